@@ -59,6 +59,8 @@
 #include "src/executor/attach_op_execs_pass.cc"
 #include "src/executor/attach_op_resource_pass.cc"
 #include "src/executor/inplace_addto_detect_pass.cc"
+#include "src/executor/fuse_elemwise_pass.cc"
+#include "src/executor/fold_batch_norm.cc"
 
 #include "src/nnvm/legacy_json_util.cc"
 #include "src/nnvm/legacy_op_util.cc"
@@ -83,6 +85,7 @@
 #include "src/operator/tensor/elemwise_unary_op_basic.cc"
 #include "src/operator/tensor/elemwise_unary_op_trig.cc"
 #include "src/operator/tensor/matrix_op.cc"
+#include "src/operator/fused_elemwise.cc"
 
 #include "src/storage/storage.cc"
 
@@ -90,6 +93,7 @@
 #include "src/initialize.cc"
 
 #include "src/c_api/c_predict_api.cc"
+#include "src/c_api/c_predict_batcher.cc"
 #include "src/c_api/c_api_symbolic.cc"
 #include "src/c_api/c_api_ndarray.cc"
 #include "src/c_api/c_api_error.cc"
@@ -0,0 +1,86 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""Write a copy of mxnet_predict0.cc that only includes the operators a model uses.
+
+Usage: python prune_ops.py model-symbol.json mxnet_predict0.cc output.cc
+
+Every included src/operator source is scanned for the operator names and aliases
+it registers. Sources registering none of the operators of the symbol, nor of the
+ones the executor inserts itself, are left out of the amalgamation.
+"""
+from __future__ import print_function
+
+import json
+import os.path
+import re
+import sys
+
+# operators the predictor looks up whatever the model is
+RUNTIME_OPS = ['BatchNorm', '_FusedElemwise']
+
+re_include = re.compile(r'^#include "(src/operator/.*\.cc)"')
+re_register = re.compile(r'(?:NNVM|MXNET)_\w*REGISTER\w*\(\s*(\w+)')
+re_alias = re.compile(r'\.add_alias\("(\w+)"\)')
+
+
+def model_ops(symbol_file):
+    """Names of the operators of the nodes of a symbol json file."""
+    with open(symbol_file) as f:
+        nodes = json.load(f)['nodes']
+    return set(node['op'] for node in nodes if node['op'] != 'null')
+
+
+def registered_ops(source):
+    """Names and aliases of the operators a source file registers."""
+    with open(source) as f:
+        text = f.read()
+    return set(re_register.findall(text)) | set(re_alias.findall(text))
+
+
+def main():
+    if len(sys.argv) != 4:
+        print(__doc__)
+        sys.exit(1)
+    symbol_file, predict_file, output = sys.argv[1:]
+    mxnet_root = os.path.join(os.path.dirname(os.path.realpath(__file__)), os.pardir)
+    needed = model_ops(symbol_file) | set(RUNTIME_OPS)
+
+    lines = []
+    found = set()
+    with open(predict_file) as f:
+        for line in f:
+            m = re_include.match(line)
+            if m:
+                ops = registered_ops(os.path.join(mxnet_root, m.group(1)))
+                # sources registering nothing are the operator framework itself
+                if ops and not ops & needed:
+                    print('Pruned:', m.group(1))
+                    continue
+                found |= ops
+            lines.append(line)
+
+    missing = sorted(needed - found - set(RUNTIME_OPS))
+    if missing:
+        print('Operators of %s not in the amalgamation: %s' % (symbol_file, ', '.join(missing)))
+        sys.exit(1)
+    with open(output, 'w') as f:
+        f.writelines(lines)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,69 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+
+"""Compare two result files of mxnet_bench and report the cases which got slower.
+
+    python benchmark/cpp/compare.py base.json new.json --threshold 0.05
+
+Exits with status 1 when a case is slower than the threshold allows, or stopped running.
+"""
+from __future__ import print_function
+import argparse
+import json
+import sys
+
+
+def load(fname):
+    with open(fname) as f:
+        return {r['key']: r for r in json.load(f)['results']}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('base', help='results of the reference build')
+    parser.add_argument('new', help='results of the build to check')
+    parser.add_argument('--threshold', type=float, default=0.05,
+                        help='relative slowdown of the median time reported as a regression')
+    args = parser.parse_args()
+    base, new = load(args.base), load(args.new)
+    regressions = 0
+    print('%-72s %12s %12s %8s' % ('case', 'base (us)', 'new (us)', 'change'))
+    for key in sorted(set(base) & set(new)):
+        b, n = base[key], new[key]
+        if not b['ok']:
+            continue
+        if not n['ok']:
+            print('%-72s %12.1f %12s   FAILED %s' % (key, b['median_us'], '-', n['error']))
+            regressions += 1
+            continue
+        change = n['median_us'] / b['median_us'] - 1
+        flag = ''
+        if change > args.threshold:
+            flag = '  REGRESSION'
+            regressions += 1
+        print('%-72s %12.1f %12.1f %+7.1f%%%s' % (key, b['median_us'], n['median_us'],
+                                                 change * 100, flag))
+    for key in sorted(set(base) - set(new)):
+        print('%-72s only in %s' % (key, args.base))
+    print('%d regression(s)' % regressions)
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,380 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file operator_bench.cc
+ * \brief Forward pass benchmark of the hot operators over a matrix of shapes. Prints a
+ *  table and writes JSON results which compare.py checks for regressions between builds.
+ */
+#include <mxnet/c_api.h>
+#include <nnvm/c_api.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+typedef std::vector<mx_uint> Shape;
+typedef std::vector<std::pair<std::string, std::string>> Params;
+
+/*! \brief how to fill an input, detection inputs need valid boxes and image sizes */
+enum Fill { kUniform, kImInfo, kRois };
+
+struct Input {
+  Shape shape;
+  Fill fill;
+};
+
+struct Case {
+  /*! \brief name of the case, unique within the suite */
+  std::string name;
+  std::string op;
+  Params params;
+  std::vector<Input> inputs;
+  /*! \brief floating point operations of one forward pass, 0 if not meaningful */
+  double flops;
+  /*! \brief height and width of the image the boxes of kRois and kImInfo inputs refer to */
+  float image_h, image_w;
+};
+
+struct Options {
+  int dev_type = 1;
+  int dev_id = 0;
+  std::string filter;
+  double min_time = 0.2;
+  int repeats = 5;
+  double peak_gbps = 0;
+  std::string output = "mxnet_bench.json";
+};
+
+struct Result {
+  const Case *c;
+  bool ok;
+  std::string error;
+  double median_us, min_us;
+  double bytes;
+};
+
+std::string ToString(const Shape &shape) {
+  std::ostringstream os;
+  os << "(";
+  for (size_t i = 0; i < shape.size(); ++i) os << (i ? ", " : "") << shape[i];
+  os << (shape.size() == 1 ? ",)" : ")");
+  return os.str();
+}
+
+size_t Size(const Shape &shape) {
+  size_t size = 1;
+  for (mx_uint d : shape) size *= d;
+  return size;
+}
+
+size_t DTypeSize(int dtype) {
+  switch (dtype) {
+    case 1: case 6: return 8;
+    case 2: return 2;
+    case 3: case 5: return 1;
+    default: return 4;
+  }
+}
+
+/*! \brief the hot operators over a matrix of shapes */
+std::vector<Case> Suite() {
+  std::vector<Case> cases;
+  for (auto s : std::vector<std::vector<mx_uint>>{
+           {1, 64, 56, 56, 64, 3}, {32, 64, 56, 56, 64, 3},
+           {32, 256, 14, 14, 256, 3}, {32, 256, 56, 56, 64, 1}}) {
+    const mx_uint n = s[0], c = s[1], h = s[2], w = s[3], k = s[4], r = s[5];
+    const std::string kernel = "(" + std::to_string(r) + ", " + std::to_string(r) + ")";
+    const std::string pad = "(" + std::to_string(r / 2) + ", " + std::to_string(r / 2) + ")";
+    cases.push_back({"Convolution", "Convolution",
+                     {{"kernel", kernel}, {"pad", pad}, {"num_filter", std::to_string(k)}},
+                     {{{n, c, h, w}, kUniform}, {{k, c, r, r}, kUniform}, {{k}, kUniform}},
+                     2.0 * n * k * h * w * c * r * r, 0, 0});
+  }
+  for (auto s : std::vector<std::vector<mx_uint>>{
+           {1, 1024, 1000}, {64, 1024, 1000}, {256, 4096, 4096}}) {
+    cases.push_back({"FullyConnected", "FullyConnected", {{"num_hidden", std::to_string(s[2])}},
+                     {{{s[0], s[1]}, kUniform}, {{s[2], s[1]}, kUniform}, {{s[2]}, kUniform}},
+                     2.0 * s[0] * s[1] * s[2], 0, 0});
+  }
+  for (Shape s : std::vector<Shape>{{32, 64, 56, 56}, {32, 256, 14, 14}}) {
+    const Shape c = {s[1]};
+    cases.push_back({"BatchNorm", "BatchNorm", {},
+                     {{s, kUniform}, {c, kUniform}, {c, kUniform}, {c, kUniform}, {c, kUniform}},
+                     0, 0, 0});
+  }
+  cases.push_back({"Pooling", "Pooling",
+                   {{"kernel", "(3, 3)"}, {"stride", "(2, 2)"}, {"pool_type", "max"}},
+                   {{{32, 64, 112, 112}, kUniform}}, 0, 0, 0});
+  cases.push_back({"Pooling", "Pooling",
+                   {{"kernel", "(7, 7)"}, {"global_pool", "True"}, {"pool_type", "avg"}},
+                   {{{32, 2048, 7, 7}, kUniform}}, 0, 0, 0});
+  for (Shape s : std::vector<Shape>{{64, 1000}, {128, 30000}}) {
+    cases.push_back({"softmax", "softmax", {}, {{s, kUniform}}, 0, 0, 0});
+  }
+  cases.push_back({"broadcast_add", "broadcast_add", {},
+                   {{{32, 256, 56, 56}, kUniform}, {{1, 256, 1, 1}, kUniform}}, 0, 0, 0});
+  cases.push_back({"broadcast_add", "broadcast_add", {},
+                   {{{1024, 1024}, kUniform}, {{1024, 1}, kUniform}}, 0, 0, 0});
+  cases.push_back({"sum", "sum", {{"axis", "(2, 3)"}}, {{{32, 256, 56, 56}, kUniform}}, 0, 0, 0});
+  cases.push_back({"sum", "sum", {{"axis", "1"}}, {{{1024, 1024}, kUniform}}, 0, 0, 0});
+  cases.push_back({"topk", "topk", {{"k", "10"}}, {{{64, 30000}, kUniform}}, 0, 0, 0});
+  cases.push_back({"topk", "topk", {{"k", "100"}}, {{{1, 100000}, kUniform}}, 0, 0, 0});
+  for (mx_uint rois : {128, 512}) {
+    cases.push_back({"ROIAlign_v2", "_contrib_ROIAlign_v2",
+                     {{"pooled_size", "(7, 7)"}, {"spatial_scale", "0.0625"}},
+                     {{{1, 256, 64, 64}, kUniform}, {{rois, 5}, kRois}}, 0, 1024, 1024});
+  }
+  // 4 scales times 3 ratios make 12 anchors per position
+  cases.push_back({"Proposal", "_contrib_Proposal", {{"rpn_post_nms_top_n", "300"}},
+                   {{{1, 24, 38, 50}, kUniform}, {{1, 48, 38, 50}, kUniform},
+                    {{1, 3}, kImInfo}}, 0, 608, 800});
+  for (auto s : std::vector<std::vector<mx_uint>>{{1, 300, 21}, {4, 300, 81}}) {
+    const mx_uint n = s[0], r = s[1], c = s[2];
+    cases.push_back({"PostDetection", "PostDetection", {},
+                     {{{n * r, 5}, kRois}, {{n, r, c}, kUniform}, {{n, r, 4 * c}, kUniform},
+                      {{n, 3}, kImInfo}}, 0, 600, 800});
+  }
+  return cases;
+}
+
+std::vector<float> FillData(const Input &input, const Case &c, std::mt19937 *rng) {
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::vector<float> data(Size(input.shape));
+  switch (input.fill) {
+    case kUniform:
+      for (float &v : data) v = uniform(*rng);
+      break;
+    case kImInfo:
+      for (size_t i = 0; i + 2 < data.size(); i += 3) {
+        data[i] = c.image_h;
+        data[i + 1] = c.image_w;
+        data[i + 2] = 1.f;
+      }
+      break;
+    case kRois: {
+      // (batch index, x1, y1, x2, y2), the boxes of a batch are contiguous
+      const size_t num = input.shape[0];
+      const size_t batch = c.inputs.size() > 1 && c.inputs[1].shape.size() == 3 ?
+                           c.inputs[1].shape[0] : 1;
+      for (size_t i = 0; i < num; ++i) {
+        const float x = uniform(*rng) * c.image_w * 0.75f;
+        const float y = uniform(*rng) * c.image_h * 0.75f;
+        data[i * 5] = static_cast<float>(i * batch / num);
+        data[i * 5 + 1] = x;
+        data[i * 5 + 2] = y;
+        data[i * 5 + 3] = x + uniform(*rng) * c.image_w * 0.25f + 1;
+        data[i * 5 + 4] = y + uniform(*rng) * c.image_h * 0.25f + 1;
+      }
+      break;
+    }
+  }
+  return data;
+}
+
+/*! \brief NDArrays freed at the end of the scope */
+struct Handles {
+  std::vector<NDArrayHandle> v;
+  ~Handles() {
+    for (NDArrayHandle h : v) MXNDArrayFree(h);
+  }
+};
+
+#define BENCH_CALL(call)                  \
+  if ((call) != 0) {                      \
+    result->error = MXGetLastError();     \
+    return false;                         \
+  }
+
+/*! \brief run a case, returns false with the error of MXNet on failure */
+bool Run(const Case &c, const Options &opt, Result *result) {
+  std::vector<const char *> keys, vals;
+  for (const auto &kv : c.params) {
+    keys.push_back(kv.first.c_str());
+    vals.push_back(kv.second.c_str());
+  }
+  OpHandle op = nullptr;
+  BENCH_CALL(NNGetOpHandle(c.op.c_str(), &op));
+  Handles inputs, outputs;
+  std::mt19937 rng(0);
+  result->bytes = 0;
+  for (const Input &input : c.inputs) {
+    NDArrayHandle h;
+    BENCH_CALL(MXNDArrayCreateEx(input.shape.data(), input.shape.size(), opt.dev_type,
+                                 opt.dev_id, 0, 0, &h));
+    inputs.v.push_back(h);
+    const std::vector<float> data = FillData(input, c, &rng);
+    BENCH_CALL(MXNDArraySyncCopyFromCPU(h, data.data(), data.size()));
+    result->bytes += data.size() * sizeof(float);
+  }
+  // the first call allocates the outputs, the others write into them
+  int num_outputs = 0;
+  NDArrayHandle *out_ptr = nullptr;
+  BENCH_CALL(MXImperativeInvoke(op, inputs.v.size(), inputs.v.data(), &num_outputs, &out_ptr,
+                                keys.size(), keys.data(), vals.data()));
+  outputs.v.assign(out_ptr, out_ptr + num_outputs);
+  for (NDArrayHandle h : outputs.v) {
+    mx_uint ndim;
+    const mx_uint *dims;
+    int dtype;
+    BENCH_CALL(MXNDArrayGetShape(h, &ndim, &dims));
+    BENCH_CALL(MXNDArrayGetDType(h, &dtype));
+    result->bytes += Size(Shape(dims, dims + ndim)) * DTypeSize(dtype);
+  }
+  // the first pass warms up, then the iterations of a measurement are doubled
+  // until it takes its share of min_time
+  std::vector<double> times;
+  size_t iters = 1;
+  for (int pass = 0; static_cast<int>(times.size()) < opt.repeats; ++pass) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < iters; ++i) {
+      out_ptr = outputs.v.data();
+      BENCH_CALL(MXImperativeInvoke(op, inputs.v.size(), inputs.v.data(), &num_outputs,
+                                    &out_ptr, keys.size(), keys.data(), vals.data()));
+    }
+    BENCH_CALL(MXNDArrayWaitAll());
+    const double elapsed = std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    if (elapsed >= opt.min_time / opt.repeats || iters >= (1 << 20)) {
+      if (pass > 0) times.push_back(elapsed * 1e6 / iters);
+    } else {
+      iters *= 2;
+    }
+  }
+  std::sort(times.begin(), times.end());
+  result->median_us = times[times.size() / 2];
+  result->min_us = times.front();
+  return true;
+}
+
+#undef BENCH_CALL
+
+std::string JSONString(const std::string &s) {
+  std::string out = "\"";
+  for (char ch : s) {
+    if (ch == '"' || ch == '\\') out += '\\';
+    if (ch == '\n') {
+      out += "\\n";
+      continue;
+    }
+    out += ch;
+  }
+  return out + "\"";
+}
+
+/*! \brief the key compare.py matches results by */
+std::string Key(const Case &c) {
+  std::ostringstream os;
+  os << c.name;
+  for (const auto &kv : c.params) os << " " << kv.first << "=" << kv.second;
+  for (const Input &input : c.inputs) os << " " << ToString(input.shape);
+  return os.str();
+}
+
+void WriteJSON(const std::vector<Result> &results, const Options &opt) {
+  int version = 0;
+  MXGetVersion(&version);
+  std::ofstream os(opt.output);
+  os << "{\n  \"version\": " << version << ",\n  \"device\": \""
+     << (opt.dev_type == 2 ? "gpu" : "cpu") << "(" << opt.dev_id << ")\",\n"
+     << "  \"peak_gbps\": " << opt.peak_gbps << ",\n  \"results\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    os << (i ? "," : "") << "\n    {\"key\": " << JSONString(Key(*r.c))
+       << ", \"op\": " << JSONString(r.c->op) << ", \"ok\": " << (r.ok ? "true" : "false");
+    if (r.ok) {
+      const double gbps = r.bytes / r.median_us / 1e3;
+      os << ", \"median_us\": " << r.median_us << ", \"min_us\": " << r.min_us
+         << ", \"gflops\": " << r.c->flops / r.median_us / 1e3
+         << ", \"gbps\": " << gbps
+         << ", \"bandwidth_utilization\": " << (opt.peak_gbps > 0 ? gbps / opt.peak_gbps : 0);
+    } else {
+      os << ", \"error\": " << JSONString(r.error);
+    }
+    os << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+void Usage(const char *prog) {
+  std::cerr << "Usage: " << prog << " [options]\n"
+            << "  --gpu ID          run on the GPU ID instead of the CPU\n"
+            << "  --filter STR      only run the cases whose name contains STR\n"
+            << "  --min-time SEC    time to spend measuring each case (default 0.2)\n"
+            << "  --repeats N       number of measurements, the median is reported (default 5)\n"
+            << "  --peak-gbps GBPS  peak memory bandwidth of the device, to report utilization\n"
+            << "  --output FILE     JSON results (default mxnet_bench.json)\n";
+  std::exit(1);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) Usage(argv[0]);
+    const char *value = argv[++i];
+    if (arg == "--gpu") {
+      opt.dev_type = 2;
+      opt.dev_id = std::atoi(value);
+    } else if (arg == "--filter") {
+      opt.filter = value;
+    } else if (arg == "--min-time") {
+      opt.min_time = std::atof(value);
+    } else if (arg == "--repeats") {
+      opt.repeats = std::max(1, std::atoi(value));
+    } else if (arg == "--peak-gbps") {
+      opt.peak_gbps = std::atof(value);
+    } else if (arg == "--output") {
+      opt.output = value;
+    } else {
+      Usage(argv[0]);
+    }
+  }
+  const std::vector<Case> cases = Suite();
+  std::vector<Result> results;
+  std::printf("%-72s %12s %10s %10s\n", "case", "median (us)", "GFLOP/s", "GB/s");
+  for (const Case &c : cases) {
+    if (!opt.filter.empty() && c.name.find(opt.filter) == std::string::npos) continue;
+    Result r;
+    r.c = &c;
+    const std::string key = Key(c);
+    r.ok = Run(c, opt, &r);
+    if (r.ok) {
+      std::printf("%-72s %12.1f %10.1f %10.1f\n", key.c_str(), r.median_us,
+                  c.flops / r.median_us / 1e3, r.bytes / r.median_us / 1e3);
+    } else {
+      std::printf("%-72s failed: %s\n", key.c_str(), r.error.c_str());
+    }
+    results.push_back(r);
+  }
+  WriteJSON(results, opt);
+  return 0;
+}
@@ -0,0 +1,252 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+
+"""Throughput of the image record iterators, per stage and end to end.
+
+The single-thread cost of each stage of the pipeline (read, decode, augment, normalize,
+batch) is measured on a sample of records with the Python equivalents of what the
+iterators do in C++. The iterators are then run end to end for each number of
+preprocessing threads, with and without prefetching, and the thread count at which
+adding threads stops helping is reported: past it the pipeline is bound by something
+else than decoding and augmentation, usually reading or the consumer.
+
+Without --rec, JPEG records are synthesized for every --image-sizes short edge, which
+needs OpenCV (cv2). Example, sizing the CPU needed to feed a GPU training at 1500 img/s:
+
+    python benchmark/python/io/image_iter_perf.py --threads 1,2,4,8,16 --target 1500
+"""
+from __future__ import print_function
+import argparse
+import json
+import logging
+import os
+import shutil
+import tempfile
+import time
+
+import numpy as np
+import mxnet as mx
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--rec', type=str, default=None,
+                        help='classification record file to read instead of synthetic ones')
+    parser.add_argument('--det-rec', type=str, default=None,
+                        help='detection record file for ImageDetRecordIter')
+    parser.add_argument('--image-sizes', type=str, default='256,512,1024',
+                        help='short edges of the synthetic images, one record file each')
+    parser.add_argument('--num-images', type=int, default=1024,
+                        help='number of images of each synthetic record file')
+    parser.add_argument('--data-shape', type=str, default='3,224,224')
+    parser.add_argument('--batch-size', type=int, default=64)
+    parser.add_argument('--threads', type=str, default='1,2,4,8',
+                        help='numbers of preprocessing threads to run the iterators with')
+    parser.add_argument('--iters', type=str,
+                        default='ImageRecordIter,ImageRecordIter_v1,ImageDetRecordIter',
+                        help='iterators to benchmark')
+    parser.add_argument('--num-batches', type=int, default=50,
+                        help='batches to time the iterators over, after 5 warm-up batches')
+    parser.add_argument('--sample', type=int, default=200,
+                        help='records to measure the single-thread stage costs on')
+    parser.add_argument('--target', type=float, default=0,
+                        help='images/sec the pipeline has to sustain, e.g. for one GPU')
+    parser.add_argument('--output', type=str, default='image_iter_perf.json',
+                        help='JSON file of the results')
+    return parser.parse_args()
+
+
+def synthesize(path, short_edge, num_images, detection):
+    """Write num_images random JPEGs with the given short edge, and 4:3 aspect ratio"""
+    import cv2  # pylint: disable=import-error
+    rng = np.random.RandomState(0)
+    long_edge = short_edge * 4 // 3
+    with open(path + '.lst', 'w') as lst:
+        rec = mx.recordio.MXIndexedRecordIO(path + '.idx', path + '.rec', 'w')
+        for i in range(num_images):
+            # smooth random images compress like photos, unlike white noise
+            small = rng.randint(0, 255, (short_edge // 16, long_edge // 16, 3)).astype(np.uint8)
+            img = cv2.resize(small, (long_edge, short_edge), interpolation=cv2.INTER_CUBIC)
+            if detection:
+                # header width 2, object width 5: class, xmin, ymin, xmax, ymax
+                label = [2, 5, i % 20, 0.1, 0.1, 0.6, 0.7]
+            else:
+                label = float(i % 1000)
+            header = mx.recordio.IRHeader(0, label, i, 0)
+            rec.write_idx(i, mx.recordio.pack_img(header, img, quality=90))
+            lst.write('%d\t0\timage%d.jpg\n' % (i, i))
+        rec.close()
+    return path + '.rec'
+
+
+def stage_costs(rec_path, sample, data_shape, batch_size):
+    """Single-thread seconds per image of each stage"""
+    reader = mx.recordio.MXRecordIO(rec_path, 'r')
+    costs = {}
+    start = time.time()
+    records, nbytes = [], 0
+    while len(records) < sample:
+        s = reader.read()
+        if s is None:
+            break
+        records.append(s)
+        nbytes += len(s)
+    reader.close()
+    costs['read'] = (time.time() - start) / len(records)
+    payloads = [mx.recordio.unpack(s)[1] for s in records]
+
+    start = time.time()
+    images = [mx.image.imdecode(p) for p in payloads]
+    mx.nd.waitall()
+    costs['decode'] = (time.time() - start) / len(images)
+
+    augmenters = mx.image.CreateAugmenter(data_shape, resize=data_shape[1] * 8 // 7,
+                                          rand_crop=True, rand_mirror=True)
+    start = time.time()
+    augmented = []
+    for img in images:
+        for aug in augmenters:
+            img = aug(img)
+        augmented.append(img)
+    mx.nd.waitall()
+    costs['augment'] = (time.time() - start) / len(images)
+
+    normalize = mx.image.ColorNormalizeAug(mx.nd.array([123.68, 116.28, 103.53]),
+                                           mx.nd.array([58.395, 57.12, 57.375]))
+    start = time.time()
+    normalized = [normalize(img) for img in augmented]
+    mx.nd.waitall()
+    costs['normalize'] = (time.time() - start) / len(images)
+
+    start = time.time()
+    count = 0
+    for i in range(0, len(normalized) - batch_size + 1, batch_size):
+        batch = mx.nd.stack(*normalized[i:i + batch_size]).transpose((0, 3, 1, 2))
+        batch.wait_to_read()
+        count += batch_size
+    costs['batch'] = (time.time() - start) / count if count else float('nan')
+    return costs, nbytes / len(records)
+
+
+def make_iter(name, rec_path, data_shape, batch_size, threads, prefetch):
+    kwargs = dict(path_imgrec=rec_path, data_shape=data_shape, batch_size=batch_size,
+                  preprocess_threads=threads, prefetch_buffer=prefetch, shuffle=False,
+                  round_batch=True, mean_r=123.68, mean_g=116.28, mean_b=103.53)
+    if name == 'ImageDetRecordIter':
+        kwargs.update(rand_mirror_prob=0.5, label_pad_width=-1)
+    else:
+        kwargs.update(resize=data_shape[1] * 8 // 7, rand_crop=True, rand_mirror=True,
+                      std_r=58.395, std_g=57.12, std_b=57.375)
+        if name == 'ImageRecordIter_v1':
+            for key in ['std_r', 'std_g', 'std_b']:
+                del kwargs[key]
+    return getattr(mx.io, name)(**kwargs)
+
+
+def end_to_end(it, batch_size, num_batches):
+    """images/sec of an iterator, wrapping around the record file as needed"""
+    def next_batch():
+        try:
+            batch = it.next()
+        except StopIteration:
+            it.reset()
+            batch = it.next()
+        batch.data[0].wait_to_read()
+    for _ in range(5):
+        next_batch()
+    start = time.time()
+    for _ in range(num_batches):
+        next_batch()
+    return num_batches * batch_size / (time.time() - start)
+
+
+def saturation(rates):
+    """The thread count past which adding threads speeds up less than 10%"""
+    for (t0, r0), (_, r1) in zip(rates, rates[1:]):
+        if r1 < r0 * 1.1:
+            return t0
+    return rates[-1][0]
+
+
+def main():
+    logging.basicConfig(level=logging.INFO)
+    args = parse_args()
+    data_shape = tuple(int(x) for x in args.data_shape.split(','))
+    threads = [int(x) for x in args.threads.split(',')]
+    iters = args.iters.split(',')
+    workdir = tempfile.mkdtemp()
+    results = []
+    try:
+        inputs = []
+        if args.rec:
+            inputs.append(('user', args.rec, args.det_rec))
+        else:
+            for size in [int(x) for x in args.image_sizes.split(',')]:
+                base = os.path.join(workdir, 'img%d' % size)
+                logging.info('synthesizing %d images of short edge %d', args.num_images, size)
+                inputs.append((size, synthesize(base, size, args.num_images, False),
+                               synthesize(base + '_det', size, args.num_images, True)))
+        for size, rec, det_rec in inputs:
+            costs, record_bytes = stage_costs(rec, args.sample, data_shape, args.batch_size)
+            print('\nimages of %s, %.1f KB per record' % (size, record_bytes / 1024.))
+            print('single thread: ' + ', '.join('%s %.0f img/s' % (k, 1. / v)
+                                                for k, v in sorted(costs.items()) if v > 0))
+            # decoding, augmentation and normalization run in the preprocessing threads
+            per_thread = 1. / (costs['decode'] + costs['augment'] + costs['normalize'])
+            entry = {'images': size, 'record_bytes': record_bytes,
+                     'stage_img_per_sec': {k: 1. / v for k, v in costs.items() if v > 0},
+                     'iterators': {}}
+            for name in iters:
+                path = det_rec if name == 'ImageDetRecordIter' else rec
+                if path is None:
+                    continue
+                rates = []
+                for t in threads:
+                    rates.append((t, end_to_end(make_iter(name, path, data_shape,
+                                                           args.batch_size, t, 4),
+                                                args.batch_size, args.num_batches)))
+                no_prefetch = end_to_end(make_iter(name, path, data_shape, args.batch_size,
+                                                   threads[-1], 1),
+                                         args.batch_size, args.num_batches)
+                sat = saturation(rates)
+                best = max(r for _, r in rates)
+                print('%-20s ' % name + '  '.join('%2d threads %6.0f img/s (%3.0f%% of %d x %.0f)'
+                                               % (t, r, 100. * r / (t * per_thread), t,
+                                                  per_thread) for t, r in rates))
+                print('%-20s saturates at %d threads, %.0f img/s; '
+                      'without prefetching %.0f img/s' % ('', sat, best, no_prefetch))
+                if args.target > 0:
+                    enough = [t for t, r in rates if r >= args.target]
+                    print('%-20s %s' % ('', 'reaches %.0f img/s with %d threads' % (
+                        args.target, enough[0]) if enough else 'does not reach %.0f img/s'
+                        % args.target))
+                entry['iterators'][name] = {
+                    'img_per_sec': {str(t): r for t, r in rates},
+                    'saturation_threads': sat,
+                    'img_per_sec_without_prefetch': no_prefetch}
+            results.append(entry)
+    finally:
+        shutil.rmtree(workdir)
+    with open(args.output, 'w') as f:
+        json.dump({'data_shape': data_shape, 'batch_size': args.batch_size,
+                   'results': results}, f, indent=2)
+
+
+if __name__ == '__main__':
+    main()
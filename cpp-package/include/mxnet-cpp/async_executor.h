@@ -0,0 +1,102 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+*  Copyright (c) 2018 by Contributors
+* \file async_executor.h
+* \brief executor wrapper pipelining the submission of batches
+*/
+
+#ifndef MXNET_CPP_ASYNC_EXECUTOR_H_
+#define MXNET_CPP_ASYNC_EXECUTOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "mxnet-cpp/base.h"
+#include "mxnet-cpp/ndarray.h"
+#include "mxnet-cpp/executor.h"
+
+namespace mxnet {
+namespace cpp {
+
+/*!
+* \brief Runs the forward passes of an executor without waiting for them.
+*  Inputs are copied into one of several buffers, so the next batch can be
+*  prepared while the previous ones are computed, and every submission returns
+*  a future of its outputs.
+*/
+class AsyncExecutor {
+ public:
+  /*! \brief outputs of a forward pass, in the order of Executor::outputs */
+  typedef std::vector<std::vector<mx_float> > Result;
+
+  /*!
+  * \brief AsyncExecutor constructor
+  * \param exec The executor to run, it must outlive this object.
+  * \param input_names Names of the arguments set by each submission.
+  * \param num_buffers Number of batches in flight at most.
+  */
+  AsyncExecutor(Executor *exec, const std::vector<std::string> &input_names,
+                int num_buffers = 2);
+  /*!
+  * \brief wait for the submitted batches and stop the completion thread
+  */
+  ~AsyncExecutor();
+
+  /*!
+  * \brief Submit a batch for inference.
+  *  Blocks only while all the buffers hold batches in flight. Must not be called
+  *  from several threads at once.
+  * \param inputs Data of every input, with the size of its argument array.
+  * \return The future outputs of the batch.
+  */
+  std::shared_future<Result> Submit(const std::map<std::string, const mx_float*> &inputs);
+
+ private:
+  struct Buffer {
+    std::vector<NDArray> inputs;
+    std::vector<NDArray> outputs;
+    std::shared_future<Result> done;
+  };
+  AsyncExecutor(const AsyncExecutor &e);
+  AsyncExecutor &operator=(const AsyncExecutor &e);
+  void Complete();
+
+  Executor *exec_;
+  std::vector<std::string> input_names_;
+  std::vector<NDArray> args_;
+  std::vector<Buffer> buffers_;
+  size_t next_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::pair<Buffer*, std::promise<Result> > > pending_;
+  bool stop_;
+  std::thread completer_;
+};
+
+}  // namespace cpp
+}  // namespace mxnet
+#endif  // MXNET_CPP_ASYNC_EXECUTOR_H_
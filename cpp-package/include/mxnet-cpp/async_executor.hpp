@@ -0,0 +1,121 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+*  Copyright (c) 2018 by Contributors
+* \file async_executor.hpp
+* \brief implementation of the executor wrapper pipelining batches
+*/
+
+#ifndef MXNET_CPP_ASYNC_EXECUTOR_HPP_
+#define MXNET_CPP_ASYNC_EXECUTOR_HPP_
+
+#include <exception>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mxnet-cpp/async_executor.h"
+
+namespace mxnet {
+namespace cpp {
+inline AsyncExecutor::AsyncExecutor(Executor *exec,
+                                    const std::vector<std::string> &input_names,
+                                    int num_buffers)
+  : exec_(exec), input_names_(input_names), buffers_(num_buffers), next_(0), stop_(false) {
+  CHECK_GT(num_buffers, 0);
+  std::map<std::string, NDArray> args = exec_->arg_dict();
+  for (const auto &name : input_names_) {
+    CHECK(args.count(name)) << "No argument named " << name;
+    args_.push_back(args[name]);
+  }
+  // inputs stay on the device of the executor, outputs are read from the cpu
+  for (auto &buffer : buffers_) {
+    for (const auto &arg : args_) {
+      buffer.inputs.emplace_back(arg.GetShape(), arg.GetContext(), false);
+    }
+    for (const auto &out : exec_->outputs) {
+      buffer.outputs.emplace_back(out.GetShape(), Context::cpu(), false);
+    }
+  }
+  completer_ = std::thread([this]() { Complete(); });
+}
+
+inline AsyncExecutor::~AsyncExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  completer_.join();
+}
+
+inline std::shared_future<AsyncExecutor::Result> AsyncExecutor::Submit(
+    const std::map<std::string, const mx_float*> &inputs) {
+  Buffer &buffer = buffers_[next_];
+  next_ = (next_ + 1) % buffers_.size();
+  // the outputs of the buffer are read until its previous batch completes
+  if (buffer.done.valid()) buffer.done.wait();
+  for (size_t i = 0; i < args_.size(); ++i) {
+    auto it = inputs.find(input_names_[i]);
+    CHECK(it != inputs.end()) << "No data for input " << input_names_[i];
+    buffer.inputs[i].SyncCopyFromCPU(it->second, buffer.inputs[i].Size());
+  }
+  // the engine orders the copies and the forward pass by their dependencies,
+  // so none of them blocks
+  for (size_t i = 0; i < args_.size(); ++i) {
+    buffer.inputs[i].CopyTo(&args_[i]);
+  }
+  exec_->Forward(false);
+  for (size_t i = 0; i < buffer.outputs.size(); ++i) {
+    exec_->outputs[i].CopyTo(&buffer.outputs[i]);
+  }
+  std::promise<Result> promise;
+  buffer.done = promise.get_future().share();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.emplace_back(&buffer, std::move(promise));
+  }
+  cv_.notify_one();
+  return buffer.done;
+}
+
+inline void AsyncExecutor::Complete() {
+  while (true) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return stop_ || !pending_.empty(); });
+    if (pending_.empty()) return;
+    auto next = std::move(pending_.front());
+    pending_.pop_front();
+    lock.unlock();
+    try {
+      Result result(next.first->outputs.size());
+      for (size_t i = 0; i < result.size(); ++i) {
+        next.first->outputs[i].SyncCopyToCPU(&result[i]);
+      }
+      next.second.set_value(std::move(result));
+    } catch (...) {
+      next.second.set_exception(std::current_exception());
+    }
+  }
+}
+
+}  // namespace cpp
+}  // namespace mxnet
+#endif  // MXNET_CPP_ASYNC_EXECUTOR_HPP_
@@ -71,6 +71,8 @@ typedef const void *FunctionHandle;
 typedef void *AtomicSymbolCreator;
 /*! \brief handle to cached operator */
 typedef void *CachedOpHandle;
+/*! \brief handle to an operator with parsed attributes */
+typedef void *OpInstanceHandle;
 /*! \brief handle to a symbol that can be bind as operator */
 typedef void *SymbolHandle;
 /*! \brief handle to a AtomicSymbol */
@@ -93,10 +95,16 @@ typedef void *CudaModuleHandle;
 typedef void *CudaKernelHandle;
 /*! \brief handle to a Profile object (domain, duration, counter, etc.) */
 typedef void *ProfileHandle;
+/*! \brief handle to a recording of engine operations */
+typedef void *EngineRecordHandle;
+/*! \brief handle to a DLManagedTensor */
+typedef void *DLManagedTensorHandle;
 
 typedef void (*ExecutorMonitorCallback)(const char*,
                                         NDArrayHandle,
                                         void *);
+/*! \brief callback of MXNDArrayOnReadyToRead, called with its callback_handle */
+typedef void (*NDArrayReadyCallback)(void *);
 
 struct NativeOpInfo {
   void (*forward)(int, float**, int*, unsigned**, int*, void*);
@@ -264,6 +272,24 @@ MXNET_DLL int MXDumpProfile(int finished);
  */
 MXNET_DLL int MXAggregateProfileStatsPrint(const char **out_str, int reset);
 
+/*!
+ * \brief Print the aggregate duration stats, with their percentiles and histograms
+ *  overall and per device, to a JSON string
+ * \param out_json Will receive a pointer to the output string
+ * \param reset Clear the aggregate stats after printing
+ * \return 0 when success, -1 when failure happens.
+ */
+MXNET_DLL int MXAggregateProfileStatsPrintJSON(const char **out_json, int reset);
+
+/*!
+ * \brief Print the statistics of the operators sampled when MXNET_PROFILER_SAMPLE_RATE
+ *  is set, as JSON
+ * \param out_json Will receive a pointer to the output string
+ * \param reset Clear the sampled statistics after printing
+ * \return 0 when success, -1 when failure happens.
+ */
+MXNET_DLL int MXProfileSampledStats(const char **out_json, int reset);
+
 /*!
  * \brief Pause profiler tuning collection
  * \param paused If nonzero, profiling pauses. Otherwise, profiling resumes/continues
@@ -272,6 +298,14 @@ MXNET_DLL int MXAggregateProfileStatsPrint(const char **out_str, int reset);
  */
 MXNET_DLL int MXProfilePause(int paused);
 
+/*!
+ * \brief Emit NVTX ranges around engine operators, graph nodes, bulk segments, CachedOp
+ *  calls and kvstore push/pull, for Nsight Systems
+ * \param enabled If nonzero, ranges are emitted. Ignored unless built with USE_NVTX
+ * \return 0 when success, -1 when failure happens.
+ */
+MXNET_DLL int MXProfileSetNVTX(int enabled);
+
 /*!
  * \brief Create profiling domain
  * \param domain String representing the domain name to create
@@ -383,6 +417,42 @@ MXNET_DLL int MXSetNumOMPThreads(int thread_num);
  */
 MXNET_DLL int MXEngineSetBulkSize(int bulk_size, int* prev_bulk_size);
 
+/*!
+ * \brief get the load of the engine worker queues created so far
+ * \param out_size number of queues
+ * \param out_names names of the queues, e.g. cpu(0), cpu_priority or gpu(0)_copy_to
+ * \param out_stats out_size rows of the number of worker threads, the pending and
+ *  the executed operations, and the microseconds operations waited in the queue,
+ *  the workers were busy and the workers were idle
+ * \return 0 when success, -1 when failure happens.
+ */
+MXNET_DLL int MXEngineGetWorkerStats(mx_uint *out_size, const char ***out_names,
+                                     const uint64_t **out_stats);
+
+/*!
+ * \brief start recording the operations the calling thread pushes to the engine
+ * \return 0 when success, -1 when failure happens.
+ */
+MXNET_DLL int MXEngineStartRecord();
+/*!
+ * \brief stop recording the operations of the calling thread
+ * \param out the recording, NULL if no operation was recorded
+ * \return 0 when success, -1 when failure happens.
+ */
+MXNET_DLL int MXEngineStopRecord(EngineRecordHandle *out);
+/*!
+ * \brief run the recorded operations again, on the same arrays
+ * \param handle the recording
+ * \return 0 when success, -1 when failure happens.
+ */
+MXNET_DLL int MXEngineReplay(EngineRecordHandle handle);
+/*!
+ * \brief free a recording once its replays completed
+ * \param handle the recording
+ * \return 0 when success, -1 when failure happens.
+ */
+MXNET_DLL int MXEngineFreeRecord(EngineRecordHandle handle);
+
 /*!
  * \brief get the MXNet library version as an integer
  * \param pointer to the integer holding the version number
@@ -502,6 +572,39 @@ MXNET_DLL int MXNDArraySave(const char* fname,
                             mx_uint num_args,
                             NDArrayHandle* args,
                             const char** keys);
+/*!
+ * \brief Save list of narray into a file in the format of MXNDArraySave, in the
+ *  background: the arrays are copied to CPU snapshots and written by operations on
+ *  the engine, so they can be updated right away.
+ * \param fname name of the file.
+ * \param num_args number of arguments to save.
+ * \param args the array of NDArrayHandles to be saved.
+ * \param keys the name of the NDArray, optional, can be NULL
+ * \param dtype the type float32 dense arrays are stored as, e.g. float16, -1 to keep it
+ * \param out an array written after the file is closed, waiting for it rethrows
+ *  the errors of writing the file
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXNDArraySaveAsync(const char* fname,
+                                 mx_uint num_args,
+                                 NDArrayHandle* args,
+                                 const char** keys,
+                                 int dtype,
+                                 NDArrayHandle* out);
+/*!
+ * \brief Save list of dense narray into a file that MXNDArrayLoad maps into memory.
+ *  The data of each array is 64 byte aligned, and loading only reads the index of
+ *  the arrays, returning CPU arrays backed by the copy-on-write mapping of the file.
+ * \param fname name of the file, a local file to be loaded by mapping.
+ * \param num_args number of arguments to save.
+ * \param args the array of NDArrayHandles to be saved.
+ * \param keys the name of the NDArray, optional, can be NULL
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXNDArraySaveMapped(const char* fname,
+                                  mx_uint num_args,
+                                  NDArrayHandle* args,
+                                  const char** keys);
 /*!
  * \brief Load list of narray from the file.
  * \param fname name of the file.
@@ -590,6 +693,26 @@ MXNET_DLL int MXNDArraySyncCheckFormat(NDArrayHandle handle, const bool full_che
  * \return 0 when success, -1 when failure happens
  */
 MXNET_DLL int MXNDArrayWaitToRead(NDArrayHandle handle);
+/*!
+ * \brief Check without blocking whether the pending writes with respect NDArray are finished.
+ * \param handle the NDArray handle
+ * \param out 1 if the NDArray can be read, 0 otherwise
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXNDArrayIsReadyToRead(NDArrayHandle handle, int *out);
+/*!
+ * \brief Call a function once the pending writes with respect NDArray are finished,
+ *  without blocking the calling thread. The callback runs on an engine thread and
+ *  must not block; MXNDArrayWaitToRead then returns at once, reporting the error of
+ *  a failed write.
+ * \param handle the NDArray handle
+ * \param callback the function to call
+ * \param callback_handle the argument passed to the callback
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXNDArrayOnReadyToRead(NDArrayHandle handle,
+                                     NDArrayReadyCallback callback,
+                                     void *callback_handle);
 /*!
  * \brief Wait until all the pending read/write with respect NDArray are finished.
  *  Always call this before write data into NDArray synchronizely.
@@ -682,6 +805,32 @@ MXNET_DLL int MXNDArrayGetShape(NDArrayHandle handle,
  */
 MXNET_DLL int MXNDArrayGetData(NDArrayHandle handle,
                                void **out_pdata);
+/*!
+ * \brief Create a DLPack tensor sharing the memory of the NDArray, without copying.
+ *  The array is kept alive until MXNDArrayCallDLPackDeleter is called on the tensor.
+ *  Wait for the pending operations on the array before using the tensor.
+ * \param handle the handle to the ndarray
+ * \param out_dlpack pointer holder to get pointer of DLManagedTensor
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXNDArrayToDLPack(NDArrayHandle handle,
+                                DLManagedTensorHandle *out_dlpack);
+/*!
+ * \brief Create an NDArray sharing the memory of a DLPack tensor, without copying.
+ *  The NDArray takes over the tensor, its deleter is called once the memory is no
+ *  longer used by the NDArray and the operations on it.
+ * \param dlpack the pointer of the input DLManagedTensor
+ * \param out_handle pointer holder to get pointer of NDArray
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXNDArrayFromDLPack(DLManagedTensorHandle dlpack,
+                                  NDArrayHandle *out_handle);
+/*!
+ * \brief Call the deleter of a DLPack tensor that is not consumed.
+ * \param dlpack the pointer of the input DLManagedTensor
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXNDArrayCallDLPackDeleter(DLManagedTensorHandle dlpack);
 /*!
  * \brief get the type of the data in NDArray
  * \param handle the handle to the narray
@@ -885,6 +1034,45 @@ MXNET_DLL int MXImperativeInvokeEx(AtomicSymbolCreator creator,
                                    const char **param_keys,
                                    const char **param_vals,
                                    const int **out_stypes);
+/*!
+ * \brief create an operator instance, which parses the keyword parameters once
+ *  so MXInvokeOpInstance only takes the arrays, for ops invoked many times
+ * \param creator the op
+ * \param num_inputs number of input NDArrays the instance is invoked with
+ * \param num_params number of keyword parameters
+ * \param param_keys keys for keyword parameters
+ * \param param_vals values for keyword parameters
+ * \param out the created instance
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXCreateOpInstance(AtomicSymbolCreator creator,
+                                 int num_inputs,
+                                 int num_params,
+                                 const char **param_keys,
+                                 const char **param_vals,
+                                 OpInstanceHandle *out);
+/*!
+ * \brief free an operator instance
+ * \param handle the instance
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXFreeOpInstance(OpInstanceHandle handle);
+/*!
+ * \brief invoke an operator instance, as MXImperativeInvokeEx
+ * \param handle the instance
+ * \param num_inputs number of input NDArrays
+ * \param inputs input NDArrays
+ * \param num_outputs number of output NDArrays
+ * \param outputs output NDArrays
+ * \param out_stypes output ndarrays' stypes, can be NULL
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXInvokeOpInstance(OpInstanceHandle handle,
+                                 int num_inputs,
+                                 NDArrayHandle *inputs,
+                                 int *num_outputs,
+                                 NDArrayHandle **outputs,
+                                 const int **out_stypes);
 /*!
  * \brief set whether to record operator for autograd
  * \param is_recording 1 when recording, 0 when not recording.
@@ -1647,6 +1835,13 @@ MXNET_DLL int MXExecutorSimpleBind(SymbolHandle symbol_handle,
 MXNET_DLL int MXExecutorSetMonitorCallback(ExecutorHandle handle,
                                            ExecutorMonitorCallback callback,
                                            void* callback_handle);
+/*!
+ * \brief set the engine priority of the operations the executor pushes
+ * \param handle the executor handle
+ * \param priority the priority, a positive one schedules them ahead of priority 0 ones
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXExecutorSetPriority(ExecutorHandle handle, int priority);
 //--------------------------------------------
 // Part 5: IO Interface
 //--------------------------------------------
@@ -2265,6 +2460,28 @@ MXNET_DLL int MXNDArrayGetSharedMemHandle(NDArrayHandle handle, int* shared_pid,
  */
 MXNET_DLL int MXNDArrayCreateFromSharedMem(int shared_pid, int shared_id, const mx_uint *shape,
                                            mx_uint ndim, int dtype, NDArrayHandle *out);
+/*!
+ * \brief Get a cuda ipc handle other processes can create an NDArray from with
+ *  MXNDArrayCreateFromGPUIpcHandle. An array not in gpu shared memory yet is
+ *  exported as a copy. The shared memory stays allocated for the lifetime of
+ *  the process, which has to outlive its importers.
+ * \param handle NDArray handle of a gpu array
+ * \param ipc_handle output buffer of 128 bytes
+ */
+MXNET_DLL int MXNDArrayGetGPUIpcHandle(NDArrayHandle handle, char* ipc_handle);
+/*!
+ * \brief Create an NDArray on gpu memory exported with MXNDArrayGetGPUIpcHandle,
+ *  in this or another process, without copying it.
+ * \param ipc_handle buffer of 128 bytes
+ * \param dev_id gpu to open the memory on, the one it was exported from
+ * \param shape pointer to NDArray dimensions
+ * \param ndim number of NDArray dimensions
+ * \param dtype data type of NDArray
+ * \param out constructed NDArray
+ */
+MXNET_DLL int MXNDArrayCreateFromGPUIpcHandle(const char* ipc_handle, int dev_id,
+                                              const mx_uint *shape, mx_uint ndim, int dtype,
+                                              NDArrayHandle *out);
 
 
 #ifdef __cplusplus
@@ -49,6 +49,8 @@ typedef float mx_float;
 typedef void *PredictorHandle;
 /*! \brief handle to NDArray list */
 typedef void *NDListHandle;
+/*! \brief handle to a request batcher */
+typedef void *PredBatcherHandle;
 
 /*!
  * \brief Get the last error happeneed.
@@ -121,6 +123,10 @@ MXNET_DLL int MXPredCreatePartialOut(const char* symbol_json_str,
                                      PredictorHandle* out);
 /*!
  * \brief Change the input shape of an existing predictor.
+ *
+ *  Executors bound for earlier shapes are kept, up to MXNET_PREDICT_EXEC_CACHE_SIZE,
+ *  and reused when the same shapes are asked for again. The original predictor
+ *  stays usable.
  * \param num_input_nodes Number of input nodes to the net,
  *    For feedforward net, this is 1.
  * \param input_keys The name of input argument.
@@ -140,6 +146,81 @@ int MXPredReshape(mx_uint num_input_nodes,
                   const mx_uint* input_shape_data,
                   PredictorHandle handle,
                   PredictorHandle* out);
+/*!
+ * \brief Create a predictor that shares the parameters of an existing one.
+ *
+ *  The new predictor reads the same parameter and auxiliary arrays, and only
+ *  owns its inputs and the memory of its executor. Predictors created this way
+ *  can run forward concurrently from different threads; on GPU their operators
+ *  run on the worker streams of the device (MXNET_GPU_WORKER_NTHREADS).
+ * \param handle The predictor to share the parameters of.
+ * \param out The created predictor handle.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredCreateShared(PredictorHandle handle,
+                                 PredictorHandle* out);
+/*!
+ * \brief Create a batcher that coalesces single sample requests into batches.
+ *
+ *  Requests of all threads are queued; a worker thread runs a batch as soon as
+ *  max_batch_size requests are queued or the oldest one has waited max_delay_us,
+ *  and copies the outputs back. Batches run through predictors reshaped from the
+ *  given one, one per batch size, so combine it with MXNET_PREDICT_BATCH_BUCKETS
+ *  to bound their number. All outputs must have the batch along axis 0.
+ * \param handle The predictor to reshape, it must outlive the batcher and must not
+ *    be used while the batcher runs.
+ * \param num_input_nodes Number of input nodes to the net.
+ * \param input_keys The name of input argument.
+ * \param input_shape_indptr Index pointer of shapes of each input node.
+ * \param input_shape_data Shapes of one sample of each input, without the batch axis.
+ * \param max_batch_size Maximum number of requests in a batch.
+ * \param max_delay_us Maximum time in microseconds a request waits for others.
+ * \param out The created batcher handle.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBatcherCreate(PredictorHandle handle,
+                                  mx_uint num_input_nodes,
+                                  const char** input_keys,
+                                  const mx_uint* input_shape_indptr,
+                                  const mx_uint* input_shape_data,
+                                  mx_uint max_batch_size,
+                                  mx_uint max_delay_us,
+                                  PredBatcherHandle* out);
+/*!
+ * \brief Get the number of floats of one sample of an output.
+ * \param handle The batcher handle.
+ * \param index The index of the output.
+ * \param out_size The size of the output of one sample.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBatcherGetOutputSize(PredBatcherHandle handle,
+                                         mx_uint index,
+                                         mx_uint* out_size);
+/*!
+ * \brief Run one sample, blocking until the batch it is part of is done.
+ *  Can be called from many threads at the same time.
+ * \param handle The batcher handle.
+ * \param inputs One sample of every input, in the order given at creation.
+ * \param outputs Buffers for one sample of every output.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBatcherPredict(PredBatcherHandle handle,
+                                   const mx_float** inputs,
+                                   mx_float** outputs);
+/*!
+ * \brief Free a batcher, after running the requests still queued.
+ * \param handle The batcher handle.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBatcherFree(PredBatcherHandle handle);
+/*!
+ * \brief Get the number of output nodes of a predictor.
+ * \param handle The handle of the predictor.
+ * \param num_outputs Used to hold the number of outputs.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredGetNumOutputs(PredictorHandle handle,
+                                  mx_uint* num_outputs);
 /*!
  * \brief Get the shape of output node.
  *  The returned shape_data and shape_ndim is only valid before next call to MXPred function.
@@ -201,6 +282,35 @@ MXNET_DLL int MXPredGetOutput(PredictorHandle handle,
                               mx_uint index,
                               mx_float* data,
                               mx_uint size);
+/*!
+ * \brief Bind a user buffer to an input of the predictor, so MXPredSetInput is not needed.
+ *  On cpu the executor reads the buffer directly, on other devices MXPredForward
+ *  schedules the copy from it, which is asynchronous for pinned memory.
+ *  The buffer must stay valid until the predictor is freed, and is not bound to
+ *  the predictors created from this one by MXPredReshape.
+ * \param handle The predictor handle.
+ * \param key The name of input node to bind.
+ * \param data The buffer holding the input, with the shape specified in MXPredCreate.
+ * \param size The size of data array, used for safety check.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBindInput(PredictorHandle handle,
+                              const char* key,
+                              mx_float* data,
+                              mx_uint size);
+/*!
+ * \brief Bind a user buffer to an output of the predictor, so MXPredGetOutput is not needed.
+ *  MXPredForward writes the output to the buffer and returns once it is there.
+ * \param handle The predictor handle.
+ * \param index The index of output node, set to 0 if there is only one output.
+ * \param data The buffer to hold the output.
+ * \param size The size of data array, used for safety check.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBindOutput(PredictorHandle handle,
+                               mx_uint index,
+                               mx_float* data,
+                               mx_uint size);
 /*!
  * \brief Free a predictor handle.
  * \param handle The handle of the predictor.
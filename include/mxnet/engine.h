@@ -31,6 +31,7 @@
 #include <memory>
 #include <functional>
 #endif
+#include <string>
 #include <vector>
 #include "./base.h"
 
@@ -41,8 +42,44 @@ class Engine;
 
 /*! \brief namespace of engine internal types. */
 namespace engine {
+/*! \brief load of the workers serving one queue of the engine */
+struct WorkerStats {
+  /*! \brief the queue, e.g. cpu(0), cpu_priority, gpu(0) or gpu(0)_copy_to */
+  std::string name;
+  /*! \brief number of worker threads */
+  uint64_t nthreads{0};
+  /*! \brief operations waiting in the queue */
+  uint64_t pending{0};
+  /*! \brief operations run so far */
+  uint64_t executed{0};
+  /*! \brief microseconds operations waited in the queue, summed over operations */
+  uint64_t queue_wait_us{0};
+  /*! \brief microseconds the workers ran operations, summed over threads */
+  uint64_t busy_us{0};
+  /*! \brief microseconds the workers waited for operations, summed over threads */
+  uint64_t idle_us{0};
+};
+
 /*! \brief Internal representation of variable. */
-struct Var;
+struct Var {
+  virtual ~Var() = default;
+  /*!
+   * \brief number of writes to the variable that have completed. It only
+   *  changes while no operation holds a dependency on the variable.
+   */
+  inline size_t version() const {
+    return version_;
+  }
+  /*!
+   * \brief cast variable to derived type T
+   * \tparam T the type we want to cast into.
+   * \return A casted variable.
+   */
+  template <typename T>
+  inline T* Cast();
+  /*! \brief incremented by the engine when a write to the variable completes */
+  size_t version_{0};
+};  // struct Var
 /*! \brief Internal representation of operator.  */
 struct Opr;
 /*! \brief Variable pointer type, usually hold by user used to specify dependencies. */
@@ -162,7 +199,9 @@ class MXNET_API Engine {
    * \brief Push an operator to the engine.
    * \param op The operator to push.
    * \param exec_ctx Execution context.
-   * \param priority Priority of the action, as hint to the engine.
+   * \param priority Priority of the action, as hint to the engine. Ready operations of
+   *        positive priority go ahead of the queued ones, and raise the operations they
+   *        wait for on a variable to their priority.
    * \param profiling The variable indicate whether to profile this operator.
    */
   virtual void Push(OprHandle op, Context exec_ctx, int priority = 0, bool profiling = false) = 0;
@@ -207,6 +246,12 @@ class MXNET_API Engine {
    *            variable is ready.
    */
   virtual void WaitForVar(VarHandle var) = 0;
+  /*!
+   * \brief Check without blocking whether a variable is ready to read.
+   * \param var The variable to check.
+   * \return whether all the writes pushed to the variable so far completed.
+   */
+  virtual bool IsVarReady(VarHandle var) = 0;
   /*!
    * \brief Wait until all the activity of engine finishes.
    */
@@ -284,6 +329,31 @@ class MXNET_API Engine {
     }
     read_vars->resize(rtop - read_vars->begin());
   }
+  /*!
+   * \brief Start recording the operations this thread pushes. They still run as usual.
+   */
+  virtual void StartRecord() {
+    LOG(FATAL) << "Engine cannot record operations";
+  }
+  /*!
+   * \brief Stop recording the operations this thread pushes.
+   *  The returned operator replays them each time it is pushed, with the dependencies
+   *  between them taken from the recording rather than tracked again, and with the
+   *  variables they use as its own. Waits and variable deletions are not recorded, and
+   *  the variables used must outlive the operator, which is freed by DeleteOperator.
+   * \return the operator replaying the recording, nullptr if nothing was recorded.
+   */
+  virtual OprHandle StopRecord() {
+    LOG(FATAL) << "Engine cannot record operations";
+    return nullptr;
+  }
+  /*!
+   * \brief The load of every worker queue created so far, engines without
+   *  worker queues return none.
+   */
+  virtual std::vector<engine::WorkerStats> GetWorkerStats() {
+    return std::vector<engine::WorkerStats>();
+  }
   /*! \brief query current limit for bulk size */
   virtual int bulk_size() const {
     return 0;
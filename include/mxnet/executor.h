@@ -151,6 +151,13 @@ class Executor {
    * \brief Install a callback to notify the completion of operation.
    */
   virtual void SetMonitorCallback(const MonitorCallback& callback) {}
+  /*!
+   * \brief Set the engine priority of the operations the executor pushes.
+   *  A positive priority, e.g. for latency critical inference sharing the process
+   *  with batch jobs, schedules them ahead of the operations of priority 0.
+   * \param priority the priority, 0 by default.
+   */
+  virtual void SetPriority(int priority) {}
 };  // class executor
 }  // namespace mxnet
 #endif  // MXNET_EXECUTOR_H_
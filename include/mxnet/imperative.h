@@ -28,6 +28,9 @@
 #include <nnvm/graph.h>
 #include <vector>
 #include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include <string>
 #include <unordered_map>
@@ -40,6 +43,9 @@ struct CachedOpParam : public dmlc::Parameter<CachedOpParam> {
   uint32_t inline_limit;
   uint32_t forward_bulk_size;
   uint32_t backward_bulk_size;
+  bool static_alloc;
+  uint32_t static_alloc_cache_size;
+  uint32_t shape_cache_size;
   DMLC_DECLARE_PARAMETER(CachedOpParam) {
     DMLC_DECLARE_FIELD(inline_limit)
     .set_default(2)
@@ -50,6 +56,22 @@ struct CachedOpParam : public dmlc::Parameter<CachedOpParam> {
     DMLC_DECLARE_FIELD(backward_bulk_size)
     .set_default(dmlc::GetEnv("MXNET_EXEC_BULK_EXEC_MAX_NODE_TRAIN", 15))
     .describe("Segment size of bulk execution during backward pass.");
+    DMLC_DECLARE_FIELD(static_alloc)
+    .set_default(false)
+    .describe("Keep the memory of intermediate results across inference calls "
+              "instead of allocating it on every call. Memory is planned once "
+              "per input signature.");
+    DMLC_DECLARE_FIELD(static_alloc_cache_size)
+    .set_default(4)
+    .set_lower_bound(1)
+    .describe("Number of input signatures whose memory is kept when static_alloc "
+              "is on. The least recently used one is released first.");
+    DMLC_DECLARE_FIELD(shape_cache_size)
+    .set_default(8)
+    .describe("Number of input shapes, besides the current one, whose inferred "
+              "shapes and memory plans are kept, so inputs alternating between a "
+              "few shapes, like variable length sequences, are not re-inferred "
+              "on every change. 0 keeps none.");
   }
 };
 /*! \brief runtime functions for NDArray */
@@ -137,6 +159,9 @@ class Imperative {
       std::vector<NDArray> buff;
       std::vector<OpStatePtr> states;
     };
+    /*! \brief planned graph and intermediate buffers of one inference signature */
+    struct ForwardArena;
+    std::shared_ptr<ForwardArena> GetForwardArena(const std::vector<NDArray*>& inputs);
     std::mutex mutex_;
     CachedOpParam param_;
     nnvm::Graph fwd_graph_;
@@ -148,6 +173,11 @@ class Imperative {
     std::vector<uint32_t> bwd_in_dep_, bwd_out_dep_, bwd_ograd_dep_;
     std::vector<uint32_t> bwd_input_eid_;
     std::vector<bool> save_inputs_, save_outputs_;
+    /*! \brief arenas of static_alloc by input signature, most recently used first */
+    std::list<std::pair<std::string, std::shared_ptr<ForwardArena> > > arenas_;
+    /*! \brief shapes and memory plans of previous input shapes, most recently used first */
+    std::list<std::unordered_map<std::string, std::shared_ptr<dmlc::any> > >
+        fwd_shape_cache_, bwd_shape_cache_;
   };
   /*! \brief whether operator recording is on. */
   bool is_training() const {
@@ -239,6 +269,20 @@ class Imperative {
   std::atomic<uint64_t> variable_count_{0};
   /*! \brief default backward bulk size */
   int backward_bulk_size_{0};
+  /*! \brief gradient graph and inferred attributes of one tape structure */
+  struct BackwardPlan;
+  /*!
+   * \brief describe the structure of the recorded graph ending at outputs, returns
+   *  an empty string when backward plans of it cannot be reused
+   * \param p_nodes the recorded nodes in the order of the indexed graph
+   */
+  static std::string BackwardPlanKey(const std::vector<nnvm::NodeEntry>& outputs,
+                                     const std::vector<NDArray*>& ograds,
+                                     const std::vector<NDArray*>& variables,
+                                     std::vector<nnvm::NodePtr>* p_nodes);
+  /*! \brief backward plans by tape structure, most recently used first */
+  std::list<std::pair<std::string, std::shared_ptr<BackwardPlan> > > backward_plans_;
+  std::mutex backward_plan_mutex_;
 };
 
 using CachedOpPtr = std::shared_ptr<Imperative::CachedOp>;
@@ -116,11 +116,44 @@ class NDArray {
         dtype_(data.type_flag_), storage_type_(kDefaultStorage),
         entry_({nullptr, 0, 0}) {
   }
+  /*!
+   * \brief constructing a static NDArray that shares data with TBlob, like
+   *  NDArray(data, dev_id), keeping owner alive until the data is no longer used
+   * \param data the memory content of static data
+   * \param dev_id the device id this tensor sits at
+   * \param owner the owner of the memory, e.g. a file mapping that unmaps on release
+   */
+  NDArray(const TBlob &data, int dev_id, std::shared_ptr<void> owner)
+      : NDArray(data, dev_id) {
+    ptr_->static_owner = std::move(owner);
+  }
+  /*!
+   * \brief create an NDArray sharing the memory of a DLPack tensor, for example one
+   *  allocated by another framework, without copying it
+   * \param tensor the tensor, its deleter is called once the memory is no longer used
+   * \return the NDArray
+   */
+  static NDArray FromDLPack(DLManagedTensor *tensor);
+  /*!
+   * \brief create a DLPack tensor sharing the memory of this NDArray, which is kept
+   *  alive until the deleter of the tensor is called. The caller waits for pending
+   *  operations on the array before using the tensor
+   * \return the tensor
+   */
+  DLManagedTensor *ToDLPack() const;
   /*! \brief create ndarray from shared memory */
   NDArray(int shared_pid, int shared_id, const TShape& shape, int dtype)
       : ptr_(std::make_shared<Chunk>(shared_pid, shared_id, shape, dtype)), shape_(shape),
         dtype_(dtype), storage_type_(kDefaultStorage), entry_({nullptr, 0, 0}) {
   }
+  /*!
+   * \brief create ndarray owning an allocated storage handle, e.g. gpu shared memory,
+   *  which is released through Storage::Free with the array
+   */
+  NDArray(const Storage::Handle& shandle, const TShape& shape, int dtype)
+      : ptr_(std::make_shared<Chunk>(shandle, shape)), shape_(shape),
+        dtype_(dtype), storage_type_(kDefaultStorage), entry_({nullptr, 0, 0}) {
+  }
 
   /*!
    * \brief constructing a static NDArray of non-default storage that shares data with TBlob
@@ -306,6 +339,14 @@ class NDArray {
     if (is_none()) return;
     Engine::Get()->WaitForVar(ptr_->var);
   }
+  /*!
+   * \brief Check without blocking whether the pending write operations with
+   *    respect to current NDArray are finished.
+   */
+  inline bool IsReadyToRead() const {
+    if (is_none()) return true;
+    return Engine::Get()->IsVarReady(ptr_->var);
+  }
   /*!
    * \brief Block until all the pending read/write operations with respect
    *    to current NDArray are finished, and write can be performed.
@@ -326,6 +367,13 @@ class NDArray {
   inline Engine::VarHandle var() const {
     return ptr_->var;
   }
+  /*!
+   * \return the number of completed writes to the ndarray, or to any array
+   *  sharing its variable
+   */
+  inline size_t version() const {
+    return ptr_->var->version();
+  }
   /*! \return byte offset in chunk of the ndarray*/
   inline size_t byte_offset() const {
     return byte_offset_;
@@ -335,6 +383,13 @@ class NDArray {
    * \param strm the output stream
    */
   void Save(dmlc::Stream *strm) const;
+  /*!
+   * \brief save the content of a CPU ndarray into binary stream like Save, without
+   *  waiting for it, e.g. in an operation reading it
+   * \param strm the output stream
+   * \param ctx the context saved with the content, where Load places it
+   */
+  void SaveCPU(dmlc::Stream *strm, Context ctx) const;
   /*!
    * \brief load ndarrays before supporting sparse ndarrays
    * \param strm the output stream
@@ -702,6 +757,22 @@ class NDArray {
   static void Save(dmlc::Stream* fo,
                    const std::vector<NDArray>& data,
                    const std::vector<std::string>& names);
+  /*!
+   * \brief Save list of ndarray into a file in the format of Save, in the background.
+   *  The arrays are copied to CPU snapshots by operations pushed on the engine, each of
+   *  which is written to the file by another operation once it is ready and released
+   *  after, so callers can keep updating the arrays right away.
+   * \param fname the file name, any dmlc stream URI
+   * \param data the NDArrays to be saved.
+   * \param names the name of the NDArray, optional, can be zero length.
+   * \param dtype the type float32 dense arrays are stored as, e.g. float16, -1 to keep it
+   * \return an array written after the file is closed, waiting for it rethrows the
+   *  errors of writing the file
+   */
+  static NDArray SaveAsync(const std::string& fname,
+                           const std::vector<NDArray>& data,
+                           const std::vector<std::string>& names,
+                           int dtype = -1);
   /*!
    * \brief Load list of ndarray into from the stream.
    * \param fi The stream of the input file.
@@ -711,6 +782,19 @@ class NDArray {
   static void Load(dmlc::Stream* fi,
                    std::vector<NDArray>* data,
                    std::vector<std::string>* keys);
+  /*!
+   * \brief Load list of ndarray from a buffer holding the content saved by Save,
+   *  without copying the data of dense arrays: they are static CPU arrays reading the
+   *  buffer, which must stay alive and unchanged while they are used. Other arrays
+   *  are loaded as by Load.
+   * \param buf the buffer
+   * \param size size of the buffer in bytes
+   * \param data the NDArrays to be loaded
+   * \param keys the name of the NDArray, if saved in the file.
+   */
+  static void LoadFromBuffer(const void* buf, size_t size,
+                             std::vector<NDArray>* data,
+                             std::vector<std::string>* keys);
 
  private:
   friend class Imperative;
@@ -741,6 +825,8 @@ class NDArray {
      */
     /*! \brief construct from static data */
     bool static_data;
+    /*! \brief keeps static data alive until the chunk is deleted, may be empty */
+    std::shared_ptr<void> static_owner;
     /*! \brief whether data allocation is delayed. This doesn't indicate whether aux data
                allocation is delayed. */
     bool delay_alloc;
@@ -801,6 +887,14 @@ class NDArray {
       Storage::Get()->Alloc(&shandle);
       storage_shape = shape;
     }
+    /*! \brief take ownership of an allocated storage handle */
+    Chunk(const Storage::Handle& shandle_, const TShape& shape)
+        : static_data(false), delay_alloc(false) {
+      var = Engine::Get()->NewVariable();
+      ctx = shandle_.ctx;
+      shandle = shandle_;
+      storage_shape = shape;
+    }
     // Constructor for a non-default storage chunk
     Chunk(NDArrayStorageType storage_type_, const TShape &storage_shape_, Context ctx_,
           bool delay_alloc_, int dtype, const std::vector<int> &aux_types_,
@@ -274,6 +274,14 @@ using FQuantizedOp = std::function<nnvm::NodePtr (const NodeAttrs& attrs)>;
  */
 using FNeedRequantize = std::function<bool (const NodeAttrs& attrs)>;
 
+/*!
+ * \brief Register a function to determine if an input of a quantized operator
+ * is read as float32 instead of being quantized, e.g. the rois of quantized_ROIAlign_v2.
+ * Such inputs have no min and max inputs in the quantized operator.
+ * \note Register under "FAvoidQuantizeInput" for non-quantized operators
+ */
+using FAvoidQuantizeInput = std::function<bool (const NodeAttrs& attrs, size_t index)>;
+
 }  // namespace mxnet
 
 #endif  // MXNET_OP_ATTR_TYPES_H_
@@ -111,9 +111,9 @@ struct Resource {
    *
    *  This space can be shared with other calls to this->get_space.
    *  So the caller need to serialize the calls when using the conflicted space.
-   *  The old space can get freed, however, this will incur a synchronization,
-   *  when running on device, so the launched kernels that depend on the temp space
-   *  can finish correctly.
+   *  When the space grows on a device, the old space is returned to the storage
+   *  pool tagged with the stream, so kernels already launched on it can finish
+   *  correctly without synchronizing the device.
    *
    * \param shape the Shape of returning tensor.
    * \param stream the stream of retruning tensor.
@@ -154,7 +154,7 @@ struct Resource {
       mshadow::Shape<ndim> shape, mshadow::Stream<xpu> *stream) const {
     CHECK_EQ(req.type, ResourceRequest::kTempSpace);
     return mshadow::Tensor<xpu, ndim, DType>(
-        reinterpret_cast<DType*>(get_space_internal(shape.Size() * sizeof(DType))),
+        reinterpret_cast<DType*>(get_space_internal(shape.Size() * sizeof(DType), stream)),
         shape, shape[ndim - 1], stream);
   }
   /*!
@@ -176,9 +176,10 @@ struct Resource {
   /*!
    * \brief internal function to get space from resources.
    * \param size The size of the space.
+   * \param stream The mshadow stream the space is used on, can be nullptr.
    * \return The allocated space.
    */
-  void* get_space_internal(size_t size) const;
+  void* get_space_internal(size_t size, void* stream) const;
   /*!
    * \brief internal function to get cpu space from resources.
    * \param size The size of space.
@@ -209,6 +210,14 @@ class ResourceManager {
    * \param seed the seed to the random number generators.
    */
   virtual void SeedRandom(Context ctx, uint32_t seed) = 0;
+  /*!
+   * \brief Number of temporal space reallocations on all devices so far.
+   *  Work recorded with pointers into temporal space, such as a captured
+   *  CUDA graph, stays valid only while this value is unchanged.
+   */
+  virtual uint64_t TempSpaceVersion() const {
+    return 0;
+  }
   /*! \brief virtual destructor */
   virtual ~ResourceManager() DMLC_THROW_EXCEPTION {}
   /*!
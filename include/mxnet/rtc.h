@@ -27,6 +27,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <unordered_map>
 #include <unordered_set>
@@ -57,15 +58,29 @@ class CudaModule {
      * \return loaded function handle
      */
     CUfunction GetFunction(const std::string& mangled_name, const Context& ctx);
-    /*! \brief nvrtc program handle. */
-    nvrtcProgram prog_;
+    /*!
+     * \brief Compile the source, or read the PTX of an earlier compilation from
+     *  the MXNET_RTC_CACHE_DIR cache
+     */
+    void Compile(const char* source,
+                 const std::vector<std::string>& options,
+                 const std::vector<std::string>& exports);
     /*! \brief compiled cuda PTX */
-    char* ptx_;
+    std::string ptx_;
     /*! \brief lazily loaded cuda module */
     std::unordered_map<int, CUmodule> mod_;
-    /*! \brief exported names */
-    std::unordered_set<std::string> exports_;
+    /*! \brief mangled name of each exported name */
+    std::unordered_map<std::string, std::string> lowered_;
+    /*! \brief guards mod_, chunks are shared by the modules of the same source */
+    std::mutex mutex_;
   };
+  /*!
+   * \brief Get the chunk of a source, shared by all the live modules compiled
+   *  from the same source, options and exports
+   */
+  static std::shared_ptr<Chunk> GetChunk(const char* source,
+                                         const std::vector<std::string>& options,
+                                         const std::vector<std::string>& exports);
   /*! \brief pointer to Chunk */
   std::shared_ptr<Chunk> ptr_;
 
@@ -89,6 +104,12 @@ class CudaModule {
                 uint32_t shared_mem);
     /*! \brief kernel interface signature */
     const std::vector<ArgType>& signature() { return signature_; }
+    /*!
+     * \brief get the loaded kernel function on a device, for operators that
+     *  launch it on their own stream instead of pushing it with Launch.
+     *  Not thread safe, callers must serialize calls on the same kernel.
+     */
+    CUfunction GetFunction(const Context& ctx);
 
    private:
     friend class CudaModule;
@@ -118,7 +139,7 @@ class CudaModule {
   CudaModule(const char* source,
              const std::vector<std::string>& options,
              const std::vector<std::string>& exports)
-      : ptr_(std::make_shared<Chunk>(source, options, exports)) {}
+      : ptr_(GetChunk(source, options, exports)) {}
   /*!
    * \brief Get cuda kernal from module by name
    * \param name kernel name
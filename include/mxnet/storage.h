@@ -35,6 +35,36 @@ namespace mxnet {
  */
 class Storage {
  public:
+  /*! \brief what memory is allocated for, attributed by the memory profiler */
+  enum Category {
+    kOther = 0,
+    kWeight,
+    kActivation,
+    kWorkspace,
+    kNumCategories
+  };
+  /*!
+   * \brief Tags the allocations of the current thread with an operator name and a
+   *  category while it lives, for the memory profiler. Scopes nest, the innermost wins.
+   */
+  class AllocScope {
+   public:
+    /*!
+     * \param name name of the operator allocating, nullptr to keep the enclosing one
+     * \param category what the memory is for
+     */
+    AllocScope(const char* name, Category category);
+    ~AllocScope();
+    /*! \return name of the innermost scope of the thread, nullptr if none */
+    static const char* name();
+    /*! \return category of the innermost scope of the thread, kOther if none */
+    static Category category();
+
+   private:
+    const char* prev_name_;
+    Category prev_category_;
+    DISALLOW_COPY_AND_ASSIGN(AllocScope);
+  };
   /*!
    * \brief Storage handle.
    */
@@ -56,6 +86,12 @@ class Storage {
      */
     int shared_pid{-1};
     int shared_id{-1};
+    /*!
+     * \brief Operator and category the memory profiler attributed the allocation
+     *  to, category -1 if it was not profiled
+     */
+    const char* profiler_name{nullptr};
+    int profiler_category{-1};
   };
   /*!
    * \brief Allocate a new contiguous memory for a given size.
@@ -80,6 +116,28 @@ class Storage {
    * \param handle handle to shared memory.
    */
   virtual void SharedIncrementRefCount(Handle handle) = 0;
+  /*! \brief Bytes of the handle gpu shared memory is exported with. */
+  static constexpr size_t kGPUIpcHandleSize = 128;
+  /*!
+   * \brief Allocate gpu memory that other processes can open, through cuda ipc.
+   *  The memory is released through Free.
+   * \param handle handle initialized with size and a gpu ctx
+   */
+  virtual void SharedAllocGPU(Handle* handle) = 0;
+  /*!
+   * \brief Export gpu memory allocated by SharedAllocGPU. The memory stays
+   *  allocated for the lifetime of the process.
+   * \param handle handle to the gpu shared memory
+   * \param ipc_handle output buffer of kGPUIpcHandleSize bytes
+   */
+  virtual void SharedExportGPU(const Handle& handle, char* ipc_handle) = 0;
+  /*!
+   * \brief Open gpu memory exported by SharedExportGPU in this or another process.
+   *  The opened memory is released through Free.
+   * \param ipc_handle buffer of kGPUIpcHandleSize bytes
+   * \param handle handle initialized with the gpu ctx to open the memory on
+   */
+  virtual void SharedImportGPU(const char* ipc_handle, Handle* handle) = 0;
   /*!
    * \brief Free storage.
    * \param handle Handle struct.
@@ -95,6 +153,29 @@ class Storage {
    * \param handle Handle struct.
    */
   virtual void DirectFree(Handle handle) = 0;
+  /*!
+   * \brief Allocate memory that will be used on the given device stream.
+   *  Memory freed on the same stream through FreeOnStream can be reused
+   *  without waiting for the work queued on it.
+   *
+   * \param handle handle initialized with size and ctx
+   * \param stream the cudaStream_t to use the memory on, nullptr for none
+   */
+  virtual void AllocOnStream(Handle* handle, void* stream) {
+    this->Alloc(handle);
+  }
+  /*!
+   * \brief Free storage that may still be read or written by work queued on
+   *  the given device stream. Unlike DirectFree, this does not synchronize:
+   *  the memory is reused on the same stream immediately and on other
+   *  streams once that work has finished.
+   *
+   * \param handle Handle struct.
+   * \param stream the cudaStream_t the memory was last used on, nullptr for none
+   */
+  virtual void FreeOnStream(Handle handle, void* stream) {
+    this->Free(handle);
+  }
   /*!
    * \brief Destructor.
    */
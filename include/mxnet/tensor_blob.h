@@ -104,6 +104,21 @@ class TBlob {
       : dptr_(dptr), shape_(shape), type_flag_(type_flag) {
     SetDLTensor(dev_mask, dev_id);
   }
+  /*!
+   * \brief constructor that construct TBlob from DLTensor
+   * \param dltensor the DLTensor, compact and on CPU, pinned CPU or GPU memory
+   */
+  explicit TBlob(const DLTensor &dltensor)
+      : dptr_(static_cast<char*>(dltensor.data) + dltensor.byte_offset),
+        shape_(dltensor.shape, dltensor.shape + dltensor.ndim),
+        type_flag_(DLDataTypeTransform(dltensor.dtype)) {
+    CHECK(IsCompact(dltensor)) << "TBlob only supports compact DLTensor";
+    const int dev_mask = dltensor.ctx.device_type == kDLCPUPinned ?
+        static_cast<int>(cpu::kDevMask) : static_cast<int>(dltensor.ctx.device_type);
+    CHECK(dev_mask == cpu::kDevMask || dev_mask == gpu::kDevMask)
+        << "Unsupported DLTensor device type " << dltensor.ctx.device_type;
+    SetDLTensor(dev_mask, dltensor.ctx.device_id);
+  }
   /*!
    * \brief constructor from tensor
    * \param src source tensor
@@ -337,6 +352,44 @@ class TBlob {
     }
   }
 
+  static int DLDataTypeTransform(DLDataType dldata_type) {
+    if (dldata_type.lanes == 1) {
+      switch (dldata_type.code) {
+        case kDLFloat:
+          switch (dldata_type.bits) {
+            case 16: return mshadow::kFloat16;
+            case 32: return mshadow::kFloat32;
+            case 64: return mshadow::kFloat64;
+          }
+          break;
+        case kDLUInt:
+          if (dldata_type.bits == 8) return mshadow::kUint8;
+          break;
+        case kDLInt:
+          switch (dldata_type.bits) {
+            case 8: return mshadow::kInt8;
+            case 32: return mshadow::kInt32;
+            case 64: return mshadow::kInt64;
+          }
+          break;
+      }
+    }
+    LOG(FATAL) << "Unsupported DLDataType{" << static_cast<int>(dldata_type.code)
+               << ", " << static_cast<int>(dldata_type.bits)
+               << ", " << dldata_type.lanes << "}";
+    return mshadow::kFloat32;
+  }
+  /*! \brief whether the tensor is stored row major without gaps */
+  static bool IsCompact(const DLTensor &dltensor) {
+    if (dltensor.strides == NULL) return true;
+    int64_t expected = 1;
+    for (int i = dltensor.ndim - 1; i >= 0; --i) {
+      if (dltensor.shape[i] != 1 && dltensor.strides[i] != expected) return false;
+      expected *= dltensor.shape[i];
+    }
+    return true;
+  }
+
   inline void SetDLTensor(int dev_mask, int dev_id) {
     dltensor_.data = dptr_;
     dltensor_.ctx = DLContext{static_cast<DLDeviceType>(dev_mask), dev_id};
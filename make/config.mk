@@ -79,6 +79,9 @@ USE_NCCL = 0
 #add the path to NCCL library
 USE_NCCL_PATH = NONE
 
+# whether to emit NVTX ranges for Nsight Systems, needs USE_CUDA = 1
+USE_NVTX = 0
+
 # whether use opencv during compilation
 # you can disable it, however, you will not able to use
 # imbin iterator
@@ -89,6 +92,11 @@ USE_LIBJPEG_TURBO = 0
 #add the path to libjpeg-turbo library
 USE_LIBJPEG_TURBO_PATH = NONE
 
+# whether use nvJPEG to decode images on the GPU in ImageRecordIter (needs USE_CUDA)
+USE_NVJPEG = 0
+#add the path to nvJPEG library
+USE_NVJPEG_PATH = NONE
+
 # use openmp for parallelization
 USE_OPENMP = 1
 
@@ -58,7 +58,9 @@ void TBlob2CaffeBlob(caffeMemoryTypes memType,
                      typename std::vector<TBlob>::const_iterator tblob,
                      int n = 1) {
   for (int i = 0; i < n; ++i, ++blob, ++tblob) {
-    (*blob)->Reshape(TShape2Vector((*tblob).shape_));
+    // the blob only aliases the memory of the TBlob, reshape just when it changes
+    std::vector<int> shape = TShape2Vector((*tblob).shape_);
+    if ((*blob)->shape() != shape) (*blob)->Reshape(shape);
     SetDataGradToBlob<Device, Dtype>(memType, blob, tblob);
   }
 }
@@ -43,6 +43,35 @@ void CaffeMode::SetMode<mshadow::gpu>() {
   ::caffe::Caffe::set_mode(::caffe::Caffe::GPU);
 }
 
+template<>
+void CaffeStream::Bind<mshadow::cpu>(mshadow::Stream<mshadow::cpu> *s) {
+}
+
+template<>
+void CaffeStream::Join<mshadow::cpu>(mshadow::Stream<mshadow::cpu> *s) {
+}
+
+#if MXNET_USE_CUDA
+template<>
+void CaffeStream::Bind<mshadow::gpu>(mshadow::Stream<mshadow::gpu> *s) {
+  CHECK_EQ(cublasSetStream(::caffe::Caffe::cublas_handle(),
+                           mshadow::Stream<mshadow::gpu>::GetStream(s)),
+           CUBLAS_STATUS_SUCCESS);
+}
+
+template<>
+void CaffeStream::Join<mshadow::gpu>(mshadow::Stream<mshadow::gpu> *s) {
+  cudaEvent_t event;
+  CHECK_EQ(cudaEventCreateWithFlags(&event, cudaEventDisableTiming), cudaSuccess);
+  // caffe's own kernels go to the legacy default stream
+  CHECK_EQ(cudaEventRecord(event, 0), cudaSuccess);
+  CHECK_EQ(cudaStreamWaitEvent(mshadow::Stream<mshadow::gpu>::GetStream(s), event, 0),
+           cudaSuccess);
+  // released by the runtime once the event completes
+  CHECK_EQ(cudaEventDestroy(event), cudaSuccess);
+}
+#endif  // MXNET_USE_CUDA
+
 }  // namespace caffe
 }  // namespace op
 }  // namespace mxnet
@@ -53,6 +53,21 @@ class CaffeMode {
   template<typename xpu> static void SetMode();
 };
 
+/**
+ * \brief The class runs caffe's gpu work in order with the stream of the op.
+ *  Caffe's cublas calls are issued on the stream, and the kernels caffe launches
+ *  on the default stream are joined into it by an event, so the engine's wait on
+ *  the stream covers them without a device synchronization.
+ * \tparam xpu The device that the op will be executed on.
+ */
+class CaffeStream {
+ public:
+  /*! \brief issue caffe's cublas calls on s, before forward/backward */
+  template<typename xpu> static void Bind(mshadow::Stream<xpu> *s);
+  /*! \brief make s wait for the work caffe queued on the default stream */
+  template<typename xpu> static void Join(mshadow::Stream<xpu> *s);
+};
+
 // Initialization funciton called by caffeOp & caffeLoss
 template<typename Dtype>
 void InitCaffeBlobs(std::vector< ::caffe::Blob<Dtype>*>* v, int n_num) {
@@ -108,6 +108,7 @@ class CaffeLoss : public Operator {
     // TODO(Haoran): when need cublas handle in stream?
     CHECK_EQ(s->blas_handle_ownership_, Stream<xpu>::OwnHandle)
           << "Must init CuBLAS handle in stream";
+    caffe::CaffeStream::Bind<xpu>(s);
 #endif  // __CUDACC__
 
     caffe::TBlob2CaffeBlob<xpu, Dtype>(caffe::Data,
@@ -130,7 +131,7 @@ class CaffeLoss : public Operator {
     for (uint32_t i = 0; i < top_.size(); ++i)
       top_[i]->gpu_data();
 
-    CHECK_EQ(cudaStreamSynchronize(NULL), cudaSuccess);
+    caffe::CaffeStream::Join<xpu>(s);
 #endif  // __CUDACC__
   }
 
@@ -163,6 +164,7 @@ class CaffeLoss : public Operator {
     // TODO(Haoran): when need cublas handle in stream?
     CHECK_EQ(s->blas_handle_ownership_, Stream<xpu>::OwnHandle)
           << "Must init CuBLAS handle in stream";
+    caffe::CaffeStream::Bind<xpu>(s);
 #endif  // __CUDACC__
 
     caffe::TBlob2CaffeBlob<xpu, Dtype>(caffe::Grad,
@@ -183,7 +185,7 @@ class CaffeLoss : public Operator {
     for (uint32_t i = 0; i < bot_.size(); ++i)
       bot_[i]->gpu_diff();
 
-    CHECK_EQ(cudaStreamSynchronize(NULL), cudaSuccess);
+    caffe::CaffeStream::Join<xpu>(s);
 #endif  // __CUDACC__
   }
 
@@ -27,8 +27,11 @@
 #include <mxnet/base.h>
 #include <mxnet/ndarray.h>
 #include <opencv2/opencv.hpp>
+#include <memory>
+#include <vector>
 #include "cv_api.h"
 #include "../../src/c_api/c_api_common.h"
+#include "../../src/engine/openmp.h"
 
 
 using namespace mxnet;
@@ -140,6 +143,56 @@ MXNET_DLL int MXCVResize(NDArrayHandle src, const mx_uint w, const mx_uint h,
   API_END();
 }
 
+MXNET_DLL int MXCVImdecodeResizeBatch(const mx_uint num_images,
+                                      const unsigned char **imgs,
+                                      const mx_uint *lens,
+                                      const int flag,
+                                      const int interpolation,
+                                      NDArrayHandle out) {
+  API_BEGIN();
+  NDArray ndout = *static_cast<NDArray*>(out);
+  CHECK_GE(flag, 0) << "flag must be 0 (grayscale) or 1 (colored).";
+  CHECK_EQ(ndout.shape().ndim(), 4);
+  CHECK_EQ(ndout.shape()[0], num_images);
+  CHECK_EQ(ndout.shape()[3], flag == 0 ? 1 : 3);
+  CHECK_EQ(ndout.ctx(), Context::CPU());
+  CHECK_EQ(ndout.dtype(), mshadow::kUint8);
+
+  // the buffers of the caller may be freed before the batch is decoded
+  std::vector<size_t> offsets(num_images + 1, 0);
+  for (mx_uint i = 0; i < num_images; ++i) offsets[i + 1] = offsets[i] + lens[i];
+  auto data = std::make_shared<std::vector<unsigned char> >(offsets[num_images]);
+  for (mx_uint i = 0; i < num_images; ++i) {
+    memcpy(data->data() + offsets[i], imgs[i], lens[i]);
+  }
+  Engine::Get()->PushSync([=](RunContext ctx){
+      const int h = ndout.shape()[1], w = ndout.shape()[2];
+      const int type = flag == 0 ? CV_8U : CV_8UC3;
+      const size_t image_size = ndout.shape().ProdShape(1, 4);
+      unsigned char *batch = ndout.data().dptr<unsigned char>();
+      int num_failed = 0;
+      #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount()) \
+          reduction(+:num_failed)
+      for (int i = 0; i < static_cast<int>(num_images); ++i) {
+        cv::Mat buf(1, lens[i], CV_8U, data->data() + offsets[i]);
+        cv::Mat img = cv::imdecode(buf, flag);
+        if (img.empty()) {
+          ++num_failed;
+          continue;
+        }
+        // both write into the preallocated image of the batch
+        cv::Mat dst(h, w, type, batch + i * image_size);
+        if (img.rows == h && img.cols == w) {
+          img.copyTo(dst);
+        } else {
+          cv::resize(img, dst, cv::Size(w, h), 0, 0, interpolation);
+        }
+      }
+      CHECK_EQ(num_failed, 0) << num_failed << " images of the batch failed to decode";
+    }, ndout.ctx(), {}, {ndout.var()});
+  API_END();
+}
+
 MXNET_DLL int MXCVcopyMakeBorder(NDArrayHandle src,
                                  const int top,
                                  const int bot,
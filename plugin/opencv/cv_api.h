@@ -41,6 +41,23 @@ MXNET_DLL int MXCVResize(
   const int interpolation,
   NDArrayHandle *out);
 
+/*!
+ * \brief decode images and resize them into the images of a batch, in parallel
+ * \param num_images number of images
+ * \param imgs encoded images
+ * \param lens sizes in bytes of the encoded images
+ * \param flag 0 to decode as grayscale, 1 as BGR
+ * \param interpolation same as interpolation for cv2.resize
+ * \param out uint8 array of shape (num_images, height, width, channels)
+ */
+MXNET_DLL int MXCVImdecodeResizeBatch(
+  const mx_uint num_images,
+  const unsigned char **imgs,
+  const mx_uint *lens,
+  const int flag,
+  const int interpolation,
+  NDArrayHandle out);
+
 MXNET_DLL int MXCVcopyMakeBorder(
   NDArrayHandle src,
   const int top,
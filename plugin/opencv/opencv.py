@@ -71,6 +71,38 @@ def resize(src, size, interpolation=cv2.INTER_LINEAR):
                                interpolation, ctypes.byref(hdl)))
     return mx.nd.NDArray(hdl)
 
+def imdecode_resize_batch(str_imgs, size, flag=1, interpolation=cv2.INTER_LINEAR, out=None):
+    """Decode images from str buffers and resize them into one batch.
+    The images are decoded in parallel.
+
+    Parameters
+    ----------
+    str_imgs : list of str
+        str buffers read from image files
+    size : tuple
+        target size in (width, height)
+    flag : int
+        same as flag for cv2.imdecode
+    interpolation : int
+        same as interpolation for cv2.imresize
+    out : NDArray, optional
+        uint8 array in (batch, height, width, channels) to decode into
+
+    Returns
+    -------
+    batch : NDArray
+        decoded images in (batch, height, width, channels)
+        with BGR color channel order
+    """
+    num = len(str_imgs)
+    if out is None:
+        out = mx.nd.empty((num, size[1], size[0], 3 if flag else 1), dtype='uint8')
+    bufs = (ctypes.c_char_p * num)(*str_imgs)
+    lens = (mx_uint * num)(*[len(s) for s in str_imgs])
+    check_call(_LIB.MXCVImdecodeResizeBatch(mx_uint(num), bufs, lens, flag,
+                                            interpolation, out.handle))
+    return out
+
 def copyMakeBorder(src, top, bot, left, right, border_type=cv2.BORDER_CONSTANT, value=0):
     """Pad image border
     Wrapper for cv2.copyMakeBorder that uses mx.nd.NDArray
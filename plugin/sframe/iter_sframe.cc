@@ -32,6 +32,9 @@
 #include <dmlc/parameter.h>
 #include <string>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <utility>
 #include <unity/lib/image_util.hpp>
 #include <unity/lib/gl_sframe.hpp>
 #include <unity/lib/gl_sarray.hpp>
@@ -41,6 +44,7 @@
 #include "../../src/io/iter_prefetcher.h"
 #include "../../src/io/iter_normalize.h"
 #include "../../src/io/iter_batchloader.h"
+#include "../../src/engine/openmp.h"
 
 namespace mxnet {
 namespace io {
@@ -211,6 +215,137 @@ class SFrameDataIter : public SFrameIterBase {
   typedef SFrameIterBase Parent;
 };  // class SFrameDataIter
 
+/*!
+ * \brief batch iterator reading the data and label columns of a vector sframe
+ *  block by block, without going through one DataInst per row.
+ */
+class SFrameColumnIter : public IIterator<TBlobBatch> {
+ public:
+  SFrameColumnIter() : cursor_(0), num_overflow_(0) {}
+
+  virtual ~SFrameColumnIter() {
+    delete[] out_.inst_index;
+  }
+
+  void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
+    param_.InitAllowUnknown(kwargs);
+    batch_param_.InitAllowUnknown(kwargs);
+    graphlab::gl_sframe sframe(param_.path_sframe);
+    columns_ = {sframe[param_.data_field], sframe[param_.label_field]};
+    num_rows_ = sframe.size();
+    CHECK(num_rows_ >= batch_param_.batch_size || !batch_param_.round_batch)
+      << "number of input must be bigger than batch size";
+    const TShape shapes[] = {param_.data_shape, param_.label_shape};
+    data_.resize(columns_.size());
+    blocks_.resize(columns_.size());
+    unit_size_.resize(columns_.size());
+    out_.inst_index = new unsigned[batch_param_.batch_size];
+    out_.batch_size = batch_param_.batch_size;
+    out_.data.clear();
+    for (size_t i = 0; i < columns_.size(); ++i) {
+      std::vector<index_t> shape_vec;
+      shape_vec.push_back(batch_param_.batch_size);
+      for (index_t dim = 0; dim < shapes[i].ndim(); ++dim) {
+        shape_vec.push_back(shapes[i][dim]);
+      }
+      TShape dst_shape(shape_vec.begin(), shape_vec.end());
+      data_[i].resize(mshadow::Shape1(dst_shape.Size()), mshadow::kFloat32);
+      unit_size_[i] = shapes[i].Size();
+      out_.data.push_back(TBlob(data_[i].dptr_, dst_shape, cpu::kDevMask, mshadow::kFloat32, 0));
+    }
+    this->BeforeFirst();
+  }
+
+  void BeforeFirst() override {
+    // in round_batch mode the wrapped rows are already consumed from the next epoch
+    cursor_ = batch_param_.round_batch ? num_overflow_ : 0;
+    num_overflow_ = 0;
+  }
+
+  bool Next() override {
+    if (cursor_ >= num_rows_) return false;
+    const size_t batch_size = batch_param_.batch_size;
+    const size_t top = std::min(batch_size, num_rows_ - cursor_);
+    this->ReadRows(cursor_, cursor_ + top, 0);
+    cursor_ += top;
+    out_.batch_size = batch_size;
+    out_.num_batch_padd = 0;
+    if (top < batch_size) {
+      if (batch_param_.round_batch) {
+        num_overflow_ = batch_size - top;
+        this->ReadRows(0, num_overflow_, top);
+        out_.num_batch_padd = num_overflow_;
+      } else {
+        out_.num_batch_padd = batch_size - top;
+      }
+    }
+    return true;
+  }
+
+  const TBlobBatch &Value() const override {
+    return out_;
+  }
+
+ private:
+  /*!
+   * \brief copy rows [begin, end) of every column into the batch from slot top.
+   *  A column block is fetched with one range read, the rows are then cast
+   *  into the batch in parallel.
+   */
+  void ReadRows(size_t begin, size_t end, size_t top) {
+    const int n = static_cast<int>(end - begin);
+    for (size_t i = 0; i < columns_.size(); ++i) {
+      std::vector<graphlab::flexible_type> &block = blocks_[i];
+      block.clear();
+      block.reserve(n);
+      for (const graphlab::flexible_type &v : columns_[i].range_iterator(begin, end)) {
+        block.push_back(v);
+      }
+      CHECK_EQ(block.size(), static_cast<size_t>(n));
+      const size_t unit = unit_size_[i];
+      float *dst = data_[i].dptr<float>() + top * unit;
+      #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+      for (int j = 0; j < n; ++j) {
+        float *row = dst + j * unit;
+        if (block[j].get_type() == graphlab::flex_type_enum::VECTOR) {
+          const graphlab::flex_vec &vec = block[j].get<graphlab::flex_vec>();
+          CHECK_EQ(vec.size(), unit) << "Column shape does not match";
+          for (size_t k = 0; k < unit; ++k) {
+            row[k] = static_cast<float>(vec[k]);
+          }
+        } else {
+          CHECK_EQ(unit, 1U) << "Scalar column needs an instance shape of size 1";
+          row[0] = static_cast<float>(block[j].to<graphlab::flex_float>());
+        }
+      }
+    }
+    for (size_t j = 0; j < end - begin; ++j) {
+      out_.inst_index[top + j] = static_cast<unsigned>(begin + j);
+    }
+  }
+
+  /*! \brief sframe iter parameter */
+  SFrameParam param_;
+  /*! \brief batch parameter */
+  BatchParam batch_param_;
+  /*! \brief data and label columns */
+  std::vector<graphlab::gl_sarray> columns_;
+  /*! \brief rows of the current block of each column */
+  std::vector<std::vector<graphlab::flexible_type> > blocks_;
+  /*! \brief batch memory of each column */
+  std::vector<TBlobContainer> data_;
+  /*! \brief number of values of one instance of each column */
+  std::vector<size_t> unit_size_;
+  /*! \brief output batch */
+  TBlobBatch out_;
+  /*! \brief number of rows of the sframe */
+  size_t num_rows_;
+  /*! \brief next row to read */
+  size_t cursor_;
+  /*! \brief number of rows wrapped around at the end of the epoch */
+  size_t num_overflow_;
+};  // class SFrameColumnIter
+
 DMLC_REGISTER_PARAMETER(SFrameParam);
 
 MXNET_REGISTER_IO_ITER(SFrameImageIter)
@@ -238,6 +373,15 @@ MXNET_REGISTER_IO_ITER(SFrameDataIter)
               new SFrameDataIter()));
     });
 
+MXNET_REGISTER_IO_ITER(SFrameColumnIter)
+.describe("SFrame data iterator reading whole column blocks into each batch")
+.add_arguments(SFrameParam::__FIELDS__())
+.add_arguments(BatchParam::__FIELDS__())
+.add_arguments(PrefetcherParam::__FIELDS__())
+.set_body([]() {
+    return new PrefetcherIter(
+        new SFrameColumnIter());
+    });
 
 }  // namespace io
 }  // namespace mxnet
@@ -61,6 +61,8 @@ void TorchState::SetStream(mshadow::Stream<mshadow::cpu>* s) {
 #if MXNET_USE_CUDA
 template<>
 void TorchState::SetStream(mshadow::Stream<mshadow::gpu>* s) {
+  // cutorch launches its kernels and binds its cublas handle to the current stream,
+  // so torch work queues behind the op's stream instead of the default one
   CudaState()->currentStream = mshadow::Stream<gpu>::GetStream(s);
 }
 #endif  // MXNET_USE_CUDA
@@ -54,14 +54,19 @@ class TorchState {
   static TorchState* ThreadSharedLuaState();
 
 #if MXNET_USE_CUDA
+  /*!
+   * \brief cutorch state of this lua state, looked up once since every tensor
+   *  wrapped for a gpu call needs it
+   */
   THCState* CudaState() {
+    if (cuda_state_ != nullptr) return cuda_state_;
     lua_getglobal(L, "cutorch");
     CHECK(!lua_isnil(L, -1));
     lua_getfield(L, -1, "_state");
     CHECK(!lua_isnil(L, -1));
-    THCState* state = reinterpret_cast<THCState*>(lua_touserdata(L, -1));
+    cuda_state_ = reinterpret_cast<THCState*>(lua_touserdata(L, -1));
     lua_pop(L, 2);
-    return state;
+    return cuda_state_;
   }
 #endif  // MXNET_USE_CUDA
 
@@ -112,6 +117,11 @@ class TorchState {
     lua_pop(L, 2);
     return 0;
   }
+
+ private:
+#if MXNET_USE_CUDA
+  THCState* cuda_state_{nullptr};
+#endif  // MXNET_USE_CUDA
 };
 
 typedef void* THGeneralTensor;
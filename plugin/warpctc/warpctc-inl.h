@@ -100,31 +100,42 @@ class WarpCTCOp : public Operator {
     Softmax(out_tensor, data_tensor);
   }
 
-  std::vector<int> labelLengths(const int * flat_labels, int minibatch,
-                                int size, int blank, int * total_length) {
+  /*!
+   * \brief count the non blank labels of each sequence and pack them into labels_,
+   *  in one pass over the padded labels.
+   */
+  void packLabels(const int * flat_labels, int minibatch, int size, int blank) {
     CHECK_EQ(param_.label_length * minibatch, size)
         << "label size should = label_length * minibatch";
-    std::vector<int> ret(minibatch, 0);
+    label_lengths_.assign(minibatch, 0);
+    labels_.clear();
     for (int i = 0; i < size; i++) {
       if (flat_labels[i] == blank) {
         continue;
       }
-      int b = i / param_.label_length;
-      ret[b]++;
-      (*total_length)++;
+      label_lengths_[i / param_.label_length]++;
+      labels_.push_back(flat_labels[i]);
     }
-    return ret;
   }
 
-  void removeBlank(const int * flat_labels, int * cpu_labels,
-                   int size, int blank) {
-    int k = 0;
-    for (int i = 0; i < size; i++) {
-      if (flat_labels[i] != blank) {
-        cpu_labels[k] = flat_labels[i];
-        k += 1;
-      }
-    }
+  /*!
+   * \brief workspace bytes of a minibatch, computed once per shape with every
+   *  sequence at the full label_length, which bounds any shorter labelling.
+   */
+  size_t workspaceBytes(int minibatch, int alphabet_size, const ctcOptions &info) {
+    const std::pair<int, int> key(minibatch, alphabet_size);
+    auto it = workspace_bytes_.find(key);
+    if (it != workspace_bytes_.end()) return it->second;
+    std::vector<int> max_label_lengths(minibatch, param_.label_length);
+    size_t alloc_bytes;
+    throw_on_error(get_workspace_size(max_label_lengths.data(),
+                                      input_lengths_.data(),
+                                      alphabet_size,
+                                      minibatch, info,
+                                      &alloc_bytes),
+                   "Error: get_workspace_size");
+    workspace_bytes_[key] = alloc_bytes;
+    return alloc_bytes;
   }
 
   virtual void Backward(const OpContext &ctx,
@@ -156,71 +167,57 @@ class WarpCTCOp : public Operator {
     int T = param_.input_length;
     int minibatch = data.shape_[0] / T;
     int alphabet_size = data.shape_[1];
-    std::vector<int> input_lengths;
-    for (int i = 0; i < minibatch; i++) {
-      input_lengths.push_back(T);
-    }
+    input_lengths_.assign(minibatch, T);
 
-#if MXNET_USE_CUDA
-    cudaError_t cuda_status;
-#endif
     float* activations = static_cast<float*>(data.dptr_);
-    int* flat_labels = static_cast<int*>(label.dptr_);
-    int* cpu_raw_labels = flat_labels;
+    const int* flat_labels = static_cast<const int*>(label.dptr_);
     float* grads = static_cast<float*>(in_grad[warpctc_enum::kData].dptr_);
     if (data.dev_mask() == gpu::kDevMask) {
 #if MXNET_USE_CUDA
-      cpu_raw_labels = reinterpret_cast<int*>(malloc(sizeof(int) * label.Size()));
-      cuda_status = cudaMemcpyAsync(cpu_raw_labels, flat_labels,
-                                    label.Size()*sizeof(int),
-                                    cudaMemcpyDeviceToHost,
-                                    ctx.get_stream<gpu>()->stream_);
+      // warp-ctc reads the labels and their lengths on the host
+      raw_labels_.resize(label.Size());
+      cudaError_t cuda_status = cudaMemcpyAsync(raw_labels_.data(), flat_labels,
+                                                label.Size()*sizeof(int),
+                                                cudaMemcpyDeviceToHost,
+                                                ctx.get_stream<gpu>()->stream_);
       CHECK_EQ(cuda_status, cudaSuccess) << "cuda memcpy label error";
+      ctx.get_stream<gpu>()->Wait();
+      flat_labels = raw_labels_.data();
 #endif
     }
+    packLabels(flat_labels, minibatch, label.Size(), 0);
 
-    int total_label_length = 0;
-    std::vector<int> label_lengths = labelLengths(cpu_raw_labels,
-                                                  minibatch,
-                                                  label.Size(),
-                                                  0, &total_label_length);
-    int* cpu_labels = reinterpret_cast<int*>(
-        malloc(sizeof(int) * total_label_length));
-    removeBlank(cpu_raw_labels, cpu_labels, label.Size(), 0);
-
-    size_t alloc_bytes;
-    throw_on_error(get_workspace_size(label_lengths.data(),
-                                      input_lengths.data(),
-                                      alphabet_size,
-                                      input_lengths.size(), info,
-                                      &alloc_bytes),
-                   "Error: get_workspace_size in inf_test");
-
+    size_t alloc_bytes = workspaceBytes(minibatch, alphabet_size, info);
     Tensor<xpu, 1> ctc_workspace = ctx.requested[warpctc_enum::kTmp].get_space<xpu>(
-        mshadow::Shape1(alloc_bytes), s);
+        mshadow::Shape1((alloc_bytes + sizeof(real_t) - 1) / sizeof(real_t)), s);
 
-    std::vector<float> costs(minibatch);
+    costs_.resize(minibatch);
     throw_on_error(compute_ctc_loss(activations,
                                     grads,
-                                    cpu_labels,
-                                    label_lengths.data(),
-                                    input_lengths.data(),
+                                    labels_.data(),
+                                    label_lengths_.data(),
+                                    input_lengths_.data(),
                                     alphabet_size,
                                     minibatch,
-                                    costs.data(),
+                                    costs_.data(),
                                     ctc_workspace.dptr_,
                                     info),
                    "Error: compute_ctc_loss");
-
-    if (data.dev_mask() == cpu::kDevMask) {
-      free(cpu_labels);
-    } else if (data.dev_mask() == gpu::kDevMask) {
-#if MXNET_USE_CUDA
-      free(cpu_raw_labels);
-      free(cpu_labels);
-#endif
-    }
   }
+
+ private:
+  /*! \brief host copy of the padded labels of a gpu batch */
+  std::vector<int> raw_labels_;
+  /*! \brief non blank labels of the batch */
+  std::vector<int> labels_;
+  /*! \brief number of non blank labels of each sequence */
+  std::vector<int> label_lengths_;
+  /*! \brief input length of each sequence */
+  std::vector<int> input_lengths_;
+  /*! \brief ctc cost of each sequence */
+  std::vector<float> costs_;
+  /*! \brief workspace bytes by (minibatch, alphabet_size) */
+  std::map<std::pair<int, int>, size_t> workspace_bytes_;
 };
 
 template<typename xpu>
@@ -24,8 +24,8 @@ from __future__ import absolute_import as _abs
 import ctypes
 
 from ..base import _LIB
-from ..base import c_str_array, c_handle_array
-from ..base import NDArrayHandle, CachedOpHandle
+from ..base import c_str, c_str_array, c_handle_array
+from ..base import NDArrayHandle, CachedOpHandle, OpHandle, OpInstanceHandle
 from ..base import check_call
 
 
@@ -157,3 +157,73 @@ class CachedOp(object):
             return [_ndarray_cls(ctypes.cast(output_vars[i], NDArrayHandle),
                                  stype=out_stypes[i])
                     for i in range(num_output.value)]
+
+
+class OpInstance(object):
+    """Operator with its keyword arguments parsed once.
+
+    Calls only pass the arrays to the backend, which saves parsing the arguments
+    on every call of small operators invoked many times.
+
+    Parameters
+    ----------
+    op_name : str
+        Name of the operator, e.g. 'elemwise_add'.
+    num_inputs : int
+        Number of input arrays of every call.
+    **kwargs
+        Keyword arguments of the operator.
+    """
+    __slots__ = ["handle"]
+    def __init__(self, op_name, num_inputs, **kwargs):
+        op_handle = OpHandle()
+        check_call(_LIB.NNGetOpHandle(c_str(op_name), ctypes.byref(op_handle)))
+        keys = list(kwargs.keys())
+        self.handle = OpInstanceHandle()
+        check_call(_LIB.MXCreateOpInstance(
+            op_handle,
+            ctypes.c_int(num_inputs),
+            ctypes.c_int(len(keys)),
+            c_str_array(keys),
+            c_str_array([str(kwargs[key]) for key in keys]),
+            ctypes.byref(self.handle)))
+
+    def __del__(self):
+        check_call(_LIB.MXFreeOpInstance(self.handle))
+
+    def __call__(self, *args, **kwargs):
+        """ctypes implementation of operator instance invoke wrapper"""
+        out = kwargs.pop('out', None)
+        if kwargs:
+            raise TypeError(
+                "OpInstance.__call__ got unexpected keyword argument(s): " + \
+                ', '.join(kwargs.keys()))
+        if out is not None:
+            original_output = out
+            if isinstance(out, NDArrayBase):
+                out = (out,)
+            num_output = ctypes.c_int(len(out))
+            output_vars = c_handle_array(out)
+            output_vars = ctypes.cast(output_vars, ctypes.POINTER(NDArrayHandle))
+        else:
+            original_output = None
+            output_vars = ctypes.POINTER(NDArrayHandle)()
+            num_output = ctypes.c_int(0)
+        out_stypes = ctypes.POINTER(ctypes.c_int)()
+
+        check_call(_LIB.MXInvokeOpInstance(
+            self.handle,
+            ctypes.c_int(len(args)),
+            c_handle_array(args),
+            ctypes.byref(num_output),
+            ctypes.byref(output_vars),
+            ctypes.byref(out_stypes)))
+
+        if original_output is not None:
+            return original_output
+        if num_output.value == 1:
+            return _ndarray_cls(ctypes.cast(output_vars[0], NDArrayHandle),
+                                stype=out_stypes[0])
+        return [_ndarray_cls(ctypes.cast(output_vars[i], NDArrayHandle),
+                             stype=out_stypes[i])
+                for i in range(num_output.value)]
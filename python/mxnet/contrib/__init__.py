@@ -32,3 +32,4 @@ from . import onnx
 from . import io
 from . import quantization
 from . import quantization as quant
+from . import tvm
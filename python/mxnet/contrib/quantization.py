@@ -124,11 +124,14 @@ class _LayerOutputCollector(object):
 
     def collect(self, name, arr):
         """Callback function for collecting layer output NDArrays."""
-        name = py_str(name)
+        handle = ctypes.cast(arr, NDArrayHandle)
+        self.collect_array(py_str(name), NDArray(handle, writable=False))
+
+    def collect_array(self, name, arr):
+        """Collects the NDArray of a layer output or of a data input."""
         if self.include_layer is not None and not self.include_layer(name):
             return
-        handle = ctypes.cast(arr, NDArrayHandle)
-        arr = NDArray(handle, writable=False).copyto(cpu())
+        arr = arr.copyto(cpu())
         if self.logger is not None:
             self.logger.info("Collecting layer %s output of shape %s" % (name, arr.shape))
         if name in self.nd_dict:
@@ -148,11 +151,13 @@ class _LayerOutputMinMaxCollector(object):
 
     def collect(self, name, arr):
         """Callback function for collecting min and max values from an NDArray."""
-        name = py_str(name)
+        handle = ctypes.cast(arr, NDArrayHandle)
+        self.collect_array(py_str(name), NDArray(handle, writable=False))
+
+    def collect_array(self, name, arr):
+        """Collects the min and max values of a layer output or of a data input."""
         if self.include_layer is not None and not self.include_layer(name):
             return
-        handle = ctypes.cast(arr, NDArrayHandle)
-        arr = NDArray(handle, writable=False)
         min_range = ndarray.min(arr).asscalar()
         max_range = ndarray.max(arr).asscalar()
         if name in self.min_max_dict:
@@ -200,6 +205,10 @@ def _collect_layer_statistics(mod, data, collector, max_num_examples=None, logge
     num_examples = 0
     for batch in data:
         mod.forward(data_batch=batch, is_train=False)
+        # the data inputs are not layer outputs, but are quantized by the quantized layers
+        # reading them directly
+        for name, arr in zip(mod.data_names, batch.data):
+            collector.collect_array(name, arr)
         num_batches += 1
         num_examples += data.batch_size
         if max_num_examples is not None and num_examples >= max_num_examples:
@@ -433,9 +442,10 @@ def quantize_model(sym, arg_params, aux_params,
         from being quantized.
     calib_mode : str
         If calib_mode='none', no calibration will be used and the thresholds for
-        requantization after the corresponding layers will be calculated at runtime by
-        calling min and max operators. The quantized models generated in this
-        mode are normally 10-20% slower than those with calibrations during inference.
+        requantization after the corresponding layers, and for quantizing the float32 inputs
+        of quantized layers, will be calculated at runtime by calling min and max operators.
+        The quantized models generated in this mode are normally 10-20% slower than those
+        with calibrations during inference.
         If calib_mode='naive', the min and max values of the layer outputs from a calibration
         dataset will be directly taken as the thresholds for quantization.
         If calib_mode='entropy' (default mode), the thresholds for quantization will be
@@ -450,7 +460,8 @@ def quantize_model(sym, arg_params, aux_params,
         Given a layer's output name in string, return True or False for deciding whether to
         calibrate this layer. If yes, the statistics of the layer's output will be collected;
         otherwise, no information of the layer's output will be collected. If not provided,
-        all the layers' outputs that need requantization will be collected.
+        all the layers' outputs and the data inputs will be collected, and used for the
+        requantization after quantized layers and for quantizing their float32 inputs.
     logger : Object
         A logging object for printing information during the process of quantization.
 
@@ -488,7 +499,7 @@ def quantize_model(sym, arg_params, aux_params,
             raise ValueError('calib_data must be of DataIter type when calib_mode=%s,'
                              ' while received type %s' % (calib_mode, str(type(calib_data))))
         if calib_layer is None:
-            calib_layer = lambda name: name.endswith('_output')
+            calib_layer = lambda name: name.endswith('_output') or name in data_names
 
         mod = Module(symbol=sym, data_names=data_names, label_names=label_names, context=ctx)
         if len(calib_data.provide_label) > 0:
@@ -0,0 +1,70 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# coding: utf-8
+"""Compile operator subgraphs of executors with TVM."""
+from __future__ import absolute_import
+
+import json
+
+from ..base import _LIB
+from ..context import Context
+from ..ndarray.ndarray import _DTYPE_MX_TO_NP
+from .. import symbol as sym
+
+_BRIDGE_FUNCS = {}
+
+
+def _bridge_func(name):
+    """The function the MXNet TVM bridge registers under name."""
+    import tvm
+    if not _BRIDGE_FUNCS:
+        def fregister(key, func):
+            _BRIDGE_FUNCS[key] = func
+        fregister = tvm.convert(fregister)
+        _LIB.MXTVMBridge(fregister.handle)
+    return _BRIDGE_FUNCS[name]
+
+
+def set_subgraph_compiler(fcompile):
+    """Register the compiler of the subgraphs the executor hands to TVM.
+
+    With ``MXNET_EXEC_TVM_SUBGRAPH=1``, executors bound for inference replace
+    groups of single-consumer operators, the elementwise ones by default or the
+    ones listed in ``MXNET_EXEC_TVM_SUBGRAPH_OPS``, by ``_TVMSubgraph`` nodes.
+    Every node compiles its subgraph with ``fcompile`` on its first run for
+    each new combination of shapes, types and device, and reuses the result.
+    Executors bound before the compiler is registered are not affected.
+
+    Parameters
+    ----------
+    fcompile : function
+        ``fcompile(symbol, shapes, dtypes, ctx)`` returning a TVM function.
+        The symbol has the inputs ``data0``, ``data1``, ... and one output.
+        shapes and dtypes list the inputs followed by the output, and the TVM
+        function takes the input arrays then the output array to write.
+    """
+    import tvm
+
+    def compile_subgraph(graph_json, shapes_json, dtypes_json, dev_type, dev_id):
+        shapes = [tuple(s) for s in json.loads(shapes_json)]
+        dtypes = [_DTYPE_MX_TO_NP[t] for t in json.loads(dtypes_json)]
+        ctx = Context('gpu' if dev_type == tvm.gpu(0).device_type else 'cpu', dev_id)
+        return fcompile(sym.load_json(graph_json), shapes, dtypes, ctx)
+
+    _bridge_func("RegisterSubgraphCompiler")(
+        tvm.convert(compile_subgraph), tvm.get_global_func("_TVMSetStream"))
@@ -8,6 +8,7 @@ ctypedef void* SymbolHandle
 ctypedef void* NDArrayHandle
 ctypedef void* OpHandle
 ctypedef void* CachedOpHandle
+ctypedef void* OpInstanceHandle
 ctypedef unsigned nn_uint
 
 cdef py_str(const char* x):
@@ -102,6 +103,19 @@ cdef extern from "mxnet/c_api.h":
     int MXCreateCachedOp(SymbolHandle handle,
                          CachedOpHandle *out);
     int MXFreeCachedOp(CachedOpHandle handle);
+    int MXCreateOpInstance(OpHandle creator,
+                           int num_inputs,
+                           int num_params,
+                           const char **param_keys,
+                           const char **param_vals,
+                           OpInstanceHandle *out);
+    int MXFreeOpInstance(OpInstanceHandle handle);
+    int MXInvokeOpInstance(OpInstanceHandle handle,
+                           int num_inputs,
+                           NDArrayHandle *inputs,
+                           int *num_outputs,
+                           NDArrayHandle **outputs,
+                           const int **out_stypes);
     int MXInvokeCachedOp(CachedOpHandle handle,
                        int num_inputs,
                        NDArrayHandle *inputs,
@@ -20,7 +20,7 @@
 from __future__ import absolute_import
 
 import ctypes
-from .base import _LIB, check_call
+from .base import _LIB, check_call, mx_uint, py_str
 
 
 def set_bulk_size(size):
@@ -46,6 +46,34 @@ def set_bulk_size(size):
     return prev.value
 
 
+_WORKER_STATS = ('nthreads', 'pending', 'executed', 'queue_wait_us', 'busy_us', 'idle_us')
+
+
+def worker_stats():
+    """Load of the engine worker queues created so far.
+
+    Counters are totals since the queue was created, so the busy fraction of
+    a queue over an interval is the difference of ``busy_us`` divided by the
+    elapsed microseconds times ``nthreads``.
+
+    Returns
+    -------
+    dict of str to dict
+        For every queue, e.g. ``cpu(0)``, ``cpu_priority`` or ``gpu(0)_copy_to``,
+        its number of worker threads, pending and executed operations, and the
+        microseconds operations waited in the queue (``queue_wait_us``) and its
+        workers were busy (``busy_us``) and idle (``idle_us``).
+    """
+    size = mx_uint()
+    names = ctypes.POINTER(ctypes.c_char_p)()
+    stats = ctypes.POINTER(ctypes.c_uint64)()
+    check_call(_LIB.MXEngineGetWorkerStats(ctypes.byref(size), ctypes.byref(names),
+                                           ctypes.byref(stats)))
+    n = len(_WORKER_STATS)
+    return {py_str(names[i]): {k: stats[i * n + j] for j, k in enumerate(_WORKER_STATS)}
+            for i in range(size.value)}
+
+
 class _BulkScope(object):
     """Scope object for bulk execution."""
     def __init__(self, size):
@@ -73,3 +101,58 @@ def bulk(size):
                 x += 1
     """
     return _BulkScope(size)
+
+
+class Recording(object):
+    """Engine operations recorded by :func:`record`.
+
+    :meth:`replay` runs them again on the same arrays, with the dependencies
+    between them computed once at recording time instead of for every
+    operation. Update the inputs in place, e.g. with ``copyto``, and read the
+    results from the arrays the recorded step produced.
+    """
+    def __init__(self):
+        self.handle = None
+
+    def replay(self):
+        """Run the recorded operations again."""
+        if self.handle is not None:
+            check_call(_LIB.MXEngineReplay(self.handle))
+
+    def __del__(self):
+        if self.handle is not None:
+            check_call(_LIB.MXEngineFreeRecord(self.handle))
+
+
+class _RecordScope(object):
+    """Scope object for recording."""
+    def __init__(self):
+        self._recording = Recording()
+
+    def __enter__(self):
+        check_call(_LIB.MXEngineStartRecord())
+        return self._recording
+
+    def __exit__(self, ptype, value, trace):
+        handle = ctypes.c_void_p()
+        check_call(_LIB.MXEngineStopRecord(ctypes.byref(handle)))
+        self._recording.handle = handle if handle.value else None
+
+
+def record():
+    """Record the operations pushed in the scope by the current thread, so
+    a step that repeats the same operations on the same arrays can be
+    replayed without running the Python code again. The operations of the
+    scope run as usual. Arrays used in the scope must not be freed before
+    the recording is.
+
+    Returns a scope whose target is the :class:`Recording`::
+
+        x = mx.nd.ones((4,))
+        y = mx.nd.zeros((4,))
+        with mx.engine.record() as step:
+            y += x * 2
+        for _ in range(10):
+            step.replay()
+    """
+    return _RecordScope()
@@ -255,6 +255,21 @@ class Executor(object):
             self._monitor_callback,
             None))
 
+    def set_priority(self, priority):
+        """Set the engine priority of the operations this executor runs.
+
+        Operations of a positive priority are scheduled ahead of the queued
+        operations of priority 0, and raise the operations they wait for on
+        an array to their priority. Use it for latency critical inference
+        sharing the process with batch jobs.
+
+        Parameters
+        ----------
+        priority : int
+            The priority, 0 by default.
+        """
+        check_call(_LIB.MXExecutorSetPriority(self.handle, ctypes.c_int(priority)))
+
     @property
     def arg_dict(self):
         """Get dictionary representation of argument arrrays.
@@ -172,7 +172,10 @@ class Trainer(object):
 
         self._optimizer.rescale_grad = self._scale / batch_size
 
-        for i, param in enumerate(self._params):
+        # walk the parameters backwards: their gradients become ready in that
+        # order, so pushing them first overlaps communication with backward
+        for i in reversed(range(len(self._params))):
+            param = self._params[i]
             if param.grad_req == 'null':
                 continue
             if not ignore_stale_grad:
@@ -422,13 +422,20 @@ class KVStore(object):
         a dictionary which includes `threshold` like:
         {'type': '2bit', 'threshold': 0.5}
 
+        Top-k Gradient Compression takes a float `ratio` in (0, 0.5], the fraction of
+        gradient values to send. The gradient is split into blocks of about 1/ratio
+        values and only the value of largest magnitude in each block is sent, together
+        with its position in the block. As with 2bit compression, whatever was not
+        sent stays in the residual and is added to the gradient in the next iteration:
+        {'type': 'topk', 'ratio': 0.01}
+
         Parameters
         ----------
         compression_params : dict
             A dictionary specifying the type and parameters for gradient compression.
             The key `type` in this dictionary is a
             required string argument and specifies the type of gradient compression.
-            Currently `type` can be only `2bit`
+            Currently `type` can be `2bit` or `topk`
             Other keys in this dictionary are optional and specific to the type
             of gradient compression.
         """
@@ -473,8 +480,9 @@ class KVStore(object):
         is_worker = ctypes.c_int()
         check_call(_LIB.MXKVStoreIsWorkerNode(ctypes.byref(is_worker)))
 
-        # pylint: disable=invalid-name
-        if 'dist' in self.type and is_worker.value: # pylint: disable=unsupported-membership-test
+        # pylint: disable=invalid-name,unsupported-membership-test
+        # dist_allreduce has no servers, every worker updates its own weights
+        if 'dist' in self.type and 'allreduce' not in self.type and is_worker.value:
             # send the optimizer to server
             try:
                 # use ASCII protocol 0, might be slower, but not a big ideal
@@ -651,9 +659,14 @@ def create(name='local'):
     No two updates happen on the same weight at the same time. However, the order is not
     guaranteed.
 
+    ``dist_allreduce``: Synchronous like ``dist_sync``, without servers. The gradients
+    of all the GPUs of all the machines are summed with NCCL allreduce and every machine
+    updates its own copy of the weights.
+
     Parameters
     ----------
-    name : {'local', 'device', 'nccl', 'dist_sync', 'dist_device_sync', 'dist_async'}
+    name : {'local', 'device', 'device_ring', 'nccl', 'dist_sync', 'dist_device_sync', \
+            'dist_async', 'dist_allreduce'}
         The type of KVStore.
     Returns
     -------
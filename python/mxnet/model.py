@@ -111,22 +111,24 @@ def _update_params_on_kvstore_nccl(param_arrays, grad_arrays, kvstore, param_nam
     valid_param_arrays = [param_arrays[i] for i in valid_indices]
     valid_param_names = [param_names[i] for i in valid_indices]
     size = len(valid_grad_arrays)
-    start = 0
     # Use aggregation by default only with NCCL
     default_batch = 16
     batch = int(os.getenv('MXNET_UPDATE_AGGREGATION_SIZE', default_batch))
-    while start < size:
+    # issue the batches from the last parameters, whose gradients backward
+    # produces first, so their reduction overlaps the rest of backward
+    for start in reversed(range(0, size, batch)):
         end = start + batch if start + batch < size else size
         # push gradient, priority is negative index
         kvstore.push(valid_param_names[start:end], valid_grad_arrays[start:end], priority=-start)
         # pull back the weights
         kvstore.pull(valid_param_names[start:end], valid_param_arrays[start:end], priority=-start)
-        start = end
 
 def _update_params_on_kvstore(param_arrays, grad_arrays, kvstore, param_names):
     """Perform update of param_arrays from grad_arrays on kvstore."""
-    for index, pair in enumerate(zip(param_arrays, grad_arrays)):
-        arg_list, grad_list = pair
+    # push in reverse order: backward produces the gradients of the last
+    # parameters first, so their communication overlaps the rest of backward
+    for index in reversed(range(len(param_arrays))):
+        arg_list, grad_list = param_arrays[index], grad_arrays[index]
         if grad_list[0] is None:
             continue
         name = param_names[index]
@@ -138,8 +140,9 @@ def _update_params_on_kvstore(param_arrays, grad_arrays, kvstore, param_names):
 def _update_params(param_arrays, grad_arrays, updater, num_device,
                    kvstore=None, param_names=None):
     """Perform update of param_arrays from grad_arrays not on kvstore."""
-    for i, pair in enumerate(zip(param_arrays, grad_arrays)):
-        arg_list, grad_list = pair
+    # reverse order, see _update_params_on_kvstore
+    for i in reversed(range(len(param_arrays))):
+        arg_list, grad_list = param_arrays[i], grad_arrays[i]
         if grad_list[0] is None:
             continue
         index = i
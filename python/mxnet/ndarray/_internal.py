@@ -24,18 +24,18 @@ import numpy as np
 
 try:
     if int(_os.environ.get("MXNET_ENABLE_CYTHON", True)) == 0:
-        from .._ctypes.ndarray import NDArrayBase, CachedOp
+        from .._ctypes.ndarray import NDArrayBase, CachedOp, OpInstance
         from .._ctypes.ndarray import _set_ndarray_class, _imperative_invoke
     elif _sys.version_info >= (3, 0):
-        from .._cy3.ndarray import NDArrayBase, CachedOp
+        from .._cy3.ndarray import NDArrayBase, CachedOp, OpInstance
         from .._cy3.ndarray import _set_ndarray_class, _imperative_invoke
     else:
-        from .._cy2.ndarray import NDArrayBase, CachedOp
+        from .._cy2.ndarray import NDArrayBase, CachedOp, OpInstance
         from .._cy2.ndarray import _set_ndarray_class, _imperative_invoke
 except ImportError:
     if int(_os.environ.get("MXNET_ENFORCE_CYTHON", False)) != 0:
         raise ImportError("Cython Module cannot be loaded but MXNET_ENFORCE_CYTHON=1")
-    from .._ctypes.ndarray import NDArrayBase, CachedOp
+    from .._ctypes.ndarray import NDArrayBase, CachedOp, OpInstance
     from .._ctypes.ndarray import _set_ndarray_class, _imperative_invoke
 
 from ..base import _Null
@@ -44,4 +44,5 @@ try:
 except ImportError:
     pass
 
-__all__ = ['NDArrayBase', 'CachedOp', '_imperative_invoke', '_set_ndarray_class']
+__all__ = ['NDArrayBase', 'CachedOp', 'OpInstance', '_imperative_invoke',
+           '_set_ndarray_class']
@@ -35,7 +35,7 @@ from functools import reduce # pylint: disable=redefined-builtin
 import numpy as np
 from ..base import _LIB, numeric_types, integer_types
 from ..base import c_array, c_array_buf, c_handle_array, mx_real_t
-from ..base import mx_uint, NDArrayHandle, check_call
+from ..base import mx_uint, NDArrayHandle, check_call, c_str
 from ..base import ctypes2buffer
 from ..context import Context
 from . import _internal
@@ -46,7 +46,8 @@ __all__ = ["NDArray", "concatenate", "_DTYPE_NP_TO_MX", "_DTYPE_MX_TO_NP", "_GRA
            "ones", "add", "arange", "eye", "divide", "equal", "full", "greater", "greater_equal",
            "imdecode", "lesser", "lesser_equal", "maximum", "minimum", "moveaxis", "modulo",
            "multiply", "not_equal", "onehot_encode", "power", "subtract", "true_divide",
-           "waitall", "_new_empty_handle"]
+           "waitall", "_new_empty_handle", "from_dlpack", "to_dlpack_for_read",
+           "to_dlpack_for_write"]
 
 _STORAGE_TYPE_UNDEFINED = -1
 _STORAGE_TYPE_DEFAULT = 0
@@ -152,6 +153,18 @@ def _new_from_shared_mem(shared_pid, shared_id, shape, dtype):
     return hdl
 
 
+def _new_from_gpu_ipc_handle(ipc_handle, device_id, shape, dtype):
+    hdl = NDArrayHandle()
+    check_call(_LIB.MXNDArrayCreateFromGPUIpcHandle(
+        ctypes.c_char_p(ipc_handle),
+        ctypes.c_int(device_id),
+        c_array(mx_uint, shape),
+        mx_uint(len(shape)),
+        ctypes.c_int(int(_DTYPE_NP_TO_MX[np.dtype(dtype).type])),
+        ctypes.byref(hdl)))
+    return hdl
+
+
 def waitall():
     """Wait for all async operations to finish in MXNet.
 
@@ -160,6 +173,120 @@ def waitall():
     check_call(_LIB.MXNDArrayWaitAll())
 
 
+_PyCapsuleDestructor = ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+_C_STR_DLTENSOR = c_str('dltensor')
+_C_STR_USED_DLTENSOR = c_str('used_dltensor')
+ctypes.pythonapi.PyCapsule_New.restype = ctypes.py_object
+ctypes.pythonapi.PyCapsule_New.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                           _PyCapsuleDestructor]
+ctypes.pythonapi.PyCapsule_IsValid.restype = ctypes.c_int
+ctypes.pythonapi.PyCapsule_IsValid.argtypes = [ctypes.py_object, ctypes.c_char_p]
+ctypes.pythonapi.PyCapsule_GetPointer.restype = ctypes.c_void_p
+ctypes.pythonapi.PyCapsule_GetPointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+ctypes.pythonapi.PyCapsule_SetName.restype = ctypes.c_int
+ctypes.pythonapi.PyCapsule_SetName.argtypes = [ctypes.py_object, ctypes.c_char_p]
+ctypes.pythonapi.PyCapsule_SetDestructor.restype = ctypes.c_int
+ctypes.pythonapi.PyCapsule_SetDestructor.argtypes = [ctypes.py_object, ctypes.c_void_p]
+
+
+# the capsule being destroyed is passed as a raw pointer, it must not be referenced
+_capsule_is_valid_raw = ctypes.PYFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_char_p)(
+    ('PyCapsule_IsValid', ctypes.pythonapi))
+_capsule_get_pointer_raw = ctypes.PYFUNCTYPE(ctypes.c_void_p, ctypes.c_void_p, ctypes.c_char_p)(
+    ('PyCapsule_GetPointer', ctypes.pythonapi))
+
+
+def _dlpack_deleter(pycapsule):
+    """Calls the deleter of a DLPack capsule that was never consumed."""
+    if _capsule_is_valid_raw(pycapsule, _C_STR_DLTENSOR):
+        ptr = _capsule_get_pointer_raw(pycapsule, _C_STR_DLTENSOR)
+        check_call(_LIB.MXNDArrayCallDLPackDeleter(ctypes.c_void_p(ptr)))
+
+_C_DLPACK_DELETER = _PyCapsuleDestructor(_dlpack_deleter)
+
+
+def _to_dlpack(data):
+    dlpack = ctypes.c_void_p()
+    check_call(_LIB.MXNDArrayToDLPack(data.handle, ctypes.byref(dlpack)))
+    return ctypes.pythonapi.PyCapsule_New(dlpack, _C_STR_DLTENSOR, _C_DLPACK_DELETER)
+
+
+def to_dlpack_for_read(data):
+    """Returns a DLPack capsule ('dltensor') sharing the memory of the array.
+
+    The pending writes to the array are finished first, so the tensor can be read.
+
+    Parameters
+    ----------
+    data : NDArray
+        A dense array.
+
+    Returns
+    -------
+    PyCapsule
+        The capsule, consumed once by a DLPack importer such as ``from_dlpack``.
+
+    Examples
+    --------
+    >>> x = mx.nd.ones((2,3))
+    >>> y = mx.nd.to_dlpack_for_read(x)
+    >>> z = mx.nd.from_dlpack(y)
+    >>> z
+    [[1. 1. 1.]
+     [1. 1. 1.]]
+    <NDArray 2x3 @cpu(0)>
+    """
+    data.wait_to_read()
+    return _to_dlpack(data)
+
+
+def to_dlpack_for_write(data):
+    """Returns a DLPack capsule ('dltensor') sharing the memory of the array.
+
+    All pending operations on the array are finished first, so the tensor can be written.
+
+    Parameters
+    ----------
+    data : NDArray
+        A dense array.
+
+    Returns
+    -------
+    PyCapsule
+        The capsule, consumed once by a DLPack importer such as ``from_dlpack``.
+    """
+    check_call(_LIB.MXNDArrayWaitToWrite(data.handle))
+    return _to_dlpack(data)
+
+
+def from_dlpack(dlpack):
+    """Returns an NDArray sharing the memory of a DLPack tensor, without copying.
+
+    Parameters
+    ----------
+    dlpack : PyCapsule or object with a ``__dlpack__`` method
+        A DLPack capsule ('dltensor') of a dense tensor on CPU or GPU. The capsule is
+        consumed, the deleter of the tensor is called once the NDArray and the
+        operations using it are done with the memory.
+
+    Returns
+    -------
+    NDArray
+        The array sharing the memory of the tensor.
+    """
+    if hasattr(dlpack, '__dlpack__'):
+        dlpack = dlpack.__dlpack__()
+    if not ctypes.pythonapi.PyCapsule_IsValid(dlpack, _C_STR_DLTENSOR):
+        raise ValueError('Invalid DLPack tensor, DLPack capsules can be consumed only once.')
+    ptr = ctypes.pythonapi.PyCapsule_GetPointer(dlpack, _C_STR_DLTENSOR)
+    handle = NDArrayHandle()
+    check_call(_LIB.MXNDArrayFromDLPack(ctypes.c_void_p(ptr), ctypes.byref(handle)))
+    # the NDArray owns the tensor now
+    ctypes.pythonapi.PyCapsule_SetName(dlpack, _C_STR_USED_DLTENSOR)
+    ctypes.pythonapi.PyCapsule_SetDestructor(dlpack, None)
+    return NDArray(handle=handle)
+
+
 def _storage_type(handle):
     storage_type = ctypes.c_int(0)
     check_call(_LIB.MXNDArrayGetStorageType(handle, ctypes.byref(storage_type)))
@@ -200,6 +327,11 @@ fixed-size items.
             self.handle, ctypes.byref(shared_pid), ctypes.byref(shared_id)))
         return shared_pid.value, shared_id.value, self.shape, self.dtype
 
+    def _to_gpu_ipc_handle(self):
+        ipc_handle = ctypes.create_string_buffer(128)
+        check_call(_LIB.MXNDArrayGetGPUIpcHandle(self.handle, ipc_handle))
+        return ipc_handle.raw, self.context.device_id, self.shape, self.dtype
+
     def __add__(self, other):
         """x.__add__(y) <=> x+y <=> mx.nd.add(x, y) """
         return add(self, other)
@@ -1681,6 +1813,20 @@ fixed-size items.
             return op.broadcast_to(self, shape=tuple(shape))
     # pylint: enable= undefined-variable
 
+    def to_dlpack_for_read(self):
+        """Returns a DLPack capsule sharing the memory of this array, once it can be read.
+
+        See ``mx.nd.to_dlpack_for_read``.
+        """
+        return to_dlpack_for_read(self)
+
+    def to_dlpack_for_write(self):
+        """Returns a DLPack capsule sharing the memory of this array, once it can be written.
+
+        See ``mx.nd.to_dlpack_for_write``.
+        """
+        return to_dlpack_for_write(self)
+
     def wait_to_read(self):
         """Waits until all previous write operations on the current array are finished.
 
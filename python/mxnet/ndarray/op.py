@@ -18,10 +18,10 @@
 # coding: utf-8
 # pylint: disable=wildcard-import, unused-wildcard-import, redefined-builtin
 """Backend ops in mxnet.ndarray namespace"""
-from ._internal import CachedOp
+from ._internal import CachedOp, OpInstance
 try:
     from .gen_op import * # pylint: disable=unused-wildcard-import
 except ImportError:
     pass
 
-__all__ = ['CachedOp']
+__all__ = ['CachedOp', 'OpInstance']
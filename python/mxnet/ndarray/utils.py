@@ -19,9 +19,11 @@
 """Utility functions for NDArray and BaseSparseNDArray."""
 import ctypes
 
+import numpy as np
+
 from ..base import _LIB, check_call, py_str, c_str, string_types, mx_uint, NDArrayHandle
 from ..base import c_array, c_handle_array, c_str_array
-from .ndarray import NDArray
+from .ndarray import NDArray, _DTYPE_NP_TO_MX
 from .ndarray import array as _array
 from .ndarray import empty as _empty_ndarray
 from .ndarray import zeros as _zeros_ndarray
@@ -219,7 +221,7 @@ def load_frombuffer(buf):
             for i in range(out_size.value))
 
 
-def save(fname, data):
+def save(fname, data, mapped=False, background=False, dtype=None):
     """Saves a list of arrays or a dict of str->array to file.
 
     Examples of filenames:
@@ -236,6 +238,18 @@ def save(fname, data):
            or list of NDArray, RowSparseNDArray or CSRNDArray, \
            or dict of str to NDArray, RowSparseNDArray or CSRNDArray
         The data to save.
+    mapped : bool, optional
+        Save dense arrays in the indexed format that ``load`` maps into memory,
+        aligning the data of each array to 64 bytes. Loading such a file only reads
+        the index, the arrays are on ``cpu(0)`` and are read from the file on first use.
+    background : bool, optional
+        Write the file in the background. The arrays are copied to CPU snapshots by
+        operations on the engine and written as the copies complete, so they can be
+        updated right away. Returns an NDArray that is written once the file is closed,
+        waiting for it raises the errors of writing the file.
+    dtype : str or numpy.dtype, optional
+        The type float32 dense arrays are stored as, e.g. ``'float16'`` to halve the
+        size of checkpoints. ``load`` returns arrays of this type.
 
     Examples
     --------
@@ -267,7 +281,24 @@ def save(fname, data):
     else:
         raise ValueError("data needs to either be a NDArray, dict of str, NDArray pairs "
                          "or a list of NDarrays.")
-    check_call(_LIB.MXNDArraySave(c_str(fname),
-                                  mx_uint(len(handles)),
-                                  handles,
-                                  keys))
+    if background or dtype is not None:
+        if mapped:
+            raise ValueError("mapped files cannot be saved in the background or cast")
+        done = NDArrayHandle()
+        mx_dtype = -1 if dtype is None else _DTYPE_NP_TO_MX[np.dtype(dtype).type]
+        check_call(_LIB.MXNDArraySaveAsync(c_str(fname),
+                                           mx_uint(len(handles)),
+                                           handles,
+                                           keys,
+                                           ctypes.c_int(mx_dtype),
+                                           ctypes.byref(done)))
+        done = NDArray(done)
+        if background:
+            return done
+        done.wait_to_read()
+        return None
+    save_fn = _LIB.MXNDArraySaveMapped if mapped else _LIB.MXNDArraySave
+    check_call(save_fn(c_str(fname),
+                       mx_uint(len(handles)),
+                       handles,
+                       keys))
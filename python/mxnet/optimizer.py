@@ -1144,24 +1144,31 @@ class RMSProp(Optimizer):
         ``False`` will use Tieleman & Hinton's version of `RMSProp`.
     clip_weights : float, optional
         Clips weights into range ``[-clip_weights, clip_weights]``.
+    lazy_update : bool, optional
+       Default is True. If True and the storage types of weight and grad are both
+       ``row_sparse``, lazy updates are applied: only the rows of weight and the
+       states whose indices appear in grad are updated.
     """
     def __init__(self, learning_rate=0.001, gamma1=0.9, gamma2=0.9,
-                 epsilon=1e-8, centered=False, clip_weights=None, **kwargs):
+                 epsilon=1e-8, centered=False, clip_weights=None,
+                 lazy_update=True, **kwargs):
         super(RMSProp, self).__init__(learning_rate=learning_rate, **kwargs)
         self.gamma1 = gamma1
         self.gamma2 = gamma2
         self.centered = centered
         self.epsilon = epsilon
         self.clip_weights = clip_weights
+        self.lazy_update = lazy_update
 
     def create_state(self, index, weight):
+        stype = weight.stype if self.lazy_update else 'default'
         if self.centered:
             return (
-                zeros(weight.shape, weight.context, stype=weight.stype),  # n
-                zeros(weight.shape, weight.context, stype=weight.stype),  # g
-                zeros(weight.shape, weight.context, stype=weight.stype))  # delta
+                zeros(weight.shape, weight.context, stype=stype),  # n
+                zeros(weight.shape, weight.context, stype=stype),  # g
+                zeros(weight.shape, weight.context, stype=stype))  # delta
         else:
-            return (zeros(weight.shape, weight.context, stype=weight.stype),)  # n
+            return (zeros(weight.shape, weight.context, stype=stype),)  # n
 
     def update(self, index, weight, grad, state):
         assert(isinstance(weight, NDArray))
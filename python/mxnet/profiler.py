@@ -21,6 +21,7 @@
 """Profiler setting methods."""
 from __future__ import absolute_import
 import ctypes
+import json
 import warnings
 from .base import _LIB, check_call, c_str, ProfileHandle, c_str_array, py_str
 
@@ -39,7 +40,9 @@ def set_config(**kwargs):
     profile_imperative : boolean,
         whether to profile imperative operators
     profile_memory : boolean,
-        whether to profile memory usage
+        whether to profile memory usage. Besides the total of each device, the memory in use
+        is broken down by category (weights, activations, workspace, other) and by the
+        operator that allocated it, as counters whose maximum is the peak
     profile_api : boolean,
         whether to profile the C API
     contiguous_dump : boolean,
@@ -124,20 +127,68 @@ def dump_profile():
     dump(True)
 
 
-def dumps(reset=False):
+def dumps(reset=False, format='table'):
     """Return a printable string of aggregate profile stats.
 
     Parameters
     ----------
     reset: boolean
         Indicates whether to clean aggeregate statistical data collected up to this point
+    format: string
+        'table' for a table to print, or 'json' for a JSON string of the durations, with
+        their count, total, min, max, average and 50, 90, 99 and 99.9 percentiles in
+        microseconds and their histogram, overall and per device for the operators
     """
+    # pylint: disable=redefined-builtin
     debug_str = ctypes.c_char_p()
     do_reset = 1 if reset is True else 0
-    check_call(_LIB.MXAggregateProfileStatsPrint(ctypes.byref(debug_str), int(do_reset)))
+    if format == 'table':
+        check_call(_LIB.MXAggregateProfileStatsPrint(ctypes.byref(debug_str), int(do_reset)))
+    elif format == 'json':
+        check_call(_LIB.MXAggregateProfileStatsPrintJSON(ctypes.byref(debug_str),
+                                                         int(do_reset)))
+    else:
+        raise ValueError("format must be 'table' or 'json', got %s" % format)
     return py_str(debug_str.value)
 
 
+def sampled_stats(reset=False):
+    """Return the statistics of the operators sampled when the environment variable
+    MXNET_PROFILER_SAMPLE_RATE is set to n > 0, in which case one out of n operators
+    is timed whether the profiler runs or not.
+
+    Parameters
+    ----------
+    reset: boolean
+        Indicates whether to clean the statistics sampled up to this point
+
+    Returns
+    -------
+    dict
+        Maps the category, then the operator name to a dict with the number of samples
+        'count', their 'total_us', 'min_us', 'max_us', 'avg_us' durations and 'p50_us',
+        'p90_us', 'p99_us' and 'p999_us' percentiles in microseconds, as in
+        ``dumps(format='json')``. Empty when sampling is disabled.
+    """
+    json_str = ctypes.c_char_p()
+    check_call(_LIB.MXProfileSampledStats(ctypes.byref(json_str), int(reset)))
+    return json.loads(py_str(json_str.value))
+
+
+def set_nvtx(enabled=True):
+    """Turn the NVTX ranges around operators, bulk segments, hybridized blocks and kvstore
+    push and pull on or off, to name what launched the kernels in Nsight Systems. Also set
+    at startup by the environment variable MXNET_PROFILER_NVTX. Needs MXNet built with
+    USE_NVTX=1.
+
+    Parameters
+    ----------
+    enabled: boolean
+        Whether to emit the ranges
+    """
+    check_call(_LIB.MXProfileSetNVTX(int(enabled)))
+
+
 def pause():
     """Pause profiling."""
     check_call(_LIB.MXProfilePause(int(1)))
@@ -46,6 +46,7 @@
 #include "./c_api_common.h"
 #include "../operator/custom/custom-inl.h"
 #include "../operator/tensor/matrix_op-inl.h"
+#include "../ndarray/mapped_ndarray_file.h"
 
 using namespace mxnet;
 
@@ -116,6 +117,51 @@ int MXEngineSetBulkSize(int bulk_size, int* prev_bulk_size) {
   API_END();
 }
 
+int MXEngineGetWorkerStats(mx_uint *out_size, const char ***out_names,
+                           const uint64_t **out_stats) {
+  MXAPIThreadLocalEntry *ret = MXAPIThreadLocalStore::Get();
+  API_BEGIN();
+  ret->ret_vec_str.clear();
+  ret->ret_vec_uint64.clear();
+  for (const engine::WorkerStats& s : Engine::Get()->GetWorkerStats()) {
+    ret->ret_vec_str.push_back(s.name);
+    for (uint64_t v : {s.nthreads, s.pending, s.executed, s.queue_wait_us, s.busy_us,
+                       s.idle_us}) {
+      ret->ret_vec_uint64.push_back(v);
+    }
+  }
+  ret->ret_vec_charp.clear();
+  for (const std::string& name : ret->ret_vec_str) ret->ret_vec_charp.push_back(name.c_str());
+  *out_size = static_cast<mx_uint>(ret->ret_vec_str.size());
+  *out_names = dmlc::BeginPtr(ret->ret_vec_charp);
+  *out_stats = dmlc::BeginPtr(ret->ret_vec_uint64);
+  API_END();
+}
+
+int MXEngineStartRecord() {
+  API_BEGIN();
+  Engine::Get()->StartRecord();
+  API_END();
+}
+
+int MXEngineStopRecord(EngineRecordHandle *out) {
+  API_BEGIN();
+  *out = Engine::Get()->StopRecord();
+  API_END();
+}
+
+int MXEngineReplay(EngineRecordHandle handle) {
+  API_BEGIN();
+  Engine::Get()->Push(static_cast<Engine::OprHandle>(handle), Context::CPU());
+  API_END();
+}
+
+int MXEngineFreeRecord(EngineRecordHandle handle) {
+  API_BEGIN();
+  Engine::Get()->DeleteOperator(static_cast<Engine::OprHandle>(handle));
+  API_END();
+}
+
 int MXGetVersion(int *out) {
   API_BEGIN();
   *out = static_cast<int>(MXNET_VERSION);
@@ -264,6 +310,30 @@ int MXNDArrayWaitToRead(NDArrayHandle handle) {
   API_END();
 }
 
+int MXNDArrayIsReadyToRead(NDArrayHandle handle, int *out) {
+  API_BEGIN();
+  *out = static_cast<NDArray*>(handle)->IsReadyToRead();
+  API_END();
+}
+
+int MXNDArrayOnReadyToRead(NDArrayHandle handle,
+                           NDArrayReadyCallback callback,
+                           void *callback_handle) {
+  API_BEGIN();
+  const NDArray *arr = static_cast<NDArray*>(handle);
+  if (arr->is_none() || arr->IsReadyToRead()) {
+    callback(callback_handle);
+  } else {
+    // pushed as a wait operation, so it runs after a failed write too
+    Engine::Get()->PushAsync(
+      [callback, callback_handle](RunContext, Engine::CallbackOnComplete on_complete) {
+        callback(callback_handle);
+        on_complete();
+      }, Context::CPU(), {arr->var()}, {}, FnProperty::kNormal, 0, "OnReadyToRead", true);
+  }
+  API_END();
+}
+
 int MXNDArrayWaitToWrite(NDArrayHandle handle) {
   API_BEGIN();
   static_cast<NDArray*>(handle)->WaitToWrite();
@@ -299,6 +369,42 @@ int MXNDArraySave(const char* fname,
   API_END();
 }
 
+int MXNDArraySaveAsync(const char* fname,
+                       mx_uint num_args,
+                       NDArrayHandle* args,
+                       const char** keys,
+                       int dtype,
+                       NDArrayHandle* out) {
+  API_BEGIN();
+  std::vector<NDArray> data(num_args);
+  std::vector<std::string> names;
+  for (mx_uint i = 0; i < num_args; ++i) {
+    data[i] = *static_cast<NDArray*>(args[i]);
+  }
+  if (keys != nullptr) {
+    names.assign(keys, keys + num_args);
+  }
+  *out = new NDArray(mxnet::NDArray::SaveAsync(fname, data, names, dtype));
+  API_END();
+}
+
+int MXNDArraySaveMapped(const char* fname,
+                        mx_uint num_args,
+                        NDArrayHandle* args,
+                        const char** keys) {
+  API_BEGIN();
+  std::vector<NDArray> data(num_args);
+  std::vector<std::string> names;
+  for (mx_uint i = 0; i < num_args; ++i) {
+    data[i] = *static_cast<NDArray*>(args[i]);
+  }
+  if (keys != nullptr) {
+    names.assign(keys, keys + num_args);
+  }
+  mxnet::MappedNDArrayFile::Save(fname, data, names);
+  API_END();
+}
+
 int MXNDArrayLoad(const char* fname,
                   mx_uint *out_size,
                   NDArrayHandle** out_arr,
@@ -309,7 +415,12 @@ int MXNDArrayLoad(const char* fname,
   API_BEGIN();
   std::vector<NDArray> data;
   std::vector<std::string> &names = ret->ret_vec_str;
-  {
+  if (mxnet::MappedNDArrayFile::IsMappedFile(fname)) {
+    // the arrays are backed by the mapped file and read on first use
+    mxnet::MappedNDArrayFile file(fname);
+    for (size_t i = 0; i < file.size(); ++i) data.push_back(file.Get(i));
+    names = file.names();
+  } else {
     std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname, "r"));
     mxnet::NDArray::Load(fi.get(), &data, &names);
   }
@@ -485,6 +596,30 @@ int MXNDArrayGetData(NDArrayHandle handle,
   API_END();
 }
 
+int MXNDArrayToDLPack(NDArrayHandle handle,
+                      DLManagedTensorHandle *out_dlpack) {
+  API_BEGIN();
+  NDArray *arr = static_cast<NDArray*>(handle);
+  *out_dlpack = arr->ToDLPack();
+  API_END();
+}
+
+int MXNDArrayFromDLPack(DLManagedTensorHandle dlpack,
+                        NDArrayHandle *out_handle) {
+  API_BEGIN();
+  *out_handle = new NDArray(NDArray::FromDLPack(static_cast<DLManagedTensor*>(dlpack)));
+  API_END();
+}
+
+int MXNDArrayCallDLPackDeleter(DLManagedTensorHandle dlpack) {
+  API_BEGIN();
+  if (dlpack != nullptr) {
+    DLManagedTensor *tensor = static_cast<DLManagedTensor*>(dlpack);
+    if (tensor->deleter != nullptr) tensor->deleter(tensor);
+  }
+  API_END();
+}
+
 int MXNDArrayGetDType(NDArrayHandle handle,
                      int *out_dtype) {
   API_BEGIN();
@@ -1305,3 +1440,42 @@ int MXNDArrayCreateFromSharedMem(int shared_pid, int shared_id, const mx_uint *s
   *out = new NDArray(shared_pid, shared_id, TShape(shape, shape + ndim), dtype);
   API_END();
 }
+
+int MXNDArrayGetGPUIpcHandle(NDArrayHandle handle, char* ipc_handle) {
+  API_BEGIN();
+  NDArray* arr = reinterpret_cast<NDArray*>(handle);
+  CHECK_EQ(arr->ctx().dev_type, Context::kGPU) << "GPU ipc handles need a gpu array";
+  CHECK_EQ(arr->storage_type(), kDefaultStorage)
+      << "GPU ipc handles only support default storage";
+  arr->WaitToRead();
+  Storage::Handle shandle = arr->storage_handle();
+  if (shandle.shared_pid == -1) {
+    // export a copy in gpu shared memory
+    shandle = Storage::Handle();
+    shandle.ctx = arr->ctx();
+    shandle.size = arr->shape().Size() * mshadow::mshadow_sizeof(arr->dtype());
+    Storage::Get()->SharedAllocGPU(&shandle);
+    NDArray new_arr(shandle, arr->shape(), arr->dtype());
+    CopyFromTo(*arr, new_arr);
+    new_arr.WaitToRead();
+  }
+  Storage::Get()->SharedExportGPU(shandle, ipc_handle);
+  API_END();
+}
+
+int MXNDArrayCreateFromGPUIpcHandle(const char* ipc_handle, int dev_id, const mx_uint *shape,
+                                    mx_uint ndim, int dtype, NDArrayHandle *out) {
+  API_BEGIN();
+  TShape tshape(shape, shape + ndim);
+  Storage::Handle shandle;
+  shandle.ctx = Context::GPU(dev_id);
+  Storage::Get()->SharedImportGPU(ipc_handle, &shandle);
+  const size_t bytes = tshape.Size() * mshadow::mshadow_sizeof(dtype);
+  if (shandle.size < bytes) {
+    Storage::Get()->Free(shandle);
+    LOG(FATAL) << "Shared gpu memory of " << shandle.size << " bytes is too small for "
+               << bytes << " bytes";
+  }
+  *out = new NDArray(shandle, tshape, dtype);
+  API_END();
+}
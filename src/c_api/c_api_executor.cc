@@ -524,3 +524,10 @@ int MXExecutorSetMonitorCallback(ExecutorHandle handle,
   exec->SetMonitorCallback(clbk);
   API_END();
 }
+
+int MXExecutorSetPriority(ExecutorHandle handle, int priority) {
+  API_BEGIN();
+  Executor *exec = static_cast<Executor*>(handle);
+  exec->SetPriority(priority);
+  API_END();
+}
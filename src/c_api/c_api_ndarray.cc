@@ -31,6 +31,7 @@
 #include <mxnet/imperative.h>
 #include <nnvm/node.h>
 #include <nnvm/op_attr_types.h>
+#include <memory>
 #include <string>
 #include "./c_api_common.h"
 #include "../common/utils.h"
@@ -77,31 +78,29 @@ void SetNDInputsOutputs(const nnvm::Op* op,
   }
 }
 
-void MXImperativeInvokeImpl(AtomicSymbolCreator creator,
-                            int num_inputs,
-                            NDArrayHandle *inputs,
-                            int *num_outputs,
-                            NDArrayHandle **outputs,
-                            int num_params,
-                            const char **param_keys,
-                            const char **param_vals) {
-  const nnvm::Op* op = static_cast<nnvm::Op*>(creator);
+/*!
+ * \brief invoke op with attributes parsed before, inputs and outputs as MXImperativeInvoke.
+ * \param record_attrs attributes, moved into a recorded node, none to copy attrs instead
+ */
+void InvokeParsedOp(const nnvm::NodeAttrs& attrs,
+                    nnvm::NodeAttrs* record_attrs,
+                    int infered_num_outputs,
+                    int num_visible_outputs,
+                    int num_inputs,
+                    NDArrayHandle *inputs,
+                    int *num_outputs,
+                    NDArrayHandle **outputs) {
   MXAPIThreadLocalEntry *ret = MXAPIThreadLocalStore::Get();
 
-  nnvm::NodeAttrs attrs = imperative::ParseAttrs(op, num_inputs, num_params,
-                                                 param_keys, param_vals);
-
-  int infered_num_outputs;
-  int num_visible_outputs;
-  imperative::SetNumOutputs(op, attrs, num_inputs, &infered_num_outputs, &num_visible_outputs);
-
   std::vector<NDArray*> ndinputs, ndoutputs;
-  SetNDInputsOutputs(op, &ndinputs, &ndoutputs, num_inputs, inputs,
+  SetNDInputsOutputs(attrs.op, &ndinputs, &ndoutputs, num_inputs, inputs,
       num_outputs, infered_num_outputs, num_visible_outputs, outputs);
 
   auto state = Imperative::Get()->Invoke(Context::CPU(), attrs, ndinputs, ndoutputs);
   if (Imperative::Get()->is_recording()) {
-    Imperative::Get()->RecordOp(std::move(attrs), ndinputs, ndoutputs, state);
+    Imperative::Get()->RecordOp(
+        record_attrs != nullptr ? std::move(*record_attrs) : nnvm::NodeAttrs(attrs),
+        ndinputs, ndoutputs, state);
   }
 
   for (int i = *num_outputs; i < infered_num_outputs; ++i) delete ndoutputs[i];
@@ -114,6 +113,39 @@ void MXImperativeInvokeImpl(AtomicSymbolCreator creator,
   }
 }
 
+/*! \brief set the storage types of the outputs of an invoke for the Ex C APIs */
+void SetOutputStypes(int num_outputs, NDArrayHandle *outputs, const int **out_stypes) {
+  MXAPIThreadLocalEntry *ret = MXAPIThreadLocalStore::Get();
+  NDArray** out_array = reinterpret_cast<NDArray**>(outputs);
+  ret->out_types.clear();
+  ret->out_types.reserve(num_outputs);
+  for (int i = 0; i < num_outputs; ++i) {
+    ret->out_types.emplace_back(out_array[i]->storage_type());
+  }
+  *out_stypes = dmlc::BeginPtr(ret->out_types);
+}
+
+void MXImperativeInvokeImpl(AtomicSymbolCreator creator,
+                            int num_inputs,
+                            NDArrayHandle *inputs,
+                            int *num_outputs,
+                            NDArrayHandle **outputs,
+                            int num_params,
+                            const char **param_keys,
+                            const char **param_vals) {
+  const nnvm::Op* op = static_cast<nnvm::Op*>(creator);
+
+  nnvm::NodeAttrs attrs = imperative::ParseAttrs(op, num_inputs, num_params,
+                                                 param_keys, param_vals);
+
+  int infered_num_outputs;
+  int num_visible_outputs;
+  imperative::SetNumOutputs(op, attrs, num_inputs, &infered_num_outputs, &num_visible_outputs);
+
+  InvokeParsedOp(attrs, &attrs, infered_num_outputs, num_visible_outputs,
+                 num_inputs, inputs, num_outputs, outputs);
+}
+
 int MXImperativeInvoke(AtomicSymbolCreator creator,
                        int num_inputs,
                        NDArrayHandle *inputs,
@@ -137,17 +169,58 @@ int MXImperativeInvokeEx(AtomicSymbolCreator creator,
                          const char **param_keys,
                          const char **param_vals,
                          const int **out_stypes) {  // outputs storage types
-  MXAPIThreadLocalEntry *ret = MXAPIThreadLocalStore::Get();
   API_BEGIN();
   MXImperativeInvokeImpl(creator, num_inputs, inputs, num_outputs, outputs,
                          num_params, param_keys, param_vals);
-  NDArray** out_array = *reinterpret_cast<NDArray***>(outputs);
-  ret->out_types.clear();
-  ret->out_types.reserve(*num_outputs);
-  for (int i = 0; i < *num_outputs; ++i) {
-    ret->out_types.emplace_back(out_array[i]->storage_type());
-  }
-  *out_stypes = dmlc::BeginPtr(ret->out_types);
+  SetOutputStypes(*num_outputs, *outputs, out_stypes);
+  API_END();
+}
+
+/*! \brief an operator with its attributes parsed once, for MXInvokeOpInstance */
+struct OpInstance {
+  nnvm::NodeAttrs attrs;
+  int num_inputs;
+  int infered_num_outputs;
+  int num_visible_outputs;
+};
+
+int MXCreateOpInstance(AtomicSymbolCreator creator,
+                       int num_inputs,
+                       int num_params,
+                       const char **param_keys,
+                       const char **param_vals,
+                       OpInstanceHandle *out) {
+  const nnvm::Op* op = static_cast<nnvm::Op*>(creator);
+  API_BEGIN();
+  std::unique_ptr<OpInstance> inst(new OpInstance());
+  inst->attrs = imperative::ParseAttrs(op, num_inputs, num_params, param_keys, param_vals);
+  inst->num_inputs = num_inputs;
+  imperative::SetNumOutputs(op, inst->attrs, num_inputs, &inst->infered_num_outputs,
+                            &inst->num_visible_outputs);
+  *out = inst.release();
+  API_END();
+}
+
+int MXFreeOpInstance(OpInstanceHandle handle) {
+  API_BEGIN();
+  delete static_cast<OpInstance*>(handle);
+  API_END();
+}
+
+int MXInvokeOpInstance(OpInstanceHandle handle,
+                       int num_inputs,
+                       NDArrayHandle *inputs,
+                       int *num_outputs,
+                       NDArrayHandle **outputs,
+                       const int **out_stypes) {
+  const OpInstance* inst = static_cast<OpInstance*>(handle);
+  API_BEGIN();
+  CHECK_EQ(num_inputs, inst->num_inputs)
+    << "Operator " << inst->attrs.op->name << " was created for " << inst->num_inputs
+    << " inputs, but got " << num_inputs << " instead.";
+  InvokeParsedOp(inst->attrs, nullptr, inst->infered_num_outputs, inst->num_visible_outputs,
+                 num_inputs, inputs, num_outputs, outputs);
+  if (out_stypes != nullptr) SetOutputStypes(*num_outputs, *outputs, out_stypes);
   API_END();
 }
 
@@ -32,6 +32,7 @@
 #include <stack>
 #include "./c_api_common.h"
 #include "../profiler/profiler.h"
+#include "../profiler/nvtx.h"
 
 namespace mxnet {
 
@@ -288,6 +289,43 @@ int MXAggregateProfileStatsPrint(const char **out_str, int reset) {
   API_END();
 }
 
+int MXAggregateProfileStatsPrintJSON(const char **out_json, int reset) {
+  MXAPIThreadLocalEntry *ret = MXAPIThreadLocalStore::Get();
+  API_BEGIN();
+    CHECK_NOTNULL(out_json);
+    profiler::Profiler *profiler = profiler::Profiler::Get();
+    if (profiler->IsEnableOutput()) {
+      // Register stats up until now
+      profiler->DumpProfile(false);
+    }
+    std::shared_ptr<profiler::AggregateStats> stats = profiler->GetAggregateStats();
+    std::ostringstream os;
+    if (stats) {
+      stats->DumpJSON(os, reset != 0);
+    } else {
+      os << "{}";
+    }
+    ret->ret_str = os.str();
+    *out_json = (ret->ret_str).c_str();
+  API_END();
+}
+
+int MXProfileSampledStats(const char **out_json, int reset) {
+  MXAPIThreadLocalEntry *ret = MXAPIThreadLocalStore::Get();
+  API_BEGIN();
+    CHECK_NOTNULL(out_json);
+    profiler::OperatorSampler *sampler = profiler::Profiler::Get()->sampler();
+    std::ostringstream os;
+    if (sampler) {
+      sampler->Dump(os, reset != 0);
+    } else {
+      os << "{}";
+    }
+    ret->ret_str = os.str();
+    *out_json = (ret->ret_str).c_str();
+  API_END();
+}
+
 int MXDumpProfile(int finished) {
   mxnet::IgnoreProfileCallScope ignore;
   API_BEGIN();
@@ -445,6 +483,13 @@ int MXProfileDurationStop(ProfileHandle duration_handle) {
   API_END();
 }
 
+int MXProfileSetNVTX(int enabled) {
+  mxnet::IgnoreProfileCallScope ignore;
+  API_BEGIN();
+    profiler::nvtx::SetEnabled(enabled != 0);
+  API_END();
+}
+
 int MXProfilePause(int paused) {
   mxnet::IgnoreProfileCallScope ignore;
   API_BEGIN();
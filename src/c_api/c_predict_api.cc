@@ -28,15 +28,72 @@
 #include <mxnet/executor.h>
 #include <mxnet/ndarray.h>
 #include <nnvm/pass_functions.h>
+#include <algorithm>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <unordered_set>
 #include <unordered_map>
 #include "./c_api_common.h"
 #include "../operator/operator_common.h"
 #include "../executor/exec_pass.h"
+#include "../ndarray/param_loader.h"
 
 using namespace mxnet;
 
+// executor bound for one set of input shapes
+struct MXAPIPredictorExec {
+  std::shared_ptr<Executor> exec;
+  std::vector<NDArray> arg_arrays;
+  std::vector<NDArray> aux_arrays;
+  std::vector<NDArray> out_arrays;
+  std::vector<TShape> out_shapes;
+};
+
+// executors of a predictor and of the predictors reshaped from it, by input shapes
+struct MXAPIPredictorCache {
+  // maximum number of executors kept
+  size_t capacity;
+  // batch sizes the inputs are padded to, empty to not pad
+  std::vector<mx_uint> buckets;
+  std::mutex mutex;
+  // most recently used first
+  std::list<std::pair<std::string, MXAPIPredictorExec> > entries;
+
+  MXAPIPredictorCache()
+      : capacity(dmlc::GetEnv("MXNET_PREDICT_EXEC_CACHE_SIZE", 8)) {
+    std::istringstream is(dmlc::GetEnv("MXNET_PREDICT_BATCH_BUCKETS", std::string()));
+    std::string bucket;
+    while (std::getline(is, bucket, ',')) {
+      if (bucket.empty()) continue;
+      const int size = std::stoi(bucket);
+      CHECK_GT(size, 0) << "Invalid batch size bucket " << bucket;
+      buckets.push_back(size);
+    }
+    std::sort(buckets.begin(), buckets.end());
+  }
+
+  bool Get(const std::string& key, MXAPIPredictorExec* out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (it->first != key) continue;
+      entries.splice(entries.begin(), entries, it);
+      *out = it->second;
+      return true;
+    }
+    return false;
+  }
+
+  void Put(const std::string& key, const MXAPIPredictorExec& exec) {
+    if (capacity == 0) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.emplace_front(key, exec);
+    while (entries.size() > capacity) entries.pop_back();
+  }
+};
+
 // predictor interface
 struct MXAPIPredictor {
   // output arrays
@@ -52,11 +109,36 @@ struct MXAPIPredictor {
   // key to arguments
   std::unordered_map<std::string, size_t> key2arg;
   // executor
-  std::unique_ptr<Executor> exec;
+  std::shared_ptr<Executor> exec;
   // symbol
   nnvm::Symbol sym;
   // Context
   Context ctx;
+  // executors shared with the predictors reshaped from this one
+  std::shared_ptr<MXAPIPredictorCache> cache;
+  // batch size of the inputs, and the one they are padded to
+  mx_uint batch_size{0}, padded_batch_size{0};
+  // names of the arguments set by MXPredSetInput, the others are parameters
+  std::unordered_set<std::string> input_names;
+  // key of the input shapes in the cache
+  std::string shape_key;
+  // user buffers bound to the inputs copied by MXPredForward, by argument index
+  std::vector<std::pair<size_t, NDArray> > bound_inputs;
+  // user buffers bound to outputs, by output index
+  std::vector<std::pair<size_t, NDArray> > bound_outputs;
+
+  void SetExec(const MXAPIPredictorExec& bound) {
+    exec = bound.exec;
+    arg_arrays = bound.arg_arrays;
+    aux_arrays = bound.aux_arrays;
+    out_arrays = bound.out_arrays;
+    out_shapes = bound.out_shapes;
+  }
+  // whether axis 0 of an input or output of this shape holds the padded batch
+  bool Padded(const TShape& shape) const {
+    return padded_batch_size != batch_size && shape.ndim() != 0 &&
+           shape[0] == padded_batch_size;
+  }
 };
 
 struct MXAPINDList {
@@ -90,9 +172,37 @@ int MXPredCreate(const char* symbol_json_str,
       NULL,
       out);
 }
-namespace mxnet {
+namespace {
+// cache key of a set of input shapes
+std::string ShapeKey(const std::unordered_map<std::string, TShape>& shapes) {
+  std::map<std::string, TShape> sorted(shapes.begin(), shapes.end());
+  std::ostringstream os;
+  for (const auto& kv : sorted) os << kv.first << kv.second << ';';
+  return os.str();
+}
 
-}  // namespace mxnet
+// pad axis 0 of the input shapes to the next bucket, return the batch size before padding
+mx_uint PadBatch(const std::vector<mx_uint>& buckets,
+                 std::unordered_map<std::string, TShape>* shapes,
+                 mx_uint* padded_batch_size) {
+  mx_uint batch_size = 0;
+  for (const auto& kv : *shapes) {
+    if (kv.second.ndim() == 0) continue;
+    if (batch_size == 0) batch_size = kv.second[0];
+    CHECK(buckets.empty() || kv.second[0] == batch_size)
+      << "Inputs must have the same batch size to be padded to a bucket, but "
+      << kv.first << " has shape " << kv.second;
+  }
+  *padded_batch_size = batch_size;
+  auto bucket = std::lower_bound(buckets.begin(), buckets.end(), batch_size);
+  if (bucket == buckets.end()) return batch_size;
+  *padded_batch_size = *bucket;
+  for (auto& kv : *shapes) {
+    if (kv.second.ndim() != 0) kv.second[0] = *bucket;
+  }
+  return batch_size;
+}
+}  // namespace
 
 int MXPredCreatePartialOut(const char* symbol_json_str,
                            const void* param_bytes,
@@ -155,8 +265,8 @@ int MXPredCreatePartialOut(const char* symbol_json_str,
     }
     std::vector<NDArray> data;
     std::vector<std::string> names;
-    dmlc::MemoryFixedSizeStream fi((void*)param_bytes, param_size);  // NOLINT(*)
-    NDArray::Load(&fi, &data, &names);
+    // dense arrays read param_bytes until they are copied to the executor below
+    NDArray::LoadFromBuffer(param_bytes, param_size, &data, &names);
     CHECK_EQ(names.size(), data.size())
         << "Invalid param file format";
     for (size_t i = 0; i < names.size(); ++i) {
@@ -175,6 +285,37 @@ int MXPredCreatePartialOut(const char* symbol_json_str,
     }
   }
 
+  if (dmlc::GetEnv("MXNET_PREDICT_FOLD_BATCHNORM", true)) {
+    nnvm::Graph g; g.outputs = sym.outputs;
+    sym.outputs = mxnet::exec::FoldBatchNorm(std::move(g), &arg_params, aux_params).outputs;
+  }
+  if (dmlc::GetEnv("MXNET_PREDICT_FOLD_CONSTANTS", true)) {
+    std::unordered_set<std::string> inputs(input_keys, input_keys + num_input_nodes);
+    nnvm::Graph g; g.outputs = sym.outputs;
+    sym.outputs = mxnet::exec::FoldConstants(std::move(g), &arg_params, inputs).outputs;
+  }
+  // the parameters computed in float16 are converted on the host before they are copied
+  std::unordered_map<std::string, int> arg_dtypes;
+  if (dev_type == Context::kGPU && dmlc::GetEnv("MXNET_PREDICT_FP16", false)) {
+    std::unordered_set<std::string> inputs(input_keys, input_keys + num_input_nodes);
+    for (const auto& kv : arg_params) {
+      arg_dtypes[kv.first] = kv.second.dtype();
+      if (kv.second.storage_type() != kDefaultStorage) inputs.insert(kv.first);
+    }
+    for (const auto& kv : aux_params) arg_dtypes[kv.first] = kv.second.dtype();
+    for (mx_uint i = 0; i < num_input_nodes; ++i) arg_dtypes[input_keys[i]] = mshadow::kFloat32;
+    nnvm::Graph g; g.outputs = sym.outputs;
+    sym.outputs = mxnet::exec::ConvertFP16(std::move(g), &arg_dtypes, inputs).outputs;
+    for (auto& kv : arg_params) {
+      if (arg_dtypes.at(kv.first) != mshadow::kFloat16 || kv.second.dtype() == mshadow::kFloat16) {
+        continue;
+      }
+      NDArray half(kv.second.shape(), Context::CPU(), false, mshadow::kFloat16);
+      CopyFromTo(kv.second, &half);
+      kv.second = half;
+    }
+  }
+
   // shape inference and bind
   std::unordered_map<std::string, TShape> known_shape;
   for (mx_uint i = 0; i < num_input_nodes; ++i) {
@@ -182,6 +323,10 @@ int MXPredCreatePartialOut(const char* symbol_json_str,
         TShape(input_shape_data + input_shape_indptr[i],
                input_shape_data + input_shape_indptr[i + 1]);
   }
+  ret->cache = std::make_shared<MXAPIPredictorCache>();
+  ret->batch_size = PadBatch(ret->cache->buckets, &known_shape, &ret->padded_batch_size);
+  for (const auto& kv : known_shape) ret->input_names.insert(kv.first);
+  ret->shape_key = ShapeKey(known_shape);
   std::vector<std::string> arg_names = sym.ListInputNames(Symbol::kReadOnlyArgs);
   std::vector<std::string> aux_names = sym.ListInputNames(Symbol::kAuxiliaryStates);
   std::vector<TShape> out_shapes(sym.ListOutputNames().size());
@@ -216,21 +361,30 @@ int MXPredCreatePartialOut(const char* symbol_json_str,
   Context ctx = Context::Create(static_cast<Context::DeviceType>(dev_type), dev_id);
 
   std::vector<NDArray> arg_arrays, aux_arrays;
+  std::vector<NDArray> param_src, param_dst;
   for (size_t i = 0; i < arg_shapes.size(); ++i) {
-    NDArray nd = NDArray(arg_shapes[i], ctx);
+    auto dtype = arg_dtypes.find(arg_names[i]);
+    NDArray nd = NDArray(arg_shapes[i], ctx, false,
+                         dtype != arg_dtypes.end() ? dtype->second : mshadow::default_type_flag);
     if (arg_params.count(arg_names[i]) != 0) {
-      CopyFromTo(arg_params[arg_names[i]], &nd);
+      param_src.push_back(arg_params[arg_names[i]]);
+      param_dst.push_back(nd);
     }
     arg_arrays.push_back(nd);
   }
   for (size_t i = 0; i < aux_shapes.size(); ++i) {
     NDArray nd = NDArray(aux_shapes[i], ctx);
     if (aux_params.count(aux_names[i]) != 0) {
-      CopyFromTo(aux_params[aux_names[i]], &nd);
+      param_src.push_back(aux_params[aux_names[i]]);
+      param_dst.push_back(nd);
     }
     aux_arrays.push_back(nd);
   }
+  LoadParams(param_src, param_dst);
   ret->arg_arrays = arg_arrays;
+  ret->aux_arrays = aux_arrays;
+  ret->sym = sym;
+  ret->ctx = ctx;
   // bind
   {
     std::map<std::string, Context> ctx_map;
@@ -245,6 +399,8 @@ int MXPredCreatePartialOut(const char* symbol_json_str,
     ret->out_shapes = out_shapes;
     ret->out_arrays = ret->exec->outputs();
   }
+  ret->cache->Put(ret->shape_key, MXAPIPredictorExec{
+      ret->exec, ret->arg_arrays, ret->aux_arrays, ret->out_arrays, ret->out_shapes});
   *out = ret;
   API_END_HANDLE_ERROR(delete ret);
 }
@@ -267,12 +423,25 @@ int MXPredReshape(mx_uint num_input_nodes,
             input_shape_data + input_shape_indptr[i + 1]);
   }
   ret->sym = p->sym;
+  ret->ctx = p->ctx;
+  ret->key2arg = p->key2arg;
+  ret->cache = p->cache;
+  ret->batch_size = PadBatch(ret->cache->buckets, &new_shape, &ret->padded_batch_size);
+  ret->input_names = p->input_names;
+  for (const auto& kv : new_shape) ret->input_names.insert(kv.first);
+  ret->shape_key = ShapeKey(new_shape);
+  MXAPIPredictorExec bound;
+  if (ret->cache->Get(ret->shape_key, &bound)) {
+    ret->SetExec(bound);
+    *out = ret.release();
+    return 0;
+  }
+
   std::vector<std::string> arg_names = ret->sym.ListInputNames(Symbol::kReadOnlyArgs);
   std::vector<std::string> aux_names = ret->sym.ListInputNames(Symbol::kAuxiliaryStates);
   std::vector<TShape> out_shapes(ret->sym.ListOutputNames().size());
   std::vector<TShape> aux_shapes(aux_names.size());
   std::vector<TShape> arg_shapes;
-  ret->key2arg = p->key2arg;
 
   try {
     std::vector<TShape> in_shapes;
@@ -296,20 +465,20 @@ int MXPredReshape(mx_uint num_input_nodes,
     throw dmlc::Error(err.msg);
   }
 
-  ret->arg_arrays = p->arg_arrays;
-  ret->ctx = p->ctx;
+  // inputs get arrays of their own, so the executors in the cache stay usable,
+  // parameters are shared
+  bound.arg_arrays = p->arg_arrays;
   for (size_t i=0; i < arg_names.size(); ++i) {
     TShape newShape = arg_shapes[i];
     NDArray &arr = p->arg_arrays[i];
     if (new_shape.count(arg_names[i]) != 0) {
-      ret->arg_arrays[i].ReshapeAndAlloc(newShape);
+      bound.arg_arrays[i] = NDArray(newShape, ret->ctx, false, arr.dtype());
     } else {
        CHECK_EQ(newShape.Size(), arr.shape().Size())
         << "arg " << arg_names[i]
         << " shape has been changed, only allow to change the shape of input data.";
     }
   }
-  p->arg_arrays.clear();
 
   for (size_t i=0; i < aux_names.size(); ++i) {
     TShape newShape = aux_shapes[i];
@@ -318,28 +487,77 @@ int MXPredReshape(mx_uint num_input_nodes,
       << "aux " << aux_names[i]
       << " shape has been changed, only allow to change the shape of input data.";
   }
-  ret->aux_arrays = p->aux_arrays;
-  p->aux_arrays.clear();
+  bound.aux_arrays = p->aux_arrays;
 
   // bind
   {
     std::map<std::string, Context> ctx_map;
     std::vector<NDArray> grad_store;
-    grad_store.reserve(ret->arg_arrays.size());
-    std::vector<OpReqType> grad_req(ret->arg_arrays.size(), kNullOp);
+    grad_store.reserve(bound.arg_arrays.size());
+    std::vector<OpReqType> grad_req(bound.arg_arrays.size(), kNullOp);
+
+    bound.exec.reset(Executor::Bind(ret->sym, ret->ctx, ctx_map,
+                                    bound.arg_arrays,
+                                    grad_store, grad_req,
+                                    bound.aux_arrays,
+                                    p->exec.get()));
+    bound.out_shapes = out_shapes;
+    bound.out_arrays = bound.exec->outputs();
+  }
+  ret->cache->Put(ret->shape_key, bound);
+  ret->SetExec(bound);
+  *out = ret.release();
+  API_END();
+}
 
-    ret->exec.reset(Executor::Bind(ret->sym, ret->ctx, ctx_map,
-                                   ret->arg_arrays,
-                                   grad_store, grad_req,
-                                   ret->aux_arrays,
-                                   p->exec.get()));
-    ret->out_shapes = out_shapes;
-    ret->out_arrays = ret->exec->outputs();
+int MXPredCreateShared(PredictorHandle handle, PredictorHandle* out) {
+  MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
+  std::unique_ptr<MXAPIPredictor> ret(new MXAPIPredictor());
+  API_BEGIN();
+  ret->sym = p->sym;
+  ret->ctx = p->ctx;
+  ret->key2arg = p->key2arg;
+  ret->batch_size = p->batch_size;
+  ret->padded_batch_size = p->padded_batch_size;
+  ret->input_names = p->input_names;
+  ret->shape_key = p->shape_key;
+  // executors in the cache write to their inputs, so the new predictor gets its own
+  ret->cache = std::make_shared<MXAPIPredictorCache>();
+
+  std::vector<std::string> arg_names = p->sym.ListInputNames(nnvm::Symbol::kReadOnlyArgs);
+  MXAPIPredictorExec bound;
+  bound.arg_arrays = p->arg_arrays;
+  for (size_t i = 0; i < arg_names.size(); ++i) {
+    if (ret->input_names.count(arg_names[i]) == 0) continue;
+    const NDArray& arr = p->arg_arrays[i];
+    bound.arg_arrays[i] = NDArray(arr.shape(), ret->ctx, false, arr.dtype());
   }
+  bound.aux_arrays = p->aux_arrays;
+  {
+    std::map<std::string, Context> ctx_map;
+    std::vector<NDArray> grad_store(bound.arg_arrays.size());
+    std::vector<OpReqType> grad_req(bound.arg_arrays.size(), kNullOp);
+    bound.exec.reset(Executor::Bind(ret->sym, ret->ctx, ctx_map,
+                                    bound.arg_arrays,
+                                    grad_store, grad_req,
+                                    bound.aux_arrays));
+    bound.out_shapes = p->out_shapes;
+    bound.out_arrays = bound.exec->outputs();
+  }
+  ret->cache->Put(ret->shape_key, bound);
+  ret->SetExec(bound);
   *out = ret.release();
   API_END();
 }
 
+int MXPredGetNumOutputs(PredictorHandle handle,
+                        mx_uint* num_outputs) {
+  MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
+  API_BEGIN();
+  *num_outputs = static_cast<mx_uint>(p->out_arrays.size());
+  API_END();
+}
+
 int MXPredGetOutputShape(PredictorHandle handle,
                          mx_uint out_index,
                          mx_uint** shape_data,
@@ -349,11 +567,12 @@ int MXPredGetOutputShape(PredictorHandle handle,
   CHECK_LT(out_index, p->out_arrays.size())
       << "Index exceed number of outputs";
 
-  const TShape& s = p->out_shapes[out_index];
+  TShape s = p->out_shapes[out_index];
+  if (p->Padded(s)) s[0] = p->batch_size;
   p->out_shapes_buffer.resize(s.ndim());
   nnvm::ShapeTypeCast(s.begin(), s.end(), p->out_shapes_buffer.data());
   *shape_data = p->out_shapes_buffer.data();
-  *shape_ndim = p->out_shapes[out_index].ndim();
+  *shape_ndim = s.ndim();
   API_END();
 }
 
@@ -368,14 +587,94 @@ int MXPredSetInput(PredictorHandle handle,
     LOG(FATAL) << "cannot find input key " << key;
   }
   NDArray& nd = p->arg_arrays[it->second];
-  nd.SyncCopyFromCPU(data, size);
+  if (p->Padded(nd.shape()) && size < nd.shape().Size()) {
+    // the rows past the batch size are only padding
+    nd.Slice(0, p->batch_size).SyncCopyFromCPU(data, size);
+  } else {
+    nd.SyncCopyFromCPU(data, size);
+  }
+  API_END();
+}
+
+// array over a user buffer, of the shape of nd without the padding
+static NDArray BoundArray(const MXAPIPredictor* p, const NDArray& nd,
+                          mx_float* data, mx_uint size) {
+  CHECK_EQ(nd.dtype(), mshadow::kFloat32) << "Only float32 arrays can be bound";
+  TShape shape = nd.shape();
+  if (p->Padded(shape)) shape[0] = p->batch_size;
+  CHECK_EQ(size, shape.Size()) << "Bound buffer size does not match shape " << shape;
+  return NDArray(TBlob(data, shape, cpu::kDevMask, 0), 0);
+}
+
+int MXPredBindInput(PredictorHandle handle,
+                    const char* key,
+                    mx_float* data,
+                    mx_uint size) {
+  MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
+  API_BEGIN();
+  auto it = p->key2arg.find(key);
+  if (it == p->key2arg.end()) {
+    LOG(FATAL) << "cannot find input key " << key;
+  }
+  const size_t index = it->second;
+  NDArray bound = BoundArray(p, p->arg_arrays[index], data, size);
+  for (auto i = p->bound_inputs.begin(); i != p->bound_inputs.end(); ++i) {
+    if (i->first == index) {
+      p->bound_inputs.erase(i);
+      break;
+    }
+  }
+  if (p->ctx.dev_mask() != cpu::kDevMask || p->Padded(p->arg_arrays[index].shape())) {
+    p->bound_inputs.emplace_back(index, bound);
+  } else {
+    // rebind the executor on the buffer, sharing the memory of the current one
+    p->arg_arrays[index] = bound;
+    std::map<std::string, Context> ctx_map;
+    std::vector<NDArray> grad_store(p->arg_arrays.size());
+    std::vector<OpReqType> grad_req(p->arg_arrays.size(), kNullOp);
+    p->exec.reset(Executor::Bind(p->sym, p->ctx, ctx_map,
+                                 p->arg_arrays,
+                                 grad_store, grad_req,
+                                 p->aux_arrays,
+                                 p->exec.get()));
+    p->out_arrays = p->exec->outputs();
+  }
+  API_END();
+}
+
+int MXPredBindOutput(PredictorHandle handle,
+                     mx_uint index,
+                     mx_float* data,
+                     mx_uint size) {
+  MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
+  API_BEGIN();
+  CHECK_LT(index, p->out_arrays.size())
+      << "Output index out of range";
+  NDArray bound = BoundArray(p, p->out_arrays[index], data, size);
+  for (auto i = p->bound_outputs.begin(); i != p->bound_outputs.end(); ++i) {
+    if (i->first == index) {
+      p->bound_outputs.erase(i);
+      break;
+    }
+  }
+  p->bound_outputs.emplace_back(index, bound);
   API_END();
 }
 
 int MXPredForward(PredictorHandle handle) {
   MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
   API_BEGIN();
+  // the copies are scheduled with the forward pass, so they overlap with the other work
+  for (const auto& kv : p->bound_inputs) {
+    const NDArray& nd = p->arg_arrays[kv.first];
+    CopyFromTo(kv.second, p->Padded(nd.shape()) ? nd.Slice(0, p->batch_size) : nd);
+  }
   p->exec->Forward(false);
+  for (const auto& kv : p->bound_outputs) {
+    const NDArray& nd = p->out_arrays[kv.first];
+    CopyFromTo(p->Padded(nd.shape()) ? nd.Slice(0, p->batch_size) : nd, kv.second);
+  }
+  for (const auto& kv : p->bound_outputs) kv.second.WaitToRead();
   API_END();
 }
 
@@ -395,7 +694,11 @@ int MXPredGetOutput(PredictorHandle handle,
   CHECK_LT(index, p->out_arrays.size())
       << "Output index out of range";
   const NDArray& nd = p->out_arrays[index];
-  nd.SyncCopyToCPU(data, size);
+  if (p->Padded(nd.shape())) {
+    nd.Slice(0, p->batch_size).SyncCopyToCPU(data, size);
+  } else {
+    nd.SyncCopyToCPU(data, size);
+  }
   API_END();
 }
 
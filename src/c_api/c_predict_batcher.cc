@@ -0,0 +1,259 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file c_predict_batcher.cc
+ * \brief batching of single sample requests on top of the C predict API
+ */
+#include <dmlc/logging.h>
+#include <mxnet/c_predict_api.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "./c_api_common.h"
+
+namespace {
+/*!
+ * \brief Coalesces requests of many threads into batches.
+ *
+ *  A worker thread waits for the first request, then for more until either
+ *  max_batch_size requests are queued or the first one has waited max_delay.
+ *  The batch runs through a predictor reshaped to its size, kept for the next
+ *  batch of that size, and the outputs are copied back to every request.
+ */
+class PredictBatcher {
+ public:
+  PredictBatcher(PredictorHandle base, mx_uint num_input_nodes, const char** input_keys,
+                 const mx_uint* input_shape_indptr, const mx_uint* input_shape_data,
+                 mx_uint max_batch_size, mx_uint max_delay_us)
+      : base_(base), max_batch_size_(max_batch_size),
+        max_delay_(std::chrono::microseconds(max_delay_us)) {
+    CHECK_GT(num_input_nodes, 0U) << "The batcher needs at least one input";
+    CHECK_GT(max_batch_size, 0U) << "max_batch_size must be positive";
+    for (mx_uint i = 0; i < num_input_nodes; ++i) {
+      Input input;
+      input.key = input_keys[i];
+      input.shape.assign(input_shape_data + input_shape_indptr[i],
+                         input_shape_data + input_shape_indptr[i + 1]);
+      input.size = 1;
+      for (mx_uint d : input.shape) input.size *= d;
+      inputs_.push_back(input);
+    }
+    // the output sizes of one sample, taken from a predictor of batch size 1
+    PredictorHandle pred = Predictor(1);
+    mx_uint num_outputs;
+    CHECK_EQ(MXPredGetNumOutputs(pred, &num_outputs), 0) << MXGetLastError();
+    for (mx_uint index = 0; index < num_outputs; ++index) {
+      mx_uint* shape_data;
+      mx_uint shape_ndim;
+      CHECK_EQ(MXPredGetOutputShape(pred, index, &shape_data, &shape_ndim), 0)
+        << MXGetLastError();
+      size_t size = 1;
+      for (mx_uint d = 1; d < shape_ndim; ++d) size *= shape_data[d];
+      CHECK(shape_ndim > 0 && shape_data[0] == 1)
+        << "Output " << index << " does not have the batch along axis 0";
+      output_sizes_.push_back(size);
+    }
+    worker_ = std::thread([this]() { Run(); });
+  }
+
+  ~PredictBatcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+    for (auto& kv : predictors_) MXPredFree(kv.second);
+  }
+
+  size_t num_outputs() const {
+    return output_sizes_.size();
+  }
+
+  size_t output_size(size_t index) const {
+    CHECK_LT(index, output_sizes_.size()) << "Output index out of range";
+    return output_sizes_[index];
+  }
+
+  /*! \brief queue one sample and wait for its outputs */
+  void Predict(const mx_float** inputs, mx_float** outputs) {
+    Request req;
+    req.inputs = inputs;
+    req.outputs = outputs;
+    req.arrival = Clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    CHECK(!stop_) << "The batcher is being destroyed";
+    queue_.push_back(&req);
+    cv_.notify_all();
+    req.done_cv.wait(lock, [&req]() { return req.done; });
+    if (!req.error.empty()) LOG(FATAL) << req.error;
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Input {
+    std::string key;
+    std::vector<mx_uint> shape;
+    size_t size;
+  };
+
+  struct Request {
+    const mx_float** inputs;
+    mx_float** outputs;
+    Clock::time_point arrival;
+    bool done{false};
+    std::string error;
+    std::condition_variable done_cv;
+  };
+
+  /*! \brief predictor for a batch size, reshaped from the base one on first use */
+  PredictorHandle Predictor(mx_uint batch_size) {
+    auto it = predictors_.find(batch_size);
+    if (it != predictors_.end()) return it->second;
+    std::vector<const char*> keys;
+    std::vector<mx_uint> indptr(1, 0), shapes;
+    for (const Input& input : inputs_) {
+      keys.push_back(input.key.c_str());
+      shapes.push_back(batch_size);
+      shapes.insert(shapes.end(), input.shape.begin(), input.shape.end());
+      indptr.push_back(shapes.size());
+    }
+    PredictorHandle pred;
+    CHECK_EQ(MXPredReshape(keys.size(), keys.data(), indptr.data(), shapes.data(),
+                           base_, &pred), 0) << MXGetLastError();
+    predictors_[batch_size] = pred;
+    return pred;
+  }
+
+  /*! \brief run one batch, and return the error message if it failed */
+  std::string RunBatch(const std::vector<Request*>& batch) {
+    const mx_uint n = batch.size();
+    try {
+      PredictorHandle pred = Predictor(n);
+      for (size_t k = 0; k < inputs_.size(); ++k) {
+        const size_t size = inputs_[k].size;
+        buffer_.resize(n * size);
+        for (mx_uint i = 0; i < n; ++i) {
+          std::memcpy(&buffer_[i * size], batch[i]->inputs[k], size * sizeof(mx_float));
+        }
+        CHECK_EQ(MXPredSetInput(pred, inputs_[k].key.c_str(), buffer_.data(), buffer_.size()), 0)
+          << MXGetLastError();
+      }
+      CHECK_EQ(MXPredForward(pred), 0) << MXGetLastError();
+      for (size_t k = 0; k < output_sizes_.size(); ++k) {
+        const size_t size = output_sizes_[k];
+        buffer_.resize(n * size);
+        CHECK_EQ(MXPredGetOutput(pred, k, buffer_.data(), buffer_.size()), 0)
+          << MXGetLastError();
+        for (mx_uint i = 0; i < n; ++i) {
+          std::memcpy(batch[i]->outputs[k], &buffer_[i * size], size * sizeof(mx_float));
+        }
+      }
+    } catch (const dmlc::Error& e) {
+      return e.what();
+    }
+    return std::string();
+  }
+
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) return;
+      const Clock::time_point deadline = queue_.front()->arrival + max_delay_;
+      cv_.wait_until(lock, deadline, [this]() {
+          return stop_ || queue_.size() >= max_batch_size_;
+        });
+      const size_t n = std::min<size_t>(queue_.size(), max_batch_size_);
+      std::vector<Request*> batch(queue_.begin(), queue_.begin() + n);
+      queue_.erase(queue_.begin(), queue_.begin() + n);
+      // requests keep queueing while the batch runs
+      lock.unlock();
+      const std::string error = RunBatch(batch);
+      lock.lock();
+      for (Request* req : batch) {
+        req->error = error;
+        req->done = true;
+        req->done_cv.notify_one();
+      }
+    }
+  }
+
+  PredictorHandle base_;
+  size_t max_batch_size_;
+  Clock::duration max_delay_;
+  std::vector<Input> inputs_;
+  std::vector<size_t> output_sizes_;
+  /*! \brief predictors by batch size, only used by the worker after construction */
+  std::unordered_map<mx_uint, PredictorHandle> predictors_;
+  /*! \brief staging of the batched inputs and outputs */
+  std::vector<mx_float> buffer_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Request*> queue_;
+  bool stop_{false};
+  std::thread worker_;
+};
+}  // namespace
+
+int MXPredBatcherCreate(PredictorHandle handle,
+                        mx_uint num_input_nodes,
+                        const char** input_keys,
+                        const mx_uint* input_shape_indptr,
+                        const mx_uint* input_shape_data,
+                        mx_uint max_batch_size,
+                        mx_uint max_delay_us,
+                        PredBatcherHandle* out) {
+  API_BEGIN();
+  *out = new PredictBatcher(handle, num_input_nodes, input_keys, input_shape_indptr,
+                            input_shape_data, max_batch_size, max_delay_us);
+  API_END();
+}
+
+int MXPredBatcherGetOutputSize(PredBatcherHandle handle,
+                               mx_uint index,
+                               mx_uint* out_size) {
+  API_BEGIN();
+  *out_size = static_cast<PredictBatcher*>(handle)->output_size(index);
+  API_END();
+}
+
+int MXPredBatcherPredict(PredBatcherHandle handle,
+                         const mx_float** inputs,
+                         mx_float** outputs) {
+  API_BEGIN();
+  static_cast<PredictBatcher*>(handle)->Predict(inputs, outputs);
+  API_END();
+}
+
+int MXPredBatcherFree(PredBatcherHandle handle) {
+  API_BEGIN();
+  delete static_cast<PredictBatcher*>(handle);
+  API_END();
+}
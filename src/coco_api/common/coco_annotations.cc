@@ -0,0 +1,313 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file coco_annotations.cc
+ * \brief load the instance annotations of a COCO json file into flat arrays
+ */
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <dmlc/omp.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include "./coco_annotations.h"
+#include "./gason.h"
+#include "../../engine/openmp.h"
+
+namespace mxnet {
+namespace coco {
+
+namespace {
+
+/*! \brief byte range of one json value in the file buffer */
+typedef std::pair<char*, char*> Range;
+
+/*! \brief annotations of one chunk, with category ids not mapped to classes yet */
+struct Chunk {
+  std::vector<int64_t> image_ids;
+  std::vector<int> category_ids;
+  std::vector<uint8_t> iscrowd;
+  std::vector<float> bboxes;
+  std::vector<size_t> num_polys;
+  std::vector<size_t> poly_lens;
+  std::vector<float> coords;
+};
+
+inline char *SkipSpace(char *p, char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+  return p;
+}
+
+/*! \brief return the position past the closing quote of the string opened at p */
+inline char *SkipString(char *p, char *end) {
+  for (++p; p < end; ++p) {
+    if (*p == '\\') {
+      ++p;
+    } else if (*p == '"') {
+      return p + 1;
+    }
+  }
+  LOG(FATAL) << "Unterminated json string";
+  return end;
+}
+
+/*! \brief return the position past the object or array opened at p */
+inline char *SkipValue(char *p, char *end) {
+  CHECK(*p == '{' || *p == '[') << "Expect a json object or array";
+  int depth = 0;
+  while (p < end) {
+    const char c = *p;
+    if (c == '"') {
+      p = SkipString(p, end);
+      continue;
+    }
+    if (c == '{' || c == '[') ++depth;
+    if ((c == '}' || c == ']') && --depth == 0) return p + 1;
+    ++p;
+  }
+  LOG(FATAL) << "Unterminated json value";
+  return end;
+}
+
+/*!
+ * \brief ranges of the elements of the array under the top level key of a json
+ *  object, found by a scan that only tracks strings and nesting.
+ */
+std::vector<Range> FindArray(char *begin, char *end, const char *key) {
+  std::vector<Range> elems;
+  const size_t key_len = std::strlen(key);
+  char *p = SkipSpace(begin, end);
+  CHECK(p < end && *p == '{') << "Expect a json object at the top level";
+  ++p;
+  while (true) {
+    p = SkipSpace(p, end);
+    if (p >= end || *p == '}') return elems;
+    if (*p == ',') {
+      ++p;
+      continue;
+    }
+    CHECK_EQ(*p, '"') << "Expect a key in the top level object";
+    char *name = p + 1;
+    p = SkipString(p, end);
+    const bool match = static_cast<size_t>(p - 1 - name) == key_len &&
+                       std::strncmp(name, key, key_len) == 0;
+    p = SkipSpace(p, end);
+    CHECK(p < end && *p == ':') << "Expect ':' after a key";
+    p = SkipSpace(p + 1, end);
+    if (!match) {
+      if (*p == '{' || *p == '[') {
+        p = SkipValue(p, end);
+      } else if (*p == '"') {
+        p = SkipString(p, end);
+      } else {
+        while (p < end && *p != ',' && *p != '}') ++p;
+      }
+      continue;
+    }
+    CHECK(*p == '[') << "Expect an array under \"" << key << "\"";
+    for (++p; ; ) {
+      p = SkipSpace(p, end);
+      CHECK(p < end) << "Unterminated array \"" << key << "\"";
+      if (*p == ']') return elems;
+      if (*p == ',') {
+        ++p;
+        continue;
+      }
+      char *elem_end = SkipValue(p, end);
+      elems.emplace_back(p, elem_end);
+      p = elem_end;
+    }
+  }
+}
+
+inline JsonValue Parse(const Range &range, JsonAllocator *allocator) {
+  char *endptr;
+  JsonValue value;
+  const int status = jsonParse(range.first, &endptr, &value, *allocator);
+  CHECK_EQ(status, JSON_OK) << "Json parse error: " << jsonStrError(status);
+  return value;
+}
+
+/*! \brief append one annotation object to a chunk */
+void AddAnnotation(JsonValue ann, Chunk *chunk) {
+  CHECK_EQ(ann.getTag(), JSON_OBJECT) << "Expect annotation objects";
+  int64_t image_id = -1;
+  int category_id = -1;
+  uint8_t iscrowd = 0;
+  float bbox[4] = {0, 0, 0, 0};
+  size_t num_polys = 0;
+  for (auto field : ann) {
+    if (!std::strcmp(field->key, "image_id")) {
+      image_id = static_cast<int64_t>(field->value.toNumber());
+    } else if (!std::strcmp(field->key, "category_id")) {
+      category_id = static_cast<int>(field->value.toNumber());
+    } else if (!std::strcmp(field->key, "iscrowd")) {
+      iscrowd = field->value.toNumber() != 0;
+    } else if (!std::strcmp(field->key, "bbox")) {
+      int k = 0;
+      for (auto v : field->value) {
+        CHECK_LT(k, 4) << "bbox should have 4 values";
+        bbox[k++] = static_cast<float>(v->value.toNumber());
+      }
+    } else if (!std::strcmp(field->key, "segmentation") &&
+               field->value.getTag() == JSON_ARRAY) {
+      // polygons, a crowd region is a run length encoded object instead
+      for (auto poly : field->value) {
+        size_t len = 0;
+        for (auto v : poly->value) {
+          chunk->coords.push_back(static_cast<float>(v->value.toNumber()));
+          ++len;
+        }
+        chunk->poly_lens.push_back(len);
+        ++num_polys;
+      }
+    }
+  }
+  CHECK_NE(image_id, -1) << "Annotation without image_id";
+  chunk->image_ids.push_back(image_id);
+  chunk->category_ids.push_back(category_id);
+  chunk->iscrowd.push_back(iscrowd);
+  chunk->bboxes.insert(chunk->bboxes.end(), bbox, bbox + 4);
+  chunk->num_polys.push_back(num_polys);
+}
+
+}  // namespace
+
+Annotations LoadAnnotations(const std::string &path, int num_threads) {
+  std::vector<char> buf;
+  {
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(path.c_str(), "r"));
+    const size_t kBlock = 1 << 22;
+    size_t size = 0;
+    while (true) {
+      buf.resize(size + kBlock);
+      const size_t nread = fi->Read(buf.data() + size, kBlock);
+      size += nread;
+      if (nread == 0) break;
+    }
+    buf.resize(size + 1);
+    buf[size] = '\0';
+  }
+  char *begin = buf.data();
+  char *end = begin + buf.size() - 1;
+  // both ranges are found before any in place parsing rewrites the buffer
+  const std::vector<Range> categories = FindArray(begin, end, "categories");
+  const std::vector<Range> elems = FindArray(begin, end, "annotations");
+
+  std::vector<int> category_ids;
+  {
+    JsonAllocator allocator;
+    for (const Range &range : categories) {
+      for (auto field : Parse(range, &allocator)) {
+        if (!std::strcmp(field->key, "id")) {
+          category_ids.push_back(static_cast<int>(field->value.toNumber()));
+        }
+      }
+    }
+  }
+  std::sort(category_ids.begin(), category_ids.end());
+  std::unordered_map<int, int> class_of;
+  for (size_t i = 0; i < category_ids.size(); ++i) {
+    class_of[category_ids[i]] = static_cast<int>(i) + 1;
+  }
+
+  if (num_threads <= 0) {
+    num_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  }
+  const size_t num_chunks = std::max<size_t>(
+      1, std::min<size_t>(elems.size() / 1024 + 1, 4 * num_threads));
+  std::vector<Chunk> chunks(num_chunks);
+  #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+  for (int c = 0; c < static_cast<int>(num_chunks); ++c) {
+    const size_t first = elems.size() * c / num_chunks;
+    const size_t last = elems.size() * (c + 1) / num_chunks;
+    JsonAllocator allocator;
+    for (size_t i = first; i < last; ++i) {
+      AddAnnotation(Parse(elems[i], &allocator), &chunks[c]);
+      allocator.deallocate();
+    }
+  }
+
+  Annotations anns;
+  anns.ann_offsets.push_back(0);
+  anns.poly_offsets.push_back(0);
+  for (Chunk &chunk : chunks) {
+    for (size_t i = 0; i < chunk.image_ids.size(); ++i) {
+      auto it = class_of.find(chunk.category_ids[i]);
+      CHECK(it != class_of.end()) << "Unknown category_id " << chunk.category_ids[i];
+      anns.image_annotations[chunk.image_ids[i]].push_back(anns.image_ids.size());
+      anns.image_ids.push_back(chunk.image_ids[i]);
+      anns.classes.push_back(it->second);
+      anns.ann_offsets.push_back(anns.ann_offsets.back() + chunk.num_polys[i]);
+    }
+    for (size_t len : chunk.poly_lens) {
+      anns.poly_offsets.push_back(anns.poly_offsets.back() + len);
+    }
+    anns.iscrowd.insert(anns.iscrowd.end(), chunk.iscrowd.begin(), chunk.iscrowd.end());
+    anns.bboxes.insert(anns.bboxes.end(), chunk.bboxes.begin(), chunk.bboxes.end());
+    anns.coords.insert(anns.coords.end(), chunk.coords.begin(), chunk.coords.end());
+    chunk = Chunk();
+  }
+  return anns;
+}
+
+size_t FillGroundTruth(const Annotations &anns, int64_t image_id, size_t max_gt,
+                       size_t poly_len, float *gt_boxes, float *gt_polys) {
+  std::fill(gt_boxes, gt_boxes + max_gt * 5, -1.f);
+  std::fill(gt_polys, gt_polys + max_gt * poly_len, 0.f);
+  auto it = anns.image_annotations.find(image_id);
+  if (it == anns.image_annotations.end()) return 0;
+  size_t row = 0;
+  for (size_t ann : it->second) {
+    if (anns.iscrowd[ann]) continue;
+    CHECK_LT(row, max_gt) << "Image " << image_id << " has more than " << max_gt
+                          << " annotations";
+    const float *bbox = &anns.bboxes[ann * 4];
+    float *box = gt_boxes + row * 5;
+    box[0] = bbox[0];
+    box[1] = bbox[1];
+    box[2] = bbox[0] + std::max(0.f, bbox[2] - 1.f);
+    box[3] = bbox[1] + std::max(0.f, bbox[3] - 1.f);
+    box[4] = static_cast<float>(anns.classes[ann]);
+
+    const size_t first = anns.ann_offsets[ann];
+    const size_t n_seg = anns.ann_offsets[ann + 1] - first;
+    const size_t num_coords = anns.poly_offsets[first + n_seg] - anns.poly_offsets[first];
+    CHECK_LE(2 + n_seg + num_coords, poly_len)
+      << "Polygons of annotation " << ann << " do not fit in poly_len " << poly_len;
+    float *poly = gt_polys + row * poly_len;
+    poly[0] = static_cast<float>(anns.classes[ann]);
+    poly[1] = static_cast<float>(n_seg);
+    for (size_t s = 0; s < n_seg; ++s) {
+      poly[2 + s] = static_cast<float>(anns.poly_offsets[first + s + 1] -
+                                       anns.poly_offsets[first + s]);
+    }
+    std::copy(anns.coords.begin() + anns.poly_offsets[first],
+              anns.coords.begin() + anns.poly_offsets[first + n_seg],
+              poly + 2 + n_seg);
+    ++row;
+  }
+  return row;
+}
+
+}  // namespace coco
+}  // namespace mxnet
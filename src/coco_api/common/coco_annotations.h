@@ -0,0 +1,93 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file coco_annotations.h
+ * \brief load the instance annotations of a COCO json file into flat arrays
+ */
+#ifndef MXNET_COCO_API_COMMON_COCO_ANNOTATIONS_H_
+#define MXNET_COCO_API_COMMON_COCO_ANNOTATIONS_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mxnet {
+namespace coco {
+
+/*!
+ * \brief instance annotations of a COCO json file, with their polygons packed
+ *  in one coordinate buffer.
+ *
+ *  The polygons of annotation i are [ann_offsets[i], ann_offsets[i+1]), and the
+ *  x, y coordinates of polygon p are coords[poly_offsets[p], poly_offsets[p+1]).
+ */
+struct Annotations {
+  /*! \brief image id of each annotation */
+  std::vector<int64_t> image_ids;
+  /*! \brief contiguous class of each annotation, 1 based in sorted category id order */
+  std::vector<int> classes;
+  /*! \brief whether each annotation is a crowd region, whose mask has no polygon */
+  std::vector<uint8_t> iscrowd;
+  /*! \brief x, y, w, h box of each annotation */
+  std::vector<float> bboxes;
+  /*! \brief first polygon of each annotation, size num_annotations + 1 */
+  std::vector<size_t> ann_offsets;
+  /*! \brief first coordinate of each polygon, size num_polygons + 1 */
+  std::vector<size_t> poly_offsets;
+  /*! \brief x, y coordinates of all the polygons */
+  std::vector<float> coords;
+  /*! \brief annotations of each image id, in file order */
+  std::unordered_map<int64_t, std::vector<size_t> > image_annotations;
+
+  size_t size() const {
+    return image_ids.size();
+  }
+};
+
+/*!
+ * \brief load the "annotations" and "categories" of a COCO json file.
+ *  The annotations are split at their boundaries and parsed in parallel chunks,
+ *  each straight into flat arrays, without keeping a json tree around.
+ * \param path json file
+ * \param num_threads parsing threads, 0 for the engine's recommendation
+ */
+Annotations LoadAnnotations(const std::string &path, int num_threads = 0);
+
+/*!
+ * \brief fill the gt_boxes and gt_polys rows of an image for ProposalMaskTarget.
+ *  Boxes are [x1, y1, x2, y2, class], and polygons use the layout
+ *  [class, n_seg, len_0, ..., len_{n_seg-1}, x0, y0, x1, y1, ...].
+ *  Unused rows get class -1, crowd annotations are skipped.
+ * \param anns loaded annotations
+ * \param image_id image to fill
+ * \param max_gt rows of gt_boxes and gt_polys
+ * \param poly_len length of a gt_polys row
+ * \param gt_boxes output of shape (max_gt, 5)
+ * \param gt_polys output of shape (max_gt, poly_len)
+ * \return number of rows filled
+ */
+size_t FillGroundTruth(const Annotations &anns, int64_t image_id, size_t max_gt,
+                       size_t poly_len, float *gt_boxes, float *gt_polys);
+
+}  // namespace coco
+}  // namespace mxnet
+#endif  // MXNET_COCO_API_COMMON_COCO_ANNOTATIONS_H_
@@ -158,9 +158,9 @@ int uintCompare(const void *a, const void *b) {
   uint c=*((uint*)a), d=*((uint*)b); return c>d?1:c<d?-1:0;
 }
 
-void rleFrPoly( RLE *R, const double *xy, siz k, siz h, siz w ) {
+static siz polyBoundary( const double *xy, siz k, siz h, siz w, int **bx, int **by ) {
   /* upsample and get discrete points densely along entire boundary */
-  siz j, m=0; double scale=5; int *x, *y, *u, *v; uint *a, *b;
+  siz j, m=0; double scale=5; int *x, *y, *u, *v;
   x=static_cast<int*>(malloc(sizeof(int)*(k+1))); y=static_cast<int*>(malloc(sizeof(int)*(k+1)));
   for(j=0; j<k; j++) x[j]=(int)(scale*xy[j*2+0]+.5); x[k]=x[0];
   for(j=0; j<k; j++) y[j]=(int)(scale*xy[j*2+1]+.5); y[k]=y[0];
@@ -188,10 +188,16 @@ void rleFrPoly( RLE *R, const double *xy, siz k, siz h, siz w ) {
     if(yd<0) yd=0; else if(yd>h) yd=h; yd=ceil(yd);
     x[m]=(int) xd; y[m]=(int) yd; m++;
   }
+  free(u); free(v); *bx=x; *by=y; return m;
+}
+
+void rleFrPoly( RLE *R, const double *xy, siz k, siz h, siz w ) {
+  siz j, m; int *x, *y; uint *a, *b;
+  m=polyBoundary(xy,k,h,w,&x,&y);
   /* compute rle encoding given y-boundary points */
   k=m; a=static_cast<uint*>(malloc(sizeof(uint)*(k+1)));
   for( j=0; j<k; j++ ) a[j]=(uint)(x[j]*(int)(h)+y[j]);
-  a[k++]=(uint)(h*w); free(u); free(v); free(x); free(y);
+  a[k++]=(uint)(h*w); free(x); free(y);
   qsort(a,k,sizeof(uint),uintCompare); uint p=0;
   for( j=0; j<k; j++ ) { uint t=a[j]; a[j]-=p; p=t; }
   b=static_cast<uint*>(malloc(sizeof(uint)*k)); j=m=0; b[m++]=a[j++];
@@ -200,6 +206,19 @@ void rleFrPoly( RLE *R, const double *xy, siz k, siz h, siz w ) {
   rleInit(R,h,w,m,b); free(a); free(b);
 }
 
+void polyToMask( const double *xy, siz k, siz h, siz w, byte *M ) {
+  /* every y-boundary point flips the value of all later pixels in column-major
+     order, which is what the rle runs of rleFrPoly encode; points flip bit 1
+     in place and a single prefix scan ORs the parity into bit 0 */
+  siz j, m, a=h*w; int *x, *y; byte v=0;
+  m=polyBoundary(xy,k,h,w,&x,&y);
+  for( j=0; j<m; j++ ) {
+    siz t=(siz)(x[j]*(int)(h)+y[j]); if(t<a) M[t]^=2;
+  }
+  free(x); free(y);
+  for( j=0; j<a; j++ ) { v^=(M[j]>>1); M[j]=(M[j]&1)|v; }
+}
+
 char* rleToString( const RLE *R ) {
   /* Similar to LEB128 but using 6 bits/char and ascii chars 48-111. */
   siz i, m=R->m, p=0; long x; int more;
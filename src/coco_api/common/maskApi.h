@@ -53,6 +53,9 @@ void rleFrBbox( RLE *R, const BB bb, siz h, siz w, siz n );
 /* Convert polygon to encoded mask. */
 void rleFrPoly( RLE *R, const double *xy, siz k, siz h, siz w );
 
+/* Rasterize polygon into a column-major binary mask (OR with its contents). */
+void polyToMask( const double *xy, siz k, siz h, siz w, byte *mask );
+
 /* Get compressed string representation of encoded mask. */
 char* rleToString( const RLE *R );
 
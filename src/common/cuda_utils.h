@@ -52,6 +52,7 @@ extern __cuda_fake_struct blockIdx;
 #include <cuda_runtime.h>
 #include <cublas_v2.h>
 #include <curand.h>
+#include <cusparse.h>
 
 /*!
  * \brief When compiling a __device__ function, check that the architecture is >= Kepler (3.0)
@@ -169,6 +170,37 @@ inline const char* CurandGetErrorString(curandStatus_t status) {
   return "Unknown cuRAND status";
 }
 
+/*!
+ * \brief Get string representation of cuSPARSE errors.
+ * \param status The status.
+ * \return String representation.
+ */
+inline const char* CusparseGetErrorString(cusparseStatus_t status) {
+  switch (status) {
+  case CUSPARSE_STATUS_SUCCESS:
+    return "CUSPARSE_STATUS_SUCCESS";
+  case CUSPARSE_STATUS_NOT_INITIALIZED:
+    return "CUSPARSE_STATUS_NOT_INITIALIZED";
+  case CUSPARSE_STATUS_ALLOC_FAILED:
+    return "CUSPARSE_STATUS_ALLOC_FAILED";
+  case CUSPARSE_STATUS_INVALID_VALUE:
+    return "CUSPARSE_STATUS_INVALID_VALUE";
+  case CUSPARSE_STATUS_ARCH_MISMATCH:
+    return "CUSPARSE_STATUS_ARCH_MISMATCH";
+  case CUSPARSE_STATUS_MAPPING_ERROR:
+    return "CUSPARSE_STATUS_MAPPING_ERROR";
+  case CUSPARSE_STATUS_EXECUTION_FAILED:
+    return "CUSPARSE_STATUS_EXECUTION_FAILED";
+  case CUSPARSE_STATUS_INTERNAL_ERROR:
+    return "CUSPARSE_STATUS_INTERNAL_ERROR";
+  case CUSPARSE_STATUS_MATRIX_TYPE_NOT_SUPPORTED:
+    return "CUSPARSE_STATUS_MATRIX_TYPE_NOT_SUPPORTED";
+  default:
+    break;
+  }
+  return "Unknown cuSPARSE status";
+}
+
 template <typename DType>
 inline DType __device__ CudaMax(DType a, DType b) {
     return a > b ? a : b;
@@ -245,6 +277,19 @@ inline DType __device__ CudaMin(DType a, DType b) {
         << "cuRAND: " << mxnet::common::cuda::CurandGetErrorString(e); \
   }
 
+/*!
+ * \brief Protected cuSPARSE call.
+ * \param func Expression to call.
+ *
+ * It checks for cuSPARSE errors after invocation of the expression.
+ */
+#define CUSPARSE_CALL(func)                                     \
+  {                                                             \
+    cusparseStatus_t e = (func);                                \
+    CHECK_EQ(e, CUSPARSE_STATUS_SUCCESS)                        \
+        << "cuSPARSE: " << mxnet::common::cuda::CusparseGetErrorString(e); \
+  }
+
 /*!
  * \brief Protected NVRTC call.
  * \param func Expression to call.
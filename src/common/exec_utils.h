@@ -26,6 +26,7 @@
 
 #include <vector>
 #include "../common/utils.h"
+#include "../profiler/profiler.h"
 
 namespace mxnet {
 namespace common {
@@ -148,6 +149,21 @@ inline void SetupDefaultBlobsInOut(const std::vector<NDArray> &ndinputs,
   }
 }
 
+/*!
+ * \brief profiler counters of the storage fallback casts that ran, and of those
+ *  skipped because a cached dense shadow already held the source's version
+ */
+struct StorageFallbackCounters {
+  profiler::ProfileDomain domain{"StorageFallback"};
+  profiler::ProfileCounter casts{"Storage Fallback Casts", &domain};
+  profiler::ProfileCounter reused{"Storage Fallback Reused", &domain};
+
+  static StorageFallbackCounters* Get() {
+    static StorageFallbackCounters inst;
+    return &inst;
+  }
+};
+
 /*
  * \brief cast the NDArrays in `src` and store the result in NDArrays in `dst`.
  *        This is only used for storage fallback in executor.
@@ -160,6 +176,8 @@ inline void CastNonDefaultStorage(const std::vector<NDArray>& src,
                                   const OpContext& ctx,
                                   const bool is_gpu) {
   CHECK_EQ(dst.size(), src.size());
+  if (src.empty()) return;
+  StorageFallbackCounters::Get()->casts += src.size();
   for (size_t i = 0; i < src.size(); i++) {
     if (is_gpu) {
 #if MXNET_USE_CUDA
@@ -0,0 +1,145 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file numa.cc
+ * \brief NUMA topology from sysfs, thread and memory binding through the
+ *  affinity and mbind system calls, so no libnuma is needed
+ */
+#include "./numa.h"
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace mxnet {
+namespace common {
+namespace numa {
+namespace {
+/*! \brief mbind policy preferring one node, from linux/mempolicy.h */
+const int kMPolPreferred = 1;
+
+/*! \brief parse a sysfs cpu list such as "0-13,28-41" */
+std::vector<int> ParseCPUList(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    int begin, end;
+    const int matched = sscanf(range.c_str(), "%d-%d", &begin, &end);
+    if (matched < 1) continue;
+    if (matched == 1) end = begin;
+    for (int cpu = begin; cpu <= end; ++cpu) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+struct Topology {
+  std::vector<std::vector<int> > node_cpus;
+  int num_cpus{0};
+
+  Topology() {
+#if defined(__linux__)
+    if (!dmlc::GetEnv("MXNET_CPU_NUMA_BIND", false)) return;
+    for (int node = 0; ; ++node) {
+      std::ifstream is("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+      if (!is) break;
+      std::string list;
+      std::getline(is, list);
+      std::vector<int> cpus = ParseCPUList(list);
+      // memory-only nodes hold no workers
+      if (cpus.empty()) continue;
+      num_cpus += static_cast<int>(cpus.size());
+      node_cpus.push_back(cpus);
+    }
+    if (node_cpus.empty()) {
+      LOG(WARNING) << "MXNET_CPU_NUMA_BIND is set but no NUMA node was found, "
+                   << "CPU workers are not pinned";
+    }
+#endif
+  }
+
+  static const Topology& Get() {
+    static Topology inst;
+    return inst;
+  }
+};
+}  // namespace
+
+int NumNodes() {
+  return static_cast<int>(Topology::Get().node_cpus.size());
+}
+
+int NumCPUs() {
+  return Topology::Get().num_cpus;
+}
+
+int NodeOfDevice(int dev_id) {
+  const int num_nodes = NumNodes();
+  return num_nodes == 0 ? -1 : dev_id % num_nodes;
+}
+
+const std::vector<int>& NodeCPUs(int node) {
+  return Topology::Get().node_cpus.at(node);
+}
+
+bool BindThreadToNode(int node) {
+#if defined(__linux__)
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (int cpu : NodeCPUs(node)) CPU_SET(cpu, &mask);
+  const int ret = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+  if (ret != 0) {
+    LOG(WARNING) << "Failed to pin a CPU worker to NUMA node " << node << ", error " << ret;
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void PreferNodeForMemory(void* ptr, size_t size, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  // mbind takes whole pages, the partial pages at the ends keep the default
+  // policy, and maxnode counts one past the last bit it reads
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t begin = (reinterpret_cast<size_t>(ptr) + page - 1) / page * page;
+  const size_t end = (reinterpret_cast<size_t>(ptr) + size) / page * page;
+  if (end <= begin) return;
+  const size_t kBits = 8 * sizeof(unsigned long);  // NOLINT(runtime/int)
+  std::vector<unsigned long> nodemask(node / kBits + 1, 0);  // NOLINT(runtime/int)
+  nodemask[node / kBits] = 1UL << (node % kBits);
+  syscall(SYS_mbind, begin, end - begin, kMPolPreferred, nodemask.data(),
+          nodemask.size() * kBits + 1, 0);
+#endif
+}
+
+}  // namespace numa
+}  // namespace common
+}  // namespace mxnet
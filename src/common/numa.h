@@ -0,0 +1,61 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file numa.h
+ * \brief placement of CPU contexts on NUMA nodes, cpu(i) maps to node i % NumNodes()
+ */
+#ifndef MXNET_COMMON_NUMA_H_
+#define MXNET_COMMON_NUMA_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace mxnet {
+namespace common {
+namespace numa {
+
+/*!
+ * \brief number of NUMA nodes CPU contexts are placed on, 0 unless
+ *  MXNET_CPU_NUMA_BIND is set and the nodes can be read from the system
+ */
+int NumNodes();
+/*! \brief number of CPUs over all nodes */
+int NumCPUs();
+/*! \return the node of context cpu(dev_id), or -1 when placement is disabled */
+int NodeOfDevice(int dev_id);
+/*! \return the CPUs of a node */
+const std::vector<int>& NodeCPUs(int node);
+/*!
+ * \brief pin the calling thread to the CPUs of a node, threads it creates
+ *  afterwards, such as its OpenMP team, inherit the mask
+ * \return whether the thread was pinned
+ */
+bool BindThreadToNode(int node);
+/*!
+ * \brief prefer a node for the pages of [ptr, ptr + size) that are not
+ *  touched yet, pages that are already placed do not move
+ */
+void PreferNodeForMemory(void* ptr, size_t size, int node);
+
+}  // namespace numa
+}  // namespace common
+}  // namespace mxnet
+#endif  // MXNET_COMMON_NUMA_H_
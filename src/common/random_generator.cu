@@ -57,6 +57,7 @@ void RandGenerator<gpu, float>::Seed(mshadow::Stream<gpu> *s, uint32_t seed) {
           seed);
   MSHADOW_CUDA_POST_KERNEL_CHECK(rand_generator_seed_kernel);
   s->Wait();
+  philox_key_ = PhiloxKey{seed, 0};
 }
 
 }  // namespace random
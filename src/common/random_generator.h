@@ -38,6 +38,106 @@ namespace mxnet {
 namespace common {
 namespace random {
 
+/*! \brief key of one launch of a counter based kernel */
+struct PhiloxKey {
+  /*! \brief seed of the generator */
+  uint64_t seed;
+  /*! \brief number of launches since the generator was seeded */
+  uint32_t offset;
+};
+
+/*!
+ * \brief Philox4x32-10 counter based generator (Salmon et al., "Parallel random numbers:
+ *  as easy as 1, 2, 3", SC'11). Its output is a function of the key of the launch and the
+ *  index of the element, so the numbers do not depend on the number of threads or blocks
+ *  the elements are spread over, and no state is kept in memory between launches.
+ *  Each call of Next() returns four 32 bit words, further calls of the same index give
+ *  further independent words.
+ */
+class PhiloxGenerator {
+ public:
+  MSHADOW_XINLINE PhiloxGenerator(const PhiloxKey& key, const uint64_t index)
+      : key0_(static_cast<uint32_t>(key.seed)), key1_(static_cast<uint32_t>(key.seed >> 32)),
+        ctr0_(static_cast<uint32_t>(index)), ctr1_(static_cast<uint32_t>(index >> 32)),
+        ctr2_(key.offset), ctr3_(0) {}
+
+  /*! \brief the next four random words of this index */
+  MSHADOW_XINLINE void Next(uint32_t out[4]) {
+    uint32_t c0 = ctr0_, c1 = ctr1_, c2 = ctr2_, c3 = ctr3_++;
+    uint32_t k0 = key0_, k1 = key1_;
+    for (int r = 0; r < 10; ++r) {
+      uint32_t hi0, hi1;
+      const uint32_t lo0 = MulHiLo(kMul0, c0, &hi0);
+      const uint32_t lo1 = MulHiLo(kMul1, c2, &hi1);
+      c0 = hi1 ^ c1 ^ k0;
+      c1 = lo1;
+      c2 = hi0 ^ c3 ^ k1;
+      c3 = lo0;
+      k0 += kWeyl0;
+      k1 += kWeyl1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+  }
+
+  /*! \brief four uniform numbers in [0, 1), with the mantissa of FType filled */
+  template<typename FType>
+  MSHADOW_XINLINE void Uniform(FType out[4]);
+
+  /*! \brief four standard normal numbers, by the Box-Muller transform */
+  template<typename FType>
+  MSHADOW_XINLINE void Normal(FType out[4]) {
+    Uniform(out);
+    for (int k = 0; k < 4; k += 2) {
+      // 1 - u is in (0, 1], so the log is finite
+      const FType radius = sqrt(FType(-2) * log(FType(1) - out[k]));
+      const FType theta = FType(2 * 3.14159265358979323846) * out[k + 1];
+      out[k] = radius * cos(theta);
+      out[k + 1] = radius * sin(theta);
+    }
+  }
+
+ private:
+  static const uint32_t kMul0 = 0xD2511F53;
+  static const uint32_t kMul1 = 0xCD9E8D57;
+  static const uint32_t kWeyl0 = 0x9E3779B9;
+  static const uint32_t kWeyl1 = 0xBB67AE85;
+
+  static MSHADOW_XINLINE uint32_t MulHiLo(const uint32_t a, const uint32_t b, uint32_t* hi) {
+#ifdef __CUDA_ARCH__
+    *hi = __umulhi(a, b);
+    return a * b;
+#else
+    const uint64_t product = static_cast<uint64_t>(a) * b;
+    *hi = static_cast<uint32_t>(product >> 32);
+    return static_cast<uint32_t>(product);
+#endif  // __CUDA_ARCH__
+  }
+
+  uint32_t key0_, key1_;
+  uint32_t ctr0_, ctr1_, ctr2_, ctr3_;
+};  // class PhiloxGenerator
+
+template<>
+MSHADOW_XINLINE void PhiloxGenerator::Uniform<float>(float out[4]) {
+  uint32_t words[4];
+  Next(words);
+  for (int k = 0; k < 4; ++k) out[k] = (words[k] >> 8) * (1.0f / 16777216.0f);
+}
+
+template<>
+MSHADOW_XINLINE void PhiloxGenerator::Uniform<double>(double out[4]) {
+  uint32_t words[8];
+  Next(words);
+  Next(words + 4);
+  for (int k = 0; k < 4; ++k) {
+    const uint64_t bits = (static_cast<uint64_t>(words[2 * k]) << 21) ^ (words[2 * k + 1] >> 11);
+    out[k] = bits * (1.0 / 9007199254740992.0);
+  }
+}
+
 template<typename Device, typename DType MSHADOW_DEFAULT_DTYPE>
 class RandGenerator;
 
@@ -90,10 +190,19 @@ class RandGenerator<cpu, DType> {
 
   MSHADOW_XINLINE void Seed(mshadow::Stream<cpu> *, uint32_t seed) {
     for (int i = 0; i < kNumRandomStates; ++i) (states_ + i)->seed(seed + i);
+    philox_key_ = PhiloxKey{seed, 0};
+  }
+
+  /*! \brief key of the next launch of a counter based kernel */
+  inline PhiloxKey NextPhiloxKey() {
+    const PhiloxKey key = philox_key_;
+    ++philox_key_.offset;
+    return key;
   }
 
  private:
   std::mt19937 *states_;
+  PhiloxKey philox_key_;
 };  // class RandGenerator<cpu, DType>
 
 template<typename DType>
@@ -161,8 +270,16 @@ class RandGenerator<gpu, DType> {
 
   void Seed(mshadow::Stream<gpu> *s, uint32_t seed);
 
+  /*! \brief key of the next launch of a counter based kernel */
+  inline PhiloxKey NextPhiloxKey() {
+    const PhiloxKey key = philox_key_;
+    ++philox_key_.offset;
+    return key;
+  }
+
  private:
   curandStatePhilox4_32_10_t *states_;
+  PhiloxKey philox_key_;
 };  // class RandGenerator<gpu, DType>
 
 template<>
@@ -206,8 +323,16 @@ class RandGenerator<gpu, double> {
     curandStatePhilox4_32_10_t state_;
   };  // class RandGenerator<gpu, double>::Impl
 
+  /*! \brief key of the next launch of a counter based kernel */
+  inline PhiloxKey NextPhiloxKey() {
+    const PhiloxKey key = philox_key_;
+    ++philox_key_.offset;
+    return key;
+  }
+
  private:
   curandStatePhilox4_32_10_t *states_;
+  PhiloxKey philox_key_;
 };  // class RandGenerator<gpu, double>
 
 #endif  // MXNET_USE_CUDA
@@ -18,6 +18,11 @@
  */
 
 #include <mxnet/rtc.h>
+#include <dmlc/io.h>
+#include <dmlc/parameter.h>
+#include <unistd.h>
+#include <cstdio>
+#include <sstream>
 #include <typeinfo>
 
 #include "../common/cuda_utils.h"
@@ -28,37 +33,122 @@
 namespace mxnet {
 namespace rtc {
 
+namespace {
+
+/*! \brief key of a compilation, everything the PTX depends on */
+std::string CompileKey(const char* source,
+                       const std::vector<std::string>& options,
+                       const std::vector<std::string>& exports) {
+  int major, minor;
+  NVRTC_CALL(nvrtcVersion(&major, &minor));
+  std::ostringstream key;
+  key << "nvrtc " << major << "." << minor << '\0';
+  for (const auto& i : options) key << i << '\0';
+  key << '\0';
+  for (const auto& i : exports) key << i << '\0';
+  key << '\0' << source;
+  return key.str();
+}
+
+/*! \brief file of a compilation in the disk cache, empty when the cache is off */
+std::string CacheFile(const std::string& key) {
+  static const std::string dir = dmlc::GetEnv("MXNET_RTC_CACHE_DIR", std::string());
+  if (dir.empty()) return std::string();
+  std::ostringstream name;
+  name << dir << "/" << std::hex << std::hash<std::string>()(key) << ".ptx";
+  return name.str();
+}
+
+}  // namespace
+
 CudaModule::Chunk::Chunk(
     const char* source,
     const std::vector<std::string>& options,
     const std::vector<std::string>& exports) {
-  NVRTC_CALL(nvrtcCreateProgram(&prog_, source, "source.cu", 0, NULL, NULL));
-  for (const auto& i : exports) exports_.insert(i);
-#if CUDA_VERSION >= 8000
-  for (const auto& func : exports) {
-    NVRTC_CALL(nvrtcAddNameExpression(prog_, func.c_str()));
-  }
-#else
+#if CUDA_VERSION < 8000
   CHECK_EQ(exports.size(), 0)
       << "Exporting is only supported with CUDA 8.0 and above. "
       << "For lower version of CUDA, please prepend your kernel defintiions "
       << "with extern \"C\" instead.";
+#endif
+  const std::string key = CompileKey(source, options, exports);
+  const std::string file = CacheFile(key);
+  if (!file.empty()) {
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(file.c_str(), "r", true));
+    std::string cached_key;
+    std::vector<std::string> names, lowered;
+    // the full key is stored to rule out hash collisions
+    if (fi != nullptr && fi->Read(&cached_key) && cached_key == key &&
+        fi->Read(&names) && fi->Read(&lowered) && fi->Read(&ptx_) &&
+        names.size() == lowered.size()) {
+      for (size_t i = 0; i < names.size(); ++i) lowered_[names[i]] = lowered[i];
+      return;
+    }
+  }
+  Compile(source, options, exports);
+  if (!file.empty()) {
+    std::vector<std::string> names, lowered;
+    for (const auto& kv : lowered_) {
+      names.push_back(kv.first);
+      lowered.push_back(kv.second);
+    }
+    // written aside and renamed, so that concurrent processes never read a partial file
+    std::ostringstream tmp;
+    tmp << file << "." << getpid();
+    {
+      std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp.str().c_str(), "w", true));
+      if (fo == nullptr) {
+        LOG(WARNING) << "Cannot write to MXNET_RTC_CACHE_DIR file " << tmp.str();
+        return;
+      }
+      fo->Write(key);
+      fo->Write(names);
+      fo->Write(lowered);
+      fo->Write(ptx_);
+    }
+    if (std::rename(tmp.str().c_str(), file.c_str()) != 0) {
+      std::remove(tmp.str().c_str());
+    }
+  }
+}
+
+
+void CudaModule::Chunk::Compile(
+    const char* source,
+    const std::vector<std::string>& options,
+    const std::vector<std::string>& exports) {
+  nvrtcProgram prog;
+  NVRTC_CALL(nvrtcCreateProgram(&prog, source, "source.cu", 0, NULL, NULL));
+#if CUDA_VERSION >= 8000
+  for (const auto& func : exports) {
+    NVRTC_CALL(nvrtcAddNameExpression(prog, func.c_str()));
+  }
 #endif
   std::vector<const char*> c_options;
   for (const auto& i : options) c_options.push_back(i.c_str());
-  nvrtcResult compile_res = nvrtcCompileProgram(prog_, c_options.size(), c_options.data());
+  nvrtcResult compile_res = nvrtcCompileProgram(prog, c_options.size(), c_options.data());
   if (compile_res != NVRTC_SUCCESS) {
     size_t err_size;
-    NVRTC_CALL(nvrtcGetProgramLogSize(prog_, &err_size));
+    NVRTC_CALL(nvrtcGetProgramLogSize(prog, &err_size));
     std::vector<char> err(err_size);
-    NVRTC_CALL(nvrtcGetProgramLog(prog_, err.data()));
+    NVRTC_CALL(nvrtcGetProgramLog(prog, err.data()));
+    NVRTC_CALL(nvrtcDestroyProgram(&prog));
     LOG(FATAL) << err.data();
   }
+#if CUDA_VERSION >= 8000
+  for (const auto& func : exports) {
+    const char * c_mangled_name;
+    NVRTC_CALL(nvrtcGetLoweredName(prog, func.c_str(), &c_mangled_name));
+    lowered_[func] = c_mangled_name;
+  }
+#endif
 
   size_t ptx_size;
-  NVRTC_CALL(nvrtcGetPTXSize(prog_, &ptx_size));
-  ptx_ = new char[ptx_size];
-  NVRTC_CALL(nvrtcGetPTX(prog_, ptx_));
+  NVRTC_CALL(nvrtcGetPTXSize(prog, &ptx_size));
+  std::vector<char> ptx(ptx_size);
+  NVRTC_CALL(nvrtcGetPTX(prog, ptx.data()));
+  ptx_.assign(ptx.data(), ptx_size);
+  NVRTC_CALL(nvrtcDestroyProgram(&prog));
 }
 
 
@@ -66,8 +156,6 @@ CudaModule::Chunk::~Chunk() {
   for (const auto& kv : mod_) {
     CUDA_DRIVER_CALL(cuModuleUnload(kv.second));
   }
-  NVRTC_CALL(nvrtcDestroyProgram(&prog_));
-  delete ptx_;
 }
 
 
@@ -76,13 +164,14 @@ CUfunction CudaModule::Chunk::GetFunction(
     const Context& ctx) {
   CHECK_EQ(ctx.dev_mask(), Context::kGPU)
       << "CUDA Runtime compilation only supports Nvidia GPU.";
+  std::lock_guard<std::mutex> lock(mutex_);
   auto iter = mod_.find(ctx.dev_id);
   CUmodule module;
   if (iter != mod_.end()) {
     module = iter->second;
   } else {
     CUDA_CALL(cudaSetDevice(ctx.dev_id));
-    CUDA_DRIVER_CALL(cuModuleLoadDataEx(&module, ptx_, 0, 0, 0));
+    CUDA_DRIVER_CALL(cuModuleLoadDataEx(&module, ptx_.c_str(), 0, 0, 0));
     mod_[ctx.dev_id] = module;
   }
   CUfunction function;
@@ -98,16 +187,27 @@ CUfunction CudaModule::Chunk::GetFunction(
 }
 
 
+std::shared_ptr<CudaModule::Chunk> CudaModule::GetChunk(
+    const char* source,
+    const std::vector<std::string>& options,
+    const std::vector<std::string>& exports) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::weak_ptr<Chunk> > chunks;
+  const std::string key = CompileKey(source, options, exports);
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<Chunk> chunk = chunks[key].lock();
+  if (chunk == nullptr) {
+    chunk = std::make_shared<Chunk>(source, options, exports);
+    chunks[key] = chunk;
+  }
+  return chunk;
+}
+
+
 std::shared_ptr<CudaModule::Kernel> CudaModule::GetKernel(
     const std::string& name, const std::vector<ArgType>& signature) {
-  std::string mangled_name = name;
-#if CUDA_VERSION >= 8000
-  if (ptr_->exports_.count(name)) {
-    const char * c_mangled_name;
-    NVRTC_CALL(nvrtcGetLoweredName(ptr_->prog_, name.c_str(), &c_mangled_name));
-    mangled_name = c_mangled_name;
-  }
-#endif
+  auto iter = ptr_->lowered_.find(name);
+  const std::string& mangled_name = iter != ptr_->lowered_.end() ? iter->second : name;
   return std::shared_ptr<Kernel>(new Kernel(ptr_, mangled_name, signature));
 }
 
@@ -119,6 +219,15 @@ CudaModule::Kernel::Kernel(
       : mangled_name_(mangled_name), signature_(signature), mod_(mod) {
 }
 
+CUfunction CudaModule::Kernel::GetFunction(const Context& ctx) {
+  auto iter = func_.find(ctx.dev_id);
+  if (iter != func_.end()) return iter->second;
+  CUfunction function = mod_->GetFunction(mangled_name_, ctx);
+  func_[ctx.dev_id] = function;
+  return function;
+}
+
+
 void CudaModule::Kernel::Launch(
     const Context& ctx, const std::vector<dmlc::any>& args,
     uint32_t grid_dim_x, uint32_t grid_dim_y, uint32_t grid_dim_z,
@@ -130,14 +239,7 @@ void CudaModule::Kernel::Launch(
   auto mod = mod_;
   auto arg_types = signature();
 
-  CUfunction function;
-  auto iter = func_.find(ctx.dev_id);
-  if (iter != func_.end()) {
-    function = iter->second;
-  } else {
-    function = mod_->GetFunction(mangled_name_, ctx);
-    func_[ctx.dev_id] = function;
-  }
+  CUfunction function = GetFunction(ctx);
 
   std::vector<Engine::VarHandle> read_vars, write_vars;
   for (size_t i = 0; i < arg_types.size(); ++i) {
@@ -0,0 +1,86 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file small_vector.h
+ * \brief vector keeping its first elements inline
+ */
+#ifndef MXNET_COMMON_SMALL_VECTOR_H_
+#define MXNET_COMMON_SMALL_VECTOR_H_
+
+#include <dmlc/base.h>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+namespace mxnet {
+namespace common {
+
+/*!
+ * \brief Vector of plain old data keeping up to N elements inline, so the short
+ *        lists of a pooled object, e.g. the variables of an engine operation,
+ *        are stored without a heap allocation.
+ * \tparam T element type, plain old data
+ * \tparam N number of elements stored inline
+ */
+template<typename T, size_t N>
+class SmallVector {
+  static_assert(std::is_pod<T>::value, "SmallVector only holds plain old data");
+
+ public:
+  SmallVector() = default;
+  ~SmallVector() {
+    if (data_ != inline_) delete[] data_;
+  }
+  /*!
+   * \brief change the number of elements, keeping the first ones; grown elements
+   *        are left uninitialized
+   * \param size the new number of elements
+   */
+  void resize(size_t size) {
+    if (size > capacity_) {
+      T *data = new T[size];
+      std::copy(data_, data_ + size_, data);
+      if (data_ != inline_) delete[] data_;
+      data_ = data;
+      capacity_ = size;
+    }
+    size_ = size;
+  }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  T *begin() { return data_; }
+  T *end() { return data_ + size_; }
+  const T *begin() const { return data_; }
+  const T *end() const { return data_ + size_; }
+  T &operator[](size_t i) { return data_[i]; }
+  const T &operator[](size_t i) const { return data_[i]; }
+
+ private:
+  T inline_[N];
+  T *data_{inline_};
+  size_t size_{0};
+  size_t capacity_{N};
+  DISALLOW_COPY_AND_ASSIGN(SmallVector);
+};
+
+}  // namespace common
+}  // namespace mxnet
+#endif  // MXNET_COMMON_SMALL_VECTOR_H_
@@ -462,6 +462,33 @@ V ParallelAccumulate(const T* a, const int n, V start) {
   return sum;
 }
 
+/*!
+ * \brief In place inclusive prefix sum of a[0, n). Every thread scans one block,
+ *  the block totals are scanned serially and added back in a second parallel pass.
+ */
+template<typename T>
+void ParallelPrefixSum(T* a, const nnvm::dim_t n) {
+  const int num_threads = std::max(1, std::min<int>(omp_get_max_threads(), n / 4096));
+  if (num_threads == 1) {
+    for (nnvm::dim_t i = 1; i < n; ++i) a[i] += a[i - 1];
+    return;
+  }
+  std::vector<T> block_sum(num_threads + 1, 0);
+  #pragma omp parallel num_threads(num_threads)
+  {
+    const int tid = omp_get_thread_num();
+    const nnvm::dim_t begin = n * tid / num_threads;
+    const nnvm::dim_t end = n * (tid + 1) / num_threads;
+    for (nnvm::dim_t i = begin + 1; i < end; ++i) a[i] += a[i - 1];
+    block_sum[tid + 1] = end > begin ? a[end - 1] : 0;
+    #pragma omp barrier
+    #pragma omp single
+    for (int t = 1; t <= num_threads; ++t) block_sum[t] += block_sum[t - 1];
+    const T offset = block_sum[tid];
+    for (nnvm::dim_t i = begin; i < end; ++i) a[i] += offset;
+  }
+}
+
 /*!
  * \brief
  * Helper function for ParallelSort.
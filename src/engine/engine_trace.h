@@ -0,0 +1,114 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file engine_trace.h
+ * \brief per operation scheduling trace of the threaded engines, one JSON
+ *  line per completed operation, read by tools/engine_trace.py
+ */
+#ifndef MXNET_ENGINE_ENGINE_TRACE_H_
+#define MXNET_ENGINE_ENGINE_TRACE_H_
+
+#include <dmlc/logging.h>
+#include <mxnet/base.h>
+#include <mxnet/engine.h>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include "../profiler/profiler.h"
+
+namespace mxnet {
+namespace engine {
+
+/*! \brief timestamps of an operation, in microseconds */
+struct OprTrace {
+  /*! \brief sequence number of the push */
+  uint64_t id{0};
+  /*! \brief when it was pushed */
+  uint64_t push{0};
+  /*! \brief when its last dependency was satisfied */
+  uint64_t ready{0};
+  /*! \brief when a worker started it */
+  uint64_t start{0};
+  /*! \brief id of the operation whose completion made it ready, 0 if ready at push */
+  uint64_t trigger{0};
+  /*! \brief the variable that was satisfied last, nullptr if ready at push */
+  const void* var{nullptr};
+
+  static inline uint64_t Now() {
+    return profiler::ProfileStat::NowInMicrosec();
+  }
+};
+
+/*!
+ * \brief writes the traces of completed operations, enabled by setting
+ *  MXNET_ENGINE_TRACE to the output file
+ */
+class EngineTraceWriter {
+ public:
+  explicit EngineTraceWriter(const std::string& filename) : os_(filename) {
+    CHECK(os_) << "MXNET_ENGINE_TRACE: cannot open " << filename;
+  }
+  /*! \return a new trace with its id and push time set */
+  OprTrace* NewTrace() {
+    OprTrace* trace = new OprTrace();
+    trace->id = ++next_id_;
+    trace->push = OprTrace::Now();
+    return trace;
+  }
+  /*! \brief write the trace of an operation that just completed */
+  void Write(const OprTrace& trace, const char* name, const Context& ctx, FnProperty prop) {
+    const uint64_t end = OprTrace::Now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    os_ << "{\"id\":" << trace.id
+        << ",\"name\":\"" << (name != nullptr ? name : "") << "\""
+        << ",\"ctx\":\"" << ctx << "\""
+        << ",\"prop\":\"" << PropName(prop) << "\""
+        << ",\"push\":" << trace.push
+        << ",\"ready\":" << trace.ready
+        << ",\"start\":" << trace.start
+        << ",\"end\":" << end
+        << ",\"trigger\":" << trace.trigger
+        << ",\"var\":\"" << trace.var << "\"}\n";
+  }
+
+ private:
+  static const char* PropName(FnProperty prop) {
+    switch (prop) {
+      case FnProperty::kNormal: return "normal";
+      case FnProperty::kCopyFromGPU: return "copy_from_gpu";
+      case FnProperty::kCopyToGPU: return "copy_to_gpu";
+      case FnProperty::kCPUPrioritized: return "cpu_prioritized";
+      case FnProperty::kAsync: return "async";
+      case FnProperty::kDeleteVar: return "delete_var";
+    }
+    return "unknown";
+  }
+
+  std::mutex mutex_;
+  std::ofstream os_;
+  std::atomic<uint64_t> next_id_{0};
+};
+
+}  // namespace engine
+}  // namespace mxnet
+#endif  // MXNET_ENGINE_ENGINE_TRACE_H_
@@ -24,9 +24,12 @@
  */
 #include <vector>
 #include <atomic>
+#include <memory>
 #include <thread>
+#include <mxnet/storage.h>
 #include "./engine_impl.h"
 #include "../profiler/profiler.h"
+#include "../profiler/nvtx.h"
 #include "./openmp.h"
 
 namespace mxnet {
@@ -47,6 +50,9 @@ class NaiveEngine final : public Engine {
     std::unique_ptr<profiler::ProfileOperator> opr_profile;
   };
 
+  /*! \brief variable that only counts its writes, the naive engine runs everything in order */
+  struct NaiveVar final : public Var {};
+
   NaiveEngine() {
   }
   // virtual destructor
@@ -65,8 +71,7 @@ class NaiveEngine final : public Engine {
 
   // new variables
   VarHandle NewVariable() override {
-    size_t v = ++counter_;
-    return reinterpret_cast<VarHandle>(v);
+    return new NaiveVar();
   }
 
   OprHandle NewOperator(AsyncFn fn,
@@ -92,6 +97,9 @@ class NaiveEngine final : public Engine {
   void Push(OprHandle op, Context exec_ctx, int priority = 0, bool profiling = false) override {
     profiler::Profiler *profiler = profiler::Profiler::Get();
     NaiveOpr *opr = op->Cast<NaiveOpr>();
+    // the closure below refers to this frame, the operator's own function is recorded
+    Record(opr->fn, exec_ctx, opr->prop, opr->opr_name, opr->mutable_vars);
+    RecordPause pause(this);
     opr->profiling = profiling && profiler->IsProfiling(profiler::Profiler::kSymbolic);
     this->PushAsync([&](RunContext ctx, CallbackOnComplete on_complete) {
         if (opr->profiling) {
@@ -123,6 +131,7 @@ class NaiveEngine final : public Engine {
                  int priority = 0,
                  const char* opr_name = nullptr,
                  bool wait = false) override {
+    if (!wait) Record(exec_fun, exec_ctx, prop, opr_name, mutable_vars);
     CallbackOnComplete callback = CreateCallback(
         NaiveEngine::OnComplete, nullptr);
     this->req_completed_ = false;
@@ -140,6 +149,11 @@ class NaiveEngine final : public Engine {
       opr->opr_profile.reset(new profiler::ProfileOperator(opr->opr_name, attrs.release()));
       opr->opr_profile->start(exec_ctx.dev_type, exec_ctx.dev_id);
     }
+    const uint64_t sample_start =
+        !profiling && opr_name && profiler->sampler() && profiler->sampler()->Sample() ?
+        profiler::ProfileStat::NowInMicrosec() : 0;
+    Storage::AllocScope alloc_scope(opr_name, Storage::kActivation);
+    profiler::nvtx::NVTXRange nvtx_range(opr_name, profiler::nvtx::kOperator);
     if (exec_ctx.dev_mask() == gpu::kDevMask) {
 #if MXNET_USE_CUDA
       size_t dev_id = static_cast<size_t>(exec_ctx.dev_id);
@@ -159,19 +173,51 @@ class NaiveEngine final : public Engine {
     }
     CHECK(this->req_completed_)
         << "NaiveEngine only support synchronize Push so far";
+    for (VarHandle var : mutable_vars) ++var->version_;
     if (profiling) {
       opr->opr_profile->stop();
     }
+    if (sample_start) {
+      profiler->sampler()->Add(opr_name, profiler::ProfileStat::NowInMicrosec() - sample_start);
+    }
   }
 
   void DeleteVariable(SyncFn delete_fn, Context exec_ctx, VarHandle var) override {
+    RecordPause pause(this);
     this->PushSync(delete_fn, exec_ctx, {}, {var},
                    FnProperty::kNormal, 0, "DeleteVariable");
+    delete var->Cast<NaiveVar>();
   }
 
   void WaitForVar(VarHandle var) override {
   }
 
+  bool IsVarReady(VarHandle var) override {
+    return true;
+  }
+
+  void StartRecord() override {
+    CHECK(!recording_) << "The engine is already recording";
+    recording_ = true;
+  }
+
+  OprHandle StopRecord() override {
+    CHECK(recording_) << "The engine is not recording";
+    recording_ = false;
+    if (recorded_.empty()) return nullptr;
+    // operations run in their push order, which the replay keeps
+    std::shared_ptr<std::vector<RecordedOpr> > steps(
+        new std::vector<RecordedOpr>(std::move(recorded_)));
+    recorded_.clear();
+    return NewOperator([this, steps](RunContext, CallbackOnComplete on_complete) {
+        for (const RecordedOpr& step : *steps) {
+          this->PushAsync(step.fn, step.ctx, {}, step.mutable_vars, step.prop, 0,
+                          step.opr_name);
+        }
+        on_complete();
+      }, {}, {}, FnProperty::kNormal, "Replay");
+  }
+
   void WaitForAll() override {
   }
 
@@ -180,20 +226,44 @@ class NaiveEngine final : public Engine {
   }
 
  private:
+  /*! \brief an operation recorded between StartRecord and StopRecord */
+  struct RecordedOpr {
+    AsyncFn fn;
+    Context ctx;
+    FnProperty prop;
+    const char* opr_name;
+    /*! \brief written variables, whose versions a replay still advances */
+    std::vector<VarHandle> mutable_vars;
+  };
+  /*! \brief scope in which pushes are not recorded */
+  struct RecordPause {
+    explicit RecordPause(NaiveEngine* engine) : engine_(engine) { ++engine_->record_paused_; }
+    ~RecordPause() { --engine_->record_paused_; }
+    NaiveEngine* engine_;
+  };
+  // add an operation to the recording
+  inline void Record(const AsyncFn& fn, Context ctx, FnProperty prop, const char* opr_name,
+                     const std::vector<VarHandle>& mutable_vars) {
+    if (recording_ && !record_paused_ && prop != FnProperty::kDeleteVar) {
+      recorded_.push_back(RecordedOpr{fn, ctx, prop, opr_name, mutable_vars});
+    }
+  }
   // callback to oncomplete
   static void OnComplete(Engine *engine, void *param) {
     static_cast<NaiveEngine*>(engine)->req_completed_ = true;
   }
   // whether action is completed
   bool req_completed_;
-  // counter
-  std::atomic<size_t> counter_{0};
   /*! \brief whether it is during shutdown phase*/
   std::atomic<bool> shutdown_phase_{false};
   // CPU stream
   mshadow::Stream<cpu> cpu_stream_;
   // GPU streams
   std::vector<mshadow::Stream<gpu>*> streams_;
+  // recording state
+  bool recording_{false};
+  int record_paused_{0};
+  std::vector<RecordedOpr> recorded_;
 };  // class NaiveEngine
 
 Engine *CreateNaiveEngine() {
@@ -40,6 +40,7 @@ OpenMP *OpenMP::Get() {
 
 OpenMP::OpenMP()
   : omp_num_threads_set_in_environment_(is_env_set("OMP_NUM_THREADS")) {
+  core_budget_ = dmlc::GetEnv("MXNET_OMP_CORE_BUDGET", true);
 #ifdef _OPENMP
   const int max = dmlc::GetEnv("MXNET_OMP_MAX_THREADS", INT_MIN);
   if (max != INT_MIN) {
@@ -61,10 +62,12 @@ OpenMP::OpenMP()
 #endif
 }
 
-void OpenMP::on_start_worker_thread(bool use_omp) {
+void OpenMP::on_start_worker_thread(bool use_omp, int max_threads) {
 #ifdef _OPENMP
   if (!omp_num_threads_set_in_environment_) {
-    omp_set_num_threads(use_omp ? GetRecommendedOMPThreadCount(true) : 1);
+    int nthreads = use_omp ? GetRecommendedOMPThreadCount(true) : 1;
+    if (max_threads > 0 && nthreads > max_threads) nthreads = max_threads;
+    omp_set_num_threads(nthreads);
   }
 #endif
 }
@@ -96,10 +99,17 @@ int OpenMP::GetRecommendedOMPThreadCount(bool exclude_reserved) const {
       }
     }
     // Check that OMP doesn't suggest more than our 'omp_thread_max_' value
-    if (!omp_thread_max_ || thread_count < omp_thread_max_) {
-      return thread_count;
+    if (omp_thread_max_ && thread_count > omp_thread_max_) {
+      thread_count = omp_thread_max_;
     }
-    return omp_thread_max_;
+    // Split the threads between the operations running concurrently
+    if (core_budget_) {
+      const int running_ops = running_ops_.load(std::memory_order_relaxed);
+      if (running_ops > 1) {
+        thread_count = thread_count > running_ops ? thread_count / running_ops : 1;
+      }
+    }
+    return thread_count;
   }
   return 1;
 #else
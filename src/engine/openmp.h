@@ -19,6 +19,8 @@
 #ifndef MXNET_ENGINE_OPENMP_H_
 #define MXNET_ENGINE_OPENMP_H_
 
+#include <atomic>
+
 namespace mxnet {
 namespace engine {
 
@@ -71,8 +73,24 @@ class OpenMP {
    * \brief Call at the beginning of a worker thread's life.  This will set the omp_num_threads
    *        for omp regions created by this thread
    * \param use_omp true if this thread plans to utilize parallel omp regions
+   * \param max_threads if positive, the most threads omp regions of this thread use,
+   *        for a thread pinned to a part of the machine
+   */
+  void on_start_worker_thread(bool use_omp, int max_threads = 0);
+
+  /*!
+   * \brief Mark an operation starting or ending on a CPU worker.  While several run,
+   *        GetRecommendedOMPThreadCount() gives each an equal share of the threads,
+   *        so concurrent operations do not oversubscribe the cores
    */
-  void on_start_worker_thread(bool use_omp);
+  void on_start_op() { running_ops_.fetch_add(1, std::memory_order_relaxed); }
+  void on_end_op() { running_ops_.fetch_sub(1, std::memory_order_relaxed); }
+  /*! \brief Scope of an operation's share of the OMP threads */
+  class OpScope {
+   public:
+    OpScope() { OpenMP::Get()->on_start_op(); }
+    ~OpScope() { OpenMP::Get()->on_end_op(); }
+  };
 
   /*!
    * \brief Get the OpenMP object's singleton pointer
@@ -94,6 +112,14 @@ class OpenMP {
    * \brief Number of cores to reserve for non-OMP regions
    */
   volatile int reserve_cores_ = 0;
+  /*!
+   * \brief Whether the operations in flight share the OMP threads, MXNET_OMP_CORE_BUDGET
+   */
+  bool core_budget_ = true;
+  /*!
+   * \brief Number of operations running on CPU workers
+   */
+  std::atomic<int> running_ops_{0};
   /*!
    * \brief Whether OMP_NUM_THREADS was set in the environment.  If it is, we fall back to
    *        the OMP's implementation's handling of that environment variable
@@ -0,0 +1,102 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file parallel_for_pool.cc
+ * \brief persistent pool of spinning worker threads for the parallel loops of CPU kernels
+ */
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include "./openmp.h"
+#include "./parallel_for_pool.h"
+
+namespace mxnet {
+namespace engine {
+
+ParallelForPool *ParallelForPool::Get() {
+  // never destroyed, the workers may still be polling while static objects go away at exit
+  static ParallelForPool *pool = dmlc::GetEnv("MXNET_CPU_PARALLEL_POOL", false) ?
+    new ParallelForPool(std::max(OpenMP::Get()->thread_max() - 1, 0)) : nullptr;
+  return pool;
+}
+
+ParallelForPool::ParallelForPool(int nworkers)
+  : spin_count_(dmlc::GetEnv("MXNET_CPU_PARALLEL_POOL_SPIN", 1 << 16)) {
+  for (int i = 0; i < nworkers; ++i) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ParallelForPool::~ParallelForPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  for (std::thread &t : workers_) t.join();
+}
+
+void ParallelForPool::Run(int64_t n, int nchunks, ChunkFn fn, const void *f) {
+  n_ = n;
+  fn_ = fn;
+  f_ = f;
+  done_.store(0, std::memory_order_relaxed);
+  // publishing the chunk count releases the loop to the workers
+  state_.store(static_cast<uint64_t>(nchunks) << 32);
+  if (sleeping_.load() > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_all();
+  }
+  RunChunks();
+  while (done_.load(std::memory_order_acquire) < nchunks) std::this_thread::yield();
+}
+
+void ParallelForPool::RunChunks() {
+  uint64_t state = state_.load(std::memory_order_acquire);
+  while (true) {
+    const uint64_t chunk = state & 0xffffffffULL, nchunks = state >> 32;
+    if (chunk >= nchunks) return;
+    // a claimed chunk keeps its loop, and so n_, fn_ and f_, from completing
+    if (!state_.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel)) continue;
+    const int64_t begin = n_ * static_cast<int64_t>(chunk) / static_cast<int64_t>(nchunks);
+    const int64_t end = n_ * static_cast<int64_t>(chunk + 1) / static_cast<int64_t>(nchunks);
+    fn_(f_, begin, end);
+    done_.fetch_add(1, std::memory_order_release);
+    state = state_.load(std::memory_order_acquire);
+  }
+}
+
+void ParallelForPool::WorkerLoop() {
+  OpenMP::Get()->on_start_worker_thread(false);
+  while (!shutdown_.load(std::memory_order_relaxed)) {
+    int polls = 0;
+    while (!HasWork() && polls < spin_count_) ++polls;
+    if (!HasWork()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++sleeping_;
+      cv_.wait(lock, [this]() { return HasWork() || shutdown_; });
+      --sleeping_;
+    }
+    RunChunks();
+  }
+}
+
+}  // namespace engine
+}  // namespace mxnet
@@ -0,0 +1,117 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file parallel_for_pool.h
+ * \brief persistent pool of spinning worker threads for the parallel loops of CPU kernels
+ */
+#ifndef MXNET_ENGINE_PARALLEL_FOR_POOL_H_
+#define MXNET_ENGINE_PARALLEL_FOR_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mxnet {
+namespace engine {
+
+/*!
+ * \brief Pool of worker threads kept alive between the parallel loops of CPU kernels.
+ *        The workers spin for a while after a loop and then sleep, so the loops of
+ *        consecutive small operators do not pay to fork and join an OMP team each time.
+ *        Enabled by MXNET_CPU_PARALLEL_POOL, the parallel loops use OMP otherwise.
+ */
+class ParallelForPool {
+ public:
+  /*!
+   * \brief Get the pool singleton
+   * \return the pool, nullptr unless MXNET_CPU_PARALLEL_POOL is set
+   */
+  static ParallelForPool *Get();
+
+  /*!
+   * \brief Run f(begin, end) over the contiguous chunks of [0, n).
+   *        The calling thread runs chunks too, so the loop completes even when
+   *        no worker wakes up in time.
+   * \param n number of iterations
+   * \param nthreads number of chunks, at most the threads of the pool and the caller
+   * \param f the loop body over a range of iterations
+   * \return false, running nothing, when the pool is busy with the loop of another thread
+   *         or of an enclosing chunk; the caller runs the loop its own way then
+   */
+  template<typename F>
+  bool ParallelFor(int64_t n, int nthreads, const F &f) {
+    if (busy_.test_and_set(std::memory_order_acquire)) return false;
+    const int nchunks = static_cast<int>(std::min<int64_t>(
+      n, std::min(nthreads, static_cast<int>(workers_.size()) + 1)));
+    if (nchunks > 0) Run(n, nchunks, &ParallelForPool::Invoke<F>, &f);
+    busy_.clear(std::memory_order_release);
+    return true;
+  }
+
+  ~ParallelForPool();
+
+ private:
+  typedef void (*ChunkFn)(const void *f, int64_t begin, int64_t end);
+
+  explicit ParallelForPool(int nworkers);
+
+  template<typename F>
+  static void Invoke(const void *f, int64_t begin, int64_t end) {
+    (*static_cast<const F *>(f))(begin, end);
+  }
+
+  /*! \brief publish a loop, run chunks of it, and wait for the workers' chunks */
+  void Run(int64_t n, int nchunks, ChunkFn fn, const void *f);
+  /*! \brief run chunks of the current loop until none is left */
+  void RunChunks();
+  /*! \brief whether the current loop has chunks nobody claimed yet */
+  bool HasWork() const {
+    const uint64_t state = state_.load();
+    return (state & 0xffffffffULL) < (state >> 32);
+  }
+  void WorkerLoop();
+
+  /*! \brief number of chunks in the high half, the next chunk to claim in the low half */
+  std::atomic<uint64_t> state_{0};
+  /*! \brief number of chunks of the current loop that completed */
+  std::atomic<int> done_{0};
+  /*! \brief the current loop, written before state_ publishes it */
+  int64_t n_ = 0;
+  ChunkFn fn_ = nullptr;
+  const void *f_ = nullptr;
+  /*! \brief taken by the thread whose loop the pool runs */
+  std::atomic_flag busy_ = ATOMIC_FLAG_INIT;
+  /*! \brief number of polls before an idle worker sleeps, MXNET_CPU_PARALLEL_POOL_SPIN */
+  int spin_count_;
+  std::atomic<int> sleeping_{0};
+  std::atomic<bool> shutdown_{false};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace engine
+}  // namespace mxnet
+#endif  // MXNET_ENGINE_PARALLEL_FOR_POOL_H_
@@ -38,7 +38,8 @@ namespace engine {
  * \brief Stream manager.
  *
  * Uses a basic round-robin algorithm to dispatch GPU streams. Returns default
- * context on CPU.
+ * context on CPU. Copies to and from a GPU get one stream per direction, so
+ * uploads and downloads overlap on full-duplex links.
  */
 template <std::size_t kNumGpus, std::size_t kStreams>
 class StreamManager {
@@ -48,14 +49,19 @@ class StreamManager {
     Finalize();
   }
   RunContext GetRunContext(Context const& ctx);
-  RunContext GetIORunContext(Context const& ctx);
+  /*!
+   * \brief the copy stream of a device
+   * \param to_gpu whether it is for copies to the device, or from the device otherwise
+   */
+  RunContext GetIORunContext(Context const& ctx, bool to_gpu);
   void Finalize();
  private:
   std::mutex mutex_;
 #if MXNET_USE_CUDA
   std::array<std::array<mshadow::Stream<gpu>*, kStreams>, kNumGpus>
       gpu_streams_;
-  std::array<mshadow::Stream<gpu>*, kNumGpus> gpu_io_streams_;
+  // copies from and to the device, indexed by to_gpu
+  std::array<std::array<mshadow::Stream<gpu>*, 2>, kNumGpus> gpu_io_streams_;
   std::array<int, kNumGpus> gpu_cnt_;
 #endif  // MXNET_USE_CUDA
   DISALLOW_COPY_AND_ASSIGN(StreamManager);
@@ -99,7 +105,7 @@ RunContext StreamManager<kNumGpus, kStreams>::GetRunContext(
 
 template <std::size_t kNumGpus, std::size_t kStreams>
 RunContext StreamManager<kNumGpus, kStreams>::GetIORunContext(
-    Context const& ctx) {
+    Context const& ctx, bool to_gpu) {
   RunContext ret;
   switch (ctx.dev_mask()) {
     case cpu::kDevMask:
@@ -110,11 +116,12 @@ RunContext StreamManager<kNumGpus, kStreams>::GetIORunContext(
       CUDA_CALL(cudaSetDevice(ctx.dev_id));
       {
         std::lock_guard<std::mutex> lock{mutex_};
-        if (gpu_io_streams_.at(ctx.dev_id) == nullptr) {
-          gpu_io_streams_.at(ctx.dev_id) = mshadow::NewStream<gpu>(false, false, ctx.dev_id);
+        auto&& stream = gpu_io_streams_.at(ctx.dev_id).at(to_gpu);
+        if (stream == nullptr) {
+          stream = mshadow::NewStream<gpu>(false, false, ctx.dev_id);
         }
       }
-      ret = RunContext{ctx, gpu_io_streams_.at(ctx.dev_id)};
+      ret = RunContext{ctx, gpu_io_streams_.at(ctx.dev_id).at(to_gpu)};
       break;
 #else
       LOG(FATAL) << MXNET_GPU_NOT_ENABLED_ERROR;
@@ -133,7 +140,7 @@ StreamManager<kNumGpus, kStreams>::StreamManager() {
     gpu_cnt_.at(i) = -1;
   }
   for (auto&& i : gpu_io_streams_) {
-    i = nullptr;
+    i.fill(nullptr);
   }
 #endif  // MXNET_USE_CUDA
 }
@@ -149,6 +156,12 @@ void StreamManager<kNumGpus, kStreams>::Finalize() {
       }
       gpu_cnt_.at(i) = -1;
     }
+    for (auto&& j : gpu_io_streams_.at(i)) {
+      if (j != nullptr) {
+        MSHADOW_CATCH_ERROR(mshadow::DeleteStream<gpu>(j));
+        j = nullptr;
+      }
+    }
   }
 #endif  // MXNET_USE_CUDA
 }
@@ -26,9 +26,13 @@
 #include <dmlc/logging.h>
 #include <cassert>
 #include <algorithm>
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include "./threaded_engine.h"
 #include "../common/cuda_utils.h"
 
@@ -42,6 +46,9 @@ std::atomic<std::size_t> ThreadedVar::counter{0};
 std::atomic<std::size_t> ThreadedOpr::counter{0};
 #endif  // ENGINE_DEBUG
 
+constexpr int ThreadedVar::kWritePending;
+constexpr size_t ThreadedOpr::kInlineVars;
+
 ThreadedVar::ThreadedVar(VersionedVarBlock* head) : head_{head} {
 #if ENGINE_DEBUG
   LOG(INFO) << __func__ << " " << ++counter;
@@ -49,24 +56,28 @@ ThreadedVar::ThreadedVar(VersionedVarBlock* head) : head_{head} {
 }
 
 inline void ThreadedVar::AppendReadDependency(OprBlock* opr_block) {
+  // fast path, no write on the var is pending
+  if (TryAddRead()) {
+    opr_block->decr_wait();
+    return;
+  }
   std::lock_guard<std::mutex> lock{mutex_};
-  if (pending_write_ == nullptr) {
-    // invariant: is_ready_to_read()
-    CHECK_GE(num_pending_reads_, 0);
-    // STATE CHANGE
-    ++num_pending_reads_;
-    // decrease wait counter
+  // the pending write may have completed in between, and kWritePending only
+  // changes with the lock held
+  if (TryAddRead()) {
     opr_block->decr_wait();
-  } else {
-    auto&& new_var_block = VersionedVarBlock::New();
-    assert(head_->next == nullptr);
-    assert(head_->trigger == nullptr);
-    assert(head_->write == false);
-    // append things to next.
-    head_->next = new_var_block;
-    head_->trigger = opr_block;
-    head_ = new_var_block;
+    return;
   }
+  assert(pending_write_ != nullptr);
+  InheritPriority(opr_block);
+  auto&& new_var_block = VersionedVarBlock::New();
+  assert(head_->next == nullptr);
+  assert(head_->trigger == nullptr);
+  assert(head_->write == false);
+  // append things to next.
+  head_->next = new_var_block;
+  head_->trigger = opr_block;
+  head_ = new_var_block;
 }
 
 inline void ThreadedVar::AppendWriteDependency(OprBlock* opr_block) {
@@ -85,37 +96,42 @@ inline void ThreadedVar::AppendWriteDependency(OprBlock* opr_block) {
   if (pending_write_ == nullptr) {
     // invariant: is_ready_to_read()
     pending_write_ = head_;
-    CHECK_GE(num_pending_reads_, 0);
-    if (num_pending_reads_ == 0) {
-      // STATE CHANGE
+    // STATE CHANGE, from here on the last running read triggers the write
+    const int state = num_pending_reads_.fetch_or(kWritePending, std::memory_order_acq_rel);
+    CHECK_EQ(state & kWritePending, 0);
+    if (state == 0) {
       opr_block->decr_wait();
-      num_pending_reads_ = kWriteTriggered;
     }
   } else {
-    CHECK_NE(num_pending_reads_, 0);
+    CHECK_NE(num_pending_reads_.load(std::memory_order_relaxed) & kWritePending, 0);
+    InheritPriority(opr_block);
   }
   head_ = new_var_block;
 }
 
+inline void ThreadedVar::InheritPriority(const OprBlock* opr_block) {
+  const int priority = opr_block->priority.load(std::memory_order_relaxed);
+  if (priority <= 0) return;
+  // the operations in [pending_write_, head_) wait for this var and are only
+  // dispatched by its completions, which need the lock, so they are alive
+  for (VersionedVarBlock* blk = pending_write_; blk != head_; blk = blk->next) {
+    blk->trigger->inherit_priority(priority);
+  }
+}
+
 template <typename Dispatcher>
 inline void ThreadedVar::CompleteReadDependency(Dispatcher dispatcher) {
-  OprBlock *trigger = nullptr;
-  {
-    // this is lock scope
-    std::lock_guard<std::mutex> lock{mutex_};
-    CHECK_GT(num_pending_reads_, 0);
-
-    if (--num_pending_reads_ == 0) {
-      if (pending_write_ != nullptr) {
-        // STATE CHANGE
-        trigger = pending_write_->trigger;
-        num_pending_reads_ = kWriteTriggered;
-      }
+  const int prev = num_pending_reads_.fetch_sub(1, std::memory_order_acq_rel);
+  CHECK_GT(prev & ~kWritePending, 0);
+  if (prev - 1 == kWritePending) {
+    // STATE CHANGE, the last read before the pending write. pending_write_
+    // was published before kWritePending and only changes once this write
+    // completes, so it is safe to read without the lock.
+    OprBlock *trigger = pending_write_->trigger;
+    if (trigger->decr_wait() == 0) {
+      dispatcher(trigger);
     }
   }
-  if (trigger != nullptr && trigger->decr_wait() == 0) {
-    dispatcher(trigger);
-  }
 }
 
 template <typename Dispatcher>
@@ -128,7 +144,7 @@ inline bool ThreadedVar::CompleteWriteDependency(Dispatcher dispatcher) {
     // invariants
     assert(head_->next == nullptr);
     assert(pending_write_ != nullptr);
-    CHECK_EQ(num_pending_reads_, kWriteTriggered);
+    CHECK_EQ(num_pending_reads_.load(std::memory_order_relaxed), kWritePending);
 
     // really delete
     if (to_delete_) {
@@ -138,26 +154,30 @@ inline bool ThreadedVar::CompleteWriteDependency(Dispatcher dispatcher) {
       VersionedVarBlock::Delete(head);
       return true;
     }
+    ++version_;
     // detach pending write
     old_pending_write = pending_write_;
     // search for chains to trigger
     end_of_read_chain = old_pending_write->next;
-    // reset to 0 pending reads
-    num_pending_reads_ = 0;
+    // count the queued reads up to the next write
+    int num_reads = 0;
     while (end_of_read_chain != head_ &&
            end_of_read_chain->write == false) {
-      ++num_pending_reads_;
+      ++num_reads;
       end_of_read_chain = end_of_read_chain->next;
     }
+    // no read runs and readers do not touch the state while kWritePending
+    // is set, so it can be stored directly
     if (end_of_read_chain == head_) {
       pending_write_ = nullptr;
+      num_pending_reads_.store(num_reads, std::memory_order_release);
     } else {
       // check if there is pending reads, if not trigger write
       assert(end_of_read_chain->write == true);
       pending_write_ = end_of_read_chain;
-      if (num_pending_reads_ == 0) {
-        // mark write as already activated in this var
-        num_pending_reads_ = kWriteTriggered;
+      num_pending_reads_.store(kWritePending | num_reads, std::memory_order_release);
+      if (num_reads == 0) {
+        // the write is activated right away
         trigger_write = end_of_read_chain->trigger;
       }
     }
@@ -192,7 +212,6 @@ inline void ThreadedVar::SetToDelete() {
 }
 
 inline bool ThreadedVar::ready_to_read() {
-  std::lock_guard<std::mutex> lock{mutex_};
   return this->is_ready_to_read();
 }
 
@@ -270,6 +289,8 @@ void ThreadedEngine::DeleteOperator(OprHandle op) {
   deps.insert(deps.end(),
               threaded_opr->mutable_vars.begin(),
               threaded_opr->mutable_vars.end());
+  // a replay must not delete the operator again
+  RecordPause pause;
   this->PushAsync([threaded_opr](RunContext, CallbackOnComplete on_complete) {
       ThreadedOpr::Delete(threaded_opr);
       on_complete();
@@ -279,6 +300,16 @@ void ThreadedEngine::DeleteOperator(OprHandle op) {
 
 void ThreadedEngine::Push(OprHandle op, Context exec_ctx, int priority, bool profiling) {
   ThreadedOpr* threaded_opr = ThreadedOpr::CastFromBase(op);
+  RecordStatus& record = *RecordStatusStore::Get();
+  if (record.recording && !record.paused && !threaded_opr->wait &&
+      threaded_opr->prop != FnProperty::kDeleteVar) {
+    Record(threaded_opr, exec_ctx, priority);
+  }
+  Schedule(threaded_opr, exec_ctx, priority, profiling);
+}
+
+void ThreadedEngine::Schedule(ThreadedOpr* threaded_opr, Context exec_ctx,
+                              int priority, bool profiling) {
   OprBlock* opr_block = OprBlock::New();
   opr_block->opr = threaded_opr;
 
@@ -288,6 +319,7 @@ void ThreadedEngine::Push(OprHandle op, Context exec_ctx, int priority, bool pro
   opr_block->ctx = exec_ctx;
   opr_block->priority = priority;
   opr_block->profiling = profiling;
+  if (trace_) opr_block->trace.reset(trace_->NewTrace());
   ++pending_;
   // Add read dependencies.
   for (auto&& i : threaded_opr->const_vars) {
@@ -298,6 +330,7 @@ void ThreadedEngine::Push(OprHandle op, Context exec_ctx, int priority, bool pro
     i->AppendWriteDependency(opr_block);
   }
   if (opr_block->decr_wait() == 0) {
+    MarkReady(opr_block, nullptr, 0);
     this->PushToExecute(opr_block, true);
   }
 }
@@ -370,6 +403,19 @@ void ThreadedEngine::WaitForVar(VarHandle var) {
     ThrowException(threaded_var);
     return;
   }
+  if (wait_spin_us_ > 0) {
+    // a short wait completes faster by polling than through a pushed
+    // operation and the wakeup of this thread
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::microseconds(wait_spin_us_);
+    while (!threaded_var->ready_to_read()) {
+      if (std::chrono::steady_clock::now() >= deadline) break;
+    }
+    if (threaded_var->ready_to_read()) {
+      ThrowException(threaded_var);
+      return;
+    }
+  }
   if (engine_info_) {
     LOG(INFO) << "Wait for " << threaded_var;
     debug_wait_var_ = threaded_var;
@@ -400,6 +446,11 @@ void ThreadedEngine::WaitForVar(VarHandle var) {
   ThrowException(threaded_var);
 }
 
+bool ThreadedEngine::IsVarReady(VarHandle var) {
+  BulkFlush();
+  return ThreadedVar::CastFromBase(var)->ready_to_read();
+}
+
 void ThreadedEngine::WaitForAll() {
   BulkFlush();
   std::unique_lock<std::mutex> lock{finished_m_};
@@ -408,12 +459,14 @@ void ThreadedEngine::WaitForAll() {
     });
 }
 
-inline void ThreadedEngine::OnComplete(ThreadedOpr* threaded_opr) {
+inline void ThreadedEngine::OnComplete(ThreadedOpr* threaded_opr, uint64_t trace_id) {
   bool is_temporary_opr = threaded_opr->temporary;
   // Mark complete for read variables
   for (auto&& i : threaded_opr->const_vars) {
-    i->CompleteReadDependency(
-        [this](OprBlock* opr) { this->PushToExecute(opr, false); });
+    i->CompleteReadDependency([this, i, trace_id](OprBlock* opr) {
+      MarkReady(opr, i, trace_id);
+      this->PushToExecute(opr, false);
+    });
   }
   // Mark complete for write variables.
   for (auto&& i : threaded_opr->mutable_vars) {
@@ -425,11 +478,12 @@ inline void ThreadedEngine::OnComplete(ThreadedOpr* threaded_opr) {
       LOG(INFO) << "Complete write dep for " << i;
     }
     const bool to_delete =
-        i->CompleteWriteDependency([this, debug_info](OprBlock* opr) {
+        i->CompleteWriteDependency([this, debug_info, i, trace_id](OprBlock* opr) {
           if (debug_info) {
             LOG(INFO) << "PushToExecute " << opr;
             debug_push_opr_ = opr;
           }
+          MarkReady(opr, i, trace_id);
           this->PushToExecute(opr, false);
           if (debug_info) {
             LOG(INFO) << "Fin PushToExecute " << opr;
@@ -477,9 +531,164 @@ void ThreadedEngine::OnCompleteStatic(
     // record operator end timestamp
     opr_block->opr_profile->stop();
   }
-  static_cast<ThreadedEngine*>(engine)->OnComplete(threaded_opr);
+  ThreadedEngine* threaded_engine = static_cast<ThreadedEngine*>(engine);
+  if (opr_block->sample_start) {
+    threaded_engine->profiler_->sampler()->Add(
+        threaded_opr->opr_name,
+        profiler::ProfileStat::NowInMicrosec() - opr_block->sample_start);
+  }
+  uint64_t trace_id = 0;
+  if (opr_block->trace) {
+    // written before the dependents are triggered, as threaded_opr may be
+    // deleted once they run
+    trace_id = opr_block->trace->id;
+    threaded_engine->trace_->Write(*opr_block->trace, threaded_opr->opr_name,
+                                   opr_block->ctx, threaded_opr->prop);
+  }
+  threaded_engine->OnComplete(threaded_opr, trace_id);
   OprBlock::Delete(opr_block);
 }
 
+void ThreadedEngine::StartRecord() {
+  BulkFlush();
+  RecordStatus& record = *RecordStatusStore::Get();
+  CHECK(!record.recording) << "The engine is already recording on this thread";
+  record.recording = std::make_shared<Recording>();
+}
+
+Engine::OprHandle ThreadedEngine::StopRecord() {
+  RecordStatus& record = *RecordStatusStore::Get();
+  CHECK(record.recording) << "The engine is not recording on this thread";
+  std::shared_ptr<Recording> rec = std::move(record.recording);
+  record.recording.reset();
+  if (rec->nodes.empty()) return nullptr;
+
+  // an operation depends on the last write of the variables it uses, and a
+  // write also on the reads since the last write
+  struct VarState {
+    int last_write = -1;
+    std::vector<int> reads;
+  };
+  std::unordered_map<ThreadedVar*, VarState> vars;
+  std::vector<VarHandle> const_vars, mutable_vars;
+  Recording* raw = rec.get();
+  for (int i = 0; i < static_cast<int>(rec->nodes.size()); ++i) {
+    Recording::Node& node = *rec->nodes[i];
+    std::vector<int> preds;
+    for (ThreadedVar* var : node.const_vars) {
+      VarState& state = vars[var];
+      if (state.last_write >= 0) preds.push_back(state.last_write);
+      state.reads.push_back(i);
+      const_vars.push_back(var);
+    }
+    for (ThreadedVar* var : node.mutable_vars) {
+      VarState& state = vars[var];
+      if (state.last_write >= 0) preds.push_back(state.last_write);
+      preds.insert(preds.end(), state.reads.begin(), state.reads.end());
+      state.reads.clear();
+      state.last_write = i;
+      mutable_vars.push_back(var);
+    }
+    std::sort(preds.begin(), preds.end());
+    preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+    for (int p : preds) rec->nodes[p]->succ.push_back(i);
+    node.num_pred = static_cast<int>(preds.size());
+    if (preds.empty()) rec->roots.push_back(i);
+    node.const_vars.clear();
+    node.mutable_vars.clear();
+    node.rec = raw;
+    // the operations run without variables, their order comes from the
+    // recording, and the replay operator owns rec and frees them with it
+    node.opr = NewOperator([this, raw, i](RunContext ctx, CallbackOnComplete on_complete) {
+        this->RunRecorded(raw, i, ctx, on_complete);
+      }, {}, {}, node.prop, node.opr_name);
+  }
+  // replays of the operator run one at a time
+  rec->var = NewVariable();
+  mutable_vars.push_back(rec->var);
+  DeduplicateVarHandle(&const_vars, &mutable_vars);
+  rec->opr = NewOperator([this, rec](RunContext, CallbackOnComplete on_complete) {
+      this->Replay(rec.get(), on_complete);
+    }, const_vars, mutable_vars, FnProperty::kAsync, "Replay");
+  return rec->opr;
+}
+
+inline void ThreadedEngine::Record(ThreadedOpr* threaded_opr, Context exec_ctx, int priority) {
+  std::unique_ptr<Recording::Node> node(new Recording::Node());
+  node->fn = threaded_opr->fn;
+  node->ctx = exec_ctx;
+  node->prop = threaded_opr->prop;
+  node->priority = priority;
+  node->opr_name = threaded_opr->opr_name;
+  node->const_vars.assign(threaded_opr->const_vars.begin(), threaded_opr->const_vars.end());
+  node->mutable_vars.assign(threaded_opr->mutable_vars.begin(), threaded_opr->mutable_vars.end());
+  RecordStatusStore::Get()->recording->nodes.push_back(std::move(node));
+}
+
+void ThreadedEngine::Replay(Recording* rec, const CallbackOnComplete& on_complete) {
+  for (auto& node : rec->nodes) node->pending.store(node->num_pred, std::memory_order_relaxed);
+  rec->remaining.store(static_cast<int>(rec->nodes.size()), std::memory_order_relaxed);
+  rec->exception = nullptr;
+  rec->failed.store(false, std::memory_order_relaxed);
+  rec->on_complete = on_complete;
+  const bool profiling = profiler_->IsProfiling(profiler::Profiler::kImperative);
+  for (int i : rec->roots) {
+    const Recording::Node& node = *rec->nodes[i];
+    Schedule(node.opr, node.ctx, node.priority, profiling);
+  }
+}
+
+void ThreadedEngine::RunRecorded(Recording* rec, int i, RunContext ctx,
+                                 const CallbackOnComplete& on_complete) {
+  Recording::Node& node = *rec->nodes[i];
+  node.on_complete = on_complete;
+  CallbackOnComplete done = CreateCallback(ThreadedEngine::OnRecordedCompleteStatic, &node);
+  // after a failure the remaining operations only complete, as in OnStart
+  if (rec->failed.load(std::memory_order_acquire)) {
+    done();
+    return;
+  }
+  try {
+    node.fn(ctx, done);
+  } catch (dmlc::Error& e) {
+    {
+      std::lock_guard<std::mutex> lock(rec->mutex);
+      if (!rec->exception) rec->exception = std::current_exception();
+    }
+    rec->failed.store(true, std::memory_order_release);
+    done();
+  }
+}
+
+void ThreadedEngine::OnRecordedCompleteStatic(Engine *engine, void *node_) {
+  ThreadedEngine* threaded_engine = static_cast<ThreadedEngine*>(engine);
+  Recording::Node* node = static_cast<Recording::Node*>(node_);
+  Recording* rec = node->rec;
+  node->on_complete();
+  const bool profiling = threaded_engine->profiler_->IsProfiling(profiler::Profiler::kImperative);
+  for (int s : node->succ) {
+    const Recording::Node& succ = *rec->nodes[s];
+    if (rec->nodes[s]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      threaded_engine->Schedule(succ.opr, succ.ctx, succ.priority, profiling);
+    }
+  }
+  if (rec->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // the variables of the replay get the error of a failed operation
+    if (rec->exception) {
+      rec->opr->opr_exception = std::make_shared<std::exception_ptr>(rec->exception);
+    }
+    rec->on_complete();
+  }
+}
+
+ThreadedEngine::Recording::~Recording() {
+  for (auto& node : nodes) {
+    if (node->opr != nullptr) ThreadedOpr::Delete(node->opr);
+  }
+  if (var != nullptr) {
+    Engine::Get()->DeleteVariable([](RunContext) {}, Context::CPU(), var);
+  }
+}
+
 }  // namespace engine
 }  // namespace mxnet
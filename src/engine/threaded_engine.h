@@ -30,6 +30,7 @@
 #include <dmlc/base.h>
 #include <dmlc/logging.h>
 #include <dmlc/omp.h>
+#include <mxnet/storage.h>
 #include <vector>
 #include <functional>
 #include <condition_variable>
@@ -39,9 +40,12 @@
 #include <string>
 #include <thread>
 #include "./engine_impl.h"
+#include "./engine_trace.h"
 #include "../profiler/profiler.h"
+#include "../profiler/nvtx.h"
 #include "./openmp.h"
 #include "../common/object_pool.h"
+#include "../common/small_vector.h"
 
 namespace mxnet {
 namespace engine {
@@ -72,14 +76,31 @@ struct OprBlock : public common::ObjectPoolAllocatable<OprBlock> {
   ThreadedOpr* opr{nullptr};
   /*! \brief The context this operator */
   Context ctx;
-  /*! \brief priority of the function */
-  int priority;
+  /*!
+   * \brief priority of the function, raised while a positive priority
+   *  operation waits behind this one on a variable
+   */
+  std::atomic<int> priority{0};
   /*! \brief indicate whether to profile this operator */
   bool profiling{false};
   /*! \brief operator execution statistics */
   std::unique_ptr<profiler::ProfileOperator> opr_profile;
+  /*! \brief start time in microseconds when the operator is sampled, otherwise 0 */
+  uint64_t sample_start{0};
+  /*! \brief microseconds timestamp of when it was pushed to a worker queue */
+  uint64_t queued{0};
+  /*! \brief scheduling timestamps, set when the engine trace is enabled */
+  std::unique_ptr<OprTrace> trace;
   // define possible debug information
   DEFINE_ENGINE_DEBUG_INFO(OprBlock);
+  /*!
+   * \brief raise the priority to at least the given one.
+   * \param p the priority of an operation waiting for this one.
+   */
+  inline void inherit_priority(int p) {
+    int cur = priority.load(std::memory_order_relaxed);
+    while (cur < p && !priority.compare_exchange_weak(cur, p, std::memory_order_relaxed)) {}
+  }
   /*!
    * \brief call this function to decrease the wait counter.
    * \return the wait counter after the decreasement.
@@ -179,15 +200,20 @@ class ThreadedVar final
   std::shared_ptr<std::exception_ptr> var_exception;
 
  private:
-  // TODO(hotpxl) change this to spinlock for faster runtime
   // TODO(hotpxl) consider rename head
-  /*! \brief inetrnal mutex of the ThreadedVar */
+  /*!
+   * \brief inetrnal mutex of the ThreadedVar, guards the version list and
+   *  pending_write_, reads on a var without a pending write never take it
+   */
   std::mutex mutex_;
   /*!
-   * \brief number of pending reads operation in the variable.
-   *  will be marked as -1 when there is a already triggered pending write.
+   * \brief number of running reads on the variable, or-ed with kWritePending
+   *  while pending_write_ is set. The pending write is triggered by whoever
+   *  brings the state to exactly kWritePending, which happens once.
+   *  Readers only change it by CAS while kWritePending is clear, and
+   *  kWritePending is only changed with mutex_ held.
    */
-  int num_pending_reads_{0};
+  std::atomic<int> num_pending_reads_{0};
   /*!
    * \brief Points to the last VersionedVarBlock in the queue.
    *  head_ always points to a empty VersionedVarBlock.
@@ -207,14 +233,34 @@ class ThreadedVar final
    * \brief If true, delete after operation completes.
    */
   bool to_delete_{false};
-  /*! \brief special const on num_pending_reads_ to mark write being triggered */
-  static constexpr int kWriteTriggered = -1;
+  /*!
+   * \brief raise the operations queued on this variable to the priority of
+   *  opr_block, if it is positive. Needs the lock.
+   */
+  inline void InheritPriority(const OprBlock* opr_block);
+  /*! \brief flag in num_pending_reads_ marking a pending write */
+  static constexpr int kWritePending = 1 << 30;
   /*!
    * \brief derived invariant of ready to ready, without lock.
    * \return whether the current variable is ready to read.
    */
   inline bool is_ready_to_read() const {
-    return pending_write_ == nullptr;
+    return (num_pending_reads_.load(std::memory_order_acquire) & kWritePending) == 0;
+  }
+  /*!
+   * \brief count a read if no write is pending, without taking the lock.
+   * \return whether the read was counted.
+   */
+  inline bool TryAddRead() {
+    int state = num_pending_reads_.load(std::memory_order_relaxed);
+    while ((state & kWritePending) == 0) {
+      if (num_pending_reads_.compare_exchange_weak(state, state + 1,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
   }
 };  // struct ThreadedVar
 
@@ -223,12 +269,17 @@ class ThreadedVar final
  */
 struct ThreadedOpr final : public Opr,
                            public common::ObjectPoolAllocatable<ThreadedOpr> {
+  /*!
+   * \brief Number of variables of each kind stored in the operator itself, so pushing
+   *  a typical imperative operation does not allocate.
+   */
+  static constexpr size_t kInlineVars = 6;
   /*! \brief The function to be invoked each time. */
   Engine::AsyncFn fn;
   /*! \brief The variable this operation will read from. */
-  std::vector<ThreadedVar*> const_vars;
+  common::SmallVector<ThreadedVar*, kInlineVars> const_vars;
   /*! \brief The variable this operation will mutate. */
-  std::vector<ThreadedVar*> mutable_vars;
+  common::SmallVector<ThreadedVar*, kInlineVars> mutable_vars;
   /*! \brief The property of the operator */
   FnProperty prop;
   /*! \brief The name of the operator */
@@ -292,13 +343,19 @@ class ThreadedEngine : public Engine {
                 const char* opr_name = nullptr) override;
   void DeleteVariable(SyncFn delete_fn, Context exec_ctx, VarHandle var) override;
   void WaitForVar(VarHandle var) override;
+  bool IsVarReady(VarHandle var) override;
   void WaitForAll() override;
+  void StartRecord() override;
+  OprHandle StopRecord() override;
   void NotifyShutdown() override {
     shutdown_phase_.store(true);
   }
 
   ThreadedEngine() {
     engine_info_ = dmlc::GetEnv("MXNET_ENGINE_INFO", false);
+    wait_spin_us_ = dmlc::GetEnv("MXNET_ENGINE_WAIT_SPIN_US", 0);
+    const std::string trace_file = dmlc::GetEnv("MXNET_ENGINE_TRACE", std::string());
+    if (!trace_file.empty()) trace_.reset(new EngineTraceWriter(trace_file));
 
     objpool_opr_ref_    = common::ObjectPool<ThreadedOpr>::_GetSharedRef();
     objpool_blk_ref_    = common::ObjectPool<OprBlock>::_GetSharedRef();
@@ -343,7 +400,10 @@ class ThreadedEngine : public Engine {
       opr_block->opr_profile.reset(new profiler::ProfileOperator(threaded_opr->opr_name,
                                                                  attrs.release()));
       opr_block->opr_profile->start(ctx.dev_type, ctx.dev_id);
+    } else if (profiler_->sampler() && threaded_opr->opr_name && profiler_->sampler()->Sample()) {
+      opr_block->sample_start = profiler::ProfileStat::NowInMicrosec();
     }
+    if (opr_block->trace) opr_block->trace->start = OprTrace::Now();
     CallbackOnComplete callback =
         this->CreateCallback(ThreadedEngine::OnCompleteStatic, opr_block);
     const bool debug_info = (engine_info_ && debug_push_opr_ == opr_block);
@@ -360,7 +420,17 @@ class ThreadedEngine : public Engine {
         try {
           if (!(threaded_opr->opr_exception && *threaded_opr->opr_exception) ||
               threaded_opr->wait) {
-            threaded_opr->fn(run_ctx, callback);
+            // memory allocated by the operation is attributed to it when profiling
+            Storage::AllocScope alloc_scope(threaded_opr->opr_name, Storage::kActivation);
+            profiler::nvtx::NVTXRange nvtx_range(threaded_opr->opr_name,
+                                                 profiler::nvtx::kOperator);
+            if (opr_block->ctx.dev_mask() == cpu::kDevMask) {
+              // the CPU operations running at once share the OMP threads
+              OpenMP::OpScope omp_scope;
+              threaded_opr->fn(run_ctx, callback);
+            } else {
+              threaded_opr->fn(run_ctx, callback);
+            }
           } else {
             callback();
           }
@@ -395,6 +465,8 @@ class ThreadedEngine : public Engine {
 
   int bulk_size() const override {
     const profiler::Profiler *prof = profiler::Profiler::Get();
+    // recorded operations are kept apart to replay their dependencies
+    if (RecordStatusStore::Get()->recording) return 0;
     return (prof && prof->AggregateRunning()) ? 0 :  BulkStatusStore::Get()->bulk_size;
   }
 
@@ -423,6 +495,75 @@ class ThreadedEngine : public Engine {
   };
   /*! thread local store for bulk */
   typedef dmlc::ThreadLocalStore<BulkStatus> BulkStatusStore;
+  /*!
+   * \brief operations recorded between StartRecord and StopRecord, replayed
+   *  as a DAG of operators without variables
+   */
+  struct Recording {
+    /*! \brief a recorded operation */
+    struct Node {
+      /*! \brief the function, context and scheduling of the operation */
+      AsyncFn fn;
+      Context ctx;
+      FnProperty prop;
+      int priority;
+      const char* opr_name;
+      /*! \brief variables, only kept while the dependencies are computed */
+      std::vector<ThreadedVar*> const_vars;
+      std::vector<ThreadedVar*> mutable_vars;
+      /*! \brief the operations depending on this one, and the number it depends on */
+      std::vector<int> succ;
+      int num_pred{0};
+      /*! \brief operator without variables running the operation */
+      ThreadedOpr* opr{nullptr};
+      /*! \brief operations it still waits for in the current replay */
+      std::atomic<int> pending{0};
+      /*! \brief completion of opr in the current replay */
+      CallbackOnComplete on_complete;
+      Recording* rec{nullptr};
+    };
+    ~Recording();
+    std::vector<std::unique_ptr<Node> > nodes;
+    /*! \brief the operations depending on no other */
+    std::vector<int> roots;
+    /*! \brief the replay operator, and a variable it mutates to run one replay at a time */
+    ThreadedOpr* opr{nullptr};
+    VarHandle var{nullptr};
+    /*! \brief state of the current replay */
+    std::atomic<int> remaining{0};
+    CallbackOnComplete on_complete;
+    std::atomic<bool> failed{false};
+    std::mutex mutex;
+    std::exception_ptr exception;
+  };
+  /*! \brief structure for holding the recording of a thread */
+  struct RecordStatus {
+    /*! \brief the recording, nullptr unless recording */
+    std::shared_ptr<Recording> recording;
+    /*! \brief number of scopes pausing the recording */
+    int paused = 0;
+  };
+  /*! thread local store for recording */
+  typedef dmlc::ThreadLocalStore<RecordStatus> RecordStatusStore;
+  /*! \brief scope in which the pushes of this thread are not recorded */
+  struct RecordPause {
+    RecordPause() { ++RecordStatusStore::Get()->paused; }
+    ~RecordPause() { --RecordStatusStore::Get()->paused; }
+  };
+  /*!
+   * \brief add the creation of threaded_opr to the recording of this thread
+   */
+  inline void Record(ThreadedOpr* threaded_opr, Context exec_ctx, int priority);
+  /*!
+   * \brief push an operator without recording it
+   */
+  void Schedule(ThreadedOpr* threaded_opr, Context exec_ctx, int priority, bool profiling);
+  /*! \brief start a replay, on_complete completes the replay operator */
+  void Replay(Recording* rec, const CallbackOnComplete& on_complete);
+  /*! \brief run the i-th operation of a replay */
+  void RunRecorded(Recording* rec, int i, RunContext ctx, const CallbackOnComplete& on_complete);
+  /*! \brief completion of a recorded operation, schedules the ones depending on it */
+  static void OnRecordedCompleteStatic(Engine *engine, void *node);
   /*!
    * \brief check if thee is duplication in const_vars and mutable_vars.
    * \param const_vars the variables to read from.
@@ -434,8 +575,21 @@ class ThreadedEngine : public Engine {
    * \brief Callback on operation completion.
    *
    * On operation completion, this will trigger subsequent operations.
+   * \param trace_id trace id of the completed operation, recorded as the
+   *  trigger of the operations it makes ready
    */
-  inline void OnComplete(ThreadedOpr* threaded_opr);
+  inline void OnComplete(ThreadedOpr* threaded_opr, uint64_t trace_id = 0);
+  /*!
+   * \brief record, when tracing, that an operation became ready
+   * \param var the variable satisfied last, nullptr if ready at push
+   */
+  inline void MarkReady(OprBlock* opr_block, const ThreadedVar* var, uint64_t trigger) {
+    if (opr_block->trace) {
+      opr_block->trace->ready = OprTrace::Now();
+      opr_block->trace->var = var;
+      opr_block->trace->trigger = trigger;
+    }
+  }
   /*!
    * \brief rethrow caught exception in WaitForVar
    * \param threaded_var the var that we are waiting to read
@@ -498,6 +652,10 @@ class ThreadedEngine : public Engine {
     SyncFn fn = std::move(bulk_status.fn);
     this->PushAsync([fn](RunContext ctx, CallbackOnComplete on_complete) {
         fn(ctx);
+#if MXNET_USE_CUDA
+        // imperative ops skip their own stream wait when bulked
+        if (ctx.get_ctx().dev_mask() == gpu::kDevMask) ctx.get_stream<gpu>()->Wait();
+#endif
         on_complete();
       }, bulk_status.ctx, bulk_status.const_vars, bulk_status.mutable_vars,
       FnProperty::kNormal, 0, "ImperativeBulk");
@@ -515,6 +673,10 @@ class ThreadedEngine : public Engine {
   std::atomic<bool> shutdown_phase_{false};
   /*!\brief show more information from engine actions */
   bool engine_info_{false};
+  /*! \brief microseconds WaitForVar polls the variable before it blocks */
+  int wait_spin_us_{0};
+  /*! \brief writer of the scheduling trace, nullptr unless MXNET_ENGINE_TRACE is set */
+  std::unique_ptr<EngineTraceWriter> trace_;
   /*! \brief debug information about wait for var. */
   std::atomic<ThreadedVar*> debug_wait_var_{nullptr};
   /*! \brief debug information about wait for var. */
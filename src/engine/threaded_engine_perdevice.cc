@@ -22,6 +22,10 @@
  * \file threaded_engine_perdevice.cc
  * \brief ThreadedEngine that uses fix amount of thread for each device.
  */
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <string>
 #include <dmlc/base.h>
 #include <dmlc/omp.h>
 #include <dmlc/logging.h>
@@ -31,6 +35,7 @@
 #include "./threaded_engine.h"
 #include "./thread_pool.h"
 #include "../common/lazy_alloc_array.h"
+#include "../common/numa.h"
 #include "../common/utils.h"
 
 namespace mxnet {
@@ -40,7 +45,7 @@ namespace engine {
  * The policy of this Engine:
  *  - Execute Async operation immediately if pushed from Pusher.
  *  - Use fixed amount of threads for each device.
- *  - Use special threads for copy operations.
+ *  - Use special threads for copy operations, one set per direction.
  *  - Each stream is allocated and bound to each of the thread.
  */
 class ThreadedEnginePerDevice : public ThreadedEngine {
@@ -77,7 +82,8 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
   void StopNoWait() {
     SignalQueuesForKill();
     gpu_normal_workers_.Clear();
-    gpu_copy_workers_.Clear();
+    gpu_h2d_workers_.Clear();
+    gpu_d2h_workers_.Clear();
     cpu_normal_workers_.Clear();
     cpu_priority_worker_.reset(nullptr);
   }
@@ -88,13 +94,30 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
     StopNoWait();
   }
 
+  std::vector<engine::WorkerStats> GetWorkerStats() override {
+    std::vector<engine::WorkerStats> stats;
+    if (cpu_priority_worker_) AppendStats(*cpu_priority_worker_, &stats);
+    auto append = [&stats](size_t i, ThreadWorkerBlock<kWorkerQueue>* block) {
+      AppendStats(*block, &stats);
+    };
+    cpu_normal_workers_.ForEach(append);
+    gpu_normal_workers_.ForEach(append);
+    auto append_copy = [&stats](size_t i, ThreadWorkerBlock<kCopyQueue>* block) {
+      AppendStats(*block, &stats);
+    };
+    gpu_h2d_workers_.ForEach(append_copy);
+    gpu_d2h_workers_.ForEach(append_copy);
+    return stats;
+  }
+
   void Start() override {
     if (is_worker_) return;
     gpu_worker_nthreads_ = common::GetNumThreadsPerGPU();
     cpu_worker_nthreads_ = dmlc::GetEnv("MXNET_CPU_WORKER_NTHREADS", 1);
     // create CPU task
     int cpu_priority_nthreads = dmlc::GetEnv("MXNET_CPU_PRIORITY_NTHREADS", 4);
-    cpu_priority_worker_.reset(new ThreadWorkerBlock<kPriorityQueue>());
+    cpu_priority_worker_.reset(new ThreadWorkerBlock<kPriorityQueue>("cpu_priority",
+                                                                      cpu_priority_nthreads));
     cpu_priority_worker_->pool.reset(new ThreadPool(
         cpu_priority_nthreads,
         [this](std::shared_ptr<dmlc::ManualEvent> ready_event) {
@@ -115,28 +138,25 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
       }
       this->ExecuteOprBlock(RunContext{ctx, nullptr}, opr_block);
     } else {
+      // positive priority operations, e.g. of a latency critical executor, go
+      // ahead of the operations already queued on the FIFO workers
       if (ctx.dev_mask() == Context::kCPU) {
         if (opr_block->opr->prop == FnProperty::kCPUPrioritized) {
-          cpu_priority_worker_->task_queue.Push(opr_block, opr_block->priority);
+          Enqueue(cpu_priority_worker_.get(), opr_block, false);
         } else {
           int dev_id = ctx.dev_id;
           int nthread = cpu_worker_nthreads_;
           auto ptr =
           cpu_normal_workers_.Get(dev_id, [this, ctx, nthread]() {
-              auto blk = new ThreadWorkerBlock<kWorkerQueue>();
+              auto blk = new ThreadWorkerBlock<kWorkerQueue>(Name(ctx, ""), nthread);
               blk->pool.reset(new ThreadPool(nthread,
                   [this, ctx, blk](std::shared_ptr<dmlc::ManualEvent> ready_event) {
-                    this->CPUWorker(ctx, blk, ready_event);
+                    this->CPUWorker(ctx, blk, ready_event,
+                                    common::numa::NodeOfDevice(ctx.dev_id));
                   }, true));
             return blk;
           });
-          if (ptr) {
-            if (opr_block->opr->prop == FnProperty::kDeleteVar) {
-              ptr->task_queue.PushFront(opr_block, opr_block->priority);
-            } else {
-              ptr->task_queue.Push(opr_block, opr_block->priority);
-            }
-          }
+          if (ptr) Enqueue(ptr, opr_block, true);
         }
       } else {
         CHECK_EQ(ctx.dev_mask(), Context::kGPU);
@@ -146,10 +166,15 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
                               prop == FnProperty::kCopyToGPU);
         const size_t nthread = gpu_worker_nthreads_;
         if (is_copy) {
-          auto ptr = gpu_copy_workers_.Get(ctx.dev_id, [this, ctx, is_copy, nthread]() {
+          // uploads and downloads run on their own workers and streams so
+          // they overlap on full-duplex links
+          auto&& copy_workers = prop == FnProperty::kCopyToGPU ?
+                                gpu_h2d_workers_ : gpu_d2h_workers_;
+          const char* suffix = prop == FnProperty::kCopyToGPU ? "_copy_to" : "_copy_from";
+          auto ptr = copy_workers.Get(ctx.dev_id, [this, ctx, is_copy, nthread, suffix]() {
             // Signify to kernel that GPU is being used, so reserve cores as necessary
             OpenMP::Get()->set_reserve_cores(GetReserveCoreCount(true));
-            auto blk = new ThreadWorkerBlock<kCopyQueue>();
+            auto blk = new ThreadWorkerBlock<kCopyQueue>(Name(ctx, suffix), nthread);
               blk->pool.reset(new ThreadPool(
                 nthread,
                 [this, ctx, is_copy, blk]
@@ -158,18 +183,12 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
                   }, true));
               return blk;
             });
-          if (ptr) {
-            if (opr_block->opr->prop == FnProperty::kDeleteVar) {
-              ptr->task_queue.PushFront(opr_block, opr_block->priority);
-            } else {
-              ptr->task_queue.Push(opr_block, opr_block->priority);
-            }
-          }
+          if (ptr) Enqueue(ptr, opr_block, true);
         } else {
           auto ptr = gpu_normal_workers_.Get(ctx.dev_id, [this, ctx, is_copy, nthread]() {
             // Signify to kernel that GPU is being used, so reserve cores as necessary
             OpenMP::Get()->set_reserve_cores(GetReserveCoreCount(true));
-              auto blk = new ThreadWorkerBlock<kWorkerQueue>();
+              auto blk = new ThreadWorkerBlock<kWorkerQueue>(Name(ctx, ""), nthread);
               blk->pool.reset(new ThreadPool(
                 nthread,
                 [this, ctx, is_copy, blk]
@@ -178,13 +197,7 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
                   }, true));
               return blk;
           });
-          if (ptr) {
-            if (opr_block->opr->prop == FnProperty::kDeleteVar) {
-              ptr->task_queue.PushFront(opr_block, opr_block->priority);
-            } else {
-              ptr->task_queue.Push(opr_block, opr_block->priority);
-            }
-          }
+          if (ptr) Enqueue(ptr, opr_block, true);
         }
       }
     }
@@ -196,10 +209,19 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
   struct ThreadWorkerBlock {
     // task queue on this task
     dmlc::ConcurrentBlockingQueue<OprBlock*, type>  task_queue;
-    // thread pool that works on this task
+    // name of the queue in the worker stats
+    const std::string name;
+    const size_t nthreads;
+    // load counters, updated without ordering as they are only sampled
+    std::atomic<uint64_t> pending{0}, executed{0}, queue_wait_us{0}, busy_us{0}, idle_us{0};
+    // pending operations as a profiler counter, only set while the profiler runs
+    profiler::ProfileCounter pending_counter;
+    // thread pool that works on this task, destroyed first as its threads use the above
     std::unique_ptr<ThreadPool> pool;
     // constructor
-    ThreadWorkerBlock() = default;
+    ThreadWorkerBlock(const std::string& name, size_t nthreads)
+      : name(name), nthreads(nthreads),
+        pending_counter((name + " pending").c_str(), EngineProfileDomain()) {}
     // destructor
     ~ThreadWorkerBlock() noexcept(false) {}
   };
@@ -216,8 +238,10 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
   std::unique_ptr<ThreadWorkerBlock<kPriorityQueue> > cpu_priority_worker_;
   // workers doing normal works on GPU
   common::LazyAllocArray<ThreadWorkerBlock<kWorkerQueue> > gpu_normal_workers_;
-  // workers doing copy works from/to GPU
-  common::LazyAllocArray<ThreadWorkerBlock<kCopyQueue> > gpu_copy_workers_;
+  // workers doing copy works to GPU
+  common::LazyAllocArray<ThreadWorkerBlock<kCopyQueue> > gpu_h2d_workers_;
+  // workers doing copy works from GPU
+  common::LazyAllocArray<ThreadWorkerBlock<kCopyQueue> > gpu_d2h_workers_;
   /*!
    * \brief GPU worker that performs operations on a certain device.
    * \param dev_id The device id of the worker.
@@ -244,17 +268,13 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
       }
     } while (false);
     // execute task
-    OprBlock* opr_block;
     RunContext run_ctx{ctx, stream};
-    auto* task_queue = &(block->task_queue);
 
     // Don't eat up omp threads for GPU jobs.  They're probably best used elsewhere,
     // for example for image decoding or the optimizer pass
     OpenMP::Get()->on_start_worker_thread(false);
 
-    while (task_queue->Pop(&opr_block)) {
-      this->ExecuteOprBlock(run_ctx, opr_block);
-    }
+    RunTasks(run_ctx, block);
     // Catch exception for CUDA driver shutdown
     MSHADOW_CATCH_ERROR(mshadow::DeleteStream<gpu>(stream));
 #else
@@ -264,27 +284,94 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
   /*!
    * \brief CPU worker that performs operations on CPU.
    * \param block The task block of the worker.
+   * \param numa_node The NUMA node to pin the worker and its OMP team to, or -1.
    */
   template<dmlc::ConcurrentQueueType type>
   inline void CPUWorker(Context ctx,
                         ThreadWorkerBlock<type> *block,
-                        const std::shared_ptr<dmlc::ManualEvent>& ready_event) {
+                        const std::shared_ptr<dmlc::ManualEvent>& ready_event,
+                        int numa_node = -1) {
     this->is_worker_ = true;
-    auto* task_queue = &(block->task_queue);
     RunContext run_ctx{ctx, nullptr};
-
-    // execute task
-    OprBlock* opr_block;
     ready_event->signal();
 
-    // Set default number of threads for OMP parallel regions initiated by this thread
-    OpenMP::Get()->on_start_worker_thread(true);
+    // Set default number of threads for OMP parallel regions initiated by this thread,
+    // a pinned worker gets the share of the OMP threads its node has of the CPUs
+    int omp_max_threads = 0;
+    if (numa_node >= 0 && common::numa::BindThreadToNode(numa_node)) {
+      const int node_cpus = common::numa::NodeCPUs(numa_node).size();
+      omp_max_threads = std::max(1, OpenMP::Get()->thread_max() * node_cpus /
+                                    common::numa::NumCPUs());
+    }
+    OpenMP::Get()->on_start_worker_thread(true, omp_max_threads);
 
-    while (task_queue->Pop(&opr_block)) {
+    RunTasks(run_ctx, block);
+  }
+
+  /*! \brief execute the operations of the queue of block until it is killed */
+  template<typename Block>
+  inline void RunTasks(const RunContext& run_ctx, Block* block) {
+    OprBlock* opr_block;
+    uint64_t end = OprTrace::Now();
+    while (block->task_queue.Pop(&opr_block)) {
+      const uint64_t start = OprTrace::Now();
+      block->idle_us.fetch_add(start - end, std::memory_order_relaxed);
+      block->queue_wait_us.fetch_add(start - opr_block->queued, std::memory_order_relaxed);
+      const uint64_t pending = block->pending.fetch_sub(1, std::memory_order_relaxed) - 1;
+      if (Profiling()) block->pending_counter = pending;
       this->ExecuteOprBlock(run_ctx, opr_block);
+      end = OprTrace::Now();
+      block->busy_us.fetch_add(end - start, std::memory_order_relaxed);
+      block->executed.fetch_add(1, std::memory_order_relaxed);
     }
   }
 
+  /*!
+   * \brief push opr_block to the queue of block
+   * \param front whether deletions and positive priority operations go ahead of
+   *  the queued ones, for the FIFO queues
+   */
+  template<typename Block>
+  inline void Enqueue(Block* block, OprBlock* opr_block, const bool front) {
+    opr_block->queued = OprTrace::Now();
+    const uint64_t pending = block->pending.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (Profiling()) block->pending_counter = pending;
+    if (front && (opr_block->opr->prop == FnProperty::kDeleteVar || opr_block->priority > 0)) {
+      block->task_queue.PushFront(opr_block, opr_block->priority);
+    } else {
+      block->task_queue.Push(opr_block, opr_block->priority);
+    }
+  }
+
+  /*! \brief name of the workers of ctx in the worker stats */
+  static std::string Name(const Context& ctx, const char* suffix) {
+    std::ostringstream os;
+    os << ctx << suffix;
+    return os.str();
+  }
+
+  static bool Profiling() {
+    return profiler::Profiler::Get()->GetState() == profiler::Profiler::kRunning;
+  }
+
+  static profiler::ProfileDomain* EngineProfileDomain() {
+    static profiler::ProfileDomain domain("Engine");
+    return &domain;
+  }
+
+  template<typename Block>
+  static void AppendStats(const Block& block, std::vector<engine::WorkerStats>* stats) {
+    engine::WorkerStats s;
+    s.name = block.name;
+    s.nthreads = block.nthreads;
+    s.pending = block.pending.load(std::memory_order_relaxed);
+    s.executed = block.executed.load(std::memory_order_relaxed);
+    s.queue_wait_us = block.queue_wait_us.load(std::memory_order_relaxed);
+    s.busy_us = block.busy_us.load(std::memory_order_relaxed);
+    s.idle_us = block.idle_us.load(std::memory_order_relaxed);
+    stats->push_back(s);
+  }
+
   /*!
    * \brief Get number of cores this engine should reserve for its own use
    * \param using_gpu Whether there is GPU usage
@@ -317,7 +404,8 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
   /*! Signal all queues for shutdown */
   void SignalQueuesForKill() {
     SignalQueueForKill(&gpu_normal_workers_);
-    SignalQueueForKill(&gpu_copy_workers_);
+    SignalQueueForKill(&gpu_h2d_workers_);
+    SignalQueueForKill(&gpu_d2h_workers_);
     SignalQueueForKill(&cpu_normal_workers_);
     if (cpu_priority_worker_) {
       cpu_priority_worker_->task_queue.SignalForKill();
@@ -44,12 +44,14 @@ class ThreadedEnginePooled : public ThreadedEngine {
  public:
   ThreadedEnginePooled() :
       thread_pool_(kNumWorkingThreads, [this]() { ThreadWorker(&task_queue_); }),
-      io_thread_pool_(1, [this]() { ThreadWorker(&io_task_queue_); }) {}
+      d2h_thread_pool_(1, [this]() { ThreadWorker(&d2h_task_queue_); }),
+      h2d_thread_pool_(1, [this]() { ThreadWorker(&h2d_task_queue_); }) {}
 
   ~ThreadedEnginePooled() noexcept(false) {
     streams_.Finalize();
     task_queue_.SignalForKill();
-    io_task_queue_.SignalForKill();
+    d2h_task_queue_.SignalForKill();
+    h2d_task_queue_.SignalForKill();
   }
 
  protected:
@@ -76,12 +78,15 @@ class ThreadedEnginePooled : public ThreadedEngine {
    * \brief Task queues.
    */
   dmlc::ConcurrentBlockingQueue<OprBlock*> task_queue_;
-  dmlc::ConcurrentBlockingQueue<OprBlock*> io_task_queue_;
+  // copies from and to the GPUs, one thread each so both directions overlap
+  dmlc::ConcurrentBlockingQueue<OprBlock*> d2h_task_queue_;
+  dmlc::ConcurrentBlockingQueue<OprBlock*> h2d_task_queue_;
   /*!
    * \brief Thread pools.
    */
   ThreadPool thread_pool_;
-  ThreadPool io_thread_pool_;
+  ThreadPool d2h_thread_pool_;
+  ThreadPool h2d_thread_pool_;
   /*!
    * \brief Worker.
    * \param task_queue Queue to work on.
@@ -107,10 +112,10 @@ class ThreadedEnginePooled : public ThreadedEngine {
       LOG(FATAL) << "Please compile with CUDA enabled";
       #endif  // MXNET_USE_CUDA
     }
-    bool is_copy = (opr_block->opr->prop == FnProperty::kCopyFromGPU ||
-                    opr_block->opr->prop == FnProperty::kCopyToGPU);
+    const FnProperty prop = opr_block->opr->prop;
+    bool is_copy = (prop == FnProperty::kCopyFromGPU || prop == FnProperty::kCopyToGPU);
     auto&& rctx = is_copy
-        ? streams_.GetIORunContext(opr_block->ctx)
+        ? streams_.GetIORunContext(opr_block->ctx, prop == FnProperty::kCopyToGPU)
         : streams_.GetRunContext(opr_block->ctx);
     this->ExecuteOprBlock(rctx, opr_block);
   }
@@ -120,13 +125,20 @@ class ThreadedEnginePooled : public ThreadedEngine {
    */
   void DoPushToQueue(OprBlock* opr_block) {
     switch (opr_block->opr->prop) {
-      case FnProperty::kCopyFromGPU:
+      case FnProperty::kCopyFromGPU: {
+        d2h_task_queue_.Push(opr_block);
+        break;
+      }
       case FnProperty::kCopyToGPU: {
-        io_task_queue_.Push(opr_block);
+        h2d_task_queue_.Push(opr_block);
         break;
       }
       default: {
-        task_queue_.Push(opr_block);
+        if (opr_block->priority > 0) {
+          task_queue_.PushFront(opr_block);
+        } else {
+          task_queue_.Push(opr_block);
+        }
         break;
       }
     }
@@ -0,0 +1,288 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file threaded_engine_stealing.cc
+ * \brief Pooled threaded engine with per-worker deques and work stealing
+ */
+#include <dmlc/base.h>
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <dmlc/concurrency.h>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "./threaded_engine.h"
+#include "./thread_pool.h"
+#include "./stream_manager.h"
+
+namespace mxnet {
+namespace engine {
+/*!
+ * \brief ThreadedEngine using a global pool of workers that each own a deque.
+ * The policy of this Engine:
+ *  - Execute Async operation immediately if pushed from Pusher.
+ *  - Operations pushed from a worker go to the back of that worker's deque,
+ *    other pushes are spread round-robin over the workers.
+ *  - A worker pops from the back of its own deque and, when it is empty,
+ *    steals from the front of the others, so pushes and pops do not
+ *    contend on a single queue lock.
+ *  - kCPUPrioritized operations go to a dedicated priority queue and pool,
+ *    as in ThreadedEnginePerDevice.
+ *  - Use special thread pool for copy operations.
+ */
+class ThreadedEngineStealing : public ThreadedEngine {
+ public:
+  ThreadedEngineStealing()
+      : num_workers_(dmlc::GetEnv("MXNET_ENGINE_STEALING_NTHREADS",
+                                  static_cast<int>(kNumWorkingThreads))),
+        workers_(num_workers_) {
+    CHECK_GT(num_workers_, 0);
+    for (auto& worker : workers_) {
+      worker.reset(new WorkerQueue());
+    }
+    thread_pool_.reset(new ThreadPool(num_workers_, [this]() {
+      this->StealingWorker(next_worker_id_++);
+    }));
+    priority_thread_pool_.reset(new ThreadPool(
+        dmlc::GetEnv("MXNET_CPU_PRIORITY_NTHREADS", 4),
+        [this]() { ThreadWorker(&priority_task_queue_); }));
+    d2h_thread_pool_.reset(new ThreadPool(1, [this]() { ThreadWorker(&d2h_task_queue_); }));
+    h2d_thread_pool_.reset(new ThreadPool(1, [this]() { ThreadWorker(&h2d_task_queue_); }));
+  }
+
+  ~ThreadedEngineStealing() noexcept(false) {
+    streams_.Finalize();
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      kill_ = true;
+    }
+    sleep_cond_.notify_all();
+    priority_task_queue_.SignalForKill();
+    d2h_task_queue_.SignalForKill();
+    h2d_task_queue_.SignalForKill();
+    thread_pool_.reset(nullptr);
+    priority_thread_pool_.reset(nullptr);
+    d2h_thread_pool_.reset(nullptr);
+    h2d_thread_pool_.reset(nullptr);
+  }
+
+ protected:
+  void PushToExecute(OprBlock *opr_block, bool pusher_thread) override {
+    if (opr_block->opr->prop == FnProperty::kAsync && pusher_thread) {
+      DoExecute(opr_block);
+    } else {
+      DoPushToQueue(opr_block);
+    }
+  }
+
+ private:
+  /*! \brief deque owned by a single worker, stolen from by the others */
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<OprBlock*> tasks;
+  };
+  /*! \brief Default concurrency for thread pool */
+  static constexpr int kNumWorkingThreads = 16;
+  /*! \brief Maximum number of GPUs */
+  static constexpr std::size_t kMaxNumGpus = 16;
+  /*!\brief number of streams allocated for each GPU */
+  static constexpr std::size_t kNumStreamsPerGpu = 16;
+  /*! \brief number of workers */
+  const int num_workers_;
+  /*! \brief per-worker deques */
+  std::vector<std::unique_ptr<WorkerQueue> > workers_;
+  /*! \brief id handed to the next worker thread that starts */
+  std::atomic<int> next_worker_id_{0};
+  /*! \brief round-robin target for pushes from non-worker threads */
+  std::atomic<unsigned> next_push_{0};
+  /*! \brief number of operations sitting in the worker deques */
+  std::atomic<int> num_pending_{0};
+  /*! \brief number of workers waiting for work */
+  std::atomic<int> num_sleeping_{0};
+  /*! \brief protects sleeping workers and kill_ */
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cond_;
+  bool kill_{false};
+  /*!
+   * \brief Streams.
+   */
+  StreamManager<kMaxNumGpus, kNumStreamsPerGpu> streams_;
+  /*!
+   * \brief Task queues.
+   */
+  dmlc::ConcurrentBlockingQueue<OprBlock*, dmlc::ConcurrentQueueType::kPriority>
+    priority_task_queue_;
+  // copies from and to the GPUs, one thread each so both directions overlap
+  dmlc::ConcurrentBlockingQueue<OprBlock*> d2h_task_queue_;
+  dmlc::ConcurrentBlockingQueue<OprBlock*> h2d_task_queue_;
+  /*!
+   * \brief Thread pools.
+   */
+  std::unique_ptr<ThreadPool> thread_pool_;
+  std::unique_ptr<ThreadPool> priority_thread_pool_;
+  std::unique_ptr<ThreadPool> d2h_thread_pool_;
+  std::unique_ptr<ThreadPool> h2d_thread_pool_;
+  /*! \brief engine owning the current thread, if it is a stealing worker */
+  static MX_THREAD_LOCAL ThreadedEngineStealing* worker_owner_;
+  /*! \brief id of the current thread within worker_owner_ */
+  static MX_THREAD_LOCAL int worker_id_;
+
+  /*!
+   * \brief Take an operation, from the back of our own deque first.
+   * \param id worker id
+   * \return operation, or nullptr if all deques are empty
+   */
+  OprBlock* TryTake(int id) {
+    {
+      WorkerQueue* own = workers_[id].get();
+      std::lock_guard<std::mutex> lock(own->mutex);
+      if (!own->tasks.empty()) {
+        OprBlock* opr_block = own->tasks.back();
+        own->tasks.pop_back();
+        return opr_block;
+      }
+    }
+    for (int k = 1; k < num_workers_; ++k) {
+      WorkerQueue* victim = workers_[(id + k) % num_workers_].get();
+      std::unique_lock<std::mutex> lock(victim->mutex, std::try_to_lock);
+      if (lock.owns_lock() && !victim->tasks.empty()) {
+        OprBlock* opr_block = victim->tasks.front();
+        victim->tasks.pop_front();
+        return opr_block;
+      }
+    }
+    return nullptr;
+  }
+  /*!
+   * \brief Worker loop of the stealing pool.
+   * \param id worker id
+   */
+  void StealingWorker(int id) {
+    worker_owner_ = this;
+    worker_id_ = id;
+    while (true) {
+      OprBlock* opr_block = num_pending_.load() > 0 ? TryTake(id) : nullptr;
+      if (opr_block != nullptr) {
+        --num_pending_;
+        DoExecute(opr_block);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      if (kill_) break;
+      if (num_pending_.load() > 0) continue;
+      ++num_sleeping_;
+      sleep_cond_.wait(lock, [this]() { return kill_ || num_pending_.load() > 0; });
+      --num_sleeping_;
+      if (kill_) break;
+    }
+  }
+  /*!
+   * \brief Worker.
+   * \param task_queue Queue to work on.
+   *
+   * The method to pass to thread pool to parallelize.
+   */
+  template<dmlc::ConcurrentQueueType type>
+  void ThreadWorker(dmlc::ConcurrentBlockingQueue<OprBlock*, type>* task_queue) {
+    OprBlock* opr_block;
+    while (task_queue->Pop(&opr_block)) {
+      DoExecute(opr_block);
+    }
+  }
+  /*!
+   * \brief Execute an operation.
+   * \param opr_block The operator block.
+   */
+  void DoExecute(OprBlock* opr_block) {
+    assert(opr_block->wait.load() == 0);
+    if (opr_block->ctx.dev_mask() == gpu::kDevMask) {
+      #if MXNET_USE_CUDA
+      CUDA_CALL(cudaSetDevice(opr_block->ctx.dev_id));
+      #else   // MXNET_USE_CUDA
+      LOG(FATAL) << "Please compile with CUDA enabled";
+      #endif  // MXNET_USE_CUDA
+    }
+    const FnProperty prop = opr_block->opr->prop;
+    bool is_copy = (prop == FnProperty::kCopyFromGPU || prop == FnProperty::kCopyToGPU);
+    auto&& rctx = is_copy
+        ? streams_.GetIORunContext(opr_block->ctx, prop == FnProperty::kCopyToGPU)
+        : streams_.GetRunContext(opr_block->ctx);
+    this->ExecuteOprBlock(rctx, opr_block);
+  }
+  /*!
+   * \brief Push the operation to a worker deque and wake a sleeping worker.
+   * \param opr_block The operator block.
+   */
+  void PushToWorker(OprBlock* opr_block) {
+    const int id = worker_owner_ == this
+        ? worker_id_
+        : static_cast<int>(next_push_++ % num_workers_);
+    {
+      WorkerQueue* worker = workers_[id].get();
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->tasks.push_back(opr_block);
+    }
+    ++num_pending_;
+    if (num_sleeping_.load() > 0) {
+      // taking the lock orders the notify after a worker's predicate check
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      sleep_cond_.notify_one();
+    }
+  }
+  /*!
+   * \brief Push the operation to the queue.
+   * \param opr_block The operator block.
+   */
+  void DoPushToQueue(OprBlock* opr_block) {
+    switch (opr_block->opr->prop) {
+      case FnProperty::kCopyFromGPU: {
+        d2h_task_queue_.Push(opr_block);
+        break;
+      }
+      case FnProperty::kCopyToGPU: {
+        h2d_task_queue_.Push(opr_block);
+        break;
+      }
+      case FnProperty::kCPUPrioritized: {
+        priority_task_queue_.Push(opr_block, opr_block->priority);
+        break;
+      }
+      default: {
+        PushToWorker(opr_block);
+        break;
+      }
+    }
+  }
+};
+
+Engine *CreateThreadedEngineStealing() {
+  return new ThreadedEngineStealing();
+}
+
+MX_THREAD_LOCAL ThreadedEngineStealing* ThreadedEngineStealing::worker_owner_ = nullptr;
+MX_THREAD_LOCAL int ThreadedEngineStealing::worker_id_ = 0;
+
+}  // namespace engine
+}  // namespace mxnet
@@ -27,6 +27,7 @@
 #include <mxnet/op_attr_types.h>
 #include <mxnet/graph_attr_types.h>
 #include <nnvm/graph_attr_types.h>
+#include <algorithm>
 #include "../common/utils.h"
 #include "../common/exec_utils.h"
 #include "./exec_pass.h"
@@ -50,6 +51,9 @@ class StorageFallbackOpExecutor : public OpExecutor {
 
   void Setup() override {
     init_ = false;
+    blobs_cached_ = false;
+    shadow_var_.clear();
+    shadow_version_.clear();
   }
 
  protected:
@@ -73,6 +77,9 @@ class StorageFallbackOpExecutor : public OpExecutor {
   // storage fallback before fcompute is launched
   void PreFCompute(bool is_gpu) {
     using namespace common;
+    // the arrays of an executor keep their memory between runs, so without any
+    // storage fallback the blobs of the last run still hold
+    if (blobs_cached_) return;
     InitBlobs();
     in_data_.clear(); out_data_.clear();
     pre_temp_src_.clear(); pre_temp_dst_.clear();
@@ -84,15 +91,55 @@ class StorageFallbackOpExecutor : public OpExecutor {
                            &pre_temp_src_, &pre_temp_dst_,
                            &post_temp_src_, &post_temp_dst_,
                            &in_temp_idx_map_, mutate_idx_);
+#if MXNET_USE_MKLDNN != 1
+    // an mkldnn array may need a reorder in any later run
+    blobs_cached_ = pre_temp_src_.empty() && post_temp_src_.empty();
+#endif
+    SkipCachedInputCasts();
     common::CastNonDefaultStorage(pre_temp_src_, pre_temp_dst_, op_ctx, is_gpu);
   }
 
   // storage fallback after fcompute is completed
   void PostFCompute(bool is_gpu) {
+    if (blobs_cached_) return;
     common::CastNonDefaultStorage(post_temp_src_, post_temp_dst_, op_ctx, is_gpu);
     req = tmp_req;
   }
 
+  // The dense buffer of an input still holds the input as of the last cast if its
+  // variable has not been written since, which spares casting weights that rarely
+  // change every run. Mutable inputs are written back, so they are always cast.
+  void SkipCachedInputCasts() {
+    if (pre_temp_src_.empty()) return;
+    shadow_var_.resize(in_array.size(), nullptr);
+    shadow_version_.resize(in_array.size(), 0);
+    std::vector<bool> cast(pre_temp_src_.size(), true);
+    for (const auto& kv : in_temp_idx_map_) {
+      const uint32_t i = kv.first;
+      const NDArray& nd = in_array[i];
+      if (std::find(mutate_idx_.begin(), mutate_idx_.end(), i) != mutate_idx_.end()) {
+        shadow_var_[i] = nullptr;
+        continue;
+      }
+      if (shadow_var_[i] == nd.var() && shadow_version_[i] == nd.version()) {
+        cast[kv.second] = false;
+      } else {
+        shadow_var_[i] = nd.var();
+        shadow_version_[i] = nd.version();
+      }
+    }
+    size_t kept = 0;
+    for (size_t j = 0; j < cast.size(); ++j) {
+      if (!cast[j]) continue;
+      pre_temp_src_[kept] = pre_temp_src_[j];
+      pre_temp_dst_[kept] = pre_temp_dst_[j];
+      ++kept;
+    }
+    common::StorageFallbackCounters::Get()->reused += pre_temp_src_.size() - kept;
+    pre_temp_src_.resize(kept);
+    pre_temp_dst_.resize(kept);
+  }
+
   // output requirement on each output array.
   // This temporarily saves the original output requirements.
   std::vector<OpReqType> tmp_req;
@@ -108,8 +155,13 @@ class StorageFallbackOpExecutor : public OpExecutor {
   std::unordered_map<uint32_t, uint32_t> in_temp_idx_map_;
   // indices of mutatable inputs
   std::vector<uint32_t> mutate_idx_;
+  // variable and version of the input each dense input buffer was last cast from
+  std::vector<Engine::VarHandle> shadow_var_;
+  std::vector<size_t> shadow_version_;
   // whether blobs are initialized
   bool init_;
+  // whether in_data_ and out_data_ of the last run are reused without fallback
+  bool blobs_cached_{false};
 };
 
 
@@ -0,0 +1,272 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file convert_fp16.cc
+ * \brief run the float32 operators of an inference graph in float16
+ */
+#include <mxnet/base.h>
+#include <mxnet/op_attr_types.h>
+#include <nnvm/graph.h>
+#include <nnvm/pass_functions.h>
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "./exec_pass.h"
+
+namespace mxnet {
+namespace exec {
+namespace {
+using mshadow::kFloat16;
+using mshadow::kFloat32;
+using nnvm::Node;
+using nnvm::NodeEntry;
+using nnvm::NodePtr;
+
+/*! \brief operators whose inputs are cast to float32 and whose outputs stay float32 */
+const std::unordered_set<std::string>& FP32Ops() {
+  static const std::unordered_set<std::string> ops = [] {
+    std::unordered_set<std::string> ops = {
+      "softmax", "log_softmax", "SoftmaxActivation", "SoftmaxOutput", "Softmax",
+      "softmax_cross_entropy", "LinearRegressionOutput", "LogisticRegressionOutput",
+      "MAERegressionOutput", "SVMOutput", "MakeLoss", "make_loss", "_contrib_CTCLoss",
+      "L2Normalization", "LayerNorm", "InstanceNorm", "norm",
+      "_contrib_Proposal", "_contrib_MultiProposal", "_contrib_MultiBoxDetection",
+      "_contrib_MultiBoxTarget", "_contrib_box_nms"};
+    std::istringstream is(dmlc::GetEnv("MXNET_FP16_FP32_OPS", std::string()));
+    std::string name;
+    while (std::getline(is, name, ',')) {
+      if (!name.empty()) ops.insert(name);
+    }
+    return ops;
+  }();
+  return ops;
+}
+
+/*! \brief normalizations that take float32 parameters, and statistics, for float16 data */
+bool IsNorm(const Node& node) {
+  return node.op()->name == "BatchNorm" || node.op()->name == "_contrib_SyncBatchNorm";
+}
+
+/*! \brief whether the input i of the node has to keep its dtype, as it is updated or indexes */
+bool Pinned(const Node& node, uint32_t i, const std::vector<uint32_t>& mutable_inputs) {
+  static const std::unordered_map<std::string, uint32_t> index_inputs = {
+    {"Embedding", 0}, {"one_hot", 0}, {"take", 1}, {"batch_take", 1}, {"pick", 1},
+    {"gather_nd", 1}, {"SequenceLast", 1}, {"SequenceMask", 1}, {"SequenceReverse", 1}};
+  if (std::find(mutable_inputs.begin(), mutable_inputs.end(), i) != mutable_inputs.end()) {
+    return true;
+  }
+  auto it = index_inputs.find(node.op()->name);
+  return it != index_inputs.end() && it->second == i;
+}
+
+/*! \brief dtype a float32 input of the node is read in, -1 for any */
+int InputDType(const Node& node, uint32_t i, const std::vector<uint32_t>& mutable_inputs) {
+  static const nnvm::Op* cast_op = nnvm::Op::Get("Cast");
+  if (node.op() == cast_op) return -1;
+  if (FP32Ops().count(node.op()->name) || Pinned(node, i, mutable_inputs)) return kFloat32;
+  if (IsNorm(node) && i != 0) return kFloat32;
+  return kFloat16;
+}
+}  // namespace
+
+Graph ConvertFP16(Graph g, std::unordered_map<std::string, int>* arg_dtypes,
+                  const std::unordered_set<std::string>& inputs) {
+  static auto& fmutate = nnvm::Op::GetAttr<nnvm::FMutateInputs>("FMutateInputs");
+  static const nnvm::Op* cast_op = nnvm::Op::Get("Cast");
+  auto input_dtypes = [](const nnvm::IndexedGraph& idx,
+                         const std::unordered_map<std::string, int>& known) {
+    nnvm::DTypeVector dtypes(idx.input_nodes().size(), -1);
+    for (size_t i = 0; i < dtypes.size(); ++i) {
+      auto it = known.find(idx[idx.input_nodes()[i]].source->attrs.name);
+      if (it != known.end()) dtypes[i] = it->second;
+    }
+    return dtypes;
+  };
+
+  // the dtypes of the graph as it is, only its float32 entries are converted
+  Graph typed;
+  typed.outputs = g.outputs;
+  try {
+    nnvm::DTypeVector dtypes = input_dtypes(typed.indexed_graph(), *arg_dtypes);
+    typed = InferType(std::move(typed), std::move(dtypes), "__dtype__");
+  } catch (const dmlc::Error& err) {
+    LOG(WARNING) << "ConvertFP16: graph left in float32, " << err.what();
+    return g;
+  }
+  if (typed.GetAttr<size_t>("dtype_num_unknown_nodes") != 0U) {
+    LOG(WARNING) << "ConvertFP16: graph left in float32, its dtypes are not known";
+    return g;
+  }
+  const nnvm::IndexedGraph& idx = typed.indexed_graph();
+  const nnvm::DTypeVector& dtypes = typed.GetAttr<nnvm::DTypeVector>("dtype");
+  auto orig_dtype = [&](const Node* node, uint32_t index) {
+    return dtypes[idx.entry_id(idx.node_id(node), index)];
+  };
+  std::vector<NodePtr> topo;
+  nnvm::DFSVisit(g.outputs, [&](const NodePtr& node) { topo.push_back(node); });
+  auto mutable_inputs = [](const Node& node) {
+    return fmutate.count(node.op()) ? fmutate[node.op()](node.attrs) : std::vector<uint32_t>();
+  };
+
+  // a parameter is stored in float16 when an operator reads it in float16 and none
+  // updates it or reads indices from it
+  std::unordered_set<const Node*> half_vars, pinned_vars;
+  for (const NodePtr& node : topo) {
+    if (node->is_variable()) continue;
+    const std::vector<uint32_t> mutate = mutable_inputs(*node);
+    for (uint32_t i = 0; i < node->inputs.size(); ++i) {
+      const NodeEntry& e = node->inputs[i];
+      if (!e.node->is_variable() || inputs.count(e.node->attrs.name) ||
+          orig_dtype(e.node.get(), e.index) != kFloat32) {
+        continue;
+      }
+      if (Pinned(*node, i, mutate)) {
+        pinned_vars.insert(e.node.get());
+      } else if (InputDType(*node, i, mutate) == kFloat16) {
+        half_vars.insert(e.node.get());
+      }
+    }
+  }
+  for (const Node* var : pinned_vars) half_vars.erase(var);
+
+  // operators are rebuilt on their converted inputs, Casts are inserted where the dtype of
+  // an entry changes, variables are kept and their new dtypes returned in arg_dtypes
+  std::unordered_map<const Node*, std::vector<NodeEntry>> outputs_of;
+  std::unordered_map<const Node*, std::vector<int>> dtype_of;
+  // the entry read by each inserted Cast, so that casting it back reads the entry instead
+  std::unordered_map<const Node*, NodeEntry> cast_src;
+  std::map<std::tuple<const Node*, uint32_t, int>, NodeEntry> casts;
+  auto entry_dtype = [&dtype_of](const NodeEntry& e) {
+    return dtype_of.at(e.node.get())[e.index];
+  };
+  auto cast_to = [&](const NodeEntry& e, int dtype) {
+    if (dtype == -1 || entry_dtype(e) == dtype) return e;
+    auto src = cast_src.find(e.node.get());
+    if (src != cast_src.end() && entry_dtype(src->second) == dtype) return src->second;
+    auto key = std::make_tuple(e.node.get(), e.index, dtype);
+    auto it = casts.find(key);
+    if (it != casts.end()) return it->second;
+    NodePtr cast = Node::Create();
+    cast->attrs.op = cast_op;
+    cast->attrs.name = e.node->attrs.name + (e.index != 0 ? "_" + std::to_string(e.index) : "") +
+                       (dtype == kFloat16 ? "_fp16" : "_fp32");
+    cast->attrs.dict["dtype"] = dtype == kFloat16 ? "float16" : "float32";
+    cast->attrs.op->attr_parser(&(cast->attrs));
+    cast->inputs.push_back(e);
+    dtype_of[cast.get()] = {dtype};
+    cast_src[cast.get()] = e;
+    NodeEntry out{cast, 0, 0};
+    casts.emplace(key, out);
+    return out;
+  };
+
+  for (const NodePtr& node : topo) {
+    if (node->is_variable()) {
+      outputs_of[node.get()] = {NodeEntry{node, 0, 0}};
+      dtype_of[node.get()] = {half_vars.count(node.get()) ? kFloat16 : orig_dtype(node.get(), 0)};
+      continue;
+    }
+    if (node->op() == cast_op) {
+      // casts of the model that the conversion made redundant are dropped
+      const NodeEntry& e = node->inputs[0];
+      const NodeEntry in = outputs_of.at(e.node.get())[e.index];
+      const int dtype = orig_dtype(node.get(), 0);
+      auto src = cast_src.find(in.node.get());
+      if (entry_dtype(in) == dtype) {
+        outputs_of[node.get()] = {in};
+        continue;
+      } else if (src != cast_src.end() && entry_dtype(src->second) == dtype) {
+        outputs_of[node.get()] = {src->second};
+        continue;
+      }
+    }
+    NodePtr copy = Node::Create();
+    copy->attrs = node->attrs;
+    for (const NodePtr& dep : node->control_deps) {
+      copy->control_deps.push_back(outputs_of.at(dep.get())[0].node);
+    }
+    const std::vector<uint32_t> mutate = mutable_inputs(*node);
+    bool half_input = false;
+    for (uint32_t i = 0; i < node->inputs.size(); ++i) {
+      const NodeEntry& e = node->inputs[i];
+      const NodeEntry in = outputs_of.at(e.node.get())[e.index];
+      const int orig = orig_dtype(e.node.get(), e.index);
+      const int dtype = orig == kFloat32 ? InputDType(*node, i, mutate) : orig;
+      half_input |= dtype == kFloat16;
+      copy->inputs.push_back(cast_to(in, dtype));
+    }
+    // an operator reading float16 data computes in float16 but for the statistics of
+    // normalizations, and outputs of other dtypes keep them
+    std::vector<NodeEntry>& outs = outputs_of[node.get()];
+    std::vector<int>& out_dtypes = dtype_of[copy.get()];
+    for (uint32_t j = 0; j < node->num_outputs(); ++j) {
+      const int orig = orig_dtype(node.get(), j);
+      const bool half = half_input && orig == kFloat32 && !(IsNorm(*node) && j != 0);
+      outs.push_back(NodeEntry{copy, j, 0});
+      out_dtypes.push_back(half ? kFloat16 : orig);
+    }
+  }
+
+  // the outputs are cast back, so callers read the dtypes they did before
+  Graph converted;
+  for (const NodeEntry& e : g.outputs) {
+    const NodeEntry& out = outputs_of.at(e.node.get())[e.index];
+    converted.outputs.push_back(cast_to(out, orig_dtype(e.node.get(), e.index)));
+  }
+  // operators that do not compute in the dtype of their data are left in float32
+  std::unordered_map<std::string, int> new_dtypes(*arg_dtypes);
+  for (const Node* var : half_vars) new_dtypes[var->attrs.name] = kFloat16;
+  try {
+    nnvm::DTypeVector in_dtypes = input_dtypes(converted.indexed_graph(), new_dtypes);
+    converted = InferType(std::move(converted), std::move(in_dtypes), "__dtype__");
+  } catch (const dmlc::Error& err) {
+    LOG(WARNING) << "ConvertFP16: graph left in float32, " << err.what();
+    return g;
+  }
+  const nnvm::IndexedGraph& cidx = converted.indexed_graph();
+  const nnvm::DTypeVector& cdtypes = converted.GetAttr<nnvm::DTypeVector>("dtype");
+  for (uint32_t nid = 0; nid < cidx.num_nodes(); ++nid) {
+    const std::vector<int>& expected = dtype_of.at(cidx[nid].source);
+    for (uint32_t j = 0; j < expected.size(); ++j) {
+      if (cdtypes[cidx.entry_id(nid, j)] != expected[j]) {
+        LOG(WARNING) << "ConvertFP16: graph left in float32, " << cidx[nid].source->attrs.name
+                     << " does not compute in float16";
+        return g;
+      }
+    }
+  }
+  std::swap(*arg_dtypes, new_dtypes);
+  if (dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+    LOG(INFO) << "ConvertFP16: converted " << half_vars.size() << " parameters, inserted "
+              << casts.size() << " casts";
+  }
+  Graph ret;
+  ret.outputs = converted.outputs;
+  return ret;
+}
+
+}  // namespace exec
+}  // namespace mxnet
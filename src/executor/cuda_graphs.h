@@ -0,0 +1,122 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file cuda_graphs.h
+ * \brief Capture and replay of bulked executor segments as CUDA graphs.
+ */
+#ifndef MXNET_EXECUTOR_CUDA_GRAPHS_H_
+#define MXNET_EXECUTOR_CUDA_GRAPHS_H_
+
+#include <mxnet/base.h>
+#include <mxnet/resource.h>
+
+#if MXNET_USE_CUDA
+#include <cuda_runtime.h>
+#include <mshadow/tensor.h>
+#include <mutex>
+#include "../common/cuda_utils.h"
+
+namespace mxnet {
+namespace exec {
+
+/*!
+ * \brief Caches the CUDA graph of one bulk segment.
+ *
+ * The first run executes the segment normally so that every lazily
+ * allocated buffer (temp space, cuDNN workspaces, handles) exists. The
+ * second run is captured into a graph and launched, later runs only call
+ * cudaGraphLaunch. Kernels are captured with their argument pointers, so
+ * the graph is dropped and recaptured whenever temp space is reallocated.
+ * Segments must not synchronize with the host, which holds for fixed-shape
+ * inference graphs of plain kernels.
+ */
+class CudaGraphCache {
+ public:
+  ~CudaGraphCache() {
+#if CUDART_VERSION >= 10000
+    if (graph_exec_ != nullptr) cudaGraphExecDestroy(graph_exec_);
+#endif
+  }
+  /*!
+   * \brief run the segment on the stream of rctx.
+   * \param rctx run context of the segment operator
+   * \param run function that executes every op of the segment
+   */
+  template<typename FRun>
+  void Run(const RunContext& rctx, const FRun& run) {
+    // the segment operator mutates its outputs, so the engine never runs two
+    // instances at once; the lock only keeps worker threads' views consistent
+    std::lock_guard<std::mutex> lock(mutex_);
+#if CUDART_VERSION >= 10000
+    cudaStream_t stream = mshadow::Stream<gpu>::GetStream(rctx.get_stream<gpu>());
+    const uint64_t version = ResourceManager::Get()->TempSpaceVersion();
+    if (graph_exec_ != nullptr && version == version_) {
+      CUDA_CALL(cudaGraphLaunch(graph_exec_, stream));
+      return;
+    }
+    if (graph_exec_ != nullptr) {
+      CUDA_CALL(cudaGraphExecDestroy(graph_exec_));
+      graph_exec_ = nullptr;
+      warmed_up_ = false;
+    }
+    if (!warmed_up_) {
+      run();
+      warmed_up_ = true;
+      return;
+    }
+    cudaGraph_t graph;
+    CUDA_CALL(cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal));
+    run();
+    CUDA_CALL(cudaStreamEndCapture(stream, &graph));
+    if (ResourceManager::Get()->TempSpaceVersion() != version) {
+      // buffers moved while capturing, what we recorded is stale
+      CUDA_CALL(cudaGraphDestroy(graph));
+      run();
+      return;
+    }
+    CUDA_CALL(cudaGraphInstantiate(&graph_exec_, graph, nullptr, nullptr, 0));
+    CUDA_CALL(cudaGraphDestroy(graph));
+    version_ = version;
+    CUDA_CALL(cudaGraphLaunch(graph_exec_, stream));
+#else
+    static bool warned = false;
+    if (!warned) {
+      LOG(WARNING) << "CUDA graphs need CUDA 10 or later, "
+                   << "MXNET_EXEC_ENABLE_CUDA_GRAPHS is ignored";
+      warned = true;
+    }
+    run();
+#endif
+  }
+
+ private:
+  std::mutex mutex_;
+#if CUDART_VERSION >= 10000
+  bool warmed_up_{false};
+  cudaGraphExec_t graph_exec_{nullptr};
+  uint64_t version_{0};
+#endif
+};
+
+}  // namespace exec
+}  // namespace mxnet
+#endif  // MXNET_USE_CUDA
+#endif  // MXNET_EXECUTOR_CUDA_GRAPHS_H_
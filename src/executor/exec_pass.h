@@ -31,9 +31,12 @@
 #include <mxnet/graph_attr_types.h>
 #include <nnvm/graph.h>
 #include <nnvm/graph_attr_types.h>
+#include <functional>
 #include <vector>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace mxnet {
 namespace exec {
@@ -139,6 +142,160 @@ Graph AttachOpResources(Graph g);
  */
 Graph DetectInplaceAddTo(Graph g);
 
+/*! \brief placement attribute of a node, only nodes with the same one are fused */
+std::string CtxGroup(const nnvm::Node& node);
+
+/*!
+ * \brief Copy the operator nodes of a graph, replacing some of them.
+ *
+ *  The nodes of a graph are shared with the symbol of the caller, so a pass
+ *  rewiring them works on copies: every operator node is copied with its
+ *  inputs and control dependencies pointing at the copies, variables are kept.
+ *
+ * \param topo nodes of the graph in topological order.
+ * \param replaced nodes standing in for some of the nodes, their inputs are
+ *  entries of the input graph.
+ * \param fused nodes dropped from the graph, none of them may be used by a
+ *  node left in it.
+ * \param g graph whose outputs are pointed at the copies.
+ */
+void CopyGraphWithReplacements(
+    const std::vector<nnvm::NodePtr>& topo,
+    const std::unordered_map<const nnvm::Node*, nnvm::NodePtr>& replaced,
+    const std::unordered_set<const nnvm::Node*>& fused, Graph* g);
+
+/*!
+ * \brief Replace groups of fusible nodes by single nodes.
+ *
+ *  A group grows from a consumer up to the fusible producers of the same
+ *  __ctx_group__ that only it uses and that are not graph outputs.
+ *
+ * \param g input graph, its nodes are not modified.
+ * \param max_nodes maximum number of nodes of a group.
+ * \param fusible whether a node can be part of a group.
+ * \param fuse node replacing the nodes of a group given its root, whose
+ *  inputs are entries of the input graph, nullptr to leave the group alone.
+ * \param num_replaced output number of nodes replaced.
+ * \return graph with the fused nodes.
+ */
+Graph ReplaceNodeGroups(
+    Graph g, size_t max_nodes,
+    const std::function<bool(const nnvm::Node&)>& fusible,
+    const std::function<nnvm::NodePtr(const nnvm::NodePtr&,
+                                      const std::unordered_set<const nnvm::Node*>&)>& fuse,
+    size_t* num_replaced);
+
+/*!
+ * \brief Replace chains of elementwise operators by _FusedElemwise nodes.
+ *
+ *  Only producers used once by the chain and not graph outputs are fused,
+ *  so the pass is meant for forward only graphs.
+ *
+ * \param g input graph, its nodes are not modified.
+ * \return graph with the fused nodes.
+ */
+Graph FuseElemwise(Graph g);
+
+/*!
+ * \brief Hand groups of operators to the subgraph compiler registered through
+ *  the TVM bridge, each replaced by a _TVMSubgraph node.
+ *
+ *  The operators are the elementwise ones FuseElemwise fuses, or the ones
+ *  listed in MXNET_EXEC_TVM_SUBGRAPH_OPS. Like FuseElemwise, the pass is
+ *  meant for forward only graphs. Without a registered compiler the graph
+ *  is returned unchanged.
+ *
+ * \param g input graph, its nodes are not modified.
+ * \return graph with the subgraph nodes.
+ */
+Graph FuseTVMSubgraph(Graph g);
+
+/*! \brief whether a subgraph compiler was registered through the TVM bridge */
+bool HasTVMSubgraphCompiler();
+
+/*!
+ * \brief Replace BatchNorm -> elemwise_add -> relu chains by BatchNormAddRelu nodes.
+ *
+ *  Runs on the forward graph before the gradient is taken, so that the
+ *  backward pass uses the relu mask saved by the fused node.
+ *
+ * \param g input graph, its nodes are not modified.
+ * \return graph with the fused nodes.
+ */
+Graph FuseBatchNormAddRelu(Graph g);
+
+/*!
+ * \brief Fold inference BatchNorm into the Convolution or FullyConnected producing its input.
+ *
+ *  A layer is folded when it only feeds the BatchNorm, its output channels
+ *  are along axis 1 and all parameters are known float32 CPU arrays.
+ *
+ * \param g input graph, its nodes are rewired in place.
+ * \param arg_params values of the arguments, the folded weights and biases are added.
+ * \param aux_params values of the auxiliary states.
+ * \return graph without the folded BatchNorm nodes.
+ */
+Graph FoldBatchNorm(Graph g, std::unordered_map<std::string, NDArray>* arg_params,
+                    const std::unordered_map<std::string, NDArray>& aux_params);
+
+/*!
+ * \brief Evaluate the operators that only depend on parameters once and replace
+ *  their outputs read by the rest of the graph by new parameters.
+ *
+ *  Operators that mutate inputs, draw random numbers, have control dependencies
+ *  or are Custom are never folded, neither are the outputs of the graph.
+ *
+ * \param g input graph, its nodes are rewired in place.
+ * \param arg_params values of the arguments, the folded outputs are added.
+ * \param inputs names of the arguments fed at every forward, they are not constant.
+ * \return graph reading the folded outputs from arg_params.
+ */
+Graph FoldConstants(Graph g, std::unordered_map<std::string, NDArray>* arg_params,
+                    const std::unordered_set<std::string>& inputs);
+
+/*!
+ * \brief Run the float32 operators of an inference graph in float16.
+ *
+ *  Parameters read in float16 are stored in float16, Cast nodes are inserted
+ *  around operators that need float32, such as softmax, losses, detection and
+ *  the statistics of BatchNorm, and casts that become redundant are dropped.
+ *  The outputs keep their dtypes. The graph is left as is when the operators
+ *  do not infer the dtypes the conversion expects.
+ *
+ * \param g input graph, its nodes are not modified.
+ * \param arg_dtypes known dtypes of the arguments, the converted parameters are set to float16.
+ * \param inputs names of the arguments fed at every forward, they keep their dtypes.
+ * \return graph computing in float16.
+ */
+Graph ConvertFP16(Graph g, std::unordered_map<std::string, int>* arg_dtypes,
+                  const std::unordered_set<std::string>& inputs);
+
+/*!
+ * \brief Replace Convolution nodes followed by a BatchNorm with global statistics,
+ *  an elemwise_add and a relu, or a part of them, by _mkldnn_fused_conv nodes.
+ *
+ * \param g input graph, its nodes are not modified.
+ * \return graph with the fused convolutions.
+ */
+#if MXNET_USE_MKLDNN == 1
+Graph MKLDNNFuseConv(Graph g);
+#endif  // MXNET_USE_MKLDNN == 1
+
+/*!
+ * \brief Insert one _mkldnn_reorder2default node for every output of an MKLDNN operator
+ *  read by operators that need the default layout.
+ *
+ *  MKLDNN operators pass their blocked layouts to each other, and the operators
+ *  reading the default layout share the reordered copy instead of reordering
+ *  the array into a temporary buffer each.
+ *
+ * \param g input graph, its nodes are not modified.
+ * \return graph with the reorder nodes.
+ */
+#if MXNET_USE_MKLDNN == 1
+Graph MKLDNNLayout(Graph g);
+#endif  // MXNET_USE_MKLDNN == 1
+
 /*!
  * \brief Infer shapes in the graph given the information.
  * \param graph The input graph.
@@ -0,0 +1,181 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file fold_batch_norm.cc
+ * \brief fold inference BatchNorm into the preceding Convolution or FullyConnected
+ */
+#include <mxnet/base.h>
+#include <mxnet/ndarray.h>
+#include <nnvm/graph.h>
+#include <nnvm/pass_functions.h>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "./exec_pass.h"
+#include "../operator/nn/batch_norm-inl.h"
+#include "../operator/nn/convolution-inl.h"
+#include "../operator/nn/fully_connected-inl.h"
+
+namespace mxnet {
+namespace exec {
+namespace {
+using nnvm::Node;
+using nnvm::NodeEntry;
+using nnvm::NodePtr;
+
+/*! \brief whether the output channels of the layer are along axis 1 of its output */
+bool ChannelFirstLayer(const Node& node) {
+  const std::string& name = node.op()->name;
+  if (name == "Convolution") {
+    const auto& param = nnvm::get<op::ConvolutionParam>(node.attrs.parsed);
+    if (!param.layout.has_value()) return true;
+    const int layout = param.layout.value();
+    return layout == mshadow::kNCW || layout == mshadow::kNCHW || layout == mshadow::kNCDHW;
+  }
+  if (name == "FullyConnected") {
+    return nnvm::get<op::FullyConnectedParam>(node.attrs.parsed).flatten;
+  }
+  return false;
+}
+
+/*! \brief value of a float32 parameter, or nullptr when it is not known */
+const NDArray* FindParam(const std::unordered_map<std::string, NDArray>& params,
+                         const NodeEntry& e) {
+  if (!e.node->is_variable()) return nullptr;
+  const auto it = params.find(e.node->attrs.name);
+  if (it == params.end()) return nullptr;
+  const NDArray& arr = it->second;
+  if (arr.dtype() != mshadow::kFloat32 || arr.storage_type() != kDefaultStorage ||
+      arr.ctx().dev_mask() != cpu::kDevMask) {
+    return nullptr;
+  }
+  return &arr;
+}
+
+/*! \brief read a CPU parameter after pending writes to it are done */
+const float* ParamData(const NDArray& arr) {
+  arr.WaitToRead();
+  return arr.data().dptr<float>();
+}
+}  // namespace
+
+Graph FoldBatchNorm(Graph g, std::unordered_map<std::string, NDArray>* arg_params,
+                    const std::unordered_map<std::string, NDArray>& aux_params) {
+  static const nnvm::Op* bn_op = nnvm::Op::Get("BatchNorm");
+  std::unordered_map<const Node*, int> num_uses;
+  std::vector<NodePtr> topo;
+  nnvm::DFSVisit(g.outputs, [&](const NodePtr& node) {
+    topo.push_back(node);
+    for (const NodeEntry& e : node->inputs) ++num_uses[e.node.get()];
+    for (const NodePtr& dep : node->control_deps) ++num_uses[dep.get()];
+  });
+  for (const NodeEntry& e : g.outputs) ++num_uses[e.node.get()];
+
+  // the BatchNorm nodes folded away, with the layer replacing them
+  std::unordered_map<const Node*, NodePtr> folded;
+  for (const NodePtr& bn : topo) {
+    if (bn->is_variable() || bn->op() != bn_op || !bn->control_deps.empty()) continue;
+    const auto& bn_param = nnvm::get<op::BatchNormParam>(bn->attrs.parsed);
+    if (bn_param.output_mean_var || bn_param.axis != 1) continue;
+    const NodePtr layer = bn->inputs[0].node;
+    if (layer->is_variable() || num_uses[layer.get()] != 1 || !layer->control_deps.empty() ||
+        !ChannelFirstLayer(*layer)) {
+      continue;
+    }
+    const NDArray* weight = FindParam(*arg_params, layer->inputs[1]);
+    const bool has_bias = layer->inputs.size() > 2;
+    const NDArray* bias = has_bias ? FindParam(*arg_params, layer->inputs[2]) : nullptr;
+    const NDArray* gamma = FindParam(*arg_params, bn->inputs[1]);
+    const NDArray* beta = FindParam(*arg_params, bn->inputs[2]);
+    const NDArray* mean = FindParam(aux_params, bn->inputs[3]);
+    const NDArray* var = FindParam(aux_params, bn->inputs[4]);
+    if (weight == nullptr || (has_bias && bias == nullptr) || (!bn_param.fix_gamma && !gamma) ||
+        beta == nullptr || mean == nullptr || var == nullptr) {
+      continue;
+    }
+    const size_t channels = weight->shape()[0];
+    if (mean->shape().Size() != channels || var->shape().Size() != channels ||
+        beta->shape().Size() != channels ||
+        (!bn_param.fix_gamma && gamma->shape().Size() != channels) ||
+        (has_bias && bias->shape().Size() != channels)) {
+      continue;
+    }
+
+    // W' = W * gamma / sqrt(var + eps), b' = (b - mean) * gamma / sqrt(var + eps) + beta
+    const size_t row = weight->shape().Size() / channels;
+    NDArray new_weight(weight->shape(), Context::CPU(), false, mshadow::kFloat32);
+    NDArray new_bias(mshadow::Shape1(channels), Context::CPU(), false, mshadow::kFloat32);
+    const float* w = ParamData(*weight);
+    const float* b = has_bias ? ParamData(*bias) : nullptr;
+    const float* gm = bn_param.fix_gamma ? nullptr : ParamData(*gamma);
+    const float* bt = ParamData(*beta);
+    const float* mn = ParamData(*mean);
+    const float* vr = ParamData(*var);
+    float* out_w = new_weight.data().dptr<float>();
+    float* out_b = new_bias.data().dptr<float>();
+    for (size_t c = 0; c < channels; ++c) {
+      const double scale = (gm == nullptr ? 1.0 : gm[c]) / std::sqrt(vr[c] + bn_param.eps);
+      for (size_t i = 0; i < row; ++i) {
+        out_w[c * row + i] = static_cast<float>(w[c * row + i] * scale);
+      }
+      out_b[c] = static_cast<float>(((b == nullptr ? 0.0 : b[c]) - mn[c]) * scale + bt[c]);
+    }
+
+    // the layer takes the name of the BatchNorm, so output names do not change, and
+    // gets new variables so parameters shared with other nodes stay intact
+    NodePtr new_layer = Node::Create();
+    new_layer->attrs = layer->attrs;
+    new_layer->attrs.name = bn->attrs.name;
+    new_layer->attrs.dict["no_bias"] = "False";
+    new_layer->attrs.op->attr_parser(&(new_layer->attrs));
+    const std::string weight_name = bn->attrs.name + "_folded_weight";
+    const std::string bias_name = bn->attrs.name + "_folded_bias";
+    NodePtr weight_var = Node::Create();
+    weight_var->attrs.name = weight_name;
+    NodePtr bias_var = Node::Create();
+    bias_var->attrs.name = bias_name;
+    new_layer->inputs = {layer->inputs[0], NodeEntry{weight_var, 0, 0},
+                         NodeEntry{bias_var, 0, 0}};
+    (*arg_params)[weight_name] = new_weight;
+    (*arg_params)[bias_name] = new_bias;
+    folded[bn.get()] = new_layer;
+  }
+  if (folded.empty()) return g;
+
+  // the graph is owned by the caller, consumers of the folded nodes are rewired in place
+  auto rewire = [&folded](NodeEntry* e) {
+    auto it = folded.find(e->node.get());
+    if (it != folded.end()) *e = NodeEntry{it->second, 0, 0};
+  };
+  for (const NodePtr& node : topo) {
+    for (NodeEntry& e : node->inputs) rewire(&e);
+  }
+  for (auto& kv : folded) rewire(&(kv.second->inputs[0]));
+  for (NodeEntry& e : g.outputs) rewire(&e);
+  if (dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+    LOG(INFO) << "FoldBatchNorm: folded " << folded.size() << " BatchNorm nodes";
+  }
+  return g;
+}
+
+}  // namespace exec
+}  // namespace mxnet
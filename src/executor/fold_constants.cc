@@ -0,0 +1,163 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file fold_constants.cc
+ * \brief evaluate the subgraphs of an inference graph that only depend on parameters
+ */
+#include <mxnet/base.h>
+#include <mxnet/executor.h>
+#include <mxnet/ndarray.h>
+#include <mxnet/op_attr_types.h>
+#include <nnvm/graph.h>
+#include <nnvm/pass_functions.h>
+#include <nnvm/symbolic.h>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "./exec_pass.h"
+
+namespace mxnet {
+namespace exec {
+namespace {
+using nnvm::Node;
+using nnvm::NodeEntry;
+using nnvm::NodePtr;
+
+/*! \brief whether evaluating the operator node once gives the result of every later run */
+bool Deterministic(const Node& node) {
+  static auto& fmutate = nnvm::Op::GetAttr<nnvm::FMutateInputs>("FMutateInputs");
+  static auto& fresource = nnvm::Op::GetAttr<FResourceRequest>("FResourceRequest");
+  static const nnvm::Op* custom_op = nnvm::Op::Get("Custom");
+  if (node.op() == custom_op || !node.control_deps.empty()) return false;
+  if (fmutate.count(node.op()) && !fmutate[node.op()](node.attrs).empty()) return false;
+  if (fresource.count(node.op())) {
+    for (const ResourceRequest& req : fresource[node.op()](node.attrs)) {
+      if (req.type == ResourceRequest::kRandom || req.type == ResourceRequest::kParallelRandom) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+}  // namespace
+
+Graph FoldConstants(Graph g, std::unordered_map<std::string, NDArray>* arg_params,
+                    const std::unordered_set<std::string>& inputs) {
+  std::vector<NodePtr> topo;
+  nnvm::DFSVisit(g.outputs, [&](const NodePtr& node) { topo.push_back(node); });
+
+  // a node is constant when it is a known parameter or a deterministic operator of
+  // constants only, operators without inputs such as _zeros included
+  std::unordered_set<const Node*> constant;
+  for (const NodePtr& node : topo) {
+    if (node->is_variable()) {
+      const std::string& name = node->attrs.name;
+      if (arg_params->count(name) && !inputs.count(name)) constant.insert(node.get());
+      continue;
+    }
+    if (!Deterministic(*node)) continue;
+    bool all_constant = true;
+    for (const NodeEntry& e : node->inputs) all_constant &= constant.count(e.node.get()) != 0;
+    if (all_constant) constant.insert(node.get());
+  }
+
+  // the operator outputs read by nodes that are not constant are evaluated, constant graph
+  // outputs are left alone so the output names do not change
+  std::vector<NodeEntry> folded;
+  std::map<std::pair<const Node*, uint32_t>, size_t> folded_index;
+  for (const NodePtr& node : topo) {
+    if (constant.count(node.get())) continue;
+    for (const NodeEntry& e : node->inputs) {
+      if (e.node->is_variable() || !constant.count(e.node.get())) continue;
+      if (folded_index.emplace(std::make_pair(e.node.get(), e.index), folded.size()).second) {
+        folded.push_back(e);
+      }
+    }
+  }
+  if (folded.empty()) return g;
+
+  nnvm::Symbol sub;
+  sub.outputs = folded;
+  std::vector<NDArray> in_args;
+  for (const std::string& name : sub.ListInputNames(nnvm::Symbol::kReadOnlyArgs)) {
+    in_args.push_back(arg_params->at(name));
+  }
+  {
+    // operators like _zeros with unknown dims only get their shape from their consumers
+    Graph sub_g;
+    sub_g.outputs = folded;
+    nnvm::ShapeVector shapes;
+    nnvm::DTypeVector dtypes;
+    for (const NDArray& arr : in_args) {
+      shapes.push_back(arr.shape());
+      dtypes.push_back(arr.dtype());
+    }
+    sub_g = InferShape(std::move(sub_g), std::move(shapes));
+    sub_g = InferType(std::move(sub_g), std::move(dtypes));
+    if (sub_g.GetAttr<size_t>("shape_num_unknown_nodes") != 0U ||
+        sub_g.GetAttr<size_t>("dtype_num_unknown_nodes") != 0U) {
+      return g;
+    }
+  }
+  std::vector<NDArray> outputs;
+  {
+    std::vector<NDArray> arg_grads(in_args.size());
+    std::vector<OpReqType> grad_reqs(in_args.size(), kNullOp);
+    std::unique_ptr<Executor> exec(Executor::Bind(sub, Context::CPU(),
+                                                  std::map<std::string, Context>(), in_args,
+                                                  arg_grads, grad_reqs, std::vector<NDArray>()));
+    exec->Forward(false);
+    for (const NDArray& out : exec->outputs()) outputs.push_back(out.Copy(Context::CPU()));
+  }
+
+  std::vector<NodePtr> vars(folded.size());
+  for (size_t i = 0; i < folded.size(); ++i) {
+    const NodeEntry& e = folded[i];
+    const std::string name = e.node->attrs.name + "_folded" + std::to_string(e.index);
+    vars[i] = Node::Create();
+    vars[i]->attrs.name = name;
+    // consumers like elemwise ops cannot infer the shape of their inputs backwards
+    std::ostringstream os;
+    os << outputs[i].shape();
+    vars[i]->attrs.dict["__shape__"] = os.str();
+    outputs[i].WaitToRead();
+    (*arg_params)[name] = outputs[i];
+  }
+  // the graph is owned by the caller, consumers of the folded outputs are rewired in place
+  for (const NodePtr& node : topo) {
+    if (constant.count(node.get())) continue;
+    for (NodeEntry& e : node->inputs) {
+      auto it = folded_index.find(std::make_pair(e.node.get(), e.index));
+      if (it != folded_index.end()) e = NodeEntry{vars[it->second], 0, 0};
+    }
+  }
+  if (dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+    LOG(INFO) << "FoldConstants: replaced " << folded.size() << " outputs by constants";
+  }
+  return g;
+}
+
+}  // namespace exec
+}  // namespace mxnet
@@ -0,0 +1,123 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file fuse_bn_add_relu_pass.cc
+ * \brief replace BatchNorm -> elemwise_add -> relu chains by BatchNormAddRelu
+ */
+#include <mxnet/base.h>
+#include <nnvm/graph.h>
+#include <nnvm/pass_functions.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "./exec_pass.h"
+#include "../operator/nn/batch_norm-inl.h"
+
+namespace mxnet {
+namespace exec {
+namespace {
+using nnvm::Node;
+using nnvm::NodeEntry;
+using nnvm::NodePtr;
+
+/*! \brief whether the node is a BatchNorm over axis 1 showing only its output */
+bool IsFusableBatchNorm(const Node& node) {
+  if (node.is_variable() || node.op()->name != "BatchNorm" || !node.control_deps.empty()) {
+    return false;
+  }
+  const auto& param = nnvm::get<op::BatchNormParam>(node.attrs.parsed);
+  return !param.output_mean_var && param.axis == 1;
+}
+
+bool IsRelu(const Node& node) {
+  if (node.op()->name == "relu") return true;
+  if (node.op()->name != "Activation") return false;
+  const auto it = node.attrs.dict.find("act_type");
+  return it != node.attrs.dict.end() && it->second == "relu";
+}
+}  // namespace
+
+Graph FuseBatchNormAddRelu(Graph g) {
+  // count the uses of every node, graph outputs and control dependencies
+  // keep a node from being fused into its consumer
+  std::unordered_map<const Node*, int> num_uses;
+  std::unordered_map<const Node*, NodePtr> consumer;
+  std::vector<NodePtr> topo;
+  nnvm::DFSVisit(g.outputs, [&](const NodePtr& node) {
+    topo.push_back(node);
+    for (const NodeEntry& e : node->inputs) {
+      ++num_uses[e.node.get()];
+      consumer[e.node.get()] = node;
+    }
+    for (const NodePtr& dep : node->control_deps) ++num_uses[dep.get()];
+  });
+  for (const NodeEntry& e : g.outputs) ++num_uses[e.node.get()];
+
+  // the single consumer of node, if it is an operator in the group of bn
+  auto next = [&](const NodePtr& node, const NodePtr& bn) -> NodePtr {
+    if (num_uses[node.get()] != 1 || !consumer.count(node.get())) return nullptr;
+    const NodePtr& c = consumer.at(node.get());
+    if (!c->control_deps.empty() || CtxGroup(*c) != CtxGroup(*bn)) return nullptr;
+    return c;
+  };
+
+  // the nodes folded into the fused ones, and the fused node replacing the relu of a chain
+  std::unordered_set<const Node*> fused;
+  std::unordered_map<const Node*, NodePtr> replaced;
+  for (const NodePtr& bn : topo) {
+    if (!IsFusableBatchNorm(*bn)) continue;
+    const NodePtr add = next(bn, bn);
+    if (add == nullptr || add->op()->name != "elemwise_add") continue;
+    const NodePtr relu = next(add, bn);
+    if (relu == nullptr || !IsRelu(*relu)) continue;
+
+    // the fused node takes the name of the relu, so output names do not
+    // change, and lists its inputs in the DFS order of the nodes it replaces
+    const bool addend_first = add->inputs[1].node == bn;
+    const NodeEntry& addend = add->inputs[addend_first ? 0 : 1];
+    NodePtr node = Node::Create();
+    node->attrs.op = nnvm::Op::Get("BatchNormAddRelu");
+    node->attrs.name = relu->attrs.name;
+    node->attrs.dict = bn->attrs.dict;
+    node->attrs.dict["addend_first"] = addend_first ? "True" : "False";
+    node->attrs.op->attr_parser(&(node->attrs));
+    if (addend_first) node->inputs.push_back(addend);
+    node->inputs.insert(node->inputs.end(), bn->inputs.begin(), bn->inputs.end());
+    if (!addend_first) node->inputs.push_back(addend);
+    fused.insert(bn.get());
+    fused.insert(add.get());
+    replaced[relu.get()] = node;
+  }
+  if (replaced.empty()) return g;
+
+  // the relu of each chain is replaced by the BatchNormAddRelu node, the
+  // BatchNorm and elemwise_add feeding it are dropped
+  CopyGraphWithReplacements(topo, replaced, fused, &g);
+  if (dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+    LOG(INFO) << "FuseBatchNormAddRelu: fused " << replaced.size()
+              << " BatchNorm, elemwise_add and relu chains";
+  }
+  return g;
+}
+
+}  // namespace exec
+}  // namespace mxnet
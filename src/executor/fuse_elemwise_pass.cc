@@ -0,0 +1,318 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file fuse_elemwise_pass.cc
+ * \brief replace chains of elementwise operators by _FusedElemwise nodes
+ */
+#include <mxnet/base.h>
+#include <nnvm/graph.h>
+#include <nnvm/pass_functions.h>
+#include <functional>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "./exec_pass.h"
+#include "../operator/fused_elemwise-inl.h"
+
+namespace mxnet {
+namespace exec {
+namespace {
+using nnvm::Node;
+using nnvm::NodeEntry;
+using nnvm::NodePtr;
+using op::FusedElemwiseStep;
+
+/*! \brief the step of a node, or -1 if the node cannot be fused */
+int FusedStepType(const Node& node) {
+  using namespace op::fused_elemwise;
+  if (node.is_variable() || node.num_outputs() != 1 || !node.control_deps.empty()) return -1;
+  static const std::unordered_map<std::string, int> steps = {
+    {"elemwise_add", kAdd}, {"elemwise_sub", kSub}, {"elemwise_mul", kMul},
+    {"elemwise_div", kDiv}, {"_plus_scalar", kPlusScalar},
+    {"_minus_scalar", kMinusScalar}, {"_rminus_scalar", kRMinusScalar},
+    {"_mul_scalar", kMulScalar}, {"_div_scalar", kDivScalar},
+    {"_rdiv_scalar", kRDivScalar}, {"relu", kRelu}, {"sigmoid", kSigmoid},
+    {"tanh", kTanh}, {"exp", kExp}, {"log", kLog}, {"sqrt", kSqrt},
+    {"square", kSquare}, {"negative", kNegative}, {"abs", kAbs}};
+  const std::string& name = node.op()->name;
+  if (name == "Activation") {
+    const auto it = node.attrs.dict.find("act_type");
+    if (it == node.attrs.dict.end()) return -1;
+    if (it->second == "relu") return kRelu;
+    if (it->second == "sigmoid") return kSigmoid;
+    if (it->second == "tanh") return kTanh;
+    return -1;
+  }
+  const auto it = steps.find(name);
+  return it == steps.end() ? -1 : it->second;
+}
+
+/*! \brief one group of nodes to fuse, rooted at the node producing its output */
+struct FusedGroup {
+  std::unordered_set<const Node*> nodes;
+  std::vector<FusedElemwiseStep> steps;
+  std::vector<NodeEntry> inputs;
+  /*! \brief operand id of every node and external entry already emitted */
+  std::unordered_map<const Node*, int> node_operand;
+  std::unordered_map<const Node*, std::unordered_map<uint32_t, int> > input_operand;
+};
+
+/*!
+ * \brief emit the steps computing entry e, inputs first from left to right,
+ *  so that the new node lists its inputs in the DFS order of the original
+ *  subgraph and the order of the graph inputs does not change.
+ */
+int Emit(const NodeEntry& e, FusedGroup* group) {
+  const Node* node = e.node.get();
+  if (!group->nodes.count(node)) {
+    auto& operands = group->input_operand[node];
+    auto it = operands.find(e.index);
+    if (it != operands.end()) return it->second;
+    const int id = static_cast<int>(group->inputs.size());
+    group->inputs.push_back(e);
+    operands[e.index] = id;
+    return id;
+  }
+  auto it = group->node_operand.find(node);
+  if (it != group->node_operand.end()) return it->second;
+  FusedElemwiseStep step;
+  step.op = FusedStepType(*node);
+  step.lhs = Emit(node->inputs[0], group);
+  step.rhs = op::fused_elemwise::IsBinary(step.op) ? Emit(node->inputs[1], group) : -1;
+  step.scalar = 0;
+  if (node->op()->name.find("_scalar") != std::string::npos) {
+    step.scalar = nnvm::get<double>(node->attrs.parsed);
+  }
+  group->steps.push_back(step);
+  const int id = -static_cast<int>(group->steps.size());
+  group->node_operand[node] = id;
+  return id;
+}
+}  // namespace
+
+std::string CtxGroup(const Node& node) {
+  const auto it = node.attrs.dict.find("__ctx_group__");
+  return it == node.attrs.dict.end() ? std::string() : it->second;
+}
+
+void CopyGraphWithReplacements(const std::vector<NodePtr>& topo,
+                               const std::unordered_map<const Node*, NodePtr>& replaced,
+                               const std::unordered_set<const Node*>& fused, Graph* g) {
+  std::unordered_map<const Node*, NodePtr> copied;
+  auto remap = [&copied](const NodeEntry& e) {
+    return NodeEntry{copied.at(e.node.get()), e.index, e.version};
+  };
+  for (const NodePtr& node : topo) {
+    if (node->is_variable()) {
+      copied[node.get()] = node;
+      continue;
+    }
+    auto it = replaced.find(node.get());
+    NodePtr copy;
+    if (it != replaced.end()) {
+      copy = it->second;
+    } else if (fused.count(node.get())) {
+      continue;
+    } else {
+      copy = Node::Create();
+      copy->attrs = node->attrs;
+      copy->inputs = node->inputs;
+      for (const NodePtr& dep : node->control_deps) {
+        copy->control_deps.push_back(copied.at(dep.get()));
+      }
+    }
+    for (NodeEntry& e : copy->inputs) e = remap(e);
+    copied[node.get()] = copy;
+  }
+  for (NodeEntry& e : g->outputs) e = remap(e);
+}
+
+Graph ReplaceNodeGroups(
+    Graph g, size_t max_nodes,
+    const std::function<bool(const Node&)>& fusible,
+    const std::function<NodePtr(const NodePtr&, const std::unordered_set<const Node*>&)>& fuse,
+    size_t* num_replaced) {
+  // count the uses of every output, graph outputs and control dependencies
+  // keep a node from being fused into its consumer
+  std::unordered_map<const Node*, int> num_uses;
+  std::unordered_set<const Node*> pinned;
+  std::vector<NodePtr> topo;
+  nnvm::DFSVisit(g.outputs, [&](const NodePtr& node) {
+    topo.push_back(node);
+    for (const NodeEntry& e : node->inputs) ++num_uses[e.node.get()];
+    for (const NodePtr& dep : node->control_deps) pinned.insert(dep.get());
+  });
+  for (const NodeEntry& e : g.outputs) pinned.insert(e.node.get());
+
+  // grow groups from the consumers down to their producers
+  std::unordered_set<const Node*> fused;
+  std::unordered_map<const Node*, NodePtr> replaced;
+  for (auto it = topo.rbegin(); it != topo.rend(); ++it) {
+    const NodePtr& root = *it;
+    if (fused.count(root.get()) || !fusible(*root)) continue;
+    std::unordered_set<const Node*> nodes = {root.get()};
+    std::vector<const Node*> frontier = {root.get()};
+    while (!frontier.empty() && nodes.size() < max_nodes) {
+      const Node* node = frontier.back();
+      frontier.pop_back();
+      for (const NodeEntry& e : node->inputs) {
+        const Node* producer = e.node.get();
+        if (nodes.size() >= max_nodes) break;
+        if (nodes.count(producer) || fused.count(producer) || pinned.count(producer) ||
+            num_uses[producer] != 1 || !fusible(*producer) ||
+            CtxGroup(*producer) != CtxGroup(*root)) {
+          continue;
+        }
+        nodes.insert(producer);
+        frontier.push_back(producer);
+      }
+    }
+    if (nodes.size() < 2) continue;
+    NodePtr node = fuse(root, nodes);
+    if (node == nullptr) continue;
+    for (const Node* n : nodes) fused.insert(n);
+    replaced[root.get()] = node;
+  }
+  *num_replaced = fused.size();
+  if (replaced.empty()) return g;
+
+  // the root of each group is replaced, consumers of its output read the fused node
+  CopyGraphWithReplacements(topo, replaced, fused, &g);
+  return g;
+}
+
+Graph FuseElemwise(Graph g) {
+  using namespace op::fused_elemwise;
+  size_t num_groups = 0, num_fused = 0;
+  auto fuse = [&num_groups](const NodePtr& root, const std::unordered_set<const Node*>& nodes) {
+    FusedGroup group;
+    group.nodes = nodes;
+    Emit(NodeEntry{root, 0, 0}, &group);
+    if (group.inputs.size() > static_cast<size_t>(kMaxInputs)) return NodePtr();
+    // steps refer to earlier steps with negative ids until the inputs are known
+    const int num_inputs = static_cast<int>(group.inputs.size());
+    for (FusedElemwiseStep& step : group.steps) {
+      if (step.lhs < 0) step.lhs = num_inputs - step.lhs - 1;
+      if (step.rhs < -1 || (step.rhs == -1 && IsBinary(step.op))) {
+        step.rhs = num_inputs - step.rhs - 1;
+      }
+    }
+    NodePtr node = Node::Create();
+    node->attrs.op = nnvm::Op::Get("_FusedElemwise");
+    node->attrs.name = root->attrs.name;
+    for (const auto& kv : root->attrs.dict) {
+      if (kv.first.compare(0, 2, "__") == 0) node->attrs.dict.insert(kv);
+    }
+    node->attrs.dict["num_inputs"] = std::to_string(num_inputs);
+    node->attrs.dict["program"] = op::FusedElemwiseProgramString(group.steps);
+    node->attrs.op->attr_parser(&(node->attrs));
+    node->inputs = group.inputs;
+    ++num_groups;
+    return node;
+  };
+  g = ReplaceNodeGroups(std::move(g), kMaxSteps,
+                        [](const Node& node) { return FusedStepType(node) >= 0; },
+                        fuse, &num_fused);
+  if (num_groups != 0 && dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+    LOG(INFO) << "FuseElemwise: replaced " << num_fused << " nodes by "
+              << num_groups << " fused nodes";
+  }
+  return g;
+}
+
+Graph FuseTVMSubgraph(Graph g) {
+  if (!HasTVMSubgraphCompiler()) return g;
+  static const std::unordered_set<std::string> listed = []() {
+    std::unordered_set<std::string> ops;
+    std::istringstream names(dmlc::GetEnv("MXNET_EXEC_TVM_SUBGRAPH_OPS", std::string()));
+    std::string name;
+    while (std::getline(names, name, ',')) {
+      if (!name.empty()) ops.insert(name);
+    }
+    return ops;
+  }();
+  static const auto& fmutate = nnvm::Op::GetAttr<nnvm::FMutateInputs>("FMutateInputs");
+  auto fusible = [](const Node& node) {
+    if (node.is_variable() || node.num_outputs() != 1 || !node.control_deps.empty() ||
+        fmutate.count(node.op())) {
+      return false;
+    }
+    return listed.empty() ? FusedStepType(node) >= 0 : listed.count(node.op()->name) != 0;
+  };
+  size_t num_groups = 0, num_fused = 0;
+  auto fuse = [&num_groups](const NodePtr& root, const std::unordered_set<const Node*>& nodes) {
+    // copy the group into a standalone graph whose inputs are the variables
+    // data0, data1, ... in the DFS order of the group
+    std::vector<NodeEntry> inputs;
+    std::map<std::pair<const Node*, uint32_t>, NodeEntry> input_vars;
+    std::unordered_map<const Node*, NodePtr> copies;
+    std::function<NodeEntry(const NodeEntry&)> copy = [&](const NodeEntry& e) -> NodeEntry {
+      const Node* node = e.node.get();
+      if (!nodes.count(node)) {
+        const auto key = std::make_pair(node, e.index);
+        auto it = input_vars.find(key);
+        if (it != input_vars.end()) return it->second;
+        NodePtr var = Node::Create();
+        var->attrs.name = "data" + std::to_string(inputs.size());
+        inputs.push_back(e);
+        return input_vars[key] = NodeEntry{var, 0, 0};
+      }
+      auto it = copies.find(node);
+      if (it == copies.end()) {
+        NodePtr c = Node::Create();
+        c->attrs = node->attrs;
+        for (const NodeEntry& in : node->inputs) c->inputs.push_back(copy(in));
+        it = copies.emplace(node, c).first;
+      }
+      return NodeEntry{it->second, e.index, 0};
+    };
+    Graph subgraph;
+    subgraph.outputs.push_back(copy(NodeEntry{root, 0, 0}));
+
+    NodePtr node = Node::Create();
+    node->attrs.op = nnvm::Op::Get("_TVMSubgraph");
+    node->attrs.name = root->attrs.name;
+    for (const auto& kv : root->attrs.dict) {
+      if (kv.first.compare(0, 2, "__") == 0) node->attrs.dict.insert(kv);
+    }
+    node->attrs.dict["num_inputs"] = std::to_string(inputs.size());
+    node->attrs.dict["graph"] = nnvm::pass::SaveJSON(subgraph);
+    node->attrs.op->attr_parser(&(node->attrs));
+    node->inputs = inputs;
+    ++num_groups;
+    return node;
+  };
+  g = ReplaceNodeGroups(std::move(g), std::numeric_limits<size_t>::max(), fusible, fuse,
+                        &num_fused);
+  if (num_groups != 0 && dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+    LOG(INFO) << "FuseTVMSubgraph: replaced " << num_fused << " nodes by "
+              << num_groups << " subgraph nodes";
+  }
+  return g;
+}
+
+}  // namespace exec
+}  // namespace mxnet
@@ -27,10 +27,19 @@
 #include <nnvm/pass_functions.h>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "./exec_pass.h"
 #include "./graph_executor.h"
+#include "./cuda_graphs.h"
 #include "../profiler/profiler.h"
+#include "../profiler/nvtx.h"
 #include "../common/utils.h"
 
 namespace mxnet {
@@ -102,11 +111,12 @@ void GraphExecutor::Backward(const std::vector<NDArray>& head_grads, bool is_tra
             << "If you are attempting to minimize the output as "
             << "an objective, please modify your network and "
             << "pass it through the make_loss symbol.";
-        CopyFromTo(head_grads[i], &(head_grad_array_[i]));
+        CopyFromTo(head_grads[i], &(head_grad_array_[i]), priority_);
       }
     }
   }
   RunOps(is_train, num_forward_nodes_, idx.num_nodes());
+  if (measure_node_time_ && --measure_runs_left_ == 0) FinishMeasureNodeTime();
 }
 
 void GraphExecutor::Print(std::ostream &os) const {  // NOLINT(*)
@@ -139,6 +149,19 @@ const std::unordered_map<std::string, NDArray>& GraphExecutor::aux_state_map() c
   return aux_state_map_;
 }
 
+/*!
+ * \brief bytes of a new array of a pool shared between executors, rounded up to
+ *  one of num_classes size classes per power of two. Executors of other buckets
+ *  with slightly larger entries then fit in the arrays already in the pool.
+ */
+static size_t SharedPoolBytes(size_t bytes, int num_classes) {
+  if (num_classes <= 0 || bytes <= 4) return bytes;
+  size_t base = 1;
+  while (base <= bytes / 2) base <<= 1;
+  const size_t step = std::max<size_t>(base / num_classes, 4);
+  return (bytes + step - 1) / step * step;
+}
+
 static nnvm::NodeEntry AttrHint(nnvm::NodeEntry src, nnvm::NodeEntry like) {
   static const Op* id_like = Op::Get("_identity_with_attr_like_rhs");
   nnvm::NodePtr n = nnvm::Node::Create();
@@ -242,12 +265,112 @@ inline ValueType get_node_attr(
   }
 }
 
+/*!
+ * \brief Infer the shapes of a graph from the known argument shapes.
+ * \return whether the shapes of all entries are known
+ */
+static bool InferKnownShapes(const std::unordered_map<std::string, TShape>& arg_shapes,
+                             nnvm::Graph* g) {
+  const auto& idx = g->indexed_graph();
+  nnvm::ShapeVector in_shapes(idx.input_nodes().size());
+  for (size_t i = 0; i < idx.input_nodes().size(); ++i) {
+    auto it = arg_shapes.find(idx[idx.input_nodes()[i]].source->attrs.name);
+    if (it != arg_shapes.end()) in_shapes[i] = it->second;
+  }
+  try {
+    *g = InferShape(std::move(*g), std::move(in_shapes), "__shape__");
+    return g->GetAttr<size_t>("shape_num_unknown_nodes") == 0U;
+  } catch (const dmlc::Error&) {
+    return false;
+  }
+}
+
+/*!
+ * \brief Choose the forward nodes to recompute in backward so that the
+ *  activations fit in budget bytes.
+ *
+ *  Greedy segmentation of [Chen et al. 2016]: nodes are walked in topological
+ *  order and the output of a node is kept whenever the outputs dropped since
+ *  the previous kept one exceed a segment size. The estimated peak is the kept
+ *  outputs plus the largest segment, and the smallest segment size (the least
+ *  recomputation) under the budget is used. With budget 0 the segment size is
+ *  total / sqrt(n). Shapes come from the known argument shapes; when they do
+ *  not determine all activations every node counts the same.
+ */
+static std::unordered_set<const nnvm::Node*> BudgetMirrorNodes(
+    const nnvm::Graph& fwd, const std::unordered_map<std::string, TShape>& arg_shapes,
+    const std::function<bool(const nnvm::Node&)>& can_mirror, size_t budget) {
+  nnvm::Graph g;
+  g.outputs = fwd.outputs;
+  const bool known = InferKnownShapes(arg_shapes, &g);
+  const auto& idx = g.indexed_graph();
+  // output size of every forward operator, float32 assumed
+  std::vector<double> sizes(idx.num_nodes(), 0);
+  double total = 0;
+  size_t num_ops = 0;
+  for (uint32_t nid = 0; nid < idx.num_nodes(); ++nid) {
+    if (idx[nid].source->is_variable()) continue;
+    if (known) {
+      const auto& shapes = g.GetAttr<nnvm::ShapeVector>("shape");
+      for (uint32_t i = 0; i < idx[nid].source->num_outputs(); ++i) {
+        sizes[nid] += 4.0 * shapes[idx.entry_id(nid, i)].Size();
+      }
+    } else {
+      sizes[nid] = 1;
+    }
+    total += sizes[nid];
+    ++num_ops;
+  }
+  std::unordered_set<const nnvm::Node*> mirror;
+  if (num_ops == 0) return mirror;
+  auto segment = [&](double segment_size, std::unordered_set<const nnvm::Node*>* out) {
+    double kept = 0, dropped = 0, peak_segment = 0;
+    for (uint32_t nid = 0; nid < idx.num_nodes(); ++nid) {
+      const nnvm::Node* node = idx[nid].source;
+      if (node->is_variable()) continue;
+      if (!can_mirror(*node) || dropped + sizes[nid] > segment_size) {
+        kept += sizes[nid];
+        peak_segment = std::max(peak_segment, dropped);
+        dropped = 0;
+        continue;
+      }
+      dropped += sizes[nid];
+      if (out != nullptr) out->insert(node);
+    }
+    return kept + std::max(peak_segment, dropped);
+  };
+  double segment_size = total / std::sqrt(static_cast<double>(num_ops));
+  if (budget != 0 && known) {
+    if (total <= budget) return mirror;
+    // from the most kept outputs to the least, stop at the first plan that fits
+    double best = segment(segment_size, nullptr);
+    for (double size = total / num_ops; size <= total; size *= 1.1) {
+      const double peak = segment(size, nullptr);
+      if (peak <= budget) {
+        segment_size = size;
+        best = peak;
+        break;
+      }
+      if (peak < best) {
+        segment_size = size;
+        best = peak;
+      }
+    }
+    LOG_IF(WARNING, best > budget)
+      << "Activations need an estimated " << (best / (1 << 20))
+      << " MB with mirroring, more than MXNET_BACKWARD_MIRROR_BUDGET_MB";
+  }
+  segment(segment_size, &mirror);
+  return mirror;
+}
+
 /*!
  * \brief Create the graph for backward pass.
  * This is triggered by both simple_bind and bind flows.
  */
-nnvm::Graph GraphExecutor::InitFullGraph(nnvm::Symbol symbol,
-                                         const std::vector<OpReqType>& grad_req_types) {
+nnvm::Graph GraphExecutor::InitFullGraph(
+    nnvm::Symbol symbol, const std::vector<OpReqType>& grad_req_types,
+    const std::unordered_map<std::string, TShape>& arg_shapes) {
   using nnvm::NodePtr;
   using nnvm::NodeEntry;
   // initial information
@@ -260,7 +383,11 @@ nnvm::Graph GraphExecutor::InitFullGraph(nnvm::Symbol symbol,
   for (OpReqType req : grad_req_types) {
     if (req != kNullOp) need_grad = true;
   }
-  if (!need_grad) return g;
+  if (!need_grad) {
+    if (dmlc::GetEnv("MXNET_EXEC_TVM_SUBGRAPH", false)) g = FuseTVMSubgraph(std::move(g));
+    if (dmlc::GetEnv("MXNET_EXEC_FUSE_ELEMWISE", false)) g = FuseElemwise(std::move(g));
+    return g;
+  }
   for (size_t i = 0; i < g.outputs.size(); ++i) {
     NodeEntry ngrad{nnvm::Node::Create(), 0, 0};
     head_grad_entry_.emplace_back(AttrHint(ngrad, g.outputs[i]));
@@ -275,17 +402,32 @@ nnvm::Graph GraphExecutor::InitFullGraph(nnvm::Symbol symbol,
   }
 
   int do_mirror = dmlc::GetEnv("MXNET_BACKWARD_DO_MIRROR", 0);
-  auto need_mirror = [do_mirror](const nnvm::Node& node) -> int {
+  const int budget_mb = dmlc::GetEnv("MXNET_BACKWARD_MIRROR_BUDGET_MB", 0);
+  // recomputing these would draw new random numbers or update states twice
+  static const auto& fmutate = nnvm::Op::GetAttr<nnvm::FMutateInputs>("FMutateInputs");
+  auto can_mirror = [](const nnvm::Node& node) {
+    const std::string& type = node.attrs.op->name;
+    return type != "Dropout" && type != "BatchNorm" && type != "CuDNNBatchNorm" &&
+           !fmutate.count(node.op());
+  };
+  std::unordered_set<const nnvm::Node*> budget_mirror;
+  if (do_mirror == 2 || budget_mb > 0) {
+    budget_mirror = BudgetMirrorNodes(g, arg_shapes, can_mirror,
+                                      static_cast<size_t>(budget_mb) << 20);
+  }
+  auto need_mirror = [do_mirror, &budget_mirror, budget_mb](const nnvm::Node& node) -> int {
     if (node.is_variable()) return 0;
     const std::string& type = node.attrs.op->name;
     if (type == "Dropout") return false;
     if (get_node_attr(node, "__force_mirroring__", false)) return true;
+    if (do_mirror == 2 || budget_mb > 0) return budget_mirror.count(&node) != 0;
     if (do_mirror == 0) return false;
     if (type == "Convolution") return false;
     if (type == "FullyConnected") return false;
     if (type == "Concat") return false;
     if (type == "SoftmaxOutput") return false;
     if (type == "BatchNorm") return false;
+    if (type == "BatchNormAddRelu") return false;
     if (type == "CuDNNBatchNorm") return false;
     return true;
   };
@@ -306,6 +448,106 @@ nnvm::Graph GraphExecutor::InitFullGraph(nnvm::Symbol symbol,
   return g;
 }
 
+/*!
+ * \brief Swap forward activations used by backward to pinned host memory.
+ *
+ *  Every forward output read by backward and of at least min_bytes is copied
+ *  by a host node in group __offload_host__, and backward reads it from there.
+ *  PlaceDevice then inserts the device to host copy, ordered before the first
+ *  forward node after the last forward use of the output, and the host to
+ *  device copy, which the engine starts as soon as backward is pushed. The
+ *  device memory of the output is thus free for the rest of the forward pass.
+ *  The backward readers are put in group __offload_device__ so they stay on
+ *  the device.
+ * \return the number of outputs offloaded
+ */
+static size_t OffloadActivations(nnvm::Graph* g, size_t num_forward_outputs,
+                                 const std::unordered_map<std::string, TShape>& arg_shapes,
+                                 size_t min_bytes) {
+  using nnvm::Node;
+  using nnvm::NodeEntry;
+  using nnvm::NodePtr;
+  nnvm::Graph fwd;
+  fwd.outputs.assign(g->outputs.begin(), g->outputs.begin() + num_forward_outputs);
+  const bool known = InferKnownShapes(arg_shapes, &fwd);
+  const auto& fwd_idx = fwd.indexed_graph();
+  if (!known && min_bytes != 0) return 0;
+
+  // the last forward reader of every forward node, as a position in fwd_idx
+  std::vector<int> last_use(fwd_idx.num_nodes(), -1);
+  for (uint32_t nid = 0; nid < fwd_idx.num_nodes(); ++nid) {
+    for (const auto& e : fwd_idx[nid].inputs) last_use[e.node_id] = nid;
+    for (uint32_t dep : fwd_idx[nid].control_deps) last_use[dep] = nid;
+  }
+  for (const auto& e : fwd_idx.outputs()) last_use[e.node_id] = fwd_idx.num_nodes();
+
+  // copies of the operators, the backward readers of offloaded outputs and the
+  // forward nodes ordering the device to host copies are rewired below
+  std::vector<NodePtr> topo;
+  std::unordered_map<const Node*, NodePtr> copied;
+  nnvm::DFSVisit(g->outputs, [&](const NodePtr& node) {
+    topo.push_back(node);
+    if (node->is_variable()) {
+      copied[node.get()] = node;
+      return;
+    }
+    NodePtr copy = Node::Create();
+    copy->attrs = node->attrs;
+    // only used without group2ctx, where the groups are ignored
+    copy->attrs.dict.erase("__ctx_group__");
+    for (const NodeEntry& e : node->inputs) {
+      copy->inputs.push_back(NodeEntry{copied.at(e.node.get()), e.index, e.version});
+    }
+    for (const NodePtr& dep : node->control_deps) {
+      copy->control_deps.push_back(copied.at(dep.get()));
+    }
+    copied[node.get()] = copy;
+  });
+
+  static const nnvm::Op* copy_op = nnvm::Op::Get("_copy");
+  // host copy of every offloaded (node, output index)
+  std::unordered_map<const Node*, std::unordered_map<uint32_t, NodeEntry> > host;
+  size_t num_offloaded = 0;
+  for (const NodePtr& node : topo) {
+    if (fwd_idx.exist(node.get())) continue;
+    NodePtr copy = copied.at(node.get());
+    for (size_t i = 0; i < node->inputs.size(); ++i) {
+      const NodeEntry& e = node->inputs[i];
+      if (e.node->is_variable() || !fwd_idx.exist(e.node.get())) continue;
+      const uint32_t nid = fwd_idx.node_id(e.node.get());
+      // the copy is ordered before the next operator after the last forward
+      // reader, forward outputs are needed after forward and have none
+      uint32_t next = std::max(last_use[nid], static_cast<int>(nid)) + 1;
+      while (next < fwd_idx.num_nodes() && fwd_idx[next].source->is_variable()) ++next;
+      if (next >= fwd_idx.num_nodes()) continue;
+      // float32 assumed, as types are not inferred yet
+      if (known && 4 * fwd.GetAttr<nnvm::ShapeVector>("shape")[
+              fwd_idx.entry_id(nid, e.index)].Size() < min_bytes) {
+        continue;
+      }
+      auto& outputs = host[e.node.get()];
+      auto it = outputs.find(e.index);
+      if (it == outputs.end()) {
+        NodePtr h = Node::Create();
+        h->attrs.op = copy_op;
+        h->attrs.name = e.node->attrs.name + "_offload" + std::to_string(e.index);
+        h->attrs.dict["__ctx_group__"] = "__offload_host__";
+        h->inputs.push_back(NodeEntry{copied.at(e.node.get()), e.index, e.version});
+        copied.at(fwd_idx[next].source)->control_deps.push_back(h);
+        it = outputs.emplace(e.index, NodeEntry{h, 0, 0}).first;
+        ++num_offloaded;
+      }
+      copy->inputs[i] = it->second;
+      copy->attrs.dict["__ctx_group__"] = "__offload_device__";
+    }
+  }
+  if (num_offloaded == 0) return 0;
+  for (NodeEntry& e : g->outputs) {
+    e = NodeEntry{copied.at(e.node.get()), e.index, e.version};
+  }
+  return num_offloaded;
+}
+
 /*!
  * \brief Assign context to the graph.
  * This is triggered by both simple_bind and bind flows.
@@ -531,8 +773,18 @@ void GraphExecutor::Init(nnvm::Symbol symbol,
   std::vector<Context> aux_state_ctxes(aux_states.size());
   std::transform(aux_states.begin(), aux_states.end(), aux_state_ctxes.begin(), get_ctx1);
 
+  std::unordered_map<std::string, TShape> arg_shape_map;
+  const std::vector<std::string> arg_names = symbol.ListInputNames(nnvm::Symbol::kReadOnlyArgs);
+  const std::vector<std::string> aux_names =
+      symbol.ListInputNames(nnvm::Symbol::kAuxiliaryStates);
+  for (size_t i = 0; i < arg_names.size() && i < in_args.size(); ++i) {
+    arg_shape_map[arg_names[i]] = in_args[i].shape();
+  }
+  for (size_t i = 0; i < aux_names.size() && i < aux_states.size(); ++i) {
+    arg_shape_map[aux_names[i]] = aux_states[i].shape();
+  }
   nnvm::Graph g = InitGraph(symbol, default_ctx, ctx_map, in_arg_ctxes,
-                            arg_grad_ctxes, aux_state_ctxes, grad_req_types);
+                            arg_grad_ctxes, aux_state_ctxes, grad_req_types, arg_shape_map);
 
   // create arg_shapes and arg_dtypes for shape and type inferences
   const auto& idx = g.indexed_graph();
@@ -749,6 +1001,8 @@ void GraphExecutor::InitArguments(const nnvm::IndexedGraph& idx,
                                   std::vector<NDArray>* in_arg_vec,
                                   std::vector<NDArray>* arg_grad_vec,
                                   std::vector<NDArray>* aux_state_vec) {
+  // the arrays allocated here are attributed to weights by the memory profiler
+  Storage::AllocScope alloc_scope(nullptr, Storage::kWeight);
   // initialize in_args, arg_grads, and aux_states and populate grad_store_
   data_entry_.resize(idx.num_node_entries());
   size_t arg_top = 0, aux_top = 0;
@@ -899,8 +1153,15 @@ void GraphExecutor::FinishInitGraph(nnvm::Symbol symbol,
     for (size_t i = 0; i < idx.num_node_entries(); i++) {
       if (vstorage_type[i] != kDefaultStorage) arg_storage_id[i] = kDynamicStorageID;
     }
-    g.attrs["storage"] = std::make_shared<dmlc::any>(std::move(arg_storage_id));
-    g = nnvm::ApplyPass(g, "PlanMemory");
+    plan_reused_ = shared_exec != nullptr &&
+        ReuseMemoryPlan(dynamic_cast<GraphExecutor*>(shared_exec), arg_storage_id, &g);
+    if (!plan_reused_) {
+      plan_input_storage_ = arg_storage_id;
+      g.attrs["storage"] = std::make_shared<dmlc::any>(std::move(arg_storage_id));
+      g = nnvm::ApplyPass(g, "PlanMemory");
+      plan_storage_id_ = g.GetAttr<nnvm::StorageVector>("storage_id");
+      plan_inplace_index_ = g.GetAttr<std::vector<int> >("storage_inplace_index");
+    }
   }
   g = DetectInplaceAddTo(g);
 
@@ -965,8 +1226,21 @@ void GraphExecutor::Init(nnvm::Symbol symbol,
                          std::unordered_map<std::string, NDArray>* shared_buffer,
                          Executor* shared_exec,
                          const nnvm::NodeEntryMap<NDArray>& feed_dict) {
+  // inference on a gpu may run in float16, the arguments without a given shape are
+  // taken as parameters and allocated in the dtypes the conversion picks
+  std::unordered_map<std::string, int> arg_dtypes(arg_dtype_map);
+  if (default_ctx.dev_mask() == gpu::kDevMask &&
+      std::all_of(grad_req_types.begin(), grad_req_types.end(),
+                  [](OpReqType req) { return req == kNullOp; }) &&
+      dmlc::GetEnv("MXNET_EXEC_FP16_INFERENCE", false)) {
+    std::unordered_set<std::string> inputs;
+    for (const auto& kv : arg_shape_map) inputs.insert(kv.first);
+    nnvm::Graph fwd;
+    fwd.outputs = symbol.outputs;
+    symbol.outputs = ConvertFP16(std::move(fwd), &arg_dtypes, inputs).outputs;
+  }
   nnvm::Graph g = InitGraph(symbol, default_ctx, ctx_map, in_arg_ctxes, arg_grad_ctxes,
-                            aux_state_ctxes, grad_req_types);
+                            aux_state_ctxes, grad_req_types, arg_shape_map);
   // The following code of shape and dtype inferences and argument
   // initialization is for simple_bind only. Regular bind operation
   // should do this differently.
@@ -984,8 +1258,8 @@ void GraphExecutor::Init(nnvm::Symbol symbol,
     if (arg_shape_map.end() != it1) {
       arg_shapes[i] = it1->second;
     }
-    auto it2 = arg_dtype_map.find(name);
-    if (arg_dtype_map.end() != it2) {
+    auto it2 = arg_dtypes.find(name);
+    if (arg_dtypes.end() != it2) {
       arg_dtypes[i] = it2->second;
     }
     auto it3 = arg_stype_map.find(name);
@@ -1050,12 +1324,64 @@ Graph GraphExecutor::InitGraph(nnvm::Symbol symbol,
                                const std::vector<Context>& in_arg_ctxes,
                                const std::vector<Context>& arg_grad_ctxes,
                                const std::vector<Context>& aux_state_ctxes,
-                               const std::vector<OpReqType>& grad_req_types) {
+                               const std::vector<OpReqType>& grad_req_types,
+                               const std::unordered_map<std::string, TShape>& arg_shapes) {
+  // offloading places the graph on two devices, so it is only done when
+  // everything is on the one device otherwise
+  std::map<std::string, Context> offload_ctx_map;
+  const bool single_device = ctx_map.empty() &&
+      std::all_of(in_arg_ctxes.begin(), in_arg_ctxes.end(),
+                  [&](const Context& c) { return c == default_ctx; }) &&
+      std::all_of(arg_grad_ctxes.begin(), arg_grad_ctxes.end(),
+                  [&](const Context& c) { return c == default_ctx; }) &&
+      std::all_of(aux_state_ctxes.begin(), aux_state_ctxes.end(),
+                  [&](const Context& c) { return c == default_ctx; });
+
+  // the fused operator has its own gradient, so it replaces the forward
+  // nodes before the backward graph is built from them
+  if (single_device && default_ctx.dev_type == Context::kGPU &&
+      dmlc::GetEnv("MXNET_EXEC_FUSE_BN_ADD_RELU", true)) {
+    nnvm::Graph fwd;
+    fwd.outputs = symbol.outputs;
+    symbol.outputs = FuseBatchNormAddRelu(std::move(fwd)).outputs;
+  }
+
   // setup gradient
-  nnvm::Graph g = InitFullGraph(symbol, grad_req_types);
+  nnvm::Graph g = InitFullGraph(symbol, grad_req_types, arg_shapes);
+  if (dmlc::GetEnv("MXNET_BACKWARD_OFFLOAD", false) && single_device &&
+      default_ctx.dev_type == Context::kGPU && g.outputs.size() > num_forward_outputs_) {
+    const size_t min_bytes =
+        static_cast<size_t>(dmlc::GetEnv("MXNET_BACKWARD_OFFLOAD_MIN_KB", 1024)) << 10;
+    const size_t num_offloaded =
+        OffloadActivations(&g, num_forward_outputs_, arg_shapes, min_bytes);
+    if (num_offloaded != 0) {
+      offload_ctx_map["__offload_host__"] = Context::CPUPinned(default_ctx.dev_id);
+      offload_ctx_map["__offload_device__"] = default_ctx;
+      // groups of the variables are shared with the symbol and kept
+      nnvm::DFSVisit(g.outputs, [&](const nnvm::NodePtr& node) {
+        auto it = node->attrs.dict.find("__ctx_group__");
+        if (it != node->attrs.dict.end()) offload_ctx_map.emplace(it->second, default_ctx);
+      });
+    }
+    if (dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+      LOG(INFO) << "Offloading " << num_offloaded << " activations to host memory";
+    }
+  }
+
+#if MXNET_USE_MKLDNN == 1
+  if (single_device && default_ctx.dev_mask() == cpu::kDevMask &&
+      g.outputs.size() == num_forward_outputs_) {
+    if (dmlc::GetEnv("MXNET_MKLDNN_FUSE_CONV", true)) {
+      g = MKLDNNFuseConv(std::move(g));
+    }
+    if (dmlc::GetEnv("MXNET_MKLDNN_LAYOUT_PASS", true)) {
+      g = MKLDNNLayout(std::move(g));
+    }
+  }
+#endif  // MXNET_USE_MKLDNN == 1
 
   // create "device" and "context" attrs for the graph
-  g = AssignContext(g, default_ctx, ctx_map,
+  g = AssignContext(g, default_ctx, offload_ctx_map.empty() ? ctx_map : offload_ctx_map,
                     in_arg_ctxes,
                     arg_grad_ctxes,
                     aux_state_ctxes,
@@ -1074,7 +1400,83 @@ Graph GraphExecutor::InitGraph(nnvm::Symbol symbol,
 }
 
 // initialize the memory of each entries
+/*!
+ * \brief Reuse the memory plan of the shared executor instead of planning again,
+ *  for example after a reshape or for another bucket of the same symbol. The
+ *  plan only depends on the lifetimes of the entries, so it holds for any shapes
+ *  as long as the graph is the same and in place entries still have the size of
+ *  the input they overwrite.
+ */
+bool GraphExecutor::ReuseMemoryPlan(const GraphExecutor* shared,
+                                    const nnvm::StorageVector& storage,
+                                    nnvm::Graph* g) {
+  if (shared == nullptr || shared->plan_storage_id_.empty() ||
+      storage != shared->plan_input_storage_) {
+    return false;
+  }
+  const auto& idx = g->indexed_graph();
+  const auto& sidx = shared->graph_.indexed_graph();
+  if (idx.num_nodes() != sidx.num_nodes() ||
+      idx.num_node_entries() != sidx.num_node_entries() ||
+      idx.outputs().size() != sidx.outputs().size()) {
+    return false;
+  }
+  const auto& vctx = g->GetAttr<ContextVector>("context");
+  const auto& sctx = shared->graph_.GetAttr<ContextVector>("context");
+  for (uint32_t nid = 0; nid < idx.num_nodes(); ++nid) {
+    const auto& inode = idx[nid];
+    const auto& snode = sidx[nid];
+    if (inode.source->op() != snode.source->op() ||
+        inode.source->attrs.name != snode.source->attrs.name ||
+        inode.source->num_outputs() != snode.source->num_outputs() ||
+        inode.inputs.size() != snode.inputs.size() ||
+        inode.control_deps.size() != snode.control_deps.size() || vctx[nid] != sctx[nid]) {
+      return false;
+    }
+    for (size_t i = 0; i < inode.inputs.size(); ++i) {
+      if (idx.entry_id(inode.inputs[i]) != sidx.entry_id(snode.inputs[i])) return false;
+    }
+    for (size_t i = 0; i < inode.control_deps.size(); ++i) {
+      if (inode.control_deps[i] != snode.control_deps[i]) return false;
+    }
+  }
+  for (size_t i = 0; i < idx.outputs().size(); ++i) {
+    if (idx.entry_id(idx.outputs()[i]) != sidx.entry_id(sidx.outputs()[i])) return false;
+  }
+  const auto& vshape = g->GetAttr<nnvm::ShapeVector>("shape");
+  const auto& vdtype = g->GetAttr<nnvm::DTypeVector>("dtype");
+  auto bytes = [&](uint32_t eid) {
+    return vshape[eid].Size() * mshadow::mshadow_sizeof(vdtype[eid]);
+  };
+  const std::vector<int>& inplace_index = shared->plan_inplace_index_;
+  std::vector<size_t> sid_bytes;
+  for (uint32_t nid = 0; nid < idx.num_nodes(); ++nid) {
+    for (uint32_t i = 0; i < idx[nid].source->num_outputs(); ++i) {
+      const uint32_t eid = idx.entry_id(nid, i);
+      const int in = inplace_index[eid];
+      if (in >= 0 && bytes(eid) != bytes(idx.entry_id(idx[nid].inputs[in]))) return false;
+      const int sid = shared->plan_storage_id_[eid];
+      if (sid < 0) continue;
+      if (static_cast<size_t>(sid) >= sid_bytes.size()) sid_bytes.resize(sid + 1, 0);
+      sid_bytes[sid] = std::max(sid_bytes[sid], bytes(eid));
+    }
+  }
+  size_t total_bytes = 0;
+  for (size_t b : sid_bytes) total_bytes += b;
+  plan_input_storage_ = storage;
+  plan_storage_id_ = shared->plan_storage_id_;
+  plan_inplace_index_ = inplace_index;
+  g->attrs["storage_id"] = std::make_shared<dmlc::any>(plan_storage_id_);
+  g->attrs["storage_inplace_index"] = std::make_shared<dmlc::any>(plan_inplace_index_);
+  g->attrs["storage_allocated_bytes"] = std::make_shared<dmlc::any>(total_bytes);
+  if (log_verbose_) {
+    LOG(INFO) << "Reuse the memory plan of the shared executor";
+  }
+  return true;
+}
+
 void GraphExecutor::InitDataEntryMemory(std::vector<NDArray>* shared_pool) {
+  Storage::AllocScope alloc_scope(nullptr, Storage::kActivation);
   using nnvm::DTypeVector;
   using nnvm::ShapeVector;
   using nnvm::StorageVector;
@@ -1129,6 +1531,9 @@ void GraphExecutor::InitDataEntryMemory(std::vector<NDArray>* shared_pool) {
                 << common::stype_string(stype);
     }
   }
+  if (dmlc::GetEnv("MXNET_EXEC_ZERO_COPY_VIEWS", false)) {
+    InitViewEntries(data_context);
+  }
   // get maximum bytes in each pool
   for (size_t i = 0; i < vshape.size(); ++i) {
     if (!data_entry_[i].is_none()) continue;
@@ -1148,11 +1553,14 @@ void GraphExecutor::InitDataEntryMemory(std::vector<NDArray>* shared_pool) {
     }
   }
   // construct the re-use pool, if needed
-  std::multimap<size_t, NDArray> free_pool;
+  static const int num_size_classes = dmlc::GetEnv("MXNET_EXEC_SHARED_POOL_SIZE_CLASSES", 4);
+  // free arrays of the shared pool by their bytes, as indices into the pool
+  std::multimap<size_t, size_t> free_pool;
   if (shared_pool != nullptr) {
-    for (const NDArray& nd : *shared_pool) {
+    for (size_t k = 0; k < shared_pool->size(); ++k) {
+      const NDArray& nd = (*shared_pool)[k];
       size_t bytes = nd.shape().Size() * mshadow::mshadow_sizeof(nd.dtype());
-      free_pool.insert(std::make_pair(bytes, nd));
+      free_pool.insert(std::make_pair(bytes, k));
     }
   }
   // remake the data pool
@@ -1173,15 +1581,33 @@ void GraphExecutor::InitDataEntryMemory(std::vector<NDArray>* shared_pool) {
     const Context& ctx = pool_info[i].ctx;
     size_t bytes = pool_info[i].bytes;
     bool allocated = false;
-    for (auto it = free_pool.lower_bound(bytes); it != free_pool.end(); ++it) {
-      if (it->second.ctx() == ctx && it->first >= bytes) {
-        data_pool_[i] = it->second;
+    if (plan_reused_ && shared_pool != nullptr && i < shared_pool->size()) {
+      // with the plan of the shared executor, its array of the same storage id
+      // holds the entries of the same lifetimes
+      const NDArray& nd = (*shared_pool)[i];
+      const size_t nd_bytes = nd.shape().Size() * mshadow::mshadow_sizeof(nd.dtype());
+      auto range = free_pool.equal_range(nd_bytes);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == i && nd.ctx() == ctx && nd_bytes >= bytes) {
+          data_pool_[i] = nd;
+          free_pool.erase(it);
+          allocated = true;
+          break;
+        }
+      }
+    }
+    for (auto it = free_pool.lower_bound(bytes); !allocated && it != free_pool.end(); ++it) {
+      const NDArray& nd = (*shared_pool)[it->second];
+      if (nd.ctx() == ctx && it->first >= bytes) {
+        data_pool_[i] = nd;
         free_pool.erase(it);
         allocated = true;
         break;
       }
     }
     if (!allocated) {
+      // an array added to a shared pool is rounded up, later executors reuse it
+      if (shared_pool != nullptr) bytes = SharedPoolBytes(bytes, num_size_classes);
       size_t nword = (bytes + 3) / 4;
       CHECK_LE(nword, std::numeric_limits<nnvm::dim_t>::max());
       // allocate float arrays
@@ -1218,6 +1644,145 @@ void GraphExecutor::InitDataEntryMemory(std::vector<NDArray>* shared_pool) {
   }
 }
 
+void GraphExecutor::InitViewEntries(const std::vector<Context>& data_context) {
+  static const Op* concat_op = Op::Get("Concat");
+  static const Op* slice_channel_op = Op::Get("SliceChannel");
+  static const Op* crop_op = Op::Get("Crop");
+  static const Op* swapaxis_op = Op::Get("SwapAxis");
+  const auto& idx = graph_.indexed_graph();
+  const auto& vdtype = graph_.GetAttr<nnvm::DTypeVector>("dtype");
+  const auto& vshape = graph_.GetAttr<nnvm::ShapeVector>("shape");
+  const auto& vstorage = graph_.GetAttr<nnvm::StorageVector>("storage_id");
+  const auto& vstorage_type = graph_.GetAttr<StorageTypeVector>("storage_type");
+  const auto& addto_entry = graph_.GetAttr<std::vector<int> >("addto_entry");
+  // entries sharing memory with another entry of their node are written in place
+  // or added to, which a view of a different array would break
+  std::vector<bool> inplace(idx.num_node_entries(), false);
+  for (uint32_t nid = 0; nid < idx.num_nodes(); ++nid) {
+    const auto& inode = idx[nid];
+    for (const auto& e : inode.inputs) {
+      const uint32_t ieid = idx.entry_id(e);
+      for (uint32_t i = 0; i < inode.source->num_outputs(); ++i) {
+        const uint32_t oeid = idx.entry_id(nid, i);
+        if (vstorage[ieid] >= 0 && vstorage[ieid] == vstorage[oeid]) {
+          inplace[ieid] = inplace[oeid] = true;
+        }
+      }
+    }
+  }
+  // entries laid out here, which may be the whole array of another node
+  std::unordered_set<uint32_t> assigned;
+  auto viewable = [&](uint32_t eid, int dtype, const Context& ctx) {
+    return data_entry_[eid].is_none() && vstorage[eid] >= 0 && !inplace[eid] &&
+           !addto_entry[eid] && vstorage_type[eid] == kDefaultStorage &&
+           vdtype[eid] == dtype && data_context[eid] == ctx;
+  };
+  // make the parts views of the whole array of an entry, each given with its
+  // offset in elements. The parts get views of planned memory only if the whole
+  // entry has memory of its own, a variable or an array allocated here.
+  auto lay_out = [&](uint32_t whole_eid, bool is_variable,
+                     const std::vector<std::pair<uint32_t, size_t> >& parts) {
+    const int dtype = vdtype[whole_eid];
+    const Context& ctx = data_context[whole_eid];
+#if MXNET_USE_MKLDNN == 1
+    // mkldnn may reorder an array in place into its own layout
+    if (ctx.dev_mask() == cpu::kDevMask) return;
+#endif
+    std::unordered_set<uint32_t> seen;
+    for (const auto& part : parts) {
+      if (!viewable(part.first, dtype, ctx) || !seen.insert(part.first).second) return;
+    }
+    NDArray whole;
+    if (assigned.count(whole_eid)) {
+      whole = data_entry_[whole_eid];
+    } else if (viewable(whole_eid, dtype, ctx)) {
+      whole = NDArray(vshape[whole_eid], ctx, false, dtype);
+    } else if (is_variable && !data_entry_[whole_eid].is_none() &&
+               data_entry_[whole_eid].storage_type() == kDefaultStorage &&
+               data_entry_[whole_eid].dtype() == dtype && data_entry_[whole_eid].ctx() == ctx) {
+      whole = data_entry_[whole_eid];
+    } else {
+      return;
+    }
+    data_entry_[whole_eid] = whole;
+    assigned.insert(whole_eid);
+    NDArray flat = whole.Reshape(TShape{static_cast<nnvm::dim_t>(whole.shape().Size())});
+    for (const auto& part : parts) {
+      const TShape& shape = vshape[part.first];
+      CHECK_LE(part.second + shape.Size(), flat.shape().Size());
+      data_entry_[part.first] = flat.Slice(part.second, part.second + shape.Size()).Reshape(shape);
+      assigned.insert(part.first);
+    }
+    if (log_verbose_) {
+      LOG(INFO) << "\tinit " << parts.size() << " data entries as views of entry " << whole_eid;
+    }
+  };
+  auto int_attr = [](const nnvm::NodeAttrs& attrs, const char* key, int value) {
+    auto it = attrs.dict.find(key);
+    return it == attrs.dict.end() ? value : std::stoi(it->second);
+  };
+  // product of the dimensions in [begin, end)
+  auto prod = [](const TShape& shape, int begin, int end) {
+    size_t size = 1;
+    for (int i = begin; i < end; ++i) size *= shape[i];
+    return size;
+  };
+  // consumers first, so that a view can itself be the whole array of its producer
+  for (int nid = static_cast<int>(idx.num_nodes()) - 1; nid >= 0; --nid) {
+    const auto& inode = idx[nid];
+    if (inode.source->is_variable() || inode.inputs.empty()) continue;
+    const auto& attrs = inode.source->attrs;
+    const uint32_t ieid = idx.entry_id(inode.inputs[0]);
+    const bool in_variable = idx[inode.inputs[0].node_id].source->is_variable();
+    std::vector<std::pair<uint32_t, size_t> > parts;
+    if (inode.source->op() == concat_op || inode.source->op() == slice_channel_op) {
+      // contiguous slices when every dimension before the axis is 1
+      const bool concat = inode.source->op() == concat_op;
+      const uint32_t whole_eid = concat ? idx.entry_id(nid, 0) : ieid;
+      const TShape& shape = vshape[whole_eid];
+      int axis = int_attr(attrs, concat ? "dim" : "axis", 1);
+      if (axis < 0) axis += static_cast<int>(shape.ndim());
+      if (prod(shape, 0, axis) != 1) continue;
+      size_t begin = 0;
+      const size_t num_parts = concat ? inode.inputs.size() : inode.source->num_outputs();
+      for (size_t i = 0; i < num_parts; ++i) {
+        const uint32_t eid = concat ? idx.entry_id(inode.inputs[i]) : idx.entry_id(nid, i);
+        parts.emplace_back(eid, begin);
+        begin += vshape[eid].Size();
+      }
+      lay_out(whole_eid, !concat && in_variable, parts);
+    } else if (inode.source->op() == crop_op) {
+      // rows of full width of a single image are a contiguous range
+      const uint32_t oeid = idx.entry_id(nid, 0);
+      const TShape& ishape = vshape[ieid];
+      const TShape& oshape = vshape[oeid];
+      if (ishape[0] * ishape[1] != 1 || ishape[3] != oshape[3]) continue;
+      size_t offset_h = (ishape[2] - oshape[2]) / 2;
+      if (int_attr(attrs, "center_crop", 0) == 0) {
+        auto it = attrs.dict.find("offset");
+        TShape offset(2);
+        offset[0] = offset[1] = 0;
+        if (it != attrs.dict.end()) {
+          std::istringstream is(it->second);
+          is >> offset;
+        }
+        offset_h = offset[0];
+      }
+      parts.emplace_back(oeid, offset_h * ishape[3]);
+      lay_out(ieid, in_variable, parts);
+    } else if (inode.source->op() == swapaxis_op) {
+      // the memory is unchanged when at most one of the dimensions it reorders is not 1
+      const TShape& shape = vshape[ieid];
+      const int dim1 = std::min(int_attr(attrs, "dim1", 0), int_attr(attrs, "dim2", 0));
+      const int dim2 = std::max(int_attr(attrs, "dim1", 0), int_attr(attrs, "dim2", 0));
+      const int num_reordered = (shape[dim1] != 1) + (prod(shape, dim1 + 1, dim2) != 1) +
+                                (shape[dim2] != 1);
+      if (num_reordered > 1) continue;
+      parts.emplace_back(idx.entry_id(nid, 0), 0);
+      lay_out(ieid, in_variable, parts);
+    }
+  }
+}
 
 void GraphExecutor::InitCachedOps() {
   // get the graph
@@ -1270,6 +1835,7 @@ void GraphExecutor::InitCachedOps() {
     op_nodes_[e.node_id].exec->req[e.index] =
         grad_store_[j - num_forward_outputs_].first;
   }
+  node_time_us_.assign(idx.num_nodes(), std::numeric_limits<uint64_t>::max());
   for (uint32_t nid = 0; nid < idx.num_nodes(); ++nid) {
     const auto& inode = idx[nid];
     if (inode.source->is_variable()) continue;
@@ -1306,12 +1872,19 @@ void GraphExecutor::InitCachedOps() {
         on_complete();
       }, Context::CPU(), {}, all_vars, FnProperty::kNormal, 0,
       "SetupExec");
-    auto exec_fun = [exec, is_async, is_gpu] (
+    const bool* measure = &measure_node_time_;
+    uint64_t* time_us = &node_time_us_[nid];
+    const char* node_name = inode.source->attrs.name.c_str();
+    auto exec_fun = [exec, is_async, is_gpu, measure, time_us, node_name] (
         RunContext ctx, Engine::CallbackOnComplete on_complete) {
       if (is_async) {
         exec->op_ctx.async_on_complete = on_complete;
       }
-      exec->Run(ctx, is_gpu);
+      const uint64_t start = *measure ? profiler::ProfileStat::NowInMicrosec() : 0;
+      {
+        profiler::nvtx::NVTXRange nvtx_range(node_name, profiler::nvtx::kNode);
+        exec->Run(ctx, is_gpu);
+      }
       // call on complete only if it is async op
       if (!is_async) {
         if (is_gpu) {
@@ -1322,6 +1895,9 @@ void GraphExecutor::InitCachedOps() {
           LOG(FATAL) << MXNET_GPU_NOT_ENABLED_ERROR;
         #endif
         }
+        if (*measure) {
+          *time_us = std::min(*time_us, profiler::ProfileStat::NowInMicrosec() - start);
+        }
         on_complete();
       }
     };
@@ -1350,7 +1926,14 @@ void GraphExecutor::InitOpSegs() {
 
   bool is_training = num_forward_nodes_ != total_num_nodes;
 
-  if (prefer_bulk_exec  && is_training) {
+  parallel_branches_ = dmlc::GetEnv("MXNET_EXEC_PARALLEL_BRANCHES", false);
+  bulk_segment_us_ = dmlc::GetEnv("MXNET_EXEC_BULK_EXEC_SEGMENT_US", 0);
+  if (prefer_bulk_exec && is_training && bulk_segment_us_ != 0) {
+    // nodes run one by one until their times are known, the shorter of two
+    // runs is kept as the first one includes one time setup
+    measure_node_time_ = true;
+    measure_runs_left_ = 2;
+  } else if (prefer_bulk_exec && is_training) {
     this->BulkTrainingOpSegs(total_num_nodes);
   }
 
@@ -1369,9 +1952,13 @@ void GraphExecutor::BulkTrainingOpSegs(size_t total_num_nodes) {
   for (size_t nid = 0; nid < num_forward_nodes_; nid++) {
     auto &node = graph_.indexed_graph()[nid].source;
     auto &op_node = op_nodes_[nid];
+    if (StartsBranch(topo_start, nid)) {
+      cached_seg_opr_[topo_start] = this->CreateCachedSegOpr(topo_start, nid);
+      topo_start = nid;
+    }
     // check if the segment relies on external input, or exceeds maxinum number of node,
     // or requires async ops
-    if (node->is_variable() || nid - topo_start > num_nodes_threshold ||
+    if (node->is_variable() || TrainingSegFull(topo_start, nid, num_nodes_threshold) ||
         op_node.exec->exec_type() != ExecType::kSync) {
       // create a new segment for the previous nodes if the current one cannot be bulked
       cached_seg_opr_[topo_start] = this->CreateCachedSegOpr(topo_start, nid);
@@ -1396,7 +1983,12 @@ void GraphExecutor::BulkTrainingOpSegs(size_t total_num_nodes) {
     if (op_node.skip_exec_node || op_node.exec == nullptr) {
       continue;
     }
-    if (idx[nid].source->is_variable() || nid - topo_start > num_nodes_threshold ||
+    if (StartsBranch(topo_start, nid)) {
+      cached_seg_opr_[topo_start] = this->CreateCachedSegOpr(topo_start, nid);
+      topo_start = nid;
+    }
+    if (idx[nid].source->is_variable() ||
+        TrainingSegFull(topo_start, nid, num_nodes_threshold) ||
         op_node.exec->exec_type() != ExecType::kSync) {
       cached_seg_opr_[topo_start] = this->CreateCachedSegOpr(topo_start, nid);
       topo_start = nid + 1;
@@ -1420,6 +2012,56 @@ void GraphExecutor::BulkTrainingOpSegs(size_t total_num_nodes) {
   }
 }
 
+bool GraphExecutor::TrainingSegFull(size_t topo_start, size_t nid,
+                                    size_t num_nodes_threshold) const {
+  if (bulk_segment_us_ == 0 || measure_node_time_) return nid - topo_start > num_nodes_threshold;
+  // close the segment once the measured nodes in it reach the target time,
+  // nodes that did not run count as free
+  uint64_t total_us = 0;
+  for (size_t i = topo_start; i < nid; ++i) {
+    if (node_time_us_[i] != std::numeric_limits<uint64_t>::max()) total_us += node_time_us_[i];
+  }
+  return total_us >= bulk_segment_us_;
+}
+
+bool GraphExecutor::StartsBranch(size_t topo_start, size_t nid) const {
+  const auto& idx = graph_.indexed_graph();
+  if (!parallel_branches_ || idx[nid].source->is_variable()) return false;
+  // nodes are in depth first order, so a node not reading the operator run
+  // just before it starts another branch, and the branches of a fork are
+  // consecutive runs of nodes that become separate segments
+  for (size_t i = nid; i > topo_start; --i) {
+    const size_t prev = i - 1;
+    if (idx[prev].source->is_variable() || op_nodes_[prev].skip_exec_node) continue;
+    for (const auto& e : idx[nid].inputs) {
+      if (e.node_id == prev) return false;
+    }
+    for (uint32_t dep : idx[nid].control_deps) {
+      if (dep == prev) return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+void GraphExecutor::FinishMeasureNodeTime() {
+  // the times are written by the engine, every run must be done
+  Engine::Get()->WaitForAll();
+  measure_node_time_ = false;
+  for (auto& seg : cached_seg_opr_) {
+    if (seg.opr != nullptr) Engine::Get()->DeleteOperator(seg.opr);
+  }
+  const size_t total_num_nodes = graph_.indexed_graph().num_nodes();
+  cached_seg_opr_.assign(total_num_nodes, CachedSegOpr());
+  this->BulkTrainingOpSegs(total_num_nodes);
+  if (log_verbose_) {
+    size_t num_segs = 0;
+    for (const auto& seg : cached_seg_opr_) num_segs += seg.opr != nullptr;
+    LOG(INFO) << "Created " << num_segs << " training segments of about "
+              << bulk_segment_us_ << " us";
+  }
+}
+
 void GraphExecutor::BulkInferenceOpSegs() {
   // Attempt to bulk the whole graph for inference.  We will only create new segments when
   // required for non-kSync operations.
@@ -1434,6 +2076,9 @@ void GraphExecutor::BulkInferenceOpSegs() {
     if (op_node.exec->exec_type() != ExecType::kSync) {
       cached_seg_opr_[topo_start] = this->CreateCachedSegOpr(topo_start, nid);
       topo_start = nid + 1;
+    } else if (StartsBranch(topo_start, nid)) {
+      cached_seg_opr_[topo_start] = this->CreateCachedSegOpr(topo_start, nid);
+      topo_start = nid;
     }
   }
   // The last segment
@@ -1482,7 +2127,7 @@ void GraphExecutor::RunOps(bool is_train, size_t topo_start, size_t topo_end) {
     // Check segments first
     if (monitor_callback_ == nullptr && seg_op.opr != nullptr && seg_op.topo_end <= topo_end) {
       bool profiling = profiler::Profiler::Get()->GetState() == profiler::Profiler::kRunning;
-      Engine::Get()->Push(seg_op.opr, seg_op.ctx, 0, profiling);
+      Engine::Get()->Push(seg_op.opr, seg_op.ctx, priority_, profiling);
       nid = seg_op.topo_end - 1;
       continue;
     }
@@ -1496,10 +2141,10 @@ void GraphExecutor::RunOps(bool is_train, size_t topo_start, size_t topo_end) {
       CHECK_EQ(inode.inputs.size(), 1U);
       CHECK_EQ(opnode.exec->in_array.size(), 1U);
       CHECK_EQ(opnode.exec->out_array.size(), 1U);
-      CopyFromTo(opnode.exec->in_array[0], &(opnode.exec->out_array[0]));
+      CopyFromTo(opnode.exec->in_array[0], &(opnode.exec->out_array[0]), priority_);
     } else if (opnode.cached_opr != nullptr) {
       bool profiling = profiler::Profiler::Get()->GetState() == profiler::Profiler::kRunning;
-      Engine::Get()->Push(opnode.cached_opr, opnode.ctx, 0, profiling);
+      Engine::Get()->Push(opnode.cached_opr, opnode.ctx, priority_, profiling);
     } else {
       LOG(FATAL) << "Not accessed";
     }
@@ -1523,6 +2168,8 @@ GraphExecutor::CachedSegOpr GraphExecutor::CreateCachedSegOpr(size_t topo_start,
     return ret;
   }
   std::string opr_names = "[";
+  // names of the nodes, stable as long as the graph lives
+  std::vector<const char*> node_names;
 
   const auto& idx = graph_.indexed_graph();
   for (size_t nid = topo_start; nid < topo_end; ++nid) {
@@ -1544,6 +2191,7 @@ GraphExecutor::CachedSegOpr GraphExecutor::CreateCachedSegOpr(size_t topo_start,
     std::copy(op_node.use_vars.begin(), op_node.use_vars.end(),
               std::inserter(use_vars, use_vars.end()));
     ret.exec_list.push_back(exec);
+    node_names.push_back(inode.source->attrs.name.c_str());
     opr_names += inode.source->op()->name + ",";
   }
 
@@ -1552,12 +2200,50 @@ GraphExecutor::CachedSegOpr GraphExecutor::CreateCachedSegOpr(size_t topo_start,
   Engine::Get()->DeduplicateVarHandle(&use_vars, &mutate_vars);
 
   bool is_gpu = pctx->dev_mask() == gpu::kDevMask;
-  auto exec_fun = [exec_list, is_gpu] (
+  opr_names.pop_back();
+  opr_names += "]";
+  const char* seg_name = cached_seg_opr_names_.insert(opr_names).first->c_str();
+#if MXNET_USE_CUDA
+  // opt-in: replay inference segments as CUDA graphs. Random resources are
+  // advanced on the host per call, so segments using them are never captured.
+  std::shared_ptr<CudaGraphCache> cuda_graph;
+  if (is_gpu && dmlc::GetEnv("MXNET_EXEC_ENABLE_CUDA_GRAPHS", false)) {
+    bool capturable = true;
+    for (auto &exec : exec_list) {
+      for (const auto& resource : exec->op_ctx.requested) {
+        if (resource.req.type == ResourceRequest::kRandom ||
+            resource.req.type == ResourceRequest::kParallelRandom) {
+          capturable = false;
+        }
+      }
+    }
+    if (capturable) cuda_graph = std::make_shared<CudaGraphCache>();
+  }
+  auto exec_fun = [exec_list, node_names, seg_name, is_gpu, cuda_graph] (
       RunContext ctx, Engine::CallbackOnComplete on_complete) {
+    profiler::nvtx::NVTXRange nvtx_range(seg_name, profiler::nvtx::kSegment);
+    auto run_all = [&exec_list, &node_names, &ctx, is_gpu]() {
+      for (size_t i = 0; i < exec_list.size(); ++i) {
+        profiler::nvtx::NVTXRange nvtx_node_range(node_names[i], profiler::nvtx::kNode);
+        exec_list[i]->Run(ctx, is_gpu);
+      }
+    };
     // Run all opr in the sub-graph
-    for (auto &exec : exec_list) {
-      exec->Run(ctx, is_gpu);
+    if (cuda_graph != nullptr && !exec_list.front()->op_ctx.is_train) {
+      cuda_graph->Run(ctx, run_all);
+    } else {
+      run_all();
     }
+#else
+  auto exec_fun = [exec_list, node_names, seg_name, is_gpu] (
+      RunContext ctx, Engine::CallbackOnComplete on_complete) {
+    profiler::nvtx::NVTXRange nvtx_range(seg_name, profiler::nvtx::kSegment);
+    // Run all opr in the sub-graph
+    for (size_t i = 0; i < exec_list.size(); ++i) {
+      profiler::nvtx::NVTXRange nvtx_node_range(node_names[i], profiler::nvtx::kNode);
+      exec_list[i]->Run(ctx, is_gpu);
+    }
+#endif
     if (is_gpu) {
 #if MXNET_USE_CUDA
       // Wait GPU kernel to finish.
@@ -1568,12 +2254,8 @@ GraphExecutor::CachedSegOpr GraphExecutor::CreateCachedSegOpr(size_t topo_start,
     }
     on_complete();
   };
-  opr_names.pop_back();
-  opr_names += "]";
-  auto iter = cached_seg_opr_names_.insert(opr_names).first;
   ret.opr = Engine::Get()->NewOperator(
-    exec_fun, use_vars, mutate_vars, FnProperty::kNormal,
-    iter->c_str());
+    exec_fun, use_vars, mutate_vars, FnProperty::kNormal, seg_name);
   return ret;
 }
 }  // namespace exec
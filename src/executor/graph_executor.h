@@ -69,6 +69,7 @@ class GraphExecutor : public Executor {
   const std::unordered_map<std::string, NDArray>& aux_state_map() const override;
   void Print(std::ostream &os) const override; // NOLINT(*)
   void SetMonitorCallback(const MonitorCallback& callback) override;
+  void SetPriority(int priority) override { priority_ = priority; }
   // Initialize the rest of attributes
   // after setting up arguments.
   void FinishInitGraph(nnvm::Symbol symbol, nnvm::Graph g,
@@ -174,10 +175,12 @@ class GraphExecutor : public Executor {
                   const std::vector<Context>& in_arg_ctxes,
                   const std::vector<Context>& arg_grad_ctxes,
                   const std::vector<Context>& aux_state_ctxes,
-                  const std::vector<OpReqType>& grad_req_types);
+                  const std::vector<OpReqType>& grad_req_types,
+                  const std::unordered_map<std::string, TShape>& arg_shapes);
   // intialize the full graph for simple bind, including gradient
   Graph InitFullGraph(nnvm::Symbol symbol,
-                      const std::vector<OpReqType>& grad_req_types);
+                      const std::vector<OpReqType>& grad_req_types,
+                      const std::unordered_map<std::string, TShape>& arg_shapes);
   // initialize the cached operator
   void InitCachedOps();
   // initialize the opr segments for bulk exec
@@ -186,6 +189,12 @@ class GraphExecutor : public Executor {
   // initialize the memory of data entries
   // shared_pool: extra memory shared from other parts
   void InitDataEntryMemory(std::vector<NDArray>* shared_pool);
+  // take the memory plan of shared when g has the same nodes, storage and contexts
+  bool ReuseMemoryPlan(const GraphExecutor* shared, const nnvm::StorageVector& storage,
+                       nnvm::Graph* g);
+  // lay entries out as views of the array of another entry where an op would
+  // only copy between them, Concat inputs, SliceChannel, Crop and SwapAxis outputs
+  void InitViewEntries(const std::vector<Context>& data_context);
   // run ops from topo order start to end
   void RunOps(bool is_train, size_t topo_start, size_t topo_end);
   /*!
@@ -202,6 +211,12 @@ class GraphExecutor : public Executor {
   void BulkInferenceOpSegs();
   // perform bulking and segmentation on a training graph
   void BulkTrainingOpSegs(size_t total_num_nodes);
+  // whether a training segment of nodes [topo_start, nid) is full
+  bool TrainingSegFull(size_t topo_start, size_t nid, size_t num_nodes_threshold) const;
+  // resegment a training graph with the node times of the last runs
+  void FinishMeasureNodeTime();
+  // whether node nid starts a branch independent of the segment [topo_start, nid)
+  bool StartsBranch(size_t topo_start, size_t nid) const;
 
   // internal graph
   nnvm::Graph graph_;
@@ -212,6 +227,14 @@ class GraphExecutor : public Executor {
   // internal data pool of allocated entries.
   // these allocated entries can be used for static memory sharing between executors.
   std::vector<NDArray> data_pool_;
+  // input of PlanMemory and its storage ids before inplace addto detection,
+  // reused by executors bound with this one as shared_exec
+  nnvm::StorageVector plan_input_storage_;
+  nnvm::StorageVector plan_storage_id_;
+  std::vector<int> plan_inplace_index_;
+  // whether the memory plan is the one of shared_exec, whose pool entries are
+  // then taken by storage id
+  bool plan_reused_{false};
   // output arrays
   std::vector<NDArray> output_arrays_;
   // input argument map, key is arg name, value is arg's NDArray
@@ -238,6 +261,8 @@ class GraphExecutor : public Executor {
   std::unordered_map<const nnvm::Node*, OpStatePtr> saved_states_;
   // monitor call back
   std::function<void(const char*, void*)> monitor_callback_{nullptr};
+  // engine priority of the pushed operations
+  int priority_{0};
   // whether to enable bulk execution
   bool prefer_bulk_execution_;
   // cached segment operator
@@ -246,6 +271,16 @@ class GraphExecutor : public Executor {
   std::unordered_set<std::string> cached_seg_opr_names_;
   // verbose logging
   bool log_verbose_ = false;
+  // target run time in microseconds of a training segment, 0 to count nodes
+  size_t bulk_segment_us_{0};
+  // number of backward runs left before training segments are created from node times
+  int measure_runs_left_{0};
+  // whether the cached operators record their run time, only set between runs
+  bool measure_node_time_{false};
+  // the shortest measured run time of every node in microseconds
+  std::vector<uint64_t> node_time_us_;
+  // whether segments are cut between independent branches so they run in parallel
+  bool parallel_branches_{false};
 };
 
 }  // namespace exec
@@ -281,20 +281,69 @@ nnvm::Graph InferAttr(nnvm::Graph &&ret,
     }
   };
 
+  // the entries the inference of a node reads or writes, a backward node with a
+  // control dependency also reads the entries of its forward node
+  auto node_entries = [&](uint32_t nid, std::vector<uint32_t>* eids) {
+    const auto& inode = idx[nid];
+    eids->clear();
+    for (const auto& e : inode.inputs) eids->push_back(idx.entry_id(e));
+    for (uint32_t i = 0; i < inode.source->num_outputs(); ++i) {
+      eids->push_back(idx.entry_id(nid, i));
+    }
+    if (!inode.source->is_variable() && inode.control_deps.size() &&
+        is_backward.get(inode.source->op(), false)) {
+      const uint32_t fid = inode.control_deps[0];
+      for (const auto& e : idx[fid].inputs) eids->push_back(idx.entry_id(e));
+      for (uint32_t i = 0; i < idx[fid].source->num_outputs(); ++i) {
+        eids->push_back(idx.entry_id(fid, i));
+      }
+    }
+  };
+  // nodes to infer again when an entry changes
+  std::vector<std::vector<uint32_t> > entry_nodes(idx.num_node_entries());
+  std::vector<uint32_t> eids;
+  for (uint32_t nid = node_start; nid < node_end; ++nid) {
+    node_entries(nid, &eids);
+    for (uint32_t eid : eids) entry_nodes[eid].push_back(nid);
+  }
+  // every node is inferred in the first pass, later passes only infer again the
+  // nodes an entry of which changed since they were last inferred
+  std::vector<uint8_t> dirty(idx.num_nodes(), 1);
+  bool any_dirty = true;
+  AttrVector before;
+  auto visit = [&](uint32_t nid) {
+    if (!dirty[nid]) return;
+    dirty[nid] = 0;
+    node_entries(nid, &eids);
+    before.clear();
+    for (uint32_t eid : eids) before.push_back(rshape[eid]);
+    infer_step(nid, false);
+    for (size_t k = 0; k < eids.size(); ++k) {
+      if (rshape[eids[k]] == before[k]) continue;
+      for (uint32_t other : entry_nodes[eids[k]]) {
+        if (other != nid) {
+          dirty[other] = 1;
+          any_dirty = true;
+        }
+      }
+    }
+  };
+
   size_t last_num_unknown;
   size_t num_unknown_dispatch_mode = dispatch_mode_name ? node_end - node_start : 0;
   size_t num_unknown_entry_attr = entry_end - entry_start;
   size_t num_unknown = num_unknown_entry_attr + num_unknown_dispatch_mode;
   int i = 0;
   do {
+    any_dirty = false;
     if (i % 2 == 0) {
       for (uint32_t nid = node_start; nid < node_end; ++nid) {
-        infer_step(nid, false);
+        visit(nid);
       }
     } else {
       // backward inference
       for (uint32_t i = node_end; i != node_start; --i) {
-        infer_step(i - 1, false);
+        visit(i - 1);
       }
     }
     last_num_unknown = num_unknown;
@@ -310,7 +359,7 @@ nnvm::Graph InferAttr(nnvm::Graph &&ret,
       }
     }
     ++i;
-  } while (num_unknown > 0 && last_num_unknown > num_unknown);
+  } while (num_unknown > 0 && last_num_unknown > num_unknown && any_dirty);
   // set the shapes
   ret.attrs[attr_name] = std::make_shared<any>(std::move(rshape));
   // set the shapes
@@ -0,0 +1,166 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file mkldnn_fuse_conv_pass.cc
+ * \brief replace Convolution -> BatchNorm -> elemwise_add -> relu chains by _mkldnn_fused_conv
+ */
+#include <mxnet/base.h>
+#include <nnvm/graph.h>
+#include <nnvm/pass_functions.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "./exec_pass.h"
+#include "../operator/nn/batch_norm-inl.h"
+#include "../operator/nn/convolution-inl.h"
+
+#if MXNET_USE_MKLDNN == 1
+namespace mxnet {
+namespace exec {
+namespace {
+using nnvm::Node;
+using nnvm::NodeEntry;
+using nnvm::NodePtr;
+
+/*! \brief whether the node is a 2D convolution the MKLDNN kernel can run */
+bool IsFusableConv(const Node& node) {
+  if (node.is_variable() || node.op()->name != "Convolution" || !node.control_deps.empty()) {
+    return false;
+  }
+  const auto& param = nnvm::get<op::ConvolutionParam>(node.attrs.parsed);
+  return param.kernel.ndim() == 2 && param.layout.value() == mshadow::kNCHW;
+}
+
+/*! \brief whether the BatchNorm uses the moving statistics in training mode too */
+bool IsFusableBatchNorm(const Node& node) {
+  const auto& param = nnvm::get<op::BatchNormParam>(node.attrs.parsed);
+  return param.use_global_stats && !param.output_mean_var && param.axis == 1;
+}
+
+bool IsRelu(const Node& node) {
+  if (node.op()->name == "relu") return true;
+  if (node.op()->name != "Activation") return false;
+  const auto it = node.attrs.dict.find("act_type");
+  return it != node.attrs.dict.end() && it->second == "relu";
+}
+}  // namespace
+
+Graph MKLDNNFuseConv(Graph g) {
+  // count the uses of every node, graph outputs and control dependencies
+  // keep a node from being fused into its consumer
+  std::unordered_map<const Node*, int> num_uses;
+  std::unordered_map<const Node*, NodePtr> consumer;
+  std::vector<NodePtr> topo;
+  nnvm::DFSVisit(g.outputs, [&](const NodePtr& node) {
+    topo.push_back(node);
+    for (const NodeEntry& e : node->inputs) {
+      ++num_uses[e.node.get()];
+      consumer[e.node.get()] = node;
+    }
+    for (const NodePtr& dep : node->control_deps) ++num_uses[dep.get()];
+  });
+  for (const NodeEntry& e : g.outputs) ++num_uses[e.node.get()];
+
+  // the nodes folded into the fused ones, and the fused node replacing the last of a chain
+  std::unordered_set<const Node*> fused;
+  std::unordered_map<const Node*, NodePtr> replaced;
+  for (const NodePtr& conv : topo) {
+    if (!IsFusableConv(*conv)) continue;
+    // the single consumer of tail, if it can be fused into the chain
+    NodePtr tail = conv;
+    auto next = [&]() -> NodePtr {
+      if (num_uses[tail.get()] != 1 || !consumer.count(tail.get())) return nullptr;
+      const NodePtr& node = consumer.at(tail.get());
+      if (!node->control_deps.empty() || CtxGroup(*node) != CtxGroup(*conv) ||
+          fused.count(node.get()) || replaced.count(node.get())) {
+        return nullptr;
+      }
+      return node;
+    };
+    NodePtr bn = next();
+    if (bn != nullptr && bn->op()->name == "BatchNorm" && IsFusableBatchNorm(*bn)) {
+      tail = bn;
+    } else {
+      bn = nullptr;
+    }
+    NodePtr add = next();
+    NodeEntry sum;
+    bool sum_first = false;
+    if (add != nullptr && add->op()->name == "elemwise_add") {
+      sum_first = add->inputs[1].node == tail;
+      sum = add->inputs[sum_first ? 0 : 1];
+      tail = add;
+    } else {
+      add = nullptr;
+    }
+    NodePtr relu = next();
+    if (relu != nullptr && IsRelu(*relu)) {
+      tail = relu;
+    } else {
+      relu = nullptr;
+    }
+    if (tail == conv) continue;
+
+    // the fused node takes the name of the last node, so output names do not
+    // change, and lists its inputs in the DFS order of the nodes it replaces
+    NodePtr node = Node::Create();
+    node->attrs.op = nnvm::Op::Get("_mkldnn_fused_conv");
+    node->attrs.name = tail->attrs.name;
+    node->attrs.dict = conv->attrs.dict;
+    if (bn != nullptr) {
+      node->attrs.dict["with_bn"] = "True";
+      for (const char* key : {"eps", "fix_gamma"}) {
+        const auto it = bn->attrs.dict.find(key);
+        if (it != bn->attrs.dict.end()) node->attrs.dict[std::string("bn_") + key] = it->second;
+      }
+    }
+    if (add != nullptr) {
+      node->attrs.dict["with_sum"] = "True";
+      node->attrs.dict["sum_first"] = sum_first ? "True" : "False";
+    }
+    if (relu != nullptr) node->attrs.dict["with_relu"] = "True";
+    node->attrs.op->attr_parser(&(node->attrs));
+    if (add != nullptr && sum_first) node->inputs.push_back(sum);
+    node->inputs.insert(node->inputs.end(), conv->inputs.begin(), conv->inputs.end());
+    if (bn != nullptr) node->inputs.insert(node->inputs.end(), bn->inputs.begin() + 1,
+                                           bn->inputs.end());
+    if (add != nullptr && !sum_first) node->inputs.push_back(sum);
+    for (const NodePtr& n : {conv, bn, add, relu}) {
+      if (n != nullptr && n != tail) fused.insert(n.get());
+    }
+    replaced[tail.get()] = node;
+  }
+  if (replaced.empty()) return g;
+
+  // the last node of each chain is replaced, so its consumers read the fused
+  // convolution and the other nodes of the chain are dropped
+  CopyGraphWithReplacements(topo, replaced, fused, &g);
+  if (dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+    LOG(INFO) << "MKLDNNFuseConv: replaced " << fused.size() + replaced.size()
+              << " nodes by " << replaced.size() << " fused convolutions";
+  }
+  return g;
+}
+
+}  // namespace exec
+}  // namespace mxnet
+#endif  // MXNET_USE_MKLDNN == 1
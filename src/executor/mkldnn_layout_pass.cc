@@ -0,0 +1,116 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file mkldnn_layout_pass.cc
+ * \brief reorder MKLDNN layouts once where they flow into operators needing the default one
+ */
+#include <mxnet/base.h>
+#include <nnvm/graph.h>
+#include <nnvm/pass_functions.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "./exec_pass.h"
+
+#if MXNET_USE_MKLDNN == 1
+namespace mxnet {
+namespace exec {
+namespace {
+using nnvm::Node;
+using nnvm::NodeEntry;
+using nnvm::NodePtr;
+
+/*! \brief whether the outputs of a node can be in an MKLDNN layout */
+bool WritesMKLDNNLayout(const Node& node) {
+  if (node.is_variable()) return false;
+  static const std::unordered_set<std::string> ops = {
+    "Convolution", "Deconvolution", "FullyConnected", "Pooling", "LRN", "BatchNorm",
+    "Activation", "Concat", "softmax", "elemwise_add", "add_n", "_mkldnn_fused_conv"};
+  return ops.count(node.op()->name) != 0;
+}
+
+/*! \brief whether a node reads inputs in MKLDNN layouts without reordering them first */
+bool ReadsMKLDNNLayout(const Node& node) {
+  // _copy and Flatten reorder inside their own kernel, which writes the default layout
+  static const std::unordered_set<std::string> ops = {"_copy", "Flatten",
+                                                      "_mkldnn_reorder2default"};
+  return WritesMKLDNNLayout(node) || ops.count(node.op()->name) != 0;
+}
+}  // namespace
+
+Graph MKLDNNLayout(Graph g) {
+  std::vector<NodePtr> topo;
+  nnvm::DFSVisit(g.outputs, [&](const NodePtr& node) { topo.push_back(node); });
+
+  // consumers needing the default layout read the outputs of MKLDNN operators
+  // through a reorder, which is inserted while the operators are copied
+  std::unordered_map<const Node*, NodePtr> copied;
+  std::unordered_map<const Node*, std::unordered_map<uint32_t, NodePtr> > reorders;
+  size_t num_reorders = 0;
+  for (const NodePtr& node : topo) {
+    if (node->is_variable()) {
+      copied[node.get()] = node;
+      continue;
+    }
+    NodePtr copy = Node::Create();
+    copy->attrs = node->attrs;
+    for (const NodePtr& dep : node->control_deps) {
+      copy->control_deps.push_back(copied.at(dep.get()));
+    }
+    const bool reads_mkldnn = ReadsMKLDNNLayout(*node);
+    for (const NodeEntry& e : node->inputs) {
+      NodeEntry input{copied.at(e.node.get()), e.index, e.version};
+      if (!reads_mkldnn && WritesMKLDNNLayout(*e.node)) {
+        // every consumer of the entry needing the default layout shares one reorder
+        NodePtr& reorder = reorders[e.node.get()][e.index];
+        if (reorder == nullptr) {
+          reorder = Node::Create();
+          reorder->attrs.op = nnvm::Op::Get("_mkldnn_reorder2default");
+          reorder->attrs.name = e.node->attrs.name + "_reorder" +
+                                (e.index == 0 ? std::string() : std::to_string(e.index));
+          for (const auto& kv : e.node->attrs.dict) {
+            if (kv.first.compare(0, 2, "__") == 0) reorder->attrs.dict.insert(kv);
+          }
+          reorder->inputs.push_back(input);
+          ++num_reorders;
+        }
+        input = NodeEntry{reorder, 0, 0};
+      }
+      copy->inputs.push_back(input);
+    }
+    copied[node.get()] = copy;
+  }
+  if (num_reorders == 0) return g;
+
+  // graph outputs stay in place, they are reordered when they are read
+  for (NodeEntry& e : g.outputs) {
+    e = NodeEntry{copied.at(e.node.get()), e.index, e.version};
+  }
+  if (dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+    LOG(INFO) << "MKLDNNLayout: inserted " << num_reorders << " reorders";
+  }
+  return g;
+}
+
+}  // namespace exec
+}  // namespace mxnet
+#endif  // MXNET_USE_MKLDNN == 1
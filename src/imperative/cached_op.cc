@@ -16,9 +16,12 @@
  * specific language governing permissions and limitations
  * under the License.
  */
+#include <algorithm>
 #include <unordered_set>
 #include <iostream>
+#include <sstream>
 #include "./imperative_utils.h"
+#include "../profiler/nvtx.h"
 
 namespace mxnet {
 
@@ -176,6 +179,33 @@ std::vector<nnvm::NodeEntry> Imperative::CachedOp::Gradient(
   return ret;
 }
 
+/*!
+ * \brief swap the shapes and memory plans g holds, named by names, for the ones it
+ *  inferred earlier for the new inputs, if they are among the last cache_size kept.
+ *  The current ones are kept in turn, so a graph fed a few distinct shapes, like
+ *  variable length sequences, runs shape inference and memory planning once per shape.
+ * \param matches whether a set of graph attributes was inferred from the new inputs
+ */
+template<typename FMatch>
+void SwapShapeAttrs(nnvm::Graph* g, const std::vector<std::string>& names,
+                    const FMatch& matches, size_t cache_size,
+                    std::list<std::unordered_map<std::string,
+                                                 std::shared_ptr<dmlc::any> > >* cache) {
+  if (cache_size == 0 || !g->attrs.count("shape") || matches(g->attrs)) return;
+  std::unordered_map<std::string, std::shared_ptr<dmlc::any> > current;
+  for (const auto& name : names) {
+    if (g->attrs.count(name)) current[name] = g->attrs.at(name);
+  }
+  auto it = std::find_if(cache->begin(), cache->end(), matches);
+  if (it != cache->end()) {
+    for (const auto& name : names) g->attrs.erase(name);
+    for (const auto& kv : *it) g->attrs[kv.first] = kv.second;
+    cache->erase(it);
+  }
+  cache->push_front(std::move(current));
+  if (cache->size() > cache_size) cache->pop_back();
+}
+
 nnvm::Graph Imperative::CachedOp::GetForwardGraph(
     const bool recording, const std::vector<NDArray*>& inputs) {
   using namespace nnvm;
@@ -196,12 +226,21 @@ nnvm::Graph Imperative::CachedOp::GetForwardGraph(
     storage_type_inputs.emplace_back(inputs[i]->storage_type());
   }
 
-  bool match = true;
-  match &= CheckAndInferShape(&g, std::move(shape_inputs), true);
-  match &= CheckAndInferType(&g, std::move(dtype_inputs), true);
+  SwapShapeAttrs(
+      &g, {"shape", "shape_inputs", "forward_mem_plan", "full_mem_plan"},
+      [&shape_inputs](const std::unordered_map<std::string, std::shared_ptr<dmlc::any> >& attrs) {
+        return attrs.count("shape_inputs") &&
+               dmlc::get<ShapeVector>(*attrs.at("shape_inputs")) == shape_inputs;
+      }, param_.shape_cache_size, &fwd_shape_cache_);
+
+  bool match = CheckAndInferShape(&g, std::move(shape_inputs), true);
+  bool type_match = CheckAndInferType(&g, std::move(dtype_inputs), true);
   exec::DevMaskVector dev_mask(g.indexed_graph().num_nodes(), inputs[0]->ctx().dev_mask());
-  match &= CheckAndInferStorageType(&g, std::move(dev_mask),
-                                    std::move(storage_type_inputs), true);
+  type_match &= CheckAndInferStorageType(&g, std::move(dev_mask),
+                                         std::move(storage_type_inputs), true);
+  // the kept memory plans were made for the previous types
+  if (!type_match) fwd_shape_cache_.clear();
+  match &= type_match;
 
   if (!match) {
     g.attrs.erase("forward_mem_plan");
@@ -230,6 +269,84 @@ nnvm::Graph Imperative::CachedOp::GetForwardGraph(
   return g;
 }
 
+struct Imperative::CachedOp::ForwardArena {
+  /*! \brief forward graph with the shapes and types of the signature inferred */
+  nnvm::Graph graph;
+  imperative::MemoryPlanVector mem_plan;
+  /*! \brief view into the arena of every planned intermediate, none for the others */
+  std::vector<NDArray> arrays;
+};
+
+std::shared_ptr<Imperative::CachedOp::ForwardArena> Imperative::CachedOp::GetForwardArena(
+    const std::vector<NDArray*>& inputs) {
+  using namespace nnvm;
+  using namespace imperative;
+  CHECK_EQ(inputs.size(), num_inputs());
+  const Context& ctx = inputs[0]->ctx();
+  std::ostringstream os;
+  os << ctx;
+  for (const NDArray* in : inputs) {
+    os << ';' << in->shape() << ',' << in->dtype() << ',' << in->storage_type();
+  }
+  const std::string key = os.str();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = arenas_.begin(); it != arenas_.end(); ++it) {
+    if (it->first != key) continue;
+    arenas_.splice(arenas_.begin(), arenas_, it);
+    return arenas_.front().second;
+  }
+
+  auto arena = std::make_shared<ForwardArena>();
+  nnvm::Graph& g = arena->graph;
+  g = fwd_graph_;
+  ShapeVector shape_inputs;
+  DTypeVector dtype_inputs;
+  StorageTypeVector storage_type_inputs;
+  for (const NDArray* in : inputs) {
+    shape_inputs.emplace_back(in->shape());
+    dtype_inputs.emplace_back(in->dtype());
+    storage_type_inputs.emplace_back(in->storage_type());
+  }
+  CheckAndInferShape(&g, std::move(shape_inputs), true);
+  CheckAndInferType(&g, std::move(dtype_inputs), true);
+  exec::DevMaskVector dev_mask(g.indexed_graph().num_nodes(), ctx.dev_mask());
+  CheckAndInferStorageType(&g, std::move(dev_mask), std::move(storage_type_inputs), true);
+
+  // outputs are handed to the caller, so they are never placed in the arena
+  const auto& idx = g.indexed_graph();
+  StorageVector storage(idx.num_node_entries(), exec::kBadStorageID);
+  for (const auto i : idx.input_nodes()) storage[idx.entry_id(i, 0)] = exec::kExternalStorageID;
+  for (const auto& i : idx.outputs()) storage[idx.entry_id(i)] = exec::kExternalStorageID;
+  const auto& stypes = g.GetAttr<StorageTypeVector>("storage_type");
+  for (size_t i = 0; i < stypes.size(); i++) {
+    if (stypes[i] != kDefaultStorage) storage[i] = exec::kDynamicStorageID;
+  }
+  std::vector<bool> planned(storage.size());
+  for (size_t i = 0; i < storage.size(); ++i) planned[i] = storage[i] == exec::kBadStorageID;
+  arena->mem_plan = PlanMemory(&g, std::move(storage),
+                               g.GetAttr<std::vector<uint32_t> >("forward_ref_count"));
+
+  const auto& shapes = g.GetAttr<ShapeVector>("shape");
+  const auto& dtypes = g.GetAttr<DTypeVector>("dtype");
+  arena->arrays.resize(idx.num_node_entries());
+  for (size_t i = 0; i < arena->arrays.size(); ++i) {
+    const MemoryPlanInfo& info = arena->mem_plan[i];
+    if (!planned[i] || info.sid != i || info.size == 0) continue;
+    NDArray buff(TShape({static_cast<nnvm::dim_t>(info.size)}), ctx, false, mshadow::kUint8);
+    arena->arrays[i] = buff.AsArray(shapes[i], dtypes[i]);
+  }
+  for (size_t i = 0; i < arena->arrays.size(); ++i) {
+    const MemoryPlanInfo& info = arena->mem_plan[i];
+    if (!planned[i] || info.sid == i || arena->arrays[info.sid].is_none()) continue;
+    arena->arrays[i] = arena->arrays[info.sid].AsArray(shapes[i], dtypes[i]);
+  }
+
+  arenas_.emplace_front(key, arena);
+  if (arenas_.size() > param_.static_alloc_cache_size) arenas_.pop_back();
+  return arena;
+}
+
 nnvm::Graph Imperative::CachedOp::GetBackwardGraph(
     const OpStatePtr& op_state,
     const std::vector<OpReqType>& reqs,
@@ -253,6 +370,7 @@ nnvm::Graph Imperative::CachedOp::GetBackwardGraph(
       if (curr_grad_req_[i]) g.outputs.emplace_back(grad_graph_.outputs[i]);
     }
     bwd_input_eid_.clear();
+    bwd_shape_cache_.clear();
   }
 
   const auto& idx = g.indexed_graph();
@@ -307,14 +425,29 @@ nnvm::Graph Imperative::CachedOp::GetBackwardGraph(
   node_range = {num_forward_nodes, idx.num_nodes()};
   entry_range = {num_forward_entries, idx.num_node_entries()};
 
-  bool match = true;
-  match &= CheckAndInferShape(&g, std::move(shapes), false,
-                              node_range, entry_range);
-  match &= CheckAndInferType(&g, std::move(dtypes), false,
-                             node_range, entry_range);
+  SwapShapeAttrs(
+      &g, {"shape", "backward_mem_plan"},
+      [&shapes, &entry_range](
+          const std::unordered_map<std::string, std::shared_ptr<dmlc::any> >& attrs) {
+        if (!attrs.count("shape")) return false;
+        const auto& prev_shapes = dmlc::get<ShapeVector>(*attrs.at("shape"));
+        for (size_t i = 0; i < shapes.size(); ++i) {
+          if (i == entry_range.first) i = entry_range.second;
+          if (i >= shapes.size()) break;
+          if (shapes[i] != prev_shapes[i]) return false;
+        }
+        return true;
+      }, param_.shape_cache_size, &bwd_shape_cache_);
+
+  bool match = CheckAndInferShape(&g, std::move(shapes), false,
+                                  node_range, entry_range);
+  bool type_match = CheckAndInferType(&g, std::move(dtypes), false,
+                                      node_range, entry_range);
   exec::DevMaskVector dev_mask(idx.num_nodes(), inputs[0]->ctx().dev_mask());
-  match &= CheckAndInferStorageType(&g, std::move(dev_mask), std::move(stypes),
-                                    false, node_range, entry_range);
+  type_match &= CheckAndInferStorageType(&g, std::move(dev_mask), std::move(stypes),
+                                         false, node_range, entry_range);
+  if (!type_match) bwd_shape_cache_.clear();
+  match &= type_match;
 
   if (!match) {
     g.attrs.erase("backward_mem_plan");
@@ -346,10 +479,14 @@ void Imperative::CachedOp::Forward(
   using namespace nnvm;
   using namespace imperative;
   static const auto cached_op = nnvm::Op::Get("_CachedOp");
+  profiler::nvtx::NVTXRange nvtx_range("CachedOp::Forward", profiler::nvtx::kCachedOp);
 
   // Initialize
   bool recording = Imperative::Get()->is_recording();
-  nnvm::Graph g = GetForwardGraph(recording, inputs);
+  // the arena is reused by the next call, so only inference can use it
+  std::shared_ptr<ForwardArena> arena;
+  if (param_.static_alloc && !recording) arena = GetForwardArena(inputs);
+  nnvm::Graph g = arena ? arena->graph : GetForwardGraph(recording, inputs);
   const auto& idx = g.indexed_graph();
   size_t num_inputs = idx.input_nodes().size();
 
@@ -395,8 +532,17 @@ void Imperative::CachedOp::Forward(
     if (ref_count[i] == 0) array_reqs[i] = kNullOp;
   }
 
-  const auto& mem_plan = g.GetAttr<MemoryPlanVector >(
+  const auto& mem_plan = arena ? arena->mem_plan : g.GetAttr<MemoryPlanVector >(
       recording ? "full_mem_plan" : "forward_mem_plan");
+  if (arena) {
+    // later calls wait for the pending reads of earlier ones through the engine
+    // variables of the arena, the rest is allocated as usual
+    for (size_t i = 0; i < arrays.size(); ++i) {
+      if (arena->arrays[i].is_none() || !arrays[i]->is_none()) continue;
+      *arrays[i] = arena->arrays[i];
+      if (mem_plan[i].inplace && array_reqs[i] == kWriteTo) array_reqs[i] = kWriteInplace;
+    }
+  }
   AllocateMemory(g, idx, default_ctx, 0, idx.num_node_entries(),
                  mem_plan, arrays, &array_reqs);
 
@@ -443,6 +589,7 @@ void Imperative::CachedOp::Backward(
       << "CachedOp does not support higher order gradients. "
       << "If you want to do backward with create_graph=True please "
       << "do not use hybridize.";
+  profiler::nvtx::NVTXRange nvtx_range("CachedOp::Backward", profiler::nvtx::kCachedOp);
 
   // Initialize
   nnvm::Graph g = GetBackwardGraph(state, reqs, inputs);
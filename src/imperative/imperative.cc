@@ -18,6 +18,8 @@
  */
 #include <unordered_set>
 #include <iostream>
+#include <map>
+#include <sstream>
 #include "./imperative_utils.h"
 
 namespace mxnet {
@@ -355,6 +357,74 @@ void Imperative::RunGraph(
 }
 
 
+struct Imperative::BackwardPlan {
+  /*! \brief forward and gradient graph with the inferred attributes */
+  nnvm::Graph graph;
+  /*! \brief every node of the graph, the recorded history they hang off is cleared */
+  std::vector<nnvm::NodePtr> nodes;
+  /*! \brief placement of every node */
+  std::vector<Context> vctx;
+  size_t num_forward_outputs, num_forward_nodes, num_forward_entries;
+  /*! \brief entry of every head gradient in the graph, -1 when it is not used */
+  std::vector<int64_t> ograd_eids;
+};
+
+std::string Imperative::BackwardPlanKey(
+    const std::vector<nnvm::NodeEntry>& outputs,
+    const std::vector<NDArray*>& ograds,
+    const std::vector<NDArray*>& variables,
+    std::vector<nnvm::NodePtr>* p_nodes) {
+  static const nnvm::Op* cached_op = nnvm::Op::Get("_CachedOp");
+  std::vector<nnvm::NodePtr>& nodes = *p_nodes;
+  std::unordered_map<const nnvm::Node*, size_t> node_ids;
+  bool cacheable = true;
+  std::ostringstream os;
+  auto write_array = [&os](const NDArray& arr) {
+    os << arr.shape() << ',' << arr.dtype() << ',' << arr.storage_type();
+  };
+  // the nodes are listed in the order the indexed graph visits them, so the
+  // id of a recorded node in a cached plan is its position here
+  nnvm::DFSVisit(outputs, [&](const nnvm::NodePtr& n) {
+    node_ids[n.get()] = nodes.size();
+    nodes.push_back(n);
+    const AGInfo& info = AGInfo::Get(n);
+    os << '|' << info.ctx;
+    if (n->is_variable()) {
+      os << ",v" << info.grad_req;
+      if (info.grad_req != kNullOp) write_array(info.out_grads[0]);
+    } else {
+      // the parsed attributes of cached ops and subgraph ops are not described
+      // by their dictionary
+      if (n->op() == cached_op || !n->attrs.subgraphs.empty()) cacheable = false;
+      os << ',' << n->op()->name;
+      for (const auto& kv : std::map<std::string, std::string>(n->attrs.dict.begin(),
+                                                               n->attrs.dict.end())) {
+        os << ',' << kv.first << '=' << kv.second;
+      }
+    }
+    for (const auto& e : n->inputs) os << ";i" << node_ids.at(e.node.get()) << ':' << e.index;
+    for (const auto& d : n->control_deps) os << ";c" << node_ids.at(d.get());
+    for (const auto& arr : info.outputs) {
+      os << ";o";
+      write_array(arr);
+    }
+  });
+  for (size_t i = 0; i < ograds.size(); ++i) {
+    os << "|g";
+    if (ograds[i] != nullptr) write_array(*ograds[i]);
+  }
+  for (const auto& i : outputs) os << "|e" << node_ids.at(i.node.get()) << ':' << i.index;
+  for (const auto& i : variables) {
+    auto it = node_ids.find(i->entry_.node.get());
+    if (it == node_ids.end()) {
+      cacheable = false;
+      break;
+    }
+    os << "|x" << it->second;
+  }
+  return cacheable ? os.str() : std::string();
+}
+
 std::vector<NDArray*> Imperative::Backward(
     const std::vector<NDArray*>& outputs,
     const std::vector<NDArray*>& ograds,
@@ -365,19 +435,21 @@ std::vector<NDArray*> Imperative::Backward(
   using namespace imperative;
   static const std::vector<const Op*> zero_ops{Op::Get("zeros_like"), Op::Get("_zeros")};
   static const Op* copy_op = Op::Get("_copy");
+  static const size_t plan_cache_size =
+      dmlc::GetEnv("MXNET_IMPERATIVE_BACKWARD_CACHE_SIZE", 8);
 
   // Construct forward graph
-  Graph graph;
-  graph.outputs.reserve(outputs.size());
+  Symbol sym;
+  sym.outputs.reserve(outputs.size());
   for (const auto& i : outputs) {
     CHECK(!AGInfo::IsNone(*i))
       << "Cannot differentiate node because it is not in a computational graph. "
       << "You need to set is_recording to true or use autograd.record() to save "
       << "computational graphs for backward. If you want to differentiate the same "
       << "graph twice, you need to pass retain_graph=True to backward.";
-    graph.outputs.emplace_back(i->entry_);
+    sym.outputs.emplace_back(i->entry_);
   }
-  size_t num_forward_outputs = graph.outputs.size();
+  size_t num_forward_outputs = sym.outputs.size();
 
   // Prepare head gradients
   std::vector<NodeEntry> ograd_entries;
@@ -396,8 +468,6 @@ std::vector<NDArray*> Imperative::Backward(
   }
 
   // Get gradient graph
-  Symbol sym;
-  sym.outputs = graph.outputs;
   std::vector<NodeEntry> xs;
   std::vector<NDArray*> x_grads;
   std::vector<OpReqType> x_reqs;
@@ -431,31 +501,69 @@ std::vector<NDArray*> Imperative::Backward(
         << "There are no inputs in computation graph that require gradients.";
   }
 
-  Graph g_graph = pass::Gradient(
-      graph, graph.outputs, xs, ograd_entries,
-      exec::AggregateGradient, nullptr, nullptr,
-      zero_ops, "_copy");
-  CHECK_EQ(g_graph.outputs.size(), xs.size());
-  for (const auto &e : g_graph.outputs) {
-    if (e.node->op() == nullptr) {
-      auto node = Node::Create();
-      node->attrs.op = copy_op;
-      node->inputs.push_back(e);
-      graph.outputs.push_back(NodeEntry{node, 0, 0});
-    } else {
-      graph.outputs.push_back(e);
+  // Training loops record the same tape every step, so the gradient graph and its
+  // inferred attributes are reused while the structure of the tape is unchanged.
+  // Plans are only kept when the history is dropped after backward, which is what
+  // makes the recorded nodes of a step interchangeable with those of the next.
+  std::vector<NodePtr> fwd_nodes;
+  std::string key;
+  if (!create_graph && !retain_graph && plan_cache_size > 0) {
+    key = BackwardPlanKey(sym.outputs, ograds, variables, &fwd_nodes);
+  }
+  std::shared_ptr<BackwardPlan> plan;
+  if (!key.empty()) {
+    std::lock_guard<std::mutex> lock(backward_plan_mutex_);
+    for (auto it = backward_plans_.begin(); it != backward_plans_.end(); ++it) {
+      if (it->first != key) continue;
+      backward_plans_.splice(backward_plans_.begin(), backward_plans_, it);
+      plan = backward_plans_.front().second;
+      break;
+    }
+  }
+  const bool cached = plan != nullptr;
+  if (!cached) {
+    plan = std::make_shared<BackwardPlan>();
+    plan->num_forward_outputs = num_forward_outputs;
+  }
+
+  Graph& graph = plan->graph;
+  if (!cached) {
+    graph.outputs = sym.outputs;
+    Graph g_graph = pass::Gradient(
+        graph, graph.outputs, xs, ograd_entries,
+        exec::AggregateGradient, nullptr, nullptr,
+        zero_ops, "_copy");
+    CHECK_EQ(g_graph.outputs.size(), xs.size());
+    for (const auto &e : g_graph.outputs) {
+      if (e.node->op() == nullptr) {
+        auto node = Node::Create();
+        node->attrs.op = copy_op;
+        node->inputs.push_back(e);
+        graph.outputs.push_back(NodeEntry{node, 0, 0});
+      } else {
+        graph.outputs.push_back(e);
+      }
     }
   }
   const auto& idx = graph.indexed_graph();
-  // get number of nodes used in forward pass
-  size_t num_forward_nodes = 0;
-  size_t num_forward_entries = 0;
-  for (size_t i = 0; i < num_forward_outputs; ++i) {
-    num_forward_nodes = std::max(
-        num_forward_nodes, static_cast<size_t>(idx.outputs()[i].node_id + 1));
-    num_forward_entries = std::max(
-        num_forward_entries, static_cast<size_t>(idx.entry_id(idx.outputs()[i])) + 1);
+  if (!cached) {
+    // get number of nodes used in forward pass
+    plan->num_forward_nodes = 0;
+    plan->num_forward_entries = 0;
+    for (size_t i = 0; i < num_forward_outputs; ++i) {
+      plan->num_forward_nodes = std::max(
+          plan->num_forward_nodes, static_cast<size_t>(idx.outputs()[i].node_id + 1));
+      plan->num_forward_entries = std::max(
+          plan->num_forward_entries, static_cast<size_t>(idx.entry_id(idx.outputs()[i])) + 1);
+    }
+    for (const auto& e : ograd_entries) {
+      plan->ograd_eids.push_back(idx.exist(e.node.get()) ?
+                                 static_cast<int64_t>(idx.entry_id(e)) : -1);
+    }
   }
+  const size_t num_forward_nodes = plan->num_forward_nodes;
+  const size_t num_forward_entries = plan->num_forward_entries;
+  CHECK(!cached || fwd_nodes.size() == num_forward_nodes);
 
   // Allocate buffer
   std::vector<NDArray> buff(idx.num_node_entries());
@@ -488,7 +596,9 @@ std::vector<NDArray*> Imperative::Backward(
   } else {
     states.reserve(num_forward_nodes);
     for (size_t i = 0; i < num_forward_nodes; ++i) {
-      const AGInfo& info = dmlc::get<AGInfo>(idx[i].source->info);
+      // a cached plan refers to the nodes recorded by an earlier step
+      const Node* source = cached ? fwd_nodes[i].get() : idx[i].source;
+      const AGInfo& info = dmlc::get<AGInfo>(source->info);
       states.emplace_back(info.state);
       for (size_t j = 0; j < info.outputs.size(); ++j) {
         size_t eid = idx.entry_id(i, j);
@@ -498,9 +608,9 @@ std::vector<NDArray*> Imperative::Backward(
       }
     }
     for (size_t i = 0; i < ograd_entries.size(); ++i) {
-      if (!idx.exist(ograd_entries[i].node.get())) continue;
+      if (plan->ograd_eids[i] < 0) continue;
       AGInfo& info = AGInfo::Get(ograd_entries[i].node);
-      arrays[idx.entry_id(ograd_entries[i])] = &info.outputs[0];
+      arrays[plan->ograd_eids[i]] = &info.outputs[0];
     }
   }
   for (size_t i = num_forward_outputs; i < graph.outputs.size(); ++i) {
@@ -509,11 +619,12 @@ std::vector<NDArray*> Imperative::Backward(
     ref_count[eid] = 1;
   }
 
-  // Assign context
-  auto vctx = PlaceDevice(idx);
+  if (!cached) {
+    // Assign context
+    plan->vctx = PlaceDevice(idx);
+    const auto& vctx = plan->vctx;
 
-  // Infer shape type
-  {
+    // Infer shape type
     std::pair<uint32_t, uint32_t> node_range, entry_range;
     node_range = {num_forward_nodes, idx.num_nodes()};
     entry_range = {num_forward_entries, idx.num_node_entries()};
@@ -539,6 +650,7 @@ std::vector<NDArray*> Imperative::Backward(
     CheckAndInferStorageType(&graph, std::move(dev_mask), std::move(stypes), false,
                              node_range, entry_range);
   }
+  const auto& vctx = plan->vctx;
 
   // Calculate ref count
   for (size_t i = num_forward_nodes; i < idx.num_nodes(); ++i) {
@@ -576,6 +688,13 @@ std::vector<NDArray*> Imperative::Backward(
     }
   }
 
+  if (!cached && !key.empty()) {
+    // the nodes of the plan outlive the history cleared below
+    nnvm::DFSVisit(graph.outputs, [&](const nnvm::NodePtr& n) {
+      plan->nodes.push_back(n);
+    });
+  }
+
   // Execution
 
   bool prev_recording = set_is_recording(create_graph);
@@ -597,6 +716,14 @@ std::vector<NDArray*> Imperative::Backward(
     });
   }
 
+  if (!cached && !key.empty()) {
+    // the head gradients of this step must not be kept alive by the plan
+    for (const auto& e : ograd_entries) AGInfo::Clear(e.node);
+    std::lock_guard<std::mutex> lock(backward_plan_mutex_);
+    backward_plans_.emplace_front(key, plan);
+    if (backward_plans_.size() > plan_cache_size) backward_plans_.pop_back();
+  }
+
   if (variables.size()) {
     return x_grads;
   }
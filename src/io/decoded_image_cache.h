@@ -0,0 +1,125 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file decoded_image_cache.h
+ * \brief cache of decoded images for datasets that are read many times
+ */
+#ifndef MXNET_IO_DECODED_IMAGE_CACHE_H_
+#define MXNET_IO_DECODED_IMAGE_CACHE_H_
+
+#if MXNET_USE_OPENCV
+#include <dmlc/logging.h>
+#include <opencv2/opencv.hpp>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace mxnet {
+namespace io {
+/*!
+ * \brief Keeps decoded images by record index within a memory budget.
+ *
+ *  Images that do not fit are appended to a spill file, if one is given,
+ *  and read back from there; otherwise they are simply not cached. All
+ *  methods are thread safe, callers always get their own copy of the
+ *  pixels since augmenters may work in place.
+ */
+class DecodedImageCache {
+ public:
+  /*!
+   * \param budget_bytes memory budget of the cached pixels
+   * \param spill_path file to spill to, empty to not spill
+   */
+  DecodedImageCache(size_t budget_bytes, const std::string& spill_path)
+      : budget_bytes_(budget_bytes) {
+    if (!spill_path.empty()) {
+      spill_ = std::fopen(spill_path.c_str(), "w+b");
+      CHECK(spill_ != nullptr) << "Failed to open image cache spill file " << spill_path;
+    }
+  }
+
+  ~DecodedImageCache() {
+    if (spill_ != nullptr) std::fclose(spill_);
+  }
+  /*!
+   * \brief look up a decoded image.
+   * \return false if the image is not cached
+   */
+  bool Get(uint64_t key, cv::Mat* out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto mem = memory_.find(key);
+    if (mem != memory_.end()) {
+      *out = mem->second.clone();
+      return true;
+    }
+    auto disk = disk_.find(key);
+    if (disk == disk_.end()) return false;
+    const DiskEntry& e = disk->second;
+    out->create(e.rows, e.cols, e.type);
+    CHECK_EQ(std::fseek(spill_, e.offset, SEEK_SET), 0);
+    CHECK_EQ(std::fread(out->data, 1, e.bytes, spill_), e.bytes)
+      << "Failed to read the image cache spill file";
+    return true;
+  }
+  /*! \brief cache a decoded image, first writer wins */
+  void Put(uint64_t key, const cv::Mat& img) {
+    const cv::Mat image = img.isContinuous() ? img : img.clone();
+    const size_t bytes = image.total() * image.elemSize();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (memory_.count(key) || disk_.count(key)) return;
+    if (used_bytes_ + bytes <= budget_bytes_) {
+      memory_[key] = image.clone();
+      used_bytes_ += bytes;
+    } else if (spill_ != nullptr) {
+      DiskEntry e;
+      e.offset = spill_end_;
+      e.bytes = bytes;
+      e.rows = image.rows;
+      e.cols = image.cols;
+      e.type = image.type();
+      CHECK_EQ(std::fseek(spill_, e.offset, SEEK_SET), 0);
+      CHECK_EQ(std::fwrite(image.data, 1, bytes, spill_), bytes)
+        << "Failed to write the image cache spill file";
+      spill_end_ += bytes;
+      disk_[key] = e;
+    }
+  }
+
+ private:
+  /*! \brief location of a spilled image */
+  struct DiskEntry {
+    long offset;  // NOLINT(*)
+    size_t bytes;
+    int rows, cols, type;
+  };
+  size_t budget_bytes_;
+  size_t used_bytes_{0};
+  std::FILE* spill_{nullptr};
+  long spill_end_{0};  // NOLINT(*)
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, cv::Mat> memory_;
+  std::unordered_map<uint64_t, DiskEntry> disk_;
+};
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_USE_OPENCV
+#endif  // MXNET_IO_DECODED_IMAGE_CACHE_H_
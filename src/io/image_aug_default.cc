@@ -194,6 +194,10 @@ class DefaultImageAugmenter : public ImageAugmenter {
       return inter_method;
     }
   }
+  int MinDecodeShortSide() const override {
+    // everything after the resize only sees the resized image
+    return param_.resize;
+  }
   cv::Mat Process(const cv::Mat &src, std::vector<float> *label,
                   common::RANDOM_ENGINE *prnd) override {
     using mshadow::index_t;
@@ -59,6 +59,14 @@ class ImageAugmenter {
    */
   virtual cv::Mat Process(const cv::Mat &src, std::vector<float> *label,
                           common::RANDOM_ENGINE *prnd) = 0;
+  /*!
+   * \brief shorter edge the source image needs to have for this augmenter
+   *  to produce the same result, so the decoder may decode at a lower scale.
+   * \return the edge length, or -1 if the full resolution is needed
+   */
+  virtual int MinDecodeShortSide() const {
+    return -1;
+  }
   // virtual destructor
   virtual ~ImageAugmenter() {}
   /*!
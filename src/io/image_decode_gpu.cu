@@ -0,0 +1,213 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file image_decode_gpu.cu
+ * \brief batched JPEG decode with nvJPEG
+ */
+#include <dmlc/logging.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "./image_decode_gpu.h"
+#include "../common/cuda_utils.h"
+
+#if MXNET_USE_NVJPEG
+
+#define NVJPEG_CALL(func)                                              \
+  {                                                                    \
+    nvjpegStatus_t e = (func);                                         \
+    CHECK_EQ(e, NVJPEG_STATUS_SUCCESS) << "nvJPEG: " << static_cast<int>(e); \
+  }
+
+namespace mxnet {
+namespace io {
+
+namespace {
+const int kDecodeThreads = 256;
+const int kDecodeMaxBlocks = 4096;
+}  // namespace
+
+/*!
+ * \brief bilinear sample of each crop window into the NCHW batch, with the
+ *  mirror and normalization of ImageRecordIOParser2::ProcessImage.
+ *  One thread per output element.
+ */
+template<typename DType>
+__global__ void CropResizeNormalizeKernel(const uint8_t* images, const GPUImageDesc* descs,
+                                          const GPUNormalize norm, const int channels,
+                                          const int out_h, const int out_w, const int n,
+                                          DType* out) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x; index < n;
+       index += blockDim.x * gridDim.x) {
+    const int x = index % out_w;
+    const int y = (index / out_w) % out_h;
+    const int c = (index / out_w / out_h) % channels;
+    const int b = index / (out_w * out_h * channels);
+    const GPUImageDesc d = descs[b];
+    // mirror reads the source column from the other side
+    const int src_col = d.mirror ? out_w - 1 - x : x;
+    float sx = d.x0 + (src_col + 0.5f) * d.crop_w / out_w - 0.5f;
+    float sy = d.y0 + (y + 0.5f) * d.crop_h / out_h - 0.5f;
+    sx = fminf(fmaxf(sx, 0.f), d.width - 1.f);
+    sy = fminf(fmaxf(sy, 0.f), d.height - 1.f);
+    const int x0 = static_cast<int>(sx);
+    const int y0 = static_cast<int>(sy);
+    const int x1 = min(x0 + 1, d.width - 1);
+    const int y1 = min(y0 + 1, d.height - 1);
+    const float ax = sx - x0;
+    const float ay = sy - y0;
+    const uint8_t* img = images + d.offset;
+    const float top = (1.f - ax) * img[(y0 * d.width + x0) * channels + c] +
+                      ax * img[(y0 * d.width + x1) * channels + c];
+    const float bottom = (1.f - ax) * img[(y1 * d.width + x0) * channels + c] +
+                         ax * img[(y1 * d.width + x1) * channels + c];
+    float v = (1.f - ay) * top + ay * bottom;
+    if (norm.enabled) {
+      v = (v - norm.mean[c]) * d.contrast / norm.std[c] + d.illumination / norm.std[c];
+      // int8 output saturates like PixelCast<int8_t> of the CPU path
+      if (sizeof(DType) == 1) v = fminf(fmaxf(rintf(v), -128.f), 127.f);
+    } else {
+      v = fminf(fmaxf(roundf(v), 0.f), 255.f);
+    }
+    out[index] = DType(v);
+  }
+}
+
+ImageDecoderGPU::ImageDecoderGPU(int dev_id, int channels, int cpu_threads)
+  : dev_id_(dev_id), channels_(channels), cpu_threads_(cpu_threads) {
+  CHECK(channels_ == 1 || channels_ == 3)
+    << "GPU decode supports 1 or 3 channels, got " << channels_;
+  CUDA_CALL(cudaSetDevice(dev_id_));
+  CUDA_CALL(cudaStreamCreateWithFlags(&stream_, cudaStreamNonBlocking));
+  NVJPEG_CALL(nvjpegCreateSimple(&handle_));
+  NVJPEG_CALL(nvjpegJpegStateCreate(handle_, &state_));
+}
+
+ImageDecoderGPU::~ImageDecoderGPU() {
+  cudaSetDevice(dev_id_);
+  if (images_ != nullptr) cudaFree(images_);
+  if (descs_ != nullptr) cudaFree(descs_);
+  nvjpegJpegStateDestroy(state_);
+  nvjpegDestroy(handle_);
+  cudaStreamDestroy(stream_);
+}
+
+bool ImageDecoderGPU::GetImageInfo(const std::string& image, int* height, int* width) {
+  const unsigned char* data = reinterpret_cast<const unsigned char*>(image.data());
+  if (image.size() < 2 || data[0] != 255 || data[1] != 216) return false;
+  int num_components;
+  nvjpegChromaSubsampling_t subsampling;
+  int widths[NVJPEG_MAX_COMPONENT];
+  int heights[NVJPEG_MAX_COMPONENT];
+  if (nvjpegGetImageInfo(handle_, data, image.size(), &num_components, &subsampling,
+                         widths, heights) != NVJPEG_STATUS_SUCCESS) {
+    return false;
+  }
+  *height = heights[0];
+  *width = widths[0];
+  return true;
+}
+
+void ImageDecoderGPU::Reserve(size_t image_bytes, size_t num_images) {
+  if (image_bytes > images_bytes_) {
+    if (images_ != nullptr) CUDA_CALL(cudaFree(images_));
+    // leave some room so that slightly larger batches do not reallocate
+    images_bytes_ = image_bytes + image_bytes / 4;
+    CUDA_CALL(cudaMalloc(&images_, images_bytes_));
+  }
+  if (num_images > descs_size_) {
+    if (descs_ != nullptr) CUDA_CALL(cudaFree(descs_));
+    descs_size_ = num_images;
+    CUDA_CALL(cudaMalloc(&descs_, descs_size_ * sizeof(GPUImageDesc)));
+  }
+}
+
+template<typename DType>
+void ImageDecoderGPU::Decode(const std::vector<std::string>& images,
+                             std::vector<GPUImageDesc>* descs,
+                             const GPUNormalize& norm,
+                             int out_height, int out_width, DType* out) {
+  CHECK_EQ(images.size(), descs->size());
+  if (images.empty()) return;
+  CUDA_CALL(cudaSetDevice(dev_id_));
+  size_t total = 0;
+  for (auto& d : *descs) {
+    d.offset = total;
+    // keep every image 256-byte aligned
+    total += (static_cast<size_t>(d.height) * d.width * channels_ + 255) / 256 * 256;
+  }
+  Reserve(total, descs->size());
+
+  std::vector<const unsigned char*> data;
+  std::vector<size_t> lengths;
+  std::vector<nvjpegImage_t> dst;
+  for (size_t i = 0; i < images.size(); ++i) {
+    const GPUImageDesc& d = (*descs)[i];
+    if (d.raw) {
+      CHECK_EQ(images[i].size(), static_cast<size_t>(d.height) * d.width * channels_);
+      CUDA_CALL(cudaMemcpyAsync(images_ + d.offset, images[i].data(), images[i].size(),
+                                cudaMemcpyHostToDevice, stream_));
+    } else {
+      nvjpegImage_t img;
+      std::fill(img.channel, img.channel + NVJPEG_MAX_COMPONENT, nullptr);
+      std::fill(img.pitch, img.pitch + NVJPEG_MAX_COMPONENT, 0);
+      img.channel[0] = images_ + d.offset;
+      img.pitch[0] = static_cast<unsigned int>(d.width * channels_);
+      data.push_back(reinterpret_cast<const unsigned char*>(images[i].data()));
+      lengths.push_back(images[i].size());
+      dst.push_back(img);
+    }
+  }
+  if (!data.empty()) {
+    const nvjpegOutputFormat_t format = channels_ == 1 ? NVJPEG_OUTPUT_Y : NVJPEG_OUTPUT_RGBI;
+    NVJPEG_CALL(nvjpegDecodeBatchedInitialize(handle_, state_, static_cast<int>(data.size()),
+                                              cpu_threads_, format));
+    NVJPEG_CALL(nvjpegDecodeBatched(handle_, state_, data.data(), lengths.data(),
+                                    dst.data(), stream_));
+  }
+  CUDA_CALL(cudaMemcpyAsync(descs_, descs->data(), descs->size() * sizeof(GPUImageDesc),
+                            cudaMemcpyHostToDevice, stream_));
+  const int n = static_cast<int>(descs->size()) * channels_ * out_height * out_width;
+  const int blocks = std::min((n + kDecodeThreads - 1) / kDecodeThreads, kDecodeMaxBlocks);
+  CropResizeNormalizeKernel<DType><<<blocks, kDecodeThreads, 0, stream_>>>(
+    images_, descs_, norm, channels_, out_height, out_width, n, out);
+  CUDA_CALL(cudaGetLastError());
+  // the batch is handed to the engine right after, make it complete
+  CUDA_CALL(cudaStreamSynchronize(stream_));
+}
+
+template void ImageDecoderGPU::Decode<float>(const std::vector<std::string>& images,
+                                             std::vector<GPUImageDesc>* descs,
+                                             const GPUNormalize& norm,
+                                             int out_height, int out_width, float* out);
+template void ImageDecoderGPU::Decode<uint8_t>(const std::vector<std::string>& images,
+                                               std::vector<GPUImageDesc>* descs,
+                                               const GPUNormalize& norm,
+                                               int out_height, int out_width, uint8_t* out);
+template void ImageDecoderGPU::Decode<int8_t>(const std::vector<std::string>& images,
+                                              std::vector<GPUImageDesc>* descs,
+                                              const GPUNormalize& norm,
+                                              int out_height, int out_width, int8_t* out);
+
+}  // namespace io
+}  // namespace mxnet
+
+#endif  // MXNET_USE_NVJPEG
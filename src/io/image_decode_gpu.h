@@ -0,0 +1,138 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file image_decode_gpu.h
+ * \brief batched JPEG decode with nvJPEG, followed by crop, resize and
+ *        normalization on the same GPU
+ */
+#ifndef MXNET_IO_IMAGE_DECODE_GPU_H_
+#define MXNET_IO_IMAGE_DECODE_GPU_H_
+
+#include <dmlc/parameter.h>
+#include <mxnet/base.h>
+#include <string>
+#include <vector>
+
+#if MXNET_USE_NVJPEG
+#include <cuda_runtime.h>
+#include <nvjpeg.h>
+#endif
+
+namespace mxnet {
+namespace io {
+
+/*! \brief augmentations applied on the GPU after decode */
+struct ImageDecodeGPUParam : public dmlc::Parameter<ImageDecodeGPUParam> {
+  /*! \brief resize shorter edge to size before cropping */
+  int resize;
+  /*! \brief whether we do random cropping */
+  bool rand_crop;
+  DMLC_DECLARE_PARAMETER(ImageDecodeGPUParam) {
+    DMLC_DECLARE_FIELD(resize).set_default(-1)
+        .describe("Down scale the shorter edge to a new size before applying other augmentations.");
+    DMLC_DECLARE_FIELD(rand_crop).set_default(false)
+        .describe("If or not randomly crop the image");
+  }
+};
+
+/*! \brief where and how one decoded image is sampled into the batch */
+struct GPUImageDesc {
+  /*! \brief offset of the decoded image in the image buffer */
+  size_t offset;
+  /*! \brief whether the image is already decoded on the host */
+  int raw;
+  /*! \brief decoded image height and width */
+  int height, width;
+  /*! \brief crop window in decoded image coordinates */
+  float x0, y0, crop_w, crop_h;
+  /*! \brief whether to mirror horizontally */
+  int mirror;
+  /*! \brief contrast multiplier and illumination bias */
+  float contrast, illumination;
+};
+
+/*! \brief per-channel normalization shared by the whole batch */
+struct GPUNormalize {
+  /*! \brief whether to normalize at all, false for uint8 output */
+  int enabled;
+  float mean[4];
+  float std[4];
+};
+
+#if MXNET_USE_NVJPEG
+/*!
+ * \brief Decodes a batch of JPEG images with nvJPEG on one GPU and samples
+ *  each crop window into an NCHW output batch on the same device.
+ *
+ *  Images nvJPEG cannot decode are decoded on the host by the caller and
+ *  passed in as raw pixels, so a batch never fails on a few odd records.
+ */
+class ImageDecoderGPU {
+ public:
+  /*!
+   * \param dev_id GPU to decode on
+   * \param channels number of output channels, 1 or 3
+   * \param cpu_threads host threads nvJPEG may use for Huffman decode
+   */
+  ImageDecoderGPU(int dev_id, int channels, int cpu_threads);
+  ~ImageDecoderGPU();
+  /*!
+   * \brief read the size of an encoded image.
+   * \return false if the image is not a JPEG nvJPEG understands
+   */
+  bool GetImageInfo(const std::string& image, int* height, int* width);
+  /*!
+   * \brief decode the images and write the batch.
+   * \param images encoded images, or interleaved pixels for raw descs
+   * \param descs crop windows, the offsets are filled in here
+   * \param norm normalization of the output
+   * \param out_height output height
+   * \param out_width output width
+   * \param out device pointer to the batch in NCHW layout
+   */
+  template<typename DType>
+  void Decode(const std::vector<std::string>& images,
+              std::vector<GPUImageDesc>* descs,
+              const GPUNormalize& norm,
+              int out_height, int out_width, DType* out);
+
+ private:
+  /*! \brief grow the device buffers to hold the decoded batch */
+  void Reserve(size_t image_bytes, size_t num_images);
+
+  int dev_id_;
+  int channels_;
+  int cpu_threads_;
+  cudaStream_t stream_;
+  nvjpegHandle_t handle_;
+  nvjpegJpegState_t state_;
+  /*! \brief decoded interleaved images of the batch */
+  uint8_t* images_{nullptr};
+  size_t images_bytes_{0};
+  /*! \brief descriptors on the device */
+  GPUImageDesc* descs_{nullptr};
+  size_t descs_size_{0};
+};
+#endif  // MXNET_USE_NVJPEG
+
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_IMAGE_DECODE_GPU_H_
@@ -119,6 +119,8 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
   int label_width;
   /*! \brief input shape */
   TShape data_shape;
+  /*! \brief layout of the output batch, NCHW or NHWC */
+  int layout;
   /*! \brief number of threads */
   int preprocess_threads;
   /*! \brief whether to remain silent */
@@ -131,6 +133,20 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
   size_t shuffle_chunk_size;
   /*! \brief the seed for chunk shuffling*/
   int shuffle_chunk_seed;
+  /*! \brief gpu to decode on, -1 to decode on cpu */
+  int gpu_decode_id;
+  /*! \brief whether to decode jpeg at a reduced scale when augmenters allow */
+  bool scaled_decode;
+  /*! \brief whether to read path_imgrec through mmap */
+  bool use_mmap;
+  /*! \brief number of records in the streaming shuffle buffer */
+  size_t shuffle_buffer_size;
+  /*! \brief memory budget of the decoded image cache in MB */
+  size_t cache_mem_mb;
+  /*! \brief shorter edge of the cached images, -1 to keep the decoded size */
+  int cache_resize;
+  /*! \brief file the decoded image cache spills to */
+  std::string cache_spill_path;
 
   // declare parameters
   DMLC_DECLARE_PARAMETER(ImageRecParserParam) {
@@ -153,6 +169,11 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
     DMLC_DECLARE_FIELD(data_shape)
         .set_expect_ndim(3).enforce_nonzero()
         .describe("The shape of one output image in (channels, height, width) format.");
+    DMLC_DECLARE_FIELD(layout).set_default(mshadow::kNCHW)
+        .add_enum("NCHW", mshadow::kNCHW)
+        .add_enum("NHWC", mshadow::kNHWC)
+        .describe("Layout of the output batch. NHWC gives (batch, height, width, channels) "
+                  "for the channels-last operators; data_shape stays in (c, h, w) format.");
     DMLC_DECLARE_FIELD(preprocess_threads).set_lower_bound(1).set_default(4)
         .describe("The number of threads to do preprocessing.");
     DMLC_DECLARE_FIELD(verbose).set_default(true)
@@ -165,6 +186,32 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
         .describe("The data shuffle buffer size in MB. Only valid if shuffle is true.");
     DMLC_DECLARE_FIELD(shuffle_chunk_seed).set_default(0)
         .describe("The random seed for shuffling");
+    DMLC_DECLARE_FIELD(gpu_decode_id).set_default(-1)
+        .describe("Decode JPEG images with nvJPEG on this gpu and output the batch "
+                  "there. Only resize, rand_crop, mirror and mean/std normalization "
+                  "are applied. -1 decodes on the cpu.");
+    DMLC_DECLARE_FIELD(scaled_decode).set_default(false)
+        .describe("With libjpeg-turbo, decode JPEG images at the smallest DCT scale "
+                  "whose shorter edge still covers the augmenter's resize, instead "
+                  "of decoding at full resolution and shrinking afterwards.");
+    DMLC_DECLARE_FIELD(use_mmap).set_default(false)
+        .describe("Map the local path_imgrec file into memory and read records at the "
+                  "offsets of path_imgidx, without copying them into read buffers. "
+                  "Readahead follows the shuffle order.");
+    DMLC_DECLARE_FIELD(shuffle_buffer_size).set_default(0)
+        .describe("If shuffle is true and no path_imgidx is given, read records "
+                  "sequentially on a background thread and shuffle them through a "
+                  "seeded buffer of this many records. 0 shuffles within chunks only.");
+    DMLC_DECLARE_FIELD(cache_mem_mb).set_default(0)
+        .describe("Keep decoded uint8 images of up to this many MB in memory and reuse "
+                  "them in later epochs, so only augmentation runs again. Records are "
+                  "matched by their image index. 0 disables the cache.");
+    DMLC_DECLARE_FIELD(cache_resize).set_default(-1)
+        .describe("Shrink the shorter edge of decoded images to this size before "
+                  "caching them. -1 caches them at the decoded size.");
+    DMLC_DECLARE_FIELD(cache_spill_path).set_default("")
+        .describe("File that decoded images beyond cache_mem_mb are written to and "
+                  "read back from. Empty to not cache them.");
   }
 };
 
@@ -339,6 +386,10 @@ struct PrefetcherParam : public dmlc::Parameter<PrefetcherParam> {
   size_t prefetch_buffer;
   /*! \brief data type */
   dmlc::optional<int> dtype;
+  /*! \brief whether to allocate output batches in shared memory */
+  bool shared_memory;
+  /*! \brief GPU to copy the prefetched batches to, -1 for none */
+  int gpu_prefetch;
 
   // declare parameters
   DMLC_DECLARE_PARAMETER(PrefetcherParam) {
@@ -352,6 +403,15 @@ struct PrefetcherParam : public dmlc::Parameter<PrefetcherParam> {
       .add_enum("uint8", mshadow::kUint8)
       .set_default(dmlc::optional<int>())
       .describe("Output data type. ``None`` means no change.");
+    DMLC_DECLARE_FIELD(shared_memory).set_default(false)
+      .describe("Allocate the output batches in shared memory (cpu_shared), so other "
+                "processes can attach to them by handle without copies. The buffers "
+                "are recycled, so consumers must be done with a batch before the "
+                "iterator runs more than prefetch_buffer batches ahead of it.");
+    DMLC_DECLARE_FIELD(gpu_prefetch).set_default(-1)
+      .describe("If set to a GPU id, the prefetched batches are staged in pinned memory "
+                "and copied to that GPU asynchronously, so the next batch is on the "
+                "device while the current one is computed. -1 keeps them on the CPU.");
   }
 };
 
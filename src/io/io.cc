@@ -22,6 +22,7 @@
 #include <mxnet/io.h>
 #include <dmlc/registry.h>
 #include "./image_augmenter.h"
+#include "./image_decode_gpu.h"
 #include "./image_iter_common.h"
 
 // Registers
@@ -38,5 +39,6 @@ DMLC_REGISTER_PARAMETER(ImageNormalizeParam);
 DMLC_REGISTER_PARAMETER(ImageRecParserParam);
 DMLC_REGISTER_PARAMETER(ImageRecordParam);
 DMLC_REGISTER_PARAMETER(ImageDetNormalizeParam);
+DMLC_REGISTER_PARAMETER(ImageDecodeGPUParam);
 }  // namespace io
 }  // namespace mxnet
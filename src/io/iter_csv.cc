@@ -27,6 +27,7 @@
 #include <dmlc/logging.h>
 #include <dmlc/parameter.h>
 #include <dmlc/data.h>
+#include "./parallel_text_parser.h"
 #include "./iter_prefetcher.h"
 #include "./iter_batchloader.h"
 
@@ -42,6 +43,8 @@ struct CSVIterParam : public dmlc::Parameter<CSVIterParam> {
   std::string label_csv;
   /*! \brief label shape */
   TShape label_shape;
+  /*! \brief number of threads parsing each chunk */
+  int preprocess_threads;
   // declare parameters
   DMLC_DECLARE_PARAMETER(CSVIterParam) {
     DMLC_DECLARE_FIELD(data_csv)
@@ -54,6 +57,8 @@ struct CSVIterParam : public dmlc::Parameter<CSVIterParam> {
     index_t shape1[] = {1};
     DMLC_DECLARE_FIELD(label_shape).set_default(TShape(shape1, shape1 + 1))
         .describe("The shape of one label.");
+    DMLC_DECLARE_FIELD(preprocess_threads).set_lower_bound(1).set_default(4)
+        .describe("The number of threads to parse each chunk of the input with.");
   }
 };
 
@@ -67,9 +72,11 @@ class CSVIter: public IIterator<DataInst> {
   // intialize iterator loads data in
   virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
     param_.InitAllowUnknown(kwargs);
-    data_parser_.reset(dmlc::Parser<uint32_t>::Create(param_.data_csv.c_str(), 0, 1, "csv"));
+    data_parser_.reset(new ParallelTextParser<uint32_t>(param_.data_csv, 0, 1, "csv",
+                                                        param_.preprocess_threads));
     if (param_.label_csv != "NULL") {
-      label_parser_.reset(dmlc::Parser<uint32_t>::Create(param_.label_csv.c_str(), 0, 1, "csv"));
+      label_parser_.reset(new ParallelTextParser<uint32_t>(param_.label_csv, 0, 1, "csv",
+                                                           param_.preprocess_threads));
     } else {
       dummy_label.set_pad(false);
       dummy_label.Resize(mshadow::Shape1(1));
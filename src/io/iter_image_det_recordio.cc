@@ -32,7 +32,9 @@
 #include <dmlc/parameter.h>
 #include <dmlc/recordio.h>
 #include <dmlc/threadediter.h>
+#include <algorithm>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 #include <cstdlib>
 #include "./inst_vector.h"
@@ -478,6 +480,8 @@ struct ImageDetRecordParam: public dmlc::Parameter<ImageDetRecordParam> {
   int seed;
   /*! \brief whether to remain silent */
   bool verbose;
+  /*! \brief whether to batch images of similar aspect ratio together */
+  bool aspect_grouping;
   // declare parameters
   DMLC_DECLARE_PARAMETER(ImageDetRecordParam) {
     DMLC_DECLARE_FIELD(shuffle).set_default(false)
@@ -486,6 +490,13 @@ struct ImageDetRecordParam: public dmlc::Parameter<ImageDetRecordParam> {
         .describe("Augmentation Param: Random Seed.");
     DMLC_DECLARE_FIELD(verbose).set_default(true)
         .describe("Auxiliary Param: Whether to output information.");
+    DMLC_DECLARE_FIELD(aspect_grouping).set_default(false)
+        .describe("Batch images of similar aspect ratio together. The images of each "
+                  "prefetched chunk are sorted by the aspect ratio after augmentation "
+                  "and cut into batches, which are shuffled if shuffle is set. With the "
+                  "shrink and fit resize modes the images of a batch then cover similar "
+                  "regions of data_shape, as given by the height and width in the label "
+                  "header.");
   }
 };
 
@@ -502,6 +513,7 @@ class ImageDetRecordIter : public IIterator<DataInst> {
   // constructor
   virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
     param_.InitAllowUnknown(kwargs);
+    batch_param_.InitAllowUnknown(kwargs);
     // use the kwarg to init parser
     parser_.Init(kwargs);
     // prefetch at most 4 minbatches
@@ -522,6 +534,7 @@ class ImageDetRecordIter : public IIterator<DataInst> {
     iter_.BeforeFirst();
     inst_order_.clear();
     inst_ptr_ = 0;
+    num_emitted_ = 0;
   }
 
   virtual bool Next(void) {
@@ -530,6 +543,7 @@ class ImageDetRecordIter : public IIterator<DataInst> {
         std::pair<unsigned, unsigned> p = inst_order_[inst_ptr_];
         out_ = (*data_)[p.first][p.second];
         ++inst_ptr_;
+        ++num_emitted_;
         return true;
       } else {
         if (data_ != nullptr) iter_.Recycle(&data_);
@@ -545,6 +559,7 @@ class ImageDetRecordIter : public IIterator<DataInst> {
         if (param_.shuffle != 0) {
           std::shuffle(inst_order_.begin(), inst_order_.end(), rnd_);
         }
+        if (param_.aspect_grouping) GroupByAspect();
         inst_ptr_ = 0;
       }
     }
@@ -556,6 +571,43 @@ class ImageDetRecordIter : public IIterator<DataInst> {
   }
 
  private:
+  /*!
+   * \brief reorder inst_order_ into runs of batch_size instances of similar
+   *  aspect ratio. The first run completes the batch the previous chunk left
+   *  partially filled, so runs stay aligned with the batches.
+   */
+  void GroupByAspect() {
+    auto aspect = [this](const std::pair<unsigned, unsigned>& p) {
+      // label header: channels, height, width, label size
+      const mshadow::Tensor<cpu, 1> label = (*data_)[p.first].label()[p.second];
+      return label[2] / std::max(label[1], 1.0f);
+    };
+    std::stable_sort(inst_order_.begin(), inst_order_.end(),
+                     [&aspect](const std::pair<unsigned, unsigned>& a,
+                               const std::pair<unsigned, unsigned>& b) {
+                       return aspect(a) < aspect(b);
+                     });
+    const size_t batch_size = batch_param_.batch_size;
+    const size_t head = (batch_size - num_emitted_ % batch_size) % batch_size;
+    std::vector<std::pair<size_t, size_t> > runs;
+    for (size_t begin = 0; begin < inst_order_.size();) {
+      const size_t len = (begin == 0 && head != 0) ? head : batch_size;
+      runs.emplace_back(begin, std::min(begin + len, inst_order_.size()));
+      begin = runs.back().second;
+    }
+    if (param_.shuffle != 0 && runs.size() > 1) {
+      // keep the run completing the previous batch first
+      std::shuffle(runs.begin() + (head != 0 ? 1 : 0), runs.end(), rnd_);
+    }
+    std::vector<std::pair<unsigned, unsigned> > order;
+    order.reserve(inst_order_.size());
+    for (const auto& run : runs) {
+      order.insert(order.end(), inst_order_.begin() + run.first,
+                   inst_order_.begin() + run.second);
+    }
+    inst_order_.swap(order);
+  }
+
   // random magic
   static const int kRandMagic = 233;
   // output instance
@@ -572,6 +624,10 @@ class ImageDetRecordIter : public IIterator<DataInst> {
   dmlc::ThreadedIter<std::vector<InstVector<DType>> > iter_;
   // parameters
   ImageDetRecordParam param_;
+  // batch parameters, for aspect_grouping
+  BatchParam batch_param_;
+  // number of instances returned since BeforeFirst
+  size_t num_emitted_{0};
   // random number generator
   common::RANDOM_ENGINE rnd_;
 };
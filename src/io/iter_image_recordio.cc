@@ -86,6 +86,8 @@ inline void ImageRecordIOParser<DType>::Init(
   // initialize parameter
   // init image rec param
   param_.InitAllowUnknown(kwargs);
+  CHECK_EQ(param_.layout, mshadow::kNCHW)
+      << "ImageRecordIter_v1: only the NCHW layout is supported";
   int maxthread, threadget;
   #pragma omp parallel
   {
@@ -33,14 +33,24 @@
 #include <dmlc/omp.h>
 #include <dmlc/common.h>
 #include <dmlc/timer.h>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <string>
 #include <type_traits>
+#include <vector>
 #if MXNET_USE_LIBJPEG_TURBO
 #include <turbojpeg.h>
 #endif
 #include "./image_recordio.h"
 #include "./image_augmenter.h"
+#include "./image_decode_gpu.h"
 #include "./image_iter_common.h"
 #include "./inst_vector.h"
+#include "./iter_prefetcher.h"
+#include "./decoded_image_cache.h"
+#include "./mmap_recordio.h"
+#include "./record_shuffle_buffer.h"
 #include "../common/utils.h"
 
 namespace mxnet {
@@ -56,7 +66,8 @@ class ImageRecordIOParser2 {
   inline void BeforeFirst(void) {
     if (batch_param_.round_batch == 0 || !overflow) {
       n_parsed_ = 0;
-      return source_->BeforeFirst();
+      gpu_pending_.clear();
+      return ResetSource();
     } else {
       overflow = false;
     }
@@ -72,12 +83,28 @@ class ImageRecordIOParser2 {
     mshadow::Tensor<cpu, 3, DType>* data_ptr, const bool is_mirrored, const float contrast_scaled,
     const float illumination_scaled);
 #if MXNET_USE_LIBJPEG_TURBO
-  cv::Mat TJimdecode(cv::Mat buf, int color);
+  cv::Mat TJimdecode(cv::Mat buf, int color, int min_short_side);
 #endif
 #endif
   inline unsigned ParseChunk(DType* data_dptr, real_t* label_dptr, const unsigned current_size,
     dmlc::InputSplit::Blob * chunk);
   inline void CreateMeanImg(void);
+  // rewind the data source to the first record
+  inline void ResetSource(void);
+  // whether records come one batch at a time from mmap_ or shuffle_
+  inline bool RecordBatched(void) const {
+    return mmap_ != nullptr || shuffle_ != nullptr;
+  }
+  // get the records of the next batch from mmap_ or shuffle_
+  inline bool NextRecordBatch(void);
+  // allocate the output batch on ctx
+  inline void InitBatch(DataBatch *out, const Context& ctx);
+  // load the label of a record into label_buf
+  inline void LoadLabel(const ImageRecordIO& rec, std::vector<float>* label_buf);
+#if MXNET_USE_NVJPEG && MXNET_USE_OPENCV
+  // decode a whole batch on the gpu
+  inline bool ParseNextGPU(DataBatch *out);
+#endif
 
   // magic number to seed prng
   static const int kRandMagic = 111;
@@ -91,12 +118,26 @@ class ImageRecordIOParser2 {
   #if MXNET_USE_OPENCV
   /*! \brief augmenters */
   std::vector<std::vector<std::unique_ptr<ImageAugmenter> > > augmenters_;
+  /*! \brief decoded images of earlier epochs, if cache_mem_mb is set */
+  std::unique_ptr<DecodedImageCache> cache_;
   #endif
   /*! \brief random samplers */
   std::vector<std::unique_ptr<common::RANDOM_ENGINE> > prnds_;
   common::RANDOM_ENGINE rnd_;
   /*! \brief data source */
   std::unique_ptr<dmlc::InputSplit> source_;
+  /*! \brief mapped data source, replaces source_ if use_mmap is set */
+  std::unique_ptr<MMapRecordIO> mmap_;
+  /*! \brief order in which mapped records are read */
+  std::vector<size_t> mmap_order_;
+  /*! \brief position of the next batch in mmap_order_ */
+  size_t mmap_pos_;
+  /*! \brief streaming shuffle in front of source_, if shuffle_buffer_size is set */
+  std::unique_ptr<RecordShuffleBuffer> shuffle_;
+  /*! \brief records of the current batch from mmap_ or shuffle_ */
+  std::vector<dmlc::InputSplit::Blob> batch_records_;
+  /*! \brief storage of the records in batch_records_ that need it */
+  std::vector<std::string> batch_buf_;
   /*! \brief label information, if any */
   std::unique_ptr<ImageLabelMap> label_map_;
   /*! \brief temporary results */
@@ -119,6 +160,14 @@ class ImageRecordIOParser2 {
   bool legacy_shuffle_;
   // whether mean image is ready.
   bool meanfile_ready_;
+  /*! \brief records read but not yet put into a gpu decoded batch */
+  std::deque<std::string> gpu_pending_;
+#if MXNET_USE_NVJPEG
+  /*! \brief augmentations done by the gpu decoder */
+  ImageDecodeGPUParam gpu_aug_param_;
+  /*! \brief gpu decoder, if gpu_decode_id is set */
+  std::unique_ptr<ImageDecoderGPU> gpu_decoder_;
+#endif
 };
 
 template<typename DType>
@@ -159,6 +208,35 @@ inline void ImageRecordIOParser2<DType>::Init(
     }
     prnds_.emplace_back(new common::RANDOM_ENGINE((i + 1) * kRandMagic));
   }
+#if !MXNET_USE_LIBJPEG_TURBO
+  if (param_.scaled_decode) {
+    LOG(WARNING) << "scaled_decode needs MXNet built with USE_LIBJPEG_TURBO=1, ignored";
+  }
+#endif
+  if (param_.gpu_decode_id >= 0) {
+    CHECK_EQ(param_.layout, mshadow::kNCHW)
+        << "ImageRecordIOParser2: gpu decoding only supports the NCHW layout";
+#if MXNET_USE_NVJPEG
+    CHECK(param_.data_shape[0] == 1 || param_.data_shape[0] == 3)
+      << "gpu_decode only supports 1 or 3 channels";
+    CHECK_EQ(normalize_param_.mean_img.length(), 0)
+      << "gpu_decode does not support mean_img, use mean_r, mean_g and mean_b";
+    CHECK_LT(prefetch_param_.gpu_prefetch, 0)
+      << "gpu_prefetch cannot be used with gpu_decode_id, the batches are already on the GPU";
+    gpu_aug_param_.InitAllowUnknown(kwargs);
+    gpu_decoder_.reset(new ImageDecoderGPU(param_.gpu_decode_id, param_.data_shape[0],
+                                           param_.preprocess_threads));
+    if (param_.verbose) {
+      LOG(INFO) << "ImageRecordIOParser2: decode on gpu(" << param_.gpu_decode_id
+                << "), only resize, rand_crop, mirror and normalization are applied";
+    }
+#else
+    LOG(FATAL) << "gpu_decode_id needs MXNet built with USE_NVJPEG=1";
+#endif
+  }
+  if (param_.cache_mem_mb > 0 || param_.cache_spill_path.length() != 0) {
+    cache_.reset(new DecodedImageCache(param_.cache_mem_mb << 20UL, param_.cache_spill_path));
+  }
   if (param_.path_imglist.length() != 0) {
     label_map_.reset(new ImageLabelMap(param_.path_imglist.c_str(),
       param_.label_width, !param_.verbose));
@@ -171,7 +249,16 @@ inline void ImageRecordIOParser2<DType>::Init(
               << ", use " << threadget << " threads for decoding..";
   }
   legacy_shuffle_ = false;
-  if (param_.path_imgidx.length() != 0) {
+  if (param_.use_mmap) {
+    CHECK(param_.path_imgidx.length() != 0) << "use_mmap needs path_imgidx";
+    mmap_.reset(new MMapRecordIO(param_.path_imgrec, param_.path_imgidx,
+                                 param_.part_index, param_.num_parts));
+    mmap_order_.resize(mmap_->Size());
+    for (size_t i = 0; i < mmap_order_.size(); ++i) mmap_order_[i] = i;
+    // shuffled reads defeat the kernel's sequential readahead, we issue our own
+    mmap_->SetSequential(!record_param_.shuffle);
+    ResetSource();
+  } else if (param_.path_imgidx.length() != 0) {
     source_.reset(dmlc::InputSplit::Create(
         param_.path_imgrec.c_str(),
         param_.path_imgidx.c_str(),
@@ -212,12 +299,21 @@ inline void ImageRecordIOParser2<DType>::Init(
       // use 64 MB chunk when possible
       source_->HintChunkSize(64 << 20UL);
     }
+    if (record_param_.shuffle && param_.shuffle_buffer_size > 0) {
+      // the buffer shuffles across chunks, no need to shuffle within them
+      legacy_shuffle_ = false;
+      shuffle_.reset(new RecordShuffleBuffer(source_.get(), param_.shuffle_buffer_size,
+                                             kRandMagic + record_param_.seed));
+    }
   }
   // Normalize init
   if (!std::is_same<DType, uint8_t>::value) {
     meanimg_.set_pad(false);
     meanfile_ready_ = false;
     if (normalize_param_.mean_img.length() != 0) {
+      CHECK_EQ(param_.layout, mshadow::kNCHW)
+          << "ImageRecordIOParser2: mean_img needs the NCHW layout, use mean_r, mean_g "
+          << "and mean_b with NHWC";
       std::unique_ptr<dmlc::Stream> fi(
           dmlc::Stream::Create(normalize_param_.mean_img.c_str(), "r", true));
       if (fi.get() == nullptr) {
@@ -254,16 +350,7 @@ inline void ImageRecordIOParser2<DType>::Init(
 }
 
 template<typename DType>
-inline bool ImageRecordIOParser2<DType>::ParseNext(DataBatch *out) {
-  if (overflow) {
-    return false;
-  }
-  CHECK(source_ != nullptr);
-  dmlc::InputSplit::Blob chunk;
-  unsigned current_size = 0;
-  out->index.resize(batch_param_.batch_size);
-
-  // InitBatch
+inline void ImageRecordIOParser2<DType>::InitBatch(DataBatch *out, const Context& ctx) {
   if (out->data.size() == 0) {
     // This assumes that DataInst given by
     // InstVector contains only 2 elements in
@@ -273,8 +360,14 @@ inline bool ImageRecordIOParser2<DType>::ParseNext(DataBatch *out) {
 
     std::vector<index_t> shape_vec;
     shape_vec.push_back(batch_param_.batch_size);
-    for (index_t dim = 0; dim < param_.data_shape.ndim(); ++dim) {
-      shape_vec.push_back(param_.data_shape[dim]);
+    if (param_.layout == mshadow::kNHWC) {
+      shape_vec.push_back(param_.data_shape[1]);
+      shape_vec.push_back(param_.data_shape[2]);
+      shape_vec.push_back(param_.data_shape[0]);
+    } else {
+      for (index_t dim = 0; dim < param_.data_shape.ndim(); ++dim) {
+        shape_vec.push_back(param_.data_shape[dim]);
+      }
     }
     TShape data_shape(shape_vec.begin(), shape_vec.end());
 
@@ -283,24 +376,67 @@ inline bool ImageRecordIOParser2<DType>::ParseNext(DataBatch *out) {
     shape_vec.push_back(param_.label_width);
     TShape label_shape(shape_vec.begin(), shape_vec.end());
 
-    out->data.at(0) = NDArray(data_shape, Context::CPUPinned(0), false,
+    out->data.at(0) = NDArray(data_shape, ctx, false,
       mshadow::DataType<DType>::kFlag);
-    out->data.at(1) = NDArray(label_shape, Context::CPUPinned(0), false,
+    out->data.at(1) = NDArray(label_shape, ctx, false,
       mshadow::DataType<real_t>::kFlag);
     unit_size_[0] = param_.data_shape.Size();
     unit_size_[1] = param_.label_width;
   }
 
+}
+
+template<typename DType>
+inline void ImageRecordIOParser2<DType>::LoadLabel(const ImageRecordIO& rec,
+                                                   std::vector<float>* label_buf) {
+  if (label_map_ != nullptr) {
+    *label_buf = label_map_->FindCopy(rec.image_index());
+  } else if (rec.label != NULL) {
+    CHECK_EQ(param_.label_width, rec.num_label)
+      << "rec file provide " << rec.num_label << "-dimensional label "
+         "but label_width is set to " << param_.label_width;
+    label_buf->assign(rec.label, rec.label + rec.num_label);
+  } else {
+    CHECK_EQ(param_.label_width, 1)
+      << "label_width must be 1 unless an imglist is provided "
+         "or the rec file is packed with multi dimensional label";
+    label_buf->assign(&rec.header.label, &rec.header.label + 1);
+  }
+}
+
+template<typename DType>
+inline bool ImageRecordIOParser2<DType>::ParseNext(DataBatch *out) {
+#if MXNET_USE_NVJPEG && MXNET_USE_OPENCV
+  if (gpu_decoder_ != nullptr) {
+    return ParseNextGPU(out);
+  }
+#endif
+  if (overflow) {
+    return false;
+  }
+  CHECK(source_ != nullptr || mmap_ != nullptr);
+  dmlc::InputSplit::Blob chunk;
+  unsigned current_size = 0;
+  out->index.resize(batch_param_.batch_size);
+
+  Context ctx = Context::CPUPinned(std::max(prefetch_param_.gpu_prefetch, 0));
+  if (prefetch_param_.shared_memory) ctx = Context::CPUShared(0);
+  InitBatch(out, ctx);
+
   while (current_size < batch_param_.batch_size) {
     // int n_to_copy;
     unsigned n_to_out = 0;
     if (n_parsed_ == 0) {
-      if (source_->NextBatch(&chunk, batch_param_.batch_size)) {
+      const bool has_data = RecordBatched() ?
+          NextRecordBatch() : source_->NextBatch(&chunk, batch_param_.batch_size);
+      if (has_data) {
         inst_order_.clear();
         inst_index_ = 0;
         DType* data_dptr = static_cast<DType*>(out->data[0].data().dptr_);
         real_t* label_dptr = static_cast<real_t*>(out->data[1].data().dptr_);
-        if (!legacy_shuffle_) {
+        if (RecordBatched()) {
+          n_to_out = ParseChunk(data_dptr, label_dptr, current_size, nullptr);
+        } else if (!legacy_shuffle_) {
           n_to_out = ParseChunk(data_dptr, label_dptr, current_size, &chunk);
         } else {
           n_to_out = ParseChunk(NULL, NULL, batch_param_.batch_size, &chunk);
@@ -318,7 +454,7 @@ inline bool ImageRecordIOParser2<DType>::ParseNext(DataBatch *out) {
         CHECK(!overflow) << "number of input images must be bigger than the batch size";
         if (batch_param_.round_batch != 0) {
           overflow = true;
-          source_->BeforeFirst();
+          ResetSource();
         } else {
           current_size = batch_param_.batch_size;
         }
@@ -352,75 +488,207 @@ inline bool ImageRecordIOParser2<DType>::ParseNext(DataBatch *out) {
   return true;
 }
 
+#if MXNET_USE_NVJPEG && MXNET_USE_OPENCV
+template<typename DType>
+inline bool ImageRecordIOParser2<DType>::ParseNextGPU(DataBatch *out) {
+  if (overflow) {
+    return false;
+  }
+  CHECK(source_ != nullptr || mmap_ != nullptr);
+  const unsigned batch_size = batch_param_.batch_size;
+  out->index.resize(batch_size);
+  InitBatch(out, Context::GPU(param_.gpu_decode_id));
+  // collect the raw records of one batch
+  std::vector<std::string> records;
+  records.reserve(batch_size);
+  out->num_batch_padd = 0;
+  while (records.size() < batch_size) {
+    if (!gpu_pending_.empty()) {
+      records.emplace_back(std::move(gpu_pending_.front()));
+      gpu_pending_.pop_front();
+      continue;
+    }
+    dmlc::InputSplit::Blob chunk;
+    if (RecordBatched() && NextRecordBatch()) {
+      for (const auto& blob : batch_records_) {
+        gpu_pending_.emplace_back(static_cast<char*>(blob.dptr), blob.size);
+      }
+    } else if (!RecordBatched() && source_->NextBatch(&chunk, batch_size)) {
+      dmlc::RecordIOChunkReader reader(chunk, 0, 1);
+      dmlc::InputSplit::Blob blob;
+      while (reader.NextRecord(&blob)) {
+        gpu_pending_.emplace_back(static_cast<char*>(blob.dptr), blob.size);
+      }
+      if (legacy_shuffle_) {
+        std::shuffle(gpu_pending_.begin(), gpu_pending_.end(), rnd_);
+      }
+    } else {
+      if (records.empty()) {
+        return false;
+      }
+      CHECK(!overflow) << "number of input images must be bigger than the batch size";
+      out->num_batch_padd = batch_size - records.size();
+      if (batch_param_.round_batch != 0) {
+        overflow = true;
+        ResetSource();
+      } else {
+        break;
+      }
+    }
+  }
+  // read headers and labels and pick crop windows on the host
+  const int n = static_cast<int>(records.size());
+  const int channels = param_.data_shape[0];
+  const int out_h = param_.data_shape[1];
+  const int out_w = param_.data_shape[2];
+  std::vector<std::string> images(n);
+  std::vector<GPUImageDesc> descs(n);
+  std::vector<real_t> labels(batch_size * param_.label_width, 0.0f);
+  #pragma omp parallel for num_threads(param_.preprocess_threads)
+  for (int i = 0; i < n; ++i) {
+    common::RANDOM_ENGINE* prnd = prnds_[omp_get_thread_num()].get();
+    ImageRecordIO rec;
+    rec.Load(&records[i][0], records[i].size());
+    std::vector<float> label_buf;
+    LoadLabel(rec, &label_buf);
+    std::copy(label_buf.begin(), label_buf.end(), labels.begin() + i * param_.label_width);
+    out->index[i] = rec.image_index();
+    images[i].assign(reinterpret_cast<char*>(rec.content), rec.content_size);
+    GPUImageDesc& d = descs[i];
+    d.raw = 0;
+    if (!gpu_decoder_->GetImageInfo(images[i], &d.height, &d.width)) {
+      // not something nvJPEG can decode, decode it here and upload the pixels
+      cv::Mat buf(1, rec.content_size, CV_8U, rec.content);
+      cv::Mat res = cv::imdecode(buf, channels == 1 ? 0 : 1);
+      CHECK(!res.empty()) << "Failed to decode image with index " << rec.image_index();
+      if (channels == 3) cv::cvtColor(res, res, cv::COLOR_BGR2RGB);
+      if (!res.isContinuous()) res = res.clone();
+      images[i].assign(reinterpret_cast<char*>(res.data), res.total() * res.elemSize());
+      d.height = res.rows;
+      d.width = res.cols;
+      d.raw = 1;
+    }
+    // resize the shorter edge, then crop data_shape out of it
+    const float scale = gpu_aug_param_.resize > 0 ?
+        static_cast<float>(gpu_aug_param_.resize) / std::min(d.height, d.width) : 1.0f;
+    d.crop_w = std::min(out_w / scale, static_cast<float>(d.width));
+    d.crop_h = std::min(out_h / scale, static_cast<float>(d.height));
+    if (gpu_aug_param_.rand_crop) {
+      std::uniform_real_distribution<float> rand_x(0, d.width - d.crop_w);
+      std::uniform_real_distribution<float> rand_y(0, d.height - d.crop_h);
+      d.x0 = rand_x(*prnd);
+      d.y0 = rand_y(*prnd);
+    } else {
+      d.x0 = (d.width - d.crop_w) / 2;
+      d.y0 = (d.height - d.crop_h) / 2;
+    }
+    std::uniform_real_distribution<float> rand_uniform(0, 1);
+    std::bernoulli_distribution coin_flip(0.5);
+    d.mirror = (normalize_param_.rand_mirror && coin_flip(*prnd)) || normalize_param_.mirror;
+    d.contrast = 1;
+    d.illumination = 0;
+    if (!std::is_same<DType, uint8_t>::value) {
+      d.contrast =
+        (rand_uniform(*prnd) * normalize_param_.max_random_contrast * 2
+        - normalize_param_.max_random_contrast + 1) * normalize_param_.scale;
+      d.illumination =
+        (rand_uniform(*prnd) * normalize_param_.max_random_illumination * 2
+        - normalize_param_.max_random_illumination) * normalize_param_.scale;
+    }
+  }
+  GPUNormalize norm;
+  norm.enabled = !std::is_same<DType, uint8_t>::value;
+  const float mean[4] = {normalize_param_.mean_r, normalize_param_.mean_g,
+                         normalize_param_.mean_b, normalize_param_.mean_a};
+  const float stdev[4] = {normalize_param_.std_r, normalize_param_.std_g,
+                          normalize_param_.std_b, normalize_param_.std_a};
+  std::copy(mean, mean + 4, norm.mean);
+  std::copy(stdev, stdev + 4, norm.std);
+  gpu_decoder_->Decode(images, &descs, norm, out_h, out_w,
+                       static_cast<DType*>(out->data[0].data().dptr_));
+  out->data[1].SyncCopyFromCPU(labels.data(), labels.size());
+  return true;
+}
+#endif  // MXNET_USE_NVJPEG && MXNET_USE_OPENCV
+
 #if MXNET_USE_OPENCV
+/*! \brief convert a normalized pixel to the output type */
+template<typename DType>
+inline DType PixelCast(float v) {
+  return static_cast<DType>(v);
+}
+/*! \brief int8 output is the normalized value rounded and saturated */
+template<>
+inline int8_t PixelCast<int8_t>(float v) {
+  return static_cast<int8_t>(std::min(std::max(std::nearbyint(v), -128.0f), 127.0f));
+}
+
 template<typename DType>
 template<int n_channels>
 void ImageRecordIOParser2<DType>::ProcessImage(const cv::Mat& res,
   mshadow::Tensor<cpu, 3, DType>* data_ptr, const bool is_mirrored, const float contrast_scaled,
   const float illumination_scaled) {
-  float RGBA_MULT[4] = { 0 };
-  float RGBA_BIAS[4] = { 0 };
-  float RGBA_MEAN[4] = { 0 };
   mshadow::Tensor<cpu, 3, DType>& data = (*data_ptr);
-  if (!std::is_same<DType, uint8_t>::value) {
-    RGBA_MULT[0] = contrast_scaled / normalize_param_.std_r;
-    RGBA_MULT[1] = contrast_scaled / normalize_param_.std_g;
-    RGBA_MULT[2] = contrast_scaled / normalize_param_.std_b;
-    RGBA_MULT[3] = contrast_scaled / normalize_param_.std_a;
-    RGBA_BIAS[0] = illumination_scaled / normalize_param_.std_r;
-    RGBA_BIAS[1] = illumination_scaled / normalize_param_.std_g;
-    RGBA_BIAS[2] = illumination_scaled / normalize_param_.std_b;
-    RGBA_BIAS[3] = illumination_scaled / normalize_param_.std_a;
-    if (!meanfile_ready_) {
-      RGBA_MEAN[0] = normalize_param_.mean_r;
-      RGBA_MEAN[1] = normalize_param_.mean_g;
-      RGBA_MEAN[2] = normalize_param_.mean_b;
-      RGBA_MEAN[3] = normalize_param_.mean_a;
-    }
-  }
-
-  int swap_indices[n_channels]; // NOLINT(*)
-  if (n_channels == 1) {
-    swap_indices[0] = 0;
-  } else if (n_channels == 3) {
-    swap_indices[0] = 2;
-    swap_indices[1] = 1;
-    swap_indices[2] = 0;
-  } else if (n_channels == 4) {
-    swap_indices[0] = 2;
-    swap_indices[1] = 1;
-    swap_indices[2] = 0;
-    swap_indices[3] = 3;
+  // logic from iter_normalize.h, function SetOutImg, folded into
+  // out = in * mult + bias, or out = (in - meanimg) * mult + bias
+  const bool normalize = !std::is_same<DType, uint8_t>::value;
+  const bool use_meanimg = normalize && meanfile_ready_;
+  const float mean[4] = {normalize_param_.mean_r, normalize_param_.mean_g,
+                         normalize_param_.mean_b, normalize_param_.mean_a};
+  const float stdev[4] = {normalize_param_.std_r, normalize_param_.std_g,
+                          normalize_param_.std_b, normalize_param_.std_a};
+  float mult[n_channels], bias[n_channels];  // NOLINT(*)
+  for (int k = 0; k < n_channels; ++k) {
+    mult[k] = normalize ? contrast_scaled / stdev[k] : 1.0f;
+    bias[k] = normalize ? illumination_scaled / stdev[k] : 0.0f;
+    if (normalize && !use_meanimg) bias[k] -= mean[k] * mult[k];
   }
+  // For RGB or RGBA data, swap the B and R channel:
+  // OpenCV store as BGR (or BGRA) and we want RGB (or RGBA)
+  const int swap_indices[4] = {n_channels == 1 ? 0 : 2, 1, 0, 3};
+  // data is (h, w, c) for the NHWC layout, the pixels of a row are written
+  // with a stride of n_channels then
+  const bool channel_last = param_.layout == mshadow::kNHWC;
 
-  DType RGBA[n_channels] = {};
+  // one pass per output row and channel over contiguous memory, with every
+  // branch hoisted out of the pixel loops so that the compiler vectorizes them
+  const int cols = res.cols;
+  std::vector<float> row(cols);
+  float* row_data = row.data();
   for (int i = 0; i < res.rows; ++i) {
     const uchar* im_data = res.ptr<uchar>(i);
-    for (int j = 0; j < res.cols; ++j) {
-      for (int k = 0; k < n_channels; ++k) {
-        RGBA[k] = im_data[swap_indices[k]];
+    for (int k = 0; k < n_channels; ++k) {
+      const uchar* src = im_data + swap_indices[k];
+      const float m = mult[k];
+      const float b = bias[k];
+      if (use_meanimg) {
+        const float* mean_row = meanimg_[k][i].dptr_;
+        for (int j = 0; j < cols; ++j) {
+          row_data[j] = (src[j * n_channels] - mean_row[j]) * m + b;
+        }
+      } else {
+        for (int j = 0; j < cols; ++j) {
+          row_data[j] = src[j * n_channels] * m + b;
+        }
       }
-      if (!std::is_same<DType, uint8_t>::value) {
-        // normalize/mirror here to avoid memory copies
-        // logic from iter_normalize.h, function SetOutImg
-        for (int k = 0; k < n_channels; ++k) {
-          if (meanfile_ready_) {
-            RGBA[k] = (RGBA[k] - meanimg_[k][i][j]) * RGBA_MULT[k] + RGBA_BIAS[k];
-          } else {
-            RGBA[k] = (RGBA[k] - RGBA_MEAN[k]) * RGBA_MULT[k] + RGBA_BIAS[k];
-          }
+      // mirror here to avoid memory copies
+      if (channel_last) {
+        DType* out = data[i].dptr_ + k;
+        for (int j = 0; j < cols; ++j) {
+          out[(is_mirrored ? cols - 1 - j : j) * n_channels] = PixelCast<DType>(row_data[j]);
         }
+        continue;
       }
-      for (int k = 0; k < n_channels; ++k) {
-        // mirror here to avoid memory copies
-        // logic from iter_normalize.h, function SetOutImg
-        if (is_mirrored) {
-          data[k][i][res.cols - j - 1] = RGBA[k];
-        } else {
-          data[k][i][j] = RGBA[k];
+      DType* out = data[k][i].dptr_;
+      if (is_mirrored) {
+        for (int j = 0; j < cols; ++j) {
+          out[cols - 1 - j] = PixelCast<DType>(row_data[j]);
+        }
+      } else {
+        for (int j = 0; j < cols; ++j) {
+          out[j] = PixelCast<DType>(row_data[j]);
         }
       }
-      im_data += n_channels;
     }
   }
 }
@@ -435,8 +703,10 @@ bool is_jpeg(unsigned char * file) {
   }
 }
 
+// min_short_side > 0 lets libjpeg-turbo skip DCT coefficients and decode
+// directly at the smallest scale whose shorter edge is still that long
 template<typename DType>
-cv::Mat ImageRecordIOParser2<DType>::TJimdecode(cv::Mat image, int color) {
+cv::Mat ImageRecordIOParser2<DType>::TJimdecode(cv::Mat image, int color, int min_short_side) {
   unsigned char* jpeg = image.ptr();
   size_t jpeg_size = image.rows * image.cols;
 
@@ -453,8 +723,24 @@ cv::Mat ImageRecordIOParser2<DType>::TJimdecode(cv::Mat image, int color) {
                                 &w, &h, &subsamp);
   if (err != 0) {
     // If it is a malformed JPEG then fall back to OpenCV
+    tjDestroy(handle);
     return cv::imdecode(image, color);
   }
+  if (min_short_side > 0) {
+    int num_factors = 0;
+    const tjscalingfactor* factors = tjGetScalingFactors(&num_factors);
+    int best_w = w, best_h = h;
+    for (int i = 0; i < num_factors; ++i) {
+      const int sw = TJSCALED(w, factors[i]);
+      const int sh = TJSCALED(h, factors[i]);
+      if (std::min(sw, sh) >= min_short_side && sw * sh < best_w * best_h) {
+        best_w = sw;
+        best_h = sh;
+      }
+    }
+    w = best_w;
+    h = best_h;
+  }
   cv::Mat ret = cv::Mat(h, w, color ? CV_8UC3 : CV_8UC1);
   err = tjDecompress2(handle,
                       jpeg,
@@ -465,24 +751,73 @@ cv::Mat ImageRecordIOParser2<DType>::TJimdecode(cv::Mat image, int color) {
                       h,
                       color ? TJPF_BGR : TJPF_GRAY,
                       0);
+  tjDestroy(handle);
   if (err != 0) {
     // If it is a malformed JPEG then fall back to OpenCV
     return cv::imdecode(image, color);
   }
-  tjDestroy(handle);
   return ret;
 }
 #endif
 #endif
 
-// Returns the number of images that are put into output
+template<typename DType>
+inline void ImageRecordIOParser2<DType>::ResetSource(void) {
+  if (shuffle_ != nullptr) {
+    shuffle_->BeforeFirst();
+    return;
+  }
+  if (mmap_ == nullptr) {
+    source_->BeforeFirst();
+    return;
+  }
+  mmap_pos_ = 0;
+  if (record_param_.shuffle) {
+    std::shuffle(mmap_order_.begin(), mmap_order_.end(), rnd_);
+  }
+  const size_t end = std::min(mmap_order_.size(), static_cast<size_t>(batch_param_.batch_size));
+  for (size_t i = 0; i < end; ++i) mmap_->WillNeed(mmap_order_[i]);
+}
+
+template<typename DType>
+inline bool ImageRecordIOParser2<DType>::NextRecordBatch(void) {
+  const size_t batch_size = batch_param_.batch_size;
+  if (shuffle_ != nullptr) {
+    batch_buf_.resize(batch_size);
+    batch_records_.clear();
+    for (size_t i = 0; i < batch_size && shuffle_->Next(&batch_buf_[i]); ++i) {
+      dmlc::InputSplit::Blob blob;
+      blob.dptr = &batch_buf_[i][0];
+      blob.size = batch_buf_[i].size();
+      batch_records_.push_back(blob);
+    }
+    return !batch_records_.empty();
+  }
+  if (mmap_pos_ >= mmap_order_.size()) return false;
+  const size_t n = std::min(batch_size, mmap_order_.size() - mmap_pos_);
+  batch_records_.resize(n);
+  batch_buf_.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    batch_records_[i] = mmap_->Record(mmap_order_[mmap_pos_ + i], &batch_buf_[i]);
+  }
+  mmap_pos_ += n;
+  // let the kernel read the next batch while this one is decoded
+  const size_t end = std::min(mmap_order_.size(), mmap_pos_ + batch_size);
+  for (size_t i = mmap_pos_; i < end; ++i) mmap_->WillNeed(mmap_order_[i]);
+  return true;
+}
+
+// Returns the number of images that are put into output.
+// A null chunk parses the records of the current mapped batch.
 template<typename DType>
 inline unsigned ImageRecordIOParser2<DType>::ParseChunk(DType* data_dptr, real_t* label_dptr,
   const unsigned current_size, dmlc::InputSplit::Blob * chunk) {
   temp_.resize(param_.preprocess_threads);
 #if MXNET_USE_OPENCV
   // save opencv out
-  dmlc::RecordIOChunkReader reader(*chunk, 0, 1);
+  std::unique_ptr<dmlc::RecordIOChunkReader> reader;
+  if (chunk != nullptr) reader.reset(new dmlc::RecordIOChunkReader(*chunk, 0, 1));
+  size_t batch_next = 0;
   unsigned gl_idx = current_size;
   #pragma omp parallel num_threads(param_.preprocess_threads)
   {
@@ -499,7 +834,12 @@ inline unsigned ImageRecordIOParser2<DType>::ParseChunk(DType* data_dptr, real_t
       unsigned idx;
       #pragma omp critical
       {
-        reader_has_data = reader.NextRecord(&blob);
+        if (reader != nullptr) {
+          reader_has_data = reader->NextRecord(&blob);
+        } else {
+          reader_has_data = batch_next < batch_records_.size();
+          if (reader_has_data) blob = batch_records_[batch_next++];
+        }
         if (reader_has_data) {
           idx = gl_idx++;
           if (idx >= batch_param_.batch_size) {
@@ -512,57 +852,62 @@ inline unsigned ImageRecordIOParser2<DType>::ParseChunk(DType* data_dptr, real_t
       cv::Mat res;
       rec.Load(blob.dptr, blob.size);
       cv::Mat buf(1, rec.content_size, CV_8U, rec.content);
-      switch (param_.data_shape[0]) {
-       case 1:
+      const bool cached = cache_ != nullptr && cache_->Get(rec.image_index(), &res);
+      if (!cached) {
 #if MXNET_USE_LIBJPEG_TURBO
-        res = TJimdecode(buf, 0);
+        const int min_short_side = param_.scaled_decode && !augmenters_[tid].empty() ?
+            augmenters_[tid][0]->MinDecodeShortSide() : -1;
+#endif
+        switch (param_.data_shape[0]) {
+         case 1:
+#if MXNET_USE_LIBJPEG_TURBO
+          res = TJimdecode(buf, 0, min_short_side);
 #else
-        res = cv::imdecode(buf, 0);
+          res = cv::imdecode(buf, 0);
 #endif
-        break;
-       case 3:
+          break;
+         case 3:
 #if MXNET_USE_LIBJPEG_TURBO
-        res = TJimdecode(buf, 1);
+          res = TJimdecode(buf, 1, min_short_side);
 #else
-        res = cv::imdecode(buf, 1);
+          res = cv::imdecode(buf, 1);
 #endif
-        break;
-       case 4:
-        // -1 to keep the number of channel of the encoded image, and not force gray or color.
-        res = cv::imdecode(buf, -1);
-        CHECK_EQ(res.channels(), 4)
-          << "Invalid image with index " << rec.image_index()
-          << ". Expected 4 channels, got " << res.channels();
-        break;
-       default:
-        LOG(FATAL) << "Invalid output shape " << param_.data_shape;
+          break;
+         case 4:
+          // -1 to keep the number of channel of the encoded image, not force gray or color.
+          res = cv::imdecode(buf, -1);
+          CHECK_EQ(res.channels(), 4)
+            << "Invalid image with index " << rec.image_index()
+            << ". Expected 4 channels, got " << res.channels();
+          break;
+         default:
+          LOG(FATAL) << "Invalid output shape " << param_.data_shape;
+        }
+        if (cache_ != nullptr) {
+          if (param_.cache_resize > 0 && std::min(res.rows, res.cols) > param_.cache_resize) {
+            // shrink the shorter edge before caching to fit more images
+            const double scale = static_cast<double>(param_.cache_resize) /
+                                 std::min(res.rows, res.cols);
+            cv::resize(res, res, cv::Size(), scale, scale, cv::INTER_AREA);
+          }
+          cache_->Put(rec.image_index(), res);
+        }
       }
       const int n_channels = res.channels();
       // load label before augmentations
       std::vector<float> label_buf;
-      if (label_map_ != nullptr) {
-        label_buf = label_map_->FindCopy(rec.image_index());
-      } else if (rec.label != NULL) {
-        CHECK_EQ(param_.label_width, rec.num_label)
-          << "rec file provide " << rec.num_label << "-dimensional label "
-             "but label_width is set to " << param_.label_width;
-        label_buf.assign(rec.label, rec.label + rec.num_label);
-      } else {
-        CHECK_EQ(param_.label_width, 1)
-          << "label_width must be 1 unless an imglist is provided "
-             "or the rec file is packed with multi dimensional label";
-        label_buf.assign(&rec.header.label, &rec.header.label + 1);
-      }
+      LoadLabel(rec, &label_buf);
       for (auto& aug : augmenters_[tid]) {
         res = aug->Process(res, &label_buf, prnds_[tid].get());
       }
+      const mshadow::Shape<3> dshape = param_.layout == mshadow::kNHWC ?
+          mshadow::Shape3(res.rows, res.cols, n_channels) :
+          mshadow::Shape3(n_channels, res.rows, res.cols);
       mshadow::Tensor<cpu, 3, DType> data;
       if (idx < batch_param_.batch_size) {
-        data = mshadow::Tensor<cpu, 3, DType>(data_dptr + idx*unit_size_[0],
-          mshadow::Shape3(n_channels, res.rows, res.cols));
+        data = mshadow::Tensor<cpu, 3, DType>(data_dptr + idx*unit_size_[0], dshape);
       } else {
-        out_tmp.Push(static_cast<unsigned>(rec.image_index()),
-                 mshadow::Shape3(n_channels, res.rows, res.cols),
+        out_tmp.Push(static_cast<unsigned>(rec.image_index()), dshape,
                  mshadow::Shape1(param_.label_width));
         data = out_tmp.data().Back();
       }
@@ -581,8 +926,6 @@ inline unsigned ImageRecordIOParser2<DType>::ParseChunk(DType* data_dptr, real_t
           (rand_uniform(*(prnds_[tid])) * normalize_param_.max_random_illumination * 2
           - normalize_param_.max_random_illumination) * normalize_param_.scale;
       }
-      // For RGB or RGBA data, swap the B and R channel:
-      // OpenCV store as BGR (or BGRA) and we want RGB (or RGBA)
       if (n_channels == 1) {
         ProcessImage<1>(res, &data, is_mirrored, contrast_scaled, illumination_scaled);
       } else if (n_channels == 3) {
@@ -614,6 +957,9 @@ inline unsigned ImageRecordIOParser2<DType>::ParseChunk(DType* data_dptr, real_t
 // create mean image.
 template<typename DType>
 inline void ImageRecordIOParser2<DType>::CreateMeanImg(void) {
+  CHECK((std::is_same<DType, real_t>::value))
+    << "The mean image " << normalize_param_.mean_img << " does not exist, "
+    << "create it with ImageRecordIter first";
     if (param_.verbose) {
       LOG(INFO) << "Cannot find " << normalize_param_.mean_img
                 << ": create mean image, this will take some time...";
@@ -621,10 +967,10 @@ inline void ImageRecordIOParser2<DType>::CreateMeanImg(void) {
     double start = dmlc::GetTime();
     dmlc::InputSplit::Blob chunk;
     size_t imcnt = 0;  // NOLINT(*)
-    while (source_->NextChunk(&chunk)) {
+    while (RecordBatched() ? NextRecordBatch() : source_->NextChunk(&chunk)) {
       inst_order_.clear();
       // Parse chunk w/o putting anything in out
-      ParseChunk(NULL, NULL, batch_param_.batch_size, &chunk);
+      ParseChunk(NULL, NULL, batch_param_.batch_size, RecordBatched() ? nullptr : &chunk);
       for (unsigned i = 0; i < inst_order_.size(); ++i) {
         std::pair<unsigned, unsigned> place = inst_order_[i];
         mshadow::Tensor<cpu, 3> outimg =
@@ -671,6 +1017,7 @@ class ImageRecordIter2 : public IIterator<DataBatch> {
     virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
       prefetch_param_.InitAllowUnknown(kwargs);
       parser_.Init(kwargs);
+      device_.reset(DevicePrefetcher::Create(prefetch_param_));
       // maximum prefetch threaded iter internal size
       const int kMaxPrefetchBuffer = 16;
       // init thread iter
@@ -680,7 +1027,9 @@ class ImageRecordIter2 : public IIterator<DataBatch> {
           if (*dptr == nullptr) {
             *dptr = new DataBatch();
           }
-          return parser_.ParseNext(*dptr);
+          if (!parser_.ParseNext(*dptr)) return false;
+          if (device_ != nullptr) device_->Copy(**dptr);
+          return true;
           },
           [this]() { parser_.BeforeFirst(); });
     }
@@ -708,7 +1057,7 @@ class ImageRecordIter2 : public IIterator<DataBatch> {
     }
 
     virtual const DataBatch &Value(void) const {
-      return *out_;
+      return device_ != nullptr ? device_->Get(out_) : *out_;
     }
 
  private:
@@ -716,6 +1065,8 @@ class ImageRecordIter2 : public IIterator<DataBatch> {
     dmlc::ThreadedIter<DataBatch> iter_;
     /*! \brief Parameters */
     PrefetcherParam prefetch_param_;
+    /*! \brief device copies of the batches, if gpu_prefetch is set */
+    std::unique_ptr<DevicePrefetcher> device_;
     /*! \brief output data */
     DataBatch *out_;
     /*! \brief queue to be recycled */
@@ -774,5 +1125,24 @@ the data type instead of ``float``.
 .set_body([]() {
     return new ImageRecordIter2<uint8_t>();
   });
+
+MXNET_REGISTER_IO_ITER(ImageRecordInt8Iter)
+.describe(R"code(Iterating on image RecordIO files
+
+This iterator is identical to ``ImageRecordIter`` except for using ``int8`` as
+the data type instead of ``float``, for the input of quantized networks. The
+normalized values are rounded and saturated to [-128, 127], ``scale`` and the
+mean and std arguments should map the pixels to the quantized data range.
+
+)code" ADD_FILELINE)
+.add_arguments(ImageRecParserParam::__FIELDS__())
+.add_arguments(ImageRecordParam::__FIELDS__())
+.add_arguments(BatchParam::__FIELDS__())
+.add_arguments(PrefetcherParam::__FIELDS__())
+.add_arguments(ListDefaultAugParams())
+.add_arguments(ImageNormalizeParam::__FIELDS__())
+.set_body([]() {
+    return new ImageRecordIter2<int8_t>();
+  });
 }  // namespace io
 }  // namespace mxnet
@@ -26,6 +26,7 @@
 #include <dmlc/logging.h>
 #include <dmlc/parameter.h>
 #include <dmlc/data.h>
+#include "./parallel_text_parser.h"
 #include "./iter_sparse_prefetcher.h"
 #include "./iter_sparse_batchloader.h"
 
@@ -45,6 +46,8 @@ struct LibSVMIterParam : public dmlc::Parameter<LibSVMIterParam> {
   int num_parts;
   /*! \brief the index of the part will read*/
   int part_index;
+  /*! \brief number of threads parsing each chunk */
+  int preprocess_threads;
   // declare parameters
   DMLC_DECLARE_PARAMETER(LibSVMIterParam) {
     DMLC_DECLARE_FIELD(data_libsvm)
@@ -61,6 +64,8 @@ struct LibSVMIterParam : public dmlc::Parameter<LibSVMIterParam> {
         .describe("partition the data into multiple parts");
     DMLC_DECLARE_FIELD(part_index).set_default(0)
         .describe("the index of the part will read");
+    DMLC_DECLARE_FIELD(preprocess_threads).set_lower_bound(1).set_default(4)
+        .describe("The number of threads to parse each chunk of the input with.");
   }
 };
 
@@ -75,13 +80,13 @@ class LibSVMIter: public SparseIIterator<DataInst> {
     CHECK_EQ(param_.data_shape.ndim(), 1) << "dimension of data_shape is expected to be 1";
     CHECK_GT(param_.num_parts, 0) << "number of parts should be positive";
     CHECK_GE(param_.part_index, 0) << "part index should be non-negative";
-    data_parser_.reset(dmlc::Parser<uint64_t>::Create(param_.data_libsvm.c_str(),
-                                                      param_.part_index,
-                                                      param_.num_parts, "libsvm"));
+    data_parser_.reset(new ParallelTextParser<uint64_t>(param_.data_libsvm,
+                                                        param_.part_index, param_.num_parts,
+                                                        "libsvm", param_.preprocess_threads));
     if (param_.label_libsvm != "NULL") {
-      label_parser_.reset(dmlc::Parser<uint64_t>::Create(param_.label_libsvm.c_str(),
-                                                         param_.part_index,
-                                                         param_.num_parts, "libsvm"));
+      label_parser_.reset(new ParallelTextParser<uint64_t>(param_.label_libsvm,
+                                                           param_.part_index, param_.num_parts,
+                                                           "libsvm", param_.preprocess_threads));
       CHECK_GT(param_.label_shape.Size(), 1)
         << "label_shape is not expected to be (1,) when param_.label_libsvm is set.";
     } else {
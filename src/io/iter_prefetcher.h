@@ -38,11 +38,74 @@
 #include <vector>
 #include <queue>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "./inst_vector.h"
 #include "./image_iter_common.h"
 
 namespace mxnet {
 namespace io {
+/*!
+ * \brief GPU copies of the batches of a prefetching iterator.
+ *
+ *  The prefetch thread pushes the copy of every batch as soon as it is
+ *  filled. CopyFromTo runs it as a kCopyToGPU engine op on the copy stream,
+ *  so batch N+1 moves to the device while batch N is computed. The CPU
+ *  batches should be in pinned memory for the copies to be asynchronous.
+ *  A device batch is reused once its CPU batch is recycled, the engine
+ *  orders the next copy after the reads of the previous one.
+ */
+class DevicePrefetcher {
+ public:
+  explicit DevicePrefetcher(int dev_id) : ctx_(Context::GPU(dev_id)) {}
+  /*! \brief push the copy of a filled CPU batch, called by the prefetch thread */
+  void Copy(const DataBatch& src) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DataBatch& dst = batches_[&src];
+    if (dst.data.size() != src.data.size()) {
+      dst.data.clear();
+      for (const NDArray& arr : src.data) {
+        dst.data.emplace_back(arr.shape(), ctx_, false, arr.dtype());
+      }
+    }
+    for (size_t i = 0; i < src.data.size(); ++i) {
+      CHECK_EQ(dst.data[i].shape(), src.data[i].shape());
+      CopyFromTo(src.data[i], &dst.data[i]);
+    }
+    dst.index = src.index;
+    dst.extra_data = src.extra_data;
+    dst.num_batch_padd = src.num_batch_padd;
+  }
+  /*! \brief the device batch of a CPU batch given to Copy */
+  const DataBatch& Get(const DataBatch* src) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = batches_.find(src);
+    CHECK(it != batches_.end());
+    return it->second;
+  }
+  /*! \brief context to stage the CPU batches in */
+  Context StagingContext() const {
+    return Context::CPUPinned(ctx_.dev_id);
+  }
+  /*! \brief check the prefetch options and create the prefetcher if asked for */
+  static DevicePrefetcher* Create(const PrefetcherParam& param) {
+    if (param.gpu_prefetch < 0) return nullptr;
+    CHECK(!param.shared_memory) << "gpu_prefetch cannot be used with shared_memory";
+#if MXNET_USE_CUDA
+    return new DevicePrefetcher(param.gpu_prefetch);
+#else
+    LOG(FATAL) << "gpu_prefetch requires MXNet built with CUDA";
+    return nullptr;
+#endif  // MXNET_USE_CUDA
+  }
+
+ private:
+  Context ctx_;
+  mutable std::mutex mutex_;
+  std::unordered_map<const DataBatch*, DataBatch> batches_;
+};
+
 // iterator on image recordio
 class PrefetcherIter : public IIterator<DataBatch> {
  public:
@@ -67,6 +130,7 @@ class PrefetcherIter : public IIterator<DataBatch> {
     const int kMaxPrefetchBuffer = 16;
     // init thread iter
     iter.set_max_capacity(kMaxPrefetchBuffer);
+    device_.reset(DevicePrefetcher::Create(param_));
   }
 
   virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
@@ -82,13 +146,14 @@ class PrefetcherIter : public IIterator<DataBatch> {
           (*dptr)->num_batch_padd = batch.num_batch_padd;
           (*dptr)->data.resize(batch.data.size());
           (*dptr)->index.resize(batch.batch_size);
+          Context ctx = Context::CPU();
+          if (param_.shared_memory) ctx = Context::CPUShared(0);
+          if (device_ != nullptr) ctx = device_->StagingContext();
           for (size_t i = 0; i < batch.data.size(); ++i) {
             auto dtype = param_.dtype
                              ? param_.dtype.value()
                              : batch.data[i].type_flag_;
-            (*dptr)->data.at(i) = NDArray(batch.data[i].shape_,
-                                          Context::CPU(), false,
-                                          dtype);
+            (*dptr)->data.at(i) = NDArray(batch.data[i].shape_, ctx, false, dtype);
           }
         }
         CHECK(batch.data.size() == (*dptr)->data.size());
@@ -106,6 +171,7 @@ class PrefetcherIter : public IIterator<DataBatch> {
                     batch.inst_index + batch.batch_size,
                     (*dptr)->index.begin());
         }
+        if (device_ != nullptr) device_->Copy(**dptr);
        return true;
       },
       [this]() { loader_->BeforeFirst(); });
@@ -132,12 +198,14 @@ class PrefetcherIter : public IIterator<DataBatch> {
     return iter.Next(&out_);
   }
   virtual const DataBatch &Value(void) const {
-    return *out_;
+    return device_ != nullptr ? device_->Get(out_) : *out_;
   }
 
  protected:
   /*! \brief prefetcher parameters */
   PrefetcherParam param_;
+  /*! \brief device copies of the batches, if gpu_prefetch is set */
+  std::unique_ptr<DevicePrefetcher> device_;
   /*! \brief backend thread */
   dmlc::ThreadedIter<DataBatch> iter;
   /*! \brief internal batch loader */
@@ -54,6 +54,7 @@ class SparsePrefetcherIter : public PrefetcherIter {
 
   virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
     PrefetcherIter::InitParams(kwargs);
+    CHECK(device_ == nullptr) << "gpu_prefetch is not supported by sparse data iterators";
     // use the kwarg to init batch loader
     sparse_loader_->Init(kwargs);
     iter.Init([this](DataBatch **dptr) {
@@ -0,0 +1,172 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file mmap_recordio.h
+ * \brief RecordIO reader over a memory mapped local file, addressed by
+ *        the offsets of its .idx file
+ */
+#ifndef MXNET_IO_MMAP_RECORDIO_H_
+#define MXNET_IO_MMAP_RECORDIO_H_
+
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <dmlc/recordio.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif  // _WIN32
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mxnet {
+namespace io {
+/*!
+ * \brief Maps a whole .rec file and hands out records as spans into it.
+ *
+ *  Records are found through the offsets of the .idx file, so any order can
+ *  be read without scanning. A record is only copied when it was written in
+ *  several parts, which dmlc::RecordIOWriter does when the payload contains
+ *  the magic number.
+ */
+class MMapRecordIO {
+ public:
+  /*!
+   * \param rec_path path of the local .rec file
+   * \param idx_path path of its .idx file
+   * \param part_index the part of the records to read
+   * \param num_parts number of parts the records are split into
+   */
+  MMapRecordIO(const std::string& rec_path, const std::string& idx_path,
+               int part_index, int num_parts) {
+#ifndef _WIN32
+    fd_ = open(rec_path.c_str(), O_RDONLY);
+    CHECK_NE(fd_, -1) << "Failed to open " << rec_path << ": " << strerror(errno);
+    struct stat st;
+    CHECK_EQ(fstat(fd_, &st), 0) << "Failed to stat " << rec_path << ": " << strerror(errno);
+    size_ = static_cast<size_t>(st.st_size);
+    CHECK_GT(size_, 0) << rec_path << " is empty";
+    void* ptr = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    CHECK_NE(ptr, MAP_FAILED) << "Failed to map " << rec_path << ": " << strerror(errno);
+    data_ = static_cast<char*>(ptr);
+#else
+    LOG(FATAL) << "mmap RecordIO reader is not supported on Windows";
+#endif  // _WIN32
+    std::ifstream fin(idx_path.c_str());
+    CHECK(fin.good()) << "Failed to open " << idx_path;
+    std::vector<size_t> offsets;
+    size_t key, offset;
+    while (fin >> key >> offset) {
+      CHECK_LT(offset, size_) << "offset in " << idx_path << " past the end of " << rec_path;
+      offsets.push_back(offset);
+    }
+    CHECK(!offsets.empty()) << idx_path << " has no records";
+    std::sort(offsets.begin(), offsets.end());
+    // same split of the records as the indexed_recordio input split
+    const size_t num = offsets.size();
+    const size_t begin = num * part_index / num_parts;
+    const size_t end = num * (part_index + 1) / num_parts;
+    for (size_t i = begin; i < end; ++i) {
+      records_.emplace_back(offsets[i], i + 1 < num ? offsets[i + 1] : size_);
+    }
+  }
+
+  ~MMapRecordIO() {
+#ifndef _WIN32
+    if (data_ != nullptr) munmap(data_, size_);
+    if (fd_ != -1) close(fd_);
+#endif  // _WIN32
+  }
+  /*! \return number of records of this part */
+  size_t Size() const {
+    return records_.size();
+  }
+  /*!
+   * \brief get record i.
+   * \param i record index within this part
+   * \param buf storage for records written in several parts
+   * \return span of the record payload
+   */
+  dmlc::InputSplit::Blob Record(size_t i, std::string* buf) const {
+    using dmlc::RecordIOWriter;
+    const char* p = data_ + records_[i].first;
+    const char* end = data_ + records_[i].second;
+    dmlc::InputSplit::Blob blob;
+    buf->clear();
+    while (true) {
+      CHECK_LE(p + 2 * sizeof(uint32_t), end) << "truncated record";
+      uint32_t header[2];
+      std::memcpy(header, p, sizeof(header));
+      CHECK_EQ(header[0], RecordIOWriter::kMagic) << "invalid RecordIO format";
+      const uint32_t cflag = RecordIOWriter::DecodeFlag(header[1]);
+      const uint32_t len = RecordIOWriter::DecodeLength(header[1]);
+      const char* payload = p + sizeof(header);
+      CHECK_LE(payload + len, end) << "truncated record";
+      if (cflag == 0U) {
+        blob.dptr = const_cast<char*>(payload);
+        blob.size = len;
+        return blob;
+      }
+      buf->append(payload, len);
+      if (cflag == 3U) break;
+      // a part boundary stands for a magic number in the payload
+      const uint32_t magic = RecordIOWriter::kMagic;
+      buf->append(reinterpret_cast<const char*>(&magic), sizeof(magic));
+      p = payload + ((len + 3U) >> 2U << 2U);
+    }
+    blob.dptr = &(*buf)[0];
+    blob.size = buf->size();
+    return blob;
+  }
+  /*! \brief ask the kernel to start reading record i */
+  void WillNeed(size_t i) const {
+#ifndef _WIN32
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = records_[i].first / page * page;
+    madvise(data_ + begin, records_[i].second - begin, MADV_WILLNEED);
+#endif  // _WIN32
+  }
+  /*! \brief hint whether the records are read in file order */
+  void SetSequential(bool sequential) const {
+#ifndef _WIN32
+    madvise(data_, size_, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif  // _WIN32
+  }
+
+ private:
+  /*! \brief file descriptor of the .rec file */
+  int fd_{-1};
+  /*! \brief mapped .rec file */
+  char* data_{nullptr};
+  /*! \brief size of the .rec file */
+  size_t size_{0};
+  /*! \brief byte range of every record of this part */
+  std::vector<std::pair<size_t, size_t> > records_;
+};
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_MMAP_RECORDIO_H_
@@ -0,0 +1,253 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file parallel_text_parser.h
+ * \brief CSV and LibSVM parser that splits every chunk over a
+ *        configurable number of threads
+ */
+#ifndef MXNET_IO_PARALLEL_TEXT_PARSER_H_
+#define MXNET_IO_PARALLEL_TEXT_PARSER_H_
+
+#include <dmlc/data.h>
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <dmlc/omp.h>
+#include <dmlc/threadediter.h>
+#include <mxnet/base.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mxnet {
+namespace io {
+/*!
+ * \brief Drop-in replacement of dmlc::Parser::Create for the csv and libsvm
+ *  formats.
+ *
+ *  The dmlc parsers use a fixed number of threads per chunk, which on large
+ *  logs leaves the iterator bound by a single core. Here a reader thread
+ *  fetches the chunks and parses each of them with nthread OpenMP threads,
+ *  every thread filling a CSR row block of its own line range that is handed
+ *  out as is, so the rows are never copied again.
+ */
+template<typename IndexType>
+class ParallelTextParser : public dmlc::Parser<IndexType> {
+ public:
+  /*!
+   * \param uri file or directory to read
+   * \param part_index the part of the input to read
+   * \param num_parts number of parts the input is split into
+   * \param format "csv" or "libsvm"
+   * \param nthread number of threads parsing a chunk
+   */
+  ParallelTextParser(const std::string& uri, unsigned part_index, unsigned num_parts,
+                     const std::string& format, int nthread)
+      : libsvm_(format == "libsvm"), nthread_(std::max(nthread, 1)) {
+    CHECK(format == "libsvm" || format == "csv") << "Unknown text format " << format;
+    source_.reset(dmlc::InputSplit::Create(uri.c_str(), part_index, num_parts, "text"));
+    iter_.set_max_capacity(4);
+    iter_.Init([this](std::vector<Block>** dptr) {
+        dmlc::InputSplit::Blob chunk;
+        if (!source_->NextChunk(&chunk)) return false;
+        if (*dptr == nullptr) *dptr = new std::vector<Block>();
+        const char* begin = static_cast<const char*>(chunk.dptr);
+        ParseChunk(begin, begin + chunk.size, *dptr);
+        bytes_read_ += chunk.size;
+        return true;
+      },
+      [this]() {
+        source_->BeforeFirst();
+        bytes_read_ = 0;
+      });
+  }
+
+  virtual ~ParallelTextParser() {
+    iter_.Destroy();
+  }
+
+  virtual void BeforeFirst() {
+    if (blocks_ != nullptr) iter_.Recycle(&blocks_);
+    iter_.BeforeFirst();
+    pos_ = 0;
+  }
+
+  virtual bool Next() {
+    while (true) {
+      if (blocks_ != nullptr) {
+        while (pos_ < blocks_->size()) {
+          const Block& block = (*blocks_)[pos_++];
+          if (block.label.size() != 0) {
+            value_ = block.GetBlock();
+            return true;
+          }
+        }
+        iter_.Recycle(&blocks_);
+      }
+      if (!iter_.Next(&blocks_)) return false;
+      pos_ = 0;
+    }
+  }
+
+  virtual const dmlc::RowBlock<IndexType>& Value() const {
+    return value_;
+  }
+
+  virtual size_t BytesRead() const {
+    return bytes_read_;
+  }
+
+ private:
+  /*! \brief rows parsed by one thread in CSR layout */
+  struct Block {
+    std::vector<size_t> offset;
+    std::vector<real_t> label;
+    std::vector<IndexType> index;
+    std::vector<real_t> value;
+
+    void Clear() {
+      offset.assign(1, 0);
+      label.clear();
+      index.clear();
+      value.clear();
+    }
+
+    dmlc::RowBlock<IndexType> GetBlock() const {
+      dmlc::RowBlock<IndexType> out;
+      out.size = label.size();
+      out.offset = offset.data();
+      out.label = label.data();
+      out.weight = nullptr;
+      out.qid = nullptr;
+      out.field = nullptr;
+      out.index = index.data();
+      out.value = value.data();
+      return out;
+    }
+  };
+
+  static bool IsEOL(char c) {
+    return c == '\n' || c == '\r';
+  }
+
+  static bool IsBlank(char c) {
+    return c == ' ' || c == '\t';
+  }
+  /*! \brief first line start at or after p */
+  static const char* LineStart(const char* begin, const char* end, const char* p) {
+    while (p != begin && p != end && !IsEOL(p[-1])) ++p;
+    return p;
+  }
+  /*! \brief parse a number token, which the chunk does not null terminate */
+  static real_t ParseReal(const char* begin, const char* end) {
+    char buf[64];
+    const size_t n = std::min(static_cast<size_t>(end - begin), sizeof(buf) - 1);
+    std::memcpy(buf, begin, n);
+    buf[n] = '\0';
+    return std::strtof(buf, nullptr);
+  }
+
+  static IndexType ParseIndex(const char* begin, const char* end) {
+    char buf[32];
+    const size_t n = std::min(static_cast<size_t>(end - begin), sizeof(buf) - 1);
+    std::memcpy(buf, begin, n);
+    buf[n] = '\0';
+    return static_cast<IndexType>(std::strtoull(buf, nullptr, 10));
+  }
+
+  /*! \brief split a chunk at line boundaries and parse the parts in parallel */
+  void ParseChunk(const char* begin, const char* end, std::vector<Block>* blocks) {
+    blocks->resize(nthread_);
+    const size_t len = end - begin;
+    #pragma omp parallel for num_threads(nthread_)
+    for (int tid = 0; tid < nthread_; ++tid) {
+      const char* lbegin = LineStart(begin, end, begin + len * tid / nthread_);
+      const char* lend = LineStart(begin, end, begin + len * (tid + 1) / nthread_);
+      Block* block = &(*blocks)[tid];
+      block->Clear();
+      const char* p = lbegin;
+      while (p < lend) {
+        const char* line_end = std::find_if(p, lend, IsEOL);
+        if (libsvm_) {
+          ParseLibSVMLine(p, line_end, block);
+        } else {
+          ParseCSVLine(p, line_end, block);
+        }
+        p = line_end;
+        while (p != lend && IsEOL(*p)) ++p;
+      }
+    }
+  }
+  /*! \brief label[:weight] idx[:value] ..., with # comments and qid: ignored */
+  static void ParseLibSVMLine(const char* p, const char* end, Block* block) {
+    end = std::find(p, end, '#');
+    bool has_label = false;
+    while (p != end) {
+      while (p != end && IsBlank(*p)) ++p;
+      const char* tok_end = std::find_if(p, end, IsBlank);
+      if (p == tok_end) break;
+      const char* colon = std::find(p, tok_end, ':');
+      if (!has_label) {
+        block->label.push_back(ParseReal(p, colon));
+        has_label = true;
+      } else if (tok_end - p < 4 || std::strncmp(p, "qid:", 4) != 0) {
+        block->index.push_back(ParseIndex(p, colon));
+        block->value.push_back(colon == tok_end ? 1.0f : ParseReal(colon + 1, tok_end));
+      }
+      p = tok_end;
+    }
+    if (has_label) block->offset.push_back(block->index.size());
+  }
+  /*! \brief comma separated dense values, the label is always 0 */
+  static void ParseCSVLine(const char* p, const char* end, Block* block) {
+    if (p == end) return;
+    IndexType column = 0;
+    while (true) {
+      const char* field_end = std::find(p, end, ',');
+      block->index.push_back(column++);
+      block->value.push_back(ParseReal(p, field_end));
+      if (field_end == end) break;
+      p = field_end + 1;
+    }
+    block->label.push_back(0.0f);
+    block->offset.push_back(block->index.size());
+  }
+
+  /*! \brief whether the format is libsvm, csv otherwise */
+  bool libsvm_;
+  /*! \brief number of threads parsing a chunk */
+  int nthread_;
+  std::unique_ptr<dmlc::InputSplit> source_;
+  /*! \brief reader thread producing the parsed blocks of one chunk at a time */
+  dmlc::ThreadedIter<std::vector<Block> > iter_;
+  /*! \brief blocks of the chunk being consumed */
+  std::vector<Block>* blocks_{nullptr};
+  /*! \brief next block in blocks_ */
+  size_t pos_{0};
+  dmlc::RowBlock<IndexType> value_;
+  std::atomic<size_t> bytes_read_{0};
+};
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_PARALLEL_TEXT_PARSER_H_
@@ -0,0 +1,133 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file record_shuffle_buffer.h
+ * \brief streaming shuffle of RecordIO records read sequentially
+ */
+#ifndef MXNET_IO_RECORD_SHUFFLE_BUFFER_H_
+#define MXNET_IO_RECORD_SHUFFLE_BUFFER_H_
+
+#include <dmlc/io.h>
+#include <dmlc/recordio.h>
+#include <dmlc/threadediter.h>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mxnet {
+namespace io {
+/*!
+ * \brief Bounded shuffle buffer between a sequential RecordIO reader and
+ *  the decoders.
+ *
+ *  A reader thread splits the chunks of the input split into records. The
+ *  buffer keeps up to capacity of them and hands out a uniformly chosen one
+ *  for every record it takes in, so the reads stay sequential while the
+ *  output order is close to random. The order only depends on the seed and
+ *  the epoch, not on thread timing.
+ */
+class RecordShuffleBuffer {
+ public:
+  /*!
+   * \param source input split to read from, not owned
+   * \param capacity number of records held for shuffling
+   * \param seed random seed
+   */
+  RecordShuffleBuffer(dmlc::InputSplit* source, size_t capacity, unsigned seed)
+      : capacity_(capacity), seed_(seed) {
+    reader_.set_max_capacity(4);
+    reader_.Init([source](std::vector<std::string>** dptr) {
+        dmlc::InputSplit::Blob chunk;
+        if (!source->NextChunk(&chunk)) return false;
+        if (*dptr == nullptr) *dptr = new std::vector<std::string>();
+        (*dptr)->clear();
+        dmlc::RecordIOChunkReader reader(chunk, 0, 1);
+        dmlc::InputSplit::Blob rec;
+        while (reader.NextRecord(&rec)) {
+          (*dptr)->emplace_back(static_cast<char*>(rec.dptr), rec.size);
+        }
+        return true;
+      },
+      [source]() { source->BeforeFirst(); });
+    rnd_.seed(seed_);
+    pool_.reserve(capacity_);
+  }
+
+  ~RecordShuffleBuffer() {
+    reader_.Destroy();
+  }
+  /*! \brief restart from the first record, with the next epoch's order */
+  void BeforeFirst() {
+    if (chunk_ != nullptr) reader_.Recycle(&chunk_);
+    reader_.BeforeFirst();
+    pool_.clear();
+    pos_ = 0;
+    rnd_.seed(seed_ + (++epoch_));
+  }
+  /*!
+   * \brief get the next record.
+   * \return false at the end of the data
+   */
+  bool Next(std::string* out) {
+    std::string rec;
+    while (pool_.size() < capacity_ && Pull(&rec)) {
+      pool_.emplace_back(std::move(rec));
+    }
+    if (pool_.empty()) return false;
+    std::uniform_int_distribution<size_t> pick(0, pool_.size() - 1);
+    std::swap(pool_[pick(rnd_)], pool_.back());
+    *out = std::move(pool_.back());
+    pool_.pop_back();
+    return true;
+  }
+
+ private:
+  /*! \brief take the next record in file order */
+  bool Pull(std::string* out) {
+    while (chunk_ == nullptr || pos_ == chunk_->size()) {
+      if (chunk_ != nullptr) reader_.Recycle(&chunk_);
+      if (!reader_.Next(&chunk_)) {
+        chunk_ = nullptr;
+        return false;
+      }
+      pos_ = 0;
+    }
+    *out = std::move((*chunk_)[pos_++]);
+    return true;
+  }
+
+  /*! \brief reader thread producing the records of one chunk at a time */
+  dmlc::ThreadedIter<std::vector<std::string> > reader_;
+  /*! \brief chunk being consumed */
+  std::vector<std::string>* chunk_{nullptr};
+  /*! \brief next record in chunk_ */
+  size_t pos_{0};
+  /*! \brief records waiting to be picked */
+  std::vector<std::string> pool_;
+  size_t capacity_;
+  unsigned seed_;
+  unsigned epoch_{0};
+  std::mt19937 rnd_;
+};
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_RECORD_SHUFFLE_BUFFER_H_
@@ -27,6 +27,8 @@
 #include <algorithm>
 #include <utility>
 #include <limits>
+#include <set>
+#include <cstdlib>
 #include <vector>
 #include <tuple>
 #include <thread>
@@ -35,6 +37,7 @@
 #include "../ndarray/ndarray_function.h"
 #include "../operator/tensor/sparse_retain-inl.h"
 #include "./kvstore_utils.h"
+#include "../engine/parallel_for_pool.h"
 namespace mxnet {
 namespace kvstore {
 /**
@@ -184,7 +187,7 @@ class CommCPU : public Comm {
         [reduce, result, rsc, this](RunContext rctx, Engine::CallbackOnComplete on_complete) {
           NDArray out = result;
           is_serial_push_?
-            ReduceSumCPUExSerial(reduce, &out)
+            ReduceSumCPUEx(reduce, &out)
             : mxnet::ndarray::ElementwiseSum(rctx.get_stream<cpu>(), rsc, reduce, &out);
           on_complete();
         }, Context::CPU(), const_vars, {result.var(), rsc.var},
@@ -259,8 +262,9 @@ class CommCPU : public Comm {
     });
   }
 
-  // serial implementation of reduce sum for row sparse NDArray.
-  inline void ReduceSumCPUExSerial(const std::vector<NDArray> &in, NDArray *out) {
+  // implementation of reduce sum for row sparse NDArray. The unique output
+  // rows are split into contiguous blocks that are merged in parallel.
+  inline void ReduceSumCPUEx(const std::vector<NDArray> &in, NDArray *out) {
     using namespace rowsparse;
     using namespace mshadow;
     auto stype = out->storage_type();
@@ -274,8 +278,6 @@ class CommCPU : public Comm {
       MSHADOW_IDX_TYPE_SWITCH(out->aux_type(kIdx), IType, {
         std::vector<Tensor<cpu, 2, DType>> in_vals(num_in);
         std::vector<Tensor<cpu, 1, IType>> in_indices(num_in);
-        // offset to the values tensor of all inputs
-        std::vector<size_t> offsets(num_in, 0);
         std::vector<size_t> num_rows(num_in, 0);
         for (size_t i = 0; i < num_in; i++) {
           if (!in[i].storage_initialized()) {
@@ -306,23 +308,44 @@ class CommCPU : public Comm {
         out->CheckAndAlloc({Shape1(nnr)});
         auto idx_data = out->aux_data(kIdx).FlatTo1D<cpu, IType>();
         auto val_data = out->data().FlatTo2D<cpu, DType>();
-
-        for (size_t i = 0; i < nnr; i++) {
-          // copy indices back
-          idx_data[i] = indices[i];
-          bool zeros = true;
+        const size_t row_length = out->shape().ProdShape(1, out->shape().ndim());
+        // one block per thread, or a single block for small arrays
+        long nblock = 1;  // NOLINT(*)
+        if (nnr * row_length >= bigarray_bound_ && nthread_reduction_ > 1) {
+          nblock = std::min(static_cast<long>(nnr),  // NOLINT(*)
+                            static_cast<long>(nthread_reduction_));  // NOLINT(*)
+        }
+        #pragma omp parallel for schedule(static) num_threads(nthread_reduction_) if (nblock > 1)
+        for (long b = 0; b < nblock; ++b) { // NOLINT(*)
+          const size_t begin = nnr * b / nblock;
+          const size_t end = nnr * (b + 1) / nblock;
+          if (begin == end) continue;
+          // input row indices are sorted, so each input contributes a
+          // contiguous range to this block starting at its lower bound
+          std::vector<size_t> offsets(num_in, 0);
           for (size_t j = 0; j < num_in; j++) {
             if (skip[j]) continue;
-            size_t offset = offsets[j];
-            if (offset < num_rows[j]) {
-              if (indices[i] == in_indices[j][offset]) {
-                if (zeros) {
-                  Copy(val_data[i], in_vals[j][offset], nullptr);
-                  zeros = false;
-                } else {
-                  val_data[i] += in_vals[j][offset];
+            const IType* row_idx = in_indices[j].dptr_;
+            offsets[j] = std::lower_bound(row_idx, row_idx + num_rows[j], indices[begin])
+                         - row_idx;
+          }
+          for (size_t i = begin; i < end; i++) {
+            // copy indices back
+            idx_data[i] = indices[i];
+            bool zeros = true;
+            for (size_t j = 0; j < num_in; j++) {
+              if (skip[j]) continue;
+              size_t offset = offsets[j];
+              if (offset < num_rows[j]) {
+                if (indices[i] == in_indices[j][offset]) {
+                  if (zeros) {
+                    Copy(val_data[i], in_vals[j][offset], nullptr);
+                    zeros = false;
+                  } else {
+                    val_data[i] += in_vals[j][offset];
+                  }
+                  offsets[j] += 1;
                 }
-                offsets[j] += 1;
               }
             }
           }
@@ -375,13 +398,23 @@ class CommCPU : public Comm {
     if (total < bigarray_bound_ || nthread_reduction_ <= 1) {
       ReduceSumCPU(dptr, 0, total);
     } else {
-      #pragma omp parallel for schedule(static) num_threads(nthread_reduction_)
-      for (long j = 0; j < ntask; ++j) { // NOLINT(*)
+      auto reduce_task = [&](long j) { // NOLINT(*)
         size_t k = static_cast<size_t>(j);
         size_t begin = std::min(k * step, total);
         size_t end = std::min((k + 1) * step, total);
         if (j == ntask - 1) CHECK_EQ(end, total);
         ReduceSumCPU(dptr, begin, static_cast<index_t>(end - begin));
+      };
+      engine::ParallelForPool *pool = engine::ParallelForPool::Get();
+      const bool pooled = pool != nullptr &&
+        pool->ParallelFor(ntask, nthread_reduction_, [&](int64_t begin, int64_t end) {
+          for (int64_t j = begin; j < end; ++j) reduce_task(j);
+        });
+      if (!pooled) {
+        #pragma omp parallel for schedule(static) num_threads(nthread_reduction_)
+        for (long j = 0; j < ntask; ++j) { // NOLINT(*)
+          reduce_task(j);
+        }
       }
     }
   }
@@ -603,7 +636,7 @@ class CommDevice : public Comm {
     }
   }
 
- private:
+ protected:
   void EnableP2P(const std::vector<Context>& devs) {
 #if MXNET_USE_CUDA
     std::vector<int> gpus;
@@ -625,6 +658,7 @@ class CommDevice : public Comm {
           if (e == cudaSuccess || e == cudaErrorPeerAccessAlreadyEnabled) {
             ++enabled;
             p2p[i*n+j] = 1;
+            p2p_pairs_.emplace(gpus[i], gpus[j]);
           }
         }
       }
@@ -699,6 +733,174 @@ class CommDevice : public Comm {
   };
   std::unordered_map<int, BufferEntry> merge_buf_;
   bool inited_;
+  /// \brief (from, to) gpu pairs with peer access enabled
+  std::set<std::pair<int, int>> p2p_pairs_;
+};
+
+/**
+ * \brief CommDevice that reduces dense arrays with a chunked ring
+ * reduce-scatter and broadcasts them along a doubling tree.
+ *
+ * The ring visits the GPUs so that neighbours have peer access whenever
+ * possible. Every step moves only 1/n of the array over each link, so all
+ * links are busy at once instead of all traffic converging on the merge
+ * buffer's device. Small, non-float32 or sparse arrays, and arrays not
+ * spread over distinct GPUs, fall back to the star reduce of CommDevice.
+ */
+class CommDeviceRing : public CommDevice {
+ public:
+  CommDeviceRing() {
+    ring_min_size_ = dmlc::GetEnv("MXNET_KVSTORE_RING_MIN_SIZE", 64 * 1024);
+  }
+
+  const NDArray& Reduce(int key, const std::vector<NDArray>& src,
+                        int priority) override {
+    if ((gc_ != nullptr && gc_->get_type() != CompressionType::kNone) ||
+        src.size() == 1) {
+      return CommDevice::Reduce(key, src, priority);
+    }
+    InitBuffersAndComm(src);
+    auto& buf = merge_buf_[key];
+    if (!UseRing(buf.merged, src)) {
+      return CommDevice::Reduce(key, src, priority);
+    }
+    auto& ring = ring_buf_[key];
+    const size_t n = src.size();
+    const size_t total = buf.merged.shape().Size();
+    // ring order follows the topology computed over all devices
+    std::vector<size_t> pos = RingPositions(src);
+    if (ring.acc.empty()) {
+      ring.acc.resize(n);
+      ring.recv.resize(n);
+      for (size_t p = 0; p < n; ++p) {
+        const Context& ctx = src[pos[p]].ctx();
+        ring.acc[p] = NDArray(TShape{static_cast<index_t>(total)}, ctx, false,
+                              buf.merged.dtype());
+        ring.recv[p] = NDArray(TShape{static_cast<index_t>((total + n - 1) / n)},
+                               ctx, false, buf.merged.dtype());
+      }
+    }
+    for (size_t p = 0; p < n; ++p) {
+      NDArray flat = src[pos[p]].Reshape(TShape{static_cast<index_t>(total)});
+      CopyFromTo(flat, &ring.acc[p], priority);
+    }
+    // reduce-scatter: at step s, position p sends chunk (p - s) to p + 1
+    for (size_t s = 0; s + 1 < n; ++s) {
+      for (size_t p = 0; p < n; ++p) {
+        const size_t q = (p + 1) % n;
+        const size_t c = (p + n - s) % n;
+        const index_t begin = ChunkBegin(total, n, c);
+        const index_t end = ChunkBegin(total, n, c + 1);
+        NDArray recv = ring.recv[q].Slice(0, end - begin);
+        CopyFromTo(ring.acc[p].Slice(begin, end), &recv, priority);
+        NDArray acc = ring.acc[q].Slice(begin, end);
+        acc += recv;
+      }
+    }
+    // position p now owns the full sum of chunk p + 1
+    NDArray merged = buf.merged.Reshape(TShape{static_cast<index_t>(total)});
+    for (size_t p = 0; p < n; ++p) {
+      const size_t c = (p + 1) % n;
+      const index_t begin = ChunkBegin(total, n, c);
+      const index_t end = ChunkBegin(total, n, c + 1);
+      NDArray out = merged.Slice(begin, end);
+      CopyFromTo(ring.acc[p].Slice(begin, end), &out, priority);
+    }
+    return buf.merged;
+  }
+
+  void Broadcast(int key, const NDArray& src,
+                 const std::vector<NDArray*> dst, int priority) override {
+    if (!inited_ || dst.size() == 1) {
+      CommDevice::Broadcast(key, src, dst, priority);
+      return;
+    }
+    auto& buf = merge_buf_[key];
+    std::vector<NDArray> dst_arrays;
+    for (auto d : dst) dst_arrays.push_back(*d);
+    if (!UseRing(buf.merged, dst_arrays)) {
+      CommDevice::Broadcast(key, src, dst, priority);
+      return;
+    }
+    CopyFromTo(src, &buf.merged, priority);
+    // doubling tree over the ring order, starting next to the merge buffer:
+    // every array holding the value sends it on to one more device per round
+    std::vector<size_t> pos = RingPositions(dst_arrays);
+    size_t start = 0;
+    for (size_t p = 0; p < pos.size(); ++p) {
+      if (dst[pos[p]]->ctx() == buf.merged.ctx()) start = p;
+    }
+    std::vector<NDArray*> order;
+    for (size_t p = 0; p < pos.size(); ++p) {
+      order.push_back(dst[pos[(start + p) % pos.size()]]);
+    }
+    CopyFromTo(buf.merged, order[0], priority);
+    for (size_t have = 1; have < order.size(); have *= 2) {
+      for (size_t i = 0; i < have && have + i < order.size(); ++i) {
+        CopyFromTo(*order[i], order[have + i], priority);
+      }
+    }
+  }
+
+ private:
+  /// \brief per-device accumulation and receive buffers of one key
+  struct RingEntry {
+    std::vector<NDArray> acc;
+    std::vector<NDArray> recv;
+  };
+
+  /// \brief chunk c of n covers [ChunkBegin(c), ChunkBegin(c + 1))
+  static index_t ChunkBegin(size_t total, size_t n, size_t c) {
+    return static_cast<index_t>(c * total / n);
+  }
+
+  bool UseRing(const NDArray& merged, const std::vector<NDArray>& arrays) const {
+    if (merged.storage_type() != kDefaultStorage ||
+        merged.dtype() != mshadow::kFloat32 ||
+        merged.shape().Size() < std::max<size_t>(ring_min_size_, arrays.size())) {
+      return false;
+    }
+    std::set<int> devs;
+    for (const auto& a : arrays) {
+      if (a.ctx().dev_mask() != gpu::kDevMask) return false;
+      devs.insert(a.ctx().dev_id);
+    }
+    return devs.size() == arrays.size();
+  }
+
+  /**
+   * \brief ring order of the arrays, greedily walking to a peer-accessible
+   * device with the closest id, which follows the PCIe switch layout on
+   * common machines
+   */
+  std::vector<size_t> RingPositions(const std::vector<NDArray>& arrays) const {
+    const size_t n = arrays.size();
+    std::vector<size_t> order{0};
+    std::vector<bool> used(n, false);
+    used[0] = true;
+    for (size_t step = 1; step < n; ++step) {
+      const int cur = arrays[order.back()].ctx().dev_id;
+      size_t best = n;
+      bool best_p2p = false;
+      for (size_t i = 0; i < n; ++i) {
+        if (used[i]) continue;
+        const int dev = arrays[i].ctx().dev_id;
+        const bool p2p = p2p_pairs_.count(std::make_pair(cur, dev)) > 0;
+        if (best == n || (p2p && !best_p2p) ||
+            (p2p == best_p2p &&
+             std::abs(dev - cur) < std::abs(arrays[best].ctx().dev_id - cur))) {
+          best = i;
+          best_p2p = p2p;
+        }
+      }
+      used[best] = true;
+      order.push_back(best);
+    }
+    return order;
+  }
+
+  std::unordered_map<int, RingEntry> ring_buf_;
+  size_t ring_min_size_;
 };
 
 }  // namespace kvstore
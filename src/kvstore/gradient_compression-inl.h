@@ -36,6 +36,10 @@ void Quantize2BitImpl(mshadow::Stream<mshadow::gpu> *s, const std::vector<mxnet:
                       const float threshold);
 void Dequantize2BitImpl(mshadow::Stream<mshadow::gpu> *s, const std::vector<mxnet::TBlob> &inputs,
                         const float threshold);
+void QuantizeTopKImpl(mshadow::Stream<mshadow::gpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                      const int block);
+void DequantizeTopKImpl(mshadow::Stream<mshadow::gpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                        const int block);
 
 struct quantize_2bit {
   MSHADOW_XINLINE static void Map(int out_block_id,
@@ -138,6 +142,70 @@ void Dequantize2BitKernelLaunch(mshadow::Stream<xpu> *s, const std::vector<mxnet
           threshold);               // positive threshold
 }
 
+struct quantize_topk {
+  MSHADOW_XINLINE static void Map(int block_id,
+                                  int original_size,
+                                  int block,
+                                  float *out,
+                                  float *grad,
+                                  float *residual) {
+    // each block of the gradient is sent as its largest magnitude
+    // value, stored as (position in block, value)
+    const int start = block_id * block;
+    const int end = (start + block <= original_size) ? start + block : original_size;
+    int top = start;
+    float top_abs = -1.f;
+    for (int i = start; i < end; i++) {
+      // adds gradient to existing residual to get updated grad
+      residual[i] += grad[i];
+      const float abs_val = residual[i] < 0 ? -residual[i] : residual[i];
+      if (abs_val > top_abs) {
+        top_abs = abs_val;
+        top = i;
+      }
+    }
+    out[2 * block_id] = static_cast<float>(top - start);
+    out[2 * block_id + 1] = residual[top];
+    // what was sent leaves the residual, the rest is fed back next time
+    residual[top] = 0.f;
+  }
+};
+
+template<typename xpu>
+void QuantizeTopKKernelLaunch(mshadow::Stream<xpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                              const int block) {
+  mxnet::op::mxnet_op::Kernel<quantize_topk, xpu>
+    ::Launch(s,
+            inputs[2].Size() / 2,     // number of blocks
+            inputs[0].Size(),         // original size
+            block,                    // values per block
+            inputs[2].dptr<float>(),  // compressed array
+            inputs[0].dptr<float>(),  // original array
+            inputs[1].dptr<float>());  // residual array
+}
+
+struct dequantize_topk {
+  MSHADOW_XINLINE static void Map(int i,
+                                  int block,
+                                  float *out,
+                                  float *in) {
+    const int block_id = i / block;
+    const int top = static_cast<int>(in[2 * block_id]);
+    out[i] = (i - block_id * block == top) ? in[2 * block_id + 1] : 0.f;
+  }
+};
+
+template<typename xpu>
+void DequantizeTopKKernelLaunch(mshadow::Stream<xpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                                const int block) {
+  mxnet::op::mxnet_op::Kernel<dequantize_topk, xpu>
+  ::Launch(s,
+          inputs[1].Size(),         // original size
+          block,                    // values per block
+          inputs[1].dptr<float>(),  // out array
+          inputs[0].dptr<float>());  // compressed array
+}
+
 inline void Quantize2BitImpl(mshadow::Stream<mshadow::cpu> *s,
                              const std::vector<mxnet::TBlob> &inputs,
                              const float threshold) {
@@ -149,6 +217,18 @@ inline void Dequantize2BitImpl(mshadow::Stream<mshadow::cpu> *s,
                                const float threshold) {
   Dequantize2BitKernelLaunch(s, inputs, threshold);
 }
+
+inline void QuantizeTopKImpl(mshadow::Stream<mshadow::cpu> *s,
+                             const std::vector<mxnet::TBlob> &inputs,
+                             const int block) {
+  QuantizeTopKKernelLaunch(s, inputs, block);
+}
+
+inline void DequantizeTopKImpl(mshadow::Stream<mshadow::cpu> *s,
+                               const std::vector<mxnet::TBlob> &inputs,
+                               const int block) {
+  DequantizeTopKKernelLaunch(s, inputs, block);
+}
 }  // namespace kvstore
 }  // namespace mxnet
 
@@ -23,6 +23,8 @@
  * \author Rahul Huilgol
  */
 
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <vector>
 #include "gradient_compression.h"
@@ -61,6 +63,9 @@ void GradientCompression::SetParams(const std::vector<std::pair<std::string, std
   CHECK_GT(params.threshold, 0) << "threshold must be greater than 0";
   if (params.type == "2bit") {
     SetTwoBitCompression(params.threshold);
+  } else if (params.type == "topk") {
+    CHECK(params.ratio > 0 && params.ratio <= 0.5) << "ratio must be in (0, 0.5]";
+    SetTopKCompression(params.ratio);
   } else {
     LOG(FATAL) << "Unknown type for gradient compression " << params.type;
   }
@@ -79,11 +84,20 @@ void GradientCompression::SetTwoBitCompression(const float threshold) {
   threshold_ = threshold;
 }
 
+void GradientCompression::SetTopKCompression(const float ratio) {
+  type_ = CompressionType::kTopK;
+  // blocks hold an even number of values so that a (position, value) pair
+  // takes the place of exactly GetCompressionFactor() values per float
+  topk_block_ = 2 * std::max(1, static_cast<int>(std::round(0.5f / ratio)));
+}
+
 std::string GradientCompression::EncodeParams() {
   using namespace std;  // to reduce length of next line
   string rval = get_type_str();
   if (type_ == CompressionType::kTwoBit) {
     rval += "," + to_string(threshold_);
+  } else if (type_ == CompressionType::kTopK) {
+    rval += "," + to_string(topk_block_);
   }
   return rval;
 }
@@ -94,7 +108,11 @@ void GradientCompression::DecodeParams(const std::string &s) {
   type_ = static_cast<CompressionType>(stoi(elems[0]));
   if (elems.size() > 1) {
     if (!elems[1].empty()) {
-      threshold_ = stof(elems[1]);
+      if (type_ == CompressionType::kTopK) {
+        topk_block_ = stoi(elems[1]);
+      } else {
+        threshold_ = stof(elems[1]);
+      }
     }
   }
 }
@@ -102,17 +120,23 @@ void GradientCompression::DecodeParams(const std::string &s) {
 int GradientCompression::GetCompressionFactor() {
   if (type_ == CompressionType::kTwoBit) {
     return 16;
+  } else if (type_ == CompressionType::kTopK) {
+    return topk_block_ / 2;
   } else {
     LOG(FATAL) << "Unsupported compression type: " << get_type_str();
     return 0;
   }
 }
 
+int GradientCompression::GetCompressedUnit() {
+  return type_ == CompressionType::kTopK ? 2 : 1;
+}
+
 int64_t GradientCompression::GetCompressedSize(const int64_t original_size) {
-  const int bits = GetCompressionFactor();
-  return ((original_size % bits == 0) ?
-          original_size / bits :
-          original_size / bits + 1);
+  const int unit = GetCompressedUnit();
+  const int64_t block = GetCompressionFactor() * unit;
+  const int64_t num_blocks = (original_size + block - 1) / block;
+  return num_blocks * unit;
 }
 
 void GradientCompression::Quantize(const mxnet::NDArray &from, mxnet::NDArray *to,
@@ -123,7 +147,32 @@ void GradientCompression::Quantize(const mxnet::NDArray &from, mxnet::NDArray *t
   const int a = from.ctx().dev_mask();
   const int b = to->ctx().dev_mask();
   const float threshold = threshold_;
-  if (type_ == CompressionType::kTwoBit) {
+  const int block = topk_block_;
+  if (type_ == CompressionType::kTopK) {
+    if (a == mshadow::cpu::kDevMask && b == mshadow::cpu::kDevMask) {
+      mxnet::Engine::Get()->PushSync([from, to, residual, block](mxnet::RunContext ctx) {
+        std::vector<mxnet::TBlob> inputs = {from.data(), residual->data(), to->data()};
+        QuantizeTopKImpl(ctx.get_stream<mshadow::cpu>(), inputs, block);
+      }, from.ctx(), {from.var()}, {to->var(), residual->var()},
+      mxnet::FnProperty::kNormal, priority, "QuantizeTopKCPU");
+    } else {
+#if MXNET_USE_CUDA
+      if (a == mshadow::gpu::kDevMask && b == mshadow::gpu::kDevMask) {
+        mxnet::Engine::Get()->PushSync([from, to, residual, block](mxnet::RunContext ctx) {
+          std::vector<mxnet::TBlob> inputs = {from.data(), residual->data(), to->data()};
+          QuantizeTopKImpl(ctx.get_stream<mshadow::gpu>(), inputs, block);
+          // Wait GPU kernel to complete
+          ctx.get_stream<mshadow::gpu>()->Wait();
+        }, from.ctx(), {from.var()}, {to->var(), residual->var()},
+        mxnet::FnProperty::kNormal, priority, "QuantizeTopKGPU");
+      } else {
+        LOG(FATAL) << "unknown device mask";
+      }
+#else
+      LOG(FATAL) << MXNET_GPU_NOT_ENABLED_ERROR;
+#endif
+    }
+  } else if (type_ == CompressionType::kTwoBit) {
     if (a == mshadow::cpu::kDevMask && b == mshadow::cpu::kDevMask) {
       mxnet::Engine::Get()->PushSync([from, to, residual, threshold](mxnet::RunContext ctx) {
         std::vector<mxnet::TBlob> inputs = {from.data(), residual->data(), to->data()};
@@ -159,7 +208,32 @@ void GradientCompression::Dequantize(const mxnet::NDArray &from, mxnet::NDArray
   const int a = from.ctx().dev_mask();
   const int b = to->ctx().dev_mask();
   const float threshold = threshold_;
-  if (type_ == CompressionType::kTwoBit) {
+  const int block = topk_block_;
+  if (type_ == CompressionType::kTopK) {
+    if (a == mshadow::cpu::kDevMask && b == mshadow::cpu::kDevMask) {
+      mxnet::Engine::Get()->PushSync([from, to, block](mxnet::RunContext ctx) {
+        std::vector<mxnet::TBlob> inputs = {from.data(), to->data()};
+        DequantizeTopKImpl(ctx.get_stream<mshadow::cpu>(), inputs, block);
+      }, from.ctx(), {from.var()}, {to->var()},
+      mxnet::FnProperty::kNormal, priority, "DequantizeTopKCPU");
+    } else {
+#if MXNET_USE_CUDA
+      if (a == mshadow::gpu::kDevMask && b == mshadow::gpu::kDevMask) {
+        mxnet::Engine::Get()->PushSync([from, to, block](mxnet::RunContext ctx) {
+          std::vector<mxnet::TBlob> inputs = {from.data(), to->data()};
+          DequantizeTopKImpl(ctx.get_stream<mshadow::gpu>(), inputs, block);
+          // Wait GPU kernel to complete
+          ctx.get_stream<mshadow::gpu>()->Wait();
+        }, from.ctx(), {from.var()}, {to->var()},
+        mxnet::FnProperty::kNormal, priority, "DequantizeTopKGPU");
+      } else {
+        LOG(FATAL) << "unknown device mask";
+      }
+#else
+      LOG(FATAL) << MXNET_GPU_NOT_ENABLED_ERROR;
+#endif
+    }
+  } else if (type_ == CompressionType::kTwoBit) {
     if (a == mshadow::cpu::kDevMask && b == mshadow::cpu::kDevMask) {
       mxnet::Engine::Get()->PushSync([from, to, threshold](mxnet::RunContext ctx) {
         std::vector<mxnet::TBlob> inputs = {from.data(), to->data()};
@@ -36,5 +36,15 @@ void Dequantize2BitImpl(mshadow::Stream<gpu>* s, const std::vector<TBlob>& input
                         const float threshold) {
   Dequantize2BitKernelLaunch(s, inputs, threshold);
 }
+
+void QuantizeTopKImpl(mshadow::Stream<gpu>* s, const std::vector<TBlob>& inputs,
+                      const int block) {
+  QuantizeTopKKernelLaunch(s, inputs, block);
+}
+
+void DequantizeTopKImpl(mshadow::Stream<gpu>* s, const std::vector<TBlob>& inputs,
+                        const int block) {
+  DequantizeTopKKernelLaunch(s, inputs, block);
+}
 }  // namespace kvstore
 }  // namespace mxnet
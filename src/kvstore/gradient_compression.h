@@ -35,17 +35,20 @@ namespace mxnet {
 namespace kvstore {
 
 enum class CompressionType {
-  kNone, kTwoBit
+  kNone, kTwoBit, kTopK
 };
 
 struct GradientCompressionParam : public dmlc::Parameter<GradientCompressionParam> {
   std::string type;
   float threshold;
+  float ratio;
   DMLC_DECLARE_PARAMETER(GradientCompressionParam) {
     DMLC_DECLARE_FIELD(type)
       .describe("Type of gradient compression to use, like `2bit` for example");
     DMLC_DECLARE_FIELD(threshold).set_default(0.5)
       .describe("Threshold to use for 2bit gradient compression");
+    DMLC_DECLARE_FIELD(ratio).set_default(0.01)
+      .describe("Fraction of the gradient values sent by topk gradient compression");
   }
 };
 
@@ -78,6 +81,13 @@ class GradientCompression {
    */
   void SetTwoBitCompression(const float threshold);
 
+  /*!
+   * \brief sets top-k gradient compression
+   * \param ratio fraction of values to send, the largest value of every
+   * block of about 1/ratio values is sent with its position
+   */
+  void SetTopKCompression(const float ratio);
+
   /*!
    * \brief encodes parameters of gc into a string
    */
@@ -99,6 +109,13 @@ class GradientCompression {
    */
   int64_t GetCompressedSize(const int64_t original_size);
 
+  /*!
+   * \brief returns the number of compressed values that encode one block of
+   * GetCompressionFactor() * GetCompressedUnit() original values. Compressed
+   * arrays can only be partitioned at multiples of this.
+   */
+  int GetCompressedUnit();
+
   /*!
   * \brief Issues quantize operation to be scheduled by the engine
   * Compresses `from` into `to` and accumulates the quantization error
@@ -132,6 +149,12 @@ class GradientCompression {
    * all negative gradients will be thresholded to -1*`threshold_`
    */
   float threshold_ = 0;
+
+  /*!
+   * \brief number of original values per block for top-k compression,
+   * each block is sent as one (position, value) pair
+   */
+  int topk_block_ = 0;
 };
 }  // namespace kvstore
 }  // namespace mxnet
@@ -33,6 +33,7 @@ std::atomic<int> mxnet::kvstore::KVStoreDist::customer_id_{0};
 #endif  // MXNET_USE_DIST_KVSTORE
 #if MXNET_USE_NCCL
 #include "./kvstore_nccl.h"
+#include "./kvstore_dist_nccl.h"
 #endif  // MXNET_USE_NCCL
 
 namespace mxnet {
@@ -49,7 +50,14 @@ KVStore* KVStore::Create(const char *type_name) {
     use_device_comm = true;
   }
 
-  if (has("dist")) {
+  if (has("dist_allreduce")) {
+#if MXNET_USE_NCCL
+    kv = new kvstore::KVStoreDistNCCL();
+#else
+    LOG(FATAL) << "compile with USE_NCCL=1 to use " << tname;
+    return nullptr;
+#endif  // MXNET_USE_NCCL
+  } else if (has("dist")) {
 #if MXNET_USE_DIST_KVSTORE
     kv = new kvstore::KVStoreDist(use_device_comm);
     if (!has("_async") && kv->IsWorkerNode() && kv->get_rank() == 0) {
@@ -69,7 +77,7 @@ KVStore* KVStore::Create(const char *type_name) {
       return nullptr;
 #endif
     } else {
-      kv =  new kvstore::KVStoreLocal(use_device_comm);
+      kv =  new kvstore::KVStoreLocal(use_device_comm, has("device_ring"));
     }
   }
   kv->type_ = tname;
@@ -24,14 +24,17 @@
  */
 #ifndef MXNET_KVSTORE_KVSTORE_DIST_H_
 #define MXNET_KVSTORE_KVSTORE_DIST_H_
+#include <cstring>
 #include <string>
 #include <vector>
 #include <algorithm>
 #include <utility>
 #include "./kvstore_local.h"
 #include "mxnet/engine.h"
+#include <list>
 #include "ps/ps.h"
 #include "./kvstore_dist_server.h"
+#include "../profiler/profiler.h"
 namespace mxnet {
 namespace kvstore {
 
@@ -57,6 +60,14 @@ class KVStoreDist : public KVStoreLocal {
     }
     bigarray_bound_ = dmlc::GetEnv("MXNET_KVSTORE_BIGARRAY_BOUND", 1000 * 1000);
     log_verbose_ = dmlc::GetEnv("MXNET_KVSTORE_DIST_ROW_SPARSE_VERBOSE", false);
+    fusion_bucket_bytes_ = dmlc::GetEnv("MXNET_KVSTORE_FUSION_BUCKET_BYTES", 4 << 20);
+    stale_pull_ = dmlc::GetEnv("MXNET_KVSTORE_STALE_PULL", false);
+    rsp_cache_rows_ = dmlc::GetEnv("MXNET_KVSTORE_RSP_CACHE_ROWS", 0);
+    fp16_wire_ = dmlc::GetEnv("MXNET_KVSTORE_DIST_FP16", false);
+    if (fp16_wire_ && IsWorkerNode() && get_rank() == 0) {
+      // the servers keep float32 copies of the keys sent as float16
+      SendCommandToServers(static_cast<int>(CommandType::kSetMultiPrecision), "");
+    }
   }
 
   virtual ~KVStoreDist() {
@@ -176,12 +187,19 @@ class KVStoreDist : public KVStoreLocal {
    * \brief serialize access to ps_kv_ or push_ps_kv_/pull_ps_kv_ while encoding keys
    */
   std::mutex mu_;
+  /**
+   * \brief bytes of the keys assigned to every server, and the server of each
+   * key stored on a single one
+   */
+  std::vector<size_t> server_bytes_;
+  std::unordered_map<int, int> key_server_;
 
   void InitImpl(const std::vector<int>& keys,
                 const std::vector<NDArray>& values) override {
     CheckUnique(keys);
     for (size_t i = 0; i < keys.size(); ++i) {
       comm_->Init(keys[i], values[i].storage_type(), values[i].shape(), values[i].dtype());
+      AssignServer(keys[i], values[i]);
     }
     if (get_rank() == 0) {
       Push_(keys, values, 0, false);
@@ -189,6 +207,7 @@ class KVStoreDist : public KVStoreLocal {
       for (const int key : keys) {
         comm_buf_[key].WaitToWrite();
         compr_buf_[key].WaitToWrite();
+        if (half_buf_.count(key)) half_buf_[key].WaitToWrite();
       }
     } else {
       // do nothing
@@ -211,6 +230,13 @@ class KVStoreDist : public KVStoreLocal {
     std::vector<std::vector<NDArray*> > grouped_vals;
     GroupKVPairsPull(keys, values, &uniq_keys, &grouped_vals);
 
+    std::vector<int> fused_keys;
+    std::vector<NDArray> fused_bufs;
+    std::vector<NDArray> broadcast_src(uniq_keys.size());
+    // float16 received arrays and the float32 ones they are cast into
+    std::vector<std::pair<NDArray, NDArray> > casts;
+    // received arrays of stale pulls and the buffers the next pull hands out
+    std::vector<std::pair<NDArray, NDArray> > snapshots;
     for (size_t i = 0; i < uniq_keys.size(); ++i) {
       int key = uniq_keys[i];
       // use the same array for merging to guarantee that pull always happens
@@ -224,37 +250,93 @@ class KVStoreDist : public KVStoreLocal {
         recv_buf = NDArray(grouped_vals[i][0]->shape(), pinned_ctx_,
                            true, grouped_vals[i][0]->dtype());
       }
-      auto pull_from_servers = [this, key, recv_buf](
-          RunContext rctx, Engine::CallbackOnComplete cb) {
-        // convert to ps keys
-        size_t size = recv_buf.shape().Size();
-        const int dtype = recv_buf.dtype();
-        const int num_bytes = mshadow::mshadow_sizeof(dtype);
-        PSKV& pskv = (gradient_compression_->get_type() == CompressionType::kNone) ?
-                      EncodeDefaultKey(key, size, num_bytes) :
-                      EncodeCompressedKey(key, size, false, num_bytes);
-        char* data = static_cast<char*> (recv_buf.data().dptr_);
-        // false means not to delete data when SArray is deleted
-        auto vals = new ps::SArray<char>(data, size * num_bytes, false);
-        // issue pull
-        RequestType mode = (gradient_compression_->get_type() != CompressionType::kNone) ?
-                  RequestType::kCompressedPushPull : RequestType::kDefaultPushPull;
-        const int cmd = GetCommandType(mode, dtype);
-        CHECK_NOTNULL(ps_worker_)->ZPull(
-          pskv.keys, vals, &pskv.lens, cmd, [vals, cb](){ delete vals; cb(); });
-      };
+      NDArray pull_dst = recv_buf;
+      if (stale_pull_) {
+        // comm_buf_ holds the merged gradient until the push of it is sent, so
+        // stale pulls are received into their own buffer once it has been
+        auto& pull_buf = pull_buf_[key];
+        if (pull_buf.is_none()) {
+          pull_buf = NDArray(recv_buf.shape(), pinned_ctx_, true, recv_buf.dtype());
+        }
+        Engine::Get()->PushSync([](RunContext rctx) {}, pinned_ctx_, {},
+                                {recv_buf.var(), pull_buf.var()}, FnProperty::kNormal,
+                                priority, "KVStoreDistStalePullOrder");
+        pull_dst = pull_buf;
+        auto it = stale_buf_.find(key);
+        if (it != stale_buf_.end()) {
+          // hand out what the previous pull brought in and let this pull
+          // complete in the background
+          broadcast_src[i] = it->second;
+        } else {
+          // the first pull of a key is waited for, later ones are stale by one
+          it = stale_buf_.emplace(key, NDArray(recv_buf.shape(), pinned_ctx_, true,
+                                               recv_buf.dtype())).first;
+          broadcast_src[i] = pull_buf;
+        }
+        snapshots.emplace_back(pull_buf, it->second);
+      } else {
+        broadcast_src[i] = recv_buf;
+      }
+      NDArray wire_buf = pull_dst;
+      if (UseHalfWire(pull_dst)) {
+        wire_buf = HalfBuffer(key, pull_dst);
+        casts.emplace_back(wire_buf, pull_dst);
+      }
+      if (IsFusable(wire_buf)) {
+        fused_keys.push_back(key);
+        fused_bufs.push_back(wire_buf);
+        continue;
+      }
+      PullDefault(key, wire_buf, priority);
+    }
+    for (const auto& bucket : MakeFusionBuckets(fused_keys, fused_bufs)) {
+      if (bucket.keys.size() == 1) {
+        PullDefault(bucket.keys[0], bucket.bufs[0], priority);
+      } else {
+        PullFused(bucket, priority);
+      }
+    }
+    for (const auto& cast : casts) {
+      CastArray(cast.first, cast.second, priority);
+    }
+    for (size_t i = 0; i < uniq_keys.size(); ++i) {
+      comm_->Broadcast(uniq_keys[i], broadcast_src[i], grouped_vals[i], priority);
+    }
+    // queued after the broadcasts so that they still read the previous weights
+    for (auto& snapshot : snapshots) {
+      CopyFromTo(snapshot.first, &snapshot.second, priority);
+    }
+  }
 
-      CHECK_NOTNULL(Engine::Get())->PushAsync(
-          pull_from_servers,
-          pinned_ctx_,
-          {},
-          {recv_buf.var()},
-          FnProperty::kNormal,
-          priority,
-          "KVStoreDistDefaultStoragePull");
+  void PullDefault(int key, const NDArray& recv_buf, int priority) {
+    auto pull_from_servers = [this, key, recv_buf](
+        RunContext rctx, Engine::CallbackOnComplete cb) {
+      // convert to ps keys
+      size_t size = recv_buf.shape().Size();
+      const int dtype = recv_buf.dtype();
+      const int num_bytes = mshadow::mshadow_sizeof(dtype);
+      PSKV& pskv = (gradient_compression_->get_type() == CompressionType::kNone) ?
+                    EncodeDefaultKey(key, size, num_bytes) :
+                    EncodeCompressedKey(key, size, false, num_bytes);
+      char* data = static_cast<char*> (recv_buf.data().dptr_);
+      // false means not to delete data when SArray is deleted
+      auto vals = new ps::SArray<char>(data, size * num_bytes, false);
+      // issue pull
+      RequestType mode = (gradient_compression_->get_type() != CompressionType::kNone) ?
+                RequestType::kCompressedPushPull : RequestType::kDefaultPushPull;
+      const int cmd = GetCommandType(mode, dtype);
+      CHECK_NOTNULL(ps_worker_)->ZPull(
+        pskv.keys, vals, &pskv.lens, cmd, [vals, cb](){ delete vals; cb(); });
+    };
 
-      comm_->Broadcast(key, recv_buf, grouped_vals[i], priority);
-    }
+    CHECK_NOTNULL(Engine::Get())->PushAsync(
+        pull_from_servers,
+        pinned_ctx_,
+        {},
+        {recv_buf.var()},
+        FnProperty::kNormal,
+        priority,
+        "KVStoreDistDefaultStoragePull");
   }
 
   void PullRowSparseImpl(const std::vector<int>& keys,
@@ -306,6 +388,8 @@ class KVStoreDist : public KVStoreLocal {
     std::vector<std::vector<NDArray> > grouped_vals;
     GroupKVPairsPush(keys, values, &uniq_keys, &grouped_vals);
 
+    std::vector<int> fused_keys;
+    std::vector<NDArray> fused_bufs;
     for (size_t i = 0; i < uniq_keys.size(); ++i) {
       // merge over devices
       int key = uniq_keys[i];
@@ -314,6 +398,19 @@ class KVStoreDist : public KVStoreLocal {
 
       const auto storage_type = merged.storage_type();
       auto &comm_buf = comm_buf_[key];
+      // compressed gradients on a gpu are quantized there, so only the
+      // compressed data is copied to the host
+      if (merged.ctx().dev_mask() != cpu::kDevMask && do_merge &&
+          storage_type == kDefaultStorage && merged.dtype() == mshadow::kFloat32 &&
+          gradient_compression_->get_type() != CompressionType::kNone) {
+        if (comm_buf.is_none()) {
+          comm_buf = NDArray(merged.shape(), pinned_ctx_, true, merged.dtype());
+        }
+        PSKV &pskv = EncodeCompressedKey(key, merged.shape().Size(), true,
+                                         mshadow::mshadow_sizeof(merged.dtype()));
+        PushCompressed(key, merged, pskv, priority);
+        continue;
+      }
       if (merged.ctx().dev_mask() == cpu::kDevMask) {
         // Start of a push doesn't guarantee that the previous pushes are completed.
         // This shouldn't affect training of networks though because training involves
@@ -330,13 +427,21 @@ class KVStoreDist : public KVStoreLocal {
         }
         CopyFromTo(merged, &comm_buf);
       }
-      const int dtype = merged.dtype();
+      NDArray send_buf = comm_buf;
+      if (UseHalfWire(comm_buf)) {
+        send_buf = HalfBuffer(key, comm_buf);
+        CastArray(comm_buf, send_buf, priority);
+      }
+      const int dtype = send_buf.dtype();
       const int num_bytes = mshadow::mshadow_sizeof(dtype);
       // push to servers
-      if (storage_type == kDefaultStorage) {
+      if (IsFusable(send_buf)) {
+        fused_keys.push_back(key);
+        fused_bufs.push_back(send_buf);
+      } else if (storage_type == kDefaultStorage) {
         if (gradient_compression_->get_type() == CompressionType::kNone) {
-          PSKV& pskv = EncodeDefaultKey(key, comm_buf.shape().Size(), num_bytes);
-          PushDefault(key, comm_buf, pskv, priority);
+          PSKV& pskv = EncodeDefaultKey(key, send_buf.shape().Size(), num_bytes);
+          PushDefault(key, send_buf, pskv, priority);
         } else {
           CHECK_EQ(dtype, mshadow::kFloat32) << "Gradient compression is only supported for "
                                              << "float32 type of parameters";
@@ -362,6 +467,179 @@ class KVStoreDist : public KVStoreLocal {
         LOG(FATAL) << "unknown storage type";
       }
     }
+    for (const auto& bucket : MakeFusionBuckets(fused_keys, fused_bufs)) {
+      if (bucket.keys.size() == 1) {
+        PushDefault(bucket.keys[0], bucket.bufs[0], bucket.pskv[0], priority);
+      } else {
+        PushFused(bucket, priority);
+      }
+    }
+  }
+
+  /**
+   * \brief whether a key is sent and received as float16
+   */
+  inline bool UseHalfWire(const NDArray& buf) const {
+    return fp16_wire_ && buf.storage_type() == kDefaultStorage &&
+           buf.dtype() == mshadow::kFloat32 &&
+           gradient_compression_->get_type() == CompressionType::kNone;
+  }
+
+  /**
+   * \brief the float16 array a key is sent and received through
+   */
+  NDArray HalfBuffer(int key, const NDArray& buf) {
+    auto& half = half_buf_[key];
+    if (half.is_none()) {
+      half = NDArray(buf.shape(), pinned_ctx_, true, mshadow::kFloat16);
+    }
+    return half;
+  }
+
+  /**
+   * \brief convert a float32 array to float16 or back
+   */
+  void CastArray(const NDArray& from, const NDArray& to, int priority) {
+    Engine::Get()->PushSync([from, to](RunContext rctx) {
+        using mshadow::half::half_t;
+        if (from.dtype() == mshadow::kFloat32) {
+          mshadow::Tensor<cpu, 1, half_t> dst = to.data().FlatTo1D<cpu, half_t>();
+          dst = mshadow::expr::tcast<half_t>(from.data().FlatTo1D<cpu, float>());
+        } else {
+          mshadow::Tensor<cpu, 1, float> dst = to.data().FlatTo1D<cpu, float>();
+          dst = mshadow::expr::tcast<float>(from.data().FlatTo1D<cpu, half_t>());
+        }
+      }, pinned_ctx_, {from.var()}, {to.var()},
+      FnProperty::kNormal, priority, "KVStoreDistCast");
+  }
+
+  /**
+   * \brief small dense keys sent to the servers in a single request
+   */
+  struct FusionBucket {
+    std::vector<int> keys;
+    std::vector<NDArray> bufs;
+    std::vector<PSKV> pskv;
+    size_t num_bytes = 0;
+  };
+
+  /**
+   * \brief whether a key can share a request with other keys. only dense,
+   * uncompressed keys that live on a single server are fused.
+   */
+  inline bool IsFusable(const NDArray& buf) const {
+    return fusion_bucket_bytes_ > 0 &&
+           buf.storage_type() == kDefaultStorage &&
+           gradient_compression_->get_type() == CompressionType::kNone &&
+           buf.shape().Size() < bigarray_bound_;
+  }
+
+  /**
+   * \brief group keys of the same dtype in ps key order into buckets of at
+   * most fusion_bucket_bytes_ bytes
+   */
+  std::vector<FusionBucket> MakeFusionBuckets(const std::vector<int>& keys,
+                                              const std::vector<NDArray>& bufs) {
+    std::vector<size_t> order(keys.size());
+    std::vector<ps::Key> ps_keys(keys.size());
+    std::vector<PSKV> pskvs(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      order[i] = i;
+      pskvs[i] = EncodeDefaultKey(keys[i], bufs[i].shape().Size(),
+                                  mshadow::mshadow_sizeof(bufs[i].dtype()));
+      ps_keys[i] = pskvs[i].keys[0];
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      if (bufs[a].dtype() != bufs[b].dtype()) return bufs[a].dtype() < bufs[b].dtype();
+      return ps_keys[a] < ps_keys[b];
+    });
+    std::vector<FusionBucket> buckets;
+    for (size_t i : order) {
+      const size_t num_bytes = pskvs[i].size;
+      if (buckets.empty() ||
+          buckets.back().bufs[0].dtype() != bufs[i].dtype() ||
+          buckets.back().num_bytes + num_bytes > fusion_bucket_bytes_) {
+        buckets.emplace_back();
+      }
+      auto& bucket = buckets.back();
+      bucket.keys.push_back(keys[i]);
+      bucket.bufs.push_back(bufs[i]);
+      bucket.pskv.push_back(pskvs[i]);
+      bucket.num_bytes += num_bytes;
+    }
+    return buckets;
+  }
+
+  /**
+   * \brief push the keys of a bucket with one ZPush. ps-lite slices the
+   * request by server key range, so every server gets one message.
+   */
+  void PushFused(const FusionBucket& bucket, int priority) {
+    std::vector<Engine::VarHandle> const_vars;
+    for (const auto& buf : bucket.bufs) const_vars.push_back(buf.var());
+    auto push_to_servers =
+        [this, bucket](RunContext rctx, Engine::CallbackOnComplete cb) {
+          ps::SArray<ps::Key> keys;
+          ps::SArray<int> lens;
+          ps::SArray<char> vals(bucket.num_bytes);
+          size_t offset = 0;
+          for (size_t i = 0; i < bucket.keys.size(); ++i) {
+            const int len = bucket.pskv[i].size;
+            keys.push_back(bucket.pskv[i].keys[0]);
+            lens.push_back(len);
+            memcpy(vals.data() + offset, bucket.bufs[i].data().dptr_, len);
+            offset += len;
+          }
+          const int cmd = GetCommandType(RequestType::kFusedPushPull, bucket.bufs[0].dtype());
+          CHECK_NOTNULL(ps_worker_)->ZPush(keys, vals, lens, cmd, [cb]() { cb(); });
+        };
+    Engine::Get()->PushAsync(
+        push_to_servers,
+        pinned_ctx_,
+        const_vars,
+        {},
+        FnProperty::kNormal,
+        priority,
+        "KVStoreDistFusedPush");
+  }
+
+  /**
+   * \brief pull the keys of a bucket with one ZPull and scatter the reply
+   * into the receive buffers
+   */
+  void PullFused(const FusionBucket& bucket, int priority) {
+    std::vector<Engine::VarHandle> mutable_vars;
+    for (const auto& buf : bucket.bufs) mutable_vars.push_back(buf.var());
+    auto pull_from_servers =
+        [this, bucket](RunContext rctx, Engine::CallbackOnComplete cb) {
+          ps::SArray<ps::Key> keys;
+          auto lens = new ps::SArray<int>();
+          for (size_t i = 0; i < bucket.keys.size(); ++i) {
+            keys.push_back(bucket.pskv[i].keys[0]);
+            lens->push_back(bucket.pskv[i].size);
+          }
+          auto vals = new ps::SArray<char>(bucket.num_bytes);
+          const int cmd = GetCommandType(RequestType::kFusedPushPull, bucket.bufs[0].dtype());
+          CHECK_NOTNULL(ps_worker_)->ZPull(
+            keys, vals, lens, cmd, [bucket, vals, lens, cb]() {
+              size_t offset = 0;
+              for (size_t i = 0; i < bucket.bufs.size(); ++i) {
+                memcpy(bucket.bufs[i].data().dptr_, vals->data() + offset, (*lens)[i]);
+                offset += (*lens)[i];
+              }
+              delete vals;
+              delete lens;
+              cb();
+            });
+        };
+    CHECK_NOTNULL(Engine::Get())->PushAsync(
+        pull_from_servers,
+        pinned_ctx_,
+        {},
+        mutable_vars,
+        FnProperty::kNormal,
+        priority,
+        "KVStoreDistFusedPull");
   }
 
   void PushCompressed(int key, const NDArray& comm_buf, const PSKV& pskv, int priority) {
@@ -372,11 +650,27 @@ class KVStoreDist : public KVStoreLocal {
 
     // Init the small buffer and residual_ buffer for quantize
     if (small_buf.is_none()) {
-      small_buf = NDArray(TShape{pskv.size}, comm_buf.ctx(), false, dtype);
+      small_buf = NDArray(TShape{pskv.size}, pinned_ctx_, false, dtype);
       res_buf = NDArray(TShape{static_cast<int64_t>(original_size)}, comm_buf.ctx(), false, dtype);
       res_buf = 0;
+    } else if (res_buf.ctx() != comm_buf.ctx()) {
+      res_buf = res_buf.Copy(comm_buf.ctx());
+    }
+    if (comm_buf.ctx().dev_mask() == cpu::kDevMask) {
+      gradient_compression_->Quantize(comm_buf, &small_buf, &res_buf, priority);
+    } else {
+      // the copy to the host runs on the copy stream, overlapping with the
+      // quantization of the next key
+      auto &dev_buf = compr_dev_buf_[key];
+      if (dev_buf.is_none()) {
+        dev_buf = NDArray(TShape{pskv.size}, comm_buf.ctx(), false, dtype);
+      }
+      gradient_compression_->Quantize(comm_buf, &dev_buf, &res_buf, priority);
+      CopyFromTo(dev_buf, &small_buf, priority);
     }
-    gradient_compression_->Quantize(comm_buf, &small_buf, &res_buf, priority);
+    // pulls receive into the comm_buf_ of the key
+    std::vector<Engine::VarHandle> const_vars = {small_buf.var(), comm_buf.var()};
+    if (comm_buf_[key].var() != comm_buf.var()) const_vars.push_back(comm_buf_[key].var());
     auto push_to_servers =
       [this, key, dtype, pskv, small_buf](RunContext rctx, Engine::CallbackOnComplete cb) {
         size_t size = small_buf.shape().Size() * mshadow::mshadow_sizeof(dtype);
@@ -391,7 +685,7 @@ class KVStoreDist : public KVStoreLocal {
     Engine::Get()->PushAsync(
       push_to_servers,
       pinned_ctx_,
-      {small_buf.var(), comm_buf.var()},
+      const_vars,
       {},
       FnProperty::kNormal,
       priority,
@@ -480,13 +774,18 @@ class KVStoreDist : public KVStoreLocal {
         LOG(INFO) << "worker " << get_rank() << " pull lens: " << pskv.lens << " keys: "
                   << pskv.keys << " size: " << size;
       }
-      auto vals = new ps::SArray<char>(data, size * num_bytes, false);
       const int cmd = GetCommandType(RequestType::kRowSparsePushPull, recv_buf.dtype());
       // copy indices to recv_buf. this needs to be done before ZPull
       // because after pull is done, the callback function returns and locks are released.
       // at this point, later functions may access the indices variable while copy happens
       mshadow::Copy(recv_buf.aux_data(kIdx).FlatTo1D<cpu, int64_t>(),
                     idx_data.FlatTo1D<cpu, int64_t>());
+      if (rsp_cache_rows_ > 0 && num_rows > 0) {
+        PullRowSparseCached(key, recv_buf, pskv, std::vector<int64_t>(offsets, offsets + num_rows),
+                            unit_len, cb);
+        return;
+      }
+      auto vals = new ps::SArray<char>(data, size * num_bytes, false);
       CHECK_NOTNULL(ps_worker_)->ZPull(pskv.keys, vals, &pskv.lens,
                                        cmd,
                                        [vals, cb]() { delete vals; cb(); });
@@ -501,6 +800,126 @@ class KVStoreDist : public KVStoreLocal {
       "KVStoreDistRowSparsePull");
   }
 
+  /**
+   * \brief rows of a row sparse key kept by the worker, least recently used first out
+   */
+  struct RowCache {
+    struct Entry {
+      int64_t version;
+      std::vector<char> data;
+      std::list<int64_t>::iterator pos;
+    };
+    std::unordered_map<int64_t, Entry> rows;
+    std::list<int64_t> lru;
+  };
+
+  /**
+   * \brief pull the rows of recv_buf in two rounds: first their versions,
+   * then only the rows that are missing from the cache or out of date.
+   * runs inside the engine operation of the pull, which owns recv_buf.
+   * \param pskv ps keys of all rows
+   * \param rows row ids, sorted
+   * \param cb completion callback of the engine operation
+   */
+  void PullRowSparseCached(const int key, const NDArray& recv_buf, const PSKV& pskv,
+                           const std::vector<int64_t>& rows, const size_t unit_len,
+                           Engine::CallbackOnComplete cb) {
+    const int dtype = recv_buf.dtype();
+    const size_t row_bytes = unit_len * mshadow::mshadow_sizeof(dtype);
+    ps::SArray<ps::Key> keys;
+    keys.CopyFrom(pskv.keys);
+    auto lens = new ps::SArray<int>(pskv.lens.size());
+    for (size_t i = 0; i < pskv.lens.size(); ++i) {
+      (*lens)[i] = pskv.lens[i] == 0 ? 0 : sizeof(int64_t);
+    }
+    auto versions = new ps::SArray<char>(rows.size() * sizeof(int64_t));
+    const int cmd = GetCommandType(RequestType::kRowSparseVersionPull, dtype);
+    CHECK_NOTNULL(ps_worker_)->ZPull(keys, versions, lens, cmd,
+      [this, key, recv_buf, rows, row_bytes, unit_len, versions, lens, cb]() {
+        const int64_t* version = reinterpret_cast<const int64_t*>(versions->data());
+        std::vector<int64_t> row_version(version, version + rows.size());
+        delete versions;
+        delete lens;
+        mu_.lock();
+        RowCache& cache = rsp_cache_[key];
+        mu_.unlock();
+        std::vector<int64_t> missing;
+        for (size_t i = 0; i < rows.size(); ++i) {
+          auto it = cache.rows.find(rows[i]);
+          if (it == cache.rows.end() || it->second.version != row_version[i]) {
+            missing.push_back(rows[i]);
+          }
+        }
+        *rsp_cache_hits_ += rows.size() - missing.size();
+        *rsp_cache_misses_ += missing.size();
+        if (missing.empty()) {
+          FillFromRowCache(&cache, recv_buf, rows, row_version, missing, nullptr, row_bytes);
+          cb();
+          return;
+        }
+        const int64_t size = missing.size() * unit_len;
+        PSKV miss_pskv;
+        {
+          PSKV& encoded = EncodeRowSparseKey(key, size, missing.size(), missing.data(), unit_len,
+                                             recv_buf.shape()[0],
+                                             mshadow::mshadow_sizeof(recv_buf.dtype()));
+          miss_pskv.keys.CopyFrom(encoded.keys);
+          miss_pskv.lens.CopyFrom(encoded.lens);
+        }
+        auto vals = new ps::SArray<char>(missing.size() * row_bytes);
+        auto miss_lens = new ps::SArray<int>(miss_pskv.lens);
+        const int cmd = GetCommandType(RequestType::kRowSparsePushPull, recv_buf.dtype());
+        CHECK_NOTNULL(ps_worker_)->ZPull(miss_pskv.keys, vals, miss_lens, cmd,
+          [this, &cache, recv_buf, rows, row_version, missing, row_bytes, vals, miss_lens, cb]() {
+            FillFromRowCache(&cache, recv_buf, rows, row_version, missing, vals->data(),
+                             row_bytes);
+            delete vals;
+            delete miss_lens;
+            cb();
+          });
+      });
+  }
+
+  /**
+   * \brief write every requested row into recv_buf, taking the rows in
+   * missing from fetched (in order) and storing them in the cache
+   */
+  void FillFromRowCache(RowCache* cache, const NDArray& recv_buf,
+                        const std::vector<int64_t>& rows,
+                        const std::vector<int64_t>& row_version,
+                        const std::vector<int64_t>& missing,
+                        const char* fetched, const size_t row_bytes) {
+    char* data = static_cast<char*>(recv_buf.data().dptr_);
+    size_t next_missing = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+      char* dst = data + i * row_bytes;
+      if (next_missing < missing.size() && missing[next_missing] == rows[i]) {
+        const char* src = fetched + next_missing * row_bytes;
+        memcpy(dst, src, row_bytes);
+        ++next_missing;
+        auto it = cache->rows.find(rows[i]);
+        if (it == cache->rows.end()) {
+          cache->lru.push_front(rows[i]);
+          it = cache->rows.emplace(rows[i], RowCache::Entry()).first;
+          it->second.pos = cache->lru.begin();
+          it->second.data.resize(row_bytes);
+        } else {
+          cache->lru.splice(cache->lru.begin(), cache->lru, it->second.pos);
+        }
+        it->second.version = row_version[i];
+        memcpy(it->second.data.data(), src, row_bytes);
+      } else {
+        auto& entry = cache->rows.at(rows[i]);
+        cache->lru.splice(cache->lru.begin(), cache->lru, entry.pos);
+        memcpy(dst, entry.data.data(), row_bytes);
+      }
+    }
+    while (cache->rows.size() > rsp_cache_rows_) {
+      cache->rows.erase(cache->lru.back());
+      cache->lru.pop_back();
+    }
+  }
+
   /**
    * \brief check if the keys are all unique
    */
@@ -518,6 +937,37 @@ class KVStoreDist : public KVStoreLocal {
    * \param num_bytes size of each element in number of bytes
    * \return PSKV used for both push and pull
    */
+  /**
+   * \brief assign a key smaller than bigarray_bound_ to the server with the
+   * fewest bytes so far. Every worker inits the same keys in the same order,
+   * so they all compute the same assignment.
+   */
+  void AssignServer(const int key, const NDArray& value) {
+    const int num_servers = ps::Postoffice::Get()->num_servers();
+    CHECK_GT(num_servers, 0);
+    const size_t num_bytes = value.shape().Size() * mshadow::mshadow_sizeof(value.dtype());
+    std::lock_guard<std::mutex> lock(mu_);
+    server_bytes_.resize(num_servers, 0);
+    if (value.shape().Size() >= bigarray_bound_) {
+      // partitioned over all the servers
+      for (auto& bytes : server_bytes_) bytes += num_bytes / num_servers;
+      return;
+    }
+    const int server = std::min_element(server_bytes_.begin(), server_bytes_.end()) -
+                       server_bytes_.begin();
+    server_bytes_[server] += num_bytes;
+    key_server_[key] = server;
+  }
+
+  /**
+   * \brief the server holding a key smaller than bigarray_bound_
+   */
+  int KeyServer(const int key, const int num_servers) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = key_server_.find(key);
+    return it != key_server_.end() ? it->second : (key * 9973) % num_servers;
+  }
+
   inline PSKV& EncodeDefaultKey(const int key, const size_t num_arr_elems,
                                 const int num_bytes) {
     mu_.lock();
@@ -534,8 +984,8 @@ class KVStoreDist : public KVStoreLocal {
 
       // a simple heuristic for load balance
       if (num_arr_elems < bigarray_bound_) {
-        // send it to a single random picked server
-        int server = (key * 9973) % num_servers;
+        // send it to a single server
+        int server = KeyServer(key, num_servers);
         ps::Key ps_key = krs[server].begin() + key;
         CHECK_LT(ps_key, krs[server].end());
         pskv.keys.push_back(ps_key);
@@ -598,9 +1048,8 @@ class KVStoreDist : public KVStoreLocal {
       mu_.unlock();
 
       if (original_num_elem < bigarray_bound_) {
-        // a simple heuristic for load balancing
-        // send it to a single random picked server
-        const int server = (key * 9973) % num_servers;
+        // send it to a single server
+        const int server = KeyServer(key, num_servers);
         ps::Key ps_key = krs[server].begin() + key;
         CHECK_LT(ps_key, krs[server].end());
         // meta info
@@ -626,9 +1075,12 @@ class KVStoreDist : public KVStoreLocal {
             part_compr = compr_num_elem - push_pskv.size;
             part_orig = original_num_elem - pull_pskv.size;
           } else {
-            part_compr =
-              static_cast<size_t> (round(static_cast<double>(compr_num_elem)/num_servers*(i+1))) -
-              static_cast<size_t> (round(static_cast<double>(compr_num_elem)/num_servers*(i)));
+            // split at whole compressed blocks so each server can decompress its part
+            const int unit = gradient_compression_->GetCompressedUnit();
+            const double num_units = static_cast<double>(compr_num_elem / unit);
+            part_compr = unit * (
+              static_cast<size_t> (round(num_units/num_servers*(i+1))) -
+              static_cast<size_t> (round(num_units/num_servers*(i))));
             part_orig = part_compr * gradient_compression_->GetCompressionFactor();
           }
 
@@ -705,8 +1157,8 @@ class KVStoreDist : public KVStoreLocal {
       }
       CHECK_EQ(static_cast<size_t>(pskv.size), num_elem * num_bytes);
     } else {
-      // send it to a single random picked server
-      const int server = (key * 9973) % num_servers;
+      // send it to a single server
+      const int server = KeyServer(key, num_servers);
       ps::Key master_key = krs[server].begin() + key;
       pskv.keys.push_back(master_key);
       pskv.lens.push_back(0);
@@ -733,6 +1185,41 @@ class KVStoreDist : public KVStoreLocal {
    * \brief threshold for partition
    */
   size_t bigarray_bound_;
+  /**
+   * \brief small dense keys of one push or pull are packed into requests of
+   * at most this many bytes, 0 disables fusion
+   */
+  size_t fusion_bucket_bytes_;
+  /**
+   * \brief whether pulls return the weights of the previous pull while the
+   * current one is in flight
+   */
+  bool stale_pull_;
+  /**
+   * \brief weights of the previous pull of each key, handed out by stale pulls
+   */
+  std::unordered_map<int, NDArray> stale_buf_;
+  /**
+   * \brief receive buffer of each key for stale pulls, copied into stale_buf_
+   * once the pull completes
+   */
+  std::unordered_map<int, NDArray> pull_buf_;
+  /**
+   * \brief maximum number of rows cached per row sparse key, 0 disables the cache
+   */
+  size_t rsp_cache_rows_;
+  /**
+   * \brief cached rows of each row sparse key
+   */
+  std::unordered_map<int, RowCache> rsp_cache_;
+  /**
+   * \brief profiler counters of cached rows that were reused or fetched
+   */
+  profiler::ProfileDomain profile_domain_{"KVStoreDist"};
+  std::unique_ptr<profiler::ProfileCounter> rsp_cache_hits_{
+    new profiler::ProfileCounter("RowSparse Cache Hits", &profile_domain_)};
+  std::unique_ptr<profiler::ProfileCounter> rsp_cache_misses_{
+    new profiler::ProfileCounter("RowSparse Cache Misses", &profile_domain_)};
   /**
    * \brief buffer for non-compressed data.
    * When gradient compression is active, this is used
@@ -745,6 +1232,17 @@ class KVStoreDist : public KVStoreLocal {
    * is push
    */
   std::unordered_map<int, NDArray> compr_buf_;
+  /**
+   * \brief compressed data of gradients quantized on a gpu,
+   * before their copy to compr_buf_
+   */
+  std::unordered_map<int, NDArray> compr_dev_buf_;
+  /**
+   * \brief float16 copies of the float32 keys pushed and pulled,
+   * if MXNET_KVSTORE_DIST_FP16 is set
+   */
+  std::unordered_map<int, NDArray> half_buf_;
+  bool fp16_wire_;
   /**
    * \brief residual buffer to accumulate quantization error
    * during gradient compression
@@ -0,0 +1,301 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * @file   kvstore_dist_nccl.h
+ * @brief  allreduce over NCCL communicators spanning the GPUs of several workers
+ */
+#ifndef MXNET_KVSTORE_KVSTORE_DIST_NCCL_H_
+#define MXNET_KVSTORE_KVSTORE_DIST_NCCL_H_
+
+#if MXNET_USE_NCCL
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "./kvstore_nccl.h"
+
+namespace mxnet {
+namespace kvstore {
+
+/**
+ * \brief TCP connections of the workers to worker 0, which only exchange
+ *  the NCCL unique id, the initial values and barriers
+ */
+class Rendezvous {
+ public:
+  Rendezvous(const std::string& host, int port, int rank, int size) : rank_(rank) {
+    if (rank_ == 0) {
+      const int fd = socket(AF_INET, SOCK_STREAM, 0);
+      CHECK_GE(fd, 0) << "Cannot create the rendezvous socket";
+      const int on = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+      sockaddr_in addr;
+      std::memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons(port);
+      CHECK_EQ(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0)
+          << "Cannot bind the rendezvous socket to port " << port;
+      CHECK_EQ(listen(fd, size), 0);
+      // peers are ordered by their rank
+      peers_.resize(size - 1, -1);
+      for (int i = 1; i < size; ++i) {
+        const int peer = accept(fd, nullptr, nullptr);
+        CHECK_GE(peer, 0) << "Rendezvous accept failed";
+        int peer_rank = 0;
+        Recv(peer, &peer_rank, sizeof(peer_rank));
+        CHECK(peer_rank > 0 && peer_rank < size && peers_[peer_rank - 1] < 0)
+            << "Invalid or duplicate worker rank " << peer_rank;
+        peers_[peer_rank - 1] = peer;
+      }
+      close(fd);
+    } else {
+      // worker 0 may not listen yet, so connecting is retried for a minute
+      addrinfo hints, *res = nullptr;
+      std::memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_INET;
+      hints.ai_socktype = SOCK_STREAM;
+      CHECK_EQ(getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res), 0)
+          << "Cannot resolve rendezvous host " << host;
+      int fd = -1;
+      for (int retry = 0; retry < 600 && fd < 0; ++retry) {
+        fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        CHECK_GE(fd, 0) << "Cannot create the rendezvous socket";
+        if (connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+          close(fd);
+          fd = -1;
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+      }
+      freeaddrinfo(res);
+      CHECK_GE(fd, 0) << "Cannot connect to worker 0 at " << host << ":" << port;
+      Send(fd, &rank_, sizeof(rank_));
+      peers_.push_back(fd);
+    }
+  }
+
+  ~Rendezvous() {
+    for (int fd : peers_) close(fd);
+  }
+
+  /*! \brief copy bytes of worker 0 to the other workers */
+  void Broadcast(void* data, size_t size) {
+    for (int fd : peers_) {
+      if (rank_ == 0) {
+        Send(fd, data, size);
+      } else {
+        Recv(fd, data, size);
+      }
+    }
+  }
+
+  /*! \brief wait for all the workers to reach the barrier */
+  void Barrier() {
+    char byte = 0;
+    if (rank_ == 0) {
+      for (int fd : peers_) Recv(fd, &byte, 1);
+      for (int fd : peers_) Send(fd, &byte, 1);
+    } else {
+      Send(peers_[0], &byte, 1);
+      Recv(peers_[0], &byte, 1);
+    }
+  }
+
+ private:
+  static void Send(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+      const ssize_t n = send(fd, p, size, 0);
+      CHECK_GT(n, 0) << "Rendezvous send failed";
+      p += n;
+      size -= n;
+    }
+  }
+  static void Recv(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+      const ssize_t n = recv(fd, p, size, 0);
+      CHECK_GT(n, 0) << "Rendezvous connection closed";
+      p += n;
+      size -= n;
+    }
+  }
+
+  int rank_;
+  // connections to the other workers on worker 0, to worker 0 on the others
+  std::vector<int> peers_;
+};
+
+/**
+ * \brief kvstore allreducing the values of all the GPUs of all the workers,
+ *  without servers. The communicators take the GPUs of worker r as the ranks
+ *  r * num_gpus ... (r + 1) * num_gpus - 1, so every worker needs the same
+ *  number of GPUs. With an updater, every worker updates its own copy of the
+ *  weights with the same sum.
+ */
+class KVStoreDistNCCL : public KVStoreNCCL {
+ public:
+  KVStoreDistNCCL() : KVStoreNCCL() {
+    multi_node_ = true;
+    use_allreduce_ = true;
+    num_workers_ = dmlc::GetEnv("DMLC_NUM_WORKER", 1);
+    rank_ = dmlc::GetEnv("DMLC_WORKER_ID", 0);
+    CHECK(rank_ >= 0 && rank_ < num_workers_)
+        << "DMLC_WORKER_ID must be in [0, DMLC_NUM_WORKER)";
+    const std::string host = dmlc::GetEnv("DMLC_PS_ROOT_URI", std::string("127.0.0.1"));
+    const int port = dmlc::GetEnv("DMLC_PS_ROOT_PORT", 9091);
+    rendezvous_.reset(new Rendezvous(host, port, rank_, num_workers_));
+  }
+
+  virtual ~KVStoreDistNCCL() {
+    Engine::Get()->WaitForAll();
+  }
+
+  int get_rank() const override { return rank_; }
+
+  int get_group_size() const override { return num_workers_; }
+
+  void Barrier() override {
+    Engine::Get()->WaitForAll();
+    rendezvous_->Barrier();
+  }
+
+ private:
+  void InitImpl(const std::vector<int>& keys,
+                const std::vector<NDArray>& values) override {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      CHECK(local_.find(keys[i]) == local_.end())
+          << "duplicate init of key " << keys[i];
+      NDArray& local = local_[keys[i]];
+      local = values[i].Copy(pinned_ctx_);
+      InitKey(keys[i], values[i].storage_type(), values[i].shape(), values[i].dtype());
+      // the values of worker 0 are used, no operation reads the copy yet
+      local.WaitToRead();
+      rendezvous_->Broadcast(local.data().dptr_,
+                             local.shape().Size() * mshadow::mshadow_sizeof(local.dtype()));
+      weights_[keys[i]] = local;
+    }
+  }
+
+  void PushImpl(const std::vector<int>& keys,
+                const std::vector<NDArray>& values,
+                int priority) override {
+    std::vector<int> uniq_keys;
+    std::vector<std::vector<NDArray> > grouped_vals;
+    GroupKVPairsHelper(keys, values, &uniq_keys, &grouped_vals);
+    AllReduce(uniq_keys, grouped_vals, priority);
+    if (updater_ == nullptr) return;
+
+    for (int key : uniq_keys) {
+      const NDArray& merged = reduced_[key][0];
+      NDArray& weight = weights_[key];
+      CHECK(!weight.is_none()) << "key " << key << " has not been inited";
+      if (weight.ctx().dev_mask() == cpu::kDevMask) {
+        weight = weight.Copy(merged.ctx());
+      }
+      if (key_type_ == kStringKey && str_updater_ != nullptr) {
+        str_updater_(reverse_str_key_dict_[key], merged, &weight);
+      } else {
+        updater_(key, merged, &weight);
+      }
+      local_[key] = weight;
+      allreduced_.erase(key);
+    }
+  }
+
+  void PullImpl(const std::vector<int>& keys,
+                const std::vector<NDArray*>& values,
+                int priority) override {
+    std::vector<int> uniq_keys;
+    std::vector<std::vector<NDArray*> > grouped_vals;
+    GroupKVPairsHelper(keys, values, &uniq_keys, &grouped_vals);
+    // NCCL broadcasts would span all the workers, the copies stay on this one
+    for (size_t i = 0; i < uniq_keys.size(); ++i) {
+      const int key = uniq_keys[i];
+      const NDArray& local = local_[key];
+      CHECK(!local.is_none()) << "key " << key << " has not been inited";
+      for (NDArray* dst : grouped_vals[i]) {
+        auto it = nccl_data_.find(dst->ctx().dev_id);
+        if (allreduced_.count(key) && dst->ctx().dev_mask() == gpu::kDevMask &&
+            it != nccl_data_.end()) {
+          CopyFromTo(reduced_[key][it->second.dev_index], *dst, priority);
+        } else {
+          CopyFromTo(local, *dst, priority);
+        }
+      }
+    }
+  }
+
+  void InitNCCL(const std::vector<Context>& devs) override {
+#if NCCL_MAJOR < 2
+    LOG(FATAL) << "dist_allreduce kvstore needs NCCL 2 or later";
+#else
+    for (const auto& dev : devs) {
+      device_ids_.push_back(dev.dev_id);
+    }
+    std::sort(device_ids_.begin(), device_ids_.end());
+    const int num_devs = device_ids_.size();
+    int root_num_devs = num_devs;
+    rendezvous_->Broadcast(&root_num_devs, sizeof(root_num_devs));
+    CHECK_EQ(num_devs, root_num_devs) << "All workers must use the same number of GPUs";
+    ncclUniqueId id;
+    if (rank_ == 0) ncclGetUniqueId(&id);
+    rendezvous_->Broadcast(&id, sizeof(id));
+
+    std::lock_guard<std::mutex> l(Storage::Get()->GetMutex(Context::kGPU));
+    std::vector<ncclComm_t> comms(num_devs);
+    ncclGroupStart();
+    for (int i = 0; i < num_devs; ++i) {
+      CUDA_CALL(cudaSetDevice(device_ids_[i]));
+      ncclCommInitRank(&comms[i], num_workers_ * num_devs, id, rank_ * num_devs + i);
+    }
+    ncclGroupEnd();
+    for (int i = 0; i < num_devs; ++i) {
+      NCCLEntry e;
+      e.dev_id = device_ids_[i];
+      e.comm = comms[i];
+      e.rank = rank_ * num_devs + i;
+      e.dev_index = i;
+      cudaSetDevice(e.dev_id);
+      cudaStreamCreate(&(e.stream));
+      nccl_data_[device_ids_[i]] = e;
+    }
+#endif  // NCCL_MAJOR < 2
+  }
+
+  int rank_;
+  int num_workers_;
+  std::unique_ptr<Rendezvous> rendezvous_;
+  // weights updated by the updater, by key
+  std::unordered_map<int, NDArray> weights_;
+};
+
+}  // namespace kvstore
+}  // namespace mxnet
+#endif  // MXNET_USE_NCCL
+#endif  // MXNET_KVSTORE_KVSTORE_DIST_NCCL_H_
@@ -24,14 +24,22 @@
  */
 #ifndef MXNET_KVSTORE_KVSTORE_DIST_SERVER_H_
 #define MXNET_KVSTORE_KVSTORE_DIST_SERVER_H_
+#include <algorithm>
 #include <queue>
+#include <cstring>
 #include <string>
+#include <map>
+#include <tuple>
 #include <mutex>
 #include <condition_variable>
 #include <memory>
 #include <functional>
+#include <atomic>
+#include <thread>
+#include <numeric>
 #include <future>
 #include <vector>
+#include "dmlc/concurrency.h"
 #include "ps/ps.h"
 #include "mxnet/kvstore.h"
 #include "../operator/tensor/elemwise_binary_op-inl.h"
@@ -46,7 +54,8 @@ enum class CommandType {
 };
 
 enum class RequestType {
-  kDefaultPushPull, kRowSparsePushPull, kCompressedPushPull
+  kDefaultPushPull, kRowSparsePushPull, kCompressedPushPull, kFusedPushPull,
+  kRowSparseVersionPull
 };
 
 struct DataHandleType {
@@ -148,6 +157,30 @@ class Executor {
   std::condition_variable cond_;
 };
 
+/**
+ * \brief runs functions in push order on its own thread
+ */
+class SerialQueue {
+ public:
+  SerialQueue() : thread_([this]() {
+      std::function<void()> func;
+      while (queue_.Pop(&func)) func();
+    }) {}
+
+  ~SerialQueue() {
+    queue_.SignalForKill();
+    thread_.join();
+  }
+
+  void Push(std::function<void()> func) {
+    queue_.Push(std::move(func));
+  }
+
+ private:
+  dmlc::ConcurrentBlockingQueue<std::function<void()>> queue_;
+  std::thread thread_;
+};
+
 class KVStoreDistServer {
  public:
   KVStoreDistServer() {
@@ -160,9 +193,16 @@ class KVStoreDistServer {
     sync_mode_ = false;
     gradient_compression_ = std::make_shared<GradientCompression>();
     log_verbose_ = dmlc::GetEnv("MXNET_KVSTORE_DIST_ROW_SPARSE_VERBOSE", false);
+    merge_nthreads_ = dmlc::GetEnv("MXNET_KVSTORE_SERVER_MERGE_NTHREADS", 4);
+    const int num_threads = dmlc::GetEnv("MXNET_KVSTORE_SERVER_NTHREADS", 1);
+    CHECK_GT(num_threads, 0);
+    if (num_threads > 1) {
+      for (int i = 0; i < num_threads; ++i) shards_.emplace_back(new SerialQueue());
+    }
   }
 
   ~KVStoreDistServer() {
+    shards_.clear();
     delete ps_server_;
   }
 
@@ -189,6 +229,9 @@ class KVStoreDistServer {
     NDArray merged;
     // temp_array is used to cast received values as float32 for computation if required
     NDArray temp_array;
+    // pushes of the current round not summed into merged yet, and the requests owning them
+    std::vector<const char*> pending;
+    std::vector<ps::SArray<char>> pending_owners;
   };
 
   void CommandHandle(const ps::SimpleData& recved, ps::SimpleApp* app) {
@@ -262,6 +305,24 @@ class KVStoreDistServer {
                     const ps::KVPairs<char>& req_data,
                     ps::KVServer<char>* server) {
     DataHandleType type = DepairDataHandleType(req_meta.cmd);
+    if (shards_.empty() || type.requestType == RequestType::kFusedPushPull) {
+      // fused requests span several keys and split themselves over the shards
+      DataHandle(type, req_meta, req_data, server);
+      return;
+    }
+    // every request of a key goes to the same shard, so they keep their order
+    const size_t index = (type.requestType == RequestType::kCompressedPushPull &&
+                          req_meta.push) ? 1 : 0;
+    CHECK_GT(req_data.keys.size(), index);
+    const int key = DecodeKey(req_data.keys[index]);
+    shards_[ShardOf(key)]->Push([this, type, req_meta, req_data, server]() {
+        DataHandle(type, req_meta, req_data, server);
+      });
+  }
+
+  void DataHandle(const DataHandleType type, const ps::KVMeta& req_meta,
+                  const ps::KVPairs<char>& req_data,
+                  ps::KVServer<char>* server) {
     switch (type.requestType) {
       case RequestType::kRowSparsePushPull:
         DataHandleRowSparse(type, req_meta, req_data, server);
@@ -272,6 +333,12 @@ class KVStoreDistServer {
       case RequestType::kDefaultPushPull:
         DataHandleDefault(type, req_meta, req_data, server);
         break;
+      case RequestType::kFusedPushPull:
+        DataHandleFused(type, req_meta, req_data, server);
+        break;
+      case RequestType::kRowSparseVersionPull:
+        DataHandleRowSparseVersion(type, req_meta, req_data, server);
+        break;
     }
   }
 
@@ -283,7 +350,8 @@ class KVStoreDistServer {
                            UpdateBuf *update_buf, ps::KVServer<char>* server) {
     if (!sync_mode_ || update_buf->request.size() == (size_t) ps::NumWorkers()) {
       // let the main thread to execute updater_, which is necessary for python
-      auto& stored = has_multi_precision_copy(type) ? store_realt_[key] : store_[key];
+      auto& stored = has_multi_precision_copy(type) ? Lookup(&store_realt_, key)
+                                                    : Lookup(&store_, key);
       auto& update =  sync_mode_ ? update_buf->merged : update_buf->temp_array;
       if (updater_) {
         exec_.Exec([this, key, &update, &stored](){
@@ -299,17 +367,65 @@ class KVStoreDistServer {
       if (log_verbose_)  {
         LOG(INFO) << "sent response to " << update_buf->request.size() << " workers";
       }
+      if (type.requestType == RequestType::kRowSparsePushPull) {
+        // rows stay unchanged unless they were updated, workers caching rows rely on this
+        stored.WaitToRead();
+        BumpRowVersions(key, update);
+      }
       for (const auto& req : update_buf->request) {
-        server->Response(req);
+        Respond(req, server);
       }
       update_buf->request.clear();
-      if (has_multi_precision_copy(type)) CopyFromTo(stored, store_[key]);
+      if (has_multi_precision_copy(type)) CopyFromTo(stored, Lookup(&store_, key));
       stored.WaitToRead();
     } else {
       update_buf->merged.WaitToRead();
     }
   }
 
+  /**
+   * \brief increase the version of the rows in the row sparse gradient
+   * applied to master_key. versions are only kept once a worker asked for them.
+   */
+  void BumpRowVersions(const int master_key, const NDArray& grad) {
+    auto& versions = Lookup(&row_version_, master_key);
+    if (versions.empty() || grad.storage_initialized() == false) return;
+    const TBlob idx = grad.aux_data(rowsparse::kIdx);
+    MSHADOW_IDX_TYPE_SWITCH(idx.type_flag_, IType, {
+      const IType* rows = idx.dptr<IType>();
+      for (size_t i = 0; i < idx.Size(); ++i) ++versions[rows[i]];
+    });
+  }
+
+  /**
+   * \brief respond to a pull of the versions of some rows of a row sparse
+   * key, one int64 per row, laid out like a row sparse pull
+   */
+  void DataHandleRowSparseVersion(const DataHandleType type, const ps::KVMeta& req_meta,
+                                  const ps::KVPairs<char>& req_data,
+                                  ps::KVServer<char>* server) {
+    CHECK(!req_meta.push) << "row versions can only be pulled";
+    const int master_key = DecodeKey(req_data.keys[0]);
+    const size_t num_rows = req_data.keys.size() - 1;
+    const NDArray& stored = Lookup(&store_, master_key);
+    CHECK(!stored.is_none()) << "init " << master_key << " first";
+    auto& versions = Lookup(&row_version_, master_key);
+    if (versions.empty()) versions.resize(stored.shape()[0], 0);
+    ps::KVPairs<char> response;
+    response.keys = req_data.keys;
+    std::vector<int> lens(req_data.keys.size(), sizeof(int64_t));
+    lens[0] = 0;
+    response.lens.CopyFrom(lens.begin(), lens.end());
+    response.vals.resize(num_rows * sizeof(int64_t));
+    int64_t* out = reinterpret_cast<int64_t*>(response.vals.data());
+    for (size_t i = 1; i <= num_rows; i++) {
+      const int64_t row_id = DecodeKey(req_data.keys[i]) - master_key;
+      CHECK_LT(row_id, static_cast<int64_t>(versions.size()));
+      out[i - 1] = versions[row_id];
+    }
+    server->Response(req_meta, response);
+  }
+
   void DecodeRowIds(const ps::SArray<ps::Key> &keys, int64_t *indices,
                     const int64_t master_key, const int64_t num_rows) {
     indices[0] = 0;
@@ -357,7 +473,7 @@ class KVStoreDistServer {
       server->Response(req_meta, response);
       return;
     }
-    const NDArray& stored = store_[master_key];
+    const NDArray& stored = Lookup(&store_, master_key);
     if (has_multi_precision_copy(type)) stored.WaitToRead();
     CHECK(!stored.is_none()) << "init " << master_key << " first";
     auto shape = stored.shape();
@@ -391,7 +507,8 @@ class KVStoreDistServer {
                            const ps::KVMeta& req_meta,
                            const ps::KVPairs<char>& req_data,
                            ps::KVServer<char>* server) {
-    auto& stored = has_multi_precision_copy(type) ? store_realt_[master_key] : store_[master_key];
+    auto& stored = has_multi_precision_copy(type) ? Lookup(&store_realt_, master_key)
+                                                  : Lookup(&store_, master_key);
     int dtype = type.dtype;
     int num_bytes = mshadow::mshadow_sizeof(dtype);
     auto unit_len = req_data.lens[1] / num_bytes;
@@ -407,7 +524,8 @@ class KVStoreDistServer {
     stored = NDArray(kRowSparseStorage, dshape, Context(), true,
                      has_multi_precision_copy(type) ? mshadow::kFloat32 : type.dtype);
     if (has_multi_precision_copy(type)) {
-      store_[master_key] = NDArray(kRowSparseStorage, dshape, Context(), true, type.dtype);
+      Lookup(&store_, master_key) = NDArray(kRowSparseStorage, dshape, Context(), true,
+                                            type.dtype);
     }
     Engine::Get()->PushAsync(
     [this, recved, stored, type](RunContext ctx, Engine::CallbackOnComplete on_complete) {
@@ -427,8 +545,8 @@ class KVStoreDistServer {
     }, recved.ctx(), {recved.var()}, {stored.var()},
     FnProperty::kNormal, 0, PROFILER_MESSAGE_FUNCNAME);
     if (has_multi_precision_copy(type)) {
-      CopyFromTo(stored, store_[master_key]);
-      store_[master_key].WaitToRead();
+      CopyFromTo(stored, Lookup(&store_, master_key));
+      Lookup(&store_, master_key).WaitToRead();
     }
     stored.WaitToRead();
     server->Response(req_meta);
@@ -439,7 +557,7 @@ class KVStoreDistServer {
                            ps::KVServer<char>* server) {
     int master_key = DecodeKey(req_data.keys[0]);
     auto num_rows = req_data.keys.size() - 1;
-    auto& stored = store_[master_key];
+    auto& stored = Lookup(&store_, master_key);
     if (req_meta.push) {
       CHECK_GT(req_data.lens.size(), 0) << "req_data.lens cannot be empty";
       CHECK_EQ(req_data.lens[0], 0);
@@ -451,7 +569,7 @@ class KVStoreDistServer {
         return;
       } else {
         if (log_verbose_) LOG(INFO) << "push: " << master_key << " " << req_data.keys;
-        auto& updates = update_buf_[master_key];
+        auto& updates = Lookup(&update_buf_, master_key);
         if (sync_mode_ && updates.merged.is_none()) {
           updates.merged = NDArray(kRowSparseStorage, stored.shape(), Context(), true,
                                    has_multi_precision_copy(type) ? mshadow::kFloat32 : type.dtype);
@@ -523,7 +641,7 @@ class KVStoreDistServer {
                               const ps::KVPairs<char> &req_data,
                               ps::KVServer<char>* server) {
     ps::KVPairs<char> response;
-    const NDArray& stored = store_[key];
+    const NDArray& stored = Lookup(&store_, key);
     CHECK(!stored.is_none()) << "init " << key << " first";
 
     // as server returns when store_realt is ready in this case
@@ -555,14 +673,14 @@ class KVStoreDistServer {
 
       int original_size = DecodeKey(req_data.keys[0]);
       int key = DecodeKey(req_data.keys[1]);
-      auto& stored = store_[key];
+      auto& stored = Lookup(&store_, key);
 
       size_t ds[] = {(size_t)req_data.lens[1] / mshadow::mshadow_sizeof(type.dtype)};
       TShape dshape(ds, ds + 1);
       TBlob recv_blob(reinterpret_cast<real_t*>(req_data.vals.data()), dshape, cpu::kDevMask);
       NDArray recved = NDArray(recv_blob, 0);
 
-      NDArray decomp_buf = decomp_buf_[key];
+      NDArray decomp_buf = Lookup(&decomp_buf_, key);
       dshape = TShape{(int64_t) original_size};
 
       if (decomp_buf.is_none()) {
@@ -576,7 +694,7 @@ class KVStoreDistServer {
         stored.WaitToRead();
       } else if (sync_mode_) {
         // synced push
-        auto& merged = update_buf_[key];
+        auto& merged = Lookup(&update_buf_, key);
         if (merged.merged.is_none()) {
           merged.merged = NDArray(dshape, Context());
         }
@@ -616,65 +734,230 @@ class KVStoreDistServer {
       CHECK_EQ(req_data.vals.size(), (size_t)req_data.lens[0]);
     }
     int key = DecodeKey(req_data.keys[0]);
-    auto& stored = has_multi_precision_copy(type) ? store_realt_[key] : store_[key];
+    if (req_meta.push) {
+      DefaultStoragePush(type, key, req_data.vals.data(), req_data.lens[0], req_data.vals,
+                         req_meta, server);
+    } else {
+      DefaultStorageResponse(type, key, req_meta, req_data, server);
+    }
+  }
+
+  /**
+   * \brief merge or initialize one key of a dense push request
+   * \param data the pushed values of this key
+   * \param num_bytes size of data in bytes
+   * \param owner the received values data points into
+   */
+  void DefaultStoragePush(const DataHandleType type, const int key,
+                          char* data, const size_t num_bytes,
+                          const ps::SArray<char>& owner,
+                          const ps::KVMeta& req_meta,
+                          ps::KVServer<char>* server) {
+    auto& stored = has_multi_precision_copy(type) ? Lookup(&store_realt_, key)
+                                                  : Lookup(&store_, key);
     // there used several WaitToRead, this is because \a recved's memory
     // could be deallocated when this function returns. so we need to make sure
     // the operators with \a NDArray are actually finished
-    if (req_meta.push) {
-      size_t ds[] = {(size_t) req_data.lens[0] / mshadow::mshadow_sizeof(type.dtype)};
-      TShape dshape(ds, ds + 1);
-      TBlob recv_blob;
-      MSHADOW_REAL_TYPE_SWITCH(type.dtype, DType, {
-        recv_blob = TBlob(reinterpret_cast<DType*>(req_data.vals.data()), dshape, cpu::kDevMask);
-      })
-      NDArray recved = NDArray(recv_blob, 0);
-      if (stored.is_none()) {
-        // initialization
-        stored = NDArray(dshape, Context(), false,
-                         has_multi_precision_copy(type) ? mshadow::kFloat32 : type.dtype);
-        CopyFromTo(recved, &stored, 0);
-        server->Response(req_meta);
-        if (has_multi_precision_copy(type)) {
-          auto& stored_dtype = store_[key];
-          stored_dtype = NDArray(dshape, Context(), false, type.dtype);
-          CopyFromTo(stored, stored_dtype);
-          stored_dtype.WaitToRead();
-        }
-        stored.WaitToRead();
-      } else {
-        auto &updates = update_buf_[key];
-        if (sync_mode_ && updates.merged.is_none()) {
-          updates.merged = NDArray(dshape, Context(), false,
-                                   has_multi_precision_copy(type) ? mshadow::kFloat32 : type.dtype);
-        }
-        if (has_multi_precision_copy(type) && updates.temp_array.is_none()) {
-          updates.temp_array = NDArray(dshape, Context(), false, mshadow::kFloat32);
+    size_t ds[] = {num_bytes / mshadow::mshadow_sizeof(type.dtype)};
+    TShape dshape(ds, ds + 1);
+    TBlob recv_blob;
+    MSHADOW_REAL_TYPE_SWITCH(type.dtype, DType, {
+      recv_blob = TBlob(reinterpret_cast<DType*>(data), dshape, cpu::kDevMask);
+    })
+    NDArray recved = NDArray(recv_blob, 0);
+    if (stored.is_none()) {
+      // initialization
+      stored = NDArray(dshape, Context(), false,
+                       has_multi_precision_copy(type) ? mshadow::kFloat32 : type.dtype);
+      CopyFromTo(recved, &stored, 0);
+      Respond(req_meta, server);
+      if (has_multi_precision_copy(type)) {
+        auto& stored_dtype = Lookup(&store_, key);
+        stored_dtype = NDArray(dshape, Context(), false, type.dtype);
+        CopyFromTo(stored, stored_dtype);
+        stored_dtype.WaitToRead();
+      }
+      stored.WaitToRead();
+    } else {
+      auto &updates = Lookup(&update_buf_, key);
+      if (sync_mode_ && updates.merged.is_none()) {
+        updates.merged = NDArray(dshape, Context(), false,
+                                 has_multi_precision_copy(type) ? mshadow::kFloat32 : type.dtype);
+      }
+      if (has_multi_precision_copy(type) && updates.temp_array.is_none()) {
+        updates.temp_array = NDArray(dshape, Context(), false, mshadow::kFloat32);
+      }
+      if (sync_mode_ && merge_nthreads_ > 0 && !has_multi_precision_copy(type)) {
+        // keep the pushes until all the workers sent theirs, then sum them in one pass
+        updates.pending.push_back(data);
+        updates.pending_owners.push_back(owner);
+        updates.request.push_back(req_meta);
+        if (updates.request.size() == (size_t) ps::NumWorkers()) {
+          MergePending(type.dtype, &updates);
         }
-        if (updates.request.empty()) {
-          if (sync_mode_) {
-            CopyFromTo(recved, updates.merged);
-          } else {
-            if (has_multi_precision_copy(type)) {
-              CopyFromTo(recved, updates.temp_array);
-            } else {
-              updates.temp_array = recved;
-            }
-          }
+        ApplyUpdates(type, key, &updates, server);
+        return;
+      }
+      if (updates.request.empty()) {
+        if (sync_mode_) {
+          CopyFromTo(recved, updates.merged);
         } else {
-          CHECK(sync_mode_);
           if (has_multi_precision_copy(type)) {
             CopyFromTo(recved, updates.temp_array);
-            updates.merged += updates.temp_array;
           } else {
-            updates.merged += recved;
+            updates.temp_array = recved;
           }
         }
-        updates.request.push_back(req_meta);
-        ApplyUpdates(type, key, &updates, server);
+      } else {
+        CHECK(sync_mode_);
+        if (has_multi_precision_copy(type)) {
+          CopyFromTo(recved, updates.temp_array);
+          updates.merged += updates.temp_array;
+        } else {
+          updates.merged += recved;
+        }
       }
+      updates.request.push_back(req_meta);
+      ApplyUpdates(type, key, &updates, server);
+    }
+  }
+
+  /**
+   * \brief sum the pending pushes of a key into its merge buffer. The array is
+   * split into chunks summed in parallel, each reading every push once.
+   */
+  void MergePending(const int dtype, UpdateBuf* updates) {
+    NDArray& merged = updates->merged;
+    merged.WaitToWrite();
+    const size_t size = merged.shape().Size();
+    const size_t chunk = 1 << 16;
+    const index_t num_chunks = (size + chunk - 1) / chunk;
+    MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
+      DType* out = merged.data().dptr<DType>();
+      std::vector<const DType*> ins;
+      for (const char* p : updates->pending) ins.push_back(reinterpret_cast<const DType*>(p));
+      #pragma omp parallel for num_threads(merge_nthreads_)
+      for (index_t c = 0; c < num_chunks; ++c) {
+        const size_t begin = c * chunk;
+        const size_t end = std::min(begin + chunk, size);
+        std::copy(ins[0] + begin, ins[0] + end, out + begin);
+        for (size_t j = 1; j < ins.size(); ++j) {
+          for (size_t i = begin; i < end; ++i) out[i] += ins[j][i];
+        }
+      }
+    });
+    updates->pending.clear();
+    updates->pending_owners.clear();
+  }
+
+  /**
+   * \brief handle a request carrying several small dense keys at once.
+   * Every key is merged and updated like a default push; the request is
+   * answered once all of its keys have been applied.
+   */
+  void DataHandleFused(const DataHandleType type, const ps::KVMeta& req_meta,
+                       const ps::KVPairs<char> &req_data,
+                       ps::KVServer<char>* server) {
+    const size_t num_keys = req_data.keys.size();
+    if (req_meta.push) {
+      CHECK_EQ(req_data.lens.size(), num_keys);
+      std::vector<size_t> offsets(num_keys + 1, 0);
+      for (size_t i = 0; i < num_keys; ++i) offsets[i + 1] = offsets[i] + req_data.lens[i];
+      CHECK_EQ(offsets[num_keys], req_data.vals.size());
+      {
+        std::lock_guard<std::mutex> lock(fused_mu_);
+        fused_pending_[RequestId(req_meta)] = num_keys;
+      }
+      RunSharded(req_data.keys, [this, type, req_meta, req_data, offsets, server](
+          const std::vector<size_t>& owned) {
+        for (size_t i : owned) {
+          DefaultStoragePush(type, DecodeKey(req_data.keys[i]),
+                             req_data.vals.data() + offsets[i], req_data.lens[i],
+                             req_data.vals, req_meta, server);
+        }
+      });
     } else {
-      DefaultStorageResponse(type, key, req_meta, req_data, server);
+      auto response = std::make_shared<ps::KVPairs<char>>();
+      response->keys = req_data.keys;
+      response->lens.resize(num_keys);
+      std::vector<size_t> offsets(num_keys + 1, 0);
+      for (size_t i = 0; i < num_keys; ++i) {
+        const int key = DecodeKey(req_data.keys[i]);
+        const NDArray& stored = Lookup(&store_, key);
+        CHECK(!stored.is_none()) << "init " << key << " first";
+        response->lens[i] = stored.shape().Size() * mshadow::mshadow_sizeof(stored.dtype());
+        offsets[i + 1] = offsets[i] + response->lens[i];
+      }
+      response->vals.resize(offsets[num_keys]);
+      auto remaining = std::make_shared<std::atomic<size_t>>(num_keys);
+      RunSharded(req_data.keys, [this, type, req_meta, offsets, response, remaining, server](
+          const std::vector<size_t>& owned) {
+        for (size_t i : owned) {
+          const NDArray& stored = Lookup(&store_, DecodeKey(response->keys[i]));
+          if (has_multi_precision_copy(type) || !shards_.empty()) stored.WaitToRead();
+          memcpy(response->vals.data() + offsets[i], stored.data().dptr_, response->lens[i]);
+        }
+        if (remaining->fetch_sub(owned.size()) == owned.size()) {
+          server->Response(req_meta, *response);
+        }
+      });
+    }
+  }
+
+  /**
+   * \brief split the keys of a request by shard and run fn on the indices
+   * of each part, on the shard threads if there are any
+   */
+  template<typename FRun>
+  void RunSharded(const ps::SArray<ps::Key>& keys, const FRun& fn) {
+    if (shards_.empty()) {
+      std::vector<size_t> owned(keys.size());
+      std::iota(owned.begin(), owned.end(), 0);
+      fn(owned);
+      return;
+    }
+    std::vector<std::vector<size_t>> owned(shards_.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      owned[ShardOf(DecodeKey(keys[i]))].push_back(i);
     }
+    for (size_t s = 0; s < shards_.size(); ++s) {
+      if (owned[s].empty()) continue;
+      const std::vector<size_t>& part = owned[s];
+      shards_[s]->Push([fn, part]() { fn(part); });
+    }
+  }
+
+  inline size_t ShardOf(const int key) const {
+    return static_cast<size_t>(key) % shards_.size();
+  }
+
+  /**
+   * \brief find or insert the entry of key. entries never move once inserted,
+   * so the lock is only held for the lookup itself.
+   */
+  template<typename V>
+  inline V& Lookup(std::unordered_map<int, V>* map, const int key) {
+    std::lock_guard<std::mutex> lock(map_mu_);
+    return (*map)[key];
+  }
+
+  inline std::tuple<int, int, int> RequestId(const ps::KVMeta& req_meta) {
+    return std::make_tuple(req_meta.sender, req_meta.customer_id, req_meta.timestamp);
+  }
+
+  /**
+   * \brief respond to a push, fused requests only once their last key is done
+   */
+  void Respond(const ps::KVMeta& req_meta, ps::KVServer<char>* server) {
+    {
+      std::lock_guard<std::mutex> lock(fused_mu_);
+      auto it = fused_pending_.find(RequestId(req_meta));
+      if (it != fused_pending_.end()) {
+        if (--it->second > 0) return;
+        fused_pending_.erase(it);
+      }
+    }
+    server->Response(req_meta);
   }
 
   int DecodeKey(ps::Key key) {
@@ -709,11 +992,38 @@ class KVStoreDistServer {
    */
   std::unordered_map<int, NDArray> decomp_buf_;
 
+  /**
+   * \brief row_version_ counts the updates of each row of a row sparse key
+   */
+  std::unordered_map<int, std::vector<int64_t>> row_version_;
+
+  /**
+   * \brief number of keys of each fused push request not yet applied,
+   * indexed by (sender, customer id, timestamp)
+   */
+  std::map<std::tuple<int, int, int>, size_t> fused_pending_;
+  std::mutex fused_mu_;
+
+  /**
+   * \brief protects insertion into the maps above when requests are handled
+   * by several shards
+   */
+  std::mutex map_mu_;
+  /**
+   * \brief key-sharded threads handling data requests, empty if requests are
+   * handled on the ps-lite receive thread
+   */
+  std::vector<std::unique_ptr<SerialQueue>> shards_;
+
   Executor exec_;
   ps::KVServer<char>* ps_server_;
 
   // whether to LOG verbose information
   bool log_verbose_;
+  /**
+   * \brief threads summing the pushes of a key in sync mode, 0 to add each push on arrival
+   */
+  int merge_nthreads_;
 
   /*
    * \brief whether to use multi precision mode.
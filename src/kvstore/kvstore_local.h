@@ -36,6 +36,7 @@
 #include "./comm.h"
 #include "./kvstore_utils.h"
 #include "../ndarray/ndarray_function.h"
+#include "../profiler/nvtx.h"
 
 namespace mxnet {
 namespace kvstore {
@@ -53,9 +54,12 @@ class KVStoreLocal : public KVStore {
  public:
   /*
    * \param use_device_comm
+   * \param use_ring_comm reduce on device with CommDeviceRing
    */
-  explicit KVStoreLocal(bool use_device_comm) : KVStore() {
-    if (use_device_comm) {
+  explicit KVStoreLocal(bool use_device_comm, bool use_ring_comm = false) : KVStore() {
+    if (use_device_comm && use_ring_comm) {
+      comm_ = new CommDeviceRing();
+    } else if (use_device_comm) {
       comm_ = new CommDevice();
     } else {
       comm_ = new CommCPU();
@@ -95,6 +99,7 @@ class KVStoreLocal : public KVStore {
   void Push(const std::vector<int>& keys,
             const std::vector<NDArray>& values,
             int priority) override {
+    profiler::nvtx::NVTXRange nvtx_range("KVStore::Push", profiler::nvtx::kKVStore);
     SetKeyType(kIntKey);
     PushImpl(keys, values, priority);
   }
@@ -102,6 +107,7 @@ class KVStoreLocal : public KVStore {
   void Pull(const std::vector<int>& keys,
             const std::vector<NDArray*>& values,
             int priority) override {
+    profiler::nvtx::NVTXRange nvtx_range("KVStore::Pull", profiler::nvtx::kKVStore);
     SetKeyType(kIntKey);
     PullImpl(keys, values, priority);
   }
@@ -109,6 +115,7 @@ class KVStoreLocal : public KVStore {
   void PullRowSparse(const std::vector<int>& keys,
                      const std::vector<std::pair<NDArray*, NDArray>>& val_rowids,
                      int priority = 0) override {
+    profiler::nvtx::NVTXRange nvtx_range("KVStore::PullRowSparse", profiler::nvtx::kKVStore);
     SetKeyType(kIntKey);
     PullRowSparseImpl(keys, val_rowids, priority);
   }
@@ -116,6 +123,7 @@ class KVStoreLocal : public KVStore {
   void Push(const std::vector<std::string>& str_keys,
             const std::vector<NDArray>& values,
             int priority) override {
+    profiler::nvtx::NVTXRange nvtx_range("KVStore::Push", profiler::nvtx::kKVStore);
     SetKeyType(kStringKey);
     std::vector<int> keys(str_keys.size());
     LookupKeys(str_keys, &keys);
@@ -125,6 +133,7 @@ class KVStoreLocal : public KVStore {
   void Pull(const std::vector<std::string>& str_keys,
             const std::vector<NDArray*>& values,
             int priority) override {
+    profiler::nvtx::NVTXRange nvtx_range("KVStore::Pull", profiler::nvtx::kKVStore);
     SetKeyType(kStringKey);
     std::vector<int> keys(str_keys.size());
     LookupKeys(str_keys, &keys);
@@ -134,6 +143,7 @@ class KVStoreLocal : public KVStore {
   void PullRowSparse(const std::vector<std::string>& str_keys,
                      const std::vector<std::pair<NDArray*, NDArray>>& val_rowids,
                      int priority = 0) override {
+    profiler::nvtx::NVTXRange nvtx_range("KVStore::PullRowSparse", profiler::nvtx::kKVStore);
     SetKeyType(kStringKey);
     std::vector<int> keys(str_keys.size());
     LookupKeys(str_keys, &keys);
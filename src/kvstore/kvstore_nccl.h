@@ -28,7 +28,9 @@
 
 #include <mxnet/kvstore.h>
 #include <nccl.h>
+#include <dmlc/parameter.h>
 #include <unordered_map>
+#include <unordered_set>
 #include <bitset>
 #include <vector>
 #include <string>
@@ -66,6 +68,8 @@ class KVStoreNCCL : public KVStoreLocal {
     comm_ = nullptr;
     pinned_ctx_ = Context::CPUPinned(0);
     inited_ = false;
+    use_allreduce_ = dmlc::GetEnv("MXNET_KVSTORE_NCCL_ALLREDUCE", true);
+    fusion_bucket_bytes_ = dmlc::GetEnv("MXNET_KVSTORE_FUSION_BUCKET_BYTES", 4 << 20);
   }
 
   virtual ~KVStoreNCCL() {
@@ -93,6 +97,12 @@ class KVStoreNCCL : public KVStoreLocal {
     std::vector<std::vector<NDArray> > grouped_vals;
     GroupKVPairsHelper(keys, values, &uniq_keys, &grouped_vals);
 
+    // without updater every device pulls the sum back, which one allreduce provides
+    if (updater_ == nullptr && use_allreduce_) {
+      AllReduce(uniq_keys, grouped_vals, priority);
+      return;
+    }
+
     std::vector<const NDArray*> merged_ptrs;
     std::vector<NDArray*> local_ptrs;
     bool nccl_called = false;
@@ -127,6 +137,7 @@ class KVStoreNCCL : public KVStoreLocal {
       int key = uniq_keys[i];
       auto& merged = *(merged_ptrs[i]);
       NDArray& local = *(local_ptrs[i]);
+      allreduced_.erase(key);
       if (updater_ != nullptr) {
         // call the updater with string keys
         // if string keys are used and str_updater_ is available
@@ -153,6 +164,26 @@ class KVStoreNCCL : public KVStoreLocal {
     std::vector<NDArray> locals;
     bool nccl_called = false;
 
+    // keys last pushed by an allreduce have their sum on every device already
+    size_t num_bcast = 0;
+    for (size_t i = 0; i < uniq_keys.size(); ++i) {
+      int key = uniq_keys[i];
+      if (allreduced_.count(key) == 0) {
+        uniq_keys[num_bcast] = key;
+        grouped_vals[num_bcast++] = grouped_vals[i];
+        continue;
+      }
+      const std::vector<NDArray>& reduced = reduced_[key];
+      for (NDArray* dst : grouped_vals[i]) {
+        auto it = nccl_data_.find(dst->ctx().dev_id);
+        CHECK(dst->ctx().dev_mask() == gpu::kDevMask && it != nccl_data_.end())
+            << "NCCL KVStore supports only single set of devices";
+        CopyFromTo(reduced[it->second.dev_index], *dst, priority);
+      }
+    }
+    uniq_keys.resize(num_bcast);
+    grouped_vals.resize(num_bcast);
+
     for (size_t i = 0; i < uniq_keys.size(); ++i) {
       int key = uniq_keys[i];
       const NDArray& local = local_[key];
@@ -164,10 +195,14 @@ class KVStoreNCCL : public KVStoreLocal {
       }
     }
 
+    if (uniq_keys.empty()) return;
     Broadcast(uniq_keys, locals, grouped_vals, priority);
     // Sync after all broadcasts in a group
     if (nccl_called) {
-      const std::vector<const NDArray*> values_copy(values.begin(), values.end());
+      std::vector<const NDArray*> values_copy;
+      for (const auto& dst : grouped_vals) {
+        values_copy.insert(values_copy.end(), dst.begin(), dst.end());
+      }
       CommSync(values_copy, priority);
     }
   }
@@ -204,7 +239,6 @@ class KVStoreNCCL : public KVStoreLocal {
     GroupKVPairs(keys, values, uniq_keys, grouped_vals, validator);
   }
 
- private:
   // Aggregated reductions
   virtual void Reduce(const std::vector<int> keys,
                       const std::vector<std::vector<NDArray>>& srcs,
@@ -312,6 +346,178 @@ class KVStoreNCCL : public KVStoreLocal {
       "KVStoreReduce");
   }
 
+  // Allreduces the values of every key into a copy of their sum on each device.
+  // Keys smaller than the fusion bucket size are packed by type into buckets,
+  // which take one collective each.
+  void AllReduce(const std::vector<int>& keys,
+                 const std::vector<std::vector<NDArray>>& srcs,
+                 int priority) {
+    std::vector<std::vector<NDArray>> reduced(keys.size());
+    std::vector<size_t> large;
+    std::vector<std::vector<size_t>> buckets;
+    // open bucket of each type and its size in bytes
+    std::unordered_map<int, std::pair<size_t, size_t>> open;
+    std::vector<Engine::VarHandle> const_vars;
+    std::vector<Engine::VarHandle> mutate_vars;
+    std::vector<const NDArray*> synced;
+
+    for (size_t k = 0; k < keys.size(); ++k) {
+      const int key = keys[k];
+      auto& src = srcs[k];
+      if (src.size() == 1 && !multi_node_) {
+        local_[key] = src[0];
+        allreduced_.erase(key);
+        continue;
+      }
+      if (!inited_) {
+        std::vector<Context> devs;
+        for (const auto& a : src) {
+          devs.push_back(a.ctx());
+        }
+        InitNCCL(devs);
+        InitMergeBuffer(devs);
+      }
+      std::vector<int> dev_ids;
+      for (const auto& e : src) {
+        dev_ids.push_back(e.ctx().dev_id);
+      }
+      std::sort(dev_ids.begin(), dev_ids.end());
+      CHECK(device_ids_ == dev_ids) << "NCCL KVStore supports only single set of devices";
+
+      // the sums are kept per device, in the order of device_ids_
+      auto& bufs = reduced_[key];
+      if (bufs.empty()) {
+        for (int dev_id : device_ids_) {
+          bufs.emplace_back(src[0].shape(), Context::GPU(dev_id), false, src[0].dtype());
+        }
+      }
+      reduced[k] = bufs;
+      local_[key] = bufs[0];
+      allreduced_.insert(key);
+      for (const auto& e : src) const_vars.push_back(e.var());
+      for (const auto& e : bufs) {
+        mutate_vars.push_back(e.var());
+        synced.push_back(&e);
+      }
+
+      const int dtype = src[0].dtype();
+      const size_t bytes = src[0].shape().Size() * mshadow::mshadow_sizeof(dtype);
+      if (bytes >= fusion_bucket_bytes_) {
+        large.push_back(k);
+        continue;
+      }
+      auto it = open.find(dtype);
+      if (it == open.end()) {
+        it = open.emplace(dtype, std::make_pair(buckets.size(), 0)).first;
+        buckets.emplace_back();
+      } else if (it->second.second + bytes > fusion_bucket_bytes_) {
+        it->second = std::make_pair(buckets.size(), 0);
+        buckets.emplace_back();
+      }
+      buckets[it->second.first].push_back(k);
+      it->second.second += bytes;
+    }
+
+    // buckets are gathered into and reduced from flat buffers on every device
+    std::unordered_map<int, std::vector<NDArray>> fusion_in, fusion_out;
+    for (const auto& kv : open) {
+      const int dtype = kv.first;
+      auto& in = fusion_in_[dtype];
+      auto& out = fusion_out_[dtype];
+      if (in.empty()) {
+        const TShape shape(mshadow::Shape1(fusion_bucket_bytes_ / mshadow::mshadow_sizeof(dtype)));
+        for (int dev_id : device_ids_) {
+          in.emplace_back(shape, Context::GPU(dev_id), false, dtype);
+          out.emplace_back(shape, Context::GPU(dev_id), false, dtype);
+        }
+      }
+      fusion_in[dtype] = in;
+      fusion_out[dtype] = out;
+      for (size_t r = 0; r < in.size(); ++r) {
+        mutate_vars.push_back(in[r].var());
+        mutate_vars.push_back(out[r].var());
+        synced.push_back(&in[r]);
+        synced.push_back(&out[r]);
+      }
+    }
+    if (synced.empty()) return;
+
+    Engine::Get()->PushSync([srcs, reduced, large, buckets, fusion_in, fusion_out,
+                             this](RunContext rctx) {
+        std::lock_guard<std::mutex> l(Storage::Get()->GetMutex(Context::kGPU));
+        for (const auto& bucket : buckets) {
+          const int dtype = srcs[bucket[0]][0].dtype();
+          const auto& in = fusion_in.at(dtype);
+          const auto& out = fusion_out.at(dtype);
+          size_t offset = 0;
+          for (size_t k : bucket) {
+            const size_t bytes = srcs[k][0].shape().Size() * mshadow::mshadow_sizeof(dtype);
+            for (const auto& src : srcs[k]) {
+              const NCCLEntry& cur = nccl_data_[src.ctx().dev_id];
+              CUDA_CALL(cudaSetDevice(cur.dev_id));
+              CUDA_CALL(cudaMemcpyAsync(static_cast<char*>(in[cur.dev_index].data().dptr_) + offset,
+                                        src.data().dptr_, bytes,
+                                        cudaMemcpyDeviceToDevice, cur.stream));
+            }
+            offset += bytes;
+          }
+          ncclGroupStart();
+          for (size_t r = 0; r < in.size(); ++r) {
+            const NCCLEntry& cur = nccl_data_[device_ids_[r]];
+            MSHADOW_TYPE_SWITCH(dtype, DType,
+            ncclAllReduce(in[r].data().dptr<DType>(),
+                          out[r].data().dptr<DType>(),
+                          offset / sizeof(DType),
+                          GetNCCLType(dtype),
+                          ncclSum,
+                          cur.comm,
+                          cur.stream););
+          }
+          ncclGroupEnd();
+          offset = 0;
+          for (size_t k : bucket) {
+            const size_t bytes = srcs[k][0].shape().Size() * mshadow::mshadow_sizeof(dtype);
+            for (size_t r = 0; r < out.size(); ++r) {
+              const NCCLEntry& cur = nccl_data_[device_ids_[r]];
+              CUDA_CALL(cudaSetDevice(cur.dev_id));
+              CUDA_CALL(cudaMemcpyAsync(reduced[k][r].data().dptr_,
+                                        static_cast<char*>(out[r].data().dptr_) + offset, bytes,
+                                        cudaMemcpyDeviceToDevice, cur.stream));
+            }
+            offset += bytes;
+          }
+        }
+#if (NCCL_MAJOR > 2 || (NCCL_MAJOR == 2 && NCCL_MINOR > 1))
+        ncclGroupStart();
+#endif
+        for (size_t k : large) {
+          ncclGroupStart();
+          for (const auto& src : srcs[k]) {
+            const NCCLEntry& cur = nccl_data_[src.ctx().dev_id];
+            MSHADOW_TYPE_SWITCH(src.dtype(), DType,
+            ncclAllReduce(src.data().dptr<DType>(),
+                          reduced[k][cur.dev_index].data().dptr<DType>(),
+                          src.shape().Size(),
+                          GetNCCLType(src.dtype()),
+                          ncclSum,
+                          cur.comm,
+                          cur.stream););
+          }
+          ncclGroupEnd();
+        }
+#if (NCCL_MAJOR > 2 || (NCCL_MAJOR == 2 && NCCL_MINOR > 1))
+        ncclGroupEnd();
+#endif
+      },
+      Context::CPU(),
+      const_vars,
+      mutate_vars,
+      FnProperty::kCPUPrioritized,
+      priority,
+      "KVStoreAllReduce");
+    CommSync(synced, priority);
+  }
+
   virtual void Broadcast(const std::vector<int> keys,
       const std::vector<NDArray>& srcs,
       const std::vector<std::vector<NDArray*>>& dsts,
@@ -467,7 +673,7 @@ class KVStoreNCCL : public KVStoreLocal {
     return ncclNumTypes;
   }
 
-  void InitNCCL(const std::vector<Context>& devs) {
+  virtual void InitNCCL(const std::vector<Context>& devs) {
     for (size_t i = 0; i < devs.size(); ++i) {
       device_ids_.push_back(devs[i].dev_id);
     }
@@ -480,6 +686,7 @@ class KVStoreNCCL : public KVStoreLocal {
       e.dev_id = device_ids_[i];
       e.comm = comms[i];
       e.rank = i;
+      e.dev_index = i;
       cudaSetDevice(e.dev_id);
       cudaStreamCreate(&(e.stream));
       nccl_data_[device_ids_[i]] = e;
@@ -534,12 +741,26 @@ class KVStoreNCCL : public KVStoreLocal {
     ncclComm_t comm;
     /// \brief NCCL rank
     int rank;
+    /// \brief position of the device in device_ids_
+    size_t dev_index;
     /// \brief GPU stream to use with NCCL
     cudaStream_t stream;
   };
   std::unordered_map<int, BufferEntry> merge_buf_;
   std::unordered_map<int, NCCLEntry> nccl_data_;
   bool inited_;
+  /// \brief whether the communicators span the devices of several workers
+  bool multi_node_{false};
+  /// \brief whether pushes without updater allreduce instead of reducing to one device
+  bool use_allreduce_;
+  /// \brief maximum size in bytes of the keys allreduced together
+  size_t fusion_bucket_bytes_;
+  /// \brief sums of the allreduced keys on every device, in the order of device_ids_
+  std::unordered_map<int, std::vector<NDArray>> reduced_;
+  /// \brief keys whose last push was an allreduce
+  std::unordered_set<int> allreduced_;
+  /// \brief buffers the buckets are gathered into and reduced to, by type and device
+  std::unordered_map<int, std::vector<NDArray>> fusion_in_, fusion_out_;
   // \brief devices used with this KVStore
   std::vector<int> device_ids_;
 };
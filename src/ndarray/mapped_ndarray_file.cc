@@ -0,0 +1,192 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file mapped_ndarray_file.cc
+ * \brief indexed NDArray file format loaded by mapping the file into memory
+ */
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif  // _WIN32
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include "./mapped_ndarray_file.h"
+
+namespace mxnet {
+namespace {
+/*! \brief magic number of the format, the NDArray list format uses 0x112 */
+const uint64_t kMXAPIMappedListMagic = 0x113;
+
+inline uint64_t AlignUp(uint64_t n) {
+  const uint64_t align = MappedNDArrayFile::kAlignment;
+  return (n + align - 1) / align * align;
+}
+}  // namespace
+
+const size_t MappedNDArrayFile::kAlignment;
+
+void MappedNDArrayFile::Save(const std::string& fname,
+                             const std::vector<NDArray>& data,
+                             const std::vector<std::string>& names) {
+  CHECK(names.empty() || names.size() == data.size())
+      << "MappedNDArrayFile: expect one name per array";
+  // the CPU copies of the arrays, and the size of the table
+  std::vector<NDArray> cpu_data(data.size());
+  uint64_t table_size = 2 * sizeof(uint64_t);
+  for (size_t i = 0; i < data.size(); ++i) {
+    CHECK_EQ(data[i].storage_type(), kDefaultStorage)
+        << "MappedNDArrayFile only saves dense arrays";
+    CHECK(!data[i].is_none()) << "MappedNDArrayFile cannot save empty arrays";
+    cpu_data[i] = data[i].ctx().dev_mask() == cpu::kDevMask ?
+        data[i] : data[i].Copy(Context::CPU());
+    table_size += sizeof(uint64_t) + (names.empty() ? 0 : names[i].size()) +
+        sizeof(int32_t) + sizeof(uint32_t) + sizeof(int64_t) * data[i].shape().ndim() +
+        sizeof(uint64_t);
+  }
+  std::vector<uint64_t> offsets(data.size());
+  uint64_t end = table_size;
+  for (size_t i = 0; i < data.size(); ++i) {
+    offsets[i] = AlignUp(end);
+    end = offsets[i] + data[i].shape().Size() * mshadow::mshadow_sizeof(data[i].dtype());
+  }
+
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname.c_str(), "w"));
+  const uint64_t magic = kMXAPIMappedListMagic, num = data.size();
+  fo->Write(&magic, sizeof(magic));
+  fo->Write(&num, sizeof(num));
+  for (size_t i = 0; i < data.size(); ++i) {
+    const std::string name = names.empty() ? std::string() : names[i];
+    const uint64_t name_len = name.size();
+    const int32_t dtype = data[i].dtype();
+    const TShape& shape = data[i].shape();
+    const uint32_t ndim = shape.ndim();
+    fo->Write(&name_len, sizeof(name_len));
+    fo->Write(name.data(), name.size());
+    fo->Write(&dtype, sizeof(dtype));
+    fo->Write(&ndim, sizeof(ndim));
+    for (uint32_t k = 0; k < ndim; ++k) {
+      const int64_t dim = shape[k];
+      fo->Write(&dim, sizeof(dim));
+    }
+    fo->Write(&offsets[i], sizeof(offsets[i]));
+  }
+  const char padding[kAlignment] = {0};
+  uint64_t pos = table_size;
+  for (size_t i = 0; i < cpu_data.size(); ++i) {
+    fo->Write(padding, offsets[i] - pos);
+    cpu_data[i].WaitToRead();
+    const TBlob blob = cpu_data[i].data();
+    CHECK(blob.CheckContiguous());
+    const size_t nbytes = blob.shape_.Size() * mshadow::mshadow_sizeof(blob.type_flag_);
+    fo->Write(blob.dptr_, nbytes);
+    pos = offsets[i] + nbytes;
+  }
+}
+
+bool MappedNDArrayFile::IsMappedFile(const std::string& fname) {
+  FILE* fp = std::fopen(fname.c_str(), "rb");
+  if (fp == nullptr) return false;
+  uint64_t magic = 0;
+  const bool ok = std::fread(&magic, sizeof(magic), 1, fp) == 1 &&
+      magic == kMXAPIMappedListMagic;
+  std::fclose(fp);
+  return ok;
+}
+
+MappedNDArrayFile::MappedNDArrayFile(const std::string& fname) {
+#ifdef _WIN32
+  LOG(FATAL) << "MappedNDArrayFile is not supported on Windows";
+#else
+  int fd = open(fname.c_str(), O_RDONLY);
+  CHECK_NE(fd, -1) << "Failed to open " << fname << ": " << strerror(errno);
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "Failed to stat " << fname << ": " << strerror(errno);
+  const size_t size = st.st_size;
+  CHECK_GE(size, 2 * sizeof(uint64_t)) << "Invalid mapped NDArray file " << fname;
+  // copy-on-write, so arrays written in place do not change the file
+  void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  CHECK_NE(addr, MAP_FAILED) << "Failed to map " << fname << ": " << strerror(errno);
+  mapping_ = std::shared_ptr<void>(addr, [size](void* p) { munmap(p, size); });
+
+  const char* base = static_cast<const char*>(addr);
+  size_t pos = 0;
+  auto read = [&](void* dst, size_t n) {
+    CHECK_LE(pos + n, size) << "Invalid mapped NDArray file " << fname;
+    std::memcpy(dst, base + pos, n);
+    pos += n;
+  };
+  uint64_t magic, num;
+  read(&magic, sizeof(magic));
+  CHECK_EQ(magic, kMXAPIMappedListMagic) << "Invalid mapped NDArray file " << fname;
+  read(&num, sizeof(num));
+  entries_.resize(num);
+  names_.resize(num);
+  bool named = false;
+  for (uint64_t i = 0; i < num; ++i) {
+    uint64_t name_len;
+    read(&name_len, sizeof(name_len));
+    CHECK_LE(pos + name_len, size) << "Invalid mapped NDArray file " << fname;
+    names_[i].assign(base + pos, name_len);
+    pos += name_len;
+    named = named || name_len != 0;
+    Entry& e = entries_[i];
+    int32_t dtype;
+    uint32_t ndim;
+    read(&dtype, sizeof(dtype));
+    read(&ndim, sizeof(ndim));
+    e.dtype = dtype;
+    e.shape = TShape(ndim);
+    for (uint32_t k = 0; k < ndim; ++k) {
+      int64_t dim;
+      read(&dim, sizeof(dim));
+      e.shape[k] = dim;
+    }
+    read(&e.offset, sizeof(e.offset));
+    CHECK_LE(e.offset + e.shape.Size() * mshadow::mshadow_sizeof(e.dtype), size)
+        << "Invalid mapped NDArray file " << fname;
+    if (name_len != 0) index_[names_[i]] = i;
+  }
+  if (!named) names_.clear();
+#endif  // _WIN32
+}
+
+NDArray MappedNDArrayFile::Get(size_t i) const {
+  CHECK_LT(i, entries_.size());
+  const Entry& e = entries_[i];
+  void* dptr = static_cast<char*>(mapping_.get()) + e.offset;
+  return NDArray(TBlob(dptr, e.shape, cpu::kDevMask, e.dtype), 0, mapping_);
+}
+
+bool MappedNDArrayFile::Get(const std::string& name, NDArray* out) const {
+  auto it = index_.find(name);
+  if (it == index_.end()) return false;
+  *out = Get(it->second);
+  return true;
+}
+
+}  // namespace mxnet
@@ -0,0 +1,97 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file mapped_ndarray_file.h
+ * \brief indexed NDArray file format loaded by mapping the file into memory
+ */
+#ifndef MXNET_NDARRAY_MAPPED_NDARRAY_FILE_H_
+#define MXNET_NDARRAY_MAPPED_NDARRAY_FILE_H_
+
+#include <mxnet/ndarray.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mxnet {
+
+/*!
+ * \brief NDArray file with a table of the arrays ahead of their data, each
+ *  payload aligned to kAlignment bytes. Opening the file maps it copy-on-write,
+ *  and the arrays it returns are CPU arrays backed by the mapping, so loading
+ *  reads only the table, the pages of an array are read when it is first used,
+ *  and processes loading the same file share the pages they do not write.
+ *
+ *  Layout, little endian:
+ *    uint64 magic, uint64 number of arrays,
+ *    for each array: uint64 name length, name, int32 dtype, uint32 ndim,
+ *                    int64 dims[ndim], uint64 offset of the data in the file,
+ *    the data of the arrays at their offsets.
+ */
+class MappedNDArrayFile {
+ public:
+  /*! \brief alignment of the data of each array in the file */
+  static const size_t kAlignment = 64;
+  /*!
+   * \brief write dense arrays in the format
+   * \param fname the file name, any dmlc stream URI
+   * \param data the arrays, copied to the CPU if needed
+   * \param names the names of the arrays, empty or one per array
+   */
+  static void Save(const std::string& fname,
+                   const std::vector<NDArray>& data,
+                   const std::vector<std::string>& names);
+  /*! \return whether the local file fname is in the format */
+  static bool IsMappedFile(const std::string& fname);
+  /*!
+   * \brief map a local file and read its table
+   * \param fname the file name
+   */
+  explicit MappedNDArrayFile(const std::string& fname);
+  /*! \return the names of the arrays, empty strings if saved without names */
+  const std::vector<std::string>& names() const { return names_; }
+  /*! \return number of arrays in the file */
+  size_t size() const { return entries_.size(); }
+  /*! \return the i-th array, backed by the mapping */
+  NDArray Get(size_t i) const;
+  /*!
+   * \brief the array saved with a name
+   * \param name the name
+   * \param out the array, backed by the mapping
+   * \return whether the file has the name
+   */
+  bool Get(const std::string& name, NDArray* out) const;
+
+ private:
+  struct Entry {
+    TShape shape;
+    int dtype;
+    uint64_t offset;
+  };
+  /*! \brief the mapping, unmapped once no array uses it */
+  std::shared_ptr<void> mapping_;
+  std::vector<Entry> entries_;
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, size_t> index_;
+};
+
+}  // namespace mxnet
+#endif  // MXNET_NDARRAY_MAPPED_NDARRAY_FILE_H_
@@ -113,7 +113,9 @@ NDArray::Chunk::~Chunk() {
   // We want to delete mkldnn memory after deleting the variable.
   mem.mem = this->mkl_mem_;
 #endif
-  Engine::Get()->DeleteVariable([mem, skip_free](RunContext s) {
+  // the owner of static data is released once the pending operations completed
+  std::shared_ptr<void> owner = static_owner;
+  Engine::Get()->DeleteVariable([mem, skip_free, owner](RunContext s) {
     if (skip_free == false) {
 #if MXNET_USE_MKLDNN == 1
       if (mem.mem) {
@@ -1587,6 +1589,40 @@ NDArray &NDArray::operator/=(const real_t &src) {
   return ScalarOpApply<ndarray::Div>(this, src);
 }
 
+NDArray NDArray::FromDLPack(DLManagedTensor *tensor) {
+  std::shared_ptr<void> owner(tensor, [](void *ptr) {
+      DLManagedTensor *tensor = static_cast<DLManagedTensor*>(ptr);
+      if (tensor->deleter != nullptr) tensor->deleter(tensor);
+    });
+  return NDArray(TBlob(tensor->dl_tensor), tensor->dl_tensor.ctx.device_id, owner);
+}
+
+namespace {
+/*! \brief the DLPack tensor of an NDArray, with the array it keeps alive */
+struct NDArrayDLManager {
+  NDArray handle;
+  TShape shape;
+  DLManagedTensor tensor;
+};
+}  // namespace
+
+DLManagedTensor *NDArray::ToDLPack() const {
+  CHECK_EQ(storage_type(), kDefaultStorage) << "ToDLPack only supports dense arrays";
+  NDArrayDLManager *manager = new NDArrayDLManager();
+  manager->handle = *this;
+  // copies of a TBlob keep pointing to the shape of the original, the tensor
+  // points to the one of the manager
+  const TBlob blob = manager->handle.data();
+  manager->shape = blob.shape_;
+  manager->tensor.dl_tensor = blob.dltensor();
+  manager->tensor.dl_tensor.shape = manager->shape.data();
+  manager->tensor.manager_ctx = manager;
+  manager->tensor.deleter = [](DLManagedTensor *tensor) {
+    delete static_cast<NDArrayDLManager*>(tensor->manager_ctx);
+  };
+  return &manager->tensor;
+}
+
 /* magic number for ndarray version 1, with int64_t TShape */
 static const uint32_t NDARRAY_V1_MAGIC = 0xF993fac8;
 
@@ -1594,6 +1630,15 @@ static const uint32_t NDARRAY_V1_MAGIC = 0xF993fac8;
 static const uint32_t NDARRAY_V2_MAGIC = 0xF993fac9;
 
 void NDArray::Save(dmlc::Stream *strm) const {
+  NDArray nd_cpu = *this;  // a copy of *this on cpu
+  if (!is_none()) {
+    if (ctx().dev_mask() != cpu::kDevMask) nd_cpu = this->Copy(Context::CPU());
+    nd_cpu.WaitToRead();
+  }
+  nd_cpu.SaveCPU(strm, is_none() ? Context() : ctx());
+}
+
+void NDArray::SaveCPU(dmlc::Stream *strm, Context ctx) const {
   // write magic number to mark this version
   // for storage type
   strm->Write(NDARRAY_V2_MAGIC);
@@ -1613,19 +1658,8 @@ void NDArray::Save(dmlc::Stream *strm) const {
   if (is_none()) return;
 
   // save context
-  Context ctx = this->ctx();
   ctx.Save(strm);
-  TBlob save_data;
-  NDArray nd_cpu;  // a copy of *this on cpu
-  if (ctx.dev_mask() != cpu::kDevMask) {
-    nd_cpu = this->Copy(Context::CPU());
-    nd_cpu.WaitToRead();
-    save_data = nd_cpu.data();
-  } else {
-    this->WaitToRead();
-    save_data = this->data();
-    nd_cpu = *this;
-  }
+  TBlob save_data = this->data();
 
   // save type flag
   int32_t type_flag = save_data.type_flag_;
@@ -1650,7 +1684,7 @@ void NDArray::Save(dmlc::Stream *strm) const {
   // save aux data
   if (nad > 0) {
     for (int i = 0; i < nad; ++i) {
-      TBlob save_data = nd_cpu.aux_data(i);
+      TBlob save_data = this->aux_data(i);
       // save aux_data
       CHECK(save_data.CheckContiguous());
       size_t aux_type_size = mshadow::mshadow_sizeof(aux_type(i));
@@ -1801,6 +1835,55 @@ void NDArray::Save(dmlc::Stream* fo,
   fo->Write(names);
 }
 
+NDArray NDArray::SaveAsync(const std::string& fname,
+                           const std::vector<NDArray>& data,
+                           const std::vector<std::string>& names,
+                           int dtype) {
+  CHECK(names.empty() || names.size() == data.size())
+      << "SaveAsync: expect one name per array";
+  Engine* engine = Engine::Get();
+  // the operations writing the file in order, the stream is opened by the first one
+  Engine::VarHandle file_var = engine->NewVariable();
+  auto fo = std::make_shared<std::unique_ptr<dmlc::Stream>>();
+  const uint64_t num = data.size();
+  engine->PushSync([fo, fname, num](RunContext ctx) {
+      fo->reset(dmlc::Stream::Create(fname.c_str(), "w"));
+      uint64_t header = kMXAPINDArrayListMagic, reserved = 0;
+      (*fo)->Write(&header, sizeof(header));
+      (*fo)->Write(&reserved, sizeof(reserved));
+      (*fo)->Write(&num, sizeof(num));
+    }, Context::CPU(), {}, {file_var}, FnProperty::kNormal, 0, "SaveAsync");
+  for (const NDArray& arr : data) {
+    if (arr.is_none()) {
+      engine->PushSync([fo, arr](RunContext ctx) {
+          arr.SaveCPU(fo->get(), Context());
+        }, Context::CPU(), {}, {file_var}, FnProperty::kNormal, 0, "SaveAsync");
+      continue;
+    }
+    // a snapshot on CPU, so later writes to the array do not change the file, and
+    // each array is written once its copy is ready, arrays on GPUs are copied on
+    // their kCopyFromGPU queues
+    NDArray snapshot = arr.Copy(Context::CPU());
+    if (dtype != -1 && arr.dtype() == mshadow::kFloat32 &&
+        arr.storage_type() == kDefaultStorage) {
+      NDArray cast(arr.shape(), Context::CPU(), false, dtype);
+      CopyFromTo(snapshot, &cast);
+      snapshot = cast;
+    }
+    const Context save_ctx = arr.ctx();
+    engine->PushSync([fo, snapshot, save_ctx](RunContext ctx) {
+        snapshot.SaveCPU(fo->get(), save_ctx);
+      }, Context::CPU(), {snapshot.var()}, {file_var}, FnProperty::kNormal, 0, "SaveAsync");
+  }
+  NDArray done(mshadow::Shape1(1), Context::CPU());
+  engine->PushSync([fo, names](RunContext ctx) {
+      (*fo)->Write(names);
+      fo->reset();
+    }, Context::CPU(), {}, {file_var, done.var()}, FnProperty::kNormal, 0, "SaveAsync");
+  engine->DeleteVariable([](RunContext ctx) {}, Context::CPU(), file_var);
+  return done;
+}
+
 void NDArray::Load(dmlc::Stream* fi,
                    std::vector<NDArray>* data,
                    std::vector<std::string>* keys) {
@@ -1819,6 +1902,50 @@ void NDArray::Load(dmlc::Stream* fi,
       << "Invalid NDArray file format";
 }
 
+void NDArray::LoadFromBuffer(const void* buf, size_t size,
+                             std::vector<NDArray>* data,
+                             std::vector<std::string>* keys) {
+  char* base = static_cast<char*>(const_cast<void*>(buf));
+  dmlc::MemoryFixedSizeStream fi(base, size);
+  uint64_t header, reserved, num;
+  CHECK(fi.Read(&header)) << "Invalid NDArray file format";
+  CHECK(fi.Read(&reserved)) << "Invalid NDArray file format";
+  CHECK(header == kMXAPINDArrayListMagic) << "Invalid NDArray file format";
+  CHECK(fi.Read(&num)) << "Invalid NDArray file format";
+  data->resize(num);
+  for (uint64_t i = 0; i < num; ++i) {
+    const size_t begin = fi.Tell();
+    uint32_t magic;
+    int32_t stype;
+    CHECK(fi.Read(&magic)) << "Invalid NDArray file format";
+    if (magic != NDARRAY_V2_MAGIC || !fi.Read(&stype) || stype != kDefaultStorage) {
+      // legacy and sparse arrays are read the usual way
+      fi.Seek(begin);
+      CHECK((*data)[i].Load(&fi)) << "Invalid NDArray file format";
+      continue;
+    }
+    TShape shape;
+    CHECK(shape.Load(&fi)) << "Invalid NDArray file format";
+    if (shape.ndim() == 0) {
+      (*data)[i] = NDArray();
+      continue;
+    }
+    Context ctx;
+    int32_t type_flag;
+    CHECK(ctx.Load(&fi)) << "Invalid NDArray file format";
+    CHECK(fi.Read(&type_flag, sizeof(type_flag)) == sizeof(type_flag))
+        << "Invalid NDArray file format";
+    const size_t offset = fi.Tell();
+    const size_t nbytes = shape.Size() * mshadow::mshadow_sizeof(type_flag);
+    CHECK_LE(offset + nbytes, size) << "Invalid NDArray file format";
+    (*data)[i] = NDArray(TBlob(base + offset, shape, cpu::kDevMask, type_flag), 0);
+    fi.Seek(offset + nbytes);
+  }
+  CHECK(fi.Read(keys)) << "Invalid NDArray file format";
+  CHECK(keys->size() == 0 || keys->size() == data->size())
+      << "Invalid NDArray file format";
+}
+
 NDArray NDArray::Copy(Context ctx) const {
   NDArray ret;
   if (kDefaultStorage == storage_type()) {
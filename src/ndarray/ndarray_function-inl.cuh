@@ -61,6 +61,52 @@ struct ElementWiseRspAdditionKernel {
   }
 };
 
+/*!
+ * \brief GPU kernel to perform RSP tensor addition: out += in
+ * The output row of each input row is found by binary search in the sorted
+ * output row indices, so no array over all rows is needed.
+ * Parallelization by non-zero input elements: 1 thread/element
+ */
+struct ElementWiseRspSearchAdditionKernel {
+  /*!
+   * \brief
+   * \param tid         global thread id
+   * \param data_out    rsp output data
+   * \param row_idx_out rsp output sorted non-zero row indices
+   * \param nnr_out     rsp output number of non-zero rows
+   * \param row_idx_in  rsp input non-zero row indices
+   * \param data_in     rsp input data
+   * \param nnr_in      rsp input number of non-zero rows
+   * \param row_length  rsp input and output number of elements per row
+   */
+  template<typename DType, typename IType>
+  __device__ __forceinline__ static void Map(int tid,
+                                             DType* data_out,
+                                             const IType* row_idx_out,
+                                             const nnvm::dim_t nnr_out,
+                                             const IType* row_idx_in,
+                                             const DType* data_in,
+                                             const nnvm::dim_t nnr_in,
+                                             const nnvm::dim_t row_length) {
+    using nnvm::dim_t;
+    if (tid < nnr_in * row_length) {
+      dim_t in_row = tid / row_length;
+      dim_t in_col = tid % row_length;
+      const IType target = row_idx_in[in_row];
+      dim_t lo = 0, hi = nnr_out;
+      while (lo < hi) {
+        dim_t mid = lo + (hi - lo) / 2;
+        if (row_idx_out[mid] < target) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      data_out[lo * row_length + in_col] += data_in[tid];
+    }
+  }
+};
+
 }  // namespace ndarray
 }  // namespace mxnet
 
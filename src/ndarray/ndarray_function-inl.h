@@ -27,6 +27,7 @@
 
 #include <vector>
 #include "./ndarray_function.h"
+#include "../operator/tensor/elemwise_sum.h"
 // this file will be included twice by CPU and GPU
 // macro to help specialize evaluation function
 
@@ -397,39 +398,10 @@ void ElementwiseSum<DEVICE>(const std::vector<TBlob> source,
       << "Only support input/output with the same data type";
   }
   MSHADOW_TYPE_SWITCH(dst->type_flag_, DType, {
-    Tensor<xpu, 2, DType> out = dst->FlatTo2D<xpu, DType>(s);
-
-    switch (source.size()) {
-      case 2: {
-        Tensor<xpu, 2, DType> in_0 = source[0].FlatTo2D<xpu, DType>(s);
-        Tensor<xpu, 2, DType> in_1 = source[1].FlatTo2D<xpu, DType>(s);
-        out = in_0 + in_1;
-        break;
-      }
-      case 3: {
-        Tensor<xpu, 2, DType> in_0 = source[0].FlatTo2D<xpu, DType>(s);
-        Tensor<xpu, 2, DType> in_1 = source[1].FlatTo2D<xpu, DType>(s);
-        Tensor<xpu, 2, DType> in_2 = source[2].FlatTo2D<xpu, DType>(s);
-        out = in_0 + in_1 + in_2;
-        break;
-      }
-      case 4: {
-        Tensor<xpu, 2, DType> in_0 = source[0].FlatTo2D<xpu, DType>(s);
-        Tensor<xpu, 2, DType> in_1 = source[1].FlatTo2D<xpu, DType>(s);
-        Tensor<xpu, 2, DType> in_2 = source[2].FlatTo2D<xpu, DType>(s);
-        Tensor<xpu, 2, DType> in_3 = source[3].FlatTo2D<xpu, DType>(s);
-        out = in_0 + in_1 + in_2 + in_3;
-        break;
-      }
-      default: {
-        Tensor<xpu, 2, DType> in_0 = source[0].FlatTo2D<xpu, DType>(s);
-        out = F<op::mshadow_op::identity>(in_0);
-        for (size_t i = 1; i < source.size(); ++i) {
-          out += source[i].FlatTo2D<xpu, DType>(s);
-        }
-        break;
-      }
-    }
+    std::vector<const DType*> inputs(source.size());
+    for (size_t i = 0; i < source.size(); ++i) inputs[i] = source[i].dptr<DType>();
+    op::ElemwiseSumLaunch(s, inputs, dst->dptr<DType>(), kWriteTo,
+                          static_cast<index_t>(dst->Size()));
   });
 }
 
@@ -25,6 +25,8 @@
 // this will be invoked by nvcc and compile GPU version
 #include <cub/cub.cuh>
 #include <dmlc/logging.h>
+#include <algorithm>
+#include <vector>
 #include "../operator/mxnet_op.h"
 #include "../operator/tensor/init_op.h"
 #include "../operator/tensor/util/tensor_util-inl.h"
@@ -33,6 +35,7 @@
 #include "./ndarray_function.h"
 #include "./ndarray_function-inl.h"
 #include "./ndarray_function-inl.cuh"
+#include "./pinned_staging.h"
 
 namespace mxnet {
 namespace ndarray {
@@ -42,6 +45,12 @@ void Copy<cpu, gpu>(const TBlob &from, TBlob *to,
                     RunContext ctx) {
   CHECK_EQ(to->type_flag_, from.type_flag_)
     << "Source and target must have the same data type when copying across devices.";
+  const size_t size = from.shape_.Size() * mshadow::mshadow_sizeof(from.type_flag_);
+  if (from_ctx.dev_type != Context::kCPUPinned && PinnedStaging::Use(size)) {
+    PinnedStaging::Get()->ToDevice(to->dptr_, from.dptr_, size,
+                                   mshadow::Stream<gpu>::GetStream(ctx.get_stream<gpu>()));
+    return;
+  }
   MSHADOW_TYPE_SWITCH(to->type_flag_, DType, {
     mshadow::Copy(to->FlatTo1D<gpu, DType>(),
                   from.FlatTo1D<cpu, DType>(),
@@ -55,6 +64,12 @@ void Copy<gpu, cpu>(const TBlob &from, TBlob *to,
                     RunContext ctx) {
   CHECK_EQ(to->type_flag_, from.type_flag_)
     << "Source and target must have the same data type when copying across devices.";
+  const size_t size = from.shape_.Size() * mshadow::mshadow_sizeof(from.type_flag_);
+  if (to_ctx.dev_type != Context::kCPUPinned && PinnedStaging::Use(size)) {
+    PinnedStaging::Get()->ToHost(to->dptr_, from.dptr_, size,
+                                 mshadow::Stream<gpu>::GetStream(ctx.get_stream<gpu>()));
+    return;
+  }
   MSHADOW_TYPE_SWITCH(to->type_flag_, DType, {
     mshadow::Copy(to->FlatTo1D<cpu, DType>(),
                   from.FlatTo1D<gpu, DType>(),
@@ -96,6 +111,80 @@ void Copy<gpu, gpu>(const TBlob &from, TBlob *to,
   }
 }
 
+/*!
+ * \brief GPU impl of elemwise sum for rsp tensors whose rows are sparse.
+ * The output row indices are the sorted unique of all input row indices,
+ * so time and workspace scale with the total number of input rows rather
+ * than with the number of rows of the full tensor.
+ */
+template<typename DType, typename IType>
+void ElementwiseSumRspSortImpl(mshadow::Stream<gpu>* s,
+                               const Resource& rsc,
+                               const std::vector<NDArray>& nds,
+                               const nnvm::dim_t total_nnr,
+                               NDArray* out) {
+  using namespace mxnet::op;
+  using namespace rowsparse;
+  using nnvm::dim_t;
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+  const dim_t row_length = out->shape().ProdShape(1, out->shape().ndim());
+  // query the temp storage of cub's radix sort and unique selection
+  size_t sort_temp_bytes = 0;
+  size_t unique_temp_bytes = 0;
+  IType* concat_idx = NULL;
+  IType* sorted_idx = NULL;
+  size_t* num_unique = NULL;
+  cub::DeviceRadixSort::SortKeys(NULL, sort_temp_bytes, concat_idx, sorted_idx,
+                                 static_cast<int>(total_nnr), 0, sizeof(IType) * 8, stream);
+  cub::DeviceSelect::Unique(NULL, unique_temp_bytes, sorted_idx, concat_idx, num_unique,
+                            static_cast<int>(total_nnr), stream);
+  const size_t temp_bytes = std::max(sort_temp_bytes, unique_temp_bytes);
+  // workspace layout: [num_unique, concat_idx, sorted_idx, cub temp storage]
+  const size_t idx_bytes = (total_nnr * sizeof(IType) + 7) / 8 * 8;
+  mshadow::Tensor<gpu, 1, char> workspace = rsc
+      .get_space_typed<gpu, 1, char>(mshadow::Shape1(8 + 2 * idx_bytes + temp_bytes), s);
+  num_unique = reinterpret_cast<size_t*>(workspace.dptr_);
+  concat_idx = reinterpret_cast<IType*>(workspace.dptr_ + 8);
+  sorted_idx = reinterpret_cast<IType*>(workspace.dptr_ + 8 + idx_bytes);
+  void* d_temp_storage = workspace.dptr_ + 8 + 2 * idx_bytes;
+  // gather the row indices of all inputs
+  dim_t offset = 0;
+  for (const auto& nd : nds) {
+    if (nd.storage_initialized()) {
+      const dim_t nd_nnr = nd.storage_shape()[0];
+      CUDA_CALL(cudaMemcpyAsync(concat_idx + offset, nd.aux_data(kIdx).dptr<IType>(),
+                                nd_nnr * sizeof(IType), cudaMemcpyDeviceToDevice, stream));
+      offset += nd_nnr;
+    }
+  }
+  cub::DeviceRadixSort::SortKeys(d_temp_storage, sort_temp_bytes, concat_idx, sorted_idx,
+                                 static_cast<int>(total_nnr), 0, sizeof(IType) * 8, stream);
+  cub::DeviceSelect::Unique(d_temp_storage, unique_temp_bytes, sorted_idx, concat_idx,
+                            num_unique, static_cast<int>(total_nnr), stream);
+  // get total number of output non-zero rows from GPU and allocate out data and row_idx
+  size_t nnr_out = 0;
+  CUDA_CALL(cudaMemcpyAsync(&nnr_out, num_unique, sizeof(size_t),
+                            cudaMemcpyDeviceToHost, stream));
+  CUDA_CALL(cudaStreamSynchronize(stream));
+  out->CheckAndAlloc({mshadow::Shape1(nnr_out)});
+  IType* out_row_idx = out->aux_data(kIdx).dptr<IType>();
+  DType* out_data = out->data().dptr<DType>();
+  CUDA_CALL(cudaMemcpyAsync(out_row_idx, concat_idx, nnr_out * sizeof(IType),
+                            cudaMemcpyDeviceToDevice, stream));
+  // perform elementwise addition, writing to output data
+  mxnet_op::Kernel<mxnet_op::set_zero, gpu>::Launch(s, nnr_out * row_length, out_data);
+  for (const auto& nd : nds) {
+    if (nd.storage_initialized()) {
+      const IType* nd_row_idx = nd.aux_data(kIdx).dptr<IType>();
+      const DType* nd_data = nd.data().dptr<DType>();
+      const dim_t nd_nnr = nd.storage_shape()[0];
+      mxnet_op::Kernel<ElementWiseRspSearchAdditionKernel, gpu>::Launch(s,
+          nd_nnr * row_length, out_data, out_row_idx, static_cast<dim_t>(nnr_out),
+          nd_row_idx, nd_data, nd_nnr, row_length);
+    }
+  }
+}
+
 /*!
  * \brief GPU impl of elemwise sum for rowsparse tensors.
  */
@@ -121,8 +210,18 @@ void ElementwiseSumRspImpl(mshadow::Stream<gpu>* s,
   }
   const dim_t num_rows = out->shape()[0];
   const dim_t row_length = out->shape().ProdShape(1, out->shape().ndim());
+  dim_t total_nnr = 0;
+  for (const auto& nd : nds) {
+    if (nd.storage_initialized()) total_nnr += nd.storage_shape()[0];
+  }
   MSHADOW_TYPE_SWITCH(out->dtype(), DType, {  // data type
     MSHADOW_IDX_TYPE_SWITCH(out->aux_type(kIdx), IType, {  // row_idx type
+      // when the inputs touch few rows, sorting their indices is cheaper
+      // than scanning a flag array over all rows
+      if (total_nnr * 4 < num_rows) {
+        ElementwiseSumRspSortImpl<DType, IType>(s, rsc, nds, total_nnr, out);
+        return;
+      }
       // Allocate temporary storage for row_flg array and cub's prefix sum operation
       IType* row_flg = NULL;
       void* d_temp_storage = NULL;
@@ -0,0 +1,153 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file param_loader.cc
+ * \brief copy loaded parameters to the arrays of an executor
+ */
+#include <dmlc/parameter.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include "./param_loader.h"
+#include "../engine/openmp.h"
+
+namespace mxnet {
+namespace {
+/*! \brief bytes copied by one thread at a time */
+const size_t kCopyBlock = 1 << 22;
+
+struct HostCopy {
+  const char* src;
+  char* dst;
+  size_t size;
+};
+
+/*! \brief run the copies in blocks on the recommended number of threads */
+void ParallelCopy(const std::vector<HostCopy>& copies) {
+  std::vector<HostCopy> blocks;
+  for (const HostCopy& c : copies) {
+    for (size_t off = 0; off < c.size; off += kCopyBlock) {
+      blocks.push_back({c.src + off, c.dst + off, std::min(kCopyBlock, c.size - off)});
+    }
+  }
+  const int64_t n = blocks.size();
+  const int nthreads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+  for (int64_t i = 0; i < n; ++i) {
+    std::memcpy(blocks[i].dst, blocks[i].src, blocks[i].size);
+  }
+}
+
+/*! \brief pinned staging buffers for the copies to one GPU, filled in turn */
+class StageRing {
+ public:
+  StageRing(int dev_id, size_t num, size_t size) : size_(size) {
+    for (size_t i = 0; i < num; ++i) {
+      slots_.emplace_back(mshadow::Shape1(size), Context::CPUPinned(dev_id), false,
+                          mshadow::kUint8);
+    }
+  }
+  /*! \brief stage nbytes from src for the byte view dst, from its byte offset */
+  void Push(const char* src, const NDArray& dst, size_t offset, size_t nbytes) {
+    while (nbytes != 0) {
+      if (used_ == size_) Flush();
+      if (used_ == 0) slots_[next_].WaitToWrite();
+      const size_t n = std::min(nbytes, size_ - used_);
+      char* slot = static_cast<char*>(slots_[next_].data().dptr_);
+      fills_.push_back({src, slot + used_, n});
+      copies_.push_back({used_, n, dst, offset});
+      used_ += n;
+      src += n;
+      offset += n;
+      nbytes -= n;
+    }
+  }
+  /*! \brief fill the current buffer and push its copies to the device */
+  void Flush() {
+    if (used_ == 0) return;
+    ParallelCopy(fills_);
+    for (const DeviceCopy& c : copies_) {
+      NDArray to = c.dst.Slice(c.dst_offset, c.dst_offset + c.size);
+      CopyFromTo(slots_[next_].Slice(c.slot_offset, c.slot_offset + c.size), &to);
+    }
+    fills_.clear();
+    copies_.clear();
+    next_ = (next_ + 1) % slots_.size();
+    used_ = 0;
+  }
+
+ private:
+  struct DeviceCopy {
+    size_t slot_offset;
+    size_t size;
+    NDArray dst;
+    size_t dst_offset;
+  };
+  const size_t size_;
+  std::vector<NDArray> slots_;
+  size_t next_{0};
+  size_t used_{0};
+  std::vector<HostCopy> fills_;
+  std::vector<DeviceCopy> copies_;
+};
+}  // namespace
+
+void LoadParams(const std::vector<NDArray>& src, const std::vector<NDArray>& dst) {
+  CHECK_EQ(src.size(), dst.size());
+  static const size_t stage_num = std::max(2, dmlc::GetEnv("MXNET_PARAM_LOAD_STAGE_NUM", 4));
+  static const size_t stage_size = std::max<size_t>(
+      kCopyBlock, dmlc::GetEnv("MXNET_PARAM_LOAD_STAGE_SIZE", static_cast<size_t>(1 << 24)));
+  std::vector<HostCopy> host_copies;
+  std::unordered_map<int, std::unique_ptr<StageRing>> rings;
+  // fall back copies may read src asynchronously
+  std::vector<NDArray> pending;
+  for (size_t i = 0; i < src.size(); ++i) {
+    const NDArray& from = src[i];
+    NDArray to = dst[i];
+    if (from.storage_type() != kDefaultStorage || to.storage_type() != kDefaultStorage ||
+        from.ctx().dev_mask() != cpu::kDevMask || from.dtype() != to.dtype() ||
+        from.shape() != to.shape()) {
+      CopyFromTo(from, &to);
+      pending.push_back(to);
+      continue;
+    }
+    const size_t nbytes = from.shape().Size() * mshadow::mshadow_sizeof(from.dtype());
+    if (nbytes == 0) continue;
+    from.WaitToRead();
+    const char* data = static_cast<const char*>(from.data().dptr_);
+    if (to.ctx().dev_mask() == cpu::kDevMask) {
+      to.WaitToWrite();
+      host_copies.push_back({data, static_cast<char*>(to.data().dptr_), nbytes});
+    } else if (to.ctx().dev_mask() == gpu::kDevMask) {
+      std::unique_ptr<StageRing>& ring = rings[to.ctx().dev_id];
+      if (!ring) ring.reset(new StageRing(to.ctx().dev_id, stage_num, stage_size));
+      ring->Push(data, to.AsArray(mshadow::Shape1(nbytes), mshadow::kUint8), 0, nbytes);
+    } else {
+      CopyFromTo(from, &to);
+      pending.push_back(to);
+    }
+  }
+  ParallelCopy(host_copies);
+  for (auto& kv : rings) kv.second->Flush();
+  for (const NDArray& arr : pending) arr.WaitToRead();
+}
+}  // namespace mxnet
@@ -0,0 +1,47 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file param_loader.h
+ * \brief copy loaded parameters to the arrays of an executor
+ */
+#ifndef MXNET_NDARRAY_PARAM_LOADER_H_
+#define MXNET_NDARRAY_PARAM_LOADER_H_
+
+#include <mxnet/ndarray.h>
+#include <vector>
+
+namespace mxnet {
+/*!
+ * \brief copy each CPU array of src into the array of dst with the same shape.
+ *  The data is copied by multiple threads, straight into CPU destinations and,
+ *  for GPU destinations, into a ring of pinned staging buffers per GPU that are
+ *  copied to the device by asynchronous copies on the engine while the next
+ *  buffer is filled. src is no longer read when the function returns, the copies
+ *  to GPUs may still run. Arrays of other storage types, data types or contexts
+ *  are copied by CopyFromTo.
+ *
+ *  The ring has MXNET_PARAM_LOAD_STAGE_NUM buffers of MXNET_PARAM_LOAD_STAGE_SIZE bytes.
+ * \param src the loaded arrays, e.g. from NDArray::LoadFromBuffer
+ * \param dst the destinations, allocated and not used by pending operations
+ */
+void LoadParams(const std::vector<NDArray>& src, const std::vector<NDArray>& dst);
+}  // namespace mxnet
+#endif  // MXNET_NDARRAY_PARAM_LOADER_H_
@@ -0,0 +1,133 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file pinned_staging.h
+ * \brief pinned buffers that copies between pageable host memory and a gpu go through
+ */
+#ifndef MXNET_NDARRAY_PINNED_STAGING_H_
+#define MXNET_NDARRAY_PINNED_STAGING_H_
+
+#if MXNET_USE_CUDA
+
+#include <cuda_runtime.h>
+#include <dmlc/parameter.h>
+#include <dmlc/thread_local.h>
+#include <mxnet/base.h>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include "../common/cuda_utils.h"
+
+namespace mxnet {
+namespace ndarray {
+
+/*!
+ * \brief ring of pinned chunks a copy thread stages pageable host memory through.
+ *
+ *  A copy from pageable memory makes the driver stage it synchronously. Going
+ *  through the ring instead, the host memcpy of one chunk overlaps the dma of the
+ *  previous one, and the dma itself runs at pinned bandwidth on the copy stream.
+ *  Each copy thread keeps one ring per device, so no locking is needed.
+ */
+class PinnedStaging {
+ public:
+  static const int kSlots = 2;
+
+  /*! \brief whether a copy of size bytes between pageable memory and a gpu is staged */
+  static bool Use(const size_t size) {
+    static const size_t threshold =
+      dmlc::GetEnv("MXNET_GPU_COPY_STAGING_THRESHOLD", static_cast<size_t>(1 << 20));
+    return threshold != 0 && size >= threshold;
+  }
+
+  /*! \brief the ring of the calling thread on the current device */
+  static PinnedStaging* Get() {
+    int dev_id;
+    CUDA_CALL(cudaGetDevice(&dev_id));
+    // never destroyed, the cuda runtime may be unloaded before thread local destructors run
+    PinnedStaging*& ring = dmlc::ThreadLocalStore<std::unordered_map<int, PinnedStaging*> >
+                             ::Get()->operator[](dev_id);
+    if (ring == nullptr) ring = new PinnedStaging();
+    return ring;
+  }
+
+  /*! \brief copy size bytes from pageable src to the device memory dst */
+  void ToDevice(void* dst, const void* src, const size_t size, cudaStream_t stream) {
+    char* to = static_cast<char*>(dst);
+    const char* from = static_cast<const char*>(src);
+    for (size_t c = 0; c * chunk_ < size; ++c) {
+      const int k = c % kSlots;
+      const size_t offset = c * chunk_;
+      const size_t n = std::min(chunk_, size - offset);
+      // the dma that last read the slot has to finish before it is refilled
+      CUDA_CALL(cudaEventSynchronize(done_[k]));
+      std::memcpy(slots_[k], from + offset, n);
+      CUDA_CALL(cudaMemcpyAsync(to + offset, slots_[k], n, cudaMemcpyHostToDevice, stream));
+      CUDA_CALL(cudaEventRecord(done_[k], stream));
+    }
+  }
+
+  /*! \brief copy size bytes from the device memory src to pageable dst, blocks until done */
+  void ToHost(void* dst, const void* src, const size_t size, cudaStream_t stream) {
+    char* to = static_cast<char*>(dst);
+    const char* from = static_cast<const char*>(src);
+    const size_t num_chunks = (size + chunk_ - 1) / chunk_;
+    auto issue = [&](const size_t c) {
+      const int k = c % kSlots;
+      const size_t offset = c * chunk_;
+      CUDA_CALL(cudaEventSynchronize(done_[k]));
+      CUDA_CALL(cudaMemcpyAsync(slots_[k], from + offset, std::min(chunk_, size - offset),
+                                cudaMemcpyDeviceToHost, stream));
+      CUDA_CALL(cudaEventRecord(done_[k], stream));
+    };
+    for (size_t c = 0; c < std::min<size_t>(num_chunks, kSlots); ++c) issue(c);
+    for (size_t c = 0; c < num_chunks; ++c) {
+      const int k = c % kSlots;
+      const size_t offset = c * chunk_;
+      CUDA_CALL(cudaEventSynchronize(done_[k]));
+      std::memcpy(to + offset, slots_[k], std::min(chunk_, size - offset));
+      if (c + kSlots < num_chunks) issue(c + kSlots);
+    }
+  }
+
+ private:
+  PinnedStaging()
+    : chunk_(std::max<size_t>(1, dmlc::GetEnv("MXNET_GPU_COPY_STAGING_CHUNK", 4)) << 20) {
+    for (int k = 0; k < kSlots; ++k) {
+      CUDA_CALL(cudaHostAlloc(reinterpret_cast<void**>(&slots_[k]), chunk_,
+                              cudaHostAllocPortable));
+      CUDA_CALL(cudaEventCreateWithFlags(&done_[k], cudaEventDisableTiming));
+    }
+  }
+
+  /*! \brief bytes of each slot */
+  const size_t chunk_;
+  char* slots_[kSlots];
+  /*! \brief recorded after the last dma of each slot */
+  cudaEvent_t done_[kSlots];
+  DISALLOW_COPY_AND_ASSIGN(PinnedStaging);
+};
+
+}  // namespace ndarray
+}  // namespace mxnet
+
+#endif  // MXNET_USE_CUDA
+#endif  // MXNET_NDARRAY_PINNED_STAGING_H_
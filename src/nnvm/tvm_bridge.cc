@@ -38,8 +38,16 @@
 #include <mxnet/c_api.h>
 #include <mxnet/ndarray.h>
 #include <mxnet/engine.h>
+#include <mxnet/op_attr_types.h>
+#include <nnvm/pass_functions.h>
 
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../executor/exec_pass.h"
 
 namespace mxnet {
 
@@ -167,6 +175,210 @@ void WrapAsyncCall(TVMArgs wrap_args, TVMRetValue* wrap_rv) {
   *wrap_rv = PackedFunc(wrapped);
 }
 
+/*!
+ * \brief Compiler of the subgraphs of _TVMSubgraph nodes, registered from TVM
+ *  through the bridge, with the functions it compiled for every shape.
+ */
+struct TVMSubgraphCompiler {
+  std::mutex mutex;
+  /*! \brief fcompile(graph_json, shapes_json, dtypes_json, dev_type, dev_id) */
+  PackedFunc fcompile;
+  PackedFunc fset_stream;
+  std::unordered_map<std::string, PackedFunc> compiled;
+
+  static TVMSubgraphCompiler* Get() {
+    static TVMSubgraphCompiler inst;
+    return &inst;
+  }
+};
+
+// Register the subgraph compiler, called by TVM with fcompile and TVMSetStream.
+void RegisterSubgraphCompiler(TVMArgs args, TVMRetValue* rv) {
+  TVMSubgraphCompiler* compiler = TVMSubgraphCompiler::Get();
+  std::lock_guard<std::mutex> lock(compiler->mutex);
+  compiler->fcompile = args[0];
+  compiler->fset_stream = args[1];
+  compiler->compiled.clear();
+}
+
+namespace exec {
+bool HasTVMSubgraphCompiler() {
+  TVMSubgraphCompiler* compiler = TVMSubgraphCompiler::Get();
+  std::lock_guard<std::mutex> lock(compiler->mutex);
+  return compiler->fcompile != nullptr;
+}
+}  // namespace exec
+
+namespace op {
+
+struct TVMSubgraphParam : public dmlc::Parameter<TVMSubgraphParam> {
+  int num_inputs;
+  std::string graph;
+  DMLC_DECLARE_PARAMETER(TVMSubgraphParam) {
+    DMLC_DECLARE_FIELD(num_inputs).set_lower_bound(1)
+    .describe("Number of inputs of the subgraph.");
+    DMLC_DECLARE_FIELD(graph)
+    .describe("Json of the subgraph, its inputs are the variables data0, data1, ...");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(TVMSubgraphParam);
+
+/*! \brief parsed _TVMSubgraph attributes */
+struct TVMSubgraphAttrs {
+  TVMSubgraphParam param;
+  /*! \brief the subgraph */
+  std::shared_ptr<nnvm::Graph> graph;
+  /*! \brief input number of each variable of the indexed subgraph */
+  std::vector<int> input_index;
+};
+
+void TVMSubgraphParser(nnvm::NodeAttrs* attrs) {
+  TVMSubgraphAttrs parsed;
+  parsed.param.Init(attrs->dict);
+  parsed.graph = std::make_shared<nnvm::Graph>(nnvm::pass::LoadJSON(parsed.param.graph));
+  const auto& idx = parsed.graph->indexed_graph();
+  for (uint32_t nid : idx.input_nodes()) {
+    const std::string& name = idx[nid].source->attrs.name;
+    CHECK_EQ(name.compare(0, 4, "data"), 0) << "Unexpected subgraph input " << name;
+    parsed.input_index.push_back(std::stoi(name.substr(4)));
+  }
+  CHECK_EQ(parsed.input_index.size(), static_cast<size_t>(parsed.param.num_inputs));
+  attrs->parsed = std::move(parsed);
+}
+
+/*! \brief infer an attribute of the inputs and the output through the subgraph */
+template<typename AttrType, typename InferFn>
+bool TVMSubgraphInfer(const nnvm::NodeAttrs& attrs, std::vector<AttrType>* in_attrs,
+                      std::vector<AttrType>* out_attrs, const char* attr_name,
+                      InferFn infer) {
+  const TVMSubgraphAttrs& parsed = nnvm::get<TVMSubgraphAttrs>(attrs.parsed);
+  std::vector<AttrType> inputs(parsed.input_index.size());
+  for (size_t i = 0; i < inputs.size(); ++i) inputs[i] = (*in_attrs)[parsed.input_index[i]];
+  nnvm::Graph g;
+  g.outputs = parsed.graph->outputs;
+  g = infer(std::move(g), std::move(inputs));
+  const auto& idx = g.indexed_graph();
+  const auto& values = g.GetAttr<std::vector<AttrType> >(attr_name);
+  for (size_t i = 0; i < parsed.input_index.size(); ++i) {
+    (*in_attrs)[parsed.input_index[i]] = values[idx.entry_id(idx.input_nodes()[i], 0)];
+  }
+  (*out_attrs)[0] = values[idx.entry_id(idx.outputs()[0])];
+  return g.GetAttr<size_t>(std::string(attr_name) + "_num_unknown_nodes") == 0;
+}
+
+bool TVMSubgraphShape(const nnvm::NodeAttrs& attrs, std::vector<TShape>* in_attrs,
+                      std::vector<TShape>* out_attrs) {
+  return TVMSubgraphInfer(attrs, in_attrs, out_attrs, "shape",
+                          [](nnvm::Graph g, nnvm::ShapeVector inputs) {
+                            return exec::InferShape(std::move(g), std::move(inputs));
+                          });
+}
+
+bool TVMSubgraphType(const nnvm::NodeAttrs& attrs, std::vector<int>* in_attrs,
+                     std::vector<int>* out_attrs) {
+  return TVMSubgraphInfer(attrs, in_attrs, out_attrs, "dtype",
+                          [](nnvm::Graph g, nnvm::DTypeVector inputs) {
+                            return exec::InferType(std::move(g), std::move(inputs));
+                          });
+}
+
+/*! \brief the function compiled for the shapes and types of the blobs, compiled if needed */
+PackedFunc TVMSubgraphFunction(const nnvm::NodeAttrs& attrs, const std::vector<TBlob>& blobs,
+                               const Context& ctx) {
+  const TVMSubgraphAttrs& parsed = nnvm::get<TVMSubgraphAttrs>(attrs.parsed);
+  std::ostringstream shapes, dtypes;
+  shapes << "[";
+  dtypes << "[";
+  for (size_t i = 0; i < blobs.size(); ++i) {
+    shapes << (i ? "," : "") << "[";
+    for (index_t j = 0; j < blobs[i].ndim(); ++j) shapes << (j ? "," : "") << blobs[i].shape_[j];
+    shapes << "]";
+    dtypes << (i ? "," : "") << blobs[i].type_flag_;
+  }
+  shapes << "]";
+  dtypes << "]";
+  const int dev_type = ctx.dev_mask() == gpu::kDevMask ? kDLGPU : kDLCPU;
+  std::ostringstream key;
+  key << parsed.param.graph << '\0' << shapes.str() << dtypes.str()
+      << dev_type << ":" << ctx.dev_id;
+
+  TVMSubgraphCompiler* compiler = TVMSubgraphCompiler::Get();
+  std::lock_guard<std::mutex> lock(compiler->mutex);
+  auto it = compiler->compiled.find(key.str());
+  if (it != compiler->compiled.end()) return it->second;
+  CHECK(compiler->fcompile != nullptr) << "No subgraph compiler registered through the TVM bridge";
+  PackedFunc f = compiler->fcompile(parsed.param.graph, shapes.str(), dtypes.str(),
+                                    dev_type, ctx.dev_id);
+  compiler->compiled[key.str()] = f;
+  return f;
+}
+
+template<typename xpu>
+void TVMSubgraphCompute(const nnvm::NodeAttrs& attrs, const OpContext& ctx,
+                        const std::vector<TBlob>& inputs, const std::vector<OpReqType>& req,
+                        const std::vector<TBlob>& outputs) {
+  CHECK(req[0] == kWriteTo || req[0] == kWriteInplace)
+    << "_TVMSubgraph only supports write requests";
+  // the compiled function takes the inputs followed by the output
+  std::vector<TBlob> blobs = inputs;
+  blobs.push_back(outputs[0]);
+  PackedFunc f = TVMSubgraphFunction(attrs, blobs, ctx.run_ctx.ctx);
+  std::vector<DLTensor> tensors;
+  for (const TBlob& blob : blobs) tensors.push_back(blob.dltensor());
+  std::vector<TVMValue> values(tensors.size());
+  std::vector<int> type_codes(tensors.size(), kArrayHandle);
+  for (size_t i = 0; i < tensors.size(); ++i) values[i].v_handle = &tensors[i];
+  TVMRetValue rv;
+  TVMArgs args(values.data(), type_codes.data(), values.size());
+  if (ctx.run_ctx.ctx.dev_mask() == gpu::kDevMask) {
+#if MXNET_USE_CUDA
+    PackedFunc fset_stream = TVMSubgraphCompiler::Get()->fset_stream;
+    void* strm = static_cast<void*>(ctx.get_stream<gpu>()->stream_);
+    fset_stream(static_cast<int>(kDLGPU), ctx.run_ctx.ctx.dev_id, strm);
+    f.CallPacked(args, &rv);
+    fset_stream(static_cast<int>(kDLGPU), ctx.run_ctx.ctx.dev_id, nullptr);
+#else
+    LOG(FATAL) << "Please compile with CUDA enabled for cuda features";
+#endif
+  } else {
+    f.CallPacked(args, &rv);
+  }
+}
+
+NNVM_REGISTER_OP(_TVMSubgraph)
+.describe(R"code(Runs a subgraph compiled by the compiler registered through the TVM bridge.
+
+Created by the executor when ``MXNET_EXEC_TVM_SUBGRAPH`` is set, from groups of
+single-consumer operators of inference graphs. The subgraph is compiled for
+every new combination of input shapes, types and device, on its first run.
+
+)code" ADD_FILELINE)
+.set_num_inputs([](const nnvm::NodeAttrs& attrs) {
+    return static_cast<uint32_t>(nnvm::get<TVMSubgraphAttrs>(attrs.parsed).param.num_inputs);
+  })
+.set_num_outputs(1)
+.set_attr_parser(TVMSubgraphParser)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const nnvm::NodeAttrs& attrs) {
+    const int num_inputs = nnvm::get<TVMSubgraphAttrs>(attrs.parsed).param.num_inputs;
+    std::vector<std::string> ret;
+    for (int i = 0; i < num_inputs; ++i) {
+      ret.push_back(std::string("data") + std::to_string(i));
+    }
+    return ret;
+  })
+.set_attr<std::string>("key_var_num_args", "num_inputs")
+.set_attr<nnvm::FInferShape>("FInferShape", TVMSubgraphShape)
+.set_attr<nnvm::FInferType>("FInferType", TVMSubgraphType)
+.set_attr<FCompute>("FCompute<cpu>", TVMSubgraphCompute<cpu>)
+#if MXNET_USE_CUDA
+.set_attr<FCompute>("FCompute<gpu>", TVMSubgraphCompute<gpu>)
+#endif  // MXNET_USE_CUDA
+.add_argument("data", "NDArray-or-Symbol[]", "Inputs of the subgraph")
+.add_arguments(TVMSubgraphParam::__FIELDS__());
+
+}  // namespace op
 }  // namespace mxnet
 
 // C callback that can be used by TVM to extract
@@ -176,5 +388,6 @@ extern "C" MXNET_DLL int MXTVMBridge(TVMFunctionHandle pregister) {
   const PackedFunc& fregister =
       *static_cast<PackedFunc*>(pregister);
   fregister("WrapAsyncCall", PackedFunc(mxnet::WrapAsyncCall));
+  fregister("RegisterSubgraphCompiler", PackedFunc(mxnet::RegisterSubgraphCompiler));
   return 0;
 }
@@ -0,0 +1,284 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file all_finite-inl.h
+ * \brief overflow checks of gradients and the dynamic loss scale of
+ *  mixed precision training. The flag and the scale stay on the device, so
+ *  no step of the training loop waits for the host.
+ */
+#ifndef MXNET_OPERATOR_ALL_FINITE_INL_H_
+#define MXNET_OPERATOR_ALL_FINITE_INL_H_
+
+#include <dmlc/parameter.h>
+#include <mxnet/operator_util.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "./mxnet_op.h"
+#include "./operator_common.h"
+#include "./elemwise_op_common.h"
+
+namespace mxnet {
+namespace op {
+
+using std::isfinite;
+
+struct AllFiniteParam : public dmlc::Parameter<AllFiniteParam> {
+  bool init_output;
+  DMLC_DECLARE_PARAMETER(AllFiniteParam) {
+    DMLC_DECLARE_FIELD(init_output)
+    .set_default(true)
+    .describe("Initialize the output to 1. If false, the output is only cleared when "
+              "a value is not finite, so the flags of several calls accumulate.");
+  }
+};
+
+struct MultiAllFiniteParam : public dmlc::Parameter<MultiAllFiniteParam> {
+  int num_arrays;
+  bool init_output;
+  DMLC_DECLARE_PARAMETER(MultiAllFiniteParam) {
+    DMLC_DECLARE_FIELD(num_arrays)
+    .set_default(1)
+    .set_lower_bound(1)
+    .describe("Number of arrays.");
+    DMLC_DECLARE_FIELD(init_output)
+    .set_default(true)
+    .describe("Initialize the output to 1. If false, the output is only cleared when "
+              "a value is not finite, so the flags of several calls accumulate.");
+  }
+};
+
+struct DynamicLossScaleParam : public dmlc::Parameter<DynamicLossScaleParam> {
+  float scale_factor;
+  int scale_window;
+  float min_loss_scale;
+  float max_loss_scale;
+  DMLC_DECLARE_PARAMETER(DynamicLossScaleParam) {
+    DMLC_DECLARE_FIELD(scale_factor)
+    .set_default(2.0f)
+    .describe("Factor the loss scale is divided by on overflow and multiplied by "
+              "after scale_window steps without one.");
+    DMLC_DECLARE_FIELD(scale_window)
+    .set_default(2000)
+    .set_lower_bound(1)
+    .describe("Number of steps without overflow after which the loss scale grows.");
+    DMLC_DECLARE_FIELD(min_loss_scale)
+    .set_default(1.0f)
+    .describe("Lower bound of the loss scale.");
+    DMLC_DECLARE_FIELD(max_loss_scale)
+    .set_default(16777216.0f)
+    .describe("Upper bound of the loss scale.");
+  }
+};
+
+/*! \brief the most arrays one multi_all_finite kernel checks */
+const int kMaxAllFiniteArrays = 60;
+
+template<typename DType>
+MSHADOW_XINLINE bool IsFinite(const DType val) {
+  return isfinite(static_cast<float>(val));
+}
+
+template<>
+MSHADOW_XINLINE bool IsFinite(const double val) {
+  return isfinite(val);
+}
+
+template<>
+MSHADOW_XINLINE bool IsFinite(const mshadow::half::half_t val) {
+  // the exponent bits of inf and nan are all set
+  return (val.half_ & 0x7c00) != 0x7c00;
+}
+
+struct AllFiniteInitKernel {
+  MSHADOW_XINLINE static void Map(int i, float* out) {
+    out[0] = 1.0f;
+  }
+};
+
+/*! \brief clears the flag on a value that is not finite, every writer stores the same 0 */
+struct AllFiniteKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const DType* data, float* out) {
+    if (!IsFinite(data[i])) out[0] = 0.0f;
+  }
+};
+
+template<typename DType>
+struct MultiAllFiniteKernelParam {
+  int count;
+  index_t max_size;
+  index_t sizes[kMaxAllFiniteArrays];
+  const DType* arrays[kMaxAllFiniteArrays];
+};
+
+struct MultiAllFiniteKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const MultiAllFiniteKernelParam<DType>& param,
+                                  float* out) {
+    for (int index = 0; index < param.count; ++index) {
+      if (static_cast<index_t>(i) < param.sizes[index] &&
+          !IsFinite(param.arrays[index][i])) {
+        out[0] = 0.0f;
+      }
+    }
+  }
+};
+
+/*!
+ * \brief one step of the dynamic loss scale: on overflow the scale shrinks and
+ *  the count of good steps restarts, after scale_window good steps it grows
+ */
+struct DynamicLossScaleKernel {
+  MSHADOW_XINLINE static void Map(int i, const float* is_finite, const float* loss_scale,
+                                  float* num_good_steps, float* out,
+                                  const float scale_factor, const int scale_window,
+                                  const float min_loss_scale, const float max_loss_scale) {
+    float scale = loss_scale[0];
+    if (is_finite[0] != 0.0f) {
+      num_good_steps[0] += 1.0f;
+      if (num_good_steps[0] >= static_cast<float>(scale_window)) {
+        scale = scale * scale_factor;
+        if (scale > max_loss_scale) scale = max_loss_scale;
+        num_good_steps[0] = 0.0f;
+      }
+    } else {
+      scale = scale / scale_factor;
+      if (scale < min_loss_scale) scale = min_loss_scale;
+      num_good_steps[0] = 0.0f;
+    }
+    out[0] = scale;
+  }
+};
+
+/*! \brief the flag output is a float32 scalar of shape (1,) */
+inline bool AllFiniteShape(const nnvm::NodeAttrs& attrs,
+                           std::vector<TShape>* in_attrs,
+                           std::vector<TShape>* out_attrs) {
+  CHECK_EQ(out_attrs->size(), 1U);
+  SHAPE_ASSIGN_CHECK(*out_attrs, 0, TShape(1, 1));
+  for (const TShape& shape : *in_attrs) {
+    if (shape.ndim() == 0) return false;
+  }
+  return true;
+}
+
+inline bool AllFiniteType(const nnvm::NodeAttrs& attrs,
+                          std::vector<int>* in_attrs,
+                          std::vector<int>* out_attrs) {
+  CHECK_EQ(out_attrs->size(), 1U);
+  TYPE_ASSIGN_CHECK(*out_attrs, 0, mshadow::kFloat32);
+  int dtype = -1;
+  for (int type : *in_attrs) {
+    if (type != -1) dtype = type;
+  }
+  if (dtype == -1) return false;
+  for (size_t i = 0; i < in_attrs->size(); ++i) TYPE_ASSIGN_CHECK(*in_attrs, i, dtype);
+  return true;
+}
+
+/*! \brief the flag, the loss scale and the count of good steps are float32 of shape (1,) */
+inline bool DynamicLossScaleShape(const nnvm::NodeAttrs& attrs,
+                                  std::vector<TShape>* in_attrs,
+                                  std::vector<TShape>* out_attrs) {
+  CHECK_EQ(in_attrs->size(), 3U);
+  CHECK_EQ(out_attrs->size(), 1U);
+  for (size_t i = 0; i < in_attrs->size(); ++i) SHAPE_ASSIGN_CHECK(*in_attrs, i, TShape(1, 1));
+  SHAPE_ASSIGN_CHECK(*out_attrs, 0, TShape(1, 1));
+  return true;
+}
+
+inline bool DynamicLossScaleType(const nnvm::NodeAttrs& attrs,
+                                 std::vector<int>* in_attrs,
+                                 std::vector<int>* out_attrs) {
+  CHECK_EQ(in_attrs->size(), 3U);
+  CHECK_EQ(out_attrs->size(), 1U);
+  for (size_t i = 0; i < in_attrs->size(); ++i) {
+    TYPE_ASSIGN_CHECK(*in_attrs, i, mshadow::kFloat32);
+  }
+  TYPE_ASSIGN_CHECK(*out_attrs, 0, mshadow::kFloat32);
+  return true;
+}
+
+template<typename xpu>
+inline void AllFiniteCompute(const nnvm::NodeAttrs& attrs,
+                             const OpContext& ctx,
+                             const std::vector<TBlob>& inputs,
+                             const std::vector<OpReqType>& req,
+                             const std::vector<TBlob>& outputs) {
+  using namespace mxnet_op;
+  const AllFiniteParam& param = nnvm::get<AllFiniteParam>(attrs.parsed);
+  mshadow::Stream<xpu>* s = ctx.get_stream<xpu>();
+  float* out = outputs[0].dptr<float>();
+  if (param.init_output) Kernel<AllFiniteInitKernel, xpu>::Launch(s, 1, out);
+  MSHADOW_TYPE_SWITCH(inputs[0].type_flag_, DType, {
+    Kernel<AllFiniteKernel, xpu>::Launch(s, inputs[0].Size(), inputs[0].dptr<DType>(), out);
+  });
+}
+
+/*! \brief checks all arrays in one kernel launch per kMaxAllFiniteArrays of them */
+template<typename xpu>
+inline void MultiAllFiniteCompute(const nnvm::NodeAttrs& attrs,
+                                  const OpContext& ctx,
+                                  const std::vector<TBlob>& inputs,
+                                  const std::vector<OpReqType>& req,
+                                  const std::vector<TBlob>& outputs) {
+  using namespace mxnet_op;
+  const MultiAllFiniteParam& param = nnvm::get<MultiAllFiniteParam>(attrs.parsed);
+  mshadow::Stream<xpu>* s = ctx.get_stream<xpu>();
+  float* out = outputs[0].dptr<float>();
+  if (param.init_output) Kernel<AllFiniteInitKernel, xpu>::Launch(s, 1, out);
+  MSHADOW_TYPE_SWITCH(inputs[0].type_flag_, DType, {
+    for (int begin = 0; begin < param.num_arrays; begin += kMaxAllFiniteArrays) {
+      MultiAllFiniteKernelParam<DType> kernel_param;
+      kernel_param.count = std::min(kMaxAllFiniteArrays, param.num_arrays - begin);
+      kernel_param.max_size = 0;
+      for (int k = 0; k < kernel_param.count; ++k) {
+        const TBlob& in = inputs[begin + k];
+        kernel_param.sizes[k] = in.Size();
+        kernel_param.max_size = std::max(kernel_param.max_size, kernel_param.sizes[k]);
+        kernel_param.arrays[k] = in.dptr<DType>();
+      }
+      Kernel<MultiAllFiniteKernel, xpu>::Launch(s, kernel_param.max_size, kernel_param, out);
+    }
+  });
+}
+
+template<typename xpu>
+inline void DynamicLossScaleCompute(const nnvm::NodeAttrs& attrs,
+                                    const OpContext& ctx,
+                                    const std::vector<TBlob>& inputs,
+                                    const std::vector<OpReqType>& req,
+                                    const std::vector<TBlob>& outputs) {
+  using namespace mxnet_op;
+  const DynamicLossScaleParam& param = nnvm::get<DynamicLossScaleParam>(attrs.parsed);
+  mshadow::Stream<xpu>* s = ctx.get_stream<xpu>();
+  if (req[0] == kNullOp) return;
+  Kernel<DynamicLossScaleKernel, xpu>::Launch(s, 1, inputs[0].dptr<float>(),
+    inputs[1].dptr<float>(), inputs[2].dptr<float>(), outputs[0].dptr<float>(),
+    param.scale_factor, param.scale_window, param.min_loss_scale, param.max_loss_scale);
+}
+
+}  // namespace op
+}  // namespace mxnet
+
+#endif  // MXNET_OPERATOR_ALL_FINITE_INL_H_
@@ -0,0 +1,117 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file all_finite.cc
+ * \brief overflow checks and dynamic loss scale of mixed precision training
+ */
+#include "./all_finite-inl.h"
+
+namespace mxnet {
+namespace op {
+
+DMLC_REGISTER_PARAMETER(AllFiniteParam);
+DMLC_REGISTER_PARAMETER(MultiAllFiniteParam);
+DMLC_REGISTER_PARAMETER(DynamicLossScaleParam);
+
+NNVM_REGISTER_OP(all_finite)
+.describe(R"code(Check whether all elements of the array are finite.
+
+The output is a float32 array of shape (1,) holding 1 if no element is inf or nan,
+and 0 otherwise. It stays on the device of the input, so it can feed other
+operators such as ``multi_mp_sgd_update`` without a copy to the host.
+
+)code" ADD_FILELINE)
+.set_num_inputs(1)
+.set_num_outputs(1)
+.set_attr_parser(ParamParser<AllFiniteParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", AllFiniteShape)
+.set_attr<nnvm::FInferType>("FInferType", AllFiniteType)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    return std::vector<std::string>{"data"};
+  })
+.set_attr<FCompute>("FCompute<cpu>", AllFiniteCompute<cpu>)
+.add_argument("data", "NDArray-or-Symbol", "Array")
+.add_arguments(AllFiniteParam::__FIELDS__());
+
+NNVM_REGISTER_OP(multi_all_finite)
+.describe(R"code(Check whether all elements of ``num_arrays`` arrays are finite.
+
+The output is a float32 array of shape (1,) holding 1 if no element of any array
+is inf or nan, and 0 otherwise. All arrays are checked in one kernel launch per
+60 arrays.
+
+)code" ADD_FILELINE)
+.set_num_inputs([](const nnvm::NodeAttrs& attrs) {
+    return static_cast<uint32_t>(nnvm::get<MultiAllFiniteParam>(attrs.parsed).num_arrays);
+  })
+.set_num_outputs(1)
+.set_attr_parser(ParamParser<MultiAllFiniteParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", AllFiniteShape)
+.set_attr<nnvm::FInferType>("FInferType", AllFiniteType)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    const int num_arrays = nnvm::get<MultiAllFiniteParam>(attrs.parsed).num_arrays;
+    std::vector<std::string> ret;
+    for (int i = 0; i < num_arrays; ++i) ret.push_back(std::string("array_") + std::to_string(i));
+    return ret;
+  })
+.set_attr<FCompute>("FCompute<cpu>", MultiAllFiniteCompute<cpu>)
+.add_argument("data", "NDArray-or-Symbol[]", "Arrays")
+.add_arguments(MultiAllFiniteParam::__FIELDS__());
+
+NNVM_REGISTER_OP(dynamic_loss_scale_update)
+.describe(R"code(Update the dynamic loss scale of mixed precision training.
+
+The inputs are float32 arrays of shape (1,): ``is_finite``, the output of
+``all_finite`` or ``multi_all_finite`` over the gradients, ``loss_scale`` and
+``num_good_steps``. The update is::
+
+    if is_finite:
+        num_good_steps += 1
+        if num_good_steps >= scale_window:
+            loss_scale = min(loss_scale * scale_factor, max_loss_scale)
+            num_good_steps = 0
+    else:
+        loss_scale = max(loss_scale / scale_factor, min_loss_scale)
+        num_good_steps = 0
+
+The output is the new loss scale, usually written to ``loss_scale`` in place, and
+``num_good_steps`` is updated in place. The state never leaves the device.
+
+)code" ADD_FILELINE)
+.set_num_inputs(3)
+.set_num_outputs(1)
+.set_attr_parser(ParamParser<DynamicLossScaleParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", DynamicLossScaleShape)
+.set_attr<nnvm::FInferType>("FInferType", DynamicLossScaleType)
+.set_attr<nnvm::FMutateInputs>("FMutateInputs",
+  [](const nnvm::NodeAttrs& attrs) {
+    return std::vector<uint32_t>{2};
+  })
+.set_attr<FCompute>("FCompute<cpu>", DynamicLossScaleCompute<cpu>)
+.add_argument("is_finite", "NDArray-or-Symbol", "Whether the gradients are finite")
+.add_argument("loss_scale", "NDArray-or-Symbol", "Loss scale")
+.add_argument("num_good_steps", "NDArray-or-Symbol", "Number of steps since the last overflow")
+.add_arguments(DynamicLossScaleParam::__FIELDS__());
+
+}  // namespace op
+}  // namespace mxnet
@@ -101,6 +101,23 @@ void Split(const mshadow::Tensor<xpu, dim, DType> &input,
     split_helper<xpu, dim, dim-1>(input, output, dimension, req);
   }
 }
+
+/*!
+ * \brief whether the (1, C_i, trailing) parts already lie back to back in the
+ *  (1, C, trailing) whole, as when the executor planned them as views of it.
+ *  Concat and split then have nothing to copy.
+ */
+template<typename xpu, typename DType>
+inline bool IsContiguousSlices(const std::vector<mshadow::Tensor<xpu, 3, DType> > &parts,
+                               const mshadow::Tensor<xpu, 3, DType> &whole) {
+  if (whole.size(0) != 1) return false;
+  const DType *ptr = whole.dptr_;
+  for (const auto &part : parts) {
+    if (part.dptr_ != ptr) return false;
+    ptr += part.shape_.Size();
+  }
+  return ptr == whole.dptr_ + whole.shape_.Size();
+}
 }  // namespace op
 }  // namespace mxnet
 #endif  // MXNET_OPERATOR_CHANNEL_OP_COMMON_H_
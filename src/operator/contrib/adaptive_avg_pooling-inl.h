@@ -43,6 +43,7 @@
 #include "../operator_common.h"
 #include "../mxnet_op.h"
 #include "../mshadow_op.h"
+#include "../nn/pool.h"
 
 namespace mxnet {
 namespace op {
@@ -90,8 +91,23 @@ inline void AdaptiveAvgPoolOpForward(const nnvm::NodeAttrs& attrs,
   CHECK_EQ(inputs.size(), 1U);
   CHECK_EQ(outputs.size(), 1U);
   mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
+  const TShape& ishape = inputs[0].shape_;
+  const TShape& oshape = outputs[0].shape_;
   MSHADOW_REAL_TYPE_SWITCH_EX(inputs[0].type_flag_, DType, AccReal, {
-    AdaptiveAvgPoolUpdateOutput<xpu, DType, AccReal>(s, inputs, outputs);
+    if (oshape[2] == 1 && oshape[3] == 1) {
+      global_pool(s, inputs[0].dptr<DType>(), ishape[0] * ishape[1], ishape[2] * ishape[3],
+                  pool_enum::kAvgPooling, outputs[0].dptr<DType>());
+    } else if (std::is_same<xpu, gpu>::value &&
+               !std::is_same<DType, mshadow::half::half_t>::value &&
+               ishape[2] % oshape[2] == 0 && ishape[3] % oshape[3] == 0) {
+      // the adaptive windows are the windows of plain average pooling, which the gpu
+      // computes without the per element window arithmetic, the cpu pool() is serial
+      const TShape kernel = mshadow::Shape2(ishape[2] / oshape[2], ishape[3] / oshape[3]);
+      pool(s, inputs[0].dptr<DType>(), ishape, oshape, kernel, mshadow::Shape2(0, 0), kernel,
+           pool_enum::kAvgPooling, kWriteTo, outputs[0].dptr<DType>());
+    } else {
+      AdaptiveAvgPoolUpdateOutput<xpu, DType, AccReal>(s, inputs, outputs);
+    }
   });
 }
 
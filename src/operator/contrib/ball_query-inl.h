@@ -15,6 +15,7 @@
 #include "../mshadow_op.h"
 #include "../tensor/init_op.h"
 #include "../operator_common.h"
+#include "./point_grid-inl.h"
 
 namespace mxnet {
   typedef std::vector<mxnet::TShape> ShapeVector;
@@ -23,11 +24,16 @@ namespace op {
 struct BallQueryParam : public dmlc::Parameter<BallQueryParam> {
   float radius;
   int nsample;
+  bool use_grid;
   DMLC_DECLARE_PARAMETER(BallQueryParam) {
     DMLC_DECLARE_FIELD(radius)
       .describe("Search radius.");
     DMLC_DECLARE_FIELD(nsample)
       .describe("Number of samples ball within radius to be returned.");
+    DMLC_DECLARE_FIELD(use_grid).set_default(false)
+      .describe("Index the points by a hashed grid of cells of edge radius and only "
+                "search the 27 cells around every query. Returns the same samples as "
+                "the search over all points and is faster for large point clouds.");
   }
 };
 
@@ -64,6 +70,63 @@ struct BallQueryKernel {
   }
 };
 
+/*! \brief keep the nsample smallest indices seen so far in ascending order */
+MSHADOW_XINLINE void BallQueryInsert(int* idx, int* cnt, const int nsample, const int k) {
+  if (*cnt == nsample && k >= idx[nsample - 1]) return;
+  int pos = *cnt < nsample ? (*cnt)++ : nsample - 1;
+  for (; pos > 0 && idx[pos - 1] > k; --pos) idx[pos] = idx[pos - 1];
+  idx[pos] = k;
+}
+
+struct BallQueryGridKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const int n, const int m,
+                                  const DType* xyz, const DType* query, int* idx,
+                                  const float r, const int nsample, const float cell,
+                                  const int table_size, const int* keys, const int* order) {
+    const int b = i / m;
+    query += i * 3;
+    xyz += b * n * 3;
+    idx += i * nsample;
+
+    const float r2 = r * r;
+    const float q_x = query[0];
+    const float q_y = query[1];
+    const float q_z = query[2];
+    const int cx = PointGridCoord(q_x, cell);
+    const int cy = PointGridCoord(q_y, cell);
+    const int cz = PointGridCoord(q_z, cell);
+    // neighbor cells may hash to the same bucket, which is searched once
+    int buckets[27];
+    int num_buckets = 0;
+    int cnt = 0;
+    for (int dx = -1; dx <= 1; ++dx) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dz = -1; dz <= 1; ++dz) {
+          const int h = PointGridHash(cx + dx, cy + dy, cz + dz, table_size);
+          bool seen = false;
+          for (int j = 0; j < num_buckets; ++j) seen = seen || buckets[j] == h;
+          if (seen) continue;
+          buckets[num_buckets++] = h;
+          int begin, end;
+          PointGridRange(keys, b * n, (b + 1) * n, b * table_size + h, &begin, &end);
+          for (int p = begin; p < end; ++p) {
+            const int k = order[p];
+            float x = xyz[k * 3 + 0];
+            float y = xyz[k * 3 + 1];
+            float z = xyz[k * 3 + 2];
+            float d2 = (q_x - x) * (q_x - x) + (q_y - y) * (q_y - y) + (q_z - z) * (q_z - z);
+            if (d2 < r2) BallQueryInsert(idx, &cnt, nsample, k);
+          }
+        }
+      }
+    }
+    // as in BallQueryKernel, the missing samples repeat the first one
+    if (cnt == 0) return;
+    for (int l = cnt; l < nsample; ++l) idx[l] = idx[0];
+  }
+};
+
 template <typename xpu>
 void BallQueryForward(const nnvm::NodeAttrs& attrs, const OpContext& ctx,
                          const std::vector<TBlob>& in_data,
@@ -79,6 +142,23 @@ void BallQueryForward(const nnvm::NodeAttrs& attrs, const OpContext& ctx,
 
   mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
   const BallQueryParam& param = nnvm::get<BallQueryParam>(attrs.parsed);
+  if (param.use_grid) {
+    // cells slightly larger than the radius, so rounding cannot move a
+    // neighbor beyond the adjacent cells
+    const float cell = param.radius * 1.001f;
+    const int table_size = PointGridTableSize(n);
+    mshadow::Tensor<xpu, 1, char> space = ctx.requested[0].get_space_typed<xpu, 1, char>(
+      mshadow::Shape1(PointGridWorkspaceSize<xpu>(batch_size, n)), s);
+    MSHADOW_TYPE_SWITCH(in_data[0].type_flag_, DType, {
+      int *keys, *order;
+      BuildPointGrid(s, in_data[0].dptr<DType>(), batch_size, n, cell, table_size, space,
+                     &keys, &order);
+      mxnet_op::Kernel<BallQueryGridKernel, xpu>::Launch(
+        s, batch_size * m, n, m, in_data[0].dptr<DType>(), in_data[1].dptr<DType>(),
+        out_data[0].dptr<int>(), param.radius, param.nsample, cell, table_size, keys, order);
+    });
+    return;
+  }
   MSHADOW_TYPE_SWITCH(in_data[0].type_flag_, DType, {
      mxnet_op::Kernel<BallQueryKernel, xpu>::Launch(
        s, batch_size*m, n, m, in_data[0].dptr<DType>(), in_data[1].dptr<DType>(), out_data[0].dptr<int>(),
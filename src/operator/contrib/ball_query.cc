@@ -55,6 +55,10 @@ NNVM_REGISTER_OP(_contrib_BallQuery)
   out_type->push_back(mshadow::kInt32);
   return true;
 })
+.set_attr<FResourceRequest>("FResourceRequest", [](const NodeAttrs& attrs) {
+  if (!nnvm::get<BallQueryParam>(attrs.parsed).use_grid) return std::vector<ResourceRequest>();
+  return std::vector<ResourceRequest>{ResourceRequest::kTempSpace};
+})
 .set_attr<FCompute>("FCompute<cpu>", BallQueryForward<cpu>)
 .set_attr<nnvm::FGradient>("FGradient", MakeZeroGradNodes)
 .add_argument("xyz", "NDArray-or-Symbol", "Points xyz, 3D tensor")
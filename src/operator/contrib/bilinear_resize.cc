@@ -23,14 +23,38 @@
  * \author Hang Zhang
 */
 #include "bilinear_resize-inl.h"
+#include <algorithm>
 // #include "elemwise_op_common.h"
 #include "../elemwise_op_common.h"
+#include "../../engine/openmp.h"
 
 namespace mxnet {
 namespace op {
 
 using namespace mshadow;
 
+/*!
+ * \brief source index, offset to the next source index and weight of the
+ *  next one, for every output position of an axis
+ */
+template<typename AccReal>
+struct BilinearAxisTable {
+  std::vector<int> index;
+  std::vector<int> next;
+  std::vector<AccReal> lambda;
+  BilinearAxisTable(int input_size, int output_size)
+    : index(output_size), next(output_size), lambda(output_size) {
+    const float ratio = (output_size > 1) ? static_cast<float>(input_size - 1) /
+                        (output_size - 1) : 0.f;
+    for (int o = 0; o < output_size; ++o) {
+      const float r = ratio * o;
+      index[o] = r;
+      next[o] = (index[o] < input_size - 1) ? 1 : 0;
+      lambda[o] = r - index[o];
+    }
+  }
+};
+
 template<typename xpu, typename DType, typename AccReal>
 void SpatialUpSamplingBilinearUpdateOutput(mshadow::Stream<cpu> *s,
                                            const std::vector<TBlob> &input,
@@ -44,50 +68,56 @@ void SpatialUpSamplingBilinearUpdateOutput(mshadow::Stream<cpu> *s,
   int inputHeight = itensor.size(2);
   int inputWidth = itensor.size(3);
 
-  DType *idata = itensor.dptr_;
+  const DType *idata = itensor.dptr_;
   DType *odata = otensor.dptr_;
   channels = nbatch * channels;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
   // special case: just copy
   if (inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const int h1 = h2;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const int w1 = w2;
-        const DType* pos1 = &idata[h1 * inputWidth + w1];
-        DType* pos2 = &odata[h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos2[0] = pos1[0];
-          pos1 += inputWidth * inputHeight;
-          pos2 += outputWidth * outputHeight;
-        }
-      }
+    const index_t plane = inputHeight * inputWidth;
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int c = 0; c < channels; ++c) {
+      std::copy(idata + c * plane, idata + (c + 1) * plane, odata + c * plane);
     }
     return;
   }
-  const float rheight =(outputHeight > 1) ? static_cast<float>(inputHeight - 1)/
-                       (outputHeight - 1) : 0.f;
-  const float rwidth = (outputWidth > 1) ? static_cast<float>(inputWidth - 1) /
-                       (outputWidth - 1) : 0.f;
-  for (int h2 = 0; h2 < outputHeight; ++h2) {
-    const float h1r = rheight * h2;
-    const int h1 = h1r;
-    const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-    const DType h1lambda = h1r - h1;
-    const DType h0lambda = (DType)1. - h1lambda;
-    for (int w2 = 0; w2 < outputWidth; ++w2) {
-      const float w1r = rwidth * w2;
-      const int w1 = w1r;
-      const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-      const DType w1lambda = w1r - w1;
-      const DType w0lambda = (DType)1. - w1lambda;
-      const DType* pos1 = &idata[h1 * inputWidth + w1];
-      DType* pos2 = &odata[h2 * outputWidth + w2];
-      for (int c = 0; c < channels; ++c) {
-        pos2[0] = h0lambda * (w0lambda * pos1[0]+ w1lambda * pos1[w1p])
-                  + h1lambda * (w0lambda * pos1[h1p * inputWidth]
-                  + w1lambda * pos1[h1p * inputWidth + w1p]);
-        pos1 += inputWidth * inputHeight;
-        pos2 += outputWidth * outputHeight;
+  // the interpolation is separable: an output row blends two input rows,
+  // which are interpolated along the width once and kept while h2 maps to them
+  const BilinearAxisTable<AccReal> htable(inputHeight, outputHeight);
+  const BilinearAxisTable<AccReal> wtable(inputWidth, outputWidth);
+  #pragma omp parallel num_threads(omp_threads)
+  {
+    std::vector<AccReal> rows(2 * outputWidth);
+    AccReal *row0 = rows.data();
+    AccReal *row1 = row0 + outputWidth;
+    #pragma omp for
+    for (int c = 0; c < channels; ++c) {
+      const DType *iplane = idata + static_cast<index_t>(c) * inputHeight * inputWidth;
+      DType *oplane = odata + static_cast<index_t>(c) * outputHeight * outputWidth;
+      int cached = -1;
+      for (int h2 = 0; h2 < outputHeight; ++h2) {
+        const int h1 = htable.index[h2];
+        if (h1 != cached) {
+          const DType *in0 = iplane + h1 * inputWidth;
+          const DType *in1 = in0 + htable.next[h2] * inputWidth;
+          for (int w2 = 0; w2 < outputWidth; ++w2) {
+            const int w1 = wtable.index[w2];
+            const int w1p = wtable.next[w2];
+            const AccReal w1lambda = wtable.lambda[w2];
+            const AccReal w0lambda = 1 - w1lambda;
+            row0[w2] = w0lambda * static_cast<AccReal>(in0[w1]) +
+                       w1lambda * static_cast<AccReal>(in0[w1 + w1p]);
+            row1[w2] = w0lambda * static_cast<AccReal>(in1[w1]) +
+                       w1lambda * static_cast<AccReal>(in1[w1 + w1p]);
+          }
+          cached = h1;
+        }
+        const AccReal h1lambda = htable.lambda[h2];
+        const AccReal h0lambda = 1 - h1lambda;
+        DType *orow = oplane + h2 * outputWidth;
+        for (int w2 = 0; w2 < outputWidth; ++w2) {
+          orow[w2] = static_cast<DType>(h0lambda * row0[w2] + h1lambda * row1[w2]);
+        }
       }
     }
   }
@@ -109,51 +139,52 @@ void SpatialUpSamplingBilinearUpdateGradInput(mshadow::Stream<cpu> *s,
   int inputWidth = gradInput.size(3);
 
   DType *data1 = gradInput.dptr_;
-  DType *data2 = gradOutput.dptr_;
+  const DType *data2 = gradOutput.dptr_;
   channels = nbatch * channels;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
 
   // special case: same-size matching grids
   if (inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const int h1 = h2;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const int w1 = w2;
-        DType* pos1 = &data1[h1 * inputWidth + w1];
-        const DType* pos2 = &data2[h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos1[0] += pos2[0];
-          pos1 += inputWidth * inputHeight;
-          pos2 += outputWidth * outputHeight;
-        }
-      }
+    const index_t plane = inputHeight * inputWidth;
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int c = 0; c < channels; ++c) {
+      DType *pos1 = data1 + c * plane;
+      const DType *pos2 = data2 + c * plane;
+      for (index_t i = 0; i < plane; ++i) pos1[i] += pos2[i];
     }
     return;
   }
-  const float rheight =(outputHeight > 1) ? static_cast<float>(inputHeight - 1)/
-                       (outputHeight - 1) : 0.f;
-  const float rwidth = (outputWidth > 1) ? static_cast<float>(inputWidth - 1)/
-                       (outputWidth - 1) : 0.f;
-  for (int h2 = 0; h2 < outputHeight; ++h2) {
-    const float h1r = rheight * h2;
-    const int h1 = h1r;
-    const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-    const DType h1lambda = h1r - h1;
-    const DType h0lambda = (DType)1. - h1lambda;
-    for (int w2 = 0; w2 < outputWidth; ++w2) {
-      const float w1r = rwidth * w2;
-      const int w1 = w1r;
-      const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-      const DType w1lambda = w1r - w1;
-      const DType w0lambda = (DType)1. - w1lambda;
-      DType* pos1 = &data1[h1 * inputWidth + w1];
-      const DType* pos2 = &data2[h2 * outputWidth + w2];
-      for (int c = 0; c < channels; ++c) {
-        pos1[0] += h0lambda * w0lambda * pos2[0];
-        pos1[w1p] += h0lambda * w1lambda * pos2[0];
-        pos1[h1p * inputWidth] += h1lambda * w0lambda * pos2[0];
-        pos1[h1p * inputWidth + w1p] += h1lambda * w1lambda * pos2[0];
-        pos1 += inputWidth * inputHeight;
-        pos2 += outputWidth * outputHeight;
+  // a gradient row is reduced along the width once, then split between the
+  // two input rows it came from
+  const BilinearAxisTable<AccReal> htable(inputHeight, outputHeight);
+  const BilinearAxisTable<AccReal> wtable(inputWidth, outputWidth);
+  #pragma omp parallel num_threads(omp_threads)
+  {
+    std::vector<AccReal> row(inputWidth);
+    #pragma omp for
+    for (int c = 0; c < channels; ++c) {
+      DType *iplane = data1 + static_cast<index_t>(c) * inputHeight * inputWidth;
+      const DType *oplane = data2 + static_cast<index_t>(c) * outputHeight * outputWidth;
+      for (int h2 = 0; h2 < outputHeight; ++h2) {
+        const DType *grow = oplane + h2 * outputWidth;
+        std::fill(row.begin(), row.end(), AccReal(0));
+        for (int w2 = 0; w2 < outputWidth; ++w2) {
+          const int w1 = wtable.index[w2];
+          const AccReal w1lambda = wtable.lambda[w2];
+          const AccReal g = static_cast<AccReal>(grow[w2]);
+          row[w1] += (1 - w1lambda) * g;
+          row[w1 + wtable.next[w2]] += w1lambda * g;
+        }
+        const AccReal h1lambda = htable.lambda[h2];
+        const AccReal h0lambda = 1 - h1lambda;
+        DType *in0 = iplane + htable.index[h2] * inputWidth;
+        DType *in1 = in0 + htable.next[h2] * inputWidth;
+        for (int w1 = 0; w1 < inputWidth; ++w1) {
+          in0[w1] = static_cast<DType>(static_cast<AccReal>(in0[w1]) + h0lambda * row[w1]);
+        }
+        for (int w1 = 0; w1 < inputWidth; ++w1) {
+          in1[w1] = static_cast<DType>(static_cast<AccReal>(in1[w1]) + h1lambda * row[w1]);
+        }
       }
     }
   }
@@ -238,49 +238,93 @@ MSHADOW_XINLINE DType Intersect(const DType *a, const DType *b, int encode) {
   return w > 0 ? w : DType(0);
 }
 
+/*! \brief boxes whose overlaps one nms_mask word holds */
+const int kNMSBlockSize = 64;
+
 /*!
-   * \brief Implementation of the non-maximum suppression operation
+   * \brief Bits of the boxes a candidate suppresses, for one block of later candidates
    *
-   * \param i the launched thread index
+   * \param i the launched thread index, over batch x candidate x column block
+   * \param mask output, bit j of word (b, k, c) is set if candidate k suppresses
+   *  candidate c * 64 + j of batch b, should they both be kept
    * \param index sorted index in descending order
    * \param input the input of nms op
    * \param areas pre-computed box areas
    * \param k nms topk number
-   * \param ref compare reference position
    * \param num number of input boxes in each batch
+   * \param col_blocks words of mask per candidate, ceil(k / 64)
    * \param stride input stride, usually 6 (id-score-x1-y1-x2-y2)
    * \param offset_box box offset, usually 2
+   * \param offset_id class id offset, used when force == false, usually 0
    * \param thresh nms threshold
    * \param force force suppress regardless of class id
-   * \param offset_id class id offset, used when force == false, usually 0
    * \param encode box encoding type, corner(0) or center(1)
    * \tparam DType the data type
    */
-struct nms_impl {
+struct nms_mask {
   template<typename DType>
-  MSHADOW_XINLINE static void Map(int i, DType *index, const DType *input,
-                                  const DType *areas, int k, int ref, int num,
-                                  int stride, int offset_box, int offset_id,
+  MSHADOW_XINLINE static void Map(int i, uint64_t *mask, const DType *index,
+                                  const DType *input, const DType *areas, int k, int num,
+                                  int col_blocks, int stride, int offset_box, int offset_id,
                                   float thresh, bool force, int encode) {
-    int b = i / k;  // batch
-    int pos = i % k + ref + 1;  // position
-    if (index[b * num + ref] < 0) return;  // reference has been suppressed
-    if (index[b * num + pos] < 0) return;  // self been suppressed
-    int ref_offset = static_cast<int>(index[b * num + ref]) * stride + offset_box;
-    int pos_offset = static_cast<int>(index[b * num + pos]) * stride + offset_box;
-    if (!force && offset_id >=0) {
-      int ref_id = static_cast<int>(input[ref_offset - offset_box + offset_id]);
-      int pos_id = static_cast<int>(input[pos_offset - offset_box + offset_id]);
-      if (ref_id != pos_id) return;  // different class
-    }
-    DType intersect = Intersect(input + ref_offset, input + pos_offset, encode);
-    intersect *= Intersect(input + ref_offset + 1, input + pos_offset + 1, encode);
+    int b = i / (k * col_blocks);  // batch
+    int ref = i / col_blocks % k;  // candidate
+    int col = i % col_blocks;  // block of later candidates
+    int begin = col * kNMSBlockSize > ref + 1 ? col * kNMSBlockSize : ref + 1;
+    int end = (col + 1) * kNMSBlockSize < k ? (col + 1) * kNMSBlockSize : k;
     int ref_area_offset = static_cast<int>(index[b * num + ref]);
-    int pos_area_offset = static_cast<int>(index[b * num + pos]);
-    DType iou = intersect / (areas[ref_area_offset] + areas[pos_area_offset] -
-      intersect);
-    if (iou > thresh) {
-      index[b * num + pos] = -1;
+    int ref_offset = ref_area_offset * stride + offset_box;
+    int ref_id = 0;
+    if (!force && offset_id >= 0) {
+      ref_id = static_cast<int>(input[ref_offset - offset_box + offset_id]);
+    }
+    uint64_t bits = 0;
+    for (int pos = begin; pos < end; ++pos) {
+      int pos_area_offset = static_cast<int>(index[b * num + pos]);
+      int pos_offset = pos_area_offset * stride + offset_box;
+      if (!force && offset_id >= 0 &&
+          static_cast<int>(input[pos_offset - offset_box + offset_id]) != ref_id) {
+        continue;  // different class
+      }
+      DType intersect = Intersect(input + ref_offset, input + pos_offset, encode);
+      intersect *= Intersect(input + ref_offset + 1, input + pos_offset + 1, encode);
+      DType iou = intersect / (areas[ref_area_offset] + areas[pos_area_offset] -
+        intersect);
+      if (iou > thresh) {
+        bits |= uint64_t(1) << (pos - col * kNMSBlockSize);
+      }
+    }
+    mask[i] = bits;
+  }
+};
+
+/*!
+   * \brief Greedy scan of the candidates of a batch in score order, suppressed ones are
+   *  marked -1 in index
+   *
+   * \param b the batch
+   * \param index sorted index in descending order
+   * \param mask suppression bits from nms_mask
+   * \param removed col_blocks words of scratch per batch
+   * \param k nms topk number
+   * \param num number of input boxes in each batch
+   * \param col_blocks words of mask per candidate
+   * \tparam DType the data type
+   */
+struct nms_scan {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int b, DType *index, const uint64_t *mask,
+                                  uint64_t *removed, int k, int num, int col_blocks) {
+    uint64_t *remv = removed + b * col_blocks;
+    for (int col = 0; col < col_blocks; ++col) remv[col] = 0;
+    for (int ref = 0; ref < k; ++ref) {
+      int col = ref / kNMSBlockSize;
+      if (remv[col] & (uint64_t(1) << (ref % kNMSBlockSize))) {
+        index[b * num + ref] = -1;
+        continue;
+      }
+      const uint64_t *ref_mask = mask + (static_cast<size_t>(b) * k + ref) * col_blocks;
+      for (; col < col_blocks; ++col) remv[col] |= ref_mask[col];
     }
   }
 };
@@ -348,16 +392,24 @@ void BoxNMSForward(const nnvm::NodeAttrs& attrs,
     Tensor<xpu, 3, DType> record = outputs[box_nms_enum::kTemp]
      .get_with_shape<xpu, 3, DType>(Shape3(num_batch, num_elem, 1), s);
 
-    // prepare workspace
+    // sort topk
+    int topk = param.topk < 0? num_elem : std::min(num_elem, param.topk);
+    int col_blocks = (topk + kNMSBlockSize - 1) / kNMSBlockSize;
+
+    // prepare workspace, the suppression masks go first to keep them aligned
     Shape<1> sort_index_shape = Shape1(num_batch * num_elem);
     Shape<3> buffer_shape = Shape3(num_batch, num_elem, width_elem);
-    index_t workspace_size = 4 * sort_index_shape.Size();
+    size_t mask_words = static_cast<size_t>(num_batch) * (topk + 1) * col_blocks;
+    index_t mask_size = (mask_words * sizeof(uint64_t) + sizeof(DType) - 1) / sizeof(DType);
+    index_t workspace_size = mask_size + 4 * sort_index_shape.Size();
     if (req[0] == kWriteInplace) {
       workspace_size += buffer_shape.Size();
     }
     Tensor<xpu, 1, DType> workspace = ctx.requested[box_nms_enum::kTempSpace]
       .get_space_typed<xpu, 1, DType>(Shape1(workspace_size), s);
-    Tensor<xpu, 1, DType> sorted_index(workspace.dptr_, sort_index_shape, s);
+    uint64_t *mask = reinterpret_cast<uint64_t*>(workspace.dptr_);
+    uint64_t *removed = mask + static_cast<size_t>(num_batch) * topk * col_blocks;
+    Tensor<xpu, 1, DType> sorted_index(workspace.dptr_ + mask_size, sort_index_shape, s);
     Tensor<xpu, 1, DType> scores(sorted_index.dptr_ + sorted_index.MSize(),
       sort_index_shape, s);
     Tensor<xpu, 1, DType> batch_id(scores.dptr_ + scores.MSize(), sort_index_shape,
@@ -375,8 +427,6 @@ void BoxNMSForward(const nnvm::NodeAttrs& attrs,
     int coord_start = param.coord_start;
     int id_index = param.id_index;
 
-    // sort topk
-    int topk = param.topk < 0? num_elem : std::min(num_elem, param.topk);
     if (topk < 1) {
       out = F<mshadow_op::identity>(buffer);
       record = reshape(range<DType>(0, num_batch * num_elem), record.shape_);
@@ -397,15 +447,13 @@ void BoxNMSForward(const nnvm::NodeAttrs& attrs,
      param.in_format);
 
     // apply nms
-    // go through each box as reference, suppress if overlap > threshold
-    // sorted_index with -1 is marked as suppressed
-    for (int ref = 0; ref < topk; ++ref) {
-      int num_worker = topk - ref - 1;
-      if (num_worker < 1) continue;
-      Kernel<nms_impl, xpu>::Launch(s, num_batch * num_worker, sorted_index.dptr_,
-        buffer.dptr_, areas.dptr_, num_worker, ref, num_elem, width_elem,
-        coord_start, id_index, param.overlap_thresh, param.force_suppress, param.in_format);
-    }
+    // the overlaps of every candidate with the later ones of its batch become bit masks
+    // in one launch, then a greedy scan per batch marks suppressed sorted_index with -1
+    Kernel<nms_mask, xpu>::Launch(s, num_batch * topk * col_blocks, mask,
+      sorted_index.dptr_, buffer.dptr_, areas.dptr_, topk, num_elem, col_blocks, width_elem,
+      coord_start, id_index, param.overlap_thresh, param.force_suppress, param.in_format);
+    Kernel<nms_scan, xpu>::Launch(s, num_batch, sorted_index.dptr_, mask, removed, topk,
+      num_elem, col_blocks);
 
     // store the results to output, keep a record for backward
     record = -1;
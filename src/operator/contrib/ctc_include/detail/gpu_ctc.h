@@ -41,20 +41,26 @@ class GpuCTC {
         GpuCTC(const GpuCTC&) = delete;
         GpuCTC& operator=(const GpuCTC&) = delete;
 
+        // The labels and lengths are in device memory, and flat_labels holds
+        // max_label_length labels per utterance, padded at the end.
         ctcStatus_t
         cost_and_grad(const ProbT* const activations,
                       ProbT* grads,
                       ProbT* costs,
                       const int* const flat_labels,
                       const int* const label_lengths,
-                      const int* const input_lengths);
+                      const int* const input_lengths,
+                      int max_label_length,
+                      int max_input_length);
 
         ctcStatus_t
         score_forward(const ProbT* const activations,
                       ProbT* costs,
                       const int* const flat_labels,
                       const int* const label_lengths,
-                      const int* const input_lengths);
+                      const int* const input_lengths,
+                      int max_label_length,
+                      int max_input_length);
 
     private:
 
@@ -74,12 +80,16 @@ class GpuCTC {
         ctcStatus_t
         setup_gpu_metadata(const int* const flat_labels,
                            const int* const label_lengths,
-                           const int* const input_lengths);
+                           const int* const input_lengths,
+                           int max_label_length,
+                           int max_input_length);
 
         ctcStatus_t
         create_metadata_and_choose_config(const int* const label_lengths,
                                           const int* const flat_labels,
                                           const int* const input_lengths,
+                                          int max_label_length,
+                                          int max_input_length,
                                           size_t& best_config);
 
         ctcStatus_t
@@ -92,6 +102,8 @@ class GpuCTC {
                                const int* const flat_labels,
                                const int* const label_lengths,
                                const int* const input_lengths,
+                               int max_label_length,
+                               int max_input_length,
                                bool compute_alpha,
                                bool compute_betas_and_grad);
 
@@ -108,11 +120,11 @@ class GpuCTC {
         CUstream stream_;
         int blank_label_;
 
-        int *utt_length_; // T
-        int *label_sizes_; // L
+        const int *utt_length_; // T
+        const int *label_sizes_; // L
         int *repeats_; // repeats_
         int *label_offsets_;
-        int *labels_without_blanks_;
+        const int *labels_without_blanks_;
         int *labels_with_blanks_;
         ProbT *alphas_;
         ProbT *nll_forward_;
@@ -125,7 +137,9 @@ template<typename ProbT>
 ctcStatus_t
 GpuCTC<ProbT>::setup_gpu_metadata(const int* const flat_labels,
                                   const int* const label_lengths,
-                                  const int* const input_lengths)
+                                  const int* const input_lengths,
+                                  int max_label_length,
+                                  int max_input_length)
 {
     size_t gpu_bytes_used = 0;
 
@@ -151,111 +165,22 @@ GpuCTC<ProbT>::setup_gpu_metadata(const int* const flat_labels,
                                 gpu_bytes_used);
     gpu_bytes_used += minibatch_ * sizeof(int);
 
+    // The lengths are only known on the device, so S and T are the bounds
+    // given by the padded labels and the activations. Each utterance still
+    // only runs over its own length in the alpha and beta kernels.
+    S_ = 2 * max_label_length + 1;
+    T_ = max_input_length;
 
-    // This is the max of all S and T for all valid examples in the minibatch.
-    // A valid example is one for which L + repeats <= T
-    S_ = 0;
-    T_ = 0;
+    activation_cols_ = minibatch_ * max_input_length;
 
-    // This is the max of all timesteps, valid or not. Needed to compute offsets
-    int Tmax = 0;
-
-    // This is the max of all labels, valid or not. Needed to compute offsets
-    int Lmax = 0;
-    int total_label_length = 0;
-
-    constexpr int cpu_buffer_size = 64;
-    int repeats[cpu_buffer_size];
-    int label_offsets[cpu_buffer_size];
-
-    const int num_passes = ctc_helper::div_up(minibatch_, cpu_buffer_size);
-
-    cudaError_t cuda_status;
-
-    for (int pass = 0; pass < num_passes; ++pass) {
-
-        const int start_idx = pass * cpu_buffer_size;
-        const int end_idx = std::min(minibatch_, (pass+1) * cpu_buffer_size);
-
-        for (int j = start_idx; j < end_idx; ++j) {
-            const int L = label_lengths[j];
-            const int local_T = input_lengths[j];
-            const int *label_ptr = &(flat_labels[total_label_length]);
-
-            label_offsets[j % cpu_buffer_size] = total_label_length;
-            total_label_length += L;
-
-            int repeat_counter = 0;
-
-            for (int i = 1; i < L; ++i)
-                repeat_counter += (label_ptr[i] == label_ptr[i-1]);
-
-            repeats[j % cpu_buffer_size] = repeat_counter;
-            const bool valid_label = ((L + repeat_counter) <= local_T);
-
-            // Only update S and T if label is valid
-            S_ = (valid_label) ? std::max(S_, L) : S_;
-            T_ = (valid_label) ? std::max(T_, local_T) : T_;
-
-            Tmax = std::max(Tmax, local_T);
-            Lmax = std::max(Lmax, L);
-        }
-
-        cuda_status = cudaMemcpyAsync(&(repeats_[start_idx]), repeats,
-                                      (end_idx - start_idx) * sizeof(int),
-                                      cudaMemcpyHostToDevice, stream_);
-        if (cuda_status != cudaSuccess)
-            return CTC_STATUS_MEMOPS_FAILED;
-
-
-        cuda_status = cudaMemcpyAsync(&(label_offsets_[start_idx]), label_offsets,
-                                      (end_idx - start_idx) * sizeof(int),
-                                      cudaMemcpyHostToDevice, stream_);
-        if (cuda_status != cudaSuccess)
-            return CTC_STATUS_MEMOPS_FAILED;
-    }
-
-    S_ = 2 * S_ + 1;
-    const int Smax = 2 * Lmax + 1;
-
-    activation_cols_ = minibatch_ * Tmax;
-
-    // Allocate memory for T
-    utt_length_ =
-        reinterpret_cast<int *>(static_cast<char*>(gpu_workspace_) +
-                                gpu_bytes_used);
-    gpu_bytes_used += minibatch_  * sizeof(int);
-
-    cuda_status = cudaMemcpyAsync(utt_length_, input_lengths,
-                                  minibatch_ * sizeof(int),
-                                  cudaMemcpyHostToDevice, stream_);
-    if (cuda_status != cudaSuccess)
-        return CTC_STATUS_MEMOPS_FAILED;
-
-    label_sizes_ =
-        reinterpret_cast<int *>(static_cast<char*>(gpu_workspace_) +
-                                gpu_bytes_used);
-    gpu_bytes_used += minibatch_ * sizeof(int);
-    cuda_status = cudaMemcpyAsync(label_sizes_, label_lengths,
-                                  minibatch_ * sizeof(int),
-                                  cudaMemcpyHostToDevice, stream_);
-    if (cuda_status != cudaSuccess)
-        return CTC_STATUS_MEMOPS_FAILED;
-
-    labels_without_blanks_ =
-        reinterpret_cast<int *>(static_cast<char*>(gpu_workspace_) +
-                                gpu_bytes_used);
-    gpu_bytes_used += Lmax * minibatch_ * sizeof(int);
-    cuda_status = cudaMemcpyAsync(labels_without_blanks_, flat_labels,
-                                  total_label_length * sizeof(int),
-                                  cudaMemcpyHostToDevice, stream_);
-    if (cuda_status != cudaSuccess)
-        return CTC_STATUS_MEMOPS_FAILED;
+    utt_length_ = input_lengths;
+    label_sizes_ = label_lengths;
+    labels_without_blanks_ = flat_labels;
 
     labels_with_blanks_ =
         reinterpret_cast<int *>(static_cast<char*>(gpu_workspace_) +
                                 gpu_bytes_used);
-    gpu_bytes_used += Smax * minibatch_ * sizeof(int);
+    gpu_bytes_used += S_ * minibatch_ * sizeof(int);
 
     alphas_ =
         reinterpret_cast<ProbT *>(static_cast<char*>(gpu_workspace_) +
@@ -273,6 +198,15 @@ GpuCTC<ProbT>::setup_gpu_metadata(const int* const flat_labels,
                                   gpu_bytes_used);
     gpu_bytes_used += out_dim_ * activation_cols_ * sizeof(ProbT);
 
+    // Count the repeats and set the label offsets on the device
+    const int NT = 128;
+    setup_label_metadata_kernel<ProbT><<<ctc_helper::div_up(minibatch_, NT), NT, 0, stream_>>>
+        (labels_without_blanks_, label_sizes_, utt_length_, max_label_length,
+         minibatch_, repeats_, label_offsets_, nll_forward_);
+
+    if (cudaGetLastError() != cudaSuccess)
+        return CTC_STATUS_EXECUTION_FAILED;
+
     return CTC_STATUS_SUCCESS;
 }
 
@@ -303,8 +237,6 @@ ctcStatus_t GpuCTC<ProbT>::launch_alpha_beta_kernels(const ProbT* const log_prob
             (log_probs, label_sizes_, utt_length_, repeats_,
              labels_with_blanks_, alphas_, nll_forward_, nll_backward_,
              grads, stride, out_dim_, S_, T_, blank_label_);
-
-        cudaStreamSynchronize(stream_);
     }
 
     cudaError_t err = cudaGetLastError();
@@ -319,10 +251,13 @@ ctcStatus_t
 GpuCTC<ProbT>::create_metadata_and_choose_config(const int* const flat_labels,
                                                  const int* const label_lengths,
                                                  const int* const input_lengths,
+                                                 int max_label_length,
+                                                 int max_input_length,
                                                  size_t& best_config) {
 
     // Setup the metadata for GPU
-    ctcStatus_t status = setup_gpu_metadata(flat_labels, label_lengths, input_lengths);
+    ctcStatus_t status = setup_gpu_metadata(flat_labels, label_lengths, input_lengths,
+                                            max_label_length, max_input_length);
     if (status != CTC_STATUS_SUCCESS)
         return status;
 
@@ -438,6 +373,8 @@ GpuCTC<ProbT>::compute_cost_and_score(const ProbT* const activations,
                                       const int* const flat_labels,
                                       const int* const label_lengths,
                                       const int* const input_lengths,
+                                      int max_label_length,
+                                      int max_input_length,
                                       bool compute_alpha,
                                       bool compute_betas_and_grad) {
 
@@ -445,6 +382,8 @@ GpuCTC<ProbT>::compute_cost_and_score(const ProbT* const activations,
     ctcStatus_t status = create_metadata_and_choose_config(flat_labels,
                                                            label_lengths,
                                                            input_lengths,
+                                                           max_label_length,
+                                                           max_input_length,
                                                            best_config);
     if (status != CTC_STATUS_SUCCESS)
         return status;
@@ -453,15 +392,17 @@ GpuCTC<ProbT>::compute_cost_and_score(const ProbT* const activations,
     if (status != CTC_STATUS_SUCCESS)
         return status;
 
-    launch_gpu_kernels(log_probs_, grads, best_config,
-                       compute_alpha, compute_betas_and_grad);
+    status = launch_gpu_kernels(log_probs_, grads, best_config,
+                                compute_alpha, compute_betas_and_grad);
+    if (status != CTC_STATUS_SUCCESS)
+        return status;
 
-    cudaError_t cuda_status_mem, cuda_status_sync;
+    // The costs are on the device too, so there is no need to wait for the stream
+    cudaError_t cuda_status_mem;
     cuda_status_mem = cudaMemcpyAsync(costs, nll_forward_,
                                       sizeof(ProbT) * minibatch_,
-                                      cudaMemcpyDeviceToHost, stream_);
-    cuda_status_sync = cudaStreamSynchronize(stream_);
-    if (cuda_status_mem != cudaSuccess || cuda_status_sync != cudaSuccess)
+                                      cudaMemcpyDeviceToDevice, stream_);
+    if (cuda_status_mem != cudaSuccess)
         return CTC_STATUS_MEMOPS_FAILED;
 
     return CTC_STATUS_SUCCESS;
@@ -474,7 +415,9 @@ GpuCTC<ProbT>::cost_and_grad(const ProbT* const activations,
                              ProbT* costs,
                              const int* const flat_labels,
                              const int* const label_lengths,
-                             const int* const input_lengths) {
+                             const int* const input_lengths,
+                             int max_label_length,
+                             int max_input_length) {
     if (activations == nullptr ||
         grads == nullptr ||
         costs == nullptr ||
@@ -485,7 +428,8 @@ GpuCTC<ProbT>::cost_and_grad(const ProbT* const activations,
         return CTC_STATUS_INVALID_VALUE;
 
     return compute_cost_and_score(activations, grads, costs, flat_labels,
-                                  label_lengths, input_lengths, true, true);
+                                  label_lengths, input_lengths,
+                                  max_label_length, max_input_length, true, true);
 }
 
 template<typename ProbT>
@@ -494,7 +438,9 @@ GpuCTC<ProbT>::score_forward(const ProbT* const activations,
                              ProbT* costs,
                              const int* const flat_labels,
                              const int* const label_lengths,
-                             const int* const input_lengths) {
+                             const int* const input_lengths,
+                             int max_label_length,
+                             int max_input_length) {
     if (activations == nullptr ||
         costs == nullptr ||
         flat_labels == nullptr ||
@@ -504,7 +450,8 @@ GpuCTC<ProbT>::score_forward(const ProbT* const activations,
         return CTC_STATUS_INVALID_VALUE;
 
     return compute_cost_and_score(activations, nullptr, costs, flat_labels,
-                                  label_lengths, input_lengths, true, false);
+                                  label_lengths, input_lengths,
+                                  max_label_length, max_input_length, true, false);
 }
 
 } // mxnet_warpctc
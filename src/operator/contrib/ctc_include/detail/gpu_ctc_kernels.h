@@ -96,6 +96,32 @@ struct CTASegReduce {
     }
 };
 
+// Counts the repeated labels of every utterance and sets its offset into the
+// labels, which hold label_stride labels per utterance. Utterances too short for
+// their labels are skipped by the alpha and beta kernels, their cost is zero as
+// on the cpu.
+template<typename ProbT>
+__global__
+void setup_label_metadata_kernel (const int *labels, const int *label_sizes,
+                                  const int *utt_length, int label_stride, int minibatch,
+                                  int *repeats_in_labels, int *label_offsets,
+                                  ProbT *nll_forward) {
+    const int mb = blockIdx.x * blockDim.x + threadIdx.x;
+    if (mb >= minibatch)
+        return;
+
+    const int L = label_sizes[mb];
+    const int *label_ptr = &labels[mb * label_stride];
+    int repeat_counter = 0;
+    for (int i = 1; i < L; ++i)
+        repeat_counter += (label_ptr[i] == label_ptr[i-1]);
+
+    repeats_in_labels[mb] = repeat_counter;
+    label_offsets[mb] = mb * label_stride;
+    if ((L + repeat_counter) > utt_length[mb])
+        nll_forward[mb] = 0;
+}
+
 // Computes forward probabilities. This fills in a T * S matrix.
 // The computation starts at t=1 (2nd row) and ends at t=T-1 (last row). Each row has
 // S elements where S = 2L + 1.
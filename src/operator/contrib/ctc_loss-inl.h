@@ -41,6 +41,7 @@
 #include "../operator_common.h"
 #include "../sequence_op_common.h"
 #include "../mshadow_op.h"
+#include "../mxnet_op.h"
 #include "../nn/sequence_mask-inl.h"
 
 #if defined(__CUDACC__) && MXNET_USE_CUDNN == 1 && CUDNN_MAJOR >= 7
@@ -57,17 +58,12 @@ enum CTCLossOpOutputs { kOut, kGrad };
 enum CTCLossOpForwardResource { kTempSpace };
 }
 
+// maxL and maxT are the max of all label and data lengths in the minibatch. On gpu the
+// labels and lengths stay on the device, so they are bounded by the input shapes instead.
 template <typename T>
-inline void get_workspace_size(std::vector<int> *label_lengths,
-                               std::vector<int> *data_lengths,
+inline void get_workspace_size(int maxL, int maxT,
                                int alphabet_size, int minibatch, bool gpu,
                                size_t *size_bytes) {
-  // This is the max of all S and T for all examples in the minibatch.
-  int maxL = *std::max_element(label_lengths->data(),
-                               label_lengths->data() + minibatch);
-  int maxT = *std::max_element(data_lengths->data(),
-                               data_lengths->data() + minibatch);
-
   const int S = 2 * maxL + 1;
 
   *size_bytes = 0;
@@ -83,15 +79,6 @@ inline void get_workspace_size(std::vector<int> *label_lengths,
     // label offsets
     *size_bytes += sizeof(int) * minibatch;
 
-    // utt_length
-    *size_bytes += sizeof(int) * minibatch;
-
-    // label lengths
-    *size_bytes += sizeof(int) * minibatch;
-
-    // labels without blanks - overallocate for now
-    *size_bytes += sizeof(int) * maxL * minibatch;
-
     // labels with blanks
     *size_bytes += sizeof(int) * S * minibatch;
 
@@ -193,6 +180,33 @@ inline bool PackLabelByLength(mshadow::Tensor<xpu, 2, DType> labels,
   return exceed_limit;
 }
 
+// Converts the padded labels of an example to integers on the device and sets its
+// label and data lengths, taken from the length inputs when given. Otherwise the label
+// length is the position of the first padding value, and the data length is the
+// maximum sequence length.
+struct ctc_label_metadata {
+  template <typename DType>
+  MSHADOW_XINLINE static int Round(DType x) {
+    return static_cast<int>(x >= 0 ? x + DType(0.5) : x - DType(0.5));
+  }
+
+  template <typename DType>
+  MSHADOW_XINLINE static void Map(int b, const DType *labels, const DType *in_label_lengths,
+                                  const DType *in_data_lengths, int max_num_labels,
+                                  int max_seq_len, int padding_mask, int *int_labels,
+                                  int *label_lengths, int *data_lengths) {
+    const DType *label = labels + b * max_num_labels;
+    int *out = int_labels + b * max_num_labels;
+    int len = max_num_labels;
+    for (int i = 0; i < max_num_labels; ++i) {
+      out[i] = Round(label[i]);
+      if (len == max_num_labels && out[i] == padding_mask) len = i;
+    }
+    label_lengths[b] = in_label_lengths != nullptr ? Round(in_label_lengths[b]) : len;
+    data_lengths[b] = in_data_lengths != nullptr ? Round(in_data_lengths[b]) : max_seq_len;
+  }
+};
+
 struct CTCLossParam : public dmlc::Parameter<CTCLossParam> {
   bool use_data_lengths;
   bool use_label_lengths;
@@ -258,55 +272,15 @@ class CTCLossOp : public Operator {
 
     Tensor<xpu, 3, real_t> data =
         in_data[ctc_loss::kData].get<xpu, 3, real_t>(s);
-    Tensor<xpu, 2, real_t> labels =
-        in_data[ctc_loss::kLabel].get<xpu, 2, real_t>(s);
 
     Tensor<xpu, 1, real_t> costs =
         out_data[ctc_loss::kOut].get<xpu, 1, real_t>(s);
     Tensor<xpu, 3, real_t> grad =
         out_data[ctc_loss::kGrad].get<xpu, 3, real_t>(s);
 
-    int max_seq_len = data.size(0);
-    int batch_size = data.size(1);
-    int alphabet_size = data.size(2);
-
-    // data_lengths
-    std::vector<int> data_lengths(batch_size, max_seq_len);
-    if (param_.use_data_lengths) {
-      int kInputLength = 2;
-      IndexTensorToVector(in_data[kInputLength].get<xpu, 1, real_t>(s), &data_lengths);
-    }
-
-    // label_lengths
-    std::vector<int> packed_labels;
-    std::vector<int> label_lengths(batch_size);
-
-    if (param_.use_label_lengths) {
-      int kLabelLength = 2+param_.use_data_lengths;
-      exceed_cudnn_limit = PackLabelByLength(labels, in_data[kLabelLength].get<xpu, 1, real_t>(s),
-                                             &packed_labels, &label_lengths);
-    } else {
-      exceed_cudnn_limit = LabelTensorToPackedVector(labels, param_.blank_label == 0?0:-1,
-                                                     &packed_labels, &label_lengths);
-    }
-
-// CUDNN is disabled due to lack of support for input lengths
-/* #if defined(__CUDACC__) && MXNET_USE_CUDNN == 1 && CUDNN_MAJOR >= 7 */
-/*     if (!exceed_cudnn_limit) { */
-/*       cudnn_forward(ctx, s, data, costs, grad, */
-/*                     &data_lengths, &label_lengths, &packed_labels, */
-/*                     max_seq_len, batch_size, alphabet_size, */
-/*                     req[ctc_loss::kGrad] != mxnet::kNullOp); */
-/*     } else { */
-/*       baidu_forward(ctx, s, data, costs, grad, */
-/*                     &data_lengths, &label_lengths, &packed_labels, */
-/*                     batch_size, alphabet_size, req[ctc_loss::kGrad] != mxnet::kNullOp); */
-/*     } */
-/* #else */
-
-    baidu_forward(ctx, s, data, costs, grad,
-                  &data_lengths, &label_lengths, &packed_labels,
-                  batch_size, alphabet_size, req[ctc_loss::kGrad] != mxnet::kNullOp);
+    // CUDNN is disabled due to lack of support for input lengths
+    baidu_forward(ctx, s, in_data, data, costs, grad,
+                  req[ctc_loss::kGrad] != mxnet::kNullOp);
 
     if (param_.use_data_lengths) {
       // baidu warp CTC implementation sometimes includes undefined gradients
@@ -433,35 +407,104 @@ class CTCLossOp : public Operator {
   }
 #endif  // __CUDACC__ && CUDNN
 
-  inline virtual void baidu_forward(const OpContext &ctx,
-                                    mshadow::Stream<xpu>* s,
-                                    mshadow::Tensor<xpu, 3, real_t> data,
-                                    mshadow::Tensor<xpu, 1, real_t> costs,
-                                    mshadow::Tensor<xpu, 3, real_t> grad,
-                                    std::vector<int>* data_lengths,
-                                    std::vector<int>* label_lengths,
-                                    std::vector<int>* packed_labels,
-                                    int batch_size,
-                                    int alphabet_size,
-                                    bool req_grad) {
+  // The labels and lengths are packed on the host for the cpu kernels.
+  template <typename DType>
+  void baidu_forward(const OpContext &ctx,
+                     mshadow::Stream<cpu>* s,
+                     const std::vector<TBlob> &in_data,
+                     mshadow::Tensor<cpu, 3, DType> data,
+                     mshadow::Tensor<cpu, 1, DType> costs,
+                     mshadow::Tensor<cpu, 3, DType> grad,
+                     bool req_grad) {
     using namespace mshadow;
+    int max_seq_len = data.size(0);
+    int batch_size = data.size(1);
+    int alphabet_size = data.size(2);
+    Tensor<cpu, 2, DType> labels = in_data[ctc_loss::kLabel].get<cpu, 2, DType>(s);
+
+    // data_lengths
+    std::vector<int> data_lengths(batch_size, max_seq_len);
+    if (param_.use_data_lengths) {
+      int kInputLength = 2;
+      IndexTensorToVector(in_data[kInputLength].get<cpu, 1, DType>(s), &data_lengths);
+    }
+
+    // label_lengths
+    std::vector<int> packed_labels;
+    std::vector<int> label_lengths(batch_size);
+
+    if (param_.use_label_lengths) {
+      int kLabelLength = 2+param_.use_data_lengths;
+      exceed_cudnn_limit = PackLabelByLength(labels, in_data[kLabelLength].get<cpu, 1, DType>(s),
+                                             &packed_labels, &label_lengths);
+    } else {
+      exceed_cudnn_limit = LabelTensorToPackedVector(labels, param_.blank_label == 0?0:-1,
+                                                     &packed_labels, &label_lengths);
+    }
+
     // allocate temporary workspace
     size_t size_bytes;
-    bool gpu = data.kDevCPU ? false : true;
-    get_workspace_size<real_t>(label_lengths, data_lengths, alphabet_size,
-                               batch_size, gpu, &size_bytes);
+    get_workspace_size<DType>(*std::max_element(label_lengths.begin(), label_lengths.end()),
+                              *std::max_element(data_lengths.begin(), data_lengths.end()),
+                              alphabet_size, batch_size, false, &size_bytes);
 
     // round-up so there are enough elems in memory
-    int num_tmp_elems = (size_bytes + sizeof(real_t) - 1) / sizeof(real_t);
-    Tensor<xpu, 1, real_t> workspace =
-        ctx.requested[ctc_loss::kTempSpace].get_space_typed<xpu, 1, real_t>(
+    int num_tmp_elems = (size_bytes + sizeof(DType) - 1) / sizeof(DType);
+    Tensor<cpu, 1, DType> workspace =
+        ctx.requested[ctc_loss::kTempSpace].get_space_typed<cpu, 1, DType>(
             Shape1(num_tmp_elems), s);
 
-    compute_ctc_cost(data, costs.dptr_, grad.dptr_, packed_labels->data(),
-                     label_lengths->data(), data_lengths->data(),
+    compute_ctc_cost(data, costs.dptr_, grad.dptr_, packed_labels.data(),
+                     label_lengths.data(), data_lengths.data(),
                      workspace.dptr_, req_grad,
                      param_.blank_label == 0?0:(alphabet_size-1));
   }
+
+#ifdef __CUDACC__
+  // The labels are converted and the lengths computed on the device, and the gpu
+  // kernels read the padded labels directly, so the forward pass never waits for
+  // the stream. The workspace is sized by the input shapes.
+  template <typename DType>
+  void baidu_forward(const OpContext &ctx,
+                     mshadow::Stream<gpu>* s,
+                     const std::vector<TBlob> &in_data,
+                     mshadow::Tensor<gpu, 3, DType> data,
+                     mshadow::Tensor<gpu, 1, DType> costs,
+                     mshadow::Tensor<gpu, 3, DType> grad,
+                     bool req_grad) {
+    using namespace mshadow;
+    int max_seq_len = data.size(0);
+    int batch_size = data.size(1);
+    int alphabet_size = data.size(2);
+    Tensor<gpu, 2, DType> labels = in_data[ctc_loss::kLabel].get<gpu, 2, DType>(s);
+    int max_num_labels = labels.size(1);
+
+    size_t size_bytes;
+    get_workspace_size<DType>(max_num_labels, max_seq_len, alphabet_size, batch_size,
+                              true, &size_bytes);
+    // the integer labels, label lengths and data lengths follow the ctc workspace
+    const size_t num_ctc_elems = (size_bytes + sizeof(DType) - 1) / sizeof(DType);
+    const size_t meta_bytes = sizeof(int) * batch_size * (max_num_labels + 2);
+    const size_t num_meta_elems = (meta_bytes + sizeof(DType) - 1) / sizeof(DType);
+    Tensor<gpu, 1, DType> workspace =
+        ctx.requested[ctc_loss::kTempSpace].get_space_typed<gpu, 1, DType>(
+            Shape1(num_ctc_elems + num_meta_elems), s);
+    int *int_labels = reinterpret_cast<int *>(workspace.dptr_ + num_ctc_elems);
+    int *label_lengths = int_labels + batch_size * max_num_labels;
+    int *data_lengths = label_lengths + batch_size;
+
+    const DType *in_label_lengths = param_.use_label_lengths ?
+        in_data[2 + param_.use_data_lengths].dptr<DType>() : nullptr;
+    const DType *in_data_lengths = param_.use_data_lengths ? in_data[2].dptr<DType>() : nullptr;
+    mxnet_op::Kernel<ctc_label_metadata, gpu>::Launch(s, batch_size, labels.dptr_,
+        in_label_lengths, in_data_lengths, max_num_labels, max_seq_len,
+        param_.blank_label == 0 ? 0 : -1, int_labels, label_lengths, data_lengths);
+
+    compute_ctc_cost(data, costs.dptr_, grad.dptr_, int_labels, label_lengths, data_lengths,
+                     max_num_labels, workspace.dptr_, req_grad,
+                     param_.blank_label == 0?0:(alphabet_size-1));
+  }
+#endif  // __CUDACC__
 };  // class CTCLossOp
 
 template <typename xpu>
@@ -29,21 +29,31 @@
 
 namespace mshadow {
 
+// The labels are padded to max_label_length per example, and the labels and lengths
+// are in device memory.
 template <typename DType>
 ctcStatus_t compute_ctc_cost(const Tensor<gpu, 3, DType> activations,
                              DType *costs, DType *grads, int *labels,
                              int *label_lengths, int *input_lengths,
+                             int max_label_length,
                              void *workspace, int train, int blank_label) {
+  int max_seq_len = static_cast<int>(activations.size(0));
   int minibatch = static_cast<int>(activations.size(1));
   int alphabet_size = static_cast<int>(activations.size(2));
   mxnet_warpctc::GpuCTC<DType> ctc(alphabet_size, minibatch, workspace,
                     activations.stream_->stream_, blank_label);
+  ctcStatus_t status;
   if (train)
-    return ctc.cost_and_grad(activations.dptr_, grads, costs, labels,
-                             label_lengths, input_lengths);
+    status = ctc.cost_and_grad(activations.dptr_, grads, costs, labels,
+                               label_lengths, input_lengths,
+                               max_label_length, max_seq_len);
   else
-    return ctc.score_forward(activations.dptr_, costs, labels,
-                             label_lengths, input_lengths);
+    status = ctc.score_forward(activations.dptr_, costs, labels,
+                               label_lengths, input_lengths,
+                               max_label_length, max_seq_len);
+  CHECK_EQ(status, CTC_STATUS_SUCCESS) << "CTC loss failed on gpu, the label sequence "
+                                          "length " << max_label_length << " may be too long";
+  return status;
 }
 
 }  // namespace mshadow
@@ -21,7 +21,7 @@
  * Copyright (c) 2017 Microsoft
  * Licensed under The Apache-2.0 License [see LICENSE for details]
  * \file deformable_psroi_pooling.cc
- * \brief
+ * \brief CPU implementation of deformable psroi pooling
  * \author Yi Li, Guodong Zhang, Jifeng Dai
 */
 #include "./deformable_psroi_pooling-inl.h"
@@ -30,13 +30,90 @@
 #include <mshadow/packet-inl.h>
 #include <mshadow/dot_engine-inl.h>
 #include <cassert>
+#include "../../engine/openmp.h"
 
 using std::max;
 using std::min;
 using std::floor;
 using std::ceil;
+using std::round;
 
 namespace mshadow {
+  /*!
+   * \brief sampling window of the output bin (n, ctop, ph, pw), the same
+   *  arithmetic as the GPU kernels
+   */
+  template<typename DType>
+  struct DeformablePSROIBin {
+    int roi_batch_ind;
+    // channel of data pooled into the bin
+    int c;
+    // offset of the x transition in trans, -1 without trans
+    int trans_index;
+    DType wstart, hstart, sub_bin_size_w, sub_bin_size_h, roi_width, roi_height;
+  };
+
+  template<typename DType>
+  inline DeformablePSROIBin<DType> GetDeformablePSROIBin(const DType* bottom_rois,
+    const DType* bottom_trans, const int n, const int ctop, const int ph, const int pw,
+    const bool no_trans, const DType spatial_scale, const DType trans_std,
+    const int pooled_size, const int sample_per_part, const int group_size,
+    const int part_size, const int num_classes, const int channels_each_class) {
+    DeformablePSROIBin<DType> bin;
+    const DType* offset_bottom_rois = bottom_rois + n * 5;
+    bin.roi_batch_ind = offset_bottom_rois[0];
+    DType roi_start_w = static_cast<DType>(round(offset_bottom_rois[1])) * spatial_scale - 0.5;
+    DType roi_start_h = static_cast<DType>(round(offset_bottom_rois[2])) * spatial_scale - 0.5;
+    DType roi_end_w = static_cast<DType>(round(offset_bottom_rois[3]) + 1.) * spatial_scale - 0.5;
+    DType roi_end_h = static_cast<DType>(round(offset_bottom_rois[4]) + 1.) * spatial_scale - 0.5;
+
+    // Force too small ROIs to be 1x1
+    bin.roi_width = max(roi_end_w - roi_start_w, static_cast<DType>(0.1));  // avoid 0
+    bin.roi_height = max(roi_end_h - roi_start_h, static_cast<DType>(0.1));
+
+    DType bin_size_h = bin.roi_height / static_cast<DType>(pooled_size);
+    DType bin_size_w = bin.roi_width / static_cast<DType>(pooled_size);
+    bin.sub_bin_size_h = bin_size_h / static_cast<DType>(sample_per_part);
+    bin.sub_bin_size_w = bin_size_w / static_cast<DType>(sample_per_part);
+
+    int part_h = floor(static_cast<DType>(ph) / pooled_size * part_size);
+    int part_w = floor(static_cast<DType>(pw) / pooled_size * part_size);
+    int class_id = ctop / channels_each_class;
+    bin.trans_index = no_trans ? -1 :
+      (((n * num_classes + class_id) * 2) * part_size + part_h) * part_size + part_w;
+    DType trans_x = no_trans ? static_cast<DType>(0) :
+      bottom_trans[bin.trans_index] * trans_std;
+    DType trans_y = no_trans ? static_cast<DType>(0) :
+      bottom_trans[bin.trans_index + part_size * part_size] * trans_std;
+
+    bin.wstart = static_cast<DType>(pw) * bin_size_w + roi_start_w + trans_x * bin.roi_width;
+    bin.hstart = static_cast<DType>(ph) * bin_size_h + roi_start_h + trans_y * bin.roi_height;
+
+    int gw = floor(static_cast<DType>(pw) * group_size / pooled_size);
+    int gh = floor(static_cast<DType>(ph) * group_size / pooled_size);
+    gw = min(max(gw, 0), group_size - 1);
+    gh = min(max(gh, 0), group_size - 1);
+    bin.c = (ctop * group_size + gh) * group_size + gw;
+    return bin;
+  }
+
+  /*!
+   * \brief the sample (ih, iw) of the bin clamped into the feature map, false
+   *  when it falls outside
+   */
+  template<typename DType>
+  inline bool DeformablePSROISample(const DeformablePSROIBin<DType>& bin, const int ih,
+    const int iw, const int height, const int width, DType* w, DType* h) {
+    *w = bin.wstart + iw * bin.sub_bin_size_w;
+    *h = bin.hstart + ih * bin.sub_bin_size_h;
+    if (*w < -0.5 || *w > width - 0.5 || *h < -0.5 || *h > height - 0.5) {
+      return false;
+    }
+    *w = min(max(*w, static_cast<DType>(0)), static_cast<DType>(width - 1));
+    *h = min(max(*h, static_cast<DType>(0)), static_cast<DType>(height - 1));
+    return true;
+  }
+
   template<typename DType>
   inline void DeformablePSROIPoolForward(const Tensor<cpu, 4, DType> &out,
     const Tensor<cpu, 4, DType> &data,
@@ -51,8 +128,53 @@ namespace mshadow {
     const int part_size,
     const int sample_per_part,
     const float trans_std) {
-    // NOT_IMPLEMENTED;
-    return;
+    const DType *bottom_data = data.dptr_;
+    const DType *bottom_rois = bbox.dptr_;
+    const DType *bottom_trans = no_trans ? NULL : trans.dptr_;
+    DType *top_data = out.dptr_;
+    DType *top_count_data = top_count.dptr_;
+    const int num_rois = out.size(0);
+    const int channels = data.size(1);
+    const int height = data.size(2);
+    const int width = data.size(3);
+    const int num_classes = no_trans ? 1 : trans.size(1) / 2;
+    const int channels_each_class = no_trans ? output_dim : output_dim / num_classes;
+    const int pooled_area = pooled_size * pooled_size;
+    const int omp_threads = mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+
+    // every iteration fills the pooled_size x pooled_size bins of one roi and channel
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int nc = 0; nc < num_rois * output_dim; ++nc) {
+      const int n = nc / output_dim, ctop = nc % output_dim;
+      for (int ph = 0; ph < pooled_size; ++ph) {
+        for (int pw = 0; pw < pooled_size; ++pw) {
+          const DeformablePSROIBin<DType> bin = GetDeformablePSROIBin(bottom_rois, bottom_trans,
+            n, ctop, ph, pw, no_trans, static_cast<DType>(spatial_scale),
+            static_cast<DType>(trans_std), pooled_size, sample_per_part, group_size, part_size,
+            num_classes, channels_each_class);
+          const DType* plane = bottom_data +
+            (static_cast<size_t>(bin.roi_batch_ind) * channels + bin.c) * height * width;
+          DType sum = 0;
+          int count = 0;
+          for (int ih = 0; ih < sample_per_part; ++ih) {
+            for (int iw = 0; iw < sample_per_part; ++iw) {
+              DType w, h;
+              if (!DeformablePSROISample(bin, ih, iw, height, width, &w, &h)) continue;
+              const int x1 = floor(w), x2 = ceil(w), y1 = floor(h), y2 = ceil(h);
+              const DType dist_x = w - x1, dist_y = h - y1;
+              sum += (1 - dist_x) * (1 - dist_y) * plane[y1 * width + x1] +
+                     (1 - dist_x) * dist_y * plane[y2 * width + x1] +
+                     dist_x * (1 - dist_y) * plane[y1 * width + x2] +
+                     dist_x * dist_y * plane[y2 * width + x2];
+              ++count;
+            }
+          }
+          const int index = nc * pooled_area + ph * pooled_size + pw;
+          top_data[index] = count == 0 ? static_cast<DType>(0) : sum / count;
+          top_count_data[index] = count;
+        }
+      }
+    }
   }
 
   template<typename DType>
@@ -71,8 +193,77 @@ namespace mshadow {
     const int part_size,
     const int sample_per_part,
     const float trans_std) {
-    // NOT_IMPLEMENTED;
-    return;
+    const DType *top_diff = out_grad.dptr_;
+    const DType *top_count_data = top_count.dptr_;
+    const DType *bottom_data = data.dptr_;
+    const DType *bottom_rois = bbox.dptr_;
+    const DType *bottom_trans = no_trans ? NULL : trans.dptr_;
+    DType *bottom_data_diff = in_grad.dptr_;
+    DType *bottom_trans_diff = no_trans ? NULL : trans_grad.dptr_;
+    const int num_rois = out_grad.size(0);
+    const int channels = in_grad.size(1);
+    const int height = in_grad.size(2);
+    const int width = in_grad.size(3);
+    const int num_classes = no_trans ? 1 : trans.size(1) / 2;
+    const int channels_each_class = no_trans ? output_dim : output_dim / num_classes;
+    const int pooled_area = pooled_size * pooled_size;
+    const int omp_threads = mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+
+    // the bins of an output channel only pool the group_size x group_size data
+    // channels of it, so the iterations over output channels scatter into
+    // disjoint channels of the data gradient; the trans gradient of a roi is
+    // shared by the output channels of a class, so it is reduced per roi
+    for (int pass = 0; pass < (no_trans ? 1 : 2); ++pass) {
+      const int outer = pass == 0 ? output_dim : num_rois;
+      const int inner = pass == 0 ? num_rois : output_dim;
+      #pragma omp parallel for num_threads(omp_threads)
+      for (int o = 0; o < outer; ++o) {
+        for (int i = 0; i < inner; ++i) {
+          const int n = pass == 0 ? i : o, ctop = pass == 0 ? o : i;
+          for (int ph = 0; ph < pooled_size; ++ph) {
+            for (int pw = 0; pw < pooled_size; ++pw) {
+              const int index = (n * output_dim + ctop) * pooled_area + ph * pooled_size + pw;
+              if (top_count_data[index] <= 0) continue;
+              const DType diff_val = top_diff[index] / top_count_data[index];
+              const DeformablePSROIBin<DType> bin = GetDeformablePSROIBin(bottom_rois,
+                bottom_trans, n, ctop, ph, pw, no_trans, static_cast<DType>(spatial_scale),
+                static_cast<DType>(trans_std), pooled_size, sample_per_part, group_size,
+                part_size, num_classes, channels_each_class);
+              const size_t offset =
+                (static_cast<size_t>(bin.roi_batch_ind) * channels + bin.c) * height * width;
+              for (int ih = 0; ih < sample_per_part; ++ih) {
+                for (int iw = 0; iw < sample_per_part; ++iw) {
+                  DType w, h;
+                  if (!DeformablePSROISample(bin, ih, iw, height, width, &w, &h)) continue;
+                  const int x0 = floor(w), x1 = ceil(w), y0 = floor(h), y1 = ceil(h);
+                  const DType dist_x = w - x0, dist_y = h - y0;
+                  if (pass == 0) {
+                    DType* diff = bottom_data_diff + offset;
+                    diff[y0 * width + x0] += (1 - dist_x) * (1 - dist_y) * diff_val;
+                    diff[y1 * width + x0] += (1 - dist_x) * dist_y * diff_val;
+                    diff[y0 * width + x1] += dist_x * (1 - dist_y) * diff_val;
+                    diff[y1 * width + x1] += dist_x * dist_y * diff_val;
+                    continue;
+                  }
+                  const DType* plane = bottom_data + offset;
+                  const DType U00 = plane[y0 * width + x0];
+                  const DType U01 = plane[y1 * width + x0];
+                  const DType U10 = plane[y0 * width + x1];
+                  const DType U11 = plane[y1 * width + x1];
+                  const DType diff_x = (U11 * dist_y + U10 * (1 - dist_y) - U01 * dist_y -
+                    U00 * (1 - dist_y)) * static_cast<DType>(trans_std) * diff_val;
+                  const DType diff_y = (U11 * dist_x + U01 * (1 - dist_x) - U10 * dist_x -
+                    U00 * (1 - dist_x)) * static_cast<DType>(trans_std) * diff_val;
+                  bottom_trans_diff[bin.trans_index] += diff_x * bin.roi_width;
+                  bottom_trans_diff[bin.trans_index + part_size * part_size] +=
+                    diff_y * bin.roi_height;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
   }
 }  // namespace mshadow
 
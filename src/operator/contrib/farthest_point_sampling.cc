@@ -4,18 +4,109 @@
  * \brief farthest point sampling
  * \author Feng Wang
 */
+#include <algorithm>
+#include <limits>
+#include <type_traits>
 #include "./farthest_point_sampling-inl.h"
+#include "../../engine/openmp.h"
 
 namespace mxnet {
 namespace op {
 
+namespace farthest_point_sampling {
+/*!
+ * \brief sample one batch element. The points are kept as separate x, y and z
+ *  arrays so the distance update vectorizes. Every step updates and reduces
+ *  contiguous chunks of the points in parallel, and ties go to the smallest
+ *  index as on GPU.
+ */
+template<typename DType, typename AType>
+void SampleCPU(const DType* data, int n, int c, int m, int nthreads,
+               int* idxs, DType* min_dis) {
+  std::vector<AType> x(n), y(n), z(n), dist(n, std::numeric_limits<AType>::max());
+  for (int k = 0; k < n; ++k) {
+    x[k] = data[k * c + 0];
+    y[k] = data[k * c + 1];
+    z[k] = data[k * c + 2];
+  }
+  // chunks of at least a few thousand points make the parallel region worth it
+  const int num_chunks = std::max(1, std::min(nthreads, n / 4096));
+  const int chunk = (n + num_chunks - 1) / num_chunks;
+  std::vector<AType> chunk_best(num_chunks);
+  std::vector<int> chunk_besti(num_chunks);
+  int old = 0;
+  idxs[0] = old;
+  for (int j = 1; j < m; ++j) {
+    const AType x1 = x[old], y1 = y[old], z1 = z[old];
+    #pragma omp parallel for num_threads(num_chunks) if (num_chunks > 1)
+    for (int t = 0; t < num_chunks; ++t) {
+      const int begin = t * chunk;
+      const int end = std::min(n, begin + chunk);
+      AType* d = dist.data();
+      for (int k = begin; k < end; ++k) {
+        const AType dx = x[k] - x1, dy = y[k] - y1, dz = z[k] - z1;
+        d[k] = std::min(d[k], dx * dx + dy * dy + dz * dz);
+      }
+      AType best = -1;
+      int besti = 0;
+      for (int k = begin; k < end; ++k) {
+        if (d[k] > best) {
+          best = d[k];
+          besti = k;
+        }
+      }
+      chunk_best[t] = best;
+      chunk_besti[t] = besti;
+    }
+    AType best = -1;
+    for (int t = 0; t < num_chunks; ++t) {
+      if (chunk_best[t] > best) {
+        best = chunk_best[t];
+        old = chunk_besti[t];
+      }
+    }
+    idxs[j] = old;
+  }
+  for (int k = 0; k < n; ++k) min_dis[k] = static_cast<DType>(dist[k]);
+}
+}  // namespace farthest_point_sampling
+
 template <>
 void FarthestPointSamplingForward<cpu>(const nnvm::NodeAttrs& attrs,
                                        const OpContext& ctx,
                                        const std::vector<TBlob>& inputs,
                                        const std::vector<OpReqType>& req,
                                        const std::vector<TBlob>& outputs) {
-  LOG(FATAL) << "NotImplemented";
+  using namespace farthest_point_sampling;
+  CHECK_EQ(inputs.size(), 1U);
+  CHECK_EQ(outputs.size(), 2U);
+  const FarthestPointSamplingParam& param =
+      nnvm::get<FarthestPointSamplingParam>(attrs.parsed);
+  const int b = inputs[kData].size(0);
+  const int n = inputs[kData].size(1);
+  const int c = inputs[kData].size(2);
+  const int m = param.npoints;
+  if (m <= 0 || n <= 0) return;
+  const int nthreads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  MSHADOW_REAL_TYPE_SWITCH(inputs[kData].type_flag_, DType, {
+    typedef typename std::conditional<std::is_same<DType, double>::value,
+                                      double, float>::type AType;
+    const DType* data = inputs[kData].dptr<DType>();
+    int* idxs = outputs[kOut].dptr<int>();
+    DType* min_dis = outputs[kMinDist].dptr<DType>();
+    if (b >= nthreads) {
+      // enough batch elements to keep every thread busy with one of them
+      #pragma omp parallel for num_threads(nthreads)
+      for (int i = 0; i < b; ++i) {
+        SampleCPU<DType, AType>(data + i * n * c, n, c, m, 1, idxs + i * m, min_dis + i * n);
+      }
+    } else {
+      for (int i = 0; i < b; ++i) {
+        SampleCPU<DType, AType>(data + i * n * c, n, c, m, nthreads, idxs + i * m,
+                                min_dis + i * n);
+      }
+    }
+  });
 }
 
 DMLC_REGISTER_PARAMETER(FarthestPointSamplingParam);
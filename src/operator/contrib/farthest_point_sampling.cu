@@ -5,145 +5,143 @@
  * \author Feng Wang
 */
 #include "./farthest_point_sampling-inl.h"
+#include <type_traits>
 #include "../../common/cuda_utils.h"
 
 namespace mxnet {
 namespace op {
 
 #define TOTAL_THREADS 1024
-#define THREADS_PER_BLOCK 256
-#define DIVUP(m, n) ((m) / (n) + ((m) % (n) > 0))
+#define WARP_SIZE 32
+#define FULL_WARP_MASK 0xFFFFFFFF
+/*! \brief bytes of shared memory a block may use to keep its points resident */
+#define MAX_RESIDENT_BYTES (48 * 1024)
+
+#if CUDA_VERSION < 9000
+template<typename DType>
+__forceinline__ __device__ DType __shfl_down_sync(unsigned, DType val, int delta) {
+  return __shfl_down(val, delta);
+}
+#endif
 
+/*! \brief a power of two number of threads, at least a warp and at most one per point */
 inline int opt_n_threads(int work_size) {
-    const int pow_2 = std::log(static_cast<double>(work_size)) / std::log(2.0);
-
-    return max(min(1 << pow_2, TOTAL_THREADS), 1);
+  int n_threads = WARP_SIZE;
+  while (n_threads < TOTAL_THREADS && n_threads < work_size) n_threads <<= 1;
+  return n_threads;
 }
 
-template <typename DType>
-__device__ void __update(DType* __restrict__ dists, int* __restrict__ dists_i,
-                            int idx1, int idx2) {
-    const DType v1 = dists[idx1], v2 = dists[idx2];
-    const int i1 = dists_i[idx1], i2 = dists_i[idx2];
-    dists[idx1] = max(v1, v2);
-    dists_i[idx1] = v2 > v1 ? i2 : i1;
+/*! \brief keep the larger distance, and the smaller index on ties */
+template <typename AType>
+__device__ __forceinline__ void fps_warp_argmax(AType* best, int* besti) {
+  for (int offset = WARP_SIZE / 2; offset > 0; offset >>= 1) {
+    const AType other = __shfl_down_sync(FULL_WARP_MASK, *best, offset);
+    const int other_i = __shfl_down_sync(FULL_WARP_MASK, *besti, offset);
+    if (other > *best || (other == *best && other_i < *besti)) {
+      *best = other;
+      *besti = other_i;
+    }
+  }
 }
 
-template <typename DType, unsigned int block_size>
+/*!
+ * \brief the whole sampling loop of one batch element in one block. With
+ *  resident, every thread keeps the coordinates and distances of its points in
+ *  shared memory, otherwise they stay in global memory. The argmax of a step
+ *  is reduced within warps by shuffles and then across warps, two block
+ *  barriers per step.
+ */
+template <typename DType, typename AType, bool resident>
 __global__ void farthest_point_sampling_kernel(
     int b, int n, int m, int c, const DType* __restrict__ bottom_data,
     DType* __restrict__ temp, int* __restrict__ idxs) {
-    // bottom_data: (B, N, C)
-    // temp: (B, N)
-    // output:
-    // idxs: (B, M)
-
-    if (m <= 0) return;
-    __shared__ DType dists[block_size];
-    __shared__ int dists_i[block_size];
-
-    int batch_index = blockIdx.x;
-    bottom_data += batch_index * n * c;
-    temp += batch_index * n;
-    idxs += batch_index * m;
-
-    int tid = threadIdx.x;
-    const int stride = block_size;
-
-    int old = 0;
-    if (threadIdx.x == 0) idxs[0] = old;
-
-    __syncthreads();
-    for (int j = 1; j < m; j++) {
+  // bottom_data: (B, N, C)
+  // temp: (B, N)
+  // output:
+  // idxs: (B, M)
+  if (m <= 0) return;
+  extern __shared__ char fps_resident[];
+  __shared__ AType warp_best[TOTAL_THREADS / WARP_SIZE];
+  __shared__ int warp_besti[TOTAL_THREADS / WARP_SIZE];
+  __shared__ int selected;
+
+  const int batch_index = blockIdx.x;
+  bottom_data += batch_index * n * c;
+  temp += batch_index * n;
+  idxs += batch_index * m;
+
+  const int tid = threadIdx.x;
+  const int stride = blockDim.x;
+  const int lane = tid % WARP_SIZE;
+  const int warp = tid / WARP_SIZE;
+  const int num_warps = blockDim.x / WARP_SIZE;
+  AType* xyz = reinterpret_cast<AType*>(fps_resident);
+  AType* dist = xyz + 3 * n;
+  for (int k = tid; k < n; k += stride) {
+    if (resident) {
+      xyz[k * 3 + 0] = bottom_data[k * c + 0];
+      xyz[k * 3 + 1] = bottom_data[k * c + 1];
+      xyz[k * 3 + 2] = bottom_data[k * c + 2];
+      dist[k] = mshadow::red::limits::MaxValue<AType>();
+    } else {
+      temp[k] = mshadow::red::limits::MaxValue<DType>();
+    }
+  }
+  // the first step reads the coordinates another thread stored
+  __syncthreads();
+
+  int old = 0;
+  if (tid == 0) idxs[0] = old;
+  for (int j = 1; j < m; j++) {
+    const AType x1 = resident ? xyz[old * 3 + 0] : AType(bottom_data[old * c + 0]);
+    const AType y1 = resident ? xyz[old * 3 + 1] : AType(bottom_data[old * c + 1]);
+    const AType z1 = resident ? xyz[old * 3 + 2] : AType(bottom_data[old * c + 2]);
+    AType best = -1;
     int besti = 0;
-    DType best = -1;
-    DType x1 = bottom_data[old * c + 0];
-    DType y1 = bottom_data[old * c + 1];
-    DType z1 = bottom_data[old * c + 2];
     for (int k = tid; k < n; k += stride) {
-        DType x2, y2, z2;
+      AType x2, y2, z2, d2;
+      if (resident) {
+        x2 = xyz[k * 3 + 0];
+        y2 = xyz[k * 3 + 1];
+        z2 = xyz[k * 3 + 2];
+      } else {
         x2 = bottom_data[k * c + 0];
         y2 = bottom_data[k * c + 1];
         z2 = bottom_data[k * c + 2];
-        // float mag = (x2 * x2) + (y2 * y2) + (z2 * z2);
-        // if (mag <= 1e-3)
-        // continue;
-
-        DType d = (x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1) + (z2 - z1) * (z2 - z1);
-        DType d2 = min(d, temp[k]);
+      }
+      const AType d = (x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1) + (z2 - z1) * (z2 - z1);
+      if (resident) {
+        d2 = min(d, dist[k]);
+        dist[k] = d2;
+      } else {
+        d2 = min(d, static_cast<AType>(temp[k]));
         temp[k] = d2;
-        besti = d2 > best ? k : besti;
-        best = d2 > best ? d2 : best;
-    }
-    dists[tid] = best;
-    dists_i[tid] = besti;
-    __syncthreads();
-
-    if (block_size >= 1024) {
-        if (tid < 512) {
-        __update(dists, dists_i, tid, tid + 512);
-        }
-        __syncthreads();
+      }
+      // indices grow, so the first maximum of the thread is kept
+      if (d2 > best) {
+        best = d2;
+        besti = k;
+      }
     }
-
-    if (block_size >= 512) {
-        if (tid < 256) {
-        __update(dists, dists_i, tid, tid + 256);
-        }
-        __syncthreads();
-    }
-    if (block_size >= 256) {
-        if (tid < 128) {
-        __update(dists, dists_i, tid, tid + 128);
-        }
-        __syncthreads();
-    }
-    if (block_size >= 128) {
-        if (tid < 64) {
-        __update(dists, dists_i, tid, tid + 64);
-        }
-        __syncthreads();
-    }
-    if (block_size >= 64) {
-        if (tid < 32) {
-        __update(dists, dists_i, tid, tid + 32);
-        }
-        __syncthreads();
-    }
-    if (block_size >= 32) {
-        if (tid < 16) {
-        __update(dists, dists_i, tid, tid + 16);
-        }
-        __syncthreads();
+    fps_warp_argmax(&best, &besti);
+    if (lane == 0) {
+      warp_best[warp] = best;
+      warp_besti[warp] = besti;
     }
-    if (block_size >= 16) {
-        if (tid < 8) {
-        __update(dists, dists_i, tid, tid + 8);
-        }
-        __syncthreads();
-    }
-    if (block_size >= 8) {
-        if (tid < 4) {
-        __update(dists, dists_i, tid, tid + 4);
-        }
-        __syncthreads();
-    }
-    if (block_size >= 4) {
-        if (tid < 2) {
-        __update(dists, dists_i, tid, tid + 2);
-        }
-        __syncthreads();
-    }
-    if (block_size >= 2) {
-        if (tid < 1) {
-        __update(dists, dists_i, tid, tid + 1);
-        }
-        __syncthreads();
+    __syncthreads();
+    if (warp == 0) {
+      best = lane < num_warps ? warp_best[lane] : AType(-1);
+      besti = lane < num_warps ? warp_besti[lane] : n;
+      fps_warp_argmax(&best, &besti);
+      if (lane == 0) selected = besti;
     }
-
-    old = dists_i[0];
+    __syncthreads();
+    old = selected;
     if (tid == 0) idxs[j] = old;
-    }
+  }
+  if (resident) {
+    for (int k = tid; k < n; k += stride) temp[k] = dist[k];
+  }
 }
 
 template <>
@@ -169,60 +167,28 @@ void FarthestPointSamplingForward<gpu>(const nnvm::NodeAttrs& attrs,
     const int n = in_data[farthest_point_sampling::kData].size(1);
     const int c = in_data[farthest_point_sampling::kData].size(2);
     const int m = param.npoints;
+    if (b == 0 || n == 0) return;
 
     Stream<gpu>* s = ctx.get_stream<gpu>();
     auto stream = mshadow::Stream<gpu>::GetStream(s);
     // assume all the data and gradient have the same type
     MSHADOW_REAL_TYPE_SWITCH(in_data[0].type_flag_, DType, {
-    unsigned int n_threads = opt_n_threads(n);
+    typedef typename std::conditional<std::is_same<DType, double>::value,
+                                      double, float>::type AType;
+    const unsigned int n_threads = opt_n_threads(n);
     const DType* input_data = in_data[farthest_point_sampling::kData].dptr<DType>();
     int* idxs = out_data[farthest_point_sampling::kOut].dptr<int>();
     DType* temp = out_data[farthest_point_sampling::kMinDist].dptr<DType>();
-
-    Fill<false>(s, out_data[farthest_point_sampling::kMinDist], kWriteTo, std::numeric_limits<DType>::max());
-
-    switch (n_threads) {
-        case 1024:
-        farthest_point_sampling_kernel<DType, 1024><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 512:
-        farthest_point_sampling_kernel<DType, 512><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 256:
-        farthest_point_sampling_kernel<DType, 256><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 128:
-        farthest_point_sampling_kernel<DType, 128><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 64:
-        farthest_point_sampling_kernel<DType, 64><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 32:
-        farthest_point_sampling_kernel<DType, 32><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 16:
-        farthest_point_sampling_kernel<DType, 16><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 8:
-        farthest_point_sampling_kernel<DType, 8><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 4:
-        farthest_point_sampling_kernel<DType, 4><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 2:
-        farthest_point_sampling_kernel<DType, 2><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        case 1:
-        farthest_point_sampling_kernel<DType, 1><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-        break;
-        default:
-        farthest_point_sampling_kernel<DType, 512><<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
-    }
-    cudaError_t err = cudaGetLastError();
-    if (cudaSuccess != err) {
-        LOG(FATAL) << "CUDA kernel failed : " << cudaGetErrorString(err);
-        exit(-1);
+    // the static part of the shared memory is at most 8 KB
+    const size_t resident_bytes = 4 * static_cast<size_t>(n) * sizeof(AType);
+    if (resident_bytes + 8 * 1024 <= MAX_RESIDENT_BYTES) {
+      farthest_point_sampling_kernel<DType, AType, true>
+        <<<b, n_threads, resident_bytes, stream>>>(b, n, m, c, input_data, temp, idxs);
+    } else {
+      farthest_point_sampling_kernel<DType, AType, false>
+        <<<b, n_threads, 0, stream>>>(b, n, m, c, input_data, temp, idxs);
     }
+    MSHADOW_CUDA_POST_KERNEL_CHECK(farthest_point_sampling_kernel);
     })
   }
 
@@ -31,13 +31,9 @@
 #include <vector>
 #include <string>
 #include <utility>
-#include <iostream>
 #include "../operator_common.h"
 #include "../mshadow_op.h"
-
-#if MXNET_USE_CUDA
-#include <cufft.h>
-#endif
+#include "./fft_plan.h"
 
 namespace mxnet {
 namespace op {
@@ -55,14 +51,11 @@ struct FFTParam : public dmlc::Parameter<FFTParam> {
   }
 };
 
-#if MXNET_USE_CUDA
 template<typename xpu, typename DType>
 class FFTOp : public Operator {
  public:
   explicit FFTOp(FFTParam p) {
     this->param_ = p;
-    init_cufft_ = false;
-    dim_ = 0;
   }
 
   virtual void Forward(const OpContext &ctx,
@@ -75,66 +68,27 @@ class FFTOp : public Operator {
     CHECK_EQ(in_data.size(), 1);
     CHECK_EQ(out_data.size(), 1);
 
-    // the last dimention should be the dimension of fft vector
-    if (!init_cufft_) {
-      n_ffts = in_data[fft::kData].shape_.ProdShape(0, in_data[fft::kData].ndim()-1);
-      dim_ = in_data[fft::kData].shape_[in_data[fft::kData].ndim()-1];
-
-      stride_ = param_.compute_size*dim_;
-
-      init_cufft_ = true;
-
-      // will handle the (possibly) incomplete group later
-      num_compute = n_ffts / param_.compute_size;
-    }
-
-
     Stream<xpu> *s = ctx.get_stream<xpu>();
-    // const TShape& oshape = out_data[fft::kOutComplex].shape_;
+    // the last dimention should be the dimension of fft vector
     const TShape& ishape = in_data[fft::kData].shape_;
-    const TShape& oshape = out_data[fft::kOutComplex].shape_;
+    const int n_ffts = ishape.ProdShape(0, ishape.ndim()-1);
+    const int dim = ishape[ishape.ndim()-1];
+    const int compute_size = std::min(param_.compute_size, n_ffts);
     Tensor<xpu, 2, DType> data = in_data[fft::kData].get_with_shape<xpu, 2, DType>(
-          Shape2(n_ffts, dim_), s);
+          Shape2(n_ffts, dim), s);
     Tensor<xpu, 2, DType> out = out_data[fft::kOutComplex].get_with_shape<xpu, 2, DType>(
-          Shape2(n_ffts, dim_*2), s);
+          Shape2(n_ffts, dim*2), s);
 
-    // need temp space to pad the data into complex numbers due to cufft interface
+    // need temp space to pad the data into complex numbers
     Tensor<xpu, 1, DType> workspace =
             ctx.requested[fft::kTempSpace].get_space_typed<xpu, 1, DType>(
-                Shape1(param_.compute_size*dim_*2), s);
-    Tensor<xpu, 2, DType> complex_data = Tensor<xpu, 2, DType>(workspace.dptr_,
-                                              Shape2(param_.compute_size, dim_*2), s);
-    // start fft
-    cufftHandle plan;
-    cufftPlanMany(&plan, 1, &dim_, nullptr, 0, 0, nullptr, 0, 0, CUFFT_C2C, param_.compute_size);
-    for (size_t idx=0; idx < num_compute; ++idx) {
-      complex_data = complex_pad_imag(data.Slice(idx*param_.compute_size,
-                                                 idx*param_.compute_size+param_.compute_size));
-
-      cufftComplex* in_tmp = const_cast<cufftComplex*>(
-        reinterpret_cast<const cufftComplex*>(complex_data.dptr_));
-      cufftComplex* out_tmp = reinterpret_cast<cufftComplex*>(out.dptr_ + 2*idx*stride_);
-      CHECK_EQ(cufftExecC2C(plan, in_tmp, out_tmp, CUFFT_FORWARD), CUFFT_SUCCESS);
-    }
-    cufftDestroy(plan);
-
-    // handle the remaining samples
-    size_t remain_num = n_ffts - param_.compute_size*num_compute;
-    if (remain_num > 0) {
-      cufftHandle plan_remain;
-      cufftPlanMany(&plan_remain, 1, &dim_, nullptr, 0, 0, nullptr, 0, 0,
-                    CUFFT_C2C, remain_num);
-
-      complex_data = Tensor<xpu, 2, DType>(workspace.dptr_,
-                                          Shape2(remain_num, dim_*2), s);
-      complex_data = complex_pad_imag(data.Slice(
-          num_compute*param_.compute_size, num_compute*param_.compute_size+remain_num));
-
-      cufftComplex* in_tmp = const_cast<cufftComplex*>(
-        reinterpret_cast<const cufftComplex*>(complex_data.dptr_));
-      cufftComplex* out_tmp = reinterpret_cast<cufftComplex*>(out.dptr_ + 2*num_compute*stride_);
-      CHECK_EQ(cufftExecC2C(plan_remain, in_tmp, out_tmp, CUFFT_FORWARD), CUFFT_SUCCESS);
-      cufftDestroy(plan_remain);
+                Shape1(compute_size*dim*2), s);
+    // the plans of full sub-batches and of the remaining samples are cached across calls
+    for (int first = 0; first < n_ffts; first += compute_size) {
+      const int batch = std::min(compute_size, n_ffts - first);
+      Tensor<xpu, 2, DType> complex_data(workspace.dptr_, Shape2(batch, dim*2), s);
+      complex_data = complex_pad_imag(data.Slice(first, first + batch));
+      fft::ComplexFFT(s, dim, batch, complex_data.dptr_, out.dptr_ + 2*first*dim, false);
     }
   }
 
@@ -152,55 +106,27 @@ class FFTOp : public Operator {
     CHECK_EQ(req.size(), 1);
 
     Stream<xpu> *s = ctx.get_stream<xpu>();
-
     const TShape& ishape = in_grad[fft::kData].shape_;
-    const TShape& oshape = out_grad[fft::kOutComplex].shape_;
+    const int n_ffts = ishape.ProdShape(0, ishape.ndim()-1);
+    const int dim = ishape[ishape.ndim()-1];
+    const int compute_size = std::min(param_.compute_size, n_ffts);
     Tensor<xpu, 2, DType> gdata = in_grad[fft::kData].get_with_shape<xpu, 2, DType>(
-          Shape2(n_ffts, dim_), s);
+          Shape2(n_ffts, dim), s);
     Tensor<xpu, 2, DType> grad = out_grad[fft::kOutComplex].get_with_shape<xpu, 2, DType>(
-          Shape2(n_ffts, dim_*2), s);
-    // need temp space to pad the data into complex numbers due to cufft interface
+          Shape2(n_ffts, dim*2), s);
     Tensor<xpu, 1, DType> workspace =
             ctx.requested[fft::kTempSpace].get_space_typed<xpu, 1, DType>(
-                Shape1(param_.compute_size*dim_*2), s);
-    Tensor<xpu, 2, DType> complex_data = Tensor<xpu, 2, DType>(workspace.dptr_,
-                                              Shape2(param_.compute_size, dim_*2), s);
+                Shape1(compute_size*dim*2), s);
 
     // by default, we think forward is firstly conducted
     // In this solution, out_grad must comes from a fft of real signal,
     // so that it is Hermitian symmetric, giving a real output
     // but if it is not, remember that we have implemented complex_take_real, and use this
-    cufftHandle plan;
-    cufftPlanMany(&plan, 1, &dim_, nullptr, 0, 0, nullptr, 0, 0, CUFFT_C2C, param_.compute_size);
-    for (size_t idx = 0; idx < num_compute; ++idx) {
-      cufftComplex* in_tmp = const_cast<cufftComplex*>(
-        reinterpret_cast<const cufftComplex*>(grad.dptr_ + 2*idx*stride_));
-      cufftComplex* out_tmp = reinterpret_cast<cufftComplex*>(complex_data.dptr_);
-      CHECK_EQ(cufftExecC2C(plan, in_tmp, out_tmp, CUFFT_INVERSE), CUFFT_SUCCESS);
-
-      Assign(gdata.Slice(idx*param_.compute_size, (idx+1)*param_.compute_size),
-             req[fft::kData], complex_toreal(complex_data));
-    }
-    cufftDestroy(plan);
-
-    // handle the remaining samples
-    size_t remain_num = n_ffts - param_.compute_size*num_compute;
-    if (remain_num > 0) {
-      cufftHandle plan_remain;
-      cufftPlanMany(&plan_remain, 1, &dim_, nullptr, 0, 0, nullptr, 0, 0,
-                    CUFFT_C2C, remain_num);
-      complex_data = Tensor<xpu, 2, DType>(workspace.dptr_,
-                                              Shape2(remain_num, dim_*2), s);
-
-      cufftComplex* in_tmp = const_cast<cufftComplex*>(
-        reinterpret_cast<const cufftComplex*>(grad.dptr_ + 2*num_compute*stride_));
-      cufftComplex* out_tmp = reinterpret_cast<cufftComplex*>(complex_data.dptr_);
-      CHECK_EQ(cufftExecC2C(plan_remain, in_tmp, out_tmp, CUFFT_INVERSE), CUFFT_SUCCESS);
-
-      Assign(gdata.Slice(param_.compute_size*num_compute,
-                         param_.compute_size*num_compute+remain_num),
-             req[fft::kData], complex_toreal(complex_data));
-      cufftDestroy(plan_remain);
+    for (int first = 0; first < n_ffts; first += compute_size) {
+      const int batch = std::min(compute_size, n_ffts - first);
+      Tensor<xpu, 2, DType> complex_data(workspace.dptr_, Shape2(batch, dim*2), s);
+      fft::ComplexFFT(s, dim, batch, grad.dptr_ + 2*first*dim, complex_data.dptr_, true);
+      Assign(gdata.Slice(first, first + batch), req[fft::kData], complex_toreal(complex_data));
     }
     // for bp, we should not divide it
     // but for comparison with np.fft.ifft, we should do it.
@@ -209,11 +135,7 @@ class FFTOp : public Operator {
 
  private:
   FFTParam param_;
-  int dim_, stride_, n_ffts;
-  size_t num_compute;
-  bool init_cufft_;
 };  // class FFTOp
-#endif  // MXNET_USE_CUDA
 
 // Declare Factory Function, used for dispatch specialization
 template<typename xpu>
@@ -29,8 +29,11 @@ namespace mxnet {
 namespace op {
 template<>
 Operator *CreateOp<cpu>(FFTParam param, int dtype) {
-  LOG(FATAL) << "fft is only available for GPU.";
-  return NULL;
+  Operator *op = NULL;
+  MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
+      op = new FFTOp<cpu, DType>(param);
+  })
+  return op;
 }
 
 Operator *FFTProp::CreateOperatorEx(Context ctx, std::vector<TShape> *in_shape,
@@ -43,7 +46,8 @@ DMLC_REGISTER_PARAMETER(FFTParam);
 MXNET_REGISTER_OP_PROPERTY(_contrib_fft, FFTProp)
 .describe(R"code(Apply 1D FFT to input"
 
-.. note:: `fft` is only available on GPU.
+Plans of the transforms are cached per device, at most `MXNET_FFT_PLAN_CACHE_SIZE` each.
+On GPU, float32 and float64 data are supported.
 
 Currently accept 2 input data shapes: (N, d) or (N1, N2, N3, d), data can only be real numbers.
 The output data has shape: (N, 2*d) or (N1, N2, N3, 2*d). The format is: [real0, imag0, real1, imag1, ...].
@@ -51,7 +55,7 @@ The output data has shape: (N, 2*d) or (N1, N2, N3, 2*d). The format is: [real0,
 Example::
 
    data = np.random.normal(0,1,(3,4))
-   out = mx.contrib.ndarray.fft(data = mx.nd.array(data,ctx = mx.gpu(0)))
+   out = mx.contrib.ndarray.fft(data = mx.nd.array(data))
 
 )code" ADD_FILELINE)
 .add_argument("data", "NDArray-or-Symbol", "Input data to the FFTOp.")
@@ -0,0 +1,313 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file fft_plan.h
+ * \brief cached plans of the batched complex transforms behind fft and ifft
+ */
+#ifndef MXNET_OPERATOR_CONTRIB_FFT_PLAN_H_
+#define MXNET_OPERATOR_CONTRIB_FFT_PLAN_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <mxnet/base.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../../common/cuda_utils.h"
+#include "../../engine/openmp.h"
+
+#if MXNET_USE_CUDA
+#include <cufft.h>
+#endif
+
+namespace mxnet {
+namespace op {
+namespace fft {
+
+/*! \brief what a plan is built for */
+struct PlanKey {
+  int dev_id;
+  int n;
+  int batch;
+  int dtype;
+  void* stream;
+
+  bool operator==(const PlanKey& other) const {
+    return dev_id == other.dev_id && n == other.n && batch == other.batch &&
+           dtype == other.dtype && stream == other.stream;
+  }
+};
+
+struct PlanKeyHash {
+  size_t operator()(const PlanKey& key) const {
+    size_t h = std::hash<void*>()(key.stream);
+    for (int v : {key.dev_id, key.n, key.batch, key.dtype}) {
+      h ^= std::hash<int>()(v) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+  }
+};
+
+/*!
+ * \brief least recently used plans of every device, at most
+ *  MXNET_FFT_PLAN_CACHE_SIZE each. Plans are handed out as shared pointers,
+ *  so one evicted by another thread stays valid until its user is done.
+ */
+template<typename Plan>
+class PlanCache {
+ public:
+  static PlanCache* Get() {
+    // never destroyed, the cuda runtime may be unloaded before static destructors run
+    static PlanCache* inst = new PlanCache();
+    return inst;
+  }
+
+  /*! \brief the plan of key, made by create() if it is not cached */
+  template<typename Create>
+  std::shared_ptr<Plan> Find(const PlanKey& key, Create create) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Device& dev = devices_[key.dev_id];
+    auto it = dev.index.find(key);
+    if (it != dev.index.end()) {
+      dev.lru.splice(dev.lru.begin(), dev.lru, it->second);
+      return it->second->second;
+    }
+    std::shared_ptr<Plan> plan(create());
+    dev.lru.emplace_front(key, plan);
+    dev.index[key] = dev.lru.begin();
+    while (dev.lru.size() > capacity_) {
+      dev.index.erase(dev.lru.back().first);
+      dev.lru.pop_back();
+    }
+    return plan;
+  }
+
+ private:
+  typedef std::list<std::pair<PlanKey, std::shared_ptr<Plan> > > List;
+  struct Device {
+    List lru;
+    std::unordered_map<PlanKey, typename List::iterator, PlanKeyHash> index;
+  };
+
+  PlanCache()
+    : capacity_(std::max(1, dmlc::GetEnv("MXNET_FFT_PLAN_CACHE_SIZE", 16))) {}
+
+  const size_t capacity_;
+  std::mutex mutex_;
+  std::unordered_map<int, Device> devices_;
+};
+
+/*!
+ * \brief unnormalized complex transform of length n on the cpu. Powers of two run
+ *  an iterative radix-2 transform, other lengths Bluestein's algorithm, which
+ *  turns them into a convolution of power of two length, so every length is
+ *  O(n log n).
+ */
+template<typename AType>
+class CPUPlan {
+ public:
+  typedef std::complex<AType> Complex;
+
+  explicit CPUPlan(const int n) : n_(n), m_(1) {
+    const bool pow2 = (n & (n - 1)) == 0;
+    while (m_ < (pow2 ? n : 2 * n - 1)) m_ <<= 1;
+    int bits = 0;
+    while ((1 << bits) < m_) ++bits;
+    rev_.assign(m_, 0);
+    for (int i = 1; i < m_; ++i) {
+      rev_[i] = (rev_[i >> 1] >> 1) | ((i & 1) << (bits - 1));
+    }
+    twiddle_.resize(m_ / 2);
+    for (int k = 0; k < m_ / 2; ++k) {
+      const double angle = -2.0 * M_PI * k / m_;
+      twiddle_[k] = Complex(std::cos(angle), std::sin(angle));
+    }
+    if (pow2) return;
+    // chirp w_k = exp(-pi i k^2 / n), with k^2 taken mod 2n to keep the angle small
+    chirp_.resize(n);
+    for (int k = 0; k < n; ++k) {
+      const int64_t k2 = static_cast<int64_t>(k) * k % (2 * static_cast<int64_t>(n));
+      const double angle = -M_PI * k2 / n;
+      chirp_[k] = Complex(std::cos(angle), std::sin(angle));
+    }
+    filter_.assign(m_, Complex(0, 0));
+    filter_[0] = std::conj(chirp_[0]);
+    for (int k = 1; k < n; ++k) {
+      filter_[k] = filter_[m_ - k] = std::conj(chirp_[k]);
+    }
+    Radix2(filter_.data(), false);
+  }
+
+  /*! \brief complex numbers of scratch an Exec needs */
+  int scratch_size() const {
+    return chirp_.empty() ? 0 : m_;
+  }
+
+  /*! \brief transform x in place, e^{+2 pi i jk / n} for the inverse */
+  void Exec(Complex* x, const bool inverse, Complex* scratch) const {
+    if (chirp_.empty()) {
+      Radix2(x, inverse);
+      return;
+    }
+    // the inverse is the conjugate of the forward transform of the conjugate
+    for (int j = 0; j < n_; ++j) {
+      scratch[j] = (inverse ? std::conj(x[j]) : x[j]) * chirp_[j];
+    }
+    std::fill(scratch + n_, scratch + m_, Complex(0, 0));
+    Radix2(scratch, false);
+    for (int j = 0; j < m_; ++j) scratch[j] *= filter_[j];
+    Radix2(scratch, true);
+    const AType scale = AType(1) / m_;
+    for (int k = 0; k < n_; ++k) {
+      const Complex y = chirp_[k] * scratch[k] * scale;
+      x[k] = inverse ? std::conj(y) : y;
+    }
+  }
+
+ private:
+  void Radix2(Complex* x, const bool inverse) const {
+    for (int i = 0; i < m_; ++i) {
+      if (i < rev_[i]) std::swap(x[i], x[rev_[i]]);
+    }
+    for (int len = 2; len <= m_; len <<= 1) {
+      const int half = len >> 1;
+      const int step = m_ / len;
+      for (int i = 0; i < m_; i += len) {
+        for (int j = 0; j < half; ++j) {
+          const Complex w = inverse ? std::conj(twiddle_[j * step]) : twiddle_[j * step];
+          const Complex u = x[i + j];
+          const Complex v = x[i + j + half] * w;
+          x[i + j] = u + v;
+          x[i + j + half] = u - v;
+        }
+      }
+    }
+  }
+
+  /*! \brief transform length */
+  const int n_;
+  /*! \brief power of two length of the radix-2 transforms */
+  int m_;
+  std::vector<int> rev_;
+  /*! \brief exp(-2 pi i k / m) */
+  std::vector<Complex> twiddle_;
+  /*! \brief Bluestein chirp and the transform of its conjugate, empty for powers of two */
+  std::vector<Complex> chirp_, filter_;
+};
+
+/*!
+ * \brief unnormalized transforms of batch contiguous rows of n complex numbers,
+ *  stored as interleaved real and imaginary parts
+ */
+template<typename DType>
+inline void ComplexFFT(mshadow::Stream<cpu>* s, const int n, const int batch,
+                       const DType* in, DType* out, const bool inverse) {
+  typedef typename std::conditional<std::is_same<DType, double>::value,
+                                    double, float>::type AType;
+  typedef typename CPUPlan<AType>::Complex Complex;
+  const PlanKey key{-1, n, 1, mshadow::DataType<AType>::kFlag, nullptr};
+  std::shared_ptr<CPUPlan<AType> > plan =
+    PlanCache<CPUPlan<AType> >::Get()->Find(key, [n]() { return new CPUPlan<AType>(n); });
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel num_threads(omp_threads)
+  {
+    std::vector<Complex> row(n), scratch(plan->scratch_size());
+    #pragma omp for
+    for (int b = 0; b < batch; ++b) {
+      const DType* x = in + 2 * static_cast<size_t>(b) * n;
+      for (int j = 0; j < n; ++j) {
+        row[j] = Complex(static_cast<AType>(x[2 * j]), static_cast<AType>(x[2 * j + 1]));
+      }
+      plan->Exec(row.data(), inverse, scratch.data());
+      DType* y = out + 2 * static_cast<size_t>(b) * n;
+      for (int j = 0; j < n; ++j) {
+        y[2 * j] = DType(row[j].real());
+        y[2 * j + 1] = DType(row[j].imag());
+      }
+    }
+  }
+}
+
+#if MXNET_USE_CUDA
+/*! \brief cufft plan of batch contiguous transforms of length n, bound to one stream */
+class CuFFTPlan {
+ public:
+  CuFFTPlan(int n, const int batch, const cufftType type, cudaStream_t stream) {
+    CHECK_EQ(cufftPlanMany(&plan_, 1, &n, nullptr, 0, 0, nullptr, 0, 0, type, batch),
+             CUFFT_SUCCESS) << "Failed to create a cufft plan of length " << n;
+    CHECK_EQ(cufftSetStream(plan_, stream), CUFFT_SUCCESS);
+  }
+
+  ~CuFFTPlan() {
+    cufftDestroy(plan_);
+  }
+
+  cufftHandle get() const {
+    return plan_;
+  }
+
+ private:
+  cufftHandle plan_;
+  DISALLOW_COPY_AND_ASSIGN(CuFFTPlan);
+};
+
+inline void CuFFTExec(cufftHandle plan, const float* in, float* out, const bool inverse) {
+  CHECK_EQ(cufftExecC2C(plan, reinterpret_cast<cufftComplex*>(const_cast<float*>(in)),
+                        reinterpret_cast<cufftComplex*>(out),
+                        inverse ? CUFFT_INVERSE : CUFFT_FORWARD), CUFFT_SUCCESS);
+}
+
+inline void CuFFTExec(cufftHandle plan, const double* in, double* out, const bool inverse) {
+  CHECK_EQ(cufftExecZ2Z(plan, reinterpret_cast<cufftDoubleComplex*>(const_cast<double*>(in)),
+                        reinterpret_cast<cufftDoubleComplex*>(out),
+                        inverse ? CUFFT_INVERSE : CUFFT_FORWARD), CUFFT_SUCCESS);
+}
+
+template<typename DType>
+inline void CuFFTExec(cufftHandle plan, const DType* in, DType* out, const bool inverse) {
+  LOG(FATAL) << "fft and ifft on gpu only support float32 and float64";
+}
+
+template<typename DType>
+inline void ComplexFFT(mshadow::Stream<gpu>* s, const int n, const int batch,
+                       const DType* in, DType* out, const bool inverse) {
+  int dev_id;
+  CUDA_CALL(cudaGetDevice(&dev_id));
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+  const PlanKey key{dev_id, n, batch, mshadow::DataType<DType>::kFlag, stream};
+  const cufftType type = std::is_same<DType, double>::value ? CUFFT_Z2Z : CUFFT_C2C;
+  std::shared_ptr<CuFFTPlan> plan = PlanCache<CuFFTPlan>::Get()->Find(
+    key, [=]() { return new CuFFTPlan(n, batch, type, stream); });
+  CuFFTExec(plan->get(), in, out, inverse);
+}
+#endif  // MXNET_USE_CUDA
+
+}  // namespace fft
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_CONTRIB_FFT_PLAN_H_
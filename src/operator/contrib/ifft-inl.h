@@ -34,10 +34,7 @@
 #include <utility>
 #include "../operator_common.h"
 #include "../mshadow_op.h"
-
-#if MXNET_USE_CUDA
-#include <cufft.h>
-#endif
+#include "./fft_plan.h"
 
 namespace mxnet {
 namespace op {
@@ -48,21 +45,18 @@ namespace ifft {
 }
 
 struct IFFTParam : public dmlc::Parameter<IFFTParam> {
-  int compute_size;  // the maximum size of sub-batch to be forwarded through cufft in one time
+  int compute_size;  // the maximum size of sub-batch to be forwarded through fft in one time
   DMLC_DECLARE_PARAMETER(IFFTParam){
     DMLC_DECLARE_FIELD(compute_size).set_default(128)
     .describe("Maximum size of sub-batch to be forwarded at one time");
   }
 };
 
-#if MXNET_USE_CUDA
 template<typename xpu, typename DType>
 class IFFTOp : public Operator {
  public:
   explicit IFFTOp(IFFTParam p) {
     this->param_ = p;
-    init_cufft_ = false;
-    dim_ = 0;
   }
 
   virtual void Forward(const OpContext &ctx,
@@ -75,62 +69,26 @@ class IFFTOp : public Operator {
     CHECK_EQ(in_data.size(), 1);
     CHECK_EQ(out_data.size(), 1);
 
-    if (!init_cufft_) {
-      n_iffts = in_data[ifft::kData].shape_.ProdShape(0, in_data[ifft::kData].ndim()-1);
-      // remember that input is complex
-      dim_ = in_data[ifft::kData].shape_[in_data[ifft::kData].ndim()-1]/2;
-      // stride_ in the number of complex numbers
-      stride_ = param_.compute_size*dim_;
-
-      init_cufft_ = true;
-
-      num_compute = n_iffts/param_.compute_size;
-    }
-
     Stream<xpu> *s = ctx.get_stream<xpu>();
     const TShape& ishape = in_data[ifft::kData].shape_;
-    const TShape& oshape = out_data[ifft::kOut].shape_;
+    const int n_iffts = ishape.ProdShape(0, ishape.ndim()-1);
+    // remember that input is complex
+    const int dim = ishape[ishape.ndim()-1]/2;
+    const int compute_size = std::min(param_.compute_size, n_iffts);
     Tensor<xpu, 2, DType> data = in_data[ifft::kData].get_with_shape<xpu, 2, DType>(
-          Shape2(n_iffts, dim_*2), s);
+          Shape2(n_iffts, dim*2), s);
     Tensor<xpu, 2, DType> out = out_data[ifft::kOut].get_with_shape<xpu, 2, DType>(
-          Shape2(n_iffts, dim_), s);
+          Shape2(n_iffts, dim), s);
     // need temp space to store the intermediate complex matrices
     Tensor<xpu, 1, DType> workspace =
             ctx.requested[ifft::kTempSpace].get_space_typed<xpu, 1, DType>(
-                Shape1(param_.compute_size*dim_*2), s);
-    Tensor<xpu, 2, DType> complex_data = Tensor<xpu, 2, DType>(workspace.dptr_,
-                                              Shape2(param_.compute_size, dim_*2), s);
-    // start ifft
-    cufftHandle plan;
-    cufftPlanMany(&plan, 1, &dim_, nullptr, 0, 0, nullptr, 0, 0, CUFFT_C2C, param_.compute_size);
-    for (size_t idx=0; idx < num_compute; ++idx) {
-      cufftComplex* in_tmp = const_cast<cufftComplex*>(
-        reinterpret_cast<const cufftComplex*>(data.dptr_ + 2*idx*stride_));
-      cufftComplex* out_tmp = reinterpret_cast<cufftComplex*>(complex_data.dptr_);
-      CHECK_EQ(cufftExecC2C(plan, in_tmp, out_tmp, CUFFT_INVERSE), CUFFT_SUCCESS);
-
-      Assign(out.Slice(idx*param_.compute_size, (idx+1)*param_.compute_size),
-             req[ifft::kOut], complex_toreal(complex_data));
-    }
-    cufftDestroy(plan);
-    // handle the remaining samples
-    size_t remain_num = n_iffts - param_.compute_size*num_compute;
-    if (remain_num > 0) {
-      cufftHandle plan_remain;
-      cufftPlanMany(&plan_remain, 1, &dim_, nullptr, 0, 0, nullptr, 0, 0,
-                    CUFFT_C2C, remain_num);
-
-      complex_data = Tensor<xpu, 2, DType>(workspace.dptr_,
-                                              Shape2(remain_num, dim_*2), s);
-
-      cufftComplex* in_tmp = const_cast<cufftComplex*>(
-        reinterpret_cast<const cufftComplex*>(data.dptr_ + 2*num_compute*stride_));
-      cufftComplex* out_tmp = reinterpret_cast<cufftComplex*>(complex_data.dptr_);
-      CHECK_EQ(cufftExecC2C(plan_remain, in_tmp, out_tmp, CUFFT_INVERSE), CUFFT_SUCCESS);
-        Assign(out.Slice(param_.compute_size*num_compute,
-                         param_.compute_size*num_compute+remain_num),
-             req[ifft::kOut], complex_toreal(complex_data));
-      cufftDestroy(plan_remain);
+                Shape1(compute_size*dim*2), s);
+    // the plans of full sub-batches and of the remaining samples are cached across calls
+    for (int first = 0; first < n_iffts; first += compute_size) {
+      const int batch = std::min(compute_size, n_iffts - first);
+      Tensor<xpu, 2, DType> complex_data(workspace.dptr_, Shape2(batch, dim*2), s);
+      fft::ComplexFFT(s, dim, batch, data.dptr_ + 2*first*dim, complex_data.dptr_, true);
+      Assign(out.Slice(first, first + batch), req[ifft::kOut], complex_toreal(complex_data));
     }
     // commenting this out to be consistant with caffe
     // out /= dim_;
@@ -149,49 +107,23 @@ class IFFTOp : public Operator {
     CHECK_EQ(req.size(), 1);
 
     Stream<xpu> *s = ctx.get_stream<xpu>();
-
     const TShape& ishape = in_grad[ifft::kData].shape_;
-    const TShape& oshape = out_grad[ifft::kOut].shape_;
+    const int n_iffts = ishape.ProdShape(0, ishape.ndim()-1);
+    const int dim = ishape[ishape.ndim()-1]/2;
+    const int compute_size = std::min(param_.compute_size, n_iffts);
     Tensor<xpu, 2, DType> gdata = in_grad[ifft::kData].get_with_shape<xpu, 2, DType>(
-          Shape2(n_iffts, dim_*2), s);
+          Shape2(n_iffts, dim*2), s);
     Tensor<xpu, 2, DType> grad = out_grad[ifft::kOut].get_with_shape<xpu, 2, DType>(
-          Shape2(n_iffts, dim_), s);
-    // need temp space to pad the data into complex numbers due to cufft interface
+          Shape2(n_iffts, dim), s);
+    // need temp space to pad the data into complex numbers
     Tensor<xpu, 1, DType> workspace =
             ctx.requested[ifft::kTempSpace].get_space_typed<xpu, 1, DType>(
-                Shape1(param_.compute_size*dim_*2), s);
-    Tensor<xpu, 2, DType> complex_data = Tensor<xpu, 2, DType>(workspace.dptr_,
-                                              Shape2(param_.compute_size, dim_*2), s);
-    // start fft
-    cufftHandle plan;
-    cufftPlanMany(&plan, 1, &dim_, nullptr, 0, 0, nullptr, 0, 0, CUFFT_C2C, param_.compute_size);
-    for (size_t idx = 0; idx < num_compute; ++idx) {
-      complex_data = complex_pad_imag(grad.Slice(idx*param_.compute_size,
-                                                 idx*param_.compute_size+param_.compute_size));
-
-      cufftComplex* in_tmp = const_cast<cufftComplex*>(
-        reinterpret_cast<const cufftComplex*>(complex_data.dptr_));
-      cufftComplex* out_tmp = reinterpret_cast<cufftComplex*>(gdata.dptr_ + 2*idx*stride_);
-      CHECK_EQ(cufftExecC2C(plan, in_tmp, out_tmp, CUFFT_FORWARD), CUFFT_SUCCESS);
-    }
-    cufftDestroy(plan);
-
-    // handle the remaining samples
-    size_t remain_num = n_iffts - param_.compute_size*num_compute;
-    if (remain_num > 0) {
-      cufftHandle plan_remain;
-      cufftPlanMany(&plan_remain, 1, &dim_, nullptr, 0, 0, nullptr, 0, 0,
-                    CUFFT_C2C, remain_num);
-      complex_data = Tensor<xpu, 2, DType>(workspace.dptr_,
-                                          Shape2(remain_num, dim_*2), s);
-      complex_data = complex_pad_imag(grad.Slice(
-          num_compute*param_.compute_size, num_compute*param_.compute_size+remain_num));
-
-      cufftComplex* in_tmp = const_cast<cufftComplex*>(
-        reinterpret_cast<const cufftComplex*>(complex_data.dptr_));
-      cufftComplex* out_tmp = reinterpret_cast<cufftComplex*>(gdata.dptr_ + 2*num_compute*stride_);
-      CHECK_EQ(cufftExecC2C(plan_remain, in_tmp, out_tmp, CUFFT_FORWARD), CUFFT_SUCCESS);
-      cufftDestroy(plan_remain);
+                Shape1(compute_size*dim*2), s);
+    for (int first = 0; first < n_iffts; first += compute_size) {
+      const int batch = std::min(compute_size, n_iffts - first);
+      Tensor<xpu, 2, DType> complex_data(workspace.dptr_, Shape2(batch, dim*2), s);
+      complex_data = complex_pad_imag(grad.Slice(first, first + batch));
+      fft::ComplexFFT(s, dim, batch, complex_data.dptr_, gdata.dptr_ + 2*first*dim, false);
     }
     // commenting this out to be consistant with caffe
     // gdata /= dim_;
@@ -199,13 +131,8 @@ class IFFTOp : public Operator {
 
  private:
   IFFTParam param_;
-  int dim_, stride_, n_iffts;
-  size_t num_compute;
-  bool init_cufft_;
 };  // class IFFTOp
 
-#endif  // MXNET_USE_CUDA
-
 // Declare Factory Function, used for dispatch specialization
 template<typename xpu>
 Operator* CreateOp(IFFTParam param, int dtype);
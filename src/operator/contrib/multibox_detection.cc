@@ -25,6 +25,8 @@
 */
 #include "./multibox_detection-inl.h"
 #include <algorithm>
+#include <vector>
+#include "../../engine/openmp.h"
 
 namespace mshadow {
 template<typename DType>
@@ -37,8 +39,9 @@ struct SortElemDescend {
     index = i;
   }
 
+  // ties keep the anchor order, so any sort gives the order of a stable one
   bool operator<(const SortElemDescend &other) const {
-    return value > other.value;
+    return value > other.value || (value == other.value && index < other.index);
   }
 };
 
@@ -79,6 +82,41 @@ inline DType CalculateOverlap(const DType *a, const DType *b) {
   return u <= 0.f ? static_cast<DType>(0) : static_cast<DType>(i / u);
 }
 
+/*!
+ * \brief Greedy NMS over the detections at rows of out, in the order of rows.
+ *  The boxes are gathered into arrays so the overlaps of one box with all later ones
+ *  are computed in a loop the compiler vectorizes.
+ */
+template<typename DType>
+inline void ApplyNMS(DType *out, const std::vector<int> &rows, const float nms_threshold) {
+  const int n = static_cast<int>(rows.size());
+  std::vector<DType> left(n), top(n), right(n), bottom(n), area(n);
+  std::vector<char> suppressed(n, 0);
+  for (int k = 0; k < n; ++k) {
+    const DType *box = out + rows[k] * 6 + 2;
+    left[k] = box[0];
+    top[k] = box[1];
+    right[k] = box[2];
+    bottom[k] = box[3];
+    area[k] = (box[2] - box[0]) * (box[3] - box[1]);
+  }
+  for (int i = 0; i < n; ++i) {
+    if (suppressed[i]) continue;
+    for (int j = i + 1; j < n; ++j) {
+      // the arithmetic of CalculateOverlap
+      const DType w = std::max(DType(0), std::min(right[i], right[j]) - std::max(left[i], left[j]));
+      const DType h = std::max(DType(0), std::min(bottom[i], bottom[j]) - std::max(top[i], top[j]));
+      const DType inter = w * h;
+      const DType u = area[i] + area[j] - inter;
+      const DType iou = u <= 0.f ? static_cast<DType>(0) : static_cast<DType>(inter / u);
+      suppressed[j] |= iou >= nms_threshold;
+    }
+  }
+  for (int k = 0; k < n; ++k) {
+    if (suppressed[k]) out[rows[k] * 6] = -1;
+  }
+}
+
 template<typename DType>
 inline void MultiBoxDetectionForward(const Tensor<cpu, 3, DType> &out,
                                      const Tensor<cpu, 3, DType> &cls_prob,
@@ -96,29 +134,35 @@ inline void MultiBoxDetectionForward(const Tensor<cpu, 3, DType> &out,
   const int num_anchors = cls_prob.size(2);
   const int num_batches = cls_prob.size(0);
   const DType *p_anchor = anchors.dptr_;
+  const int omp_threads = mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  const bool apply_nms = nms_threshold > 0 && nms_threshold <= 1;
+  std::vector<int> valid_counts(num_batches, 0);
+  // decode and sort the detections, one batch item per thread
+  #pragma omp parallel for num_threads(omp_threads)
   for (int nbatch = 0; nbatch < num_batches; ++nbatch) {
     const DType *p_cls_prob = cls_prob.dptr_ + nbatch * num_classes * num_anchors;
     const DType *p_loc_pred = loc_pred.dptr_ + nbatch * num_anchors * 4;
     DType *p_out = out.dptr_ + nbatch * num_anchors * 6;
-    int valid_count = 0;
-    for (int i = 0; i < num_anchors; ++i) {
-      // find the predicted class id and probability
-      DType score = -1;
-      int id = 0;
-      for (int j = 1; j < num_classes; ++j) {
-        DType temp = p_cls_prob[j * num_anchors + i];
-        if (temp > score) {
-          score = temp;
-          id = j;
+    // find the predicted class id and probability of every anchor, class by class
+    // so the probabilities are read contiguously
+    std::vector<DType> scores(num_anchors, DType(-1));
+    std::vector<int> ids(num_anchors, 0);
+    for (int j = 1; j < num_classes; ++j) {
+      const DType *p_prob = p_cls_prob + j * num_anchors;
+      for (int i = 0; i < num_anchors; ++i) {
+        if (p_prob[i] > scores[i]) {
+          scores[i] = p_prob[i];
+          ids[i] = j;
         }
       }
-      if (id > 0 && score < threshold) {
-        id = 0;
-      }
-      if (id > 0) {
+    }
+    int valid_count = 0;
+    for (int i = 0; i < num_anchors; ++i) {
+      const int id = ids[i];
+      if (id > 0 && !(scores[i] < threshold)) {
         // [id, prob, xmin, ymin, xmax, ymax]
         p_out[valid_count * 6] = id - 1;  // remove background, restore original id
-        p_out[valid_count * 6 + 1] = (id == 0 ? DType(-1) : score);
+        p_out[valid_count * 6 + 1] = scores[i];
         int offset = i * 4;
         TransformLocations(p_out + valid_count * 6 + 2, p_anchor + offset,
           p_loc_pred + offset, clip, variances[0], variances[1],
@@ -126,46 +170,49 @@ inline void MultiBoxDetectionForward(const Tensor<cpu, 3, DType> &out,
         ++valid_count;
       }
     }  // end iter num_anchors
+    valid_counts[nbatch] = valid_count;
 
-    if (valid_count < 1 || nms_threshold <= 0 || nms_threshold > 1) continue;
+    if (valid_count < 1 || !apply_nms) continue;
 
-    // sort and apply NMS
-    Copy(temp_space[nbatch], out[nbatch], out.stream_);
-    // sort confidence in descend order
+    // sort confidence in descend order, only the top k are needed
+    DType *ptemp = temp_space.dptr_ + nbatch * num_anchors * 6;
+    std::copy(p_out, p_out + valid_count * 6, ptemp);
     std::vector<SortElemDescend<DType>> sorter;
     sorter.reserve(valid_count);
     for (int i = 0; i < valid_count; ++i) {
       sorter.push_back(SortElemDescend<DType>(p_out[i * 6 + 1], i));
     }
-    std::stable_sort(sorter.begin(), sorter.end());
-    // re-order output
-    DType *ptemp = temp_space.dptr_ + nbatch * num_anchors * 6;
     int nkeep = static_cast<int>(sorter.size());
     if (nms_topk > 0 && nms_topk < nkeep) {
       nkeep = nms_topk;
+      std::partial_sort(sorter.begin(), sorter.begin() + nkeep, sorter.end());
+    } else {
+      std::sort(sorter.begin(), sorter.end());
     }
+    // re-order output
     for (int i = 0; i < nkeep; ++i) {
       for (int j = 0; j < 6; ++j) {
         p_out[i * 6 + j] = ptemp[sorter[i].index * 6 + j];
       }
     }
-    // apply nms
-    for (int i = 0; i < valid_count; ++i) {
-      int offset_i = i * 6;
-      if (p_out[offset_i] < 0) continue;  // skip eliminated
-      for (int j = i + 1; j < valid_count; ++j) {
-        int offset_j = j * 6;
-        if (p_out[offset_j] < 0) continue;  // skip eliminated
-        if (force_suppress || (p_out[offset_i] == p_out[offset_j])) {
-          // when foce_suppress == true or class_id equals
-          DType iou = CalculateOverlap(p_out + offset_i + 2, p_out + offset_j + 2);
-          if (iou >= nms_threshold) {
-            p_out[offset_j] = -1;
-          }
-        }
-      }
-    }
   }  // end iter batch
+  if (!apply_nms) return;
+
+  // boxes of different classes never suppress each other, unless force_suppress,
+  // so every (batch, class) pair is an independent NMS problem
+  const int num_groups = force_suppress ? 1 : std::max(num_classes - 1, 1);
+  std::vector<std::vector<int>> groups(num_batches * num_groups);
+  for (int nbatch = 0; nbatch < num_batches; ++nbatch) {
+    const DType *p_out = out.dptr_ + nbatch * num_anchors * 6;
+    for (int i = 0; i < valid_counts[nbatch]; ++i) {
+      const int group = force_suppress ? 0 : static_cast<int>(p_out[i * 6]);
+      groups[nbatch * num_groups + group].push_back(nbatch * num_anchors + i);
+    }
+  }
+  #pragma omp parallel for num_threads(omp_threads) schedule(dynamic)
+  for (int g = 0; g < static_cast<int>(groups.size()); ++g) {
+    if (groups[g].size() > 1) ApplyNMS(out.dptr_, groups[g], nms_threshold);
+  }
 }
 }  // namespace mshadow
 
@@ -24,8 +24,10 @@
  * \author Joshua Zhang
 */
 #include <algorithm>
+#include <vector>
 #include "./multibox_target-inl.h"
 #include "../mshadow_op.h"
+#include "../../engine/openmp.h"
 
 namespace mshadow {
 template<typename DType>
@@ -63,8 +65,9 @@ struct SortElemDescend {
     index = i;
   }
 
+  // ties keep the anchor order, so a partial selection picks what a stable sort does
   bool operator<(const SortElemDescend &other) const {
-    return value > other.value;
+    return value > other.value || (value == other.value && index < other.index);
   }
 };
 
@@ -87,11 +90,12 @@ inline void MultiBoxTargetForward(const Tensor<cpu, 2, DType> &loc_target,
   const int num_labels = labels.size(1);
   const int label_width = labels.size(2);
   const int num_anchors = anchors.size(0);
+  const int num_classes = cls_preds.size(1);
   CHECK_EQ(variances.ndim(), 4);
+  if (negative_mining_ratio > 0) CHECK_GT(negative_mining_thresh, 0);
+  std::vector<int> num_valid_gt(num_batches, 0);
   for (int nbatch = 0; nbatch < num_batches; ++nbatch) {
     const DType *p_label = labels.dptr_ + nbatch * num_labels * label_width;
-    const DType *p_overlaps = temp_space.dptr_ + nbatch * num_anchors * num_labels;
-    int num_valid_gt = 0;
     for (int i = 0; i < num_labels; ++i) {
       if (static_cast<float>(*(p_label + i * label_width)) == -1.0f) {
         CHECK_EQ(static_cast<float>(*(p_label + i * label_width + 1)), -1.0f);
@@ -100,183 +104,177 @@ inline void MultiBoxTargetForward(const Tensor<cpu, 2, DType> &loc_target,
         CHECK_EQ(static_cast<float>(*(p_label + i * label_width + 4)), -1.0f);
         break;
       }
-      ++num_valid_gt;
+      ++num_valid_gt[nbatch];
     }  // end iterate labels
+  }
 
-    if (num_valid_gt > 0) {
-      std::vector<bool> gt_flags(num_valid_gt, false);
-      std::vector<std::pair<float, int>> max_matches(num_anchors,
-        std::pair<float, int>(-1.0f, -1));
-      std::vector<char> anchor_flags(num_anchors, -1);  // -1 means don't care
-      int num_positive = 0;
-      while (std::find(gt_flags.begin(), gt_flags.end(), false) != gt_flags.end()) {
-        // ground-truths not fully matched
-        int best_anchor = -1;
-        int best_gt = -1;
-        float max_overlap = 1e-6;  // start with a very small positive overlap
-        for (int j = 0; j < num_anchors; ++j) {
-          if (anchor_flags[j] == 1) {
-            continue;  // already matched this anchor
-          }
-          const DType *pp_overlaps = p_overlaps + j * num_labels;
-          for (int k = 0; k < num_valid_gt; ++k) {
-            if (gt_flags[k]) {
-              continue;  // already matched this gt
-            }
-            float iou = static_cast<float>(*(pp_overlaps + k));
-            if (iou > max_overlap) {
-              best_anchor = j;
-              best_gt = k;
-              max_overlap = iou;
-            }
-          }
+  // the ground truth every anchor overlaps most, and for the anchors negative
+  // mining may pick the negated background probability, of all batches at once
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  const int num_total = num_batches * num_anchors;
+  std::vector<float> max_iou(num_total, -1.0f);
+  std::vector<int> max_gt(num_total, -1);
+  std::vector<float> neg_score(num_total, 0.0f);
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int i = 0; i < num_total; ++i) {
+    const int nbatch = i / num_anchors;
+    const int j = i % num_anchors;
+    const DType *pp_overlaps = temp_space.dptr_ + static_cast<index_t>(i) * num_labels;
+    for (int k = 0; k < num_valid_gt[nbatch]; ++k) {
+      float iou = static_cast<float>(*(pp_overlaps + k));
+      if (iou > max_iou[i]) {
+        max_gt[i] = k;
+        max_iou[i] = iou;
+      }
+    }
+    if (num_valid_gt[nbatch] > 0 && negative_mining_ratio > 0 &&
+        max_iou[i] < negative_mining_thresh) {
+      const DType *p_cls_preds = cls_preds.dptr_ + nbatch * num_classes * num_anchors;
+      DType max_val = p_cls_preds[j];
+      for (int k = 1; k < num_classes; ++k) {
+        DType tmp = p_cls_preds[j + num_anchors * k];
+        if (tmp > max_val) max_val = tmp;
+      }
+      DType sum = 0.f;
+      for (int k = 0; k < num_classes; ++k) {
+        DType tmp = p_cls_preds[j + num_anchors * k];
+        sum += std::exp(tmp - max_val);
+      }
+      DType prob = std::exp(p_cls_preds[j] - max_val) / sum;
+      // loss should be -log(x), but value does not matter, skip log
+      neg_score[i] = -prob;
+    }
+  }
+
+  std::vector<int> num_candidates(num_batches, -1);
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int nbatch = 0; nbatch < num_batches; ++nbatch) {
+    const int num_gt = num_valid_gt[nbatch];
+    if (num_gt == 0) continue;
+    const DType *p_label = labels.dptr_ + nbatch * num_labels * label_width;
+    const DType *p_overlaps = temp_space.dptr_ + nbatch * num_anchors * num_labels;
+    float *p_max_iou = max_iou.data() + nbatch * num_anchors;
+    int *p_max_gt = max_gt.data() + nbatch * num_anchors;
+    std::vector<char> anchor_flags(num_anchors, -1);  // -1 means don't care
+    int num_positive = 0;
+
+    // bipartite matching: the unmatched pair of largest overlap is matched until
+    // every ground truth is, each ground truth remembers its best unmatched anchor
+    // and only looks again when another ground truth takes that anchor
+    std::vector<bool> gt_flags(num_gt, false);
+    std::vector<int> gt_anchor(num_gt, -1);
+    std::vector<float> gt_overlap(num_gt);
+    auto find_anchor = [&](const int k) {
+      gt_anchor[k] = -1;
+      gt_overlap[k] = 1e-6;  // start with a very small positive overlap
+      for (int j = 0; j < num_anchors; ++j) {
+        if (anchor_flags[j] == 1) continue;  // already matched this anchor
+        float iou = static_cast<float>(*(p_overlaps + j * num_labels + k));
+        if (iou > gt_overlap[k]) {
+          gt_anchor[k] = j;
+          gt_overlap[k] = iou;
+        }
+      }
+    };
+    for (int k = 0; k < num_gt; ++k) find_anchor(k);
+    while (true) {
+      // ties go to the lower anchor, then the lower ground truth
+      int best_gt = -1;
+      for (int k = 0; k < num_gt; ++k) {
+        if (gt_flags[k] || gt_anchor[k] < 0) continue;
+        if (best_gt < 0 || gt_overlap[k] > gt_overlap[best_gt] ||
+            (gt_overlap[k] == gt_overlap[best_gt] && gt_anchor[k] < gt_anchor[best_gt])) {
+          best_gt = k;
         }
+      }
+      if (best_gt == -1) break;  // no more good match
+      const int best_anchor = gt_anchor[best_gt];
+      p_max_iou[best_anchor] = gt_overlap[best_gt];
+      p_max_gt[best_anchor] = best_gt;
+      num_positive += 1;
+      // mark as visited
+      gt_flags[best_gt] = true;
+      anchor_flags[best_anchor] = 1;
+      for (int k = 0; k < num_gt; ++k) {
+        if (!gt_flags[k] && gt_anchor[k] == best_anchor) find_anchor(k);
+      }
+    }  // end while
 
-        if (best_anchor == -1) {
-          CHECK_EQ(best_gt, -1);
-          break;  // no more good match
-        } else {
-          CHECK_EQ(max_matches[best_anchor].first, -1.0f);
-          CHECK_EQ(max_matches[best_anchor].second, -1);
-          max_matches[best_anchor].first = max_overlap;
-          max_matches[best_anchor].second = best_gt;
+    if (overlap_threshold > 0) {
+      // find positive matches based on overlaps
+      for (int j = 0; j < num_anchors; ++j) {
+        if (anchor_flags[j] != 1 && p_max_iou[j] > overlap_threshold) {
           num_positive += 1;
-          // mark as visited
-          gt_flags[best_gt] = true;
-          anchor_flags[best_anchor] = 1;
+          anchor_flags[j] = 1;
         }
-      }  // end while
+      }  // end iterate anchors
+    }
 
-      if (overlap_threshold > 0) {
-        // find positive matches based on overlaps
+    if (negative_mining_ratio > 0) {
+      int num_negative = num_positive * negative_mining_ratio;
+      if (num_negative > (num_anchors - num_positive)) {
+        num_negative = num_anchors - num_positive;
+      }
+      if (num_negative > 0) {
+        // use negative mining, pick up "best" negative samples
+        std::vector<SortElemDescend> temp;
+        temp.reserve(num_anchors - num_positive);
         for (int j = 0; j < num_anchors; ++j) {
-          if (anchor_flags[j] == 1) {
-            continue;  // already matched this anchor
-          }
-          const DType *pp_overlaps = p_overlaps + j * num_labels;
-          int best_gt = -1;
-          float max_iou = -1.0f;
-          for (int k = 0; k < num_valid_gt; ++k) {
-            float iou = static_cast<float>(*(pp_overlaps + k));
-            if (iou > max_iou) {
-              best_gt = k;
-              max_iou = iou;
-            }
-          }
-          if (best_gt != -1) {
-            CHECK_EQ(max_matches[j].first, -1.0f);
-            CHECK_EQ(max_matches[j].second, -1);
-            max_matches[j].first = max_iou;
-            max_matches[j].second = best_gt;
-            if (max_iou > overlap_threshold) {
-              num_positive += 1;
-              // mark as visited
-              gt_flags[best_gt] = true;
-              anchor_flags[j] = 1;
-            }
+          if (anchor_flags[j] == -1 && p_max_iou[j] < negative_mining_thresh) {
+            temp.push_back(SortElemDescend(neg_score[nbatch * num_anchors + j], j));
           }
         }  // end iterate anchors
-      }
-
-      if (negative_mining_ratio > 0) {
-        const int num_classes = cls_preds.size(1);
-        DType *p_cls_preds = cls_preds.dptr_ + nbatch * num_classes * num_anchors;
-        CHECK_GT(negative_mining_thresh, 0);
-        int num_negative = num_positive * negative_mining_ratio;
-        if (num_negative > (num_anchors - num_positive)) {
-          num_negative = num_anchors - num_positive;
+        if (static_cast<int>(temp.size()) < num_negative) {
+          num_candidates[nbatch] = temp.size();
+          continue;
         }
-        if (num_negative > 0) {
-          // use negative mining, pick up "best" negative samples
-          std::vector<SortElemDescend> temp;
-          temp.reserve(num_anchors - num_positive);
-          for (int j = 0; j < num_anchors; ++j) {
-            if (anchor_flags[j] == 1) {
-              continue;  // already matched this anchor
-            }
-            if (max_matches[j].first < 0) {
-              // not yet calculated
-              const DType *pp_overlaps = p_overlaps + j * num_labels;
-              int best_gt = -1;
-              float max_iou = -1.0f;
-              for (int k = 0; k < num_valid_gt; ++k) {
-                float iou = static_cast<float>(*(pp_overlaps + k));
-                if (iou > max_iou) {
-                  best_gt = k;
-                  max_iou = iou;
-                }
-              }
-              if (best_gt != -1) {
-                CHECK_EQ(max_matches[j].first, -1.0f);
-                CHECK_EQ(max_matches[j].second, -1);
-                max_matches[j].first = max_iou;
-                max_matches[j].second = best_gt;
-              }
-            }
-            if (max_matches[j].first < negative_mining_thresh &&
-                anchor_flags[j] == -1) {
-                // calcuate class predictions
-              DType max_val = p_cls_preds[j];
-              for (int k = 1; k < num_classes; ++k) {
-                DType tmp = p_cls_preds[j + num_anchors * k];
-                if (tmp > max_val) max_val = tmp;
-              }
-              DType sum = 0.f;
-              for (int k = 0; k < num_classes; ++k) {
-                DType tmp = p_cls_preds[j + num_anchors * k];
-                sum += std::exp(tmp - max_val);
-              }
-              DType prob = std::exp(p_cls_preds[j] - max_val) / sum;
-              // loss should be -log(x), but value does not matter, skip log
-              temp.push_back(SortElemDescend(-prob, j));
-            }
-          }  // end iterate anchors
-
-          CHECK_GE(temp.size(), num_negative);
-          std::stable_sort(temp.begin(), temp.end());
-          for (int i = 0; i < num_negative; ++i) {
-            anchor_flags[temp[i].index] = 0;  // mark as negative sample
-          }
-        }
-      } else {
-        // use all negative samples
-        for (int i = 0; i < num_anchors; ++i) {
-          if (anchor_flags[i] != 1) {
-            anchor_flags[i] = 0;
-          }
+        // only which anchors are the hardest matters, not their order
+        std::nth_element(temp.begin(), temp.begin() + (num_negative - 1), temp.end());
+        for (int i = 0; i < num_negative; ++i) {
+          anchor_flags[temp[i].index] = 0;  // mark as negative sample
         }
       }
-
-      // assign training targets
-      DType *p_loc_target = loc_target.dptr_ + nbatch * num_anchors * 4;
-      DType *p_loc_mask = loc_mask.dptr_ + nbatch * num_anchors * 4;
-      DType *p_cls_target = cls_target.dptr_ + nbatch * num_anchors;
+    } else {
+      // use all negative samples
       for (int i = 0; i < num_anchors; ++i) {
-        if (anchor_flags[i] == 1) {
-          // positive sample
-          CHECK_GE(max_matches[i].second, 0);
-          // 0 reserved for background
-          *(p_cls_target + i) = *(p_label + label_width * max_matches[i].second) + 1;
-          int offset = i * 4;
-          *(p_loc_mask + offset) = 1;
-          *(p_loc_mask + offset + 1) = 1;
-          *(p_loc_mask + offset + 2) = 1;
-          *(p_loc_mask + offset + 3) = 1;
-          AssignLocTargets(p_anchor + i * 4,
-            p_label + label_width * max_matches[i].second + 1, p_loc_target + offset,
-            variances[0], variances[1], variances[2], variances[3]);
-        } else if (anchor_flags[i] == 0) {
-          // negative sample
-          *(p_cls_target + i) = 0;
-          int offset = i * 4;
-          *(p_loc_mask + offset) = 0;
-          *(p_loc_mask + offset + 1) = 0;
-          *(p_loc_mask + offset + 2) = 0;
-          *(p_loc_mask + offset + 3) = 0;
+        if (anchor_flags[i] != 1) {
+          anchor_flags[i] = 0;
         }
-      }  // end iterate anchors
+      }
     }
+
+    // assign training targets
+    DType *p_loc_target = loc_target.dptr_ + nbatch * num_anchors * 4;
+    DType *p_loc_mask = loc_mask.dptr_ + nbatch * num_anchors * 4;
+    DType *p_cls_target = cls_target.dptr_ + nbatch * num_anchors;
+    for (int i = 0; i < num_anchors; ++i) {
+      if (anchor_flags[i] == 1) {
+        // positive sample
+        // 0 reserved for background
+        *(p_cls_target + i) = *(p_label + label_width * p_max_gt[i]) + 1;
+        int offset = i * 4;
+        *(p_loc_mask + offset) = 1;
+        *(p_loc_mask + offset + 1) = 1;
+        *(p_loc_mask + offset + 2) = 1;
+        *(p_loc_mask + offset + 3) = 1;
+        AssignLocTargets(p_anchor + i * 4,
+          p_label + label_width * p_max_gt[i] + 1, p_loc_target + offset,
+          variances[0], variances[1], variances[2], variances[3]);
+      } else if (anchor_flags[i] == 0) {
+        // negative sample
+        *(p_cls_target + i) = 0;
+        int offset = i * 4;
+        *(p_loc_mask + offset) = 0;
+        *(p_loc_mask + offset + 1) = 0;
+        *(p_loc_mask + offset + 2) = 0;
+        *(p_loc_mask + offset + 3) = 0;
+      }
+    }  // end iterate anchors
   }  // end iterate batches
+  for (int nbatch = 0; nbatch < num_batches; ++nbatch) {
+    CHECK_LT(num_candidates[nbatch], 0) << "MultiBoxTarget: batch " << nbatch << " has only "
+      << num_candidates[nbatch] << " negative candidates below negative_mining_thresh";
+  }
 }
 }  // namespace mshadow
 
@@ -468,7 +468,7 @@ __global__ void deformable_col2im_coord_gpu_kernel(const int n, const DType* dat
       cnt += 1;
     }
 
-    grad_offset[index] = val;
+    KERNEL_ASSIGN(grad_offset[index], req, val);
   }
 }
 
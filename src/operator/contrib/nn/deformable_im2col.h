@@ -63,13 +63,72 @@
 
 #include <mxnet/base.h>
 #include <mxnet/operator.h>
+#include <cmath>
 #include <cstring>
 #include <vector>
 #include "../../mxnet_op.h"
+#include "../../../engine/openmp.h"
 
 namespace mxnet {
 namespace op {
 
+/*!
+ * \brief bilinear sample of an image plane at (h, w), which must lie in
+ *  [0, height) x [0, width); the last row and column are clamped
+ */
+template <typename DType>
+inline DType deformable_im2col_bilinear_cpu(const DType* data, const int height,
+  const int width, DType h, DType w) {
+  int h_low = std::floor(h);
+  int w_low = std::floor(w);
+  int h_high = h_low + 1;
+  int w_high = w_low + 1;
+  if (h_low >= height - 1) {
+    h_high = h_low = height - 1;
+    h = static_cast<DType>(h_low);
+  }
+  if (w_low >= width - 1) {
+    w_high = w_low = width - 1;
+    w = static_cast<DType>(w_low);
+  }
+  const DType lh = h - h_low, lw = w - w_low;
+  const DType hh = 1 - lh, hw = 1 - lw;
+  return hh * hw * data[h_low * width + w_low] + hh * lw * data[h_low * width + w_high] +
+         lh * hw * data[h_high * width + w_low] + lh * lw * data[h_high * width + w_high];
+}
+
+/*!
+ * \brief derivative of the bilinear sample at (argmax_h, argmax_w) along h
+ *  (bp_dir 0) or w (bp_dir 1), zero outside of the image
+ */
+template <typename DType>
+inline DType deformable_coordinate_weight_cpu(DType argmax_h, DType argmax_w,
+  const int height, const int width, const DType* im_data, const int bp_dir) {
+  if (argmax_h < 0 || argmax_h > height || argmax_w < 0 || argmax_w > width) {
+    return 0;
+  }
+  int h_low = static_cast<int>(argmax_h);
+  int w_low = static_cast<int>(argmax_w);
+  int h_high = h_low + 1;
+  int w_high = w_low + 1;
+  if (h_low >= height - 1) {
+    h_high = h_low = height - 1;
+    argmax_h = static_cast<DType>(h_low);
+  }
+  if (w_low >= width - 1) {
+    w_high = w_low = width - 1;
+    argmax_w = static_cast<DType>(w_low);
+  }
+  const DType v1 = im_data[h_low * width + w_low];
+  const DType v2 = im_data[h_low * width + w_high];
+  const DType v3 = im_data[h_high * width + w_low];
+  const DType v4 = im_data[h_high * width + w_high];
+  if (bp_dir == 0) {
+    return (w_low + 1 - argmax_w) * (v3 - v1) + (argmax_w - w_low) * (v4 - v2);
+  }
+  return (h_low + 1 - argmax_h) * (v2 - v1) + (argmax_h - h_low) * (v4 - v3);
+}
+
 /*!\brief
  * cpu function of deformable_im2col algorithm
  * \param s device stream
@@ -90,10 +149,40 @@ inline void deformable_im2col(mshadow::Stream<cpu>* s,
   const TShape& im_shape, const TShape& col_shape, const TShape& kernel_shape,
   const TShape& pad, const TShape& stride, const TShape& dilation,
   const uint32_t deformable_group, DType* data_col) {
-  if (2 == kernel_shape.ndim()) {
-    LOG(FATAL) << "only implemented in GPU";
-  } else {
-    LOG(FATAL) << "not implemented";
+  CHECK_EQ(kernel_shape.ndim(), 2U) << "deformable_im2col only supports 2D kernels";
+  const int channels = im_shape[1], height = im_shape[2], width = im_shape[3];
+  const int kernel_h = kernel_shape[0], kernel_w = kernel_shape[1];
+  const int pad_h = pad[0], pad_w = pad[1];
+  const int stride_h = stride[0], stride_w = stride[1];
+  const int dilation_h = dilation[0], dilation_w = dilation[1];
+  const int height_col = col_shape[1], width_col = col_shape[2];
+  const int col_size = height_col * width_col;
+  const int channel_per_deformable_group = channels / deformable_group;
+  // a row of the output of a channel per task, the offsets of a row are contiguous
+  #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int task = 0; task < channels * height_col; ++task) {
+    const int c_im = task / height_col;
+    const int h_col = task % height_col;
+    const int h_in = h_col * stride_h - pad_h;
+    const DType* im = data_im + c_im * height * width;
+    const DType* offset = data_offset +
+      (c_im / channel_per_deformable_group) * 2 * kernel_h * kernel_w * col_size +
+      h_col * width_col;
+    DType* col = data_col + c_im * kernel_h * kernel_w * col_size + h_col * width_col;
+    for (int i = 0; i < kernel_h; ++i) {
+      for (int j = 0; j < kernel_w; ++j, col += col_size) {
+        const DType* offset_h = offset + 2 * (i * kernel_w + j) * col_size;
+        const DType* offset_w = offset_h + col_size;
+        for (int w_col = 0; w_col < width_col; ++w_col) {
+          const DType h_im = h_in + i * dilation_h + offset_h[w_col];
+          const DType w_im = (w_col * stride_w - pad_w) +
+                             j * dilation_w + offset_w[w_col];
+          col[w_col] = (h_im >= 0 && w_im >= 0 && h_im < height && w_im < width) ?
+                       deformable_im2col_bilinear_cpu(im, height, width, h_im, w_im) :
+                       static_cast<DType>(0);
+        }
+      }
+    }
   }
 }
 
@@ -110,7 +199,7 @@ inline void deformable_im2col(mshadow::Stream<cpu>* s,
  * \param stride stride shape
  * \param dilation dilation shape
  * \param deformable_group #offset group that deformable convolution use
- * \param grad_im pointer of a image (C, H, W,...) in the image batch
+ * \param grad_im pointer of a image (C, H, W,...) in the image batch, added to
  */
 template <typename DType>
 inline void deformable_col2im(mshadow::Stream<cpu>* s,
@@ -119,7 +208,57 @@ inline void deformable_col2im(mshadow::Stream<cpu>* s,
   const TShape& pad, const TShape& stride,
   const TShape& dilation, const uint32_t deformable_group,
   DType* grad_im, OpReqType req) {
-  LOG(FATAL) << "only implemented in GPU";
+  CHECK_EQ(kernel_shape.ndim(), 2U) << "deformable_col2im only supports 2D kernels";
+  const int channels = im_shape[1], height = im_shape[2], width = im_shape[3];
+  const int kernel_h = kernel_shape[0], kernel_w = kernel_shape[1];
+  const int pad_h = pad[0], pad_w = pad[1];
+  const int stride_h = stride[0], stride_w = stride[1];
+  const int dilation_h = dilation[0], dilation_w = dilation[1];
+  const int height_col = col_shape[1], width_col = col_shape[2];
+  const int col_size = height_col * width_col;
+  const int channel_per_deformable_group = channels / deformable_group;
+  // the gradient of a channel only comes from its own columns, so the
+  // channels are scattered into in parallel without atomics
+  #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int c = 0; c < channels; ++c) {
+    DType* grad = grad_im + c * height * width;
+    const DType* offset = data_offset +
+      (c / channel_per_deformable_group) * 2 * kernel_h * kernel_w * col_size;
+    const DType* col = data_col + c * kernel_h * kernel_w * col_size;
+    for (int i = 0; i < kernel_h; ++i) {
+      for (int j = 0; j < kernel_w; ++j, col += col_size) {
+        const DType* offset_h = offset + 2 * (i * kernel_w + j) * col_size;
+        const DType* offset_w = offset_h + col_size;
+        for (int h_col = 0; h_col < height_col; ++h_col) {
+          const int h_in = h_col * stride_h - pad_h + i * dilation_h;
+          for (int w_col = 0; w_col < width_col; ++w_col) {
+            const int pos = h_col * width_col + w_col;
+            DType h = h_in + offset_h[pos];
+            DType w = (w_col * stride_w - pad_w + j * dilation_w) +
+                      offset_w[pos];
+            if (h < 0 || w < 0 || h >= height || w >= width) continue;
+            int h_low = static_cast<int>(h), w_low = static_cast<int>(w);
+            int h_high = h_low + 1, w_high = w_low + 1;
+            if (h_low >= height - 1) {
+              h_high = h_low = height - 1;
+              h = static_cast<DType>(h_low);
+            }
+            if (w_low >= width - 1) {
+              w_high = w_low = width - 1;
+              w = static_cast<DType>(w_low);
+            }
+            const DType lh = h - h_low, lw = w - w_low;
+            const DType hh = 1 - lh, hw = 1 - lw;
+            const DType top_grad = col[pos];
+            grad[h_low * width + w_low] += hh * hw * top_grad;
+            grad[h_low * width + w_high] += hh * lw * top_grad;
+            grad[h_high * width + w_low] += lh * hw * top_grad;
+            grad[h_high * width + w_high] += lh * lw * top_grad;
+          }
+        }
+      }
+    }
+  }
 }
 
 
@@ -145,7 +284,49 @@ inline void deformable_col2im_coord(mshadow::Stream<cpu>* s,
   const TShape& col_shape, const TShape& kernel_shape,
   const TShape& pad, const TShape& stride,
   const TShape& dilation, const uint32_t deformable_group, DType* grad_offset, OpReqType req) {
-  LOG(FATAL) << "only implemented in GPU";
+  CHECK_EQ(kernel_shape.ndim(), 2U) << "deformable_col2im_coord only supports 2D kernels";
+  if (req == kNullOp) return;
+  const int height = im_shape[2], width = im_shape[3];
+  const int kernel_h = kernel_shape[0], kernel_w = kernel_shape[1];
+  const int pad_h = pad[0], pad_w = pad[1];
+  const int stride_h = stride[0], stride_w = stride[1];
+  const int dilation_h = dilation[0], dilation_w = dilation[1];
+  const int height_col = col_shape[1], width_col = col_shape[2];
+  const int col_size = height_col * width_col;
+  const int kernel_size = kernel_h * kernel_w;
+  const int channel_per_deformable_group = im_shape[1] / deformable_group;
+  // a row of an offset map per task, summing over the channels of its group
+  const int nrows = deformable_group * 2 * kernel_size * height_col;
+  #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int row = 0; row < nrows; ++row) {
+    const int h_col = row % height_col;
+    const int c = row / height_col;
+    const int group = c / (2 * kernel_size);
+    const int bp_dir = c % 2;
+    const int k = (c % (2 * kernel_size)) / 2;
+    const int i = k / kernel_w, j = k % kernel_w;
+    const DType* offset = data_offset + (group * 2 * kernel_size + 2 * k) * col_size +
+                          h_col * width_col;
+    const DType* im = data_im + group * channel_per_deformable_group * height * width;
+    const DType* col = data_col + (group * channel_per_deformable_group * kernel_size + k) *
+                       col_size + h_col * width_col;
+    DType* out = grad_offset + c * col_size + h_col * width_col;
+    const int h_in = h_col * stride_h - pad_h + i * dilation_h;
+    for (int w_col = 0; w_col < width_col; ++w_col) {
+      DType inv_h = h_in + offset[w_col];
+      DType inv_w = (w_col * stride_w - pad_w + j * dilation_w) +
+                    offset[col_size + w_col];
+      DType val = 0;
+      if (inv_h >= 0 && inv_w >= 0 && inv_h < height && inv_w < width) {
+        for (int cnt = 0; cnt < channel_per_deformable_group; ++cnt) {
+          val += deformable_coordinate_weight_cpu(inv_h, inv_w, height, width,
+                                                  im + cnt * height * width, bp_dir) *
+                 col[cnt * kernel_size * col_size + w_col];
+        }
+      }
+      KERNEL_ASSIGN(out[w_col], req, val);
+    }
+  }
 }
 
 }  // namespace op
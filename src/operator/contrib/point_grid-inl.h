@@ -0,0 +1,107 @@
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file point_grid-inl.h
+ * \brief hashed voxel grid over 3d points for neighbor search
+ *
+ *  The points of every batch are sorted by the hash of their cell, so the
+ *  points of a cell are a contiguous range of the sorted order, found by
+ *  binary search, and keep ascending indices within the range. Cells whose
+ *  hashes collide share a range, which only adds candidates.
+ */
+#ifndef MXNET_OPERATOR_CONTRIB_POINT_GRID_INL_H_
+#define MXNET_OPERATOR_CONTRIB_POINT_GRID_INL_H_
+
+#include <mxnet/operator_util.h>
+#include <cmath>
+#include <limits>
+#include "../mxnet_op.h"
+#include "../tensor/sort_op.h"
+
+namespace mxnet {
+namespace op {
+
+/*! \brief number of hash buckets of a batch, a power of two of at least 2n */
+inline int PointGridTableSize(int n) {
+  int size = 1;
+  while (size < 2 * n) size <<= 1;
+  return size;
+}
+
+MSHADOW_XINLINE int PointGridCoord(float v, float cell) {
+  return static_cast<int>(floorf(v / cell));
+}
+
+MSHADOW_XINLINE int PointGridHash(int cx, int cy, int cz, int table_size) {
+  const unsigned h = static_cast<unsigned>(cx) * 73856093u ^
+                     static_cast<unsigned>(cy) * 19349663u ^
+                     static_cast<unsigned>(cz) * 83492791u;
+  return static_cast<int>(h & static_cast<unsigned>(table_size - 1));
+}
+
+/*! \brief range [*begin, *end) of the sorted keys in [lo, hi) equal to key */
+MSHADOW_XINLINE void PointGridRange(const int* keys, int lo, int hi, int key,
+                                    int* begin, int* end) {
+  int l = lo, h = hi;
+  while (l < h) {
+    const int mid = (l + h) / 2;
+    if (keys[mid] < key) l = mid + 1; else h = mid;
+  }
+  *begin = l;
+  h = hi;
+  while (l < h) {
+    const int mid = (l + h) / 2;
+    if (keys[mid] <= key) l = mid + 1; else h = mid;
+  }
+  *end = l;
+}
+
+struct PointGridKeyKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const int n, const int table_size,
+                                  const DType* xyz, const float cell,
+                                  int* keys, int* order) {
+    const int b = i / n;
+    xyz += i * 3;
+    keys[i] = b * table_size + PointGridHash(PointGridCoord(xyz[0], cell),
+                                             PointGridCoord(xyz[1], cell),
+                                             PointGridCoord(xyz[2], cell), table_size);
+    order[i] = i - b * n;
+  }
+};
+
+/*! \brief temporary bytes of a grid over batch * n points */
+template<typename xpu>
+inline size_t PointGridWorkspaceSize(int batch, int n) {
+  const size_t num = static_cast<size_t>(batch) * n;
+  return 2 * num * sizeof(int) + SortByKeyWorkspaceSize<int, int, xpu>(num);
+}
+
+/*!
+ * \brief index the points xyz of shape (batch, n, 3) by cells of edge cell
+ * \param keys output, the sorted bucket ids of batch * table_size buckets
+ * \param order output, the index within its batch of every sorted point
+ */
+template<typename xpu, typename DType>
+inline void BuildPointGrid(mshadow::Stream<xpu>* s, const DType* xyz, int batch, int n,
+                           float cell, int table_size, mshadow::Tensor<xpu, 1, char> space,
+                           int** keys, int** order) {
+  using namespace mshadow;
+  CHECK_GT(cell, 0.0f) << "The grid cells must have a positive size";
+  CHECK_LE(static_cast<int64_t>(batch) * table_size, std::numeric_limits<int>::max())
+    << "Too many points for the grid";
+  const int num = batch * n;
+  *keys = reinterpret_cast<int*>(space.dptr_);
+  *order = *keys + num;
+  Tensor<xpu, 1, char> workspace(reinterpret_cast<char*>(*order + num),
+                                 Shape1(space.size(0) - 2 * num * sizeof(int)), s);
+  mxnet_op::Kernel<PointGridKeyKernel, xpu>::Launch(s, num, n, table_size, xyz, cell,
+                                                     *keys, *order);
+  Tensor<xpu, 1, int> key_tensor(*keys, Shape1(num), s);
+  Tensor<xpu, 1, int> order_tensor(*order, Shape1(num), s);
+  SortByKey(key_tensor, order_tensor, true, &workspace);
+}
+
+}  // namespace op
+}  // namespace mxnet
+
+#endif  // MXNET_OPERATOR_CONTRIB_POINT_GRID_INL_H_
@@ -0,0 +1,541 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file proposal-inl.cuh
+ * \brief Device-side proposal pipeline shared by Proposal and MultiProposal
+ *  All images of the batch go through the same kernels: anchor decode, clip
+ *  and min-size filter, a segmented sort of the scores made of two stable
+ *  SortByKey passes, the NMS overlap bitmasks and a greedy reduction of the
+ *  masks with one block per image. Nothing is copied back to the host.
+ */
+#ifndef MXNET_OPERATOR_CONTRIB_PROPOSAL_INL_CUH_
+#define MXNET_OPERATOR_CONTRIB_PROPOSAL_INL_CUH_
+
+#include <mshadow/tensor.h>
+#include <algorithm>
+#include <vector>
+#include "../tensor/sort_op.h"
+
+namespace mshadow {
+namespace cuda {
+namespace proposal {
+
+const int kNMSThreadsPerBlock = sizeof(uint64_t) * 8;
+
+MSHADOW_XINLINE int DivUp(int m, int n) {
+  return (m + n - 1) / n;
+}
+
+// anchors are (anchor, 5)
+// scores are (b, 2 * anchor, h, w)
+// proposals are (b, h * w * anchor, 5)
+// w defines "x" and h defines "y"
+// count should be total anchors numbers, b * h * w * anchors
+template<typename Dtype>
+__global__ void ProposalGridKernel(const int count,
+                                   const int num_anchors,
+                                   const int height,
+                                   const int width,
+                                   const int feature_stride,
+                                   const Dtype* anchors,
+                                   const Dtype* scores,
+                                   Dtype* proposals) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    int a = index % num_anchors;
+    int w = (index / num_anchors) % width;
+    int h = (index / num_anchors / width) % height;
+    int b = index / num_anchors / width / height;
+
+    proposals[index * 5 + 0] = anchors[a * 5 + 0] + w * feature_stride;
+    proposals[index * 5 + 1] = anchors[a * 5 + 1] + h * feature_stride;
+    proposals[index * 5 + 2] = anchors[a * 5 + 2] + w * feature_stride;
+    proposals[index * 5 + 3] = anchors[a * 5 + 3] + h * feature_stride;
+    proposals[index * 5 + 4] =
+        scores[((b * (2 * num_anchors) + a + num_anchors) * height + h) * width + w];
+  }
+}
+
+// boxes are (b, h * w * anchor, 5)
+// deltas are (b, 4 * anchor, h, w)
+// out_pred_boxes are (b, h * w * anchor, 5)
+// count should be total anchors numbers, b * h * w * anchors
+// in-place write: boxes and out_pred_boxes are the same location
+template<typename Dtype>
+__global__ void BBoxPredKernel(const int count,
+                               const int num_anchors,
+                               const int feat_height,
+                               const int feat_width,
+                               const int feature_stride,
+                               const Dtype* im_infos,
+                               const Dtype* boxes,
+                               const Dtype* deltas,
+                               Dtype* out_pred_boxes) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    int a = index % num_anchors;
+    int w = (index / num_anchors) % feat_width;
+    int h = (index / num_anchors / feat_width) % feat_height;
+    int b = index / num_anchors / feat_width / feat_height;
+
+    float im_height = im_infos[b * 3];
+    float im_width = im_infos[b * 3 + 1];
+    int real_height = static_cast<int>(im_height / feature_stride);
+    int real_width = static_cast<int>(im_width / feature_stride);
+
+    float width = boxes[index * 5 + 2] - boxes[index * 5 + 0] + 1.0f;
+    float height = boxes[index * 5 + 3] - boxes[index * 5 + 1] + 1.0f;
+    float ctr_x = boxes[index * 5 + 0] + 0.5f * (width - 1.0f);
+    float ctr_y = boxes[index * 5 + 1] + 0.5f * (height - 1.0f);
+
+    int ba = (b * num_anchors + a);
+    float dx = deltas[((ba * 4) * feat_height + h) * feat_width + w];
+    float dy = deltas[((ba * 4 + 1) * feat_height + h) * feat_width + w];
+    float dw = deltas[((ba * 4 + 2) * feat_height + h) * feat_width + w];
+    float dh = deltas[((ba * 4 + 3) * feat_height + h) * feat_width + w];
+
+    float pred_ctr_x = dx * width + ctr_x;
+    float pred_ctr_y = dy * height + ctr_y;
+    float pred_w = exp(dw) * width;
+    float pred_h = exp(dh) * height;
+
+    float pred_x1 = pred_ctr_x - 0.5f * (pred_w - 1.0f);
+    float pred_y1 = pred_ctr_y - 0.5f * (pred_h - 1.0f);
+    float pred_x2 = pred_ctr_x + 0.5f * (pred_w - 1.0f);
+    float pred_y2 = pred_ctr_y + 0.5f * (pred_h - 1.0f);
+
+    pred_x1 = max(min(pred_x1, im_width - 1.0f), 0.0f);
+    pred_y1 = max(min(pred_y1, im_height - 1.0f), 0.0f);
+    pred_x2 = max(min(pred_x2, im_width - 1.0f), 0.0f);
+    pred_y2 = max(min(pred_y2, im_height - 1.0f), 0.0f);
+
+    out_pred_boxes[index * 5 + 0] = pred_x1;
+    out_pred_boxes[index * 5 + 1] = pred_y1;
+    out_pred_boxes[index * 5 + 2] = pred_x2;
+    out_pred_boxes[index * 5 + 3] = pred_y2;
+
+    if (h >= real_height || w >= real_width) {
+      out_pred_boxes[index * 5 + 4] = -1.0f;
+    }
+  }
+}
+
+// boxes are (b, h * w * anchor, 5)
+// deltas are (b, 4 * anchor, h, w)
+// out_pred_boxes are (b, h * w * anchor, 5)
+// count should be total anchors numbers, b * h * w * anchors
+// in-place write: boxes and out_pred_boxes are the same location
+template<typename Dtype>
+__global__ void IoUPredKernel(const int count,
+                              const int num_anchors,
+                              const int feat_height,
+                              const int feat_width,
+                              const int feature_stride,
+                              const Dtype* im_infos,
+                              const Dtype* boxes,
+                              const Dtype* deltas,
+                              Dtype* out_pred_boxes) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    int a = index % num_anchors;
+    int w = (index / num_anchors) % feat_width;
+    int h = (index / num_anchors / feat_width) % feat_height;
+    int b = index / num_anchors / feat_width / feat_height;
+
+    float im_height = im_infos[b * 3];
+    float im_width = im_infos[b * 3 + 1];
+    int real_height = static_cast<int>(im_height / feature_stride);
+    int real_width = static_cast<int>(im_width / feature_stride);
+
+    float x1 = boxes[index * 5 + 0];
+    float y1 = boxes[index * 5 + 1];
+    float x2 = boxes[index * 5 + 2];
+    float y2 = boxes[index * 5 + 3];
+
+    int ba = (b * num_anchors + a);
+    float dx1 = deltas[((ba * 4) * feat_height + h) * feat_width + w];
+    float dy1 = deltas[((ba * 4 + 1) * feat_height + h) * feat_width + w];
+    float dx2 = deltas[((ba * 4 + 2) * feat_height + h) * feat_width + w];
+    float dy2 = deltas[((ba * 4 + 3) * feat_height + h) * feat_width + w];
+
+    float pred_x1 = max(min(x1 + dx1, im_width - 1.0f), 0.0f);
+    float pred_y1 = max(min(y1 + dy1, im_height - 1.0f), 0.0f);
+    float pred_x2 = max(min(x2 + dx2, im_width - 1.0f), 0.0f);
+    float pred_y2 = max(min(y2 + dy2, im_height - 1.0f), 0.0f);
+
+    out_pred_boxes[index * 5 + 0] = pred_x1;
+    out_pred_boxes[index * 5 + 1] = pred_y1;
+    out_pred_boxes[index * 5 + 2] = pred_x2;
+    out_pred_boxes[index * 5 + 3] = pred_y2;
+
+    if (h >= real_height || w >= real_width) {
+      out_pred_boxes[index * 5 + 4] = -1.0f;
+    }
+  }
+}
+
+// filter box with stride less than rpn_min_size
+// filter: set score to -1, the score then takes part in the fill of score and order
+// dets (b, n, 5); score (b * n, ); order (b * n, )
+template<typename Dtype>
+__global__ void FilterBoxKernel(const int count,
+                                const int count_anchors,
+                                const float original_min_size,
+                                const Dtype* im_infos,
+                                Dtype* dets,
+                                Dtype* score,
+                                int* order) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    int b = index / count_anchors;
+    float iw = dets[index * 5 + 2] - dets[index * 5 + 0] + 1.0f;
+    float ih = dets[index * 5 + 3] - dets[index * 5 + 1] + 1.0f;
+    float min_size = original_min_size * im_infos[b * 3 + 2];
+    if (iw < min_size || ih < min_size) {
+      dets[index * 5 + 0] -= min_size / 2;
+      dets[index * 5 + 1] -= min_size / 2;
+      dets[index * 5 + 2] += min_size / 2;
+      dets[index * 5 + 3] += min_size / 2;
+      dets[index * 5 + 4] = -1.0f;
+    }
+    score[index] = dets[index * 5 + 4];
+    order[index] = index;
+  }
+}
+
+// image of every sorted proposal, the key of the second, stable, sort pass
+// order (b * n, ); batch_id (b * n, )
+static __global__ void BatchIdKernel(const int count,
+                                     const int count_anchors,
+                                     const int* order,
+                                     int* batch_id) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    batch_id[index] = order[index] / count_anchors;
+  }
+}
+
+// gather the top_n proposals of every image according to order
+// prev_dets (b * n, 5); order (b * n, ) of global indices, grouped by image; dets (b, top_n, 5)
+// count should be b * top_n
+template<typename Dtype>
+__global__ void ReorderProposalsKernel(const int count,
+                                       const int count_anchors,
+                                       const int top_n,
+                                       const Dtype* prev_dets,
+                                       const int* order,
+                                       Dtype* dets) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    const int b = index / top_n;
+    const int order_i = order[b * count_anchors + index % top_n];
+    for (int j = 0; j < 5; j ++) {
+      dets[index * 5 + j] = prev_dets[order_i * 5 + j];
+    }
+  }
+}
+
+__device__ inline float devIoU(float const * const a, float const * const b) {
+  float left = max(a[0], b[0]), right = min(a[2], b[2]);
+  float top = max(a[1], b[1]), bottom = min(a[3], b[3]);
+  float width = max(right - left + 1, 0.f), height = max(bottom - top + 1, 0.f);
+  float interS = width * height;
+  float Sa = (a[2] - a[0] + 1) * (a[3] - a[1] + 1);
+  float Sb = (b[2] - b[0] + 1) * (b[3] - b[1] + 1);
+  return interS / (Sa + Sb - interS);
+}
+
+// overlap bitmasks of the sorted boxes, blockIdx.z is the image
+// dev_boxes (b, n_boxes, 5); dev_mask (b, n_boxes, col_blocks)
+static __global__ void nms_kernel(const int n_boxes, const float nms_overlap_thresh,
+                                  const float *dev_boxes, uint64_t *dev_mask) {
+  const int threadsPerBlock = kNMSThreadsPerBlock;
+  const int row_start = blockIdx.y;
+  const int col_start = blockIdx.x;
+  const int col_blocks = DivUp(n_boxes, threadsPerBlock);
+  dev_boxes += static_cast<size_t>(blockIdx.z) * n_boxes * 5;
+  dev_mask += static_cast<size_t>(blockIdx.z) * n_boxes * col_blocks;
+
+  const int row_size =
+        min(n_boxes - row_start * threadsPerBlock, threadsPerBlock);
+  const int col_size =
+        min(n_boxes - col_start * threadsPerBlock, threadsPerBlock);
+
+  __shared__ float block_boxes[threadsPerBlock * 5];
+  if (threadIdx.x < col_size) {
+    for (int k = 0; k < 5; ++k) {
+      block_boxes[threadIdx.x * 5 + k] =
+          dev_boxes[(threadsPerBlock * col_start + threadIdx.x) * 5 + k];
+    }
+  }
+  __syncthreads();
+
+  if (threadIdx.x < row_size) {
+    const int cur_box_idx = threadsPerBlock * row_start + threadIdx.x;
+    const float *cur_box = dev_boxes + cur_box_idx * 5;
+    uint64_t t = 0;
+    int start = 0;
+    if (row_start == col_start) {
+      start = threadIdx.x + 1;
+    }
+    for (int i = start; i < col_size; i++) {
+      if (devIoU(cur_box, block_boxes + i * 5) > nms_overlap_thresh) {
+        t |= 1ULL << i;
+      }
+    }
+    dev_mask[cur_box_idx * col_blocks + col_start] = t;
+  }
+}
+
+// greedy NMS over the bitmasks, one block per image, the threads of a block
+// share the removed bits and OR the mask row of every kept box into them
+// dev_mask (b, n_boxes, col_blocks); keep (b, max_keep); num_keep (b, )
+static __global__ void NMSReduceKernel(const int n_boxes,
+                                       const int max_keep,
+                                       const uint64_t* dev_mask,
+                                       int* keep,
+                                       int* num_keep) {
+  extern __shared__ uint64_t remv[];
+  const int col_blocks = DivUp(n_boxes, kNMSThreadsPerBlock);
+  const int b = blockIdx.x;
+  dev_mask += static_cast<size_t>(b) * n_boxes * col_blocks;
+  keep += b * max_keep;
+  for (int j = threadIdx.x; j < col_blocks; j += blockDim.x) {
+    remv[j] = 0;
+  }
+  __syncthreads();
+
+  // a kept box only sets the bits of later boxes, so every thread takes the
+  // same decisions, the barrier after the update is only needed for the next
+  // kept box and all threads reach it together
+  int num_to_keep = 0;
+  for (int i = 0; i < n_boxes && num_to_keep < max_keep; ++i) {
+    const int nblock = i / kNMSThreadsPerBlock;
+    const int inblock = i % kNMSThreadsPerBlock;
+    if (remv[nblock] & (1ULL << inblock)) continue;
+    if (threadIdx.x == 0) {
+      keep[num_to_keep] = i;
+    }
+    ++num_to_keep;
+    const uint64_t* p = dev_mask + static_cast<size_t>(i) * col_blocks;
+    for (int j = nblock + threadIdx.x; j < col_blocks; j += blockDim.x) {
+      remv[j] |= p[j];
+    }
+    __syncthreads();
+  }
+  if (threadIdx.x == 0) {
+    num_keep[b] = num_to_keep;
+  }
+}
+
+// copy proposals to output, cycling through the kept ones to fill out_size rows
+// dets (b, top_n, 5); keep (b, max_keep); num_keep (b, ); out (b, out_size, 5)
+// count should be b * out_size
+template<typename Dtype>
+__global__ void PrepareOutput(const int count,
+                              const int out_size,
+                              const int top_n,
+                              const int max_keep,
+                              const Dtype* dets,
+                              const int* keep,
+                              const int* num_keep,
+                              Dtype* out,
+                              Dtype* score) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    const int b = index / out_size;
+    const int keep_i = keep[b * max_keep + (index % out_size) % num_keep[b]];
+    const Dtype* det = dets + (b * top_n + keep_i) * 5;
+    out[index * 5] = b;
+    for (int j = 0; j < 4; ++j) {
+      out[index * 5 + j + 1] = det[j];
+    }
+    score[index] = det[4];
+  }
+}
+
+/*!
+ * \brief temporary bytes of ProposalForward, 256-byte aligned regions
+ * \param offsets optional output, the start of the 9 regions and the size of the last
+ */
+inline size_t ProposalWorkspaceSize(const int num_images,
+                                    const int num_anchors,
+                                    const int count_anchors,
+                                    const int pre_nms_top_n,
+                                    const int max_keep,
+                                    size_t* offsets = nullptr) {
+  const size_t count = static_cast<size_t>(num_images) * count_anchors;
+  const size_t num_ordered = static_cast<size_t>(num_images) * pre_nms_top_n;
+  const size_t col_blocks = DivUp(pre_nms_top_n, kNMSThreadsPerBlock);
+  const size_t sizes[9] = {
+    sizeof(float) * num_anchors * 5,                 // anchors
+    sizeof(float) * count * 5,                       // decoded proposals
+    sizeof(float) * count,                           // scores
+    sizeof(int) * count,                             // order
+    sizeof(int) * count,                             // image of the sorted proposals
+    sizeof(float) * num_ordered * 5,                 // top proposals before nms
+    sizeof(uint64_t) * num_ordered * col_blocks,     // nms bitmasks
+    sizeof(int) * (num_images * max_keep + num_images),  // kept indices and counts
+    std::max(mxnet::op::SortByKeyWorkspaceSize<float, int, gpu>(count),
+             mxnet::op::SortByKeyWorkspaceSize<int, int, gpu>(count))
+  };
+  size_t total = 0;
+  for (int i = 0; i < 9; ++i) {
+    if (offsets != nullptr) offsets[i] = total;
+    total += (sizes[i] + 255) / 256 * 256;
+  }
+  if (offsets != nullptr) offsets[9] = sizes[8];
+  return total;
+}
+
+/*!
+ * \brief proposals of every image of the batch
+ * \param scores (b, 2 * anchor, h, w), the second half are the foreground scores
+ * \param bbox_deltas (b, 4 * anchor, h, w)
+ * \param im_info (b, 3) of (height, width, scale)
+ * \param anchors (anchor, 5) generated from the base anchor
+ * \param pre_nms_top_n proposals of an image going into nms, at most h * w * anchor
+ * \param max_keep most proposals kept by nms, at most pre_nms_top_n
+ * \param workspace at least ProposalWorkspaceSize bytes
+ * \param out (b, out_size, 5) of (image, x1, y1, x2, y2)
+ * \param out_score (b, out_size)
+ */
+inline void ProposalForward(const Tensor<gpu, 4>& scores,
+                            const Tensor<gpu, 4>& bbox_deltas,
+                            const Tensor<gpu, 2>& im_info,
+                            const std::vector<float>& anchors,
+                            const int feature_stride,
+                            const bool iou_loss,
+                            const float rpn_min_size,
+                            const int pre_nms_top_n,
+                            const int max_keep,
+                            const float threshold,
+                            const Tensor<gpu, 1, char>& workspace,
+                            const int out_size,
+                            float* out,
+                            float* out_score) {
+  Stream<gpu>* s = scores.stream_;
+  const int num_images = scores.size(0);
+  const int num_anchors = scores.size(1) / 2;
+  const int height = scores.size(2);
+  const int width = scores.size(3);
+  const int count_anchors = num_anchors * height * width;
+  const int count = num_images * count_anchors;
+  if (count == 0 || out_size == 0) return;
+  CHECK_GT(max_keep, 0);
+  CHECK_LE(max_keep, pre_nms_top_n);
+  CHECK_LE(pre_nms_top_n, count_anchors);
+  CHECK_EQ(anchors.size(), static_cast<size_t>(num_anchors) * 5);
+
+  size_t offsets[10];
+  CHECK_GE(workspace.size(0), ProposalWorkspaceSize(num_images, num_anchors, count_anchors,
+                                                    pre_nms_top_n, max_keep, offsets));
+  char* base = workspace.dptr_;
+  float* anchors_dev = reinterpret_cast<float*>(base + offsets[0]);
+  float* proposals = reinterpret_cast<float*>(base + offsets[1]);
+  Tensor<gpu, 1> score(reinterpret_cast<float*>(base + offsets[2]), Shape1(count), s);
+  Tensor<gpu, 1, int> order(reinterpret_cast<int*>(base + offsets[3]), Shape1(count), s);
+  Tensor<gpu, 1, int> batch_id(reinterpret_cast<int*>(base + offsets[4]), Shape1(count), s);
+  float* ordered_proposals = reinterpret_cast<float*>(base + offsets[5]);
+  uint64_t* mask = reinterpret_cast<uint64_t*>(base + offsets[6]);
+  int* keep = reinterpret_cast<int*>(base + offsets[7]);
+  int* num_keep = keep + num_images * max_keep;
+  Tensor<gpu, 1, char> sort_workspace(base + offsets[8], Shape1(offsets[9]), s);
+
+  cudaStream_t stream = Stream<gpu>::GetStream(s);
+  const int threads = kMaxThreadsPerBlock;
+  auto blocks = [threads](int n) {
+    return std::min((n + threads - 1) / threads, static_cast<int>(kMaxGridNum));
+  };
+
+  // the anchors are the only upload, pageable memory is staged by the copy
+  // call itself, so the host vector may go away once it returns
+  CHECK_EQ(cudaMemcpyAsync(anchors_dev, anchors.data(), sizeof(float) * anchors.size(),
+                           cudaMemcpyHostToDevice, stream), cudaSuccess);
+
+  ProposalGridKernel<<<blocks(count), threads, 0, stream>>>(
+    count, num_anchors, height, width, feature_stride, anchors_dev, scores.dptr_, proposals);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(ProposalGridKernel);
+
+  // transform anchors and bbox_deltas into bboxes, clipped to the images
+  if (iou_loss) {
+    IoUPredKernel<<<blocks(count), threads, 0, stream>>>(
+      count, num_anchors, height, width, feature_stride, im_info.dptr_,
+      proposals, bbox_deltas.dptr_, proposals);
+    MSHADOW_CUDA_POST_KERNEL_CHECK(IoUPredKernel);
+  } else {
+    BBoxPredKernel<<<blocks(count), threads, 0, stream>>>(
+      count, num_anchors, height, width, feature_stride, im_info.dptr_,
+      proposals, bbox_deltas.dptr_, proposals);
+    MSHADOW_CUDA_POST_KERNEL_CHECK(BBoxPredKernel);
+  }
+
+  FilterBoxKernel<<<blocks(count), threads, 0, stream>>>(
+    count, count_anchors, rpn_min_size, im_info.dptr_, proposals, score.dptr_, order.dptr_);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(FilterBoxKernel);
+
+  // both passes are stable, so the proposals of an image end up contiguous,
+  // by descending score and ascending index among equal scores
+  mxnet::op::SortByKey(score, order, false, &sort_workspace);
+  if (num_images > 1) {
+    int end_bit = 1;
+    while ((1 << end_bit) < num_images) ++end_bit;
+    BatchIdKernel<<<blocks(count), threads, 0, stream>>>(
+      count, count_anchors, order.dptr_, batch_id.dptr_);
+    MSHADOW_CUDA_POST_KERNEL_CHECK(BatchIdKernel);
+    mxnet::op::SortByKey(batch_id, order, true, &sort_workspace, 0, end_bit);
+  }
+
+  const int num_ordered = num_images * pre_nms_top_n;
+  ReorderProposalsKernel<<<blocks(num_ordered), threads, 0, stream>>>(
+    num_ordered, count_anchors, pre_nms_top_n, proposals, order.dptr_, ordered_proposals);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(ReorderProposalsKernel);
+
+  const int col_blocks = DivUp(pre_nms_top_n, kNMSThreadsPerBlock);
+  const size_t remv_bytes = sizeof(uint64_t) * col_blocks;
+  CHECK_LE(remv_bytes, 48 * 1024U) << "rpn_pre_nms_top_n is too large for the nms of an image";
+  nms_kernel<<<dim3(col_blocks, col_blocks, num_images), kNMSThreadsPerBlock, 0, stream>>>(
+    pre_nms_top_n, threshold, ordered_proposals, mask);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(nms_kernel);
+  const int reduce_threads = std::min(threads, DivUp(col_blocks, 32) * 32);
+  NMSReduceKernel<<<num_images, reduce_threads, remv_bytes, stream>>>(
+    pre_nms_top_n, max_keep, mask, keep, num_keep);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(NMSReduceKernel);
+
+  const int num_out = num_images * out_size;
+  PrepareOutput<<<blocks(num_out), threads, 0, stream>>>(
+    num_out, out_size, pre_nms_top_n, max_keep, ordered_proposals, keep, num_keep,
+    out, out_score);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(PrepareOutput);
+}
+
+}  // namespace proposal
+}  // namespace cuda
+}  // namespace mshadow
+
+#endif  // MXNET_OPERATOR_CONTRIB_PROPOSAL_INL_CUH_
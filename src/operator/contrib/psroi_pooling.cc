@@ -31,6 +31,9 @@
 #include <mshadow/packet-inl.h>
 #include <mshadow/dot_engine-inl.h>
 #include <cassert>
+#include <type_traits>
+#include <vector>
+#include "../../engine/openmp.h"
 
 using std::max;
 using std::min;
@@ -38,6 +41,59 @@ using std::floor;
 using std::ceil;
 
 namespace mshadow {
+/*!
+ * \brief clipped [start, end) rows and columns of every bin of every roi, found once
+ *  instead of for each output channel, along with the batch index of each roi
+ */
+template<typename DType, typename AType>
+inline void PSROIPoolBins(const Tensor<cpu, 2, DType> &bbox,
+                          const float spatial_scale,
+                          const int height, const int width,
+                          const int pooled_height, const int pooled_width,
+                          std::vector<int> *batch_ind,
+                          std::vector<int> *hbins,
+                          std::vector<int> *wbins) {
+  const int num_rois = bbox.size(0);
+  batch_ind->resize(num_rois);
+  hbins->resize(num_rois * pooled_height * 2);
+  wbins->resize(num_rois * pooled_width * 2);
+  for (int n = 0; n < num_rois; ++n) {
+    const DType *roi = bbox.dptr_ + n * 5;
+    (*batch_ind)[n] = static_cast<int>(static_cast<AType>(roi[0]));
+    const AType roi_start_w = round(static_cast<AType>(roi[1])) * spatial_scale;
+    const AType roi_start_h = round(static_cast<AType>(roi[2])) * spatial_scale;
+    const AType roi_end_w = (round(static_cast<AType>(roi[3])) + 1) * spatial_scale;
+    const AType roi_end_h = (round(static_cast<AType>(roi[4])) + 1) * spatial_scale;
+    // Force too small ROIs to be 1x1
+    const AType roi_width = max(roi_end_w - roi_start_w, AType(0.1));
+    const AType roi_height = max(roi_end_h - roi_start_h, AType(0.1));
+    const AType bin_size_h = roi_height / static_cast<AType>(pooled_height);
+    const AType bin_size_w = roi_width / static_cast<AType>(pooled_width);
+    for (int ph = 0; ph < pooled_height; ++ph) {
+      const int hstart = floor(static_cast<AType>(ph) * bin_size_h + roi_start_h);
+      const int hend = ceil(static_cast<AType>(ph + 1) * bin_size_h + roi_start_h);
+      (*hbins)[(n * pooled_height + ph) * 2] = min(max(hstart, 0), height);
+      (*hbins)[(n * pooled_height + ph) * 2 + 1] = min(max(hend, 0), height);
+    }
+    for (int pw = 0; pw < pooled_width; ++pw) {
+      const int wstart = floor(static_cast<AType>(pw) * bin_size_w + roi_start_w);
+      const int wend = ceil(static_cast<AType>(pw + 1) * bin_size_w + roi_start_w);
+      (*wbins)[(n * pooled_width + pw) * 2] = min(max(wstart, 0), width);
+      (*wbins)[(n * pooled_width + pw) * 2 + 1] = min(max(wend, 0), width);
+    }
+  }
+}
+
+/*! \brief position sensitive group of each of the pooled rows (or columns) */
+inline std::vector<int> PSROIPoolGroups(const int group_size, const int pooled_size) {
+  std::vector<int> groups(pooled_size);
+  for (int p = 0; p < pooled_size; ++p) {
+    const int g = floor(static_cast<float>(p) * group_size / pooled_size);
+    groups[p] = min(max(g, 0), group_size - 1);
+  }
+  return groups;
+}
+
 template<typename DType>
 inline void PSROIPoolForward(const Tensor<cpu, 4, DType> &out,
                            const Tensor<cpu, 4, DType> &data,
@@ -45,8 +101,50 @@ inline void PSROIPoolForward(const Tensor<cpu, 4, DType> &out,
                            const float spatial_scale_,
                            const int output_dim_,
                            const int group_size_) {
-  // NOT_IMPLEMENTED;
-  return;
+  typedef typename std::conditional<std::is_same<DType, double>::value,
+                                    double, float>::type AType;
+  const int num_rois = bbox.size(0);
+  const int channels = data.size(1);
+  const int height = data.size(2);
+  const int width = data.size(3);
+  const int pooled_height = out.size(2);
+  const int pooled_width = out.size(3);
+  CHECK_GE(channels, output_dim_ * group_size_ * group_size_)
+    << "PSROIPooling needs output_dim * group_size^2 input channels";
+  std::vector<int> batch_ind, hbins, wbins;
+  PSROIPoolBins<DType, AType>(bbox, spatial_scale_, height, width, pooled_height,
+                              pooled_width, &batch_ind, &hbins, &wbins);
+  const std::vector<int> gh = PSROIPoolGroups(group_size_, pooled_height);
+  const std::vector<int> gw = PSROIPoolGroups(group_size_, pooled_width);
+
+  const int omp_threads = mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int index = 0; index < num_rois * output_dim_; ++index) {
+    // one output map (n, ctop) per iteration
+    const int n = index / output_dim_;
+    const int ctop = index % output_dim_;
+    DType *top_data = out.dptr_ + static_cast<size_t>(index) * pooled_height * pooled_width;
+    for (int ph = 0; ph < pooled_height; ++ph) {
+      const int hstart = hbins[(n * pooled_height + ph) * 2];
+      const int hend = hbins[(n * pooled_height + ph) * 2 + 1];
+      for (int pw = 0; pw < pooled_width; ++pw) {
+        const int wstart = wbins[(n * pooled_width + pw) * 2];
+        const int wend = wbins[(n * pooled_width + pw) * 2 + 1];
+        const int c = (ctop * group_size_ + gh[ph]) * group_size_ + gw[pw];
+        const DType *bottom_data = data.dptr_ +
+          (static_cast<size_t>(batch_ind[n]) * channels + c) * height * width;
+        AType out_sum = 0;
+        for (int h = hstart; h < hend; ++h) {
+          for (int w = wstart; w < wend; ++w) {
+            out_sum += static_cast<AType>(bottom_data[h * width + w]);
+          }
+        }
+        const bool is_empty = (hend <= hstart) || (wend <= wstart);
+        top_data[ph * pooled_width + pw] = is_empty ? DType(0) :
+          DType(out_sum / static_cast<AType>((hend - hstart) * (wend - wstart)));
+      }
+    }
+  }
 }
 
 template<typename DType>
@@ -56,8 +154,51 @@ inline void PSROIPoolBackwardAcc(const Tensor<cpu, 4, DType> &in_grad,
                             const float spatial_scale_,
                             const int output_dim_,
                             const int group_size_) {
-  // NOT_IMPLEMENTED;
-  return;
+  typedef typename std::conditional<std::is_same<DType, double>::value,
+                                    double, float>::type AType;
+  const int num_rois = bbox.size(0);
+  const int channels = in_grad.size(1);
+  const int height = in_grad.size(2);
+  const int width = in_grad.size(3);
+  const int pooled_height = out_grad.size(2);
+  const int pooled_width = out_grad.size(3);
+  CHECK_GE(channels, output_dim_ * group_size_ * group_size_)
+    << "PSROIPooling needs output_dim * group_size^2 input channels";
+  std::vector<int> batch_ind, hbins, wbins;
+  PSROIPoolBins<DType, AType>(bbox, spatial_scale_, height, width, pooled_height,
+                              pooled_width, &batch_ind, &hbins, &wbins);
+  const std::vector<int> gh = PSROIPoolGroups(group_size_, pooled_height);
+  const std::vector<int> gw = PSROIPoolGroups(group_size_, pooled_width);
+
+  // the input channels of different output channels are disjoint, so each thread owns
+  // the gradient it accumulates for all the rois of its output channels
+  const int omp_threads = mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int ctop = 0; ctop < output_dim_; ++ctop) {
+    for (int n = 0; n < num_rois; ++n) {
+      const DType *top_diff = out_grad.dptr_ +
+        (static_cast<size_t>(n) * output_dim_ + ctop) * pooled_height * pooled_width;
+      for (int ph = 0; ph < pooled_height; ++ph) {
+        const int hstart = hbins[(n * pooled_height + ph) * 2];
+        const int hend = hbins[(n * pooled_height + ph) * 2 + 1];
+        for (int pw = 0; pw < pooled_width; ++pw) {
+          const int wstart = wbins[(n * pooled_width + pw) * 2];
+          const int wend = wbins[(n * pooled_width + pw) * 2 + 1];
+          if ((hend <= hstart) || (wend <= wstart)) continue;
+          const int c = (ctop * group_size_ + gh[ph]) * group_size_ + gw[pw];
+          DType *bottom_diff = in_grad.dptr_ +
+            (static_cast<size_t>(batch_ind[n]) * channels + c) * height * width;
+          const DType diff_val = DType(static_cast<AType>(top_diff[ph * pooled_width + pw]) /
+                                       static_cast<AType>((hend - hstart) * (wend - wstart)));
+          for (int h = hstart; h < hend; ++h) {
+            for (int w = wstart; w < wend; ++w) {
+              bottom_diff[h * width + w] += diff_val;
+            }
+          }
+        }
+      }
+    }
+  }
 }
 }  // namespace mshadow
 
@@ -5,104 +5,230 @@
  * \author Yuchen Guo, Zehao Shi
 */
 #include "./roi_align_v2-inl.h"
-
+#include <algorithm>
+#include <vector>
+#include "../../engine/openmp.h"
 
 namespace mxnet {
 namespace op {
 
 /*!
- * \brief Kernel for backward pass of ROIAlign.
+ * \brief A bilinear sample of a pooling bin: the offsets of its four neighbours in a
+ *  channel plane and their weights, which do not depend on the channel.
+ */
+template<typename DType>
+struct ROIAlignSample_v2 {
+  int offset[4];
+  DType weight[4];
+  DType x, y;
+};
+
+/*!
+ * \brief Samples of every bin of one roi, in the order of ROIAlignForwardKernel_v2.
+ * \param bin_begin the samples of bin ph * pooled_width + pw are
+ *  [bin_begin[bin], bin_begin[bin + 1]), a bin without samples pools nothing
  */
-struct ROIAlignBackwardKernelCPU {
-  /*!
-   * \param index          loop index
-   * \param top_diff       gradient of output data
-   * \param argmax_x       index of value in pooled feature map on x axis
-   * \param argmax_y       index of value in pooled feature map on y axis
-   * \param num_rois       number of rois
-   * \param spatial_scale  ratio of input feature map height (or width)
-                               to raw image height (or width)
-   * \param channels       channels of input data
-   * \param height         height of input data
-   * \param width          width of input data
-   * \param pooled_height  height of fix pooled size
-   * \param pooled_width   width of fix pooled size
-   * \param bottom_diff    gradient of input 4D feature map
-   * \param bottom_rois    gradient of input rois
-   */
-  template<typename DType>
-  MSHADOW_XINLINE static void Map(int index, const DType* top_diff,
-                                  const DType* argmax_x, const DType* argmax_y,
-                                  const int num_rois, const float spatial_scale,
-                                  const int channels, const int height, const int width,
-                                  const int pooled_height, const int pooled_width,
-                                  DType* bottom_diff, const DType* bottom_rois) {
-    using namespace mxnet::op::mshadow_op;
-    // (n, c, h, w) coords in bottom data
-    int w = index % width;
-    int h = (index / width) % height;
-    int c = (index / width / height) % channels;
-    int n = index / width / height / channels;
-
-    DType gradient = 0;
-    // Accumulate gradient over all ROIs that pooled this element
-    for (int roi_n = 0; roi_n < num_rois; ++roi_n) {
-      const DType* offset_bottom_rois = bottom_rois + roi_n * 5;
-      int roi_batch_ind = offset_bottom_rois[0];
-      // Skip if ROI's batch index doesn't match n
-      if (n != roi_batch_ind) {
-        continue;
+template<typename DType>
+void ROIAlignRoiSamples_v2(const DType* roi, const float spatial_scale,
+                           const int height, const int width,
+                           const int pooled_height, const int pooled_width,
+                           std::vector<ROIAlignSample_v2<DType>>* samples,
+                           std::vector<int>* bin_begin) {
+  using namespace mxnet::op::mshadow_op;
+  samples->clear();
+  bin_begin->clear();
+  const DType roi_start_w = roi[1] * spatial_scale;
+  const DType roi_start_h = roi[2] * spatial_scale;
+  const DType roi_end_w = roi[3] * spatial_scale;
+  const DType roi_end_h = roi[4] * spatial_scale;
+  const DType bin_size_h = (roi_end_h - roi_start_h) / static_cast<DType>(pooled_height);
+  const DType bin_size_w = (roi_end_w - roi_start_w) / static_cast<DType>(pooled_width);
+  for (int ph = 0; ph < pooled_height; ++ph) {
+    for (int pw = 0; pw < pooled_width; ++pw) {
+      bin_begin->push_back(samples->size());
+      DType hstart = static_cast<DType>(ph * bin_size_h);
+      DType wstart = static_cast<DType>(pw * bin_size_w);
+      DType hend = static_cast<DType>((ph + 1) * bin_size_h);
+      DType wend = static_cast<DType>((pw + 1) * bin_size_w);
+      hstart = minimum::Map(maximum::Map(hstart + roi_start_h, static_cast<DType>(0)),
+                            static_cast<DType>(height - 1));
+      hend = minimum::Map(maximum::Map(hend + roi_start_h, static_cast<DType>(0)),
+                          static_cast<DType>(height - 1));
+      wstart = minimum::Map(maximum::Map(wstart + roi_start_w, static_cast<DType>(0)),
+                            static_cast<DType>(width - 1));
+      wend = minimum::Map(maximum::Map(wend + roi_start_w, static_cast<DType>(0)),
+                          static_cast<DType>(width - 1));
+      if ((hend <= hstart) || (wend <= wstart)) continue;
+      const DType h_stride = (hend - hstart) / 3.0;
+      const DType w_stride = (wend - wstart) / 3.0;
+      for (DType h = hstart + h_stride; h <= hend - h_stride + 0.01;
+           h += maximum::Map(h_stride, static_cast<DType>(0.01))) {
+        for (DType w = wstart + w_stride; w <= wend - w_stride + 0.01;
+             w += maximum::Map(w_stride, static_cast<DType>(0.01))) {
+          const int hlow = minimum::Map(maximum::Map(static_cast<int>(floor::Map(h)), 0),
+                                        height - 1);
+          const int hhigh = minimum::Map(maximum::Map(static_cast<int>(ceil::Map(h)), 0),
+                                         height - 1);
+          const int wleft = minimum::Map(maximum::Map(static_cast<int>(floor::Map(w)), 0),
+                                         width - 1);
+          const int wright = minimum::Map(maximum::Map(static_cast<int>(ceil::Map(w)), 0),
+                                          width - 1);
+          const DType alpha = (hlow == hhigh) ? static_cast<DType>(0.5)
+                                              : (h - hlow) / (hhigh - hlow);
+          const DType beta = (wleft == wright) ? static_cast<DType>(0.5)
+                                               : (w - wleft) / (wright - wleft);
+          ROIAlignSample_v2<DType> sample;
+          sample.offset[0] = hlow * width + wleft;
+          sample.offset[1] = hhigh * width + wleft;
+          sample.offset[2] = hlow * width + wright;
+          sample.offset[3] = hhigh * width + wright;
+          sample.weight[0] = (1 - alpha) * (1 - beta);
+          sample.weight[1] = alpha * (1 - beta);
+          sample.weight[2] = (1 - alpha) * beta;
+          sample.weight[3] = alpha * beta;
+          sample.x = w;
+          sample.y = h;
+          samples->push_back(sample);
+        }
       }
+    }
+  }
+  bin_begin->push_back(samples->size());
+}
 
-      DType roi_start_w = (offset_bottom_rois[1]) * spatial_scale;
-      DType roi_start_h = (offset_bottom_rois[2]) * spatial_scale;
-      DType roi_end_w = (offset_bottom_rois[3]) * spatial_scale;
-      DType roi_end_h = (offset_bottom_rois[4]) * spatial_scale;
+/*!
+ * \brief Forward pass of ROIAlign on cpu. The bilinear samples of a roi are computed once
+ *  and reused for all its channels, rois are spread over the OpenMP threads.
+ */
+template<>
+void ROIAlignForward_v2<cpu>(const nnvm::NodeAttrs& attrs,
+                             const OpContext& ctx,
+                             const std::vector<TBlob>& in_data,
+                             const std::vector<OpReqType>& req,
+                             const std::vector<TBlob>& out_data) {
+  using namespace mshadow;
+  CHECK_EQ(in_data.size(), 2U);
+  CHECK_EQ(out_data.size(), 3U);
+  CHECK_EQ(out_data[roialign_v2::kOut].shape_[0], in_data[roialign_v2::kBox].shape_[0]);
+  CHECK_EQ(out_data[roialign_v2::kMaxIdx_x].shape_[0], in_data[roialign_v2::kBox].shape_[0]);
+  CHECK_EQ(out_data[roialign_v2::kMaxIdx_y].shape_[0], in_data[roialign_v2::kBox].shape_[0]);
 
-      // Skip if ROI doesn't include (h, w)
-      const bool in_roi = (w > roi_start_w - 1.0 && w < roi_end_w + 1.0 &&
-                           h > roi_start_h - 1.0 && h < roi_end_h + 1.0);
-      if (!in_roi) {
-        continue;
-      }
+  const ROIAlignParam_v2 param = nnvm::get<ROIAlignParam_v2>(attrs.parsed);
 
-      int offset = (roi_n * channels + c) * pooled_height * pooled_width;
-      const DType* offset_top_diff = top_diff + offset;
-      const DType* offset_argmax_x = argmax_x + offset;
-      const DType* offset_argmax_y = argmax_y + offset;
-
-      for (int ph = 0; ph < pooled_height; ++ph) {
-        for (int pw = 0; pw < pooled_width; ++pw) {
-          const int pool_index = ph * pooled_width + pw;
-          DType a_x = offset_argmax_x[pool_index];
-          DType a_y = offset_argmax_y[pool_index];
-          int hlow = minimum::Map(maximum::Map(static_cast<int>(floor::Map(a_y)), 0), height-1);
-          int hhigh = minimum::Map(maximum::Map(static_cast<int>(ceil::Map(a_y)), 0), height-1);
-          int wleft = minimum::Map(maximum::Map(static_cast<int>(floor::Map(a_x)), 0), width-1);
-          int wright = minimum::Map(maximum::Map(static_cast<int>(ceil::Map(a_x)), 0), width-1);
-          // (w, h) is not around (a_x, a_y)
-          if (h != hlow && h != hhigh && w != wleft && w != wright)
-            continue;
-
-          DType alpha = (hlow == hhigh) ? static_cast<DType>(0.5)
-                                        : (a_y - hlow) / (hhigh - hlow);
-          DType beta = (wleft == wright) ? static_cast<DType>(0.5)
-                                         : (a_x - wleft) / (wright - wleft);
-          if (h == hlow && w == wleft) {
-            gradient += offset_top_diff[pool_index] * (1 - alpha) * (1 - beta);
-          } else if (h == hlow && w == wright) {
-            gradient += offset_top_diff[pool_index] * (1 - alpha) * beta;
-          } else if (h == hhigh && w == wleft) {
-            gradient += offset_top_diff[pool_index] * alpha * (1 - beta);
-          } else if (h == hhigh && w == wright) {
-            gradient += offset_top_diff[pool_index] * alpha * beta;
+  const int num_rois = in_data[roialign_v2::kBox].size(0);
+  const int channels = in_data[roialign_v2::kData].size(1);
+  const int height = in_data[roialign_v2::kData].size(2);
+  const int width = in_data[roialign_v2::kData].size(3);
+  const int pooled_height = out_data[roialign_v2::kOut].size(2);
+  const int pooled_width = out_data[roialign_v2::kOut].size(3);
+  const int num_bins = pooled_height * pooled_width;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+
+  MSHADOW_REAL_TYPE_SWITCH(in_data[0].type_flag_, DType, {
+    const DType *bottom_data = in_data[roialign_v2::kData].dptr<DType>();
+    const DType *bottom_rois = in_data[roialign_v2::kBox].dptr<DType>();
+    DType *top_data = out_data[roialign_v2::kOut].dptr<DType>();
+    DType *argmax_x = out_data[roialign_v2::kMaxIdx_x].dptr<DType>();
+    DType *argmax_y = out_data[roialign_v2::kMaxIdx_y].dptr<DType>();
+
+    #pragma omp parallel num_threads(omp_threads)
+    {
+      std::vector<ROIAlignSample_v2<DType>> samples;
+      std::vector<int> bin_begin;
+      #pragma omp for schedule(dynamic)
+      for (int n = 0; n < num_rois; ++n) {
+        const DType *roi = bottom_rois + n * 5;
+        const int roi_batch_ind = roi[0];
+        const int top_offset = n * channels * num_bins;
+        if (roi_batch_ind < 0) {
+          std::fill(top_data + top_offset, top_data + top_offset + channels * num_bins,
+                    static_cast<DType>(0));
+          std::fill(argmax_x + top_offset, argmax_x + top_offset + channels * num_bins,
+                    static_cast<DType>(0));
+          std::fill(argmax_y + top_offset, argmax_y + top_offset + channels * num_bins,
+                    static_cast<DType>(0));
+          continue;
+        }
+        ROIAlignRoiSamples_v2(roi, param.spatial_scale, height, width,
+                              pooled_height, pooled_width, &samples, &bin_begin);
+        for (int c = 0; c < channels; ++c) {
+          const DType *data = bottom_data + (roi_batch_ind * channels + c) * height * width;
+          const int offset = top_offset + c * num_bins;
+          for (int bin = 0; bin < num_bins; ++bin) {
+            // If nothing is pooled, argmax = -1 causes nothing to be backprop'd
+            DType maxidx_x = -1;
+            DType maxidx_y = -1;
+            DType maxval = bin_begin[bin] == bin_begin[bin + 1] ?
+                           static_cast<DType>(0) : mshadow::red::limits::MinValue<DType>();
+            for (int k = bin_begin[bin]; k < bin_begin[bin + 1]; ++k) {
+              const ROIAlignSample_v2<DType>& sample = samples[k];
+              const DType value = sample.weight[0] * data[sample.offset[0]]
+                                  + sample.weight[1] * data[sample.offset[1]]
+                                  + sample.weight[2] * data[sample.offset[2]]
+                                  + sample.weight[3] * data[sample.offset[3]];
+              if (value > maxval) {
+                maxval = value;
+                maxidx_x = sample.x;
+                maxidx_y = sample.y;
+              }
+            }
+            top_data[offset + bin] = maxval;
+            argmax_x[offset + bin] = maxidx_x;
+            argmax_y[offset + bin] = maxidx_y;
           }
         }
       }
     }
-    bottom_diff[index] += gradient;
+  })
+}
+
+/*!
+ * \brief Backward pass of ROIAlign on cpu: the gradient of every pooled element goes to
+ *  the four neighbours of its argmax, as on gpu. The channels are spread over the OpenMP
+ *  threads, so no two threads write the same input gradient.
+ */
+template<typename DType>
+void ROIAlignBackwardCPU_v2(const DType* top_diff, const DType* argmax_x,
+                            const DType* argmax_y, const DType* bottom_rois,
+                            const int num_rois, const int channels,
+                            const int height, const int width,
+                            const int pooled_height, const int pooled_width,
+                            DType* bottom_diff) {
+  using namespace mxnet::op::mshadow_op;
+  const int num_bins = pooled_height * pooled_width;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int c = 0; c < channels; ++c) {
+    for (int n = 0; n < num_rois; ++n) {
+      const int roi_batch_ind = bottom_rois[n * 5];
+      if (roi_batch_ind < 0) continue;
+      DType* diff = bottom_diff + (roi_batch_ind * channels + c) * height * width;
+      const int top_offset = (n * channels + c) * num_bins;
+      for (int bin = 0; bin < num_bins; ++bin) {
+        const DType a_x = argmax_x[top_offset + bin];
+        const DType a_y = argmax_y[top_offset + bin];
+        if (a_x == static_cast<DType>(-1) || a_y == static_cast<DType>(-1)) continue;
+        const DType grad = top_diff[top_offset + bin];
+        const int hlow = minimum::Map(maximum::Map(static_cast<int>(floor::Map(a_y)), 0),
+                                      height - 1);
+        const int hhigh = minimum::Map(maximum::Map(static_cast<int>(ceil::Map(a_y)), 0),
+                                       height - 1);
+        const int wleft = minimum::Map(maximum::Map(static_cast<int>(floor::Map(a_x)), 0),
+                                       width - 1);
+        const int wright = minimum::Map(maximum::Map(static_cast<int>(ceil::Map(a_x)), 0),
+                                        width - 1);
+        const DType alpha = (hlow == hhigh) ? static_cast<DType>(0.5)
+                                            : (a_y - hlow) / (hhigh - hlow);
+        const DType beta = (wleft == wright) ? static_cast<DType>(0.5)
+                                             : (a_x - wleft) / (wright - wleft);
+        diff[hlow * width + wleft] += grad * (1 - alpha) * (1 - beta);
+        diff[hhigh * width + wleft] += grad * alpha * (1 - beta);
+        diff[hlow * width + wright] += grad * (1 - alpha) * beta;
+        diff[hhigh * width + wright] += grad * alpha * beta;
+      }
+    }
   }
-};
+}
 
 template<>
 void ROIAlignBackward_v2<cpu>(const nnvm::NodeAttrs& attrs,
@@ -127,9 +253,6 @@ void ROIAlignBackward_v2<cpu>(const nnvm::NodeAttrs& attrs,
   CHECK_NE(req[1], kWriteInplace) <<
     "ROIAlign: Backward doesn't support kWriteInplace.";
 
-  const ROIAlignParam_v2 param = nnvm::get<ROIAlignParam_v2>(attrs.parsed);
-
-  const int count = outputs[0].Size();
   const int num_rois = in_data[0].size(0);
   const int channels = outputs[0].size(1);
   const int height = outputs[0].size(2);
@@ -145,16 +268,13 @@ void ROIAlignBackward_v2<cpu>(const nnvm::NodeAttrs& attrs,
     DType *argmax_x = out_data[0].dptr<DType>();
     DType *argmax_y = out_data[1].dptr<DType>();
     DType *grad_in = outputs[0].dptr<DType>();
-    DType *grad_roi = outputs[1].dptr<DType>();
 
     if (kAddTo == req[roialign_v2::kData] || kWriteTo == req[roialign_v2::kData]) {
       if (kWriteTo == req[roialign_v2::kData]) {
         Fill<false>(s, outputs[0], kWriteTo, static_cast<DType>(0));
       }
-      mxnet_op::Kernel<ROIAlignBackwardKernelCPU, cpu>::Launch(s,
-        count, top_diff, argmax_x, argmax_y, num_rois, param.spatial_scale,
-        channels, height, width,
-        pooled_height, pooled_width, grad_in, bottom_rois);
+      ROIAlignBackwardCPU_v2(top_diff, argmax_x, argmax_y, bottom_rois, num_rois, channels,
+                             height, width, pooled_height, pooled_width, grad_in);
     }
     if (kWriteTo == req[roialign_v2::kBox]) {
       Fill<false>(s, outputs[1], kWriteTo, static_cast<DType>(0));
@@ -0,0 +1,317 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file sampled_softmax-inl.h
+ * \brief softmax cross entropy over the true class and a shared set of sampled classes
+ *
+ *  Only the weight rows of the true and the sampled classes are read: the
+ *  sampled rows are gathered once for the batch, their logits come from one
+ *  gemm, and the logits are corrected by the log probability of the sampling
+ *  distribution, so the loss estimates the one of the full softmax.
+ */
+#ifndef MXNET_OPERATOR_CONTRIB_SAMPLED_SOFTMAX_INL_H_
+#define MXNET_OPERATOR_CONTRIB_SAMPLED_SOFTMAX_INL_H_
+
+#include <mxnet/operator_util.h>
+#include <vector>
+#include "../mshadow_op.h"
+#include "../mxnet_op.h"
+#include "../operator_common.h"
+#include "../elemwise_op_common.h"
+#include "../linalg.h"
+
+namespace mxnet {
+namespace op {
+
+namespace sampled_softmax {
+enum SampledSoftmaxInputs {kData, kWeight, kLabel, kSampled, kProb};
+}  // namespace sampled_softmax
+
+struct SampledSoftmaxParam : public dmlc::Parameter<SampledSoftmaxParam> {
+  bool remove_accidental_hits;
+  DMLC_DECLARE_PARAMETER(SampledSoftmaxParam) {
+    DMLC_DECLARE_FIELD(remove_accidental_hits).set_default(true)
+    .describe("Whether to leave out of the softmax of a sample the sampled classes "
+              "equal to its label.");
+  }
+};
+
+inline bool SampledSoftmaxShape(const nnvm::NodeAttrs& attrs,
+                                std::vector<TShape> *in_attrs,
+                                std::vector<TShape> *out_attrs) {
+  using namespace sampled_softmax;
+  CHECK_EQ(in_attrs->size(), 5U) << "Input:[data, weight, label, sampled, prob]";
+  CHECK_EQ(out_attrs->size(), 1U);
+  const TShape& dshape = (*in_attrs)[kData];
+  const TShape& wshape = (*in_attrs)[kWeight];
+  if (dshape.ndim() == 0 || wshape.ndim() == 0 || (*in_attrs)[kSampled].ndim() == 0) {
+    return false;
+  }
+  CHECK_EQ(dshape.ndim(), 2U) << "data must be (batch_size, feature_dim)";
+  CHECK_EQ(wshape.ndim(), 2U) << "weight must be (num_classes, feature_dim)";
+  CHECK_EQ(dshape[1], wshape[1]) << "data and weight must have the same feature_dim";
+  CHECK_EQ((*in_attrs)[kSampled].ndim(), 1U) << "sampled must be 1D";
+  SHAPE_ASSIGN_CHECK(*in_attrs, kLabel, TShape(mshadow::Shape1(dshape[0])));
+  SHAPE_ASSIGN_CHECK(*in_attrs, kProb, TShape(mshadow::Shape1(wshape[0])));
+  SHAPE_ASSIGN_CHECK(*out_attrs, 0, TShape(1));
+  return true;
+}
+
+inline bool SampledSoftmaxType(const nnvm::NodeAttrs& attrs,
+                               std::vector<int> *in_attrs,
+                               std::vector<int> *out_attrs) {
+  using namespace sampled_softmax;
+  CHECK_EQ(in_attrs->size(), 5U);
+  CHECK_EQ(out_attrs->size(), 1U);
+  const int dtype = (*in_attrs)[kData];
+  if (dtype == -1) return false;
+  TYPE_ASSIGN_CHECK(*in_attrs, kWeight, dtype);
+  TYPE_ASSIGN_CHECK(*in_attrs, kProb, dtype);
+  TYPE_ASSIGN_CHECK(*out_attrs, 0, dtype);
+  // the class ids may be of any type, sample_multinomial gives int32
+  if ((*in_attrs)[kLabel] == -1) TYPE_ASSIGN_CHECK(*in_attrs, kLabel, dtype);
+  if ((*in_attrs)[kSampled] == -1) TYPE_ASSIGN_CHECK(*in_attrs, kSampled, mshadow::kInt32);
+  return true;
+}
+
+/*! \brief out[j] = weight[sampled[j]], one thread per element */
+struct SampledRowsKernel {
+  template<typename DType, typename IType>
+  MSHADOW_XINLINE static void Map(int i, DType* out, const DType* weight, const IType* sampled,
+                                  const int dim) {
+    const int j = i / dim;
+    out[i] = weight[static_cast<index_t>(sampled[j]) * dim + i % dim];
+  }
+};
+
+/*!
+ * \brief softmax of a sample over its true class and the sampled ones, one row per thread
+ * \param sampled_logits (n, S) input the raw logits, output the probabilities
+ * \param true_grad output p_true - 1
+ * \param loss output the cross entropy, or nullptr
+ */
+struct SampledSoftmaxRowKernel {
+  template<typename DType, typename IType, typename LType>
+  MSHADOW_XINLINE static void Map(int i, const DType* data, const DType* weight,
+                                  const LType* label, const IType* sampled, const DType* prob,
+                                  const int dim, const int num_sampled,
+                                  const bool remove_accidental_hits, DType* sampled_logits,
+                                  DType* true_grad, DType* loss) {
+    const index_t y = static_cast<index_t>(label[i]);
+    const DType* x = data + static_cast<index_t>(i) * dim;
+    const DType* w = weight + y * dim;
+    DType z0 = 0;
+    for (int l = 0; l < dim; ++l) z0 += x[l] * w[l];
+    z0 -= math::log(prob[y] > DType(1e-30f) ? prob[y] : DType(1e-30f));
+    DType* z = sampled_logits + static_cast<index_t>(i) * num_sampled;
+    DType m = z0;
+    for (int j = 0; j < num_sampled; ++j) {
+      const index_t c = static_cast<index_t>(sampled[j]);
+      if (remove_accidental_hits && c == y) {
+        // masked below, the true class is always part of the softmax
+        z[j] = z0;
+        continue;
+      }
+      z[j] -= math::log(prob[c] > DType(1e-30f) ? prob[c] : DType(1e-30f));
+      if (z[j] > m) m = z[j];
+    }
+    DType sum = math::exp(z0 - m);
+    for (int j = 0; j < num_sampled; ++j) {
+      if (remove_accidental_hits && static_cast<index_t>(sampled[j]) == y) continue;
+      sum += math::exp(z[j] - m);
+    }
+    for (int j = 0; j < num_sampled; ++j) {
+      z[j] = (remove_accidental_hits && static_cast<index_t>(sampled[j]) == y) ?
+             DType(0) : DType(math::exp(z[j] - m) / sum);
+    }
+    const DType p0 = math::exp(z0 - m) / sum;
+    true_grad[i] = p0 - 1;
+    if (loss != nullptr) loss[i] = math::log(sum) + m - z0;
+  }
+};
+
+/*!
+ * \brief scatter the gradient of the rows that were read into the weight gradient,
+ *  one thread per feature, so that repeated classes never race
+ */
+struct SampledWeightGradKernel {
+  template<typename DType, typename IType, typename LType>
+  MSHADOW_XINLINE static void Map(int l, DType* wgrad, const DType* sampled_grad,
+                                  const IType* sampled, const int num_sampled,
+                                  const DType* data, const LType* label, const DType* true_grad,
+                                  const int batch_size, const int dim) {
+    for (int j = 0; j < num_sampled; ++j) {
+      wgrad[static_cast<index_t>(sampled[j]) * dim + l] += sampled_grad[j * dim + l];
+    }
+    for (int i = 0; i < batch_size; ++i) {
+      wgrad[static_cast<index_t>(label[i]) * dim + l] += true_grad[i] * data[i * dim + l];
+    }
+  }
+};
+
+/*! \brief dgrad[i] += true_grad[i] * weight[label[i]], one thread per element */
+struct SampledDataGradKernel {
+  template<typename DType, typename LType>
+  MSHADOW_XINLINE static void Map(int i, DType* dgrad, const DType* weight, const LType* label,
+                                  const DType* true_grad, const int dim) {
+    const int r = i / dim;
+    dgrad[i] += true_grad[r] * weight[static_cast<index_t>(label[r]) * dim + i % dim];
+  }
+};
+
+/*!
+ * \brief the probabilities of the sampled classes in sampled_logits (n, S) and
+ *  p_true - 1 in true_grad (n), computed in the workspace, which starts with
+ *  the gathered sampled rows (S, dim)
+ */
+template<typename xpu, typename DType, typename IType, typename LType>
+inline void SampledSoftmaxProbs(mshadow::Stream<xpu>* s, const SampledSoftmaxParam& param,
+                                const std::vector<TBlob>& inputs,
+                                const mshadow::Tensor<xpu, 2, DType>& sampled_rows,
+                                const mshadow::Tensor<xpu, 2, DType>& sampled_logits,
+                                DType* true_grad, DType* loss) {
+  using namespace mxnet_op;
+  using namespace sampled_softmax;
+  mshadow::Tensor<xpu, 2, DType> data = inputs[kData].FlatTo2D<xpu, DType>(s);
+  const DType* weight = inputs[kWeight].dptr<DType>();
+  const LType* label = inputs[kLabel].dptr<LType>();
+  const IType* sampled = inputs[kSampled].dptr<IType>();
+  const int dim = data.size(1);
+  const int num_sampled = sampled_rows.size(0);
+  Kernel<SampledRowsKernel, xpu>::Launch(s, sampled_rows.shape_.Size(), sampled_rows.dptr_,
+                                         weight, sampled, dim);
+  linalg_gemm(data, sampled_rows, sampled_logits, false, true, s);
+  Kernel<SampledSoftmaxRowKernel, xpu>::Launch(
+    s, data.size(0), data.dptr_, weight, label, sampled, inputs[kProb].dptr<DType>(), dim,
+    num_sampled, param.remove_accidental_hits, sampled_logits.dptr_, true_grad, loss);
+}
+
+template<typename xpu>
+void SampledSoftmaxForward(const nnvm::NodeAttrs& attrs,
+                           const OpContext& ctx,
+                           const std::vector<TBlob>& inputs,
+                           const std::vector<OpReqType>& req,
+                           const std::vector<TBlob>& outputs) {
+  using namespace mshadow;
+  using namespace mshadow::expr;
+  using namespace sampled_softmax;
+  const SampledSoftmaxParam& param = nnvm::get<SampledSoftmaxParam>(attrs.parsed);
+  Stream<xpu> *s = ctx.get_stream<xpu>();
+  const index_t n = inputs[kData].shape_[0];
+  const index_t dim = inputs[kData].shape_[1];
+  const index_t num_sampled = inputs[kSampled].Size();
+  MSHADOW_SGL_DBL_TYPE_SWITCH(outputs[0].type_flag_, DType, {
+    MSHADOW_TYPE_SWITCH(inputs[kSampled].type_flag_, IType, {
+      MSHADOW_TYPE_SWITCH(inputs[kLabel].type_flag_, LType, {
+        Tensor<xpu, 1, DType> workspace = ctx.requested[0].get_space_typed<xpu, 1, DType>(
+            Shape1(num_sampled * dim + n * num_sampled + 2 * n), s);
+        Tensor<xpu, 2, DType> sampled_rows(workspace.dptr_, Shape2(num_sampled, dim), s);
+        Tensor<xpu, 2, DType> sampled_logits(sampled_rows.dptr_ + sampled_rows.shape_.Size(),
+                                             Shape2(n, num_sampled), s);
+        DType* true_grad = sampled_logits.dptr_ + sampled_logits.shape_.Size();
+        Tensor<xpu, 2, DType> loss(true_grad + n, Shape2(1, n), s);
+        SampledSoftmaxProbs<xpu, DType, IType, LType>(s, param, inputs, sampled_rows,
+                                                      sampled_logits, true_grad, loss.dptr_);
+        Tensor<xpu, 1, DType> out = outputs[0].get<xpu, 1, DType>(s);
+        ASSIGN_DISPATCH(out, req[0], sumall_except_dim<0>(loss));
+      });
+    });
+  });
+}
+
+/*!
+ * inputs: [ograd, data, weight, label, sampled, prob]
+ * outputs: [data_grad, weight_grad, label_grad, sampled_grad, prob_grad]
+ */
+template<typename xpu>
+void SampledSoftmaxBackward(const nnvm::NodeAttrs& attrs,
+                            const OpContext& ctx,
+                            const std::vector<TBlob>& inputs,
+                            const std::vector<OpReqType>& req,
+                            const std::vector<TBlob>& outputs) {
+  using namespace mshadow;
+  using namespace mshadow::expr;
+  using namespace mxnet_op;
+  using namespace sampled_softmax;
+  CHECK_EQ(inputs.size(), 6U);
+  CHECK_EQ(outputs.size(), 5U);
+  const SampledSoftmaxParam& param = nnvm::get<SampledSoftmaxParam>(attrs.parsed);
+  Stream<xpu> *s = ctx.get_stream<xpu>();
+  const std::vector<TBlob> in_data(inputs.begin() + 1, inputs.end());
+  const index_t n = in_data[kData].shape_[0];
+  const index_t dim = in_data[kData].shape_[1];
+  const index_t num_sampled = in_data[kSampled].Size();
+  for (int k : {kLabel, kSampled, kProb}) {
+    CHECK_NE(req[k], kAddTo) << "sampled_softmax_cross_entropy: no gradient for class ids "
+                             << "and probabilities";
+    if (req[k] != kNullOp) {
+      MSHADOW_TYPE_SWITCH(outputs[k].type_flag_, DType, {
+        Kernel<set_zero, xpu>::Launch(s, outputs[k].Size(), outputs[k].dptr<DType>());
+      });
+    }
+  }
+  MSHADOW_SGL_DBL_TYPE_SWITCH(in_data[kData].type_flag_, DType, {
+    MSHADOW_TYPE_SWITCH(in_data[kSampled].type_flag_, IType, {
+      MSHADOW_TYPE_SWITCH(in_data[kLabel].type_flag_, LType, {
+        Tensor<xpu, 1, DType> workspace = ctx.requested[0].get_space_typed<xpu, 1, DType>(
+            Shape1(2 * num_sampled * dim + n * num_sampled + n), s);
+        Tensor<xpu, 2, DType> sampled_rows(workspace.dptr_, Shape2(num_sampled, dim), s);
+        Tensor<xpu, 2, DType> sampled_grad(sampled_rows.dptr_ + sampled_rows.shape_.Size(),
+                                           Shape2(num_sampled, dim), s);
+        Tensor<xpu, 2, DType> sampled_probs(sampled_grad.dptr_ + sampled_grad.shape_.Size(),
+                                            Shape2(n, num_sampled), s);
+        Tensor<xpu, 1, DType> true_grad(sampled_probs.dptr_ + sampled_probs.shape_.Size(),
+                                        Shape1(n), s);
+        SampledSoftmaxProbs<xpu, DType, IType, LType>(s, param, in_data, sampled_rows,
+                                                      sampled_probs, true_grad.dptr_, nullptr);
+        // scale by the gradient of the summed loss
+        Tensor<xpu, 1, DType> ograd = inputs[0].get_with_shape<xpu, 1, DType>(Shape1(1), s);
+        sampled_probs *= broadcast_scalar(ograd, sampled_probs.shape_);
+        true_grad *= broadcast_scalar(ograd, true_grad.shape_);
+
+        Tensor<xpu, 2, DType> data = in_data[kData].FlatTo2D<xpu, DType>(s);
+        const LType* label = in_data[kLabel].dptr<LType>();
+        const DType* weight = in_data[kWeight].dptr<DType>();
+        if (req[kData] != kNullOp) {
+          Tensor<xpu, 2, DType> dgrad = outputs[kData].FlatTo2D<xpu, DType>(s);
+          linalg_gemm(sampled_probs, sampled_rows, dgrad, false, false, s, req[kData]);
+          Kernel<SampledDataGradKernel, xpu>::Launch(s, dgrad.shape_.Size(), dgrad.dptr_,
+                                                     weight, label, true_grad.dptr_,
+                                                     static_cast<int>(dim));
+        }
+        if (req[kWeight] != kNullOp) {
+          Tensor<xpu, 2, DType> wgrad = outputs[kWeight].FlatTo2D<xpu, DType>(s);
+          if (req[kWeight] != kAddTo) wgrad = scalar<DType>(0);
+          linalg_gemm(sampled_probs, data, sampled_grad, true, false, s);
+          Kernel<SampledWeightGradKernel, xpu>::Launch(
+            s, dim, wgrad.dptr_, sampled_grad.dptr_, in_data[kSampled].dptr<IType>(),
+            static_cast<int>(num_sampled), data.dptr_, label, true_grad.dptr_,
+            static_cast<int>(n), static_cast<int>(dim));
+        }
+      });
+    });
+  });
+}
+
+}  // namespace op
+}  // namespace mxnet
+
+#endif  // MXNET_OPERATOR_CONTRIB_SAMPLED_SOFTMAX_INL_H_
@@ -0,0 +1,85 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file sampled_softmax.cc
+ * \brief CPU implementation of sampled softmax cross entropy
+ */
+#include "./sampled_softmax-inl.h"
+
+namespace mxnet {
+namespace op {
+
+DMLC_REGISTER_PARAMETER(SampledSoftmaxParam);
+
+NNVM_REGISTER_OP(_contrib_sampled_softmax_cross_entropy)
+.describe(R"code(Computes the softmax cross entropy of a fully connected layer
+over the true class and a set of sampled classes shared by the batch.
+
+The logit of class :math:`c` for sample :math:`i` is :math:`x_i \cdot w_c - \log q_c`,
+where :math:`q` is the distribution ``sampled`` was drawn from, and the loss is
+the cross entropy of the softmax over the true class and the sampled ones,
+summed over the batch. Only the rows of ``weight`` of these classes are read,
+so the cost scales with ``num_sampled`` instead of ``num_classes``.
+
+Example::
+
+  prob = mx.nd.ones((num_classes,)) / num_classes
+  sampled = mx.nd.random.multinomial(prob, shape=(num_sampled,))
+  loss = mx.nd.contrib.sampled_softmax_cross_entropy(x, weight, label, sampled, prob)
+
+)code" ADD_FILELINE)
+.set_attr_parser(ParamParser<SampledSoftmaxParam>)
+.set_num_inputs(5)
+.set_num_outputs(1)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    return std::vector<std::string>{"data", "weight", "label", "sampled", "prob"};
+  })
+.set_attr<nnvm::FInferShape>("FInferShape", SampledSoftmaxShape)
+.set_attr<nnvm::FInferType>("FInferType", SampledSoftmaxType)
+.set_attr<FResourceRequest>("FResourceRequest",
+  [](const NodeAttrs& attrs) {
+    return std::vector<ResourceRequest>{ResourceRequest::kTempSpace};
+  })
+.set_attr<FCompute>("FCompute<cpu>", SampledSoftmaxForward<cpu>)
+.set_attr<nnvm::FGradient>("FGradient",
+  ElemwiseGradUseIn{"_contrib_backward_sampled_softmax_cross_entropy"})
+.add_argument("data", "NDArray-or-Symbol", "Input features of shape (batch_size, feature_dim)")
+.add_argument("weight", "NDArray-or-Symbol", "Class weights of shape (num_classes, feature_dim)")
+.add_argument("label", "NDArray-or-Symbol", "True class of every sample")
+.add_argument("sampled", "NDArray-or-Symbol", "Sampled class ids of shape (num_sampled,)")
+.add_argument("prob", "NDArray-or-Symbol",
+              "Probability of every class under the sampling distribution")
+.add_arguments(SampledSoftmaxParam::__FIELDS__());
+
+NNVM_REGISTER_OP(_contrib_backward_sampled_softmax_cross_entropy)
+.set_attr_parser(ParamParser<SampledSoftmaxParam>)
+.set_num_inputs(6)
+.set_num_outputs(5)
+.set_attr<nnvm::TIsBackward>("TIsBackward", true)
+.set_attr<FResourceRequest>("FResourceRequest",
+  [](const NodeAttrs& attrs) {
+    return std::vector<ResourceRequest>{ResourceRequest::kTempSpace};
+  })
+.set_attr<FCompute>("FCompute<cpu>", SampledSoftmaxBackward<cpu>);
+
+}  // namespace op
+}  // namespace mxnet
@@ -35,20 +35,22 @@
 #include <vector>
 #include <utility>
 #include "../operator_common.h"
+#include "../mxnet_op.h"
+#include "../row_stats.h"
 
 namespace mxnet {
 namespace op {
 
 namespace sigmoid_ce {
 enum SigmoidCrossEntropyOpInputs {kData, kLabel};
-enum SigmoidCrossEntropyOpOutputs {kOut, kLoss, kLossSum, kCount, kCountSum};
+enum SigmoidCrossEntropyOpOutputs {kOut, kCount};
 enum SigmoidCrossEntropyNormType {kNull, kValid};
-enum SigmoidCrossEntropyOpResource {kTempSpace};
 }  // namespace sigmoid_ce
 
 struct SigmoidCrossEntropyParam : public dmlc::Parameter<SigmoidCrossEntropyParam> {
   float grad_scale;
   int normalization;
+  float ignore_label;
   DMLC_DECLARE_PARAMETER(SigmoidCrossEntropyParam) {
     DMLC_DECLARE_FIELD(grad_scale).set_default(1.0f)
     .describe("Scales the gradient by a float factor.");
@@ -57,9 +59,60 @@ struct SigmoidCrossEntropyParam : public dmlc::Parameter<SigmoidCrossEntropyPara
     .add_enum("valid", sigmoid_ce::kValid)
     .set_default(sigmoid_ce::kValid)
     .describe("Normalizes the gradient.");
+    DMLC_DECLARE_FIELD(ignore_label).set_default(-1.0f)
+    .describe("Targets equal to this value are masked out of the loss and the gradient.");
   };
 };
 
+/*! \brief added to the number of valid targets of a row before it divides */
+const float kSigmoidCEMinCount = 1e-5f;
+
+/*! \brief binary cross entropy of sigmoid(x) against target t, without overflow */
+template<typename AType>
+MSHADOW_XINLINE AType SigmoidCrossEntropyLoss(const AType x, const AType t) {
+  const AType neg_abs = x >= 0 ? -x : x;
+  return (x >= 0 ? x : AType(0)) - x * t + math::log1p(math::exp(neg_abs));
+}
+
+/*!
+ * \brief gradient of element i of a (n, k) input, recomputed from data and
+ *  label with the valid count of its row, so no probabilities are kept
+ */
+template<int req>
+struct sigmoid_ce_backward {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, DType* d_data, const DType* data, const DType* label,
+                                  const DType* count, const int k, const float ignore_label,
+                                  const float scale, const bool normalize) {
+    typedef typename row_stats::AccType<DType>::type AType;
+    const AType t = label[i];
+    if (t == static_cast<AType>(ignore_label)) {
+      KERNEL_ASSIGN(d_data[i], req, DType(0));
+      return;
+    }
+    const AType x = data[i];
+    const AType e = math::exp(x >= 0 ? -x : x);
+    const AType prob = x >= 0 ? AType(1) / (1 + e) : e / (1 + e);
+    const AType norm = normalize ?
+      static_cast<AType>(count[i / k]) + static_cast<AType>(kSigmoidCEMinCount) : AType(1);
+    KERNEL_ASSIGN(d_data[i], req, DType((prob - t) * static_cast<AType>(scale) / norm));
+  }
+};
+
+/*!
+ * \brief loss of every row of a (n, k) input and its number of valid targets,
+ *  in one pass without keeping per element losses
+ */
+template<typename DType>
+void SigmoidCrossEntropyForward(mshadow::Stream<cpu>* s, const int n, const int k,
+                                const DType* data, const DType* label, DType* out,
+                                DType* count, const float ignore_label, const bool normalize);
+
+template<typename DType>
+void SigmoidCrossEntropyForward(mshadow::Stream<gpu>* s, const int n, const int k,
+                                const DType* data, const DType* label, DType* out,
+                                DType* count, const float ignore_label, const bool normalize);
+
 template<typename xpu, typename T>
 class SigmoidCrossEntropyOp : public Operator {
  public:
@@ -71,24 +124,17 @@ class SigmoidCrossEntropyOp : public Operator {
                        const std::vector<TBlob> &out_data,
                        const std::vector<TBlob> &aux_args) {
     using namespace mshadow;
-    using namespace mshadow::expr;
-    using std::cout;
     CHECK_EQ(in_data.size(), 2U) << "SigmoidCrossEntropy Input: [data, label]";
-    CHECK_EQ(out_data.size(), 5U) << "SigmoidCrossEntropy Output: [output, loss, loss_sum, count, count_sum]";
+    CHECK_EQ(out_data.size(), 2U) << "SigmoidCrossEntropy Output: [output, count]";
     Stream<xpu> *s = ctx.get_stream<xpu>();
 
     int n = in_data[sigmoid_ce::kData].shape_[0];
     int k = in_data[sigmoid_ce::kData].shape_.Size() / n;
-    Shape<2> s2 = Shape2(n, k);
-    Tensor<xpu, 2, T> data = in_data[sigmoid_ce::kData].get_with_shape<xpu, 2, T>(s2, s);
-    Tensor<xpu, 2, T> label = in_data[sigmoid_ce::kLabel].get_with_shape<xpu, 2, T>(s2, s);
-    Tensor<xpu, 1, T> out = out_data[sigmoid_ce::kOut].FlatTo1D<xpu, T>(s);
-    Tensor<xpu, 2, T> loss = out_data[sigmoid_ce::kLoss].get_with_shape<xpu, 2, T>(s2, s);
-    Tensor<xpu, 1, T> loss_sum = out_data[sigmoid_ce::kLossSum].FlatTo1D<xpu, T>(s);
-    Tensor<xpu, 2, T> count = out_data[sigmoid_ce::kCount].get_with_shape<xpu, 2, T>(s2, s);
-    Tensor<xpu, 1, T> count_sum = out_data[sigmoid_ce::kCountSum].FlatTo1D<xpu, T>(s);
-
-    SigmoidCrossEntropyForward(data, label, loss, loss_sum, count, count_sum, out, static_cast<T>(param_.grad_scale));
+    SigmoidCrossEntropyForward(s, n, k, in_data[sigmoid_ce::kData].dptr<T>(),
+                               in_data[sigmoid_ce::kLabel].dptr<T>(),
+                               out_data[sigmoid_ce::kOut].dptr<T>(),
+                               out_data[sigmoid_ce::kCount].dptr<T>(), param_.ignore_label,
+                               param_.normalization == sigmoid_ce::kValid);
   }
 
   virtual void Backward(const OpContext &ctx,
@@ -99,23 +145,20 @@ class SigmoidCrossEntropyOp : public Operator {
                         const std::vector<TBlob> &in_grad,
                         const std::vector<TBlob> &aux_args) {
     using namespace mshadow;
-    using namespace mshadow::expr;
-    CHECK_EQ(in_data.size(), 2U); // [data, label]
-    CHECK_EQ(out_data.size(), 5U); // [out]
-    CHECK_GE(in_grad.size(), 1U); // [d_data]
-    CHECK_GE(req.size(), 1U); // [req_data]
+    CHECK_EQ(in_data.size(), 2U);  // [data, label]
+    CHECK_EQ(out_data.size(), 2U);  // [out, count]
+    CHECK_GE(in_grad.size(), 1U);  // [d_data]
+    CHECK_GE(req.size(), 1U);  // [req_data]
     Stream<xpu> *s = ctx.get_stream<xpu>();
 
     int n = in_data[sigmoid_ce::kData].shape_[0];
     int k = in_data[sigmoid_ce::kData].shape_.Size() / n;
-    Shape<2> s2 = Shape2(n, k);
-    Tensor<xpu, 2, T> data = in_data[sigmoid_ce::kData].get_with_shape<xpu, 2, T>(s2, s);
-    Tensor<xpu, 2, T> label = in_data[sigmoid_ce::kLabel].get_with_shape<xpu, 2, T>(s2, s);
-    Tensor<xpu, 2, T> count = out_data[sigmoid_ce::kCount].get_with_shape<xpu, 2, T>(s2, s);
-    Tensor<xpu, 1, T> count_sum = out_data[sigmoid_ce::kCountSum].FlatTo1D<xpu, T>(s);
-    Tensor<xpu, 2, T> d_data = in_grad[sigmoid_ce::kData].get_with_shape<xpu, 2, T>(s2, s);
-
-    SigmoidCrossEntropyBackward(data, label, d_data, count, count_sum, static_cast<T>(param_.grad_scale));
+    MXNET_ASSIGN_REQ_SWITCH(req[sigmoid_ce::kData], Req, {
+      mxnet_op::Kernel<sigmoid_ce_backward<Req>, xpu>::Launch(
+        s, n * k, in_grad[sigmoid_ce::kData].dptr<T>(), in_data[sigmoid_ce::kData].dptr<T>(),
+        in_data[sigmoid_ce::kLabel].dptr<T>(), out_data[sigmoid_ce::kCount].dptr<T>(), k,
+        param_.ignore_label, param_.grad_scale, param_.normalization == sigmoid_ce::kValid);
+    });
   }
 
  private:
@@ -134,7 +177,7 @@ class SigmoidCrossEntropyProp : public OperatorProperty {
   }
 
   std::vector<std::string> ListOutputs() const {
-    return {"output", "loss", "loss_sum", "count", "count_sum"};
+    return {"output", "count"};
   }
 
   int NumVisibleOutputs() const {
@@ -163,11 +206,8 @@ class SigmoidCrossEntropyProp : public OperatorProperty {
     TShape oshape = Shape1(dshape[0]);
     
     out_shape->clear();
-    out_shape->push_back(oshape); // out shape
-    out_shape->push_back(dshape); // loss shape
-    out_shape->push_back(oshape); // loss_sum shape
-    out_shape->push_back(dshape); // count shape
-    out_shape->push_back(oshape); // count_sum shape
+    out_shape->push_back(oshape);  // out shape
+    out_shape->push_back(oshape);  // count shape
     return true;
   }
 
@@ -181,9 +221,6 @@ class SigmoidCrossEntropyProp : public OperatorProperty {
     out_type->clear();
     out_type->push_back(dtype);
     out_type->push_back(dtype);
-    out_type->push_back(dtype);
-    out_type->push_back(dtype);
-    out_type->push_back(dtype);
     return true;
   }
 
@@ -201,8 +238,8 @@ class SigmoidCrossEntropyProp : public OperatorProperty {
     const std::vector<int> &out_grad,
     const std::vector<int> &in_data,
     const std::vector<int> &out_data) const override {
-    return {in_data[sigmoid_ce::kData], in_data[sigmoid_ce::kLabel], 
-            out_data[sigmoid_ce::kCount], out_data[sigmoid_ce::kCountSum]};
+    return {in_data[sigmoid_ce::kData], in_data[sigmoid_ce::kLabel],
+            out_data[sigmoid_ce::kCount]};
   }
 
   Operator* CreateOperator(Context ctx) const override {
@@ -26,34 +26,31 @@
 
 #include "./sigmoid_cross_entropy-inl.h"
 
-namespace mshadow {
-
-template<typename T>
-inline void SigmoidCrossEntropyForward(const Tensor<cpu, 2, T> &data,
-                                       const Tensor<cpu, 2, T> &label,
-                                       Tensor<cpu, 2, T> &loss,
-                                       Tensor<cpu, 1, T> &loss_sum,
-                                       Tensor<cpu, 2, T> &count,
-                                       Tensor<cpu, 1, T> &count_sum,
-                                       Tensor<cpu, 1, T> &out,
-                                       T scale) {
-  LOG(FATAL) << "NotImplemented";
-}
-
-template<typename T>
-inline void SigmoidCrossEntropyBackward(const Tensor<cpu, 2, T> &data,
-                                        const Tensor<cpu, 2, T> &label,
-                                        Tensor<cpu, 2, T> &d_data,
-                                        Tensor<cpu, 2, T> &count,
-                                        Tensor<cpu, 1, T> &count_sum,
-                                        T scale) {
-  LOG(FATAL) << "NotImplemented";
-}
+namespace mxnet {
+namespace op {
 
+template<typename DType>
+void SigmoidCrossEntropyForward(mshadow::Stream<cpu>* s, const int n, const int k,
+                                const DType* data, const DType* label, DType* out,
+                                DType* count, const float ignore_label, const bool normalize) {
+  typedef typename row_stats::AccType<DType>::type AType;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int r = 0; r < n; ++r) {
+    const DType* x = data + static_cast<size_t>(r) * k;
+    const DType* t = label + static_cast<size_t>(r) * k;
+    AType loss = 0, valid = 0;
+    for (int j = 0; j < k; ++j) {
+      const AType tj = t[j];
+      if (tj == static_cast<AType>(ignore_label)) continue;
+      loss += SigmoidCrossEntropyLoss(static_cast<AType>(x[j]), tj);
+      valid += 1;
+    }
+    out[r] = DType(normalize ? loss / (valid + static_cast<AType>(kSigmoidCEMinCount)) : loss);
+    count[r] = DType(valid);
+  }
 }
 
-namespace mxnet {
-namespace op {
 template<>
 Operator *CreateOp<cpu>(SigmoidCrossEntropyParam param, int dtype) {
   Operator *op = NULL;
@@ -74,14 +71,16 @@ DMLC_REGISTER_PARAMETER(SigmoidCrossEntropyParam);
 MXNET_REGISTER_OP_PROPERTY(_contrib_SigmoidCrossEntropy, SigmoidCrossEntropyProp)
 .describe(R"DOC(
 Compute sigmoid activations followed by averaged binary cross entropy loss. The
-target values may be in {-1, 0, 1}, where -1 indicates that the corresponding
-sample should be ignored and {0, 1} correspond to the binary classes 0 and 1. By
-default the loss is divided by the number of targets > -1 and then multiplied by
-the `grad_scale` op argument. The divisive normalization may be disable by setting
-the op argument `normalize` to 0 (the multiplication by `scale` still takes
-effect).
+target values may be in {0, 1} for the binary classes, or `ignore_label` (-1 by
+default) for targets that should be ignored. By default the loss of each sample
+is divided by its number of targets that are not ignored, and the gradient is
+then multiplied by the `grad_scale` op argument. The divisive normalization may
+be disabled by setting `normalization` to "null" (the multiplication by
+`grad_scale` still takes effect).
 This op fuses sigmoid and cross entropy for numerical stability in both forward
-and gradient computation.
+and gradient computation. The forward pass reduces each sample to its loss and
+count in one pass, and the backward pass recomputes the sigmoid from the data,
+so neither keeps a tensor of per element losses or probabilities.
 )DOC" ADD_FILELINE)
 .add_argument("data", "NDArray-or-Symbol", "Input array.")
 .add_argument("label", "NDArray-or-Symbol", "Ground truth label.")
@@ -26,130 +26,62 @@
 
 #include "./sigmoid_cross_entropy-inl.h"
 
-#define CUDA_1D_KERNEL_LOOP(i, n)                               \
-for (size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < (n); \
-     i += blockDim.x * gridDim.x)
-
-constexpr int CAFFE_CUDA_NUM_THREADS = 512;
-constexpr int CAFFE_MAXIMUM_NUM_BLOCKS = 4096;
-
-inline int CAFFE_GET_BLOCKS(const int N) {
-  return std::min((N + CAFFE_CUDA_NUM_THREADS - 1) / CAFFE_CUDA_NUM_THREADS,
-                  CAFFE_MAXIMUM_NUM_BLOCKS);
-}
-
-namespace mshadow {
-namespace cuda {
+namespace mxnet {
+namespace op {
 
-template<typename T>
-__global__ void SigmoidCrossEntropyLossKernel(
-    const int n,
-    const T* logits,
-    const T* targets,
-    T* losses,
-    T* counts) {
-  CUDA_1D_KERNEL_LOOP(index, n) {
-    if (targets[index] == -1) {
-      losses[index] = 0.;
-      counts[index] = 0.;
-    } else {
-      losses[index] =
-          -1. * logits[index] * (targets[index] - (logits[index] >= 0)) +
-          logf(
-              1 +
-              expf(logits[index] - 2 * logits[index] * (logits[index] >= 0)));
-      counts[index] = 1.;
+/*! \brief one block reduces the loss and valid count of a row at a time */
+template<typename DType>
+__global__ void SigmoidCrossEntropyForwardKernel(const int n, const int k, const DType* data,
+                                                 const DType* label, DType* out, DType* count,
+                                                 const float ignore_label, const bool normalize) {
+  typedef typename row_stats::AccType<DType>::type AType;
+  __shared__ AType s_loss[mshadow::cuda::kBaseThreadNum];
+  __shared__ AType s_valid[mshadow::cuda::kBaseThreadNum];
+  for (int r = blockIdx.x; r < n; r += gridDim.x) {
+    const DType* x = data + static_cast<size_t>(r) * k;
+    const DType* t = label + static_cast<size_t>(r) * k;
+    AType loss = 0, valid = 0;
+    for (int j = threadIdx.x; j < k; j += blockDim.x) {
+      const AType tj = t[j];
+      if (tj != static_cast<AType>(ignore_label)) {
+        loss += SigmoidCrossEntropyLoss(static_cast<AType>(x[j]), tj);
+        valid += 1;
+      }
     }
-  }
-}
-
-template<typename T>
-__global__ void SigmoidCrossEntropyLossGradientKernel(
-    const int n,
-    const T* logits,
-    const T* targets,
-    T* d_logits,
-    T* counts) {
-  CUDA_1D_KERNEL_LOOP(index, n) {
-    if (targets[index] == -1) {
-      d_logits[index] = 0.;
-      counts[index] = 0.;
-    } else {
-      d_logits[index] = 1. / (1. + expf(-logits[index])) - targets[index];
-      counts[index] = 1.;
+    s_loss[threadIdx.x] = loss;
+    s_valid[threadIdx.x] = valid;
+    __syncthreads();
+    for (int offset = blockDim.x / 2; offset > 0; offset >>= 1) {
+      if (threadIdx.x < offset) {
+        s_loss[threadIdx.x] += s_loss[threadIdx.x + offset];
+        s_valid[threadIdx.x] += s_valid[threadIdx.x + offset];
+      }
+      __syncthreads();
     }
+    if (threadIdx.x == 0) {
+      const AType sum = s_loss[0];
+      out[r] = DType(normalize ? sum / (s_valid[0] + static_cast<AType>(kSigmoidCEMinCount))
+                               : sum);
+      count[r] = DType(s_valid[0]);
+    }
+    __syncthreads();
   }
 }
 
-template<typename T>
-inline void SigmoidCrossEntropyForward(const Tensor<gpu, 2, T> &data,
-                                       const Tensor<gpu, 2, T> &label,
-                                       Tensor<gpu, 2, T> &loss,
-                                       Tensor<gpu, 1, T> &loss_sum,
-                                       Tensor<gpu, 2, T> &count,
-                                       Tensor<gpu, 1, T> &count_sum,
-                                       Tensor<gpu, 1, T> &out,
-                                       T scale) {
-  using namespace mshadow::expr;
-  SigmoidCrossEntropyLossKernel<<<CAFFE_GET_BLOCKS(data.shape_.Size()), CAFFE_CUDA_NUM_THREADS, 0>>>(
-    data.shape_.Size(), data.dptr_, label.dptr_, loss.dptr_, count.dptr_);
-  loss_sum = sumall_except_dim<0>(loss);
-  count_sum = sumall_except_dim<0>(count);
-  count_sum += static_cast<T>(1e-5);
-  out = loss_sum / count_sum;
-  int count_num = (count.size(0) * count.size(1));
-  //out /= static_cast<T>(count_num);
-  // mx.metric.Loss will take care of this
-  // out *= scale; 
+template<typename DType>
+void SigmoidCrossEntropyForward(mshadow::Stream<gpu>* s, const int n, const int k,
+                                const DType* data, const DType* label, DType* out,
+                                DType* count, const float ignore_label, const bool normalize) {
+  using namespace mshadow::cuda;
+  // the tree reduction needs a power of two, short rows do not need a full block
+  int threads = kWarpSize;
+  while (threads < kBaseThreadNum && threads < k) threads *= 2;
+  const int blocks = std::max(1, std::min(n, kMaxGridNum));
+  SigmoidCrossEntropyForwardKernel<<<blocks, threads, 0, mshadow::Stream<gpu>::GetStream(s)>>>(
+    n, k, data, label, out, count, ignore_label, normalize);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(SigmoidCrossEntropyForwardKernel);
 }
 
-template<typename T>
-inline void SigmoidCrossEntropyBackward(const Tensor<gpu, 2, T> &data,
-                                        const Tensor<gpu, 2, T> &label,
-                                        Tensor<gpu, 2, T> &d_data,
-                                        Tensor<gpu, 2, T> &count,
-                                        Tensor<gpu, 1, T> &count_sum,
-                                        T scale) {
-  using namespace mshadow::expr;
-  SigmoidCrossEntropyLossGradientKernel<<<CAFFE_GET_BLOCKS(data.shape_.Size()), CAFFE_CUDA_NUM_THREADS, 0>>>(
-    data.shape_.Size(), data.dptr_, label.dptr_, d_data.dptr_, count.dptr_);
-  count_sum = sumall_except_dim<0>(count);
-  count_sum += static_cast<T>(1e-5);
-  d_data /= broadcast<0>(count_sum, d_data.shape_);
-  int count_num = (count.size(0) * count.size(1));
-  //d_data /= static_cast<T>(count_num);
-  d_data *= scale;
-}
-
-} // namespace cuda
-
-template<typename T>
-inline void SigmoidCrossEntropyForward(const Tensor<gpu, 2, T> &data,
-                                       const Tensor<gpu, 2, T> &label,
-                                       Tensor<gpu, 2, T> &loss,
-                                       Tensor<gpu, 1, T> &loss_sum,
-                                       Tensor<gpu, 2, T> &count,
-                                       Tensor<gpu, 1, T> &count_sum,
-                                       Tensor<gpu, 1, T> &out,
-                                       T scale) {
-  cuda::SigmoidCrossEntropyForward(data, label, loss, loss_sum, count, count_sum, out, scale);
-}
-
-template<typename T>
-inline void SigmoidCrossEntropyBackward(const Tensor<gpu, 2, T> &data,
-                                        const Tensor<gpu, 2, T> &label,
-                                        Tensor<gpu, 2, T> &d_data,
-                                        Tensor<gpu, 2, T> &count,
-                                        Tensor<gpu, 1, T> &count_sum,
-                                        T scale) {
-  cuda::SigmoidCrossEntropyBackward(data, label, d_data, count, count_sum, scale);
-}
-
-} // namespace mshadow
-
-namespace mxnet {
-namespace op {
-
 template<>
 Operator *CreateOp<gpu>(SigmoidCrossEntropyParam param, int dtype) {
   Operator *op = NULL;
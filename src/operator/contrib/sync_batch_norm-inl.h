@@ -0,0 +1,433 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file sync_batch_norm-inl.h
+ * \brief batch normalization with the statistics reduced over the devices
+ *        a data-parallel model runs on
+*/
+#ifndef MXNET_OPERATOR_CONTRIB_SYNC_BATCH_NORM_INL_H_
+#define MXNET_OPERATOR_CONTRIB_SYNC_BATCH_NORM_INL_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <mxnet/operator.h>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../operator_common.h"
+#include "../mshadow_op.h"
+
+namespace mxnet {
+namespace op {
+
+namespace syncbatchnorm {
+enum SyncBatchNormOpInputs {kData, kGamma, kBeta};
+enum SyncBatchNormOpOutputs {kOut, kMean, kVar};
+enum SyncBatchNormOpAuxiliary {kMovingMean, kMovingVar};
+enum SyncBatchNormResource {kTempSpace};
+}  // namespace syncbatchnorm
+
+struct SyncBatchNormParam : public dmlc::Parameter<SyncBatchNormParam> {
+  float eps;
+  float momentum;
+  bool fix_gamma;
+  bool use_global_stats;
+  bool output_mean_var;
+  int ndev;
+  std::string key;
+  DMLC_DECLARE_PARAMETER(SyncBatchNormParam) {
+    DMLC_DECLARE_FIELD(eps).set_default(1e-3f)
+    .describe("Epsilon to prevent div 0");
+    DMLC_DECLARE_FIELD(momentum).set_default(0.9f)
+    .describe("Momentum for moving average");
+    DMLC_DECLARE_FIELD(fix_gamma).set_default(true)
+    .describe("Fix gamma while training");
+    DMLC_DECLARE_FIELD(use_global_stats).set_default(false)
+    .describe("Whether use global moving statistics instead of local batch-norm. "
+              "This will force change batch-norm into a scale shift operator.");
+    DMLC_DECLARE_FIELD(output_mean_var).set_default(false)
+    .describe("Output All,normal mean and var");
+    DMLC_DECLARE_FIELD(ndev).set_default(1).set_lower_bound(1)
+    .describe("The number of devices the statistics are synchronized over");
+    DMLC_DECLARE_FIELD(key)
+    .describe("Hash key of the layer, shared by its copies on the different devices "
+              "and unique among the synchronized batch norm layers of the model");
+  }
+};
+
+/*!
+ * \brief rendezvous summing the per-channel statistics of the copies of a layer.
+ *  The copies of a layer run on different devices, so on different engine
+ *  worker threads, and each sends a single host buffer per pass. The last one
+ *  to arrive wakes up the others, which only blocks the workers of this layer.
+ */
+class SyncBatchNormReducer {
+ public:
+  static SyncBatchNormReducer* Get() {
+    static SyncBatchNormReducer inst;
+    return &inst;
+  }
+  /*!
+   * \brief replace buf by its sum over the ndev callers using key
+   * \param key name of the reduction, one per layer and pass
+   * \param ndev number of callers taking part in each reduction
+   * \param buf local values in, reduced values out
+   */
+  void AllReduce(const std::string& key, int ndev, std::vector<real_t>* buf) {
+    if (ndev == 1) return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::unique_ptr<Slot>& ptr = slots_[key];
+    if (ptr == nullptr) ptr.reset(new Slot());
+    Slot* slot = ptr.get();
+    // the callers of the previous round must have read the sum before it is reset
+    slot->cv.wait(lock, [slot]() { return slot->readers == 0; });
+    if (slot->arrived == 0) slot->sum.assign(buf->size(), 0.0f);
+    CHECK_EQ(slot->sum.size(), buf->size())
+      << "SyncBatchNorm: copies of layer " << key << " have a different number of channels";
+    for (size_t i = 0; i < buf->size(); ++i) slot->sum[i] += (*buf)[i];
+    const uint64_t round = slot->round;
+    if (++slot->arrived == ndev) {
+      slot->arrived = 0;
+      slot->readers = ndev;
+      ++slot->round;
+      slot->cv.notify_all();
+    } else {
+      slot->cv.wait(lock, [slot, round]() { return slot->round != round; });
+    }
+    *buf = slot->sum;
+    if (--slot->readers == 0) slot->cv.notify_all();
+  }
+
+ private:
+  struct Slot {
+    std::vector<real_t> sum;
+    int arrived = 0;
+    int readers = 0;
+    uint64_t round = 0;
+    std::condition_variable cv;
+  };
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::unique_ptr<Slot>> slots_;
+};
+
+/*!
+ * \brief sum the 2 x C statistics in stats over the devices, through the host
+ * \return the total number of elements each channel had on the devices
+ */
+template<typename xpu>
+inline real_t SyncBatchNormAllReduce(mshadow::Stream<xpu> *s, const std::string& key,
+                                     int ndev, mshadow::Tensor<xpu, 2> stats, real_t count) {
+  std::vector<real_t> buf(stats.shape_.Size() + 1);
+  mshadow::Tensor<cpu, 2> host(buf.data(), stats.shape_);
+  mshadow::Copy(host, stats, s);
+  // the count is sent along so that devices may have different batch sizes
+  buf.back() = count;
+  s->Wait();
+  SyncBatchNormReducer::Get()->AllReduce(key, ndev, &buf);
+  host.dptr_ = buf.data();
+  mshadow::Copy(stats, host, s);
+  s->Wait();
+  return buf.back();
+}
+
+template<typename xpu>
+class SyncBatchNormOp : public Operator {
+ public:
+  explicit SyncBatchNormOp(SyncBatchNormParam param) {
+    this->param_ = param;
+  }
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_states) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    CHECK_EQ(in_data.size(), 3U);
+    CHECK_EQ(aux_states.size(), 2U);
+    CHECK_EQ(out_data.size(), 3U);
+    CHECK_EQ(req.size(), 3U);
+    CHECK_EQ(req[syncbatchnorm::kOut], kWriteTo);
+
+    Stream<xpu> *s = ctx.get_stream<xpu>();
+    const TShape& dshape = in_data[syncbatchnorm::kData].shape_;
+    Tensor<xpu, 4> data = in_data[syncbatchnorm::kData].get_with_shape<xpu, 4, real_t>(
+        DataShape(dshape), s);
+    Tensor<xpu, 4> out = out_data[syncbatchnorm::kOut].get_with_shape<xpu, 4, real_t>(
+        DataShape(dshape), s);
+    Tensor<xpu, 1> slope = in_data[syncbatchnorm::kGamma].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> bias = in_data[syncbatchnorm::kBeta].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> moving_mean = aux_states[syncbatchnorm::kMovingMean].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> moving_var = aux_states[syncbatchnorm::kMovingVar].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> mean = out_data[syncbatchnorm::kMean].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> var = out_data[syncbatchnorm::kVar].get<xpu, 1, real_t>(s);
+
+    if (param_.fix_gamma) slope = 1.f;
+
+    if (ctx.is_train && !param_.use_global_stats) {
+      // the sums of x and x^2 go out as a single message
+      Tensor<xpu, 2> stats = ctx.requested[syncbatchnorm::kTempSpace].get_space<xpu>(
+          Shape2(2, mean.shape_[0]), s);
+      Tensor<xpu, 1> sum = stats[0];
+      Tensor<xpu, 1> sum_square = stats[1];
+      sum = sumall_except_dim<1>(data);
+      sum_square = sumall_except_dim<1>(F<mshadow_op::square>(data));
+      const real_t count = SyncBatchNormAllReduce(
+          s, param_.key + "_fwd", param_.ndev, stats, data.shape_.Size() / data.size(1));
+      mean = sum / count;
+      var = F<mshadow_op::maximum>(sum_square / count - F<mshadow_op::square>(mean),
+                                   scalar<real_t>(0.0f));
+      Assign(out, req[syncbatchnorm::kOut], broadcast<1>(slope, out.shape_) *
+             (data - broadcast<1>(mean, data.shape_)) /
+             F<mshadow_op::square_root>(broadcast<1>(var + param_.eps, data.shape_)) +
+             broadcast<1>(bias, out.shape_));
+      // every copy computes the same update, so the moving stats stay in sync
+      moving_mean = moving_mean * param_.momentum + mean * (1 - param_.momentum);
+      moving_var = moving_var * param_.momentum + var * (1 - param_.momentum);
+    } else {
+      Assign(out, req[syncbatchnorm::kOut], broadcast<1>(slope /
+                                          F<mshadow_op::square_root>(moving_var + param_.eps),
+                                          data.shape_) * data +
+             broadcast<1>(bias - (slope * moving_mean) /
+                          F<mshadow_op::square_root>(moving_var + param_.eps), data.shape_));
+      mean = F<mshadow_op::identity>(moving_mean);
+      var  = F<mshadow_op::identity>(moving_var);
+    }
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_states) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    CHECK_EQ(out_grad.size(), param_.output_mean_var ? 3U : 1U);
+    CHECK_EQ(in_data.size(), 3U);
+    CHECK_EQ(out_data.size(), 3U);
+    CHECK_EQ(in_grad.size(), 3U);
+    Stream<xpu> *s = ctx.get_stream<xpu>();
+    const TShape& dshape = in_data[syncbatchnorm::kData].shape_;
+    Tensor<xpu, 4> data = in_data[syncbatchnorm::kData].get_with_shape<xpu, 4, real_t>(
+        DataShape(dshape), s);
+    Tensor<xpu, 4> grad = out_grad[syncbatchnorm::kOut].get_with_shape<xpu, 4, real_t>(
+        DataShape(dshape), s);
+    Tensor<xpu, 4> grad_in = in_grad[syncbatchnorm::kData].get_with_shape<xpu, 4, real_t>(
+        DataShape(dshape), s);
+    Tensor<xpu, 1> mean = out_data[syncbatchnorm::kMean].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> var = out_data[syncbatchnorm::kVar].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> slope = in_data[syncbatchnorm::kGamma].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> gslope = in_grad[syncbatchnorm::kGamma].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> gbias = in_grad[syncbatchnorm::kBeta].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> moving_mean = aux_states[syncbatchnorm::kMovingMean].get<xpu, 1, real_t>(s);
+    Tensor<xpu, 1> moving_var = aux_states[syncbatchnorm::kMovingVar].get<xpu, 1, real_t>(s);
+
+    if (param_.fix_gamma) slope = 1.f;
+
+    if (ctx.is_train && !param_.use_global_stats) {
+      Tensor<xpu, 2> stats = ctx.requested[syncbatchnorm::kTempSpace].get_space<xpu>(
+          Shape2(2, mean.shape_[0]), s);
+      Tensor<xpu, 1> sum_grad = stats[0];
+      Tensor<xpu, 1> sum_grad_xmu = stats[1];
+      sum_grad = sumall_except_dim<1>(grad);
+      sum_grad_xmu = sumall_except_dim<1>(grad * (data - broadcast<1>(mean, data.shape_)));
+      // gamma and beta get the local gradients, they are summed with the other
+      // parameter gradients by the kvstore
+      if (!param_.fix_gamma) {
+        Assign(gslope, req[syncbatchnorm::kGamma],
+               sum_grad_xmu / F<mshadow_op::square_root>(var + param_.eps));
+      } else {
+        Assign(gslope, req[syncbatchnorm::kGamma], 0.0f);
+      }
+      Assign(gbias, req[syncbatchnorm::kBeta], F<mshadow_op::identity>(sum_grad));
+      const real_t count = SyncBatchNormAllReduce(
+          s, param_.key + "_bwd", param_.ndev, stats, data.shape_.Size() / data.size(1));
+      sum_grad /= count;
+      sum_grad_xmu /= count * (var + param_.eps);
+      Assign(grad_in, req[syncbatchnorm::kData],
+             broadcast<1>(slope / F<mshadow_op::square_root>(var + param_.eps), data.shape_) *
+             (grad - broadcast<1>(sum_grad, data.shape_) -
+              (data - broadcast<1>(mean, data.shape_)) *
+              broadcast<1>(sum_grad_xmu, data.shape_)));
+    } else {
+      // use global statistics with freeze moving mean and var.
+      if (!param_.fix_gamma) {
+        Assign(gslope, req[syncbatchnorm::kGamma],
+               sumall_except_dim<1>(
+                   grad * (data - broadcast<1>(moving_mean, data.shape_)) /
+                   F<mshadow_op::square_root>(broadcast<1>(moving_var + param_.eps, data.shape_))));
+      } else {
+        Assign(gslope, req[syncbatchnorm::kGamma], 0.0f);
+      }
+      Assign(gbias, req[syncbatchnorm::kBeta], sumall_except_dim<1>(grad));
+      Assign(grad_in, req[syncbatchnorm::kData], (grad * broadcast<1>(slope, data.shape_)) *
+             broadcast<1>(
+                 1.0f / F<mshadow_op::square_root>(moving_var + param_.eps), data.shape_));
+    }
+  }
+
+ private:
+  /*! \brief the data as (batch, channel, rest, 1), whatever its dimension */
+  static mshadow::Shape<4> DataShape(const TShape& dshape) {
+    return mshadow::Shape4(dshape[0], dshape[1], dshape.Size() / (dshape[0] * dshape[1]), 1);
+  }
+
+  SyncBatchNormParam param_;
+};  // class SyncBatchNormOp
+
+template<typename xpu>
+Operator *CreateOp(SyncBatchNormParam param, int dtype);
+
+
+#if DMLC_USE_CXX11
+class SyncBatchNormProp : public OperatorProperty {
+ public:
+  void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
+    param_.Init(kwargs);
+  }
+
+  std::map<std::string, std::string> GetParams() const override {
+    return param_.__DICT__();
+  }
+
+  bool InferShape(std::vector<TShape> *in_shape,
+                  std::vector<TShape> *out_shape,
+                  std::vector<TShape> *aux_shape) const override {
+    using namespace mshadow;
+    CHECK_EQ(in_shape->size(), 3U) << "Input:[data, gamma, beta]";
+    const TShape &dshape = in_shape->at(0);
+    if (dshape.ndim() == 0) return false;
+    CHECK_GE(dshape.ndim(), 2U) << "SyncBatchNorm: data must have a channel axis";
+    in_shape->at(1) = TShape(Shape1(dshape[1]));
+    in_shape->at(2) = TShape(Shape1(dshape[1]));
+    out_shape->clear();
+    out_shape->push_back(dshape);
+    out_shape->push_back(Shape1(dshape[1]));
+    out_shape->push_back(Shape1(dshape[1]));
+
+    aux_shape->clear();
+    aux_shape->push_back(Shape1(dshape[1]));
+    aux_shape->push_back(Shape1(dshape[1]));
+    return true;
+  }
+
+  bool InferType(std::vector<int> *in_type,
+                 std::vector<int> *out_type,
+                 std::vector<int> *aux_type) const override {
+    CHECK_GE(in_type->size(), 1U);
+    const int dtype = (*in_type)[0];
+    CHECK_NE(dtype, -1) << "First input must have specified type";
+    CHECK_EQ(dtype, mshadow::kFloat32) << "SyncBatchNorm only supports float32 input";
+    for (index_t i = 1; i < in_type->size(); ++i) {
+      if ((*in_type)[i] == -1) {
+        (*in_type)[i] = dtype;
+      } else {
+        UNIFORM_TYPE_CHECK((*in_type)[i], dtype, ListArguments()[i]);
+      }
+    }
+    aux_type->assign(this->ListAuxiliaryStates().size(), dtype);
+    out_type->assign(this->ListOutputs().size(), dtype);
+    return true;
+  }
+
+  OperatorProperty* Copy() const override {
+    auto ptr = new SyncBatchNormProp();
+    ptr->param_ = param_;
+    return ptr;
+  }
+
+  std::string TypeString() const override {
+    return "_contrib_SyncBatchNorm";
+  }
+
+  std::vector<int> DeclareBackwardDependency(
+    const std::vector<int> &out_grad,
+    const std::vector<int> &in_data,
+    const std::vector<int> &out_data) const override {
+    return {out_grad[syncbatchnorm::kOut],
+            out_data[syncbatchnorm::kMean],
+            out_data[syncbatchnorm::kVar],
+            in_data[syncbatchnorm::kData],
+            in_data[syncbatchnorm::kGamma]
+           };
+  }
+
+  std::vector<ResourceRequest> ForwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    return {ResourceRequest::kTempSpace};
+  }
+
+  std::vector<ResourceRequest> BackwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    return {ResourceRequest::kTempSpace};
+  }
+
+  int NumVisibleOutputs() const override {
+    if (param_.output_mean_var) {
+      return 3;
+    }
+    return 1;
+  }
+
+  int NumOutputs() const override {
+    return 3;
+  }
+
+  std::vector<std::string> ListArguments() const override {
+    return {"data", "gamma", "beta"};
+  }
+
+  std::vector<std::string> ListOutputs() const override {
+    return {"output", "mean", "var"};
+  }
+
+  std::vector<std::string> ListAuxiliaryStates() const override {
+    return {"moving_mean", "moving_var"};
+  }
+
+  Operator* CreateOperator(Context ctx) const override {
+      LOG(FATAL) << "Not Implemented.";
+      return NULL;
+  }
+
+  Operator* CreateOperatorEx(Context ctx, std::vector<TShape> *in_shape,
+      std::vector<int> *in_type) const override;
+
+  inline const SyncBatchNormParam& getParam() const {
+    return param_;
+  }
+
+ private:
+  SyncBatchNormParam param_;
+};  // class SyncBatchNormProp
+
+#endif  // DMLC_USE_CXX11
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_CONTRIB_SYNC_BATCH_NORM_INL_H_
@@ -0,0 +1,88 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file sync_batch_norm.cc
+ * \brief batch normalization with the statistics reduced over the devices
+*/
+
+#include "./sync_batch_norm-inl.h"
+#include <nnvm/op_attr_types.h>
+
+namespace mxnet {
+namespace op {
+template<>
+Operator *CreateOp<cpu>(SyncBatchNormParam param, int dtype) {
+  return new SyncBatchNormOp<cpu>(param);
+}
+
+// DO_BIND_DISPATCH comes from operator_common.h
+Operator *SyncBatchNormProp::CreateOperatorEx(Context ctx, std::vector<TShape> *in_shape,
+    std::vector<int> *in_type) const {
+    std::vector<TShape> out_shape, aux_shape;
+    std::vector<int> out_type, aux_type;
+    CHECK(InferType(in_type, &out_type, &aux_type));
+    CHECK(InferShape(in_shape, &out_shape, &aux_shape));
+    DO_BIND_DISPATCH(CreateOp, param_, (*in_type)[0]);
+}
+
+DMLC_REGISTER_PARAMETER(SyncBatchNormParam);
+
+MXNET_REGISTER_OP_PROPERTY(_contrib_SyncBatchNorm, SyncBatchNormProp)
+.describe(R"code(Batch normalization with the batch statistics synchronized over devices.
+
+Normalizes a data batch like ``BatchNorm``, with axis 1 as the channel axis,
+except that when training the mean and variance are those of the whole batch
+split over the ``ndev`` devices of a data-parallel model, instead of those of
+the part each device sees. This matters when the batch per device is small,
+as it is for detection and segmentation models.
+
+The copies of the layer on the different devices find each other by ``key``,
+which must be the same for all of them and unique among the synchronized
+layers of the model. Each copy sends one message per pass to the others: the
+per-channel sums of ``data`` and ``data^2`` in forward, and of the output
+gradient and its product with the centered data in backward. ``gamma`` and
+``beta`` get the gradients of the local part of the batch, they are summed
+over the devices by the kvstore like any other parameter.
+
+All the copies must run at the same time, so on CPU contexts set
+``MXNET_CPU_WORKER_NTHREADS`` to at least ``ndev``.
+
+)code" ADD_FILELINE)
+.add_argument("data", "NDArray-or-Symbol", "Input data to batch normalization")
+.add_argument("gamma", "NDArray-or-Symbol", "gamma array")
+.add_argument("beta", "NDArray-or-Symbol", "beta array")
+.add_argument("moving_mean", "NDArray-or-Symbol", "running mean of input")
+.add_argument("moving_var", "NDArray-or-Symbol", "running variance of input")
+.add_arguments(SyncBatchNormParam::__FIELDS__());
+
+NNVM_REGISTER_OP(_contrib_SyncBatchNorm)
+.set_attr<nnvm::FSetInputVarAttrOnCompose>("FSetInputVarAttrOnCompose",
+    [](const nnvm::NodeAttrs& attrs, nnvm::NodePtr var, const int index) {
+      if (var->attrs.dict.find("__init__") != var->attrs.dict.end()) return;
+      if (index == 3) {
+        var->attrs.dict["__init__"] = "[\"zero\", {}]";
+      } else if (index == 4) {
+        var->attrs.dict["__init__"] = "[\"one\", {}]";
+      }
+    });
+
+}  // namespace op
+}  // namespace mxnet
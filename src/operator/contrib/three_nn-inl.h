@@ -10,6 +10,7 @@
 #include <vector>
 #include <utility>
 #include <math.h>
+#include <cstdlib>
 #include <limits>
 #include <mxnet/operator_util.h>
 #include "../mxnet_op.h"
@@ -17,19 +18,20 @@
 #include "../mshadow_op.h"
 #include "../tensor/init_op.h"
 #include "../operator_common.h"
+#include "./point_grid-inl.h"
 
 namespace mxnet {
   typedef std::vector<mxnet::TShape> ShapeVector;
 namespace op {
 
 struct ThreeNNParam : public dmlc::Parameter<ThreeNNParam> {
-//  float radius;
-//  int nsample;
+  float cell_size;
   DMLC_DECLARE_PARAMETER(ThreeNNParam) {
-//    DMLC_DECLARE_FIELD(radius)
-//      .describe("Search radius.");
-//    DMLC_DECLARE_FIELD(nsample)
-//      .describe("Number of samples ball within radius to be returned.");
+    DMLC_DECLARE_FIELD(cell_size).set_default(0.0f)
+      .describe("If positive, index the known points by a hashed grid of cells of this "
+                "edge and search the cells around every query outward until the three "
+                "nearest are found. A cell should hold a few known points. 0 searches "
+                "all known points.");
   }
 };
 
@@ -76,6 +78,93 @@ struct ThreeNNKernel {
   }
 };
 
+/*!
+ * \brief keep the three nearest points seen so far, ordered by distance and
+ *  then index like the search over all points, and each point once
+ */
+MSHADOW_XINLINE void ThreeNNInsert(float* best, int* besti, const float d, const int k) {
+  for (int j = 0; j < 3; ++j) {
+    if (d == best[j] && k == besti[j]) return;
+  }
+  for (int j = 0; j < 3; ++j) {
+    if (d < best[j] || (d == best[j] && k < besti[j])) {
+      for (int l = 2; l > j; --l) {
+        best[l] = best[l - 1];
+        besti[l] = besti[l - 1];
+      }
+      best[j] = d;
+      besti[j] = k;
+      return;
+    }
+  }
+}
+
+struct ThreeNNGridKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const int n, const int m,
+                                  const DType* unknown, const DType* known,
+                                  float* dist, int* idx, const float cell,
+                                  const int table_size, const int* keys, const int* order) {
+    int b = i / n;
+    known += b * m * 3;
+    unknown += i * 3;
+    dist += i * 3;
+    idx += i * 3;
+
+    const float ux = unknown[0];
+    const float uy = unknown[1];
+    const float uz = unknown[2];
+    const int cx = PointGridCoord(ux, cell);
+    const int cy = PointGridCoord(uy, cell);
+    const int cz = PointGridCoord(uz, cell);
+    float best[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                     std::numeric_limits<float>::max()};
+    int besti[3] = {0, 0, 0};
+    // search the shells of cells at distance r around the query. Points
+    // beyond shell r are at least r cells away, and once shells cover more
+    // cells than there are buckets every point is searched instead.
+    int visited = 0;
+    for (int r = 0; ; ++r) {
+      const int shell = r == 0 ? 1 : (2 * r + 1) * (2 * r + 1) * (2 * r + 1) -
+                                     (2 * r - 1) * (2 * r - 1) * (2 * r - 1);
+      if (visited + shell > table_size) {
+        for (int k = 0; k < m; ++k) {
+          float x = known[k * 3 + 0];
+          float y = known[k * 3 + 1];
+          float z = known[k * 3 + 2];
+          ThreeNNInsert(best, besti, (ux - x) * (ux - x) + (uy - y) * (uy - y) +
+                        (uz - z) * (uz - z), k);
+        }
+        break;
+      }
+      visited += shell;
+      for (int dx = -r; dx <= r; ++dx) {
+        for (int dy = -r; dy <= r; ++dy) {
+          for (int dz = -r; dz <= r; ++dz) {
+            if (abs(dx) != r && abs(dy) != r && abs(dz) != r) continue;
+            int begin, end;
+            PointGridRange(keys, b * m, (b + 1) * m,
+                           b * table_size + PointGridHash(cx + dx, cy + dy, cz + dz, table_size),
+                           &begin, &end);
+            for (int p = begin; p < end; ++p) {
+              const int k = order[p];
+              float x = known[k * 3 + 0];
+              float y = known[k * 3 + 1];
+              float z = known[k * 3 + 2];
+              ThreeNNInsert(best, besti, (ux - x) * (ux - x) + (uy - y) * (uy - y) +
+                            (uz - z) * (uz - z), k);
+            }
+          }
+        }
+      }
+      const float bound = r * cell;
+      if (best[2] < bound * bound) break;
+    }
+    dist[0] = sqrt(best[0]); dist[1] = sqrt(best[1]); dist[2] = sqrt(best[2]);
+    idx[0] = besti[0]; idx[1] = besti[1]; idx[2] = besti[2];
+  }
+};
+
 template <typename xpu>
 void ThreeNNForward(const nnvm::NodeAttrs& attrs, const OpContext& ctx,
                          const std::vector<TBlob>& in_data,
@@ -90,7 +179,22 @@ void ThreeNNForward(const nnvm::NodeAttrs& attrs, const OpContext& ctx,
   const int m = in_data[1].size(1); // known
 
   mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
-//  const ThreeNNParam& param = nnvm::get<ThreeNNParam>(attrs.parsed);
+  const ThreeNNParam& param = nnvm::get<ThreeNNParam>(attrs.parsed);
+  if (param.cell_size > 0) {
+    const int table_size = PointGridTableSize(m);
+    mshadow::Tensor<xpu, 1, char> space = ctx.requested[0].get_space_typed<xpu, 1, char>(
+      mshadow::Shape1(PointGridWorkspaceSize<xpu>(batch_size, m)), s);
+    MSHADOW_TYPE_SWITCH(in_data[0].type_flag_, DType, {
+      int *keys, *order;
+      BuildPointGrid(s, in_data[1].dptr<DType>(), batch_size, m, param.cell_size, table_size,
+                     space, &keys, &order);
+      mxnet_op::Kernel<ThreeNNGridKernel, xpu>::Launch(
+        s, batch_size * n, n, m, in_data[0].dptr<DType>(), in_data[1].dptr<DType>(),
+        out_data[0].dptr<float>(), out_data[1].dptr<int>(), param.cell_size, table_size,
+        keys, order);
+    });
+    return;
+  }
   MSHADOW_TYPE_SWITCH(in_data[0].type_flag_, DType, {
      mxnet_op::Kernel<ThreeNNKernel, xpu>::Launch(
        s, batch_size*n, n, m, in_data[0].dptr<DType>(), in_data[1].dptr<DType>(),
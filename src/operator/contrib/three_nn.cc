@@ -57,6 +57,12 @@ NNVM_REGISTER_OP(_contrib_ThreeNN)
   out_type->push_back(mshadow::kInt32);
   return true;
 })
+.set_attr<FResourceRequest>("FResourceRequest", [](const NodeAttrs& attrs) {
+  if (nnvm::get<ThreeNNParam>(attrs.parsed).cell_size <= 0) {
+    return std::vector<ResourceRequest>();
+  }
+  return std::vector<ResourceRequest>{ResourceRequest::kTempSpace};
+})
 .set_attr<FCompute>("FCompute<cpu>", ThreeNNForward<cpu>)
 .set_attr<nnvm::FGradient>("FGradient", MakeZeroGradNodes)
 .add_argument("unknown", "NDArray-or-Symbol", "Query points xyz, 3D tensor")
@@ -41,6 +41,15 @@ namespace op {
 namespace Correlation {
 enum  CorrelationOpInputs{kData1, kData2};
 enum  CorrelationOpOutputs{kOut, kTemp1, kTemp2};
+/*! \brief type the patch comparisons are summed in, float unless the data is double */
+template<typename DType>
+struct AccType {
+  typedef float type;
+};
+template<>
+struct AccType<double> {
+  typedef double type;
+};
 }  //  namespace Correlation
 struct CorrelationParam : public dmlc::Parameter<CorrelationParam> {
   uint32_t max_displacement;
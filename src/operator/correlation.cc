@@ -24,18 +24,34 @@
  * \author Xu Dong
 */
 #include "./correlation-inl.h"
+#include <algorithm>
 #include "./mshadow_op.h"
+#include "../engine/openmp.h"
 
 namespace mshadow {
+/*! \brief channel blocks of the backward pass, contiguous in the padded NHWC copies */
+const int kCorrChannelBlock = 16;
+
 template<typename Dtype>
 void AddPad(const Tensor<cpu, 4, Dtype> &original,
             const Tensor<cpu, 4, Dtype> &out,
-            int pad_size)
-{ for (index_t nbatch = 0 ; nbatch < original.size(0) ; nbatch++)
-  for (index_t channel = 0 ; channel < original.size(1) ; channel++)
-    for (index_t h = 0 ; h < original.size(2) ; h++)
-      for (index_t w = 0 ; w < original.size(3) ; w++)
-         out[nbatch][h+pad_size][w+pad_size][channel] = original[nbatch][channel][h][w];
+            int pad_size) {
+  const int channels = original.size(1);
+  const int height = original.size(2);
+  const int width = original.size(3);
+  const int pwidth = out.size(2);
+  const int nrows = original.size(0) * height;
+  #pragma omp parallel for num_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int row = 0; row < nrows; ++row) {
+    const int nbatch = row / height;
+    const int h = row % height;
+    Dtype *prow = out.dptr_ +
+                  ((nbatch * out.size(1) + h + pad_size) * pwidth + pad_size) * channels;
+    for (int channel = 0; channel < channels; ++channel) {
+      const Dtype *orow = original.dptr_ + ((nbatch * channels + channel) * height + h) * width;
+      for (int w = 0; w < width; ++w) prow[w * channels + channel] = orow[w];
+    }
+  }
 }
 template<typename Dtype>
 inline void CorrelationForward(const Tensor<cpu, 4, Dtype> &out,
@@ -48,37 +64,51 @@ inline void CorrelationForward(const Tensor<cpu, 4, Dtype> &out,
                                int max_displacement_, int kernel_size_,
                                int neighborhood_grid_radius_, int neighborhood_grid_width_,
                                int  kernel_radius_, int stride1_, int stride2_) {
-  const index_t bnum = data1.size(0);
+  const int bnum = data1.size(0);
   const int bchannels = data1.size(1);
   const int sumelems = kernel_size_ * kernel_size_ * bchannels;
   AddPad<Dtype>(data1, tmp1, pad_size_);
-  index_t top_channels_unsigned_ = static_cast<index_t>(top_channels_);
   AddPad<Dtype>(data2, tmp2, pad_size_);
-  for (index_t i = 0 ; i < static_cast<index_t>(top_height_) ; i++)
-      for (index_t j = 0 ; j < static_cast<index_t>(top_width_); j++)
-        for (index_t nbatch = 0 ; nbatch < bnum ; nbatch++) {
-            int x1 = j*stride1_+max_displacement_;
-            int y1 = i*stride1_+max_displacement_;
-            for (index_t top_channel = 0 ; top_channel < top_channels_unsigned_ ; top_channel++) {
-              int s2o = (top_channel % neighborhood_grid_width_ -\
+  const int pheight = tmp1.size(1);
+  const int pwidth = tmp1.size(2);
+  // a row of the patch covers kernel_size pixels, which are contiguous in the NHWC copies
+  const int rowelems = kernel_size_ * bchannels;
+  const int nrows = bnum * top_height_;
+  typedef typename mxnet::op::Correlation::AccType<Dtype>::type AccType;
+  #pragma omp parallel for num_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int row = 0; row < nrows; ++row) {
+    const int nbatch = row / top_height_;
+    const int i = row % top_height_;
+    const int y1 = i * stride1_ + max_displacement_;
+    for (int j = 0; j < top_width_; ++j) {
+      const int x1 = j * stride1_ + max_displacement_;
+      for (int top_channel = 0; top_channel < top_channels_; ++top_channel) {
+        const int s2o = (top_channel % neighborhood_grid_width_ -
                          neighborhood_grid_radius_) * stride2_;
-              int s2p = (top_channel / neighborhood_grid_width_ -\
+        const int s2p = (top_channel / neighborhood_grid_width_ -
                          neighborhood_grid_radius_) * stride2_;
-              int x2 = x1 + s2o;
-              int y2 = y1 + s2p;
-              for (index_t h = 0; h < static_cast<index_t>(kernel_size_); h++)
-                for (index_t w = 0; w < static_cast<index_t>(kernel_size_); w++)
-                  for (index_t channel = 0; channel < static_cast<index_t>(bchannels); channel++) {
-                    if (is_multiply == true)
-                        out[nbatch][top_channel][i][j] += \
-                        tmp1[nbatch][y1+h][x1+w][channel]*tmp2[nbatch][y2+h][x2+w][channel];
-                    else
-                        out[nbatch][top_channel][i][j] += \
-                        fabsf(tmp1[nbatch][y1+h][x1+w][channel]-tmp2[nbatch][y2+h][x2+w][channel]);
-                  }
-              out[nbatch][top_channel][i][j] /= sumelems;
+        AccType sum = 0;
+        for (int h = 0; h < kernel_size_; ++h) {
+          const Dtype *p1 = tmp1.dptr_ + ((nbatch * pheight + y1 + h) * pwidth + x1) * bchannels;
+          const Dtype *p2 = tmp2.dptr_ +
+                            ((nbatch * pheight + y1 + s2p + h) * pwidth + x1 + s2o) * bchannels;
+          if (is_multiply) {
+            #pragma omp simd reduction(+:sum)
+            for (int k = 0; k < rowelems; ++k) {
+              sum += static_cast<AccType>(p1[k]) * static_cast<AccType>(p2[k]);
+            }
+          } else {
+            #pragma omp simd reduction(+:sum)
+            for (int k = 0; k < rowelems; ++k) {
+              const AccType diff = static_cast<AccType>(p1[k]) - static_cast<AccType>(p2[k]);
+              sum += diff >= 0 ? diff : -diff;
             }
+          }
         }
+        out[nbatch][top_channel][i][j] = static_cast<Dtype>(sum / sumelems);
+      }
+    }
+  }
 }
 template<typename Dtype>
 inline void CorrelationBackward(const Tensor<cpu, 4, Dtype> &out_grad,
@@ -95,54 +125,61 @@ inline void CorrelationBackward(const Tensor<cpu, 4, Dtype> &out_grad,
                                 int stride2_, int num,
                                 int channels, int height, int width
                             ) {
-  const float sumelems = kernel_size_ * kernel_size_ * channels;
-  for (index_t i = 0 ; i < static_cast<index_t>(top_height_) ; i++)
-     for (index_t j = 0 ; j < static_cast<index_t>(top_width_); j++)
-        for (index_t nbatch = 0 ; nbatch < static_cast<index_t>(num) ; nbatch++) {
-            int x1 = j*stride1_+max_displacement_;
-            int y1 = i*stride1_+max_displacement_;
-            for (int top_channel = 0 ; top_channel < top_channels_ ; top_channel++) {
-              int s2o = (top_channel % neighborhood_grid_width_ - \
-              neighborhood_grid_radius_) * stride2_;
-              int s2p = (top_channel / neighborhood_grid_width_ - \
-              neighborhood_grid_radius_) * stride2_;
-              int x2 = x1 + s2o;
-              int y2 = y1 + s2p;
-              for (int h = 0; h < kernel_size_; h++)
-                for (int w = 0; w < kernel_size_; w++)
-                  for (int channel = 0 ; channel < channels; channel++) {
-                    if (is_multiply == true) {
-                      if ((y1 +  h - pad_size_ >= 0) && (x1 + w - pad_size_ >= 0) && \
-                      (y1 + h < height +pad_size_) && (x1 + w < width + pad_size_)) {
-                        in_grad1[nbatch][channel][y1+h-pad_size_][x1+w-pad_size_] += \
-                        out_grad[nbatch][top_channel][i][j] * \
-                        tmp2[nbatch][y2+h][x2+w][channel]/sumelems;
-                       }
-                       if ((y2 +  h - pad_size_ >= 0) && (x2 + w -pad_size_ >=0) && \
-                       (y2 + h < height +pad_size_) && (x2 + w < width + pad_size_)) {
-                       in_grad2[nbatch][channel][y2+h-pad_size_][x2+w-pad_size_] += \
-                       out_grad[nbatch][top_channel][i][j] * \
-                       tmp1[nbatch][y1+h][x1+w][channel]/sumelems;
-                       }
-                    } else {
-                      if ((y1 +  h - pad_size_ >= 0) && (x1 + w -pad_size_ >=0) && \
-                      (y1 + h < height + pad_size_) && (x1 + w < width + pad_size_)) {
-                        Dtype sign  = (tmp1[nbatch][y1+h][x1+w][channel] >= \
-                        tmp2[nbatch][y2+h][x2+w][channel])? Dtype(1.0) : Dtype(-1.0);
-                        in_grad1[nbatch][channel][y1+h-pad_size_][x1+w-pad_size_] +=\
-                        out_grad[nbatch][top_channel][i][j]*sign/sumelems;
-                      }
-                      if ((y2 +  h - pad_size_ >= 0) && (x2 + w - pad_size_ >=0) && \
-                      (y2 + h < height + pad_size_) && (x2 + w < width + pad_size_)) {
-                        Dtype sign  = (tmp1[nbatch][y1+h][x1+w][channel] >= \
-                        tmp2[nbatch][y2+h][x2+w][channel])? Dtype(-1.0) : Dtype(1.0);
-                        in_grad2[nbatch][channel][y2+h-pad_size_][x2+w-pad_size_] +=\
-                        out_grad[nbatch][top_channel][i][j]*sign/sumelems;
-                       }
-                    }
-                  }
-               }
-         }
+  const Dtype sumelems = kernel_size_ * kernel_size_ * channels;
+  const int pheight = tmp1.size(1);
+  const int pwidth = tmp1.size(2);
+  const int plane = height * width;
+  // a gradient element only gets contributions of its own channel, so the
+  // blocks of channels of the different items are independent
+  const int nblocks = (channels + kCorrChannelBlock - 1) / kCorrChannelBlock;
+  #pragma omp parallel for num_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int block = 0; block < num * nblocks; ++block) {
+    const int nbatch = block / nblocks;
+    const int cbegin = (block % nblocks) * kCorrChannelBlock;
+    const int clen = std::min(kCorrChannelBlock, channels - cbegin);
+    Dtype *g1 = in_grad1.dptr_ + (nbatch * channels + cbegin) * plane;
+    Dtype *g2 = in_grad2.dptr_ + (nbatch * channels + cbegin) * plane;
+    for (int i = 0; i < top_height_; ++i) {
+      const int y1 = i * stride1_ + max_displacement_;
+      for (int j = 0; j < top_width_; ++j) {
+        const int x1 = j * stride1_ + max_displacement_;
+        for (int top_channel = 0; top_channel < top_channels_; ++top_channel) {
+          const Dtype og = out_grad[nbatch][top_channel][i][j] / sumelems;
+          const int x2 = x1 + (top_channel % neighborhood_grid_width_ -
+                               neighborhood_grid_radius_) * stride2_;
+          const int y2 = y1 + (top_channel / neighborhood_grid_width_ -
+                               neighborhood_grid_radius_) * stride2_;
+          for (int h = 0; h < kernel_size_; ++h) {
+            const int gy1 = y1 + h - pad_size_;
+            const int gy2 = y2 + h - pad_size_;
+            for (int w = 0; w < kernel_size_; ++w) {
+              const int gx1 = x1 + w - pad_size_;
+              const int gx2 = x2 + w - pad_size_;
+              const bool in1 = gy1 >= 0 && gy1 < height && gx1 >= 0 && gx1 < width;
+              const bool in2 = gy2 >= 0 && gy2 < height && gx2 >= 0 && gx2 < width;
+              const Dtype *p1 = tmp1.dptr_ +
+                                ((nbatch * pheight + y1 + h) * pwidth + x1 + w) * channels + cbegin;
+              const Dtype *p2 = tmp2.dptr_ +
+                                ((nbatch * pheight + y2 + h) * pwidth + x2 + w) * channels + cbegin;
+              Dtype *q1 = g1 + gy1 * width + gx1;
+              Dtype *q2 = g2 + gy2 * width + gx2;
+              if (is_multiply) {
+                if (in1) for (int c = 0; c < clen; ++c) q1[c * plane] += og * p2[c];
+                if (in2) for (int c = 0; c < clen; ++c) q2[c * plane] += og * p1[c];
+              } else {
+                if (in1) {
+                  for (int c = 0; c < clen; ++c) q1[c * plane] += p1[c] >= p2[c] ? og : -og;
+                }
+                if (in2) {
+                  for (int c = 0; c < clen; ++c) q2[c * plane] += p1[c] >= p2[c] ? -og : og;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
 }
 }  // namespace mshadow
 namespace mxnet {
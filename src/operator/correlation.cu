@@ -30,7 +30,7 @@
 #include <vector>
 
 #define ROUND_OFF 50000
-#define WARPS_PER_BLOCK 1
+#define WARPS_PER_BLOCK 4
 #define THREADS_PER_WARP 32
 #define CORRELATION_CUDA_CHECK(condition) \
   /* Code block avoids redefinition of cudaError_t error */ \
@@ -44,64 +44,68 @@ for (int i = blockIdx.x * blockDim.x + threadIdx.x; \
       i += blockDim.x * gridDim.x)
 namespace mshadow {
 namespace cuda {
+#if CUDA_VERSION < 9000
+template<typename DType>
+__forceinline__ __device__ DType __shfl_down_sync(unsigned, DType val, int delta) {
+  return __shfl_down(val, delta);
+}
+#endif
 // == Correlation Kernel
-template <typename Dtype>
-__global__ void CorrelateData(const int nthreads, int num, int topwidth,
-  int topheight, int topchannels, int topcount,
+//  A block computes all the displacements of an output position: the patch of
+//  image 1 is loaded into shared memory once, then each warp takes a share of
+//  the displacements and reduces its products with image 2 by warp shuffles.
+//  The patch rows are contiguous in the padded [batch, y, x, channel] copies.
+template <bool is_multiply, typename Dtype>
+__global__ void CorrelateData(int topwidth, int topheight, int topchannels, int topcount,
   int max_displacement, int neighborhood_grid_radius,
-  int neighborhood_grid_width, int kernel_radius, int kernel_size, int stride1, int stride2,
+  int neighborhood_grid_width, int kernel_size, int stride1, int stride2,
   int bottomwidth, int bottomheight, int bottomchannels,
   const Dtype *bottom0, const Dtype *bottom1, Dtype *top) {
+  typedef typename mxnet::op::Correlation::AccType<Dtype>::type AccType;
   extern __shared__ char patch_data_char[];
   Dtype *patch_data = reinterpret_cast<Dtype *>(patch_data_char);
   //  First (upper left) position of kernel upper-left corner
   //  in current center position of neighborhood in image 1
-  int x1 = blockIdx.x * stride1 + max_displacement;
-  int y1 = blockIdx.y * stride1 + max_displacement;
-  int item = blockIdx.z;
-  int ch_off = threadIdx.x;
-  //  Load 3D patch into shared shared memory
+  const int x1 = blockIdx.x * stride1 + max_displacement;
+  const int y1 = blockIdx.y * stride1 + max_displacement;
+  const int item = blockIdx.z;
+  const int rowelems = kernel_size * bottomchannels;
+  //  Load 3D patch into shared memory
   for (int j = 0; j < kernel_size; j++) {  //  HEIGHT
-    for (int i = 0; i < kernel_size; i++) {  //  WIDTH
-      int ji_off = ((j * kernel_size) + i) * bottomchannels;
-      for (int ch = ch_off; ch < bottomchannels; ch += (THREADS_PER_WARP * WARPS_PER_BLOCK))  {
-          //  CHANNELS
-          int idx1 = ((item * bottomheight + y1+j) * bottomwidth + x1+i) * bottomchannels + ch;
-          int idxPatchData = ji_off + ch;
-          patch_data[idxPatchData] = bottom0[idx1];
-      }
+    const Dtype *row = bottom0 + ((item * bottomheight + y1 + j) * bottomwidth + x1) *
+                       bottomchannels;
+    for (int k = threadIdx.x; k < rowelems; k += blockDim.x) {
+      patch_data[j * rowelems + k] = row[k];
     }
   }
   __syncthreads();
-  __shared__ Dtype sum[THREADS_PER_WARP * WARPS_PER_BLOCK];
+  const int lane = threadIdx.x % THREADS_PER_WARP;
+  const AccType sumelems = kernel_size * rowelems;
   //  Compute correlation
-  for (int top_channel = 0; top_channel < topchannels; top_channel++) {
-    sum[ch_off] = 0;
-    int s2o = (top_channel % neighborhood_grid_width - neighborhood_grid_radius) * stride2;
-    int s2p = (top_channel / neighborhood_grid_width - neighborhood_grid_radius) * stride2;
+  for (int top_channel = threadIdx.x / THREADS_PER_WARP; top_channel < topchannels;
+       top_channel += WARPS_PER_BLOCK) {
+    const int x2 = x1 + (top_channel % neighborhood_grid_width - neighborhood_grid_radius) *
+                   stride2;
+    const int y2 = y1 + (top_channel / neighborhood_grid_width - neighborhood_grid_radius) *
+                   stride2;
+    AccType sum = 0;
     for (int j = 0; j < kernel_size; j++) {  //  HEIGHT
-      for (int i = 0; i < kernel_size; i++) {  //  WIDTH
-        int ji_off = ((j * kernel_size) + i) * bottomchannels;
-        for (int ch = ch_off; ch < bottomchannels; ch += (THREADS_PER_WARP * WARPS_PER_BLOCK)) {
-          //  CHANNELS
-          int x2 = x1 + s2o;
-          int y2 = y1 + s2p;
-          int idxPatchData = ji_off + ch;
-          int idx2 = ((item * bottomheight + y2 + j) * bottomwidth + x2 + i) * bottomchannels + ch;
-          sum[ch_off] += patch_data[idxPatchData] * bottom1[idx2];
-        }
+      const Dtype *row = bottom1 + ((item * bottomheight + y2 + j) * bottomwidth + x2) *
+                         bottomchannels;
+      for (int k = lane; k < rowelems; k += THREADS_PER_WARP) {
+        const AccType a = patch_data[j * rowelems + k];
+        const AccType b = row[k];
+        sum += is_multiply ? a * b : fabs(a - b);
       }
     }
-    __syncthreads();
-    if (ch_off == 0) {
-        Dtype total_sum = 0;
-        for (int idx = 0; idx < THREADS_PER_WARP * WARPS_PER_BLOCK; idx++) {
-            total_sum += sum[idx];
-        }
-        const int sumelems = kernel_size * kernel_size * bottomchannels;
-        const int index = ((top_channel * topheight + blockIdx.y) * topwidth) + blockIdx.x;
-        top[index + item*topcount] = total_sum / static_cast<float>(sumelems);
-    }  //  Aggregate result of  different threads
+    //  Aggregate result of the threads of the warp
+    for (int delta = THREADS_PER_WARP / 2; delta > 0; delta /= 2) {
+      sum += __shfl_down_sync(0xFFFFFFFF, sum, delta);
+    }
+    if (lane == 0) {
+      const int index = ((top_channel * topheight + blockIdx.y) * topwidth) + blockIdx.x;
+      top[index + item * topcount] = sum / sumelems;
+    }
   }
 }
 //  == Correlation Backward Pass Kernel (For data1)
@@ -232,46 +236,6 @@ __global__ void CorrelateDataBackward1(const int nthreads,
     bottom1diff[bot1index + item * bottomcount] = sum / static_cast<float>(sumelems);
   }
 }
-// == Correlation Kernel Subtraction
-template <typename Dtype>
-__global__ void CorrelateDataSubtract(const int nthreads, int num, int item,
-  int topwidth, int topheight, int topchannels, int topcount,
-  int max_displacement, int neighborhood_grid_radius,
-  int neighborhood_grid_width, int kernel_radius, int stride1, int stride2,
-  int bottomwidth, int bottomheight, int bottomchannels,
-  const Dtype *bottom0, const Dtype *bottom1, Dtype *top) {
-  CUDA_KERNEL_LOOP(index, nthreads) {
-    int x = index % topwidth;  //  w-pos
-    int y = (index / topwidth) % topheight;  //  h-pos
-    int c = (index / topwidth / topheight) % topchannels;  //  channels
-    //  Offset of patch in image 2
-    int s2o = (c % neighborhood_grid_width - neighborhood_grid_radius) * stride2;
-    int s2p = (c / neighborhood_grid_width - neighborhood_grid_radius) * stride2;
-    //  First (upper left) position of kernel center in current neighborhood in image 1
-    int x1 = x*stride1 + kernel_radius + max_displacement;
-    int y1 = y*stride1 + kernel_radius + max_displacement;
-    //  Iterate through 3D patch
-    Dtype sum = 0;
-    for (int j = -kernel_radius; j <= kernel_radius; j++) {  //  HEIGHT
-      for (int i = -kernel_radius; i <= kernel_radius; i++) {  //  WIDTH
-        for (int l = 0; l < bottomchannels; l++) {  //  CHANNELS
-          //  Calculate position in image 2
-          int x2 = x1 + s2o;
-          int y2 = y1 + s2p;
-          //  Indices in bottom data: (CH=l,W=x2,H=y2,N)
-          int idx1 = ((item * bottomheight + y1 + j) * bottomwidth + x1 + i) \
-          * bottomchannels + l;
-          int idx2 = ((item * bottomheight + y2 + j) * bottomwidth + x2 + i) \
-          * bottomchannels + l;
-          //  Do the correlation:
-          sum += fabsf(bottom0[idx1] - bottom1[idx2]);
-        }
-      }
-    }
-    const int sumelems = (kernel_radius * 2 + 1) * (kernel_radius * 2 + 1) * bottomchannels;
-    top[index + item * topcount] = sum / static_cast<float>(sumelems);
-  }
-}
 //  == Correlation Backward Pass Kernel (For Blob 0)
 template <typename Dtype>
 __global__ void CorrelateDataBackward0Subtract(const int nthreads, int num,
@@ -465,35 +429,28 @@ void Forward_gpu(
     const int height = bheight + 2 * pad_size_;
     const int width = bwidth + 2 * pad_size_;
     const int shared_memory_per_block = (kernel_size_ * kernel_size_) * bchannels;
+    dim3 totalBlocksCorr(top_width_, top_height_, num);
     if (is_multiply == true) {
         //  CorrelationLayer
-        int topThreadCount = topcount;
-        dim3 totalBlocksCorr(top_width_, top_height_, num);
-        CorrelateData<Dtype><<<totalBlocksCorr, threadsPerBlock,
+        CorrelateData<true, Dtype><<<totalBlocksCorr, threadsPerBlock,
         shared_memory_per_block * sizeof(Dtype), stream>>>(
-            topThreadCount,
-            num, top_width_, top_height_, top_channels_, topcount,
+            top_width_, top_height_, top_channels_, topcount,
             max_displacement_, neighborhood_grid_radius_,
-            neighborhood_grid_width_, kernel_radius_, kernel_size_,
+            neighborhood_grid_width_, kernel_size_,
             stride1_, stride2_,
             width, height, channels,
             rbot1, rbot2, top);
-        CORRELATION_CUDA_CHECK(cudaPeekAtLastError());
     } else {
-        //  CorrelationLayer
-        for (int n = 0; n < num; n++) {
-            int topThreadCount = topcount;
-            const int gridSize = (topThreadCount + kMaxThreadsPerBlock - 1)\
-             / kMaxThreadsPerBlock;
-            CorrelateDataSubtract<Dtype><<<gridSize, kMaxThreadsPerBlock, 0, stream>>>(
-                topThreadCount,
-                num, n, top_width_, top_height_, top_channels_, topcount,
-                max_displacement_, neighborhood_grid_radius_,
-                neighborhood_grid_width_, kernel_radius_,
-                stride1_, stride2_, width, height, channels, rbot1, rbot2, top);
-         CORRELATION_CUDA_CHECK(cudaPeekAtLastError());
-        }
+        CorrelateData<false, Dtype><<<totalBlocksCorr, threadsPerBlock,
+        shared_memory_per_block * sizeof(Dtype), stream>>>(
+            top_width_, top_height_, top_channels_, topcount,
+            max_displacement_, neighborhood_grid_radius_,
+            neighborhood_grid_width_, kernel_size_,
+            stride1_, stride2_,
+            width, height, channels,
+            rbot1, rbot2, top);
     }
+    CORRELATION_CUDA_CHECK(cudaPeekAtLastError());
 }
 template <typename Dtype>
 void Backward_gpu(
@@ -85,6 +85,11 @@ class CropOp : public Operator {
     Tensor<xpu, 4> data = in_data[crop_enum::kData].get<xpu, 4, real_t>(s);
     Tensor<xpu, 4> out = out_data[crop_enum::kOut].get<xpu, 4, real_t>(s);
     offset_hw_ = InferCropOfferset(data.shape_, out.shape_);
+    // the executor may have laid the output out as the rows it crops
+    if (data.size(0) * data.size(1) == 1 && data.size(3) == out.size(3) &&
+        out.dptr_ == data.dptr_ + offset_hw_[0] * data.size(3)) {
+      return;
+    }
     out = crop(data, Shape2(out.size(2), out.size(3)), offset_hw_[0], offset_hw_[1]);
   }
 
@@ -31,6 +31,7 @@
 #include <mxnet/operator.h>
 #include <mxnet/c_api.h>
 #include <mxnet/imperative.h>
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <string>
@@ -91,6 +92,13 @@ class CustomOperator {
       return;
     }
     std::unique_lock<std::mutex> lock(mutex_);
+    // a callback may block on arrays computed by another custom operator, e.g. of
+    // another device, so a new worker is started when none is left idle
+    if (static_cast<int>(q_.size()) >= num_free_threads_ &&
+        static_cast<int>(workers_.size()) < num_threads_) {
+      workers_.emplace_back([this]() { Worker(); });
+      ++num_free_threads_;
+    }
     q_.push([=]() mutable {
       bool prev_recording = Imperative::Get()->set_is_recording(recording);
       bool prev_training = Imperative::Get()->set_is_training(training);
@@ -129,7 +137,7 @@ class CustomOperator {
           ctx.run_ctx.ctx, vars, vars2, FnProperty::kNormal, 0,
           "CustomOperator");
     });
-    cv_.notify_all();
+    cv_.notify_one();
   }
 
   ~CustomOperator() {
@@ -139,7 +147,7 @@ class CustomOperator {
       destructing_ = true;
       cv_.notify_all();
     }
-    worker_.join();
+    for (auto& worker : workers_) worker.join();
   }
 
   static CustomOperator* Get();
@@ -147,31 +155,35 @@ class CustomOperator {
  private:
   CustomOperator() {
     destructing_ = false;
-    naive_engine_ = true;
-    if (std::string("NaiveEngine") != dmlc::GetEnv("MXNET_ENGINE_TYPE", std::string())) {
-      naive_engine_ = false;
-      worker_ = std::thread(
-        [&]() {
-          std::unique_lock<std::mutex> lock(mutex_);
-          while (!q_.empty() || !destructing_) {
-            cv_.wait(lock, [&] {return !q_.empty() || destructing_;});
-            while (!q_.empty()) {
-              auto fn = q_.front();
-              lock.unlock();
-              fn();
-              lock.lock();
-              q_.pop();
-            }
-          }
-        });
+    naive_engine_ =
+        std::string("NaiveEngine") == dmlc::GetEnv("MXNET_ENGINE_TYPE", std::string());
+    num_threads_ = std::max(1, dmlc::GetEnv("MXNET_CUSTOM_OP_NUM_THREADS", 16));
+    num_free_threads_ = 0;
+  }
+  /*! \brief runs the queued callbacks until the operator is destructed */
+  void Worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!q_.empty() || !destructing_) {
+      cv_.wait(lock, [&] {return !q_.empty() || destructing_;});
+      while (!q_.empty()) {
+        auto fn = std::move(q_.front());
+        q_.pop();
+        --num_free_threads_;
+        lock.unlock();
+        fn();
+        lock.lock();
+        ++num_free_threads_;
+      }
     }
   }
   std::mutex mutex_;
   std::map<std::string, CustomOpPropCreator> registry_;
-  // async worker
+  // async workers, started on demand up to num_threads_
   std::condition_variable cv_;
-  std::thread worker_;
+  std::vector<std::thread> workers_;
   std::queue<std::function<void(void)> > q_;
+  int num_threads_;
+  int num_free_threads_;
   bool naive_engine_;
   bool destructing_;
 };
@@ -0,0 +1,248 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file fused_elemwise-inl.h
+ * \brief a chain of elementwise operators evaluated in one pass, created
+ *        by the FuseElemwise graph pass of the executor
+ */
+#ifndef MXNET_OPERATOR_FUSED_ELEMWISE_INL_H_
+#define MXNET_OPERATOR_FUSED_ELEMWISE_INL_H_
+
+#include <dmlc/parameter.h>
+#include <mxnet/operator_util.h>
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../engine/openmp.h"
+#include "./math_functions-inl.h"
+#include "./operator_common.h"
+#include "./mxnet_op.h"
+
+namespace mxnet {
+namespace op {
+
+namespace fused_elemwise {
+enum FusedOpType {kAdd, kSub, kMul, kDiv, kPlusScalar, kMinusScalar, kRMinusScalar,
+                  kMulScalar, kDivScalar, kRDivScalar, kRelu, kSigmoid, kTanh, kExp,
+                  kLog, kSqrt, kSquare, kNegative, kAbs, kNumOps};
+/*! \brief limits of a fused group, so the GPU program fits in kernel arguments */
+const int kMaxInputs = 8;
+const int kMaxSteps = 16;
+
+/*! \brief names of the steps in the program text */
+inline const char* OpName(int op) {
+  static const char* names[kNumOps] = {
+    "add", "sub", "mul", "div", "plus_scalar", "minus_scalar", "rminus_scalar",
+    "mul_scalar", "div_scalar", "rdiv_scalar", "relu", "sigmoid", "tanh", "exp",
+    "log", "sqrt", "square", "negative", "abs"};
+  CHECK(op >= 0 && op < kNumOps);
+  return names[op];
+}
+
+inline int OpFromName(const std::string& name) {
+  for (int op = 0; op < kNumOps; ++op) {
+    if (name == OpName(op)) return op;
+  }
+  LOG(FATAL) << "Unknown fused elementwise step " << name;
+  return -1;
+}
+
+/*! \brief whether the step reads a second operand */
+inline bool IsBinary(int op) {
+  return op <= kDiv;
+}
+}  // namespace fused_elemwise
+
+struct FusedElemwiseParam : public dmlc::Parameter<FusedElemwiseParam> {
+  int num_inputs;
+  std::string program;
+  DMLC_DECLARE_PARAMETER(FusedElemwiseParam) {
+    DMLC_DECLARE_FIELD(num_inputs).set_lower_bound(1)
+    .describe("Number of inputs of the fused group.");
+    DMLC_DECLARE_FIELD(program)
+    .describe("Steps of the fused group separated by ';', each one "
+              "'name lhs rhs scalar'. Operands below num_inputs are inputs, "
+              "the others refer to the result of an earlier step. The last "
+              "step is the output.");
+  }
+};
+
+/*! \brief one elementwise operation of a fused group */
+struct FusedElemwiseStep {
+  int op;
+  /*! \brief operand ids, rhs is -1 for unary steps */
+  int lhs, rhs;
+  double scalar;
+};
+
+/*! \brief parsed attributes of a fused group */
+struct FusedElemwiseProgram {
+  FusedElemwiseParam param;
+  std::vector<FusedElemwiseStep> steps;
+};
+
+/*! \brief render steps as the program attribute */
+inline std::string FusedElemwiseProgramString(const std::vector<FusedElemwiseStep>& steps) {
+  std::ostringstream os;
+  os << std::setprecision(std::numeric_limits<double>::max_digits10);
+  for (size_t i = 0; i < steps.size(); ++i) {
+    if (i != 0) os << ';';
+    os << fused_elemwise::OpName(steps[i].op) << ' ' << steps[i].lhs << ' '
+       << steps[i].rhs << ' ' << steps[i].scalar;
+  }
+  return os.str();
+}
+
+inline void FusedElemwiseParamParser(nnvm::NodeAttrs* attrs) {
+  using namespace fused_elemwise;
+  FusedElemwiseProgram prog;
+  prog.param.Init(attrs->dict);
+  std::istringstream is(prog.param.program);
+  std::string text;
+  while (std::getline(is, text, ';')) {
+    std::istringstream step_is(text);
+    std::string name;
+    FusedElemwiseStep step;
+    CHECK(step_is >> name >> step.lhs >> step.rhs >> step.scalar)
+      << "Invalid fused elementwise step '" << text << "'";
+    step.op = OpFromName(name);
+    const int num_operands = prog.param.num_inputs + static_cast<int>(prog.steps.size());
+    CHECK(step.lhs >= 0 && step.lhs < num_operands) << "Invalid operand in '" << text << "'";
+    if (IsBinary(step.op)) {
+      CHECK(step.rhs >= 0 && step.rhs < num_operands) << "Invalid operand in '" << text << "'";
+    }
+    prog.steps.push_back(step);
+  }
+  CHECK(!prog.steps.empty()) << "Empty fused elementwise program";
+  CHECK_LE(prog.param.num_inputs, kMaxInputs);
+  CHECK_LE(prog.steps.size(), static_cast<size_t>(kMaxSteps));
+  attrs->parsed = std::move(prog);
+}
+
+/*! \brief type the steps are evaluated in, half precision goes through float */
+template<typename DType>
+struct FusedComputeType {
+  typedef DType type;
+};
+
+template<>
+struct FusedComputeType<mshadow::half::half_t> {
+  typedef float type;
+};
+
+/*! \brief evaluate one step, same semantics as the mshadow_op functors */
+template<typename CType>
+MSHADOW_XINLINE CType FusedElemwiseMap(const int op, const CType a, const CType b,
+                                       const CType s) {
+  using namespace fused_elemwise;
+  switch (op) {
+    case kAdd: return a + b;
+    case kSub: return a - b;
+    case kMul: return a * b;
+    case kDiv: return a / b;
+    case kPlusScalar: return a + s;
+    case kMinusScalar: return a - s;
+    case kRMinusScalar: return s - a;
+    case kMulScalar: return a * s;
+    case kDivScalar: return a / s;
+    case kRDivScalar: return s / a;
+    case kRelu: return a > CType(0) ? a : CType(0);
+    case kSigmoid: return CType(1) / (CType(1) + CType(math::exp(-a)));
+    case kTanh: return CType(math::tanh(a));
+    case kExp: return CType(math::exp(a));
+    case kLog: return CType(math::log(a));
+    case kSqrt: return CType(math::sqrt(a));
+    case kSquare: return a * a;
+    case kNegative: return -a;
+    case kAbs: return a < CType(0) ? -a : a;
+    default: return a;
+  }
+}
+
+/*!
+ * \brief CPU evaluation in tiles that stay in L1: every step runs as a loop
+ *  over the tile, which the compiler unswitches on the step type and
+ *  vectorizes, and no intermediate is written to memory.
+ */
+inline void FusedElemwiseComputeCPU(const nnvm::NodeAttrs& attrs,
+                                    const OpContext& ctx,
+                                    const std::vector<TBlob>& inputs,
+                                    const std::vector<OpReqType>& req,
+                                    const std::vector<TBlob>& outputs) {
+  const FusedElemwiseProgram& prog = nnvm::get<FusedElemwiseProgram>(attrs.parsed);
+  const int num_inputs = prog.param.num_inputs;
+  CHECK_EQ(inputs.size(), static_cast<size_t>(num_inputs));
+  CHECK_EQ(outputs.size(), 1U);
+  if (req[0] == kNullOp) return;
+  const index_t size = outputs[0].Size();
+  const int kTile = 512;
+  const index_t num_tiles = (size + kTile - 1) / kTile;
+  const int num_regs = num_inputs + static_cast<int>(prog.steps.size());
+  const int nthread = std::max(1, static_cast<int>(std::min<index_t>(
+    num_tiles, engine::OpenMP::Get()->GetRecommendedOMPThreadCount())));
+  MSHADOW_TYPE_SWITCH(outputs[0].type_flag_, DType, {
+    typedef typename FusedComputeType<DType>::type CType;
+    DType* out = outputs[0].dptr<DType>();
+    #pragma omp parallel num_threads(nthread)
+    {
+      std::vector<CType> regs(static_cast<size_t>(num_regs) * kTile);
+      #pragma omp for
+      for (index_t tile = 0; tile < num_tiles; ++tile) {
+        const index_t begin = tile * kTile;
+        const int len = static_cast<int>(std::min<index_t>(kTile, size - begin));
+        for (int i = 0; i < num_inputs; ++i) {
+          const DType* in = inputs[i].dptr<DType>() + begin;
+          CType* r = &regs[i * kTile];
+          for (int j = 0; j < len; ++j) r[j] = CType(in[j]);
+        }
+        for (size_t k = 0; k < prog.steps.size(); ++k) {
+          const FusedElemwiseStep& step = prog.steps[k];
+          const CType* a = &regs[step.lhs * kTile];
+          const CType* b = &regs[std::max(step.rhs, 0) * kTile];
+          const CType s = CType(step.scalar);
+          const int op = step.op;
+          CType* r = &regs[(num_inputs + k) * kTile];
+          for (int j = 0; j < len; ++j) r[j] = FusedElemwiseMap(op, a[j], b[j], s);
+        }
+        // inputs of the tile are all read, so writing in place is safe
+        const CType* result = &regs[(num_regs - 1) * kTile];
+        if (req[0] == kAddTo) {
+          for (int j = 0; j < len; ++j) out[begin + j] = DType(CType(out[begin + j]) + result[j]);
+        } else {
+          for (int j = 0; j < len; ++j) out[begin + j] = DType(result[j]);
+        }
+      }
+    }
+  });
+}
+
+void FusedElemwiseComputeGPU(const nnvm::NodeAttrs& attrs,
+                             const OpContext& ctx,
+                             const std::vector<TBlob>& inputs,
+                             const std::vector<OpReqType>& req,
+                             const std::vector<TBlob>& outputs);
+
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_FUSED_ELEMWISE_INL_H_
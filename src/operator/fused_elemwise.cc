@@ -0,0 +1,68 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file fused_elemwise.cc
+ * \brief CPU registration of the fused elementwise operator
+ */
+#include "./fused_elemwise-inl.h"
+#include "./elemwise_op_common.h"
+
+namespace mxnet {
+namespace op {
+
+DMLC_REGISTER_PARAMETER(FusedElemwiseParam);
+
+NNVM_REGISTER_OP(_FusedElemwise)
+.describe(R"code(Evaluates a chain of elementwise operators in one pass.
+
+Created by the executor when ``MXNET_EXEC_FUSE_ELEMWISE`` is set, from
+single-consumer chains of same-shape elementwise operators in inference
+graphs. All inputs and the output have the same shape and type.
+
+)code" ADD_FILELINE)
+.set_num_inputs([](const NodeAttrs& attrs) {
+    return static_cast<uint32_t>(
+      nnvm::get<FusedElemwiseProgram>(attrs.parsed).param.num_inputs);
+  })
+.set_num_outputs(1)
+.set_attr_parser(FusedElemwiseParamParser)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    const int num_inputs = nnvm::get<FusedElemwiseProgram>(attrs.parsed).param.num_inputs;
+    std::vector<std::string> ret;
+    for (int i = 0; i < num_inputs; ++i) {
+      ret.push_back(std::string("arg") + std::to_string(i));
+    }
+    return ret;
+  })
+.set_attr<std::string>("key_var_num_args", "num_inputs")
+.set_attr<nnvm::FInferShape>("FInferShape", ElemwiseShape<-1, 1>)
+.set_attr<nnvm::FInferType>("FInferType", ElemwiseType<-1, 1>)
+.set_attr<nnvm::FInplaceOption>("FInplaceOption",
+  [](const NodeAttrs& attrs) {
+    return std::vector<std::pair<int, int> >{{0, 0}};
+  })
+.set_attr<FCompute>("FCompute<cpu>", FusedElemwiseComputeCPU)
+.add_argument("args", "NDArray-or-Symbol[]", "Inputs of the fused group")
+.add_arguments(FusedElemwiseParam::__FIELDS__());
+
+}  // namespace op
+}  // namespace mxnet
@@ -0,0 +1,195 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file fused_elemwise.cu
+ * \brief GPU fused elementwise operator, compiled at runtime with NVRTC
+ *        when available and interpreted otherwise
+ */
+#include <mutex>
+#include <unordered_map>
+#include "./fused_elemwise-inl.h"
+#include "../common/cuda_utils.h"
+#if MXNET_ENABLE_CUDA_RTC
+#include <mxnet/rtc.h>
+#endif  // MXNET_ENABLE_CUDA_RTC
+
+namespace mxnet {
+namespace op {
+namespace fused_elemwise {
+
+/*! \brief program and pointers of a fused group, passed by value */
+template<typename DType>
+struct GPUArgs {
+  int num_inputs;
+  int num_steps;
+  FusedElemwiseStep steps[kMaxSteps];
+  const DType* in[kMaxInputs];
+  DType* out;
+  int add_to;
+};
+
+/*! \brief interpret the program for every element */
+template<typename DType>
+__global__ void FusedElemwiseKernel(const GPUArgs<DType> args, const int size) {
+  typedef typename FusedComputeType<DType>::type CType;
+  CType regs[kMaxInputs + kMaxSteps];
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < size;
+       i += blockDim.x * gridDim.x) {
+    for (int k = 0; k < args.num_inputs; ++k) regs[k] = CType(args.in[k][i]);
+    for (int k = 0; k < args.num_steps; ++k) {
+      const FusedElemwiseStep& step = args.steps[k];
+      regs[args.num_inputs + k] = FusedElemwiseMap(step.op, regs[step.lhs],
+                                                   regs[max(step.rhs, 0)], CType(step.scalar));
+    }
+    const CType r = regs[args.num_inputs + args.num_steps - 1];
+    args.out[i] = args.add_to ? DType(CType(args.out[i]) + r) : DType(r);
+  }
+}
+
+#if MXNET_ENABLE_CUDA_RTC
+/*! \brief CUDA source of a kernel with the program unrolled into registers */
+inline std::string RTCSource(const FusedElemwiseProgram& prog, const std::string& type,
+                             bool add_to) {
+  const int num_inputs = prog.param.num_inputs;
+  const std::string f = type == "float" ? "f" : "";
+  std::ostringstream os;
+  os << std::setprecision(std::numeric_limits<double>::max_digits10);
+  os << "typedef " << type << " T;\n"
+     << "extern \"C\" __global__ void fused_elemwise(";
+  for (int i = 0; i < num_inputs; ++i) {
+    os << "const T* __restrict__ in" << i << ", ";
+  }
+  os << "T* __restrict__ out, const int size) {\n"
+     << "  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < size;\n"
+     << "       i += blockDim.x * gridDim.x) {\n";
+  for (int i = 0; i < num_inputs; ++i) {
+    os << "    const T r" << i << " = in" << i << "[i];\n";
+  }
+  for (size_t k = 0; k < prog.steps.size(); ++k) {
+    const FusedElemwiseStep& step = prog.steps[k];
+    const std::string a = "r" + std::to_string(step.lhs);
+    const std::string b = "r" + std::to_string(step.rhs);
+    std::ostringstream scalar;
+    scalar << std::setprecision(std::numeric_limits<double>::max_digits10)
+           << "((T)" << step.scalar << ")";
+    const std::string s = scalar.str();
+    os << "    const T r" << num_inputs + k << " = ";
+    switch (step.op) {
+      case kAdd: os << a << " + " << b; break;
+      case kSub: os << a << " - " << b; break;
+      case kMul: os << a << " * " << b; break;
+      case kDiv: os << a << " / " << b; break;
+      case kPlusScalar: os << a << " + " << s; break;
+      case kMinusScalar: os << a << " - " << s; break;
+      case kRMinusScalar: os << s << " - " << a; break;
+      case kMulScalar: os << a << " * " << s; break;
+      case kDivScalar: os << a << " / " << s; break;
+      case kRDivScalar: os << s << " / " << a; break;
+      case kRelu: os << "(" << a << " > (T)0 ? " << a << " : (T)0)"; break;
+      case kSigmoid: os << "(T)1 / ((T)1 + exp" << f << "(-" << a << "))"; break;
+      case kTanh: os << "tanh" << f << "(" << a << ")"; break;
+      case kExp: os << "exp" << f << "(" << a << ")"; break;
+      case kLog: os << "log" << f << "(" << a << ")"; break;
+      case kSqrt: os << "sqrt" << f << "(" << a << ")"; break;
+      case kSquare: os << a << " * " << a; break;
+      case kNegative: os << "-" << a; break;
+      case kAbs: os << "fabs" << f << "(" << a << ")"; break;
+      default: LOG(FATAL) << "Unknown fused elementwise step " << step.op;
+    }
+    os << ";\n";
+  }
+  const std::string result = "r" + std::to_string(num_inputs + prog.steps.size() - 1);
+  os << "    out[i] " << (add_to ? "+= " : "= ") << result << ";\n"
+     << "  }\n"
+     << "}\n";
+  return os.str();
+}
+
+/*! \brief compile the program once per type and req, and get it on ctx */
+inline CUfunction GetRTCFunction(const FusedElemwiseProgram& prog, const std::string& type,
+                                 bool add_to, const Context& ctx) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<rtc::CudaModule::Kernel> > kernels;
+  const std::string source = RTCSource(prog, type, add_to);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = kernels.find(source);
+  if (it == kernels.end()) {
+    rtc::CudaModule module(source.c_str(), {}, {});
+    // the signature is only used by Kernel::Launch, which is not called here
+    it = kernels.emplace(source, module.GetKernel("fused_elemwise", {})).first;
+  }
+  return it->second->GetFunction(ctx);
+}
+#endif  // MXNET_ENABLE_CUDA_RTC
+
+}  // namespace fused_elemwise
+
+void FusedElemwiseComputeGPU(const nnvm::NodeAttrs& attrs,
+                             const OpContext& ctx,
+                             const std::vector<TBlob>& inputs,
+                             const std::vector<OpReqType>& req,
+                             const std::vector<TBlob>& outputs) {
+  using namespace fused_elemwise;
+  const FusedElemwiseProgram& prog = nnvm::get<FusedElemwiseProgram>(attrs.parsed);
+  const int num_inputs = prog.param.num_inputs;
+  CHECK_EQ(inputs.size(), static_cast<size_t>(num_inputs));
+  CHECK_EQ(outputs.size(), 1U);
+  if (req[0] == kNullOp) return;
+  int size = static_cast<int>(outputs[0].Size());
+  if (size == 0) return;
+  mshadow::Stream<gpu>* s = ctx.get_stream<gpu>();
+  const int blocks = mxnet_op::cuda_get_num_blocks(size);
+  const int threads = mxnet_op::kBaseThreadNum;
+  const int type_flag = outputs[0].type_flag_;
+#if MXNET_ENABLE_CUDA_RTC
+  if (type_flag == mshadow::kFloat32 || type_flag == mshadow::kFloat64) {
+    CUfunction function = GetRTCFunction(prog, type_flag == mshadow::kFloat32 ? "float" : "double",
+                                         req[0] == kAddTo, ctx.run_ctx.get_ctx());
+    std::vector<void*> ptrs;
+    for (const TBlob& in : inputs) ptrs.push_back(in.dptr_);
+    ptrs.push_back(outputs[0].dptr_);
+    std::vector<void*> args;
+    for (void*& p : ptrs) args.push_back(&p);
+    args.push_back(&size);
+    CUDA_DRIVER_CALL(cuLaunchKernel(function, blocks, 1, 1, threads, 1, 1, 0,
+                                    mshadow::Stream<gpu>::GetStream(s), args.data(), 0));
+    return;
+  }
+#endif  // MXNET_ENABLE_CUDA_RTC
+  MSHADOW_TYPE_SWITCH(type_flag, DType, {
+    GPUArgs<DType> args;
+    args.num_inputs = num_inputs;
+    args.num_steps = static_cast<int>(prog.steps.size());
+    std::copy(prog.steps.begin(), prog.steps.end(), args.steps);
+    for (int i = 0; i < num_inputs; ++i) args.in[i] = inputs[i].dptr<DType>();
+    args.out = outputs[0].dptr<DType>();
+    args.add_to = req[0] == kAddTo;
+    FusedElemwiseKernel<DType><<<blocks, threads, 0, mshadow::Stream<gpu>::GetStream(s)>>>(
+      args, size);
+    MSHADOW_CUDA_POST_KERNEL_CHECK(FusedElemwiseKernel);
+  });
+}
+
+NNVM_REGISTER_OP(_FusedElemwise)
+.set_attr<FCompute>("FCompute<gpu>", FusedElemwiseComputeGPU);
+
+}  // namespace op
+}  // namespace mxnet
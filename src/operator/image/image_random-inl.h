@@ -62,26 +62,34 @@ inline bool ToTensorType(const nnvm::NodeAttrs& attrs,
   return (*in_attrs)[0] != -1;
 }
 
+/*! \brief (height, width, channels) image to a (channels, height, width) tensor in [0, 1] */
+struct ToTensorKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, float *out, const DType *in,
+                                  const int length, const int channel) {
+    const int c = i / length;
+    const int l = i % length;
+    out[i] = static_cast<float>(in[l*channel + c]) / 255.0f;
+  }
+};
+
+template<typename xpu>
 void ToTensor(const nnvm::NodeAttrs &attrs,
-                     const OpContext &ctx,
-                     const std::vector<TBlob> &inputs,
-                     const std::vector<OpReqType> &req,
-                     const std::vector<TBlob> &outputs) {
+              const OpContext &ctx,
+              const std::vector<TBlob> &inputs,
+              const std::vector<OpReqType> &req,
+              const std::vector<TBlob> &outputs) {
   CHECK_EQ(req[0], kWriteTo)
     << "`to_tensor` does not support inplace";
 
   int length = inputs[0].shape_[0] * inputs[0].shape_[1];
   int channel = inputs[0].shape_[2];
+  mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
 
   MSHADOW_TYPE_SWITCH(inputs[0].type_flag_, DType, {
-    float* output = outputs[0].dptr<float>();
-    DType* input = inputs[0].dptr<DType>();
-
-    for (int l = 0; l < length; ++l) {
-      for (int c = 0; c < channel; ++c) {
-        output[c*length + l] = static_cast<float>(input[l*channel + c]) / 255.0f;
-      }
-    }
+    mxnet_op::Kernel<ToTensorKernel, xpu>::Launch(s, length * channel,
+                                                  outputs[0].dptr<float>(),
+                                                  inputs[0].dptr<DType>(), length, channel);
   });
 }
 
@@ -123,38 +131,53 @@ inline bool NormalizeShape(const nnvm::NodeAttrs& attrs,
   return true;
 }
 
+/*! \brief (x - mean) / std of every channel of a (channels, height, width) tensor */
+struct NormalizeKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, DType *out, const DType *in, const int length,
+                                  const float mean0, const float mean1, const float mean2,
+                                  const float std0, const float std1, const float std2) {
+    const int c = i / length;
+    const float mean = c == 0 ? mean0 : (c == 1 ? mean1 : mean2);
+    const float std = c == 0 ? std0 : (c == 1 ? std1 : std2);
+    out[i] = DType((static_cast<float>(in[i]) - mean) / std);
+  }
+};
+
+template<typename xpu>
 void Normalize(const nnvm::NodeAttrs &attrs,
-                      const OpContext &ctx,
-                      const std::vector<TBlob> &inputs,
-                      const std::vector<OpReqType> &req,
-                      const std::vector<TBlob> &outputs) {
+               const OpContext &ctx,
+               const std::vector<TBlob> &inputs,
+               const std::vector<OpReqType> &req,
+               const std::vector<TBlob> &outputs) {
   const NormalizeParam &param = nnvm::get<NormalizeParam>(attrs.parsed);
 
   int nchannels = inputs[0].shape_[0];
   int length = inputs[0].shape_[1] * inputs[0].shape_[2];
+  float mean[3], std[3];
+  for (int i = 0; i < 3; ++i) {
+    mean[i] = param.mean[param.mean.ndim() > 1 && i < nchannels ? i : 0];
+    std[i] = param.std[param.std.ndim() > 1 && i < nchannels ? i : 0];
+  }
+  mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
 
   MSHADOW_TYPE_SWITCH(outputs[0].type_flag_, DType, {
-    DType* input = inputs[0].dptr<DType>();
-    DType* output = outputs[0].dptr<DType>();
-
-    for (int i = 0; i < nchannels; ++i) {
-      DType mean = param.mean[param.mean.ndim() > 1 ? i : 0];
-      DType std = param.std[param.std.ndim() > 1 ? i : 0];
-      for (int j = 0; j < length; ++j) {
-        output[i*length + j] = (input[i*length + j] - mean) / std;
-      }
-    }
+    mxnet_op::Kernel<NormalizeKernel, xpu>::Launch(s, nchannels * length,
+                                                   outputs[0].dptr<DType>(),
+                                                   inputs[0].dptr<DType>(), length,
+                                                   mean[0], mean[1], mean[2],
+                                                   std[0], std[1], std[2]);
   });
 }
 
 template<typename DType>
-inline DType saturate_cast(const float& src) {
+MSHADOW_XINLINE DType saturate_cast(const float& src) {
   return static_cast<DType>(src);
 }
 
 template<>
-inline uint8_t saturate_cast(const float& src) {
-  return std::min(std::max(src, 0.f), 255.f);
+MSHADOW_XINLINE uint8_t saturate_cast(const float& src) {
+  return src < 0.f ? 0 : (src > 255.f ? 255 : static_cast<uint8_t>(src));
 }
 
 inline bool ImageShape(const nnvm::NodeAttrs& attrs,
@@ -171,50 +194,64 @@ inline bool ImageShape(const nnvm::NodeAttrs& attrs,
   return true;
 }
 
-template<typename DType, int axis>
-void FlipImpl(const TShape &shape, DType *src, DType *dst) {
+/*!
+ * \brief swap the elements j and mid-1-j along the flipped axis, one pair per thread.
+ *  The middle element of an odd axis is its own pair, so src and dst may be the same.
+ */
+struct FlipKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, DType *dst, const DType *src,
+                                  const int mid, const int tail) {
+    const int half = (mid + 1) >> 1;
+    const int k = i % tail;
+    const int j = (i / tail) % half;
+    const int h = i / tail / half;
+    const int idx1 = (h*mid + j) * tail + k;
+    const int idx2 = (h*mid + mid - 1 - j) * tail + k;
+    const DType tmp = src[idx1];
+    dst[idx1] = src[idx2];
+    dst[idx2] = tmp;
+  }
+};
+
+template<typename xpu, typename DType, int axis>
+void FlipImpl(mshadow::Stream<xpu> *s, const TShape &shape, DType *src, DType *dst) {
   int head = 1, mid = shape[axis], tail = 1;
   for (int i = 0; i < axis; ++i) head *= shape[i];
   for (uint32_t i = axis+1; i < shape.ndim(); ++i) tail *= shape[i];
-
-  for (int i = 0; i < head; ++i) {
-    for (int j = 0; j < (mid >> 1); ++j) {
-      int idx1 = (i*mid + j) * tail;
-      int idx2 = idx1 + (mid-(j << 1)-1) * tail;
-      for (int k = 0; k < tail; ++k, ++idx1, ++idx2) {
-        DType tmp = src[idx1];
-        dst[idx1] = src[idx2];
-        dst[idx2] = tmp;
-      }
-    }
-  }
+  mxnet_op::Kernel<FlipKernel, xpu>::Launch(s, head * ((mid + 1) >> 1) * tail,
+                                            dst, src, mid, tail);
 }
 
+template<typename xpu>
 void FlipLeftRight(const nnvm::NodeAttrs &attrs,
                    const OpContext &ctx,
                    const std::vector<TBlob> &inputs,
                    const std::vector<OpReqType> &req,
                    const std::vector<TBlob> &outputs) {
   using namespace mshadow;
+  Stream<xpu> *s = ctx.get_stream<xpu>();
   MSHADOW_TYPE_SWITCH(outputs[0].type_flag_, DType, {
-    FlipImpl<DType, 1>(inputs[0].shape_, inputs[0].dptr<DType>(),
-                       outputs[0].dptr<DType>());
+    FlipImpl<xpu, DType, 1>(s, inputs[0].shape_, inputs[0].dptr<DType>(),
+                            outputs[0].dptr<DType>());
   });
 }
 
+template<typename xpu>
 void FlipTopBottom(const nnvm::NodeAttrs &attrs,
                    const OpContext &ctx,
                    const std::vector<TBlob> &inputs,
                    const std::vector<OpReqType> &req,
                    const std::vector<TBlob> &outputs) {
   using namespace mshadow;
+  Stream<xpu> *s = ctx.get_stream<xpu>();
   MSHADOW_TYPE_SWITCH(outputs[0].type_flag_, DType, {
-    FlipImpl<DType, 0>(inputs[0].shape_, inputs[0].dptr<DType>(),
-                       outputs[0].dptr<DType>());
+    FlipImpl<xpu, DType, 0>(s, inputs[0].shape_, inputs[0].dptr<DType>(),
+                            outputs[0].dptr<DType>());
   });
 }
 
-void RandomFlipLeftRight(
+inline void RandomFlipLeftRight(
     const nnvm::NodeAttrs &attrs,
     const OpContext &ctx,
     const std::vector<TBlob> &inputs,
@@ -229,13 +266,13 @@ void RandomFlipLeftRight(
         std::memcpy(outputs[0].dptr_, inputs[0].dptr_, inputs[0].Size() * sizeof(DType));
       }
     } else {
-      FlipImpl<DType, 1>(inputs[0].shape_, inputs[0].dptr<DType>(),
-                         outputs[0].dptr<DType>());
+      FlipImpl<cpu, DType, 1>(s, inputs[0].shape_, inputs[0].dptr<DType>(),
+                              outputs[0].dptr<DType>());
     }
   });
 }
 
-void RandomFlipTopBottom(
+inline void RandomFlipTopBottom(
     const nnvm::NodeAttrs &attrs,
     const OpContext &ctx,
     const std::vector<TBlob> &inputs,
@@ -250,8 +287,8 @@ void RandomFlipTopBottom(
         std::memcpy(outputs[0].dptr_, inputs[0].dptr_, inputs[0].Size() * sizeof(DType));
       }
     } else {
-      FlipImpl<DType, 0>(inputs[0].shape_, inputs[0].dptr<DType>(),
-                         outputs[0].dptr<DType>());
+      FlipImpl<cpu, DType, 0>(s, inputs[0].shape_, inputs[0].dptr<DType>(),
+                              outputs[0].dptr<DType>());
     }
   });
 }
@@ -287,7 +324,7 @@ inline void AdjustBrightnessImpl(const float& alpha_b,
   });
 }
 
-void RandomBrightness(const nnvm::NodeAttrs &attrs,
+inline void RandomBrightness(const nnvm::NodeAttrs &attrs,
                       const OpContext &ctx,
                       const std::vector<TBlob> &inputs,
                       const std::vector<OpReqType> &req,
@@ -405,12 +442,12 @@ inline void RandomSaturation(const nnvm::NodeAttrs &attrs,
   AdjustSaturationImpl(alpha_s, ctx, inputs, req, outputs);
 }
 
-void RGB2HLSConvert(const float& src_r,
-                    const float& src_g,
-                    const float& src_b,
-                    float *dst_h,
-                    float *dst_l,
-                    float *dst_s) {
+MSHADOW_XINLINE void RGB2HLSConvert(const float& src_r,
+                                    const float& src_g,
+                                    const float& src_b,
+                                    float *dst_h,
+                                    float *dst_l,
+                                    float *dst_s) {
   float b = src_b / 255.f, g = src_g / 255.f, r = src_r / 255.f;
   float h = 0.f, s = 0.f, l;
   float vmin;
@@ -426,7 +463,8 @@ void RGB2HLSConvert(const float& src_r,
   diff = vmax - vmin;
   l = (vmax + vmin) * 0.5f;
 
-  if (diff > std::numeric_limits<float>::epsilon()) {
+  // FLT_EPSILON, numeric_limits is not available in device code
+  if (diff > 1.19209290e-07f) {
     s = (l < 0.5f) * diff / (vmax + vmin);
     s += (l >= 0.5f) * diff / (2.0f - vmax - vmin);
 
@@ -443,13 +481,13 @@ void RGB2HLSConvert(const float& src_r,
   *dst_s = s;
 }
 
-void HLS2RGBConvert(const float& src_h,
-                    const float& src_l,
-                    const float& src_s,
-                    float *dst_r,
-                    float *dst_g,
-                    float *dst_b) {
-  static const int c_HlsSectorData[6][3] = {
+MSHADOW_XINLINE void HLS2RGBConvert(const float& src_h,
+                                    const float& src_l,
+                                    const float& src_s,
+                                    float *dst_r,
+                                    float *dst_g,
+                                    float *dst_b) {
+  const int c_HlsSectorData[6][3] = {
     { 1, 3, 0 },
     { 1, 0, 2 },
     { 3, 0, 1 },
@@ -494,7 +532,7 @@ void HLS2RGBConvert(const float& src_h,
   *dst_r = r * 255.f;
 }
 
-void AdjustHueImpl(float alpha,
+inline void AdjustHueImpl(float alpha,
                    const OpContext &ctx,
                    const std::vector<TBlob> &inputs,
                    const std::vector<OpReqType> &req,
@@ -521,7 +559,7 @@ void AdjustHueImpl(float alpha,
   });
 }
 
-void RandomHue(const nnvm::NodeAttrs &attrs,
+inline void RandomHue(const nnvm::NodeAttrs &attrs,
                const OpContext &ctx,
                const std::vector<TBlob> &inputs,
                const std::vector<OpReqType> &req,
@@ -554,7 +592,7 @@ struct RandomColorJitterParam : public dmlc::Parameter<RandomColorJitterParam> {
   }
 };
 
-void RandomColorJitter(const nnvm::NodeAttrs &attrs,
+inline void RandomColorJitter(const nnvm::NodeAttrs &attrs,
                        const OpContext &ctx,
                        const std::vector<TBlob> &inputs,
                        const std::vector<OpReqType> &req,
@@ -623,7 +661,7 @@ struct RandomLightingParam : public dmlc::Parameter<RandomLightingParam> {
   }
 };
 
-void AdjustLightingImpl(const nnvm::Tuple<float>& alpha,
+inline void AdjustLightingImpl(const nnvm::Tuple<float>& alpha,
                         const OpContext &ctx,
                         const std::vector<TBlob> &inputs,
                         const std::vector<OpReqType> &req,
@@ -658,7 +696,7 @@ void AdjustLightingImpl(const nnvm::Tuple<float>& alpha,
   });
 }
 
-void AdjustLighting(const nnvm::NodeAttrs &attrs,
+inline void AdjustLighting(const nnvm::NodeAttrs &attrs,
                     const OpContext &ctx,
                     const std::vector<TBlob> &inputs,
                     const std::vector<OpReqType> &req,
@@ -668,7 +706,7 @@ void AdjustLighting(const nnvm::NodeAttrs &attrs,
   AdjustLightingImpl(param.alpha, ctx, inputs, req, outputs);
 }
 
-void RandomLighting(const nnvm::NodeAttrs &attrs,
+inline void RandomLighting(const nnvm::NodeAttrs &attrs,
                     const OpContext &ctx,
                     const std::vector<TBlob> &inputs,
                     const std::vector<OpReqType> &req,
@@ -684,6 +722,214 @@ void RandomLighting(const nnvm::NodeAttrs &attrs,
   AdjustLightingImpl({alpha_r, alpha_g, alpha_b}, ctx, inputs, req, outputs);
 }
 
+struct RandomAugmentParam : public dmlc::Parameter<RandomAugmentParam> {
+  bool flip_left_right;
+  bool flip_top_bottom;
+  float brightness;
+  float contrast;
+  float saturation;
+  float hue;
+  float alpha_std;
+  DMLC_DECLARE_PARAMETER(RandomAugmentParam) {
+    DMLC_DECLARE_FIELD(flip_left_right)
+    .set_default(false)
+    .describe("Whether to flip each image left to right with probability 0.5.");
+    DMLC_DECLARE_FIELD(flip_top_bottom)
+    .set_default(false)
+    .describe("Whether to flip each image top to bottom with probability 0.5.");
+    DMLC_DECLARE_FIELD(brightness)
+    .set_default(0)
+    .set_lower_bound(0)
+    .describe("How much to jitter brightness, 0 to disable.");
+    DMLC_DECLARE_FIELD(contrast)
+    .set_default(0)
+    .set_lower_bound(0)
+    .describe("How much to jitter contrast, 0 to disable.");
+    DMLC_DECLARE_FIELD(saturation)
+    .set_default(0)
+    .set_lower_bound(0)
+    .describe("How much to jitter saturation, 0 to disable.");
+    DMLC_DECLARE_FIELD(hue)
+    .set_default(0)
+    .set_lower_bound(0)
+    .describe("How much to jitter hue, 0 to disable.");
+    DMLC_DECLARE_FIELD(alpha_std)
+    .set_default(0)
+    .set_lower_bound(0)
+    .describe("Level of the lighting noise, 0 to disable.");
+  }
+};
+
+inline bool RandomAugmentShape(const nnvm::NodeAttrs& attrs,
+                               std::vector<TShape> *in_attrs,
+                               std::vector<TShape> *out_attrs) {
+  CHECK_EQ(in_attrs->size(), 1U);
+  CHECK_EQ(out_attrs->size(), 1U);
+  const TShape &dshape = (*in_attrs)[0];
+  if (!dshape.ndim()) return false;
+  CHECK(dshape.ndim() == 3 || dshape.ndim() == 4)
+      << "Input image must have shape (height, width, channels) or "
+      << "(batch, height, width, channels), but got " << dshape;
+  auto nchannels = dshape[dshape.ndim()-1];
+  CHECK(nchannels == 3 || nchannels == 1)
+      << "The last dimension of input image must be the channel dimension with "
+      << "either 1 or 3 elements, but got input with shape " << dshape;
+  SHAPE_ASSIGN_CHECK(*out_attrs, 0, dshape);
+  return true;
+}
+
+/*! \brief per image parameters of random_augment, drawn by AugmentParamsKernel */
+enum AugmentParamIndex {
+  kAugFlipLeftRight, kAugFlipTopBottom, kAugBrightness, kAugContrast, kAugContrastBeta,
+  kAugSaturation, kAugHue, kAugLightR, kAugLightG, kAugLightB, kAugNumParams
+};
+
+/*! \brief sum of the gray values of one image row, for the mean of the contrast */
+struct AugmentGrayRowKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, float *row_gray, const DType *in,
+                                  const int width, const int channels) {
+    const DType *row = in + static_cast<size_t>(i) * width * channels;
+    float sum = 0.f;
+    for (int w = 0; w < width; ++w) {
+      if (channels == 3) {
+        sum += 0.299f * static_cast<float>(row[3*w]) + 0.587f * static_cast<float>(row[3*w + 1]) +
+               0.114f * static_cast<float>(row[3*w + 2]);
+      } else {
+        sum += static_cast<float>(row[w]);
+      }
+    }
+    row_gray[i] = sum;
+  }
+};
+
+/*!
+ * \brief draw the parameters of image n from the counter based generator, so they do
+ *  not depend on how the batch is spread over threads. Disabled augmentations get
+ *  identity parameters.
+ */
+struct AugmentParamsKernel {
+  MSHADOW_XINLINE static void Map(int n, const common::random::PhiloxKey key, float *params,
+                                  const float *row_gray, const int height, const int width,
+                                  const bool flip_left_right, const bool flip_top_bottom,
+                                  const float brightness, const float contrast,
+                                  const float saturation, const float hue,
+                                  const float alpha_std) {
+    const float eig[3][3] = {
+      { 55.46f * -0.5675f, 4.794f * 0.7192f,  1.148f * 0.4009f },
+      { 55.46f * -0.5808f, 4.794f * -0.0045f, 1.148f * -0.8140f },
+      { 55.46f * -0.5836f, 4.794f * -0.6948f, 1.148f * 0.4203f }
+    };
+    common::random::PhiloxGenerator gen(key, n);
+    float u[4], v[4], z[4];
+    gen.Uniform(u);
+    gen.Uniform(v);
+    gen.Normal(z);
+    float *p = params + n * kAugNumParams;
+    p[kAugFlipLeftRight] = flip_left_right && u[0] < 0.5f;
+    p[kAugFlipTopBottom] = flip_top_bottom && u[1] < 0.5f;
+    p[kAugBrightness] = 1.f + brightness * (2.f * u[2] - 1.f);
+    p[kAugContrast] = 1.f + contrast * (2.f * u[3] - 1.f);
+    float gray_mean = 0.f;
+    if (row_gray != nullptr) {
+      for (int h = 0; h < height; ++h) gray_mean += row_gray[n * height + h];
+      gray_mean /= static_cast<float>(height) * width;
+    }
+    // brightness only scales the image, so the gray mean after it follows from the input
+    p[kAugContrastBeta] = (1.f - p[kAugContrast]) * p[kAugBrightness] * gray_mean;
+    p[kAugSaturation] = 1.f + saturation * (2.f * v[0] - 1.f);
+    p[kAugHue] = hue * (2.f * v[1] - 1.f);
+    for (int c = 0; c < 3; ++c) {
+      p[kAugLightR + c] = alpha_std * (eig[c][0] * z[0] + eig[c][1] * z[1] + eig[c][2] * z[2]);
+    }
+  }
+};
+
+/*!
+ * \brief one output pixel of random_augment: gather the flipped source pixel, then
+ *  apply brightness, contrast, saturation, hue and lighting in float, rounding once.
+ */
+struct AugmentApplyKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, DType *out, const DType *in, const float *params,
+                                  const int height, const int width, const int channels) {
+    const int w = i % width;
+    const int h = (i / width) % height;
+    const int n = i / width / height;
+    const float *p = params + n * kAugNumParams;
+    const int src_h = p[kAugFlipTopBottom] != 0.f ? height - 1 - h : h;
+    const int src_w = p[kAugFlipLeftRight] != 0.f ? width - 1 - w : w;
+    const DType *src = in + ((static_cast<size_t>(n) * height + src_h) * width + src_w) * channels;
+    const float scale = p[kAugBrightness] * p[kAugContrast];
+    float px[3];
+    for (int c = 0; c < channels; ++c) {
+      px[c] = static_cast<float>(src[c]) * scale + p[kAugContrastBeta];
+    }
+    if (channels == 3) {
+      const float alpha_s = p[kAugSaturation];
+      const float gray = (0.299f * px[0] + 0.587f * px[1] + 0.114f * px[2]) * (1.f - alpha_s);
+      for (int c = 0; c < 3; ++c) px[c] = gray + px[c] * alpha_s;
+      if (p[kAugHue] != 0.f) {
+        float hh, l, s;
+        RGB2HLSConvert(px[0], px[1], px[2], &hh, &l, &s);
+        HLS2RGBConvert(hh + p[kAugHue] * 360.f, l, s, &px[0], &px[1], &px[2]);
+      }
+      for (int c = 0; c < 3; ++c) px[c] += p[kAugLightR + c];
+    }
+    DType *dst = out + static_cast<size_t>(i) * channels;
+    for (int c = 0; c < channels; ++c) dst[c] = saturate_cast<DType>(px[c]);
+  }
+};
+
+/*!
+ * \brief random flips, brightness, contrast, saturation, hue and lighting of a whole
+ *  batch in one pass over the pixels, with independent parameters per image.
+ */
+template<typename xpu>
+void RandomAugment(const nnvm::NodeAttrs &attrs,
+                   const OpContext &ctx,
+                   const std::vector<TBlob> &inputs,
+                   const std::vector<OpReqType> &req,
+                   const std::vector<TBlob> &outputs) {
+  using namespace mshadow;
+  using namespace mxnet_op;
+  const RandomAugmentParam &param = nnvm::get<RandomAugmentParam>(attrs.parsed);
+  CHECK_EQ(req[0], kWriteTo)
+    << "`random_augment` does not support inplace";
+  const TShape &shape = inputs[0].shape_;
+  const int ndim = shape.ndim();
+  const int batch = ndim == 4 ? shape[0] : 1;
+  const int height = shape[ndim - 3];
+  const int width = shape[ndim - 2];
+  const int channels = shape[ndim - 1];
+  if (shape.Size() == 0) return;
+
+  Stream<xpu> *s = ctx.get_stream<xpu>();
+  common::random::RandGenerator<xpu, float> *pgen =
+    ctx.requested[0].get_parallel_random<xpu, float>();
+  CHECK_NOTNULL(pgen);
+  const bool contrast = param.contrast > 0;
+  Tensor<xpu, 1, float> workspace = ctx.requested[1].get_space_typed<xpu, 1, float>(
+    Shape1(batch * kAugNumParams + (contrast ? batch * height : 0)), s);
+  float *params = workspace.dptr_;
+  float *row_gray = contrast ? params + batch * kAugNumParams : nullptr;
+
+  MSHADOW_TYPE_SWITCH(outputs[0].type_flag_, DType, {
+    const DType *input = inputs[0].dptr<DType>();
+    if (contrast) {
+      Kernel<AugmentGrayRowKernel, xpu>::Launch(s, batch * height, row_gray, input,
+                                                width, channels);
+    }
+    Kernel<AugmentParamsKernel, xpu>::Launch(s, batch, pgen->NextPhiloxKey(), params, row_gray,
+                                             height, width, param.flip_left_right,
+                                             param.flip_top_bottom, param.brightness,
+                                             param.contrast, param.saturation, param.hue,
+                                             param.alpha_std);
+    Kernel<AugmentApplyKernel, xpu>::Launch(s, batch * height * width, outputs[0].dptr<DType>(),
+                                            input, params, height, width, channels);
+  });
+}
+
 
 #define MXNET_REGISTER_IMAGE_AUG_OP(name)                                   \
   NNVM_REGISTER_OP(name)                                                    \
@@ -37,6 +37,7 @@ DMLC_REGISTER_PARAMETER(RandomEnhanceParam);
 DMLC_REGISTER_PARAMETER(AdjustLightingParam);
 DMLC_REGISTER_PARAMETER(RandomLightingParam);
 DMLC_REGISTER_PARAMETER(RandomColorJitterParam);
+DMLC_REGISTER_PARAMETER(RandomAugmentParam);
 
 NNVM_REGISTER_OP(_image_to_tensor)
 .describe(R"code()code" ADD_FILELINE)
@@ -44,7 +45,7 @@ NNVM_REGISTER_OP(_image_to_tensor)
 .set_num_outputs(1)
 .set_attr<nnvm::FInferShape>("FInferShape", ToTensorShape)
 .set_attr<nnvm::FInferType>("FInferType", ToTensorType)
-.set_attr<FCompute>("FCompute<cpu>", ToTensor)
+.set_attr<FCompute>("FCompute<cpu>", ToTensor<cpu>)
 .set_attr<nnvm::FGradient>("FGradient", ElemwiseGradUseNone{ "_copy" })
 .add_argument("data", "NDArray-or-Symbol", "The input.");
 
@@ -59,14 +60,14 @@ NNVM_REGISTER_OP(_image_normalize)
   [](const NodeAttrs& attrs){
     return std::vector<std::pair<int, int> >{{0, 0}};
   })
-.set_attr<FCompute>("FCompute<cpu>", Normalize)
+.set_attr<FCompute>("FCompute<cpu>", Normalize<cpu>)
 .set_attr<nnvm::FGradient>("FGradient", ElemwiseGradUseNone{ "_copy" })
 .add_argument("data", "NDArray-or-Symbol", "The input.")
 .add_arguments(NormalizeParam::__FIELDS__());
 
 MXNET_REGISTER_IMAGE_AUG_OP(_image_flip_left_right)
 .describe(R"code()code" ADD_FILELINE)
-.set_attr<FCompute>("FCompute<cpu>", FlipLeftRight);
+.set_attr<FCompute>("FCompute<cpu>", FlipLeftRight<cpu>);
 
 MXNET_REGISTER_IMAGE_RND_AUG_OP(_image_random_flip_left_right)
 .describe(R"code()code" ADD_FILELINE)
@@ -74,7 +75,7 @@ MXNET_REGISTER_IMAGE_RND_AUG_OP(_image_random_flip_left_right)
 
 MXNET_REGISTER_IMAGE_AUG_OP(_image_flip_top_bottom)
 .describe(R"code()code" ADD_FILELINE)
-.set_attr<FCompute>("FCompute<cpu>", FlipTopBottom);
+.set_attr<FCompute>("FCompute<cpu>", FlipTopBottom<cpu>);
 
 MXNET_REGISTER_IMAGE_RND_AUG_OP(_image_random_flip_top_bottom)
 .describe(R"code()code" ADD_FILELINE)
@@ -127,6 +128,29 @@ MXNET_REGISTER_IMAGE_RND_AUG_OP(_image_random_lighting)
 .set_attr<FCompute>("FCompute<cpu>", RandomLighting)
 .add_arguments(RandomLightingParam::__FIELDS__());
 
+NNVM_REGISTER_OP(_image_random_augment)
+.describe(R"code(Randomly augment a batch of images in one pass.
+
+The input is an image of shape (height, width, channels) or a batch of shape
+(batch, height, width, channels). Each image gets its own random flips,
+brightness, contrast, saturation, hue and lighting, applied in this order, and
+the values are only saturated once at the end.
+)code" ADD_FILELINE)
+.set_num_inputs(1)
+.set_num_outputs(1)
+.set_attr_parser(ParamParser<RandomAugmentParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", RandomAugmentShape)
+.set_attr<nnvm::FInferType>("FInferType", ElemwiseType<1, 1>)
+.set_attr<FResourceRequest>("FResourceRequest",
+  [](const NodeAttrs& attrs) {
+    return std::vector<ResourceRequest>{ResourceRequest::kParallelRandom,
+                                        ResourceRequest::kTempSpace};
+  })
+.set_attr<FCompute>("FCompute<cpu>", RandomAugment<cpu>)
+.set_attr<nnvm::FGradient>("FGradient", MakeZeroGradNodes)
+.add_argument("data", "NDArray-or-Symbol", "The input.")
+.add_arguments(RandomAugmentParam::__FIELDS__());
+
 }  // namespace image
 }  // namespace op
 }  // namespace mxnet
@@ -0,0 +1,49 @@
+/*
+* Licensed to the Apache Software Foundation (ASF) under one
+* or more contributor license agreements.  See the NOTICE file
+* distributed with this work for additional information
+* regarding copyright ownership.  The ASF licenses this file
+* to you under the Apache License, Version 2.0 (the
+* "License"); you may not use this file except in compliance
+* with the License.  You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+* KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations
+* under the License.
+*/
+
+/*!
+* \file image_random.cu
+* \brief GPU implementation of the image operators
+*/
+
+#include "./image_random-inl.h"
+#include "../elemwise_op_common.h"
+
+namespace mxnet {
+namespace op {
+namespace image {
+
+NNVM_REGISTER_OP(_image_to_tensor)
+.set_attr<FCompute>("FCompute<gpu>", ToTensor<gpu>);
+
+NNVM_REGISTER_OP(_image_normalize)
+.set_attr<FCompute>("FCompute<gpu>", Normalize<gpu>);
+
+NNVM_REGISTER_OP(_image_flip_left_right)
+.set_attr<FCompute>("FCompute<gpu>", FlipLeftRight<gpu>);
+
+NNVM_REGISTER_OP(_image_flip_top_bottom)
+.set_attr<FCompute>("FCompute<gpu>", FlipTopBottom<gpu>);
+
+NNVM_REGISTER_OP(_image_random_augment)
+.set_attr<FCompute>("FCompute<gpu>", RandomAugment<gpu>);
+
+}  // namespace image
+}  // namespace op
+}  // namespace mxnet
@@ -35,6 +35,8 @@
 #include <utility>
 #include "./operator_common.h"
 #include "./mshadow_op.h"
+#include "./mxnet_op.h"
+#include "./row_stats.h"
 
 namespace mxnet {
 namespace op {
@@ -42,7 +44,7 @@ namespace op {
 namespace instance_norm {
 enum InstanceNormInputs { kData, kGamma, kBeta };
 enum InstanceNormOutputs { kOut, kMean, kVar };
-enum InstanceNormBackResource { kTempSpace };
+enum InstanceNormResource { kTempSpace };
 }  // namespace instance_norm
 
 struct InstanceNormParam : public dmlc::Parameter<InstanceNormParam> {
@@ -53,6 +55,66 @@ struct InstanceNormParam : public dmlc::Parameter<InstanceNormParam> {
   }
 };  // struct InstanceNormParam
 
+/*! \brief out = gamma * (data - mean) / sqrt(var + eps) + beta of a (n * c, row_size) input */
+template <int req>
+struct instance_norm_forward {
+  MSHADOW_XINLINE static void Map(int i, real_t *out, const real_t *data,
+                                  const real_t *mean, const real_t *var,
+                                  const real_t *gamma, const real_t *beta,
+                                  const int channels, const int row_size,
+                                  const real_t eps) {
+    const int r = i / row_size;
+    const int c = r % channels;
+    const real_t scale = gamma[c] / math::sqrt(var[r] + eps);
+    KERNEL_ASSIGN(out[i], req, (data[i] - mean[r]) * scale + beta[c]);
+  }
+};
+
+/*!
+ * \brief data gradient from the row sums sum_g of ograd and sum_gx of
+ *  ograd * (data - mean), with inv_std = 1 / sqrt(var + eps) it is
+ *  gamma * inv_std * (ograd - mean(ograd) - x_hat * mean(ograd * x_hat))
+ */
+template <int req>
+struct instance_norm_data_grad {
+  MSHADOW_XINLINE static void Map(int i, real_t *gdata, const real_t *gout,
+                                  const real_t *data, const real_t *mean,
+                                  const real_t *var, const real_t *gamma,
+                                  const real_t *sum_g, const real_t *sum_gx,
+                                  const int channels, const int row_size,
+                                  const real_t eps) {
+    const int r = i / row_size;
+    const real_t inv_std = 1.0f / math::sqrt(var[r] + eps);
+    const real_t d = data[i] - mean[r];
+    KERNEL_ASSIGN(gdata[i], req,
+                  gamma[r % channels] * inv_std *
+                  (gout[i] - (sum_g[r] + d * inv_std * inv_std * sum_gx[r]) / row_size));
+  }
+};
+
+/*! \brief gamma and beta gradients of channel c, summed over the n instances */
+struct instance_norm_gamma_beta_grad {
+  MSHADOW_XINLINE static void Map(int c, real_t *ggamma, real_t *gbeta,
+                                  const real_t *var, const real_t *sum_g,
+                                  const real_t *sum_gx, const int n,
+                                  const int channels, const real_t eps,
+                                  const OpReqType req_gamma,
+                                  const OpReqType req_beta) {
+    real_t acc_gamma = 0, acc_beta = 0;
+    for (int k = 0; k < n; ++k) {
+      const int r = k * channels + c;
+      acc_gamma += sum_gx[r] / math::sqrt(var[r] + eps);
+      acc_beta += sum_g[r];
+    }
+    KERNEL_ASSIGN(ggamma[c], req_gamma, acc_gamma);
+    KERNEL_ASSIGN(gbeta[c], req_beta, acc_beta);
+  }
+};
+
+/*!
+ * \brief The statistics of the n * c rows are taken in one read of the data,
+ *  by row_stats, and every output is then written by a single elementwise kernel.
+ */
 template <typename xpu>
 class InstanceNormOp : public Operator {
  public:
@@ -62,7 +124,7 @@ class InstanceNormOp : public Operator {
                        const std::vector<TBlob> &out_data,
                        const std::vector<TBlob> &aux_states) {
     using namespace mshadow;
-    using namespace mshadow::expr;
+    using namespace mxnet_op;
     CHECK_EQ(in_data.size(), 3U);
     CHECK_EQ(out_data.size(), 3U);
 
@@ -70,35 +132,33 @@ class InstanceNormOp : public Operator {
         << "InstanceNorm only supports input tensors of rank >= 3.";
 
     Stream<xpu> *s = ctx.get_stream<xpu>();
-    int n = in_data[instance_norm::kData].size(0);
-    int c = in_data[instance_norm::kData].size(1);
-    int rest_dim =
-        static_cast<int>(in_data[instance_norm::kData].Size() / n / c);
-    Shape<2> s2 = Shape2(n * c, rest_dim);
-    const real_t scale = static_cast<real_t>(1) / static_cast<real_t>(rest_dim);
-    // Get Inputs
-    Tensor<xpu, 2> data =
-        in_data[instance_norm::kData].get_with_shape<xpu, 2, real_t>(s2, s);
-    Tensor<xpu, 1> gamma =
-        in_data[instance_norm::kGamma].get<xpu, 1, real_t>(s);
-    Tensor<xpu, 1> beta = in_data[instance_norm::kBeta].get<xpu, 1, real_t>(s);
-    // Get Outputs
-    Tensor<xpu, 2> out =
-        out_data[instance_norm::kOut].get_with_shape<xpu, 2, real_t>(s2, s);
-    Tensor<xpu, 1> var = out_data[instance_norm::kVar].FlatTo1D<xpu, real_t>(s);
-    Tensor<xpu, 1> mean =
-        out_data[instance_norm::kMean].FlatTo1D<xpu, real_t>(s);
+    const TBlob &data = in_data[instance_norm::kData];
+    const int n = data.size(0);
+    const int c = data.size(1);
+    const int rest_dim = static_cast<int>(data.Size() / n / c);
+    const int nrows = n * c;
+    if (data.Size() == 0) return;
+    real_t *mean = out_data[instance_norm::kMean].dptr<real_t>();
+    real_t *var = out_data[instance_norm::kVar].dptr<real_t>();
     // Calculate mean + var
-    mean = scale * sumall_except_dim<0>(data);
-    var = scale * sumall_except_dim<0>(F<mshadow_op::square>(
-                      data - broadcast<0>(mean, data.shape_)));
-    Assign(
-        out, req[instance_norm::kOut],
-        broadcast<0>(reshape(repmat(gamma, n), Shape1(n * c)), out.shape_) *
-                (data - broadcast<0>(mean, data.shape_)) /
-                F<mshadow_op::square_root>(
-                    broadcast<0>(var + param_.eps, data.shape_)) +
-            broadcast<0>(reshape(repmat(beta, n), Shape1(n * c)), out.shape_));
+    const int parts = row_stats::NumParts(s, nrows, rest_dim);
+    Tensor<xpu, 1> workspace =
+        ctx.requested[instance_norm::kTempSpace].get_space<xpu>(
+            Shape1(2 * nrows * parts), s);
+    real_t *part_mean = workspace.dptr_;
+    real_t *part_m2 = part_mean + nrows * parts;
+    row_stats::PartMeanM2(s, nrows, rest_dim, parts, data.dptr<real_t>(),
+                          part_mean, part_m2);
+    Kernel<row_stats::merge_mean_var, xpu>::Launch(s, nrows, rest_dim, parts,
+                                                   part_mean, part_m2, mean, var);
+    MXNET_ASSIGN_REQ_SWITCH(req[instance_norm::kOut], Req, {
+      Kernel<instance_norm_forward<Req>, xpu>::Launch(
+          s, data.Size(), out_data[instance_norm::kOut].dptr<real_t>(),
+          data.dptr<real_t>(), mean, var,
+          in_data[instance_norm::kGamma].dptr<real_t>(),
+          in_data[instance_norm::kBeta].dptr<real_t>(), c, rest_dim,
+          static_cast<real_t>(param_.eps));
+    });
   }
 
   virtual void Backward(const OpContext &ctx,
@@ -109,7 +169,7 @@ class InstanceNormOp : public Operator {
                         const std::vector<TBlob> &in_grad,
                         const std::vector<TBlob> &aux_states) {
     using namespace mshadow;
-    using namespace mshadow::expr;
+    using namespace mxnet_op;
     CHECK_EQ(in_data.size(), 3U);
     CHECK_EQ(out_data.size(), 3U);
 
@@ -117,71 +177,46 @@ class InstanceNormOp : public Operator {
         << "InstanceNorm only supports input tensors of rank > 2.";
 
     Stream<xpu> *s = ctx.get_stream<xpu>();
-    int n = in_data[instance_norm::kData].size(0);
-    int c = in_data[instance_norm::kData].size(1);
-    int rest_dim =
-        static_cast<int>(in_data[instance_norm::kData].Size() / n / c);
-    Shape<2> s2 = Shape2(n * c, rest_dim);
-    Shape<3> s3 = Shape3(n, c, rest_dim);
-    const real_t scale = static_cast<real_t>(1) / static_cast<real_t>(rest_dim);
-    // Get Inputs
-    Tensor<xpu, 2> data =
-        in_data[instance_norm::kData].get_with_shape<xpu, 2, real_t>(s2, s);
-    Tensor<xpu, 2> gdata =
-        in_grad[instance_norm::kData].get_with_shape<xpu, 2, real_t>(s2, s);
-    Tensor<xpu, 1> gamma =
-        in_data[instance_norm::kGamma].get<xpu, 1, real_t>(s);
-    Tensor<xpu, 1> ggamma =
-        in_grad[instance_norm::kGamma].get<xpu, 1, real_t>(s);
-    Tensor<xpu, 1> gbeta = in_grad[instance_norm::kBeta].get<xpu, 1, real_t>(s);
-    // Get Outputs
-    Tensor<xpu, 2> gout =
-        out_grad[instance_norm::kOut].get_with_shape<xpu, 2, real_t>(s2, s);
-    Tensor<xpu, 1> var = out_data[instance_norm::kVar].FlatTo1D<xpu, real_t>(s);
-    Tensor<xpu, 1> mean =
-        out_data[instance_norm::kMean].FlatTo1D<xpu, real_t>(s);
+    const TBlob &data = in_data[instance_norm::kData];
+    const int n = data.size(0);
+    const int c = data.size(1);
+    const int rest_dim = static_cast<int>(data.Size() / n / c);
+    const int nrows = n * c;
+    if (data.Size() == 0) return;
+    const real_t eps = static_cast<real_t>(param_.eps);
+    const real_t *gout = out_grad[instance_norm::kOut].dptr<real_t>();
+    const real_t *mean = out_data[instance_norm::kMean].dptr<real_t>();
+    const real_t *var = out_data[instance_norm::kVar].dptr<real_t>();
     // Get temp space
-    Tensor<xpu, 2> workspace =
+    const int parts = row_stats::NumParts(s, nrows, rest_dim);
+    Tensor<xpu, 1> workspace =
         ctx.requested[instance_norm::kTempSpace].get_space<xpu>(
-            mshadow::Shape2(3, mean.shape_[0]), s);
-    Tensor<xpu, 1> gmean = workspace[0];
-    Tensor<xpu, 1> gvar = workspace[1];
-    Tensor<xpu, 1> tmp = workspace[2];
-
-    // calculate temps
-    gvar = sumall_except_dim<0>(
-        (gout *
-         broadcast<0>(reshape(repmat(gamma, n), Shape1(n * c)), data.shape_)) *
-        (data - broadcast<0>(mean, data.shape_)) * -0.5f *
-        F<mshadow_op::power>(broadcast<0>(var + param_.eps, data.shape_),
-                             -1.5f));
-    gmean = sumall_except_dim<0>(
-        gout *
-        broadcast<0>(reshape(repmat(gamma, n), Shape1(n * c)), data.shape_));
-    gmean *= -1.0f / F<mshadow_op::square_root>(var + param_.eps);
-    tmp = scale * sumall_except_dim<0>(
-                      -2.0f * (data - broadcast<0>(mean, data.shape_)));
-    tmp *= gvar;
-    gmean += tmp;
+            Shape1(2 * nrows * (parts + 1)), s);
+    real_t *part_g = workspace.dptr_;
+    real_t *part_gx = part_g + nrows * parts;
+    real_t *sum_g = part_gx + nrows * parts;
+    real_t *sum_gx = sum_g + nrows;
+
+    // row sums of ograd and ograd * (data - mean)
+    row_stats::PartSums(s, nrows, rest_dim, parts, gout, data.dptr<real_t>(),
+                        mean, part_g, part_gx);
+    Kernel<row_stats::merge_sums, xpu>::Launch(s, nrows, parts, part_g, sum_g);
+    Kernel<row_stats::merge_sums, xpu>::Launch(s, nrows, parts, part_gx, sum_gx);
 
     // Calculate grads
-    Assign(gbeta, req[instance_norm::kBeta],
-           sumall_except_dim<0>(swapaxis<1, 0>(reshape(gout, s3))));
-    Assign(ggamma, req[instance_norm::kGamma],
-           sumall_except_dim<0>(swapaxis<1, 0>(
-               reshape(gout * (data - broadcast<0>(mean, data.shape_)) /
-                           F<mshadow_op::square_root>(
-                               broadcast<0>(var + param_.eps, data.shape_)),
-                       s3))));
-    Assign(gdata, req[instance_norm::kData],
-           (gout * broadcast<0>(reshape(repmat(gamma, n), Shape1(n * c)),
-                                data.shape_)) *
-                   broadcast<0>(
-                       1.0f / F<mshadow_op::square_root>(var + param_.eps),
-                       data.shape_) +
-               broadcast<0>(gvar, data.shape_) * scale * 2.0f *
-                   (data - broadcast<0>(mean, data.shape_)) +
-               broadcast<0>(gmean, data.shape_) * scale);
+    MXNET_ASSIGN_REQ_SWITCH(req[instance_norm::kData], Req, {
+      Kernel<instance_norm_data_grad<Req>, xpu>::Launch(
+          s, data.Size(), in_grad[instance_norm::kData].dptr<real_t>(), gout,
+          data.dptr<real_t>(), mean, var,
+          in_data[instance_norm::kGamma].dptr<real_t>(), sum_g, sum_gx, c,
+          rest_dim, eps);
+    });
+    if (req[instance_norm::kGamma] == kNullOp &&
+        req[instance_norm::kBeta] == kNullOp) return;
+    Kernel<instance_norm_gamma_beta_grad, xpu>::Launch(
+        s, c, in_grad[instance_norm::kGamma].dptr<real_t>(),
+        in_grad[instance_norm::kBeta].dptr<real_t>(), var, sum_g, sum_gx, n, c,
+        eps, req[instance_norm::kGamma], req[instance_norm::kBeta]);
   }
 
  private:
@@ -235,6 +270,11 @@ class InstanceNormProp : public OperatorProperty {
             in_data[instance_norm::kGamma]};
   }
 
+  std::vector<ResourceRequest> ForwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    return {ResourceRequest::kTempSpace};
+  }
+
   std::vector<ResourceRequest> BackwardResource(
       const std::vector<TShape> &in_shape) const override {
     return {ResourceRequest::kTempSpace};
@@ -34,6 +34,8 @@
 #include <utility>
 #include "./operator_common.h"
 #include "./mshadow_op.h"
+#include "./mxnet_op.h"
+#include "./row_stats.h"
 
 namespace mxnet {
 namespace op {
@@ -44,7 +46,7 @@ namespace l2_normalization {
 enum L2NormalizationOpInputs {kData};
 enum L2NormalizationOpOutputs {kOut, kNorm};
 enum L2NormalizationOpType {kInstance, kChannel, kSpatial};
-enum L2NormalizationBackResource {kTempSpace};
+enum L2NormalizationResource {kTempSpace};
 }  // l2_normalization
 
 struct L2NormalizationParam : public dmlc::Parameter<L2NormalizationParam> {
@@ -62,6 +64,40 @@ struct L2NormalizationParam : public dmlc::Parameter<L2NormalizationParam> {
   }
 };
 
+/*! \brief norm[r] = sqrt(sum of the parts of row r + eps) */
+struct l2_norm_rows {
+  template<typename AType, typename DType>
+  MSHADOW_XINLINE static void Map(int r, const int parts, const AType* part, DType* norm,
+                                  const AType eps) {
+    AType acc = eps;
+    for (int p = 0; p < parts; ++p) acc += part[r * parts + p];
+    norm[r] = DType(math::sqrt(acc));
+  }
+};
+
+/*! \brief out = data / norm of its row */
+struct l2_normalize_rows {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, DType* out, const DType* data, const DType* norm,
+                                  const int row_size) {
+    out[i] = data[i] / norm[i / row_size];
+  }
+};
+
+/*! \brief grad_in = (grad_out - out * sum(grad_out * out)) / norm within a row */
+template<int req>
+struct l2_normalize_rows_grad {
+  template<typename DType, typename AType>
+  MSHADOW_XINLINE static void Map(int i, DType* grad_in, const DType* grad_out,
+                                  const DType* out, const DType* norm, const AType* dot,
+                                  const int row_size) {
+    const int r = i / row_size;
+    KERNEL_ASSIGN(grad_in[i], req,
+                  DType((static_cast<AType>(grad_out[i]) - static_cast<AType>(out[i]) * dot[r]) /
+                        static_cast<AType>(norm[r])));
+  }
+};
+
 /**
  * \brief This is the implementation of l2 normalization operator.
  * \tparam xpu The device that the op will be executed on.
@@ -87,20 +123,8 @@ class L2NormalizationOp : public Operator {
     Stream<xpu> *s = ctx.get_stream<xpu>();
     TShape orig_shape = in_data[l2_normalization::kData].shape_;
     if (param_.mode == l2_normalization::kInstance) {
-      Shape<2> dshape = Shape2(orig_shape[0],
-        orig_shape.ProdShape(1, orig_shape.ndim()));
-      Tensor<xpu, 2, DType> data = in_data[l2_normalization::kData]
-        .get_with_shape<xpu, 2, DType>(dshape, s);
-      Tensor<xpu, 2, DType> out = out_data[l2_normalization::kOut]
-        .get_with_shape<xpu, 2, DType>(dshape, s);
-      Tensor<xpu, 1, DType> norm = out_data[l2_normalization::kNorm].get<xpu, 1, DType>(s);
-      norm = sumall_except_dim<0>(F<mxnet::op::mshadow_op::square>(data));
-      MXNET_ASSIGN_REQ_SWITCH(req[0], Req, {
-        mxnet_op::Kernel<mxnet_op::op_with_req<mxnet::op::mshadow_op::plus, Req>, xpu>::Launch(
-          s, norm.size(0), norm.dptr_, norm.dptr_, DType(param_.eps));
-      });
-      norm = F<mxnet::op::mshadow_op::square_root>(norm);
-      out = data / broadcast<0>(norm, out.shape_);
+      ForwardRows(ctx, orig_shape[0], orig_shape.ProdShape(1, orig_shape.ndim()),
+                  in_data, out_data);
     } else if (param_.mode == l2_normalization::kChannel) {
       CHECK_GE(orig_shape.ndim(), 3U);
       Shape<3> dshape = Shape3(orig_shape[0], orig_shape[1],
@@ -121,22 +145,8 @@ class L2NormalizationOp : public Operator {
       out = data / broadcast_with_axis(norm, 0, orig_shape[1]);
     } else if (param_.mode == l2_normalization::kSpatial) {
       CHECK_GE(orig_shape.ndim(), 3U);
-      Shape<3> dshape = Shape3(orig_shape[0], orig_shape[1],
-        orig_shape.ProdShape(2, orig_shape.ndim()));
-      Tensor<xpu, 3, DType> data = in_data[l2_normalization::kData]
-        .get_with_shape<xpu, 3, DType>(dshape, s);
-      Tensor<xpu, 3, DType> out = out_data[l2_normalization::kOut]
-        .get_with_shape<xpu, 3, DType>(dshape, s);
-      Shape<2> norm_shape = Shape2(dshape[0], dshape[1]);
-      Tensor<xpu, 2, DType> norm = out_data[l2_normalization::kNorm]
-        .get_with_shape<xpu, 2, DType>(norm_shape, s);
-      norm = reduce_with_axis<red::sum, false>(F<mxnet::op::mshadow_op::square>(data), 2);
-      MXNET_ASSIGN_REQ_SWITCH(req[0], Req, {
-        mxnet_op::Kernel<mxnet_op::op_with_req<mxnet::op::mshadow_op::plus, Req>, xpu>::Launch(
-          s, norm.size(0) * norm.size(1), norm.dptr_, norm.dptr_, DType(param_.eps));
-      });
-      norm = F<mxnet::op::mshadow_op::square_root>(norm);
-      out = data / broadcast_with_axis(norm, 1, dshape[2]);
+      ForwardRows(ctx, orig_shape[0] * orig_shape[1], orig_shape.ProdShape(2, orig_shape.ndim()),
+                  in_data, out_data);
     } else {
       LOG(FATAL) << "Unexpected mode in l2 normalization";
     }
@@ -158,21 +168,8 @@ class L2NormalizationOp : public Operator {
     Stream<xpu> *s = ctx.get_stream<xpu>();
     TShape orig_shape = out_data[l2_normalization::kOut].shape_;
     if (param_.mode == l2_normalization::kInstance) {
-      Shape<2> dshape = Shape2(orig_shape[0],
-        orig_shape.ProdShape(1, orig_shape.ndim()));
-      Tensor<xpu, 2, DType> data = out_data[l2_normalization::kOut]
-        .get_with_shape<xpu, 2, DType>(dshape, s);
-      Tensor<xpu, 2, DType> grad_in = in_grad[l2_normalization::kData]
-        .get_with_shape<xpu, 2, DType>(dshape, s);
-      Tensor<xpu, 2, DType> grad_out = out_grad[l2_normalization::kOut]
-        .get_with_shape<xpu, 2, DType>(dshape, s);
-      Tensor<xpu, 1, DType> norm = out_data[l2_normalization::kNorm].get<xpu, 1, DType>(s);
-      Tensor<xpu, 1, DType> temp = ctx.requested[l2_normalization::kTempSpace]
-        .get_space_typed<xpu, 1, DType>(mshadow::Shape1(data.shape_[0]), s);
-      temp = sumall_except_dim<0>(grad_out * data);
-      Assign(grad_in, req[l2_normalization::kData],
-        (grad_out - data * broadcast<0>(temp, data.shape_)) /
-        broadcast<0>(norm, data.shape_));
+      BackwardRows(ctx, orig_shape[0], orig_shape.ProdShape(1, orig_shape.ndim()),
+                   out_grad, out_data, req, in_grad);
     } else if (param_.mode == l2_normalization::kChannel) {
       CHECK_GE(orig_shape.ndim(), 3U);
       Shape<3> dshape = Shape3(orig_shape[0], orig_shape[1],
@@ -194,29 +191,61 @@ class L2NormalizationOp : public Operator {
         broadcast_with_axis(norm, 0, orig_shape[1]));
     } else if (param_.mode == l2_normalization::kSpatial) {
       CHECK_GE(orig_shape.ndim(), 3U);
-      Shape<3> dshape = Shape3(orig_shape[0], orig_shape[1],
-        orig_shape.ProdShape(2, orig_shape.ndim()));
-      Tensor<xpu, 3, DType> data = out_data[l2_normalization::kOut]
-        .get_with_shape<xpu, 3, DType>(dshape, s);
-      Tensor<xpu, 3, DType> grad_in = in_grad[l2_normalization::kData]
-        .get_with_shape<xpu, 3, DType>(dshape, s);
-      Tensor<xpu, 3, DType> grad_out = out_grad[l2_normalization::kOut]
-        .get_with_shape<xpu, 3, DType>(dshape, s);
-      Shape<2> norm_shape = Shape2(dshape[0], dshape[1]);
-      Tensor<xpu, 2, DType> norm = out_data[l2_normalization::kNorm]
-        .get_with_shape<xpu, 2, DType>(norm_shape, s);
-      Tensor<xpu, 2, DType> temp = ctx.requested[l2_normalization::kTempSpace]
-        .get_space_typed<xpu, 2, DType>(mshadow::Shape2(data.shape_[0], data.shape_[1]), s);
-      temp = reduce_with_axis<red::sum, false>(grad_out * data, 2);
-      Assign(grad_in, req[l2_normalization::kData],
-        (grad_out - data * broadcast_with_axis(temp, 1, dshape[2])) /
-        broadcast_with_axis(norm, 1, dshape[2]));
+      BackwardRows(ctx, orig_shape[0] * orig_shape[1], orig_shape.ProdShape(2, orig_shape.ndim()),
+                   out_grad, out_data, req, in_grad);
     } else {
       LOG(FATAL) << "Unexpected mode in l2 normalization";
     }
   }
 
  private:
+  typedef typename row_stats::AccType<DType>::type AType;
+
+  /*!
+   * \brief normalize every contiguous row, the instance and spatial modes, with the
+   *  sums of squares reduced in one read of the data by row_stats
+   */
+  void ForwardRows(const OpContext &ctx, const int nrows, const int row_size,
+                   const std::vector<TBlob> &in_data, const std::vector<TBlob> &out_data) {
+    using namespace mxnet_op;
+    mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
+    if (nrows * row_size == 0) return;
+    const DType *data = in_data[l2_normalization::kData].dptr<DType>();
+    DType *norm = out_data[l2_normalization::kNorm].dptr<DType>();
+    const int parts = row_stats::NumParts(s, nrows, row_size);
+    AType *part = ctx.requested[l2_normalization::kTempSpace]
+      .get_space_typed<xpu, 1, AType>(mshadow::Shape1(nrows * parts), s).dptr_;
+    row_stats::PartSums(s, nrows, row_size, parts, data, data,
+                        static_cast<const AType*>(nullptr), static_cast<AType*>(nullptr), part);
+    Kernel<l2_norm_rows, xpu>::Launch(s, nrows, parts, part, norm,
+                                      static_cast<AType>(param_.eps));
+    Kernel<l2_normalize_rows, xpu>::Launch(s, nrows * row_size,
+                                           out_data[l2_normalization::kOut].dptr<DType>(),
+                                           data, norm, row_size);
+  }
+
+  void BackwardRows(const OpContext &ctx, const int nrows, const int row_size,
+                    const std::vector<TBlob> &out_grad, const std::vector<TBlob> &out_data,
+                    const std::vector<OpReqType> &req, const std::vector<TBlob> &in_grad) {
+    using namespace mxnet_op;
+    mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
+    if (nrows * row_size == 0 || req[l2_normalization::kData] == kNullOp) return;
+    const DType *grad_out = out_grad[l2_normalization::kOut].dptr<DType>();
+    const DType *out = out_data[l2_normalization::kOut].dptr<DType>();
+    const int parts = row_stats::NumParts(s, nrows, row_size);
+    AType *part = ctx.requested[l2_normalization::kTempSpace]
+      .get_space_typed<xpu, 1, AType>(mshadow::Shape1(nrows * (parts + 1)), s).dptr_;
+    AType *dot = part + nrows * parts;
+    row_stats::PartSums(s, nrows, row_size, parts, grad_out, out,
+                        static_cast<const AType*>(nullptr), static_cast<AType*>(nullptr), part);
+    Kernel<row_stats::merge_sums, xpu>::Launch(s, nrows, parts, part, dot);
+    MXNET_ASSIGN_REQ_SWITCH(req[l2_normalization::kData], Req, {
+      Kernel<l2_normalize_rows_grad<Req>, xpu>::Launch(
+        s, nrows * row_size, in_grad[l2_normalization::kData].dptr<DType>(), grad_out, out,
+        out_data[l2_normalization::kNorm].dptr<DType>(), dot, row_size);
+    });
+  }
+
   L2NormalizationParam param_;
 };  // class L2NormalizationOp
 
@@ -314,6 +343,11 @@ class L2NormalizationProp : public OperatorProperty {
     return {{out_grad[l2_normalization::kOut], in_grad[l2_normalization::kData]}};
   }
 
+  std::vector<ResourceRequest> ForwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    return {ResourceRequest::kTempSpace};
+  }
+
   std::vector<ResourceRequest> BackwardResource(
       const std::vector<TShape> &in_shape) const override {
     return {ResourceRequest::kTempSpace};
@@ -30,6 +30,8 @@
 #include <algorithm>
 
 #include "../common/cuda_utils.h"
+#include "../engine/openmp.h"
+#include "./math_functions-inl.h"
 
 // Convenience functions.
 inline void linalg_check_batch_size(int A, int B, int C) {
@@ -38,6 +40,235 @@ inline void linalg_check_batch_size(int A, int B, int C) {
   CHECK_GT(A, 0) << "Zero batch size for arguments to linear algebra operator";
 }
 
+///////////////////////////// SMALL MATRICES /////////////////////////////////////
+
+// Batches of matrices of at most this size do not go through one BLAS/LAPACK call per
+// matrix, whose overhead dominates at these sizes. The kernels below keep a matrix in
+// registers with the loops over its size unrolled, and run over the batch with OpenMP
+// on cpu and with one thread per matrix on gpu.
+const int kLinalgSmallMatrix = 8;
+
+// Small gemm, C = alpha * op(A) * op(B) + beta * C for row-major matrices with K rows of op(B).
+// C is not read for beta = 0, as in BLAS.
+template<int K, typename DType>
+MSHADOW_XINLINE void linalg_small_gemm(const DType *A, int lda, const DType *B, int ldb,
+                                       DType *C, int ldc, int M, int N, DType alpha,
+                                       DType beta, bool tA, bool tB) {
+  for (int i = 0; i < M; ++i) {
+    DType a[K];
+    #pragma unroll
+    for (int k = 0; k < K; ++k) a[k] = (tA ? A[k * lda + i] : A[i * lda + k]);
+    for (int j = 0; j < N; ++j) {
+      DType sum(0);
+      #pragma unroll
+      for (int k = 0; k < K; ++k) sum += a[k] * (tB ? B[j * ldb + k] : B[k * ldb + j]);
+      C[i * ldc + j] = alpha * sum + (beta == DType(0) ? DType(0) : beta * C[i * ldc + j]);
+    }
+  }
+}
+
+// Small Cholesky factorization of a row-major N x N matrix, in place in the lower
+// (A = L * L^T) or upper (A = U^T * U) triangle. The other triangle is not referenced.
+// Returns false if the matrix is not positive definite.
+template<int N, typename DType>
+MSHADOW_XINLINE bool linalg_small_potrf(DType *A, int lda, bool lower) {
+  DType l[N][N];
+  #pragma unroll
+  for (int i = 0; i < N; ++i) {
+    #pragma unroll
+    for (int j = 0; j <= i; ++j) l[i][j] = (lower ? A[i * lda + j] : A[j * lda + i]);
+  }
+  bool ok(true);
+  #pragma unroll
+  for (int j = 0; j < N; ++j) {
+    DType d(l[j][j]);
+    #pragma unroll
+    for (int k = 0; k < j; ++k) d -= l[j][k] * l[j][k];
+    ok = ok && d > DType(0);
+    d = mxnet::op::math::sqrt(d);
+    l[j][j] = d;
+    #pragma unroll
+    for (int i = j + 1; i < N; ++i) {
+      DType v(l[i][j]);
+      #pragma unroll
+      for (int k = 0; k < j; ++k) v -= l[i][k] * l[j][k];
+      l[i][j] = v / d;
+    }
+  }
+  #pragma unroll
+  for (int i = 0; i < N; ++i) {
+    #pragma unroll
+    for (int j = 0; j <= i; ++j) (lower ? A[i * lda + j] : A[j * lda + i]) = l[i][j];
+  }
+  return ok;
+}
+
+// Small triangular solve, B = alpha * op(A)^-1 * B or B = alpha * B * op(A)^-1 for a
+// row-major N x N triangular A and M right hand sides.
+template<int N, typename DType>
+MSHADOW_XINLINE void linalg_small_trsm(const DType *A, int lda, DType *B, int ldb, int M,
+                                       DType alpha, bool rightside, bool lower,
+                                       bool transpose) {
+  // X * op(A) = B is solved as op(A)^T * X^T = B^T, so the right hand sides are the rows
+  // of B and the matrix is transposed once more.
+  const bool trans(transpose != rightside);
+  const bool tri_lower(lower != trans);
+  DType t[N][N];
+  #pragma unroll
+  for (int i = 0; i < N; ++i) {
+    #pragma unroll
+    for (int j = 0; j < N; ++j) t[i][j] = (trans ? A[j * lda + i] : A[i * lda + j]);
+  }
+  for (int r = 0; r < M; ++r) {
+    DType x[N];
+    #pragma unroll
+    for (int i = 0; i < N; ++i) x[i] = alpha * (rightside ? B[r * ldb + i] : B[i * ldb + r]);
+    if (tri_lower) {
+      #pragma unroll
+      for (int i = 0; i < N; ++i) {
+        #pragma unroll
+        for (int k = 0; k < i; ++k) x[i] -= t[i][k] * x[k];
+        x[i] /= t[i][i];
+      }
+    } else {
+      #pragma unroll
+      for (int i = N - 1; i >= 0; --i) {
+        #pragma unroll
+        for (int k = i + 1; k < N; ++k) x[i] -= t[i][k] * x[k];
+        x[i] /= t[i][i];
+      }
+    }
+    #pragma unroll
+    for (int i = 0; i < N; ++i) (rightside ? B[r * ldb + i] : B[i * ldb + r]) = x[i];
+  }
+}
+
+// Calls FN<N>::Call(args...) for the size 1 <= N <= kLinalgSmallMatrix of a matrix.
+#define LINALG_SMALL_SWITCH(N, FN, ...) \
+  switch (N) { \
+    case 1: FN<1>::Call(__VA_ARGS__); break; \
+    case 2: FN<2>::Call(__VA_ARGS__); break; \
+    case 3: FN<3>::Call(__VA_ARGS__); break; \
+    case 4: FN<4>::Call(__VA_ARGS__); break; \
+    case 5: FN<5>::Call(__VA_ARGS__); break; \
+    case 6: FN<6>::Call(__VA_ARGS__); break; \
+    case 7: FN<7>::Call(__VA_ARGS__); break; \
+    case 8: FN<8>::Call(__VA_ARGS__); break; \
+    default: LOG(FATAL) << "Matrix size " << N << " exceeds kLinalgSmallMatrix"; \
+  }
+
+template<int K>
+struct linalg_small_batch_gemm_cpu {
+  template<typename DType>
+  static void Call(const Tensor<cpu, 3, DType>& A, const Tensor<cpu, 3, DType>& B,
+                   const Tensor<cpu, 3, DType>& C, DType alpha, DType beta, bool tA, bool tB) {
+    const int batch(A.size(0));
+    const int omp_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount());
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int i = 0; i < batch; ++i) {
+      linalg_small_gemm<K>(A[i].dptr_, A.stride_, B[i].dptr_, B.stride_, C[i].dptr_, C.stride_,
+                           C.size(1), C.size(2), alpha, beta, tA, tB);
+    }
+  }
+};
+
+// Runs a batch gemm through the small matrix kernel, returns false if it is too large.
+template<typename DType>
+inline bool linalg_small_batch_gemm(const Tensor<cpu, 3, DType>& A,
+                                    const Tensor<cpu, 3, DType>& B,
+                                    const Tensor<cpu, 3, DType>& C,
+                                    DType alpha, DType beta, bool tA, bool tB) {
+  const int K(tA ? A.size(1) : A.size(2));
+  if (C.size(1) > kLinalgSmallMatrix || C.size(2) > kLinalgSmallMatrix ||
+      K > kLinalgSmallMatrix || K == 0) {
+    return false;
+  }
+  LINALG_SMALL_SWITCH(K, linalg_small_batch_gemm_cpu, A, B, C, alpha, beta, tA, tB);
+  return true;
+}
+
+template<int N>
+struct linalg_small_batch_potrf_cpu {
+  template<typename DType>
+  static void Call(const Tensor<cpu, 3, DType>& A, bool lower) {
+    const int batch(A.size(0));
+    const int omp_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount());
+    int failed(0);
+    #pragma omp parallel for num_threads(omp_threads) reduction(+:failed)
+    for (int i = 0; i < batch; ++i) {
+      failed += !linalg_small_potrf<N>(A[i].dptr_, A.stride_, lower);
+    }
+    CHECK_EQ(failed, 0) << "potrf failed on cpu, " << failed
+                        << " matrices of the batch are not positive definite.";
+  }
+};
+
+template<int N>
+struct linalg_small_batch_trsm_cpu {
+  template<typename DType>
+  static void Call(const Tensor<cpu, 3, DType>& A, const Tensor<cpu, 3, DType>& B,
+                   DType alpha, bool rightside, bool lower, bool transpose) {
+    const int batch(A.size(0));
+    const int M(rightside ? B.size(1) : B.size(2));
+    const int omp_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount());
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int i = 0; i < batch; ++i) {
+      linalg_small_trsm<N>(A[i].dptr_, A.stride_, B[i].dptr_, B.stride_, M, alpha,
+                           rightside, lower, transpose);
+    }
+  }
+};
+
+#ifdef __CUDACC__
+
+template<int N, typename DType>
+__global__ void linalgSmallBatchPotrfGPU(DType *A, int lda, int mstride, int batch,
+                                         bool lower) {
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < batch; i += blockDim.x * gridDim.x) {
+    linalg_small_potrf<N>(A + i * mstride, lda, lower);
+  }
+}
+
+template<int N, typename DType>
+__global__ void linalgSmallBatchTrsmGPU(const DType *A, int lda, int mstride_a, DType *B,
+                                        int ldb, int mstride_b, int M, int batch, DType alpha,
+                                        bool rightside, bool lower, bool transpose) {
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < batch; i += blockDim.x * gridDim.x) {
+    linalg_small_trsm<N>(A + i * mstride_a, lda, B + i * mstride_b, ldb, M, alpha,
+                         rightside, lower, transpose);
+  }
+}
+
+template<int N>
+struct linalg_small_batch_potrf_gpu {
+  template<typename DType>
+  static void Call(const Tensor<gpu, 3, DType>& A, bool lower, Stream<gpu> *s) {
+    using namespace mshadow::cuda;
+    const int batch(A.size(0));
+    const int ngrid(std::min(kMaxGridNum, (batch + kBaseThreadNum - 1) / kBaseThreadNum));
+    linalgSmallBatchPotrfGPU<N><<<ngrid, kBaseThreadNum, 0, Stream<gpu>::GetStream(s)>>>
+      (A.dptr_, A.stride_, A.size(1) * A.stride_, batch, lower);
+    MSHADOW_CUDA_POST_KERNEL_CHECK(linalgSmallBatchPotrfGPU);
+  }
+};
+
+template<int N>
+struct linalg_small_batch_trsm_gpu {
+  template<typename DType>
+  static void Call(const Tensor<gpu, 3, DType>& A, const Tensor<gpu, 3, DType>& B,
+                   DType alpha, bool rightside, bool lower, bool transpose, Stream<gpu> *s) {
+    using namespace mshadow::cuda;
+    const int batch(A.size(0));
+    const int ngrid(std::min(kMaxGridNum, (batch + kBaseThreadNum - 1) / kBaseThreadNum));
+    linalgSmallBatchTrsmGPU<N><<<ngrid, kBaseThreadNum, 0, Stream<gpu>::GetStream(s)>>>
+      (A.dptr_, A.stride_, A.size(1) * A.stride_, B.dptr_, B.stride_, B.size(1) * B.stride_,
+       (rightside ? B.size(1) : B.size(2)), batch, alpha, rightside, lower, transpose);
+    MSHADOW_CUDA_POST_KERNEL_CHECK(linalgSmallBatchTrsmGPU);
+  }
+};
+
+#endif  // __CUDACC__
+
 //////////////////////////////// GEMM ////////////////////////////////////////////
 
 // CPU/GPU-versions of BLAS3 function "gemm". Please refer to the BLAS3-documentation
@@ -103,8 +334,20 @@ void linalg_batch_gemm<xpu, DType>(const Tensor<xpu, 3, DType>& A, const Tensor<
 LINALG_CPU_GEMM(sgemm, float)
 LINALG_CPU_GEMM(dgemm, double)
 
-LINALG_XPU_BATCH_GEMM(cpu, float)
-LINALG_XPU_BATCH_GEMM(cpu, double)
+#define LINALG_CPU_BATCH_GEMM(DType) \
+template<> inline \
+void linalg_batch_gemm<cpu, DType>(const Tensor<cpu, 3, DType>& A, const Tensor<cpu, 3, DType>& B, \
+                                   const Tensor<cpu, 3, DType>& C, DType alpha, DType beta, \
+                                   bool tA, bool tB, Stream<cpu> *s) { \
+  linalg_check_batch_size(A.size(0), B.size(0), C.size(0)); \
+  check_gemm(A[0], B[0], C[0], alpha, beta, tA, tB); \
+  if (linalg_small_batch_gemm(A, B, C, alpha, beta, tA, tB)) return; \
+  for (index_t i = 0; i < A.size(0); ++i) { \
+    linalg_gemm(A[i], B[i], C[i], alpha, beta, tA, tB, s); \
+  } \
+}
+LINALG_CPU_BATCH_GEMM(float)
+LINALG_CPU_BATCH_GEMM(double)
 
 // Specialization of linalg_gemm<cpu, DType> for DType=mshadow::half::half_t.
 template<> inline
@@ -283,8 +526,24 @@ void linalg_batch_trsm<xpu, DType>(const Tensor<xpu, 3, DType>& A, const Tensor<
 LINALG_CPU_TRSM(strsm, float)
 LINALG_CPU_TRSM(dtrsm, double)
 
-LINALG_XPU_BATCH_TRSM(cpu, float)
-LINALG_XPU_BATCH_TRSM(cpu, double)
+#define LINALG_CPU_BATCH_TRSM(DType) \
+template<> inline \
+void linalg_batch_trsm<cpu, DType>(const Tensor<cpu, 3, DType>& A, const Tensor<cpu, 3, DType>& B, \
+                   DType alpha, bool rightside, bool lower, bool transpose, Stream<cpu> *s) { \
+  linalg_check_batch_size(A.size(0), B.size(0), B.size(0)); \
+  check_trsm(A[0], B[0], alpha, rightside, lower, transpose); \
+  if (A.size(1) <= kLinalgSmallMatrix && B.size(1) <= kLinalgSmallMatrix && \
+      B.size(2) <= kLinalgSmallMatrix) { \
+    LINALG_SMALL_SWITCH(A.size(1), linalg_small_batch_trsm_cpu, A, B, alpha, rightside, lower, \
+                        transpose); \
+    return; \
+  } \
+  for (index_t i = 0; i < A.size(0); ++i) { \
+    linalg_trsm(A[i], B[i], alpha, rightside, lower, transpose, s); \
+  } \
+}
+LINALG_CPU_BATCH_TRSM(float)
+LINALG_CPU_BATCH_TRSM(double)
 
 #ifdef __CUDACC__
 
@@ -308,8 +567,25 @@ void linalg_trsm<gpu, DType>(const Tensor<gpu, 2, DType>& A, const Tensor<gpu, 2
 LINALG_GPU_TRSM(Strsm, float)
 LINALG_GPU_TRSM(Dtrsm, double)
 
-LINALG_XPU_BATCH_TRSM(gpu, float)
-LINALG_XPU_BATCH_TRSM(gpu, double)
+#define LINALG_GPU_BATCH_TRSM(DType) \
+template<> inline \
+void linalg_batch_trsm<gpu, DType>(const Tensor<gpu, 3, DType>& A, const Tensor<gpu, 3, DType>& B, \
+                   DType alpha, bool rightside, bool lower, bool transpose, Stream<gpu> *s) { \
+  linalg_check_batch_size(A.size(0), B.size(0), B.size(0)); \
+  check_trsm(A[0], B[0], alpha, rightside, lower, transpose); \
+  if (A.size(1) <= kLinalgSmallMatrix && B.size(1) <= kLinalgSmallMatrix && \
+      B.size(2) <= kLinalgSmallMatrix) { \
+    CHECK_NOTNULL(s); \
+    LINALG_SMALL_SWITCH(A.size(1), linalg_small_batch_trsm_gpu, A, B, alpha, rightside, lower, \
+                        transpose, s); \
+    return; \
+  } \
+  for (index_t i = 0; i < A.size(0); ++i) { \
+    linalg_trsm(A[i], B[i], alpha, rightside, lower, transpose, s); \
+  } \
+}
+LINALG_GPU_BATCH_TRSM(float)
+LINALG_GPU_BATCH_TRSM(double)
 
 #endif  // __CUDACC__
 
@@ -515,6 +791,11 @@ LINALG_CPU_POTRF(dpotrf, double)
 #define LINALG_CPU_BATCH_POTRF(DType) \
 template<> inline \
 void linalg_batch_potrf<cpu, DType>(const Tensor<cpu, 3, DType>& A, bool lower, Stream<cpu> *s) { \
+  check_potrf(A[0], lower); \
+  if (A.size(1) <= kLinalgSmallMatrix) { \
+    LINALG_SMALL_SWITCH(A.size(1), linalg_small_batch_potrf_cpu, A, lower); \
+    return; \
+  } \
   for (index_t i = 0; i < A.size(0); ++i) { \
     linalg_potrf(A[i], lower); \
   } \
@@ -566,6 +847,10 @@ void linalg_batch_potrf<gpu, DType>(const Tensor<gpu, 3, DType>& A, bool lower,
   CHECK_NOTNULL(s); \
   CHECK_GT(A.size(0), 0); \
   check_potrf(A[0], lower); \
+  if (A.size(1) <= kLinalgSmallMatrix) { \
+    LINALG_SMALL_SWITCH(A.size(1), linalg_small_batch_potrf_gpu, A, lower, s); \
+    return; \
+  } \
   int buffsize(linalg_potrf_buffsize(A[0], lower, s)); \
   Storage::Handle buffer = Storage::Get()->Alloc(sizeof(DType)*buffsize, Context::GPU()); \
   Storage::Handle info = Storage::Get()->Alloc(sizeof(int), Context::GPU()); \
@@ -28,6 +28,7 @@
 #include <mxnet/operator_util.h>
 #include <vector>
 #include "./mshadow_op.h"
+#include "./mxnet_op.h"
 #include "./elemwise_op_common.h"
 
 namespace mxnet {
@@ -47,6 +48,78 @@ inline bool SoftmaxCrossEntropyShape(const nnvm::NodeAttrs& attrs,
   return true;
 }
 
+/*! \brief type the softmax statistics of a row are accumulated in */
+template<typename DType>
+struct SoftmaxCEAccType {
+  typedef float type;
+};
+
+template<>
+struct SoftmaxCEAccType<double> {
+  typedef double type;
+};
+
+/*!
+ * \brief one pass over a row for its max, the sum of exp(x - max) and the
+ *  clipped cross entropy -log(max(p[label], 1e-8)), cpu handles a row per thread
+ */
+struct SoftmaxCERowKernel {
+  template<typename DType, typename AType>
+  MSHADOW_XINLINE static void Map(int i, const DType* data, const DType* label,
+                                  const int num_classes, AType* row_max, AType* row_sum,
+                                  DType* loss) {
+    const DType* row = data + static_cast<size_t>(i) * num_classes;
+    AType m = row[0], sum = 1;
+    for (int j = 1; j < num_classes; ++j) {
+      const AType v = row[j];
+      if (v > m) {
+        sum = sum * math::exp(m - v) + 1;
+        m = v;
+      } else {
+        sum += math::exp(v - m);
+      }
+    }
+    row_max[i] = m;
+    row_sum[i] = sum;
+    if (loss != nullptr) {
+      const AType p = math::exp(static_cast<AType>(row[static_cast<int>(label[i])]) - m) / sum;
+      loss[i] = -math::log(p > AType(1e-8f) ? p : AType(1e-8f));
+    }
+  }
+};
+
+template<typename DType, typename AType>
+inline void SoftmaxCERowStats(mshadow::Stream<cpu>* s, const mshadow::Tensor<cpu, 2, DType>& data,
+                              const DType* label, AType* row_max, AType* row_sum, DType* loss) {
+  mxnet_op::Kernel<SoftmaxCERowKernel, cpu>::Launch(s, data.size(0), data.dptr_, label,
+                                                     static_cast<int>(data.size(1)),
+                                                     row_max, row_sum, loss);
+}
+
+/*! \brief gpu reduces every row with a block */
+template<typename DType, typename AType>
+void SoftmaxCERowStats(mshadow::Stream<gpu>* s, const mshadow::Tensor<gpu, 2, DType>& data,
+                       const DType* label, AType* row_max, AType* row_sum, DType* loss);
+
+/*! \brief grad = scale * (softmax(data) - one_hot(label)) from the row statistics */
+template<int req>
+struct SoftmaxCEGradKernel {
+  template<typename DType, typename AType>
+  MSHADOW_XINLINE static void Map(int i, DType* grad, const DType* data, const DType* label,
+                                  const AType* row_max, const AType* row_sum,
+                                  const DType* scale, const int num_classes) {
+    const int r = i / num_classes;
+    AType p = math::exp(static_cast<AType>(data[i]) - row_max[r]) / row_sum[r];
+    if (i % num_classes == static_cast<int>(label[r])) p -= 1;
+    KERNEL_ASSIGN(grad[i], req, static_cast<AType>(scale[0]) * p);
+  }
+};
+
+/*!
+ * The softmax is never materialized: forward reads every row once for its
+ * statistics and loss, and backward recomputes the statistics, then writes
+ * the gradient elementwise, so the temporary space is O(batch).
+ */
 template<typename xpu>
 void SoftmaxCrossEntropyForward(const nnvm::NodeAttrs& attrs,
                                 const OpContext& ctx,
@@ -60,24 +133,19 @@ void SoftmaxCrossEntropyForward(const nnvm::NodeAttrs& attrs,
   CHECK_EQ(outputs[0].type_flag_, inputs[1].type_flag_)
     << "Binary function only support input/output with the same type";
   MSHADOW_REAL_TYPE_SWITCH(outputs[0].type_flag_, DType, {
+    typedef typename SoftmaxCEAccType<DType>::type AType;
     mshadow::Tensor<xpu, 1, DType> out = outputs[0].get<xpu, 1, DType>(s);
     mshadow::Tensor<xpu, 1, DType> mlabel = inputs[1].get<xpu, 1, DType>(s);
     mshadow::Tensor<xpu, 2, DType> mdata = inputs[0].get<xpu, 2, DType>(s);
-    mshadow::Tensor<xpu, 1, DType> workspace = ctx.requested[0].get_space_typed<xpu, 1, DType>(
-        mshadow::Shape1(mdata.shape_.Size() + mlabel.size(0)), s);
-    mshadow::Tensor<xpu, 2, DType> temp1(workspace.dptr_, mdata.shape_, s);
-    mshadow::Tensor<xpu, 2, DType> temp2(workspace.dptr_ + mdata.shape_.Size(),
-        mshadow::Shape2(1, mlabel.size(0)), s);
-    // calculate softmax on temp
-    // TODO(tqchen): change to SoftmaxLog later
-    mshadow::Softmax(temp1, mdata);
-    // choose the softmax rows
-    mshadow::Tensor<xpu, 1, DType> tdst = temp2[0];
-    tdst = F<mshadow_op::negation>(
-        F<mshadow_op::log>(
-            F<mshadow_op::maximum>(mat_choose_row_element(temp1, mlabel),
-                                   scalar<DType>(1e-8f))));
-    ASSIGN_DISPATCH(out, req[0], sumall_except_dim<0>(temp2));
+    const index_t n = mdata.size(0);
+    mshadow::Tensor<xpu, 1, char> workspace = ctx.requested[0].get_space_typed<xpu, 1, char>(
+        mshadow::Shape1(n * (2 * sizeof(AType) + sizeof(DType))), s);
+    AType* row_max = reinterpret_cast<AType*>(workspace.dptr_);
+    AType* row_sum = row_max + n;
+    mshadow::Tensor<xpu, 2, DType> loss(reinterpret_cast<DType*>(row_sum + n),
+                                        mshadow::Shape2(1, n), s);
+    SoftmaxCERowStats(s, mdata, mlabel.dptr_, row_max, row_sum, loss.dptr_);
+    ASSIGN_DISPATCH(out, req[0], sumall_except_dim<0>(loss));
   });
 }
 
@@ -87,20 +155,28 @@ void SoftmaxCrossEntropyBackward(const nnvm::NodeAttrs& attrs,
                                  const std::vector<TBlob>& inputs,
                                  const std::vector<OpReqType>& req,
                                  const std::vector<TBlob>& outputs) {
-  using namespace mshadow::expr;
+  using namespace mxnet_op;
   mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
   CHECK_EQ(req[1], kNullOp)
       << "SoftmaxCrossEntropy: Cannot take gradient wrt label";
+  if (req[0] == kNullOp) return;
   MSHADOW_REAL_TYPE_SWITCH(outputs[0].type_flag_, DType, {
+    typedef typename SoftmaxCEAccType<DType>::type AType;
     mshadow::Tensor<xpu, 1, DType> mlabel = inputs[2].get<xpu, 1, DType>(s);
     mshadow::Tensor<xpu, 2, DType> mdata = inputs[1].get<xpu, 2, DType>(s);
     mshadow::Tensor<xpu, 2, DType> mdata_grad = outputs[0].get<xpu, 2, DType>(s);
     mshadow::Tensor<xpu, 1, DType> mscale = inputs[0].get<xpu, 1, DType>(s);
-    mshadow::Tensor<xpu, 2, DType> temp = ctx.requested[0].get_space_typed<xpu, 2, DType>(
-        mdata.shape_, s);
-    mshadow::Softmax(temp, mdata);
-    mshadow::SoftmaxGrad(temp, temp, mlabel);
-    ASSIGN_DISPATCH(mdata_grad, req[0], broadcast_scalar(mscale, temp.shape_) * temp);
+    const index_t n = mdata.size(0);
+    mshadow::Tensor<xpu, 1, AType> workspace = ctx.requested[0].get_space_typed<xpu, 1, AType>(
+        mshadow::Shape1(2 * n), s);
+    AType* row_max = workspace.dptr_;
+    AType* row_sum = row_max + n;
+    SoftmaxCERowStats(s, mdata, mlabel.dptr_, row_max, row_sum, static_cast<DType*>(nullptr));
+    MXNET_ASSIGN_REQ_SWITCH(req[0], Req, {
+      Kernel<SoftmaxCEGradKernel<Req>, xpu>::Launch(
+        s, mdata.shape_.Size(), mdata_grad.dptr_, mdata.dptr_, mlabel.dptr_, row_max, row_sum,
+        mscale.dptr_, static_cast<int>(mdata.size(1)));
+    });
   });
 }
 
@@ -22,11 +22,72 @@
  * \file loss_binary_op.cu
  * \brief loss function that takes a data and label
 */
+#include <algorithm>
 #include "./loss_binary_op-inl.h"
 
 namespace mxnet {
 namespace op {
 
+// one block per row, every thread keeps a running max and sum over its
+// columns, then the block merges them pairwise in shared memory
+template<typename DType, typename AType>
+__global__ void SoftmaxCERowStatsKernel(const int num_rows, const int num_classes,
+                                        const DType* data, const DType* label,
+                                        AType* row_max, AType* row_sum, DType* loss) {
+  __shared__ AType smax[mshadow::cuda::kBaseThreadNum];
+  __shared__ AType ssum[mshadow::cuda::kBaseThreadNum];
+  for (int r = blockIdx.x; r < num_rows; r += gridDim.x) {
+    const DType* row = data + static_cast<size_t>(r) * num_classes;
+    AType m = -INFINITY, sum = 0;
+    for (int j = threadIdx.x; j < num_classes; j += blockDim.x) {
+      const AType v = row[j];
+      if (v > m) {
+        sum = sum * math::exp(m - v) + 1;
+        m = v;
+      } else {
+        sum += math::exp(v - m);
+      }
+    }
+    smax[threadIdx.x] = m;
+    ssum[threadIdx.x] = sum;
+    __syncthreads();
+    for (int offset = blockDim.x / 2; offset > 0; offset >>= 1) {
+      if (threadIdx.x < offset) {
+        const AType m1 = smax[threadIdx.x], m2 = smax[threadIdx.x + offset];
+        const AType mm = m1 > m2 ? m1 : m2;
+        if (mm != -INFINITY) {
+          ssum[threadIdx.x] = ssum[threadIdx.x] * math::exp(m1 - mm) +
+                              ssum[threadIdx.x + offset] * math::exp(m2 - mm);
+        }
+        smax[threadIdx.x] = mm;
+      }
+      __syncthreads();
+    }
+    if (threadIdx.x == 0) {
+      row_max[r] = smax[0];
+      row_sum[r] = ssum[0];
+      if (loss != nullptr) {
+        const AType p = math::exp(static_cast<AType>(row[static_cast<int>(label[r])]) -
+                                  smax[0]) / ssum[0];
+        loss[r] = -math::log(p > AType(1e-8f) ? p : AType(1e-8f));
+      }
+    }
+    __syncthreads();
+  }
+}
+
+template<typename DType, typename AType>
+void SoftmaxCERowStats(mshadow::Stream<gpu>* s, const mshadow::Tensor<gpu, 2, DType>& data,
+                       const DType* label, AType* row_max, AType* row_sum, DType* loss) {
+  const int num_rows = data.size(0);
+  if (num_rows == 0) return;
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+  const int blocks = std::min(num_rows, static_cast<int>(mshadow::cuda::kMaxGridNum));
+  SoftmaxCERowStatsKernel<<<blocks, mshadow::cuda::kBaseThreadNum, 0, stream>>>(
+    num_rows, static_cast<int>(data.size(1)), data.dptr_, label, row_max, row_sum, loss);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(SoftmaxCERowStatsKernel);
+}
+
 NNVM_REGISTER_OP(softmax_cross_entropy)
 .set_attr<FCompute>("FCompute<gpu>", SoftmaxCrossEntropyForward<gpu>);
 
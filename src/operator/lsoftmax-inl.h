@@ -67,6 +67,15 @@ class LSoftmaxOp : public Operator {
       c_table_.push_back(factor);
     }
     next_beta_ = param.beta * 0.1f;
+    k_table_xpu_.dptr_ = NULL;
+    c_table_xpu_.dptr_ = NULL;
+  }
+
+  ~LSoftmaxOp() {
+    if (k_table_xpu_.dptr_ != NULL) {
+      mshadow::FreeSpace(&k_table_xpu_);
+      mshadow::FreeSpace(&c_table_xpu_);
+    }
   }
 
   virtual void Forward(const OpContext &ctx,
@@ -103,19 +112,8 @@ class LSoftmaxOp : public Operator {
       // large margin fully connected
       const int margin = param_.margin;
       const DType beta = static_cast<DType>(param_.beta);
-      Tensor<cpu, 1, DType> k_table_cpu(k_table_.data(), Shape1(k_table_.size()));
-      Tensor<cpu, 1, DType> c_table_cpu(c_table_.data(), Shape1(c_table_.size()));
-      Tensor<xpu, 1, DType> k_table_xpu(Shape1(k_table_.size()));
-      Tensor<xpu, 1, DType> c_table_xpu(Shape1(c_table_.size()));
-      k_table_xpu.set_stream(s);
-      c_table_xpu.set_stream(s);
-      AllocSpace(&k_table_xpu);
-      AllocSpace(&c_table_xpu);
-      Copy(k_table_xpu, k_table_cpu, s);
-      Copy(c_table_xpu, c_table_cpu, s);
-      LSoftmaxForward(x, w, label, out, x_norm, w_norm, k_table_xpu, c_table_xpu, margin, beta);
-      FreeSpace(&k_table_xpu);
-      FreeSpace(&c_table_xpu);
+      InitTables(s);
+      LSoftmaxForward(x, w, label, out, x_norm, w_norm, k_table_xpu_, c_table_xpu_, margin, beta);
     }
   }
 
@@ -158,20 +156,9 @@ class LSoftmaxOp : public Operator {
     // large margin fully connected
     const int margin = param_.margin;
     const DType beta = static_cast<DType>(param_.beta);
-    Tensor<cpu, 1, DType> k_table_cpu(k_table_.data(), Shape1(k_table_.size()));
-    Tensor<cpu, 1, DType> c_table_cpu(c_table_.data(), Shape1(c_table_.size()));
-    Tensor<xpu, 1, DType> k_table_xpu(Shape1(k_table_.size()));
-    Tensor<xpu, 1, DType> c_table_xpu(Shape1(c_table_.size()));
-    k_table_xpu.set_stream(s);
-    c_table_xpu.set_stream(s);
-    AllocSpace(&k_table_xpu);
-    AllocSpace(&c_table_xpu);
-    Copy(k_table_xpu, k_table_cpu, s);
-    Copy(c_table_xpu, c_table_cpu, s);
+    InitTables(s);
     LSoftmaxBackward(x, w, label, x_norm, w_norm, o_grad, x_grad, w_grad, workspace,
-                     k_table_xpu, c_table_xpu, margin, beta);
-    FreeSpace(&k_table_xpu);
-    FreeSpace(&c_table_xpu);
+                     k_table_xpu_, c_table_xpu_, margin, beta);
     // dirty hack, should also work for multi device
     param_.beta *= param_.scale;
     param_.beta = std::max(param_.beta, param_.beta_min);
@@ -184,10 +171,26 @@ class LSoftmaxOp : public Operator {
   }
 
  private:
+  // copy the lookup tables to the device on first use, they stay there afterwards
+  void InitTables(mshadow::Stream<xpu> *s) {
+    using namespace mshadow;
+    if (k_table_xpu_.dptr_ != NULL) return;
+    Tensor<cpu, 1, DType> k_table_cpu(k_table_.data(), Shape1(k_table_.size()));
+    Tensor<cpu, 1, DType> c_table_cpu(c_table_.data(), Shape1(c_table_.size()));
+    k_table_xpu_ = Tensor<xpu, 1, DType>(Shape1(k_table_.size()));
+    c_table_xpu_ = Tensor<xpu, 1, DType>(Shape1(c_table_.size()));
+    AllocSpace(&k_table_xpu_);
+    AllocSpace(&c_table_xpu_);
+    Copy(k_table_xpu_, k_table_cpu, s);
+    Copy(c_table_xpu_, c_table_cpu, s);
+  }
+
   LSoftmaxParam param_;
   // global lookup table
   std::vector<DType> k_table_;
   std::vector<DType> c_table_;
+  mshadow::Tensor<xpu, 1, DType> k_table_xpu_;
+  mshadow::Tensor<xpu, 1, DType> c_table_xpu_;
   float next_beta_;
 };  // class LSoftmaxOp
 
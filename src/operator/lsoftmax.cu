@@ -4,7 +4,9 @@
  * \brief LSoftmax from <Large-Margin Softmax Loss for Convolutional Neural Networks>
  * \author luoyetx
  */
+#include <algorithm>
 #include "./lsoftmax-inl.h"
+#include "../common/cuda_utils.h"
 
 namespace mshadow {
 namespace cuda {
@@ -24,17 +26,41 @@ MSHADOW_XINLINE int LSPowOfMO(const int k) {
 }
 
 template<typename DType>
-__global__ void LSCalcNorm(const Tensor<gpu, 2, DType> x,
-                           Tensor<gpu, 1, DType> x_norm) {
-  const int n = x.size(0);
-  const int m = x.size(1);
-  CUDA_KERNEL_LOOP(i, n) {
-    DType norm = 0;
-    for (int j = 0; j < m; ++j) {
-      norm += x[i][j] * x[i][j];
-    }
-    x_norm[i] = sqrt(norm);
+struct LSAccType {
+  typedef float type;
+};
+
+template<>
+struct LSAccType<double> {
+  typedef double type;
+};
+
+const int kLSWarpSize = 32;
+
+#if CUDA_VERSION < 9000
+template<typename DType>
+__forceinline__ __device__ DType __shfl_down_sync(unsigned, DType val, int delta) {
+  return __shfl_down(val, delta);
+}
+#endif
+
+// sum of the lanes of a warp, only lane 0 has the total
+template<typename AType>
+__device__ AType LSWarpSum(AType val) {
+  for (int offset = kLSWarpSize / 2; offset > 0; offset >>= 1) {
+    val += __shfl_down_sync(0xFFFFFFFF, val, offset);
   }
+  return val;
+}
+
+// the lanes of a warp stride through a row, so the reads are coalesced
+template<typename DType, typename AType>
+__device__ AType LSWarpDot(const DType *a, const DType *b, const int dim, const int lane) {
+  AType sum = 0;
+  for (int l = lane; l < dim; l += kLSWarpSize) {
+    sum += static_cast<AType>(a[l]) * static_cast<AType>(b[l]);
+  }
+  return LSWarpSum(sum);
 }
 
 template<typename DType>
@@ -64,31 +90,61 @@ __device__ DType LSCalcCosmt(const DType *c_table, const int n,
   return cos_mt;
 }
 
+// one warp per row of x or w: a row of w only gets its norm, a row of x gets
+// its norm and the margin transform of its target logit, the norm of the
+// target weight is summed again by the same warp, in the same order, instead
+// of waiting for the warp of that row
 template<typename DType>
 __global__ void LSoftmaxForwardKernel(const Tensor<gpu, 2, DType> x,
                                       const Tensor<gpu, 2, DType> w,
                                       const Tensor<gpu, 1, DType> label,
-                                      const Tensor<gpu, 1, DType> x_norm,
-                                      const Tensor<gpu, 1, DType> w_norm,
+                                      Tensor<gpu, 1, DType> x_norm,
+                                      Tensor<gpu, 1, DType> w_norm,
                                       Tensor<gpu, 2, DType> out,
                                       const Tensor<gpu, 1, DType> k_table,
                                       const Tensor<gpu, 1, DType> c_table,
                                       const int margin,
                                       const DType beta) {
+  typedef typename LSAccType<DType>::type AType;
   const int n = x.size(0);
   const int feature_dim = x.size(1);
   const int m = w.size(0);
-  CUDA_KERNEL_LOOP(i, n) {
+  const int lane = threadIdx.x % kLSWarpSize;
+  const int num_warps = blockDim.x * gridDim.x / kLSWarpSize;
+  for (int row = (blockIdx.x * blockDim.x + threadIdx.x) / kLSWarpSize;
+       row < n + m;
+       row += num_warps) {
+    if (row >= n) {
+      const DType *w_j = w.dptr_ + (row - n) * w.stride_;
+      const AType norm2 = LSWarpDot<DType, AType>(w_j, w_j, feature_dim, lane);
+      if (lane == 0) w_norm[row - n] = sqrt(norm2);
+      continue;
+    }
+    const int i = row;
     const int yi = static_cast<int>(label[i]);
-    const DType fo_i_yi = out[i][yi];
-    const DType cos_t = fo_i_yi / (x_norm[i] * w_norm[yi]);
-    const int k = LSFindK(k_table.dptr_, k_table.size(0), cos_t);
-    const DType cos_mt = LSCalcCosmt(c_table.dptr_, c_table.size(0), cos_t, margin);
-    const DType f_i_yi = (LSPowOfMO(k) * cos_mt - 2*k) * (w_norm[yi] * x_norm[i]);
-    out[i][yi] = (f_i_yi + beta * fo_i_yi) / (1 + beta);
+    const DType *x_i = x.dptr_ + i * x.stride_;
+    const DType *w_yi = w.dptr_ + yi * w.stride_;
+    const AType x_norm2 = LSWarpDot<DType, AType>(x_i, x_i, feature_dim, lane);
+    const AType w_norm2 = LSWarpDot<DType, AType>(w_yi, w_yi, feature_dim, lane);
+    if (lane == 0) {
+      const DType x_norm_i = sqrt(x_norm2);
+      const DType w_norm_yi = sqrt(w_norm2);
+      x_norm[i] = x_norm_i;
+      const DType fo_i_yi = out[i][yi];
+      const DType cos_t = fo_i_yi / (x_norm_i * w_norm_yi);
+      const int k = LSFindK(k_table.dptr_, k_table.size(0), cos_t);
+      const DType cos_mt = LSCalcCosmt(c_table.dptr_, c_table.size(0), cos_t, margin);
+      const DType f_i_yi = (LSPowOfMO(k) * cos_mt - 2*k) * (w_norm_yi * x_norm_i);
+      out[i][yi] = (f_i_yi + beta * fo_i_yi) / (1 + beta);
+    }
   }
 }
 
+inline int LSBlocks(const int nthreads) {
+  return std::min((nthreads + kBaseThreadNum - 1) / kBaseThreadNum,
+                  static_cast<int>(kMaxGridNum));
+}
+
 template<typename DType>
 inline void LSoftmaxForward(const Tensor<gpu, 2, DType> &x,
                             const Tensor<gpu, 2, DType> &w,
@@ -102,15 +158,13 @@ inline void LSoftmaxForward(const Tensor<gpu, 2, DType> &x,
                             const DType beta) {
   const int n = x.size(0);
   const int m = w.size(0);
-  dim3 dimBlock(kBaseThreadNum);
-  dim3 dimGrid((n + kBaseThreadNum - 1) / kBaseThreadNum);
-  LSCalcNorm<<<dimGrid, dimBlock>>>(x, x_norm);
-  dimGrid.x = ((m + kBaseThreadNum - 1) / kBaseThreadNum);
-  LSCalcNorm<<<dimGrid, dimBlock>>>(w, w_norm);
-  dimGrid.x = ((n + kBaseThreadNum - 1) / kBaseThreadNum);
-  LSoftmaxForwardKernel<<<dimGrid, dimBlock>>>(x, w, label, x_norm, w_norm, out, k_table, c_table, margin, beta);
+  cudaStream_t stream = Stream<gpu>::GetStream(out.stream_);
+  LSoftmaxForwardKernel<<<LSBlocks((n + m) * kLSWarpSize), kBaseThreadNum, 0, stream>>>(
+    x, w, label, x_norm, w_norm, out, k_table, c_table, margin, beta);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(LSoftmaxForwardKernel);
 }
 
+// one warp per data point, fo_i_yi = dot(w_yi, x_i)
 template<typename DType>
 __global__ void LSoftmaxBackwardRequired(const Tensor<gpu, 2, DType> x,
                                          const Tensor<gpu, 2, DType> w,
@@ -121,40 +175,48 @@ __global__ void LSoftmaxBackwardRequired(const Tensor<gpu, 2, DType> x,
                                          const Tensor<gpu, 1, DType> k_table,
                                          const Tensor<gpu, 1, DType> c_table,
                                          const int margin) {
+  typedef typename LSAccType<DType>::type AType;
   const int n = x.size(0);
   const int feature_dim = x.size(1);
-  CUDA_KERNEL_LOOP(i, n) {
+  const int lane = threadIdx.x % kLSWarpSize;
+  const int num_warps = blockDim.x * gridDim.x / kLSWarpSize;
+  for (int i = (blockIdx.x * blockDim.x + threadIdx.x) / kLSWarpSize;
+       i < n;
+       i += num_warps) {
     const int yi = static_cast<int>(label[i]);
-    // fo_i_yi = dot(w_yi, x_i)
-    DType fo_i_yi = 0;
-    for (int p = 0; p < feature_dim; ++p) {
-      fo_i_yi += w[yi][p] * x[i][p];
+    const AType fo = LSWarpDot<DType, AType>(w.dptr_ + yi * w.stride_, x.dptr_ + i * x.stride_,
+                                             feature_dim, lane);
+    if (lane == 0) {
+      const DType fo_i_yi = fo;
+      const DType cos_t = fo_i_yi / (x_norm[i] * w_norm[yi]);
+      const int k = LSFindK(k_table.dptr_, k_table.size(0), cos_t);
+      const DType cos_mt = LSCalcCosmt(c_table.dptr_, c_table.size(0), cos_t, margin);
+      const DType sin2_t = 1 - cos_t * cos_t;
+      workspace[kCost][i] = cos_t;
+      workspace[kCosmt][i] = cos_mt;
+      workspace[kK][i] = static_cast<DType>(k);
+      workspace[kSin2t][i] = sin2_t;
+      workspace[kFo][i] = fo_i_yi;
+      workspace[kCostM][i] = pow(cos_t, margin - 1);
     }
-    const DType cos_t = fo_i_yi / (x_norm[i] * w_norm[yi]);
-    const int k = LSFindK(k_table.dptr_, k_table.size(0), cos_t);
-    const DType cos_mt = LSCalcCosmt(c_table.dptr_, c_table.size(0), cos_t, margin);
-    const DType sin2_t = 1 - cos_t * cos_t;
-    workspace[kCost][i] = cos_t;
-    workspace[kCosmt][i] = cos_mt;
-    workspace[kK][i] = static_cast<DType>(k);
-    workspace[kSin2t][i] = sin2_t;
-    workspace[kFo][i] = fo_i_yi;
-    workspace[kCostM][i] = pow(cos_t, margin - 1);
   }
 }
 
+// one thread per element of x: the margin term of x_grad[i][l], and of
+// w_grad[yi][l] added atomically, as only the target rows of w get one
 template<typename DType>
-__global__ void LSoftmaxBackwardXKernel(const Tensor<gpu, 2, DType> x,
-                                        const Tensor<gpu, 2, DType> w,
-                                        const Tensor<gpu, 1, DType> label,
-                                        const Tensor<gpu, 1, DType> x_norm,
-                                        const Tensor<gpu, 1, DType> w_norm,
-                                        const Tensor<gpu, 2, DType> o_grad,
-                                        Tensor<gpu, 2, DType> x_grad,
-                                        const Tensor<gpu, 2, DType> workspace,
-                                        const Tensor<gpu, 1, DType> c_table,
-                                        const int margin,
-                                        const DType beta) {
+__global__ void LSoftmaxBackwardKernel(const Tensor<gpu, 2, DType> x,
+                                       const Tensor<gpu, 2, DType> w,
+                                       const Tensor<gpu, 1, DType> label,
+                                       const Tensor<gpu, 1, DType> x_norm,
+                                       const Tensor<gpu, 1, DType> w_norm,
+                                       const Tensor<gpu, 2, DType> o_grad,
+                                       Tensor<gpu, 2, DType> x_grad,
+                                       Tensor<gpu, 2, DType> w_grad,
+                                       const Tensor<gpu, 2, DType> workspace,
+                                       const Tensor<gpu, 1, DType> c_table,
+                                       const int margin,
+                                       const DType beta) {
   const int nthreads = x.size(0) * x.size(1);
   const int feature_dim = x.size(1);
   CUDA_KERNEL_LOOP(idx, nthreads) {
@@ -168,75 +230,35 @@ __global__ void LSoftmaxBackwardXKernel(const Tensor<gpu, 2, DType> x,
     const DType fo_i_yi = workspace[kFo][i];
     const DType w_norm_yi = w_norm[yi];
     const DType x_norm_i = x_norm[i];
+    const DType x_il = x[i][l];
+    const DType w_yil = w[yi][l];
 
-    const DType dcos_dx = w[yi][l] / (w_norm_yi * x_norm_i) - \
-                          fo_i_yi * x[i][l] / (w_norm_yi * x_norm_i * x_norm_i * x_norm_i);
+    const DType dcos_dx = w_yil / (w_norm_yi * x_norm_i) - \
+                          fo_i_yi * x_il / (w_norm_yi * x_norm_i * x_norm_i * x_norm_i);
+    const DType dcos_dw = x_il / (w_norm_yi * x_norm_i) - \
+                          fo_i_yi * w_yil / (x_norm_i * w_norm_yi * w_norm_yi * w_norm_yi);
     const DType dsin2_dx = -2 * cos_t * dcos_dx;
+    const DType dsin2_dw = -2 * cos_t * dcos_dw;
     DType cos_t_p = workspace[kCostM][i];
     DType sin2_t_p = 1;
     DType dcosm_dx = margin * cos_t_p * dcos_dx;  // p = 0
+    DType dcosm_dw = margin * cos_t_p * dcos_dw;  // p = 0
     for (int p = 1; p <= margin / 2; ++p) {
       cos_t_p /= cos_t * cos_t;
       dcosm_dx += LSPowOfMO(p) * c_table[2*p] * (p * cos_t * dsin2_dx + \
                     (margin - 2*p) * sin2_t * dcos_dx) * cos_t_p * sin2_t_p;
+      dcosm_dw += LSPowOfMO(p) * c_table[2*p] * (p * cos_t * dsin2_dw + \
+                    (margin - 2*p) * sin2_t * dcos_dw) * cos_t_p * sin2_t_p;
       sin2_t_p *= sin2_t;
     }
-    const DType df_dx = (LSPowOfMO(k) * cos_mt - 2*k) * w_norm_yi / x_norm_i * x[i][l] + \
+    const DType df_dx = (LSPowOfMO(k) * cos_mt - 2*k) * w_norm_yi / x_norm_i * x_il + \
                          LSPowOfMO(k) * w_norm_yi * x_norm_i * dcosm_dx;
+    const DType df_dw = (LSPowOfMO(k) * cos_mt - 2*k) * x_norm_i / w_norm_yi * w_yil + \
+                         LSPowOfMO(k) * w_norm_yi * x_norm_i * dcosm_dw;
     const DType alpha = 1 / (1 + beta);
-    x_grad[i][l] += alpha * o_grad[i][yi] * (df_dx - w[yi][l]);
-  }
-}
-
-template<typename DType>
-__global__ void LSoftmaxBackwardWKernel(const Tensor<gpu, 2, DType> x,
-                                        const Tensor<gpu, 2, DType> w,
-                                        const Tensor<gpu, 1, DType> label,
-                                        const Tensor<gpu, 1, DType> x_norm,
-                                        const Tensor<gpu, 1, DType> w_norm,
-                                        const Tensor<gpu, 2, DType> o_grad,
-                                        Tensor<gpu, 2, DType> w_grad,
-                                        const Tensor<gpu, 2, DType> workspace,
-                                        const Tensor<gpu, 1, DType> c_table,
-                                        const int margin,
-                                        const DType beta) {
-  const int nthreads = w.size(0) * w.size(1);
-  const int n = x.size(0);
-  const int feature_dim = w.size(1);
-  CUDA_KERNEL_LOOP(idx, nthreads) {
-    const int j = idx / feature_dim;
-    const int l = idx % feature_dim;
-    DType dw = 0;
-    for (int i = 0; i < n; ++i) {
-      const int yi = static_cast<int>(label[i]);
-      if (yi == j) {
-        const DType cos_t = workspace[kCost][i];
-        const DType cos_mt = workspace[kCosmt][i];
-        const int k = static_cast<int>(workspace[kK][i]);
-        const DType sin2_t = workspace[kSin2t][i];
-        const DType fo_i_yi = workspace[kFo][i];
-        const DType x_norm_i = x_norm[i];
-        const DType w_norm_yi = w_norm[yi];
-
-        const DType dcos_dw = x[i][l] / (w_norm_yi * x_norm_i) - \
-                              fo_i_yi * w[yi][l] / (x_norm_i * w_norm_yi * w_norm_yi * w_norm_yi);
-        const DType dsin2_dw = -2 * cos_t * dcos_dw;
-        DType cos_t_p = workspace[kCostM][i];
-        DType sin2_t_p = 1;
-        DType dcosm_dw = margin * cos_t_p * dcos_dw;  // p = 0
-        for (int p = 1; p <= margin / 2; ++p) {
-          cos_t_p /= cos_t * cos_t;
-          dcosm_dw += LSPowOfMO(p) * c_table[2*p] * (p * cos_t * dsin2_dw + \
-                        (margin - 2*p) * sin2_t * dcos_dw) * cos_t_p * sin2_t_p;
-          sin2_t_p *= sin2_t;
-        }
-        const DType df_dw_j = (LSPowOfMO(k) * cos_mt - 2*k) * x_norm_i / w_norm_yi * w[yi][l] + \
-                               LSPowOfMO(k) * w_norm_yi * x_norm_i * dcosm_dw;
-        dw += o_grad[i][yi] * (df_dw_j - x[i][l]);
-      }
-    }
-    const DType alpha = 1 / (1 + beta);
-    w_grad[j][l] += alpha * dw;
+    const DType g = alpha * o_grad[i][yi];
+    x_grad[i][l] += g * (df_dx - w_yil);
+    atomicAdd(&w_grad[yi][l], g * (df_dw - x_il));
   }
 }
 
@@ -256,17 +278,13 @@ inline void LSoftmaxBackward(const Tensor<gpu, 2, DType> &x,
                              const DType beta) {
   const int n = x.size(0);
   const int feature_dim = x.size(1);
-  const int m = w.size(0);
-  dim3 dimBlock(kBaseThreadNum);
-  dim3 dimGrid((n + kBaseThreadNum - 1) / kBaseThreadNum);
-  LSoftmaxBackwardRequired<<<dimGrid, dimBlock>>>(x, w, label, x_norm, w_norm, workspace,
-                                                  k_table, c_table, margin);
-  dimGrid.x = ((n * feature_dim + kBaseThreadNum - 1) / kBaseThreadNum);
-  LSoftmaxBackwardXKernel<<<dimGrid, dimBlock>>>(x, w, label, x_norm, w_norm, o_grad, x_grad, workspace,
-                                                 c_table, margin, beta);
-  dimGrid.x = ((m * feature_dim + kBaseThreadNum - 1) / kBaseThreadNum);
-  LSoftmaxBackwardWKernel<<<dimGrid, dimBlock>>>(x, w, label, x_norm, w_norm, o_grad, w_grad, workspace,
-                                                 c_table, margin, beta);
+  cudaStream_t stream = Stream<gpu>::GetStream(x_grad.stream_);
+  LSoftmaxBackwardRequired<<<LSBlocks(n * kLSWarpSize), kBaseThreadNum, 0, stream>>>(
+    x, w, label, x_norm, w_norm, workspace, k_table, c_table, margin);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(LSoftmaxBackwardRequired);
+  LSoftmaxBackwardKernel<<<LSBlocks(n * feature_dim), kBaseThreadNum, 0, stream>>>(
+    x, w, label, x_norm, w_norm, o_grad, x_grad, w_grad, workspace, c_table, margin, beta);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(LSoftmaxBackwardKernel);
 }
 
 }  // namespace cuda
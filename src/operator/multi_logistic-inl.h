@@ -17,27 +17,11 @@
 #include <utility>
 #include "./operator_common.h"
 #include "./mshadow_op.h"
-
-
-#include <iostream>
-#include <fstream>
-using namespace std;
+#include "./mxnet_op.h"
 
 namespace mxnet {
 namespace op {
 
-struct cmp{
-  MSHADOW_XINLINE static real_t Map(real_t a, real_t b){
-    return a > b ? 1.0f : -1.0f;
-  }
-};
-
-struct abs{
-  MSHADOW_XINLINE static real_t Map(real_t a){
-    return a > 0 ? a : -a;
-  }
-};
-
 enum MultiLogisticOpInputs {kData, kLabel};
 enum MultiLogisticOpOutputs {kOut};
 
@@ -45,6 +29,8 @@ struct MultiLogisticParam : public dmlc::Parameter<MultiLogisticParam> {
   float grad_scale;
   float p;
   float weight;
+  bool use_ignore;
+  float ignore_label;
   DMLC_DECLARE_PARAMETER(MultiLogisticParam) {
     DMLC_DECLARE_FIELD(p).set_default(2.0f)
         .describe("Scale the gradient by a float factor");
@@ -52,9 +38,39 @@ struct MultiLogisticParam : public dmlc::Parameter<MultiLogisticParam> {
     .describe("Scale the gradient by a float factor");
     DMLC_DECLARE_FIELD(weight).set_default(1.0f)
     .describe("postive weight");
+    DMLC_DECLARE_FIELD(use_ignore).set_default(false)
+    .describe("If set to true, the gradient of targets equal to ignore_label is zero.");
+    DMLC_DECLARE_FIELD(ignore_label).set_default(-1.0f)
+    .describe("The target value to ignore when use_ignore is true.");
   };
 };
 
+/*! \brief sigmoid of the input */
+template<int req>
+struct multi_logistic_forward {
+  MSHADOW_XINLINE static void Map(int i, real_t* out, const real_t* data) {
+    KERNEL_ASSIGN(out[i], req, mshadow_op::sigmoid::Map(data[i]));
+  }
+};
+
+/*!
+ * \brief weighted logistic gradient (out - label) * (weight * label + 1 - label)
+ *  in one pass over the output, zero where the label is masked
+ */
+template<int req>
+struct multi_logistic_backward {
+  MSHADOW_XINLINE static void Map(int i, real_t* grad, const real_t* out, const real_t* label,
+                                  const real_t scale, const real_t weight,
+                                  const bool use_ignore, const real_t ignore_label) {
+    const real_t t = label[i];
+    if (use_ignore && t == ignore_label) {
+      KERNEL_ASSIGN(grad[i], req, 0.0f);
+      return;
+    }
+    KERNEL_ASSIGN(grad[i], req, scale * (out[i] - t) * (weight * t + (1.0f - t)));
+  }
+};
+
 template<typename xpu>
 class MultiLogisticOp : public Operator {
  public:
@@ -65,17 +81,14 @@ class MultiLogisticOp : public Operator {
                        const std::vector<OpReqType> &req,
                        const std::vector<TBlob> &out_data,
                        const std::vector<TBlob> &aux_args) {
-
-  // do nothing
     using namespace mshadow;
-    using namespace mshadow::expr;
-    CHECK_EQ(in_data.size(), 2) << "Softmax Input: [data, label]";
-    CHECK_EQ(out_data.size(), 1) << "Softmax Output: [output]";
+    CHECK_EQ(in_data.size(), 2U) << "MultiLogistic Input: [data, label]";
+    CHECK_EQ(out_data.size(), 1U) << "MultiLogistic Output: [output]";
     Stream<xpu> *s = ctx.get_stream<xpu>();
-    Tensor<xpu, 2> data = in_data[kData].FlatTo2D<xpu, real_t>(s);
-    Tensor<xpu, 2> out = out_data[kOut].FlatTo2D<xpu, real_t>(s);
-    out = mshadow::expr::F<mshadow_op::sigmoid>(data);
-
+    MXNET_ASSIGN_REQ_SWITCH(req[kOut], Req, {
+      mxnet_op::Kernel<multi_logistic_forward<Req>, xpu>::Launch(
+        s, out_data[kOut].Size(), out_data[kOut].dptr<real_t>(), in_data[kData].dptr<real_t>());
+    });
   }
 
   virtual void Backward(const OpContext &ctx,
@@ -85,20 +98,18 @@ class MultiLogisticOp : public Operator {
                         const std::vector<OpReqType> &req,
                         const std::vector<TBlob> &in_grad,
                         const std::vector<TBlob> &aux_args) {
-
     using namespace mshadow;
-    using namespace mshadow::expr;
-    CHECK_EQ(in_data.size(), 2);
-    CHECK_EQ(out_grad.size(), 1);
-    CHECK_GE(in_grad.size(), 1);
-    CHECK_GE(req.size(), 1);
+    CHECK_EQ(in_data.size(), 2U);
+    CHECK_EQ(out_grad.size(), 1U);
+    CHECK_GE(in_grad.size(), 1U);
+    CHECK_GE(req.size(), 1U);
     Stream<xpu> *s = ctx.get_stream<xpu>();
-    Tensor<xpu, 2> label = in_data[kLabel].FlatTo2D<xpu, real_t>(s);
-    Tensor<xpu, 2> out = out_data[kOut].FlatTo2D<xpu, real_t>(s);
-    Tensor<xpu, 2> grad = in_grad[kData].FlatTo2D<xpu, real_t>(s);
-
-    grad = out - label;
-    grad = (param_.grad_scale) * (grad * label * param_.weight + grad * (1 - label));
+    MXNET_ASSIGN_REQ_SWITCH(req[kData], Req, {
+      mxnet_op::Kernel<multi_logistic_backward<Req>, xpu>::Launch(
+        s, in_grad[kData].Size(), in_grad[kData].dptr<real_t>(),
+        out_data[kOut].dptr<real_t>(), in_data[kLabel].dptr<real_t>(),
+        param_.grad_scale, param_.weight, param_.use_ignore, param_.ignore_label);
+    });
   }
 
  private:
@@ -33,6 +33,7 @@
 #include <algorithm>
 #include "./operator_tune.h"
 #include "../engine/openmp.h"
+#include "../engine/parallel_for_pool.h"
 
 #ifdef __CUDACC__
 #include "../common/cuda_utils.h"
@@ -437,7 +438,7 @@ struct Kernel<OP, cpu> {
       for (int i = 0; i < N; ++i) {
         OP::Map(i, args...);
       }
-    } else {
+    } else if (!LaunchPooled(N, omp_threads, args...)) {
       #pragma omp parallel for num_threads(omp_threads)
       for (int i = 0; i < N; ++i) {
         OP::Map(i, args...);
@@ -451,6 +452,21 @@ struct Kernel<OP, cpu> {
     return true;
   }
 
+  /*!
+   * rief Run a CPU kernel on the persistent thread pool, if MXNET_CPU_PARALLEL_POOL enables it
+   * 
+eturn false if the pool is disabled or busy, and the kernel did not run
+   */
+  template<typename ...Args>
+  inline static bool LaunchPooled(const int N, const int nthreads, Args... args) {
+    engine::ParallelForPool *pool = engine::ParallelForPool::Get();
+    return pool != nullptr && pool->ParallelFor(N, nthreads, [&](int64_t begin, int64_t end) {
+      for (int i = static_cast<int>(begin); i < static_cast<int>(end); ++i) {
+        OP::Map(i, args...);
+      }
+    });
+  }
+
   /*!
    * \brief Launch CPU kernel which has OMP tuning data available.
    * When using this for a new kernel op, add declaration and tuning objects to
@@ -466,13 +482,16 @@ struct Kernel<OP, cpu> {
   static void LaunchTuned(mshadow::Stream<cpu> *, const int N, Args... args) {
 #ifdef _OPENMP
     const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
-    if (omp_threads < 2 || !tuned_op<PRIMITIVE_OP, DType>::UseOMP(
-      static_cast<size_t>(N), static_cast<size_t>(omp_threads))) {
+    // small inputs take fewer threads than available, which are left to other operators
+    const int nthreads = omp_threads < 2 ? 1 : static_cast<int>(
+      tuned_op<PRIMITIVE_OP, DType>::OMPThreadCount(static_cast<size_t>(N),
+                                                    static_cast<size_t>(omp_threads)));
+    if (nthreads < 2) {
       for (int i = 0; i < N; ++i) {
         OP::Map(i, args...);
       }
     } else {
-      #pragma omp parallel for num_threads(omp_threads)
+      #pragma omp parallel for num_threads(nthreads)
       for (int i = 0; i < N; ++i) {
         OP::Map(i, args...);
       }
@@ -25,6 +25,7 @@
 */
 
 #include "batch_norm-inl.h"
+#include "batch_norm_add_relu-inl.h"
 #include <nnvm/op_attr_types.h>
 #include "../elemwise_op_common.h"
 #if MXNET_USE_MKLDNN == 1
@@ -314,6 +315,7 @@ void BatchNormBackwardImpl(mshadow::Stream<cpu> *,
 }
 
 DMLC_REGISTER_PARAMETER(BatchNormParam);
+DMLC_REGISTER_PARAMETER(BatchNormAddReluParam);
 
 static bool BatchNormShape(const nnvm::NodeAttrs& attrs,
                            std::vector<TShape> *in_shape,
@@ -637,5 +639,161 @@ NNVM_REGISTER_OP(_backward_BatchNorm)
 #endif
 .set_attr<FCompute>("FCompute<cpu>", BatchNormGradCompute<cpu>);
 
+
+static void BatchNormAddReluParamParser(nnvm::NodeAttrs* attrs) {
+  BatchNormAddReluAttrs param;
+  param.fused.InitAllowUnknown(attrs->dict);
+  std::unordered_map<std::string, std::string> bn_dict = attrs->dict;
+  for (const auto& field : BatchNormAddReluParam::__FIELDS__()) {
+    bn_dict.erase(field.name);
+  }
+  param.bn.Init(bn_dict);
+  CHECK(!param.bn.output_mean_var) << "BatchNormAddRelu does not output the mean and var";
+  attrs->parsed = std::move(param);
+}
+
+static bool BatchNormAddReluShape(const nnvm::NodeAttrs& attrs,
+                                  std::vector<TShape> *in_shape,
+                                  std::vector<TShape> *out_shape) {
+  const BatchNormAddReluAttrs& param = nnvm::get<BatchNormAddReluAttrs>(attrs.parsed);
+  CHECK_EQ(in_shape->size(), 6U);
+  const int data = BNAddReluDataIndex(param);
+  const int addend = BNAddReluAddendIndex(param);
+  SHAPE_ASSIGN_CHECK(*in_shape, addend, in_shape->at(data));
+  SHAPE_ASSIGN_CHECK(*in_shape, data, in_shape->at(addend));
+  if (in_shape->at(data).ndim() == 0) return false;
+  nnvm::NodeAttrs bn_attrs;
+  bn_attrs.parsed = param.bn;
+  std::vector<TShape> bn_shape(in_shape->begin() + data, in_shape->begin() + data + 5);
+  if (!BatchNormShape(bn_attrs, &bn_shape, out_shape)) return false;
+  std::copy(bn_shape.begin(), bn_shape.end(), in_shape->begin() + data);
+  const TShape &dshape = bn_shape[batchnorm::kData];
+  const BNAddReluGeometry geo(dshape, batchnorm::GetRealAxis(dshape, param.bn.axis));
+  out_shape->push_back(mshadow::Shape1(geo.MaskSize()));  // kMask
+  return true;
+}
+
+static bool BatchNormAddReluType(const nnvm::NodeAttrs& attrs,
+                                 std::vector<int> *in_type, std::vector<int> *out_type) {
+  const BatchNormAddReluAttrs& param = nnvm::get<BatchNormAddReluAttrs>(attrs.parsed);
+  CHECK_EQ(in_type->size(), 6U);
+  const int data = BNAddReluDataIndex(param);
+  const int addend = BNAddReluAddendIndex(param);
+  TYPE_ASSIGN_CHECK(*in_type, addend, (*in_type)[data]);
+  TYPE_ASSIGN_CHECK(*in_type, data, (*in_type)[addend]);
+  if ((*in_type)[data] == -1) return false;
+  std::vector<int> bn_type(in_type->begin() + data, in_type->begin() + data + 5);
+  if (!BatchNormType(attrs, &bn_type, out_type)) return false;
+  std::copy(bn_type.begin(), bn_type.end(), in_type->begin() + data);
+  out_type->push_back(mshadow::kInt32);  // kMask
+  return true;
+}
+
+std::vector<nnvm::NodeEntry> BatchNormAddReluGrad(const nnvm::NodePtr& n,
+                                                  const std::vector<nnvm::NodeEntry>& ograds) {
+  const BatchNormAddReluAttrs& param = nnvm::get<BatchNormAddReluAttrs>(n->attrs.parsed);
+  const int data = BNAddReluDataIndex(param);
+  std::vector<nnvm::NodeEntry> heads;
+  heads.reserve(9);
+  heads.push_back(ograds[0]);
+  heads.push_back(nnvm::NodeEntry{n, bnaddrelu::kMask, 0});
+  heads.push_back(nnvm::NodeEntry{n, bnaddrelu::kMean, 0});
+  heads.push_back(nnvm::NodeEntry{n, bnaddrelu::kVar, 0});
+  for (int i = 0; i < 5; ++i) {
+    heads.push_back(n->inputs[data + i]);
+  }
+
+  nnvm::NodePtr gnode = nnvm::Node::Create();
+  gnode->inputs = std::move(heads);
+  gnode->control_deps.emplace_back(n);
+  gnode->attrs = n->attrs;
+  gnode->attrs.op = nnvm::Op::Get("_backward_BatchNormAddRelu");
+  gnode->attrs.name = n->attrs.name + "_backward";
+  std::vector<nnvm::NodeEntry> in_grad(6);
+  for (uint32_t i = 0; i < 3; ++i) {
+    in_grad[data + i] = nnvm::NodeEntry{gnode, i, 0};
+  }
+  in_grad[BNAddReluAddendIndex(param)] = nnvm::NodeEntry{gnode, 3, 0};
+
+  // attach no gradient node to forbid gradient on aux_state
+  nnvm::NodePtr ng = nnvm::Node::Create();
+  ng->attrs.op = Op::Get("_NoGradient");
+  ng->attrs.name = "NoGradient";
+  for (uint32_t i = 0; i < 2; ++i) {
+    in_grad[data + 3 + i] = nnvm::NodeEntry{ng, 0, 0};
+  }
+  return in_grad;
+}
+
+NNVM_REGISTER_OP(BatchNormAddRelu)
+.describe(R"code(Batch normalization followed by the sum with ``addend`` and a relu.
+
+Computes ``relu(BatchNorm(data, gamma, beta, moving_mean, moving_var) + addend)``,
+as found at the end of the residual blocks of ResNet. Instead of the input of the
+relu, only a bitmask of its positive outputs is kept for the backward pass. On GPU
+the training forward normalizes, adds and applies the relu in the same pass over
+the data.
+
+Takes the parameters of ``BatchNorm``, except ``output_mean_var``. Executors bound
+on a GPU replace ``BatchNorm``, ``elemwise_add`` and ``relu`` chains by this
+operator unless ``MXNET_EXEC_FUSE_BN_ADD_RELU`` is set to 0.
+
+)code" ADD_FILELINE)
+.set_num_inputs(6)
+.set_num_outputs(4)
+.set_attr_parser(BatchNormAddReluParamParser)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+    [](const NodeAttrs& attrs) {
+  const BatchNormAddReluAttrs& param = nnvm::get<BatchNormAddReluAttrs>(attrs.parsed);
+  if (param.fused.addend_first) {
+    return std::vector<std::string>{"addend", "data", "gamma", "beta", "moving_mean",
+                                    "moving_var"};
+  }
+  return std::vector<std::string>{"data", "gamma", "beta", "moving_mean", "moving_var",
+                                  "addend"};
+})
+.set_attr<nnvm::FListOutputNames>("FListOutputNames",
+    [](const NodeAttrs& attrs) {
+  return std::vector<std::string>{"output", "mean", "var", "mask"};
+})
+.set_attr<nnvm::FNumVisibleOutputs>("FNumVisibleOutputs",
+    [](const NodeAttrs& attrs) { return 1; })
+.set_attr<nnvm::FMutateInputs>("FMutateInputs", [](const nnvm::NodeAttrs& attrs) {
+  const uint32_t data = BNAddReluDataIndex(nnvm::get<BatchNormAddReluAttrs>(attrs.parsed));
+  return std::vector<uint32_t>{data + 3, data + 4};
+})
+.set_attr<nnvm::FInferShape>("FInferShape", BatchNormAddReluShape)
+.set_attr<nnvm::FInferType>("FInferType", BatchNormAddReluType)
+.set_attr<FCompute>("FCompute<cpu>", BatchNormAddReluCompute<cpu>)
+.set_attr<nnvm::FGradient>("FGradient", BatchNormAddReluGrad)
+.add_argument("data", "NDArray-or-Symbol", "Input data to batch normalization")
+.add_argument("gamma", "NDArray-or-Symbol", "gamma array")
+.add_argument("beta", "NDArray-or-Symbol", "beta array")
+.add_argument("moving_mean", "NDArray-or-Symbol", "running mean of input")
+.add_argument("moving_var", "NDArray-or-Symbol", "running variance of input")
+.add_argument("addend", "NDArray-or-Symbol", "Array added to the normalized data, same shape")
+.add_arguments(BatchNormParam::__FIELDS__())
+.add_arguments(BatchNormAddReluParam::__FIELDS__())
+.set_attr<nnvm::FSetInputVarAttrOnCompose>(
+  "FSetInputVarAttrOnCompose",
+  [](const nnvm::NodeAttrs& attrs, nnvm::NodePtr var, const int index) {
+    if (var->attrs.dict.find("__init__") != var->attrs.dict.end()) return;
+    const int data = BNAddReluDataIndex(nnvm::get<BatchNormAddReluAttrs>(attrs.parsed));
+    if (index == data + 3) {
+      var->attrs.dict["__init__"] = "[\"zero\", {}]";
+    } else if (index == data + 4) {
+      var->attrs.dict["__init__"] = "[\"one\", {}]";
+    }
+  });
+
+NNVM_REGISTER_OP(_backward_BatchNormAddRelu)
+.set_num_outputs(4)
+.set_attr<nnvm::TIsBackward>("TIsBackward", true)
+.set_attr<FResourceRequest>("FResourceRequest", [](const NodeAttrs& n) {
+  return std::vector<ResourceRequest>{ResourceRequest::kTempSpace};
+})
+.set_attr_parser(BatchNormAddReluParamParser)
+.set_attr<FCompute>("FCompute<cpu>", BatchNormAddReluGradCompute<cpu>);
+
 }  // namespace op
 }  // namespace mxnet
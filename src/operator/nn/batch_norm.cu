@@ -27,6 +27,7 @@
 #include <cuda_runtime_api.h>
 #include <algorithm>
 #include "batch_norm-inl.h"
+#include "batch_norm_add_relu-inl.h"
 
 #define WRITE_DATA_FLAG       1
 #define WRITE_GAMMA_FLAG      2
@@ -140,6 +141,7 @@ struct GradOp {
 #if CUDA_VERSION >= 9000
 #define FULLMASK 0xFFFFFFFF
 #define __shfl_xor(...) __shfl_xor_sync(FULLMASK, __VA_ARGS__)
+#define __ballot(...) __ballot_sync(FULLMASK, __VA_ARGS__)
 #endif
 
 // Sum across all threads within a warp
@@ -299,6 +301,72 @@ __global__ void BatchNormalizationUpdateOutputKernel(
   }
 }
 
+// BatchNormalizationUpdateOutputKernel writing relu(normalized + addend), and
+// one bit per output that is positive: a warp handles 32 consecutive x of a
+// (plane, batch) row, which is one word of the mask
+template<typename DType, typename AccReal, typename DeviceTensor1, typename DeviceTensor>
+__global__ void BatchNormAddReluUpdateOutputKernel(
+  DeviceTensor input,
+  DeviceTensor addend,
+  DeviceTensor output,
+  int32_t *mask,
+  DeviceTensor1 weight,
+  DeviceTensor1 bias,
+  const AccReal epsilon,
+  DeviceTensor1 saveMean,
+  DeviceTensor1 saveInvStd,
+  const uint32_t flags) {
+  const int plane = blockIdx.x;
+  const int N = input.OuterSize() * input.InnerSize();
+
+  const AccReal norm = AccReal(1) / N;
+
+  const AccReal mean = reduce<AccReal>(
+    SumOp<DType, AccReal, DeviceTensor>(input), input, plane) * norm;
+  __syncthreads();
+  const AccReal varN = reduce<AccReal>(VarOp<DType, AccReal, DeviceTensor>(mean, input),
+                                       input, plane);
+  AccReal invStd = 0;
+  if (varN != AccReal(0) || epsilon != AccReal(0)) {
+    invStd = AccReal(1.0) / sqrt(varN * norm + epsilon);
+  }
+
+  if (threadIdx.x == 0) {
+    saveMean[plane] = ScalarConvert<AccReal, DType>::to(mean);
+    saveInvStd[plane] = invStd;
+    if ((flags & WRITE_GAMMA_FLAG) != 0 && (flags & FIX_GAMMA_FLAG) != 0
+        && weight.numElements() > 0) {
+      weight[plane] = AccReal(1);
+    }
+  }
+
+  const AccReal gamma = ((flags & FIX_GAMMA_FLAG) == 0 && weight.numElements() > 0)
+                        ? ScalarConvert<DType, AccReal>::to(weight[plane])
+                        : ScalarConvert<int, AccReal>::to(1);
+  const AccReal beta = bias.numElements() > 0 ? ScalarConvert<DType, AccReal>::to(bias[plane])
+                                              : ScalarConvert<int, AccReal>::to(0);
+  const int nx = input.InnerSize();
+  const int words = (nx + WARP_SIZE - 1) / WARP_SIZE;
+  for (int batch = 0, nbatch = input.OuterSize(); batch < nbatch; ++batch) {
+    int32_t *row_mask = mask + (plane * nbatch + batch) * words;
+    // every lane takes part in the ballot, so the loop runs while any of the warp has an x
+    for (int x0 = 0; x0 < nx; x0 += blockDim.x) {
+      const int x = x0 + threadIdx.x;
+      bool positive = false;
+      if (x < nx) {
+        const AccReal v = gamma * (input.get_ref(batch, plane, x) - mean) * invStd + beta +
+                          ScalarConvert<DType, AccReal>::to(addend.get_ref(batch, plane, x));
+        positive = v > AccReal(0);
+        output.get_ref(batch, plane, x) = ScalarConvert<AccReal, DType>::to(positive ? v : 0);
+      }
+      const unsigned bits = __ballot(positive);
+      if (threadIdx.x % WARP_SIZE == 0 && x < nx) {
+        row_mask[x / WARP_SIZE] = static_cast<int32_t>(bits);
+      }
+    }
+  }
+}
+
 template<typename DeviceTensor1>
 struct CUDATensors {
   DeviceTensor1 gradWeight;
@@ -527,6 +595,35 @@ static void BatchNormalizationUpdateOutput(mshadow::Stream<gpu> *s,
   MSHADOW_CUDA_POST_KERNEL_CHECK(BatchNormalizationUpdateOutput);
 }
 
+template<typename DType, typename AccReal>
+static void BatchNormAddReluUpdateOutput(mshadow::Stream<gpu> *s,
+                                         const BatchNormParam& param,
+                                         const std::vector<TBlob> &in_data,
+                                         const TBlob &addend_data,
+                                         const std::vector<TBlob> &out_data,
+                                         const TBlob &mask,
+                                         const uint32_t flags,
+                                         double eps) {
+  batchnorm::BNTensor3<DType> input  = batchnorm::BNTensor3<DType>(
+    in_data[batchnorm::kData], param.axis);
+  batchnorm::BNTensor3<DType> addend  = batchnorm::BNTensor3<DType>(addend_data, param.axis);
+  batchnorm::BNTensor3<DType> output = batchnorm::BNTensor3<DType>(
+    out_data[batchnorm::kOut], param.axis);
+  DeviceTensor1 weight = devicetensor<AccReal, 1>(in_data[batchnorm::kGamma]);
+  DeviceTensor1 bias = devicetensor<AccReal, 1>(in_data[batchnorm::kBeta]);
+  DeviceTensor1 saveMean = devicetensor<AccReal, 1>(out_data[batchnorm::kMean]);
+  DeviceTensor1 saveInvStd = devicetensor<AccReal, 1>(out_data[batchnorm::kVar]);
+
+  DCHECK_GT(weight.numElements(), 0);
+  dim3 blocks(input.ChannelCount());
+  dim3 threads(batchnorm::cuda::getNumThreads(input.InnerSize(), false));
+  BatchNormAddReluUpdateOutputKernel<DType, AccReal, DeviceTensor1, batchnorm::BNTensor3<DType>>
+    <<< blocks, threads, 0, mshadow::Stream<gpu>::GetStream(s) >>> (
+    input, addend, output, mask.dptr<int32_t>(), weight, bias, eps, saveMean, saveInvStd,
+      flags);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(BatchNormAddReluUpdateOutput);
+}
+
 template<typename DType, typename AccReal>
 static void BatchNormalizationBackward(mshadow::Stream<gpu> *s,
                                        const OpContext &ctx,
@@ -641,6 +738,24 @@ void BatchNormBackwardImpl(mshadow::Stream<gpu> *stream,
   MSHADOW_CUDA_POST_KERNEL_CHECK(BatchNormOp_DoBackward_gpu);
 }
 
+/*! \brief Forward BatchNorm, elemwise_add and relu on GPU, fused for training */
+template<typename xpu, typename DType, typename AccReal>
+void BatchNormAddReluForwardImpl(mshadow::Stream<gpu> *stream,
+                                 const OpContext &ctx, const BatchNormParam& param,
+                                 const std::vector<TBlob> &in_data, const TBlob &addend,
+                                 const std::vector<OpReqType> &req,
+                                 const std::vector<TBlob> &out_data, const TBlob &mask,
+                                 const std::vector<TBlob> &aux_states) {
+  if (!ctx.is_train || param.use_global_stats) {
+    BatchNormThenAddRelu<xpu, DType, AccReal>(ctx, param, in_data, addend, req, out_data, mask,
+                                              aux_states);
+    return;
+  }
+  batchnorm::cuda::BatchNormAddReluUpdateOutput<DType, AccReal>(
+    stream, param, in_data, addend, out_data, mask,
+    SetupFlags<xpu, DType, AccReal>(ctx, param, req), param.eps);
+}
+
 #if MXNET_USE_CUDNN == 1 && CUDNN_MAJOR >= 4
 template<typename DType>
 static CuDNNBatchNormOp<DType> &GetCuDNNOp(const BatchNormParam& param) {
@@ -654,6 +769,14 @@ static CuDNNBatchNormOp<DType> &GetCuDNNOp(const BatchNormParam& param) {
 }
 #endif
 
+#if MXNET_USE_CUDNN == 1 && CUDNN_MAJOR >= 5
+/*! \brief whether cudnn normalizes over axis: the channel axis of NCHW or of NHWC */
+static bool CuDNNBatchNormAxis(const TShape &shape, int axis) {
+  return axis == mxnet::op::batchnorm::DEFAULT_AXIS ||
+         (shape.ndim() > 2 && axis == static_cast<int>(shape.ndim()) - 1);
+}
+#endif
+
 template<>
 void BatchNormCompute<gpu>(const nnvm::NodeAttrs& attrs,
                            const OpContext& ctx, const std::vector<TBlob>& inputs,
@@ -669,7 +792,7 @@ void BatchNormCompute<gpu>(const nnvm::NodeAttrs& attrs,
   param.axis = mxnet::op::batchnorm::GetRealAxis(shape, param.axis);
 #if MXNET_USE_CUDNN == 1 && CUDNN_MAJOR >= 5
   if (!param.use_global_stats && !param.cudnn_off && shape.ndim() <= 4
-      && param.axis == mxnet::op::batchnorm::DEFAULT_AXIS) {
+      && CuDNNBatchNormAxis(shape, param.axis)) {
     MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
       GetCuDNNOp<DType>(param).Forward(ctx, in_data, req, outputs, aux_states);
     })
@@ -698,7 +821,7 @@ void BatchNormGradCompute<gpu>(const nnvm::NodeAttrs& attrs,
   param.axis = mxnet::op::batchnorm::GetRealAxis(shape, param.axis);
 #if MXNET_USE_CUDNN == 1 && CUDNN_MAJOR >= 5
   if (!param.use_global_stats && !param.cudnn_off && shape.ndim() <= 4
-      && param.axis == mxnet::op::batchnorm::DEFAULT_AXIS) {
+      && CuDNNBatchNormAxis(shape, param.axis)) {
     MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
       GetCuDNNOp<DType>(param).Backward(ctx, inputs, req, outputs);
     })
@@ -720,5 +843,11 @@ NNVM_REGISTER_OP(BatchNorm)
 NNVM_REGISTER_OP(_backward_BatchNorm)
 .set_attr<FCompute>("FCompute<gpu>", BatchNormGradCompute<gpu>);
 
+NNVM_REGISTER_OP(BatchNormAddRelu)
+.set_attr<FCompute>("FCompute<gpu>", BatchNormAddReluCompute<gpu>);
+
+NNVM_REGISTER_OP(_backward_BatchNormAddRelu)
+.set_attr<FCompute>("FCompute<gpu>", BatchNormAddReluGradCompute<gpu>);
+
 }  // namespace op
 }  // namespace mxnet
@@ -0,0 +1,228 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file batch_norm_add_relu-inl.h
+ * \brief BatchNorm followed by the sum with an addend and a relu, saving a
+ *        bitmask of the positive outputs for the backward pass
+*/
+#ifndef MXNET_OPERATOR_NN_BATCH_NORM_ADD_RELU_INL_H_
+#define MXNET_OPERATOR_NN_BATCH_NORM_ADD_RELU_INL_H_
+
+#include <dmlc/parameter.h>
+#include <mxnet/operator.h>
+#include <vector>
+#include "./batch_norm-inl.h"
+#include "../mshadow_op.h"
+#include "../mxnet_op.h"
+#include "../operator_common.h"
+
+namespace mxnet {
+namespace op {
+
+namespace bnaddrelu {
+enum BatchNormAddReluOpOutputs {kOut, kMean, kVar, kMask};
+enum BatchNormAddReluOpResource {kTempSpace};
+/*! \brief number of elements whose relu mask is kept in one word */
+constexpr int kMaskBits = 32;
+}  // namespace bnaddrelu
+
+struct BatchNormAddReluParam : public dmlc::Parameter<BatchNormAddReluParam> {
+  bool addend_first;
+  DMLC_DECLARE_PARAMETER(BatchNormAddReluParam) {
+    DMLC_DECLARE_FIELD(addend_first).set_default(false)
+    .describe("Whether addend is the first input instead of the last one.");
+  }
+};
+
+/*! \brief parsed attributes, the BatchNorm ones are parsed as by BatchNorm */
+struct BatchNormAddReluAttrs {
+  BatchNormParam bn;
+  BatchNormAddReluParam fused;
+};
+
+/*! \brief index of data, the other BatchNorm inputs follow it in their usual order */
+inline int BNAddReluDataIndex(const BatchNormAddReluAttrs& param) {
+  return param.fused.addend_first ? 1 : 0;
+}
+
+inline int BNAddReluAddendIndex(const BatchNormAddReluAttrs& param) {
+  return param.fused.addend_first ? 0 : 5;
+}
+
+/*!
+ * \brief sizes of the axes before, at and after the channel axis, and the
+ *  number of mask words of every (channel, outer index) row
+ */
+struct BNAddReluGeometry {
+  int outer, channel, inner, words;
+  BNAddReluGeometry(const TShape& dshape, int axis) : outer(1), channel(dshape[axis]), inner(1) {
+    for (int i = 0; i < axis; ++i) outer *= dshape[i];
+    for (int i = axis + 1; i < static_cast<int>(dshape.ndim()); ++i) inner *= dshape[i];
+    words = (inner + bnaddrelu::kMaskBits - 1) / bnaddrelu::kMaskBits;
+  }
+  /*! \brief number of words of the mask, which is laid out as (channel, outer, words) */
+  index_t MaskSize() const {
+    return static_cast<index_t>(channel) * outer * words;
+  }
+};
+
+/*! \brief out = max(out + addend, 0) over the elements of one mask word, setting its bits */
+struct BNAddReluMaskKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, DType *out, const DType *addend, int32_t *mask,
+                                  int outer, int channel, int inner, int words) {
+    const int row = i / words;
+    const int x0 = (i % words) * bnaddrelu::kMaskBits;
+    const int offset = ((row % outer) * channel + row / outer) * inner + x0;
+    const int n = inner - x0 < bnaddrelu::kMaskBits ? inner - x0 : bnaddrelu::kMaskBits;
+    uint32_t bits = 0;
+    for (int b = 0; b < n; ++b) {
+      const DType v = out[offset + b] + addend[offset + b];
+      if (v > DType(0)) {
+        out[offset + b] = v;
+        bits |= 1U << b;
+      } else {
+        out[offset + b] = DType(0);
+      }
+    }
+    mask[i] = static_cast<int32_t>(bits);
+  }
+};
+
+/*! \brief gradient of the relu: ograd where the output was positive, 0 elsewhere */
+struct BNAddReluMaskGradKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, DType *igrad, const DType *ograd, const int32_t *mask,
+                                  int outer, int channel, int inner, int words) {
+    const int x = i % inner;
+    const int plane = (i / inner) % channel;
+    const int batch = i / inner / channel;
+    const uint32_t bits = static_cast<uint32_t>(mask[(plane * outer + batch) * words +
+                                                     x / bnaddrelu::kMaskBits]);
+    igrad[i] = (bits >> (x % bnaddrelu::kMaskBits)) & 1U ? ograd[i] : DType(0);
+  }
+};
+
+/*! \brief the BatchNorm, then the sum and relu in a second pass over its output */
+template<typename xpu, typename DType, typename AccReal>
+void BatchNormThenAddRelu(const OpContext &ctx, const BatchNormParam& param,
+                          const std::vector<TBlob> &in_data, const TBlob &addend,
+                          const std::vector<OpReqType> &req,
+                          const std::vector<TBlob> &out_data, const TBlob &mask,
+                          const std::vector<TBlob> &aux_states) {
+  BatchNormForward<xpu, DType, AccReal>(ctx, param, in_data, req, out_data, aux_states);
+  const TBlob &out = out_data[batchnorm::kOut];
+  const BNAddReluGeometry geo(out.shape_, param.axis);
+  mxnet_op::Kernel<BNAddReluMaskKernel, xpu>::Launch(
+      ctx.get_stream<xpu>(), geo.MaskSize(), out.dptr<DType>(), addend.dptr<DType>(),
+      mask.dptr<int32_t>(), geo.outer, geo.channel, geo.inner, geo.words);
+}
+
+template<typename xpu, typename DType, typename AccReal>
+void BatchNormAddReluForwardImpl(mshadow::Stream<cpu> *stream,
+                                 const OpContext &ctx, const BatchNormParam& param,
+                                 const std::vector<TBlob> &in_data, const TBlob &addend,
+                                 const std::vector<OpReqType> &req,
+                                 const std::vector<TBlob> &out_data, const TBlob &mask,
+                                 const std::vector<TBlob> &aux_states) {
+  BatchNormThenAddRelu<xpu, DType, AccReal>(ctx, param, in_data, addend, req, out_data, mask,
+                                            aux_states);
+}
+
+/*! \brief on GPU the training forward is one pass over data and addend, see batch_norm.cu */
+template<typename xpu, typename DType, typename AccReal>
+void BatchNormAddReluForwardImpl(mshadow::Stream<gpu> *stream,
+                                 const OpContext &ctx, const BatchNormParam& param,
+                                 const std::vector<TBlob> &in_data, const TBlob &addend,
+                                 const std::vector<OpReqType> &req,
+                                 const std::vector<TBlob> &out_data, const TBlob &mask,
+                                 const std::vector<TBlob> &aux_states);
+
+template<typename xpu>
+void BatchNormAddReluCompute(const nnvm::NodeAttrs& attrs,
+                             const OpContext& ctx, const std::vector<TBlob>& inputs,
+                             const std::vector<OpReqType>& req,
+                             const std::vector<TBlob>& outputs) {
+  const BatchNormAddReluAttrs& attr = nnvm::get<BatchNormAddReluAttrs>(attrs.parsed);
+  CHECK_EQ(inputs.size(), 6U);
+  CHECK_EQ(outputs.size(), 4U);
+  const int data = BNAddReluDataIndex(attr);
+  BatchNormParam param = attr.bn;
+  param.axis = batchnorm::GetRealAxis(inputs[data].shape_, param.axis);
+  std::vector<TBlob> in_data(inputs.begin() + data, inputs.begin() + data + 3);
+  std::vector<TBlob> aux_states(inputs.begin() + data + 3, inputs.begin() + data + 5);
+  std::vector<TBlob> out_data(outputs.begin(), outputs.begin() + 3);
+  std::vector<OpReqType> bn_req(req.begin(), req.begin() + 3);
+  CHECK_EQ(req[bnaddrelu::kOut], kWriteTo);
+  MSHADOW_REAL_TYPE_SWITCH_EX(inputs[data].type_flag_, DType, AccReal, {
+    BatchNormAddReluForwardImpl<xpu, DType, AccReal>(
+        ctx.get_stream<xpu>(), ctx, param, in_data, inputs[BNAddReluAddendIndex(attr)], bn_req,
+        out_data, outputs[bnaddrelu::kMask], aux_states);
+  });
+}
+
+/*!
+ * \brief inputs are the output gradient, the mask and the inputs of the BatchNorm
+ *  backward after its output gradient, outputs the gradients of data, gamma,
+ *  beta and addend
+ */
+template<typename xpu>
+void BatchNormAddReluGradCompute(const nnvm::NodeAttrs& attrs,
+                                 const OpContext& ctx, const std::vector<TBlob>& inputs,
+                                 const std::vector<OpReqType>& req,
+                                 const std::vector<TBlob>& outputs) {
+  using namespace mxnet_op;
+  const BatchNormAddReluAttrs& attr = nnvm::get<BatchNormAddReluAttrs>(attrs.parsed);
+  CHECK_EQ(inputs.size(), 9U);
+  CHECK_EQ(outputs.size(), 4U);
+  const TBlob &ograd = inputs[0];
+  BatchNormParam param = attr.bn;
+  param.axis = batchnorm::GetRealAxis(ograd.shape_, param.axis);
+  const BNAddReluGeometry geo(ograd.shape_, param.axis);
+  mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
+  MSHADOW_REAL_TYPE_SWITCH_EX(ograd.type_flag_, DType, AccReal, {
+    // the gradient of the sum is the one of the addend, and the output
+    // gradient of the BatchNorm
+    TBlob grad_sum = outputs[3];
+    if (req[3] != kWriteTo && req[3] != kWriteInplace) {
+      grad_sum = TBlob(ctx.requested[bnaddrelu::kTempSpace]
+                       .get_space_typed<xpu, 1, DType>(mshadow::Shape1(ograd.Size()), s).dptr_,
+                       ograd.shape_, xpu::kDevMask);
+    }
+    Kernel<BNAddReluMaskGradKernel, xpu>::Launch(
+        s, ograd.Size(), grad_sum.dptr<DType>(), ograd.dptr<DType>(), inputs[1].dptr<int32_t>(),
+        geo.outer, geo.channel, geo.inner, geo.words);
+    if (req[3] == kAddTo) {
+      Kernel<op_with_req<mshadow_op::identity, kAddTo>, xpu>::Launch(
+          s, ograd.Size(), outputs[3].dptr<DType>(), grad_sum.dptr<DType>());
+    }
+    std::vector<TBlob> bn_inputs(inputs.begin() + 1, inputs.end());
+    bn_inputs[0] = grad_sum;
+    std::vector<OpReqType> bn_req(req.begin(), req.begin() + 3);
+    std::vector<TBlob> bn_outputs(outputs.begin(), outputs.begin() + 3);
+    BatchNormBackward<xpu, DType, AccReal>(ctx, param, bn_inputs, bn_req, bn_outputs);
+  });
+}
+
+}  // namespace op
+}  // namespace mxnet
+
+#endif  // MXNET_OPERATOR_NN_BATCH_NORM_ADD_RELU_INL_H_
@@ -92,6 +92,7 @@ class ConcatOp {
       Shape<3> dshape = Shape3(leading, in_data[i].shape_[axis], trailing);
       data[i] = in_data[i].get_with_shape<xpu, 3, DType>(dshape, s);
     }
+    if (req[concat_enum::kOut] != kAddTo && IsContiguousSlices(data, out)) return;
     Concatenate(data, &out, 1, req[concat_enum::kOut]);
   }
 
@@ -39,9 +39,11 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include "../operator_common.h"
 #include "../linalg.h"
+#include "./convolution_cpu-inl.h"
 #include "./im2col.h"
 
 
@@ -181,53 +183,17 @@ class ConvolutionOp {
     LayerSetUp(in_data[conv::kData].shape_, out_data[conv::kOut].shape_);
     Stream<xpu>* s = ctx.get_stream<xpu>();
 
-    // initialize weight and col_buffer 3D tensors for using gemm
-    index_t M = conv_out_channels_ / group_;
-    index_t N = conv_out_spatial_dim_;
-    index_t K = kernel_dim_;
-    Tensor<xpu, 3, DType> weight_3d = in_data[conv::kWeight].get_with_shape<xpu, 3, DType>(
-      Shape3(group_, M, K), s);
-    Tensor<xpu, 4, DType> output_4d = out_data[conv::kOut].get_with_shape<xpu, 4, DType>(
-      Shape4(num_, group_, M, N), s);
-
-    // no need to allocating memory and reordering in memory
-    if (is_1x1_) {
-      Tensor<xpu, 4, DType> input_4d = in_data[conv::kData].get_with_shape<xpu, 4, DType>(
-        Shape4(num_, group_, K, N), s);
-      for (index_t n = 0; n < num_; ++n) {
-        Tensor<xpu, 3, DType> input_3d = input_4d[n];
-        Tensor<xpu, 3, DType> output_3d = output_4d[n];
-        for (index_t g = 0; g < group_; ++g) {
-          linalg_gemm(weight_3d[g], input_3d[g], output_3d[g], false, false, s, req[conv::kOut]);
-        }
-      }
+    if (num_spatial_axes_ == 2 && !is_1x1_) {
+      // on CPU, Winograd or direct convolution if they are faster for the shape
+      conv_cpu::ConvolutionForward2D<DType>(s, ctx.requested[conv::kTempSpace], param_.kernel,
+                                            param_.stride, param_.pad, param_.dilate,
+                                            param_.num_group, in_data[conv::kData],
+                                            in_data[conv::kWeight], out_data[conv::kOut],
+                                            [&]() {
+                                              ForwardGemm(ctx, in_data, req, out_data);
+                                            });
     } else {
-      // allocate workspace for col_buffer
-      Tensor<xpu, 1, DType> workspace = ctx.requested[conv::kTempSpace]
-        .get_space_typed<xpu, 1, DType>(Shape1(col_buffer_size_), s);
-      // calculate the shape of col_buffer
-      TShape col_buffer_shape(num_spatial_axes_ + 1);
-      col_buffer_shape[0] = conv_in_channels_ * param_.kernel.Size();
-      for (index_t i = 1; i < col_buffer_shape.ndim(); ++i) {
-        col_buffer_shape[i] = out_data[0].shape_[i+1];
-      }
-      // create a column buffer using workspace and col_buffer_shape
-      TBlob col_buffer(workspace.dptr_, col_buffer_shape, xpu::kDevMask, DataType<DType>::kFlag);
-      Tensor<xpu, 3, DType> col_buffer_3d = col_buffer.get_with_shape<xpu, 3, DType>(
-        Shape3(group_, K, N), s);
-      for (index_t n = 0; n < num_; ++n) {
-        // transform image to col_buffer in order to use gemm
-        im2col(s, in_data[conv::kData].dptr<DType>()+n*input_dim_, in_data[conv::kData].shape_,
-               col_buffer.shape_, param_.kernel, param_.pad, param_.stride, param_.dilate,
-               col_buffer.dptr<DType>());
-        Tensor<xpu, 3, DType> output_3d = output_4d[n];
-        for (index_t g = 0; g < group_; ++g) {
-          // Legacy approach shown here for comparison:
-          //   Assign(output_3d[g], req[conv::kOut], dot(weight_3d[g], col_buffer_3d[g]));
-          linalg_gemm(weight_3d[g], col_buffer_3d[g], output_3d[g], false, false, s,
-            req[conv::kOut]);
-        }
-      }
+      ForwardGemm(ctx, in_data, req, out_data);
     }
 
     if (bias_term_) {
@@ -336,6 +302,63 @@ class ConvolutionOp {
   }
 
  private:
+  /*! \brief forward without bias with im2col and GEMM */
+  void ForwardGemm(const OpContext &ctx,
+                   const std::vector<TBlob> &in_data,
+                   const std::vector<OpReqType> &req,
+                   const std::vector<TBlob> &out_data) {
+    using namespace mshadow;
+    Stream<xpu>* s = ctx.get_stream<xpu>();
+    // initialize weight and col_buffer 3D tensors for using gemm
+    index_t M = conv_out_channels_ / group_;
+    index_t N = conv_out_spatial_dim_;
+    index_t K = kernel_dim_;
+    Tensor<xpu, 3, DType> weight_3d = in_data[conv::kWeight].get_with_shape<xpu, 3, DType>(
+      Shape3(group_, M, K), s);
+    Tensor<xpu, 4, DType> output_4d = out_data[conv::kOut].get_with_shape<xpu, 4, DType>(
+      Shape4(num_, group_, M, N), s);
+
+    // no need to allocating memory and reordering in memory
+    if (is_1x1_) {
+      Tensor<xpu, 4, DType> input_4d = in_data[conv::kData].get_with_shape<xpu, 4, DType>(
+        Shape4(num_, group_, K, N), s);
+      for (index_t n = 0; n < num_; ++n) {
+        Tensor<xpu, 3, DType> input_3d = input_4d[n];
+        Tensor<xpu, 3, DType> output_3d = output_4d[n];
+        for (index_t g = 0; g < group_; ++g) {
+          linalg_gemm(weight_3d[g], input_3d[g], output_3d[g], false, false, s, req[conv::kOut]);
+        }
+      }
+    } else {
+      // allocate workspace for col_buffer
+      Tensor<xpu, 1, DType> workspace = ctx.requested[conv::kTempSpace]
+        .get_space_typed<xpu, 1, DType>(Shape1(col_buffer_size_), s);
+      // calculate the shape of col_buffer
+      TShape col_buffer_shape(num_spatial_axes_ + 1);
+      col_buffer_shape[0] = conv_in_channels_ * param_.kernel.Size();
+      for (index_t i = 1; i < col_buffer_shape.ndim(); ++i) {
+        col_buffer_shape[i] = out_data[0].shape_[i+1];
+      }
+      // create a column buffer using workspace and col_buffer_shape
+      TBlob col_buffer(workspace.dptr_, col_buffer_shape, xpu::kDevMask, DataType<DType>::kFlag);
+      Tensor<xpu, 3, DType> col_buffer_3d = col_buffer.get_with_shape<xpu, 3, DType>(
+        Shape3(group_, K, N), s);
+      for (index_t n = 0; n < num_; ++n) {
+        // transform image to col_buffer in order to use gemm
+        im2col(s, in_data[conv::kData].dptr<DType>()+n*input_dim_, in_data[conv::kData].shape_,
+               col_buffer.shape_, param_.kernel, param_.pad, param_.stride, param_.dilate,
+               col_buffer.dptr<DType>());
+        Tensor<xpu, 3, DType> output_3d = output_4d[n];
+        for (index_t g = 0; g < group_; ++g) {
+          // Legacy approach shown here for comparison:
+          //   Assign(output_3d[g], req[conv::kOut], dot(weight_3d[g], col_buffer_3d[g]));
+          linalg_gemm(weight_3d[g], col_buffer_3d[g], output_3d[g], false, false, s,
+            req[conv::kOut]);
+        }
+      }
+    }
+  }
+
   void LayerSetUp(const TShape& ishape, const TShape& oshape) {
     channel_axis_ = 1;  // hard code channel axis
     const index_t first_spatial_axis = channel_axis_ + 1;
@@ -392,12 +415,97 @@ class ConvolutionOp {
   bool is_1x1_;
 };  // class ConvolutionOp
 
+/*!
+ * \brief whether the convolution is depthwise, one group per input channel,
+ *  and runs on the CPU depthwise kernels instead of grouped im2col + GEMM
+ */
+inline bool SupportCPUDepthwise(const ConvolutionParam& param, const TShape& dshape) {
+  if (param.kernel.ndim() != 2 || param.num_group == 1 || dshape.ndim() != 4) return false;
+  const int layout = param.layout.has_value() ? param.layout.value() : mshadow::kNCHW;
+  if (layout != mshadow::kNCHW && layout != mshadow::kNHWC) return false;
+  const index_t channels = dshape[layout == mshadow::kNHWC ? 3 : 1];
+  return param.num_group == channels && param.num_filter % param.num_group == 0;
+}
+
+inline conv_cpu::DepthwiseShape GetDepthwiseShape(const ConvolutionParam& param,
+                                                  const TShape& dshape, const TShape& oshape) {
+  conv_cpu::DepthwiseShape p;
+  p.nhwc = param.layout.has_value() && param.layout.value() == mshadow::kNHWC;
+  p.num = dshape[0];
+  p.channels = dshape[p.nhwc ? 3 : 1];
+  p.height = dshape[p.nhwc ? 1 : 2];
+  p.width = dshape[p.nhwc ? 2 : 3];
+  p.num_filter = param.num_filter;
+  p.out_h = oshape[p.nhwc ? 1 : 2];
+  p.out_w = oshape[p.nhwc ? 2 : 3];
+  p.kernel_h = param.kernel[0];
+  p.kernel_w = param.kernel[1];
+  p.stride_h = param.stride[0];
+  p.stride_w = param.stride[1];
+  p.pad_h = param.pad[0];
+  p.pad_w = param.pad[1];
+  p.dilate_h = param.dilate[0];
+  p.dilate_w = param.dilate[1];
+  return p;
+}
+
+/*! \brief the weight transposed for the NHWC kernels, nullptr for NCHW */
+template<typename DType>
+inline DType* DepthwiseWeightT(const OpContext& ctx, const conv_cpu::DepthwiseShape& p,
+                               const TBlob& weight) {
+  if (!p.nhwc) return nullptr;
+  mshadow::Tensor<cpu, 1, DType> wt = ctx.requested[conv::kTempSpace]
+      .get_space_typed<cpu, 1, DType>(mshadow::Shape1(weight.Size()), ctx.get_stream<cpu>());
+  conv_cpu::TransposeDepthwiseWeight(p, weight.dptr<DType>(), wt.dptr_);
+  return wt.dptr_;
+}
+
+template<typename DType>
+void DepthwiseConvolutionForwardCPU(const ConvolutionParam& param, const OpContext& ctx,
+                                    const std::vector<TBlob>& inputs,
+                                    const std::vector<OpReqType>& req,
+                                    const std::vector<TBlob>& outputs) {
+  if (req[conv::kOut] == kNullOp) return;
+  CHECK_NE(req[conv::kOut], kAddTo) << "AddTo is not supported by depthwise convolution";
+  const conv_cpu::DepthwiseShape p =
+      GetDepthwiseShape(param, inputs[conv::kData].shape_, outputs[conv::kOut].shape_);
+  const TBlob& weight = inputs[conv::kWeight];
+  conv_cpu::DepthwiseForward(p, inputs[conv::kData].dptr<DType>(), weight.dptr<DType>(),
+                             DepthwiseWeightT<DType>(ctx, p, weight),
+                             param.no_bias ? nullptr : inputs[conv::kBias].dptr<DType>(),
+                             outputs[conv::kOut].dptr<DType>());
+}
+
+template<typename DType>
+void DepthwiseConvolutionBackwardCPU(const ConvolutionParam& param, const OpContext& ctx,
+                                     const TBlob& out_grad, const std::vector<TBlob>& in_data,
+                                     const std::vector<OpReqType>& req,
+                                     const std::vector<TBlob>& in_grad) {
+  const conv_cpu::DepthwiseShape p =
+      GetDepthwiseShape(param, in_data[conv::kData].shape_, out_grad.shape_);
+  const TBlob& weight = in_data[conv::kWeight];
+  const DType* wt = req[conv::kData] == kNullOp ? nullptr :
+      DepthwiseWeightT<DType>(ctx, p, weight);
+  conv_cpu::DepthwiseBackward(p, out_grad.dptr<DType>(), in_data[conv::kData].dptr<DType>(),
+                              weight.dptr<DType>(), wt,
+                              in_grad[conv::kData].dptr<DType>(), req[conv::kData],
+                              in_grad[conv::kWeight].dptr<DType>(), req[conv::kWeight],
+                              param.no_bias ? nullptr : in_grad[conv::kBias].dptr<DType>(),
+                              param.no_bias ? kNullOp : req[conv::kBias]);
+}
+
 template<typename xpu>
 void ConvolutionCompute(const nnvm::NodeAttrs& attrs,
                         const OpContext& ctx, const std::vector<TBlob>& inputs,
                         const std::vector<OpReqType>& req,
                         const std::vector<TBlob>& outputs) {
   const ConvolutionParam& param = nnvm::get<ConvolutionParam>(attrs.parsed);
+  if (std::is_same<xpu, cpu>::value && SupportCPUDepthwise(param, inputs[conv::kData].shape_)) {
+    MSHADOW_REAL_TYPE_SWITCH(inputs[conv::kData].type_flag_, DType, {
+      DepthwiseConvolutionForwardCPU<DType>(param, ctx, inputs, req, outputs);
+    });
+    return;
+  }
   MSHADOW_REAL_TYPE_SWITCH(inputs[conv::kData].type_flag_, DType, {
     ConvolutionOp<xpu, DType> op;
     op.Init(param);
@@ -415,6 +523,12 @@ void ConvolutionGradCompute(const nnvm::NodeAttrs& attrs,
   const TBlob &out_grad = inputs[0];
   const std::vector<TBlob> &in_grad = outputs;
 
+  if (std::is_same<xpu, cpu>::value && SupportCPUDepthwise(param, in_data[conv::kData].shape_)) {
+    MSHADOW_REAL_TYPE_SWITCH(out_grad.type_flag_, DType, {
+      DepthwiseConvolutionBackwardCPU<DType>(param, ctx, out_grad, in_data, req, in_grad);
+    });
+    return;
+  }
   MSHADOW_REAL_TYPE_SWITCH(out_grad.type_flag_, DType, {
     ConvolutionOp<xpu, DType> op;
     op.Init(param);
@@ -0,0 +1,657 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file convolution_cpu-inl.h
+ * \brief Winograd and direct 2D convolution forward on CPU, the autotuner
+ *        choosing between them and im2col + GEMM for every convolution shape,
+ *        and the depthwise convolution kernels
+ */
+#ifndef MXNET_OPERATOR_NN_CONVOLUTION_CPU_INL_H_
+#define MXNET_OPERATOR_NN_CONVOLUTION_CPU_INL_H_
+
+#include <dmlc/parameter.h>
+#include <mxnet/base.h>
+#include <mxnet/op_attr_types.h>
+#include <mxnet/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "../linalg.h"
+#include "../../engine/openmp.h"
+
+namespace mxnet {
+namespace op {
+namespace conv_cpu {
+
+enum ConvCPUAlgo {kIm2col, kDirect, kWinograd2, kWinograd4};
+
+/*!
+ * \brief transforms of Winograd F(m x m, 3 x 3), see Lavin and Gray, "Fast
+ *  Algorithms for Convolutional Neural Networks": the output tile is
+ *  AT * ((G * g * GT) .* (BT * d * B)) * A for the alpha x alpha input tile d.
+ */
+template<int m>
+struct Winograd;
+
+template<>
+struct Winograd<2> {
+  static const int alpha = 4;
+  static const float* BT() {
+    static const float v[] = {1, 0, -1, 0,
+                              0, 1, 1, 0,
+                              0, -1, 1, 0,
+                              0, 1, 0, -1};
+    return v;
+  }
+  static const float* G() {
+    static const float v[] = {1, 0, 0,
+                              0.5f, 0.5f, 0.5f,
+                              0.5f, -0.5f, 0.5f,
+                              0, 0, 1};
+    return v;
+  }
+  static const float* AT() {
+    static const float v[] = {1, 1, 1, 0,
+                              0, 1, -1, -1};
+    return v;
+  }
+};
+
+template<>
+struct Winograd<4> {
+  static const int alpha = 6;
+  static const float* BT() {
+    static const float v[] = {4, 0, -5, 0, 1, 0,
+                              0, -4, -4, 1, 1, 0,
+                              0, 4, -4, -1, 1, 0,
+                              0, -2, -1, 2, 1, 0,
+                              0, 2, -1, -2, 1, 0,
+                              0, 4, 0, -5, 0, 1};
+    return v;
+  }
+  static const float* G() {
+    static const float v[] = {1.0f / 4, 0, 0,
+                              -1.0f / 6, -1.0f / 6, -1.0f / 6,
+                              -1.0f / 6, 1.0f / 6, -1.0f / 6,
+                              1.0f / 24, 1.0f / 12, 1.0f / 6,
+                              1.0f / 24, -1.0f / 12, 1.0f / 6,
+                              0, 0, 1};
+    return v;
+  }
+  static const float* AT() {
+    static const float v[] = {1, 1, 1, 1, 1, 0,
+                              0, 1, -1, 2, -2, 0,
+                              0, 1, 1, 4, 4, 0,
+                              0, 1, -1, 8, -8, 1};
+    return v;
+  }
+};
+
+/*! \brief out (r x c) = lhs (r x k) * rhs (k x c), with lhs constant */
+template<typename DType>
+inline void SmallGemm(const float* lhs, const DType* rhs, DType* out, int r, int k, int c) {
+  for (int i = 0; i < r; ++i) {
+    for (int j = 0; j < c; ++j) {
+      DType sum = 0;
+      for (int l = 0; l < k; ++l) sum += lhs[i * k + l] * rhs[l * c + j];
+      out[i * c + j] = sum;
+    }
+  }
+}
+
+/*! \brief out (r x c) = lhs (r x k) * transposed rhs, with rhs (c x k) constant */
+template<typename DType>
+inline void SmallGemmTransConst(const DType* lhs, const float* rhs, DType* out,
+                                int r, int k, int c) {
+  for (int i = 0; i < r; ++i) {
+    for (int j = 0; j < c; ++j) {
+      DType sum = 0;
+      for (int l = 0; l < k; ++l) sum += lhs[i * k + l] * rhs[j * k + l];
+      out[i * c + j] = sum;
+    }
+  }
+}
+
+/*! \brief elements of the workspace of a Winograd convolution of one image */
+template<int m>
+inline size_t WinogradWorkspaceSize(const TShape& dshape, const TShape& oshape,
+                                    int num_filter) {
+  const int alpha = Winograd<m>::alpha;
+  const size_t tiles = static_cast<size_t>((oshape[2] + m - 1) / m) * ((oshape[3] + m - 1) / m);
+  return static_cast<size_t>(alpha) * alpha *
+      (static_cast<size_t>(num_filter) * dshape[1] + dshape[1] * tiles + num_filter * tiles);
+}
+
+/*!
+ * \brief 3x3 convolution with stride 1, without dilation and groups. The
+ *  products of the transformed tiles are alpha * alpha GEMMs over the channels.
+ */
+template<int m, typename DType>
+inline void WinogradForward(mshadow::Stream<cpu>* s, const TBlob& data, const TBlob& weight,
+                            const TBlob& out, int pad_y, int pad_x,
+                            mshadow::Tensor<cpu, 1, DType> workspace) {
+  using namespace mshadow;
+  const int alpha = Winograd<m>::alpha;
+  const int a2 = alpha * alpha;
+  const int num = data.shape_[0], channels = data.shape_[1];
+  const int height = data.shape_[2], width = data.shape_[3];
+  const int num_filter = out.shape_[1], out_h = out.shape_[2], out_w = out.shape_[3];
+  const int tiles_y = (out_h + m - 1) / m, tiles_x = (out_w + m - 1) / m;
+  const int tiles = tiles_y * tiles_x;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  DType* u = workspace.dptr_;
+  DType* v = u + static_cast<size_t>(a2) * num_filter * channels;
+  DType* mm = v + static_cast<size_t>(a2) * channels * tiles;
+  const float* bt = Winograd<m>::BT();
+  const float* g = Winograd<m>::G();
+  const float* at = Winograd<m>::AT();
+
+  // u[xi][k][c] = (G * w[k][c] * GT)[xi]
+  const DType* w = weight.dptr<DType>();
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int kc = 0; kc < num_filter * channels; ++kc) {
+    DType tmp[6 * 3], tile[6 * 6];
+    SmallGemm(g, w + kc * 9, tmp, alpha, 3, 3);
+    SmallGemmTransConst(tmp, g, tile, alpha, 3, alpha);
+    for (int xi = 0; xi < a2; ++xi) {
+      u[static_cast<size_t>(xi) * num_filter * channels + kc] = tile[xi];
+    }
+  }
+
+  for (int n = 0; n < num; ++n) {
+    const DType* in = data.dptr<DType>() + static_cast<size_t>(n) * channels * height * width;
+    DType* output = out.dptr<DType>() + static_cast<size_t>(n) * num_filter * out_h * out_w;
+    // v[xi][c][t] = (BT * d[c][t] * B)[xi]
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int ct = 0; ct < channels * tiles; ++ct) {
+      const int c = ct / tiles, t = ct % tiles;
+      const int y0 = (t / tiles_x) * m - pad_y, x0 = (t % tiles_x) * m - pad_x;
+      DType d[6 * 6], tmp[6 * 6], tile[6 * 6];
+      for (int i = 0; i < alpha; ++i) {
+        for (int j = 0; j < alpha; ++j) {
+          const int y = y0 + i, x = x0 + j;
+          d[i * alpha + j] = (y >= 0 && y < height && x >= 0 && x < width) ?
+              in[(static_cast<size_t>(c) * height + y) * width + x] : DType(0);
+        }
+      }
+      SmallGemm(bt, d, tmp, alpha, alpha, alpha);
+      SmallGemmTransConst(tmp, bt, tile, alpha, alpha, alpha);
+      for (int xi = 0; xi < a2; ++xi) {
+        v[(static_cast<size_t>(xi) * channels + c) * tiles + t] = tile[xi];
+      }
+    }
+    // mm[xi] = u[xi] * v[xi]
+    for (int xi = 0; xi < a2; ++xi) {
+      Tensor<cpu, 2, DType> u_xi(u + static_cast<size_t>(xi) * num_filter * channels,
+                                 Shape2(num_filter, channels), s);
+      Tensor<cpu, 2, DType> v_xi(v + static_cast<size_t>(xi) * channels * tiles,
+                                 Shape2(channels, tiles), s);
+      Tensor<cpu, 2, DType> m_xi(mm + static_cast<size_t>(xi) * num_filter * tiles,
+                                 Shape2(num_filter, tiles), s);
+      linalg_gemm(u_xi, v_xi, m_xi, false, false, s, kWriteTo);
+    }
+    // out[k][t] = AT * mm[k][t] * A
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int kt = 0; kt < num_filter * tiles; ++kt) {
+      const int k = kt / tiles, t = kt % tiles;
+      const int y0 = (t / tiles_x) * m, x0 = (t % tiles_x) * m;
+      DType tile[6 * 6], tmp[4 * 6], res[4 * 4];
+      for (int xi = 0; xi < a2; ++xi) {
+        tile[xi] = mm[(static_cast<size_t>(xi) * num_filter + k) * tiles + t];
+      }
+      SmallGemm(at, tile, tmp, m, alpha, alpha);
+      SmallGemmTransConst(tmp, at, res, m, alpha, m);
+      for (int i = 0; i < m && y0 + i < out_h; ++i) {
+        for (int j = 0; j < m && x0 + j < out_w; ++j) {
+          output[(static_cast<size_t>(k) * out_h + y0 + i) * out_w + x0 + j] = res[i * m + j];
+        }
+      }
+    }
+  }
+}
+
+/*! \brief the range [lo, hi) of the output columns x with 0 <= x * stride + offset < width */
+inline void ValidColumns(int offset, int stride, int width, int out_w, int* lo, int* hi) {
+  *lo = std::max(0, (stride - 1 - offset) / stride);
+  *hi = std::min(out_w, (width - offset + stride - 1) / stride);
+}
+
+/*!
+ * \brief direct 2D convolution, accumulating every output plane in place. The
+ *  range of the output columns reading inside the image is computed for every
+ *  kernel column, so the inner loop has no bounds checks.
+ */
+template<typename DType>
+inline void DirectForward(const TBlob& data, const TBlob& weight, const TBlob& out,
+                          const TShape& kernel, const TShape& stride, const TShape& pad,
+                          const TShape& dilate, int num_group) {
+  const int num = data.shape_[0], channels = data.shape_[1];
+  const int height = data.shape_[2], width = data.shape_[3];
+  const int num_filter = out.shape_[1], out_h = out.shape_[2], out_w = out.shape_[3];
+  const int kh = kernel[0], kw = kernel[1], sh = stride[0], sw = stride[1];
+  const int ph = pad[0], pw = pad[1], dh = dilate[0], dw = dilate[1];
+  const int in_group = channels / num_group, out_group = num_filter / num_group;
+  const DType* in = data.dptr<DType>();
+  const DType* w = weight.dptr<DType>();
+  DType* output = out.dptr<DType>();
+  #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int nk = 0; nk < num * num_filter; ++nk) {
+    const int n = nk / num_filter, k = nk % num_filter;
+    const int c0 = (k / out_group) * in_group;
+    DType* plane = output + static_cast<size_t>(nk) * out_h * out_w;
+    std::fill(plane, plane + out_h * out_w, DType(0));
+    for (int c = 0; c < in_group; ++c) {
+      const DType* image = in + (static_cast<size_t>(n) * channels + c0 + c) * height * width;
+      const DType* filter = w + (static_cast<size_t>(k) * in_group + c) * kh * kw;
+      for (int i = 0; i < kh; ++i) {
+        for (int j = 0; j < kw; ++j) {
+          const DType f = filter[i * kw + j];
+          const int x_off = j * dw - pw;
+          int x_lo, x_hi;
+          ValidColumns(x_off, sw, width, out_w, &x_lo, &x_hi);
+          for (int y = 0; y < out_h; ++y) {
+            const int iy = y * sh + i * dh - ph;
+            if (iy < 0 || iy >= height) continue;
+            const DType* row = image + static_cast<size_t>(iy) * width;
+            DType* dst = plane + static_cast<size_t>(y) * out_w;
+            if (sw == 1) {
+              for (int x = x_lo; x < x_hi; ++x) dst[x] += f * row[x + x_off];
+            } else {
+              for (int x = x_lo; x < x_hi; ++x) dst[x] += f * row[x * sw + x_off];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/*! \brief shape of a 2D depthwise convolution, num_filter is a multiple of channels */
+struct DepthwiseShape {
+  int num, channels, height, width, num_filter, out_h, out_w;
+  int kernel_h, kernel_w, stride_h, stride_w, pad_h, pad_w, dilate_h, dilate_w;
+  bool nhwc;
+};
+
+/*! \brief out = in or out += in, as req asks */
+template<typename DType>
+inline void AssignReq(DType* out, OpReqType req, DType in) {
+  if (req == kAddTo) {
+    *out += in;
+  } else {
+    *out = in;
+  }
+}
+
+/*!
+ * \brief the weights of shape (num_filter, kernel_h, kernel_w), in both layouts,
+ *  transposed to (kernel_h, kernel_w, num_filter) so the NHWC loops over the
+ *  channels read them contiguously
+ */
+template<typename DType>
+inline void TransposeDepthwiseWeight(const DepthwiseShape& p, const DType* w, DType* wt) {
+  const int taps = p.kernel_h * p.kernel_w;
+  for (int k = 0; k < p.num_filter; ++k) {
+    for (int t = 0; t < taps; ++t) wt[t * p.num_filter + k] = w[k * taps + t];
+  }
+}
+
+/*!
+ * \brief forward of a depthwise convolution, wt is the transposed weight for
+ *  NHWC. NCHW runs one output plane per iteration, NHWC one output row.
+ */
+template<typename DType>
+inline void DepthwiseForward(const DepthwiseShape& p, const DType* in, const DType* w,
+                             const DType* wt, const DType* bias, DType* out) {
+  const int mult = p.num_filter / p.channels;
+  const int taps = p.kernel_h * p.kernel_w;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  const int num_k = p.num_filter;
+  if (!p.nhwc) {
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int nk = 0; nk < p.num * num_k; ++nk) {
+      const int n = nk / num_k, k = nk % num_k;
+      const DType* image = in + (static_cast<size_t>(n) * p.channels + k / mult) *
+          p.height * p.width;
+      const DType* filter = w + static_cast<size_t>(k) * taps;
+      DType* plane = out + static_cast<size_t>(nk) * p.out_h * p.out_w;
+      std::fill(plane, plane + p.out_h * p.out_w, bias == nullptr ? DType(0) : bias[k]);
+      for (int i = 0; i < p.kernel_h; ++i) {
+        for (int j = 0; j < p.kernel_w; ++j) {
+          const DType f = filter[i * p.kernel_w + j];
+          const int x_off = j * p.dilate_w - p.pad_w;
+          int x_lo, x_hi;
+          ValidColumns(x_off, p.stride_w, p.width, p.out_w, &x_lo, &x_hi);
+          for (int y = 0; y < p.out_h; ++y) {
+            const int iy = y * p.stride_h + i * p.dilate_h - p.pad_h;
+            if (iy < 0 || iy >= p.height) continue;
+            const DType* row = image + static_cast<size_t>(iy) * p.width;
+            DType* dst = plane + static_cast<size_t>(y) * p.out_w;
+            for (int x = x_lo; x < x_hi; ++x) dst[x] += f * row[x * p.stride_w + x_off];
+          }
+        }
+      }
+    }
+    return;
+  }
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int ny = 0; ny < p.num * p.out_h; ++ny) {
+    const int n = ny / p.out_h, y = ny % p.out_h;
+    DType* row = out + static_cast<size_t>(ny) * p.out_w * num_k;
+    for (int x = 0; x < p.out_w; ++x) {
+      for (int k = 0; k < num_k; ++k) {
+        row[x * num_k + k] = bias == nullptr ? DType(0) : bias[k];
+      }
+    }
+    for (int i = 0; i < p.kernel_h; ++i) {
+      const int iy = y * p.stride_h + i * p.dilate_h - p.pad_h;
+      if (iy < 0 || iy >= p.height) continue;
+      const DType* image_row = in + (static_cast<size_t>(n) * p.height + iy) *
+          p.width * p.channels;
+      for (int j = 0; j < p.kernel_w; ++j) {
+        const DType* f = wt + static_cast<size_t>(i * p.kernel_w + j) * num_k;
+        const int x_off = j * p.dilate_w - p.pad_w;
+        int x_lo, x_hi;
+        ValidColumns(x_off, p.stride_w, p.width, p.out_w, &x_lo, &x_hi);
+        for (int x = x_lo; x < x_hi; ++x) {
+          const DType* src = image_row + static_cast<size_t>(x * p.stride_w + x_off) *
+              p.channels;
+          DType* dst = row + static_cast<size_t>(x) * num_k;
+          if (mult == 1) {
+            for (int k = 0; k < num_k; ++k) dst[k] += f[k] * src[k];
+          } else {
+            for (int k = 0; k < num_k; ++k) dst[k] += f[k] * src[k / mult];
+          }
+        }
+      }
+    }
+  }
+}
+
+/*!
+ * \brief backward of a depthwise convolution, every gradient is skipped when
+ *  its req is kNullOp or its pointer is nullptr. The data gradient of NCHW
+ *  scatters one input plane per iteration and the one of NHWC gathers one
+ *  input row, so no two iterations write the same element.
+ */
+template<typename DType>
+inline void DepthwiseBackward(const DepthwiseShape& p, const DType* ograd, const DType* in,
+                              const DType* w, const DType* wt, DType* igrad, OpReqType req_data,
+                              DType* wgrad, OpReqType req_weight, DType* bgrad,
+                              OpReqType req_bias) {
+  const int mult = p.num_filter / p.channels;
+  const int taps = p.kernel_h * p.kernel_w;
+  const int num_k = p.num_filter;
+  const size_t out_plane = static_cast<size_t>(p.out_h) * p.out_w;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  if (igrad != nullptr && req_data != kNullOp) {
+    if (!p.nhwc) {
+      #pragma omp parallel for num_threads(omp_threads)
+      for (int nc = 0; nc < p.num * p.channels; ++nc) {
+        const int n = nc / p.channels, c = nc % p.channels;
+        DType* plane = igrad + static_cast<size_t>(nc) * p.height * p.width;
+        if (req_data != kAddTo) std::fill(plane, plane + p.height * p.width, DType(0));
+        for (int k = c * mult; k < (c + 1) * mult; ++k) {
+          const DType* og = ograd + (static_cast<size_t>(n) * num_k + k) * out_plane;
+          for (int i = 0; i < p.kernel_h; ++i) {
+            for (int j = 0; j < p.kernel_w; ++j) {
+              const DType f = w[static_cast<size_t>(k) * taps + i * p.kernel_w + j];
+              const int x_off = j * p.dilate_w - p.pad_w;
+              int x_lo, x_hi;
+              ValidColumns(x_off, p.stride_w, p.width, p.out_w, &x_lo, &x_hi);
+              for (int y = 0; y < p.out_h; ++y) {
+                const int iy = y * p.stride_h + i * p.dilate_h - p.pad_h;
+                if (iy < 0 || iy >= p.height) continue;
+                DType* dst = plane + static_cast<size_t>(iy) * p.width;
+                const DType* src = og + static_cast<size_t>(y) * p.out_w;
+                for (int x = x_lo; x < x_hi; ++x) dst[x * p.stride_w + x_off] += f * src[x];
+              }
+            }
+          }
+        }
+      }
+    } else {
+      #pragma omp parallel for num_threads(omp_threads)
+      for (int nr = 0; nr < p.num * p.height; ++nr) {
+        const int n = nr / p.height, iy = nr % p.height;
+        DType* row = igrad + static_cast<size_t>(nr) * p.width * p.channels;
+        if (req_data != kAddTo) std::fill(row, row + p.width * p.channels, DType(0));
+        for (int i = 0; i < p.kernel_h; ++i) {
+          const int ty = iy + p.pad_h - i * p.dilate_h;
+          if (ty < 0 || ty % p.stride_h != 0 || ty / p.stride_h >= p.out_h) continue;
+          const DType* og_row = ograd + (static_cast<size_t>(n) * p.out_h + ty / p.stride_h) *
+              p.out_w * num_k;
+          for (int j = 0; j < p.kernel_w; ++j) {
+            const DType* f = wt + static_cast<size_t>(i * p.kernel_w + j) * num_k;
+            for (int ix = 0; ix < p.width; ++ix) {
+              const int tx = ix + p.pad_w - j * p.dilate_w;
+              if (tx < 0 || tx % p.stride_w != 0 || tx / p.stride_w >= p.out_w) continue;
+              const DType* src = og_row + static_cast<size_t>(tx / p.stride_w) * num_k;
+              DType* dst = row + static_cast<size_t>(ix) * p.channels;
+              if (mult == 1) {
+                for (int c = 0; c < p.channels; ++c) dst[c] += f[c] * src[c];
+              } else {
+                for (int k = 0; k < num_k; ++k) dst[k / mult] += f[k] * src[k];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  const bool need_weight = wgrad != nullptr && req_weight != kNullOp;
+  const bool need_bias = bgrad != nullptr && req_bias != kNullOp;
+  if (!need_weight && !need_bias) return;
+  if (!p.nhwc) {
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int k = 0; k < num_k; ++k) {
+      const int c = k / mult;
+      for (int t = 0; t < taps && need_weight; ++t) {
+        const int i = t / p.kernel_w, j = t % p.kernel_w;
+        const int x_off = j * p.dilate_w - p.pad_w;
+        int x_lo, x_hi;
+        ValidColumns(x_off, p.stride_w, p.width, p.out_w, &x_lo, &x_hi);
+        DType acc = 0;
+        for (int n = 0; n < p.num; ++n) {
+          const DType* image = in + (static_cast<size_t>(n) * p.channels + c) *
+              p.height * p.width;
+          const DType* og = ograd + (static_cast<size_t>(n) * num_k + k) * out_plane;
+          for (int y = 0; y < p.out_h; ++y) {
+            const int iy = y * p.stride_h + i * p.dilate_h - p.pad_h;
+            if (iy < 0 || iy >= p.height) continue;
+            const DType* row = image + static_cast<size_t>(iy) * p.width;
+            const DType* src = og + static_cast<size_t>(y) * p.out_w;
+            for (int x = x_lo; x < x_hi; ++x) acc += src[x] * row[x * p.stride_w + x_off];
+          }
+        }
+        AssignReq(wgrad + static_cast<size_t>(k) * taps + t, req_weight, acc);
+      }
+      if (need_bias) {
+        DType acc = 0;
+        for (int n = 0; n < p.num; ++n) {
+          const DType* og = ograd + (static_cast<size_t>(n) * num_k + k) * out_plane;
+          for (size_t e = 0; e < out_plane; ++e) acc += og[e];
+        }
+        AssignReq(bgrad + k, req_bias, acc);
+      }
+    }
+    return;
+  }
+  // NHWC: every iteration reduces a block of output channels over all positions
+  const int block = 16;
+  const int num_blocks = (num_k + block - 1) / block;
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int b = 0; b < num_blocks; ++b) {
+    const int k0 = b * block, k1 = std::min(num_k, k0 + block);
+    std::vector<DType> acc(static_cast<size_t>(taps + 1) * block, DType(0));
+    DType* bias_acc = acc.data() + static_cast<size_t>(taps) * block;
+    for (int n = 0; n < p.num; ++n) {
+      for (int y = 0; y < p.out_h; ++y) {
+        const DType* og_row = ograd + (static_cast<size_t>(n) * p.out_h + y) * p.out_w * num_k;
+        if (need_bias) {
+          for (int x = 0; x < p.out_w; ++x) {
+            for (int k = k0; k < k1; ++k) bias_acc[k - k0] += og_row[x * num_k + k];
+          }
+        }
+        for (int i = 0; i < p.kernel_h && need_weight; ++i) {
+          const int iy = y * p.stride_h + i * p.dilate_h - p.pad_h;
+          if (iy < 0 || iy >= p.height) continue;
+          const DType* image_row = in + (static_cast<size_t>(n) * p.height + iy) *
+              p.width * p.channels;
+          for (int j = 0; j < p.kernel_w; ++j) {
+            DType* a = acc.data() + static_cast<size_t>(i * p.kernel_w + j) * block - k0;
+            const int x_off = j * p.dilate_w - p.pad_w;
+            int x_lo, x_hi;
+            ValidColumns(x_off, p.stride_w, p.width, p.out_w, &x_lo, &x_hi);
+            for (int x = x_lo; x < x_hi; ++x) {
+              const DType* src = image_row + static_cast<size_t>(x * p.stride_w + x_off) *
+                  p.channels;
+              const DType* og = og_row + static_cast<size_t>(x) * num_k;
+              for (int k = k0; k < k1; ++k) a[k] += og[k] * src[k / mult];
+            }
+          }
+        }
+      }
+    }
+    for (int k = k0; k < k1; ++k) {
+      if (need_weight) {
+        for (int t = 0; t < taps; ++t) {
+          AssignReq(wgrad + static_cast<size_t>(k) * taps + t, req_weight,
+                    acc[static_cast<size_t>(t) * block + k - k0]);
+        }
+      }
+      if (need_bias) AssignReq(bgrad + k, req_bias, bias_acc[k - k0]);
+    }
+  }
+}
+
+/*! \brief the algorithm chosen for every shape, guarded by a mutex */
+class ConvCPUTuner {
+ public:
+  static ConvCPUTuner* Get() {
+    static ConvCPUTuner inst;
+    return &inst;
+  }
+
+  /*! \brief the chosen algorithm, or -1 if the shape is not tuned yet */
+  int Find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = algos_.find(key);
+    return it == algos_.end() ? -1 : it->second;
+  }
+
+  void Set(const std::string& key, int algo) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    algos_[key] = algo;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, int> algos_;
+};
+
+/*!
+ * \brief run the forward of a 2D convolution without bias. The first call for
+ *  a shape times every algorithm supporting it once and keeps the fastest;
+ *  every run writes the whole output, so the last one gives the result.
+ * \param gemm runs the im2col + GEMM forward
+ */
+template<typename DType, typename FGemm>
+inline void ConvolutionForward2D(mshadow::Stream<gpu>* s, const Resource& temp_space,
+                                 const TShape& kernel, const TShape& stride, const TShape& pad,
+                                 const TShape& dilate, int num_group, const TBlob& data,
+                                 const TBlob& weight, const TBlob& out, FGemm gemm) {
+  gemm();
+}
+
+template<typename DType, typename FGemm>
+inline void ConvolutionForward2D(mshadow::Stream<cpu>* s, const Resource& temp_space,
+                                 const TShape& kernel, const TShape& stride, const TShape& pad,
+                                 const TShape& dilate, int num_group, const TBlob& data,
+                                 const TBlob& weight, const TBlob& out, FGemm gemm) {
+  static const bool tune = dmlc::GetEnv("MXNET_CPU_CONV_AUTOTUNE", true);
+  const bool real = std::is_same<DType, float>::value || std::is_same<DType, double>::value;
+  if (!tune || !real) {
+    gemm();
+    return;
+  }
+  const bool winograd = kernel[0] == 3 && kernel[1] == 3 && stride[0] == 1 &&
+      stride[1] == 1 && dilate[0] == 1 && dilate[1] == 1 && num_group == 1;
+  std::vector<int> algos = {kIm2col, kDirect};
+  if (winograd) {
+    algos.push_back(kWinograd2);
+    algos.push_back(kWinograd4);
+  }
+  const int num_filter = out.shape_[1];
+  auto run = [&](int algo) {
+    if (algo == kIm2col) {
+      gemm();
+    } else if (algo == kDirect) {
+      DirectForward<DType>(data, weight, out, kernel, stride, pad, dilate, num_group);
+    } else {
+      const size_t size = algo == kWinograd2 ?
+          WinogradWorkspaceSize<2>(data.shape_, out.shape_, num_filter) :
+          WinogradWorkspaceSize<4>(data.shape_, out.shape_, num_filter);
+      mshadow::Tensor<cpu, 1, DType> workspace =
+          temp_space.get_space_typed<cpu, 1, DType>(mshadow::Shape1(size), s);
+      if (algo == kWinograd2) {
+        WinogradForward<2, DType>(s, data, weight, out, pad[0], pad[1], workspace);
+      } else {
+        WinogradForward<4, DType>(s, data, weight, out, pad[0], pad[1], workspace);
+      }
+    }
+  };
+
+  std::ostringstream os;
+  os << data.shape_ << weight.shape_ << stride << pad << dilate << num_group
+     << data.type_flag_;
+  const std::string key = os.str();
+  const int algo = ConvCPUTuner::Get()->Find(key);
+  if (algo >= 0) {
+    run(algo);
+    return;
+  }
+  int best = kIm2col;
+  double best_time = 0;
+  for (int candidate : algos) {
+    const auto start = std::chrono::steady_clock::now();
+    run(candidate);
+    const double time = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    if (candidate == algos[0] || time < best_time) {
+      best = candidate;
+      best_time = time;
+    }
+  }
+  ConvCPUTuner::Get()->Set(key, best);
+}
+
+}  // namespace conv_cpu
+}  // namespace op
+}  // namespace mxnet
+
+#endif  // MXNET_OPERATOR_NN_CONVOLUTION_CPU_INL_H_
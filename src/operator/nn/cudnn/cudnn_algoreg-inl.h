@@ -28,7 +28,9 @@
 
 #include <algorithm>
 #include <mutex>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "../../../common/cuda_utils.h"
 #include "../convolution-inl.h"
@@ -62,9 +64,37 @@ class CuDNNAlgo {
   bool is_tensor_core_algo_;
 };
 
+/*!
+ * \brief Path of the persistent autotune cache given by MXNET_CUDNN_AUTOTUNE_CACHE,
+ *  empty when the cache is disabled.
+ */
+const std::string& CuDNNAlgoCachePath();
+
+/*!
+ * \brief Description of the current gpu and of the cuDNN library in the keys of the
+ *  persistent cache, so a cache file copied to other hardware is not used there.
+ */
+std::string CuDNNAlgoCacheDevice();
+
+/*!
+ * \brief Reads the entries of the persistent cache whose key starts with prefix.
+ *  Later lines of the file override earlier ones, malformed lines are skipped.
+ */
+std::unordered_map<std::string, std::string> LoadCuDNNAlgoCache(const std::string& prefix);
+
+/*! \brief Appends an entry to the persistent cache */
+void AppendCuDNNAlgoCache(const std::string& key, const std::string& value);
+
 template<typename ParamType>
 class CuDNNAlgoReg {
  public:
+  /*!
+   * \param name name of the operator, prefix of the keys in the persistent cache
+   */
+  explicit CuDNNAlgoReg(const std::string& name) : name_(name) {
+    if (!CuDNNAlgoCachePath().empty()) disk_ = LoadCuDNNAlgoCache(name_ + "\t");
+  }
+
   bool Find(const ParamType &param,
             const std::vector<TShape> &in_shape,
             const std::vector<TShape> &out_shape,
@@ -80,6 +110,12 @@ class CuDNNAlgoReg {
                  cudnn_forward_compute_type, cudnn_backward_compute_type, sm_arch};
     std::lock_guard<std::mutex> guard(lock_);
     auto i = reg_.find(key);
+    if (i == reg_.end() && !disk_.empty()) {
+      // algorithms chosen by an earlier process on the same hardware
+      auto d = disk_.find(CacheKey(key));
+      CudnnAlgorithms algos;
+      if (d != disk_.end() && Parse(d->second, &algos)) i = reg_.emplace(key, algos).first;
+    }
     if (i != reg_.end()) {
       *fwd = i->second.fwd;
       *bwd = i->second.bwd;
@@ -122,6 +158,18 @@ class CuDNNAlgoReg {
     reg_[key].fwd = fwd;
     reg_[key].bwd = bwd;
     reg_[key].flt = flt;
+    if (!CuDNNAlgoCachePath().empty()) {
+      const std::string cache_key = CacheKey(key);
+      std::ostringstream value;
+      value << fwd.AlgoNumber() << ' ' << fwd.IsTensorCoreAlgo() << ' '
+            << bwd.AlgoNumber() << ' ' << bwd.IsTensorCoreAlgo() << ' '
+            << flt.AlgoNumber() << ' ' << flt.IsTensorCoreAlgo();
+      auto d = disk_.find(cache_key);
+      if (d == disk_.end() || d->second != value.str()) {
+        disk_[cache_key] = value.str();
+        AppendCuDNNAlgoCache(cache_key, value.str());
+      }
+    }
   }
 
   static CuDNNAlgoReg *Get();
@@ -168,8 +216,34 @@ class CuDNNAlgoReg {
     }
   };
 
+  /*! \brief key of the persistent cache, the operator, device, parameters, shapes and types */
+  std::string CacheKey(const ParamKey& key) const {
+    std::ostringstream os;
+    os << name_ << '\t' << CuDNNAlgoCacheDevice() << '\t';
+    for (const auto& kv : key.param.__DICT__()) os << kv.first << '=' << kv.second << ';';
+    os << '\t' << key.data_shape << key.weight_shape << key.out_shape << ' '
+       << key.cudnn_data_type << ' ' << key.cudnn_forward_compute_type << ' '
+       << key.cudnn_backward_compute_type << ' ' << key.sm_arch;
+    return os.str();
+  }
+
+  /*! \brief reads the algorithms of an entry of the persistent cache */
+  static bool Parse(const std::string& value, CudnnAlgorithms* algos) {
+    std::istringstream is(value);
+    int fwd, fwd_tc, bwd, bwd_tc, flt, flt_tc;
+    if (!(is >> fwd >> fwd_tc >> bwd >> bwd_tc >> flt >> flt_tc)) return false;
+    algos->fwd.Set(static_cast<cudnnConvolutionFwdAlgo_t>(fwd), fwd_tc != 0);
+    algos->bwd.Set(static_cast<cudnnConvolutionBwdDataAlgo_t>(bwd), bwd_tc != 0);
+    algos->flt.Set(static_cast<cudnnConvolutionBwdFilterAlgo_t>(flt), flt_tc != 0);
+    return true;
+  }
+
   std::mutex lock_;
   std::unordered_map<ParamKey, CudnnAlgorithms, ParamHash> reg_;
+  /*! \brief name of the operator in the persistent cache */
+  std::string name_;
+  /*! \brief entries of the persistent cache of this operator, by CacheKey */
+  std::unordered_map<std::string, std::string> disk_;
   bool is_warning_autotune_ = false;
 };
 
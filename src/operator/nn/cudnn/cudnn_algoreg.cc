@@ -27,21 +27,61 @@
 #include <mxnet/base.h>
 #include <mxnet/ndarray.h>
 
+#include <fstream>
+#include <mutex>
 #include <sstream>
+#include <string>
 #include <unordered_map>
 
 namespace mxnet {
 namespace op {
 #if MXNET_USE_CUDNN == 1
+const std::string& CuDNNAlgoCachePath() {
+  static const std::string path = dmlc::GetEnv("MXNET_CUDNN_AUTOTUNE_CACHE", std::string());
+  return path;
+}
+
+std::string CuDNNAlgoCacheDevice() {
+  int dev_id = 0;
+  CUDA_CALL(cudaGetDevice(&dev_id));
+  cudaDeviceProp prop;
+  CUDA_CALL(cudaGetDeviceProperties(&prop, dev_id));
+  std::ostringstream os;
+  os << prop.name << " cudnn " << cudnnGetVersion();
+  return os.str();
+}
+
+std::unordered_map<std::string, std::string> LoadCuDNNAlgoCache(const std::string& prefix) {
+  std::unordered_map<std::string, std::string> entries;
+  std::ifstream is(CuDNNAlgoCachePath());
+  std::string line;
+  while (std::getline(is, line)) {
+    const size_t sep = line.rfind('\t');
+    if (sep == std::string::npos || line.compare(0, prefix.size(), prefix) != 0) continue;
+    entries[line.substr(0, sep)] = line.substr(sep + 1);
+  }
+  return entries;
+}
+
+void AppendCuDNNAlgoCache(const std::string& key, const std::string& value) {
+  // convolution and deconvolution share the file
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> guard(mutex);
+  std::ofstream os(CuDNNAlgoCachePath(), std::ios::app);
+  if (!(os << key << '\t' << value << std::endl)) {
+    LOG(WARNING) << "Failed to write the cudnn autotune cache " << CuDNNAlgoCachePath();
+  }
+}
+
 template<>
 CuDNNAlgoReg<ConvolutionParam> *CuDNNAlgoReg<ConvolutionParam>::Get() {
-  static CuDNNAlgoReg<ConvolutionParam> inst;
+  static CuDNNAlgoReg<ConvolutionParam> inst("Convolution");
   return &inst;
 }
 
 template<>
 CuDNNAlgoReg<DeconvolutionParam> *CuDNNAlgoReg<DeconvolutionParam>::Get() {
-  static CuDNNAlgoReg<DeconvolutionParam> inst;
+  static CuDNNAlgoReg<DeconvolutionParam> inst("Deconvolution");
   return &inst;
 }
 #endif  // CUDNN
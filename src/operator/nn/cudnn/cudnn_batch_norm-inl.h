@@ -273,16 +273,20 @@ class CuDNNBatchNormOp {
 
  private:
   void Init(const TBlob &in_data) {
+    // shape_ is kept in the NCHW order, a channels-last input is described
+    // by the NHWC format of the descriptor
+    const int ndim = in_data.ndim();
+    const bool channel_last = ndim > 2 && param_.axis == ndim - 1;
     for (int i = 0; i < 4; ++i) {
-      if (i < in_data.ndim()) {
-        shape_[i] = in_data.shape_[i];
+      if (i < ndim) {
+        shape_[i] = in_data.shape_[!channel_last || i == 0 ? i : (i == 1 ? ndim - 1 : i - 1)];
       } else {
         shape_[i] = 1;
       }
     }
 
     CUDNN_CALL(cudnnSetTensor4dDescriptor(io_desc_,
-                                          CUDNN_TENSOR_NCHW,
+                                          channel_last ? CUDNN_TENSOR_NHWC : CUDNN_TENSOR_NCHW,
                                           dtype_,
                                           shape_[0],
                                           shape_[1],
@@ -368,12 +368,12 @@ class CuDNNConvolutionOp {
                        int dev_id) {
     using namespace mshadow;
 
-    // NDHWC not supported, NHWC not supported in true fp16
+    // NDHWC not supported, NHWC in true fp16 only since v7.2, where it runs on tensor cores
     auto layout_val = param.layout.value();
     auto true_fp16 = DataType<DType>::kFlag == kFloat16 &&
       (forward_compute_type == kFloat16 || backward_compute_type == kFloat16);
     if (layout_val == kNDHWC || layout_val == kNWC ||
-        layout_val == kNHWC && true_fp16)
+        layout_val == kNHWC && true_fp16 && CUDNN_VERSION < 7200)
       return false;
 
     // Permits graceful fallback to pseudo-fp16 on heterogenous systems
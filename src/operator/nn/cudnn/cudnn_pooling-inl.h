@@ -170,26 +170,33 @@ class CuDNNPoolingOp {
       Tensor<gpu, 4, DType> data = in_data.get<gpu, 4, DType>(s);
       Tensor<gpu, 4, DType> out = out_data.get<gpu, 4, DType>(s);
       mshadow::Shape<4> dshape = data.shape_;
+      // cudnn takes the dimensions in the NCHW order whatever the format
+      const bool channel_last = param_.IsChannelLast(4);
+      const cudnnTensorFormat_t format = channel_last ? CUDNN_TENSOR_NHWC : CUDNN_TENSOR_NCHW;
+      const int c_axis = channel_last ? 3 : 1;
+      const int h_axis = channel_last ? 1 : 2;
       CUDNN_CALL(cudnnSetTensor4dDescriptor(in_desc_,
-                                            CUDNN_TENSOR_NCHW,
+                                            format,
                                             dtype_,
                                             data.shape_[0],
-                                            data.shape_[1],
-                                            data.shape_[2],
-                                            data.shape_[3]));
+                                            data.shape_[c_axis],
+                                            data.shape_[h_axis],
+                                            data.shape_[h_axis + 1]));
       CUDNN_CALL(cudnnSetTensor4dDescriptor(out_desc_,
-                                            CUDNN_TENSOR_NCHW,
+                                            format,
                                             dtype_,
                                             out.shape_[0],
-                                            out.shape_[1],
-                                            out.shape_[2],
-                                            out.shape_[3]));
+                                            out.shape_[c_axis],
+                                            out.shape_[h_axis],
+                                            out.shape_[h_axis + 1]));
+      const int kernel_h = param_.global_pool ? dshape[h_axis] : param_.kernel[0];
+      const int kernel_w = param_.global_pool ? dshape[h_axis + 1] : param_.kernel[1];
       #if CUDNN_MAJOR >= 5
       CUDNN_CALL(cudnnSetPooling2dDescriptor(pooling_desc_,
                                              mode_,
                                              nan_prop_,
-                                             param_.global_pool ? dshape[2] : param_.kernel[0],
-                                             param_.global_pool ? dshape[3] : param_.kernel[1],
+                                             kernel_h,
+                                             kernel_w,
                                              param_.global_pool ? 0 : param_.pad[0],
                                              param_.global_pool ? 0 : param_.pad[1],
                                              param_.global_pool ? 1 : param_.stride[0],
@@ -197,8 +204,8 @@ class CuDNNPoolingOp {
       #else
       CUDNN_CALL(cudnnSetPooling2dDescriptor(pooling_desc_,
                                              mode_,
-                                             param_.global_pool ? dshape[2] : param_.kernel[0],
-                                             param_.global_pool ? dshape[3] : param_.kernel[1],
+                                             kernel_h,
+                                             kernel_w,
                                              param_.global_pool ? 0 : param_.pad[0],
                                              param_.global_ppol ? 0 : param_.pad[1],
                                              param_.global_pool ? 1 : param_.stride[0],
@@ -207,27 +214,25 @@ class CuDNNPoolingOp {
     } else {
       Tensor<gpu, 5, DType> data = in_data.get<gpu, 5, DType>(s);
       Tensor<gpu, 5, DType> out = out_data.get<gpu, 5, DType>(s);
-      std::vector<int> ishape = {static_cast<int>(data.shape_[0]),
-                                 static_cast<int>(data.shape_[1]),
-                                 static_cast<int>(data.shape_[2]),
-                                 static_cast<int>(data.shape_[3]),
-                                 static_cast<int>(data.shape_[4])};
-
-      std::vector<int> istride = {static_cast<int>(ishape[1] * ishape[2] * ishape[3] * ishape[4]),
-                                  static_cast<int>(ishape[2] * ishape[3] * ishape[4]),
-                                  static_cast<int>(ishape[3] * ishape[4]),
-                                  static_cast<int>(ishape[4]), 1};
-
-      std::vector<int> oshape = {static_cast<int>(out.shape_[0]),
-                                 static_cast<int>(out.shape_[1]),
-                                 static_cast<int>(out.shape_[2]),
-                                 static_cast<int>(out.shape_[3]),
-                                 static_cast<int>(out.shape_[4])};
-
-      std::vector<int> ostride = {static_cast<int>(oshape[1] * oshape[2] * oshape[3] * oshape[4]),
-                                  static_cast<int>(oshape[2] * oshape[3] * oshape[4]),
-                                  static_cast<int>(oshape[3] * oshape[4]),
-                                  static_cast<int>(oshape[4]), 1};
+      // the dimensions are given in the NCDHW order, with the strides of the
+      // layout the data is actually stored in
+      const bool channel_last = param_.IsChannelLast(5);
+      auto nd_desc = [channel_last](const mshadow::Shape<5> &shape, std::vector<int> *dims,
+                                    std::vector<int> *strides) {
+        std::vector<int> pstride(5, 1);
+        for (int i = 3; i >= 0; --i) pstride[i] = pstride[i + 1] * static_cast<int>(shape[i + 1]);
+        const int order[5] = {0, channel_last ? 4 : 1, channel_last ? 1 : 2,
+                              channel_last ? 2 : 3, channel_last ? 3 : 4};
+        dims->resize(5);
+        strides->resize(5);
+        for (int i = 0; i < 5; ++i) {
+          (*dims)[i] = static_cast<int>(shape[order[i]]);
+          (*strides)[i] = pstride[order[i]];
+        }
+      };
+      std::vector<int> ishape, istride, oshape, ostride;
+      nd_desc(data.shape_, &ishape, &istride);
+      nd_desc(out.shape_, &oshape, &ostride);
 
       std::vector<int> kernel_vec = {param_.global_pool ? ishape[2] :
                                                           static_cast<int>(param_.kernel[0]),
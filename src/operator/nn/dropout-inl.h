@@ -39,13 +39,6 @@
 #include "../random/sampler.h"
 #include "../tensor/elemwise_binary_broadcast_op.h"
 
-#if defined(USE_MKL) && defined(_OPENMP)
-#include <omp.h>
-
-#include <mkl_vml_functions.h>
-#include <mkl_vsl.h>
-#endif  // USE_MKL && _OPENMP
-
 namespace dropout {
 enum DropoutOpInputs {kData};
 enum DropoutOpOutputs {kOut, kMask};
@@ -58,6 +51,14 @@ namespace op {
 
 const int MAX_DIM = 5;
 
+/*! \brief number of items whose dropout mask bits are packed in one byte */
+const int kDropoutMaskBits = 8;
+
+/*! \brief number of bytes of the bitmap mask of standard dropout over size items */
+inline index_t DropoutMaskSize(const index_t size) {
+  return (size + kDropoutMaskBits - 1) / kDropoutMaskBits;
+}
+
 struct DropoutParam : public dmlc::Parameter<DropoutParam> {
   float p;
   int mode;
@@ -78,150 +79,64 @@ struct DropoutParam : public dmlc::Parameter<DropoutParam> {
 
 template<typename xpu, typename DType>
 class DropoutOp {
-#if defined(USE_MKL) && defined(_OPENMP)
-  static void BernoulliGenerate(common::random::RandGenerator<cpu, DType> gen,
-                                int n, double p, int* r) {
-    typename RandGenerator<xpu, DType>::Impl genImpl(&gen, 1);
-    const int seed = 17 + genImpl.rand() % 4096;  // NOLINT(runtime/threadsafe_fn)
-    const int nthr = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
-#pragma omp parallel num_threads(nthr)
-    {
-      const int ithr = omp_get_thread_num();
-      const int avg_amount = (n + nthr - 1) / nthr;
-      const int my_offset = ithr * avg_amount;
-      const int my_amount = std::min(my_offset + avg_amount, n) - my_offset;
-      if (my_amount > 0) {
-        VSLStreamStatePtr stream;
-        vslNewStream(&stream, VSL_BRNG_MCG31, seed + my_offset);
-        vslSkipAheadStream(stream, my_offset);
-        viRngBernoulli(VSL_RNG_METHOD_BERNOULLI_ICDF, stream, my_amount, r + my_offset, p);
-        vslDeleteStream(&stream);
-      }
-    }
-  }
-
-  // MKL forward pass
-  static bool MSHADOW_CINLINE MKLForward(mshadow::Stream<cpu> *s, RandGenerator<cpu, DType> *pgen,
-                                         const double pkeep,
-                                         const std::vector<TBlob> &in_data,
-                                         const std::vector<TBlob> &out_data) {
-    // BernoulliGenerate expects an array int, so for types smaller than int, the mask buffer
-    // will be too small, so we can;t use MKL in those cases
-    if (sizeof(DType) >= sizeof(int)) {
-      Tensor<xpu, 2, DType> mask = out_data[dropout::kMask].FlatTo2D<xpu, DType>(s);
-      Tensor<xpu, 2, DType> data = in_data[dropout::kData].FlatTo2D<xpu, DType>(s);
-      Tensor<xpu, 2, DType> out = out_data[dropout::kOut].FlatTo2D<xpu, DType>(s);
-      DType *outptr = out.dptr_;
-      DType *dataptr = data.dptr_;
-      auto maskptr = reinterpret_cast<int *>(mask.dptr_);
-      int count = mask.shape_[0] * mask.shape_[1];
-      BernoulliGenerate(*pgen, count, pkeep, maskptr);
-      const float pk_1 = 1.0f / pkeep;
-#pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
-      for (int i = 0; i < count; ++i) {
-        outptr[i] = dataptr[i] * maskptr[i] * pk_1;
-      }
-      return true;
-    }
-    return false;
-  }
-
-  // MKL backward pass
-  static bool MSHADOW_CINLINE MKLBackward(mshadow::Stream<cpu> *s, const double pkeep,
-                                          const std::vector<TBlob> &in_grad,
-                                          const std::vector<TBlob> &out_data,
-                                          const std::vector<TBlob> &out_grad) {
-    if (sizeof(DType) >= sizeof(int)) {
-      Tensor<xpu, 2, DType> grad = out_grad[dropout::kOut].FlatTo2D<xpu, DType>(s);
-      Tensor<xpu, 2, DType> mask = out_data[dropout::kMask].FlatTo2D<xpu, DType>(s);
-      Tensor<xpu, 2, DType> gdata = in_grad[dropout::kData].FlatTo2D<xpu, DType>(s);
-      DType *ingradptr = gdata.dptr_;
-      const DType *outgradptr = grad.dptr_;
-      auto maskptr = reinterpret_cast<int *>(mask.dptr_);
-      int count = mask.shape_[0] * mask.shape_[1];
-      const float pk_1 = 1.0f / pkeep;
-#pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
-      for (int i = 0; i < count; ++i) {
-        ingradptr[i] = outgradptr[i] * maskptr[i] * pk_1;
-      }
-      return true;
-    }
-    return false;
-  }
-
-#ifdef __CUDACC__
-  // GPU never uses MKL
-  static bool MSHADOW_CINLINE MKLForward(mshadow::Stream<gpu> *s, RandGenerator<gpu, DType> *pgen,
-                                         const double pkeep,
-                                         const std::vector<TBlob> &in_data,
-                                         const std::vector<TBlob> &out_data) {
-    return false;
-  }
-  static bool MSHADOW_CINLINE MKLBackward(mshadow::Stream<gpu> *s, const double pkeep,
-                                          const std::vector<TBlob> &in_grad,
-                                          const std::vector<TBlob> &out_data,
-                                          const std::vector<TBlob> &out_grad) {
-    return false;
-  }
-#endif  // __CUDACC__
-
-#else  // #if defined(USE_MKL) && defined(_OPENMP)
-  static bool MSHADOW_CINLINE MKLForward(mshadow::Stream<xpu> *s, RandGenerator<xpu, DType> *pgen,
-                                const double pkeep,
-                                const std::vector<TBlob> &in_data,
-                                const std::vector<TBlob> &out_data) {
-    return false;
-  }
-  static bool MSHADOW_CINLINE MKLBackward(mshadow::Stream<xpu> *s, const double pkeep,
-                                          const std::vector<TBlob> &in_grad,
-                                          const std::vector<TBlob> &out_data,
-                                          const std::vector<TBlob> &out_grad) {
-    return false;
-  }
-#endif  // #if defined(USE_MKL) && defined(_OPENMP)
-
  public:
   /*!
-   * \brief Dropout kernel, compute dropout tensor
+   * \brief Dropout kernel, compute dropout tensor and the bitmap of the kept items
    */
   struct DropoutKernel {
     /*!
      * \brief Dropout kernel function
-     * \param id Thread number (0-based representing count)
-     * \param gen Random number generator
+     * \param id Thread number, each thread computes the kDropoutMaskBits items of one mask byte
+     * \param key Key of the counter based random generator of this launch
      * \param N Total number of items in the output
-     * \param step Step between items, related to parallelism
      * \param dropout_out Output dropout values
-     * \param mask_out  Output mask (is multiplied to create dropout output, may be 0)
+     * \param mask_out Output bitmap, bit k of byte j is set when item j * 8 + k is kept
      * \param input_data Input data to perform the dropout on
      * \param pkeep Dropout rate (keep when the generated random number is less than this value)
      */
     MSHADOW_XINLINE static void Map(int id,
-                                    RandGenerator<xpu, DType> gen,
-                                    const int N,
-                                    const int step,
+                                    const PhiloxKey key,
+                                    const index_t N,
                                     DType *dropout_out,
-                                    DType *mask_out,
+                                    uint8_t *mask_out,
                                     const DType *input_data,
                                     const real_t pkeep) {
-      RNG_KERNEL_LOOP(xpu, DType, id, gen, N, step, {
-        const real_t rand_num = static_cast<real_t>(genImpl.uniform());
-        mask_out[i] = mshadow_op::threshold::Map<real_t>(rand_num, pkeep) * (1.0f / pkeep);
-        dropout_out[i] = input_data[i] * mask_out[i];
-      });
+      PhiloxGenerator gen(key, id);
+      float rand_num[kDropoutMaskBits];
+      gen.Uniform(rand_num);
+      gen.Uniform(rand_num + 4);
+      const index_t start = static_cast<index_t>(id) * kDropoutMaskBits;
+      uint8_t bits = 0;
+      for (int k = 0; k < kDropoutMaskBits && start + k < N; ++k) {
+        const bool keep = rand_num[k] < pkeep;
+        const index_t i = start + k;
+        dropout_out[i] = input_data[i] * DType(keep * (1.0f / pkeep));
+        bits |= static_cast<uint8_t>(keep) << k;
+      }
+      mask_out[id] = bits;
+    }
+  };
+  /*! \brief Dropout backward kernel, scales the kept items of the output gradient */
+  struct DropoutBackwardKernel {
+    MSHADOW_XINLINE static void Map(int i, DType *in_grad, const OpReqType req,
+                                    const DType *out_grad, const uint8_t *mask,
+                                    const real_t pkeep) {
+      const bool keep = (mask[i / kDropoutMaskBits] >> (i % kDropoutMaskBits)) & 1;
+      KERNEL_ASSIGN(in_grad[i], req, out_grad[i] * DType(keep * (1.0f / pkeep)));
     }
   };
   struct BernoulliKernel {
-    /*! \brief Bernoulli kernel for generating mask */
+    /*! \brief Bernoulli kernel for generating the mask of variational dropout */
     MSHADOW_XINLINE static void Map(int id,
-                                    RandGenerator<xpu, DType> gen,
-                                    const int N,
-                                    const int step,
+                                    const PhiloxKey key,
+                                    const index_t N,
                                     DType *mask_out,
                                     const real_t pkeep) {
-      RNG_KERNEL_LOOP(xpu, DType, id, gen, N, step, {
-        const real_t rand_num = static_cast<real_t>(genImpl.uniform());
-        mask_out[i] = mshadow_op::threshold::Map<real_t>(rand_num, pkeep) * (1.0f / pkeep);
+      PhiloxGenerator gen(key, id);
+      float rand_num[4];
+      gen.Uniform(rand_num);
+      PHILOX_KERNEL_LOOP(id, N, {
+        mask_out[i] = mshadow_op::threshold::Map<real_t>(rand_num[k], pkeep) * (1.0f / pkeep);
       });
     }
   };
@@ -246,46 +161,46 @@ class DropoutOp {
       if (ctx.is_train || this->mode_ == dropout::kAlways) {
         RandGenerator<xpu, DType> *pgen = ctx.requested[0].get_parallel_random<xpu, DType>();
         CHECK_NOTNULL(pgen);
-        if (this->axes_.ndim() != 0 || !MKLForward(s, pgen, this->pkeep_, in_data, out_data)) {
-          const TBlob &mask = out_data[dropout::kMask];
-          CHECK(req[dropout::kOut] != kAddTo);
-          if (this->axes_.ndim() == 0) {
-            // standard case for dropout
-            LaunchRNG<DropoutKernel, xpu>(s, pgen, out.Size(),
-                                        out.dptr<DType>(),
-                                        mask.dptr<DType>(),
-                                        in_data[dropout::kData].dptr<DType>(),
-                                        this->pkeep_);
-            return;
-          }
-          // initialize the mask
-          LaunchRNG<BernoulliKernel, xpu>(s, pgen, mask.Size(),
-                                          mask.dptr<DType>(),
-                                          this->pkeep_);
-          // broadcast mul
-          TShape new_lshape, new_rshape, new_oshape;
-          int ndim = BinaryBroadcastShapeCompact(in_data[dropout::kData].shape_,
-                                                 mask.shape_, out.shape_,
-                                                 &new_lshape, &new_rshape, &new_oshape);
-          if (!ndim) {
-            MXNET_ASSIGN_REQ_SWITCH(req[dropout::kOut], Req, {
-              mxnet_op::Kernel<mxnet_op::op_with_req<mshadow_op::mul, Req>, xpu>::Launch(
-                s, out.Size(), out.dptr<DType>(), in_data[dropout::kData].dptr<DType>(),
-                mask.dptr<DType>());
-            });
-          } else {
-            BROADCAST_NDIM_SWITCH(ndim, NDim, {
-              mshadow::Shape<NDim> oshape = new_oshape.get<NDim>();
-              mshadow::Shape<NDim> lstride = mxnet_op::calc_stride(new_lshape.get<NDim>());
-              mshadow::Shape<NDim> rstride = mxnet_op::calc_stride(new_rshape.get<NDim>());
-              mxnet_op::Kernel<mxnet_op::binary_broadcast_kernel<NDim, DType,
-                               mshadow_op::mul>, xpu>::
-              template LaunchEx(s, new_oshape.Size(), req[dropout::kOut],
-              lstride, rstride, oshape,
-              in_data[dropout::kData].dptr<DType>(),
-              mask.dptr<DType>(), out.dptr<DType>());
-            });
-          }
+        const TBlob &mask = out_data[dropout::kMask];
+        CHECK(req[dropout::kOut] != kAddTo);
+        if (this->axes_.ndim() == 0) {
+          // standard case for dropout, the mask is generated and applied in one pass
+          CHECK_EQ(mask.Size(), DropoutMaskSize(out.Size()));
+          if (out.Size() == 0) return;
+          mxnet_op::Kernel<DropoutKernel, xpu>::Launch(s, mask.Size(), pgen->NextPhiloxKey(),
+                                                       out.Size(), out.dptr<DType>(),
+                                                       mask.dptr<uint8_t>(),
+                                                       in_data[dropout::kData].dptr<DType>(),
+                                                       this->pkeep_);
+          return;
+        }
+        // initialize the mask
+        LaunchPhilox<BernoulliKernel, xpu>(s, pgen, mask.Size(),
+                                           mask.dptr<DType>(),
+                                           this->pkeep_);
+        // broadcast mul
+        TShape new_lshape, new_rshape, new_oshape;
+        int ndim = BinaryBroadcastShapeCompact(in_data[dropout::kData].shape_,
+                                               mask.shape_, out.shape_,
+                                               &new_lshape, &new_rshape, &new_oshape);
+        if (!ndim) {
+          MXNET_ASSIGN_REQ_SWITCH(req[dropout::kOut], Req, {
+            mxnet_op::Kernel<mxnet_op::op_with_req<mshadow_op::mul, Req>, xpu>::Launch(
+              s, out.Size(), out.dptr<DType>(), in_data[dropout::kData].dptr<DType>(),
+              mask.dptr<DType>());
+          });
+        } else {
+          BROADCAST_NDIM_SWITCH(ndim, NDim, {
+            mshadow::Shape<NDim> oshape = new_oshape.get<NDim>();
+            mshadow::Shape<NDim> lstride = mxnet_op::calc_stride(new_lshape.get<NDim>());
+            mshadow::Shape<NDim> rstride = mxnet_op::calc_stride(new_rshape.get<NDim>());
+            mxnet_op::Kernel<mxnet_op::binary_broadcast_kernel<NDim, DType,
+                             mshadow_op::mul>, xpu>::
+            template LaunchEx(s, new_oshape.Size(), req[dropout::kOut],
+            lstride, rstride, oshape,
+            in_data[dropout::kData].dptr<DType>(),
+            mask.dptr<DType>(), out.dptr<DType>());
+          });
         }
       } else {
         const TBlob& data = in_data[dropout::kData];
@@ -310,40 +225,38 @@ class DropoutOp {
     using namespace mshadow::expr;
     Stream<xpu> *s = ctx.get_stream<xpu>();
     if (ctx.is_train || mode_ == dropout::kAlways) {
-      if (this->axes_.ndim() != 0 || !MKLBackward(s, this->pkeep_, in_grad, out_data, out_grad)) {
-        const TBlob &gdata = in_grad[dropout::kData];
-        const TBlob &grad = out_grad[dropout::kOut];
-        const TBlob &mask = out_data[dropout::kMask];
-        if (this->axes_.ndim() == 0) {
-          // standard case for dropout
-          CHECK_EQ(grad.Size(), mask.Size());
-          MXNET_ASSIGN_REQ_SWITCH(req[dropout::kData], Req, {
-            mxnet_op::Kernel<mxnet_op::op_with_req<mshadow_op::mul, Req>, xpu>::Launch(
-              s, gdata.Size(), gdata.dptr<DType>(), grad.dptr<DType>(), mask.dptr<DType>());
-          });
-          return;
-        }
-        // broardcast mul
-        TShape new_lshape, new_rshape, new_oshape;
-        int ndim = BinaryBroadcastShapeCompact(grad.shape_,
-                                               mask.shape_, gdata.shape_,
-                                               &new_lshape, &new_rshape, &new_oshape);
-        if (!ndim) {
-          MXNET_ASSIGN_REQ_SWITCH(req[dropout::kData], Req, {
-            mxnet_op::Kernel<mxnet_op::op_with_req<mshadow_op::mul, Req>, xpu>::Launch(
-              s, gdata.Size(), gdata.dptr<DType>(), grad.dptr<DType>(), mask.dptr<DType>());
-          });
-        } else {
-          BROADCAST_NDIM_SWITCH(ndim, NDim, {
-            mshadow::Shape<NDim> oshape = new_oshape.get<NDim>();
-            mshadow::Shape<NDim> lstride = mxnet_op::calc_stride(new_lshape.get<NDim>());
-            mshadow::Shape<NDim> rstride = mxnet_op::calc_stride(new_rshape.get<NDim>());
-            mxnet_op::Kernel<mxnet_op::binary_broadcast_kernel<NDim, DType,
-                             mshadow_op::mul>, xpu>::
-            template LaunchEx(s, new_oshape.Size(), req[0], lstride, rstride, oshape,
-            grad.dptr<DType>(), mask.dptr<DType>(), gdata.dptr<DType>());
-          });
-        }
+      const TBlob &gdata = in_grad[dropout::kData];
+      const TBlob &grad = out_grad[dropout::kOut];
+      const TBlob &mask = out_data[dropout::kMask];
+      if (this->axes_.ndim() == 0) {
+        // standard case for dropout
+        CHECK_EQ(DropoutMaskSize(grad.Size()), mask.Size());
+        if (req[dropout::kData] == kNullOp) return;
+        mxnet_op::Kernel<DropoutBackwardKernel, xpu>::Launch(
+          s, gdata.Size(), gdata.dptr<DType>(), req[dropout::kData], grad.dptr<DType>(),
+          mask.dptr<uint8_t>(), this->pkeep_);
+        return;
+      }
+      // broardcast mul
+      TShape new_lshape, new_rshape, new_oshape;
+      int ndim = BinaryBroadcastShapeCompact(grad.shape_,
+                                             mask.shape_, gdata.shape_,
+                                             &new_lshape, &new_rshape, &new_oshape);
+      if (!ndim) {
+        MXNET_ASSIGN_REQ_SWITCH(req[dropout::kData], Req, {
+          mxnet_op::Kernel<mxnet_op::op_with_req<mshadow_op::mul, Req>, xpu>::Launch(
+            s, gdata.Size(), gdata.dptr<DType>(), grad.dptr<DType>(), mask.dptr<DType>());
+        });
+      } else {
+        BROADCAST_NDIM_SWITCH(ndim, NDim, {
+          mshadow::Shape<NDim> oshape = new_oshape.get<NDim>();
+          mshadow::Shape<NDim> lstride = mxnet_op::calc_stride(new_lshape.get<NDim>());
+          mshadow::Shape<NDim> rstride = mxnet_op::calc_stride(new_rshape.get<NDim>());
+          mxnet_op::Kernel<mxnet_op::binary_broadcast_kernel<NDim, DType,
+                           mshadow_op::mul>, xpu>::
+          template LaunchEx(s, new_oshape.Size(), req[0], lstride, rstride, oshape,
+          grad.dptr<DType>(), mask.dptr<DType>(), gdata.dptr<DType>());
+        });
       }
     } else {
       const TBlob& gdata = in_grad[dropout::kData];
@@ -98,6 +98,11 @@ Example::
   if (dshape.ndim() == 0) return false;
   out_shape->clear();
   out_shape->push_back(dshape);
+  if (param.axes.ndim() == 0) {
+    // the mask of standard dropout is a bitmap of the kept items
+    out_shape->push_back(mshadow::Shape1(DropoutMaskSize(dshape.Size())));
+    return true;
+  }
   for (index_t i = 0; i < param.axes.ndim(); ++i) {
     dshape[param.axes[i]] = 1;
   }
@@ -114,9 +119,10 @@ Example::
     return false;
   }
 
-  size_t nout = 2;
+  const DropoutParam& param = nnvm::get<DropoutParam>(attrs.parsed);
   out_type->clear();
-  for (size_t i = 0; i < nout; ++i) out_type->push_back(dtype);
+  out_type->push_back(dtype);
+  out_type->push_back(param.axes.ndim() == 0 ? mshadow::kUint8 : dtype);
   return true;
 })
 .set_attr<FCompute>("FCompute<cpu>", DropoutCompute<cpu>)
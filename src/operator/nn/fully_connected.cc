@@ -22,9 +22,13 @@
  * \file fully_connected.cc
  * \brief fully connect operator
 */
+#include <list>
+#include <memory>
+#include <mutex>
 #include "./fully_connected-inl.h"
 #include "./mkldnn/mkldnn_ops-inl.h"
 #include "./mkldnn/mkldnn_base-inl.h"
+#include "../../engine/openmp.h"
 #if MXNET_USE_NNPACK == 1
 #include "./nnpack/nnpack_fully_connected-inl.h"
 #endif  // MXNET_USE_NNPACK
@@ -32,6 +36,100 @@
 namespace mxnet {
 namespace op {
 
+#if MSHADOW_USE_MKL == 1 && MXNET_USE_MKLDNN != 1
+/*!
+ * \brief float32 weights packed by mkl for a fixed batch size. The lru cache holds
+ *  at most MXNET_FC_PACKED_WEIGHT_CACHE_SIZE of them, each keeps its weight alive
+ *  so the engine variable it is looked up by is not reused by another array.
+ */
+class FCPackedWeight {
+ public:
+  FCPackedWeight(const NDArray& weight, const int m)
+    : weight_(weight), m_(m), version_(weight.version()) {
+    const int n = weight.shape()[0], k = weight.shape()[1];
+    packed_ = cblas_sgemm_alloc(CblasBMatrix, m, n, k);
+    CHECK(packed_ != nullptr) << "Failed to allocate packed FullyConnected weights";
+    cblas_sgemm_pack(CblasRowMajor, CblasBMatrix, CblasTrans, m, n, k, 1.0f,
+                     weight.data().dptr<float>(), k, packed_);
+  }
+
+  ~FCPackedWeight() {
+    cblas_sgemm_free(packed_);
+  }
+
+  /*! \brief the packed weights of weight for batch size m, packed again after writes */
+  static std::shared_ptr<FCPackedWeight> Get(const NDArray& weight, const int m) {
+    static std::mutex mutex;
+    static std::list<std::shared_ptr<FCPackedWeight> > lru;
+    static const size_t capacity =
+      std::max(1, dmlc::GetEnv("MXNET_FC_PACKED_WEIGHT_CACHE_SIZE", 64));
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = lru.begin(); it != lru.end(); ++it) {
+      if ((*it)->weight_.var() != weight.var() || (*it)->m_ != m) continue;
+      if ((*it)->version_ != weight.version()) {
+        lru.erase(it);
+        break;
+      }
+      lru.splice(lru.begin(), lru, it);
+      return lru.front();
+    }
+    lru.emplace_front(std::make_shared<FCPackedWeight>(weight, m));
+    if (lru.size() > capacity) lru.pop_back();
+    return lru.front();
+  }
+
+  const float* packed() const {
+    return packed_;
+  }
+
+ private:
+  const NDArray weight_;
+  /*! \brief rows of the data the weights are packed for */
+  const int m_;
+  /*! \brief version of weight_ when packed */
+  const size_t version_;
+  float* packed_;
+  DISALLOW_COPY_AND_ASSIGN(FCPackedWeight);
+};
+
+/*!
+ * \brief inference forward on weights packed once instead of by every gemm call,
+ *  returns false when the inputs are not dense float32 arrays
+ */
+static bool FCForwardPacked(const FullyConnectedParam& param, const OpContext& ctx,
+                            const std::vector<NDArray>& inputs,
+                            const std::vector<OpReqType>& req,
+                            const std::vector<NDArray>& outputs) {
+  static const bool enabled = dmlc::GetEnv("MXNET_FC_PACKED_WEIGHTS", true);
+  if (!enabled || ctx.is_train || req[fullc::kOut] != kWriteTo) return false;
+  for (const NDArray& arr : inputs) {
+    if (arr.storage_type() != kDefaultStorage || arr.dtype() != mshadow::kFloat32) return false;
+  }
+  const TShape& ishape = inputs[fullc::kData].shape();
+  const TShape& wshape = inputs[fullc::kWeight].shape();
+  const int m = param.flatten ? ishape[0] : ishape.ProdShape(0, ishape.ndim() - 1);
+  const int n = wshape[0], k = wshape[1];
+  if (m == 0) return false;
+  CHECK_EQ(static_cast<size_t>(m) * k, ishape.Size())
+    << "Incomplete weight tensor detected: weight.data().shape[1] != prod(data.data().shape[1:])."
+       " This is not supported by FCForward.";
+  std::shared_ptr<FCPackedWeight> packed = FCPackedWeight::Get(inputs[fullc::kWeight], m);
+  float* out = outputs[fullc::kOut].data().dptr<float>();
+  cblas_sgemm_compute(CblasRowMajor, CblasNoTrans, CblasPacked, m, n, k,
+                      inputs[fullc::kData].data().dptr<float>(), k, packed->packed(), k,
+                      0.0f, out, n);
+  if (!param.no_bias) {
+    const float* bias = inputs[fullc::kBias].data().dptr<float>();
+    const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int i = 0; i < m; ++i) {
+      for (int j = 0; j < n; ++j) out[static_cast<size_t>(i) * n + j] += bias[j];
+    }
+  }
+  return true;
+}
+#endif  // MSHADOW_USE_MKL == 1 && MXNET_USE_MKLDNN != 1
+
 static bool FullyConnectedShape(const nnvm::NodeAttrs& attrs,
                                 std::vector<TShape> *in_shape,
                                 std::vector<TShape> *out_shape) {
@@ -124,6 +222,9 @@ void FullyConnectedComputeExCPU(const nnvm::NodeAttrs& attrs,
     LogUnimplementedOp(attrs, ctx, inputs, req, outputs);
   }
 #else
+#if MSHADOW_USE_MKL == 1
+  if (FCForwardPacked(param, ctx, inputs, req, outputs)) return;
+#endif  // MSHADOW_USE_MKL == 1
   if (valid_data && valid_weight && valid_bias && valid_out) {
     std::vector<TBlob> in_blobs(inputs.size());
     for (size_t i = 0; i < in_blobs.size(); i++) in_blobs[i] = inputs[i].data();
@@ -64,6 +64,154 @@ struct LayerNormParam : public dmlc::Parameter<LayerNormParam> {
 };
 
 
+/*! \brief type the statistics of a row are accumulated in */
+template<typename DType>
+struct LayerNormAccType {
+  typedef float type;
+};
+
+template<>
+struct LayerNormAccType<double> {
+  typedef double type;
+};
+
+/*! \brief independent partial sums of a row on cpu, so the sums vectorize */
+const int kLayerNormLanes = 8;
+/*! \brief columns of gamma and beta whose gradients one cpu thread accumulates */
+const int kLayerNormColBlock = 32;
+
+/*! \brief sum of f(j) for j in [0, n), in kLayerNormLanes partial sums */
+template<typename AType, typename F>
+inline AType LayerNormRowSum(const int n, F f) {
+  AType acc[kLayerNormLanes] = {0};
+  int j = 0;
+  for (; j + kLayerNormLanes <= n; j += kLayerNormLanes) {
+    for (int k = 0; k < kLayerNormLanes; ++k) acc[k] += f(j + k);
+  }
+  for (; j < n; ++j) acc[0] += f(j);
+  AType sum = 0;
+  for (int k = 0; k < kLayerNormLanes; ++k) sum += acc[k];
+  return sum;
+}
+
+/*!
+ * \brief normalize the rows of a (nrows, ncols) contiguous input, writing the
+ *  mean and std = sqrt(var + eps) of every row. The cpu version takes a row
+ *  per thread, which is in cache for its mean, variance and output passes
+ */
+template<typename DType>
+void LayerNormForwardRows(mshadow::Stream<cpu>* s, const int nrows, const int ncols,
+                          const float eps, const DType* in, const DType* gamma,
+                          const DType* beta, DType* out, DType* mean, DType* std) {
+  typedef typename LayerNormAccType<DType>::type AType;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int r = 0; r < nrows; ++r) {
+    const DType* x = in + static_cast<size_t>(r) * ncols;
+    DType* y = out + static_cast<size_t>(r) * ncols;
+    const AType mu = LayerNormRowSum<AType>(ncols, [x](int j) {
+      return static_cast<AType>(x[j]);
+    }) / ncols;
+    const AType var = LayerNormRowSum<AType>(ncols, [x, mu](int j) {
+      const AType d = static_cast<AType>(x[j]) - mu;
+      return d * d;
+    }) / ncols;
+    const AType sd = math::sqrt(var + static_cast<AType>(eps));
+    const AType inv_std = AType(1) / sd;
+    for (int j = 0; j < ncols; ++j) {
+      y[j] = DType((static_cast<AType>(x[j]) - mu) * inv_std * static_cast<AType>(gamma[j]) +
+                   static_cast<AType>(beta[j]));
+    }
+    mean[r] = DType(mu);
+    std[r] = DType(sd);
+  }
+}
+
+template<typename DType>
+void LayerNormForwardRows(mshadow::Stream<gpu>* s, const int nrows, const int ncols,
+                          const float eps, const DType* in, const DType* gamma,
+                          const DType* beta, DType* out, DType* mean, DType* std);
+
+template<typename DType>
+inline size_t LayerNormBackwardWorkspaceSize(mshadow::Stream<cpu>* s, const int nrows,
+                                             const int ncols) {
+  return 0;
+}
+
+template<typename DType>
+size_t LayerNormBackwardWorkspaceSize(mshadow::Stream<gpu>* s, const int nrows,
+                                      const int ncols);
+
+/*!
+ * \brief gradients of LayerNormForwardRows from the saved mean and std, for
+ *  every row x_hat = (x - mean) / std, g = ograd * gamma and
+ *  grad_data = (g - mean(g) - x_hat * mean(g * x_hat)) / std
+ */
+template<typename DType>
+void LayerNormBackwardRows(mshadow::Stream<cpu>* s, const int nrows, const int ncols,
+                           const DType* ograd, const DType* data, const DType* gamma,
+                           const DType* mean, const DType* std,
+                           DType* grad_data, DType* grad_gamma, DType* grad_beta,
+                           const std::vector<OpReqType>& req, char* workspace) {
+  typedef typename LayerNormAccType<DType>::type AType;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  if (req[0] != kNullOp) {
+    #pragma omp parallel for num_threads(omp_threads)
+    for (int r = 0; r < nrows; ++r) {
+      const DType* x = data + static_cast<size_t>(r) * ncols;
+      const DType* og = ograd + static_cast<size_t>(r) * ncols;
+      DType* gx = grad_data + static_cast<size_t>(r) * ncols;
+      const AType mu = mean[r];
+      const AType inv_std = AType(1) / static_cast<AType>(std[r]);
+      const AType mean_g = LayerNormRowSum<AType>(ncols, [og, gamma](int j) {
+        return static_cast<AType>(og[j]) * static_cast<AType>(gamma[j]);
+      }) / ncols;
+      const AType mean_gx = LayerNormRowSum<AType>(ncols, [=](int j) {
+        return static_cast<AType>(og[j]) * static_cast<AType>(gamma[j]) *
+               (static_cast<AType>(x[j]) - mu) * inv_std;
+      }) / ncols;
+      for (int j = 0; j < ncols; ++j) {
+        const AType x_hat = (static_cast<AType>(x[j]) - mu) * inv_std;
+        const AType g = static_cast<AType>(og[j]) * static_cast<AType>(gamma[j]);
+        KERNEL_ASSIGN(gx[j], req[0], DType((g - mean_g - x_hat * mean_gx) * inv_std));
+      }
+    }
+  }
+  if (req[1] == kNullOp && req[2] == kNullOp) return;
+  // a thread owns a block of columns and walks all rows, so the sums need no merge
+  const int num_blocks = (ncols + kLayerNormColBlock - 1) / kLayerNormColBlock;
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int b = 0; b < num_blocks; ++b) {
+    const int c0 = b * kLayerNormColBlock;
+    const int width = std::min(kLayerNormColBlock, ncols - c0);
+    AType sum_gamma[kLayerNormColBlock] = {0};
+    AType sum_beta[kLayerNormColBlock] = {0};
+    for (int r = 0; r < nrows; ++r) {
+      const DType* x = data + static_cast<size_t>(r) * ncols + c0;
+      const DType* og = ograd + static_cast<size_t>(r) * ncols + c0;
+      const AType mu = mean[r];
+      const AType inv_std = AType(1) / static_cast<AType>(std[r]);
+      for (int j = 0; j < width; ++j) {
+        const AType o = og[j];
+        sum_gamma[j] += o * (static_cast<AType>(x[j]) - mu) * inv_std;
+        sum_beta[j] += o;
+      }
+    }
+    for (int j = 0; j < width; ++j) {
+      if (req[1] != kNullOp) KERNEL_ASSIGN(grad_gamma[c0 + j], req[1], DType(sum_gamma[j]));
+      if (req[2] != kNullOp) KERNEL_ASSIGN(grad_beta[c0 + j], req[2], DType(sum_beta[j]));
+    }
+  }
+}
+
+template<typename DType>
+void LayerNormBackwardRows(mshadow::Stream<gpu>* s, const int nrows, const int ncols,
+                           const DType* ograd, const DType* data, const DType* gamma,
+                           const DType* mean, const DType* std,
+                           DType* grad_data, DType* grad_gamma, DType* grad_beta,
+                           const std::vector<OpReqType>& req, char* workspace);
+
+
 template<typename xpu>
 void LayerNormCompute(const nnvm::NodeAttrs& attrs,
                       const OpContext& ctx, const std::vector<TBlob>& inputs,
@@ -81,6 +229,20 @@ void LayerNormCompute(const nnvm::NodeAttrs& attrs,
   CHECK(axis >= 0 && axis < inputs[0].ndim()) << "Channel axis out of range: " << param.axis;
   CHECK_EQ(inputs.size(), 3U);
   Stream<xpu> *s = ctx.get_stream<xpu>();
+  if (axis == static_cast<int>(inputs[0].ndim()) - 1) {
+    // normalizing contiguous rows, the common case, takes one fused pass
+    const int ncols = inputs[0].shape_[axis];
+    const int nrows = inputs[0].Size() / ncols;
+    MSHADOW_REAL_TYPE_SWITCH(outputs[0].type_flag_, DType, {
+      LayerNormForwardRows(s, nrows, ncols, param.eps, inputs[layernorm::kData].dptr<DType>(),
+                           inputs[layernorm::kGamma].dptr<DType>(),
+                           inputs[layernorm::kBeta].dptr<DType>(),
+                           outputs[layernorm::kOut].dptr<DType>(),
+                           outputs[layernorm::kMean].dptr<DType>(),
+                           outputs[layernorm::kStd].dptr<DType>());
+    });
+    return;
+  }
   // Reshape gamma and beta to be broadcastable
   TShape new_param_shape(inputs[0].shape_.begin(), inputs[0].shape_.end());
   for (int i = 0; i < inputs[0].ndim(); i++) {
@@ -171,6 +333,23 @@ void LayerNormGradCompute(const nnvm::NodeAttrs& attrs,
   }
   CHECK(axis >= 0 && axis < inputs[0].ndim()) << "Channel axis out of range: " << param.axis;
   Stream<xpu> *s = ctx.get_stream<xpu>();
+  if (axis == static_cast<int>(inputs[0].ndim()) - 1) {
+    const int ncols = inputs[0].shape_[axis];
+    const int nrows = inputs[0].Size() / ncols;
+    MSHADOW_REAL_TYPE_SWITCH(outputs[0].type_flag_, DType, {
+      const size_t workspace_size = LayerNormBackwardWorkspaceSize<DType>(s, nrows, ncols);
+      char* workspace = nullptr;
+      if (workspace_size > 0) {
+        workspace = ctx.requested[0].get_space_typed<xpu, 1, char>(
+          Shape1(workspace_size), s).dptr_;
+      }
+      LayerNormBackwardRows(s, nrows, ncols, inputs[0].dptr<DType>(), inputs[1].dptr<DType>(),
+                            inputs[2].dptr<DType>(), inputs[3].dptr<DType>(),
+                            inputs[4].dptr<DType>(), outputs[0].dptr<DType>(),
+                            outputs[1].dptr<DType>(), outputs[2].dptr<DType>(), req, workspace);
+    });
+    return;
+  }
   // Reshape gamma to be broadcastable
   TShape new_param_shape(inputs[0].shape_.begin(), inputs[0].shape_.end());
   for (int i = 0; i < inputs[0].ndim(); i++) {
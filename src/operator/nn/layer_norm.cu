@@ -22,11 +22,229 @@
  * \file layer_norm.cu
  * \brief Implements Ba et. al, Layer Normalization (https://arxiv.org/abs/1607.06450).
 */
+#include <algorithm>
 #include "./layer_norm-inl.h"
 
 namespace mxnet {
 namespace op {
 
+/*! \brief rows of a column tile in the partial gamma and beta gradients */
+const int kLayerNormTileRows = 8;
+/*! \brief cap on the row slices gamma and beta gradients are split in */
+const int kLayerNormMaxParts = 128;
+
+/*! \brief a power of two number of threads for a row, at most kBaseThreadNum */
+inline int LayerNormRowThreads(const int ncols) {
+  int threads = mshadow::cuda::kWarpSize;
+  while (threads < ncols && threads < mshadow::cuda::kBaseThreadNum) threads <<= 1;
+  return threads;
+}
+
+inline int LayerNormGradParts(const int nrows) {
+  return std::max(1, std::min((nrows + 63) / 64, kLayerNormMaxParts));
+}
+
+// one block per row, every thread runs Welford over its columns, then the
+// block merges the (count, mean, M2) triples pairwise in shared memory
+template<typename DType, typename AType>
+__global__ void LayerNormFusedForwardKernel(const int nrows, const int ncols, const AType eps,
+                                            const DType* in, const DType* gamma,
+                                            const DType* beta, DType* out, DType* mean,
+                                            DType* std) {
+  __shared__ AType scount[mshadow::cuda::kBaseThreadNum];
+  __shared__ AType smean[mshadow::cuda::kBaseThreadNum];
+  __shared__ AType sm2[mshadow::cuda::kBaseThreadNum];
+  for (int r = blockIdx.x; r < nrows; r += gridDim.x) {
+    const DType* x = in + static_cast<size_t>(r) * ncols;
+    DType* y = out + static_cast<size_t>(r) * ncols;
+    AType count = 0, mu = 0, m2 = 0;
+    for (int j = threadIdx.x; j < ncols; j += blockDim.x) {
+      const AType v = x[j];
+      count += 1;
+      const AType delta = v - mu;
+      mu += delta / count;
+      m2 += delta * (v - mu);
+    }
+    scount[threadIdx.x] = count;
+    smean[threadIdx.x] = mu;
+    sm2[threadIdx.x] = m2;
+    __syncthreads();
+    for (int offset = blockDim.x / 2; offset > 0; offset >>= 1) {
+      if (threadIdx.x < offset) {
+        const AType na = scount[threadIdx.x], nb = scount[threadIdx.x + offset];
+        const AType n = na + nb;
+        if (nb > 0) {
+          const AType delta = smean[threadIdx.x + offset] - smean[threadIdx.x];
+          smean[threadIdx.x] += delta * nb / n;
+          sm2[threadIdx.x] += sm2[threadIdx.x + offset] + delta * delta * na * nb / n;
+          scount[threadIdx.x] = n;
+        }
+      }
+      __syncthreads();
+    }
+    const AType row_mean = smean[0];
+    const AType sd = math::sqrt(sm2[0] / ncols + eps);
+    const AType inv_std = AType(1) / sd;
+    for (int j = threadIdx.x; j < ncols; j += blockDim.x) {
+      y[j] = DType((static_cast<AType>(x[j]) - row_mean) * inv_std *
+                   static_cast<AType>(gamma[j]) + static_cast<AType>(beta[j]));
+    }
+    if (threadIdx.x == 0) {
+      mean[r] = DType(row_mean);
+      std[r] = DType(sd);
+    }
+    __syncthreads();
+  }
+}
+
+template<typename DType>
+void LayerNormForwardRows(mshadow::Stream<gpu>* s, const int nrows, const int ncols,
+                          const float eps, const DType* in, const DType* gamma,
+                          const DType* beta, DType* out, DType* mean, DType* std) {
+  typedef typename LayerNormAccType<DType>::type AType;
+  if (nrows == 0) return;
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+  const int blocks = std::min(nrows, mshadow::cuda::kMaxGridNum);
+  LayerNormFusedForwardKernel<<<blocks, LayerNormRowThreads(ncols), 0, stream>>>(
+    nrows, ncols, static_cast<AType>(eps), in, gamma, beta, out, mean, std);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(LayerNormFusedForwardKernel);
+}
+
+// one block per row reduces mean(g) and mean(g * x_hat), then writes the
+// gradient of the row from the values it just read
+template<int req, typename DType, typename AType>
+__global__ void LayerNormFusedDataGradKernel(const int nrows, const int ncols,
+                                             const DType* ograd, const DType* data,
+                                             const DType* gamma, const DType* mean,
+                                             const DType* std, DType* grad_data) {
+  __shared__ AType sg[mshadow::cuda::kBaseThreadNum];
+  __shared__ AType sgx[mshadow::cuda::kBaseThreadNum];
+  for (int r = blockIdx.x; r < nrows; r += gridDim.x) {
+    const DType* x = data + static_cast<size_t>(r) * ncols;
+    const DType* og = ograd + static_cast<size_t>(r) * ncols;
+    DType* gx = grad_data + static_cast<size_t>(r) * ncols;
+    const AType mu = mean[r];
+    const AType inv_std = AType(1) / static_cast<AType>(std[r]);
+    AType sum_g = 0, sum_gx = 0;
+    for (int j = threadIdx.x; j < ncols; j += blockDim.x) {
+      const AType g = static_cast<AType>(og[j]) * static_cast<AType>(gamma[j]);
+      sum_g += g;
+      sum_gx += g * (static_cast<AType>(x[j]) - mu) * inv_std;
+    }
+    sg[threadIdx.x] = sum_g;
+    sgx[threadIdx.x] = sum_gx;
+    __syncthreads();
+    for (int offset = blockDim.x / 2; offset > 0; offset >>= 1) {
+      if (threadIdx.x < offset) {
+        sg[threadIdx.x] += sg[threadIdx.x + offset];
+        sgx[threadIdx.x] += sgx[threadIdx.x + offset];
+      }
+      __syncthreads();
+    }
+    const AType mean_g = sg[0] / ncols;
+    const AType mean_gx = sgx[0] / ncols;
+    for (int j = threadIdx.x; j < ncols; j += blockDim.x) {
+      const AType x_hat = (static_cast<AType>(x[j]) - mu) * inv_std;
+      const AType g = static_cast<AType>(og[j]) * static_cast<AType>(gamma[j]);
+      KERNEL_ASSIGN(gx[j], req, DType((g - mean_g - x_hat * mean_gx) * inv_std));
+    }
+    __syncthreads();
+  }
+}
+
+// block (kWarpSize, kLayerNormTileRows) sums a tile of columns over one slice
+// of the rows, the slices are summed by LayerNormGammaBetaGradKernel
+template<typename DType, typename AType>
+__global__ void LayerNormPartGammaBetaKernel(const int nrows, const int ncols,
+                                             const DType* ograd, const DType* data,
+                                             const DType* mean, const DType* std,
+                                             AType* part_gamma, AType* part_beta) {
+  __shared__ AType sgamma[kLayerNormTileRows][mshadow::cuda::kWarpSize + 1];
+  __shared__ AType sbeta[kLayerNormTileRows][mshadow::cuda::kWarpSize + 1];
+  const int c = blockIdx.x * mshadow::cuda::kWarpSize + threadIdx.x;
+  AType sum_gamma = 0, sum_beta = 0;
+  if (c < ncols) {
+    for (int r = blockIdx.y * kLayerNormTileRows + threadIdx.y; r < nrows;
+         r += gridDim.y * kLayerNormTileRows) {
+      const size_t k = static_cast<size_t>(r) * ncols + c;
+      const AType o = ograd[k];
+      sum_gamma += o * (static_cast<AType>(data[k]) - static_cast<AType>(mean[r])) /
+                   static_cast<AType>(std[r]);
+      sum_beta += o;
+    }
+  }
+  sgamma[threadIdx.y][threadIdx.x] = sum_gamma;
+  sbeta[threadIdx.y][threadIdx.x] = sum_beta;
+  __syncthreads();
+  if (threadIdx.y == 0 && c < ncols) {
+    for (int t = 1; t < kLayerNormTileRows; ++t) {
+      sum_gamma += sgamma[t][threadIdx.x];
+      sum_beta += sbeta[t][threadIdx.x];
+    }
+    part_gamma[blockIdx.y * ncols + c] = sum_gamma;
+    part_beta[blockIdx.y * ncols + c] = sum_beta;
+  }
+}
+
+template<typename DType, typename AType>
+__global__ void LayerNormGammaBetaGradKernel(const int ncols, const int num_parts,
+                                             const AType* part_gamma, const AType* part_beta,
+                                             DType* grad_gamma, DType* grad_beta,
+                                             const OpReqType req_gamma,
+                                             const OpReqType req_beta) {
+  const int c = blockIdx.x * blockDim.x + threadIdx.x;
+  if (c >= ncols) return;
+  AType sum_gamma = 0, sum_beta = 0;
+  for (int p = 0; p < num_parts; ++p) {
+    sum_gamma += part_gamma[p * ncols + c];
+    sum_beta += part_beta[p * ncols + c];
+  }
+  KERNEL_ASSIGN(grad_gamma[c], req_gamma, DType(sum_gamma));
+  KERNEL_ASSIGN(grad_beta[c], req_beta, DType(sum_beta));
+}
+
+template<typename DType>
+size_t LayerNormBackwardWorkspaceSize(mshadow::Stream<gpu>* s, const int nrows,
+                                      const int ncols) {
+  typedef typename LayerNormAccType<DType>::type AType;
+  return 2 * static_cast<size_t>(LayerNormGradParts(nrows)) * ncols * sizeof(AType);
+}
+
+template<typename DType>
+void LayerNormBackwardRows(mshadow::Stream<gpu>* s, const int nrows, const int ncols,
+                           const DType* ograd, const DType* data, const DType* gamma,
+                           const DType* mean, const DType* std,
+                           DType* grad_data, DType* grad_gamma, DType* grad_beta,
+                           const std::vector<OpReqType>& req, char* workspace) {
+  using namespace mshadow::cuda;
+  typedef typename LayerNormAccType<DType>::type AType;
+  if (nrows == 0) return;
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+  if (req[0] != kNullOp) {
+    const int blocks = std::min(nrows, kMaxGridNum);
+    MXNET_ASSIGN_REQ_SWITCH(req[0], Req, {
+      LayerNormFusedDataGradKernel<Req, DType, AType>
+        <<<blocks, LayerNormRowThreads(ncols), 0, stream>>>(
+        nrows, ncols, ograd, data, gamma, mean, std, grad_data);
+    });
+    MSHADOW_CUDA_POST_KERNEL_CHECK(LayerNormFusedDataGradKernel);
+  }
+  if (req[1] == kNullOp && req[2] == kNullOp) return;
+  // with a null req the sums are still taken, but into the workspace only
+  const int num_parts = LayerNormGradParts(nrows);
+  AType* part_gamma = reinterpret_cast<AType*>(workspace);
+  AType* part_beta = part_gamma + static_cast<size_t>(num_parts) * ncols;
+  dim3 part_grid((ncols + kWarpSize - 1) / kWarpSize, num_parts);
+  dim3 part_block(kWarpSize, kLayerNormTileRows);
+  LayerNormPartGammaBetaKernel<<<part_grid, part_block, 0, stream>>>(
+    nrows, ncols, ograd, data, mean, std, part_gamma, part_beta);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(LayerNormPartGammaBetaKernel);
+  LayerNormGammaBetaGradKernel<<<(ncols + kBaseThreadNum - 1) / kBaseThreadNum,
+                                 kBaseThreadNum, 0, stream>>>(
+    ncols, num_parts, part_gamma, part_beta, grad_gamma, grad_beta, req[1], req[2]);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(LayerNormGammaBetaGradKernel);
+}
+
 NNVM_REGISTER_OP(LayerNorm)
 .set_attr<FCompute>("FCompute<gpu>", LayerNormCompute<gpu>);
 
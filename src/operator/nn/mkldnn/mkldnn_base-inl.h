@@ -58,6 +58,7 @@
 #include "mxnet/ndarray.h"
 #include "mxnet/resource.h"
 #include "mxnet/op_attr_types.h"
+#include "../../operator_common.h"
 using namespace mkldnn;
 namespace mxnet {
 extern bool EnableMkldnnWarnGenerated();
@@ -307,6 +308,25 @@ class MKLDNNStream {
   }
 };
 
+/*!
+ * \brief Add the primitive fwd of an operator to its thread-local cache and return the cached
+ *  copy. Every operator caches its primitives by its parameters and the shapes and formats of
+ *  its inputs, and each cache holds at most MXNET_MKLDNN_CACHE_NUM of them, so that variable
+ *  input shapes do not grow it without bound; an arbitrary entry is dropped when it is full.
+ *  The returned reference is valid until the next primitive is added to the same cache.
+ */
+template<typename Signature, typename Fwd>
+Fwd &AddToCache(std::unordered_map<Signature, Fwd, OpHash> *cache,
+                const Signature &key, const Fwd &fwd) {
+  static const int cache_size = dmlc::GetEnv("MXNET_MKLDNN_CACHE_NUM", 1024);
+  if (cache_size > 0 && cache->size() >= static_cast<size_t>(cache_size)) {
+    cache->erase(cache->begin());
+  }
+  auto ins_ret = cache->insert(std::pair<Signature, Fwd>(key, fwd));
+  CHECK(ins_ret.second);
+  return ins_ret.first->second;
+}
+
 enum OutDataOp {
   Noop,
   CopyBack,
@@ -33,7 +33,8 @@ namespace op {
 
 static mkldnn::convolution_forward::primitive_desc GetConvFwdImpl(
     const ConvolutionParam& param, bool is_train, const NDArray &data,
-    const NDArray &weights, const NDArray *bias, const NDArray &output) {
+    const NDArray &weights, const NDArray *bias, const NDArray &output,
+    const mkldnn::primitive_attr &attr = mkldnn::primitive_attr()) {
   auto prop = is_train ? mkldnn::prop_kind::forward_training : mkldnn::prop_kind::forward_scoring;
   auto data_md = GetMemDesc(data);
   auto weight_md = GetWeightDesc(weights, param.num_group);
@@ -52,13 +53,13 @@ static mkldnn::convolution_forward::primitive_desc GetConvFwdImpl(
   if (param.dilate.ndim() == 0 && bias == nullptr) {
     mkldnn::convolution_forward::desc desc(prop, mkldnn::algorithm::convolution_direct,
         data_md, weight_md, out_md, strides, padding, padding, mkldnn::padding_kind::zero);
-    return mkldnn::convolution_forward::primitive_desc(desc, engine);
+    return mkldnn::convolution_forward::primitive_desc(desc, attr, engine);
   } else if (param.dilate.ndim() == 0) {
     auto bias_md = GetMemDesc(*bias);
     mkldnn::convolution_forward::desc desc(prop, mkldnn::algorithm::convolution_direct,
         data_md, weight_md, bias_md, out_md, strides, padding, padding,
         mkldnn::padding_kind::zero);
-    return mkldnn::convolution_forward::primitive_desc(desc, engine);
+    return mkldnn::convolution_forward::primitive_desc(desc, attr, engine);
   } else {
     mkldnn::memory::dims dilates{0, 0};
     if (param.dilate.ndim() == 2) {
@@ -69,14 +70,14 @@ static mkldnn::convolution_forward::primitive_desc GetConvFwdImpl(
       mkldnn::convolution_forward::desc desc(prop, mkldnn::algorithm::convolution_direct,
           data_md, weight_md, out_md, strides, dilates, padding, padding,
           mkldnn::padding_kind::zero);
-      return mkldnn::convolution_forward::primitive_desc(desc, engine);
+      return mkldnn::convolution_forward::primitive_desc(desc, attr, engine);
     } else {
       auto bias_md = GetMemDesc(*bias);
       mkldnn::convolution_forward::desc desc(prop, mkldnn::algorithm::convolution_direct,
                                              data_md, weight_md, bias_md, out_md, strides,
                                              dilates, padding, padding,
                                              mkldnn::padding_kind::zero);
-      return mkldnn::convolution_forward::primitive_desc(desc, engine);
+      return mkldnn::convolution_forward::primitive_desc(desc, attr, engine);
     }
   }
 }
@@ -177,8 +178,9 @@ class MKLDNNConvForward {
 
   MKLDNNConvForward(const ConvolutionParam& param, bool is_train,
                     const NDArray &data, const NDArray &weights,
-                    const NDArray *bias, const NDArray &output): fwd_pd(
-                        GetConvFwdImpl(param, is_train, data, weights, bias, output)) {
+                    const NDArray *bias, const NDArray &output,
+                    const mkldnn::primitive_attr &attr): fwd_pd(
+                        GetConvFwdImpl(param, is_train, data, weights, bias, output, attr)) {
   }
 
   void SetNewMem(const mkldnn::memory &data, const mkldnn::memory &weight,
@@ -228,14 +230,31 @@ class MKLDNNConvForward {
 
 typedef ParamOpSign<ConvolutionParam> MKLDNNConvSignature;
 
+/*
+ * The post-ops run on the output of the convolution before it is written:
+ * with_sum adds the convolution to the values already in the output, and
+ * with_relu applies relu to the result.
+ */
+static mkldnn::primitive_attr GetConvPostOps(bool with_sum, bool with_relu) {
+  mkldnn::post_ops ops;
+  if (with_sum)
+    ops.append_sum(1.0f);
+  if (with_relu)
+    ops.append_eltwise(1.0f, mkldnn::algorithm::eltwise_relu, 0.0f, 0.0f);
+  mkldnn::primitive_attr attr;
+  attr.set_post_ops(ops);
+  return attr;
+}
+
 static inline MKLDNNConvForward &GetConvFwd(
-    const nnvm::NodeAttrs& attrs, bool is_train,
+    const ConvolutionParam& param, bool is_train, bool with_sum, bool with_relu,
     const NDArray &data, const NDArray &weights,
     const NDArray *bias, const NDArray &output) {
   static thread_local std::unordered_map<MKLDNNConvSignature, MKLDNNConvForward, OpHash> fwds;
-  const ConvolutionParam& param = nnvm::get<ConvolutionParam>(attrs.parsed);
   MKLDNNConvSignature key(param);
   key.AddSign(is_train);
+  key.AddSign(with_sum);
+  key.AddSign(with_relu);
   // Here we can sign the conv op with NDArray because conv primitive will
   // decide the right layout for the, so we only need to get the shape and the
   // data type of the arrays.
@@ -247,26 +266,22 @@ static inline MKLDNNConvForward &GetConvFwd(
 
   auto it = fwds.find(key);
   if (it == fwds.end()) {
-    MKLDNNConvForward fwd(param, is_train, data, weights, bias, output);
-    auto ins_ret = fwds.insert(
-        std::pair<MKLDNNConvSignature, MKLDNNConvForward>(key, fwd));
-    CHECK(ins_ret.second);
-    it = ins_ret.first;
+    MKLDNNConvForward fwd(param, is_train, data, weights, bias, output,
+                          GetConvPostOps(with_sum, with_relu));
+    return AddToCache(&fwds, key, fwd);
   }
   return it->second;
 }
 
-void MKLDNNConvolutionForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
-                               const std::vector<NDArray> &in_data,
-                               const std::vector<OpReqType> &req,
-                               const std::vector<NDArray> &out_data) {
-  TmpMemMgr::Get()->Init(ctx.requested[conv::kTempSpace]);
-  const ConvolutionParam& param = nnvm::get<ConvolutionParam>(attrs.parsed);
-  NDArray weight = in_data[conv::kWeight];
-  MKLDNNConvForward &fwd = GetConvFwd(attrs, ctx.is_train, in_data[conv::kData], weight,
-      param.no_bias ? nullptr : &in_data[conv::kBias], out_data[conv::kOut]);
+static void MKLDNNConvForwardImpl(const ConvolutionParam &param, const OpContext &ctx,
+                                  bool with_relu, const NDArray &data,
+                                  const NDArray &weight, bool persistent_weight,
+                                  const NDArray *bias, const NDArray *sum,
+                                  OpReqType req, const NDArray &out) {
+  MKLDNNConvForward &fwd = GetConvFwd(param, ctx.is_train, sum != nullptr, with_relu,
+                                      data, weight, bias, out);
 
-  auto data_mem = in_data[conv::kData].GetMKLDNNDataReorder(fwd.fwd_pd.src_primitive_desc());
+  auto data_mem = data.GetMKLDNNDataReorder(fwd.fwd_pd.src_primitive_desc());
   const mkldnn::memory *weight_mem;
   if (ctx.is_train) {
     // TODO(zhengda) kvstore doesn't handle MKLDNN correctly. Let's reorder it
@@ -274,7 +289,7 @@ void MKLDNNConvolutionForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx
     if (weight.IsMKLDNNData())
       // This asks the engine to change the layout of the weight array after
       // it's used.
-      weight.Reorder2DefaultAsync();
+      const_cast<NDArray &>(weight).Reorder2DefaultAsync();
     weight_mem = GetWeights(weight, fwd.fwd_pd.weights_primitive_desc(), param.num_group);
   } else {
     // For inference, we want to reorder the weight array so we don't need to
@@ -283,24 +298,51 @@ void MKLDNNConvolutionForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx
       weight_mem = GetWeights(weight, fwd.fwd_pd.weights_primitive_desc(), param.num_group);
       // We also need to modify the layout on the original weight array. The
       // data conversion happens after the weight array is used.
-      weight.MKLDNNDataReorderAsync(fwd.fwd_pd.weights_primitive_desc());
+      if (persistent_weight)
+        const_cast<NDArray &>(weight).MKLDNNDataReorderAsync(
+            fwd.fwd_pd.weights_primitive_desc());
     } else {
       weight_mem = weight.GetMKLDNNData();
       CHECK(weight_mem->get_primitive_desc() == fwd.fwd_pd.weights_primitive_desc());
     }
   }
-  auto out_mem = CreateMKLDNNMem(out_data[conv::kOut], fwd.fwd_pd.dst_primitive_desc(),
-                                 req[conv::kOut]);
+  auto out_mem = CreateMKLDNNMem(out, fwd.fwd_pd.dst_primitive_desc(), req);
+  if (sum != nullptr) {
+    // the sum post-op accumulates into the destination, which starts as the addend
+    auto sum_mem = sum->GetMKLDNNDataReorder(fwd.fwd_pd.dst_primitive_desc());
+    MKLDNNStream::Get()->RegisterPrim(mkldnn::reorder(*sum_mem, *out_mem.second));
+  }
   const mkldnn::memory *bias_mem = nullptr;
-  if (!param.no_bias)
-    bias_mem = in_data[conv::kBias].GetMKLDNNDataReorder(fwd.fwd_pd.bias_primitive_desc());
+  if (bias != nullptr)
+    bias_mem = bias->GetMKLDNNDataReorder(fwd.fwd_pd.bias_primitive_desc());
   fwd.SetNewMem(*data_mem, *weight_mem, bias_mem, *out_mem.second);
   MKLDNNStream::Get()->RegisterPrim(fwd.GetFwd());
 
-  CommitOutput(out_data[conv::kOut], out_mem);
+  CommitOutput(out, out_mem);
   MKLDNNStream::Get()->Submit();
 }
 
+void MKLDNNConvolutionForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
+                               const std::vector<NDArray> &in_data,
+                               const std::vector<OpReqType> &req,
+                               const std::vector<NDArray> &out_data) {
+  TmpMemMgr::Get()->Init(ctx.requested[conv::kTempSpace]);
+  const ConvolutionParam& param = nnvm::get<ConvolutionParam>(attrs.parsed);
+  MKLDNNConvForwardImpl(param, ctx, false, in_data[conv::kData], in_data[conv::kWeight], true,
+                        param.no_bias ? nullptr : &in_data[conv::kBias], nullptr,
+                        req[conv::kOut], out_data[conv::kOut]);
+}
+
+void MKLDNNFusedConvolutionForward(const ConvolutionParam &param, const OpContext &ctx,
+                                   bool with_relu, const NDArray &data,
+                                   const NDArray &weight, bool persistent_weight,
+                                   const NDArray *bias, const NDArray *sum,
+                                   OpReqType req, const NDArray &out) {
+  TmpMemMgr::Get()->Init(ctx.requested[conv::kTempSpace]);
+  MKLDNNConvForwardImpl(param, ctx, with_relu, data, weight, persistent_weight, bias, sum,
+                        req, out);
+}
+
 void MKLDNNConvolutionBackward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
                                const std::vector<NDArray>& inputs,
                                const std::vector<OpReqType>& req,
@@ -23,6 +23,8 @@
  * \author Da Zheng
 */
 
+#include <memory>
+#include <unordered_map>
 #include "../fully_connected-inl.h"
 #include "./mkldnn_base-inl.h"
 
@@ -82,6 +84,87 @@ inline static mkldnn::inner_product_backward_weights::primitive_desc GetIPBwdWei
   }
 }
 
+class MKLDNNFullyConnectedForward {
+  std::shared_ptr<mkldnn::inner_product_forward> fwd;
+  std::shared_ptr<mkldnn::memory> data;
+  std::shared_ptr<mkldnn::memory> weight;
+  std::shared_ptr<mkldnn::memory> bias;
+  std::shared_ptr<mkldnn::memory> out;
+
+ public:
+  const mkldnn::inner_product_forward::primitive_desc ipFwd_pd;
+
+  MKLDNNFullyConnectedForward(const NDArray &data, const NDArray &weight, const NDArray *bias,
+                              const mkldnn::memory::desc &out_md, const bool is_train)
+      : ipFwd_pd(GetIPFwd(data, weight, bias, out_md, is_train)) {
+  }
+
+  void SetNewMem(const mkldnn::memory &data, const mkldnn::memory &weight,
+                 const mkldnn::memory *bias, const mkldnn::memory &output) {
+    if (this->data == nullptr)
+      this->data = std::shared_ptr<mkldnn::memory>(new mkldnn::memory(
+              ipFwd_pd.src_primitive_desc(), data.get_data_handle()));
+    else
+      this->data->set_data_handle(data.get_data_handle());
+
+    if (this->weight == nullptr)
+      this->weight = std::shared_ptr<mkldnn::memory>(new mkldnn::memory(
+              ipFwd_pd.weights_primitive_desc(), weight.get_data_handle()));
+    else
+      this->weight->set_data_handle(weight.get_data_handle());
+
+    if (this->out == nullptr)
+      this->out = std::shared_ptr<mkldnn::memory>(new mkldnn::memory(
+              ipFwd_pd.dst_primitive_desc(), output.get_data_handle()));
+    else
+      this->out->set_data_handle(output.get_data_handle());
+
+    if (bias != nullptr) {
+      if (this->bias == nullptr)
+        this->bias = std::shared_ptr<mkldnn::memory>(new mkldnn::memory(
+                ipFwd_pd.bias_primitive_desc(), bias->get_data_handle()));
+      else
+        this->bias->set_data_handle(bias->get_data_handle());
+      if (this->fwd == nullptr)
+        this->fwd = std::shared_ptr<mkldnn::inner_product_forward>(
+            new mkldnn::inner_product_forward(ipFwd_pd, mkldnn::primitive::at(*this->data),
+                                              mkldnn::primitive::at(*this->weight),
+                                              mkldnn::primitive::at(*this->bias), *this->out));
+    } else if (this->fwd == nullptr) {
+      this->fwd = std::shared_ptr<mkldnn::inner_product_forward>(
+          new mkldnn::inner_product_forward(ipFwd_pd, mkldnn::primitive::at(*this->data),
+                                            mkldnn::primitive::at(*this->weight), *this->out));
+    }
+  }
+
+  const mkldnn::inner_product_forward &GetFwd() const {
+    return *fwd;
+  }
+};
+
+static MKLDNNFullyConnectedForward &GetFCFwd(
+    const FullyConnectedParam &param, bool is_train, const NDArray &data,
+    const NDArray &weight, const NDArray *bias, const mkldnn::memory::desc &out_md,
+    const NDArray &output) {
+  static thread_local std::unordered_map<OpSignature, MKLDNNFullyConnectedForward, OpHash> fwds;
+  OpSignature key;
+  key.AddSign(param.flatten);
+  key.AddSign(is_train);
+  // As for convolution, the primitive decides the layouts of its arrays.
+  key.AddSign(data);
+  key.AddSign(weight);
+  key.AddSign(output);
+  if (bias)
+    key.AddSign(*bias);
+
+  auto it = fwds.find(key);
+  if (it == fwds.end()) {
+    MKLDNNFullyConnectedForward fwd(data, weight, bias, out_md, is_train);
+    return AddToCache(&fwds, key, fwd);
+  }
+  return it->second;
+}
+
 void MKLDNNFCForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
                      const std::vector<NDArray> &in_data,
                      const std::vector<OpReqType> &req,
@@ -113,20 +196,30 @@ void MKLDNNFCForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
       mkldnn::memory::format::any);
   }
 
-  mkldnn::inner_product_forward::primitive_desc ipFwd_pd = GetIPFwd(data, weight,
-      param.no_bias ? nullptr : &in_data[fullc::kBias], out_md, ctx.is_train);
-  auto data_mem = data.GetMKLDNNDataReorder(ipFwd_pd.src_primitive_desc());
-  auto weight_mem = weight.GetMKLDNNDataReorder(ipFwd_pd.weights_primitive_desc());
-  auto out_mem = CreateMKLDNNMem(out_data[fullc::kOut],
-      ipFwd_pd.dst_primitive_desc(), req[fullc::kOut]);
-  if (param.no_bias) {
-    MKLDNNStream::Get()->RegisterPrim(mkldnn::inner_product_forward(
-          ipFwd_pd, *data_mem, *weight_mem, *out_mem.second));
+  const NDArray *bias = param.no_bias ? nullptr : &in_data[fullc::kBias];
+  MKLDNNFullyConnectedForward &fwd = GetFCFwd(param, ctx.is_train, data, weight, bias, out_md,
+                                              out_data[fullc::kOut]);
+  auto data_mem = data.GetMKLDNNDataReorder(fwd.ipFwd_pd.src_primitive_desc());
+  const mkldnn::memory *weight_mem;
+  if (ctx.is_train) {
+    // As for convolution, kvstore expects the weight in the default layout.
+    if (weight.IsMKLDNNData())
+      weight.Reorder2DefaultAsync();
+    weight_mem = weight.GetMKLDNNDataReorder(fwd.ipFwd_pd.weights_primitive_desc());
   } else {
-    auto bias_mem = in_data[fullc::kBias].GetMKLDNNDataReorder(ipFwd_pd.bias_primitive_desc());
-    MKLDNNStream::Get()->RegisterPrim(mkldnn::inner_product_forward(ipFwd_pd,
-          *data_mem, *weight_mem, *bias_mem, *out_mem.second));
+    // For inference, the weight array keeps the layout of the primitive, so
+    // it is only reordered by the first call.
+    weight_mem = weight.GetMKLDNNDataReorder(fwd.ipFwd_pd.weights_primitive_desc());
+    if (weight.IsDefaultData())
+      weight.MKLDNNDataReorderAsync(fwd.ipFwd_pd.weights_primitive_desc());
   }
+  auto out_mem = CreateMKLDNNMem(out_data[fullc::kOut],
+      fwd.ipFwd_pd.dst_primitive_desc(), req[fullc::kOut]);
+  const mkldnn::memory *bias_mem = nullptr;
+  if (bias)
+    bias_mem = bias->GetMKLDNNDataReorder(fwd.ipFwd_pd.bias_primitive_desc());
+  fwd.SetNewMem(*data_mem, *weight_mem, bias_mem, *out_mem.second);
+  MKLDNNStream::Get()->RegisterPrim(fwd.GetFwd());
   CommitOutput(out_data[fullc::kOut], out_mem);
   MKLDNNStream::Get()->Submit();
 }
@@ -0,0 +1,338 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file mkldnn_fused_conv.cc
+ * \brief convolution fused with the BatchNorm, residual sum and relu following it,
+ *        created by the executor for inference graphs
+ */
+#include <cmath>
+#include <string>
+#include <vector>
+#include "../convolution-inl.h"
+#include "../../mshadow_op.h"
+#include "../../mxnet_op.h"
+#include "./mkldnn_ops-inl.h"
+#include "./mkldnn_base-inl.h"
+
+#if MXNET_USE_MKLDNN == 1
+namespace mxnet {
+namespace op {
+
+struct MKLDNNFusedConvParam : public dmlc::Parameter<MKLDNNFusedConvParam> {
+  bool with_bn;
+  double bn_eps;
+  bool bn_fix_gamma;
+  bool with_sum;
+  bool sum_first;
+  bool with_relu;
+  DMLC_DECLARE_PARAMETER(MKLDNNFusedConvParam) {
+    DMLC_DECLARE_FIELD(with_bn).set_default(false)
+    .describe("Whether a BatchNorm with global statistics follows the convolution.");
+    DMLC_DECLARE_FIELD(bn_eps).set_default(1e-3f)
+    .describe("Epsilon of the BatchNorm.");
+    DMLC_DECLARE_FIELD(bn_fix_gamma).set_default(true)
+    .describe("Whether the gamma of the BatchNorm is fixed to 1.");
+    DMLC_DECLARE_FIELD(with_sum).set_default(false)
+    .describe("Whether the input sum is added to the result.");
+    DMLC_DECLARE_FIELD(sum_first).set_default(false)
+    .describe("Whether sum is the first input instead of the last one.");
+    DMLC_DECLARE_FIELD(with_relu).set_default(false)
+    .describe("Whether relu is applied to the result.");
+  }
+};
+
+/*! \brief parsed attributes, the convolution ones are parsed as by Convolution */
+struct MKLDNNFusedConvAttrs {
+  ConvolutionParam conv;
+  MKLDNNFusedConvParam fused;
+};
+
+/*! \brief index of every input of a fused convolution, or -1 if it does not have it */
+struct MKLDNNFusedConvInputs {
+  int data, weight, bias, gamma, beta, mean, var, sum, num;
+};
+
+static MKLDNNFusedConvInputs GetFusedConvInputs(const MKLDNNFusedConvAttrs& param) {
+  MKLDNNFusedConvInputs in;
+  int num = 0;
+  in.sum = param.fused.with_sum && param.fused.sum_first ? num++ : -1;
+  in.data = num++;
+  in.weight = num++;
+  in.bias = param.conv.no_bias ? -1 : num++;
+  in.gamma = param.fused.with_bn ? num++ : -1;
+  in.beta = param.fused.with_bn ? num++ : -1;
+  in.mean = param.fused.with_bn ? num++ : -1;
+  in.var = param.fused.with_bn ? num++ : -1;
+  if (param.fused.with_sum && !param.fused.sum_first) in.sum = num++;
+  in.num = num;
+  return in;
+}
+
+/*! \brief the parameters of the convolution the node runs, with the folded bias */
+static nnvm::NodeAttrs FusedConvConvAttrs(const nnvm::NodeAttrs& attrs) {
+  const MKLDNNFusedConvAttrs& param = nnvm::get<MKLDNNFusedConvAttrs>(attrs.parsed);
+  ConvolutionParam conv = param.conv;
+  if (param.fused.with_bn) conv.no_bias = false;
+  nnvm::NodeAttrs conv_attrs;
+  conv_attrs.op = nnvm::Op::Get("Convolution");
+  conv_attrs.name = attrs.name;
+  conv_attrs.parsed = conv;
+  return conv_attrs;
+}
+
+static void MKLDNNFusedConvParamParser(nnvm::NodeAttrs* attrs) {
+  MKLDNNFusedConvAttrs param;
+  param.fused.InitAllowUnknown(attrs->dict);
+  nnvm::NodeAttrs conv_attrs;
+  conv_attrs.op = nnvm::Op::Get("Convolution");
+  conv_attrs.name = attrs->name;
+  conv_attrs.dict = attrs->dict;
+  for (const auto& field : MKLDNNFusedConvParam::__FIELDS__()) {
+    conv_attrs.dict.erase(field.name);
+  }
+  conv_attrs.op->attr_parser(&conv_attrs);
+  param.conv = nnvm::get<ConvolutionParam>(conv_attrs.parsed);
+  attrs->parsed = std::move(param);
+}
+
+/*! \brief W' = W * gamma / sqrt(var + eps), b' = (b - mean) * gamma / sqrt(var + eps) + beta */
+static void FoldFusedConvBatchNorm(const MKLDNNFusedConvAttrs& param,
+                                   const MKLDNNFusedConvInputs& in,
+                                   const std::vector<TBlob>& inputs,
+                                   const TBlob& weight, const TBlob& bias) {
+  MSHADOW_REAL_TYPE_SWITCH(weight.type_flag_, DType, {
+    MSHADOW_REAL_TYPE_SWITCH(inputs[in.gamma].type_flag_, PType, {
+      const size_t channels = weight.shape_[0];
+      const size_t row = weight.Size() / channels;
+      const DType* w = inputs[in.weight].dptr<DType>();
+      const DType* b = in.bias < 0 ? nullptr : inputs[in.bias].dptr<DType>();
+      const PType* gamma = inputs[in.gamma].dptr<PType>();
+      const PType* beta = inputs[in.beta].dptr<PType>();
+      const PType* mean = inputs[in.mean].dptr<PType>();
+      const PType* var = inputs[in.var].dptr<PType>();
+      DType* out_w = weight.dptr<DType>();
+      DType* out_b = bias.dptr<DType>();
+      for (size_t c = 0; c < channels; ++c) {
+        const double g = param.fused.bn_fix_gamma ? 1.0 : static_cast<double>(gamma[c]);
+        const double scale = g / std::sqrt(static_cast<double>(var[c]) + param.fused.bn_eps);
+        for (size_t i = 0; i < row; ++i) {
+          out_w[c * row + i] = static_cast<DType>(static_cast<double>(w[c * row + i]) * scale);
+        }
+        const double bc = b == nullptr ? 0.0 : static_cast<double>(b[c]);
+        out_b[c] = static_cast<DType>((bc - static_cast<double>(mean[c])) * scale +
+                                      static_cast<double>(beta[c]));
+      }
+    });
+  });
+}
+
+static void MKLDNNFusedConvCompute(const nnvm::NodeAttrs& attrs,
+                                   const OpContext& ctx,
+                                   const std::vector<TBlob>& inputs,
+                                   const std::vector<OpReqType>& req,
+                                   const std::vector<TBlob>& outputs) {
+  using namespace mxnet_op;
+  const MKLDNNFusedConvAttrs& param = nnvm::get<MKLDNNFusedConvAttrs>(attrs.parsed);
+  const MKLDNNFusedConvInputs in = GetFusedConvInputs(param);
+  if (req[0] == kNullOp) return;
+  CHECK_NE(req[0], kAddTo) << "The fused convolution does not support kAddTo";
+  std::vector<TBlob> conv_in = {inputs[in.data], inputs[in.weight]};
+  if (in.bias >= 0) conv_in.push_back(inputs[in.bias]);
+  NDArray weight, bias;
+  if (param.fused.with_bn) {
+    const int dtype = inputs[in.weight].type_flag_;
+    weight = NDArray(inputs[in.weight].shape_, Context::CPU(), false, dtype);
+    bias = NDArray(mshadow::Shape1(param.conv.num_filter), Context::CPU(), false, dtype);
+    FoldFusedConvBatchNorm(param, in, inputs, weight.data(), bias.data());
+    conv_in = {inputs[in.data], weight.data(), bias.data()};
+  }
+  ConvolutionCompute<cpu>(FusedConvConvAttrs(attrs), ctx, conv_in, {kWriteTo}, outputs);
+
+  mshadow::Stream<cpu>* s = ctx.get_stream<cpu>();
+  const size_t size = outputs[0].Size();
+  MSHADOW_REAL_TYPE_SWITCH(outputs[0].type_flag_, DType, {
+    DType* out = outputs[0].dptr<DType>();
+    if (param.fused.with_sum) {
+      Kernel<op_with_req<mshadow_op::plus, kWriteTo>, cpu>::Launch(
+        s, size, out, out, inputs[in.sum].dptr<DType>());
+    }
+    if (param.fused.with_relu) {
+      Kernel<op_with_req<mshadow_op::relu, kWriteTo>, cpu>::Launch(s, size, out, out);
+    }
+  });
+}
+
+static void MKLDNNFusedConvComputeExCPU(const nnvm::NodeAttrs& attrs,
+                                        const OpContext& ctx,
+                                        const std::vector<NDArray>& inputs,
+                                        const std::vector<OpReqType>& req,
+                                        const std::vector<NDArray>& outputs) {
+  const MKLDNNFusedConvAttrs& param = nnvm::get<MKLDNNFusedConvAttrs>(attrs.parsed);
+  const MKLDNNFusedConvInputs in = GetFusedConvInputs(param);
+  if (!SupportMKLDNNConv(inputs[in.data])) {
+    FallBackCompute(MKLDNNFusedConvCompute, attrs, ctx, inputs, req, outputs);
+    return;
+  }
+  NDArray weight = inputs[in.weight];
+  const NDArray* bias = in.bias < 0 ? nullptr : &inputs[in.bias];
+  NDArray folded_bias;
+  if (param.fused.with_bn) {
+    // the folded arrays are temporary, so the BatchNorm parameters can
+    // change between two calls
+    std::vector<TBlob> blobs(inputs.size());
+    std::vector<NDArray> defaults(inputs.size());
+    for (int i : {in.weight, in.bias, in.gamma, in.beta, in.mean, in.var}) {
+      if (i < 0) continue;
+      defaults[i] = inputs[i].IsMKLDNNData() ? inputs[i].Reorder2Default() : inputs[i];
+      blobs[i] = defaults[i].data();
+    }
+    weight = NDArray(inputs[in.weight].shape(), Context::CPU(), false, inputs[in.weight].dtype());
+    folded_bias = NDArray(mshadow::Shape1(param.conv.num_filter), Context::CPU(), false,
+                          inputs[in.weight].dtype());
+    FoldFusedConvBatchNorm(param, in, blobs, weight.data(), folded_bias.data());
+    bias = &folded_bias;
+  }
+  MKLDNNFusedConvolutionForward(param.conv, ctx, param.fused.with_relu, inputs[in.data],
+                                weight, !param.fused.with_bn, bias,
+                                param.fused.with_sum ? &inputs[in.sum] : nullptr,
+                                req[0], outputs[0]);
+}
+
+static bool MKLDNNFusedConvShape(const nnvm::NodeAttrs& attrs,
+                                 std::vector<TShape> *in_shape,
+                                 std::vector<TShape> *out_shape) {
+  static auto& finfer_shape = nnvm::Op::GetAttr<nnvm::FInferShape>("FInferShape");
+  const MKLDNNFusedConvAttrs& param = nnvm::get<MKLDNNFusedConvAttrs>(attrs.parsed);
+  const MKLDNNFusedConvInputs in = GetFusedConvInputs(param);
+  CHECK_EQ(in_shape->size(), static_cast<size_t>(in.num));
+  out_shape->resize(1, TShape());
+  // the shapes of the inputs of the node, the folded bias is not one of them
+  nnvm::NodeAttrs conv_attrs = FusedConvConvAttrs(attrs);
+  conv_attrs.parsed = param.conv;
+  std::vector<TShape> conv_in = {(*in_shape)[in.data], (*in_shape)[in.weight]};
+  if (in.bias >= 0) conv_in.push_back((*in_shape)[in.bias]);
+  std::vector<TShape> conv_out;
+  const bool known = finfer_shape[conv_attrs.op](conv_attrs, &conv_in, &conv_out);
+  SHAPE_ASSIGN_CHECK(*in_shape, in.data, conv_in[0]);
+  SHAPE_ASSIGN_CHECK(*in_shape, in.weight, conv_in[1]);
+  if (in.bias >= 0) SHAPE_ASSIGN_CHECK(*in_shape, in.bias, conv_in[2]);
+  if (param.fused.with_bn) {
+    const TShape channels = mshadow::Shape1(param.conv.num_filter);
+    SHAPE_ASSIGN_CHECK(*in_shape, in.gamma, channels);
+    SHAPE_ASSIGN_CHECK(*in_shape, in.beta, channels);
+    SHAPE_ASSIGN_CHECK(*in_shape, in.mean, channels);
+    SHAPE_ASSIGN_CHECK(*in_shape, in.var, channels);
+  }
+  if (!known) return false;
+  SHAPE_ASSIGN_CHECK(*out_shape, 0, conv_out[0]);
+  if (in.sum >= 0) SHAPE_ASSIGN_CHECK(*in_shape, in.sum, conv_out[0]);
+  return true;
+}
+
+static bool MKLDNNFusedConvType(const nnvm::NodeAttrs& attrs,
+                                std::vector<int> *in_type,
+                                std::vector<int> *out_type) {
+  const MKLDNNFusedConvAttrs& param = nnvm::get<MKLDNNFusedConvAttrs>(attrs.parsed);
+  const MKLDNNFusedConvInputs in = GetFusedConvInputs(param);
+  CHECK_EQ(in_type->size(), static_cast<size_t>(in.num));
+  out_type->resize(1, -1);
+  int dtype = (*out_type)[0];
+  for (int i = 0; i < in.num && dtype == -1; ++i) {
+    if (i != in.gamma && i != in.beta && i != in.mean && i != in.var) dtype = (*in_type)[i];
+  }
+  if (dtype == -1) return false;
+  // as in BatchNorm, the parameters of float16 data are float32
+  for (int i = 0; i < in.num; ++i) {
+    const bool is_bn = i == in.gamma || i == in.beta || i == in.mean || i == in.var;
+    const int type = is_bn && dtype == mshadow::kFloat16 ? mshadow::kFloat32 : dtype;
+    TYPE_ASSIGN_CHECK(*in_type, i, type);
+  }
+  TYPE_ASSIGN_CHECK(*out_type, 0, dtype);
+  return true;
+}
+
+static bool MKLDNNFusedConvStorageType(const nnvm::NodeAttrs& attrs,
+                                       const int dev_mask,
+                                       DispatchMode* dispatch_mode,
+                                       std::vector<int> *in_attrs,
+                                       std::vector<int> *out_attrs) {
+  CHECK_EQ(out_attrs->size(), 1);
+  const DispatchMode wanted_mode = dev_mask == mshadow::cpu::kDevMask ?
+      DispatchMode::kFComputeEx : DispatchMode::kFCompute;
+  return storage_type_assign(out_attrs, mxnet::kDefaultStorage,
+                             dispatch_mode, wanted_mode);
+}
+
+DMLC_REGISTER_PARAMETER(MKLDNNFusedConvParam);
+
+NNVM_REGISTER_OP(_mkldnn_fused_conv)
+.describe(R"code(Convolution followed by an optional BatchNorm with global statistics,
+an optional sum with another array and an optional relu.
+
+Created by the executor for inference on CPU, the BatchNorm is folded into the
+weight and the bias, and the sum and relu run as MKLDNN post-ops.
+)code" ADD_FILELINE)
+.set_num_inputs([](const NodeAttrs& attrs) {
+  const MKLDNNFusedConvAttrs& param = nnvm::get<MKLDNNFusedConvAttrs>(attrs.parsed);
+  return static_cast<uint32_t>(GetFusedConvInputs(param).num);
+})
+.set_num_outputs(1)
+.set_attr_parser(MKLDNNFusedConvParamParser)
+.set_attr<nnvm::FListInputNames>("FListInputNames", [](const NodeAttrs& attrs) {
+  const MKLDNNFusedConvAttrs& param = nnvm::get<MKLDNNFusedConvAttrs>(attrs.parsed);
+  const MKLDNNFusedConvInputs in = GetFusedConvInputs(param);
+  std::vector<std::string> names(in.num);
+  names[in.data] = "data";
+  names[in.weight] = "weight";
+  if (in.bias >= 0) names[in.bias] = "bias";
+  if (param.fused.with_bn) {
+    names[in.gamma] = "gamma";
+    names[in.beta] = "beta";
+    names[in.mean] = "moving_mean";
+    names[in.var] = "moving_var";
+  }
+  if (in.sum >= 0) names[in.sum] = "sum";
+  return names;
+})
+// the moving statistics are only read, they stay auxiliary states as in BatchNorm
+.set_attr<nnvm::FMutateInputs>("FMutateInputs", [](const nnvm::NodeAttrs& attrs) {
+  const MKLDNNFusedConvAttrs& param = nnvm::get<MKLDNNFusedConvAttrs>(attrs.parsed);
+  const MKLDNNFusedConvInputs in = GetFusedConvInputs(param);
+  if (!param.fused.with_bn) return std::vector<uint32_t>();
+  return std::vector<uint32_t>{static_cast<uint32_t>(in.mean), static_cast<uint32_t>(in.var)};
+})
+.set_attr<nnvm::FInferShape>("FInferShape", MKLDNNFusedConvShape)
+.set_attr<nnvm::FInferType>("FInferType", MKLDNNFusedConvType)
+.set_attr<FInferStorageType>("FInferStorageType", MKLDNNFusedConvStorageType)
+.set_attr<FCompute>("FCompute<cpu>", MKLDNNFusedConvCompute)
+.set_attr<FComputeEx>("FComputeEx<cpu>", MKLDNNFusedConvComputeExCPU)
+.set_attr<FResourceRequest>("FResourceRequest", [](const NodeAttrs& n) {
+  return std::vector<ResourceRequest>{ResourceRequest::kTempSpace};
+})
+.add_argument("data", "NDArray-or-Symbol", "Input data to the convolution.")
+.add_argument("weight", "NDArray-or-Symbol", "Weight matrix.")
+.add_argument("bias", "NDArray-or-Symbol", "Bias parameter.")
+.add_arguments(ConvolutionParam::__FIELDS__())
+.add_arguments(MKLDNNFusedConvParam::__FIELDS__());
+
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_USE_MKLDNN == 1
@@ -168,10 +168,7 @@ static MKLDNNLRNFwd &GetLRNFwd(const LRNParam& param,
   auto it = lrn_fwds.find(key);
   if (it == lrn_fwds.end()) {
     MKLDNNLRNFwd fwd(param, ctx.is_train, in_data);
-    auto ins_ret = lrn_fwds.insert(std::pair<MKLDNNLRNSignature, MKLDNNLRNFwd>
-                                   (key, fwd));
-    CHECK(ins_ret.second);
-    it = ins_ret.first;
+    return AddToCache(&lrn_fwds, key, fwd);
   }
   return it->second;
 }
@@ -61,6 +61,18 @@ void MKLDNNConvolutionBackward(const nnvm::NodeAttrs& attrs, const OpContext &ct
                                const std::vector<OpReqType>& req,
                                const std::vector<NDArray>& outputs);
 
+/*
+ * For the fused convolution of inference graphs. sum, if given, is added to
+ * the convolution before the optional relu. The weight array is only reordered
+ * in place when persistent_weight is true.
+ */
+struct ConvolutionParam;
+void MKLDNNFusedConvolutionForward(const ConvolutionParam &param, const OpContext &ctx,
+                                   bool with_relu, const NDArray &data,
+                                   const NDArray &weight, bool persistent_weight,
+                                   const NDArray *bias, const NDArray *sum,
+                                   OpReqType req, const NDArray &out);
+
 /* For deconvolution */
 void MKLDNNDeconvolutionForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
                                 const std::vector<NDArray> &in_data,
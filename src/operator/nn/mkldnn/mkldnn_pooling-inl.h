@@ -79,7 +79,7 @@ class MKLDNNPoolingFwd {
 };
 
 inline bool SupportMKLDNNPooling(const PoolingParam &param) {
-  return param.kernel.ndim() == 2 &&
+  return param.kernel.ndim() == 2 && !param.IsChannelLast(4) && !param.return_indices &&
          (param.pool_type == pool_enum::kMaxPooling ||
           param.pool_type == pool_enum::kAvgPooling);
 }
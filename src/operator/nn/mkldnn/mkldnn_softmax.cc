@@ -23,6 +23,8 @@
  * \author Da Zheng
 */
 
+#include <memory>
+#include <unordered_map>
 #include "../softmax-inl.h"
 #include "./mkldnn_ops-inl.h"
 #include "./mkldnn_base-inl.h"
@@ -31,23 +33,83 @@
 namespace mxnet {
 namespace op {
 
-void MKLDNNSoftmaxForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
-                          const NDArray &in_data, const OpReqType &req,
-                          const NDArray &out_data) {
-  const SoftmaxParam& param = nnvm::get<SoftmaxParam>(attrs.parsed);
-  auto input_mem = in_data.GetMKLDNNData();
-  mkldnn::memory::primitive_desc data_mpd = input_mem->get_primitive_desc();
+static mkldnn::softmax_forward::primitive_desc GetSoftmaxFwdPd(
+    bool is_train, int axis, const mkldnn::memory &input_mem) {
+  mkldnn::memory::primitive_desc data_mpd = input_mem.get_primitive_desc();
   mkldnn::memory::desc data_md = data_mpd.desc();
   auto cpu_engine = data_mpd.get_engine();
-  auto prop = ctx.is_train
+  auto prop = is_train
     ? mkldnn::prop_kind::forward_training : mkldnn::prop_kind::forward_scoring;
   mkldnn::softmax_forward::desc desc = mkldnn::softmax_forward::desc(prop,
-      data_md, param.axis);
-  mkldnn::softmax_forward::primitive_desc pdesc(desc, cpu_engine);
+      data_md, axis);
+  return mkldnn::softmax_forward::primitive_desc(desc, cpu_engine);
+}
+
+class MKLDNNSoftmaxFwd {
+  std::shared_ptr<mkldnn::softmax_forward> fwd;
+  std::shared_ptr<mkldnn::memory> data;
+  std::shared_ptr<mkldnn::memory> out;
+
+ public:
+  const mkldnn::softmax_forward::primitive_desc fwd_pd;
+
+  MKLDNNSoftmaxFwd(bool is_train, int axis, const mkldnn::memory &input_mem)
+      : fwd_pd(GetSoftmaxFwdPd(is_train, axis, input_mem)) {
+  }
+
+  void SetNewMem(const mkldnn::memory &data, const mkldnn::memory &output) {
+    if (this->data == nullptr)
+      this->data = std::shared_ptr<mkldnn::memory>(new mkldnn::memory(
+              data.get_primitive_desc(), data.get_data_handle()));
+    else
+      this->data->set_data_handle(data.get_data_handle());
+
+    if (this->out == nullptr)
+      this->out = std::shared_ptr<mkldnn::memory>(new mkldnn::memory(
+              output.get_primitive_desc(), output.get_data_handle()));
+    else
+      this->out->set_data_handle(output.get_data_handle());
 
+    if (this->fwd == nullptr) {
+      this->fwd = std::shared_ptr<mkldnn::softmax_forward>(
+          new mkldnn::softmax_forward(fwd_pd, mkldnn::primitive::at(*this->data),
+                                      *this->out));
+    }
+  }
+
+  const mkldnn::softmax_forward &GetFwd() const {
+    return *fwd;
+  }
+};
+
+static MKLDNNSoftmaxFwd &GetSoftmaxFwd(const SoftmaxParam &param, bool is_train,
+                                       const NDArray &in_data, const NDArray &out_data,
+                                       const mkldnn::memory &input_mem) {
+  static thread_local std::unordered_map<OpSignature, MKLDNNSoftmaxFwd, OpHash> fwds;
+  OpSignature key;
+  key.AddSign(param.axis);
+  key.AddSign(is_train);
+  key.AddSign(in_data);
+  key.AddSign(out_data);
+
+  auto it = fwds.find(key);
+  if (it == fwds.end()) {
+    MKLDNNSoftmaxFwd fwd(is_train, param.axis, input_mem);
+    return AddToCache(&fwds, key, fwd);
+  }
+  return it->second;
+}
+
+void MKLDNNSoftmaxForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
+                          const NDArray &in_data, const OpReqType &req,
+                          const NDArray &out_data) {
+  const SoftmaxParam& param = nnvm::get<SoftmaxParam>(attrs.parsed);
+  auto input_mem = in_data.GetMKLDNNData();
+  MKLDNNSoftmaxFwd &fwd = GetSoftmaxFwd(param, ctx.is_train, in_data, out_data, *input_mem);
   auto output_memory = out_data.GetMKLDNNData();
+  fwd.SetNewMem(*input_mem, *output_memory);
   MKLDNNStream *stream = MKLDNNStream::Get();
-  stream->RegisterPrim(mkldnn::softmax_forward(pdesc, *input_mem, *output_memory));
+  stream->RegisterPrim(fwd.GetFwd());
   stream->Submit();
 }
 
@@ -23,6 +23,9 @@
  * \author Da Zheng
 */
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "./mkldnn_ops-inl.h"
 #include "./mkldnn_base-inl.h"
@@ -31,6 +34,68 @@
 namespace mxnet {
 namespace op {
 
+class MKLDNNSumFwd {
+  std::shared_ptr<mkldnn::sum> fwd;
+  std::vector<std::shared_ptr<mkldnn::memory>> data;
+  std::vector<mkldnn::primitive::at> data_mem;
+  std::shared_ptr<mkldnn::memory> out;
+
+ public:
+  mkldnn::sum::primitive_desc fwd_pd;
+
+  MKLDNNSumFwd(const std::vector<float> &scales,
+               const std::vector<mkldnn::memory::primitive_desc> &data_md)
+      : fwd_pd(scales, data_md) {
+    data.resize(data_md.size());
+  }
+
+  void SetNewMem(const std::vector<const mkldnn::memory *> &in_data,
+                 const mkldnn::memory &output) {
+    CHECK_EQ(in_data.size(), data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+      if (this->data[i] == nullptr) {
+        this->data[i] = std::shared_ptr<mkldnn::memory>(new mkldnn::memory(
+                in_data[i]->get_primitive_desc(), in_data[i]->get_data_handle()));
+        this->data_mem.push_back(*this->data[i]);
+      } else {
+        this->data[i]->set_data_handle(in_data[i]->get_data_handle());
+      }
+    }
+    if (this->out == nullptr)
+      this->out = std::shared_ptr<mkldnn::memory>(new mkldnn::memory(
+              fwd_pd.dst_primitive_desc(), output.get_data_handle()));
+    else
+      this->out->set_data_handle(output.get_data_handle());
+
+    if (this->fwd == nullptr)
+      fwd.reset(new mkldnn::sum(fwd_pd, data_mem, *out));
+  }
+
+  const mkldnn::sum &GetFwd() const {
+    return *fwd;
+  }
+};
+
+static MKLDNNSumFwd &GetSumForward(
+    const std::vector<float> &scales, const std::vector<const mkldnn::memory *> &in_mems,
+    const std::vector<mkldnn::memory::primitive_desc> &data_md) {
+  static thread_local std::unordered_map<OpSignature, MKLDNNSumFwd, OpHash> fwds;
+  OpSignature key;
+  for (const mkldnn::memory *mem : in_mems)
+    key.AddSign(*mem);
+
+  auto it = fwds.find(key);
+  if (it == fwds.end()) {
+    MKLDNNSumFwd fwd(scales, data_md);
+    return AddToCache(&fwds, key, fwd);
+  }
+  return it->second;
+}
+
+/*
+ * Sum is called by CommitOutput, which may commit several outputs before the
+ * stream is submitted, so it does not share primitives through a cache.
+ */
 void Sum(const mkldnn::memory &arr1, const mkldnn::memory &arr2,
          const mkldnn::memory &out) {
   std::vector<mkldnn::memory::primitive_desc> input_pds(2);
@@ -54,10 +119,10 @@ void MKLDNNSumForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
   }
 
   TmpMemMgr::Get()->Init(ctx.requested[0]);
-  std::vector<mkldnn::primitive::at> in_prims;
+  std::vector<const mkldnn::memory *> in_mems;
   std::vector<mkldnn::memory::primitive_desc> in_pds(inputs.size());
   std::vector<float> scales(inputs.size(), 1);
-  in_prims.reserve(inputs.size());
+  in_mems.reserve(inputs.size());
   bool pd_same = true;
   std::vector<NDArray> in_bufs(inputs.size());
   for (size_t i = 0; i < inputs.size(); i++) {
@@ -68,11 +133,13 @@ void MKLDNNSumForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
     } else {
       in_mem = inputs[i].GetMKLDNNData();
     }
-    in_prims.push_back(*in_mem);
+    in_mems.push_back(in_mem);
     in_pds[i] = in_mem->get_primitive_desc();
   }
 
-  mkldnn::sum::primitive_desc pdesc(scales, in_pds);
+  // the output is written in the layout the primitive picks for the inputs
+  MKLDNNSumFwd &fwd = GetSumForward(scales, in_mems, in_pds);
+  const mkldnn::sum::primitive_desc &pdesc = fwd.fwd_pd;
   pd_same = pd_same && (pdesc.dst_primitive_desc() == in_pds[0]);
   auto out_mem = const_cast<NDArray&>(out_data).CreateMKLDNNData(pdesc.dst_primitive_desc());
   bool addr_same = false;
@@ -87,14 +154,16 @@ void MKLDNNSumForward(const nnvm::NodeAttrs& attrs, const OpContext &ctx,
       && out_mem) {
     // do sum computation directly on output NDArray
     MKLDNNStream *stream = MKLDNNStream::Get();
-    stream->RegisterPrim(mkldnn::sum(pdesc, in_prims, *out_mem));
+    fwd.SetNewMem(in_mems, *out_mem);
+    stream->RegisterPrim(fwd.GetFwd());
     stream->Submit();
   } else {
     // req == kWriteInplace but cannot be handled by mkldnn and
     // req == kAddTo will run into this branch
     auto mem = CreateMKLDNNMem(out_data, pdesc.dst_primitive_desc(), req);
     MKLDNNStream *stream = MKLDNNStream::Get();
-    stream->RegisterPrim(mkldnn::sum(pdesc, in_prims, *mem.second));
+    fwd.SetNewMem(in_mems, *mem.second);
+    stream->RegisterPrim(fwd.GetFwd());
     CommitOutput(out_data, mem);
     stream->Submit();
   }
@@ -609,6 +609,63 @@ __global__ void unpool_sum_3d_gpu_kernel(const int nthreads, const DType* out_gr
   }
 }
 
+/*!
+ * \brief global pooling gpu kernel, one warp per plane whose lanes read the plane
+ *  coalesced and then reduce their partial results with shuffles.
+ *  Do not call this kernel directly. Use the interface global_pool().
+ */
+template<typename DType, typename AType>
+__global__ void global_pool_gpu_kernel(const int planes, const int plane_size,
+                                       const DType* in_data, const int pool_type,
+                                       DType* out_data) {
+  const int warp = (blockIdx.x * blockDim.x + threadIdx.x) / warpSize;
+  const int lane = threadIdx.x % warpSize;
+  // blocks are whole warps, so a warp either exits or reaches the shuffles at once
+  if (warp >= planes) return;
+  const bool is_max = pool_type == pool_enum::kMaxPooling;
+  const DType* in = in_data + static_cast<index_t>(warp) * plane_size;
+  AType acc = is_max ? static_cast<AType>(mshadow::red::limits::MinValue<DType>()) : AType(0);
+  for (int j = lane; j < plane_size; j += warpSize) {
+    const AType v = static_cast<AType>(in[j]);
+    acc = is_max ? (v > acc ? v : acc) : acc + v;
+  }
+  for (int offset = warpSize / 2; offset > 0; offset /= 2) {
+#if CUDA_VERSION >= 9000
+    const AType other = __shfl_down_sync(0xFFFFFFFF, acc, offset);
+#else
+    const AType other = __shfl_down(acc, offset);
+#endif
+    acc = is_max ? (other > acc ? other : acc) : acc + other;
+  }
+  if (lane == 0) {
+    out_data[warp] = DType(pool_type == pool_enum::kAvgPooling ? acc / plane_size : acc);
+  }
+}
+
+/*!
+ * \brief pooling of whole contiguous planes, i.e. global pooling of NCW, NCHW or
+ *  NCDHW data, with one output per plane.
+ * \param s context stream defining the device in use is gpu
+ * \param in_data pointer of the planes
+ * \param planes number of planes, batch size times channels
+ * \param plane_size elements of each plane
+ * \param pool_type supported pooling type: max, avg, sum
+ * \param out_data pointer of the output, one element per plane
+ */
+template<typename DType>
+inline void global_pool(mshadow::Stream<gpu>* s, const DType* in_data, const index_t planes,
+                        const index_t plane_size, const int pool_type, DType* out_data) {
+  CHECK(pool_type == pool_enum::kMaxPooling || pool_type == pool_enum::kAvgPooling ||
+        pool_type == pool_enum::kSumPooling) << "Unknown pooling type " << pool_type;
+  const int warps_per_block = mshadow::cuda::kBaseThreadNum / 32;
+  const int blocks = (planes + warps_per_block - 1) / warps_per_block;
+  // NOLINT_NEXT_LINE(whitespace/operators)
+  global_pool_gpu_kernel<DType, GlobalPoolAType<DType>><<<blocks, warps_per_block * 32, 0,
+                                                          mshadow::Stream<gpu>::GetStream(s)>>>(
+    planes, plane_size, in_data, pool_type, out_data);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(global_pool_gpu_kernel);
+}
+
 /*!
  * \brief This function serves as an interface for 1/2/3-D pooling operations.
  * \param s context stream defining the device in use is gpu
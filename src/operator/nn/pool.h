@@ -62,6 +62,7 @@
 #include <mxnet/base.h>
 #include <mxnet/operator.h>
 #include <algorithm>
+#include <type_traits>
 #include "../mxnet_op.h"
 
 namespace mxnet {
@@ -637,6 +638,228 @@ inline void unpool_sum_3d_cpu(const DType* out_grad, const TShape& ishape,
   }
 }
 
+/*!
+ * \brief the spatial part of a pooling shape as (depth, height, width), with
+ *  the dimensions 1-D and 2-D pooling lack set to fill
+ * \param shape shape to take the dimensions from
+ * \param offset position of the first spatial dimension in shape
+ * \param fill value of the missing dimensions
+ */
+inline mshadow::Shape<3> PoolSpatialShape(const TShape& shape, int offset, index_t fill) {
+  mshadow::Shape<3> ret = mshadow::Shape3(fill, fill, fill);
+  const int ndim = static_cast<int>(shape.ndim()) - offset;
+  for (int i = 0; i < ndim; ++i) ret[3 - ndim + i] = shape[offset + i];
+  return ret;
+}
+
+/*!
+ * \brief max pooling of one output element that also writes where the maximum
+ *  is, as the offset of the input element in its (depth, height, width) plane,
+ *  or -1 for a window that lies entirely in the padding.
+ *  Do not call this kernel directly. Use the interface pool_max_with_indices().
+ */
+struct pool_max_with_indices_kernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const DType* in_data, DType* out_data,
+                                  int32_t* indices, const mshadow::Shape<3> ishape,
+                                  const mshadow::Shape<3> oshape, const mshadow::Shape<3> kernel,
+                                  const mshadow::Shape<3> pad, const mshadow::Shape<3> stride) {
+    using mshadow::red::limits::MinValue;
+    const int depth = ishape[0], height = ishape[1], width = ishape[2];
+    const int pw = i % oshape[2];
+    const int ph = i / oshape[2] % oshape[1];
+    const int pd = i / (oshape[2] * oshape[1]) % oshape[0];
+    const DType* in = in_data + static_cast<index_t>(i / oshape.Size()) * ishape.Size();
+    int dstart = pd * static_cast<int>(stride[0]) - static_cast<int>(pad[0]);
+    int hstart = ph * static_cast<int>(stride[1]) - static_cast<int>(pad[1]);
+    int wstart = pw * static_cast<int>(stride[2]) - static_cast<int>(pad[2]);
+    const int dend = dstart + static_cast<int>(kernel[0]) < depth ?
+                     dstart + static_cast<int>(kernel[0]) : depth;
+    const int hend = hstart + static_cast<int>(kernel[1]) < height ?
+                     hstart + static_cast<int>(kernel[1]) : height;
+    const int wend = wstart + static_cast<int>(kernel[2]) < width ?
+                     wstart + static_cast<int>(kernel[2]) : width;
+    dstart = dstart > 0 ? dstart : 0;
+    hstart = hstart > 0 ? hstart : 0;
+    wstart = wstart > 0 ? wstart : 0;
+    DType max_val = MinValue<DType>();
+    int max_idx = -1;
+    for (int d = dstart; d < dend; ++d) {
+      for (int h = hstart; h < hend; ++h) {
+        for (int w = wstart; w < wend; ++w) {
+          const int idx = (d * height + h) * width + w;
+          if (max_idx < 0 || in[idx] > max_val) {
+            max_val = in[idx];
+            max_idx = idx;
+          }
+        }
+      }
+    }
+    out_data[i] = max_val;
+    indices[i] = max_idx;
+  }
+};
+
+/*!
+ * \brief adds one plane of pooled values to the positions of the unpooled plane
+ *  given by indices. A plane is done serially because overlapping windows may
+ *  share their maximum.
+ */
+struct unpool_max_with_indices_kernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int plane, const DType* pooled, const int32_t* indices,
+                                  DType* unpooled, const index_t unpooled_size,
+                                  const index_t pooled_size) {
+    const DType* src = pooled + static_cast<index_t>(plane) * pooled_size;
+    const int32_t* idx = indices + static_cast<index_t>(plane) * pooled_size;
+    DType* dst = unpooled + static_cast<index_t>(plane) * unpooled_size;
+    for (index_t j = 0; j < pooled_size; ++j) {
+      if (idx[j] >= 0) dst[idx[j]] += src[j];
+    }
+  }
+};
+
+/*! \brief reads each pooled value from the position of the unpooled plane given by indices */
+template<int req>
+struct gather_max_with_indices_kernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const DType* unpooled, const int32_t* indices,
+                                  DType* pooled, const index_t unpooled_size,
+                                  const index_t pooled_size) {
+    const int32_t idx = indices[i];
+    KERNEL_ASSIGN(pooled[i], req, idx >= 0 ?
+                  unpooled[static_cast<index_t>(i / pooled_size) * unpooled_size + idx] :
+                  DType(0));
+  }
+};
+
+/*!
+ * \brief max pooling for 1/2/3-D images that also outputs the position of each maximum.
+ * \param s context stream
+ * \param in_data pointer of the input tensor data in the format of NCW, NCHW, or NCDHW
+ * \param ishape input tensor shape
+ * \param oshape output tensor shape
+ * \param kernel kernel shape
+ * \param pad pad shape
+ * \param stride stride shape
+ * \param req_type operator request type, only support kWriteTo for now
+ * \param out_data pointer of the output tensor data
+ * \param indices pointer of the int32 positions, of the shape of the output
+ */
+template<typename xpu, typename DType>
+inline void pool_max_with_indices(mshadow::Stream<xpu>* s, const DType* in_data,
+                                  const TShape& ishape, const TShape& oshape,
+                                  const TShape& kernel, const TShape& pad, const TShape& stride,
+                                  OpReqType req_type, DType* out_data, int32_t* indices) {
+  CHECK_EQ(req_type, kWriteTo) << "Only support req=kWriteTo in pooling operations";
+  CHECK_LE(kernel.ndim(), 3U) << "Unsupported " << kernel.ndim() << "-D pooling";
+  mxnet_op::Kernel<pool_max_with_indices_kernel, xpu>::Launch(
+      s, oshape.Size(), in_data, out_data, indices, PoolSpatialShape(ishape, 2, 1),
+      PoolSpatialShape(oshape, 2, 1), PoolSpatialShape(kernel, 0, 1),
+      PoolSpatialShape(pad, 0, 0), PoolSpatialShape(stride, 0, 1));
+}
+
+/*!
+ * \brief scatters pooled values to the positions of their maxima, which is both the
+ *  backward pass of max pooling with indices and the forward pass of unpooling.
+ *  The rest of the unpooled tensor is zero.
+ * \param s context stream
+ * \param pooled pointer of the pooled tensor, or its gradient
+ * \param indices pointer of the int32 positions written by pool_max_with_indices()
+ * \param unpooled_shape shape of the unpooled tensor
+ * \param pooled_shape shape of the pooled tensor
+ * \param req_type operator request type
+ * \param unpooled pointer of the unpooled tensor, or the gradient of the pooling input
+ */
+template<typename xpu, typename DType>
+inline void unpool_max_with_indices(mshadow::Stream<xpu>* s, const DType* pooled,
+                                    const int32_t* indices, const TShape& unpooled_shape,
+                                    const TShape& pooled_shape, OpReqType req_type,
+                                    DType* unpooled) {
+  if (mxnet::kNullOp == req_type) return;
+  if (mxnet::kAddTo != req_type) {
+    mxnet_op::Kernel<mxnet_op::set_zero, xpu>::Launch(s, unpooled_shape.Size(), unpooled);
+  }
+  const index_t planes = pooled_shape[0] * pooled_shape[1];
+  mxnet_op::Kernel<unpool_max_with_indices_kernel, xpu>::Launch(
+      s, planes, pooled, indices, unpooled, unpooled_shape.Size() / planes,
+      pooled_shape.Size() / planes);
+}
+
+/*!
+ * \brief gathers the values at the positions of the maxima, the backward pass of unpooling
+ * \param s context stream
+ * \param unpooled pointer of the gradient of the unpooled tensor
+ * \param indices pointer of the int32 positions written by pool_max_with_indices()
+ * \param unpooled_shape shape of the unpooled tensor
+ * \param pooled_shape shape of the pooled tensor
+ * \param req_type operator request type
+ * \param pooled pointer of the gradient of the pooled tensor
+ */
+template<typename xpu, typename DType>
+inline void gather_max_with_indices(mshadow::Stream<xpu>* s, const DType* unpooled,
+                                    const int32_t* indices, const TShape& unpooled_shape,
+                                    const TShape& pooled_shape, OpReqType req_type,
+                                    DType* pooled) {
+  const index_t planes = pooled_shape[0] * pooled_shape[1];
+  MXNET_ASSIGN_REQ_SWITCH(req_type, req, {
+    mxnet_op::Kernel<gather_max_with_indices_kernel<req>, xpu>::Launch(
+        s, pooled_shape.Size(), unpooled, indices, pooled, unpooled_shape.Size() / planes,
+        pooled_shape.Size() / planes);
+  });
+}
+
+/*! \brief accumulation type of global_pool(), float for half precision */
+template<typename DType>
+using GlobalPoolAType = typename std::conditional<std::is_same<DType, double>::value,
+                                                  double, float>::type;
+
+/*!
+ * \brief pooling of whole contiguous planes, i.e. global pooling of NCW, NCHW or
+ *  NCDHW data, with one output per plane. Each plane is summed with several
+ *  independent accumulators so the additions pipeline.
+ * \param s context stream defining the device in use is cpu
+ * \param in_data pointer of the planes
+ * \param planes number of planes, batch size times channels
+ * \param plane_size elements of each plane
+ * \param pool_type supported pooling type: max, avg, sum
+ * \param out_data pointer of the output, one element per plane
+ */
+template<typename DType>
+inline void global_pool(mshadow::Stream<cpu>* s, const DType* in_data, const index_t planes,
+                        const index_t plane_size, const int pool_type, DType* out_data) {
+  typedef GlobalPoolAType<DType> AType;
+  CHECK(pool_type == pool_enum::kMaxPooling || pool_type == pool_enum::kAvgPooling ||
+        pool_type == pool_enum::kSumPooling) << "Unknown pooling type " << pool_type;
+  const bool is_max = pool_type == pool_enum::kMaxPooling;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(omp_threads)
+  for (index_t p = 0; p < planes; ++p) {
+    const DType* in = in_data + p * plane_size;
+    const index_t n4 = plane_size / 4 * 4;
+    AType acc[4];
+    for (int k = 0; k < 4; ++k) {
+      acc[k] = is_max ? static_cast<AType>(mshadow::red::limits::MinValue<DType>()) : AType(0);
+    }
+    if (is_max) {
+      for (index_t j = 0; j < n4; j += 4) {
+        for (int k = 0; k < 4; ++k) acc[k] = std::max(acc[k], static_cast<AType>(in[j + k]));
+      }
+      for (index_t j = n4; j < plane_size; ++j) {
+        acc[0] = std::max(acc[0], static_cast<AType>(in[j]));
+      }
+      out_data[p] = DType(std::max(std::max(acc[0], acc[1]), std::max(acc[2], acc[3])));
+    } else {
+      for (index_t j = 0; j < n4; j += 4) {
+        for (int k = 0; k < 4; ++k) acc[k] += static_cast<AType>(in[j + k]);
+      }
+      for (index_t j = n4; j < plane_size; ++j) acc[0] += static_cast<AType>(in[j]);
+      const AType sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+      out_data[p] = DType(pool_type == pool_enum::kAvgPooling ? sum / plane_size : sum);
+    }
+  }
+}
+
 /*!
  * \brief This function serves as an interface for 1/2/3-D pooling operations.
  * \param s context stream defining the device in use is cpu
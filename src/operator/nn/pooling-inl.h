@@ -28,6 +28,7 @@
 #define MXNET_OPERATOR_NN_POOLING_INL_H_
 
 #include <dmlc/logging.h>
+#include <dmlc/optional.h>
 #include <dmlc/parameter.h>
 #include <mxnet/operator.h>
 #include <algorithm>
@@ -49,6 +50,8 @@ struct PoolingParam : public dmlc::Parameter<PoolingParam> {
   int pooling_convention;
   bool global_pool;
   bool cudnn_off;
+  dmlc::optional<int> layout;
+  bool return_indices;
   DMLC_DECLARE_PARAMETER(PoolingParam) {
     DMLC_DECLARE_FIELD(kernel).set_default(TShape())  // add default value here
     .enforce_nonzero()
@@ -77,6 +80,35 @@ struct PoolingParam : public dmlc::Parameter<PoolingParam> {
 
     DMLC_DECLARE_FIELD(pad).set_default(TShape())
     .describe("Pad for pooling: (y, x) or (d, y, x). Defaults to no padding.");
+
+    DMLC_DECLARE_FIELD(layout)
+    .add_enum("NCW", mshadow::kNCW)
+    .add_enum("NCHW", mshadow::kNCHW)
+    .add_enum("NCDHW", mshadow::kNCDHW)
+    .add_enum("NWC", mshadow::kNWC)
+    .add_enum("NHWC", mshadow::kNHWC)
+    .add_enum("NDHWC", mshadow::kNDHWC)
+    .set_default(dmlc::optional<int>())
+    .describe("Set layout for input and output. Empty for "
+              "default layout: NCW for 1d, NCHW for 2d and NCDHW for 3d. "
+              "The channels-last layouts are only supported by the cuDNN pooling.");
+
+    DMLC_DECLARE_FIELD(return_indices).set_default(false)
+    .describe("Max pooling only. Also output the int32 position of each maximum within its "
+              "channel of the input, which the backward pass scatters the gradient to "
+              "instead of searching the windows again, and which Unpooling takes.");
+  }
+
+  /*! \brief the layout of an input with ndim dimensions */
+  int GetLayout(int ndim) const {
+    if (layout.has_value()) return layout.value();
+    return ndim == 3 ? mshadow::kNCW : (ndim == 5 ? mshadow::kNCDHW : mshadow::kNCHW);
+  }
+
+  /*! \brief whether the channel is the last axis of an input with ndim dimensions */
+  bool IsChannelLast(int ndim) const {
+    const int l = GetLayout(ndim);
+    return l == mshadow::kNWC || l == mshadow::kNHWC || l == mshadow::kNDHWC;
   }
 
   bool operator==(const PoolingParam& other) const {
@@ -86,7 +118,9 @@ struct PoolingParam : public dmlc::Parameter<PoolingParam> {
            this->pool_type          == other.pool_type &&
            this->pooling_convention == other.pooling_convention &&
            this->global_pool        == other.global_pool &&
-           this->cudnn_off          == other.cudnn_off;
+           this->cudnn_off          == other.cudnn_off &&
+           this->layout             == other.layout &&
+           this->return_indices     == other.return_indices;
   }
 };
 
@@ -105,6 +139,8 @@ struct hash<mxnet::op::PoolingParam> {
     ret = dmlc::HashCombine(ret, val.pooling_convention);
     ret = dmlc::HashCombine(ret, val.global_pool);
     ret = dmlc::HashCombine(ret, val.cudnn_off);
+    ret = dmlc::HashCombine(ret, val.layout.has_value() ? val.layout.value() : -1);
+    ret = dmlc::HashCombine(ret, val.return_indices);
     return ret;
   }
 };
@@ -114,8 +150,8 @@ namespace mxnet {
 namespace op {
 
 /*
- * When MKLDNN is enabled, we might want 2 outputs instead of one inputs, which
- * also changes the number of inputs for backward.
+ * When MKLDNN is enabled or the indices are returned, we might want 2 outputs
+ * instead of one inputs, which also changes the number of inputs for backward.
  */
 int GetNumOutputs(const PoolingParam &param);
 int GetNumBackInputs(const PoolingParam &param);
@@ -132,18 +168,14 @@ class PoolingOp {
     using namespace mshadow;
     Stream<xpu> *s = ctx.get_stream<xpu>();
     const TShape& ishape = in_data.shape_;
-    TShape kernel = param_.kernel;
-    TShape padding = param_.pad;
-    TShape stride = param_.stride;
-    if (param_.global_pool) {
-      kernel = TShape(ishape.data() + 2,
-               ishape.data() + ishape.ndim());
-      padding = TShape(ishape.ndim() - 2);
-      for (index_t i = 0; i < ishape.ndim() - 2; i++) {
-        padding[i] = 0;
-      }
-      stride = TShape(ishape.ndim() - 2);
+    if (param_.global_pool && req == kWriteTo && ishape.ndim() >= 3) {
+      // one reduction per plane instead of a window per output pixel
+      global_pool(s, in_data.dptr<DType>(), ishape[0] * ishape[1],
+                  ishape.ProdShape(2, ishape.ndim()), param_.pool_type, out_data.dptr<DType>());
+      return;
     }
+    TShape kernel, padding, stride;
+    GetWindow(in_data.shape_, &kernel, &padding, &stride);
 
     pool(s, in_data.dptr<DType>(), in_data.shape_, out_data.shape_,
          kernel,
@@ -157,19 +189,8 @@ class PoolingOp {
                 const OpReqType& req, const TBlob& in_grad) {
     using namespace mshadow;
     Stream<xpu> *s = ctx.get_stream<xpu>();
-    const TShape& ishape = in_data.shape_;
-    TShape kernel = param_.kernel;
-    TShape padding = param_.pad;
-    TShape stride = param_.stride;
-    if (param_.global_pool) {
-      kernel = TShape(ishape.data() + 2,
-               ishape.data() + ishape.ndim());
-      padding = TShape(ishape.ndim() - 2);
-      for (index_t i = 0; i < ishape.ndim() - 2; i++) {
-        padding[i] = 0;
-      }
-      stride = TShape(ishape.ndim() - 2);
-    }
+    TShape kernel, padding, stride;
+    GetWindow(in_data.shape_, &kernel, &padding, &stride);
 
     unpool(s, out_grad.dptr<DType>(), in_data.dptr<DType>(), out_data.dptr<DType>(),
            in_grad.shape_, out_grad.shape_,
@@ -179,13 +200,49 @@ class PoolingOp {
            param_.pool_type, req, in_grad.dptr<DType>());
   }
 
+  void ForwardWithIndices(const OpContext& ctx, const TBlob& in_data, const OpReqType& req,
+                          const TBlob& out_data, const TBlob& indices) {
+    TShape kernel, padding, stride;
+    GetWindow(in_data.shape_, &kernel, &padding, &stride);
+    pool_max_with_indices(ctx.get_stream<xpu>(), in_data.dptr<DType>(), in_data.shape_,
+                          out_data.shape_, kernel, padding, stride, req,
+                          out_data.dptr<DType>(), indices.dptr<int32_t>());
+  }
+
+  void BackwardWithIndices(const OpContext& ctx, const TBlob& out_grad, const TBlob& indices,
+                           const OpReqType& req, const TBlob& in_grad) {
+    unpool_max_with_indices(ctx.get_stream<xpu>(), out_grad.dptr<DType>(),
+                            indices.dptr<int32_t>(), in_grad.shape_, out_grad.shape_, req,
+                            in_grad.dptr<DType>());
+  }
+
  private:
+  /*! \brief the kernel, padding and stride of the pooling windows of an input */
+  void GetWindow(const TShape& ishape, TShape* kernel, TShape* padding, TShape* stride) const {
+    *kernel = param_.kernel;
+    *padding = param_.pad;
+    *stride = param_.stride;
+    if (param_.global_pool) {
+      *kernel = TShape(ishape.data() + 2,
+               ishape.data() + ishape.ndim());
+      *padding = TShape(ishape.ndim() - 2);
+      for (index_t i = 0; i < ishape.ndim() - 2; i++) {
+        (*padding)[i] = 0;
+      }
+      *stride = TShape(ishape.ndim() - 2);
+    }
+  }
+
   PoolingParam param_;
 };  // class PoolingOp
 
 template<typename xpu, typename DType>
 PoolingOp<xpu, DType> &GetPoolingOp(const PoolingParam &param) {
   static thread_local PoolingOp<xpu, DType> op;
+  CHECK(!param.IsChannelLast(param.kernel.ndim() + 2))
+      << "Pooling: the channels-last layouts need the cuDNN pooling";
+  CHECK(!param.return_indices || param.pool_type == pool_enum::kMaxPooling)
+      << "Pooling: return_indices is only supported by max pooling";
   // check if filter size assigned correctly
   if (param.global_pool == false) {
     CHECK_GT(param.kernel.ndim(), 0U)
@@ -205,7 +262,10 @@ void PoolingCompute(const nnvm::NodeAttrs& attrs,
   CHECK_EQ(inputs.size(), 1U);
   CHECK_EQ(outputs.size(), GetNumOutputs(param));
   MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
-    if (pool_enum::kMaxPooling == param.pool_type
+    if (param.return_indices) {
+      GetPoolingOp<xpu, DType>(param).ForwardWithIndices(ctx, inputs[0], req[0], outputs[0],
+                                                         outputs[1]);
+    } else if (pool_enum::kMaxPooling == param.pool_type
         || pool_enum::kAvgPooling == param.pool_type
         || pool_enum::kSumPooling == param.pool_type) {
       GetPoolingOp<xpu, DType>(param).Forward(ctx, inputs[0], req[0], outputs[0]);
@@ -226,7 +286,8 @@ void PoolingGradCompute(const nnvm::NodeAttrs& attrs,
   CHECK_EQ(outputs.size(), 1U);
   CHECK_EQ(req.size(), 1U);
   off_t ograd_idx, in_data_idx, out_data_idx;
-  // When MKLDNN is enabled, the input data may contains arrays for workspace.
+  // When MKLDNN is enabled or indices are returned, the input data contains the
+  // gradient and the value of the second output.
   if (GetNumBackInputs(param) == 5) {
     ograd_idx = 0;
     in_data_idx = 2;
@@ -237,7 +298,10 @@ void PoolingGradCompute(const nnvm::NodeAttrs& attrs,
     out_data_idx = 2;
   }
   MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
-    if (pool_enum::kMaxPooling == param.pool_type
+    if (param.return_indices) {
+      GetPoolingOp<xpu, DType>(param).BackwardWithIndices(ctx, inputs[ograd_idx], inputs[4],
+                                                          req[0], outputs[0]);
+    } else if (pool_enum::kMaxPooling == param.pool_type
         || pool_enum::kAvgPooling == param.pool_type
         || pool_enum::kSumPooling == param.pool_type) {
       GetPoolingOp<xpu, DType>(param).Backward(ctx, inputs[ograd_idx],
@@ -249,6 +313,62 @@ void PoolingGradCompute(const nnvm::NodeAttrs& attrs,
   });
 }
 
+struct UnpoolingParam : public dmlc::Parameter<UnpoolingParam> {
+  TShape kernel;
+  TShape stride;
+  TShape pad;
+  TShape target_shape;
+  DMLC_DECLARE_PARAMETER(UnpoolingParam) {
+    DMLC_DECLARE_FIELD(kernel).set_default(TShape())
+    .describe("Kernel of the pooling that returned the indices: (y, x) or (d, y, x)");
+    DMLC_DECLARE_FIELD(stride).set_default(TShape())
+    .describe("Stride of the pooling. Defaults to the kernel.");
+    DMLC_DECLARE_FIELD(pad).set_default(TShape())
+    .describe("Pad of the pooling. Defaults to no padding.");
+    DMLC_DECLARE_FIELD(target_shape).set_default(TShape())
+    .describe("Spatial shape of the output, the input of the pooling. Defaults to "
+              "(in - 1) * stride - 2 * pad + kernel in each dimension.");
+  }
+};
+
+template<typename xpu>
+void UnpoolingCompute(const nnvm::NodeAttrs& attrs,
+                      const OpContext& ctx,
+                      const std::vector<TBlob>& inputs,
+                      const std::vector<OpReqType>& req,
+                      const std::vector<TBlob>& outputs) {
+  CHECK_EQ(inputs.size(), 2U);
+  CHECK_EQ(outputs.size(), 1U);
+  MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
+    unpool_max_with_indices(ctx.get_stream<xpu>(), inputs[0].dptr<DType>(),
+                            inputs[1].dptr<int32_t>(), outputs[0].shape_, inputs[0].shape_,
+                            req[0], outputs[0].dptr<DType>());
+  });
+}
+
+template<typename xpu>
+void UnpoolingGradCompute(const nnvm::NodeAttrs& attrs,
+                          const OpContext& ctx,
+                          const std::vector<TBlob>& inputs,
+                          const std::vector<OpReqType>& req,
+                          const std::vector<TBlob>& outputs) {
+  using namespace mshadow;
+  // inputs are the output gradient and the indices
+  CHECK_EQ(inputs.size(), 2U);
+  CHECK_EQ(outputs.size(), 2U);
+  Stream<xpu> *s = ctx.get_stream<xpu>();
+  MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
+    gather_max_with_indices(s, inputs[0].dptr<DType>(), inputs[1].dptr<int32_t>(),
+                            inputs[0].shape_, outputs[0].shape_, req[0],
+                            outputs[0].dptr<DType>());
+  });
+  // the indices are integers without gradient
+  if (req[1] != kNullOp && req[1] != kAddTo) {
+    mxnet_op::Kernel<mxnet_op::set_zero, xpu>::Launch(s, outputs[1].Size(),
+                                                     outputs[1].dptr<int32_t>());
+  }
+}
+
 }  // namespace op
 }  // namespace mxnet
 
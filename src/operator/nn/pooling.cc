@@ -54,10 +54,13 @@ static void PoolingParamParser(nnvm::NodeAttrs *attrs) {
     if (param.stride.ndim() == 0) param.stride = Shape3(1, 1, 1);
     if (param.pad.ndim() == 0) param.pad = Shape3(0, 0, 0);
   }
+  CHECK(!param.return_indices || param.pool_type == pool_enum::kMaxPooling)
+      << "Pooling: return_indices is only supported by max pooling";
   attrs->parsed = std::move(param);
 }
 
 int GetNumOutputs(const PoolingParam &param) {
+  if (param.return_indices) return 2;
 #if MXNET_USE_MKLDNN == 1
   return MKLDNNRequireWorkspace(param) && SupportMKLDNNPooling(param) ? 2 : 1;
 #else
@@ -66,6 +69,7 @@ int GetNumOutputs(const PoolingParam &param) {
 }
 
 int GetNumBackInputs(const PoolingParam &param) {
+  if (param.return_indices) return 5;
 #if MXNET_USE_MKLDNN == 1
   return MKLDNNRequireWorkspace(param) && SupportMKLDNNPooling(param) ? 5 : 3;
 #else
@@ -77,8 +81,12 @@ static bool PoolingType(const nnvm::NodeAttrs& attrs,
                         std::vector<int> *in_attrs,
                         std::vector<int> *out_attrs) {
   out_attrs->at(0) = in_attrs->at(0);
-#if MXNET_USE_MKLDNN == 1
   const PoolingParam &param = nnvm::get<PoolingParam>(attrs.parsed);
+  if (param.return_indices) {
+    CHECK_EQ(out_attrs->size(), 2U);
+    out_attrs->at(1) = mshadow::kInt32;
+  }
+#if MXNET_USE_MKLDNN == 1
   if (MKLDNNRequireWorkspace(param) && SupportMKLDNNPooling(param)) {
     CHECK_GT(out_attrs->size(), 1U);
     out_attrs->at(1) = mshadow::kInt32;
@@ -87,11 +95,9 @@ static bool PoolingType(const nnvm::NodeAttrs& attrs,
   return true;
 }
 
-static bool PoolingShape(const nnvm::NodeAttrs &attrs,
-                         std::vector<TShape> *in_shape,
-                         std::vector<TShape> *out_shape) {
-  const PoolingParam &param = nnvm::get<PoolingParam>(attrs.parsed);
-  CHECK_EQ(in_shape->size(), 1U);
+static bool PoolingShapeChannelFirst(const PoolingParam &param,
+                                     std::vector<TShape> *in_shape,
+                                     std::vector<TShape> *out_shape) {
   const TShape &dshape = (*in_shape)[0];
   CHECK_GE(dshape.ndim(), 3U)
       << "Pooling: Input data should be  3D in (batch, channel, x)"
@@ -213,6 +219,39 @@ static bool PoolingShape(const nnvm::NodeAttrs &attrs,
   return true;
 }
 
+static bool PoolingShape(const nnvm::NodeAttrs &attrs,
+                         std::vector<TShape> *in_shape,
+                         std::vector<TShape> *out_shape) {
+  const PoolingParam &param = nnvm::get<PoolingParam>(attrs.parsed);
+  CHECK_EQ(in_shape->size(), 1U);
+  const TShape &dshape = (*in_shape)[0];
+  if (dshape.ndim() == 0 || !param.IsChannelLast(dshape.ndim())) {
+    if (!PoolingShapeChannelFirst(param, in_shape, out_shape)) return false;
+    // the indices have the shape of the output
+    if (param.return_indices) out_shape->push_back((*out_shape)[0]);
+    return true;
+  }
+  CHECK(!param.return_indices)
+      << "Pooling: return_indices is not supported by the channels-last layouts";
+  // infer on the channel-first view of a channels-last input, then move the
+  // channel axis of the outputs back to the end
+  const int ndim = dshape.ndim();
+  TShape cshape(ndim);
+  cshape[0] = dshape[0];
+  cshape[1] = dshape[ndim - 1];
+  for (int i = 2; i < ndim; ++i) cshape[i] = dshape[i - 1];
+  std::vector<TShape> cin_shape{cshape};
+  if (!PoolingShapeChannelFirst(param, &cin_shape, out_shape)) return false;
+  for (TShape &oshape : *out_shape) {
+    TShape lshape(ndim);
+    lshape[0] = oshape[0];
+    for (int i = 2; i < ndim; ++i) lshape[i - 1] = oshape[i];
+    lshape[ndim - 1] = oshape[1];
+    oshape = lshape;
+  }
+  return true;
+}
+
 #if MXNET_USE_MKLDNN == 1
 void PoolingComputeExCPU(const nnvm::NodeAttrs &attrs, const OpContext &ctx,
                          const std::vector<NDArray> &inputs,
@@ -273,15 +312,14 @@ inline static bool PoolingStorageType(const nnvm::NodeAttrs &attrs,
                                       std::vector<int> *in_attrs,
                                       std::vector<int> *out_attrs) {
   CHECK_EQ(in_attrs->size(), 1);
+  const PoolingParam &param = nnvm::get<PoolingParam>(attrs.parsed);
+  CHECK_EQ(out_attrs->size(), GetNumOutputs(param));
 
 #if MXNET_USE_MKLDNN == 1
-  const PoolingParam &param = nnvm::get<PoolingParam>(attrs.parsed);
   if (dev_mask == mshadow::cpu::kDevMask && SupportMKLDNNPooling(param)) {
     return storage_type_assign(out_attrs, mxnet::kDefaultStorage,
                                dispatch_mode, DispatchMode::kFComputeEx);
   }
-#else
-  CHECK_EQ(out_attrs->size(), 1);
 #endif
   return storage_type_assign(out_attrs, mxnet::kDefaultStorage,
                              dispatch_mode, DispatchMode::kFCompute);
@@ -301,8 +339,6 @@ inline static bool BackwardPoolingStorageType(const nnvm::NodeAttrs &attrs,
     return storage_type_assign(out_attrs, mxnet::kDefaultStorage,
                                dispatch_mode, DispatchMode::kFComputeEx);
   }
-#else
-  CHECK_EQ(in_attrs->size(), 3);
 #endif
   return storage_type_assign(out_attrs, mxnet::kDefaultStorage,
                              dispatch_mode, DispatchMode::kFCompute);
@@ -355,10 +391,11 @@ height, width)*.
   const PoolingParam &param = nnvm::get<PoolingParam>(attrs.parsed);
   return GetNumOutputs(param);
 })
-#if MXNET_USE_MKLDNN == 1
 .set_attr<nnvm::FNumVisibleOutputs>("FNumVisibleOutputs",
-                                    [](const NodeAttrs& attrs) { return 1; })
-#endif
+    [](const NodeAttrs& attrs) {
+  const PoolingParam &param = nnvm::get<PoolingParam>(attrs.parsed);
+  return param.return_indices ? 2 : 1;
+})
 .set_attr<nnvm::FListInputNames>("FListInputNames",
     [](const NodeAttrs& attrs) {
   return std::vector<std::string>{"data"};
@@ -366,7 +403,9 @@ height, width)*.
 .set_attr<nnvm::FListOutputNames>("FListOutputNames",
     [](const NodeAttrs& attrs) {
   const PoolingParam &param = nnvm::get<PoolingParam>(attrs.parsed);
-  if (GetNumOutputs(param) == 2)
+  if (param.return_indices)
+    return std::vector<std::string>{"output", "indices"};
+  else if (GetNumOutputs(param) == 2)
     return std::vector<std::string>{"output", "workspace"};
   else
     return std::vector<std::string>{"output"};
@@ -394,6 +433,10 @@ NNVM_REGISTER_OP(_backward_Pooling)
 #if MXNET_USE_CUDNN == 1
   return std::vector<std::pair<int, int> >();
 #else
+  // the second input is the gradient of the indices
+  if (nnvm::get<PoolingParam>(attrs.parsed).return_indices) {
+    return std::vector<std::pair<int, int> >();
+  }
   return std::vector<std::pair<int, int> >{{1, 0}};
 #endif
 })
@@ -410,5 +453,82 @@ NNVM_REGISTER_OP(_backward_Pooling)
 #endif
 .set_attr<FCompute>("FCompute<cpu>", PoolingGradCompute<cpu>);
 
+static bool UnpoolingShape(const nnvm::NodeAttrs &attrs,
+                           std::vector<TShape> *in_shape,
+                           std::vector<TShape> *out_shape) {
+  const UnpoolingParam &param = nnvm::get<UnpoolingParam>(attrs.parsed);
+  CHECK_EQ(in_shape->size(), 2U);
+  const TShape &dshape = (*in_shape)[0];
+  if (dshape.ndim() == 0) return false;
+  SHAPE_ASSIGN_CHECK(*in_shape, 1, dshape);
+  const index_t nspatial = dshape.ndim() - 2;
+  CHECK(nspatial >= 1 && nspatial <= 3)
+      << "Unpooling: Input data should be 3D, 4D or 5D in (batch, channel, ...)";
+  TShape oshape = dshape;
+  if (param.target_shape.ndim() != 0) {
+    CHECK_EQ(param.target_shape.ndim(), nspatial)
+        << "Unpooling: target_shape should have one value per spatial dimension";
+    for (index_t i = 0; i < nspatial; ++i) oshape[i + 2] = param.target_shape[i];
+  } else {
+    CHECK_EQ(param.kernel.ndim(), nspatial)
+        << "Unpooling: kernel or target_shape should have one value per spatial dimension";
+    for (index_t i = 0; i < nspatial; ++i) {
+      const index_t stride = param.stride.ndim() ? param.stride[i] : param.kernel[i];
+      const index_t pad = param.pad.ndim() ? param.pad[i] : 0;
+      oshape[i + 2] = (dshape[i + 2] - 1) * stride - 2 * pad + param.kernel[i];
+    }
+  }
+  SHAPE_ASSIGN_CHECK(*out_shape, 0, oshape);
+  return true;
+}
+
+static bool UnpoolingType(const nnvm::NodeAttrs& attrs,
+                          std::vector<int> *in_attrs,
+                          std::vector<int> *out_attrs) {
+  CHECK_EQ(in_attrs->size(), 2U);
+  TYPE_ASSIGN_CHECK(*in_attrs, 1, mshadow::kInt32);
+  TYPE_ASSIGN_CHECK(*out_attrs, 0, in_attrs->at(0));
+  TYPE_ASSIGN_CHECK(*in_attrs, 0, out_attrs->at(0));
+  return in_attrs->at(0) != -1;
+}
+
+DMLC_REGISTER_PARAMETER(UnpoolingParam);
+
+NNVM_REGISTER_OP(Unpooling)
+.describe(R"code(Places each value of the input at the position of the maximum it was
+pooled from, given by the ``indices`` output of max ``Pooling`` with
+``return_indices=True``, and zeros elsewhere.
+
+The output has the shape of the pooling input, which is computed from ``kernel``,
+``stride`` and ``pad`` or given by ``target_shape``. Used by decoders that upsample
+with the locations of the maxima, as in SegNet.
+
+)code" ADD_FILELINE)
+.set_num_inputs(2)
+.set_num_outputs(1)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+    [](const NodeAttrs& attrs) {
+  return std::vector<std::string>{"data", "indices"};
+})
+.set_attr_parser(ParamParser<UnpoolingParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", UnpoolingShape)
+.set_attr<nnvm::FInferType>("FInferType", UnpoolingType)
+.set_attr<FCompute>("FCompute<cpu>", UnpoolingCompute<cpu>)
+.set_attr<nnvm::FGradient>("FGradient",
+    [](const nnvm::NodePtr& n, const std::vector<nnvm::NodeEntry>& ograds) {
+  std::vector<nnvm::NodeEntry> heads{ograds[0], n->inputs[1]};
+  return MakeGradNode("_backward_Unpooling", n, heads, n->attrs.dict);
+})
+.add_argument("data", "NDArray-or-Symbol", "Values to place, the output of the pooling.")
+.add_argument("indices", "NDArray-or-Symbol", "Indices returned by the pooling.")
+.add_arguments(UnpoolingParam::__FIELDS__());
+
+NNVM_REGISTER_OP(_backward_Unpooling)
+.set_num_inputs(2)
+.set_num_outputs(2)
+.set_attr<nnvm::TIsBackward>("TIsBackward", true)
+.set_attr_parser(ParamParser<UnpoolingParam>)
+.set_attr<FCompute>("FCompute<cpu>", UnpoolingGradCompute<cpu>);
+
 }  // namespace op
 }  // namespace mxnet
@@ -56,7 +56,7 @@ void PoolingCompute<gpu>(const nnvm::NodeAttrs& attrs,
   CHECK_EQ(outputs.size(), GetNumOutputs(param));
 
 #if MXNET_USE_CUDNN == 1
-  if (!param.cudnn_off && param.kernel.ndim() > 1) {
+  if (!param.cudnn_off && !param.return_indices && param.kernel.ndim() > 1) {
     MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
       switch (param.pool_type) {
         case pool_enum::kMaxPooling:
@@ -72,7 +72,10 @@ void PoolingCompute<gpu>(const nnvm::NodeAttrs& attrs,
 #endif  // MXNET_USE_CUDNN
 
   MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
-    if (pool_enum::kMaxPooling == param.pool_type
+    if (param.return_indices) {
+      GetPoolingOp<gpu, DType>(param).ForwardWithIndices(ctx, inputs[0], req[0], outputs[0],
+                                                         outputs[1]);
+    } else if (pool_enum::kMaxPooling == param.pool_type
         || pool_enum::kAvgPooling == param.pool_type
         || pool_enum::kSumPooling == param.pool_type) {
       GetPoolingOp<gpu, DType>(param).Forward(ctx, inputs[0], req[0], outputs[0]);
@@ -93,7 +96,8 @@ void PoolingGradCompute<gpu>(const nnvm::NodeAttrs& attrs,
   CHECK_EQ(outputs.size(), 1U);
   CHECK_EQ(req.size(), 1U);
   off_t ograd_idx, in_data_idx, out_data_idx;
-  // When MKLDNN is enabled, the input data may contains arrays for workspace.
+  // When MKLDNN is enabled or indices are returned, the input data contains the
+  // gradient and the value of the second output.
   if (GetNumBackInputs(param) == 5) {
     ograd_idx = 0;
     in_data_idx = 2;
@@ -105,7 +109,7 @@ void PoolingGradCompute<gpu>(const nnvm::NodeAttrs& attrs,
   }
 
 #if MXNET_USE_CUDNN == 1
-  if (!param.cudnn_off && param.kernel.ndim() > 1) {
+  if (!param.cudnn_off && !param.return_indices && param.kernel.ndim() > 1) {
     MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
       switch (param.pool_type) {
         case pool_enum::kMaxPooling:
@@ -123,7 +127,10 @@ void PoolingGradCompute<gpu>(const nnvm::NodeAttrs& attrs,
 #endif  // MXNET_USE_CUDNN
 
   MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
-    if (pool_enum::kMaxPooling == param.pool_type
+    if (param.return_indices) {
+      GetPoolingOp<gpu, DType>(param).BackwardWithIndices(ctx, inputs[ograd_idx], inputs[4],
+                                                          req[0], outputs[0]);
+    } else if (pool_enum::kMaxPooling == param.pool_type
         || pool_enum::kAvgPooling == param.pool_type
         || pool_enum::kSumPooling == param.pool_type) {
       GetPoolingOp<gpu, DType>(param).Backward(ctx, inputs[ograd_idx],
@@ -141,5 +148,11 @@ NNVM_REGISTER_OP(Pooling)
 NNVM_REGISTER_OP(_backward_Pooling)
 .set_attr<FCompute>("FCompute<gpu>", PoolingGradCompute<gpu>);
 
+NNVM_REGISTER_OP(Unpooling)
+.set_attr<FCompute>("FCompute<gpu>", UnpoolingCompute<gpu>);
+
+NNVM_REGISTER_OP(_backward_Unpooling)
+.set_attr<FCompute>("FCompute<gpu>", UnpoolingGradCompute<gpu>);
+
 }  // namespace op
 }  // namespace mxnet
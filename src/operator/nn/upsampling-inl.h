@@ -35,6 +35,7 @@
 #include <string>
 #include <utility>
 #include "../operator_common.h"
+#include "../../engine/openmp.h"
 #include "./deconvolution-inl.h"
 
 namespace mxnet {
@@ -82,6 +83,110 @@ struct UpSamplingParam : public dmlc::Parameter<UpSamplingParam> {
   }
 };  // struct UpSamplingParam
 
+/*!
+ * \brief channels [begin, begin + data.size(1)) of out (+)= data upsampled by
+ *  an integer scale. A row of data is expanded once and copied to the scale
+ *  output rows it covers, the channels run in parallel.
+ */
+template<typename DType>
+inline void UpSamplingNearestForwardImpl(mshadow::Stream<cpu> *s,
+                                         const mshadow::Tensor<cpu, 4, DType> &data,
+                                         int scale, index_t begin, OpReqType req,
+                                         const mshadow::Tensor<cpu, 4, DType> &out) {
+  const index_t channels = data.size(1);
+  const index_t height = data.size(2);
+  const index_t width = data.size(3);
+  const index_t owidth = out.size(3);
+  const index_t osize = out.size(2) * owidth;
+  const int nplanes = data.size(0) * channels;
+  #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int plane = 0; plane < nplanes; ++plane) {
+    const index_t n = plane / channels;
+    const DType *iplane = data.dptr_ + plane * height * width;
+    DType *oplane = out.dptr_ + (n * out.size(1) + begin + plane % channels) * osize;
+    for (index_t y = 0; y < height; ++y) {
+      const DType *irow = iplane + y * width;
+      DType *orow = oplane + y * scale * owidth;
+      if (req == kAddTo) {
+        for (int dy = 0; dy < scale; ++dy, orow += owidth) {
+          for (index_t x = 0; x < owidth; ++x) orow[x] += irow[x / scale];
+        }
+        continue;
+      }
+      if (scale == 2) {
+        for (index_t x = 0; x < width; ++x) orow[2 * x] = orow[2 * x + 1] = irow[x];
+      } else {
+        for (index_t x = 0; x < width; ++x) std::fill_n(orow + x * scale, scale, irow[x]);
+      }
+      for (int dy = 1; dy < scale; ++dy) std::copy(orow, orow + owidth, orow + dy * owidth);
+    }
+  }
+}
+
+template<typename DType>
+inline void UpSamplingNearestForwardImpl(mshadow::Stream<gpu> *s,
+                                         const mshadow::Tensor<gpu, 4, DType> &data,
+                                         int scale, index_t begin, OpReqType req,
+                                         const mshadow::Tensor<gpu, 4, DType> &out) {
+  using namespace mshadow::expr;
+  Assign(slice<1>(out, begin, begin + data.size(1)), req, upsampling_nearest(data, scale));
+}
+
+/*!
+ * \brief input_grad (+)= the sums of the scale x scale blocks of channels
+ *  [begin, begin + input_grad.size(1)) of grad. The scale rows of a block are
+ *  added up first, then the groups of scale columns.
+ */
+template<typename DType>
+inline void UpSamplingNearestBackwardImpl(mshadow::Stream<cpu> *s,
+                                          const mshadow::Tensor<cpu, 4, DType> &grad,
+                                          int scale, index_t begin, OpReqType req,
+                                          const mshadow::Tensor<cpu, 4, DType> &input_grad) {
+  if (req == kNullOp) return;
+  const index_t channels = input_grad.size(1);
+  const index_t height = input_grad.size(2);
+  const index_t width = input_grad.size(3);
+  const index_t owidth = grad.size(3);
+  const index_t osize = grad.size(2) * owidth;
+  const int nplanes = input_grad.size(0) * channels;
+  #pragma omp parallel num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  {
+    std::vector<DType> rows(owidth);
+    #pragma omp for
+    for (int plane = 0; plane < nplanes; ++plane) {
+      const index_t n = plane / channels;
+      const DType *gplane = grad.dptr_ + (n * grad.size(1) + begin + plane % channels) * osize;
+      DType *iplane = input_grad.dptr_ + plane * height * width;
+      for (index_t y = 0; y < height; ++y) {
+        const DType *grow = gplane + y * scale * owidth;
+        std::copy(grow, grow + owidth, rows.begin());
+        for (int dy = 1; dy < scale; ++dy) {
+          grow += owidth;
+          for (index_t x = 0; x < owidth; ++x) rows[x] += grow[x];
+        }
+        DType *irow = iplane + y * width;
+        for (index_t x = 0; x < width; ++x) {
+          DType sum = rows[x * scale];
+          for (int dx = 1; dx < scale; ++dx) sum += rows[x * scale + dx];
+          irow[x] = req == kAddTo ? irow[x] + sum : sum;
+        }
+      }
+    }
+  }
+}
+
+template<typename DType>
+inline void UpSamplingNearestBackwardImpl(mshadow::Stream<gpu> *s,
+                                          const mshadow::Tensor<gpu, 4, DType> &grad,
+                                          int scale, index_t begin, OpReqType req,
+                                          const mshadow::Tensor<gpu, 4, DType> &input_grad) {
+  using namespace mshadow::expr;
+  mshadow::Shape<2> in_shape = mshadow::Shape2(input_grad.shape_[2], input_grad.shape_[3]);
+  Assign(input_grad, req,
+         pool<mshadow::red::sum>(slice<1>(grad, begin, begin + input_grad.size(1)),
+                                 in_shape, scale, scale, scale, scale));
+}
+
 template<typename xpu, typename DType>
 void UpSamplingForward(const OpContext &ctx, const UpSamplingParam &param,
                        const std::vector<TBlob> &in_data,
@@ -100,22 +205,18 @@ void UpSamplingForward(const OpContext &ctx, const UpSamplingParam &param,
     int begin = 0;
     for (int i = 0; i < param.num_args; ++i) {
       Tensor<xpu, 4, DType> data = in_data[i].get<xpu, 4, DType>(s);
-      int end = begin + data.size(1);
       int scale = out_data[up_enum::kOut].size(2)/in_data[i].size(2);
       if (param.multi_input_mode == up_enum::kSum) {
-        if (i == 0) {
-          Assign(out, req[up_enum::kOut], upsampling_nearest(data, scale));
-        } else {
-          out += upsampling_nearest(data, scale);
-        }
+        UpSamplingNearestForwardImpl(s, data, scale, 0, i == 0 ? req[up_enum::kOut] : kAddTo,
+                                     out);
       } else {
-        Assign(slice<1>(out, begin, end), req[up_enum::kOut], upsampling_nearest(data, scale));
+        UpSamplingNearestForwardImpl(s, data, scale, begin, req[up_enum::kOut], out);
+        begin += data.size(1);
       }
-      begin = end;
     }
   } else {
     Tensor<xpu, 4, DType> data = in_data[up_enum::kData].get<xpu, 4, DType>(s);
-    Assign(out, req[up_enum::kOut], upsampling_nearest(data, param.scale));
+    UpSamplingNearestForwardImpl(s, data, param.scale, 0, req[up_enum::kOut], out);
   }
 }
 
@@ -132,38 +233,17 @@ void UpSamplingBackward(const OpContext &ctx, const UpSamplingParam &param,
     int begin = 0;
     for (int i = 0; i < param.num_args; ++i) {
       Tensor<xpu, 4, DType> input_grad = in_grad[i].get<xpu, 4, DType>(s);
-      mshadow::Shape<2> in_shape = Shape2(input_grad.shape_[2], input_grad.shape_[3]);
-      int end = begin + input_grad.size(1);
-      int scale = grad.size(2)/in_shape[0];
+      int scale = grad.size(2)/input_grad.size(2);
       if (param.multi_input_mode == up_enum::kSum) {
-        Assign(input_grad, req[i],
-               pool<mshadow::red::sum>(grad,
-                                       in_shape,
-                                       scale,
-                                       scale,
-                                       scale,
-                                       scale));
+        UpSamplingNearestBackwardImpl(s, grad, scale, 0, req[i], input_grad);
       } else {
-        Assign(input_grad, req[i],
-               pool<mshadow::red::sum>(slice<1>(grad, begin, end),
-                                       in_shape,
-                                       scale,
-                                       scale,
-                                       scale,
-                                       scale));
+        UpSamplingNearestBackwardImpl(s, grad, scale, begin, req[i], input_grad);
+        begin += input_grad.size(1);
       }
-      begin = end;
     }
   } else {
     Tensor<xpu, 4, DType> input_grad = in_grad[up_enum::kData].get<xpu, 4, DType>(s);
-    mshadow::Shape<2> in_shape = Shape2(input_grad.shape_[2], input_grad.shape_[3]);
-    Assign(input_grad, req[up_enum::kData],
-           pool<mshadow::red::sum>(grad,
-                                   in_shape,
-                                   param.scale,
-                                   param.scale,
-                                   param.scale,
-                                   param.scale));
+    UpSamplingNearestBackwardImpl(s, grad, param.scale, 0, req[up_enum::kData], input_grad);
   }
 }
 
@@ -25,6 +25,10 @@
 #include <atomic>
 #include <cstdint>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
 #include <thread>
 #include <string>
 #include <vector>
@@ -78,6 +82,111 @@ inline const char *TuningModeToString(const TuningMode tm) {
       return "<unknown>";
   }
 }
+
+/*!
+ * \brief A kernel operator scheduled for tuning
+ */
+struct TuneEntry {
+  /*! \brief Name of the tuned_op, which includes the data type */
+  std::string name;
+  /*! \brief Function timing the operator */
+  void (*tune)();
+  /*! \brief Workload the function sets */
+  std::vector<float> *workload;
+};
+
+/*!
+ * \brief Tuning results kept in the file named by MXNET_TUNING_DATA_FILE, so that later runs
+ *        on the same CPU load them instead of timing every kernel operator at startup.
+ *        The first line names the CPU, the others hold a name and its values, tab separated.
+ */
+class TuningData {
+ public:
+  static TuningData *Get() {
+    static TuningData inst;
+    return &inst;
+  }
+
+  /*! \brief Whether a file is used */
+  bool enabled() const {
+    return !path_.empty();
+  }
+
+  /*!
+   * \brief Get the values loaded for a name
+   * \return Pointer to the values, nullptr if the file has none for this name
+   */
+  const std::vector<float> *Find(const std::string& name) const {
+    auto it = table_.find(name);
+    return it != table_.end() ? &it->second : nullptr;
+  }
+
+  void Set(const std::string& name, const std::vector<float>& values) {
+    table_[name] = values;
+  }
+
+  /*! \brief Write all values to the file, replacing it */
+  void Save() const {
+    const std::string tmp = path_ + ".tmp";
+    {
+      std::ofstream os(tmp);
+      if (!os) {
+        LOG(WARNING) << "Cannot write tuning data to " << path_;
+        return;
+      }
+      os << "cpu\t" << CPUName() << "\n";
+      os.precision(9);
+      for (const auto& kv : table_) {
+        os << kv.first << "\t";
+        for (size_t i = 0; i < kv.second.size(); ++i) os << (i ? " " : "") << kv.second[i];
+        os << "\n";
+      }
+    }
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+      LOG(WARNING) << "Cannot write tuning data to " << path_;
+      std::remove(tmp.c_str());
+    }
+  }
+
+ private:
+  TuningData() : path_(dmlc::GetEnv("MXNET_TUNING_DATA_FILE", std::string())) {
+    if (path_.empty()) return;
+    std::ifstream is(path_);
+    std::string line;
+    if (!is || !std::getline(is, line)) return;
+    if (line != "cpu\t" + CPUName()) {
+      LOG(INFO) << "Tuning data of " << path_ << " was made on another CPU, tuning again";
+      return;
+    }
+    while (std::getline(is, line)) {
+      const size_t tab = line.find('\t');
+      if (tab == std::string::npos) continue;
+      std::istringstream values(line.substr(tab + 1));
+      std::vector<float>& dst = table_[line.substr(0, tab)];
+      float v;
+      while (values >> v) dst.push_back(v);
+    }
+  }
+
+  /*! \brief CPU model and number of cores, which the tuning results depend on */
+  static std::string CPUName() {
+    std::string model = "unknown";
+    std::ifstream is("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(is, line)) {
+      if (line.compare(0, 10, "model name") != 0) continue;
+      const size_t colon = line.find(':');
+      if (colon != std::string::npos) model = line.substr(colon + 2);
+      break;
+    }
+    return model + " x" + std::to_string(omp_get_num_procs());
+  }
+
+  /*! \brief File name, empty if none */
+  std::string path_;
+  /*! \brief Values by name, ordered to keep the file stable */
+  std::map<std::string, std::vector<float> > table_;
+};
 }  // namespace tune
 
 /*!
@@ -165,7 +274,15 @@ class OperatorTune : public OperatorTuneByType<DType> {
         // Not especially concerned with a race condition, since this hsould
         // run when only one thread is active (static init), just don't cache this variable
         OperatorTuneBase::calculated_.store(true);
-        OperatorTuneBase::omp_overhead_ns_ = GetOMPLoopOverhead();
+        tune::TuningData *data = tune::TuningData::Get();
+        const std::vector<float> *overhead = data->Find("omp_overhead_ns");
+        if (overhead != nullptr && overhead->size() == 1) {
+          OperatorTuneBase::omp_overhead_ns_ = static_cast<duration_t>((*overhead)[0]);
+        } else {
+          OperatorTuneBase::omp_overhead_ns_ = GetOMPLoopOverhead();
+          data->Set("omp_overhead_ns",
+                    {static_cast<float>(OperatorTuneBase::omp_overhead_ns_)});
+        }
         std::string config = dmlc::GetEnv("MXNET_USE_OPERATOR_TUNING", std::string());
         ParseEnablerConfig(config);
       }
@@ -180,14 +297,15 @@ class OperatorTune : public OperatorTuneByType<DType> {
   /*!
    * \brief Schedule a tuning run
    * \tparam OP Operator to tune
+   * \tparam TUNED tuned_op whose workload tune_func sets
    * \param tune_func Function to call which tunes the operator
    * \return true if the tune operation was scheduled
    */
-  template<typename OP>
+  template<typename OP, typename TUNED = mxnet_op::tuned_op<OP, DType> >
   static bool ScheduleTune(void (*tune_func)()) {
 #ifdef MXNET_USE_OPERATOR_TUNING
     if (tune_func) {
-      GetTuningList()->push_back(tune_func);
+      GetTuningList()->push_back({type_name<TUNED>(), tune_func, &TUNED::workload_});
       operator_names_.insert(demangle(typeid(OP).name()));
       return true;
     }
@@ -208,11 +326,12 @@ class OperatorTune : public OperatorTuneByType<DType> {
   }
 
   /*!\
-   * \brief Tune all registered kernel operators that haven't already been tuned
+   * \brief Tune all registered kernel operators that haven't already been tuned,
+   *        or load their results from MXNET_TUNING_DATA_FILE
    */
   static bool TuneAll() {
     Initialize();
-    std::list<void (*)()> *tl = GetTuningList();
+    std::list<tune::TuneEntry> *tl = GetTuningList();
     const size_t size_save = tl->size();  // For checking if anything asynchronous is
     // adding or removing items, which is forbidden
     if (output_tuning_data_ && !tl->empty()) {
@@ -224,9 +343,19 @@ class OperatorTune : public OperatorTuneByType<DType> {
       }
     }
     const Tick start = std::chrono::high_resolution_clock::now();
-    for (auto i : *tl) {
-      (*i)();
+    tune::TuningData *data = tune::TuningData::Get();
+    size_t num_tuned = 0;
+    for (const tune::TuneEntry& entry : *tl) {
+      const std::vector<float> *loaded = data->Find(entry.name);
+      if (loaded != nullptr && loaded->size() == entry.workload->size()) {
+        *entry.workload = *loaded;
+        continue;
+      }
+      entry.tune();
+      data->Set(entry.name, *entry.workload);
+      ++num_tuned;
     }
+    if (num_tuned && data->enabled()) data->Save();
     if (OperatorTuneBase::verbose_tuning_info_) {
       const duration_t duration = OperatorTune::GetDurationInNanoseconds(start);
       LOG(INFO) << "Op Tuning  for " << type_name<DType>()
@@ -251,7 +380,7 @@ class OperatorTune : public OperatorTuneByType<DType> {
    * \brief Get the list of tuning function calls for the operators
    * \return Pointer to list of tuning function calls
    */
-  static std::list<void (*)()> *GetTuningList();
+  static std::list<tune::TuneEntry> *GetTuningList();
 
   /*!
    * \brief Demangle typeid::name() in order to generate source macros
@@ -707,6 +836,21 @@ class UnaryOpTune : public OperatorTune<DType> {
                                          thread_count,
                                          static_cast<uint64_t>(N) * OP::workload_[0]);
   }
+
+  /*!
+   * \brief Determine the number of OMP threads based upon both timing and configuration using
+   *        the given (templated) operator's workload
+   * \tparam OP Operator whose workload to use (tuned_op::workload_[0])
+   * \param N Number of iterations desired
+   * \param thread_count Number of OMP threads available to perform the iterations
+   * \returns Number of threads to use, 1 to run the iterations serially
+   */
+  template<typename OP>
+  inline static size_t OMPThreadCount(size_t N, size_t thread_count) {
+      return OperatorTune<DType>::OMPThreadCount(N,
+                                                 thread_count,
+                                                 static_cast<uint64_t>(N) * OP::workload_[0]);
+  }
 };
 
 /*!
@@ -44,8 +44,8 @@ double OperatorTuneBase::tuning_weight_scale_ = 0.0;
   template<> volatile int OperatorTune<__typ$>::volatile_int_ = 9;  /* arbitrary number */ \
   template<> std::unordered_set<std::string> OperatorTune<__typ$>::operator_names_({}); \
   template<> bool OperatorTune<__typ$>::output_tuning_data_ = false; \
-  template<> std::list<void (*)()> *OperatorTune<__typ$>::GetTuningList() { \
-    static std::list<void (*)()> ll; \
+  template<> std::list<tune::TuneEntry> *OperatorTune<__typ$>::GetTuningList() { \
+    static std::list<tune::TuneEntry> ll; \
     return &ll; \
   }
 
@@ -99,6 +99,11 @@ struct static_init_var {
     size_t N, size_t omp_threads) { \
     return ::mxnet::op::UnaryOpTune<__typ$>::UseOMP<mxnet_op::tuned_op<__op$, __typ$>>( \
       N, omp_threads); \
+  } \
+  template<> size_t ::mxnet::op::mxnet_op::tuned_op<__op$, __typ$>::OMPThreadCount( \
+    size_t N, size_t omp_threads) { \
+    return ::mxnet::op::UnaryOpTune<__typ$>::OMPThreadCount<mxnet_op::tuned_op<__op$, __typ$>>( \
+      N, omp_threads); \
   }}  /* namespace mxnet_op */ \
   template<> bool static_init_var<__op$, __typ$>::init_ = \
     ::mxnet::op::OperatorTune<__typ$>::ScheduleTune<__op$>( \
@@ -114,6 +119,11 @@ struct static_init_var {
     size_t N, size_t omp_threads) { \
     return ::mxnet::op::UnaryOpTune<__typ$>::UseOMP<mxnet_op::tuned_op<__op$, __typ$>>( \
       N, omp_threads); \
+  } \
+  template<> size_t ::mxnet::op::mxnet_op::tuned_op<__op$, __typ$>::OMPThreadCount( \
+    size_t N, size_t omp_threads) { \
+    return ::mxnet::op::UnaryOpTune<__typ$>::OMPThreadCount<mxnet_op::tuned_op<__op$, __typ$>>( \
+      N, omp_threads); \
   }}  /* namespace mxnet_op */ \
   template<> bool static_init_var<__op$, __typ$>::init_ = \
     ::mxnet::op::OperatorTune<__typ$>::ScheduleTune<__op$>( \
@@ -130,9 +140,16 @@ struct static_init_var {
     UseOMP(size_t N, size_t omp_threads) { \
     return ::mxnet::op::UnaryOpTune<__typ$>::UseOMP<mxnet_op::tuned_op< \
       ::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, __typ$>>(N, omp_threads); \
+  } \
+  template<> size_t \
+  ::mxnet::op::mxnet_op::tuned_op<::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, __typ$>:: \
+    OMPThreadCount(size_t N, size_t omp_threads) { \
+    return ::mxnet::op::UnaryOpTune<__typ$>::OMPThreadCount<mxnet_op::tuned_op< \
+      ::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, __typ$>>(N, omp_threads); \
   }}  /* namespace mxnet_op */ \
   template<> bool static_init_var<::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, __typ$>:: \
-    init_ = ::mxnet::op::OperatorTune<__typ$>::ScheduleTune<__op$>( \
+    init_ = ::mxnet::op::OperatorTune<__typ$>::ScheduleTune<__op$, mxnet_op::tuned_op< \
+      ::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, __typ$> >( \
       ::mxnet::op::UnaryOpTune<__typ$>::TuneUnaryBackwardOperator<__op$>)
 
 /*!
@@ -145,6 +162,11 @@ struct static_init_var {
     size_t N, size_t omp_threads) { \
     return ::mxnet::op::BinaryOpTune<__typ$>::UseOMP<mxnet_op::tuned_op<__op$, __typ$>>( \
       N, omp_threads); \
+  } \
+  template<> size_t ::mxnet::op::mxnet_op::tuned_op<__op$, __typ$>::OMPThreadCount( \
+    size_t N, size_t omp_threads) { \
+    return ::mxnet::op::BinaryOpTune<__typ$>::OMPThreadCount<mxnet_op::tuned_op<__op$, __typ$>>( \
+      N, omp_threads); \
   }}  /* namespace mxnet_op */ \
   template<> bool static_init_var<__op$, __typ$>::init_ = \
     ::mxnet::op::OperatorTune<__typ$>::ScheduleTune<__op$>( \
@@ -162,10 +184,18 @@ struct static_init_var {
       UseOMP(size_t N, size_t omp_threads) { \
     return ::mxnet::op::BinaryOpTune<__typ$>::UseOMP<mxnet_op::tuned_op< \
       ::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, __typ$>>(N, omp_threads); \
+  } \
+  template<> \
+    size_t ::mxnet::op::mxnet_op::tuned_op< \
+      ::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, __typ$>:: \
+      OMPThreadCount(size_t N, size_t omp_threads) { \
+    return ::mxnet::op::BinaryOpTune<__typ$>::OMPThreadCount<mxnet_op::tuned_op< \
+      ::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, __typ$>>(N, omp_threads); \
   }}  /* namespace mxnet_op */ \
   template<> bool static_init_var<::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, \
     __typ$>::init_ = \
-    ::mxnet::op::OperatorTune<__typ$>::ScheduleTune<__op$>(  \
+    ::mxnet::op::OperatorTune<__typ$>::ScheduleTune<__op$, mxnet_op::tuned_op< \
+      ::mxnet::op::mxnet_op::backward_grad_tuned<__op$>, __typ$> >(  \
       ::mxnet::op::BinaryOpTune<__typ$>::TuneBinaryBackwardOperator<__op$>)
 
 /*!
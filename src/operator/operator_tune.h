@@ -21,6 +21,7 @@
 
 #include <mshadow/base.h>
 #include <mshadow/tensor.h>
+#include <algorithm>
 #include <vector>
 #include <set>
 #include <atomic>
@@ -155,6 +156,26 @@ class OperatorTuneBase {
     }
     return false;
   }
+
+  /*!
+   * \brief Estimate how many OMP threads to use for the iterations. Every thread is given at
+   *        least the OMP overhead worth of work, since further threads barely cut the time
+   *        but keep cores from operators running at the same time
+   * \param N - Number of iterations desired
+   * \param thread_count - Number of OMP threads available to perform the iterations
+   * \returns Number of threads to use, 1 to run the iterations serially
+   */
+  inline static size_t GetOMPThreadCount(size_t N, size_t thread_count,
+                                         const uint64_t serial_workload) {
+    if (thread_count < 2) return 1;
+    const uint64_t total_serial_time_ns = serial_workload >> WORKLOAD_COUNT_SHIFT;
+    const uint64_t overhead_ns = omp_overhead_ns_ > 0 ? omp_overhead_ns_ : 1;
+    const size_t threads = static_cast<size_t>(
+      std::min<uint64_t>(thread_count, total_serial_time_ns / overhead_ns));
+    if (threads < 2) return 1;
+    const uint64_t omp_compute_time_ns = (serial_workload / threads) >> WORKLOAD_COUNT_SHIFT;
+    return overhead_ns + omp_compute_time_ns < total_serial_time_ns ? threads : 1;
+  }
 };
 
 namespace tune {
@@ -210,6 +231,29 @@ class OperatorTuneByType : public OperatorTuneBase {
 #endif
   }
 
+  /*!
+   * \brief Determine the number of OMP threads based upon both timing and configuration
+   * \param N - Number of iterations desired
+   * \param thread_count - Number of OMP threads available to perform the iterations
+   * \returns Number of threads to use, 1 to run the iterations serially
+   */
+  inline static size_t OMPThreadCount(size_t N, size_t thread_count,
+                                      const uint64_t serial_workload) {
+#ifdef MXNET_USE_OPERATOR_TUNING
+    switch (tuning_mode()) {
+      case tune::kAuto:
+        return OperatorTuneBase::GetOMPThreadCount(N, thread_count, serial_workload);
+      case tune::kNeverOMP:
+        return 1;
+      case tune::kAlwaysOMP:
+      default:
+        return thread_count;
+    }
+#else
+    return thread_count;
+#endif
+  }
+
  protected:
   /*! \brief Tuning mode */
   static volatile tune::TuningMode tuning_mode_;
@@ -255,6 +299,14 @@ struct tuned_op : public Operation {
    * \return true if OMP parallelism is recommended
    */
   static bool UseOMP(size_t N, size_t thread_count);
+
+  /*!
+   * \brief Number of OMP threads recommended for N iterations, implemented next to UseOMP()
+   * \param N Number of iterations
+   * \param thread_count Number of threads available
+   * \return Number of threads to use, 1 to run the iterations serially
+   */
+  static size_t OMPThreadCount(size_t N, size_t thread_count);
 };
 
 /*!
@@ -32,6 +32,9 @@
 #include <mshadow/base.h>
 #include <nnvm/op.h>
 #include <nnvm/op_attr_types.h>
+#include <algorithm>
+#include <string>
+#include <type_traits>
 #include <vector>
 #include "./operator_common.h"
 #include "./mshadow_op.h"
@@ -1108,6 +1111,170 @@ inline void RMSPropAlexUpdate(const nnvm::NodeAttrs &attrs,
   });
 }
 
+template<int req, typename xpu>
+struct RMSPropAlexDnsRspDnsKernel;
+
+/*!
+ * Note: this kernel performs the lazy rmspropalex update. For each row-slice in the
+ * row_sparse gradient, it updates the corresponding elements in weight, n, g and delta.
+ * The kernel assumes dense weight/n/g/delta, and row_sparse gradient
+ */
+template<int req>
+struct RMSPropAlexDnsRspDnsKernel<req, cpu> {
+  template<typename DType, typename IType>
+  MSHADOW_XINLINE static void Map(int i, const nnvm::dim_t row_length, DType* out_data,
+    DType* state_n_data, DType* state_g_data, DType* delta_data, const DType* weight_data,
+    const IType* grad_idx, const DType* grad_data, const DType clip_gradient,
+    const DType clip_weights, const DType gamma1, const DType gamma2, const DType lr,
+    const DType wd, const DType epsilon, const DType rescale_grad) {
+    using nnvm::dim_t;
+    using namespace mshadow_op;
+    const dim_t row_offset = grad_idx[i] * row_length;
+    for (dim_t j = 0; j < row_length; j++) {
+      // index in data/n/g/delta
+      const dim_t data_i = row_offset + j;
+      // index in grad
+      const dim_t grad_i = i * row_length + j;
+      DType grad_rescaled = grad_data[grad_i] * rescale_grad + weight_data[data_i] * wd;
+      if (clip_gradient >= 0.0f) {
+        grad_rescaled = clip::Map(grad_rescaled, clip_gradient);
+      }
+      state_n_data[data_i] = (1.f - gamma1) * grad_rescaled * grad_rescaled +
+                             gamma1 * state_n_data[data_i];
+      state_g_data[data_i] = (1.f - gamma1) * grad_rescaled + gamma1 * state_g_data[data_i];
+      delta_data[data_i] = gamma2 * delta_data[data_i] - lr * grad_rescaled /
+                           square_root::Map(state_n_data[data_i] -
+                                            state_g_data[data_i] * state_g_data[data_i] +
+                                            epsilon);
+      DType w = weight_data[data_i] + delta_data[data_i];
+      if (clip_weights >= 0.0f) {
+        w = clip::Map(w, clip_weights);
+      }
+      KERNEL_ASSIGN(out_data[data_i], req, w);
+    }
+  }
+};
+
+template<int req>
+struct RMSPropAlexDnsRspDnsKernel<req, gpu> {
+  template<typename DType, typename IType>
+  MSHADOW_XINLINE static void Map(int i, const nnvm::dim_t row_length, DType* out_data,
+    DType* state_n_data, DType* state_g_data, DType* delta_data, const DType* weight_data,
+    const IType* grad_idx, const DType* grad_data, const DType clip_gradient,
+    const DType clip_weights, const DType gamma1, const DType gamma2, const DType lr,
+    const DType wd, const DType epsilon, const DType rescale_grad) {
+    using nnvm::dim_t;
+    using namespace mshadow_op;
+    const dim_t row_id = i / row_length;
+    const dim_t col_id = i % row_length;
+    // index in data/n/g/delta
+    const dim_t data_i = grad_idx[row_id] * row_length + col_id;
+    DType grad_rescaled = grad_data[i] * rescale_grad + weight_data[data_i] * wd;
+    if (clip_gradient >= 0.0f) {
+      grad_rescaled = clip::Map(grad_rescaled, clip_gradient);
+    }
+    state_n_data[data_i] = (1.f - gamma1) * grad_rescaled * grad_rescaled +
+                           gamma1 * state_n_data[data_i];
+    state_g_data[data_i] = (1.f - gamma1) * grad_rescaled + gamma1 * state_g_data[data_i];
+    delta_data[data_i] = gamma2 * delta_data[data_i] - lr * grad_rescaled /
+                         square_root::Map(state_n_data[data_i] -
+                                          state_g_data[data_i] * state_g_data[data_i] +
+                                          epsilon);
+    DType w = weight_data[data_i] + delta_data[data_i];
+    if (clip_weights >= 0.0f) {
+      w = clip::Map(w, clip_weights);
+    }
+    KERNEL_ASSIGN(out_data[data_i], req, w);
+  }
+};
+
+template<typename xpu>
+inline void RMSPropAlexUpdateDnsRspDnsImpl(const RMSPropAlexParam& param,
+                                           const OpContext& ctx,
+                                           const TBlob& weight,
+                                           const NDArray& grad,
+                                           const TBlob& state_n,
+                                           const TBlob& state_g,
+                                           const TBlob& delta,
+                                           const OpReqType& req,
+                                           TBlob *out) {
+  using namespace mxnet_op;
+  using namespace rowsparse;
+  Stream<xpu>* s = ctx.get_stream<xpu>();
+  if (!grad.storage_initialized() || req == kNullOp) return;
+  CHECK_EQ(req, kWriteInplace) << "kWriteInplace is expected for sparse rmspropalex_update";
+  CHECK_GT(weight.shape_.Size(), 0);
+  CHECK_GT(state_n.shape_.Size(), 0);
+  CHECK_GT(state_g.shape_.Size(), 0);
+  CHECK_GT(delta.shape_.Size(), 0);
+
+  MSHADOW_REAL_TYPE_SWITCH(weight.type_flag_, DType, {
+    MSHADOW_IDX_TYPE_SWITCH(grad.aux_type(kIdx), IType, {
+      MXNET_ASSIGN_REQ_SWITCH(req, req_type, {
+        const nnvm::dim_t num_rows = grad.aux_shape(kIdx)[0];
+        const auto row_length = weight.shape_.ProdShape(1, weight.ndim());
+        size_t num_threads = num_rows;
+        if (std::is_same<xpu, gpu>::value) {
+          num_threads = num_rows * row_length;
+        }
+        Kernel<RMSPropAlexDnsRspDnsKernel<req_type, xpu>, xpu>::Launch(s, num_threads,
+          row_length, out->dptr<DType>(), state_n.dptr<DType>(), state_g.dptr<DType>(),
+          delta.dptr<DType>(), weight.dptr<DType>(), grad.aux_data(kIdx).dptr<IType>(),
+          grad.data().dptr<DType>(), static_cast<DType>(param.clip_gradient),
+          static_cast<DType>(param.clip_weights), static_cast<DType>(param.gamma1),
+          static_cast<DType>(param.gamma2), static_cast<DType>(param.lr),
+          static_cast<DType>(param.wd), static_cast<DType>(param.epsilon),
+          static_cast<DType>(param.rescale_grad));
+      });
+    });
+  });
+}
+
+template<typename xpu>
+inline void RMSPropAlexUpdateRspRspRspImpl(const RMSPropAlexParam& param,
+                                           const OpContext& ctx,
+                                           const NDArray& weight,
+                                           const NDArray& grad,
+                                           const NDArray& state_n,
+                                           const NDArray& state_g,
+                                           const NDArray& delta,
+                                           const OpReqType& req,
+                                           NDArray *out) {
+  using namespace mshadow;
+  using namespace mxnet_op;
+  using namespace rowsparse;
+  CHECK_RSP_ALL_ROWS_NON_ZERO(weight, "RMSPropAlexUpdate", "weights");
+  Stream<xpu>* s = ctx.get_stream<xpu>();
+  // fill the states with zero values in order to reuse the dns rsp impl
+  for (const NDArray& state : {state_n, state_g, delta}) {
+    if (!state.storage_initialized()) {
+      NDArray state_zeros = state;
+      FillDnsZerosRspImpl(s, &state_zeros);
+    }
+  }
+  TBlob out_blob = out->data();
+  // reuse dns rsp implementation when storage_shape == shape
+  RMSPropAlexUpdateDnsRspDnsImpl<xpu>(param, ctx, weight.data(), grad, state_n.data(),
+                                      state_g.data(), delta.data(), req, &out_blob);
+}
+
+template<typename xpu>
+inline void RMSPropAlexUpdateEx(const nnvm::NodeAttrs& attrs,
+                                const OpContext &ctx,
+                                const std::vector<NDArray> &inputs,
+                                const std::vector<OpReqType> &req,
+                                const std::vector<NDArray> &outputs) {
+  const RMSPropAlexParam& param = nnvm::get<RMSPropAlexParam>(attrs.parsed);
+  if (common::ContainsOnlyStorage(inputs, kRowSparseStorage) &&
+      outputs[0].storage_type() == kRowSparseStorage) {
+    NDArray out = outputs[0];
+    RMSPropAlexUpdateRspRspRspImpl<xpu>(param, ctx, inputs[0], inputs[1], inputs[2],
+                                        inputs[3], inputs[4], req[0], &out);
+  } else {
+    LogUnimplementedOp(attrs, ctx, inputs, req, outputs);
+  }
+}
+
 // This RMSProp code follows the version in
 // http://www.cs.toronto.edu/~tijmen/csc321/slides/lecture_slides_lec6.pdf
 // by Tieleman & Hinton, 2012
@@ -1207,6 +1374,153 @@ inline void RMSPropUpdate(const nnvm::NodeAttrs &attrs, const OpContext &ctx,
   });
 }
 
+template<int req, typename xpu>
+struct RMSPropDnsRspDnsKernel;
+
+/*!
+ * Note: this kernel performs the lazy rmsprop update. For each row-slice in the
+ * row_sparse gradient, it updates the corresponding elements in weight and n.
+ * The kernel assumes dense weight/n, and row_sparse gradient
+ */
+template<int req>
+struct RMSPropDnsRspDnsKernel<req, cpu> {
+  template<typename DType, typename IType>
+  MSHADOW_XINLINE static void Map(int i, const nnvm::dim_t row_length, DType* out_data,
+    DType* state_n_data, const DType* weight_data, const IType* grad_idx,
+    const DType* grad_data, const DType clip_gradient, const DType clip_weights,
+    const DType gamma1, const DType lr, const DType wd, const DType epsilon,
+    const DType rescale_grad) {
+    using nnvm::dim_t;
+    using namespace mshadow_op;
+    const dim_t row_offset = grad_idx[i] * row_length;
+    for (dim_t j = 0; j < row_length; j++) {
+      // index in data/n
+      const dim_t data_i = row_offset + j;
+      // index in grad
+      const dim_t grad_i = i * row_length + j;
+      DType grad_rescaled = grad_data[grad_i] * rescale_grad + weight_data[data_i] * wd;
+      if (clip_gradient >= 0.0f) {
+        grad_rescaled = clip::Map(grad_rescaled, clip_gradient);
+      }
+      state_n_data[data_i] = (1.f - gamma1) * grad_rescaled * grad_rescaled +
+                             gamma1 * state_n_data[data_i];
+      DType w = weight_data[data_i] - lr * grad_rescaled /
+                square_root::Map(state_n_data[data_i] + epsilon);
+      if (clip_weights >= 0.0f) {
+        w = clip::Map(w, clip_weights);
+      }
+      KERNEL_ASSIGN(out_data[data_i], req, w);
+    }
+  }
+};
+
+template<int req>
+struct RMSPropDnsRspDnsKernel<req, gpu> {
+  template<typename DType, typename IType>
+  MSHADOW_XINLINE static void Map(int i, const nnvm::dim_t row_length, DType* out_data,
+    DType* state_n_data, const DType* weight_data, const IType* grad_idx,
+    const DType* grad_data, const DType clip_gradient, const DType clip_weights,
+    const DType gamma1, const DType lr, const DType wd, const DType epsilon,
+    const DType rescale_grad) {
+    using nnvm::dim_t;
+    using namespace mshadow_op;
+    const dim_t row_id = i / row_length;
+    const dim_t col_id = i % row_length;
+    // index in data/n
+    const dim_t data_i = grad_idx[row_id] * row_length + col_id;
+    DType grad_rescaled = grad_data[i] * rescale_grad + weight_data[data_i] * wd;
+    if (clip_gradient >= 0.0f) {
+      grad_rescaled = clip::Map(grad_rescaled, clip_gradient);
+    }
+    state_n_data[data_i] = (1.f - gamma1) * grad_rescaled * grad_rescaled +
+                           gamma1 * state_n_data[data_i];
+    DType w = weight_data[data_i] - lr * grad_rescaled /
+              square_root::Map(state_n_data[data_i] + epsilon);
+    if (clip_weights >= 0.0f) {
+      w = clip::Map(w, clip_weights);
+    }
+    KERNEL_ASSIGN(out_data[data_i], req, w);
+  }
+};
+
+template<typename xpu>
+inline void RMSPropUpdateDnsRspDnsImpl(const RMSPropParam& param,
+                                       const OpContext& ctx,
+                                       const TBlob& weight,
+                                       const NDArray& grad,
+                                       const TBlob& state_n,
+                                       const OpReqType& req,
+                                       TBlob *out) {
+  using namespace mxnet_op;
+  using namespace rowsparse;
+  Stream<xpu>* s = ctx.get_stream<xpu>();
+  if (!grad.storage_initialized() || req == kNullOp) return;
+  CHECK_EQ(req, kWriteInplace) << "kWriteInplace is expected for sparse rmsprop_update";
+  CHECK_GT(weight.shape_.Size(), 0);
+  CHECK_GT(state_n.shape_.Size(), 0);
+
+  MSHADOW_REAL_TYPE_SWITCH(weight.type_flag_, DType, {
+    MSHADOW_IDX_TYPE_SWITCH(grad.aux_type(kIdx), IType, {
+      MXNET_ASSIGN_REQ_SWITCH(req, req_type, {
+        const nnvm::dim_t num_rows = grad.aux_shape(kIdx)[0];
+        const auto row_length = weight.shape_.ProdShape(1, weight.ndim());
+        size_t num_threads = num_rows;
+        if (std::is_same<xpu, gpu>::value) {
+          num_threads = num_rows * row_length;
+        }
+        Kernel<RMSPropDnsRspDnsKernel<req_type, xpu>, xpu>::Launch(s, num_threads,
+          row_length, out->dptr<DType>(), state_n.dptr<DType>(), weight.dptr<DType>(),
+          grad.aux_data(kIdx).dptr<IType>(), grad.data().dptr<DType>(),
+          static_cast<DType>(param.clip_gradient), static_cast<DType>(param.clip_weights),
+          static_cast<DType>(param.gamma1), static_cast<DType>(param.lr),
+          static_cast<DType>(param.wd), static_cast<DType>(param.epsilon),
+          static_cast<DType>(param.rescale_grad));
+      });
+    });
+  });
+}
+
+template<typename xpu>
+inline void RMSPropUpdateRspRspRspImpl(const RMSPropParam& param,
+                                       const OpContext& ctx,
+                                       const NDArray& weight,
+                                       const NDArray& grad,
+                                       const NDArray& state_n,
+                                       const OpReqType& req,
+                                       NDArray *out) {
+  using namespace mshadow;
+  using namespace mxnet_op;
+  using namespace rowsparse;
+  CHECK_RSP_ALL_ROWS_NON_ZERO(weight, "RMSPropUpdate", "weights");
+  Stream<xpu>* s = ctx.get_stream<xpu>();
+  // fill n with zero values in order to reuse the dns rsp impl
+  if (!state_n.storage_initialized()) {
+    NDArray state_zeros = state_n;
+    FillDnsZerosRspImpl(s, &state_zeros);
+  }
+  TBlob out_blob = out->data();
+  // reuse dns rsp implementation when storage_shape == shape
+  RMSPropUpdateDnsRspDnsImpl<xpu>(param, ctx, weight.data(), grad, state_n.data(),
+                                  req, &out_blob);
+}
+
+template<typename xpu>
+inline void RMSPropUpdateEx(const nnvm::NodeAttrs& attrs,
+                            const OpContext &ctx,
+                            const std::vector<NDArray> &inputs,
+                            const std::vector<OpReqType> &req,
+                            const std::vector<NDArray> &outputs) {
+  const RMSPropParam& param = nnvm::get<RMSPropParam>(attrs.parsed);
+  if (common::ContainsOnlyStorage(inputs, kRowSparseStorage) &&
+      outputs[0].storage_type() == kRowSparseStorage) {
+    NDArray out = outputs[0];
+    RMSPropUpdateRspRspRspImpl<xpu>(param, ctx, inputs[0], inputs[1], inputs[2],
+                                    req[0], &out);
+  } else {
+    LogUnimplementedOp(attrs, ctx, inputs, req, outputs);
+  }
+}
+
 struct FtrlParam : public dmlc::Parameter<FtrlParam> {
   float lr;
   float lamda1;
@@ -1277,8 +1591,11 @@ inline void FtrlUpdate(const nnvm::NodeAttrs& attrs,
   });
 }
 
+template<int req, typename xpu>
+struct FtrlDnsRspDnsKernel;
+
 template<int req>
-struct FtrlDnsRspDnsKernel {
+struct FtrlDnsRspDnsKernel<req, cpu> {
   template<typename DType, typename IType>
   MSHADOW_XINLINE static void Map(int i, const nnvm::dim_t row_length, DType* out_data,
     DType* z_data, DType* n_data, const DType* weight_data, const IType* grad_idx,
@@ -1313,6 +1630,33 @@ struct FtrlDnsRspDnsKernel {
   }
 };
 
+template<int req>
+struct FtrlDnsRspDnsKernel<req, gpu> {
+  template<typename DType, typename IType>
+  MSHADOW_XINLINE static void Map(int i, const nnvm::dim_t row_length, DType* out_data,
+    DType* z_data, DType* n_data, const DType* weight_data, const IType* grad_idx,
+    const DType* grad_data, const DType clip_gradient, const DType lamda1, const DType beta,
+    const DType lr, const DType wd, const DType rescale_grad) {
+    using nnvm::dim_t;
+    using namespace mshadow_op;
+    const dim_t row_id = i / row_length;
+    const dim_t col_id = i % row_length;
+    // index in data/z/n
+    const dim_t data_i = grad_idx[row_id] * row_length + col_id;
+    DType grad_rescaled = grad_data[i] * rescale_grad;
+    if (clip_gradient >= 0.0f) {
+      grad_rescaled = clip::Map(grad_rescaled, clip_gradient);
+    }
+    z_data[data_i] += grad_rescaled - (square_root::Map(n_data[data_i] +
+                      square::Map(grad_rescaled)) - square_root::Map(n_data[data_i])) *
+                      weight_data[data_i] / lr;
+    n_data[data_i] += square::Map(grad_rescaled);
+    KERNEL_ASSIGN(out_data[data_i], req,
+                  (sign::Map(z_data[data_i]) * lamda1 - z_data[data_i]) /
+                  ((beta + square_root::Map(n_data[data_i])) / lr + wd) *
+                  gt::Map(abs::Map(z_data[data_i]), lamda1));
+  }
+};
 
 template<typename xpu>
 inline void FtrlUpdateDnsRspDnsImpl(const FtrlParam& param,
@@ -1343,7 +1687,11 @@ inline void FtrlUpdateDnsRspDnsImpl(const FtrlParam& param,
         DType* out_data = out->dptr<DType>();
         nnvm::dim_t num_rows = grad.aux_shape(kIdx)[0];
         const auto row_length = weight.shape_.ProdShape(1, weight.ndim());
-        Kernel<FtrlDnsRspDnsKernel<req_type>, xpu>::Launch(s, num_rows, row_length,
+        size_t num_threads = num_rows;
+        if (std::is_same<xpu, gpu>::value) {
+          num_threads = num_rows * row_length;
+        }
+        Kernel<FtrlDnsRspDnsKernel<req_type, xpu>, xpu>::Launch(s, num_threads, row_length,
           out_data, z_data, n_data, weight_data, grad_idx, grad_val,
           static_cast<DType>(param.clip_gradient), static_cast<DType>(param.lamda1),
           static_cast<DType>(param.beta), static_cast<DType>(param.lr),
@@ -1725,6 +2073,436 @@ inline void AdagradUpdateEx(const nnvm::NodeAttrs& attrs,
   }
 }
 
+/*!
+ * \brief the most tensors one multi-tensor kernel updates, the pointers of
+ *  all of them are kernel arguments, which are limited to 4KB on GPU
+ */
+const int kMaxMultiTensors = 48;
+
+struct MultiSGDParam : public dmlc::Parameter<MultiSGDParam> {
+  nnvm::Tuple<float> lrs;
+  nnvm::Tuple<float> wds;
+  float rescale_grad;
+  float clip_gradient;
+  int num_weights;
+  bool use_loss_scale;
+  DMLC_DECLARE_PARAMETER(MultiSGDParam) {
+    DMLC_DECLARE_FIELD(lrs)
+    .describe("Learning rates, one per weight.");
+    DMLC_DECLARE_FIELD(wds)
+    .describe("Weight decays, one per weight.");
+    DMLC_DECLARE_FIELD(rescale_grad)
+    .set_default(1.0f)
+    .describe("Rescale gradient to grad = rescale_grad*grad.");
+    DMLC_DECLARE_FIELD(clip_gradient)
+    .set_default(-1.0f)
+    .describe("Clip gradient to the range of [-clip_gradient, clip_gradient] "
+              "If clip_gradient <= 0, gradient clipping is turned off. "
+              "grad = max(min(grad, clip_gradient), -clip_gradient).");
+    DMLC_DECLARE_FIELD(num_weights)
+    .set_default(1)
+    .set_lower_bound(1)
+    .describe("Number of updated weights.");
+    DMLC_DECLARE_FIELD(use_loss_scale)
+    .set_default(false)
+    .describe("If true, the inputs end with two float32 arrays of shape (1,), the "
+              "all_finite flag of the gradients and the loss scale. The gradients are "
+              "divided by the loss scale, and no weight or state changes when the flag is 0.");
+  }
+};
+
+struct MultiSGDMomParam : public dmlc::Parameter<MultiSGDMomParam> {
+  nnvm::Tuple<float> lrs;
+  nnvm::Tuple<float> wds;
+  float momentum;
+  float rescale_grad;
+  float clip_gradient;
+  int num_weights;
+  bool use_loss_scale;
+  DMLC_DECLARE_PARAMETER(MultiSGDMomParam) {
+    DMLC_DECLARE_FIELD(lrs)
+    .describe("Learning rates, one per weight.");
+    DMLC_DECLARE_FIELD(wds)
+    .describe("Weight decays, one per weight.");
+    DMLC_DECLARE_FIELD(momentum)
+    .set_default(0.0f)
+    .describe("The decay rate of momentum estimates at each epoch.");
+    DMLC_DECLARE_FIELD(rescale_grad)
+    .set_default(1.0f)
+    .describe("Rescale gradient to grad = rescale_grad*grad.");
+    DMLC_DECLARE_FIELD(clip_gradient)
+    .set_default(-1.0f)
+    .describe("Clip gradient to the range of [-clip_gradient, clip_gradient] "
+              "If clip_gradient <= 0, gradient clipping is turned off. "
+              "grad = max(min(grad, clip_gradient), -clip_gradient).");
+    DMLC_DECLARE_FIELD(num_weights)
+    .set_default(1)
+    .set_lower_bound(1)
+    .describe("Number of updated weights.");
+    DMLC_DECLARE_FIELD(use_loss_scale)
+    .set_default(false)
+    .describe("If true, the inputs end with two float32 arrays of shape (1,), the "
+              "all_finite flag of the gradients and the loss scale. The gradients are "
+              "divided by the loss scale, and no weight or state changes when the flag is 0.");
+  }
+};
+
+struct MultiAdamParam : public dmlc::Parameter<MultiAdamParam> {
+  nnvm::Tuple<float> lrs;
+  nnvm::Tuple<float> wds;
+  float beta1;
+  float beta2;
+  float epsilon;
+  float rescale_grad;
+  float clip_gradient;
+  bool use_tusimple_update;
+  int num_weights;
+  DMLC_DECLARE_PARAMETER(MultiAdamParam) {
+    DMLC_DECLARE_FIELD(lrs)
+    .describe("Learning rates, one per weight.");
+    DMLC_DECLARE_FIELD(wds)
+    .describe("Weight decays, one per weight.");
+    DMLC_DECLARE_FIELD(beta1)
+    .set_default(0.9f)
+    .describe("The decay rate for the 1st moment estimates.");
+    DMLC_DECLARE_FIELD(beta2)
+    .set_default(0.999f)
+    .describe("The decay rate for the 2nd moment estimates.");
+    DMLC_DECLARE_FIELD(epsilon)
+    .set_default(1e-8f)
+    .describe("A small constant for numerical stability.");
+    DMLC_DECLARE_FIELD(rescale_grad)
+    .set_default(1.0f)
+    .describe("Rescale gradient to grad = rescale_grad*grad.");
+    DMLC_DECLARE_FIELD(clip_gradient)
+    .set_default(-1.0f)
+    .describe("Clip gradient to the range of [-clip_gradient, clip_gradient] "
+              "If clip_gradient <= 0, gradient clipping is turned off. "
+              "grad = max(min(grad, clip_gradient), -clip_gradient).");
+    DMLC_DECLARE_FIELD(use_tusimple_update)
+    .set_default(true)
+    .describe("whether use the gradient of weight decay when caculate mean & var");
+    DMLC_DECLARE_FIELD(num_weights)
+    .set_default(1)
+    .set_lower_bound(1)
+    .describe("Number of updated weights.");
+  }
+};
+
+/*! \brief number of the is_finite and loss_scale inputs after those of the weights */
+inline int MultiUpdateNumLossScaleInputs(const MultiSGDParam& param) {
+  return param.use_loss_scale ? 2 : 0;
+}
+
+inline int MultiUpdateNumLossScaleInputs(const MultiSGDMomParam& param) {
+  return param.use_loss_scale ? 2 : 0;
+}
+
+inline int MultiUpdateNumLossScaleInputs(const MultiAdamParam& param) {
+  return 0;
+}
+
+/*!
+ * \brief the inputs of every weight follow each other, input_stride of them per
+ *  weight, then the is_finite flag and loss scale of shape (1,) if any
+ */
+template<typename ParamType, int input_stride>
+inline bool MultiUpdateShape(const nnvm::NodeAttrs& attrs,
+                             std::vector<TShape> *in_attrs,
+                             std::vector<TShape> *out_attrs) {
+  const ParamType& param = nnvm::get<ParamType>(attrs.parsed);
+  const size_t num_weight_inputs = input_stride * param.num_weights;
+  CHECK_EQ(in_attrs->size(), num_weight_inputs + MultiUpdateNumLossScaleInputs(param));
+  for (size_t i = num_weight_inputs; i < in_attrs->size(); ++i) {
+    SHAPE_ASSIGN_CHECK(*in_attrs, i, TShape(1, 1));
+  }
+  CHECK_EQ(out_attrs->size(), static_cast<size_t>(param.num_weights));
+  CHECK_EQ(param.lrs.ndim(), static_cast<index_t>(param.num_weights))
+    << "lrs must have one learning rate per weight";
+  CHECK_EQ(param.wds.ndim(), static_cast<index_t>(param.num_weights))
+    << "wds must have one weight decay per weight";
+  bool all_inferred = true;
+  for (int i = 0; i < param.num_weights; ++i) {
+    std::vector<TShape> inputs(in_attrs->begin() + i * input_stride,
+                               in_attrs->begin() + (i + 1) * input_stride);
+    std::vector<TShape> outputs{out_attrs->at(i)};
+    all_inferred = ElemwiseShape<input_stride, 1>(attrs, &inputs, &outputs) && all_inferred;
+    std::copy(inputs.begin(), inputs.end(), in_attrs->begin() + i * input_stride);
+    (*out_attrs)[i] = outputs[0];
+  }
+  return all_inferred;
+}
+
+/*!
+ * \brief the last num_fp32 inputs of every weight are float32 master copies,
+ *  the is_finite flag and loss scale are float32 too
+ */
+template<typename ParamType, int input_stride, int num_fp32>
+inline bool MultiUpdateType(const nnvm::NodeAttrs& attrs,
+                            std::vector<int> *in_attrs,
+                            std::vector<int> *out_attrs) {
+  const ParamType& param = nnvm::get<ParamType>(attrs.parsed);
+  const size_t num_weight_inputs = input_stride * param.num_weights;
+  CHECK_EQ(in_attrs->size(), num_weight_inputs + MultiUpdateNumLossScaleInputs(param));
+  CHECK_EQ(out_attrs->size(), static_cast<size_t>(param.num_weights));
+  for (size_t i = num_weight_inputs; i < in_attrs->size(); ++i) {
+    TYPE_ASSIGN_CHECK(*in_attrs, i, mshadow::kFloat32);
+  }
+  bool all_inferred = true;
+  for (int i = 0; i < param.num_weights; ++i) {
+    std::vector<int> inputs(in_attrs->begin() + i * input_stride,
+                            in_attrs->begin() + (i + 1) * input_stride);
+    std::vector<int> outputs{out_attrs->at(i)};
+    all_inferred = MP_SGD_InferType<input_stride - num_fp32, 1, input_stride>(
+        attrs, &inputs, &outputs) && all_inferred;
+    std::copy(inputs.begin(), inputs.end(), in_attrs->begin() + i * input_stride);
+    (*out_attrs)[i] = outputs[0];
+  }
+  return all_inferred;
+}
+
+/*! \brief names weight_0, grad_0, <states>_0, weight_1, ... of the inputs */
+inline std::vector<std::string> MultiUpdateInputNames(int num_weights,
+                                                      const std::vector<std::string>& names,
+                                                      bool use_loss_scale = false) {
+  std::vector<std::string> ret;
+  for (int i = 0; i < num_weights; ++i) {
+    for (const std::string& name : names) ret.push_back(name + "_" + std::to_string(i));
+  }
+  if (use_loss_scale) {
+    ret.push_back("is_finite");
+    ret.push_back("loss_scale");
+  }
+  return ret;
+}
+
+/*! \brief indices of the inputs of every weight at the given offsets */
+inline std::vector<uint32_t> MultiUpdateMutateInputs(int num_weights, int input_stride,
+                                                     const std::vector<int>& offsets) {
+  std::vector<uint32_t> ret;
+  for (int i = 0; i < num_weights; ++i) {
+    for (int offset : offsets) ret.push_back(i * input_stride + offset);
+  }
+  return ret;
+}
+
+/*! \brief pointers and hyper-parameters of up to kMaxMultiTensors sgd updates */
+template<typename DType, typename MPDType>
+struct MultiSGDKernelParam {
+  int count;
+  index_t max_size;
+  index_t sizes[kMaxMultiTensors];
+  DType* weights[kMaxMultiTensors];
+  const DType* grads[kMaxMultiTensors];
+  MPDType* moms[kMaxMultiTensors];
+  MPDType* weights32[kMaxMultiTensors];
+  DType* outs[kMaxMultiTensors];
+  float lrs[kMaxMultiTensors];
+  float wds[kMaxMultiTensors];
+  float momentum;
+  float clip_gradient;
+  float rescale_grad;
+  /*! \brief the all_finite flag and loss scale on the device, or NULL */
+  const float* is_finite;
+  const float* loss_scale;
+};
+
+/*!
+ * \brief element i of every tensor of the launch, the same arithmetic as
+ *  sgd_update, sgd_mom_update and their mp_ variants
+ */
+template<typename MPDType, bool has_mom, bool has_mixed_precision>
+struct MultiSGDKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const MultiSGDKernelParam<DType, MPDType>& param,
+                                  const OpReqType req) {
+    // a step with overflown gradients is skipped
+    const bool skip = param.is_finite != NULL && param.is_finite[0] == 0.0f;
+    const float rescale_grad = param.loss_scale != NULL ? param.rescale_grad / param.loss_scale[0]
+                                                        : param.rescale_grad;
+    for (int index = 0; index < param.count; ++index) {
+      if (static_cast<index_t>(i) >= param.sizes[index]) continue;
+      if (skip) {
+        if (req != kWriteInplace) KERNEL_ASSIGN(param.outs[index][i], req, param.weights[index][i]);
+        continue;
+      }
+      const MPDType lr = param.lrs[index];
+      const MPDType wd = param.wds[index];
+      MPDType w = has_mixed_precision ? param.weights32[index][i] :
+                                        static_cast<MPDType>(param.weights[index][i]);
+      MPDType grad = static_cast<MPDType>(rescale_grad) *
+                     static_cast<MPDType>(param.grads[index][i]);
+      if (param.clip_gradient >= 0.0f) {
+        grad = mshadow_op::clip::Map(grad, static_cast<MPDType>(param.clip_gradient));
+      }
+      if (has_mom) {
+        const MPDType mom = static_cast<MPDType>(param.momentum) * param.moms[index][i] -
+                            lr * wd * w - lr * grad;
+        param.moms[index][i] = mom;
+        w += mom;
+      } else {
+        w = (static_cast<MPDType>(1) - lr * wd) * w - lr * grad;
+      }
+      if (has_mixed_precision) param.weights32[index][i] = w;
+      KERNEL_ASSIGN(param.outs[index][i], req, static_cast<DType>(w));
+    }
+  }
+};
+
+inline float MultiSGDMomentum(const MultiSGDParam& param) {
+  return 0.0f;
+}
+
+inline float MultiSGDMomentum(const MultiSGDMomParam& param) {
+  return param.momentum;
+}
+
+/*!
+ * \brief multi_sgd_update and its variants, one kernel launch per
+ *  kMaxMultiTensors weights. The inputs of a weight are weight, grad, then
+ *  mom if has_mom, then weight32 if has_mixed_precision. With use_loss_scale
+ *  the is_finite flag and loss scale follow the inputs of all weights.
+ */
+template<typename xpu, typename ParamType, bool has_mom, bool has_mixed_precision>
+inline void MultiSGDUpdate(const nnvm::NodeAttrs& attrs,
+                           const OpContext &ctx,
+                           const std::vector<TBlob> &inputs,
+                           const std::vector<OpReqType> &req,
+                           const std::vector<TBlob> &outputs) {
+  using namespace mxnet_op;
+  const ParamType& param = nnvm::get<ParamType>(attrs.parsed);
+  const int input_stride = 2 + has_mom + has_mixed_precision;
+  Stream<xpu>* s = ctx.get_stream<xpu>();
+  if (req[0] == kNullOp) return;
+  MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
+    typedef typename std::conditional<has_mixed_precision, float, DType>::type MPDType;
+    for (int begin = 0; begin < param.num_weights; begin += kMaxMultiTensors) {
+      MultiSGDKernelParam<DType, MPDType> kernel_param;
+      kernel_param.count = std::min(kMaxMultiTensors, param.num_weights - begin);
+      kernel_param.max_size = 0;
+      kernel_param.momentum = MultiSGDMomentum(param);
+      kernel_param.clip_gradient = param.clip_gradient;
+      kernel_param.rescale_grad = param.rescale_grad;
+      kernel_param.is_finite = NULL;
+      kernel_param.loss_scale = NULL;
+      if (param.use_loss_scale) {
+        kernel_param.is_finite = inputs[input_stride * param.num_weights].dptr<float>();
+        kernel_param.loss_scale = inputs[input_stride * param.num_weights + 1].dptr<float>();
+      }
+      for (int k = 0; k < kernel_param.count; ++k) {
+        const int index = begin + k;
+        const TBlob* in = &inputs[index * input_stride];
+        kernel_param.sizes[k] = in[0].shape_.Size();
+        kernel_param.max_size = std::max(kernel_param.max_size, kernel_param.sizes[k]);
+        kernel_param.weights[k] = in[0].dptr<DType>();
+        kernel_param.grads[k] = in[1].dptr<DType>();
+        kernel_param.moms[k] = has_mom ? in[2].dptr<MPDType>() : NULL;
+        kernel_param.weights32[k] = has_mixed_precision ? in[input_stride - 1].dptr<MPDType>()
+                                                        : NULL;
+        kernel_param.outs[k] = outputs[index].dptr<DType>();
+        kernel_param.lrs[k] = param.lrs[index];
+        kernel_param.wds[k] = param.wds[index];
+      }
+      Kernel<MultiSGDKernel<MPDType, has_mom, has_mixed_precision>, xpu>::Launch(
+        s, kernel_param.max_size, kernel_param, req[0]);
+    }
+  });
+}
+
+/*! \brief pointers and hyper-parameters of up to kMaxMultiTensors adam updates */
+template<typename DType>
+struct MultiAdamKernelParam {
+  int count;
+  index_t max_size;
+  index_t sizes[kMaxMultiTensors];
+  const DType* weights[kMaxMultiTensors];
+  const DType* grads[kMaxMultiTensors];
+  DType* means[kMaxMultiTensors];
+  DType* vars[kMaxMultiTensors];
+  DType* outs[kMaxMultiTensors];
+  float lrs[kMaxMultiTensors];
+  float wds[kMaxMultiTensors];
+  float beta1;
+  float beta2;
+  float epsilon;
+  float clip_gradient;
+  float rescale_grad;
+  bool use_tusimple_update;
+};
+
+/*! \brief element i of every tensor of the launch, the same arithmetic as adam_update */
+struct MultiAdamKernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const MultiAdamKernelParam<DType>& param,
+                                  const OpReqType req) {
+    for (int index = 0; index < param.count; ++index) {
+      if (static_cast<index_t>(i) >= param.sizes[index]) continue;
+      const DType lr = param.lrs[index];
+      const DType wd = param.wds[index];
+      const DType w = param.weights[index][i];
+      DType grad = static_cast<DType>(param.rescale_grad) * param.grads[index][i];
+      if (!param.use_tusimple_update) grad += wd * w;
+      if (param.clip_gradient >= 0.0f) {
+        grad = mshadow_op::clip::Map(grad, static_cast<DType>(param.clip_gradient));
+      }
+      const DType mean = static_cast<DType>(param.beta1) * param.means[index][i] +
+                         static_cast<DType>(1.f - param.beta1) * grad;
+      const DType var = static_cast<DType>(param.beta2) * param.vars[index][i] +
+                        static_cast<DType>(1.f - param.beta2) * grad * grad;
+      param.means[index][i] = mean;
+      param.vars[index][i] = var;
+      const DType decayed = param.use_tusimple_update ? (static_cast<DType>(1) - lr * wd) * w : w;
+      KERNEL_ASSIGN(param.outs[index][i], req,
+                    decayed - lr * mean /
+                    (mshadow_op::square_root::Map(var) + static_cast<DType>(param.epsilon)));
+    }
+  }
+};
+
+/*!
+ * \brief multi_adam_update, one kernel launch per kMaxMultiTensors weights.
+ *  The inputs of a weight are weight, grad, mean, var.
+ */
+template<typename xpu>
+inline void MultiAdamUpdate(const nnvm::NodeAttrs& attrs,
+                            const OpContext &ctx,
+                            const std::vector<TBlob> &inputs,
+                            const std::vector<OpReqType> &req,
+                            const std::vector<TBlob> &outputs) {
+  using namespace mxnet_op;
+  const MultiAdamParam& param = nnvm::get<MultiAdamParam>(attrs.parsed);
+  const int input_stride = 4;
+  Stream<xpu>* s = ctx.get_stream<xpu>();
+  if (req[0] == kNullOp) return;
+  MSHADOW_REAL_TYPE_SWITCH(inputs[0].type_flag_, DType, {
+    for (int begin = 0; begin < param.num_weights; begin += kMaxMultiTensors) {
+      MultiAdamKernelParam<DType> kernel_param;
+      kernel_param.count = std::min(kMaxMultiTensors, param.num_weights - begin);
+      kernel_param.max_size = 0;
+      kernel_param.beta1 = param.beta1;
+      kernel_param.beta2 = param.beta2;
+      kernel_param.epsilon = param.epsilon;
+      kernel_param.clip_gradient = param.clip_gradient;
+      kernel_param.rescale_grad = param.rescale_grad;
+      kernel_param.use_tusimple_update = param.use_tusimple_update;
+      for (int k = 0; k < kernel_param.count; ++k) {
+        const int index = begin + k;
+        const TBlob* in = &inputs[index * input_stride];
+        kernel_param.sizes[k] = in[0].shape_.Size();
+        kernel_param.max_size = std::max(kernel_param.max_size, kernel_param.sizes[k]);
+        kernel_param.weights[k] = in[0].dptr<DType>();
+        kernel_param.grads[k] = in[1].dptr<DType>();
+        kernel_param.means[k] = in[2].dptr<DType>();
+        kernel_param.vars[k] = in[3].dptr<DType>();
+        kernel_param.outs[k] = outputs[index].dptr<DType>();
+        kernel_param.lrs[k] = param.lrs[index];
+        kernel_param.wds[k] = param.wds[index];
+      }
+      Kernel<MultiAdamKernel, xpu>::Launch(s, kernel_param.max_size, kernel_param, req[0]);
+    }
+  });
+}
+
 }  // namespace op
 }  // namespace mxnet
 
@@ -39,6 +39,9 @@ DMLC_REGISTER_PARAMETER(FtrlParam);
 DMLC_REGISTER_PARAMETER(SignSGDParam);
 DMLC_REGISTER_PARAMETER(SignumParam);
 DMLC_REGISTER_PARAMETER(AdagradParam);
+DMLC_REGISTER_PARAMETER(MultiSGDParam);
+DMLC_REGISTER_PARAMETER(MultiSGDMomParam);
+DMLC_REGISTER_PARAMETER(MultiAdamParam);
 
 NNVM_REGISTER_OP(signsgd_update)
 .describe(R"code(Update function for SignSGD optimizer.
@@ -509,17 +512,23 @@ Tieleman & Hinton, 2012.
 Hinton suggests the momentum term :math:`\gamma` to be 0.9 and the learning rate
 :math:`\eta` to be 0.001.
 
+If weight, grad and n are all of ``row_sparse`` storage type, only the rows
+whose indices appear in grad are updated (lazy update), so weight decay and
+the decay of n are skipped for the other rows.
+
 )code" ADD_FILELINE)
 .set_num_inputs(3)
 .set_num_outputs(1)
 .set_attr_parser(ParamParser<RMSPropParam>)
 .set_attr<nnvm::FInferShape>("FInferShape", ElemwiseShape<3, 1>)
 .set_attr<nnvm::FInferType>("FInferType", ElemwiseType<3, 1>)
+.set_attr<FInferStorageType>("FInferStorageType", ElemwiseStorageType<3, 1, false, true, false>)
 .set_attr<nnvm::FMutateInputs>("FMutateInputs",
   [](const nnvm::NodeAttrs &attrs) {
     return std::vector<uint32_t>{2};
   })
 .set_attr<FCompute>("FCompute<cpu>", RMSPropUpdate<cpu>)
+.set_attr<FComputeEx>("FComputeEx<cpu>", RMSPropUpdateEx<cpu>)
 .add_argument("weight", "NDArray-or-Symbol", "Weight")
 .add_argument("grad", "NDArray-or-Symbol", "Gradient")
 .add_argument("n", "NDArray-or-Symbol", "n")
@@ -548,17 +557,22 @@ http://arxiv.org/pdf/1308.0850v5.pdf Eq(38) - Eq(45) by Alex Graves, 2013.
 
 Graves suggests the momentum term :math:`\gamma_1` to be 0.95, :math:`\gamma_2`
 to be 0.9 and the learning rate :math:`\eta` to be 0.0001.
+
+If weight, grad and the states are all of ``row_sparse`` storage type, only the
+rows whose indices appear in grad are updated (lazy update).
 )code" ADD_FILELINE)
 .set_num_inputs(5)
 .set_num_outputs(1)
 .set_attr_parser(ParamParser<RMSPropAlexParam>)
 .set_attr<nnvm::FInferShape>("FInferShape", ElemwiseShape<5, 1>)
 .set_attr<nnvm::FInferType>("FInferType", ElemwiseType<5, 1>)
+.set_attr<FInferStorageType>("FInferStorageType", ElemwiseStorageType<5, 1, false, true, false>)
 .set_attr<nnvm::FMutateInputs>("FMutateInputs",
   [](const nnvm::NodeAttrs& attrs) {
     return std::vector<uint32_t>{2, 3, 4};
   })
 .set_attr<FCompute>("FCompute<cpu>", RMSPropAlexUpdate<cpu>)
+.set_attr<FComputeEx>("FComputeEx<cpu>", RMSPropAlexUpdateEx<cpu>)
 .add_argument("weight", "NDArray-or-Symbol", "Weight")
 .add_argument("grad", "NDArray-or-Symbol", "Gradient")
 .add_argument("n", "NDArray-or-Symbol", "n")
@@ -638,5 +652,179 @@ Note that non-zero values for the weight decay option are not supported.
 .add_argument("history", "NDArray-or-Symbol", "History")
 .add_arguments(AdagradParam::__FIELDS__());
 
+NNVM_REGISTER_OP(multi_sgd_update)
+.describe(R"code(Update function for Stochastic Gradient Descent (SDG) optimizer, for
+``num_weights`` weights at once.
+
+The inputs are the list ``weight_0, grad_0, weight_1, grad_1, ...`` and weight ``i``
+is updated as by ``sgd_update`` with learning rate ``lrs[i]`` and weight decay
+``wds[i]``. All weights are updated in one kernel launch per 48 weights.
+
+With ``use_loss_scale``, the inputs end with ``is_finite`` and ``loss_scale``, see
+``multi_all_finite`` and ``dynamic_loss_scale_update``.
+
+)code" ADD_FILELINE)
+.set_num_inputs([](const nnvm::NodeAttrs& attrs) {
+    const MultiSGDParam& param = nnvm::get<MultiSGDParam>(attrs.parsed);
+    return static_cast<uint32_t>(param.num_weights * 2 + MultiUpdateNumLossScaleInputs(param));
+  })
+.set_num_outputs([](const nnvm::NodeAttrs& attrs) {
+    return static_cast<uint32_t>(nnvm::get<MultiSGDParam>(attrs.parsed).num_weights);
+  })
+.set_attr_parser(ParamParser<MultiSGDParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", MultiUpdateShape<MultiSGDParam, 2>)
+.set_attr<nnvm::FInferType>("FInferType", MultiUpdateType<MultiSGDParam, 2, 0>)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    const MultiSGDParam& param = nnvm::get<MultiSGDParam>(attrs.parsed);
+    return MultiUpdateInputNames(param.num_weights, {"weight", "grad"},
+                                 param.use_loss_scale);
+  })
+.set_attr<FCompute>("FCompute<cpu>", MultiSGDUpdate<cpu, MultiSGDParam, false, false>)
+.add_argument("data", "NDArray-or-Symbol[]", "Weights and gradients")
+.add_arguments(MultiSGDParam::__FIELDS__());
+
+NNVM_REGISTER_OP(multi_sgd_mom_update)
+.describe(R"code(Momentum update function for Stochastic Gradient Descent (SGD) optimizer,
+for ``num_weights`` weights at once.
+
+The inputs are the list ``weight_0, grad_0, mom_0, weight_1, grad_1, mom_1, ...`` and
+weight ``i`` is updated as by ``sgd_mom_update`` with learning rate ``lrs[i]`` and
+weight decay ``wds[i]``. All weights are updated in one kernel launch per 48 weights.
+
+With ``use_loss_scale``, the inputs end with ``is_finite`` and ``loss_scale``, see
+``multi_all_finite`` and ``dynamic_loss_scale_update``.
+
+)code" ADD_FILELINE)
+.set_num_inputs([](const nnvm::NodeAttrs& attrs) {
+    const MultiSGDMomParam& param = nnvm::get<MultiSGDMomParam>(attrs.parsed);
+    return static_cast<uint32_t>(param.num_weights * 3 + MultiUpdateNumLossScaleInputs(param));
+  })
+.set_num_outputs([](const nnvm::NodeAttrs& attrs) {
+    return static_cast<uint32_t>(nnvm::get<MultiSGDMomParam>(attrs.parsed).num_weights);
+  })
+.set_attr_parser(ParamParser<MultiSGDMomParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", MultiUpdateShape<MultiSGDMomParam, 3>)
+.set_attr<nnvm::FInferType>("FInferType", MultiUpdateType<MultiSGDMomParam, 3, 0>)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    const MultiSGDMomParam& param = nnvm::get<MultiSGDMomParam>(attrs.parsed);
+    return MultiUpdateInputNames(param.num_weights, {"weight", "grad", "mom"},
+                                 param.use_loss_scale);
+  })
+.set_attr<nnvm::FMutateInputs>("FMutateInputs",
+  [](const nnvm::NodeAttrs& attrs) {
+    return MultiUpdateMutateInputs(nnvm::get<MultiSGDMomParam>(attrs.parsed).num_weights,
+                                   3, {2});
+  })
+.set_attr<FCompute>("FCompute<cpu>", MultiSGDUpdate<cpu, MultiSGDMomParam, true, false>)
+.add_argument("data", "NDArray-or-Symbol[]", "Weights, gradients and momentums")
+.add_arguments(MultiSGDMomParam::__FIELDS__());
+
+NNVM_REGISTER_OP(multi_mp_sgd_update)
+.describe(R"code(Multi-precision update function for Stochastic Gradient Descent (SDG)
+optimizer, for ``num_weights`` weights at once.
+
+The inputs are the list ``weight_0, grad_0, weight32_0, weight_1, ...`` and weight ``i``
+is updated as by ``mp_sgd_update`` with learning rate ``lrs[i]`` and weight decay
+``wds[i]``. All weights are updated in one kernel launch per 48 weights.
+
+With ``use_loss_scale``, the inputs end with ``is_finite`` and ``loss_scale``, see
+``multi_all_finite`` and ``dynamic_loss_scale_update``.
+
+)code" ADD_FILELINE)
+.set_num_inputs([](const nnvm::NodeAttrs& attrs) {
+    const MultiSGDParam& param = nnvm::get<MultiSGDParam>(attrs.parsed);
+    return static_cast<uint32_t>(param.num_weights * 3 + MultiUpdateNumLossScaleInputs(param));
+  })
+.set_num_outputs([](const nnvm::NodeAttrs& attrs) {
+    return static_cast<uint32_t>(nnvm::get<MultiSGDParam>(attrs.parsed).num_weights);
+  })
+.set_attr_parser(ParamParser<MultiSGDParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", MultiUpdateShape<MultiSGDParam, 3>)
+.set_attr<nnvm::FInferType>("FInferType", MultiUpdateType<MultiSGDParam, 3, 1>)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    const MultiSGDParam& param = nnvm::get<MultiSGDParam>(attrs.parsed);
+    return MultiUpdateInputNames(param.num_weights, {"weight", "grad", "weight32"},
+                                 param.use_loss_scale);
+  })
+.set_attr<nnvm::FMutateInputs>("FMutateInputs",
+  [](const nnvm::NodeAttrs& attrs) {
+    return MultiUpdateMutateInputs(nnvm::get<MultiSGDParam>(attrs.parsed).num_weights,
+                                   3, {2});
+  })
+.set_attr<FCompute>("FCompute<cpu>", MultiSGDUpdate<cpu, MultiSGDParam, false, true>)
+.add_argument("data", "NDArray-or-Symbol[]", "Weights, gradients and float32 weights")
+.add_arguments(MultiSGDParam::__FIELDS__());
+
+NNVM_REGISTER_OP(multi_mp_sgd_mom_update)
+.describe(R"code(Multi-precision momentum update function for Stochastic Gradient Descent
+(SGD) optimizer, for ``num_weights`` weights at once.
+
+The inputs are the list ``weight_0, grad_0, mom_0, weight32_0, weight_1, ...`` and
+weight ``i`` is updated as by ``mp_sgd_mom_update`` with learning rate ``lrs[i]`` and
+weight decay ``wds[i]``. All weights are updated in one kernel launch per 48 weights.
+
+With ``use_loss_scale``, the inputs end with ``is_finite`` and ``loss_scale``, see
+``multi_all_finite`` and ``dynamic_loss_scale_update``.
+
+)code" ADD_FILELINE)
+.set_num_inputs([](const nnvm::NodeAttrs& attrs) {
+    const MultiSGDMomParam& param = nnvm::get<MultiSGDMomParam>(attrs.parsed);
+    return static_cast<uint32_t>(param.num_weights * 4 + MultiUpdateNumLossScaleInputs(param));
+  })
+.set_num_outputs([](const nnvm::NodeAttrs& attrs) {
+    return static_cast<uint32_t>(nnvm::get<MultiSGDMomParam>(attrs.parsed).num_weights);
+  })
+.set_attr_parser(ParamParser<MultiSGDMomParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", MultiUpdateShape<MultiSGDMomParam, 4>)
+.set_attr<nnvm::FInferType>("FInferType", MultiUpdateType<MultiSGDMomParam, 4, 2>)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    const MultiSGDMomParam& param = nnvm::get<MultiSGDMomParam>(attrs.parsed);
+    return MultiUpdateInputNames(param.num_weights, {"weight", "grad", "mom", "weight32"},
+                                 param.use_loss_scale);
+  })
+.set_attr<nnvm::FMutateInputs>("FMutateInputs",
+  [](const nnvm::NodeAttrs& attrs) {
+    return MultiUpdateMutateInputs(nnvm::get<MultiSGDMomParam>(attrs.parsed).num_weights,
+                                   4, {2, 3});
+  })
+.set_attr<FCompute>("FCompute<cpu>", MultiSGDUpdate<cpu, MultiSGDMomParam, true, true>)
+.add_argument("data", "NDArray-or-Symbol[]", "Weights, gradients, momentums and float32 weights")
+.add_arguments(MultiSGDMomParam::__FIELDS__());
+
+NNVM_REGISTER_OP(multi_adam_update)
+.describe(R"code(Update function for Adam optimizer, for ``num_weights`` weights at once.
+
+The inputs are the list ``weight_0, grad_0, mean_0, var_0, weight_1, ...`` and weight
+``i`` is updated as by ``adam_update`` with learning rate ``lrs[i]`` and weight decay
+``wds[i]``. All weights are updated in one kernel launch per 48 weights.
+
+)code" ADD_FILELINE)
+.set_num_inputs([](const nnvm::NodeAttrs& attrs) {
+    return static_cast<uint32_t>(nnvm::get<MultiAdamParam>(attrs.parsed).num_weights * 4);
+  })
+.set_num_outputs([](const nnvm::NodeAttrs& attrs) {
+    return static_cast<uint32_t>(nnvm::get<MultiAdamParam>(attrs.parsed).num_weights);
+  })
+.set_attr_parser(ParamParser<MultiAdamParam>)
+.set_attr<nnvm::FInferShape>("FInferShape", MultiUpdateShape<MultiAdamParam, 4>)
+.set_attr<nnvm::FInferType>("FInferType", MultiUpdateType<MultiAdamParam, 4, 0>)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    return MultiUpdateInputNames(nnvm::get<MultiAdamParam>(attrs.parsed).num_weights,
+                                 {"weight", "grad", "mean", "var"});
+  })
+.set_attr<nnvm::FMutateInputs>("FMutateInputs",
+  [](const nnvm::NodeAttrs& attrs) {
+    return MultiUpdateMutateInputs(nnvm::get<MultiAdamParam>(attrs.parsed).num_weights,
+                                   4, {2, 3});
+  })
+.set_attr<FCompute>("FCompute<cpu>", MultiAdamUpdate<cpu>)
+.add_argument("data", "NDArray-or-Symbol[]", "Weights, gradients, means and variances")
+.add_arguments(MultiAdamParam::__FIELDS__());
+
 }  // namespace op
 }  // namespace mxnet
@@ -250,10 +250,12 @@ NNVM_REGISTER_OP(adam_update)
 .set_attr<FComputeEx>("FComputeEx<gpu>", AdamUpdateEx<gpu>);
 
 NNVM_REGISTER_OP(rmsprop_update)
-.set_attr<FCompute>("FCompute<gpu>", RMSPropUpdate<gpu>);
+.set_attr<FCompute>("FCompute<gpu>", RMSPropUpdate<gpu>)
+.set_attr<FComputeEx>("FComputeEx<gpu>", RMSPropUpdateEx<gpu>);
 
 NNVM_REGISTER_OP(rmspropalex_update)
-.set_attr<FCompute>("FCompute<gpu>", RMSPropAlexUpdate<gpu>);
+.set_attr<FCompute>("FCompute<gpu>", RMSPropAlexUpdate<gpu>)
+.set_attr<FComputeEx>("FComputeEx<gpu>", RMSPropAlexUpdateEx<gpu>);
 
 NNVM_REGISTER_OP(ftrl_update)
 .set_attr<FCompute>("FCompute<gpu>", FtrlUpdate<gpu>)
@@ -262,5 +264,20 @@ NNVM_REGISTER_OP(ftrl_update)
 NNVM_REGISTER_OP(_sparse_adagrad_update)
 .set_attr<FComputeEx>("FComputeEx<gpu>", AdagradUpdateEx<gpu>);
 
+NNVM_REGISTER_OP(multi_sgd_update)
+.set_attr<FCompute>("FCompute<gpu>", MultiSGDUpdate<gpu, MultiSGDParam, false, false>);
+
+NNVM_REGISTER_OP(multi_sgd_mom_update)
+.set_attr<FCompute>("FCompute<gpu>", MultiSGDUpdate<gpu, MultiSGDMomParam, true, false>);
+
+NNVM_REGISTER_OP(multi_mp_sgd_update)
+.set_attr<FCompute>("FCompute<gpu>", MultiSGDUpdate<gpu, MultiSGDParam, false, true>);
+
+NNVM_REGISTER_OP(multi_mp_sgd_mom_update)
+.set_attr<FCompute>("FCompute<gpu>", MultiSGDUpdate<gpu, MultiSGDMomParam, true, true>);
+
+NNVM_REGISTER_OP(multi_adam_update)
+.set_attr<FCompute>("FCompute<gpu>", MultiAdamUpdate<gpu>);
+
 }  // namespace op
 }  // namespace mxnet
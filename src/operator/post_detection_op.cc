@@ -1,9 +1,9 @@
 #include "./post_detection_op-inl.h"
 
-#include <thrust/sort.h>
-#include <thrust/execution_policy.h>
-#include <thrust/functional.h>
+#include <algorithm>
 #include <memory>
+#include <vector>
+#include "../engine/openmp.h"
 
 namespace mshadow {
 
@@ -13,29 +13,26 @@ void nonlinear_clip(
   DType* _pred_boxes,
   const DType im_w, const DType im_h,
   const int B, const int N, const int C) {
+  #pragma omp parallel for num_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
   for( int j=0; j<B*N; j++) {
     // nonlinear
-    DType w = boxes[j*5+1+2] - boxes[j*5+1+0] + 1.0;
-    DType h = boxes[j*5+1+3] - boxes[j*5+1+1] + 1.0;
-    DType cx = boxes[j*5+1+0] + 0.5 * (w - 1.0);
-    DType cy = boxes[j*5+1+1] + 0.5 * (h - 1.0);
+    const DType w = boxes[j*5+1+2] - boxes[j*5+1+0] + 1.0;
+    const DType h = boxes[j*5+1+3] - boxes[j*5+1+1] + 1.0;
+    const DType cx = boxes[j*5+1+0] + 0.5 * (w - 1.0);
+    const DType cy = boxes[j*5+1+1] + 0.5 * (h - 1.0);
+    const DType* deltas = box_deltas + j*C*4;
+    DType* pred = _pred_boxes + j*C*4;
+    // no cross-iteration dependency over classes, lets the compiler vectorize
     for( int c=0; c<C; c++) {
-      int i=j*C+c;
-      DType pred_cx = box_deltas[i*4+0] * w + cx;
-      DType pred_cy = box_deltas[i*4+1] * h + cy;
-      DType pred_w = std::exp(box_deltas[i*4+2]) * w;
-      DType pred_h = std::exp(box_deltas[i*4+3]) * h;
-
-      _pred_boxes[i*4+0] = pred_cx - 0.5 * (pred_w - 1.0);
-      _pred_boxes[i*4+1] = pred_cy - 0.5 * (pred_h - 1.0);
-      _pred_boxes[i*4+2] = pred_cx + 0.5 * (pred_w - 1.0);
-      _pred_boxes[i*4+3] = pred_cy + 0.5 * (pred_h - 1.0);
-
+      const DType pred_cx = deltas[c*4+0] * w + cx;
+      const DType pred_cy = deltas[c*4+1] * h + cy;
+      const DType half_w = 0.5 * (std::exp(deltas[c*4+2]) * w - 1.0);
+      const DType half_h = 0.5 * (std::exp(deltas[c*4+3]) * h - 1.0);
       // clip
-      _pred_boxes[i*4+0] = std::max(std::min(_pred_boxes[i*4+0], im_w-1), (DType)0.0);
-      _pred_boxes[i*4+1] = std::max(std::min(_pred_boxes[i*4+1], im_h-1), (DType)0.0);
-      _pred_boxes[i*4+2] = std::max(std::min(_pred_boxes[i*4+2], im_w-1), (DType)0.0);
-      _pred_boxes[i*4+3] = std::max(std::min(_pred_boxes[i*4+3], im_h-1), (DType)0.0);
+      pred[c*4+0] = std::max(std::min(pred_cx - half_w, im_w-1), (DType)0.0);
+      pred[c*4+1] = std::max(std::min(pred_cy - half_h, im_h-1), (DType)0.0);
+      pred[c*4+2] = std::max(std::min(pred_cx + half_w, im_w-1), (DType)0.0);
+      pred[c*4+3] = std::max(std::min(pred_cy + half_h, im_h-1), (DType)0.0);
     }
   }
 }
@@ -43,26 +40,23 @@ void nonlinear_clip(
 template <typename DType>
 void _fore_back_enhance(const DType* scores, DType* ehanced_score,
   const int B, const int N, const int C) {
+  #pragma omp parallel for num_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
   for(int i=0; i<B*N; i++) {
+    const DType* score = scores + i*C;
+    DType* enhanced = ehanced_score + i*C;
     DType max_val = 0.0;
     for(int c=0; c<C; c++) {
-      DType cur_val = scores[i*C+c];
-      if(cur_val > max_val) max_val = cur_val;
+      max_val = std::max(max_val, score[c]);
     }
-    DType sum_val = 0.0;
+    DType sum_val = score[0];
+    enhanced[0] = score[0];
     for(int c=1; c<C; c++) {
-      DType cur_val = scores[i*C+c];
-      if(cur_val >= max_val) {
-        ehanced_score[i*C+c] = cur_val;
-      } else {
-        ehanced_score[i*C+c] = 0.0;
-      }
-      sum_val += ehanced_score[i*C+c];
+      enhanced[c] = score[c] >= max_val ? score[c] : (DType)0.0;
+      sum_val += enhanced[c];
     }
-    ehanced_score[i*C+0] = scores[i*C+0];
-    sum_val += ehanced_score[i*C+0];
+    const DType inv_sum = (DType)1.0 / sum_val;
     for(int c=0; c<C; c++) {
-      ehanced_score[i*C+c] /= sum_val;
+      enhanced[c] *= inv_sum;
     }
   }
 }
@@ -72,45 +66,50 @@ void weighted_nms(
   const DType* boxes, const DType* scores, const int* cls, const int* _order, const int n_box_this_batch,
   const float thresh_lo, const float thresh_hi,
   DType* keep_out, int &keep_num ) {
-
-  DType* areas = new DType[n_box_this_batch];
-  for(int i=0; i<n_box_this_batch; i++) {
-    areas[i] = (boxes[4*i+2]-boxes[4*i+0]+(DType)1.0) *
-               (boxes[4*i+3]-boxes[4*i+1]+(DType)1.0);
+  // the remaining boxes are kept compacted in score order as structure of
+  // arrays, so the IoU of the top box against all of them is one contiguous
+  // loop without gathers
+  std::vector<int> order(_order, _order + n_box_this_batch);
+  std::vector<DType> x1(n_box_this_batch), y1(n_box_this_batch);
+  std::vector<DType> x2(n_box_this_batch), y2(n_box_this_batch);
+  std::vector<DType> areas(n_box_this_batch), ovr(n_box_this_batch);
+  for(int j=0; j<n_box_this_batch; j++) {
+    const int oj = order[j];
+    x1[j] = boxes[4*oj+0]; y1[j] = boxes[4*oj+1];
+    x2[j] = boxes[4*oj+2]; y2[j] = boxes[4*oj+3];
+    areas[j] = (x2[j]-x1[j]+(DType)1.0) * (y2[j]-y1[j]+(DType)1.0);
   }
-  DType* ovr = new DType[n_box_this_batch];
   int n_keep = n_box_this_batch;
-  int first_remaining_object = 0;
   keep_num = 0;
-  std::vector<int> order(_order, _order + n_box_this_batch);
-  std::vector<int> inds;
-  inds.reserve(n_box_this_batch);
-  while( n_keep > 0 ) {
-    inds.clear();
-    int i=order[0];
-    DType x1 = boxes[4*i+0]; DType x2 = boxes[4*i+2];
-    DType y1 = boxes[4*i+1]; DType y2 = boxes[4*i+3];
+  while( n_keep > 0 && !order.empty() ) {
+    const int n_remain = order.size();
+    const int i = order[0];
+    const DType bx1 = x1[0], by1 = y1[0], bx2 = x2[0], by2 = y2[0];
+    const DType barea = areas[0];
+    for(int j=0; j<n_remain; j++) {
+      const DType w = std::max((DType)0.0, std::min(bx2, x2[j]) - std::max(bx1, x1[j]) + (DType)1.0);
+      const DType h = std::max((DType)0.0, std::min(by2, y2[j]) - std::max(by1, y1[j]) + (DType)1.0);
+      const DType inter = w*h;
+      ovr[j] = inter / (barea + areas[j] - inter); // iou
+    }
     DType tmp = 0.0;
     DType avg_x1 = 0.0, avg_x2 = 0.0, avg_y1 = 0.0, avg_y2 = 0.0;
-    for(unsigned int j=0; j<order.size(); j++) {
-      int oj = order[j];
-      DType xx1 = std::max((DType)x1, boxes[4*oj+0]);
-      DType xx2 = std::min((DType)x2, boxes[4*oj+2]);
-      DType yy1 = std::max((DType)y1, boxes[4*oj+1]);
-      DType yy2 = std::min((DType)y2, boxes[4*oj+3]);
-      DType w = std::max((DType)0.0, xx2-xx1+(DType)1.0);
-      DType h = std::max((DType)0.0, yy2-yy1+(DType)1.0);
-      DType inter = w*h;
-      ovr[j] = inter / (areas[i] + areas[oj] - inter); // iou
+    int n_next = 0;
+    for(int j=0; j<n_remain; j++) {
       if( ovr[j] <= thresh_lo ) {
-        inds.push_back(oj);
+        // compact in place, n_next <= j
+        order[n_next] = order[j];
+        x1[n_next] = x1[j]; y1[n_next] = y1[j];
+        x2[n_next] = x2[j]; y2[n_next] = y2[j];
+        areas[n_next] = areas[j];
+        n_next++;
       } else if( ovr[j] > thresh_hi ) {
-        DType score_j = scores[j];
+        const DType score_j = scores[j];
         tmp += score_j;
-        avg_x1 += score_j * xx1;
-        avg_x2 += score_j * xx2;
-        avg_y1 += score_j * yy1;
-        avg_y2 += score_j * yy2;
+        avg_x1 += score_j * std::max(bx1, x1[j]);
+        avg_x2 += score_j * std::min(bx2, x2[j]);
+        avg_y1 += score_j * std::max(by1, y1[j]);
+        avg_y2 += score_j * std::min(by2, y2[j]);
         n_keep --;
       }
     }
@@ -122,11 +121,62 @@ void weighted_nms(
     keep_out[keep_num*6+4] = scores[i];
     keep_out[keep_num*6+5] = cls[i];
     keep_num++;
-    order.clear();
-    order.swap(inds);
+    order.resize(n_next);
   } // while( n_keep > 0 )
-  delete[] areas;
-  delete[] ovr;
+}
+
+template <typename DType>
+void post_detection_batch(
+  const DType* _pred_boxes, const DType* _enhance_scores,
+  const int b, const int N, const int C, const DType thresh,
+  const float thresh_lo, const float thresh_hi,
+  DType* out_batch_boxes, DType* out_batch_boxes_rois) {
+  // collect the boxes above threshold, each box takes its last qualifying class
+  std::vector<DType> _boxes_batch;
+  std::vector<DType> _score_batch;
+  std::vector<int> _class_batch;
+  for( int n=0; n<N; n++) {
+    int class_idx = 0;
+    DType keep_score = 0.0;
+    for( int c=1; c<C; c++) { // skip background
+      const DType score = _enhance_scores[b*N*C+n*C+c];
+      if(score > thresh) {
+        keep_score = score;
+        class_idx = c;
+      }
+    }
+    if(class_idx == 0) continue;
+    const DType* box = _pred_boxes + b*(4*C*N)+n*4*C+4*class_idx;
+    _boxes_batch.insert(_boxes_batch.end(), box, box + 4);
+    _score_batch.push_back(keep_score);
+    _class_batch.push_back(class_idx);
+  }
+  const int n_box_this_batch = _score_batch.size();
+
+  // argsort
+  std::vector<int> _order_batch(n_box_this_batch);
+  for(int k=0; k<n_box_this_batch; k++) _order_batch[k] = k;
+  std::stable_sort(_order_batch.begin(), _order_batch.end(),
+    [&_score_batch](const int l, const int r) { return _score_batch[l] > _score_batch[r]; });
+
+  // nms for this batch
+  int keep_num;
+  std::vector<DType> _keep_out(6*N);
+  weighted_nms(
+    _boxes_batch.data(), _score_batch.data(), _class_batch.data(), _order_batch.data(),
+    n_box_this_batch, thresh_lo, thresh_hi,
+    _keep_out.data(), keep_num);
+
+  for(int k=0; k<keep_num; k++) {
+    int out_idx = b * N + k;
+    out_batch_boxes_rois[out_idx * 5 + 0] = b;
+    for(int l=0; l<6; l++) {
+      out_batch_boxes[out_idx * 6 + l] = _keep_out[k * 6 + l]; // x1, y1, x2, y2, score, cls
+      if (l < 4) {
+        out_batch_boxes_rois[out_idx * 5 + l + 1] = _keep_out[k * 6 + l]; // b, x1, y1, x2, y2,
+      }
+    }
+  }
 }
 
 template <typename DType>
@@ -137,7 +187,6 @@ inline void PostDetctionForward(const Tensor<cpu, 2, DType> &rois,
                                 const Tensor<cpu, 3, DType> &batch_boxes,
                                 const Tensor<cpu, 2, DType> &batch_boxes_rois,
                                 const mxnet::op::PostDetectionOpParam &params_) {
-  // std::cout << "-- PostDetctionForward --" << std::endl;
   const DType *in_rois = rois.dptr_;
   const DType *in_scrs = scores.dptr_;
   const DType *in_bbdt = bbox_deltas.dptr_;
@@ -153,96 +202,22 @@ inline void PostDetctionForward(const Tensor<cpu, 2, DType> &rois,
   DType im_h = im_info[0][0];
   DType im_w = im_info[0][1];
   // nonlinear_pred + clipboxes
-  DType* _pred_boxes = new DType[N*B*(4*C)];
+  std::vector<DType> _pred_boxes(N*B*(4*C));
   nonlinear_clip(in_rois, in_bbdt,  // in
-    _pred_boxes,                    // out
+    _pred_boxes.data(),             // out
     im_w, im_h, B, N, C); // params
 
   // fore_back_enhance
-  DType* _enhance_scores = new DType[N*B*C];
-  _fore_back_enhance(in_scrs, _enhance_scores, B, N, C);
-
-  // each single batch
-  int* _keep = new int[N];
-  int* _class = new int[N];
-  DType* _keep_score = new DType[N]; // store the score of each box;
+  std::vector<DType> _enhance_scores(N*B*C);
+  _fore_back_enhance(in_scrs, _enhance_scores.data(), B, N, C);
 
+  // images are independent, each writes its own slice of the outputs
+  #pragma omp parallel for num_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
   for(int b=0; b<B; b++) {
-    memset(_keep, 0, N*sizeof(int));  // init as 0
-    int n_box_this_batch = 0;
-    for( int c=1; c<C; c++) { // skip background
-      for( int n=0; n<N; n++) {
-        int idx=b*N*C+n*C+c;
-        if(_enhance_scores[idx] > thresh) {
-          _keep[n] = 1;
-          _keep_score[n] = _enhance_scores[idx];
-          _class[n] = c;
-          n_box_this_batch += 1;
-        }
-      }
-    }
-    // prepare data for NMS
-    DType* _boxes_batch = new DType[n_box_this_batch*4];
-    DType* _score_batch = new DType[n_box_this_batch];
-    DType* _score_batch_copy = new DType[n_box_this_batch];
-    int* _class_batch = new int[n_box_this_batch];
-    int* _order_batch = new int[n_box_this_batch];
-    int box_batch_idx = 0;
-    for( int n=0; n<N; n++) {
-      if(_keep[n] == 1) {
-        int keep_idx = box_batch_idx*4;
-        int class_idx = _class[n];
-        int actual_idx = b*(4*C*N)+n*4*C+4*class_idx;
-        for(int bb=0; bb<4; bb++) {
-          _boxes_batch[keep_idx+bb] = _pred_boxes[actual_idx+bb];
-        }
-        _score_batch[box_batch_idx] = _keep_score[n];
-        _score_batch_copy[box_batch_idx] = _keep_score[n];
-        _order_batch[box_batch_idx] = box_batch_idx;
-        _class_batch[box_batch_idx] = _class[n];
-        box_batch_idx ++;
-      }
-    }
-
-    // argsort
-    thrust::stable_sort_by_key(thrust::host,
-        _score_batch_copy,
-        _score_batch_copy + n_box_this_batch,
-        _order_batch,
-        thrust::greater<float>());
-
-    // nms for this batch
-    // prepare output variables
-    int keep_num;
-    DType* _keep_out = new DType[6*N];
-    weighted_nms(
-      _boxes_batch, _score_batch, _class_batch, _order_batch, n_box_this_batch,
-      params_.nms_thresh_lo, params_.nms_thresh_hi,
-      _keep_out, keep_num);
-
-    for(int k=0; k<keep_num; k++) {
-      int out_idx = b * N + k;
-      out_batch_boxes_rois[out_idx * 5 + 0] = b;
-      for(int l=0; l<6; l++) {
-        out_batch_boxes[out_idx * 6 + l] = _keep_out[k * 6 + l]; // x1, y1, x2, y2, score, cls
-        if (l < 4) {
-          out_batch_boxes_rois[out_idx * 5 + l + 1] = _keep_out[k * 6 + l]; // b, x1, y1, x2, y2,
-        }
-      }
-    }
-
-    delete[] _keep_out;
-    delete[] _boxes_batch;
-    delete[] _score_batch;
-    delete[] _score_batch_copy;
-    delete[] _order_batch;
-  } // end of iterate through batch
-
-  delete[] _keep;
-  delete[] _class;
-
-  delete[] _pred_boxes;
-  delete[] _enhance_scores;
+    post_detection_batch(_pred_boxes.data(), _enhance_scores.data(), b, N, C, thresh,
+                         params_.nms_thresh_lo, params_.nms_thresh_hi,
+                         out_batch_boxes, out_batch_boxes_rois);
+  }
 }
 
 template <typename DType>
@@ -25,6 +25,7 @@ namespace op {
 namespace proposal_mask_target_enum {
 enum ProposalMaskTargetInputs {kRois, kGtBboxes, kGtPolys};
 enum ProposalMaskTargetOutputs {kRoiOutput, kLabel, kBboxTarget, kBboxWeight, kMaskTarget};
+enum ProposalMaskTargetResource {kRandom, kTempSpace};
 }
 
 struct ProposalMaskTargetParam : public dmlc::Parameter<ProposalMaskTargetParam> {
@@ -292,6 +293,12 @@ class ProposalMaskTargetProp : public OperatorProperty {
     return {};
   }
 
+  std::vector<ResourceRequest> ForwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    // used by the gpu implementation for sampling and scratch space
+    return {ResourceRequest::kRandom, ResourceRequest::kTempSpace};
+  }
+
   std::string TypeString() const override {
     return "ProposalMaskTarget";
   }
@@ -9,6 +9,7 @@
 #include <cstdio>
 #include "./proposal_mask_target-inl.h"
 #include "../coco_api/common/maskApi.h"
+#include "../engine/openmp.h"
 using std::min;
 using std::max;
 using std::vector;
@@ -39,45 +40,26 @@ inline void convertPoly2Mask(const DType *roi,
       int n_seg = static_cast<int>(poly[1]);
 
       int offset = 2 + n_seg;
-      RLE* rles;
-
-      rlesInit(&rles, n_seg);
+      // rasterize every segment straight into one byte mask, no RLE round trip
+      std::vector<byte> byte_mask(mask_size * mask_size, 0);
+      std::vector<double> xys;
       for(int i = 0; i < n_seg; i++){
         int cur_len = poly[i+2];
-        double* xys = new double[cur_len];
+        xys.resize(cur_len);
         for(int j = 0; j < cur_len; j++){
           if (j % 2 == 0)
             xys[j] = (poly[offset+j+1] - roi[2]) * mask_size / h;
           else
             xys[j] = (poly[offset+j-1] - roi[1]) * mask_size / w;
-
-
         }
-        rleFrPoly(rles + i, xys, cur_len/2, mask_size, mask_size);
-        delete [] xys;
+        polyToMask(xys.data(), cur_len/2, mask_size, mask_size, byte_mask.data());
         offset += cur_len;
       }
-      // Decode RLE to mask
-      byte* byte_mask = new byte[mask_size*mask_size*n_seg];
-      rleDecode(rles, byte_mask, n_seg);
 
       DType* mask_cat = mask + category * mask_size * mask_size;
-      // Flatten mask
       for(int j = 0; j < mask_size*mask_size; j++){
-        float cur_byte = 0;
-        for(int i = 0; i< n_seg; i++){
-          int offset = i * mask_size * mask_size + j;
-          if(byte_mask[offset]==1){
-            cur_byte = 1;
-            break;
-          }
-        }
-        mask_cat[j] = cur_byte;
+        mask_cat[j] = byte_mask[j];
       }
-
-      // Check to make sure we don't have memory leak
-      rlesFree(&rles, n_seg);
-      delete [] byte_mask;
 } // convertPoly2Mask
 
 namespace mshadow{
@@ -196,6 +178,7 @@ inline void SampleROIMask(const Tensor<cpu, 2, DType> &all_rois,
 
   ExpandBboxRegressionTargets(bbox_target_data, bbox_targets, bbox_weights, num_classes, bbox_weight);
 
+  #pragma omp parallel for num_threads(mxnet::engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
   for (index_t i=0; i < fg_rois_this_image; ++i) {
     convertPoly2Mask(rois[i].dptr_, gt_polys[gt_assignment[kept_indexes[i]]].dptr_, mask_size, mask_targets[i].dptr_);
   }
@@ -280,15 +263,6 @@ Operator *CreateOp<cpu>(ProposalMaskTargetParam param, int dtype) {
   return op;
 }
 
-template<>
-Operator *CreateOp<gpu>(ProposalMaskTargetParam param, int dtype) {
-  Operator *op = NULL;
-  MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
-    op = new ProposalMaskTargetOp<gpu, DType>(param);
-  })
-  return op;
-}
-
 Operator *ProposalMaskTargetProp::CreateOperatorEx(Context ctx, std::vector<TShape> *in_shape,
                                                std::vector<int> *in_type) const {
   std::vector<TShape> out_shape, aux_shape;
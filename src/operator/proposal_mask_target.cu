@@ -0,0 +1,174 @@
+/*!
+ * Copyright (c) 2018 by TuSimple
+ * \file proposal_mask_target.cu
+ * \brief GPU version proposal mask target
+ *  IoU computation, fg/bg sampling and polygon rasterization all stay on the
+ *  device, so the op no longer round-trips rois and polygons through the host.
+ */
+#include <dmlc/logging.h>
+#include <mshadow/tensor.h>
+#include <vector>
+#include "./proposal_mask_target-inl.h"
+#include "./proposal_target-inl.cuh"
+
+namespace mshadow {
+namespace cuda {
+namespace proposal_mask_target {
+
+// one block per fg roi: rasterize the assigned gt polygons into the mask of
+// their category with an even-odd test at pixel centers.
+// poly layout: [category, n_seg, len_0, ..., len_{n_seg-1}, x0, y0, x1, y1, ...]
+template <typename DType>
+__global__ void MaskKernel(const int fg_rois_per_image, const int rois_per_image, const int G,
+                           const int poly_len, const int num_classes, const int mask_size,
+                           const DType* out_rois, const int* kept, const int* fg_count,
+                           const int* assignment, const DType* gt_polys, DType* mask_targets) {
+  extern __shared__ char poly_smem[];
+  DType* poly = reinterpret_cast<DType*>(poly_smem);
+  const int b = blockIdx.x / fg_rois_per_image;
+  const int i = blockIdx.x % fg_rois_per_image;
+  if (i >= fg_count[b]) return;
+  const int row = b * rois_per_image + i;
+  const DType* src_poly = gt_polys + (b * G + assignment[kept[row]]) * poly_len;
+  for (int k = threadIdx.x; k < poly_len; k += blockDim.x) poly[k] = src_poly[k];
+  __syncthreads();
+
+  const DType* roi = out_rois + row * 5;
+  const DType w = max(DType(1), roi[3] - roi[1]);
+  const DType h = max(DType(1), roi[4] - roi[2]);
+  const int category = static_cast<int>(poly[0]);
+  const int n_seg = static_cast<int>(poly[1]);
+  DType* mask = mask_targets +
+      ((b * fg_rois_per_image + i) * num_classes + category) * mask_size * mask_size;
+  for (int p = threadIdx.x; p < mask_size * mask_size; p += blockDim.x) {
+    const DType px = p % mask_size + 0.5f;
+    const DType py = p / mask_size + 0.5f;
+    bool inside = false;
+    int offset = 2 + n_seg;
+    for (int s = 0; s < n_seg && !inside; ++s) {
+      const int n_pts = static_cast<int>(poly[2 + s]) / 2;
+      const DType* xy = poly + offset;
+      bool odd = false;
+      for (int a = 0, c = n_pts - 1; a < n_pts; c = a++) {
+        const DType xa = (xy[2 * a] - roi[1]) * mask_size / w;
+        const DType ya = (xy[2 * a + 1] - roi[2]) * mask_size / h;
+        const DType xc = (xy[2 * c] - roi[1]) * mask_size / w;
+        const DType yc = (xy[2 * c + 1] - roi[2]) * mask_size / h;
+        if ((ya > py) != (yc > py) &&
+            px < (xc - xa) * (py - ya) / (yc - ya) + xa) {
+          odd = !odd;
+        }
+      }
+      inside = odd;
+      offset += 2 * n_pts;
+    }
+    mask[p] = inside ? DType(1) : DType(0);
+  }
+}
+
+}  // namespace proposal_mask_target
+}  // namespace cuda
+}  // namespace mshadow
+
+namespace mxnet {
+namespace op {
+
+template<typename DType>
+class ProposalMaskTargetGPUOp : public Operator {
+ public:
+  explicit ProposalMaskTargetGPUOp(ProposalMaskTargetParam param) {
+    this->param_ = param;
+  }
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    using namespace mshadow::cuda;
+    using namespace mshadow::cuda::proposal_mask_target;
+    CHECK_EQ(in_data.size(), 3);
+    CHECK_EQ(out_data.size(), 5);
+    CHECK_EQ(req.size(), 5);
+    CHECK(!param_.ohem) << "OHEM not Implemented.";
+
+    Stream<gpu> *s = ctx.get_stream<gpu>();
+    Tensor<gpu, 3, DType> rois      = in_data[proposal_mask_target_enum::kRois].get<gpu, 3, DType>(s);
+    Tensor<gpu, 3, DType> gt_bboxes = in_data[proposal_mask_target_enum::kGtBboxes].get<gpu, 3, DType>(s);
+    Tensor<gpu, 3, DType> gt_polys  = in_data[proposal_mask_target_enum::kGtPolys].get<gpu, 3, DType>(s);
+
+    Tensor<gpu, 2, DType> out_rois     = out_data[proposal_mask_target_enum::kRoiOutput].get<gpu, 2, DType>(s);
+    Tensor<gpu, 1, DType> labels       = out_data[proposal_mask_target_enum::kLabel].get<gpu, 1, DType>(s);
+    Tensor<gpu, 2, DType> bbox_targets = out_data[proposal_mask_target_enum::kBboxTarget].get<gpu, 2, DType>(s);
+    Tensor<gpu, 2, DType> bbox_weights = out_data[proposal_mask_target_enum::kBboxWeight].get<gpu, 2, DType>(s);
+    Tensor<gpu, 4, DType> mask_targets = out_data[proposal_mask_target_enum::kMaskTarget].get<gpu, 4, DType>(s);
+
+    const int num_image = rois.size(0);
+    const int N = rois.size(1) + (param_.proposal_without_gt ? 0 : gt_bboxes.size(1));
+    const int rois_per_image = param_.img_rois;
+    const int fg_rois_per_image = static_cast<int>(param_.img_rois * param_.fg_fraction);
+    Tensor<gpu, 1, char> workspace = ctx.requested[proposal_mask_target_enum::kTempSpace]
+      .get_space_typed<gpu, 1, char>(Shape1(
+        proposal_target::SampleWorkspaceSize<DType>(num_image, N, rois_per_image)), s);
+    Random<gpu, float> *prnd = ctx.requested[proposal_mask_target_enum::kRandom]
+      .get_random<gpu, float>(s);
+
+    out_rois = 0.f;
+    labels = 0.f;
+    bbox_targets = 0.f;
+    bbox_weights = 0.f;
+    mask_targets = -1.f;
+    proposal_target::SampleResult sampled = proposal_target::SampleROIs(
+      param_, rois, gt_bboxes, rois_per_image, fg_rois_per_image, prnd, workspace,
+      out_rois, labels, bbox_targets, bbox_weights);
+
+    if (fg_rois_per_image > 0 && num_image * N > 0) {
+      const int poly_len = gt_polys.size(2);
+      MaskKernel<<<num_image * fg_rois_per_image, kMaxThreadsPerBlock,
+                   poly_len * sizeof(DType), Stream<gpu>::GetStream(s)>>>(
+        fg_rois_per_image, rois_per_image, gt_bboxes.size(1), poly_len, param_.num_classes,
+        param_.mask_size, out_rois.dptr_, sampled.kept, sampled.fg_count, sampled.assignment,
+        gt_polys.dptr_, mask_targets.dptr_);
+      MSHADOW_CUDA_POST_KERNEL_CHECK(MaskKernel);
+    }
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    Stream<gpu> *s = ctx.get_stream<gpu>();
+    for (size_t i = 0; i < in_grad.size(); ++i) {
+      Tensor<gpu, 1, DType> grad = in_grad[i].FlatTo1D<gpu, DType>(s);
+      grad = 0.f;
+    }
+  }
+
+ private:
+  ProposalMaskTargetParam param_;
+};  // class ProposalMaskTargetGPUOp
+
+template<>
+Operator *CreateOp<gpu>(ProposalMaskTargetParam param, int dtype) {
+  Operator *op = NULL;
+  switch (dtype) {
+    case mshadow::kFloat32:
+      op = new ProposalMaskTargetGPUOp<float>(param);
+      break;
+    case mshadow::kFloat64:
+      op = new ProposalMaskTargetGPUOp<double>(param);
+      break;
+    default:
+      LOG(FATAL) << "ProposalMaskTarget on gpu only supports float32 and float64";
+  }
+  return op;
+}
+
+}  // namespace op
+}  // namespace mxnet
@@ -0,0 +1,305 @@
+/*!
+ * Copyright (c) 2018 by TuSimple
+ * \file proposal_target-inl.cuh
+ * \brief Device-side roi sampling shared by ProposalTarget and ProposalMaskTarget
+ *  The IoU matrix of every image in the batch is reduced by one kernel, and
+ *  fg/bg sampling is done like the shuffle op: random keys are sorted with
+ *  SortByKey, so no data is copied to the host.
+ */
+#ifndef MXNET_OPERATOR_PROPOSAL_TARGET_INL_CUH_
+#define MXNET_OPERATOR_PROPOSAL_TARGET_INL_CUH_
+
+#include <mshadow/tensor.h>
+#include <algorithm>
+#include "./tensor/sort_op.h"
+
+namespace mshadow {
+namespace cuda {
+namespace proposal_target {
+
+// sampling categories, also the order in which candidates are sorted
+enum Category {kFg = 0, kBg = 1, kNeg = 2, kInvalid = 3};
+
+// |  rois [B, R, 5] (batch_idx, x1, y1, x2, y2)
+// |  gt_boxes [B, G, 5] (x1, y1, x2, y2, cls), cls == -1 for padding
+// -> cands [B, N, 5] with N = R (+ G if gt boxes are appended)
+template <typename DType>
+__global__ void BuildCandidatesKernel(const int count, const int R, const int G, const int N,
+                                      const DType* rois, const DType* gt_boxes,
+                                      DType* cands, int* valid) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    const int b = index / N;
+    const int j = index % N;
+    DType* cand = cands + index * 5;
+    if (j < R) {
+      const DType* roi = rois + (b * R + j) * 5;
+      for (int k = 0; k < 5; ++k) cand[k] = roi[k];
+      valid[index] = 1;
+    } else {
+      const DType* gt = gt_boxes + (b * G + j - R) * 5;
+      cand[0] = b;
+      for (int k = 0; k < 4; ++k) cand[k + 1] = gt[k];
+      valid[index] = gt[4] != -1;
+    }
+  }
+}
+
+// one thread per candidate: max IoU over the valid gt boxes of its image,
+// the assigned gt, and a sort key grouping (image, category, random order)
+template <typename DType>
+__global__ void OverlapKernel(const int count, const int N, const int G,
+                              const DType* cands, const int* valid, const DType* gt_boxes,
+                              const float fg_thresh, const float bg_thresh_hi,
+                              const float bg_thresh_lo, int* assignment, DType* labels,
+                              float* keys, int* values) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    const int b = index / N;
+    const DType* box = cands + index * 5;
+    DType max_value = 0;
+    int max_index = 0;
+    bool has_gt = false;
+    for (int k = 0; k < G; ++k) {
+      const DType* gt = gt_boxes + (b * G + k) * 5;
+      if (gt[4] == -1) continue;
+      DType overlap = 0;
+      DType iw = min(box[3], gt[2]) - max(box[1], gt[0]) + 1;
+      if (iw > 0) {
+        DType ih = min(box[4], gt[3]) - max(box[2], gt[1]) + 1;
+        if (ih > 0) {
+          DType box_area = (box[3] - box[1] + 1) * (box[4] - box[2] + 1);
+          DType gt_area = (gt[2] - gt[0] + 1) * (gt[3] - gt[1] + 1);
+          overlap = iw * ih / (box_area + gt_area - iw * ih);
+        }
+      }
+      if (!has_gt || max_value < overlap) {
+        max_value = overlap;
+        max_index = k;
+      }
+      has_gt = true;
+    }
+    assignment[index] = max_index;
+    labels[index] = has_gt ? gt_boxes[(b * G + max_index) * 5 + 4] : DType(0);
+    int category = kNeg;
+    if (!valid[index]) {
+      category = kInvalid;
+    } else if (max_value >= fg_thresh) {
+      category = kFg;
+    } else if (max_value >= bg_thresh_lo && max_value < bg_thresh_hi) {
+      category = kBg;
+    }
+    // keys hold a uniform [0, 1) sample on entry
+    keys[index] = b * 4 + category + 0.5f * keys[index];
+    values[index] = index;
+  }
+}
+
+__device__ inline int KeyCategory(const float key, const int b) {
+  return static_cast<int>(key) - b * 4;
+}
+
+// one thread per image: take fg, then bg, then pad with random negatives
+__global__ void SelectKernel(const int num_image, const int N, const int rois_per_image,
+                             const int fg_rois_per_image, const float* keys, const int* values,
+                             int* kept, int* fg_count) {
+  for (int b = blockIdx.x * blockDim.x + threadIdx.x;
+       b < num_image;
+       b += blockDim.x * gridDim.x) {
+    const float* key = keys + b * N;
+    const int* value = values + b * N;
+    int n_fg = 0, n_bg = 0, n_neg = 0;
+    for (int j = 0; j < N; ++j) {
+      const int category = KeyCategory(key[j], b);
+      if (category == kFg) ++n_fg;
+      if (category == kBg) ++n_bg;
+      if (category == kBg || category == kNeg) ++n_neg;
+    }
+    const int fg_this = min(fg_rois_per_image, n_fg);
+    const int bg_this = min(rois_per_image - fg_this, n_bg);
+    int* out = kept + b * rois_per_image;
+    int i = 0;
+    for (int j = 0; j < fg_this; ++j) out[i++] = value[j];
+    for (int j = 0; j < bg_this; ++j) out[i++] = value[n_fg + j];
+    for (int j = 0; i < rois_per_image; ++j) {
+      if (n_neg > 0) {
+        out[i++] = value[n_fg + (bg_this + j) % n_neg];
+      } else {
+        out[i++] = value[N > 0 ? j % max(n_fg, 1) : 0];
+      }
+    }
+    fg_count[b] = fg_this;
+  }
+}
+
+// one thread per output roi: rois, labels and expanded regression targets
+template <typename DType>
+__global__ void TargetKernel(const int count, const int rois_per_image, const int G,
+                             const int num_classes, const DType* cands, const int* kept,
+                             const int* fg_count, const int* assignment, const DType* labels,
+                             const DType* gt_boxes,
+                             const float m0, const float m1, const float m2, const float m3,
+                             const float s0, const float s1, const float s2, const float s3,
+                             const float w0, const float w1, const float w2, const float w3,
+                             DType* out_rois, DType* out_labels,
+                             DType* bbox_targets, DType* bbox_weights) {
+  for (int index = blockIdx.x * blockDim.x + threadIdx.x;
+       index < count;
+       index += blockDim.x * gridDim.x) {
+    const int b = index / rois_per_image;
+    const int i = index % rois_per_image;
+    const int src = kept[index];
+    const DType* roi = cands + src * 5;
+    for (int k = 0; k < 5; ++k) out_rois[index * 5 + k] = roi[k];
+    const DType label = i < fg_count[b] ? labels[src] : DType(0);
+    out_labels[index] = label;
+    const int cls = static_cast<int>(label);
+    if (cls <= 0) continue;
+    const DType* gt = gt_boxes + (b * G + assignment[src]) * 5;
+    DType ex_width  = roi[3] - roi[1] + 1;
+    DType ex_height = roi[4] - roi[2] + 1;
+    DType ex_ctr_x  = roi[1] + 0.5f * (ex_width - 1);
+    DType ex_ctr_y  = roi[2] + 0.5f * (ex_height - 1);
+    DType gt_width  = gt[2] - gt[0] + 1;
+    DType gt_height = gt[3] - gt[1] + 1;
+    DType gt_ctr_x  = gt[0] + 0.5f * (gt_width - 1);
+    DType gt_ctr_y  = gt[1] + 0.5f * (gt_height - 1);
+    DType* target = bbox_targets + index * num_classes * 4 + cls * 4;
+    DType* weight = bbox_weights + index * num_classes * 4 + cls * 4;
+    target[0] = ((gt_ctr_x - ex_ctr_x) / (ex_width + 1e-14f) - m0) / s0;
+    target[1] = ((gt_ctr_y - ex_ctr_y) / (ex_height + 1e-14f) - m1) / s1;
+    target[2] = (log(gt_width / ex_width) - m2) / s2;
+    target[3] = (log(gt_height / ex_height) - m3) / s3;
+    weight[0] = w0;
+    weight[1] = w1;
+    weight[2] = w2;
+    weight[3] = w3;
+  }
+}
+
+/*! \brief device buffers filled by SampleROIs */
+struct SampleResult {
+  /*! \brief index into the candidates of every output roi, [B * rois_per_image] */
+  const int* kept;
+  /*! \brief number of fg rois sampled for every image, [B] */
+  const int* fg_count;
+  /*! \brief gt box assigned to every candidate, [B * N] */
+  const int* assignment;
+};
+
+/*!
+ * \brief bytes of temp space needed by SampleROIs
+ * \param num_image number of images
+ * \param N candidates per image
+ * \param rois_per_image sampled rois per image
+ */
+template <typename DType>
+inline size_t SampleWorkspaceSize(const int num_image, const int N, const int rois_per_image,
+                                  size_t* offsets = nullptr) {
+  const int num_cand = num_image * N;
+  const size_t sizes[8] = {
+    sizeof(DType) * num_cand * 5,  // candidate boxes
+    sizeof(DType) * num_cand,      // labels of assigned gt
+    sizeof(int) * num_cand,        // valid flags
+    sizeof(int) * num_cand,        // assigned gt
+    sizeof(float) * num_cand,      // sort keys
+    sizeof(int) * num_cand,        // sort values
+    sizeof(int) * (num_image * rois_per_image + num_image),  // kept indices and fg counts
+    mxnet::op::SortByKeyWorkspaceSize<float, int, gpu>(num_cand)
+  };
+  size_t total = 0;
+  for (int i = 0; i < 8; ++i) {
+    if (offsets != nullptr) offsets[i] = total;
+    total += (sizes[i] + 255) / 256 * 256;
+  }
+  if (offsets != nullptr) offsets[8] = sizes[7];
+  return total;
+}
+
+/*!
+ * \brief sample rois for the whole batch and write rois, labels and bbox targets
+ * \param param ProposalTargetParam or ProposalMaskTargetParam
+ * \param rois proposals [B, R, 5]
+ * \param gt_boxes ground truth [B, G, 5], padded with cls == -1
+ * \param rois_per_image output rois per image
+ * \param fg_rois_per_image maximum fg rois per image
+ * \param workspace at least SampleWorkspaceSize bytes
+ * Outputs are expected to be zero-initialized.
+ */
+template <typename DType, typename Param>
+inline SampleResult SampleROIs(const Param& param,
+                               const Tensor<gpu, 3, DType>& rois,
+                               const Tensor<gpu, 3, DType>& gt_boxes,
+                               const int rois_per_image,
+                               const int fg_rois_per_image,
+                               Random<gpu, float>* prnd,
+                               const Tensor<gpu, 1, char>& workspace,
+                               Tensor<gpu, 2, DType> out_rois,
+                               Tensor<gpu, 1, DType> labels,
+                               Tensor<gpu, 2, DType> bbox_targets,
+                               Tensor<gpu, 2, DType> bbox_weights) {
+  Stream<gpu>* s = rois.stream_;
+  const int num_image = rois.size(0);
+  const int R = rois.size(1);
+  const int G = gt_boxes.size(1);
+  const int N = R + (param.proposal_without_gt ? 0 : G);
+  const int num_cand = num_image * N;
+  const int num_kept = num_image * rois_per_image;
+
+  size_t offsets[9];
+  CHECK_GE(workspace.size(0), SampleWorkspaceSize<DType>(num_image, N, rois_per_image, offsets));
+  char* base = workspace.dptr_;
+  DType* cands = reinterpret_cast<DType*>(base + offsets[0]);
+  DType* cand_labels = reinterpret_cast<DType*>(base + offsets[1]);
+  int* valid = reinterpret_cast<int*>(base + offsets[2]);
+  int* assignment = reinterpret_cast<int*>(base + offsets[3]);
+  Tensor<gpu, 1, float> keys(reinterpret_cast<float*>(base + offsets[4]), Shape1(num_cand), s);
+  Tensor<gpu, 1, int> values(reinterpret_cast<int*>(base + offsets[5]), Shape1(num_cand), s);
+  int* kept = reinterpret_cast<int*>(base + offsets[6]);
+  int* fg_count = kept + num_kept;
+  Tensor<gpu, 1, char> sort_workspace(base + offsets[7], Shape1(offsets[8]), s);
+  SampleResult result{kept, fg_count, assignment};
+  if (num_cand == 0) return result;
+
+  cudaStream_t stream = Stream<gpu>::GetStream(s);
+  const int threads = kMaxThreadsPerBlock;
+  auto blocks = [threads](int count) {
+    return std::min((count + threads - 1) / threads, static_cast<int>(kMaxGridNum));
+  };
+
+  BuildCandidatesKernel<<<blocks(num_cand), threads, 0, stream>>>(
+    num_cand, R, G, N, rois.dptr_, gt_boxes.dptr_, cands, valid);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(BuildCandidatesKernel);
+
+  prnd->SampleUniform(&keys, 0.f, 1.f);
+  OverlapKernel<<<blocks(num_cand), threads, 0, stream>>>(
+    num_cand, N, G, cands, valid, gt_boxes.dptr_, param.fg_thresh, param.bg_thresh_hi,
+    param.bg_thresh_lo, assignment, cand_labels, keys.dptr_, values.dptr_);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(OverlapKernel);
+
+  // groups candidates by image, then category, in random order inside each
+  mxnet::op::SortByKey(keys, values, true, &sort_workspace);
+
+  SelectKernel<<<blocks(num_image), threads, 0, stream>>>(
+    num_image, N, rois_per_image, fg_rois_per_image, keys.dptr_, values.dptr_,
+    kept, fg_count);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(SelectKernel);
+
+  TargetKernel<<<blocks(num_kept), threads, 0, stream>>>(
+    num_kept, rois_per_image, G, param.num_classes, cands, kept, fg_count, assignment,
+    cand_labels, gt_boxes.dptr_,
+    param.bbox_mean[0], param.bbox_mean[1], param.bbox_mean[2], param.bbox_mean[3],
+    param.bbox_std[0], param.bbox_std[1], param.bbox_std[2], param.bbox_std[3],
+    param.bbox_weight[0], param.bbox_weight[1], param.bbox_weight[2], param.bbox_weight[3],
+    out_rois.dptr_, labels.dptr_, bbox_targets.dptr_, bbox_weights.dptr_);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(TargetKernel);
+  return result;
+}
+
+}  // namespace proposal_target
+}  // namespace cuda
+}  // namespace mshadow
+
+#endif  // MXNET_OPERATOR_PROPOSAL_TARGET_INL_CUH_
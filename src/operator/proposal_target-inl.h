@@ -25,6 +25,7 @@ namespace op {
 namespace proposal_target_enum {
 enum ProposalTargetInputs {kRois, kGtBboxes};
 enum ProposalTargetOutputs {kRoiOutput, kLabel, kBboxTarget, kBboxWeight};
+enum ProposalTargetResource {kRandom, kTempSpace};
 }
 
 struct ProposalTargetParam : public dmlc::Parameter<ProposalTargetParam> {
@@ -271,6 +272,12 @@ class ProposalTargetProp : public OperatorProperty {
     return {};
   }
 
+  std::vector<ResourceRequest> ForwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    // used by the gpu implementation for sampling and scratch space
+    return {ResourceRequest::kRandom, ResourceRequest::kTempSpace};
+  }
+
   std::string TypeString() const override {
     return "ProposalTarget";
   }
@@ -242,15 +242,6 @@ Operator *CreateOp<cpu>(ProposalTargetParam param, int dtype) {
   return op;
 }
 
-template<>
-Operator *CreateOp<gpu>(ProposalTargetParam param, int dtype) {
-  Operator *op = NULL;
-  MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
-    op = new ProposalTargetOp<gpu, DType>(param);
-  })
-  return op;
-}
-
 Operator *ProposalTargetProp::CreateOperatorEx(Context ctx, std::vector<TShape> *in_shape,
                                                std::vector<int> *in_type) const {
   std::vector<TShape> out_shape, aux_shape;
@@ -0,0 +1,107 @@
+/*!
+ * Copyright (c) 2018 by TuSimple
+ * \file proposal_target.cu
+ * \brief GPU version proposal target
+ *  The IoU matrix of the whole batch is built by one kernel and fg/bg rois are
+ *  sampled on the device, replacing the per-image host loops.
+ */
+#include <dmlc/logging.h>
+#include <mshadow/tensor.h>
+#include <vector>
+#include "./proposal_target-inl.h"
+#include "./proposal_target-inl.cuh"
+
+namespace mxnet {
+namespace op {
+
+template<typename DType>
+class ProposalTargetGPUOp : public Operator {
+ public:
+  explicit ProposalTargetGPUOp(ProposalTargetParam param) {
+    this->param_ = param;
+  }
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    using namespace mshadow::cuda;
+    CHECK_EQ(in_data.size(), 2);
+    CHECK_EQ(out_data.size(), 4);
+    CHECK_EQ(req.size(), 4);
+    CHECK(!param_.ohem) << "OHEM not Implemented.";
+
+    Stream<gpu> *s = ctx.get_stream<gpu>();
+    const index_t num_image         = in_data[proposal_target_enum::kRois].shape_[0];
+    const index_t num_roi           = in_data[proposal_target_enum::kRois].Size() / (num_image * 5);
+    const index_t num_gtbbox        = in_data[proposal_target_enum::kGtBboxes].Size() / (num_image * 5);
+    const index_t num_roi_per_image = param_.batch_rois / param_.batch_images;
+    CHECK_EQ(num_image * num_roi_per_image, param_.batch_rois)
+      << "batch_rois must be divisible by the number of images";
+
+    Tensor<gpu, 3, DType> rois      = in_data[proposal_target_enum::kRois].
+                                      get_with_shape<gpu, 3, DType>(Shape3(num_image, num_roi, 5), s);
+    Tensor<gpu, 3, DType> gt_bboxes = in_data[proposal_target_enum::kGtBboxes].
+                                      get_with_shape<gpu, 3, DType>(Shape3(num_image, num_gtbbox, 5), s);
+
+    Tensor<gpu, 2, DType> out_rois     = out_data[proposal_target_enum::kRoiOutput].get<gpu, 2, DType>(s);
+    Tensor<gpu, 1, DType> labels       = out_data[proposal_target_enum::kLabel].get<gpu, 1, DType>(s);
+    Tensor<gpu, 2, DType> bbox_targets = out_data[proposal_target_enum::kBboxTarget].get<gpu, 2, DType>(s);
+    Tensor<gpu, 2, DType> bbox_weights = out_data[proposal_target_enum::kBboxWeight].get<gpu, 2, DType>(s);
+
+    const int N = num_roi + (param_.proposal_without_gt ? 0 : num_gtbbox);
+    const int fg_rois_per_image = static_cast<int>(num_roi_per_image * param_.fg_fraction);
+    Tensor<gpu, 1, char> workspace = ctx.requested[proposal_target_enum::kTempSpace]
+      .get_space_typed<gpu, 1, char>(Shape1(
+        proposal_target::SampleWorkspaceSize<DType>(num_image, N, num_roi_per_image)), s);
+    Random<gpu, float> *prnd = ctx.requested[proposal_target_enum::kRandom]
+      .get_random<gpu, float>(s);
+
+    out_rois = 0.f;
+    labels = 0.f;
+    bbox_targets = 0.f;
+    bbox_weights = 0.f;
+    proposal_target::SampleROIs(param_, rois, gt_bboxes, num_roi_per_image, fg_rois_per_image,
+                                prnd, workspace, out_rois, labels, bbox_targets, bbox_weights);
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    Stream<gpu> *s = ctx.get_stream<gpu>();
+    for (size_t i = 0; i < in_grad.size(); ++i) {
+      Tensor<gpu, 1, DType> grad = in_grad[i].FlatTo1D<gpu, DType>(s);
+      grad = 0.f;
+    }
+  }
+
+ private:
+  ProposalTargetParam param_;
+};  // class ProposalTargetGPUOp
+
+template<>
+Operator *CreateOp<gpu>(ProposalTargetParam param, int dtype) {
+  Operator *op = NULL;
+  switch (dtype) {
+    case mshadow::kFloat32:
+      op = new ProposalTargetGPUOp<float>(param);
+      break;
+    case mshadow::kFloat64:
+      op = new ProposalTargetGPUOp<double>(param);
+      break;
+    default:
+      LOG(FATAL) << "ProposalTarget on gpu only supports float32 and float64";
+  }
+  return op;
+}
+
+}  // namespace op
+}  // namespace mxnet
@@ -0,0 +1,134 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file mkldnn_quantized_gemm.cc
+ * \brief int8 gemm of the quantized cpu operators through the MKLDNN inner product
+ */
+#if MXNET_USE_MKLDNN == 1
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "../quantization_utils.h"
+#include "../../nn/mkldnn/mkldnn_base-inl.h"
+
+namespace mxnet {
+namespace op {
+
+/*!
+ * \brief inner product of an (2m, n) u8 source with the (k, n) s8 weights
+ *
+ *  MKLDNN only multiplies u8 by s8, and without VNNI it sums the pairs of
+ *  products in int16 with saturation. The rows of a are therefore split into
+ *  their positive and negative parts, each below 128, so the sums of pairs
+ *  fit into int16 for the int8 values in [-127, 127] the quantize operator
+ *  produces, and c is the difference of the two halves of the output.
+ */
+class MKLDNNQuantizedGemmForward {
+  std::shared_ptr<mkldnn::memory> src;
+  std::shared_ptr<mkldnn::memory> user_weight;
+  std::shared_ptr<mkldnn::memory> weight;
+  std::shared_ptr<mkldnn::memory> out;
+  std::shared_ptr<mkldnn::reorder> reorder;
+  std::shared_ptr<mkldnn::inner_product_forward> fwd;
+  int m, n, k;
+
+ public:
+  MKLDNNQuantizedGemmForward(int m, int n, int k) : m(m), n(n), k(k) {
+    using mkldnn::memory;
+    auto engine = CpuEngine::Get()->get_engine();
+    memory::desc src_md({2 * m, n}, memory::data_type::u8, memory::format::nc);
+    memory::desc weight_md({k, n}, memory::data_type::s8, memory::format::any);
+    memory::desc out_md({2 * m, k}, memory::data_type::s32, memory::format::nc);
+    mkldnn::inner_product_forward::desc desc(mkldnn::prop_kind::forward_scoring,
+                                             src_md, weight_md, out_md);
+    mkldnn::inner_product_forward::primitive_desc pd(desc, engine);
+    src.reset(new memory(pd.src_primitive_desc()));
+    out.reset(new memory(pd.dst_primitive_desc()));
+    memory::primitive_desc user_weight_pd(
+        {{k, n}, memory::data_type::s8, memory::format::oi}, engine);
+    user_weight.reset(new memory(user_weight_pd, nullptr));
+    if (pd.weights_primitive_desc() == user_weight_pd) {
+      weight = user_weight;
+    } else {
+      weight.reset(new memory(pd.weights_primitive_desc()));
+      reorder.reset(new mkldnn::reorder(*user_weight, *weight));
+    }
+    fwd.reset(new mkldnn::inner_product_forward(pd, mkldnn::primitive::at(*src),
+                                                mkldnn::primitive::at(*weight), *out));
+  }
+
+  void Execute(const int8_t* a, const int8_t* b, int32_t* c) {
+    const int64_t size = static_cast<int64_t>(m) * n;
+    uint8_t* pos = static_cast<uint8_t*>(src->get_data_handle());
+    uint8_t* neg = pos + size;
+    #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+    for (int64_t i = 0; i < size; ++i) {
+      pos[i] = static_cast<uint8_t>(std::max<int>(a[i], 0));
+      neg[i] = static_cast<uint8_t>(std::max<int>(-a[i], 0));
+    }
+    user_weight->set_data_handle(const_cast<int8_t*>(b));
+    std::vector<mkldnn::primitive> net;
+    if (reorder != nullptr) net.push_back(*reorder);
+    net.push_back(*fwd);
+    mkldnn::stream(mkldnn::stream::kind::eager).submit(net).wait();
+    const int32_t* out_pos = static_cast<const int32_t*>(out->get_data_handle());
+    const int32_t* out_neg = out_pos + static_cast<int64_t>(m) * k;
+    const int64_t out_size = static_cast<int64_t>(m) * k;
+    #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+    for (int64_t i = 0; i < out_size; ++i) {
+      c[i] = out_pos[i] - out_neg[i];
+    }
+  }
+};
+
+bool MKLDNNQuantizedGemm(int m, int n, int k, const int8_t* a, const int8_t* b,
+                         int32_t* c) {
+  // nullptr marks the shapes the MKLDNN build has no int8 inner product for
+  static thread_local std::unordered_map<OpSignature,
+                                         std::shared_ptr<MKLDNNQuantizedGemmForward>,
+                                         OpHash> fwds;
+  OpSignature key;
+  key.AddSign(m);
+  key.AddSign(n);
+  key.AddSign(k);
+  auto it = fwds.find(key);
+  MKLDNNQuantizedGemmForward* fwd;
+  if (it == fwds.end()) {
+    std::shared_ptr<MKLDNNQuantizedGemmForward> new_fwd;
+    try {
+      new_fwd = std::make_shared<MKLDNNQuantizedGemmForward>(m, n, k);
+    } catch (const mkldnn::error& e) {
+      LOG(INFO) << "MKLDNN has no int8 inner product for (" << m << ", " << n << ") * ("
+                << k << ", " << n << ").T, falling back to the native kernel: " << e.message;
+    }
+    fwd = AddToCache(&fwds, key, new_fwd).get();
+  } else {
+    fwd = it->second.get();
+  }
+  if (fwd == nullptr) return false;
+  fwd->Execute(a, b, c);
+  return true;
+}
+
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_USE_MKLDNN == 1
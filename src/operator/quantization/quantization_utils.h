@@ -26,8 +26,17 @@
 
 #include <mxnet/base.h>
 #include <algorithm>
+#include <cstring>
+#include <vector>
 #include "../mxnet_op.h"
 
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(__CUDACC__)
+#include <emmintrin.h>
+#define MXNET_QUANTIZED_GEMM_USE_SSE2 1
+#else
+#define MXNET_QUANTIZED_GEMM_USE_SSE2 0
+#endif
+
 namespace mxnet {
 namespace op {
 
@@ -169,6 +178,148 @@ struct QuantizationRangeForMultiplicationStruct {
   }
 };
 
+#if MXNET_USE_MKLDNN == 1
+/*!
+ * \brief c = a * b.T through the MKLDNN int8 inner product, with the shapes of
+ *  QuantizedGemmCPU. Returns false if MKLDNN cannot run it.
+ */
+bool MKLDNNQuantizedGemm(int m, int n, int k, const int8_t* a, const int8_t* b,
+                         int32_t* c);
+#endif
+
+namespace quantized_gemm {
+/*! \brief rows of a in a register tile */
+const int kMR = 4;
+/*! \brief rows of b in a register tile, the int32 sums of a row of the tile fill 2 xmm */
+const int kNR = 8;
+
+/*!
+ * \brief copy the rows [row, row + rows) of the (num_rows, n) int8 matrix x into a
+ *  tile of tile_rows rows widened to int16. Pairs of consecutive elements of a row
+ *  are stored next to each other and the tile rows after each other for each pair,
+ *  rows past the matrix and the odd element past n are zero.
+ */
+inline void PackTile(const int8_t* x, int num_rows, int n, int row, int tile_rows,
+                     int16_t* tile) {
+  const int num_pairs = (n + 1) / 2;
+  for (int q = 0; q < num_pairs; ++q) {
+    for (int r = 0; r < tile_rows; ++r) {
+      const int8_t* x_row = x + static_cast<int64_t>(row + r) * n;
+      const bool valid = row + r < num_rows;
+      tile[(q * tile_rows + r) * 2] = valid ? x_row[2 * q] : 0;
+      tile[(q * tile_rows + r) * 2 + 1] = valid && 2 * q + 1 < n ? x_row[2 * q + 1] : 0;
+    }
+  }
+}
+
+/*!
+ * \brief acc = tile_a * tile_b.T for tiles packed by PackTile. Each pair of a row of
+ *  tile_a is multiplied with the pairs of all rows of tile_b and the two products
+ *  summed in int32 by pmaddwd, which cannot saturate as pmaddubsw does for int8.
+ */
+inline void MultiplyTiles(int num_pairs, const int16_t* tile_a, const int16_t* tile_b,
+                          int32_t acc[kMR][kNR]) {
+#if MXNET_QUANTIZED_GEMM_USE_SSE2
+  __m128i sums[kMR][2];
+  for (int r = 0; r < kMR; ++r) sums[r][0] = sums[r][1] = _mm_setzero_si128();
+  for (int q = 0; q < num_pairs; ++q) {
+    const int16_t* pairs_b = tile_b + q * kNR * 2;
+    const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pairs_b));
+    const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pairs_b + 8));
+    for (int r = 0; r < kMR; ++r) {
+      int32_t pair;
+      std::memcpy(&pair, tile_a + (q * kMR + r) * 2, sizeof(pair));
+      const __m128i pair_a = _mm_set1_epi32(pair);
+      sums[r][0] = _mm_add_epi32(sums[r][0], _mm_madd_epi16(pair_a, b0));
+      sums[r][1] = _mm_add_epi32(sums[r][1], _mm_madd_epi16(pair_a, b1));
+    }
+  }
+  for (int r = 0; r < kMR; ++r) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc[r]), sums[r][0]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc[r] + 4), sums[r][1]);
+  }
+#else
+  for (int r = 0; r < kMR; ++r) {
+    for (int c = 0; c < kNR; ++c) acc[r][c] = 0;
+  }
+  for (int q = 0; q < num_pairs; ++q) {
+    const int16_t* pairs_b = tile_b + q * kNR * 2;
+    for (int r = 0; r < kMR; ++r) {
+      const int32_t a0 = tile_a[(q * kMR + r) * 2];
+      const int32_t a1 = tile_a[(q * kMR + r) * 2 + 1];
+      for (int c = 0; c < kNR; ++c) {
+        acc[r][c] += a0 * pairs_b[2 * c] + a1 * pairs_b[2 * c + 1];
+      }
+    }
+  }
+#endif  // MXNET_QUANTIZED_GEMM_USE_SSE2
+}
+}  // namespace quantized_gemm
+
+/*!
+ * \brief c = a * b.T on cpu, for int8 a of shape (m, n), int8 b of shape (k, n)
+ *  and int32 c of shape (m, k). Runs the MKLDNN int8 inner product when MXNet is
+ *  built with MKLDNN. Otherwise a and b are packed into tiles of kMR and kNR
+ *  rows widened to int16, and every tile of c is summed in registers.
+ */
+inline void QuantizedGemmCPU(int m, int n, int k, const int8_t* a, const int8_t* b,
+                             int32_t* c) {
+  using namespace quantized_gemm;
+#if MXNET_USE_MKLDNN == 1
+  if (MKLDNNQuantizedGemm(m, n, k, a, b, c)) return;
+#endif
+  const int num_pairs = (n + 1) / 2;
+  const int tiles_a = (m + kMR - 1) / kMR;
+  const int tiles_b = (k + kNR - 1) / kNR;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  std::vector<int16_t> packed_a(static_cast<size_t>(tiles_a) * kMR * num_pairs * 2);
+  std::vector<int16_t> packed_b(static_cast<size_t>(tiles_b) * kNR * num_pairs * 2);
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int t = 0; t < tiles_a; ++t) {
+    PackTile(a, m, n, t * kMR, kMR, packed_a.data() + static_cast<size_t>(t) * kMR * num_pairs * 2);
+  }
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int t = 0; t < tiles_b; ++t) {
+    PackTile(b, k, n, t * kNR, kNR, packed_b.data() + static_cast<size_t>(t) * kNR * num_pairs * 2);
+  }
+  // consecutive tasks share the tile of b, which stays in cache
+  const int64_t num_tasks = static_cast<int64_t>(tiles_a) * tiles_b;
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int64_t task = 0; task < num_tasks; ++task) {
+    const int ta = static_cast<int>(task % tiles_a), tb = static_cast<int>(task / tiles_a);
+    int32_t acc[kMR][kNR];
+    MultiplyTiles(num_pairs, packed_a.data() + static_cast<size_t>(ta) * kMR * num_pairs * 2,
+                  packed_b.data() + static_cast<size_t>(tb) * kNR * num_pairs * 2, acc);
+    const int rows = std::min(kMR, m - ta * kMR), cols = std::min(kNR, k - tb * kNR);
+    for (int r = 0; r < rows; ++r) {
+      int32_t* c_row = c + static_cast<int64_t>(ta * kMR + r) * k + tb * kNR;
+      for (int j = 0; j < cols; ++j) c_row[j] = acc[r][j];
+    }
+  }
+}
+
+/*!
+ * \brief add the int8 bias of channel (i / spatial_size) % bias_size to every
+ *  element i of the int32 output on cpu, rounding as the gpu kernels do
+ */
+inline void QuantizedBiasAddCPU(size_t size, size_t bias_size, size_t spatial_size,
+                                int32_t* out, const int8_t* bias,
+                                float min_out, float max_out,
+                                float min_bias, float max_bias) {
+  using mshadow::red::limits::MaxValue;
+  const float float_for_one_out_quant =
+    MaxAbs(min_out, max_out) / static_cast<double>(MaxValue<int32_t>());
+  const float float_for_one_bias_quant =
+    MaxAbs(min_bias, max_bias) / static_cast<double>(MaxValue<int8_t>());
+  #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int64_t i = 0; i < static_cast<int64_t>(size); ++i) {
+    const size_t channel_id = (i / spatial_size) % bias_size;
+    out[i] = (out[i] * float_for_one_out_quant +
+              bias[channel_id] * float_for_one_bias_quant) /
+             float_for_one_out_quant;
+  }
+}
+
 }  // namespace op
 }  // namespace mxnet
 #endif  // MXNET_OPERATOR_QUANTIZATION_QUANTIZATION_UTILS_H_
@@ -38,15 +38,36 @@ namespace op {
 
 struct QuantizeParam : public dmlc::Parameter<QuantizeParam> {
   int   out_type;
+  dmlc::optional<float> min_calib_range;  // min float value calculated from calibration dataset
+  dmlc::optional<float> max_calib_range;  // max float value calculated from calibration dataset
   DMLC_DECLARE_PARAMETER(QuantizeParam) {
     DMLC_DECLARE_FIELD(out_type)
     .add_enum("int8", mshadow::kInt8)
     .add_enum("uint8", mshadow::kUint8)
     .set_default(mshadow::kUint8)
     .describe("Output data type.");
+    DMLC_DECLARE_FIELD(min_calib_range)
+    .set_default(dmlc::optional<float>())
+    .describe("The minimum scalar value in the form of float32 obtained "
+              "through calibration. If present together with max_calib_range, "
+              "data is the only input and min_range/max_range are not taken.");
+    DMLC_DECLARE_FIELD(max_calib_range)
+    .set_default(dmlc::optional<float>())
+    .describe("The maximum scalar value in the form of float32 obtained "
+              "through calibration. If present together with min_calib_range, "
+              "data is the only input and min_range/max_range are not taken.");
   }
 };
 
+/*! \brief whether the range of the quantize op comes from calibration */
+inline bool QuantizeCalibrated(const QuantizeParam& param) {
+  return param.min_calib_range.has_value() && param.max_calib_range.has_value();
+}
+
+inline uint32_t QuantizeNumInputs(const nnvm::NodeAttrs& attrs) {
+  return QuantizeCalibrated(nnvm::get<QuantizeParam>(attrs.parsed)) ? 1 : 3;
+}
+
 // quantize float to uint8_t
 struct quantize_unsigned {
   template<typename DstDType, typename SrcDType>
@@ -54,12 +75,18 @@ struct quantize_unsigned {
                                   float *omax_range, const SrcDType *in,
                                   const float *imin_range, const float *imax_range,
                                   const double min_limit, const double max_limit) {
-    using mshadow::red::limits::MinValue;
-    using mshadow::red::limits::MaxValue;
-    const float scale = (max_limit - min_limit) / (*imax_range - *imin_range);
-    out[i] = static_cast<DstDType>((in[i] - *imin_range) * scale + 0.5);
-    *omin_range = *imin_range;
-    *omax_range = *imax_range;
+    Map(i, out, omin_range, omax_range, in, *imin_range, *imax_range, min_limit, max_limit);
+  }
+
+  template<typename DstDType, typename SrcDType>
+  MSHADOW_XINLINE static void Map(int i, DstDType *out, float *omin_range,
+                                  float *omax_range, const SrcDType *in,
+                                  const float imin_range, const float imax_range,
+                                  const double min_limit, const double max_limit) {
+    const float scale = (max_limit - min_limit) / (imax_range - imin_range);
+    out[i] = static_cast<DstDType>((in[i] - imin_range) * scale + 0.5);
+    *omin_range = imin_range;
+    *omax_range = imax_range;
   }
 };
 
@@ -71,7 +98,15 @@ struct quantize_zero_centered {
                                   float *omax_range, const SrcDType *in,
                                   const float *imin_range, const float *imax_range,
                                   const float quantized_range) {
-    float real_range = MaxAbs(*imin_range, *imax_range);
+    Map(i, out, omin_range, omax_range, in, *imin_range, *imax_range, quantized_range);
+  }
+
+  template<typename DstDType, typename SrcDType>
+  MSHADOW_XINLINE static void Map(int i, DstDType *out, float *omin_range,
+                                  float *omax_range, const SrcDType *in,
+                                  const float imin_range, const float imax_range,
+                                  const float quantized_range) {
+    float real_range = MaxAbs(imin_range, imax_range);
     float scale = quantized_range / real_range;
     SrcDType x = in[i];
     out[i] = static_cast<DstDType>(
@@ -94,16 +129,31 @@ void QuantizeCompute(const nnvm::NodeAttrs& attrs,
   Stream<xpu> *s = ctx.get_stream<xpu>();
 
   const QuantizeParam& param = nnvm::get<QuantizeParam>(attrs.parsed);
+  const bool calibrated = QuantizeCalibrated(param);
   if (param.out_type == mshadow::kUint8) {
-    Kernel<quantize_unsigned, xpu>::Launch(s, outputs[0].Size(),
-      outputs[0].dptr<uint8_t>(), outputs[1].dptr<float>(), outputs[2].dptr<float>(),
-      inputs[0].dptr<float>(), inputs[1].dptr<float>(), inputs[2].dptr<float>(),
-      MinValue<uint8_t>(), MaxValue<uint8_t>());
+    if (calibrated) {
+      Kernel<quantize_unsigned, xpu>::Launch(s, outputs[0].Size(),
+        outputs[0].dptr<uint8_t>(), outputs[1].dptr<float>(), outputs[2].dptr<float>(),
+        inputs[0].dptr<float>(), param.min_calib_range.value(), param.max_calib_range.value(),
+        MinValue<uint8_t>(), MaxValue<uint8_t>());
+    } else {
+      Kernel<quantize_unsigned, xpu>::Launch(s, outputs[0].Size(),
+        outputs[0].dptr<uint8_t>(), outputs[1].dptr<float>(), outputs[2].dptr<float>(),
+        inputs[0].dptr<float>(), inputs[1].dptr<float>(), inputs[2].dptr<float>(),
+        MinValue<uint8_t>(), MaxValue<uint8_t>());
+    }
   } else if (param.out_type == mshadow::kInt8) {  // zero-centered quantization
-    Kernel<quantize_zero_centered, xpu>::Launch(s, outputs[0].Size(),
-      outputs[0].dptr<int8_t>(), outputs[1].dptr<float>(), outputs[2].dptr<float>(),
-      inputs[0].dptr<float>(), inputs[1].dptr<float>(), inputs[2].dptr<float>(),
-      MinAbs(MaxValue<int8_t>(), MinValue<int8_t>()));
+    if (calibrated) {
+      Kernel<quantize_zero_centered, xpu>::Launch(s, outputs[0].Size(),
+        outputs[0].dptr<int8_t>(), outputs[1].dptr<float>(), outputs[2].dptr<float>(),
+        inputs[0].dptr<float>(), param.min_calib_range.value(), param.max_calib_range.value(),
+        MinAbs(MaxValue<int8_t>(), MinValue<int8_t>()));
+    } else {
+      Kernel<quantize_zero_centered, xpu>::Launch(s, outputs[0].Size(),
+        outputs[0].dptr<int8_t>(), outputs[1].dptr<float>(), outputs[2].dptr<float>(),
+        inputs[0].dptr<float>(), inputs[1].dptr<float>(), inputs[2].dptr<float>(),
+        MinAbs(MaxValue<int8_t>(), MinValue<int8_t>()));
+    }
   } else {
     LOG(FATAL) << "quantize op only supports int8 and uint8 as output type";
   }
@@ -112,10 +162,10 @@ void QuantizeCompute(const nnvm::NodeAttrs& attrs,
 inline bool QuantizeShape(const nnvm::NodeAttrs& attrs,
                           std::vector<TShape> *in_attrs,
                           std::vector<TShape> *out_attrs) {
-  CHECK_EQ(in_attrs->size(), 3U);
+  CHECK_EQ(in_attrs->size(), QuantizeNumInputs(attrs));
   CHECK_EQ(out_attrs->size(), 3U);
 
-  for (size_t i = 1; i < 3; ++i) {
+  for (size_t i = 1; i < in_attrs->size(); ++i) {
     SHAPE_ASSIGN_CHECK(*in_attrs, i, TShape({1}));
   }
 
@@ -128,12 +178,12 @@ inline bool QuantizeShape(const nnvm::NodeAttrs& attrs,
 inline bool QuantizeType(const nnvm::NodeAttrs& attrs,
                          std::vector<int> *in_attrs,
                          std::vector<int> *out_attrs) {
-  CHECK_EQ(in_attrs->size(), 3U);
+  CHECK_EQ(in_attrs->size(), QuantizeNumInputs(attrs));
   CHECK_EQ(out_attrs->size(), 3U);
   const QuantizeParam& param = nnvm::get<QuantizeParam>(attrs.parsed);
-  TYPE_ASSIGN_CHECK(*in_attrs, 0, mshadow::kFloat32);
-  TYPE_ASSIGN_CHECK(*in_attrs, 1, mshadow::kFloat32);
-  TYPE_ASSIGN_CHECK(*in_attrs, 2, mshadow::kFloat32);
+  for (size_t i = 0; i < in_attrs->size(); ++i) {
+    TYPE_ASSIGN_CHECK(*in_attrs, i, mshadow::kFloat32);
+  }
   if (param.out_type == mshadow::kUint8) {
     TYPE_ASSIGN_CHECK(*out_attrs, 0, mshadow::kUint8);
   } else if (param.out_type == mshadow::kInt8) {
@@ -50,13 +50,17 @@ where
 `quantized_range = MinAbs(max(int8), min(int8))` and
 `scale = quantized_range / MaxAbs(min_range, max_range).`
 
+When both `min_calib_range` and `max_calib_range` are given, they replace `min_range`
+and `max_range`, and `data` is the only input.
+
 .. Note::
     This operator only supports forward propogation. DO NOT use it in training.)code" ADD_FILELINE)
 .set_attr_parser(ParamParser<QuantizeParam>)
-.set_num_inputs(3)
+.set_num_inputs(QuantizeNumInputs)
 .set_num_outputs(3)
 .set_attr<nnvm::FListInputNames>("FListInputNames",
   [](const NodeAttrs& attrs) {
+    if (QuantizeNumInputs(attrs) == 1) return std::vector<std::string>{"data"};
     return std::vector<std::string>{"data", "min_range", "max_range"};
   })
 .set_attr<nnvm::FInferShape>("FInferShape", QuantizeShape)
@@ -25,6 +25,7 @@
 #include <nnvm/graph.h>
 #include <nnvm/pass.h>
 #include <mxnet/op_attr_types.h>
+#include <string>
 #include <unordered_set>
 
 namespace mxnet {
@@ -94,16 +95,55 @@ inline bool NeedQuantize(NodePtr node, const std::unordered_set<NodePtr> exclude
   return quantized_op_map.count(node->op()) && !excluded_nodes.count(node);
 }
 
+/*!
+ * \brief Index of the min of output index of a quantized node, which is followed by the max.
+ * Quantized nodes produce their data outputs, then a min and a max for every data output.
+ */
+inline uint32_t QuantizedMinIndex(const NodePtr& mirror_node, uint32_t index) {
+  return mirror_node->num_outputs() / 3 + 2 * index;
+}
+
+/*!
+ * \brief Create a dequantize node reading the data, min and max of a quantized entry, where
+ * mirror_node is the mirror of the node producing the entry.
+ */
+NodePtr CreateDequantizeNode(const NodeEntry& e, NodePtr mirror_node) {
+  uint32_t min_index = QuantizedMinIndex(mirror_node, e.index);
+  uint32_t max_index = min_index + 1;
+  NodePtr dequantize_node = CreateNode("_contrib_dequantize",
+    e.node->attrs.name + "_dequantize");
+  dequantize_node->inputs.emplace_back(NodeEntry{mirror_node, e.index, e.version});
+  dequantize_node->inputs.emplace_back(NodeEntry{mirror_node, min_index, 0});
+  dequantize_node->inputs.emplace_back(NodeEntry{mirror_node, max_index, 0});
+  dequantize_node->op()->attr_parser(&(dequantize_node->attrs));
+  return dequantize_node;
+}
+
 Graph QuantizeGraph(Graph &&src) {
   static auto& quantized_op_map = Op::GetAttr<mxnet::FQuantizedOp>("FQuantizedOp");
   static auto& need_requantize_map = Op::GetAttr<mxnet::FNeedRequantize>("FNeedRequantize");
+  static auto& avoid_quantize_input_map =
+    Op::GetAttr<mxnet::FAvoidQuantizeInput>("FAvoidQuantizeInput");
   auto offline_params = src.GetAttr<std::unordered_set<std::string>>("offline_params");
   auto excluded_nodes = src.GetAttr<std::unordered_set<NodePtr>>("excluded_nodes");
 
   // mirror_map stores the mapping from the currently visited graph to the newly created quantized
   // graph. Key is the currently visited graph's node pointer, and value is a copied node of the key
-  // node. The existing key's value may be updated with the newly created quantize/dequantize op.
+  // node, or its quantized version.
   std::unordered_map<Node*, NodePtr> mirror_map;
+  // The quantize op of every float32 entry read by quantized ops, and the dequantize op of every
+  // quantized entry read by float32 ops. They are created once per entry and shared by all the
+  // consumers, and consumers of the same type as the producer read its outputs directly, so
+  // consecutive quantized ops pass int8 data without dequantizing and quantizing it again.
+  nnvm::NodeEntryMap<NodePtr> quantize_map;
+  nnvm::NodeEntryMap<NodePtr> dequantize_map;
+  auto dequantized_entry = [&dequantize_map](const NodeEntry& e, const NodePtr& mirror_node) {
+    auto it = dequantize_map.find(e);
+    if (it == dequantize_map.end()) {
+      it = dequantize_map.emplace(e, CreateDequantizeNode(e, mirror_node)).first;
+    }
+    return NodeEntry{it->second, 0, 0};
+  };
   DFSVisit(src.outputs, [&](const NodePtr& node) {
     NodePtr new_node = Node::Create();
     // If the currently visited node needs quantization, insert a quantize op node before the
@@ -114,21 +154,39 @@ Graph QuantizeGraph(Graph &&src) {
       // quantizated version of a that op, such as quantized_conv2d.
       new_node = fquantized_op(node->attrs);
 
-      // add data into quantized op input
-      for (const auto& e : node->inputs) {
+      // add data into quantized op input, and collect the min and max of every input, assuming
+      // the order of quantized op inputs is: data1, data2, ..., min1, max1, min2, max2, ...
+      std::vector<NodeEntry> ranges;
+      auto favoid_quantize_input = avoid_quantize_input_map.get(node->op(), nullptr);
+      for (size_t i = 0; i < node->inputs.size(); ++i) {
+        const NodeEntry& e = node->inputs[i];
         NodePtr mirror_node = mirror_map.at(e.node.get());
-        NodeEntry mirror_entry = NodeEntry{
-          mirror_node, e.index, e.version};
-        // If the NodeEntry e's node does not need quantization, and (the mirror_node is a variable,
-        // or the mirror_node's op is not a quantize op), create quantize op, min op, and max op
-        // taking mirror_entry as input to generate a quantized NDArray. Save the mapping between
-        // e's source node and the newly created quantize op so that the quantize op can be
-        // reused next time when the same entry is visited again.
-        if (!NeedQuantize(e.node, excluded_nodes) &&
-            (mirror_node->op() == nullptr ||
-             mirror_node->op()->name != "_contrib_quantize")) {
-          NodePtr quantize_node = InsertNode("_contrib_quantize",
-            e.node->attrs.name + "_quantize", new_node, mirror_entry);
+        if (favoid_quantize_input != nullptr && favoid_quantize_input(node->attrs, i)) {
+          // the input stays float32, and has no min and max
+          if (NeedQuantize(e.node, excluded_nodes)) {
+            new_node->inputs.emplace_back(dequantized_entry(e, mirror_node));
+          } else {
+            new_node->inputs.emplace_back(NodeEntry{mirror_node, e.index, e.version});
+          }
+          continue;
+        }
+        if (NeedQuantize(e.node, excluded_nodes)) {
+          // the input is from a quantized op, whose min and max follow its outputs
+          uint32_t min_index = QuantizedMinIndex(mirror_node, e.index);
+          uint32_t max_index = min_index + 1;
+          new_node->inputs.emplace_back(NodeEntry{mirror_node, e.index, e.version});
+          ranges.emplace_back(NodeEntry{mirror_node, min_index, 0});
+          ranges.emplace_back(NodeEntry{mirror_node, max_index, 0});
+          continue;
+        }
+        // Otherwise quantize the float32 entry with the min and max computed at runtime, which
+        // SetCalibTableToQuantizedGraph replaces by calibrated thresholds when it has them.
+        auto it = quantize_map.find(e);
+        if (it == quantize_map.end()) {
+          NodeEntry mirror_entry = NodeEntry{mirror_node, e.index, e.version};
+          NodePtr quantize_node = CreateNode("_contrib_quantize",
+            e.node->attrs.name + "_quantize");
+          quantize_node->inputs.emplace_back(mirror_entry);
           quantize_node->attrs.dict["out_type"] = "int8";
           quantize_node->op()->attr_parser(&(quantize_node->attrs));
 
@@ -139,36 +197,13 @@ Graph QuantizeGraph(Graph &&src) {
           NodePtr max_node = InsertNode("max",
               e.node->attrs.name + "_max", quantize_node, mirror_entry);
           max_node->op()->attr_parser(&(max_node->attrs));
-
-          mirror_map[e.node.get()] = std::move(quantize_node);
-        } else {
-          // If the entry e's node needs quantization, or mirror_entry is from a quantize op,
-          // simply add mirror_entry to the input of the new_node.
-          new_node->inputs.emplace_back(mirror_entry);
+          it = quantize_map.emplace(e, quantize_node).first;
         }
-        // the input should be `quantize` or quantized version op now
-      }
-
-      // add min and max into quantized op input assume order of quantized op inputs is:
-      // data1, data2, ..., min1, max1, min2, max2, ...
-      for (const auto& e : node->inputs) {
-        NodePtr mirror_node = mirror_map.at(e.node.get());
-        NodeEntry mirror_entry = NodeEntry{
-          mirror_node, e.index, e.version};
-        // for quantize node
-        uint32_t min_index = 1;
-        uint32_t max_index = 2;
-        if (quantized_op_map.count(e.node->op())) {
-          size_t  num_outputs = e.node->num_outputs();
-          min_index = num_outputs + 2 * e.index;
-          max_index = num_outputs + 2 * e.index + 1;
-        } else {
-          CHECK(mirror_node->op()->name == "_contrib_quantize")
-            << "The input is not quantize or quantized_op";
-        }
-        new_node->inputs.emplace_back(NodeEntry{mirror_node, min_index, 0});
-        new_node->inputs.emplace_back(NodeEntry{mirror_node, max_index, 0});
+        new_node->inputs.emplace_back(NodeEntry{it->second, 0, 0});
+        ranges.emplace_back(NodeEntry{it->second, 1, 0});
+        ranges.emplace_back(NodeEntry{it->second, 2, 0});
       }
+      new_node->inputs.insert(new_node->inputs.end(), ranges.begin(), ranges.end());
 
       // If the new_node op registered attr FNeedRequantize, insert requantize node after it.
       // Here it's assumed that the quantized_op node only produces three outputs:
@@ -189,30 +224,15 @@ Graph QuantizeGraph(Graph &&src) {
     } else {
       // If the currently visited node does not need quantization, copy the current node to become
       // the new_node. Meanwhile, check whether any inputs of the current node need quantization
-      // (e.g., a quantized_conv2d node), and insert a dequantize op node in the new graph if there
-      // are any. Otherwise, simply add a copy of the current node's entry to the inputs of
-      // the new_node.
+      // (e.g., a quantized_conv2d node), and read them through a dequantize op node in the new
+      // graph if there are any. Otherwise, simply add a copy of the current node's entry to the
+      // inputs of the new_node.
       *new_node = *node;
       new_node->inputs.clear();
       for (const auto& e : node->inputs) {
         NodePtr mirror_node = mirror_map.at(e.node.get());
-        NodeEntry mirror_entry = NodeEntry{
-          mirror_node, e.index, e.version};
-        size_t num_outputs = e.node->num_outputs();
-        uint32_t min_index = num_outputs + 2 * e.index;
-        uint32_t max_index = num_outputs + 2 * e.index + 1;
-
-        // if input node is quantized operator, add dequantize node
         if (NeedQuantize(e.node, excluded_nodes)) {
-          NodePtr dequantize_node = CreateNode("_contrib_dequantize",
-            e.node->attrs.name + "_dequantize");
-          dequantize_node->inputs.emplace_back(mirror_entry);
-          dequantize_node->inputs.emplace_back(NodeEntry{mirror_node, min_index, 0});
-          dequantize_node->inputs.emplace_back(NodeEntry{mirror_node, max_index, 0});
-          dequantize_node->op()->attr_parser(&(dequantize_node->attrs));
-
-          new_node->inputs.emplace_back(NodeEntry{dequantize_node, 0, 0});
-          mirror_map[e.node.get()] = std::move(dequantize_node);
+          new_node->inputs.emplace_back(dequantized_entry(e, mirror_node));
         } else {
           new_node->inputs.emplace_back(NodeEntry{mirror_node, e.index, e.version});
         }
@@ -223,22 +243,11 @@ Graph QuantizeGraph(Graph &&src) {
 
   std::vector<NodeEntry> outputs;
   for (const auto& e : src.outputs) {
-    if (quantized_op_map.count(e.node->op())) {
-      NodePtr mirror_node = mirror_map.at(e.node.get());
-      NodeEntry mirror_entry = NodeEntry{mirror_node, e.index, e.version};
-      size_t num_inputs = e.node->num_inputs();
-      uint32_t min_index = num_inputs + 2 * e.index;
-      uint32_t max_index = num_inputs + 2 * e.index + 1;
-
-      NodePtr dequantize_node = CreateNode("_contrib_dequantize",
-          e.node->attrs.name + "_dequantize");
-      dequantize_node->inputs.emplace_back(mirror_entry);
-      dequantize_node->inputs.emplace_back(NodeEntry{mirror_node, min_index, 0});
-      dequantize_node->inputs.emplace_back(NodeEntry{mirror_node, max_index, 0});
-      dequantize_node->op()->attr_parser(&(dequantize_node->attrs));
-      outputs.emplace_back(NodeEntry{dequantize_node, 0, 0});
+    NodePtr mirror_node = mirror_map.at(e.node.get());
+    if (NeedQuantize(e.node, excluded_nodes)) {
+      outputs.emplace_back(dequantized_entry(e, mirror_node));
     } else {
-      outputs.emplace_back(NodeEntry{mirror_map.at(e.node.get()), e.index, e.version});
+      outputs.emplace_back(NodeEntry{mirror_node, e.index, e.version});
     }
   }
 
@@ -250,6 +259,21 @@ Graph QuantizeGraph(Graph &&src) {
   return ret;
 }
 
+/*!
+ * \brief Name of an entry as GraphExecutor::ExecuteMonCallback reports it, or the name of the
+ * variable for the entries of variables.
+ */
+std::string EntryName(const NodeEntry& e) {
+  static const auto& flist_outputs =
+    nnvm::Op::GetAttr<nnvm::FListOutputNames>("FListOutputNames");
+  if (e.node->is_variable()) return e.node->attrs.name;
+  auto list_output_names_func = flist_outputs.get(e.node->op(), nullptr);
+  if (list_output_names_func != nullptr) {
+    return e.node->attrs.name + "_" + list_output_names_func(e.node->attrs)[e.index];
+  }
+  return e.node->attrs.name + "_" + std::to_string(e.index);
+}
+
 Graph SetCalibTableToQuantizedGraph(Graph&& g) {
   static const auto& flist_outputs =
     nnvm::Op::GetAttr<nnvm::FListOutputNames>("FListOutputNames");
@@ -257,7 +281,29 @@ Graph SetCalibTableToQuantizedGraph(Graph&& g) {
     nnvm::Op::GetAttr<mxnet::FNeedRequantize>("FNeedRequantize");
   const auto& calib_table =
     g.GetAttr<std::unordered_map<std::string, std::pair<float, float>>>("calib_table");
+  // MXSetCalibTableToQuantizedSymbol keys the table by the float32 entry names with this prefix
+  const std::string prefix = "quantized_";
+  size_t num_calibrated_quantize = 0;
   DFSVisit(g.outputs, [&](const NodePtr& node) {
+    // If the current op quantizes a float32 entry with the min and max computed at runtime,
+    // take the thresholds of the entry from the calibration table instead, so the quantize op
+    // only reads the data and the min and max ops drop out of the graph.
+    if (node->op() != nullptr && node->op()->name == "_contrib_quantize" &&
+        node->inputs.size() == 3U) {
+      const NodePtr& min_node = node->inputs[1].node;
+      const NodePtr& max_node = node->inputs[2].node;
+      if (min_node->op() != nullptr && min_node->op()->name == "min" &&
+          max_node->op() != nullptr && max_node->op()->name == "max") {
+        const auto calib_table_iter = calib_table.find(prefix + EntryName(node->inputs[0]));
+        if (calib_table_iter != calib_table.end()) {
+          node->attrs.dict["min_calib_range"] = std::to_string(calib_table_iter->second.first);
+          node->attrs.dict["max_calib_range"] = std::to_string(calib_table_iter->second.second);
+          node->op()->attr_parser(&(node->attrs));
+          node->inputs.resize(1);
+          ++num_calibrated_quantize;
+        }
+      }
+    }
     // If the current op is requantize
     // find the thresholds from the calibration table with the key equal
     // to the current op's input node name, e.g. a quantized_conv2d node.
@@ -291,6 +337,10 @@ Graph SetCalibTableToQuantizedGraph(Graph&& g) {
       }
     }
   });
+  if (dmlc::GetEnv("MXNET_EXEC_VERBOSE_LOGGING", false)) {
+    LOG(INFO) << "SetCalibTableToQuantizedGraph: calibrated " << num_calibrated_quantize
+              << " quantize nodes";
+  }
   return g;
 }
 
@@ -24,6 +24,7 @@
  * \author Ziheng Jiang, Jun Wu
 */
 #include "../nn/convolution-inl.h"
+#include "./quantization_utils.h"
 
 namespace mxnet {
 namespace op {
@@ -104,6 +105,81 @@ bool QuantizedConvType(const nnvm::NodeAttrs& attrs,
   return true;
 }
 
+/*!
+ * \brief copy the patches of one image of shape (C, H, W) to the rows of col,
+ *  of shape (out_h * out_w, C * kernel_h * kernel_w) in the order of the weight
+ */
+static void QuantizedIm2RowCPU(const int8_t* data, int channels, int height, int width,
+                               int kernel_h, int kernel_w, int pad_h, int pad_w,
+                               int stride_h, int stride_w, int out_h, int out_w,
+                               int8_t* col) {
+  const int row_size = channels * kernel_h * kernel_w;
+  #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int p = 0; p < out_h * out_w; ++p) {
+    const int h0 = (p / out_w) * stride_h - pad_h;
+    const int w0 = (p % out_w) * stride_w - pad_w;
+    int8_t* row = col + static_cast<int64_t>(p) * row_size;
+    for (int c = 0; c < channels; ++c) {
+      const int8_t* plane = data + static_cast<int64_t>(c) * height * width;
+      for (int kh = 0; kh < kernel_h; ++kh) {
+        const int h = h0 + kh;
+        for (int kw = 0; kw < kernel_w; ++kw) {
+          const int w = w0 + kw;
+          *row++ = (h >= 0 && h < height && w >= 0 && w < width) ? plane[h * width + w] : 0;
+        }
+      }
+    }
+  }
+}
+
+void QuantizedConvForwardCPU(const nnvm::NodeAttrs& attrs,
+                             const OpContext& ctx,
+                             const std::vector<TBlob>& in_data,
+                             const std::vector<OpReqType>& req,
+                             const std::vector<TBlob>& out_data) {
+  using namespace mshadow;
+  ConvolutionParam param = nnvm::get<ConvolutionParam>(attrs.parsed);
+  CHECK_EQ(in_data.size(), param.no_bias? 6U : 9U);
+  CHECK_EQ(out_data.size(), 3U);
+  if (param.stride.ndim() == 0U) param.stride = Shape2(1, 1);
+  if (param.pad.ndim() == 0U) param.pad = Shape2(0, 0);
+  Stream<cpu> *s = ctx.get_stream<cpu>();
+  const TBlob& data = in_data[0];
+  const TBlob& weight = in_data[1];
+  const TBlob& out = out_data[0];
+  const TShape& dshape = data.shape_;
+  const TShape& oshape = out.shape_;
+  const int num_filter = oshape[1];
+  const int spatial = oshape[2] * oshape[3];
+  const int row_size = weight.shape_.ProdShape(1, weight.ndim());
+
+  // out[n] = weight * col.T with col of shape (out_h * out_w, C * kernel_h * kernel_w)
+  Tensor<cpu, 1, int8_t> col = ctx.requested[0].get_space_typed<cpu, 1, int8_t>(
+      Shape1(static_cast<index_t>(spatial) * row_size), s);
+  const int8_t* data_ptr = data.dptr<int8_t>();
+  int32_t* out_ptr = out.dptr<int32_t>();
+  for (index_t n = 0; n < dshape[0]; ++n) {
+    QuantizedIm2RowCPU(data_ptr + n * dshape.ProdShape(1, 4), dshape[1], dshape[2], dshape[3],
+                       param.kernel[0], param.kernel[1], param.pad[0], param.pad[1],
+                       param.stride[0], param.stride[1], oshape[2], oshape[3], col.dptr_);
+    QuantizedGemmCPU(num_filter, row_size, spatial, weight.dptr<int8_t>(), col.dptr_,
+                     out_ptr + static_cast<int64_t>(n) * num_filter * spatial);
+  }
+
+  const size_t num_inputs = param.no_bias ? 2 : 3;
+  mxnet_op::Kernel<QuantizationRangeForMultiplicationStruct, cpu>::Launch(s, 1,
+    out_data[1].dptr<float>(), out_data[2].dptr<float>(),
+     in_data[num_inputs].dptr<float>(),  in_data[num_inputs+1].dptr<float>(),
+     in_data[num_inputs+2].dptr<float>(),  in_data[num_inputs+3].dptr<float>());
+
+  if (!param.no_bias) {
+    const TBlob& bias = in_data[2];
+    QuantizedBiasAddCPU(out.Size(), bias.Size(), spatial, out_ptr, bias.dptr<int8_t>(),
+                        *out_data[1].dptr<float>(), *out_data[2].dptr<float>(),
+                        *in_data[7].dptr<float>(), *in_data[8].dptr<float>());
+  }
+}
+
 NNVM_REGISTER_OP(_contrib_quantized_conv)
 .describe(R"code(Convolution operator for input, weight and bias data type of int8,
 and accumulates in type int32 for the output. For each argument, two more arguments of type
@@ -141,6 +217,7 @@ and max thresholds representing the threholds for quantizing the float32 output
   [](const NodeAttrs& attrs) {
     return std::vector<ResourceRequest>(1, ResourceRequest::kTempSpace);
   })
+.set_attr<FCompute>("FCompute<cpu>", QuantizedConvForwardCPU)
 .set_attr<FNeedRequantize>("FNeedRequantize", [](const NodeAttrs& attrs) { return true; })
 .add_argument("data", "NDArray-or-Symbol", "Input data.")
 .add_argument("weight", "NDArray-or-Symbol", "weight.")
@@ -22,6 +22,9 @@
  * \file quantized_pooling.cc
 */
 #include <mxnet/op_attr_types.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include "../nn/pooling-inl.h"
 
 namespace mxnet {
@@ -91,6 +94,61 @@ bool QuantizedPoolingType(const nnvm::NodeAttrs& attrs,
   return true;
 }
 
+/*!
+ * \brief int8 pooling on cpu. Max pooling skips the padding, and avg pooling
+ *  divides by the whole window and rounds to the nearest level, as cudnn does.
+ */
+void QuantizedPoolingForwardCPU(const nnvm::NodeAttrs& attrs,
+                                const OpContext& ctx,
+                                const std::vector<TBlob>& inputs,
+                                const std::vector<OpReqType>& req,
+                                const std::vector<TBlob>& outputs) {
+  const PoolingParam& param = nnvm::get<PoolingParam>(attrs.parsed);
+  CHECK_EQ(param.kernel.ndim(), 2U)
+    << "QuantizedPoolingForward<cpu> only supports 2D pooling for now";
+  CHECK_EQ(inputs.size(), 3U);
+  CHECK_EQ(outputs.size(), 3U);
+  const TShape& ishape = inputs[0].shape_;
+  const TShape& oshape = outputs[0].shape_;
+  const int height = ishape[2], width = ishape[3];
+  const int out_h = oshape[2], out_w = oshape[3];
+  const int kernel_h = param.global_pool ? height : param.kernel[0];
+  const int kernel_w = param.global_pool ? width : param.kernel[1];
+  const int pad_h = param.pad.ndim() ? param.pad[0] : 0;
+  const int pad_w = param.pad.ndim() ? param.pad[1] : 0;
+  const int stride_h = param.global_pool || !param.stride.ndim() ? 1 : param.stride[0];
+  const int stride_w = param.global_pool || !param.stride.ndim() ? 1 : param.stride[1];
+  const bool is_max = param.pool_type == pool_enum::kMaxPooling;
+  const float window = static_cast<float>(kernel_h * kernel_w);
+  const int8_t* in_data = inputs[0].dptr<int8_t>();
+  int8_t* out_data = outputs[0].dptr<int8_t>();
+  const int num_planes = ishape[0] * ishape[1];
+  #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int plane = 0; plane < num_planes; ++plane) {
+    const int8_t* in = in_data + static_cast<int64_t>(plane) * height * width;
+    int8_t* out = out_data + static_cast<int64_t>(plane) * out_h * out_w;
+    for (int oh = 0; oh < out_h; ++oh) {
+      const int h_begin = std::max(oh * stride_h - pad_h, 0);
+      const int h_end = std::min(oh * stride_h - pad_h + kernel_h, height);
+      for (int ow = 0; ow < out_w; ++ow) {
+        const int w_begin = std::max(ow * stride_w - pad_w, 0);
+        const int w_end = std::min(ow * stride_w - pad_w + kernel_w, width);
+        int32_t acc = is_max ? std::numeric_limits<int8_t>::lowest() : 0;
+        for (int h = h_begin; h < h_end; ++h) {
+          for (int w = w_begin; w < w_end; ++w) {
+            const int32_t v = in[h * width + w];
+            acc = is_max ? std::max(acc, v) : acc + v;
+          }
+        }
+        out[oh * out_w + ow] = is_max ? static_cast<int8_t>(acc)
+                                      : static_cast<int8_t>(std::round(acc / window));
+      }
+    }
+  }
+  *outputs[1].dptr<float>() = *inputs[1].dptr<float>();
+  *outputs[2].dptr<float>() = *inputs[2].dptr<float>();
+}
+
 NNVM_REGISTER_OP(_contrib_quantized_pooling)
 .set_num_inputs(3)
 .set_num_outputs(3)
@@ -105,6 +163,7 @@ NNVM_REGISTER_OP(_contrib_quantized_pooling)
   })
 .set_attr<nnvm::FInferShape>("FInferShape", QuantizedPoolingShape)
 .set_attr<nnvm::FInferType>("FInferType", QuantizedPoolingType)
+.set_attr<FCompute>("FCompute<cpu>", QuantizedPoolingForwardCPU)
 .set_attr<FNeedRequantize>("FNeedRequantize",
   [](const NodeAttrs& attrs) {
     const PoolingParam& param = nnvm::get<PoolingParam>(attrs.parsed);
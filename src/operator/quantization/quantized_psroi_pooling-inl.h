@@ -0,0 +1,172 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file quantized_psroi_pooling-inl.h
+ * \brief implementation of int8 PSROIPooling, the data keeps its quantization range
+ */
+#ifndef MXNET_OPERATOR_QUANTIZATION_QUANTIZED_PSROI_POOLING_INL_H_
+#define MXNET_OPERATOR_QUANTIZATION_QUANTIZED_PSROI_POOLING_INL_H_
+
+#include <mxnet/operator_util.h>
+#include <vector>
+#include "../mshadow_op.h"
+#include "../mxnet_op.h"
+#include "../contrib/psroi_pooling-inl.h"
+
+namespace mxnet {
+namespace op {
+
+/*!
+ * \brief Forward of PSROIPooling over int8 data, with the bins and channel groups of
+ *  PSROIPoolForwardKernel. The sum of a bin is exact, its average is rounded.
+ */
+struct QuantizedPSROIPoolForwardKernel {
+  MSHADOW_XINLINE static void Map(int index, const int8_t* bottom_data,
+                                  const float spatial_scale, const int channels,
+                                  const int height, const int width,
+                                  const int pooled_height, const int pooled_width,
+                                  const float* bottom_rois, const int output_dim,
+                                  const int group_size, int8_t* top_data) {
+    using namespace mxnet::op::mshadow_op;
+    // The output is in order (n, ctop, ph, pw)
+    int pw = index % pooled_width;
+    int ph = (index / pooled_width) % pooled_height;
+    int ctop = (index / pooled_width / pooled_height) % output_dim;
+    int n = index / pooled_width / pooled_height / output_dim;
+
+    // [start, end) interval for spatial sampling
+    bottom_rois += n * 5;
+    int roi_batch_ind = bottom_rois[0];
+    float roi_start_w = round::Map(bottom_rois[1]) * spatial_scale;
+    float roi_start_h = round::Map(bottom_rois[2]) * spatial_scale;
+    float roi_end_w = (round::Map(bottom_rois[3]) + 1.0f) * spatial_scale;
+    float roi_end_h = (round::Map(bottom_rois[4]) + 1.0f) * spatial_scale;
+
+    // Force too small ROIs to be 1x1
+    float roi_width = maximum::Map(roi_end_w - roi_start_w, 0.1f);
+    float roi_height = maximum::Map(roi_end_h - roi_start_h, 0.1f);
+    float bin_size_h = roi_height / static_cast<float>(pooled_height);
+    float bin_size_w = roi_width / static_cast<float>(pooled_width);
+
+    int hstart = floor::Map(static_cast<float>(ph) * bin_size_h + roi_start_h);
+    int wstart = floor::Map(static_cast<float>(pw) * bin_size_w + roi_start_w);
+    int hend = ceil::Map(static_cast<float>(ph + 1) * bin_size_h + roi_start_h);
+    int wend = ceil::Map(static_cast<float>(pw + 1) * bin_size_w + roi_start_w);
+    // Add roi offsets and clip to input boundaries
+    hstart = minimum::Map(maximum::Map(hstart, 0), height);
+    hend = minimum::Map(maximum::Map(hend, 0), height);
+    wstart = minimum::Map(maximum::Map(wstart, 0), width);
+    wend = minimum::Map(maximum::Map(wend, 0), width);
+    bool is_empty = (hend <= hstart) || (wend <= wstart);
+
+    int gw = floor::Map(static_cast<float>(pw) * group_size / pooled_width);
+    int gh = floor::Map(static_cast<float>(ph) * group_size / pooled_height);
+    gw = minimum::Map(maximum::Map(gw, 0), group_size - 1);
+    gh = minimum::Map(maximum::Map(gh, 0), group_size - 1);
+    int c = (ctop * group_size + gh) * group_size + gw;
+
+    bottom_data += (roi_batch_ind * channels + c) * height * width;
+    int out_sum = 0;
+    for (int h = hstart; h < hend; ++h) {
+      for (int w = wstart; w < wend; ++w) {
+        out_sum += bottom_data[h * width + w];
+      }
+    }
+    float bin_area = (hend - hstart) * (wend - wstart);
+    top_data[index] = is_empty ? 0 : static_cast<int8_t>(round::Map(out_sum / bin_area));
+  }
+};
+
+/*! \brief parse the param like PSROIPoolingProp::Init, a group_size of 0 is pooled_size */
+inline void QuantizedPSROIPoolingParamParser(nnvm::NodeAttrs* attrs) {
+  PSROIPoolingParam param;
+  param.Init(attrs->dict);
+  if (param.group_size == 0) {
+    param.group_size = param.pooled_size;
+  }
+  attrs->parsed = std::move(param);
+}
+
+template<typename xpu>
+void QuantizedPSROIPoolingForward(const nnvm::NodeAttrs& attrs,
+                                  const OpContext& ctx,
+                                  const std::vector<TBlob>& in_data,
+                                  const std::vector<OpReqType>& req,
+                                  const std::vector<TBlob>& out_data) {
+  using namespace mshadow;
+  CHECK_EQ(in_data.size(), 4U);
+  CHECK_EQ(out_data.size(), 3U);
+  const PSROIPoolingParam& param = nnvm::get<PSROIPoolingParam>(attrs.parsed);
+  const TBlob& data = in_data[psroipool::kData];
+  const TBlob& out = out_data[psroipool::kOut];
+  Stream<xpu> *s = ctx.get_stream<xpu>();
+  mxnet_op::Kernel<QuantizedPSROIPoolForwardKernel, xpu>::Launch(s,
+    out.Size(), data.dptr<int8_t>(), param.spatial_scale, data.size(1), data.size(2),
+    data.size(3), out.size(2), out.size(3), in_data[psroipool::kBox].dptr<float>(),
+    param.output_dim, param.group_size, out.dptr<int8_t>());
+  // averages of levels stay in the range of the data
+  mxnet_op::Kernel<mxnet_op::op_with_req<mshadow_op::identity, kWriteTo>, xpu>::Launch(s, 1,
+    out_data[1].dptr<float>(), in_data[2].dptr<float>());
+  mxnet_op::Kernel<mxnet_op::op_with_req<mshadow_op::identity, kWriteTo>, xpu>::Launch(s, 1,
+    out_data[2].dptr<float>(), in_data[3].dptr<float>());
+}
+
+inline bool QuantizedPSROIPoolingShape(const nnvm::NodeAttrs& attrs,
+                                       std::vector<TShape> *in_attrs,
+                                       std::vector<TShape> *out_attrs) {
+  CHECK_EQ(in_attrs->size(), 4U);
+  CHECK_EQ(out_attrs->size(), 3U);
+  const PSROIPoolingParam& param = nnvm::get<PSROIPoolingParam>(attrs.parsed);
+  const TShape &dshape = (*in_attrs)[psroipool::kData];
+  const TShape &bshape = (*in_attrs)[psroipool::kBox];
+  if (shape_is_none(dshape) || shape_is_none(bshape)) return false;
+  CHECK_EQ(dshape.ndim(), 4U) << "data should be a 4D tensor";
+  CHECK_EQ(dshape[1], static_cast<dim_t>(param.output_dim * param.group_size * param.group_size))
+    << "data should have output_dim * group_size * group_size channels";
+  CHECK_EQ(bshape.ndim(), 2U) << "bbox should be a 2D tensor of shape [batch, 5]";
+  CHECK_EQ(bshape[1], 5U) << "bbox should be a 2D tensor of shape [batch, 5]";
+  SHAPE_ASSIGN_CHECK(*in_attrs, 2, TShape{1});
+  SHAPE_ASSIGN_CHECK(*in_attrs, 3, TShape{1});
+  SHAPE_ASSIGN_CHECK(*out_attrs, 0, mshadow::Shape4(bshape[0], param.output_dim,
+                                                    param.pooled_size, param.pooled_size));
+  SHAPE_ASSIGN_CHECK(*out_attrs, 1, TShape{1});
+  SHAPE_ASSIGN_CHECK(*out_attrs, 2, TShape{1});
+  return true;
+}
+
+inline bool QuantizedPSROIPoolingType(const nnvm::NodeAttrs& attrs,
+                                      std::vector<int> *in_attrs,
+                                      std::vector<int> *out_attrs) {
+  CHECK_EQ(in_attrs->size(), 4U);
+  CHECK_EQ(out_attrs->size(), 3U);
+  TYPE_ASSIGN_CHECK(*in_attrs, 0, mshadow::kInt8);
+  TYPE_ASSIGN_CHECK(*in_attrs, 1, mshadow::kFloat32);
+  TYPE_ASSIGN_CHECK(*in_attrs, 2, mshadow::kFloat32);
+  TYPE_ASSIGN_CHECK(*in_attrs, 3, mshadow::kFloat32);
+  TYPE_ASSIGN_CHECK(*out_attrs, 0, mshadow::kInt8);
+  TYPE_ASSIGN_CHECK(*out_attrs, 1, mshadow::kFloat32);
+  TYPE_ASSIGN_CHECK(*out_attrs, 2, mshadow::kFloat32);
+  return true;
+}
+
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_QUANTIZATION_QUANTIZED_PSROI_POOLING_INL_H_
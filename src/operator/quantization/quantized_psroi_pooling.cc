@@ -0,0 +1,74 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file quantized_psroi_pooling.cc
+ * \brief
+ */
+#include <mxnet/op_attr_types.h>
+#include "./quantized_psroi_pooling-inl.h"
+
+namespace mxnet {
+namespace op {
+
+NNVM_REGISTER_OP(_contrib_quantized_PSROIPooling)
+.describe(R"code(PSROIPooling operator for input data of type int8.
+
+The rois stay in float32. The output is int8 with the quantization range of the data,
+since every pooled value is an average of data values.
+)code" ADD_FILELINE)
+.set_num_inputs(4)
+.set_num_outputs(3)
+.set_attr_parser(QuantizedPSROIPoolingParamParser)
+.set_attr<nnvm::FListInputNames>("FListInputNames",
+  [](const NodeAttrs& attrs) {
+    return std::vector<std::string>{"data", "rois", "min_data", "max_data"};
+  })
+.set_attr<nnvm::FListOutputNames>("FListOutputNames",
+  [](const NodeAttrs& attrs) {
+    return std::vector<std::string>{"output", "min_output", "max_output"};
+  })
+.set_attr<nnvm::FInferShape>("FInferShape", QuantizedPSROIPoolingShape)
+.set_attr<nnvm::FInferType>("FInferType", QuantizedPSROIPoolingType)
+.set_attr<FCompute>("FCompute<cpu>", QuantizedPSROIPoolingForward<cpu>)
+.set_attr<FNeedRequantize>("FNeedRequantize", [](const NodeAttrs& attrs) { return false; })
+.add_argument("data", "NDArray-or-Symbol", "Input data of type int8.")
+.add_argument("rois", "NDArray-or-Symbol", "Bounding box coordinates of type float32, "
+  "a 2D array of [[batch_index, x1, y1, x2, y2]]")
+.add_argument("min_data", "NDArray-or-Symbol", "Minimum value of data.")
+.add_argument("max_data", "NDArray-or-Symbol", "Maximum value of data.")
+.add_arguments(PSROIPoolingParam::__FIELDS__());
+
+NNVM_REGISTER_OP(_contrib_PSROIPooling)
+.set_attr<FQuantizedOp>("FQuantizedOp", [](const NodeAttrs& attrs) {
+    nnvm::NodePtr node = nnvm::Node::Create();
+    node->attrs.op = Op::Get("_contrib_quantized_PSROIPooling");
+    node->attrs.name = "quantized_" + attrs.name;
+    node->attrs.dict = attrs.dict;
+    if (node->op()->attr_parser != nullptr) {
+      node->op()->attr_parser(&(node->attrs));
+    }
+    return node;
+  })
+.set_attr<FAvoidQuantizeInput>("FAvoidQuantizeInput",
+  [](const NodeAttrs& attrs, size_t index) { return index == psroipool::kBox; });
+
+}  // namespace op
+}  // namespace mxnet
@@ -0,0 +1,170 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file quantized_roi_align_v2-inl.h
+ * \brief implementation of int8 ROIAlign_v2, the data keeps its quantization range
+ */
+#ifndef MXNET_OPERATOR_QUANTIZATION_QUANTIZED_ROI_ALIGN_V2_INL_H_
+#define MXNET_OPERATOR_QUANTIZATION_QUANTIZED_ROI_ALIGN_V2_INL_H_
+
+#include <mxnet/operator_util.h>
+#include <vector>
+#include "../mshadow_op.h"
+#include "../mxnet_op.h"
+#include "../contrib/roi_align_v2-inl.h"
+
+namespace mxnet {
+namespace op {
+
+/*!
+ * \brief Forward of ROIAlign_v2 over int8 data. The samples are interpolated in float32
+ *  like ROIAlignForwardKernel_v2 does, and their maximum is rounded to the nearest level.
+ */
+struct QuantizedROIAlignForwardKernel_v2 {
+  MSHADOW_XINLINE static void Map(int index, const int8_t* bottom_data,
+                                  const float spatial_scale, const int channels,
+                                  const int height, const int width,
+                                  const int pooled_height, const int pooled_width,
+                                  const float* bottom_rois, int8_t* top_data) {
+    using namespace mxnet::op::mshadow_op;
+    // (n, c, ph, pw) is an element in the pooled output
+    int pw = index % pooled_width;
+    int ph = (index / pooled_width) % pooled_height;
+    int c = (index / pooled_width / pooled_height) % channels;
+    int n = index / pooled_width / pooled_height / channels;
+
+    bottom_rois += n * 5;
+    int roi_batch_ind = bottom_rois[0];
+    if (roi_batch_ind < 0) {
+      top_data[index] = 0;
+      return;
+    }
+
+    float roi_start_w = bottom_rois[1] * spatial_scale;
+    float roi_start_h = bottom_rois[2] * spatial_scale;
+    float roi_end_w = bottom_rois[3] * spatial_scale;
+    float roi_end_h = bottom_rois[4] * spatial_scale;
+    float bin_size_h = (roi_end_h - roi_start_h) / static_cast<float>(pooled_height);
+    float bin_size_w = (roi_end_w - roi_start_w) / static_cast<float>(pooled_width);
+
+    // Add roi offsets and clip to input boundaries
+    float hstart = minimum::Map(maximum::Map(ph * bin_size_h + roi_start_h, 0.0f),
+                                static_cast<float>(height - 1));
+    float hend = minimum::Map(maximum::Map((ph + 1) * bin_size_h + roi_start_h, 0.0f),
+                              static_cast<float>(height - 1));
+    float wstart = minimum::Map(maximum::Map(pw * bin_size_w + roi_start_w, 0.0f),
+                                static_cast<float>(width - 1));
+    float wend = minimum::Map(maximum::Map((pw + 1) * bin_size_w + roi_start_w, 0.0f),
+                              static_cast<float>(width - 1));
+    bool is_empty = (hend <= hstart) || (wend <= wstart);
+
+    float maxval = 0;
+    if (!is_empty) {
+      maxval = mshadow::red::limits::MinValue<float>();
+      bottom_data += (roi_batch_ind * channels + c) * height * width;
+      // the same sampling points as the float32 kernel
+      float h_stride = (hend - hstart) / 3.0;
+      float w_stride = (wend - wstart) / 3.0;
+      for (float h = hstart + h_stride; h <= hend - h_stride + 0.01;
+           h += maximum::Map(h_stride, 0.01f)) {
+        for (float w = wstart + w_stride; w <= wend - w_stride + 0.01;
+             w += maximum::Map(w_stride, 0.01f)) {
+          int hlow = minimum::Map(maximum::Map(static_cast<int>(floor::Map(h)), 0), height-1);
+          int hhigh = minimum::Map(maximum::Map(static_cast<int>(ceil::Map(h)), 0), height-1);
+          int wleft = minimum::Map(maximum::Map(static_cast<int>(floor::Map(w)), 0), width-1);
+          int wright = minimum::Map(maximum::Map(static_cast<int>(ceil::Map(w)), 0), width-1);
+          float alpha = (hlow == hhigh) ? 0.5f : (h - hlow) / (hhigh - hlow);
+          float beta = (wleft == wright) ? 0.5f : (w - wleft) / (wright - wleft);
+          float value = (1 - alpha) * (1 - beta) * bottom_data[hlow * width + wleft]
+                          + alpha * (1 - beta) * bottom_data[hhigh * width + wleft]
+                          + (1 - alpha) * beta * bottom_data[hlow * width + wright]
+                          + alpha * beta * bottom_data[hhigh * width + wright];
+          maxval = maximum::Map(maxval, value);
+        }
+      }
+    }
+    top_data[index] = static_cast<int8_t>(round::Map(maxval));
+  }
+};
+
+template<typename xpu>
+void QuantizedROIAlignForward_v2(const nnvm::NodeAttrs& attrs,
+                                 const OpContext& ctx,
+                                 const std::vector<TBlob>& in_data,
+                                 const std::vector<OpReqType>& req,
+                                 const std::vector<TBlob>& out_data) {
+  using namespace mshadow;
+  CHECK_EQ(in_data.size(), 4U);
+  CHECK_EQ(out_data.size(), 3U);
+  const ROIAlignParam_v2& param = nnvm::get<ROIAlignParam_v2>(attrs.parsed);
+  const TBlob& data = in_data[roialign_v2::kData];
+  const TBlob& out = out_data[roialign_v2::kOut];
+  Stream<xpu> *s = ctx.get_stream<xpu>();
+  mxnet_op::Kernel<QuantizedROIAlignForwardKernel_v2, xpu>::Launch(s,
+    out.Size(), data.dptr<int8_t>(), param.spatial_scale, data.size(1), data.size(2),
+    data.size(3), out.size(2), out.size(3), in_data[roialign_v2::kBox].dptr<float>(),
+    out.dptr<int8_t>());
+  // interpolations and maxima of levels stay in the range of the data
+  mxnet_op::Kernel<mxnet_op::op_with_req<mshadow_op::identity, kWriteTo>, xpu>::Launch(s, 1,
+    out_data[1].dptr<float>(), in_data[2].dptr<float>());
+  mxnet_op::Kernel<mxnet_op::op_with_req<mshadow_op::identity, kWriteTo>, xpu>::Launch(s, 1,
+    out_data[2].dptr<float>(), in_data[3].dptr<float>());
+}
+
+inline bool QuantizedROIAlignShape_v2(const nnvm::NodeAttrs& attrs,
+                                      std::vector<TShape> *in_attrs,
+                                      std::vector<TShape> *out_attrs) {
+  CHECK_EQ(in_attrs->size(), 4U);
+  CHECK_EQ(out_attrs->size(), 3U);
+  const ROIAlignParam_v2& param = nnvm::get<ROIAlignParam_v2>(attrs.parsed);
+  const TShape &dshape = (*in_attrs)[roialign_v2::kData];
+  const TShape &bshape = (*in_attrs)[roialign_v2::kBox];
+  if (shape_is_none(dshape) || shape_is_none(bshape)) return false;
+  CHECK_EQ(dshape.ndim(), 4U) << "data should be a 4D tensor";
+  CHECK_EQ(bshape.ndim(), 2U) << "bbox should be a 2D tensor of shape [batch, 5]";
+  CHECK_EQ(bshape[1], 5U) << "bbox should be a 2D tensor of shape [batch, 5]";
+  SHAPE_ASSIGN_CHECK(*in_attrs, 2, TShape{1});
+  SHAPE_ASSIGN_CHECK(*in_attrs, 3, TShape{1});
+  SHAPE_ASSIGN_CHECK(*out_attrs, 0, mshadow::Shape4(bshape[0], dshape[1], param.pooled_size[0],
+                                                    param.pooled_size[1]));
+  SHAPE_ASSIGN_CHECK(*out_attrs, 1, TShape{1});
+  SHAPE_ASSIGN_CHECK(*out_attrs, 2, TShape{1});
+  return true;
+}
+
+inline bool QuantizedROIAlignType_v2(const nnvm::NodeAttrs& attrs,
+                                     std::vector<int> *in_attrs,
+                                     std::vector<int> *out_attrs) {
+  CHECK_EQ(in_attrs->size(), 4U);
+  CHECK_EQ(out_attrs->size(), 3U);
+  TYPE_ASSIGN_CHECK(*in_attrs, 0, mshadow::kInt8);
+  TYPE_ASSIGN_CHECK(*in_attrs, 1, mshadow::kFloat32);
+  TYPE_ASSIGN_CHECK(*in_attrs, 2, mshadow::kFloat32);
+  TYPE_ASSIGN_CHECK(*in_attrs, 3, mshadow::kFloat32);
+  TYPE_ASSIGN_CHECK(*out_attrs, 0, mshadow::kInt8);
+  TYPE_ASSIGN_CHECK(*out_attrs, 1, mshadow::kFloat32);
+  TYPE_ASSIGN_CHECK(*out_attrs, 2, mshadow::kFloat32);
+  return true;
+}
+
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_QUANTIZATION_QUANTIZED_ROI_ALIGN_V2_INL_H_
@@ -51,6 +51,31 @@ inline static void LaunchRNG(mshadow::Stream<xpu> *s,
   Kernel<OP, xpu>::Launch(s, nthread, *gen, N, step, args...);
 }
 
+/*!
+ * \brief Launch a kernel with a counter based random generator, one thread for every
+ *  four items. The kernel gets the key of the launch and draws its numbers from
+ *  a PhiloxGenerator of its thread id, so results do not depend on the parallelism.
+ * \tparam N Number of items
+ */
+template<typename OP, typename xpu, typename GType, typename ...Args>
+inline static void LaunchPhilox(mshadow::Stream<xpu> *s,
+                                common::random::RandGenerator<xpu, GType> *gen,
+                                const index_t N, Args... args) {
+  if (N == 0) return;
+  Kernel<OP, xpu>::Launch(s, (N + 3) / 4, gen->NextPhiloxKey(), N, args...);
+}
+
+/*! \brief precision of the numbers a counter based kernel draws for items of OType */
+template<typename OType>
+using PhiloxFType = typename std::conditional<std::is_same<OType, double>::value,
+                                              double, float>::type;
+
+#define PHILOX_KERNEL_LOOP(thread_id, N, ...)                            \
+  const index_t start = static_cast<index_t>(thread_id) * 4;             \
+  for (index_t i = start, k = 0; k < 4 && i < N; ++i, ++k) {             \
+    {__VA_ARGS__}                                                        \
+  }
+
 #define RNG_KERNEL_LOOP(xpu, GType, thread_id, gen, N, step, ...)        \
   const int start = thread_id * step;                                    \
   const int end = start + step;                                          \
@@ -62,14 +87,15 @@ inline static void LaunchRNG(mshadow::Stream<xpu> *s,
 template<typename xpu>
 struct SampleUniformKernel {
   template<typename IType, typename OType>
-  MSHADOW_XINLINE static void Map(int id, RandGenerator<xpu, OType> gen,
-                                  const int N, const int step,
+  MSHADOW_XINLINE static void Map(int id, const PhiloxKey key, const index_t N,
                                   index_t nParm, index_t nSample,
                                   const IType *lower, const IType *upper, OType *out) {
-    RNG_KERNEL_LOOP(xpu, OType, id, gen, N, step, {
-      index_t nBatch(1 + (nSample - 1) / nParm);
-      out[i] = OType(lower[i / nBatch] +
-                     (upper[i / nBatch] - lower[i / nBatch]) * genImpl.uniform());
+    PhiloxGenerator gen(key, id);
+    PhiloxFType<OType> u[4];
+    gen.Uniform(u);
+    const index_t nBatch(1 + (nSample - 1) / nParm);
+    PHILOX_KERNEL_LOOP(id, N, {
+      out[i] = OType(lower[i / nBatch] + (upper[i / nBatch] - lower[i / nBatch]) * u[k]);
     });
   }
 };
@@ -82,21 +108,23 @@ struct UniformSampler {
                                    const Tensor<xpu, 1, OType>& out,
                                    RandGenerator<xpu, OType> *pgen,
                                    Stream<xpu> *s) {
-    LaunchRNG<SampleUniformKernel<xpu>, xpu>(s, pgen, out.size(0), lower.size(0), out.size(0),
-                                             lower.dptr_, upper.dptr_, out.dptr_);
+    LaunchPhilox<SampleUniformKernel<xpu>, xpu>(s, pgen, out.size(0), lower.size(0),
+                                                out.size(0), lower.dptr_, upper.dptr_, out.dptr_);
   }
 };
 
 template<typename xpu>
 struct SampleNormalKernel {
   template<typename IType, typename OType>
-  MSHADOW_XINLINE static void Map(int id, RandGenerator<xpu, OType> gen,
-                                  const int N, const int step,
+  MSHADOW_XINLINE static void Map(int id, const PhiloxKey key, const index_t N,
                                   index_t nParm, index_t nSample,
                                   const IType *mean, const IType *std, OType *out) {
-    RNG_KERNEL_LOOP(xpu, OType, id, gen, N, step, {
-      index_t nBatch(1 + (nSample - 1) / nParm);
-      out[i] = OType(genImpl.normal() * std[i / nBatch] + mean[i / nBatch]);
+    PhiloxGenerator gen(key, id);
+    PhiloxFType<OType> z[4];
+    gen.Normal(z);
+    const index_t nBatch(1 + (nSample - 1) / nParm);
+    PHILOX_KERNEL_LOOP(id, N, {
+      out[i] = OType(z[k] * std[i / nBatch] + mean[i / nBatch]);
     });
   }
 };
@@ -109,8 +137,8 @@ struct NormalSampler {
                                    const Tensor<xpu, 1, OType>& out,
                                    RandGenerator<xpu, OType> *pgen,
                                    Stream<xpu> *s) {
-    LaunchRNG<SampleNormalKernel<xpu>, xpu>(s, pgen, out.size(0), mean.size(0), out.size(0),
-                                            mean.dptr_, std.dptr_, out.dptr_);
+    LaunchPhilox<SampleNormalKernel<xpu>, xpu>(s, pgen, out.size(0), mean.size(0), out.size(0),
+                                               mean.dptr_, std.dptr_, out.dptr_);
   }
 };
 
@@ -20,7 +20,7 @@
 /*!
  * Copyright (c) 2015 by Contributors
  * \file rnn-inl.h
- * \brief
+ * \brief fused multi-layer RNN, LSTM and GRU
  * \author Sebastian Bodenstein
 */
 #ifndef MXNET_OPERATOR_RNN_INL_H_
@@ -39,6 +39,7 @@
 #include "./operator_common.h"
 #include "./mshadow_op.h"
 #include "./linalg.h"
+#include "../engine/openmp.h"
 
 namespace mxnet {
 namespace op {
@@ -162,203 +163,223 @@ class RNNOp<cpu, DType> : public Operator {
  public:
   explicit RNNOp(RNNParam param) {
     this->param_ = param;
-    // RNN Mode
-    param_.lstm_q_ = false;
-    switch (param_.mode) {
-      case rnn_enum::kLstm:
-        param_.lstm_q_ = true;
-        break;
-      default:
-        LOG(FATAL) << "only LSTM is implmented on CPU";
-    }
+    param_.lstm_q_ = param_.mode == rnn_enum::kLstm;
   }
 
+  /*!
+   * \brief inference of every mode. The input projections of a layer are one
+   *  GEMM over all timesteps, every timestep does one GEMM of the recurrent
+   *  weights per direction and one fused gate kernel over both directions,
+   *  so the two directions of a bidirectional layer advance together.
+   */
   virtual void Forward(const OpContext &ctx,
                        const std::vector<TBlob> &in_data,
                        const std::vector<OpReqType> &req,
                        const std::vector<TBlob> &out_data,
                        const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
     // Layout TNC
     CHECK(!ctx.is_train) << "only inference mode is available"
       "for cpu at the moment.";
     size_t in_expected = param_.lstm_q_ ? 4 : 3;
-    size_t out_expected = param_.lstm_q_ ? 3 : 2;
-
-    if (!param_.state_outputs)
-      LOG(FATAL) << "no state outputs is currently not supported for cpu.";
-
+    size_t out_expected = !param_.state_outputs ? 1 : (param_.lstm_q_ ? 3 : 2);
     CHECK_EQ(req[rnn_enum::kOut], kWriteTo);
     CHECK_EQ(in_data.size(), in_expected);
     CHECK_EQ(out_data.size(), out_expected);
 
-    mshadow::Stream<cpu> *s = ctx.get_stream<cpu>();
-    // get input + output tensors
-    // w layout i2h_w, h2h_w, i2h_b, h2h_b
-    Tensor<cpu, 3, DType> x =
-        in_data[rnn_enum::kData].get<cpu, 3, DType>(s);  // TNC
-    Tensor<cpu, 1, DType> w = in_data[rnn_enum::kParams].get<cpu, 1, DType>(s);
-    Tensor<cpu, 3, DType> hx =
-        in_data[rnn_enum::kState].get<cpu, 3, DType>(s);  // LNC
-    Tensor<cpu, 3, DType> y =
-        out_data[rnn_enum::kOut].get<cpu, 3, DType>(s);  // TNC
-    int64_t seq_len = x.shape_[0];
-    int64_t num_layers = hx.shape_[0];
-    int64_t batch_size = x.shape_[1];
-    int64_t h_channel = hx.shape_[2];
-    int64_t in_channel = x.shape_[2];
-    Tensor<cpu, 2, DType> x_flatten = in_data[rnn_enum::kData]
-      .get_with_shape<cpu, 2, DType>(
-          mshadow::Shape2(seq_len * batch_size, in_channel), s);  // (T*N)C
-    Tensor<cpu, 2, DType> y_flatten = out_data[rnn_enum::kOut]
-      .get_with_shape<cpu, 2, DType>(
-          mshadow::Shape2(
-              y.shape_[0] * y.shape_[1], y.shape_[2]), s);  // (T*N)C
-
-    CHECK(x.CheckContiguous());
-    CHECK(w.CheckContiguous());
-    CHECK(hx.CheckContiguous());
-    CHECK(y.CheckContiguous());
-
-    if (param_.lstm_q_) {
-      const size_t kNumMat = 4;
-      int64_t fused_h_ch = kNumMat * h_channel;
-      int64_t h_size = batch_size * fused_h_ch;
-      int64_t num_dir = 1 + param_.bidirectional;
-      int64_t h2h_w_size = h_channel * fused_h_ch;
-
-      Tensor<cpu, 3, DType> cx =
-          in_data[rnn_enum::kStateCell].get<cpu, 3, DType>(s);
-      CHECK(cx.CheckContiguous());
-
-      Tensor<cpu, 3, DType> cy =
-          out_data[rnn_enum::kStateCellOut].get<cpu, 3, DType>(s);
-      Tensor<cpu, 3, DType> hy =
-          out_data[rnn_enum::kStateOut].get<cpu, 3, DType>(s);
-      CHECK(cy.CheckContiguous());
-      CHECK(hy.CheckContiguous());
-
-      DType* workspace_addr =
-      static_cast<DType *>(ctx.requested[rnn_enum::kTempSpace]
-          .get_host_space_internal(sizeof(DType) *
-                                  (seq_len * h_size + h_size
-                                  + y.shape_[0] * y.shape_[1] * y.shape_[2])));
-      Tensor<cpu, 3, DType> i2h_y(
-          workspace_addr, mshadow::Shape3(seq_len, batch_size, fused_h_ch));
-      Tensor<cpu, 2, DType> i2h_y_flatten(
-          workspace_addr, mshadow::Shape2(seq_len * batch_size, fused_h_ch));
-      Tensor<cpu, 2, DType> h2h_y(workspace_addr
-          + seq_len * h_size, mshadow::Shape2(batch_size, fused_h_ch));
-      Tensor<cpu, 3, DType> y_tmp(workspace_addr
-          + (seq_len + 1) * h_size, y.shape_);
-      Tensor<cpu, 2, DType> y_flatten_tmp(workspace_addr
-          + (seq_len + 1) * h_size, y_flatten.shape_);
-      CHECK(i2h_y.CheckContiguous());
-      CHECK(h2h_y.CheckContiguous());
-      CHECK(y_tmp.CheckContiguous());
-
-      for (int64_t layer = 0; layer < num_layers; layer++) {
-        int reverse_dir = 0;
-        int out_tmp = 0;
-        if (param_.bidirectional && layer % 2)
-          reverse_dir = 1;
-        if (layer / num_dir % 2 == 0)
-          out_tmp = 1;
-        mshadow::Shape<2> i2h_w_shape = mshadow::Shape2(fused_h_ch,
-            (layer < num_dir) ? in_channel : num_dir * h_channel);
-        mshadow::Shape<2> h2h_w_shape = mshadow::Shape2(fused_h_ch, h_channel);
-        int64_t start = layer < num_dir ?
-            (layer * (in_channel * fused_h_ch + h2h_w_size)) :  // input layer
-              (num_dir * (in_channel * fused_h_ch + h2h_w_size)
-              + (layer - num_dir) * (h2h_w_size * num_dir + h2h_w_size));
-        Tensor<cpu, 2, DType> i2h_w(w.dptr_ + start, i2h_w_shape);
-        start += layer < num_dir ?
-            in_channel * fused_h_ch : h2h_w_size * num_dir;
-        Tensor<cpu, 2, DType> h2h_w(w.dptr_ + start, h2h_w_shape);
-        start = num_dir * (in_channel * fused_h_ch + h2h_w_size)
-            + (num_layers - num_dir) * (h2h_w_size * (num_dir + 1))
-              + layer * fused_h_ch * 2;
-        Tensor<cpu, 1, DType> i2h_b = w.Slice(start, start + fused_h_ch);
-        start += fused_h_ch;
-        Tensor<cpu, 1, DType> h2h_b = w.Slice(start, start + fused_h_ch);
-        if (out_tmp) {
-          linalg_gemm(layer < num_dir ? x_flatten:y_flatten, i2h_w,
-              i2h_y_flatten, false, true, s);
-        } else {
-          linalg_gemm(layer < num_dir ? x_flatten:y_flatten_tmp, i2h_w,
-              i2h_y_flatten, false, true, s);
+    Stream<cpu> *s = ctx.get_stream<cpu>();
+    const TShape& xshape = in_data[rnn_enum::kData].shape_;
+    const int seq_len = xshape[0];
+    const int batch_size = xshape[1];
+    const int num_dir = param_.bidirectional ? 2 : 1;
+    const int num_layers = param_.num_layers;
+    const int h_channel = param_.state_size;
+    const int gate_size = NumGates() * h_channel;
+    const int out_channel = num_dir * h_channel;
+    const size_t state_size = static_cast<size_t>(batch_size) * h_channel;
+    const size_t proj_size = static_cast<size_t>(seq_len) * batch_size * gate_size;
+    const size_t out_size = static_cast<size_t>(seq_len) * batch_size * out_channel;
+    const int num_tmp_out = std::min(num_layers - 1, 2);
+
+    const DType* w = in_data[rnn_enum::kParams].dptr<DType>();
+    const DType* hx = in_data[rnn_enum::kState].dptr<DType>();
+    const DType* cx = param_.lstm_q_ ? in_data[rnn_enum::kStateCell].dptr<DType>() : NULL;
+    DType* hy = param_.state_outputs ? out_data[rnn_enum::kStateOut].dptr<DType>() : NULL;
+    DType* cy = param_.state_outputs && param_.lstm_q_ ?
+        out_data[rnn_enum::kStateCellOut].dptr<DType>() : NULL;
+    DType* y = out_data[rnn_enum::kOut].dptr<DType>();
+    CHECK(in_data[rnn_enum::kData].CheckContiguous());
+    CHECK(out_data[rnn_enum::kOut].CheckContiguous());
+
+    // workspace: the input projections and the recurrent projections of every
+    // direction, the hidden and cell states, and the outputs of inner layers
+    const size_t workspace_size = num_dir * (proj_size + batch_size * gate_size +
+                                             state_size * (param_.lstm_q_ ? 2 : 1)) +
+                                  num_tmp_out * out_size;
+    DType* proj = ctx.requested[rnn_enum::kTempSpace]
+        .get_space_typed<cpu, 1, DType>(Shape1(workspace_size), s).dptr_;
+    DType* rec = proj + num_dir * proj_size;
+    DType* h = rec + num_dir * batch_size * gate_size;
+    DType* c = h + num_dir * state_size;
+    DType* tmp_out = c + (param_.lstm_q_ ? num_dir * state_size : 0);
+
+    // weights of every layer and direction are i2h_w, h2h_w, followed by the
+    // i2h_b, h2h_b of every layer and direction
+    const DType* bias = w + rnn_param_size(num_layers, xshape[2], h_channel,
+                                           param_.bidirectional, param_.mode) -
+                        num_layers * num_dir * 2 * gate_size;
+    const DType* layer_in = in_data[rnn_enum::kData].dptr<DType>();
+    int in_channel = xshape[2];
+    for (int layer = 0; layer < num_layers; ++layer) {
+      DType* layer_out = layer == num_layers - 1 ? y : tmp_out + (layer % 2) * out_size;
+      const DType* h2h_w[2];
+      const DType* h2h_b[2];
+      for (int d = 0; d < num_dir; ++d) {
+        const int index = layer * num_dir + d;
+        Tensor<cpu, 2, DType> in(const_cast<DType*>(layer_in),
+                                 Shape2(seq_len * batch_size, in_channel), s);
+        Tensor<cpu, 2, DType> i2h_w(const_cast<DType*>(w), Shape2(gate_size, in_channel), s);
+        Tensor<cpu, 2, DType> i2h_y(proj + d * proj_size,
+                                    Shape2(seq_len * batch_size, gate_size), s);
+        linalg_gemm(in, i2h_w, i2h_y, false, true, s);
+        w += gate_size * in_channel;
+        h2h_w[d] = w;
+        w += gate_size * h_channel;
+        h2h_b[d] = bias + (2 * index + 1) * gate_size;
+        // GRU adds the h2h bias inside the reset gate, all others fold it in
+        AddBias(i2h_y.dptr_, seq_len * batch_size, gate_size, bias + 2 * index * gate_size,
+                param_.mode == rnn_enum::kGru ? NULL : h2h_b[d]);
+        std::copy(hx + index * state_size, hx + (index + 1) * state_size, h + d * state_size);
+        if (param_.lstm_q_) {
+          std::copy(cx + index * state_size, cx + (index + 1) * state_size, c + d * state_size);
+        }
+      }
+      for (int t = 0; t < seq_len; ++t) {
+        for (int d = 0; d < num_dir; ++d) {
+          Tensor<cpu, 2, DType> h_d(h + d * state_size, Shape2(batch_size, h_channel), s);
+          Tensor<cpu, 2, DType> w_d(const_cast<DType*>(h2h_w[d]),
+                                    Shape2(gate_size, h_channel), s);
+          Tensor<cpu, 2, DType> rec_d(rec + d * batch_size * gate_size,
+                                      Shape2(batch_size, gate_size), s);
+          linalg_gemm(h_d, w_d, rec_d, false, true, s);
         }
-        i2h_y_flatten += repmat(i2h_b, seq_len * batch_size);
-        for (int64_t t = 0; t < seq_len; t++) {
-          int64_t timestep = t;
-          if (reverse_dir)
-            timestep = seq_len - 1 - t;
-          linalg_gemm(t == 0 ? hx[layer]:hy[layer], h2h_w, h2h_y,
-              false, true, s);
-          h2h_y += repmat(h2h_b, batch_size);
-          // fused element-wise ops
-          LSTMFusedElementWiseCPUOps(i2h_y[timestep], cx[layer], h2h_y,
-              y[timestep], out_tmp ? y_tmp[timestep]: y[timestep],
-                hy[layer], cy[layer], batch_size, h_channel, t,
-                reverse_dir, out_tmp && (layer == num_layers - 1));
+        switch (param_.mode) {
+          case rnn_enum::kRnnRelu:
+            RecurrentStep<rnn_enum::kRnnRelu>(t, seq_len, batch_size, num_dir, proj, rec, h2h_b,
+                                              h, c, layer_out);
+            break;
+          case rnn_enum::kRnnTanh:
+            RecurrentStep<rnn_enum::kRnnTanh>(t, seq_len, batch_size, num_dir, proj, rec, h2h_b,
+                                              h, c, layer_out);
+            break;
+          case rnn_enum::kLstm:
+            RecurrentStep<rnn_enum::kLstm>(t, seq_len, batch_size, num_dir, proj, rec, h2h_b,
+                                           h, c, layer_out);
+            break;
+          case rnn_enum::kGru:
+            RecurrentStep<rnn_enum::kGru>(t, seq_len, batch_size, num_dir, proj, rec, h2h_b,
+                                          h, c, layer_out);
+            break;
         }
       }
-    } else {
-      LOG(FATAL) << "only LSTM is available for cpu at the moment.";
+      for (int d = 0; d < num_dir && hy != NULL; ++d) {
+        const int index = layer * num_dir + d;
+        std::copy(h + d * state_size, h + (d + 1) * state_size, hy + index * state_size);
+        if (cy != NULL) {
+          std::copy(c + d * state_size, c + (d + 1) * state_size, cy + index * state_size);
+        }
+      }
+      layer_in = layer_out;
+      in_channel = out_channel;
     }
   }
 
   virtual void Backward(const OpContext &ctx,
                         const std::vector<TBlob> &out_grad,
                         const std::vector<TBlob> &in_data,
-      const std::vector<TBlob> &out_data,
+                        const std::vector<TBlob> &out_data,
                         const std::vector<OpReqType> &req,
                         const std::vector<TBlob> &in_grad,
                         const std::vector<TBlob> &aux_args) {
-    LOG(FATAL) << "LSTM backward is not available for cpu at the moment.";
+    LOG(FATAL) << "RNN backward is not available for cpu at the moment.";
   }
 
  private:
   RNNParam param_;
 
-  void LSTMFusedElementWiseCPUOps(const Tensor<cpu, 2, DType> &i2h_y,
-                                  const Tensor<cpu, 2, DType> &cx,
-                                  const Tensor<cpu, 2, DType> &h2h_y,
-                                  const Tensor<cpu, 2, DType> &y,
-                                  // holding intermediate layer output
-                                  const Tensor<cpu, 2, DType> &tmp,
-                                  const Tensor<cpu, 2, DType> &hy,
-                                  const Tensor<cpu, 2, DType> &cy,
-                                  const int64_t batch_size,
-                                  const int64_t h_channel,
-                                  const int64_t t,
-                                  const int reverse_dir,
-                                  const int copy_tmp2y) {
-    int64_t length = batch_size * h_channel;
-    #pragma omp parallel for
-    for (int64_t ji = 0; ji < length; ++ji) {
-      int64_t j = ji / h_channel;  // batch dim
-      int64_t i = ji % h_channel;
-      int64_t f = i + h_channel;
-      int64_t c = i + h_channel * 2;
-      int64_t o = i + h_channel * 3;
-      int64_t j_pos = j * h_channel * 4;
-      h2h_y.dptr_[j_pos + i] += i2h_y.dptr_[j_pos + i];
-      h2h_y.dptr_[j_pos + f] += i2h_y.dptr_[j_pos + f];
-      h2h_y.dptr_[j_pos + o] += i2h_y.dptr_[j_pos + o];
-      h2h_y.dptr_[j_pos + c] += i2h_y.dptr_[j_pos + c];
-      h2h_y.dptr_[j_pos + i] = 1.0f / (1.0f + math::exp(-h2h_y.dptr_[j_pos + i]));
-      h2h_y.dptr_[j_pos + f] = 1.0f / (1.0f + math::exp(-h2h_y.dptr_[j_pos + f]));
-      h2h_y.dptr_[j_pos + o] = 1.0f / (1.0f + math::exp(-h2h_y.dptr_[j_pos + o]));
-      h2h_y.dptr_[j_pos + c] = tanh(h2h_y.dptr_[j_pos + c]);
-      cy[j][i] = h2h_y.dptr_[j_pos + f] * (t == 0 ? cx[j][i]:cy[j][i])
-          + h2h_y.dptr_[j_pos + i] * h2h_y.dptr_[j_pos + c];
-      hy[j][i] = h2h_y.dptr_[j_pos + o] * tanh(cy[j][i]);
-      tmp[j][i + h_channel * reverse_dir] = hy[j][i];
-      if (copy_tmp2y) {
-        y[j][i] = tmp[j][i];
-        if (reverse_dir)
-          y[j][i + h_channel] = tmp[j][i + h_channel];
+  int NumGates() const {
+    switch (param_.mode) {
+      case rnn_enum::kLstm:
+        return 4;
+      case rnn_enum::kGru:
+        return 3;
+      default:
+        return 1;
+    }
+  }
+
+  /*! \brief adds b1 and, if not NULL, b2 to every row of data */
+  void AddBias(DType* data, int rows, int cols, const DType* b1, const DType* b2) {
+    #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+    for (int i = 0; i < rows; ++i) {
+      DType* row = data + static_cast<size_t>(i) * cols;
+      for (int j = 0; j < cols; ++j) row[j] += b1[j];
+      if (b2 == NULL) continue;
+      for (int j = 0; j < cols; ++j) row[j] += b2[j];
+    }
+  }
+
+  static DType Sigmoid(DType x) {
+    return DType(1) / (DType(1) + math::exp(-x));
+  }
+
+  /*!
+   * \brief gates and states of timestep t of every direction, the reversed
+   *  direction reads and writes timestep seq_len - 1 - t
+   * \param proj input projections (num_dir, seq_len, batch, gates * hidden), with the biases
+   * \param rec recurrent projections (num_dir, batch, gates * hidden), without the biases
+   * \param h hidden states (num_dir, batch, hidden), updated in place, c likewise for LSTM
+   * \param out output (seq_len, batch, num_dir * hidden)
+   */
+  template<int mode>
+  void RecurrentStep(const int t, const int seq_len, const int batch_size, const int num_dir,
+                     const DType* proj, const DType* rec, const DType* const* h2h_b,
+                     DType* h, DType* c, DType* out) {
+    const int hidden = param_.state_size;
+    const int gate_size = NumGates() * hidden;
+    const int length = num_dir * batch_size * hidden;
+    #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+    for (int i = 0; i < length; ++i) {
+      const int d = i / (batch_size * hidden);
+      const int n = i / hidden % batch_size;
+      const int j = i % hidden;
+      const int step = d == 0 ? t : seq_len - 1 - t;
+      const DType* p = proj + ((static_cast<size_t>(d) * seq_len + step) * batch_size + n) *
+                       gate_size;
+      const DType* r = rec + (static_cast<size_t>(d) * batch_size + n) * gate_size;
+      DType value;
+      if (mode == rnn_enum::kLstm) {
+        const DType in_gate = Sigmoid(p[j] + r[j]);
+        const DType forget_gate = Sigmoid(p[j + hidden] + r[j + hidden]);
+        const DType cell = math::tanh(p[j + 2 * hidden] + r[j + 2 * hidden]);
+        const DType out_gate = Sigmoid(p[j + 3 * hidden] + r[j + 3 * hidden]);
+        c[i] = forget_gate * c[i] + in_gate * cell;
+        value = out_gate * math::tanh(c[i]);
+      } else if (mode == rnn_enum::kGru) {
+        const DType* b = h2h_b[d];
+        const DType reset_gate = Sigmoid(p[j] + r[j] + b[j]);
+        const DType update_gate = Sigmoid(p[j + hidden] + r[j + hidden] + b[j + hidden]);
+        const DType next = math::tanh(p[j + 2 * hidden] +
+                                      reset_gate * (r[j + 2 * hidden] + b[j + 2 * hidden]));
+        value = (DType(1) - update_gate) * next + update_gate * h[i];
+      } else if (mode == rnn_enum::kRnnTanh) {
+        value = math::tanh(p[j] + r[j]);
+      } else {
+        value = std::max(p[j] + r[j], DType(0));
       }
+      h[i] = value;
+      out[(static_cast<size_t>(step) * batch_size + n) * num_dir * hidden + d * hidden + j] =
+          value;
     }
   }
 };  // class RNNOp
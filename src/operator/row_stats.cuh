@@ -0,0 +1,173 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file row_stats.cuh
+ * \brief gpu parts of the row statistics, one block per part of a row
+ */
+#ifndef MXNET_OPERATOR_ROW_STATS_CUH_
+#define MXNET_OPERATOR_ROW_STATS_CUH_
+
+#include <mxnet/base.h>
+#include <algorithm>
+#include "./mxnet_op.h"
+#include "../common/cuda_utils.h"
+
+namespace mxnet {
+namespace op {
+namespace row_stats {
+
+/*! \brief shortest part a row is split in on gpu */
+const int kGpuMinPartSize = 4 * mshadow::cuda::kBaseThreadNum;
+/*! \brief blocks the parts of all rows should at least give */
+const int kGpuTargetBlocks = 1024;
+
+/*!
+ * \brief number of parts a row is split in on gpu, a row per block is enough
+ *  for many rows while a few long rows are spread over more blocks
+ */
+inline int NumParts(mshadow::Stream<gpu>* s, const int nrows, const int row_size) {
+  const int by_size = (row_size + kGpuMinPartSize - 1) / kGpuMinPartSize;
+  const int by_rows = std::max(1, kGpuTargetBlocks / std::max(nrows, 1));
+  return std::max(1, std::min(by_size, by_rows));
+}
+
+/*! \brief a power of two number of threads for a part, at most kBaseThreadNum */
+inline int PartThreads(const int len) {
+  int threads = mshadow::cuda::kWarpSize;
+  while (threads < len && threads < mshadow::cuda::kBaseThreadNum) threads <<= 1;
+  return threads;
+}
+
+// every thread runs Welford over its elements of the part, then the block
+// merges the (count, mean, M2) triples pairwise in shared memory
+template<typename DType, typename AType>
+__global__ void PartMeanM2Kernel(const int tasks, const int row_size, const int parts,
+                                 const DType* in, AType* part_mean, AType* part_m2) {
+  __shared__ AType scount[mshadow::cuda::kBaseThreadNum];
+  __shared__ AType smean[mshadow::cuda::kBaseThreadNum];
+  __shared__ AType sm2[mshadow::cuda::kBaseThreadNum];
+  const int len = PartLength(row_size, parts);
+  for (int t = blockIdx.x; t < tasks; t += gridDim.x) {
+    const DType* x = in + static_cast<size_t>(t / parts) * row_size;
+    const int begin = t % parts * len;
+    const int end = begin + len < row_size ? begin + len : row_size;
+    AType count = 0, mu = 0, m2 = 0;
+    for (int j = begin + threadIdx.x; j < end; j += blockDim.x) {
+      const AType v = x[j];
+      count += 1;
+      const AType delta = v - mu;
+      mu += delta / count;
+      m2 += delta * (v - mu);
+    }
+    scount[threadIdx.x] = count;
+    smean[threadIdx.x] = mu;
+    sm2[threadIdx.x] = m2;
+    __syncthreads();
+    for (int offset = blockDim.x / 2; offset > 0; offset >>= 1) {
+      if (threadIdx.x < offset) {
+        const AType na = scount[threadIdx.x], nb = scount[threadIdx.x + offset];
+        const AType n = na + nb;
+        if (nb > 0) {
+          const AType delta = smean[threadIdx.x + offset] - smean[threadIdx.x];
+          smean[threadIdx.x] += delta * nb / n;
+          sm2[threadIdx.x] += sm2[threadIdx.x + offset] + delta * delta * na * nb / n;
+          scount[threadIdx.x] = n;
+        }
+      }
+      __syncthreads();
+    }
+    if (threadIdx.x == 0) {
+      part_mean[t] = smean[0];
+      part_m2[t] = sm2[0];
+    }
+    __syncthreads();
+  }
+}
+
+template<typename DType, typename AType>
+__global__ void PartSumsKernel(const int tasks, const int row_size, const int parts,
+                               const DType* a, const DType* b, const AType* center,
+                               AType* part_a, AType* part_ab) {
+  __shared__ AType sa[mshadow::cuda::kBaseThreadNum];
+  __shared__ AType sab[mshadow::cuda::kBaseThreadNum];
+  const int len = PartLength(row_size, parts);
+  for (int t = blockIdx.x; t < tasks; t += gridDim.x) {
+    const size_t offset = static_cast<size_t>(t / parts) * row_size;
+    const DType* x = a + offset;
+    const DType* y = b + offset;
+    const AType c = center ? center[t / parts] : AType(0);
+    const int begin = t % parts * len;
+    const int end = begin + len < row_size ? begin + len : row_size;
+    AType sum_a = 0, sum_ab = 0;
+    for (int j = begin + threadIdx.x; j < end; j += blockDim.x) {
+      const AType v = x[j];
+      sum_a += v;
+      sum_ab += v * (static_cast<AType>(y[j]) - c);
+    }
+    sa[threadIdx.x] = sum_a;
+    sab[threadIdx.x] = sum_ab;
+    __syncthreads();
+    for (int offset = blockDim.x / 2; offset > 0; offset >>= 1) {
+      if (threadIdx.x < offset) {
+        sa[threadIdx.x] += sa[threadIdx.x + offset];
+        sab[threadIdx.x] += sab[threadIdx.x + offset];
+      }
+      __syncthreads();
+    }
+    if (threadIdx.x == 0) {
+      if (part_a) part_a[t] = sa[0];
+      part_ab[t] = sab[0];
+    }
+    __syncthreads();
+  }
+}
+
+template<typename DType, typename AType>
+inline void PartMeanM2(mshadow::Stream<gpu>* s, const int nrows, const int row_size,
+                       const int parts, const DType* in, AType* part_mean, AType* part_m2) {
+  const int tasks = nrows * parts;
+  if (tasks == 0) return;
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+  PartMeanM2Kernel<<<std::min(tasks, mshadow::cuda::kMaxGridNum),
+                     PartThreads(PartLength(row_size, parts)), 0, stream>>>(
+    tasks, row_size, parts, in, part_mean, part_m2);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(PartMeanM2Kernel);
+}
+
+template<typename DType, typename AType>
+inline void PartSums(mshadow::Stream<gpu>* s, const int nrows, const int row_size,
+                     const int parts, const DType* a, const DType* b, const AType* center,
+                     AType* part_a, AType* part_ab) {
+  const int tasks = nrows * parts;
+  if (tasks == 0) return;
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+  PartSumsKernel<<<std::min(tasks, mshadow::cuda::kMaxGridNum),
+                   PartThreads(PartLength(row_size, parts)), 0, stream>>>(
+    tasks, row_size, parts, a, b, center, part_a, part_ab);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(PartSumsKernel);
+}
+
+}  // namespace row_stats
+}  // namespace op
+}  // namespace mxnet
+
+#endif  // MXNET_OPERATOR_ROW_STATS_CUH_
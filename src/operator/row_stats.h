@@ -0,0 +1,174 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file row_stats.h
+ * \brief statistics of the rows of a contiguous (nrows, row_size) input, each
+ *  row reduced in parts that are merged per row, so the input is read once
+ *  however few rows there are
+ */
+#ifndef MXNET_OPERATOR_ROW_STATS_H_
+#define MXNET_OPERATOR_ROW_STATS_H_
+
+#include <mxnet/base.h>
+#include <algorithm>
+#include "./mxnet_op.h"
+
+namespace mxnet {
+namespace op {
+namespace row_stats {
+
+/*! \brief type the statistics of a row are accumulated in */
+template<typename DType>
+struct AccType {
+  typedef float type;
+};
+
+template<>
+struct AccType<double> {
+  typedef double type;
+};
+
+/*! \brief elements of a part on cpu, which stays in L1 for its second pass */
+const int kCpuPartSize = 4096;
+/*! \brief independent partial sums of a part on cpu, so the sums vectorize */
+const int kLanes = 8;
+
+/*! \brief length of each of the parts a row is split in, the last ones may be shorter */
+MSHADOW_XINLINE int PartLength(const int row_size, const int parts) {
+  return (row_size + parts - 1) / parts;
+}
+
+/*! \brief number of parts a row is split in on cpu */
+inline int NumParts(mshadow::Stream<cpu>* s, const int nrows, const int row_size) {
+  return std::max(1, (row_size + kCpuPartSize - 1) / kCpuPartSize);
+}
+
+/*! \brief sum of f(j) for j in [begin, end), in kLanes partial sums */
+template<typename AType, typename F>
+inline AType LaneSum(const int begin, const int end, F f) {
+  AType acc[kLanes] = {0};
+  int j = begin;
+  for (; j + kLanes <= end; j += kLanes) {
+    for (int k = 0; k < kLanes; ++k) acc[k] += f(j + k);
+  }
+  for (; j < end; ++j) acc[0] += f(j);
+  AType sum = 0;
+  for (int k = 0; k < kLanes; ++k) sum += acc[k];
+  return sum;
+}
+
+/*!
+ * \brief mean and M2, the sum of squared deviations, of every part of the rows
+ *  of in, written at r * parts + p of part_mean and part_m2. Merge them with
+ *  merge_mean_var.
+ */
+template<typename DType, typename AType>
+inline void PartMeanM2(mshadow::Stream<cpu>* s, const int nrows, const int row_size,
+                       const int parts, const DType* in, AType* part_mean, AType* part_m2) {
+  const int len = PartLength(row_size, parts);
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int t = 0; t < nrows * parts; ++t) {
+    const DType* x = in + static_cast<size_t>(t / parts) * row_size;
+    const int begin = std::min(t % parts * len, row_size);
+    const int end = std::min(begin + len, row_size);
+    const AType mu = end > begin ? LaneSum<AType>(begin, end, [x](int j) {
+      return static_cast<AType>(x[j]);
+    }) / (end - begin) : AType(0);
+    part_mean[t] = mu;
+    part_m2[t] = LaneSum<AType>(begin, end, [x, mu](int j) {
+      const AType d = static_cast<AType>(x[j]) - mu;
+      return d * d;
+    });
+  }
+}
+
+/*!
+ * \brief sums of a and of a * (b - center[r]) over every part of the rows,
+ *  written at r * parts + p of part_a and part_ab. part_a may be null, and so
+ *  may center for a plain dot product. Merge them with merge_sums.
+ */
+template<typename DType, typename AType>
+inline void PartSums(mshadow::Stream<cpu>* s, const int nrows, const int row_size,
+                     const int parts, const DType* a, const DType* b, const AType* center,
+                     AType* part_a, AType* part_ab) {
+  const int len = PartLength(row_size, parts);
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int t = 0; t < nrows * parts; ++t) {
+    const size_t offset = static_cast<size_t>(t / parts) * row_size;
+    const DType* x = a + offset;
+    const DType* y = b + offset;
+    const AType c = center ? center[t / parts] : AType(0);
+    const int begin = std::min(t % parts * len, row_size);
+    const int end = std::min(begin + len, row_size);
+    if (part_a) {
+      part_a[t] = LaneSum<AType>(begin, end, [x](int j) {
+        return static_cast<AType>(x[j]);
+      });
+    }
+    part_ab[t] = LaneSum<AType>(begin, end, [x, y, c](int j) {
+      return static_cast<AType>(x[j]) * (static_cast<AType>(y[j]) - c);
+    });
+  }
+}
+
+/*! \brief merge the part means and M2 of PartMeanM2 into the mean and biased variance of row r */
+struct merge_mean_var {
+  template<typename AType, typename DType>
+  MSHADOW_XINLINE static void Map(int r, const int row_size, const int parts,
+                                  const AType* part_mean, const AType* part_m2,
+                                  DType* mean, DType* var) {
+    const int len = PartLength(row_size, parts);
+    AType count = 0, mu = 0, m2 = 0;
+    for (int p = 0; p < parts && p * len < row_size; ++p) {
+      // Chan's pairwise update of (count, mean, M2)
+      const AType nb = row_size - p * len < len ? row_size - p * len : len;
+      const AType n = count + nb;
+      const AType delta = part_mean[r * parts + p] - mu;
+      mu += delta * nb / n;
+      m2 += part_m2[r * parts + p] + delta * delta * count * nb / n;
+      count = n;
+    }
+    mean[r] = DType(mu);
+    var[r] = DType(m2 / row_size);
+  }
+};
+
+/*! \brief sum the parts of row r */
+struct merge_sums {
+  template<typename AType, typename DType>
+  MSHADOW_XINLINE static void Map(int r, const int parts, const AType* part, DType* sum) {
+    AType acc = 0;
+    for (int p = 0; p < parts; ++p) acc += part[r * parts + p];
+    sum[r] = DType(acc);
+  }
+};
+
+}  // namespace row_stats
+}  // namespace op
+}  // namespace mxnet
+#ifdef __CUDACC__
+#include "./row_stats.cuh"
+#endif
+
+#endif  // MXNET_OPERATOR_ROW_STATS_H_
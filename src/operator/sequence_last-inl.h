@@ -63,28 +63,33 @@ struct SequenceLastParam : public dmlc::Parameter<SequenceLastParam> {
   }
 };
 
-template <int req>
+// row b of the (batch, rest) output, the last row of sequence b in the
+// (seqlen, batch, rest) or, with axis 1, (batch, seqlen, rest) input
+template <int req, int axis>
 struct SequenceLastKernel {
-  template <typename DType>
-  MSHADOW_XINLINE static void Map(int i, DType *out, const DType *in,
-                                  const DType *idx, int offset1, int offset2,
-                                  mshadow::Shape<2> oshape) {
-    const auto opos = mxnet_op::unravel(i, oshape);
-    const int seqpos = static_cast<int>(idx[opos[0]]) - 1;
-    const int ipos = seqpos * offset1 + opos[0] * offset2 + opos[1];
-    KERNEL_ASSIGN(out[i], req, in[ipos]);
+  template <typename VType, typename DType>
+  MSHADOW_XINLINE static void Map(int i, VType *out, const VType *in,
+                                  const DType *idx, index_t max_seq_len,
+                                  index_t batch_size, index_t restsize) {
+    const index_t b = i / restsize;
+    const index_t seqpos = static_cast<int>(idx[b]) - 1;
+    const index_t row = axis ? b * max_seq_len + seqpos : seqpos * batch_size + b;
+    SequenceAssign<req>(out[i], in[row * restsize + i % restsize]);
   }
 };
 
+// the gradient of row b of the output goes to the last row of sequence b, the
+// rest of the input gradient is left alone
+template <int req, int axis>
 struct SequenceLastGradKernel {
-  template <typename DType>
-  MSHADOW_XINLINE static void Map(int i, DType *in_grad, const DType *out_grad,
-                                  const DType *idx, int offset1, int offset2,
-                                  mshadow::Shape<2> oshape) {
-    const auto opos = mxnet_op::unravel(i, oshape);
-    const int seqpos = static_cast<int>(idx[opos[0]]) - 1;
-    const int ipos = seqpos * offset1 + opos[0] * offset2 + opos[1];
-    in_grad[ipos] += out_grad[i];
+  template <typename VType, typename DType>
+  MSHADOW_XINLINE static void Map(int i, VType *in_grad, const VType *out_grad,
+                                  const DType *idx, index_t max_seq_len,
+                                  index_t batch_size, index_t restsize) {
+    const index_t b = i / restsize;
+    const index_t seqpos = static_cast<int>(idx[b]) - 1;
+    const index_t row = axis ? b * max_seq_len + seqpos : seqpos * batch_size + b;
+    SequenceAssign<req>(in_grad[row * restsize + i % restsize], out_grad[i]);
   }
 };
 
@@ -93,45 +98,62 @@ class SequenceLastOp : public Operator {
  public:
   explicit SequenceLastOp(SequenceLastParam p) { this->param_ = p; }
 
+  // launch OP over the (batch, rest) array small, indexing the (seqlen, batch, rest)
+  // or (batch, seqlen, rest) array large, 16 bytes at a time where the rows allow
+  template <template <int, int> class OP, int req>
+  void launch(const mshadow::Tensor<xpu, 3, DType> &large,
+              const mshadow::Tensor<xpu, 2, DType> &small,
+              const mshadow::Tensor<xpu, 1, DType> &indices,
+              bool small_is_out, mshadow::Stream<xpu> *const s) {
+    typedef SequenceVector<DType> VType;
+    const index_t batch = small.size(0);
+    const index_t rest = small.size(1);
+    const index_t max_seq_len = large.size(param_.axis);
+    DType *out = small_is_out ? small.dptr_ : large.dptr_;
+    DType *in = small_is_out ? large.dptr_ : small.dptr_;
+    if (SequenceVectorizable<DType>(rest, {large.dptr_, small.dptr_})) {
+      if (param_.axis) {
+        mxnet_op::Kernel<OP<req, 1>, xpu>::Launch(
+            s, batch * rest / VType::kSize, reinterpret_cast<VType *>(out),
+            reinterpret_cast<const VType *>(in), indices.dptr_, max_seq_len, batch,
+            rest / VType::kSize);
+      } else {
+        mxnet_op::Kernel<OP<req, 0>, xpu>::Launch(
+            s, batch * rest / VType::kSize, reinterpret_cast<VType *>(out),
+            reinterpret_cast<const VType *>(in), indices.dptr_, max_seq_len, batch,
+            rest / VType::kSize);
+      }
+    } else if (param_.axis) {
+      mxnet_op::Kernel<OP<req, 1>, xpu>::Launch(
+          s, batch * rest, out, static_cast<const DType *>(in), indices.dptr_,
+          max_seq_len, batch, rest);
+    } else {
+      mxnet_op::Kernel<OP<req, 0>, xpu>::Launch(
+          s, batch * rest, out, static_cast<const DType *>(in), indices.dptr_,
+          max_seq_len, batch, rest);
+    }
+  }
+
   void sequence_last(const mshadow::Tensor<xpu, 3, DType> &data,
                      const mshadow::Tensor<xpu, 2, DType> &out,
                      const mshadow::Tensor<xpu, 1, DType> &indices,
                      const OpReqType req, mshadow::Stream<xpu> *const s) {
-    using namespace mshadow;
-    using namespace mshadow::expr;
-
-    int axis = param_.axis;
-    int out_size = out.size(0) * out.size(1);
-    int max_seq_len = data.size(axis);
-    int offset1 = axis ? out.size(1) : out_size;
-    int offset2 = axis ? (max_seq_len * out.size(1)) : out.size(1);
-
     MXNET_ASSIGN_REQ_SWITCH(req, req_type, {
-      mxnet_op::Kernel<SequenceLastKernel<req_type>, xpu>::Launch(
-          s, out_size, out.dptr_, data.dptr_, indices.dptr_, offset1, offset2,
-          out.shape_);
+      launch<SequenceLastKernel, req_type>(data, out, indices, true, s);
     });
   }
 
+  // each sequence has one last row, so after zeroing a written gradient the
+  // rows are assigned rather than added
   void sequence_last_grad(const mshadow::Tensor<xpu, 3, DType> &in_grad,
                           const mshadow::Tensor<xpu, 2, DType> &out_grad,
                           const mshadow::Tensor<xpu, 1, DType> &indices,
-                          mshadow::Stream<xpu> *const s) {
-    using namespace mshadow;
-    using namespace mshadow::expr;
-
-    auto axis = param_.axis;
-    int batch = out_grad.size(0);
-    int rest = out_grad.size(1);
-    int out_size = batch * rest;
-
-    int max_seq_len = in_grad.size(axis);
-    int offset1 = axis ? rest : out_size;
-    int offset2 = axis ? (max_seq_len * rest) : rest;
-
-    mxnet_op::Kernel<SequenceLastGradKernel, xpu>::Launch(
-        s, out_size, in_grad.dptr_, out_grad.dptr_, indices.dptr_, offset1,
-        offset2, out_grad.shape_);
+                          const OpReqType req, mshadow::Stream<xpu> *const s) {
+    if (req == kAddTo) {
+      launch<SequenceLastGradKernel, kAddTo>(in_grad, out_grad, indices, false, s);
+    } else {
+      launch<SequenceLastGradKernel, kWriteTo>(in_grad, out_grad, indices, false, s);
+    }
   }
 
   virtual void Forward(const OpContext &ctx, const std::vector<TBlob> &in_data,
@@ -198,6 +220,7 @@ class SequenceLastOp : public Operator {
     auto dsize = in_data[seq_last::kData].Size();
 
     auto batch = (axis != 0) ? d0 : d1;
+    auto max_seq_len = in_data[seq_last::kData].size(axis);
     auto rest_size = dsize / (d0 * d1);
 
     Tensor<xpu, 3, DType> data_grad =
@@ -211,9 +234,10 @@ class SequenceLastOp : public Operator {
             ? in_data[seq_last::kSequenceLength].get<xpu, 1, DType>(s)
             : ctx.requested[seq_last::kTempSpace]
                   .get_space_typed<xpu, 1, DType>(Shape1(batch), s);
+    if (!param_.use_sequence_length) indices = max_seq_len;
 
     if (req[seq_last::kData] == kWriteTo) data_grad = 0.0f;
-    sequence_last_grad(data_grad, output_grad, indices, s);
+    sequence_last_grad(data_grad, output_grad, indices, req[seq_last::kData], s);
   }
 
  private:
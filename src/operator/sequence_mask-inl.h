@@ -37,6 +37,7 @@
 #include <vector>
 #include "./mshadow_op.h"
 #include "./operator_common.h"
+#include "./sequence_op_common.h"
 
 namespace mxnet {
 namespace op {
@@ -44,7 +45,6 @@ namespace op {
 namespace seq_mask {
 enum SequenceMaskOpInputs { kData, kSequenceLength };
 enum SequenceMaskOpOutputs { kOut };
-enum SequenceMaskOpBackResource { kTempSpace };
 }
 
 struct SequenceMaskParam : public dmlc::Parameter<SequenceMaskParam> {
@@ -65,39 +65,20 @@ struct SequenceMaskParam : public dmlc::Parameter<SequenceMaskParam> {
   }
 };
 
-// (seqlen, batch, rest) case
-template <int req>
-struct SequenceMask0Kernel {
-  template <typename DType>
-  MSHADOW_XINLINE static void Map(int b, DType *in, const DType *idx,
-                                  index_t max_s_len, index_t batch_size,
-                                  index_t restsize, DType value) {
-    const index_t seqpos = static_cast<int>(idx[b]);
-#pragma unroll
-    for (index_t s = seqpos; s < max_s_len; ++s) {
-      index_t incr = (s * batch_size * restsize) + (b * restsize);
-#pragma unroll
-      for (index_t r = 0; r < restsize; ++r)
-        KERNEL_ASSIGN(in[incr + r], req, value);
-    }
-  }
-};
-
-// (batch, seqlen, rest) case
-template <int req>
-struct SequenceMask1Kernel {
-  template <typename DType>
-  MSHADOW_XINLINE static void Map(int b, DType *in, const DType *idx,
-                                  index_t max_s_len, index_t batch_size,
-                                  index_t restsize, DType value) {
-    const index_t seqpos = static_cast<int>(idx[b]);
-#pragma unroll
-    for (index_t s = seqpos; s < max_s_len; ++s) {
-      index_t incr = (b * max_s_len * restsize) + (s * restsize);
-#pragma unroll
-      for (index_t r = 0; r < restsize; ++r)
-        KERNEL_ASSIGN(in[incr + r], req, value);
-    }
+// element i of the (seqlen, batch, rest) or, with axis 1, (batch, seqlen, rest)
+// output, a copy of the input inside the sequence and value past its end
+template <int req, int axis>
+struct SequenceMaskKernel {
+  template <typename VType, typename DType>
+  MSHADOW_XINLINE static void Map(int i, VType *out, const VType *in,
+                                  const DType *idx, index_t max_s_len,
+                                  index_t batch_size, index_t restsize,
+                                  VType value) {
+    const index_t row = i / restsize;
+    const index_t s = axis ? row % max_s_len : row / batch_size;
+    const index_t b = axis ? row / max_s_len : row % batch_size;
+    const int seqlen = static_cast<int>(idx[b]);
+    SequenceAssign<req>(out[i], static_cast<int>(s) < seqlen ? in[i] : value);
   }
 };
 
@@ -106,26 +87,45 @@ class SequenceMaskOp : public Operator {
  public:
   explicit SequenceMaskOp(SequenceMaskParam p) { this->param_ = p; }
 
+  // out = data with the elements past the end of each sequence set to val, in
+  // one pass that moves 16 bytes at a time where the rows allow
   void sequence_mask(const mshadow::Tensor<xpu, 3, DType> &data,
+                     const mshadow::Tensor<xpu, 3, DType> &out,
                      const mshadow::Tensor<xpu, 1, DType> &indices,
                      const OpReqType req, mshadow::Stream<xpu> *const s,
                      DType val) {
     using namespace mshadow;
     using namespace mshadow::expr;
+    typedef SequenceVector<DType> VType;
 
     index_t batch = indices.size(0);
     index_t max_seq_len = data.size(param_.axis);
     index_t restsize = data.size(2);
+    index_t size = data.shape_.Size();
+    const bool vectorize = SequenceVectorizable<DType>(restsize, {data.dptr_, out.dptr_});
 
     MXNET_ASSIGN_REQ_SWITCH(req, req_type, {
-      if (param_.axis == 1)
-        mxnet_op::Kernel<SequenceMask1Kernel<req_type>, xpu>::Launch(
-            s, batch, data.dptr_, indices.dptr_, max_seq_len, batch, restsize,
-            val);
-      else
-        mxnet_op::Kernel<SequenceMask0Kernel<req_type>, xpu>::Launch(
-            s, batch, data.dptr_, indices.dptr_, max_seq_len, batch, restsize,
-            val);
+      if (vectorize) {
+        if (param_.axis == 1) {
+          mxnet_op::Kernel<SequenceMaskKernel<req_type, 1>, xpu>::Launch(
+              s, size / VType::kSize, reinterpret_cast<VType *>(out.dptr_),
+              reinterpret_cast<const VType *>(data.dptr_), indices.dptr_, max_seq_len,
+              batch, restsize / VType::kSize, SequenceVectorFill(val));
+        } else {
+          mxnet_op::Kernel<SequenceMaskKernel<req_type, 0>, xpu>::Launch(
+              s, size / VType::kSize, reinterpret_cast<VType *>(out.dptr_),
+              reinterpret_cast<const VType *>(data.dptr_), indices.dptr_, max_seq_len,
+              batch, restsize / VType::kSize, SequenceVectorFill(val));
+        }
+      } else if (param_.axis == 1) {
+        mxnet_op::Kernel<SequenceMaskKernel<req_type, 1>, xpu>::Launch(
+            s, size, out.dptr_, data.dptr_, indices.dptr_, max_seq_len, batch,
+            restsize, val);
+      } else {
+        mxnet_op::Kernel<SequenceMaskKernel<req_type, 0>, xpu>::Launch(
+            s, size, out.dptr_, data.dptr_, indices.dptr_, max_seq_len, batch,
+            restsize, val);
+      }
     });
   }
 
@@ -151,12 +151,13 @@ class SequenceMaskOp : public Operator {
     Tensor<xpu, 3, DType> out =
         out_data[seq_mask::kOut].get_with_shape<xpu, 3, DType>(s3, s);
     // Actual implementation of masking
-    Assign(out, req[seq_mask::kOut], F<mshadow_op::identity>(data));
     if (param_.use_sequence_length) {
       Tensor<xpu, 1, DType> indices =
           in_data[seq_mask::kSequenceLength].get<xpu, 1, DType>(s);
-      sequence_mask(out, indices, req[seq_mask::kOut], s,
+      sequence_mask(data, out, indices, req[seq_mask::kOut], s,
                     static_cast<DType>(param_.value));
+    } else {
+      Assign(out, req[seq_mask::kOut], F<mshadow_op::identity>(data));
     }
   }
 
@@ -192,18 +193,7 @@ class SequenceMaskOp : public Operator {
     } else {
       Tensor<xpu, 1, DType> indices =
           in_data[seq_mask::kSequenceLength].get<xpu, 1, DType>(s);
-      if (req[seq_mask::kData] == kAddTo) {
-        Tensor<xpu, 3, DType> out_g_temp =
-            ctx.requested[seq_mask::kTempSpace].get_space_typed<xpu, 3, DType>(
-                s3, s);
-        out_g_temp = F<mshadow_op::identity>(out_g);
-        out_g = out_g_temp;
-        sequence_mask(out_g, indices, kWriteInplace, s, DType(0.));
-        Assign(data_g, kAddTo, F<mshadow_op::identity>(out_g));
-      } else {
-        Assign(data_g, req[seq_mask::kData], F<mshadow_op::identity>(out_g));
-        sequence_mask(data_g, indices, req[seq_mask::kData], s, DType(0.));
-      }
+      sequence_mask(out_g, data_g, indices, req[seq_mask::kData], s, DType(0.));
     }
   }
 
@@ -296,11 +286,6 @@ class SequenceMaskProp : public OperatorProperty {
       return {out_grad[seq_mask::kOut]};
   }
 
-  std::vector<ResourceRequest> BackwardResource(
-      const std::vector<TShape> &in_shape) const override {
-    return {ResourceRequest::kTempSpace};
-  }
-
   std::vector<std::pair<int, void *> > BackwardInplaceOption(
       const std::vector<int> &out_grad, const std::vector<int> &in_data,
       const std::vector<int> &out_data,
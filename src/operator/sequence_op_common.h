@@ -27,7 +27,10 @@
 #define MXNET_OPERATOR_SEQUENCE_OP_COMMON_H_
 #include <dmlc/logging.h>
 #include <mxnet/operator.h>
+#include <cstdint>
+#include <initializer_list>
 #include <vector>
+#include "./mxnet_op.h"
 #include "./operator_common.h"
 
 namespace mxnet {
@@ -61,6 +64,56 @@ inline IndexTensorToVector(mshadow::Tensor<cpu, 1, DType> data,
     (*index_vec)[i] = static_cast<RType>(std::lround(index_array[i]));
 }
 
+/*!
+ * \brief 16 bytes of elements, which the sequence kernels move with one load
+ *  and one store instead of one per element
+ */
+template <typename DType>
+struct alignas(16) SequenceVector {
+  static const int kSize = 16 / sizeof(DType);
+  DType val[kSize];
+};
+
+/*!
+ * \brief whether rows of row_size elements starting at the given addresses can
+ *  be moved as SequenceVector, which requires the rows to keep their alignment
+ */
+template <typename DType>
+inline bool SequenceVectorizable(index_t row_size, std::initializer_list<const void *> ptrs) {
+  if (row_size % SequenceVector<DType>::kSize != 0) return false;
+  for (const void *ptr : ptrs) {
+    if (reinterpret_cast<uintptr_t>(ptr) % sizeof(SequenceVector<DType>) != 0) return false;
+  }
+  return true;
+}
+
+/*! \brief assign val to out according to req */
+template <int req, typename DType>
+MSHADOW_XINLINE void SequenceAssign(DType &out, const DType &val) {  // NOLINT(*)
+  KERNEL_ASSIGN(out, req, val);
+}
+
+template <int req, typename DType>
+MSHADOW_XINLINE void SequenceAssign(SequenceVector<DType> &out,  // NOLINT(*)
+                                    const SequenceVector<DType> &val) {
+  if (req == kAddTo) {
+    SequenceVector<DType> sum = out;
+#pragma unroll
+    for (int i = 0; i < SequenceVector<DType>::kSize; ++i) sum.val[i] += val.val[i];
+    out = sum;
+  } else if (req != kNullOp) {
+    out = val;
+  }
+}
+
+/*! \brief SequenceVector with all elements set to value */
+template <typename DType>
+inline SequenceVector<DType> SequenceVectorFill(DType value) {
+  SequenceVector<DType> ret;
+  for (int i = 0; i < SequenceVector<DType>::kSize; ++i) ret.val[i] = value;
+  return ret;
+}
+
 }  // namespace op
 }  // namespace mxnet
 #endif  // MXNET_OPERATOR_SEQUENCE_OP_COMMON_H_
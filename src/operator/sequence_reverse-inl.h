@@ -29,6 +29,7 @@
 #define MXNET_OPERATOR_SEQUENCE_REVERSE_INL_H_
 
 #include <dmlc/logging.h>
+#include <dmlc/optional.h>
 #include <dmlc/parameter.h>
 #include <mxnet/operator.h>
 #include <algorithm>
@@ -52,6 +53,7 @@ enum SequenceReverseOpOutputs { kOut };
 struct SequenceReverseParam : public dmlc::Parameter<SequenceReverseParam> {
   bool use_sequence_length;
   int axis;
+  dmlc::optional<float> value;
   DMLC_DECLARE_PARAMETER(SequenceReverseParam) {
     DMLC_DECLARE_FIELD(use_sequence_length)
         .set_default(false)
@@ -61,43 +63,32 @@ struct SequenceReverseParam : public dmlc::Parameter<SequenceReverseParam> {
             "to specify variable length sequence");
     DMLC_DECLARE_FIELD(axis).set_default(0).describe(
         "The sequence axis. Only 0 is currently supported.");
+    DMLC_DECLARE_FIELD(value)
+        .set_default(dmlc::optional<float>())
+        .describe(
+            "If set, the elements past the end of each sequence are set to this "
+            "value instead of being copied, like SequenceMask does in the same pass.");
   }
 };
 
-struct ReverseKernel {
-  template <typename DType>
-  MSHADOW_XINLINE static void Map(const int i, DType *const out_data,
-                                  const DType *const in_data,
-                                  const OpReqType req,
-                                  const index_t max_seq_len,
-                                  const index_t batch_size,
-                                  const index_t other_dim, const index_t numel,
-                                  const DType *const indices) {
-    for (index_t batch = 0; batch < batch_size; ++batch) {
-      const index_t num_seq =
-          indices ? static_cast<index_t>(indices[batch]) : max_seq_len;
-      const index_t padded_periods = max_seq_len - num_seq;
-      // padded part
-      if (padded_periods > 0 && i < static_cast<int>(padded_periods)) {
-        const int padded_in_offset =
-            (i + num_seq) * batch_size * other_dim + batch * other_dim;
-
-        for (index_t j = 0; j < other_dim; ++j) {
-          KERNEL_ASSIGN(out_data[padded_in_offset + j], req,
-                        in_data[padded_in_offset + j]);
-        }
-      }
-      // unpadded part
-      if (i < static_cast<int>(num_seq)) {
-        const int in_offset = i * batch_size * other_dim + batch * other_dim;
-        const int out_offset =
-            numel - (i + 1 + padded_periods) * batch_size * other_dim +
-            batch * other_dim;
-
-        for (index_t j = 0; j < other_dim; ++j) {
-          KERNEL_ASSIGN(out_data[out_offset + j], req, in_data[in_offset + j]);
-        }
-      }
+// element i of the (seqlen, batch, rest) output, the element of the reversed
+// sequence, or past the end of the sequence the input, or value when masking
+template <int req>
+struct SequenceReverseKernel {
+  template <typename VType, typename DType>
+  MSHADOW_XINLINE static void Map(int i, VType *out, const VType *in,
+                                  const DType *idx, index_t max_seq_len,
+                                  index_t batch_size, index_t restsize,
+                                  bool mask, VType value) {
+    const index_t row = i / restsize;
+    const int t = row / batch_size;
+    const index_t b = row % batch_size;
+    const int seqlen = idx ? static_cast<int>(idx[b]) : static_cast<int>(max_seq_len);
+    if (t < seqlen) {
+      const index_t src = ((seqlen - 1 - t) * batch_size + b) * restsize + i % restsize;
+      SequenceAssign<req>(out[i], in[src]);
+    } else {
+      SequenceAssign<req>(out[i], mask ? value : in[i]);
     }
   }
 };
@@ -109,18 +100,28 @@ class SequenceReverseOp : public Operator {
   void sequence_reverse(const mshadow::Tensor<xpu, 3, DType> &data,
                         const mshadow::Tensor<xpu, 3, DType> &out,
                         const OpReqType req, const DType *const indices,
-                        mshadow::Stream<xpu> *const s) {
+                        bool mask, DType value, mshadow::Stream<xpu> *const s) {
     using namespace mshadow;
     using namespace mshadow::expr;
+    typedef SequenceVector<DType> VType;
 
     const index_t max_seq_len = data.size(0);
     const index_t batch_size = data.size(1);
     const index_t other_dim = data.size(2);
     const index_t tensor_numel = data.shape_.Size();
 
-    mxnet_op::Kernel<ReverseKernel, xpu>::Launch(
-        s, max_seq_len, out.dptr_, data.dptr_, req, max_seq_len, batch_size,
-        other_dim, tensor_numel, indices);
+    MXNET_ASSIGN_REQ_SWITCH(req, req_type, {
+      if (SequenceVectorizable<DType>(other_dim, {data.dptr_, out.dptr_})) {
+        mxnet_op::Kernel<SequenceReverseKernel<req_type>, xpu>::Launch(
+            s, tensor_numel / VType::kSize, reinterpret_cast<VType *>(out.dptr_),
+            reinterpret_cast<const VType *>(data.dptr_), indices, max_seq_len,
+            batch_size, other_dim / VType::kSize, mask, SequenceVectorFill(value));
+      } else {
+        mxnet_op::Kernel<SequenceReverseKernel<req_type>, xpu>::Launch(
+            s, tensor_numel, out.dptr_, data.dptr_, indices, max_seq_len,
+            batch_size, other_dim, mask, value);
+      }
+    });
   }
 
   virtual void Forward(const OpContext &ctx, const std::vector<TBlob> &in_data,
@@ -150,7 +151,10 @@ class SequenceReverseOp : public Operator {
             ? in_data[seq_reverse::kSequenceLength].dptr<DType>()
             : nullptr;
 
-    sequence_reverse(data, out, req[seq_reverse::kOut], indices, s);
+    sequence_reverse(data, out, req[seq_reverse::kOut], indices,
+                     param_.value.has_value(),
+                     static_cast<DType>(param_.value.has_value() ? param_.value.value() : 0.f),
+                     s);
   }
 
   virtual void Backward(const OpContext &ctx,
@@ -184,8 +188,9 @@ class SequenceReverseOp : public Operator {
             ? in_data[seq_reverse::kSequenceLength].dptr<DType>()
             : nullptr;
 
+    // masked elements are constant, their gradient is 0
     sequence_reverse(output_grad, data_grad, req[seq_reverse::kData], indices,
-                     s);
+                     param_.value.has_value(), DType(0.f), s);
   }
 
  private:
@@ -99,6 +99,10 @@ class SliceChannelOp : public Operator {
     for (int i = 0; i < size_; ++i) {
       outputs[i] = out_data[i].get_with_shape<xpu, 3, DType>(slice_shape, s);
     }
+    if (std::find(req.begin(), req.end(), kAddTo) == req.end() &&
+        IsContiguousSlices(outputs, data)) {
+      return;
+    }
     Split(data, &outputs, 1, req);
   }
 
@@ -36,6 +36,7 @@
 #include <string>
 #include <utility>
 #include "./operator_common.h"
+#include "./mxnet_op.h"
 #include "./linalg.h"
 
 
@@ -46,7 +47,7 @@ namespace st {
 enum SpatialTransformerOpInputs {kData, kLoc};
 enum SpatialTransformerOpOutputs {kOut, kGridDst, kGridSrc};
 enum SpatialTransformerOpResource {kTempSpace};
-enum SpatialTransformerTransformType {kAffine};
+enum SpatialTransformerTransformType {kAffine, kWarp};
 enum SpatialTransformerSamplerType {kBilinear};
 }
 
@@ -54,17 +55,114 @@ struct SpatialTransformerParam : public dmlc::Parameter<SpatialTransformerParam>
   TShape target_shape;
   int transform_type;
   int sampler_type;
+  bool cudnn_off;
   DMLC_DECLARE_PARAMETER(SpatialTransformerParam) {
     int shape[] = {0, 0};
     DMLC_DECLARE_FIELD(target_shape).set_default(TShape(shape, shape + 2))
-        .describe("output shape(h, w) of spatial transformer: (y, x)");
+        .describe("output shape(h, w) of spatial transformer: (y, x). "
+                  "Ignored by the warp transform, whose output has the size of the flow.");
     DMLC_DECLARE_FIELD(transform_type).add_enum("affine", st::kAffine)
-        .describe("transformation type");
+        .add_enum("warp", st::kWarp)
+        .describe("transformation type. For `affine`, loc is a (batch, 6) affine matrix, "
+                  "for `warp` it is an optical flow of shape (batch, 2, height, width), "
+                  "as in GridGenerator.");
     DMLC_DECLARE_FIELD(sampler_type).add_enum("bilinear", st::kBilinear)
         .describe("sampling type");
+    DMLC_DECLARE_FIELD(cudnn_off).set_default(false)
+        .describe("Turn off cudnn for the affine transform and use the fused sampler.");
+  }
+
+  /*! \brief whether the sampling grid is materialized in the hidden outputs, by cudnn */
+  bool NeedsGrid() const {
+    return transform_type == st::kAffine && !cudnn_off;
+  }
+};
+
+/*! \brief normalized [-1, 1] coordinates of output pixel (h, w) */
+template<typename DType>
+MSHADOW_XINLINE void SpatialTransformerTarget(const int h, const int w, const int o_h,
+                                              const int o_w, DType* x_dst, DType* y_dst) {
+  *x_dst = o_w > 1 ? DType(-1.0 + w * 2.0 / (o_w - 1)) : DType(-1);
+  *y_dst = o_h > 1 ? DType(-1.0 + h * 2.0 / (o_h - 1)) : DType(-1);
+}
+
+/*!
+ * \brief normalized coordinates of the input point output pixel p = h * o_w + w of
+ *  sample n samples, computed from loc instead of a materialized grid. The warp
+ *  transform follows GridGenerator, the source is the pixel moved by the flow.
+ */
+template<typename DType>
+MSHADOW_XINLINE void SpatialTransformerSource(const int transform_type, const DType* loc,
+                                              const int n, const int h, const int w,
+                                              const int o_h, const int o_w,
+                                              DType* x_src, DType* y_src) {
+  if (transform_type == st::kAffine) {
+    DType x_dst, y_dst;
+    SpatialTransformerTarget(h, w, o_h, o_w, &x_dst, &y_dst);
+    const DType* theta = loc + n * 6;
+    *x_src = theta[0] * x_dst + theta[1] * y_dst + theta[2];
+    *y_src = theta[3] * x_dst + theta[4] * y_dst + theta[5];
+  } else {
+    const DType* flow = loc + static_cast<index_t>(n) * 2 * o_h * o_w;
+    const int p = h * o_w + w;
+    *x_src = (w + flow[p]) / DType((o_w - 1) / 2.0) - DType(1);
+    *y_src = (h + flow[o_h * o_w + p]) / DType((o_h - 1) / 2.0) - DType(1);
+  }
+}
+
+/*!
+ * \brief fused grid generation and bilinear sampling, output element i of
+ *  (n, c, o_h, o_w) samples plane (n, c) of the input, zero outside of it
+ */
+struct spatial_transformer_forward {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, DType* out, const OpReqType req, const DType* data,
+                                  const DType* loc, const int transform_type, const int o_c,
+                                  const int o_h, const int o_w, const int i_h, const int i_w) {
+    const int w = i % o_w;
+    const int h = i / o_w % o_h;
+    const int n = i / o_w / o_h / o_c;
+    DType x_src, y_src;
+    SpatialTransformerSource(transform_type, loc, n, h, w, o_h, o_w, &x_src, &y_src);
+    const DType y_real = (y_src + 1) * (i_h - 1) / 2;
+    const DType x_real = (x_src + 1) * (i_w - 1) / 2;
+    const int y0 = static_cast<int>(floor(y_real));
+    const int x0 = static_cast<int>(floor(x_real));
+    const DType wy = DType(1) - (y_real - y0);
+    const DType wx = DType(1) - (x_real - x0);
+    const DType* plane = data + static_cast<index_t>(i / (o_h * o_w)) * i_h * i_w;
+    const int tl = y0 * i_w + x0;
+    const bool left = x0 >= 0 && x0 < i_w, right = x0 + 1 >= 0 && x0 + 1 < i_w;
+    DType v = 0;
+    if (y0 >= 0 && y0 < i_h) {
+      if (left) v += plane[tl] * wy * wx;
+      if (right) v += plane[tl + 1] * wy * (DType(1) - wx);
+    }
+    if (y0 + 1 >= 0 && y0 + 1 < i_h) {
+      if (left) v += plane[tl + i_w] * (DType(1) - wy) * wx;
+      if (right) v += plane[tl + i_w + 1] * (DType(1) - wy) * (DType(1) - wx);
+    }
+    KERNEL_ASSIGN(out[i], req, v);
   }
 };
 
+/*!
+ * \brief gradients of the fused sampler: the data gradient is scattered to the
+ *  four neighbours of every sampling point, and the loc gradient is taken from
+ *  the grid gradient of each pixel without writing the grid out.
+ */
+template<typename DType>
+void SpatialTransformerBackward(mshadow::Stream<cpu>* s, const int transform_type,
+                                const TBlob& data, const TBlob& loc, const TBlob& grad,
+                                const TBlob& gdata, const TBlob& gloc,
+                                const OpReqType req_data, const OpReqType req_loc);
+
+template<typename DType>
+void SpatialTransformerBackward(mshadow::Stream<gpu>* s, const int transform_type,
+                                const TBlob& data, const TBlob& loc, const TBlob& grad,
+                                const TBlob& gdata, const TBlob& gloc,
+                                const OpReqType req_data, const OpReqType req_loc);
+
 template<typename xpu, typename DType>
 class SpatialTransformerOp : public Operator {
  public:
@@ -78,37 +176,16 @@ class SpatialTransformerOp : public Operator {
                        const std::vector<TBlob> &out_data,
                        const std::vector<TBlob> &aux_args) {
     using namespace mshadow;
-    using namespace mshadow::expr;
     CHECK_EQ(in_data.size(), 2U);
     CHECK_EQ(out_data.size(), 3U);
     Stream<xpu> *s = ctx.get_stream<xpu>();
-    Tensor<xpu, 4, DType> data = in_data[st::kData].get<xpu, 4, DType>(s);
-    Tensor<xpu, 4, DType> out = out_data[st::kOut].get<xpu, 4, DType>(s);
-    Tensor<xpu, 2, DType> grid_dst = out_data[st::kGridDst].get<xpu, 2, DType>(s);
-    Tensor<xpu, 3, DType> grid_src = out_data[st::kGridSrc].get<xpu, 3, DType>(s);
-    Shape<3> loc_shape = Shape3(data.size(0), 2, 3);
-    Tensor<xpu, 3, DType> loc = in_data[st::kLoc].get_with_shape<xpu, 3, DType>(loc_shape, s);
-    Tensor<cpu, 2, DType> workspace =
-          ctx.requested[st::kTempSpace].get_host_space_typed<2, DType>(
-          grid_dst.shape_);
-    for (index_t i = 1; i <= workspace.size(1); i++) {
-      // grid dst coordinate is (x, y, 1)
-      workspace[0][i-1] = -1.0 + (i-1) % param_.target_shape[1] * 2.0 /
-                          (param_.target_shape[1] - 1);
-      workspace[1][i-1] = -1.0 + (i-1) / param_.target_shape[1] * 2.0 /
-                          (param_.target_shape[0] - 1);
-      workspace[2][i-1] = 1.0;
-    }
-    Copy(grid_dst, workspace, grid_dst.stream_);
-    for (index_t batch = 0; batch < data.size(0); batch++) {
-        if (param_.transform_type == st::kAffine) {
-          // Legacy approach shown here for comparison:
-          //    grid_src[batch] = dot(loc[batch], grid_dst);
-          linalg_gemm(loc[batch], grid_dst, grid_src[batch], false, false, s);
-        }
-    }
+    const TShape &dshape = in_data[st::kData].shape_;
+    const TShape &oshape = out_data[st::kOut].shape_;
     if (param_.sampler_type == st::kBilinear) {
-      BilinearSamplingForward(out, data, grid_src);
+      mxnet_op::Kernel<spatial_transformer_forward, xpu>::Launch(
+        s, oshape.Size(), out_data[st::kOut].dptr<DType>(), req[st::kOut],
+        in_data[st::kData].dptr<DType>(), in_data[st::kLoc].dptr<DType>(),
+        param_.transform_type, oshape[1], oshape[2], oshape[3], dshape[2], dshape[3]);
     }
   }
 
@@ -119,28 +196,13 @@ class SpatialTransformerOp : public Operator {
                         const std::vector<OpReqType> &req,
                         const std::vector<TBlob> &in_grad,
                         const std::vector<TBlob> &aux_args) {
-    using namespace mshadow;
-    using namespace mshadow::expr;
     CHECK_EQ(in_data.size(), 2U);
     CHECK_EQ(out_data.size(), 3U);
-    Stream<xpu> *s = ctx.get_stream<xpu>();
-    Tensor<xpu, 4, DType> data = in_data[st::kData].get<xpu, 4, DType>(s);
-    Tensor<xpu, 4, DType> grad = out_grad[st::kOut].get<xpu, 4, DType>(s);
-    Tensor<xpu, 4, DType> gdata = in_grad[st::kData].get<xpu, 4, DType>(s);
-    Tensor<xpu, 2, DType> grid_dst = out_data[st::kGridDst].get<xpu, 2, DType>(s);
-    Tensor<xpu, 3, DType> grid_src = out_data[st::kGridSrc].get<xpu, 3, DType>(s);
-    Shape<3> loc_shape = Shape3(data.size(0), 2, 3);
-    Tensor<xpu, 3, DType> gloc = in_grad[st::kLoc].get_with_shape<xpu, 3, DType>(loc_shape, s);
-    gdata = 0.0;
     if (param_.sampler_type == st::kBilinear) {
-      BilinearSamplingBackward(gdata, grid_src, grad, data);
-    }
-    for (index_t batch = 0; batch < data.size(0); batch++) {
-        if (param_.transform_type == st::kAffine) {
-          // Legacy approach shown here for comparison:
-          //   gloc[batch] = dot(grid_src[batch], grid_dst.T());
-          linalg_gemm(grid_src[batch], grid_dst, gloc[batch], false, true, s);
-        }
+      SpatialTransformerBackward<DType>(ctx.get_stream<xpu>(), param_.transform_type,
+                                        in_data[st::kData], in_data[st::kLoc],
+                                        out_grad[st::kOut], in_grad[st::kData],
+                                        in_grad[st::kLoc], req[st::kData], req[st::kLoc]);
     }
   }
 
@@ -183,7 +245,6 @@ class SpatialTransformerProp : public OperatorProperty {
                   std::vector<TShape> *aux_shape) const override {
     using namespace mshadow;
     CHECK_EQ(in_shape->size(), 2U) << "Input:[data, loc]";
-    CHECK_EQ(param_.transform_type, st::kAffine) << "only supports affine transform currently";
     CHECK_EQ(param_.sampler_type, st::kBilinear) << "only supports bilinear sampling currently";
     const TShape &dshape = (*in_shape)[st::kData];
     const TShape &lshape = (*in_shape)[st::kLoc];
@@ -191,21 +252,34 @@ class SpatialTransformerProp : public OperatorProperty {
     CHECK_EQ(dshape.ndim(), 4U) \
         << "input data should be 4D in batch-num_filter-y-x";
     if (lshape.ndim() ==  0) return false;
-    CHECK_EQ(lshape.ndim(), 2U) \
-        << "locolisation paramter should be 4D in batch-num_hidden";
+    out_shape->clear();
+    out_shape->push_back(dshape);
     if (param_.transform_type == st::kAffine) {
+      CHECK_EQ(lshape.ndim(), 2U) \
+          << "locolisation paramter should be 4D in batch-num_hidden";
       CHECK_EQ(lshape[1], 6U) << "incorrect locolisation network shape[1], should be 6";
+      CHECK_GT(param_.target_shape[0], 0U) \
+          << "incorrect target_shape: " << param_.target_shape[0];
+      CHECK_GT(param_.target_shape[1], 0U) \
+          << "incorrect target_shape: " << param_.target_shape[1];
+      (*out_shape)[st::kOut][2] = param_.target_shape[0];
+      (*out_shape)[st::kOut][3] = param_.target_shape[1];
+    } else {
+      CHECK_EQ(lshape.ndim(), 4U) << "optical flow should be 4D in batch-2-y-x";
+      CHECK_EQ(lshape[0], dshape[0]) << "optical flow and data should have the same batch size";
+      CHECK_EQ(lshape[1], 2U) << "optical flow should have 2 channels";
+      (*out_shape)[st::kOut][2] = lshape[2];
+      (*out_shape)[st::kOut][3] = lshape[3];
+    }
+    if (param_.NeedsGrid()) {
+      const index_t size = (*out_shape)[st::kOut][2] * (*out_shape)[st::kOut][3];
+      out_shape->push_back(Shape2(3, size));
+      out_shape->push_back(Shape3(dshape[0], 2, size));
+    } else {
+      // the fused sampler computes the grid on the fly
+      out_shape->push_back(Shape1(1));
+      out_shape->push_back(Shape1(1));
     }
-    out_shape->clear();
-    out_shape->push_back(dshape);
-    CHECK_GT(param_.target_shape[0], 0U) \
-        << "incorrect target_shape: " << param_.target_shape[0];
-    CHECK_GT(param_.target_shape[1], 0U) \
-        << "incorrect target_shape: " << param_.target_shape[1];
-    (*out_shape)[st::kOut][2] = param_.target_shape[0];
-    (*out_shape)[st::kOut][3] = param_.target_shape[1];
-    out_shape->push_back(Shape2(3, param_.target_shape[0]*param_.target_shape[1]));
-    out_shape->push_back(Shape3(dshape[0], 2, param_.target_shape[0]*param_.target_shape[1]));
     return true;
   }
 
@@ -253,17 +327,12 @@ class SpatialTransformerProp : public OperatorProperty {
     const std::vector<int> &in_data,
     const std::vector<int> &out_data) const override {
     return {out_grad[st::kOut],
-            out_data[st::kGridDst],
             out_data[st::kGridSrc],
-            in_data[st::kData]
+            in_data[st::kData],
+            in_data[st::kLoc]
            };
   }
 
-  std::vector<ResourceRequest> ForwardResource(
-      const std::vector<TShape> &in_shape) const override {
-    return {ResourceRequest::kTempSpace};
-  }
-
   #if CUDNN_MAJOR >= 5
   std::vector<ResourceRequest> BackwardResource(
       const std::vector<TShape> &in_shape) const override {
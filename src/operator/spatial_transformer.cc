@@ -25,132 +25,87 @@
 */
 
 #include "./spatial_transformer-inl.h"
+#include <algorithm>
 
-namespace mshadow {
-template<typename DType>
-static MSHADOW_CINLINE bool between(const DType value,
-                                    const DType lowerBound,
-                                    const DType upperBound) {
-  return value >= lowerBound && value <= upperBound;
-}
-
-template<typename DType>
-inline void BilinearSamplingForward(const Tensor<cpu, 4, DType> &output,
-                                    const Tensor<cpu, 4, DType> &input,
-                                    const Tensor<cpu, 3, DType> grid_src) {
-  DType *out = output.dptr_;
-  const DType *data = input.dptr_;
-  const DType *grid = grid_src.dptr_;
-  const int o_n = output.size(0), o_c = output.size(1), o_h = output.size(2), o_w = output.size(3);
-  const int i_c = input.size(1), i_h = input.size(2), i_w = input.size(3);
-  for (index_t n = 0; n < static_cast<index_t>(o_n); ++n) {
-    for (index_t c = 0; c < static_cast<index_t>(o_c); ++c) {
-      for (index_t h = 0; h < static_cast<index_t>(o_h); ++h) {
-        for (index_t w = 0; w < static_cast<index_t>(o_w); ++w) {
-          const index_t out_index = n * o_c * o_h * o_w + c * o_h * o_w + h * o_w + w;
-          const index_t grid_index = n * o_h * o_w * 2 + h * o_w + w;
-          const DType y_real = (*(grid + grid_index + o_h * o_w) + 1) * (i_h - 1) / 2;
-          const DType x_real = (*(grid + grid_index) + 1) * (i_w - 1) / 2;
-          const auto top_left_y = static_cast<int>(floor(y_real));
-          const auto top_left_x = static_cast<int>(floor(x_real));
-          const DType top_left_y_w = 1.0 - (y_real - top_left_y);
-          const DType top_left_x_w = 1.0 - (x_real - top_left_x);
-          const int data_index = n * i_c * i_h * i_w + c * i_h * i_w +
-                                 top_left_y * i_w + top_left_x;
-          DType top_left_v = 0;
-          DType top_right_v = 0;
-          DType bottom_left_v = 0;
-          DType bottom_right_v = 0;
-          if (between(top_left_x, 0, i_w-1) && between(top_left_y, 0, i_h-1))
-            top_left_v = *(data + data_index);
-          if (between(top_left_x + 1, 0, i_w-1) && between(top_left_y, 0, i_h-1))
-            top_right_v = *(data + data_index + 1);
-          if (between(top_left_x, 0, i_w-1) && between(top_left_y + 1, 0, i_h-1))
-            bottom_left_v = *(data + data_index + i_w);
-          if (between(top_left_x+1, 0, i_w-1) && between(top_left_y + 1, 0, i_h-1))
-            bottom_right_v = *(data + data_index + i_w + 1);
-          *(out+out_index) = top_left_v * top_left_y_w * top_left_x_w +
-                             top_right_v * top_left_y_w * (1.0 - top_left_x_w) +
-                             bottom_left_v * (1.0 - top_left_y_w) * top_left_x_w +
-                             bottom_right_v * (1.0 - top_left_y_w) * (1.0 - top_left_x_w);
-        }
-      }
-    }
-  }
-}
+namespace mxnet {
+namespace op {
 
 template<typename DType>
-inline void BilinearSamplingBackward(const Tensor<cpu, 4, DType> &input_grad,
-                                     const Tensor<cpu, 3, DType> &grid_src_data,
-                                     const Tensor<cpu, 4, DType> &output_grad,
-                                     const Tensor<cpu, 4, DType> &input_data) {
-  DType *g_input = input_grad.dptr_;
-  DType *grid_src = grid_src_data.dptr_;
-  const DType *grad = output_grad.dptr_;
-  const DType *data = input_data.dptr_;
-  const int o_n = output_grad.size(0), o_c = output_grad.size(1),
-    o_h = output_grad.size(2), o_w = output_grad.size(3);
-  const int i_c = input_data.size(1), i_h = input_data.size(2), i_w = input_data.size(3);
-  for (index_t n = 0; n < static_cast<index_t>(o_n); ++n) {
-     for (index_t h = 0; h < static_cast<index_t>(o_h); ++h) {
-        for (index_t w = 0; w < static_cast<index_t>(o_w); ++w) {
-          DType top_left_y_gw = 0.0;
-          DType top_left_x_gw = 0.0;
-          const index_t grid_src_index = n * o_h * o_w * 2 + h * o_w + w;
-          const DType y_real = (*(grid_src + grid_src_index + o_h * o_w) + 1) * (i_h - 1) / 2;
-          const DType x_real = (*(grid_src + grid_src_index) + 1) * (i_w - 1) / 2;
-          const auto top_left_y = static_cast<int>(floor(y_real));
-          const auto top_left_x = static_cast<int>(floor(x_real));
-          const DType top_left_y_w = 1.0 - (y_real - top_left_y);
-          const DType top_left_x_w = 1.0 - (x_real - top_left_x);
-          for (index_t c = 0; c < static_cast<index_t>(o_c); ++c) {
-            index_t grad_index = n * o_c * o_h * o_w + c * o_h * o_w + h * o_w + w;
-            index_t data_index = n * i_c * i_h * i_w + c * i_h * i_w + top_left_y * i_w
-                                 + top_left_x;
-            // calc 4 vertex value in input data
-            DType top_left_v = 0;
-            DType top_right_v = 0;
-            DType bottom_left_v = 0;
-            DType bottom_right_v = 0;
-            if (between(top_left_x, 0, i_w-1) && between(top_left_y, 0, i_h-1)) {
-              *(g_input + data_index) += *(grad + grad_index) * top_left_y_w * top_left_x_w;
-              top_left_v = *(data + data_index);
-            }
-            if (between(top_left_x+1, 0, i_w-1) && between(top_left_y, 0, i_h-1)) {
-              *(g_input + data_index + 1) += *(grad + grad_index) * top_left_y_w
-                                             * (1.0 - top_left_x_w);
-              top_right_v = *(data + data_index + 1);
-            }
-            if (between(top_left_x, 0, i_w-1) && between(top_left_y+1, 0, i_h-1)) {
-              *(g_input + data_index+ i_w) += *(grad + grad_index) * (1.0 - top_left_y_w)
-                                              * top_left_x_w;
-              bottom_left_v = *(data + data_index + i_w);
-            }
-            if (between(top_left_x+1, 0, i_w-1) && between(top_left_y+1, 0, i_h-1)) {
-              *(g_input + data_index+ i_w + 1) += *(grad + grad_index) * (1.0 - top_left_y_w)
-                                                  * (1.0 - top_left_x_w);
-              bottom_right_v = *(data + data_index + i_w + 1);
-            }
-            // calc weight grad of top_left_w, then multiple -1 is the grad of grid_src
-            top_left_y_gw -= *(grad + grad_index) * (top_right_v - bottom_right_v +
-                             (top_left_v - top_right_v - bottom_left_v + bottom_right_v)
-                             * top_left_x_w);
-            top_left_x_gw -= *(grad + grad_index) * (bottom_left_v - bottom_right_v +
-                             (top_left_v - top_right_v - bottom_left_v + bottom_right_v)
-                             * top_left_y_w);
+void SpatialTransformerBackward(mshadow::Stream<cpu>* s, const int transform_type,
+                                const TBlob& data, const TBlob& loc, const TBlob& grad,
+                                const TBlob& gdata, const TBlob& gloc,
+                                const OpReqType req_data, const OpReqType req_loc) {
+  const int o_n = grad.size(0), o_c = grad.size(1), o_h = grad.size(2), o_w = grad.size(3);
+  const int i_h = data.size(2), i_w = data.size(3);
+  const int o_size = o_h * o_w, i_size = i_h * i_w;
+  const DType *in = data.dptr<DType>();
+  const DType *theta = loc.dptr<DType>();
+  const DType *og = grad.dptr<DType>();
+  DType *gin = req_data == kNullOp ? nullptr : gdata.dptr<DType>();
+  DType *gl = gloc.dptr<DType>();
+  if (gin && req_data != kAddTo) std::fill(gin, gin + gdata.Size(), DType(0));
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  // a thread owns the data gradient of a sample, so the scatter needs no atomics
+  #pragma omp parallel for num_threads(omp_threads)
+  for (int n = 0; n < o_n; ++n) {
+    DType gtheta[6] = {0};
+    for (int h = 0; h < o_h; ++h) {
+      for (int w = 0; w < o_w; ++w) {
+        DType x_src, y_src;
+        SpatialTransformerSource(transform_type, theta, n, h, w, o_h, o_w, &x_src, &y_src);
+        const DType y_real = (y_src + 1) * (i_h - 1) / 2;
+        const DType x_real = (x_src + 1) * (i_w - 1) / 2;
+        const int y0 = static_cast<int>(floor(y_real));
+        const int x0 = static_cast<int>(floor(x_real));
+        const DType wy = DType(1) - (y_real - y0);
+        const DType wx = DType(1) - (x_real - x0);
+        const bool top = y0 >= 0 && y0 < i_h, bottom = y0 + 1 >= 0 && y0 + 1 < i_h;
+        const bool left = x0 >= 0 && x0 < i_w, right = x0 + 1 >= 0 && x0 + 1 < i_w;
+        const int tl = y0 * i_w + x0;
+        DType gwy = 0, gwx = 0;
+        for (int c = 0; c < o_c; ++c) {
+          const index_t plane = (static_cast<index_t>(n) * o_c + c) * i_size;
+          const DType g = og[(static_cast<index_t>(n) * o_c + c) * o_size + h * o_w + w];
+          const DType *x = in + plane;
+          const DType v_tl = top && left ? x[tl] : DType(0);
+          const DType v_tr = top && right ? x[tl + 1] : DType(0);
+          const DType v_bl = bottom && left ? x[tl + i_w] : DType(0);
+          const DType v_br = bottom && right ? x[tl + i_w + 1] : DType(0);
+          if (gin) {
+            DType *gx = gin + plane;
+            if (top && left) gx[tl] += g * wy * wx;
+            if (top && right) gx[tl + 1] += g * wy * (DType(1) - wx);
+            if (bottom && left) gx[tl + i_w] += g * (DType(1) - wy) * wx;
+            if (bottom && right) gx[tl + i_w + 1] += g * (DType(1) - wy) * (DType(1) - wx);
           }
-          // calc grid_src grad
-          *(grid_src + grid_src_index + o_h * o_w) = top_left_y_gw * (i_h - 1) / 2;
-          *(grid_src + grid_src_index) = top_left_x_gw * (i_w - 1) / 2;
+          // gradient of the top left weights, the grid gradient is its negative
+          gwy -= g * (v_tr - v_br + (v_tl - v_tr - v_bl + v_br) * wx);
+          gwx -= g * (v_bl - v_br + (v_tl - v_tr - v_bl + v_br) * wy);
+        }
+        const DType ggx = gwx * (i_w - 1) / 2;
+        const DType ggy = gwy * (i_h - 1) / 2;
+        if (transform_type == st::kAffine) {
+          DType x_dst, y_dst;
+          SpatialTransformerTarget(h, w, o_h, o_w, &x_dst, &y_dst);
+          gtheta[0] += ggx * x_dst;
+          gtheta[1] += ggx * y_dst;
+          gtheta[2] += ggx;
+          gtheta[3] += ggy * x_dst;
+          gtheta[4] += ggy * y_dst;
+          gtheta[5] += ggy;
+        } else {
+          DType *gflow = gl + static_cast<index_t>(n) * 2 * o_size;
+          KERNEL_ASSIGN(gflow[h * o_w + w], req_loc, ggx / DType((o_w - 1) / 2.0));
+          KERNEL_ASSIGN(gflow[o_size + h * o_w + w], req_loc, ggy / DType((o_h - 1) / 2.0));
         }
       }
     }
+    if (transform_type == st::kAffine) {
+      for (int k = 0; k < 6; ++k) KERNEL_ASSIGN(gl[n * 6 + k], req_loc, gtheta[k]);
+    }
   }
+}
 
-}  // namespace mshadow
-
-namespace mxnet {
-namespace op {
 template<>
 Operator* CreateOp<cpu>(SpatialTransformerParam param, int dtype) {
   Operator *op = NULL;
@@ -172,9 +127,15 @@ MXNET_REGISTER_OP_PROPERTY(SpatialTransformer, SpatialTransformerProp)
               "Input data to the SpatialTransformerOp.")
 .add_argument("loc", "NDArray-or-Symbol",
               "localisation net, the output dim should be 6 when transform_type "
-              "is affine. You shold initialize the weight and bias with identity tranform.")
+              "is affine. You shold initialize the weight and bias with identity tranform. "
+              "For the warp transform, an optical flow of shape (batch, 2, height, width).")
 .add_arguments(SpatialTransformerParam::__FIELDS__())
-.describe("Applies a spatial transformer to input feature map.");
+.describe(R"code(Applies a spatial transformer to input feature map.
+
+The sampling grid is computed on the fly inside the bilinear sampler, so this is the fused
+equivalent of GridGenerator followed by BilinearSampler. On GPU the affine transform uses
+cuDNN unless ``cudnn_off`` is set.
+)code" ADD_FILELINE);
 
 }  // namespace op
 }  // namespace mxnet
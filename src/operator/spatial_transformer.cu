@@ -30,174 +30,127 @@
 #include "./cudnn_spatial_transformer-inl.h"
 #endif  // MXNET_USE_CUDNN && CUDNN_MAJOR
 
-namespace mshadow {
-template<typename DType>
-__device__ bool between(DType value, int lowerBound, int upperBound) {
-  return (value >= lowerBound && value <= upperBound);
-}
-template<typename DType>
-__global__ void BilinearSamplingForwardKernel(const int i_c, const int i_h,
-                                              const int i_w, const DType* data,
-                                              const DType* grid, const int o_n,
-                                              const int o_c, const int o_h,
-                                              const int o_w, DType* out) {
-  for (int index = (blockIdx.x + blockIdx.y * gridDim.x) * blockDim.x + threadIdx.x;
-       index < o_n * o_c * o_h * o_w;
-       index += blockDim.x * gridDim.x * gridDim.y) {
-    // (n, c, h, w) is the element in out
-    int w = index % o_w;
-    int h = (index / o_w) % o_h;
-    int c = (index / o_w / o_h) % o_c;
-    int n = index / o_w / o_h / o_c;
-    index_t out_index = n * o_c * o_h * o_w + c * o_h * o_w + h * o_w + w;
-    index_t grid_index = n * o_h * o_w * 2 + h * o_w + w;
-    DType y_real = (*(grid + grid_index + o_h * o_w) + 1) * (i_h - 1) / 2;
-    DType x_real = (*(grid + grid_index) + 1) * (i_w - 1) / 2;
-    int top_left_y = static_cast<int>(floor(y_real));
-    int top_left_x = static_cast<int>(floor(x_real));
-    DType top_left_y_w = 1.0 - (y_real - top_left_y);
-    DType top_left_x_w = 1.0 - (x_real - top_left_x);
-    int data_index = n * i_c * i_h * i_w + c * i_h * i_w + top_left_y * i_w + top_left_x;
-    DType top_left_v = 0;
-    DType top_right_v = 0;
-    DType bottom_left_v = 0;
-    DType bottom_right_v = 0;
-    if (between(top_left_x, 0, i_w-1) && between(top_left_y, 0, i_h-1))
-      top_left_v = *(data + data_index);
-    if (between(top_left_x + 1, 0, i_w-1) && between(top_left_y, 0, i_h-1))
-      top_right_v = *(data + data_index + 1);
-    if (between(top_left_x, 0, i_w-1) && between(top_left_y + 1, 0, i_h-1))
-      bottom_left_v = *(data + data_index + i_w);
-    if (between(top_left_x+1, 0, i_w-1) && between(top_left_y + 1, 0, i_h-1))
-      bottom_right_v = *(data + data_index + i_w + 1);
-    *(out+out_index) = top_left_v * top_left_y_w * top_left_x_w +
-                        top_right_v * top_left_y_w * (1.0 - top_left_x_w) +
-                        bottom_left_v * (1.0 - top_left_y_w) * top_left_x_w +
-                        bottom_right_v * (1.0 - top_left_y_w) * (1.0 - top_left_x_w);
-    }
-}
+namespace mxnet {
+namespace op {
 
+// block (x, n) runs over pixels of sample n, the data gradient is scattered with
+// atomics and the affine gradient of the block is reduced in shared memory
 template<typename DType>
-__global__ void BilinearSamplingBackwardKernel(const int i_c, const int i_h,
-                                              const int i_w, const DType* grad,
-                                              const DType* data, const int o_n,
-                                              const int o_c, const int o_h,
-                                              const int o_w, DType* g_input,
-                                              DType* grid_src) {
-  for (int index = (blockIdx.x + blockIdx.y * gridDim.x) * blockDim.x + threadIdx.x;
-       index < o_n * o_h * o_w;
-       index += blockDim.x * gridDim.x * gridDim.y) {
-    // (n, c, h, w) is the element in grad
-    int w = index % o_w;
-    int h = (index / o_w) % o_h;
-    int n = index / o_w / o_h;
-    DType top_left_y_gw = 0.0;
-    DType top_left_x_gw = 0.0;
-    index_t grid_src_index = n * o_h * o_w * 2 + h * o_w + w;
-    DType y_real = (*(grid_src + grid_src_index + o_h * o_w) + 1) * (i_h - 1) / 2;
-    DType x_real = (*(grid_src + grid_src_index) + 1) * (i_w - 1) / 2;
-    int top_left_y = static_cast<int>(floor(y_real));
-    int top_left_x = static_cast<int>(floor(x_real));
-    DType top_left_y_w = 1.0 - (y_real - top_left_y);
-    DType top_left_x_w = 1.0 - (x_real - top_left_x);
-    for (index_t c = 0; c < o_c; ++c) {
-      index_t grad_index = n * o_c * o_h * o_w + c * o_h * o_w + h * o_w + w;
-      index_t data_index = n * i_c * i_h * i_w + c * i_h * i_w + top_left_y * i_w + top_left_x;
-      // calc 4 vertex value in input data
-      DType top_left_v = 0;
-      DType top_right_v = 0;
-      DType bottom_left_v = 0;
-      DType bottom_right_v = 0;
-      // calc input grad
-      if (between(top_left_x, 0, i_w-1) && between(top_left_y, 0, i_h-1)) {
-        *(g_input + data_index) += *(grad + grad_index) * top_left_y_w * top_left_x_w;
-        top_left_v = *(data + data_index);
+__global__ void SpatialTransformerBackwardKernel(const int transform_type, const int o_c,
+                                                 const int o_h, const int o_w, const int i_h,
+                                                 const int i_w, const DType* data,
+                                                 const DType* loc, const DType* grad,
+                                                 DType* gdata, DType* gloc,
+                                                 const OpReqType req_loc) {
+  __shared__ DType sgtheta[6][mshadow::cuda::kBaseThreadNum];
+  const int n = blockIdx.y;
+  const int o_size = o_h * o_w, i_size = i_h * i_w;
+  DType gtheta[6] = {0};
+  for (int p = blockIdx.x * blockDim.x + threadIdx.x; p < o_size;
+       p += blockDim.x * gridDim.x) {
+    const int h = p / o_w, w = p % o_w;
+    DType x_src, y_src;
+    SpatialTransformerSource(transform_type, loc, n, h, w, o_h, o_w, &x_src, &y_src);
+    const DType y_real = (y_src + 1) * (i_h - 1) / 2;
+    const DType x_real = (x_src + 1) * (i_w - 1) / 2;
+    const int y0 = static_cast<int>(floor(y_real));
+    const int x0 = static_cast<int>(floor(x_real));
+    const DType wy = DType(1) - (y_real - y0);
+    const DType wx = DType(1) - (x_real - x0);
+    const bool top = y0 >= 0 && y0 < i_h, bottom = y0 + 1 >= 0 && y0 + 1 < i_h;
+    const bool left = x0 >= 0 && x0 < i_w, right = x0 + 1 >= 0 && x0 + 1 < i_w;
+    const int tl = y0 * i_w + x0;
+    DType gwy = 0, gwx = 0;
+    for (int c = 0; c < o_c; ++c) {
+      const index_t plane = (static_cast<index_t>(n) * o_c + c) * i_size;
+      const DType g = grad[(static_cast<index_t>(n) * o_c + c) * o_size + p];
+      const DType *x = data + plane;
+      const DType v_tl = top && left ? x[tl] : DType(0);
+      const DType v_tr = top && right ? x[tl + 1] : DType(0);
+      const DType v_bl = bottom && left ? x[tl + i_w] : DType(0);
+      const DType v_br = bottom && right ? x[tl + i_w + 1] : DType(0);
+      if (gdata) {
+        DType *gx = gdata + plane;
+        if (top && left) atomicAdd(gx + tl, g * wy * wx);
+        if (top && right) atomicAdd(gx + tl + 1, g * wy * (DType(1) - wx));
+        if (bottom && left) atomicAdd(gx + tl + i_w, g * (DType(1) - wy) * wx);
+        if (bottom && right) {
+          atomicAdd(gx + tl + i_w + 1, g * (DType(1) - wy) * (DType(1) - wx));
+        }
       }
-      if (between(top_left_x+1, 0, i_w-1) && between(top_left_y, 0, i_h-1)) {
-        *(g_input + data_index + 1) += *(grad + grad_index) * top_left_y_w * (1.0 - top_left_x_w);
-        top_right_v = *(data + data_index + 1);
-      }
-      if (between(top_left_x, 0, i_w-1) && between(top_left_y+1, 0, i_h-1)) {
-        *(g_input + data_index+ i_w) += *(grad + grad_index) * (1.0 - top_left_y_w) * top_left_x_w;
-        bottom_left_v = *(data + data_index + i_w);
-      }
-      if (between(top_left_x+1, 0, i_w-1) && between(top_left_y+1, 0, i_h-1)) {
-        *(g_input + data_index+ i_w + 1) += *(grad + grad_index) * (1.0 - top_left_y_w) *
-                                            (1.0 - top_left_x_w);
-        bottom_right_v = *(data + data_index + i_w + 1);
-      }
-      // calc weight grad of top_left_w, then multiple -1 is the grad of grid_src
-      top_left_y_gw -= *(grad + grad_index) * (top_right_v - bottom_right_v +
-                       (top_left_v - top_right_v - bottom_left_v + bottom_right_v)
-                       * top_left_x_w);
-      top_left_x_gw -= *(grad + grad_index) * (bottom_left_v - bottom_right_v +
-                       (top_left_v - top_right_v - bottom_left_v + bottom_right_v)
-                       * top_left_y_w);
+      // gradient of the top left weights, the grid gradient is its negative
+      gwy -= g * (v_tr - v_br + (v_tl - v_tr - v_bl + v_br) * wx);
+      gwx -= g * (v_bl - v_br + (v_tl - v_tr - v_bl + v_br) * wy);
+    }
+    const DType ggx = gwx * (i_w - 1) / 2;
+    const DType ggy = gwy * (i_h - 1) / 2;
+    if (transform_type == st::kAffine) {
+      DType x_dst, y_dst;
+      SpatialTransformerTarget(h, w, o_h, o_w, &x_dst, &y_dst);
+      gtheta[0] += ggx * x_dst;
+      gtheta[1] += ggx * y_dst;
+      gtheta[2] += ggx;
+      gtheta[3] += ggy * x_dst;
+      gtheta[4] += ggy * y_dst;
+      gtheta[5] += ggy;
+    } else {
+      DType *gflow = gloc + static_cast<index_t>(n) * 2 * o_size;
+      KERNEL_ASSIGN(gflow[p], req_loc, ggx / DType((o_w - 1) / 2.0));
+      KERNEL_ASSIGN(gflow[o_size + p], req_loc, ggy / DType((o_h - 1) / 2.0));
     }
-    // calc grid_src grad
-    *(grid_src + grid_src_index + o_h * o_w) = top_left_y_gw * (i_h - 1) / 2;
-    *(grid_src + grid_src_index) = top_left_x_gw * (i_w - 1) / 2;
   }
+  if (transform_type != st::kAffine || req_loc == kNullOp) return;
+  for (int k = 0; k < 6; ++k) sgtheta[k][threadIdx.x] = gtheta[k];
+  __syncthreads();
+  for (int offset = blockDim.x / 2; offset > 0; offset >>= 1) {
+    if (threadIdx.x < offset) {
+      for (int k = 0; k < 6; ++k) sgtheta[k][threadIdx.x] += sgtheta[k][threadIdx.x + offset];
+    }
+    __syncthreads();
+  }
+  if (threadIdx.x < 6) atomicAdd(gloc + n * 6 + threadIdx.x, sgtheta[threadIdx.x][0]);
 }
 
 template<typename DType>
-inline void BilinearSamplingForward(const Tensor<gpu, 4, DType> &output,
-                                    const Tensor<gpu, 4, DType> &input,
-                                    const Tensor<gpu, 3, DType> grid_src) {
-    DType *out = output.dptr_;
-    const DType *data = input.dptr_;
-    const DType *grid = grid_src.dptr_;
-    int o_n = output.size(0), o_c = output.size(1), o_h = output.size(2), o_w = output.size(3);
-    int i_c = input.size(1), i_h = input.size(2), i_w = input.size(3);
-    using namespace cuda;
-    const int max_block = (output.shape_.Size() + kMaxThreadsPerBlock - 1) / kMaxThreadsPerBlock;
-    dim3 num_blocks(kMaxGridDim, (max_block + kMaxGridDim - 1) / kMaxGridDim);
-    dim3 threads_per_block(kMaxThreadsPerBlock);
-    CheckLaunchParam(num_blocks, threads_per_block, "spatial transformer forward");
-    cudaStream_t stream = Stream<gpu>::GetStream(output.stream_);
-    BilinearSamplingForwardKernel<DType> << <num_blocks, threads_per_block, 0, stream >> >(
-      i_c, i_h, i_w, data, grid, o_n, o_c, o_h, o_w, out);
-}
-
-template<typename DType>
-inline void BilinearSamplingBackward(const Tensor<gpu, 4, DType> &input_grad,
-                                     const Tensor<gpu, 3, DType> &grid_src_data,
-                                     const Tensor<gpu, 4, DType> &output_grad,
-                                     const Tensor<gpu, 4, DType> &input_data) {
-  DType *g_input = input_grad.dptr_;
-  DType *grid_src = grid_src_data.dptr_;
-  const DType *grad = output_grad.dptr_;
-  const DType *data = input_data.dptr_;
-  int o_n = output_grad.size(0), o_c = output_grad.size(1),
-      o_h = output_grad.size(2), o_w = output_grad.size(3);
-  int i_c = input_data.size(1), i_h = input_data.size(2), i_w = input_data.size(3);
-  using namespace cuda;
-  const int max_block = (output_grad.shape_.Size() / o_c + kMaxThreadsPerBlock - 1)
-                        / kMaxThreadsPerBlock;
-  dim3 num_blocks(kMaxGridDim, (max_block + kMaxGridDim - 1) / kMaxGridDim);
-  dim3 threads_per_block(kMaxThreadsPerBlock);
-  CheckLaunchParam(num_blocks, threads_per_block, "spatial transformer backward");
-  cudaStream_t stream = Stream<gpu>::GetStream(input_grad.stream_);
-  BilinearSamplingBackwardKernel<DType> << <num_blocks, threads_per_block, 0, stream >> >(
-    i_c, i_h, i_w, grad, data, o_n, o_c, o_h, o_w, g_input, grid_src);
+void SpatialTransformerBackward(mshadow::Stream<gpu>* s, const int transform_type,
+                                const TBlob& data, const TBlob& loc, const TBlob& grad,
+                                const TBlob& gdata, const TBlob& gloc,
+                                const OpReqType req_data, const OpReqType req_loc) {
+  using namespace mshadow::cuda;
+  const int o_n = grad.size(0), o_c = grad.size(1), o_h = grad.size(2), o_w = grad.size(3);
+  if (grad.Size() == 0) return;
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+  DType *gin = req_data == kNullOp ? nullptr : gdata.dptr<DType>();
+  if (gin && req_data != kAddTo) {
+    CUDA_CALL(cudaMemsetAsync(gin, 0, gdata.Size() * sizeof(DType), stream));
+  }
+  // the affine gradient is accumulated with atomics from every block of a sample
+  if (transform_type == st::kAffine && req_loc != kNullOp && req_loc != kAddTo) {
+    CUDA_CALL(cudaMemsetAsync(gloc.dptr<DType>(), 0, gloc.Size() * sizeof(DType), stream));
+  }
+  const int blocks = std::min((o_h * o_w + kBaseThreadNum - 1) / kBaseThreadNum, kMaxGridDim);
+  dim3 num_blocks(blocks, o_n);
+  CheckLaunchParam(num_blocks, dim3(kBaseThreadNum), "spatial transformer backward");
+  SpatialTransformerBackwardKernel<<<num_blocks, kBaseThreadNum, 0, stream>>>(
+    transform_type, o_c, o_h, o_w, data.size(2), data.size(3), data.dptr<DType>(),
+    loc.dptr<DType>(), grad.dptr<DType>(), gin, gloc.dptr<DType>(), req_loc);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(SpatialTransformerBackwardKernel);
 }
 
-}  // namespace mshadow
-
-namespace mxnet {
-namespace op {
 template<>
 Operator* CreateOp<gpu>(SpatialTransformerParam param, int dtype) {
   Operator *op = NULL;
 #if MXNET_USE_CUDNN == 1 && CUDNN_MAJOR >= 5
-  MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
-    op = new CuDNNSpatialTransformerOp<DType>(param);
-  })
-#else
+  if (param.NeedsGrid()) {
+    MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
+      op = new CuDNNSpatialTransformerOp<DType>(param);
+    })
+    return op;
+  }
+#endif  // MXNET_USE_CUDNN && CUDNN_MAJOR
   MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
     op = new SpatialTransformerOp<gpu, DType>(param);
   })
-#endif  // MXNET_USE_CUDNN && CUDNN_MAJOR
   return op;
 }
 
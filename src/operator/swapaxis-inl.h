@@ -127,6 +127,12 @@ class SwapAxisOp : public Operator {
 
     Tensor<xpu, 5, DType> inter_data_out = data_out.get_with_shape<xpu, 5, DType>(inter_shape2, s);
 
+    // the executor may have laid the output out as a view of an input whose
+    // memory the swap leaves unchanged
+    if (out_req != kAddTo && inter_data_out.dptr_ == inter_data_in.dptr_ &&
+        (inter_shape[1] != 1) + (inter_shape[2] != 1) + (inter_shape[3] != 1) <= 1) {
+      return;
+    }
     if (out_req == kAddTo) {
         inter_data_out += swapaxis<3, 1>(inter_data_in);
     } else {
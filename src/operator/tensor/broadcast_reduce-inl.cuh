@@ -281,6 +281,136 @@ __global__ void reduce_kernel_M1(const int N, const bool addto,
   }
 }
 
+#if CUDA_VERSION < 9000
+#define MXNET_REDUCE_SHFL_DOWN(val, delta) __shfl_down(val, delta)
+#else
+#define MXNET_REDUCE_SHFL_DOWN(val, delta) __shfl_down_sync(0xffffffff, val, delta)
+#endif
+
+// Shuffles the bits of val, so that the types the shuffle has no overload for,
+// such as half_t, go through as well
+template<typename DType>
+__device__ __forceinline__ DType warp_shfl_down(const DType& val, const int delta) {
+  static_assert(sizeof(DType) <= 2 * sizeof(int), "Type too large for a warp shuffle");
+  int bits[2] = {0, 0};
+  memcpy(bits, &val, sizeof(DType));
+  bits[0] = MXNET_REDUCE_SHFL_DOWN(bits[0], delta);
+  if (sizeof(DType) > sizeof(int)) bits[1] = MXNET_REDUCE_SHFL_DOWN(bits[1], delta);
+  DType ret;
+  memcpy(&ret, bits, sizeof(DType));
+  return ret;
+}
+
+#undef MXNET_REDUCE_SHFL_DOWN
+
+// Reduces val across the thread block, of a multiple of warpSize threads, the result
+// is in thread 0. shTile needs a DType for every warp of the block.
+template<typename Reducer, typename DType>
+__device__ __forceinline__ DType block_reduce(DType val, DType* shTile) {
+  const int nwarp = (blockDim.x + warpSize - 1) / warpSize;
+  DType tmp, residual;
+  Reducer::SetInitValue(tmp, residual);
+  for (int delta = warpSize / 2; delta > 0; delta >>= 1) {
+    // lanes past the end of the warp get their own value back
+    tmp = warp_shfl_down(val, delta);
+    if ((threadIdx.x & (warpSize - 1)) + delta < warpSize) Reducer::Reduce(val, tmp, residual);
+  }
+  if (nwarp > 1) {
+    if ((threadIdx.x & (warpSize - 1)) == 0) shTile[threadIdx.x / warpSize] = val;
+    __syncthreads();
+    if (threadIdx.x == 0) {
+      for (int w = 1; w < nwarp; ++w) Reducer::Reduce(val, shTile[w], residual);
+    }
+    __syncthreads();
+  }
+  return val;
+}
+
+// Aligned vector of elements, for loading whole rows with wide loads
+template<typename DType, int nvec>
+struct alignas(sizeof(DType) * nvec) ReduceVec {
+  DType v[nvec];
+};
+
+// Reduction over the contiguous inner axis, and the outer axis, of the ReduceView.
+// Block x reduces part blockIdx.y of output n, the outer rows of inner = nvec*Dvec
+// elements being read by the whole block with nvec wide loads.
+template<typename Reducer, typename DType, typename OP, int nvec>
+__launch_bounds__(nthread_reduce)
+__global__ void reduce_inner_kernel(const int N, const int Dvec, const int Mvec,
+                                    const bool addto, const DType* __restrict big,
+                                    DType *small, const int Mnext) {
+  __shared__ DType shTile[nthread_reduce / 32];
+  typedef ReduceVec<DType, nvec> VecType;
+  const VecType* big_vec = reinterpret_cast<const VecType*>(big);
+  for (int m0 = blockIdx.y; m0 < Mnext; m0 += gridDim.y) {
+    const int Mstart = (int)((uint64_t)Mvec*(uint64_t)m0/(uint64_t)Mnext);
+    const int Mend   = (int)((uint64_t)Mvec*(uint64_t)(m0 + 1)/(uint64_t)Mnext);
+    for (int idx = blockIdx.x; idx < N; idx += gridDim.x) {
+      DType val, residual;
+      Reducer::SetInitValue(val, residual);
+      for (int k = Mstart + threadIdx.x; k < Mend; k += blockDim.x) {
+        const int a = k / Dvec;
+        const VecType tmp = big_vec[((int64_t)a * N + idx) * Dvec + (k - a * Dvec)];
+        #pragma unroll
+        for (int u = 0; u < nvec; ++u) Reducer::Reduce(val, OP::Map(tmp.v[u]), residual);
+      }
+      val = block_reduce<Reducer>(val, shTile);
+      if (threadIdx.x == 0) assign(&small[idx + m0*N], addto, val);
+    }
+  }
+}
+
+// Reduction over the outer axis of a ReduceView with inner == 1. Threads x read nvec
+// consecutive columns each, threads y split the rows and are reduced in shared memory.
+template<typename Reducer, typename DType, typename OP, int nvec>
+__launch_bounds__(nthread_reduce)
+__global__ void reduce_outer_kernel(const int Nvec, const int M, const bool addto,
+                                    const DType* __restrict big, DType *small,
+                                    const int Mnext) {
+  extern __shared__ char shTileChar[];
+  DType* shTile = (DType*)(shTileChar);
+  typedef ReduceVec<DType, nvec> VecType;
+  const VecType* big_vec = reinterpret_cast<const VecType*>(big);
+  const int N = Nvec * nvec;
+  for (int m0 = blockIdx.y; m0 < Mnext; m0 += gridDim.y) {
+    const int Mstart = (int)((uint64_t)M*(uint64_t)m0/(uint64_t)Mnext);
+    const int Mend   = (int)((uint64_t)M*(uint64_t)(m0 + 1)/(uint64_t)Mnext);
+    for (int idx0 = blockIdx.x*blockDim.x; idx0 < Nvec; idx0 += blockDim.x*gridDim.x) {
+      const int idx = idx0 + threadIdx.x;
+      DType val[nvec], residual[nvec];
+      #pragma unroll
+      for (int u = 0; u < nvec; ++u) Reducer::SetInitValue(val[u], residual[u]);
+      if (idx < Nvec) {
+        for (int k = Mstart + threadIdx.y; k < Mend; k += blockDim.y) {
+          const VecType tmp = big_vec[(int64_t)k * Nvec + idx];
+          #pragma unroll
+          for (int u = 0; u < nvec; ++u) {
+            Reducer::Reduce(val[u], OP::Map(tmp.v[u]), residual[u]);
+          }
+        }
+      }
+      // column u of thread x is at (x*nvec + u), padded by one to avoid bank conflicts
+      const int width = blockDim.x * nvec + 1;
+      #pragma unroll
+      for (int u = 0; u < nvec; ++u) {
+        shTile[threadIdx.y * width + threadIdx.x * nvec + u] = val[u];
+      }
+      __syncthreads();
+      for (int j = threadIdx.x + threadIdx.y * blockDim.x; j < blockDim.x * nvec;
+           j += blockDim.x * blockDim.y) {
+        DType tmp, tmp_residual;
+        Reducer::SetInitValue(tmp, tmp_residual);
+        for (int y = 0; y < blockDim.y; ++y) {
+          Reducer::Reduce(tmp, shTile[y * width + j], tmp_residual);
+        }
+        if (idx0 * nvec + j < N) assign(&small[idx0 * nvec + j + m0*N], addto, tmp);
+      }
+      __syncthreads();
+    }
+  }
+}
+
 // Returns the stride with which the fastest dimension is moving.
 // Used to detect memory access scatter.
 template<int ndim>
@@ -300,6 +430,8 @@ Type ceil_idiv(const Type a, const Type b) {
   return (a + b - 1)/b;
 }
 
+enum ReduceViewKernel {kReduceViewNone, kReduceViewInner, kReduceViewOuter};
+
 // Configuration for ReduceImpl()
 template<int ndim>
 struct ReduceImplConfig {
@@ -320,6 +452,9 @@ struct ReduceImplConfig {
     int gridSize;
   } kernel_2;
   size_t workspace_size;
+  // kernel reducing a ReduceView, kReduceViewNone for the generic kernels
+  int view_kernel;
+  ReduceView view;
 
   Shape<ndim> rshape, rstride;
   Shape<ndim> lhs_shape, lhs_stride;
@@ -368,6 +503,35 @@ ReduceImplConfig<ndim> ConfigureReduceImpl(const TShape& small, const TShape& bi
   }
 
   config.workspace_size = 0;
+  config.view_kernel = kReduceViewNone;
+
+  // Rows of the reduced inner axis long enough for a thread block, or an outer
+  // reduction, take the kernels reading contiguous memory
+  if (!multiOp && config.M > 1 &&
+      GetReduceView(small.get<ndim>(), big.get<ndim>(), &config.view) &&
+      (config.view.inner >= config.warpSize || config.view.inner == 1)) {
+    int threads_per_part;
+    if (config.view.inner > 1) {
+      config.view_kernel = kReduceViewInner;
+      config.kernel_1.blockDim = dim3(std::min(nthread_reduce / 4,
+        ceil_idiv(config.M, 4 * config.warpSize) * config.warpSize));
+      threads_per_part = config.kernel_1.blockDim.x;
+    } else {
+      config.view_kernel = kReduceViewOuter;
+      config.kernel_1.blockDim = dim3(config.warpSize, 8);
+      threads_per_part = config.kernel_1.blockDim.y;
+    }
+    // Few outputs reducing long rows split the rows in parts, reduced by a second kernel
+    const int maxMblock = threads_per_part*config.maxLoopPerTB;
+    config.Mnext = (config.M + maxMblock - 1) / maxMblock;
+    if (config.Mnext > 1) {
+      config.workspace_size = config.N*config.Mnext*sizeof(DType);
+      config.kernel_2.blockSize = kMaxThreadsPerBlock;
+      config.kernel_2.gridSize = std::min((int)kBaseGridNum,
+        (config.N + config.kernel_2.blockSize - 1)/config.kernel_2.blockSize );
+    }
+    return config;
+  }
 
   if (config.M == 1) {
     config.kernel_1.blockDim.x = kMaxThreadsPerBlock;
@@ -498,10 +662,60 @@ ReduceImplConfig<ndim> ConfigureReduceImpl(const TShape& small, const TShape& bi
     {__VA_ARGS__}                                                     \
   }
 
+template<typename Reducer, int ndim, typename DType, typename OP>
+void ReduceViewImpl(cudaStream_t stream, const TBlob& small, const OpReqType req,
+                    const TBlob& big, const Tensor<gpu, 1, char>& workspace,
+                    const ReduceImplConfig<ndim>& config) {
+  const ReduceView& view = config.view;
+  DType* small_dptr = small.dptr<DType>();
+  bool addto = (req == kAddTo);
+  if (config.Mnext > 1) {
+    small_dptr = reinterpret_cast<DType*>(workspace.dptr_);
+    addto = false;
+    CHECK_EQ(workspace.CheckContiguous(), true);
+    CHECK_GE(workspace.size(0), config.workspace_size);
+  }
+  // 16 byte loads when the rows allow them
+  const int nvec = sizeof(DType) < 16 ? 16 / sizeof(DType) : 1;
+  const int row = (config.view_kernel == kReduceViewInner) ? view.inner : view.n;
+  const bool do_vec = nvec > 1 && row % nvec == 0 &&
+    reinterpret_cast<uintptr_t>(big.dptr<DType>()) % 16 == 0;
+  KERNEL_UNROLL_SWITCH(do_vec, nvec, NVEC, {
+    if (config.view_kernel == kReduceViewInner) {
+      const int Dvec = view.inner / NVEC;
+      dim3 gridDim(std::min(view.n, kMaxGridNum), std::min(kBaseGridNum, config.Mnext));
+      reduce_inner_kernel<Reducer, DType, OP, NVEC>
+      <<< gridDim, config.kernel_1.blockDim, 0, stream >>>(
+        view.n, Dvec, view.outer * Dvec, addto, big.dptr<DType>(), small_dptr, config.Mnext);
+      MSHADOW_CUDA_POST_KERNEL_CHECK(reduce_inner_kernel);
+    } else {
+      const int Nvec = view.n / NVEC;
+      const dim3& blockDim = config.kernel_1.blockDim;
+      dim3 gridDim(std::min(kBaseGridNum, ceil_idiv<int>(Nvec, blockDim.x)),
+                   std::min(kBaseGridNum, config.Mnext));
+      const int shMemSize = blockDim.y*(blockDim.x*NVEC + 1)*sizeof(DType);
+      reduce_outer_kernel<Reducer, DType, OP, NVEC>
+      <<< gridDim, blockDim, shMemSize, stream >>>(
+        Nvec, view.outer, addto, big.dptr<DType>(), small_dptr, config.Mnext);
+      MSHADOW_CUDA_POST_KERNEL_CHECK(reduce_outer_kernel);
+    }
+  });
+  if (config.Mnext > 1) {
+    reduce_lines_kernel<Reducer, DType>
+    <<< config.kernel_2.gridSize, config.kernel_2.blockSize, 0, stream >>>
+      (config.N, config.Mnext, req == kAddTo, config.N, small_dptr, small.dptr<DType>());
+    MSHADOW_CUDA_POST_KERNEL_CHECK(reduce_lines_kernel);
+  }
+}
+
 template<typename Reducer, int ndim, typename DType, typename OP>
 void ReduceImpl(cudaStream_t stream, const TBlob& small, const OpReqType req,
                 const TBlob& big, const Tensor<gpu, 1, char>& workspace,
                 const ReduceImplConfig<ndim>& config) {
+  if (config.view_kernel != kReduceViewNone) {
+    ReduceViewImpl<Reducer, ndim, DType, OP>(stream, small, req, big, workspace, config);
+    return;
+  }
   if (config.M == 1) {
     reduce_kernel_M1<Reducer, ndim, DType, OP>
     <<< config.kernel_1.gridDim, config.kernel_1.blockDim, 0, stream >>>(
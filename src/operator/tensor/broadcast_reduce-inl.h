@@ -168,6 +168,33 @@ MSHADOW_XINLINE void seq_reduce_assign(const int idx, const int M, const bool ad
   assign(&small[idx], addto, val);
 }
 
+/*!
+ * \brief A reduction of big, viewed as an (outer, n, inner) array, over the first and last
+ *  axes. Reductions over the last axes, the first axes, or all axes but the ones in the
+ *  middle, such as the statistics of a channel, get kernels reading contiguous memory.
+ */
+struct ReduceView {
+  int outer, n, inner;
+};
+
+template<int ndim>
+inline bool GetReduceView(const Shape<ndim>& small, const Shape<ndim>& big, ReduceView* view) {
+  *view = {1, 1, 1};
+  // 0: reduced axes before the kept ones, 1: kept axes, 2: reduced axes after them
+  int part = 0;
+  for (int i = 0; i < ndim; ++i) {
+    if (big[i] == 1) continue;
+    const bool reduced = small[i] != big[i];
+    if (part == 0 && !reduced) part = 1;
+    if (part == 1 && reduced) part = 2;
+    if (part == 2 && !reduced) return false;
+    if (part == 0) view->outer *= big[i];
+    if (part == 1) view->n *= big[i];
+    if (part == 2) view->inner *= big[i];
+  }
+  return view->outer * view->inner > 1;
+}
+
 #ifdef __CUDACC__
 #include "broadcast_reduce-inl.cuh"
 
@@ -204,10 +231,127 @@ void seq_reduce_compute(const int N, const int M, const bool addto,
   }
 }
 
+/*! \brief number of independent accumulators reducing a contiguous range */
+const int kReduceUnroll = 4;
+/*! \brief number of columns every task keeps accumulators for in an outer reduction */
+const int kReduceColumns = 64;
+/*! \brief smallest number of elements worth a task of its own */
+const int kReduceMinTask = 1 << 14;
+
+/*! \brief reduce len contiguous elements into val */
+template<typename Reducer, typename DType, typename OP>
+inline void contiguous_reduce(const DType* __restrict in, const int len, DType* val,
+                              DType* residual) {
+  DType vals[kReduceUnroll], residuals[kReduceUnroll];
+  for (int u = 0; u < kReduceUnroll; ++u) Reducer::SetInitValue(vals[u], residuals[u]);
+  int i = 0;
+  for (; i + kReduceUnroll <= len; i += kReduceUnroll) {
+    #pragma unroll
+    for (int u = 0; u < kReduceUnroll; ++u) {
+      Reducer::Reduce(vals[u], OP::Map(in[i + u]), residuals[u]);
+    }
+  }
+  for (; i < len; ++i) Reducer::Reduce(vals[0], OP::Map(in[i]), residuals[0]);
+  for (int u = 0; u < kReduceUnroll; ++u) Reducer::Reduce(*val, vals[u], *residual);
+}
+
+/*!
+ * \brief number of parts the reduction of every output is split into, so that few outputs
+ *  reducing many elements still use all threads. The parts are reduced in a second pass.
+ */
+inline int reduce_parts(const int tasks, const int M, const int nthreads) {
+  if (tasks >= nthreads) return 1;
+  return std::max(1, std::min((nthreads + tasks - 1) / tasks, M / kReduceMinTask));
+}
+
+/*! \brief reduce the parts of every output, which are N apart, into small */
+template<typename Reducer, typename DType>
+void parts_reduce(const int N, const int parts, const bool addto, const DType* parts_out,
+                  DType* small, const int nthreads) {
+  #pragma omp parallel for num_threads(nthreads)
+  for (int idx = 0; idx < N; ++idx) {
+    DType val, residual;
+    Reducer::SetInitValue(val, residual);
+    for (int p = 0; p < parts; ++p) Reducer::Reduce(val, parts_out[p * N + idx], residual);
+    assign(&small[idx], addto, val);
+  }
+}
+
+/*! \brief reduction with inner > 1, every output reduces outer rows of inner elements */
+template<typename Reducer, typename DType, typename OP>
+void inner_reduce_compute(const ReduceView& view, const bool addto, const DType* big,
+                          DType* small) {
+  const int nthreads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  const int N = view.n, D = view.inner, M = view.outer * view.inner;
+  const int parts = reduce_parts(N, M, nthreads);
+  std::vector<DType> parts_out(parts > 1 ? parts * N : 0);
+  #pragma omp parallel for num_threads(nthreads)
+  for (int t = 0; t < N * parts; ++t) {
+    const int idx = t / parts, p = t % parts;
+    const int kend = static_cast<int>(static_cast<int64_t>(M) * (p + 1) / parts);
+    DType val, residual;
+    Reducer::SetInitValue(val, residual);
+    for (int k = static_cast<int>(static_cast<int64_t>(M) * p / parts); k < kend;) {
+      const int a = k / D, d = k - a * D, len = std::min(D - d, kend - k);
+      contiguous_reduce<Reducer, DType, OP>(big + (static_cast<int64_t>(a) * N + idx) * D + d,
+                                            len, &val, &residual);
+      k += len;
+    }
+    if (parts > 1) {
+      parts_out[p * N + idx] = val;
+    } else {
+      assign(&small[idx], addto, val);
+    }
+  }
+  if (parts > 1) parts_reduce<Reducer>(N, parts, addto, parts_out.data(), small, nthreads);
+}
+
+/*! \brief reduction with inner == 1, outer rows of n contiguous columns are reduced */
+template<typename Reducer, typename DType, typename OP>
+void outer_reduce_compute(const ReduceView& view, const bool addto, const DType* big,
+                          DType* small) {
+  const int nthreads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  const int N = view.n, M = view.outer;
+  const int blocks = (N + kReduceColumns - 1) / kReduceColumns;
+  const int parts = reduce_parts(blocks, M * std::min(N, kReduceColumns), nthreads);
+  std::vector<DType> parts_out(parts > 1 ? parts * N : 0);
+  #pragma omp parallel for num_threads(nthreads)
+  for (int t = 0; t < blocks * parts; ++t) {
+    const int n0 = t / parts * kReduceColumns, p = t % parts;
+    const int len = std::min(kReduceColumns, N - n0);
+    DType vals[kReduceColumns], residuals[kReduceColumns];
+    for (int j = 0; j < len; ++j) Reducer::SetInitValue(vals[j], residuals[j]);
+    const int kend = static_cast<int>(static_cast<int64_t>(M) * (p + 1) / parts);
+    for (int k = static_cast<int>(static_cast<int64_t>(M) * p / parts); k < kend; ++k) {
+      const DType* row = big + static_cast<int64_t>(k) * N + n0;
+      for (int j = 0; j < len; ++j) Reducer::Reduce(vals[j], OP::Map(row[j]), residuals[j]);
+    }
+    for (int j = 0; j < len; ++j) {
+      if (parts > 1) {
+        parts_out[p * N + n0 + j] = vals[j];
+      } else {
+        assign(&small[n0 + j], addto, vals[j]);
+      }
+    }
+  }
+  if (parts > 1) parts_reduce<Reducer>(N, parts, addto, parts_out.data(), small, nthreads);
+}
+
 template<typename Reducer, int ndim, typename DType, typename OP>
 void Reduce(Stream<cpu> *s, const TBlob& small, const OpReqType req,
             const Tensor<cpu, 1, char>& workspace, const TBlob& big) {
   if (req == kNullOp) return;
+  ReduceView view;
+  if (GetReduceView(small.shape_.get<ndim>(), big.shape_.get<ndim>(), &view)) {
+    if (view.inner > 1) {
+      inner_reduce_compute<Reducer, DType, OP>(view, req == kAddTo, big.dptr<DType>(),
+                                               small.dptr<DType>());
+    } else {
+      outer_reduce_compute<Reducer, DType, OP>(view, req == kAddTo, big.dptr<DType>(),
+                                               small.dptr<DType>());
+    }
+    return;
+  }
   Shape<ndim> rshape, rstride;
   diff(small.shape_.get<ndim>(), big.shape_.get<ndim>(), &rshape, &rstride);
   int N = small.shape_.Size(), M = rshape.Size();
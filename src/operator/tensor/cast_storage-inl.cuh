@@ -67,6 +67,48 @@ struct CastDnsRspValsKernel {
   }
 };
 
+/*!
+ * \brief GPU Kernel for filling the value array of an rsp tensor that has room for
+ * every row, from the prefix sum of the non-zero row flags.
+ * Parallelized by dns tensor elements: 1 thread/element
+ */
+struct CastDnsRspValsByFlagKernel {
+  /*!
+   * \brief
+   * \param tid          global thread id
+   * \param rsp_val      value array of rsp tensor to store data
+   * \param row_flg_sum  inclusive prefix sum of the 0/1 non-zero row flags
+   * \param dns          dense matrix data
+   * \param num_rows     number of rows of the dense matrix
+   * \param row_length   number of elements per row
+   */
+  template<typename DType>
+  __device__ __forceinline__ static void Map(int tid,
+                                             DType* rsp_val,
+                                             const nnvm::dim_t* row_flg_sum,
+                                             const DType* dns,
+                                             const nnvm::dim_t num_rows,
+                                             const nnvm::dim_t row_length) {
+    using nnvm::dim_t;
+    if (tid < num_rows*row_length) {
+      const dim_t row_id = tid / row_length;
+      const dim_t prev = (row_id == 0) ? 0 : row_flg_sum[row_id-1];
+      if (row_flg_sum[row_id] > prev) {
+        rsp_val[prev * row_length + tid % row_length] = dns[tid];
+      }
+    }
+  }
+};
+
+/*!
+ * \brief Whether the GPU casts from dns fill sparse arrays allocated for their largest
+ * possible size before reading the number of non-zeros back, see MXNET_CAST_STORAGE_DEFER_NNZ.
+ */
+inline bool CastStorageDeferNNZ() {
+  static const bool defer = dmlc::GetEnv("MXNET_CAST_STORAGE_DEFER_NNZ", false);
+  return defer;
+}
+
 /*!
  * \brief Inline implementation of typed CastStorageDnsRspImpl
  * \tparam DType Data type
@@ -161,9 +203,27 @@ void CastStorageDnsRspGPUImpl_(const OpContext& ctx,
                                 num_rows,
                                 mshadow::Stream<gpu>::GetStream(s));
 
-  // Get total number of non-zero rows from device
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
   dim_t nnr = 0;
-  CUDA_CALL(cudaMemcpy(&nnr, &row_flg[num_rows - 1], sizeof(dim_t), cudaMemcpyDeviceToHost));
+  if (CastStorageDeferNNZ()) {
+    // fill an rsp with room for every row, then wait once and shrink it to nnr rows
+    rsp->CheckAndAllocAuxData(rowsparse::kIdx, Shape1(num_rows));
+    rsp->CheckAndAllocData(dns.shape_);
+    RType *row_idx = rsp->aux_data(rowsparse::kIdx).dptr<RType>();
+    Kernel<FillRspRowIdxKernel, gpu>::Launch(s, num_rows, row_idx, row_flg, num_rows);
+    Kernel<CastDnsRspValsByFlagKernel, gpu>::Launch(s, num_rows * row_length,
+        rsp->data().dptr<DType>(), row_flg, dns.dptr<DType>(), num_rows, row_length);
+    CUDA_CALL(cudaMemcpyAsync(&nnr, &row_flg[num_rows - 1], sizeof(dim_t),
+                              cudaMemcpyDeviceToHost, stream));
+    CUDA_CALL(cudaStreamSynchronize(stream));
+    rsp->set_aux_shape(rowsparse::kIdx, Shape1(nnr));
+    return;
+  }
+
+  // Get total number of non-zero rows from device, only waiting for this stream
+  CUDA_CALL(cudaMemcpyAsync(&nnr, &row_flg[num_rows - 1], sizeof(dim_t),
+                            cudaMemcpyDeviceToHost, stream));
+  CUDA_CALL(cudaStreamSynchronize(stream));
 
   // Allocate rsp tensor row index array and fill
   rsp->CheckAndAllocAuxData(rowsparse::kIdx, Shape1(nnr));
@@ -554,13 +614,23 @@ inline void CastStorageDnsCsrImpl(const OpContext& ctx,
                                       num_rows+1,
                                       mshadow::Stream<gpu>::GetStream(s));
 
-        // Receive total number of nnz values from device
+        cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
         IType nnz = 0;
-        CUDA_CALL(cudaMemcpy(&nnz, &(indptr[num_rows]), sizeof(IType), cudaMemcpyDeviceToHost));
-
-        // Allocate column index array and data array of the csr matrix
-        csr->CheckAndAllocAuxData(csr::kIdx, Shape1(static_cast<dim_t>(nnz)));
-        csr->CheckAndAllocData(Shape1(static_cast<dim_t>(nnz)));
+        const bool defer_nnz = CastStorageDeferNNZ();
+        if (defer_nnz) {
+          // Allocate room for every element, the arrays are shrunk once nnz is known
+          csr->CheckAndAllocAuxData(csr::kIdx, Shape1(num_rows * num_cols));
+          csr->CheckAndAllocData(Shape1(num_rows * num_cols));
+        } else {
+          // Receive total number of nnz values from device, only waiting for this stream
+          CUDA_CALL(cudaMemcpyAsync(&nnz, &(indptr[num_rows]), sizeof(IType),
+                                    cudaMemcpyDeviceToHost, stream));
+          CUDA_CALL(cudaStreamSynchronize(stream));
+
+          // Allocate column index array and data array of the csr matrix
+          csr->CheckAndAllocAuxData(csr::kIdx, Shape1(static_cast<dim_t>(nnz)));
+          csr->CheckAndAllocData(Shape1(static_cast<dim_t>(nnz)));
+        }
 
         // Compute and fill column index array and data array of the csr matrix
         switch (kernel_version) {
@@ -601,6 +671,12 @@ inline void CastStorageDnsCsrImpl(const OpContext& ctx,
             }
             break;
         }
+        if (defer_nnz) {
+          CUDA_CALL(cudaMemcpyAsync(&nnz, &(indptr[num_rows]), sizeof(IType),
+                                    cudaMemcpyDeviceToHost, stream));
+          CUDA_CALL(cudaStreamSynchronize(stream));
+          csr->set_aux_shape(csr::kIdx, Shape1(static_cast<dim_t>(nnz)));
+        }
       });
     });
   });
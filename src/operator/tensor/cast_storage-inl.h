@@ -28,9 +28,11 @@
 #include <mxnet/ndarray.h>
 #include <vector>
 #include <algorithm>
+#include <cstring>
 #include "../mxnet_op.h"
 #include "../operator_common.h"
 #include "../../src/operator/tensor/init_op.h"
+#include "./util/tensor_util-inl.h"
 #ifdef __CUDACC__
 #include "./cast_storage-inl.cuh"
 #endif  // __CUDACC__
@@ -68,6 +70,22 @@ struct MarkRspRowIdx {
   }
 };
 
+/*!
+ * \brief CPU kernel for copying the non-zero rows of a dns tensor to the value array of a rsp.
+ */
+struct CopyDnsRspRows {
+  // i represents the row index of the rsp tensor data
+  template<typename DType, typename RType>
+  MSHADOW_CINLINE static void Map(int i,
+                                  DType* rsp_val,
+                                  const RType* row_idx,
+                                  const DType* dns,
+                                  const nnvm::dim_t row_length) {
+    std::memcpy(rsp_val + i * row_length, dns + row_idx[i] * row_length,
+                row_length * sizeof(DType));
+  }
+};
+
 /*!
  * \brief CPU implementation of casting a dns tensor to rsp type.
  */
@@ -86,29 +104,22 @@ inline void CastStorageDnsRspImpl(const OpContext& ctx,
     MSHADOW_IDX_TYPE_SWITCH(rsp->aux_type(kIdx), RType, {  // row idx type
       const dim_t num_rows = dns.shape_[0];
       const dim_t row_length = dns.shape_.ProdShape(1, dns.shape_.ndim());
-      rsp->CheckAndAllocAuxData(kIdx, Shape1(num_rows));
-      TBlob row_idx_blob = rsp->aux_data(kIdx);
-      RType* row_idx = row_idx_blob.dptr<RType>();
-      dim_t num_threads = num_rows;
-      mxnet_op::Kernel<MarkRspRowIdx, cpu>::Launch(s, num_threads,
-          row_idx, dns.dptr<DType>(), row_length);
-      dim_t nnr = 0;
-      nnr = common::ParallelAccumulate(row_idx, num_rows, nnr);
-      rsp->set_aux_shape(kIdx, Shape1(nnr));
+      // mark the non-zero rows and scan the marks into their positions in the rsp
+      std::vector<dim_t> row_flg(num_rows);
+      mxnet_op::Kernel<MarkRspRowIdx, cpu>::Launch(s, num_rows,
+          row_flg.data(), dns.dptr<DType>(), row_length);
+      common::ParallelPrefixSum(row_flg.data(), num_rows);
+      const dim_t nnr = num_rows > 0 ? row_flg[num_rows - 1] : 0;
+      rsp->CheckAndAllocAuxData(kIdx, Shape1(nnr));
       if (0 == nnr) return;
+      RType* row_idx = rsp->aux_data(kIdx).dptr<RType>();
+      mxnet_op::Kernel<FillRspRowIdxKernel, cpu>::Launch(s, num_rows,
+          row_idx, row_flg.data(), num_rows);
       auto storage_shape = dns.shape_;
       storage_shape[0] = nnr;
       rsp->CheckAndAllocData(storage_shape);
-      auto dns_data = dns.get_with_shape<cpu, 2, DType>(Shape2(num_rows, row_length), s);
-      auto rsp_data = rsp->data().get_with_shape<cpu, 2, DType>(Shape2(nnr, row_length), s);
-      dim_t idx = 0;
-      for (dim_t i = 0; i < num_rows; ++i) {
-        if (row_idx[i] > 0) {
-          row_idx[idx] = i;
-          Copy(rsp_data[idx], dns_data[i], s);
-          ++idx;
-        }
-      }
+      mxnet_op::Kernel<CopyDnsRspRows, cpu>::Launch(s, nnr,
+          rsp->data().dptr<DType>(), row_idx, dns.dptr<DType>(), row_length);
     });
   });
 }
@@ -251,12 +262,9 @@ inline void CastStorageDnsCsrImpl(const OpContext& ctx,
         dim_t num_threads = num_rows;
         mxnet_op::Kernel<FillCsrIndPtr, cpu>::Launch(s, num_threads,
             indptr, dns_data, num_rows, num_cols);
-        // single thread to accumulate indptr
         // indptr[num_rows] indicates the number of non-zero elements
         indptr[0] = 0;
-        for (dim_t i = 0; i < num_rows; ++i) {
-          indptr[i+1] += indptr[i];
-        }
+        common::ParallelPrefixSum(indptr + 1, num_rows);
         // allocate column idx array and value array
         csr->CheckAndAllocAuxData(csr::kIdx, Shape1(static_cast<index_t>(indptr[num_rows])));
         csr->CheckAndAllocData(Shape1(static_cast<index_t>(indptr[num_rows])));
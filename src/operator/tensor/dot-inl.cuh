@@ -27,6 +27,9 @@
 
 #include <mxnet/base.h>
 #include <mxnet/operator.h>
+#include <limits>
+#include <unordered_map>
+#include "../../common/cuda_utils.h"
 #include "./util/tensor_util-inl.h"
 #include "./util/tensor_util-inl.cuh"
 #include "./indexing_op.h"
@@ -434,6 +437,142 @@ struct MarkLookupTable {
   }
 };
 
+/*! \brief csrmm2 of cuSPARSE, overloaded for the data types of the sparse dot */
+inline cusparseStatus_t CusparseCsrmm(cusparseHandle_t handle, cusparseOperation_t trans_a,
+                                      cusparseOperation_t trans_b, int m, int n, int k, int nnz,
+                                      const float* alpha, const cusparseMatDescr_t descr,
+                                      const float* val, const int* indptr, const int* col_idx,
+                                      const float* b, int ldb, const float* beta,
+                                      float* c, int ldc) {
+  return cusparseScsrmm2(handle, trans_a, trans_b, m, n, k, nnz, alpha, descr, val,
+                         indptr, col_idx, b, ldb, beta, c, ldc);
+}
+
+inline cusparseStatus_t CusparseCsrmm(cusparseHandle_t handle, cusparseOperation_t trans_a,
+                                      cusparseOperation_t trans_b, int m, int n, int k, int nnz,
+                                      const double* alpha, const cusparseMatDescr_t descr,
+                                      const double* val, const int* indptr, const int* col_idx,
+                                      const double* b, int ldb, const double* beta,
+                                      double* c, int ldc) {
+  return cusparseDcsrmm2(handle, trans_a, trans_b, m, n, k, nnz, alpha, descr, val,
+                         indptr, col_idx, b, ldb, beta, c, ldc);
+}
+
+/*! \brief geam of cuBLAS, used to move dense matrices between row and column major */
+inline cublasStatus_t CublasGeam(cublasHandle_t handle, cublasOperation_t trans_a,
+                                 cublasOperation_t trans_b, int m, int n, const float* alpha,
+                                 const float* a, int lda, const float* beta, const float* b,
+                                 int ldb, float* c, int ldc) {
+  return cublasSgeam(handle, trans_a, trans_b, m, n, alpha, a, lda, beta, b, ldb, c, ldc);
+}
+
+inline cublasStatus_t CublasGeam(cublasHandle_t handle, cublasOperation_t trans_a,
+                                 cublasOperation_t trans_b, int m, int n, const double* alpha,
+                                 const double* a, int lda, const double* beta, const double* b,
+                                 int ldb, double* c, int ldc) {
+  return cublasDgeam(handle, trans_a, trans_b, m, n, alpha, a, lda, beta, b, ldb, c, ldc);
+}
+
+/*!
+ * \brief the cuSPARSE handle of the calling thread on the current device, bound to stream.
+ *  Handles are created on first use and kept for the lifetime of the thread.
+ */
+inline cusparseHandle_t GetCusparseHandle(cudaStream_t stream) {
+  static thread_local std::unordered_map<int, cusparseHandle_t> handles;
+  int device = 0;
+  CUDA_CALL(cudaGetDevice(&device));
+  auto it = handles.find(device);
+  if (it == handles.end()) {
+    cusparseHandle_t handle;
+    CUSPARSE_CALL(cusparseCreate(&handle));
+    it = handles.emplace(device, handle).first;
+  }
+  CUSPARSE_CALL(cusparseSetStream(it->second, stream));
+  return it->second;
+}
+
+/*!
+ * \brief whether dot(csr, dns) = dns and dot(csr.T, dns) = dns go through cuSPARSE.
+ *  csrmm2 beats the kernels below once rhs is wide enough and the rows of lhs are long
+ *  enough to keep it busy, and the transposed product always, since the kernels below
+ *  scatter it with atomics. MXNET_CUSPARSE_DOT=0 keeps the kernels, 2 forces cuSPARSE.
+ */
+inline bool UseCusparseDot(const NDArray& lhs, const TBlob& rhs, const bool trans_lhs) {
+  static const int mode = dmlc::GetEnv("MXNET_CUSPARSE_DOT", 1);
+  const int kMaxInt = std::numeric_limits<int>::max();
+  const nnvm::dim_t num_rows_l = lhs.shape()[0];
+  const nnvm::dim_t num_cols_r = rhs.shape_[1];
+  const nnvm::dim_t nnz = lhs.aux_shape(csr::kIdx)[0];
+  // csrmm2 takes int32 indices and sizes
+  if (mode == 0 || lhs.aux_type(csr::kIndPtr) != mshadow::kInt32 ||
+      lhs.aux_type(csr::kIdx) != mshadow::kInt32 || nnz > kMaxInt ||
+      lhs.shape().Size() > static_cast<size_t>(kMaxInt) ||
+      rhs.Size() > static_cast<size_t>(kMaxInt)) {
+    return false;
+  }
+  if (mode == 2) return true;
+  if (trans_lhs) return num_cols_r > 1;
+  return num_cols_r >= 32 && nnz >= 16 * num_rows_l;
+}
+
+/*!
+ * \brief dot(csr, dns) = dns and dot(csr.T, dns) = dns with cuSPARSE csrmm2.
+ *  csrmm2 works on column major matrices, so its output goes to the workspace and is
+ *  transposed into ret. It reads the row major rhs as a transposed column major matrix,
+ *  which it can only do when lhs is not transposed as well, so rhs of the transposed
+ *  product is transposed into the workspace first.
+ */
+template<typename DType>
+inline void DotCsrDnsDnsCusparse(const OpContext& ctx, const NDArray& lhs, const TBlob& rhs,
+                                 const OpReqType req, const bool trans_lhs, TBlob* ret) {
+  using mshadow::Shape1;
+  using mshadow::Stream;
+  Stream<gpu>* s = ctx.get_stream<gpu>();
+  const int m = lhs.shape()[0];
+  const int k = lhs.shape()[1];
+  const int n = rhs.shape_[1];
+  const int nnz = lhs.aux_shape(csr::kIdx)[0];
+  const int out_rows = trans_lhs ? k : m;
+  const int rhs_rows = trans_lhs ? m : k;
+  const size_t out_size = static_cast<size_t>(out_rows) * n;
+  const size_t rhs_size = trans_lhs ? static_cast<size_t>(rhs_rows) * n : 0;
+  DType* workspace = ctx.requested[0].get_space_typed<gpu, 1, DType>(
+      Shape1(out_size + rhs_size), s).dptr_;
+  DType* out_col_major = workspace;
+  cusparseHandle_t handle = GetCusparseHandle(Stream<gpu>::GetStream(s));
+  cublasHandle_t blas_handle = Stream<gpu>::GetBlasHandle(s);
+  const DType one = 1;
+  const DType zero = 0;
+  const DType* b = rhs.dptr<DType>();
+  int ldb = n;
+  cusparseOperation_t trans_b = CUSPARSE_OPERATION_TRANSPOSE;
+  if (trans_lhs) {
+    DType* rhs_col_major = workspace + out_size;
+    CUBLAS_CALL(CublasGeam(blas_handle, CUBLAS_OP_T, CUBLAS_OP_N, rhs_rows, n, &one, b, n,
+                           &zero, rhs_col_major, rhs_rows, rhs_col_major, rhs_rows));
+    b = rhs_col_major;
+    ldb = rhs_rows;
+    trans_b = CUSPARSE_OPERATION_NON_TRANSPOSE;
+  }
+  cusparseMatDescr_t descr;
+  CUSPARSE_CALL(cusparseCreateMatDescr(&descr));
+  CUSPARSE_CALL(cusparseSetMatType(descr, CUSPARSE_MATRIX_TYPE_GENERAL));
+  CUSPARSE_CALL(cusparseSetMatIndexBase(descr, CUSPARSE_INDEX_BASE_ZERO));
+  const TBlob data_l = lhs.data();
+  const cusparseOperation_t trans_a = trans_lhs ? CUSPARSE_OPERATION_TRANSPOSE
+                                                : CUSPARSE_OPERATION_NON_TRANSPOSE;
+  CUSPARSE_CALL(CusparseCsrmm(handle, trans_a, trans_b, m, n, k, nnz, &one, descr,
+                              data_l.dptr<DType>(), lhs.aux_data(csr::kIndPtr).dptr<int>(),
+                              lhs.aux_data(csr::kIdx).dptr<int>(), b, ldb, &zero,
+                              out_col_major, out_rows));
+  CUSPARSE_CALL(cusparseDestroyMatDescr(descr));
+  // ret = op(lhs) * rhs, or ret + op(lhs) * rhs for kAddTo, back in row major
+  const DType beta = req == kAddTo ? 1 : 0;
+  DType* out = ret->dptr<DType>();
+  CUBLAS_CALL(CublasGeam(blas_handle, CUBLAS_OP_T, CUBLAS_OP_N, n, out_rows, &one,
+                         out_col_major, out_rows, &beta, out, n, out, n));
+}
+
 /*!
  * \brief GPU Impl of dot(csr, dns1) = dns2 and dot(csr.T, dns1) = dns2
  */
@@ -473,6 +612,13 @@ inline void DotCsrDnsDnsImpl(const OpContext& ctx,
   const TBlob& data_r = rhs;
   const TBlob data_out = *ret;
 
+  if (UseCusparseDot(lhs, rhs, trans_lhs)) {
+    MSHADOW_SGL_DBL_TYPE_SWITCH(data_l.type_flag_, DType, {
+      DotCsrDnsDnsCusparse<DType>(ctx, lhs, rhs, req, trans_lhs, ret);
+    });
+    return;
+  }
+
   MSHADOW_SGL_DBL_TYPE_SWITCH(data_l.type_flag_, DType, {  // data type
     MSHADOW_IDX_TYPE_SWITCH(indptr_l.type_flag_, IType, {  // indptr type
       MSHADOW_IDX_TYPE_SWITCH(col_idx_l.type_flag_, CType, {  // col idx type
@@ -961,6 +1107,183 @@ inline void DotCsrRspDnsImpl(const OpContext& ctx,
   });
 }
 
+/*!
+ * \brief GPU Kernel of the start of every non-zero column of csr in its column indices
+ *  sorted by column, col_flg_sum being the prefix sum of the non-zero column flags
+ * Parallelization by non-zero elements: 1 thread/element
+ */
+struct CsrColumnStartKernel {
+  template<typename CType>
+  __device__ __forceinline__ static void Map(int tid,
+                                             CType* col_start,
+                                             const CType* sorted_col_idx,
+                                             const nnvm::dim_t* col_flg_sum,
+                                             const nnvm::dim_t nnz,
+                                             const nnvm::dim_t nnc) {
+    if (tid == 0 || sorted_col_idx[tid] != sorted_col_idx[tid - 1]) {
+      col_start[col_flg_sum[static_cast<nnvm::dim_t>(sorted_col_idx[tid])] - 1] = tid;
+    }
+    if (tid == nnz - 1) col_start[nnc] = nnz;
+  }
+};
+
+/*!
+ * \brief GPU Kernel of the column indices of dot(dns, csr) = csr,
+ *  every row of which holds all non-zero columns of rhs
+ * Parallelization by output elements: 1 thread/element
+ */
+struct PopulateCsrColIdxForNNCKernel {
+  template<typename CType>
+  __device__ __forceinline__ static void Map(int tid,
+                                             CType* col_idx_out,
+                                             const CType* nnc_idx,
+                                             const nnvm::dim_t nnc) {
+    col_idx_out[tid] = nnc_idx[tid % nnc];
+  }
+};
+
+/*!
+ * \brief GPU Kernel of dot(dns, csr) = csr. rhs_pos holds the positions of the
+ *  non-zeros of rhs sorted by column, those of the p-th non-zero column in
+ *  [col_start[p], col_start[p + 1]), and rhs_row their rows
+ * Parallelization by output elements: 1 thread/element
+ */
+struct DotDnsCsrCsrKernel {
+  template<typename DType, typename IType, typename CType>
+  __device__ __forceinline__ static void Map(int tid,
+                                             DType* out,
+                                             const DType* data_l,
+                                             const DType* data_r,
+                                             const CType* rhs_pos,
+                                             const IType* rhs_row,
+                                             const CType* col_start,
+                                             const nnvm::dim_t num_cols_l,
+                                             const nnvm::dim_t nnc) {
+    const nnvm::dim_t i = tid / nnc;
+    const nnvm::dim_t p = tid % nnc;
+    const DType* row_l = data_l + i * num_cols_l;
+    DType sum = 0;
+    for (CType k = col_start[p]; k < col_start[p + 1]; ++k) {
+      const CType pos = rhs_pos[k];
+      sum += row_l[static_cast<nnvm::dim_t>(rhs_row[pos])] * data_r[pos];
+    }
+    out[tid] = sum;
+  }
+};
+
+/*!
+ * \brief GPU Impl of dot(dns, csr) = csr
+ */
+inline void DotDnsCsrCsrImpl(const OpContext& ctx, const gpu& gpu_dev,
+                             const TBlob& lhs, const NDArray& rhs,
+                             const OpReqType req, NDArray* ret) {
+  if (kNullOp == req) return;
+  CHECK_EQ(req, kWriteTo);
+  CHECK_EQ(rhs.storage_type(), kCSRStorage);
+  mshadow::Stream<gpu>* s = ctx.get_stream<gpu>();
+  if (!rhs.storage_initialized()) {
+    FillZerosCsrImpl(s, *ret);
+    return;
+  }
+
+  using mshadow::Shape1;
+  using mshadow::Tensor;
+  using mxnet_op::Kernel;
+  using mxnet_op::set_zero;
+  using nnvm::dim_t;
+
+  const NDArray& out = *ret;
+  const TBlob data_r = rhs.data();
+  const TBlob indptr_r = rhs.aux_data(csr::kIndPtr);
+  const TBlob col_idx_r = rhs.aux_data(csr::kIdx);
+  const dim_t num_rows_l = lhs.shape_[0];
+  const dim_t num_cols_l = lhs.shape_[1];
+  const dim_t num_cols_r = rhs.shape()[1];
+  const dim_t nnz_r = col_idx_r.Size();
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+
+  MSHADOW_SGL_DBL_TYPE_SWITCH(data_r.type_flag_, DType, {     // data type
+    MSHADOW_IDX_TYPE_SWITCH(indptr_r.type_flag_, IType, {     // indptr type
+      MSHADOW_IDX_TYPE_SWITCH(col_idx_r.type_flag_, CType, {  // colidx type
+        // temporary memory layout: column flags and their prefix sum, the non-zero
+        // columns and their starts, the column indices of rhs sorted with the
+        // positions of its non-zeros, the rows of the non-zeros, and the temp
+        // storage of the scan and the sort
+        size_t scan_temp_bytes = 0;
+        dim_t* null_ptr = nullptr;
+        cub::DeviceScan::InclusiveSum(nullptr, scan_temp_bytes, null_ptr, null_ptr,
+                                      num_cols_r, stream);
+        const size_t temp_bytes = std::max(scan_temp_bytes,
+                                           SortByKeyWorkspaceSize<CType, CType, gpu>(nnz_r));
+        auto aligned = [](size_t bytes) {
+          return (bytes + sizeof(dim_t) - 1) / sizeof(dim_t) * sizeof(dim_t);
+        };
+        const size_t col_flg_bytes = 2 * num_cols_r * sizeof(dim_t);
+        const size_t nnc_bytes = aligned((2 * num_cols_r + 1) * sizeof(CType));
+        const size_t sort_bytes = aligned(2 * nnz_r * sizeof(CType));
+        const size_t row_bytes = aligned(nnz_r * sizeof(IType));
+        Tensor<gpu, 1, char> workspace = ctx.requested[0].get_space_typed<gpu, 1, char>(
+            Shape1(col_flg_bytes + nnc_bytes + sort_bytes + row_bytes + temp_bytes), s);
+        dim_t* col_flg = reinterpret_cast<dim_t*>(workspace.dptr_);
+        dim_t* col_flg_sum = col_flg + num_cols_r;
+        CType* nnc_idx = reinterpret_cast<CType*>(workspace.dptr_ + col_flg_bytes);
+        CType* col_start = nnc_idx + num_cols_r;
+        CType* sorted_col_idx = reinterpret_cast<CType*>(workspace.dptr_ + col_flg_bytes +
+                                                         nnc_bytes);
+        CType* rhs_pos = sorted_col_idx + nnz_r;
+        IType* rhs_row = reinterpret_cast<IType*>(workspace.dptr_ + col_flg_bytes +
+                                                  nnc_bytes + sort_bytes);
+        char* temp_storage_ptr = workspace.dptr_ + col_flg_bytes + nnc_bytes +
+                                 sort_bytes + row_bytes;
+
+        // mark the non-zero columns and number them
+        Kernel<set_zero, gpu>::Launch(s, num_cols_r, col_flg);
+        Kernel<MarkRowFlgKernel, gpu>::Launch(s, nnz_r, col_flg, col_idx_r.dptr<CType>());
+        cub::DeviceScan::InclusiveSum(temp_storage_ptr, scan_temp_bytes, col_flg,
+                                      col_flg_sum, num_cols_r, stream);
+        dim_t nnc = 0;
+        CUDA_CALL(cudaMemcpy(&nnc, col_flg_sum + num_cols_r - 1, sizeof(dim_t),
+                             cudaMemcpyDeviceToHost));
+        if (nnc == 0) {
+          FillZerosCsrImpl(s, *ret);
+          return;
+        }
+        Kernel<FillRspRowIdxKernel, gpu>::Launch(s, num_cols_r, nnc_idx, col_flg_sum,
+                                                 num_cols_r);
+
+        // every row of the output holds all non-zero columns of rhs
+        const dim_t nnz = nnc * num_rows_l;
+        out.CheckAndAllocAuxData(csr::kIndPtr, Shape1(num_rows_l + 1));
+        out.CheckAndAllocAuxData(csr::kIdx, Shape1(nnz));
+        out.CheckAndAllocData(Shape1(nnz));
+        IType* indptr_out = out.aux_data(csr::kIndPtr).dptr<IType>();
+        CType* col_idx_out = out.aux_data(csr::kIdx).dptr<CType>();
+        Kernel<range_fwd, gpu>::Launch(s, num_rows_l + 1, 1, IType(0), IType(nnc), kWriteTo,
+                                       indptr_out);
+        Kernel<PopulateCsrColIdxForNNCKernel, gpu>::Launch(s, nnz, col_idx_out, nnc_idx, nnc);
+
+        // group the non-zeros of rhs by column
+        Kernel<mxnet_op::op_with_req<mshadow_op::identity, kWriteTo>, gpu>::Launch(
+            s, nnz_r, sorted_col_idx, col_idx_r.dptr<CType>());
+        Kernel<range_fwd, gpu>::Launch(s, nnz_r, 1, CType(0), CType(1), kWriteTo, rhs_pos);
+        Tensor<gpu, 1, CType> sorted_col_idx_tensor(sorted_col_idx, Shape1(nnz_r), s);
+        Tensor<gpu, 1, CType> rhs_pos_tensor(rhs_pos, Shape1(nnz_r), s);
+        Tensor<gpu, 1, char> temp_storage(temp_storage_ptr, Shape1(temp_bytes), s);
+        SortByKey(sorted_col_idx_tensor, rhs_pos_tensor, true, &temp_storage, 0,
+                  log2i(num_cols_r - 1));
+        Kernel<CsrColumnStartKernel, gpu>::Launch(s, nnz_r, col_start, sorted_col_idx,
+                                                  col_flg_sum, nnz_r, nnc);
+        Kernel<CsrRowScatterKernel, gpu>::Launch(s, num_cols_l, indptr_r.dptr<IType>(),
+                                                 rhs_row, num_cols_l);
+
+        Kernel<DotDnsCsrCsrKernel, gpu>::Launch(s, nnz, out.data().dptr<DType>(),
+            lhs.dptr<DType>(), data_r.dptr<DType>(), rhs_pos, rhs_row, col_start,
+            num_cols_l, nnc);
+      });
+    });
+  });
+}
+
 }  // namespace op
 }  // namespace mxnet
 
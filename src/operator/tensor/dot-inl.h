@@ -34,6 +34,7 @@
 #include "../mshadow_op.h"
 #include "../elemwise_op_common.h"
 #include "./init_op.h"
+#include "./sort_op.h"
 #include "../mxnet_op.h"
 #ifdef __CUDACC__
 #include "./dot-inl.cuh"
@@ -237,11 +238,8 @@ inline bool DotForwardInferStorageType(const nnvm::NodeAttrs& attrs,
   if (!dispatched && lhs_stype == kDefaultStorage && rhs_stype == kCSRStorage &&
       !param.transpose_a && !param.transpose_b) {
     // dns, csr -> csr
-    const bool invalid_ctx = dev_mask != mshadow::cpu::kDevMask;
-    const auto dispatch_ex = invalid_ctx ? DispatchMode::kFComputeFallback
-                                         : DispatchMode::kFComputeEx;
     dispatched = storage_type_assign(&out_stype, kCSRStorage, dispatch_mode,
-                                     dispatch_ex);
+                                     DispatchMode::kFComputeEx);
   }
   if (!dispatched) {
     dispatched = dispatch_fallback(out_attrs, dispatch_mode);
@@ -296,14 +294,57 @@ inline bool DotBackwardInferStorageType(const nnvm::NodeAttrs& attrs,
   return dispatched;
 }
 
+/*!
+ * \brief y += alpha * x, the restricted pointers let the compiler vectorize the loop
+ */
+template<typename DType>
+MSHADOW_XINLINE void DotAxpy(const nnvm::dim_t n, const DType alpha,
+                             const DType* __restrict x, DType* __restrict y) {
+  for (nnvm::dim_t l = 0; l < n; ++l) {
+    y[l] += alpha * x[l];
+  }
+}
+
+/*!
+ * \brief Split the rows of a csr matrix into num_parts parts of about the same cost,
+ *  a row costing one plus its number of non-zeros.
+ * \param indptr the num_rows + 1 row pointers
+ * \return the first row of every part, followed by num_rows
+ */
+template<typename IType>
+inline std::vector<nnvm::dim_t> PartitionCsrRows(const IType* indptr,
+                                                 const nnvm::dim_t num_rows,
+                                                 const int num_parts) {
+  using nnvm::dim_t;
+  std::vector<dim_t> starts(num_parts + 1, num_rows);
+  const dim_t total = static_cast<dim_t>(indptr[num_rows]) + num_rows;
+  starts[0] = 0;
+  for (int p = 1; p < num_parts; ++p) {
+    // the first row with a cost up to it of at least p / num_parts of the total
+    const dim_t target = total * p / num_parts;
+    dim_t lo = starts[p - 1], hi = num_rows;
+    while (lo < hi) {
+      const dim_t mid = lo + (hi - lo) / 2;
+      if (static_cast<dim_t>(indptr[mid]) + mid < target) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    starts[p] = lo;
+  }
+  return starts;
+}
+
 /*!
  * \brief CPU Kernel of dot(csr, dns1) = dns2
- * Parallelization by row blocks
+ * Parallelization by row blocks holding about the same number of non-zeros
  */
 struct DotCsrDnsDnsByRowBlocks {
   /*!
    * \brief
    * \param i the i-th thread
+   * \param row_starts the first row of every thread, followed by the number of rows
    */
   template<typename DType, typename IType, typename CType>
   MSHADOW_CINLINE static void Map(int i,
@@ -312,109 +353,124 @@ struct DotCsrDnsDnsByRowBlocks {
                                   const IType* indptr_l,
                                   const CType* col_idx_l,
                                   const DType* data_r,
-                                  const nnvm::dim_t seg_len,
-                                  const nnvm::dim_t num_rows,
-                                  const nnvm::dim_t num_cols) {
+                                  const nnvm::dim_t* row_starts,
+                                  const nnvm::dim_t num_cols,
+                                  const bool write_to) {
     using nnvm::dim_t;
-    const dim_t seg_start = i * seg_len;
-    if (seg_start >= num_rows) return;
-    const dim_t seg_end = std::min(seg_start + seg_len, num_rows);
-    for (dim_t j = seg_start; j < seg_end; ++j) {
-      if (indptr_l[j] == indptr_l[j+1]) continue;
-      const dim_t offset_out = j * num_cols;
+    for (dim_t j = row_starts[i]; j < row_starts[i + 1]; ++j) {
+      DType* out_row = out + j * num_cols;
+      if (write_to) std::fill(out_row, out_row + num_cols, DType(0));
       for (IType k = indptr_l[j]; k < indptr_l[j+1]; ++k) {
-        const DType val = data_l[k];
-        const dim_t offset_r = col_idx_l[k] * num_cols;
-        for (dim_t l = 0; l < num_cols; ++l) {
-          out[offset_out+l] += data_r[offset_r+l] * val;
-        }
+        DotAxpy(num_cols, data_l[k], data_r + col_idx_l[k] * num_cols, out_row);
       }
     }
   }
 };
 
 /*!
- * \brief CPU Kernel of dot(csr.T(), dns1) = dns2
- * Parallelization by row blocks
+ * \brief The non-zeros of a csr matrix sorted by column, so that dot(csr.T, dns) writes
+ *  every output row from one thread: segment s holds the non-zeros of the s-th non-empty
+ *  column, which are the sorted positions [seg_start[s], seg_start[s + 1]).
  */
-struct DotCsrTransDnsDnsByRowBlocks {
-  /*!
-   * \brief
-   * \param i the i-th thread
-   */
-  template<typename DType, typename IType, typename CType>
-  MSHADOW_CINLINE static void Map(int i,
-                                  DType* out,
-                                  const DType* data_l,
-                                  const IType* indptr_l,
-                                  const CType* col_idx_l,
-                                  const DType* data_r,
-                                  const nnvm::dim_t seg_len,
-                                  const nnvm::dim_t num_rows_l,
-                                  const nnvm::dim_t num_rows,
-                                  const nnvm::dim_t num_cols) {
-    using nnvm::dim_t;
-    const dim_t seg_start = i * seg_len;
-    if (seg_start >= num_rows) return;
-    const dim_t seg_end = (i + 1) * seg_len;
-    for (dim_t j = 0; j < num_rows_l; ++j) {
-      if (indptr_l[j] == indptr_l[j+1]) continue;
-      const dim_t offset_r = j * num_cols;
-      for (IType k = indptr_l[j]; k < indptr_l[j+1]; ++k) {
-        const CType col_idx = col_idx_l[k];
-        if (col_idx < seg_start || col_idx >= seg_end) continue;
-        const dim_t offset_out = col_idx * num_cols;
-        const DType val = data_l[k];
-        for (dim_t l = 0; l < num_cols; ++l) {
-          out[offset_out+l] += data_r[offset_r+l] * val;
-        }
-      }
-    }
+struct CsrColumnSegments {
+  /*! \brief column of every sorted non-zero */
+  nnvm::dim_t* col;
+  /*! \brief position in the csr matrix of every sorted non-zero */
+  nnvm::dim_t* pos;
+  /*! \brief row of every non-zero of the csr matrix, in its original order */
+  nnvm::dim_t* row;
+  /*! \brief start of every segment, followed by the number of non-zeros */
+  nnvm::dim_t* seg_start;
+  nnvm::dim_t num_segments;
+
+  static size_t WorkspaceSize(const nnvm::dim_t nnz) {
+    return (4 * nnz + 1) * sizeof(nnvm::dim_t);
   }
 };
 
 /*!
- * \brief CPU Kernel of dot(csr.T(), dns) = rsp
- * Parallelization by row blocks which evenly partition the non-zero rows.
+ * \brief Sort the non-zeros of a csr matrix by column into CsrColumnSegments
+ * \param workspace CsrColumnSegments::WorkspaceSize(nnz) bytes
  */
-struct DotCsrTransDnsRspByRowBlocks {
+template<typename IType, typename CType>
+inline CsrColumnSegments GetCsrColumnSegments(const IType* indptr, const CType* col_idx,
+                                              const nnvm::dim_t num_rows,
+                                              const nnvm::dim_t num_cols,
+                                              char* workspace) {
+  using nnvm::dim_t;
+  const dim_t nnz = indptr[num_rows];
+  CsrColumnSegments ret;
+  ret.col = reinterpret_cast<dim_t*>(workspace);
+  ret.pos = ret.col + nnz;
+  ret.row = ret.pos + nnz;
+  ret.seg_start = ret.row + nnz;
+  const int num_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  #pragma omp parallel for num_threads(num_threads)
+  for (dim_t j = 0; j < num_rows; ++j) {
+    for (IType k = indptr[j]; k < indptr[j + 1]; ++k) {
+      ret.col[k] = col_idx[k];
+      ret.pos[k] = k;
+      ret.row[k] = j;
+    }
+  }
+  int num_bits = 1;
+  while ((static_cast<dim_t>(1) << num_bits) < num_cols) ++num_bits;
+  RadixSortByKey(ret.col, ret.pos, nnz, 0, num_bits);
+  // the segments start where the column changes, every thread compacts its chunk
+  // of the starts after the ones of the chunks before it
+  const int num_chunks = std::max<dim_t>(1, std::min<dim_t>(num_threads, nnz / 4096));
+  std::vector<dim_t> chunk_offset(num_chunks + 1, 0);
+  auto chunk = [nnz, num_chunks](const int c) { return nnz * c / num_chunks; };
+  auto is_start = [&ret](const dim_t k) { return k == 0 || ret.col[k] != ret.col[k - 1]; };
+  #pragma omp parallel for num_threads(num_chunks)
+  for (int c = 0; c < num_chunks; ++c) {
+    for (dim_t k = chunk(c); k < chunk(c + 1); ++k) chunk_offset[c + 1] += is_start(k);
+  }
+  for (int c = 0; c < num_chunks; ++c) chunk_offset[c + 1] += chunk_offset[c];
+  #pragma omp parallel for num_threads(num_chunks)
+  for (int c = 0; c < num_chunks; ++c) {
+    dim_t s = chunk_offset[c];
+    for (dim_t k = chunk(c); k < chunk(c + 1); ++k) {
+      if (is_start(k)) ret.seg_start[s++] = k;
+    }
+  }
+  ret.num_segments = chunk_offset[num_chunks];
+  ret.seg_start[ret.num_segments] = nnz;
+  return ret;
+}
+
+/*!
+ * \brief CPU Kernel of dot(csr.T(), dns1) = dns2 and dot(csr.T(), dns) = rsp, without
+ *  atomics: every thread computes the output rows of the columns of its segments.
+ *  The rows of a row sparse output are the segments, and they are written together
+ *  with their indices.
+ */
+struct DotCsrTransDnsBySegments {
   /*!
    * \brief
    * \param i the i-th thread
+   * \param seg_begin the first segment of every thread, followed by the number of segments
    */
-  template<typename DType, typename IType, typename CType, typename RType>
+  template<typename DType, typename RType>
   MSHADOW_CINLINE static void Map(int i,
                                   DType* out,
-                                  nnvm::dim_t* row_flg_sum,
-                                  RType* row_idx,
+                                  RType* row_idx_out,
+                                  const CsrColumnSegments segments,
+                                  const nnvm::dim_t* seg_begin,
                                   const DType* data_l,
-                                  const IType* indptr_l,
-                                  const CType* col_idx_l,
                                   const DType* data_r,
-                                  const nnvm::dim_t seg_len,
-                                  const nnvm::dim_t num_rows_l,
-                                  const nnvm::dim_t nnr,
                                   const nnvm::dim_t num_cols) {
     using nnvm::dim_t;
-    const dim_t seg_start = i * seg_len;
-    if (seg_start >= nnr) return;
-    const dim_t seg_end = (i + 1) * seg_len;
-    const dim_t col_start = row_idx[seg_start];
-    const dim_t col_end = seg_end >= nnr ? (row_idx[nnr-1] + 1) : row_idx[seg_end];
-    for (dim_t j = 0; j < num_rows_l; ++j) {
-      if (indptr_l[j] == indptr_l[j+1]) continue;
-      const dim_t offset_r = j * num_cols;
-      for (IType k = indptr_l[j]; k < indptr_l[j+1]; ++k) {
-        const CType col_idx = col_idx_l[k];
-        if (col_idx < col_start || col_idx >= col_end) continue;
-
-        const nnvm::dim_t rsp_row = row_flg_sum[col_idx] - 1;
-        const nnvm::dim_t offset_out = rsp_row * num_cols;
-        const DType val = data_l[k];
-
-        for (dim_t l = 0; l < num_cols; ++l) {
-          out[offset_out+l] += data_r[offset_r+l] * val;
-        }
+    for (dim_t s = seg_begin[i]; s < seg_begin[i + 1]; ++s) {
+      const dim_t col = segments.col[segments.seg_start[s]];
+      DType* out_row = out + (row_idx_out == nullptr ? col : s) * num_cols;
+      if (row_idx_out != nullptr) {
+        row_idx_out[s] = static_cast<RType>(col);
+        std::fill(out_row, out_row + num_cols, DType(0));
+      }
+      for (dim_t k = segments.seg_start[s]; k < segments.seg_start[s + 1]; ++k) {
+        const dim_t pos = segments.pos[k];
+        DotAxpy(num_cols, data_l[pos], data_r + segments.row[pos] * num_cols, out_row);
       }
     }
   }
@@ -640,24 +696,30 @@ inline void DotCsrDnsDnsImpl(const OpContext& ctx,
   MSHADOW_SGL_DBL_TYPE_SWITCH(data_l.type_flag_, DType, {  // data type
     MSHADOW_IDX_TYPE_SWITCH(indptr_l.type_flag_, IType, {  // indptr type
       MSHADOW_IDX_TYPE_SWITCH(col_idx_l.type_flag_, CType, {  // col idx type
-        dim_t num_threads;
-        if (kWriteTo == req) {
-          num_threads = data_out.Size();
-          mxnet_op::Kernel<mxnet_op::set_zero, cpu>::Launch(
-              s, num_threads, data_out.dptr<DType>());
-        }
-        num_threads = mxnet_op::get_num_threads<cpu>(data_out.shape_[0]);
-        dim_t seg_len = (data_out.shape_[0] + num_threads - 1) / num_threads;
+        const int num_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
         if (trans_lhs) {
-          mxnet_op::Kernel<DotCsrTransDnsDnsByRowBlocks, cpu>::Launch(s, num_threads,
-              data_out.dptr<DType>(), data_l.dptr<DType>(), indptr_l.dptr<IType>(),
-              col_idx_l.dptr<CType>(), data_r.dptr<DType>(), seg_len,
-              lhs.shape()[0], data_out.shape_[0], data_out.shape_[1]);
+          if (kWriteTo == req) {
+            mxnet_op::Kernel<mxnet_op::set_zero, cpu>::Launch(
+                s, data_out.Size(), data_out.dptr<DType>());
+          }
+          mshadow::Tensor<cpu, 1, char> workspace =
+            ctx.requested[0].get_space_typed<cpu, 1, char>(mshadow::Shape1(
+              CsrColumnSegments::WorkspaceSize(lhs.aux_shape(csr::kIdx)[0])), s);
+          const CsrColumnSegments segments = GetCsrColumnSegments(indptr_l.dptr<IType>(),
+              col_idx_l.dptr<CType>(), lhs.shape()[0], lhs.shape()[1], workspace.dptr_);
+          const std::vector<dim_t> seg_begin = PartitionCsrRows(segments.seg_start,
+              segments.num_segments, num_threads);
+          mxnet_op::Kernel<DotCsrTransDnsBySegments, cpu>::Launch(s, num_threads,
+              data_out.dptr<DType>(), static_cast<CType*>(nullptr), segments,
+              seg_begin.data(), data_l.dptr<DType>(), data_r.dptr<DType>(),
+              data_out.shape_[1]);
         } else {
+          const std::vector<dim_t> row_starts = PartitionCsrRows(indptr_l.dptr<IType>(),
+              data_out.shape_[0], num_threads);
           mxnet_op::Kernel<DotCsrDnsDnsByRowBlocks, cpu>::Launch(s, num_threads,
               data_out.dptr<DType>(), data_l.dptr<DType>(), indptr_l.dptr<IType>(),
-              col_idx_l.dptr<CType>(), data_r.dptr<DType>(), seg_len,
-              data_out.shape_[0], data_out.shape_[1]);
+              col_idx_l.dptr<CType>(), data_r.dptr<DType>(), row_starts.data(),
+              data_out.shape_[1], kWriteTo == req);
         }
       });
     });
@@ -696,50 +758,29 @@ inline void DotCsrDnsRspImpl(const OpContext& ctx,
     MSHADOW_IDX_TYPE_SWITCH(indptr_l.type_flag_, IType, {  // indptr type
       MSHADOW_IDX_TYPE_SWITCH(col_idx_l.type_flag_, CType, {  // col idx type
         MSHADOW_IDX_TYPE_SWITCH(ret->aux_type(rowsparse::kIdx), RType, {  // row idx type
-          const dim_t num_rows = lhs.shape()[1];
-          size_t workspace_size = num_rows * sizeof(dim_t);
-          mshadow::Tensor<cpu, 1, char> workspace =
-            ctx.requested[0].get_space_typed<cpu, 1, char>(
-            mshadow::Shape1(workspace_size), s);
-          dim_t* row_flg = reinterpret_cast<dim_t*>(workspace.dptr_);
-          // prefix sum array re-uses the row_flg array temp space
-          dim_t* prefix_sum = row_flg;
-          Kernel<set_zero, cpu>::Launch(s, num_rows, row_flg);
-          Kernel<MarkRowFlgKernel, cpu>::Launch(s, lhs.aux_shape(csr::kIdx)[0], row_flg,
-            col_idx_l.dptr<CType>());
-
-          prefix_sum[0] = row_flg[0];
-          for (nnvm::dim_t i = 1; i < num_rows; i++) {
-            prefix_sum[i] = prefix_sum[i - 1] + row_flg[i];
+          if (!trans_lhs) {
+            LOG(FATAL) << "DotCsrDnsRspImpl has not implemented dot(csr, dns)=rsp yet.";
           }
-          dim_t nnr = prefix_sum[num_rows - 1];
-
+          // the non-empty columns of lhs are the rows of the output
+          mshadow::Tensor<cpu, 1, char> workspace =
+            ctx.requested[0].get_space_typed<cpu, 1, char>(mshadow::Shape1(
+              CsrColumnSegments::WorkspaceSize(lhs.aux_shape(csr::kIdx)[0])), s);
+          const CsrColumnSegments segments = GetCsrColumnSegments(indptr_l.dptr<IType>(),
+              col_idx_l.dptr<CType>(), lhs.shape()[0], lhs.shape()[1], workspace.dptr_);
+          const dim_t nnr = segments.num_segments;
           if (nnr == 0) {
             FillZerosRspImpl(s, *ret);
             return;
           }
-
           ret->CheckAndAlloc({mshadow::Shape1(nnr)});
           const TBlob& data_out = ret->data();
           const TBlob& row_idx = ret->aux_data(rowsparse::kIdx);
-
-          dim_t num_threads = data_out.Size();
-          mxnet_op::Kernel<set_zero, cpu>::Launch(s, num_threads, data_out.dptr<DType>());
-          RType* row_idx_out = row_idx.dptr<RType>();
-
-          mxnet_op::Kernel<FillRspRowIdxKernel, cpu>::Launch(s, num_rows,
-            row_idx_out, prefix_sum, num_rows);
-
-          num_threads = mxnet_op::get_num_threads<cpu>(nnr);
-          dim_t seg_len = (nnr + num_threads - 1) / num_threads;
-          if (trans_lhs) {
-            mxnet_op::Kernel<DotCsrTransDnsRspByRowBlocks, cpu>::Launch(s, num_threads,
-              data_out.dptr<DType>(), prefix_sum, row_idx_out, data_l.dptr<DType>(),
-              indptr_l.dptr<IType>(), col_idx_l.dptr<CType>(), data_r.dptr<DType>(),
-              seg_len, lhs.shape()[0], nnr, ret->shape()[1]);
-          } else {
-            LOG(FATAL) << "DotCsrDnsRspImpl has not implemented dot(csr, dns)=rsp yet.";
-          }
+          const int num_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+          const std::vector<dim_t> seg_begin = PartitionCsrRows(segments.seg_start, nnr,
+                                                                num_threads);
+          Kernel<DotCsrTransDnsBySegments, cpu>::Launch(s, num_threads,
+            data_out.dptr<DType>(), row_idx.dptr<RType>(), segments, seg_begin.data(),
+            data_l.dptr<DType>(), data_r.dptr<DType>(), ret->shape()[1]);
         });
       });
     });
@@ -898,8 +939,7 @@ inline void DotCsrRspRspImpl(const OpContext& ctx,
 /*
  * \brief CPU Impl of dot(dns, csr) = csr
  */
-template<typename xpu>
-inline void DotDnsCsrCsrImpl(const OpContext& ctx,
+inline void DotDnsCsrCsrImpl(const OpContext& ctx, const cpu& cpu_dev,
                              const TBlob& lhs, const NDArray& rhs,
                              const OpReqType req, NDArray* ret) {
   if (kNullOp == req) return;
@@ -1064,7 +1104,7 @@ void DotForwardEx(const nnvm::NodeAttrs& attrs,
              out_stype == kCSRStorage &&
              !(param.transpose_a || param.transpose_b)) {
     NDArray ret = outputs[0];
-    DotDnsCsrCsrImpl<xpu>(ctx, inputs[0].data(), inputs[1], req[0], &ret);
+    DotDnsCsrCsrImpl(ctx, xpu(), inputs[0].data(), inputs[1], req[0], &ret);
   } else {
     LogUnimplementedOp(attrs, ctx, inputs, req, outputs);
   }
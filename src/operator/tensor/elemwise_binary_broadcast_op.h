@@ -30,6 +30,7 @@
 #include <algorithm>
 #include <vector>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include "../mshadow_op.h"
 #include "../elemwise_op_common.h"
@@ -185,6 +186,50 @@ struct binary_broadcast_kernel {
   }
 };
 
+/*!
+ * \brief out = OP(lhs, rhs) of the output viewed as (outer, mid, inner), where one
+ *  operand has the output shape and the other only varies along mid
+ */
+template<typename OP, bool vec_rhs>
+struct binary_broadcast_mid_kernel {
+  /*! \brief one output element */
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, OpReqType req, int mid, int inner,
+                                  const DType* full, const DType* vec, DType* out) {
+    const DType v = vec[(i / inner) % mid];
+    KERNEL_ASSIGN(out[i], req, vec_rhs ? OP::Map(full[i], v) : OP::Map(v, full[i]));
+  }
+};
+
+/*! \brief the inner elements of row (outer, mid) of binary_broadcast_mid_kernel, for the cpu */
+template<int req, typename OP, bool vec_rhs>
+struct binary_broadcast_mid_row_kernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int row, int mid, int inner,
+                                  const DType* full, const DType* vec, DType* out) {
+    const DType v = vec[row % mid];
+    const size_t base = static_cast<size_t>(row) * inner;
+    for (int j = 0; j < inner; ++j) {
+      KERNEL_ASSIGN(out[base + j], req,
+                    vec_rhs ? OP::Map(full[base + j], v) : OP::Map(v, full[base + j]));
+    }
+  }
+};
+
+/*! \brief the mid elements of row outer of binary_broadcast_mid_kernel with inner 1 */
+template<int req, typename OP, bool vec_rhs>
+struct binary_broadcast_mid_col_kernel {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int row, int mid,
+                                  const DType* full, const DType* vec, DType* out) {
+    const size_t base = static_cast<size_t>(row) * mid;
+    for (int j = 0; j < mid; ++j) {
+      KERNEL_ASSIGN(out[base + j], req,
+                    vec_rhs ? OP::Map(full[base + j], vec[j]) : OP::Map(vec[j], full[base + j]));
+    }
+  }
+};
+
 template<int req, typename OP>
 struct csr_dns_csr_broadcast_kernel {
   template <typename DType, typename CType, typename RType>
@@ -202,6 +247,61 @@ struct csr_dns_csr_broadcast_kernel {
 
 }  // namespace mxnet_op
 
+/*!
+ * \brief whether one of the compacted operand shapes is the output shape and the
+ *  other only varies along one axis, like (N,C,H,W) and (1,C,1,1) or (M,N) and (1,N),
+ *  which is then mid of the output viewed as (outer, mid, inner)
+ */
+inline bool BinaryBroadcastMidShape(const TShape& lshape, const TShape& rshape,
+                                    const TShape& oshape, bool* vec_rhs,
+                                    index_t* outer, index_t* mid, index_t* inner) {
+  if (lshape == oshape) {
+    *vec_rhs = true;
+  } else if (rshape == oshape) {
+    *vec_rhs = false;
+  } else {
+    return false;
+  }
+  const TShape& vshape = *vec_rhs ? rshape : lshape;
+  int axis = -1;
+  for (index_t i = 0; i < vshape.ndim(); ++i) {
+    if (vshape[i] == 1) continue;
+    if (axis >= 0) return false;
+    axis = i;
+  }
+  if (axis < 0) return false;
+  *outer = oshape.ProdShape(0, axis);
+  *mid = oshape[axis];
+  *inner = oshape.ProdShape(axis + 1, oshape.ndim());
+  return true;
+}
+
+/*! \brief BinaryBroadcastCompute of shapes accepted by BinaryBroadcastMidShape */
+template<typename xpu, typename OP, bool vec_rhs, typename DType>
+void BinaryBroadcastMidCompute(mshadow::Stream<xpu>* s, const OpReqType req,
+                               const int outer, const int mid, const int inner,
+                               const DType* lhs, const DType* rhs, DType* out) {
+  using namespace mxnet_op;
+  const DType* full = vec_rhs ? lhs : rhs;
+  const DType* vec = vec_rhs ? rhs : lhs;
+  // the cpu runs contiguous rows when there are enough of them for its threads
+  const int nthreads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  if (std::is_same<xpu, cpu>::value && inner > 1 && outer * mid >= nthreads) {
+    MXNET_ASSIGN_REQ_SWITCH(req, Req, {
+      Kernel<binary_broadcast_mid_row_kernel<Req, OP, vec_rhs>, xpu>::Launch(
+        s, outer * mid, mid, inner, full, vec, out);
+    });
+  } else if (std::is_same<xpu, cpu>::value && inner == 1 && outer >= nthreads) {
+    MXNET_ASSIGN_REQ_SWITCH(req, Req, {
+      Kernel<binary_broadcast_mid_col_kernel<Req, OP, vec_rhs>, xpu>::Launch(
+        s, outer, mid, full, vec, out);
+    });
+  } else {
+    Kernel<binary_broadcast_mid_kernel<OP, vec_rhs>, xpu>::Launch(
+      s, outer * mid * inner, req, mid, inner, full, vec, out);
+  }
+}
+
 template<typename xpu, typename OP>
 void BinaryBroadcastCompute(const nnvm::NodeAttrs& attrs,
                             const OpContext& ctx,
@@ -216,6 +316,21 @@ void BinaryBroadcastCompute(const nnvm::NodeAttrs& attrs,
   } else {
     if (req[0] != kNullOp) {
       mshadow::Stream<xpu> *s = ctx.get_stream<xpu>();
+      bool vec_rhs;
+      index_t outer, mid, inner;
+      if (BinaryBroadcastMidShape(new_lshape, new_rshape, new_oshape, &vec_rhs,
+                                  &outer, &mid, &inner)) {
+        MSHADOW_TYPE_SWITCH(outputs[0].type_flag_, DType, {
+          if (vec_rhs) {
+            BinaryBroadcastMidCompute<xpu, OP, true>(s, req[0], outer, mid, inner,
+              inputs[0].dptr<DType>(), inputs[1].dptr<DType>(), outputs[0].dptr<DType>());
+          } else {
+            BinaryBroadcastMidCompute<xpu, OP, false>(s, req[0], outer, mid, inner,
+              inputs[0].dptr<DType>(), inputs[1].dptr<DType>(), outputs[0].dptr<DType>());
+          }
+        });
+        return;
+      }
       MSHADOW_TYPE_SWITCH(outputs[0].type_flag_, DType, {
         BROADCAST_NDIM_SWITCH(ndim, NDim, {
           mshadow::Shape<NDim> oshape = new_oshape.get<NDim>();
@@ -168,7 +168,19 @@ class ScatterOpBase {
 /*! \brief Scatter elemwise binary op handlers */
 class ElemwiseScatterBinaryOp : public ElemwiseBinaryOp,
                                 public ScatterOpBase {
-  /*! \brief  CPU version, RspRsp knows how to do an efficient scatter,
+  /*! \brief Whether the fused retain and update applies: row_sparse-op-row_sparse
+   * or row_sparse-op-default into row_sparse */
+  static bool IsRetainUpdate(const std::vector<NDArray> &inputs,
+                             const std::vector<NDArray> &outputs) {
+    const NDArrayStorageType input1_stype = inputs[1].storage_type();
+    return inputs[0].storage_type() == kRowSparseStorage
+        && (input1_stype == kRowSparseStorage || input1_stype == kDefaultStorage)
+        && outputs[0].storage_type() == kRowSparseStorage
+        && (input1_stype == kDefaultStorage
+            || inputs[1].aux_type(rowsparse::kIdx) == inputs[0].aux_type(rowsparse::kIdx));
+  }
+
+  /*! \brief  CPU version, rows of rhs are retained in the update of lhs rows,
    * otherwise retain rhs + normal op */
   template<typename OP>
   static void ComputeEx_(mshadow::Stream<cpu> *stream,
@@ -177,21 +189,12 @@ class ElemwiseScatterBinaryOp : public ElemwiseBinaryOp,
                          const std::vector<NDArray> &inputs,
                          const std::vector<OpReqType> &req,
                          const std::vector<NDArray> &outputs) {
-    // row_sparse-op-row_sparse or row_sparse-op-default can call RspRsp
     const NDArrayStorageType input0_stype = inputs[0].storage_type();
     const NDArrayStorageType input1_stype = inputs[1].storage_type();
-    if (input0_stype == kRowSparseStorage
-        && (input1_stype == kRowSparseStorage || input1_stype == kDefaultStorage)
-        && outputs[0].storage_type() == kRowSparseStorage) {
-      mshadow::Stream<cpu> *s = ctx.get_stream<cpu>();
-      MSHADOW_TYPE_SWITCH(inputs[0].dtype(), DType, {
-        MSHADOW_IDX_TYPE_SWITCH(inputs[0].aux_type(rowsparse::kIdx), IType, {
-          RspRspOp<DType, IType, OP>(s, attrs, ctx, inputs[0], inputs[1], req[0], outputs[0],
-                                     false, true, false, true);
-        });
-      });
-      CHECK_EQ(inputs[0].aux_shape(rowsparse::kIdx).Size(),
-               outputs[0].aux_shape(rowsparse::kIdx).Size());
+    if (IsRetainUpdate(inputs, outputs)) {
+      NDArray out = outputs[0];
+      SparseRetainUpdateRspImpl<cpu, OP>(ctx.get_stream<cpu>(), inputs[0], inputs[1], req[0],
+                                         &out);
     } else {
       ScatterWrap<cpu>(attrs, ctx, inputs, req,
                        outputs, true, [input0_stype, input1_stype](const nnvm::NodeAttrs &attrs,
@@ -213,7 +216,7 @@ class ElemwiseScatterBinaryOp : public ElemwiseBinaryOp,
   }
 
 #ifdef __CUDACC__
-  /*! \brief GPU version, fallback op + retain */
+  /*! \brief GPU version, fused retain and update, otherwise fallback op + retain */
   template<typename OP>
   static void ComputeEx_(mshadow::Stream<gpu> *stream,
                          const nnvm::NodeAttrs &attrs,
@@ -221,6 +224,12 @@ class ElemwiseScatterBinaryOp : public ElemwiseBinaryOp,
                          const std::vector<NDArray> &inputs,
                          const std::vector<OpReqType> &req,
                          const std::vector<NDArray> &outputs) {
+    if (IsRetainUpdate(inputs, outputs)) {
+      NDArray out = outputs[0];
+      SparseRetainUpdateRspImpl<gpu, OP>(ctx.get_stream<gpu>(), inputs[0], inputs[1], req[0],
+                                         &out);
+      return;
+    }
     ScatterWrap<gpu>(attrs, ctx, inputs, req,
                      outputs, false, [](const nnvm::NodeAttrs &attrs,
                                         const OpContext &ctx,
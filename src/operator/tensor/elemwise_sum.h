@@ -27,6 +27,7 @@
 #define MXNET_OPERATOR_TENSOR_ELEMWISE_SUM_H_
 
 #include <dmlc/logging.h>
+#include <algorithm>
 #include <cstring>
 #include <vector>
 #include "../operator_common.h"
@@ -37,68 +38,138 @@
 namespace mxnet {
 namespace op {
 
-struct Sum {
+/*! \brief maximal number of inputs one pass of the elementwise sum kernels reads */
+const int kElemwiseSumMaxInputs = 16;
+/*! \brief number of elements a cpu thread sums at once, small enough for the output to stay
+ *  in L1 while every input streams through once */
+const int kElemwiseSumBlock = 2048;
+
+/*! \brief input pointers of one pass, passed by value to the kernels */
+template<typename DType>
+struct ElemwiseSumInputs {
+  const DType* dptr[kElemwiseSumMaxInputs];
+};
+
+/*!
+ * \brief Sum of N inputs in one pass over memory, one element per thread on gpu.
+ *  The loop over the inputs is unrolled so their loads are in flight together.
+ */
+template<int N>
+struct SumN {
   template<typename DType>
-  MSHADOW_XINLINE static DType sum(int i, const DType* a) {
-    return a[i];
+  MSHADOW_XINLINE static void Map(int i, DType* out, const OpReqType req,
+                                  const ElemwiseSumInputs<DType> ins) {
+    DType sum = ins.dptr[0][i];
+    #pragma unroll
+    for (int k = 1; k < N; ++k) sum += ins.dptr[k][i];
+    KERNEL_ASSIGN(out[i], req, sum);
   }
-  template<typename DType, typename... DTypes>
-  MSHADOW_XINLINE static DType sum(int i, const DType* a, const DTypes... b) {
-    return a[i] + sum(i, b...);
+};
+
+/*!
+ * \brief Sum of up to kElemwiseSumMaxInputs inputs over block i of kElemwiseSumBlock elements,
+ *  used on cpu. Each input is added with a contiguous loop the compiler vectorizes, into a
+ *  block of the output that stays in cache, so each input is still read once. out may be
+ *  the first input.
+ */
+struct SumBlock {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, DType* out, const OpReqType req,
+                                  const ElemwiseSumInputs<DType> ins, const int num_inputs,
+                                  const index_t size) {
+    const index_t begin = static_cast<index_t>(i) * kElemwiseSumBlock;
+    const index_t end = begin + kElemwiseSumBlock < size ? begin + kElemwiseSumBlock : size;
+    DType* o = out;
+    int k = 0;
+    if (req != kAddTo) {
+      const DType* in0 = ins.dptr[0];
+      if (num_inputs == 1) {
+        for (index_t j = begin; j < end; ++j) o[j] = in0[j];
+        return;
+      }
+      const DType* in1 = ins.dptr[1];
+      for (index_t j = begin; j < end; ++j) o[j] = in0[j] + in1[j];
+      k = 2;
+    }
+    for (; k < num_inputs; ++k) {
+      const DType* in = ins.dptr[k];
+      for (index_t j = begin; j < end; ++j) o[j] += in[j];
+    }
   }
-  template<typename DType, typename... DTypes>
-  MSHADOW_XINLINE static void Map(int i, DType* out, const OpReqType req, const DType* in0,
-    const DTypes... ins) {
-    KERNEL_ASSIGN(out[i], req, sum(i, in0, ins...));
+};
+
+#ifdef __CUDACC__
+/*! \brief launches SumN for the number of inputs n, N being the largest supported */
+template<int N>
+struct SumNLauncher {
+  template<typename DType>
+  static void Launch(mshadow::Stream<gpu>* s, const int n, const index_t size, DType* out,
+                     const OpReqType req, const ElemwiseSumInputs<DType>& ins) {
+    if (n == N) {
+      mxnet_op::Kernel<SumN<N>, gpu>::Launch(s, size, out, req, ins);
+    } else {
+      SumNLauncher<N - 1>::Launch(s, n, size, out, req, ins);
+    }
+  }
+};
+
+template<>
+struct SumNLauncher<0> {
+  template<typename DType>
+  static void Launch(mshadow::Stream<gpu>* s, const int n, const index_t size, DType* out,
+                     const OpReqType req, const ElemwiseSumInputs<DType>& ins) {
+    LOG(FATAL) << "SumN does not support " << n << " inputs";
   }
 };
 
+#endif  // __CUDACC__
+
+template<typename DType>
+inline void ElemwiseSumPass(mshadow::Stream<cpu>* s, const int n, const index_t size,
+                            DType* out, const OpReqType req, const ElemwiseSumInputs<DType>& ins) {
+  const index_t num_blocks = (size + kElemwiseSumBlock - 1) / kElemwiseSumBlock;
+  mxnet_op::Kernel<SumBlock, cpu>::Launch(s, num_blocks, out, req, ins, n, size);
+}
+
+#ifdef __CUDACC__
+template<typename DType>
+inline void ElemwiseSumPass(mshadow::Stream<gpu>* s, const int n, const index_t size,
+                            DType* out, const OpReqType req, const ElemwiseSumInputs<DType>& ins) {
+  SumNLauncher<kElemwiseSumMaxInputs>::Launch(s, n, size, out, req, ins);
+}
+#endif  // __CUDACC__
+
+/*!
+ * \brief out = sum of inputs, or out += sum of inputs for kAddTo, over size elements.
+ *  Up to kElemwiseSumMaxInputs inputs are read in a single pass, more inputs are added
+ *  in further passes of as many. out may be inputs[0].
+ */
+template<typename xpu, typename DType>
+void ElemwiseSumLaunch(mshadow::Stream<xpu>* s, const std::vector<const DType*>& inputs,
+                       DType* out, const OpReqType req, const index_t size) {
+  CHECK(!inputs.empty());
+  if (req == kNullOp || size == 0) return;
+  for (size_t begin = 0; begin < inputs.size(); begin += kElemwiseSumMaxInputs) {
+    const int n = std::min(inputs.size() - begin, static_cast<size_t>(kElemwiseSumMaxInputs));
+    ElemwiseSumInputs<DType> ins;
+    for (int k = 0; k < n; ++k) ins.dptr[k] = inputs[begin + k];
+    ElemwiseSumPass(s, n, size, out, begin == 0 ? req : kAddTo, ins);
+  }
+}
+
 template<typename xpu, typename DType>
 void ElementWiseSumCompute_(const nnvm::NodeAttrs& attrs,
                             const OpContext& ctx,
                             const std::vector<TBlob>& in_data,
                             const std::vector<OpReqType>& req,
                             const std::vector<TBlob>& out_data) {
-  using namespace mxnet_op;
   if (req[0] == kNullOp) return;
-  size_t size = in_data.size();
   Stream<xpu> *s = ctx.get_stream<xpu>();
-  DType* out_dptr = out_data[0].dptr<DType>();
-  int out_size = static_cast<int>((out_data[0].Size() + DataType<DType>::kLanes - 1)
-                                  /DataType<DType>::kLanes);
-  switch (size) {
-    case 2: {
-      DType* in_0_dptr = in_data[0].dptr<DType>();
-      DType* in_1_dptr = in_data[1].dptr<DType>();
-      Kernel<Sum, xpu>::Launch(s, out_size, out_dptr, req[0], in_0_dptr, in_1_dptr);
-      break;
-    }
-    case 3: {
-      DType* in_0_dptr = in_data[0].dptr<DType>();
-      DType* in_1_dptr = in_data[1].dptr<DType>();
-      DType* in_2_dptr = in_data[2].dptr<DType>();
-      Kernel<Sum, xpu>::Launch(s, out_size, out_dptr, req[0], in_0_dptr, in_1_dptr, in_2_dptr);
-      break;
-    }
-    case 4: {
-      DType* in_0_dptr = in_data[0].dptr<DType>();
-      DType* in_1_dptr = in_data[1].dptr<DType>();
-      DType* in_2_dptr = in_data[2].dptr<DType>();
-      DType* in_3_dptr = in_data[3].dptr<DType>();
-      Kernel<Sum, xpu>::Launch(s, out_size, out_dptr, req[0], in_0_dptr, in_1_dptr, in_2_dptr,
-        in_3_dptr);
-      break;
-    }
-    default: {
-      DType* in_0_dptr = in_data[0].dptr<DType>();
-      Kernel<Sum, xpu>::Launch(s, out_size, out_dptr, req[0], in_0_dptr);
-      for (size_t i = 1; i < size; ++i) {
-        DType* in_dptr = in_data[i].dptr<DType>();
-        Kernel<Sum, xpu>::Launch(s, out_size, out_dptr, req[0], out_dptr, in_dptr);
-      }
-      break;
-    }
-  }
+  std::vector<const DType*> inputs(in_data.size());
+  for (size_t i = 0; i < in_data.size(); ++i) inputs[i] = in_data[i].dptr<DType>();
+  const index_t out_size = (out_data[0].Size() + DataType<DType>::kLanes - 1)
+                           / DataType<DType>::kLanes;
+  ElemwiseSumLaunch(s, inputs, out_data[0].dptr<DType>(), req[0], out_size);
 }
 
 template<typename xpu>
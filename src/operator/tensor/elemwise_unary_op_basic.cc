@@ -210,6 +210,28 @@ NNVM_REGISTER_OP(_backward_copy)
     return std::vector<bool>{true};
   });
 
+#if MXNET_USE_MKLDNN == 1
+// Unlike _copy, the output never shares the memory of the input, so it always
+// holds the data in the default layout.
+NNVM_REGISTER_OP(_mkldnn_reorder2default)
+.describe(R"code(Returns a copy of the input in the default layout.
+
+Inserted by the executor where an array in an MKLDNN layout is read by operators
+that need the default layout, so the data is reordered once for all of them.
+)code" ADD_FILELINE)
+.set_num_inputs(1)
+.set_num_outputs(1)
+.set_attr<nnvm::FInferShape>("FInferShape", ElemwiseShape<1, 1>)
+.set_attr<nnvm::FInferType>("FInferType", ElemwiseType<1, 1>)
+.set_attr<FInferStorageType>("FInferStorageType", CopyStorageType)
+.set_attr<FCompute>("FCompute<cpu>", UnaryOp::IdentityCompute<cpu>)
+.set_attr<FComputeEx>("FComputeEx<cpu>", CopyEx)
+.set_attr<FResourceRequest>("FResourceRequest", [](const NodeAttrs& n) {
+  return std::vector<ResourceRequest>{ResourceRequest::kTempSpace};
+})
+.add_argument("data", "NDArray-or-Symbol", "The input array.");
+#endif
+
 MXNET_OPERATOR_REGISTER_UNARY(BlockGrad)
 MXNET_ADD_SPARSE_OP_ALIAS(stop_gradient)
 .add_alias("stop_gradient")
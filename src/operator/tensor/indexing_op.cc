@@ -85,53 +85,56 @@ inline void SparseEmbeddingOpBackwardRspImpl<cpu>(const SparseEmbeddingParam& pa
   CHECK_EQ(req, kWriteTo) << "SparseEmbedding layer doesn't support "
                           << "weight gradient calculation with req != write";
 
-  // Request temporary storage for marking non-zero rows and prefix sum
+  // Sort the ids with their positions in data. The runs of the same id are the rows
+  // of the gradient, which are summed up by one thread each without marking the
+  // rows of the whole weight
   Stream<cpu> *s = ctx.get_stream<cpu>();
   dim_t num_rows = output.shape()[0];
   dim_t row_length = output.shape()[1];
-  size_t workspace_size = num_rows * sizeof(dim_t);
+  dim_t data_size = static_cast<dim_t>(data.shape_.Size());
+  if (data_size == 0) {
+    FillZerosRspImpl(s, output);
+    return;
+  }
+  size_t workspace_size = (3 * data_size + 1) * sizeof(dim_t);
   Tensor<cpu, 1, char> workspace =
     ctx.requested[embedding::kTempSpace].get_space_typed<cpu, 1, char>(
       Shape1(workspace_size), s);
-  dim_t* row_flg = reinterpret_cast<dim_t*>(workspace.dptr_);
-  // prefix sum array re-uses the row_flg array temp space
-  dim_t* prefix_sum = row_flg;
-  dim_t data_size = static_cast<dim_t>(data.shape_.Size());
+  dim_t* sorted_data = reinterpret_cast<dim_t*>(workspace.dptr_);
+  dim_t* original_index = sorted_data + data_size;
+  // start of the run of every row, followed by data_size
+  dim_t* segment_start = original_index + data_size;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
 
   MSHADOW_TYPE_SWITCH(data.type_flag_, IType, {
     MSHADOW_SGL_DBL_TYPE_SWITCH(ograd.type_flag_, DType, {
       MSHADOW_IDX_TYPE_SWITCH(output.aux_type(kIdx), RType, {
-        // mark row flags
-        Fill<false>(s, TBlob(row_flg, Shape1(num_rows), cpu::kDevMask), kWriteTo, 0);
-        Kernel<MarkRowFlgKernel, cpu>::Launch(s, data_size, row_flg, data.dptr<IType>());
-        // calculate inclusive prefix sum
-        // TODO(haibin) ideally this is should be done in parallel
-        prefix_sum[0] = row_flg[0];
-        for (dim_t i = 1; i < num_rows; i++) {
-          prefix_sum[i] = prefix_sum[i - 1] + row_flg[i];
-        }
-        // total number of non-zero rows
-        dim_t nnr = prefix_sum[num_rows - 1];
-        if (nnr == 0) {
-          FillZerosRspImpl(s, output);
-          return;
+        Kernel<tcast_clip, cpu>::Launch(s, data_size, sorted_data, data.dptr<IType>(),
+                                        num_rows);
+        Kernel<range_fwd, cpu>::Launch(s, data_size, 1, dim_t(0), dim_t(1), kWriteTo,
+                                       original_index);
+        SortByKey(Tensor<cpu, 1, dim_t>(sorted_data, Shape1(data_size), s),
+                  Tensor<cpu, 1, dim_t>(original_index, Shape1(data_size), s),
+                  true, nullptr, 0, ilog2(num_rows - 1));
+        dim_t nnr = 0;
+        for (dim_t i = 0; i < data_size; ++i) {
+          if (i == 0 || sorted_data[i] != sorted_data[i - 1]) segment_start[nnr++] = i;
         }
+        segment_start[nnr] = data_size;
         output.CheckAndAlloc({Shape1(nnr)});
         RType* grad_row_idx = output.aux_data(kIdx).dptr<RType>();
-        // fill row_idx array of output matrix, using the row_flg values
-        Kernel<FillRspRowIdxKernel, cpu>::Launch(s, num_rows,
-            grad_row_idx, prefix_sum, num_rows);
-        // prefill with zeros
         DType* grad_data = output.data().dptr<DType>();
-        Fill<false>(s, TBlob(grad_data, Shape1(nnr * row_length),
-            cpu::kDevMask), kWriteTo, 0);
-        // add the final gradients
-        const int num_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
-        dim_t segment_len = (nnr + num_threads - 1) / num_threads;
-        Kernel<AddTakeGradRspKernel, cpu>::Launch(s, num_threads, grad_data, prefix_sum,
-                                                  ograd.dptr<DType>(), row_length,
-                                                  data.dptr<IType>(), data_size, segment_len,
-                                                  num_rows);
+        const DType* ograd_data = ograd.dptr<DType>();
+        #pragma omp parallel for num_threads(omp_threads)
+        for (dim_t r = 0; r < nnr; ++r) {
+          grad_row_idx[r] = static_cast<RType>(sorted_data[segment_start[r]]);
+          DType* out = grad_data + r * row_length;
+          std::fill(out, out + row_length, DType(0));
+          for (dim_t k = segment_start[r]; k < segment_start[r + 1]; ++k) {
+            const DType* in = ograd_data + original_index[k] * row_length;
+            for (dim_t j = 0; j < row_length; ++j) out[j] += in[j];
+          }
+        }
       });
     });
   });
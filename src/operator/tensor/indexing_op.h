@@ -116,6 +116,8 @@ AddTakeGradLargeBatchWorkspaceSize(size_t num_keys);
  * \brief CPU/GPU: Gradient accumulate of embedding matrix.
                    dst[sorted[i]] += src[index[i]]
                    Called when the batchsize of src is larger than the featuredim
+                   On CPU the sorted indices are split between the threads at the
+                   runs of the same index, so that every row is written by one thread.
  * \param dst destination
  * \param sorted the sorted indices
  * \param index original index of the sorted indices
@@ -128,8 +130,21 @@ inline void AddTakeGradLargeBatch(mshadow::Tensor<cpu, 2, DType> dst,
                                   const mshadow::Tensor<cpu, 1, IndexType>& index,
                                   const mshadow::Tensor<cpu, 2, DType> &src,
                                   mshadow::Tensor<cpu, 1, char>* workspace = NULL) {
-  for (index_t y = 0; y < sorted.size(0); ++y) {
-    dst[sorted[y]] += src[index[y]];
+  const index_t num_keys = sorted.size(0), row_length = dst.size(1);
+  const int num_threads = std::max(1, std::min(
+    engine::OpenMP::Get()->GetRecommendedOMPThreadCount(), static_cast<int>(num_keys)));
+  #pragma omp parallel for num_threads(num_threads)
+  for (int t = 0; t < num_threads; ++t) {
+    index_t begin = static_cast<uint64_t>(num_keys) * t / num_threads;
+    index_t end = static_cast<uint64_t>(num_keys) * (t + 1) / num_threads;
+    // a run of the same index belongs to the thread it starts in
+    while (begin > 0 && begin < num_keys && sorted[begin] == sorted[begin - 1]) ++begin;
+    while (end > 0 && end < num_keys && sorted[end] == sorted[end - 1]) ++end;
+    for (index_t y = begin; y < end; ++y) {
+      DType* out = dst.dptr_ + static_cast<size_t>(sorted[y]) * dst.stride_;
+      const DType* in = src.dptr_ + static_cast<size_t>(index[y]) * src.stride_;
+      for (index_t j = 0; j < row_length; ++j) out[j] += in[j];
+    }
   }
 }
 /*!
@@ -541,48 +556,6 @@ void EmbeddingOpBackward(const nnvm::NodeAttrs& attrs,
   });
 }
 
-struct AddTakeGradRspKernel {
-  /*!
-   * \brief Each thread i is responsible for row slices in [segment_start, segment_end)
-            of the result gradient
-   * \param tid             global thread id
-   * \param grad            the gradient to calculate
-   * \param prefix_sum      the inclusive prefix sum of row ids of the gradient
-   * \param ograd           output gradient
-   * \param row_length      the length of the row slices of the gradient
-   * \param data_val        the values of input data
-   * \param data_size       number of values of input data
-   * \param segment_length  the length of row segment to process for each thread
-   * \param nnr             total number of non-zero rows of result gradient
-   */
-  template<typename DType, typename IType>
-  MSHADOW_CINLINE static void Map(int tid,
-                                  DType* grad,
-                                  const nnvm::dim_t* prefix_sum,
-                                  const DType* ograd,
-                                  const nnvm::dim_t row_length,
-                                  const IType* data_val,
-                                  const nnvm::dim_t data_size,
-                                  const nnvm::dim_t segment_length,
-                                  const nnvm::dim_t nnr) {
-    using nnvm::dim_t;
-    dim_t segment_start = tid * segment_length;
-    dim_t segment_end = std::min(nnr, segment_start + segment_length);
-    // scan all data
-    for (dim_t data_i = 0; data_i < data_size; data_i++) {
-      dim_t data = static_cast<dim_t>(data_val[data_i]);
-      dim_t grad_row_id = prefix_sum[data] - 1;
-      if (grad_row_id < segment_start || grad_row_id >= segment_end) continue;
-      // no projection is performed
-      dim_t ograd_i = data_i * row_length;
-      dim_t grad_i = grad_row_id * row_length;
-      for (dim_t offset = 0; offset < row_length; offset++) {
-        grad[grad_i + offset] += ograd[ograd_i + offset];
-      }
-    }
-  }
-};
-
 template<typename xpu>
 inline void SparseEmbeddingOpBackwardRspImpl(const SparseEmbeddingParam& param,
                                              const OpContext& ctx,
@@ -37,6 +37,7 @@
 #include "broadcast_reduce_op.h"
 #include "./init_op.h"
 #include "../../common/static_array.h"
+#include "./transpose-inl.h"
 
 #if MXNET_USE_CUDA
 #include <thrust/device_vector.h>
@@ -224,6 +225,13 @@ void TransposeImpl(RunContext ctx,
   using namespace mshadow::expr;
   CHECK_EQ(src.type_flag_, ret.type_flag_);
   Stream<xpu> *s = ctx.get_stream<xpu>();
+  transpose::BatchedShape batched;
+  if (axes.ndim() > 0 && transpose::AsBatched(src.shape_, axes, &batched)) {
+    MSHADOW_TYPE_SWITCH(ret.type_flag_, DType, {
+      transpose::BatchedTranspose(s, src.dptr<DType>(), ret.dptr<DType>(), batched);
+    });
+    return;
+  }
   MSHADOW_TYPE_SWITCH(ret.type_flag_, DType, {
     switch (axes.ndim()) {
      case 0:
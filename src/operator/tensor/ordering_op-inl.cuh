@@ -0,0 +1,191 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ *  Copyright (c) 2018 by Contributors
+ * \file ordering_op-inl.cuh
+ * \brief CUDA radix select of the first k elements of every row for topk
+ *
+ *  Every element gets a 64 bit rank key, the order preserving bits of its
+ *  value, flipped for descending order, above its index in the row. The keys
+ *  are unique and smaller keys come first, so the k-th smallest key per row
+ *  is found exactly by 8 passes of an 8 bit radix histogram, and the elements
+ *  with keys up to it are the first k of a stable sort.
+ */
+#ifndef MXNET_OPERATOR_TENSOR_ORDERING_OP_INL_CUH_
+#define MXNET_OPERATOR_TENSOR_ORDERING_OP_INL_CUH_
+
+#include <algorithm>
+#include <cstdint>
+
+namespace mxnet {
+namespace op {
+namespace topk_select {
+
+const int kRadixBits = 8;
+const int kRadixSize = 1 << kRadixBits;
+const int kBlockSize = 256;
+/*! \brief most elements of a row one thread of the histogram kernels visits */
+const int kItemsPerThread = 16;
+
+__device__ __forceinline__ uint64_t RankKey(real_t value, int index, bool is_ascend) {
+  // -0 and 0 compare equal, so they share the bits of 0
+  uint32_t bits = value == 0 ? 0u : __float_as_uint(value);
+  bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+  if (!is_ascend) bits = ~bits;
+  return (static_cast<uint64_t>(bits) << 32) | static_cast<uint32_t>(index);
+}
+
+__global__ void RadixSelectInitKernel(int batch_size, int k, uint64_t* prefix,
+                                      int* remaining, int* count, int* hist) {
+  const int row = blockIdx.x * blockDim.x + threadIdx.x;
+  if (row >= batch_size) return;
+  prefix[row] = 0;
+  remaining[row] = k;
+  count[row] = 0;
+  for (int d = 0; d < kRadixSize; ++d) hist[row * kRadixSize + d] = 0;
+}
+
+/*! \brief histogram of the digit at shift of the keys that match the prefix found so far */
+__global__ void RadixHistogramKernel(const real_t* dat, int batch_size, int element_num,
+                                     bool is_ascend, int shift, const uint64_t* prefix,
+                                     int* hist) {
+  __shared__ int local[kRadixSize];
+  const uint64_t mask = shift + kRadixBits >= 64 ? 0 : (~0ULL << (shift + kRadixBits));
+  for (int row = blockIdx.y; row < batch_size; row += gridDim.y) {
+    for (int d = threadIdx.x; d < kRadixSize; d += blockDim.x) local[d] = 0;
+    __syncthreads();
+    const real_t* row_dat = dat + static_cast<size_t>(row) * element_num;
+    const uint64_t row_prefix = prefix[row];
+    for (int j = blockIdx.x * blockDim.x + threadIdx.x; j < element_num;
+         j += gridDim.x * blockDim.x) {
+      const uint64_t key = RankKey(row_dat[j], j, is_ascend);
+      if ((key & mask) == row_prefix) {
+        atomicAdd(&local[(key >> shift) & (kRadixSize - 1)], 1);
+      }
+    }
+    __syncthreads();
+    for (int d = threadIdx.x; d < kRadixSize; d += blockDim.x) {
+      if (local[d] != 0) atomicAdd(&hist[row * kRadixSize + d], local[d]);
+    }
+    __syncthreads();
+  }
+}
+
+/*! \brief the digit at shift of the k-th key of every row, and the histogram is cleared */
+__global__ void RadixPickKernel(int batch_size, int shift, uint64_t* prefix,
+                                int* remaining, int* hist) {
+  const int row = blockIdx.x * blockDim.x + threadIdx.x;
+  if (row >= batch_size) return;
+  int* row_hist = hist + row * kRadixSize;
+  int left = remaining[row];
+  bool found = false;
+  for (int d = 0; d < kRadixSize; ++d) {
+    if (!found) {
+      if (row_hist[d] >= left) {
+        prefix[row] |= static_cast<uint64_t>(d) << shift;
+        found = true;
+      } else {
+        left -= row_hist[d];
+      }
+    }
+    row_hist[d] = 0;
+  }
+  remaining[row] = left;
+}
+
+/*! \brief copies the elements with keys up to the k-th one, in no particular order */
+__global__ void RadixGatherKernel(const real_t* dat, int batch_size, int element_num, int k,
+                                  bool is_ascend, const uint64_t* kth, int* count,
+                                  real_t* sel_dat, int* sel_idx) {
+  for (int row = blockIdx.y; row < batch_size; row += gridDim.y) {
+    const real_t* row_dat = dat + static_cast<size_t>(row) * element_num;
+    const uint64_t row_kth = kth[row];
+    for (int j = blockIdx.x * blockDim.x + threadIdx.x; j < element_num;
+         j += gridDim.x * blockDim.x) {
+      const real_t value = row_dat[j];
+      if (RankKey(value, j, is_ascend) <= row_kth) {
+        const int pos = row * k + atomicAdd(&count[row], 1);
+        sel_dat[pos] = value;
+        sel_idx[pos] = row * element_num + j;
+      }
+    }
+  }
+}
+
+}  // namespace topk_select
+
+template<typename xpu>
+inline typename std::enable_if<std::is_same<xpu, gpu>::value, size_t>::type
+TopKSelectWorkspaceSize(int batch_size, int k) {
+  using namespace topk_select;
+  // with room to align the keys of the workspace
+  return sizeof(uint64_t) + static_cast<size_t>(batch_size) *
+         (sizeof(uint64_t) + (kRadixSize + 2 + k) * sizeof(int));
+}
+
+inline void TopKSelect(mshadow::Tensor<gpu, 1, real_t> dat, int batch_size, int element_num,
+                       int k, bool is_ascend, mshadow::Tensor<gpu, 1, real_t> sel_dat,
+                       mshadow::Tensor<gpu, 1, int> sel_idx,
+                       mshadow::Tensor<gpu, 1, char> workspace,
+                       mshadow::Tensor<gpu, 1, char>* sort_workspace) {
+  using namespace topk_select;
+  using namespace mshadow;
+  Stream<gpu>* s = dat.stream_;
+  cudaStream_t stream = Stream<gpu>::GetStream(s);
+  CHECK_GE(workspace.size(0), TopKSelectWorkspaceSize<gpu>(batch_size, k));
+  const size_t offset = reinterpret_cast<uintptr_t>(workspace.dptr_) % sizeof(uint64_t);
+  uint64_t* prefix = reinterpret_cast<uint64_t*>(
+      workspace.dptr_ + (offset == 0 ? 0 : sizeof(uint64_t) - offset));
+  int* remaining = reinterpret_cast<int*>(prefix + batch_size);
+  int* count = remaining + batch_size;
+  int* hist = count + batch_size;
+  int* batch_id_ptr = hist + batch_size * kRadixSize;
+  const int row_blocks = (batch_size + kBlockSize - 1) / kBlockSize;
+  const dim3 grid(std::min(64, std::max(1, element_num / (kBlockSize * kItemsPerThread))),
+                  std::min(batch_size, 65535));
+  RadixSelectInitKernel<<<row_blocks, kBlockSize, 0, stream>>>(batch_size, k, prefix,
+                                                                remaining, count, hist);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(RadixSelectInitKernel);
+  for (int shift = 64 - kRadixBits; shift >= 0; shift -= kRadixBits) {
+    RadixHistogramKernel<<<grid, kBlockSize, 0, stream>>>(dat.dptr_, batch_size, element_num,
+                                                          is_ascend, shift, prefix, hist);
+    MSHADOW_CUDA_POST_KERNEL_CHECK(RadixHistogramKernel);
+    RadixPickKernel<<<row_blocks, kBlockSize, 0, stream>>>(batch_size, shift, prefix,
+                                                           remaining, hist);
+    MSHADOW_CUDA_POST_KERNEL_CHECK(RadixPickKernel);
+  }
+  RadixGatherKernel<<<grid, kBlockSize, 0, stream>>>(dat.dptr_, batch_size, element_num, k,
+                                                     is_ascend, prefix, count,
+                                                     sel_dat.dptr_, sel_idx.dptr_);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(RadixGatherKernel);
+  // the gathered elements by index, then stable by value, then stable by row
+  Tensor<gpu, 1, int> batch_id(batch_id_ptr, Shape1(batch_size * k), s);
+  SortByKey(sel_idx, sel_dat, true, sort_workspace);
+  SortByKey(sel_dat, sel_idx, is_ascend, sort_workspace);
+  batch_id = sel_idx / element_num;
+  SortByKey(batch_id, sel_dat, true, sort_workspace);
+  batch_id = sel_idx / element_num;
+  SortByKey(batch_id, sel_idx, true, sort_workspace);
+}
+
+}  // namespace op
+}  // namespace mxnet
+
+#endif  // MXNET_OPERATOR_TENSOR_ORDERING_OP_INL_CUH_
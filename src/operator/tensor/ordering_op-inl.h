@@ -29,8 +29,10 @@
 #include <dmlc/optional.h>
 #include <mshadow/tensor.h>
 #include <algorithm>
+#include <numeric>
 #include <vector>
 #include <type_traits>
+#include "../../engine/openmp.h"
 #include "../mshadow_op.h"
 #include "../elemwise_op_common.h"
 #include "./sort_op.h"
@@ -152,6 +154,68 @@ inline void ParseTopKParam(const TShape& src_shape, const TopKParam& param, TSha
                                       << *element_num << ", get k = " << *k;
 }
 
+/*!
+ * \brief whether topk selects the first k elements of every row instead of
+ *  sorting the whole rows, which pays off once k is a small part of a row
+ */
+inline bool TopKUseSelection(int k, int element_num) {
+  return element_num >= 1024 && k <= element_num / 16;
+}
+
+/*!
+ * \brief CPU/GPU: Return the temporary bytes TopKSelect needs besides its outputs
+ * \param batch_size number of rows
+ * \param k number of selected elements per row
+ */
+template<typename xpu>
+inline typename std::enable_if<std::is_same<xpu, cpu>::value, size_t>::type
+TopKSelectWorkspaceSize(int batch_size, int k) {
+  return 0;
+}
+
+template<typename xpu>
+inline typename std::enable_if<std::is_same<xpu, gpu>::value, size_t>::type
+TopKSelectWorkspaceSize(int batch_size, int k);
+
+/*!
+ * \brief CPU/GPU: Select the first k elements of every row in the order of a stable sort
+ * \param dat batch_size rows of element_num values
+ * \param sel_dat output, the k selected values of every row
+ * \param sel_idx output, the indices of the selected values in dat
+ * \param workspace TopKSelectWorkspaceSize bytes
+ * \param sort_workspace workspace of SortByKey over batch_size * k keys
+ */
+inline void TopKSelect(mshadow::Tensor<cpu, 1, real_t> dat, int batch_size, int element_num,
+                       int k, bool is_ascend, mshadow::Tensor<cpu, 1, real_t> sel_dat,
+                       mshadow::Tensor<cpu, 1, int> sel_idx,
+                       mshadow::Tensor<cpu, 1, char> workspace,
+                       mshadow::Tensor<cpu, 1, char>* sort_workspace) {
+  const real_t* data = dat.dptr_;
+  // nth_element then a sort of the k first, ties ordered by index as by stable sort
+  #pragma omp parallel for num_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount())
+  for (int b = 0; b < batch_size; ++b) {
+    const real_t* row = data + static_cast<size_t>(b) * element_num;
+    std::vector<int> idx(element_num);
+    std::iota(idx.begin(), idx.end(), 0);
+    auto before = [row, is_ascend](int i, int j) {
+      if (row[i] != row[j]) return is_ascend ? row[i] < row[j] : row[i] > row[j];
+      return i < j;
+    };
+    std::nth_element(idx.begin(), idx.begin() + (k - 1), idx.end(), before);
+    std::sort(idx.begin(), idx.begin() + k, before);
+    for (int j = 0; j < k; ++j) {
+      sel_dat.dptr_[b * k + j] = row[idx[j]];
+      sel_idx.dptr_[b * k + j] = b * element_num + idx[j];
+    }
+  }
+}
+
+inline void TopKSelect(mshadow::Tensor<gpu, 1, real_t> dat, int batch_size, int element_num,
+                       int k, bool is_ascend, mshadow::Tensor<gpu, 1, real_t> sel_dat,
+                       mshadow::Tensor<gpu, 1, int> sel_idx,
+                       mshadow::Tensor<gpu, 1, char> workspace,
+                       mshadow::Tensor<gpu, 1, char>* sort_workspace);
+
 /*!
    * \brief Implementation of the TopK operation
    *
@@ -194,7 +258,12 @@ void TopKImpl(RunContext ctx,
   size_t temp_size = mxnet::op::SortByKeyWorkspaceSize<int, int, xpu>(src.Size());
   temp_size = std::max(temp_size, mxnet::op::SortByKeyWorkspaceSize<int, real_t, xpu>(src.Size()));
   temp_size = std::max(temp_size, mxnet::op::SortByKeyWorkspaceSize<real_t, int, xpu>(src.Size()));
+  const bool use_selection = TopKUseSelection(k, element_num);
   size_t workspace_size = temp_size + sizeof(real_t) * src.Size() + sizeof(int) * src.Size() * 2;
+  if (use_selection) {
+    workspace_size += (sizeof(real_t) + sizeof(int)) * batch_size * k +
+                      TopKSelectWorkspaceSize<xpu>(batch_size, k);
+  }
   if (param.ret_typ == topk_enum::kReturnMask) {
     workspace_size += sizeof(int) * batch_size * k + sizeof(real_t) * batch_size * k;
   }
@@ -214,9 +283,6 @@ void TopKImpl(RunContext ctx,
   } else {
     sorted_dat = reshape(dat, Shape1(src.Size()));
   }
-  mxnet_op::Kernel<range_fwd, xpu>::Launch(s, batch_size * element_num, 1, 0, 1,
-    kWriteTo, indices.dptr_);
-
   CHECK_EQ(sorted_dat.CheckContiguous(), true);
   CHECK_EQ(indices.CheckContiguous(), true);
   if (param.ret_typ == topk_enum::kReturnMask) {
@@ -232,19 +298,44 @@ void TopKImpl(RunContext ctx,
   }
   temp_workspace = Tensor<xpu, 1, char>(workspace_curr_ptr, Shape1(temp_size), s);  // temp space
   workspace_curr_ptr += temp_size;
-  // 2. Perform inplace batch sort using the `SortByKey` in MShadow
-  // After sorting, each batch in `sorted_dat` will be sorted in the corresponding order
-  //   and the `indices` will contain the corresponding index in `sorted_dat`
-  // Sort the data and keep record of the correspondence to global indices.
-  mxnet::op::SortByKey(sorted_dat, indices, is_ascend, &temp_workspace);
-  // Calculate the corresponding batch indices of the elements
-  batch_id = indices / element_num;
-  // Since the SortByKey performs stable sort, the second SortByKey will reorder
-  //   the sorted_dat based on the order of the batch_id
-  mxnet::op::SortByKey(batch_id, sorted_dat, true, &temp_workspace);
-  // Reorder the indices
-  batch_id = indices / element_num;
-  mxnet::op::SortByKey(batch_id, indices, true, &temp_workspace);
+  // the length of the batches in `sorted_dat` and `indices`
+  int sorted_num = element_num;
+  if (use_selection) {
+    // 2. Select the first k elements of every batch, in the order the sort below gives
+    //   them, so only batch_size * k elements are left in `sorted_dat` and `indices`
+    Tensor<xpu, 1, real_t> sel_dat(reinterpret_cast<real_t*>(workspace_curr_ptr),
+                                   Shape1(batch_size * k), s);
+    workspace_curr_ptr += sizeof(real_t) * batch_size * k;
+    Tensor<xpu, 1, int> sel_idx(reinterpret_cast<int*>(workspace_curr_ptr),
+                                Shape1(batch_size * k), s);
+    workspace_curr_ptr += sizeof(int) * batch_size * k;
+    const size_t select_size = TopKSelectWorkspaceSize<xpu>(batch_size, k);
+    Tensor<xpu, 1, char> select_workspace(workspace_curr_ptr, Shape1(select_size), s);
+    workspace_curr_ptr += select_workspace.size(0);
+    TopKSelect(sorted_dat, batch_size, element_num, k, is_ascend, sel_dat, sel_idx,
+               select_workspace, &temp_workspace);
+    sorted_dat = sel_dat;
+    indices = sel_idx;
+    batch_id = Tensor<xpu, 1, int>(batch_id.dptr_, Shape1(batch_size * k), s);
+    batch_id = indices / element_num;
+    sorted_num = k;
+  } else {
+    mxnet_op::Kernel<range_fwd, xpu>::Launch(s, batch_size * element_num, 1, 0, 1,
+      kWriteTo, indices.dptr_);
+    // 2. Perform inplace batch sort using the `SortByKey` in MShadow
+    // After sorting, each batch in `sorted_dat` will be sorted in the corresponding order
+    //   and the `indices` will contain the corresponding index in `sorted_dat`
+    // Sort the data and keep record of the correspondence to global indices.
+    mxnet::op::SortByKey(sorted_dat, indices, is_ascend, &temp_workspace);
+    // Calculate the corresponding batch indices of the elements
+    batch_id = indices / element_num;
+    // Since the SortByKey performs stable sort, the second SortByKey will reorder
+    //   the sorted_dat based on the order of the batch_id
+    mxnet::op::SortByKey(batch_id, sorted_dat, true, &temp_workspace);
+    // Reorder the indices
+    batch_id = indices / element_num;
+    mxnet::op::SortByKey(batch_id, indices, true, &temp_workspace);
+  }
 
   // 3. Assign results to the ret blob
   if (param.ret_typ == topk_enum::kReturnMask) {
@@ -254,7 +345,7 @@ void TopKImpl(RunContext ctx,
     sel_indices = reshape(slice<1>(
                               inplace_reshape(indices,
                                               Shape2(batch_size,
-                                                     element_num)), 0, k),
+                                                     sorted_num)), 0, k),
                               Shape1(batch_size * k));
     if (do_transpose) {
       TShape src_shape = src.shape_.FlatTo3D(axis);
@@ -271,14 +362,14 @@ void TopKImpl(RunContext ctx,
                       slice<2>(inplace_reshape(indices,
                                                Shape3(ret_indices.shape_[0],
                                                       ret_indices.shape_[2],
-                                                      element_num)),
+                                                      sorted_num)),
                                0, k),
                       Shape3(0, 2, 1)));
     } else {
       Tensor<xpu, 2, real_t> ret_indices =
         ret[0].get_with_shape<xpu, 2, real_t>(Shape2(batch_size, k), s);
       ret_indices = tcast<real_t>(slice<1>(
-                      inplace_reshape(indices, Shape2(batch_size, element_num)), 0, k));
+                      inplace_reshape(indices, Shape2(batch_size, sorted_num)), 0, k));
     }
   } else {
     indices -= batch_id * element_num;
@@ -287,14 +378,14 @@ void TopKImpl(RunContext ctx,
       Tensor<xpu, 3, real_t> ret_indices = ret[1].FlatTo3D<xpu, real_t>(axis, axis, s);
       ret_value = transpose(
                    slice<2>(inplace_reshape(sorted_dat,
-                                    Shape3(ret_value.shape_[0], ret_value.shape_[2], element_num)),
+                                    Shape3(ret_value.shape_[0], ret_value.shape_[2], sorted_num)),
                             0, k),
                    Shape3(0, 2, 1));
       ret_indices = tcast<real_t>(transpose(
                       slice<2>(inplace_reshape(indices,
                                                Shape3(ret_indices.shape_[0],
                                                       ret_indices.shape_[2],
-                                                      element_num)),
+                                                      sorted_num)),
                                0, k),
                       Shape3(0, 2, 1)));
     } else {
@@ -302,9 +393,9 @@ void TopKImpl(RunContext ctx,
         ret[0].get_with_shape<xpu, 2, real_t>(Shape2(batch_size, k), s);
       Tensor<xpu, 2, real_t> ret_indices =
         ret[1].get_with_shape<xpu, 2, real_t>(Shape2(batch_size, k), s);
-      ret_value = slice<1>(inplace_reshape(sorted_dat, Shape2(batch_size, element_num)), 0, k);
+      ret_value = slice<1>(inplace_reshape(sorted_dat, Shape2(batch_size, sorted_num)), 0, k);
       ret_indices = tcast<real_t>(slice<1>(
-                      inplace_reshape(indices, Shape2(batch_size, element_num)), 0, k));
+                      inplace_reshape(indices, Shape2(batch_size, sorted_num)), 0, k));
     }
   }
 }
@@ -512,4 +603,7 @@ inline bool ArgSortShape(const nnvm::NodeAttrs& attrs,
 }
 }  // namespace op
 }  // namespace mxnet
+#ifdef __CUDACC__
+#include "./ordering_op-inl.cuh"
+#endif
 #endif  // MXNET_OPERATOR_TENSOR_ORDERING_OP_INL_H_
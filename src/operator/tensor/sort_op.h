@@ -27,13 +27,78 @@
 
 #include <dmlc/logging.h>
 #include <mshadow/tensor.h>
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <type_traits>
+#include "../../engine/openmp.h"
 
 namespace mxnet {
 namespace op {
+/*!
+ * \brief CPU: Stable LSD radix sort of key-value pairs, in parallel. Only the bits
+ *  [begin_bit, end_bit) of the keys are compared, the others have to be the same for all keys.
+ *  Every thread counts the digits of its chunk of the keys, so that it scatters them to the
+ *  positions the counts of all chunks before it leave free.
+ */
+template<typename KDType, typename VDType>
+inline void RadixSortByKey(KDType* keys, VDType* values, const index_t size,
+                           const int begin_bit, const int end_bit) {
+  const int kRadixBits = 8, kRadix = 1 << kRadixBits;
+  // the keys worth a chunk of their own
+  const index_t kMinChunk = 1 << 14;
+  const int nthreads = std::max(1, std::min(
+    engine::OpenMP::Get()->GetRecommendedOMPThreadCount(),
+    static_cast<int>(size / kMinChunk)));
+  std::vector<KDType> keys_tmp(size);
+  std::vector<VDType> values_tmp(size);
+  std::vector<index_t> offsets(nthreads * kRadix);
+  KDType* keys_in = keys, *keys_out = keys_tmp.data();
+  VDType* values_in = values, *values_out = values_tmp.data();
+  auto chunk = [size, nthreads](const int t) {
+    return static_cast<index_t>(static_cast<uint64_t>(size) * t / nthreads);
+  };
+  for (int bit = begin_bit; bit < end_bit; bit += kRadixBits) {
+    auto digit = [bit](const KDType key) {
+      return static_cast<int>((static_cast<uint64_t>(key) >> bit) & (kRadix - 1));
+    };
+    std::fill(offsets.begin(), offsets.end(), 0);
+    #pragma omp parallel for num_threads(nthreads)
+    for (int t = 0; t < nthreads; ++t) {
+      index_t* count = &offsets[t * kRadix];
+      for (index_t i = chunk(t); i < chunk(t + 1); ++i) {
+        ++count[digit(keys_in[i])];
+      }
+    }
+    index_t total = 0;
+    for (int d = 0; d < kRadix; ++d) {
+      for (int t = 0; t < nthreads; ++t) {
+        const index_t n = offsets[t * kRadix + d];
+        offsets[t * kRadix + d] = total;
+        total += n;
+      }
+    }
+    #pragma omp parallel for num_threads(nthreads)
+    for (int t = 0; t < nthreads; ++t) {
+      index_t* offset = &offsets[t * kRadix];
+      for (index_t i = chunk(t); i < chunk(t + 1); ++i) {
+        const index_t pos = offset[digit(keys_in[i])]++;
+        keys_out[pos] = keys_in[i];
+        values_out[pos] = values_in[i];
+      }
+    }
+    std::swap(keys_in, keys_out);
+    std::swap(values_in, values_out);
+  }
+  if (keys_in != keys) {
+    std::copy(keys_in, keys_in + size, keys);
+    std::copy(values_in, values_in + size, values);
+  }
+}
+
 /*!
  * \brief CPU/GPU: Sort key-value pairs stored in separate places. (Stable sort is performed!)
+ *  On CPU integer keys restricted to a range of bits are radix sorted in parallel.
  * \param keys the keys to sort
  * \param values the values that sorts w.r.t the key
  * \param is_ascend whether to sort key in ascending order
@@ -47,6 +112,11 @@ inline void SortByKey(mshadow::Tensor<cpu, 1, KDType> keys, mshadow::Tensor<cpu,
   CHECK_EQ(keys.size(0), values.size(0))
     << "The sizes of key/value are not equal! keys_size: " << keys.size(0)
     << "values_size: " << values.size(0);
+  if (std::is_integral<KDType>::value && is_ascend &&
+      (begin_bit != 0 || end_bit != static_cast<int>(sizeof(KDType)*8))) {
+    RadixSortByKey(keys.dptr_, values.dptr_, keys.size(0), begin_bit, end_bit);
+    return;
+  }
   std::vector<size_t> idx(keys.size(0));
   std::vector<KDType> keys_vec(keys.size(0));
   std::vector<VDType> values_vec(values.size(0));
@@ -322,6 +322,141 @@ void SparseRetainOpForwardRspImpl(mshadow::Stream<xpu> *s,
   });
 }
 
+/*!
+ * \brief Position of row irow in the sorted row indices of a row sparse ndarray,
+ * or -1 if the row is not stored. A null idx stands for a dense ndarray.
+ */
+template<typename RType>
+MSHADOW_XINLINE int64_t SparseRetainFindRow(const RType* idx, const int64_t nnr,
+                                            const RType irow) {
+  if (idx == nullptr) return static_cast<int64_t>(irow);
+  int64_t left = 0, right = nnr - 1;
+  while (left <= right) {
+    const int64_t m = left + (right - left) / 2;
+    if (idx[m] == irow) {
+      return m;
+    } else if (idx[m] < irow) {
+      left = m + 1;
+    } else {
+      right = m - 1;
+    }
+  }
+  return -1;
+}
+
+/*!
+ * \brief out = OP(lhs, rhs) on the rows of row sparse lhs, with the rows of rhs
+ * retained on the fly instead of in a new row sparse ndarray. Rows missing in
+ * rhs count as zeros. Every element of out only reads the same element of lhs,
+ * so out may be lhs itself. Parallelized by rows, used on CPU.
+ */
+template<typename OP>
+struct SparseRetainUpdateRspPerRow {
+  template<typename DType, typename RType>
+  MSHADOW_XINLINE static void Map(int i, DType* out, const DType* lhs, const RType* lhs_idx,
+                                  const DType* rhs, const RType* rhs_idx,
+                                  const int64_t rhs_nnr, const size_t row_length) {
+    const int64_t j = SparseRetainFindRow(rhs_idx, rhs_nnr, lhs_idx[i]);
+    const size_t offset = i * row_length;
+    if (j < 0) {
+      for (size_t k = 0; k < row_length; ++k) {
+        out[offset + k] = OP::Map(lhs[offset + k], DType(0));
+      }
+    } else {
+      const DType* rhs_row = rhs + j * row_length;
+      for (size_t k = 0; k < row_length; ++k) {
+        out[offset + k] = OP::Map(lhs[offset + k], rhs_row[k]);
+      }
+    }
+  }
+};
+
+/*!
+ * \brief GPU version of SparseRetainUpdateRspPerRow, parallelized by elements.
+ */
+template<typename OP>
+struct SparseRetainUpdateRspPerElem {
+  template<typename DType, typename RType>
+  MSHADOW_XINLINE static void Map(int i, DType* out, const DType* lhs, const RType* lhs_idx,
+                                  const DType* rhs, const RType* rhs_idx,
+                                  const int64_t rhs_nnr, const size_t row_length) {
+    const size_t irow = i / row_length;
+    const size_t icol = i % row_length;
+    const int64_t j = SparseRetainFindRow(rhs_idx, rhs_nnr, lhs_idx[irow]);
+    out[i] = OP::Map(lhs[i], j < 0 ? DType(0) : rhs[j * row_length + icol]);
+  }
+};
+
+/*!
+ * \brief Fused sparse retain and elementwise update: output = OP(lhs, rhs retained
+ * to the rows of lhs), with lhs row sparse and rhs row sparse or dense. The output
+ * takes the rows of lhs and is written in place when it shares the storage of lhs,
+ * as with req = kWriteInplace; no intermediate row sparse ndarray is created.
+ */
+template<typename xpu, typename OP>
+void SparseRetainUpdateRspImpl(mshadow::Stream<xpu> *s,
+                               const NDArray& lhs,
+                               const NDArray& rhs,
+                               const OpReqType req,
+                               NDArray* output_nd) {
+  if (req == kNullOp) return;
+  CHECK(req == kWriteTo || req == kWriteInplace)
+    << "SparseRetainUpdateRspImpl only supports req = kWriteTo or kWriteInplace";
+  CHECK_EQ(lhs.storage_type(), kRowSparseStorage)
+    << "SparseRetainUpdateRspImpl expects a row sparse lhs";
+  CHECK(rhs.storage_type() == kRowSparseStorage || rhs.storage_type() == kDefaultStorage)
+    << "SparseRetainUpdateRspImpl expects a row sparse or dense rhs";
+  CHECK_EQ(output_nd->storage_type(), kRowSparseStorage)
+    << "SparseRetainUpdateRspImpl only outputs row sparse NDArray";
+  CHECK_EQ(lhs.aux_type(rowsparse::kIdx), output_nd->aux_type(rowsparse::kIdx));
+  if (!lhs.storage_initialized()) {
+    FillZerosRspImpl(s, *output_nd);
+    return;
+  }
+  const bool rhs_is_dense = rhs.storage_type() == kDefaultStorage;
+  CHECK(rhs_is_dense || rhs.aux_type(rowsparse::kIdx) == lhs.aux_type(rowsparse::kIdx))
+    << "SparseRetainUpdateRspImpl expects the same row index type for lhs and rhs";
+  const TBlob lhs_data = lhs.data();
+  const TBlob lhs_idx = lhs.aux_data(rowsparse::kIdx);
+  const size_t nnr = lhs_idx.Size();
+  output_nd->CheckAndAlloc({mshadow::Shape1(nnr)});
+  const TBlob out_data = output_nd->data();
+  const TBlob out_idx = output_nd->aux_data(rowsparse::kIdx);
+  const auto row_length = lhs_data.shape_.ProdShape(1, lhs_data.shape_.ndim());
+
+  using namespace mxnet_op;
+  MSHADOW_TYPE_SWITCH(out_data.type_flag_, DType, {
+    MSHADOW_IDX_TYPE_SWITCH(out_idx.type_flag_, RType, {
+      if (out_idx.dptr<RType>() != lhs_idx.dptr<RType>()) {
+        Kernel<op_with_req<mshadow_op::identity, kWriteTo>, xpu>::Launch(
+            s, nnr, out_idx.dptr<RType>(), lhs_idx.dptr<RType>());
+      }
+      const DType* rhs_data = nullptr;
+      const RType* rhs_idx = nullptr;
+      int64_t rhs_nnr = 0;
+      if (rhs_is_dense) {
+        rhs_data = rhs.data().dptr<DType>();
+      } else if (rhs.storage_initialized()) {
+        rhs_data = rhs.data().dptr<DType>();
+        rhs_idx = rhs.aux_data(rowsparse::kIdx).dptr<RType>();
+        rhs_nnr = rhs.aux_shape(rowsparse::kIdx).Size();
+      } else {
+        // no stored rows, every lookup misses
+        rhs_idx = lhs_idx.dptr<RType>();
+      }
+      if (std::is_same<xpu, cpu>::value) {
+        Kernel<SparseRetainUpdateRspPerRow<OP>, xpu>::Launch(s, nnr,
+            out_data.dptr<DType>(), lhs_data.dptr<DType>(), lhs_idx.dptr<RType>(),
+            rhs_data, rhs_idx, rhs_nnr, row_length);
+      } else {
+        Kernel<SparseRetainUpdateRspPerElem<OP>, xpu>::Launch(s, out_data.Size(),
+            out_data.dptr<DType>(), lhs_data.dptr<DType>(), lhs_idx.dptr<RType>(),
+            rhs_data, rhs_idx, rhs_nnr, row_length);
+      }
+    });
+  });
+}
+
 template<typename xpu>
 void SparseRetainOpForwardEx(const nnvm::NodeAttrs& attrs,
                              const OpContext& ctx,
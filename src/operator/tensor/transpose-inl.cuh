@@ -0,0 +1,87 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file transpose-inl.cuh
+ * \brief GPU tiled transpose, included by transpose-inl.h
+ */
+#ifndef MXNET_OPERATOR_TENSOR_TRANSPOSE_INL_CUH_
+#define MXNET_OPERATOR_TENSOR_TRANSPOSE_INL_CUH_
+
+/*! \brief side of the tiles staged in shared memory */
+const int kTransposeTile = 32;
+/*! \brief rows of a tile every thread block reads at once */
+const int kTransposeRows = 8;
+
+/*!
+ * \brief transpose the B x C matrices of a flat (A, B, C) array, one 32x32 tile per
+ *  thread block. The tile is padded by a column so the column reads of the writes do
+ *  not conflict on the shared memory banks.
+ */
+template<typename DType>
+__global__ void BatchedTransposeKernel(const DType* in, DType* out, index_t B, index_t C,
+                                       index_t tiles_b, index_t tiles_c) {
+  __shared__ DType tile[kTransposeTile][kTransposeTile + 1];
+  const index_t t = blockIdx.x;
+  const index_t a = t / (tiles_b * tiles_c);
+  const index_t b0 = (t / tiles_c) % tiles_b * kTransposeTile;
+  const index_t c0 = t % tiles_c * kTransposeTile;
+  in += a * B * C;
+  out += a * B * C;
+  for (int i = threadIdx.y; i < kTransposeTile; i += kTransposeRows) {
+    const index_t b = b0 + i, c = c0 + threadIdx.x;
+    if (b < B && c < C) tile[i][threadIdx.x] = in[b * C + c];
+  }
+  __syncthreads();
+  for (int i = threadIdx.y; i < kTransposeTile; i += kTransposeRows) {
+    const index_t c = c0 + i, b = b0 + threadIdx.x;
+    if (c < C && b < B) out[c * B + b] = tile[threadIdx.x][i];
+  }
+}
+
+/*! \brief copy from (A, B, C, D) to (A, C, B, D), coalesced along D */
+struct batched_row_copy {
+  template<typename DType>
+  MSHADOW_XINLINE static void Map(int i, const DType* in, DType* out,
+                                  index_t B, index_t C, index_t D) {
+    const index_t d = i % D, b = (i / D) % B, c = (i / (D * B)) % C, a = i / (D * B * C);
+    out[i] = in[((a * B + b) * C + c) * D + d];
+  }
+};
+
+template<typename DType>
+void BatchedTranspose(mshadow::Stream<gpu>* s, const DType* in, DType* out,
+                      const BatchedShape& shape) {
+  if (shape.d != 1) {
+    mxnet_op::Kernel<batched_row_copy, gpu>::Launch(
+        s, shape.a * shape.b * shape.c * shape.d, in, out, shape.b, shape.c, shape.d);
+    return;
+  }
+  const index_t tiles_b = (shape.b + kTransposeTile - 1) / kTransposeTile;
+  const index_t tiles_c = (shape.c + kTransposeTile - 1) / kTransposeTile;
+  const index_t num_tiles = shape.a * tiles_b * tiles_c;
+  CHECK_LE(num_tiles, static_cast<index_t>(std::numeric_limits<int>::max()))
+      << "Transpose of too large an array";
+  cudaStream_t stream = mshadow::Stream<gpu>::GetStream(s);
+  BatchedTransposeKernel<<<num_tiles, dim3(kTransposeTile, kTransposeRows), 0, stream>>>(
+      in, out, shape.b, shape.c, tiles_b, tiles_c);
+  MSHADOW_CUDA_POST_KERNEL_CHECK(BatchedTransposeKernel);
+}
+
+#endif  // MXNET_OPERATOR_TENSOR_TRANSPOSE_INL_CUH_
@@ -0,0 +1,193 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file transpose-inl.h
+ * \brief Tiled transpose for the permutations which reduce to swapping the two middle
+ *  axes of a 4D array, which covers 2D transposes, 0213, and the NCHW <-> NHWC
+ *  conversions 0231 and 0312
+ */
+#ifndef MXNET_OPERATOR_TENSOR_TRANSPOSE_INL_H_
+#define MXNET_OPERATOR_TENSOR_TRANSPOSE_INL_H_
+
+#include <mxnet/base.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "../mxnet_op.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define MXNET_TRANSPOSE_USE_SSE 1
+#else
+#define MXNET_TRANSPOSE_USE_SSE 0
+#endif
+
+namespace mxnet {
+namespace op {
+namespace transpose {
+
+/*! \brief a transpose from (A, B, C, D) to (A, C, B, D) */
+struct BatchedShape {
+  index_t a, b, c, d;
+};
+
+/*!
+ * \brief Express the transpose of an array as a BatchedShape
+ * \param shape Shape of the input
+ * \param axes Input axis of every output axis
+ * \return false unless the transpose merges into the swap of two (groups of) axes
+ */
+inline bool AsBatched(const TShape& shape, const TShape& axes, BatchedShape* ret) {
+  if (axes.ndim() != shape.ndim() || shape.Size() == 0) return false;
+  // axes of size 1 do not move any data, and the runs of axes staying next to
+  // each other move as one
+  std::vector<index_t> perm;
+  for (index_t axis : axes) {
+    if (shape[axis] != 1) perm.push_back(axis);
+  }
+  std::vector<std::vector<index_t>> groups;
+  for (size_t i = 0; i < perm.size(); ++i) {
+    if (i > 0 && perm[i] == perm[i - 1] + 1) {
+      groups.back().push_back(perm[i]);
+    } else {
+      groups.push_back({perm[i]});
+    }
+  }
+  // the rank of every group in the input order, and its size
+  std::vector<index_t> first(groups.size()), size(groups.size(), 1);
+  for (size_t i = 0; i < groups.size(); ++i) {
+    first[i] = groups[i].front();
+    for (index_t axis : groups[i]) size[i] *= shape[axis];
+  }
+  std::vector<index_t> order(first);
+  std::sort(order.begin(), order.end());
+  std::vector<int> p(groups.size());
+  for (size_t i = 0; i < groups.size(); ++i) {
+    p[i] = std::lower_bound(order.begin(), order.end(), first[i]) - order.begin();
+  }
+  const std::vector<index_t>& n = size;
+  if (p.size() <= 1) {
+    *ret = {1, 1, 1, static_cast<index_t>(shape.Size())};
+  } else if (p == std::vector<int>{1, 0}) {
+    *ret = {1, n[1], n[0], 1};
+  } else if (p == std::vector<int>{0, 2, 1}) {
+    *ret = {n[0], n[2], n[1], 1};
+  } else if (p == std::vector<int>{1, 0, 2}) {
+    *ret = {1, n[1], n[0], n[2]};
+  } else if (p == std::vector<int>{0, 2, 1, 3}) {
+    *ret = {n[0], n[2], n[1], n[3]};
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/*! \brief transpose a rows x cols block */
+template<typename DType>
+inline void TransposeBlock(const DType* in, index_t ld_in, DType* out, index_t ld_out,
+                           index_t rows, index_t cols) {
+  for (index_t i = 0; i < rows; ++i) {
+    for (index_t j = 0; j < cols; ++j) {
+      out[j * ld_out + i] = in[i * ld_in + j];
+    }
+  }
+}
+
+/*! \brief transpose an 8x8 block, in registers for 4 byte types */
+template<typename DType>
+inline void Transpose8x8(const DType* in, index_t ld_in, DType* out, index_t ld_out) {
+#if MXNET_TRANSPOSE_USE_SSE
+  if (sizeof(DType) == 4) {
+    // the data is only moved, so ints travel through float registers unchanged
+    const float* src = reinterpret_cast<const float*>(in);
+    float* dst = reinterpret_cast<float*>(out);
+    for (int bi = 0; bi < 8; bi += 4) {
+      for (int bj = 0; bj < 8; bj += 4) {
+        const float* s = src + bi * ld_in + bj;
+        __m128 r0 = _mm_loadu_ps(s);
+        __m128 r1 = _mm_loadu_ps(s + ld_in);
+        __m128 r2 = _mm_loadu_ps(s + 2 * ld_in);
+        __m128 r3 = _mm_loadu_ps(s + 3 * ld_in);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        float* d = dst + bj * ld_out + bi;
+        _mm_storeu_ps(d, r0);
+        _mm_storeu_ps(d + ld_out, r1);
+        _mm_storeu_ps(d + 2 * ld_out, r2);
+        _mm_storeu_ps(d + 3 * ld_out, r3);
+      }
+    }
+    return;
+  }
+#endif
+  TransposeBlock(in, ld_in, out, ld_out, 8, 8);
+}
+
+/*!
+ * \brief CPU transpose from (A, B, C, D) to (A, C, B, D). With D == 1 32x32 tiles,
+ *  made of 8x8 blocks, are transposed in parallel, otherwise rows of D are copied.
+ */
+template<typename DType>
+void BatchedTranspose(mshadow::Stream<cpu>* s, const DType* in, DType* out,
+                      const BatchedShape& shape) {
+  const index_t A = shape.a, B = shape.b, C = shape.c, D = shape.d;
+  const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  if (D != 1) {
+    const index_t rows = A * B * C;
+    #pragma omp parallel for num_threads(omp_threads)
+    for (index_t r = 0; r < rows; ++r) {
+      // r runs over the output rows (a, c, b)
+      const index_t b = r % B, c = (r / B) % C, a = r / (B * C);
+      std::memcpy(out + r * D, in + ((a * B + b) * C + c) * D, D * sizeof(DType));
+    }
+    return;
+  }
+  const index_t kTile = 32, kBlock = 8;
+  const index_t tiles_b = (B + kTile - 1) / kTile, tiles_c = (C + kTile - 1) / kTile;
+  const index_t num_tiles = A * tiles_b * tiles_c;
+  #pragma omp parallel for num_threads(omp_threads)
+  for (index_t t = 0; t < num_tiles; ++t) {
+    const index_t a = t / (tiles_b * tiles_c);
+    const index_t b0 = (t / tiles_c) % tiles_b * kTile, c0 = t % tiles_c * kTile;
+    const index_t b_end = std::min(b0 + kTile, B), c_end = std::min(c0 + kTile, C);
+    const DType* src = in + a * B * C;
+    DType* dst = out + a * B * C;
+    index_t b = b0;
+    for (; b + kBlock <= b_end; b += kBlock) {
+      index_t c = c0;
+      for (; c + kBlock <= c_end; c += kBlock) {
+        Transpose8x8(src + b * C + c, C, dst + c * B + b, B);
+      }
+      TransposeBlock(src + b * C + c, C, dst + c * B + b, B, kBlock, c_end - c);
+    }
+    TransposeBlock(src + b * C + c0, C, dst + c0 * B + b, B, b_end - b, c_end - c0);
+  }
+}
+
+#ifdef __CUDACC__
+#include "./transpose-inl.cuh"
+#endif
+
+}  // namespace transpose
+}  // namespace op
+}  // namespace mxnet
+
+#undef MXNET_TRANSPOSE_USE_SSE
+#endif  // MXNET_OPERATOR_TENSOR_TRANSPOSE_INL_H_
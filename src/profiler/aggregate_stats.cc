@@ -25,6 +25,8 @@
 #include <dmlc/base.h>
 #include <dmlc/logging.h>
 #include <mxnet/base.h>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <thread>
 #include <iomanip>
@@ -38,9 +40,130 @@ inline float MicroToMilli(const DType micro) {
   return static_cast<float>(static_cast<double>(micro) / 1000);
 }
 
-void AggregateStats::OnProfileStat(const ProfileStat& stat) {
+constexpr int AggregateStats::Histogram::kSubBucketBits;
+constexpr uint64_t AggregateStats::Histogram::kSubBuckets;
+
+size_t AggregateStats::Histogram::Bucket(uint64_t duration) {
+  if (duration < kSubBuckets) return duration;
+  int exponent = kSubBucketBits;
+  while ((duration >> (exponent + 1)) != 0) ++exponent;
+  const int shift = exponent - kSubBucketBits;
+  return (shift + 1) * kSubBuckets + ((duration >> shift) - kSubBuckets);
+}
+
+uint64_t AggregateStats::Histogram::LowerBound(size_t bucket) {
+  if (bucket < kSubBuckets) return bucket;
+  const size_t shift = bucket / kSubBuckets - 1;
+  return (kSubBuckets + bucket % kSubBuckets) << shift;
+}
+
+uint64_t AggregateStats::Histogram::Width(size_t bucket) {
+  return bucket < kSubBuckets ? 1 : uint64_t(1) << (bucket / kSubBuckets - 1);
+}
+
+void AggregateStats::Histogram::Add(uint64_t duration) {
+  const size_t bucket = Bucket(duration);
+  if (bucket >= counts_.size()) counts_.resize(bucket + 1, 0);
+  ++counts_[bucket];
+  ++total_count_;
+}
+
+uint64_t AggregateStats::Histogram::Percentile(double fraction) const {
+  const uint64_t rank = std::max<uint64_t>(1, std::ceil(fraction * total_count_));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) return LowerBound(i) + Width(i) / 2;
+  }
+  return 0;
+}
+
+void AggregateStats::OnProfileStat(const ProfileStat& stat, const char *device) {
   std::unique_lock<std::mutex> lk(m_);
-  stat.SaveAggregate(&stats_[stat.categories_.c_str()][stat.name_.c_str()]);
+  StatData *data = &stats_[stat.categories_.c_str()][stat.name_.c_str()];
+  stat.SaveAggregate(data);
+  if (device && data->type_ == StatData::kDuration) {
+    data->device_histograms_[device].Add(stat.duration());
+  }
+}
+
+void AggregateStats::OnSample(const char *category, const char *name, uint64_t duration) {
+  std::unique_lock<std::mutex> lk(m_);
+  StatData &data = stats_[category][name];
+  data.type_ = StatData::kDuration;
+  ++data.total_count_;
+  data.total_aggregate_ += duration;
+  data.max_aggregate_ = std::max(data.max_aggregate_, duration);
+  data.min_aggregate_ = std::min(data.min_aggregate_, duration);
+  data.histogram_.Add(duration);
+}
+
+namespace {
+/*! \brief percentiles reported, and the suffixes of their names */
+const std::pair<double, const char *> kPercentiles[] = {
+  {0.5, "50"}, {0.9, "90"}, {0.99, "99"}, {0.999, "999"}
+};
+
+/*! \brief percentile of a histogram, within the range of durations actually seen */
+uint64_t Percentile(const AggregateStats::StatData &data,
+                    const AggregateStats::Histogram &histogram, double fraction) {
+  return std::min(std::max(histogram.Percentile(fraction), data.min_aggregate_),
+                  data.max_aggregate_);
+}
+
+void HistogramToJSON(std::ostream& os, const AggregateStats::StatData &data,
+                     const AggregateStats::Histogram &histogram) {
+  for (const auto &p : kPercentiles) {
+    os << ", \"p" << p.second << "_us\": " << Percentile(data, histogram, p.first);
+  }
+  os << ", \"histogram\": [";
+  bool first = true;
+  for (size_t i = 0; i < histogram.counts_.size(); ++i) {
+    if (histogram.counts_[i] == 0) continue;
+    os << (first ? "" : ", ") << "[" << AggregateStats::Histogram::LowerBound(i)
+       << ", " << histogram.counts_[i] << "]";
+    first = false;
+  }
+  os << "]";
+}
+}  // namespace
+
+void AggregateStats::DumpJSON(std::ostream& os, bool clear) {
+  std::unique_lock<std::mutex> lk(m_);
+  os << "{";
+  bool first_type = true;
+  for (const auto &type : stats_) {
+    os << (first_type ? "" : ",") << "\n  \"" << type.first << "\": {";
+    first_type = false;
+    bool first = true;
+    for (const auto &kv : type.second) {
+      const StatData &data = kv.second;
+      if (data.type_ != StatData::kDuration) continue;
+      os << (first ? "" : ",") << "\n    \"" << kv.first << "\": {"
+         << "\"count\": " << data.total_count_
+         << ", \"total_us\": " << data.total_aggregate_
+         << ", \"min_us\": " << data.min_aggregate_
+         << ", \"max_us\": " << data.max_aggregate_
+         << ", \"avg_us\": " << static_cast<double>(data.total_aggregate_) / data.total_count_;
+      first = false;
+      HistogramToJSON(os, data, data.histogram_);
+      os << ", \"devices\": {";
+      bool first_device = true;
+      for (const auto &dev : data.device_histograms_) {
+        os << (first_device ? "" : ", ") << "\"" << dev.first << "\": {"
+           << "\"count\": " << dev.second.total_count_;
+        first_device = false;
+        HistogramToJSON(os, data, dev.second);
+        os << "}";
+      }
+      os << "}}";
+    }
+    os << "}";
+  }
+  os << "\n}\n";
+  if (clear) {
+    stats_.clear();
+  }
 }
 
 void AggregateStats::Dump(std::ostream& os, bool clear) {
@@ -70,8 +193,11 @@ void AggregateStats::Dump(std::ostream& os, bool clear) {
          << "Max Time (ms)"
          << " "
          << std::setw(16) << std::right
-         << "Avg Time (ms)"
-         << std::endl;
+         << "Avg Time (ms)";
+      for (const auto &p : kPercentiles) {
+        os << " " << std::setw(16) << std::right << (std::string("P") + p.second + " (ms)");
+      }
+      os << std::endl;
       os << std::setw(25) << std::left  << "----"
          << std::setw(16) << std::right << "-----------"
          << " "
@@ -85,8 +211,11 @@ void AggregateStats::Dump(std::ostream& os, bool clear) {
          << "-------------"
          << " "
          << std::setw(16) << std::right
-         << "-------------"
-         << std::endl;
+         << "-------------";
+      for (size_t i = 0; i < sizeof(kPercentiles) / sizeof(kPercentiles[0]); ++i) {
+        os << " " << std::setw(16) << std::right << "--------";
+      }
+      os << std::endl;
       for (auto iter = mm.begin(), e_iter = mm.end(); iter != e_iter; ++iter) {
         const StatData &data = iter->second;
         if (data.type_ == StatData::kDuration || data.type_ == StatData::kCounter) {
@@ -111,6 +240,11 @@ void AggregateStats::Dump(std::ostream& os, bool clear) {
                << std::fixed << std::setw(16) << std::setprecision(4) << std::right
                << (MicroToMilli(static_cast<double>(data.total_aggregate_)
                                 / data.total_count_));
+            for (const auto &p : kPercentiles) {
+              os << " "
+                 << std::fixed << std::setw(16) << std::setprecision(4) << std::right
+                 << MicroToMilli(Percentile(data, data.histogram_, p.first));
+            }
           }
           os << std::endl;
         }
@@ -22,6 +22,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <cstdint>
 #include <ostream>
 #include <mutex>
@@ -34,6 +35,33 @@ struct ProfileStat;
 
 class AggregateStats {
  public:
+  /*!
+   * \brief Log-linear histogram of durations in microseconds. Durations below
+   *  kSubBuckets are counted exactly, larger ones in kSubBuckets buckets per power of
+   *  two, which bounds the relative error of the percentiles by 1 / kSubBuckets.
+   */
+  struct Histogram {
+    static constexpr int kSubBucketBits = 4;
+    static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+    /*! \brief number of durations per bucket, grown up to the largest bucket used */
+    std::vector<uint64_t> counts_;
+    /*! \brief total number of durations */
+    uint64_t total_count_ = 0;
+
+    /*! \brief Record a duration */
+    void Add(uint64_t duration);
+    /*!
+     * \brief Estimate a percentile, as the middle of the bucket it falls into
+     * \param fraction Fraction of the durations below the percentile, in [0, 1]
+     */
+    uint64_t Percentile(double fraction) const;
+    /*! \brief Index of the bucket of a duration */
+    static size_t Bucket(uint64_t duration);
+    /*! \brief Smallest duration of a bucket */
+    static uint64_t LowerBound(size_t bucket);
+    /*! \brief Number of durations counted by a bucket */
+    static uint64_t Width(size_t bucket);
+  };
   struct StatData {
     /*!
      * \brief Types that the console printer knows how to format
@@ -49,18 +77,38 @@ class AggregateStats {
     uint64_t  total_aggregate_ = 0;
     uint64_t  max_aggregate_ = 0;
     uint64_t  min_aggregate_ = INT_MAX;
+    /*! \brief Distribution of the durations */
+    Histogram histogram_;
+    /*! \brief Distribution of the durations of operators per device they ran on */
+    std::map<std::string, Histogram> device_histograms_;
   };
 
   /*!
    * \brief Record aggregate profile data
    * \param stat SIngle profile statistics to add to the accumulates statistics
+   * \param device Name of the device the statistics belong to, nullptr if none
    */
-  void OnProfileStat(const ProfileStat& stat);
+  void OnProfileStat(const ProfileStat& stat, const char *device = nullptr);
   /*!
    * \brief Print profliing statistics to console
    * \param clear Delete all of the current statistics after printing
    */
   void Dump(std::ostream& os, bool clear);
+  /*!
+   * \brief Record the duration of a sampled execution of an operator
+   * \param category Category of the statistics
+   * \param name Name of the operator
+   * \param duration Duration in microseconds
+   */
+  void OnSample(const char *category, const char *name, uint64_t duration);
+  /*!
+   * \brief Print the duration statistics as JSON, {category: {name: {"count", "total_us",
+   *  "min_us", "max_us", "avg_us", "p50_us", "p90_us", "p99_us", "p999_us", "histogram",
+   *  "devices"}}}, where histogram lists the [lower bound, count] of its non-empty buckets
+   *  and devices maps the device names to their own count, percentiles and histogram
+   * \param clear Delete all of the current statistics after printing
+   */
+  void DumpJSON(std::ostream& os, bool clear);
 
  private:
   /*! \brief Should rarely collide, so most locks should occur only in user-space (futex) */
@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file nvtx.cc
+ * \brief NVTX ranges
+ */
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <functional>
+#include <string>
+#include "./nvtx.h"
+
+namespace mxnet {
+namespace profiler {
+namespace nvtx {
+
+std::atomic<bool> enabled{dmlc::GetEnv("MXNET_PROFILER_NVTX", false)};
+
+#if MXNET_USE_NVTX
+namespace {
+/*! \brief colors of operators and nodes, picked by the hash of their names */
+const uint32_t kPalette[] = {
+  0xff1f77b4, 0xffff7f0e, 0xff2ca02c, 0xffd62728, 0xff9467bd,
+  0xff8c564b, 0xffe377c2, 0xff7f7f7f, 0xffbcbd22, 0xff17becf
+};
+
+uint32_t Color(const char *name, Category category) {
+  switch (category) {
+    case kSegment:
+      return 0xff404040;
+    case kCachedOp:
+      return 0xff00a0a0;
+    case kKVStore:
+      return 0xffa00000;
+    default:
+      return kPalette[std::hash<std::string>()(name) % (sizeof(kPalette) / sizeof(kPalette[0]))];
+  }
+}
+
+void NameCategories() {
+  nvtxNameCategoryA(kOperator, "Operator");
+  nvtxNameCategoryA(kNode, "Graph node");
+  nvtxNameCategoryA(kSegment, "Bulk segment");
+  nvtxNameCategoryA(kCachedOp, "CachedOp");
+  nvtxNameCategoryA(kKVStore, "KVStore");
+}
+}  // namespace
+#endif  // MXNET_USE_NVTX
+
+void SetEnabled(bool value) {
+#if !MXNET_USE_NVTX
+  LOG_IF(WARNING, value) << "NVTX ranges need MXNet built with USE_NVTX=1";
+#endif
+  enabled.store(value, std::memory_order_relaxed);
+}
+
+void RangePush(const char *name, Category category) {
+#if MXNET_USE_NVTX
+  static const bool named = (NameCategories(), true);
+  (void)named;
+  nvtxEventAttributes_t attr = {};
+  attr.version = NVTX_VERSION;
+  attr.size = NVTX_EVENT_ATTRIB_STRUCT_SIZE;
+  attr.category = category;
+  attr.colorType = NVTX_COLOR_ARGB;
+  attr.color = Color(name, category);
+  attr.messageType = NVTX_MESSAGE_TYPE_ASCII;
+  attr.message.ascii = name;
+  nvtxRangePushEx(&attr);
+#endif
+}
+
+}  // namespace nvtx
+}  // namespace profiler
+}  // namespace mxnet
@@ -0,0 +1,97 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file nvtx.h
+ * \brief NVTX ranges, shown by Nsight Systems around the kernels they launch
+ */
+#ifndef MXNET_PROFILER_NVTX_H_
+#define MXNET_PROFILER_NVTX_H_
+
+#include <dmlc/base.h>
+#include <atomic>
+#include <cstdint>
+
+#if MXNET_USE_NVTX
+#include <nvToolsExt.h>
+#endif
+
+namespace mxnet {
+namespace profiler {
+namespace nvtx {
+
+/*! \brief NVTX categories of the ranges */
+enum Category : uint32_t {
+  kOperator = 1,
+  kNode,
+  kSegment,
+  kCachedOp,
+  kKVStore
+};
+
+/*! \brief whether ranges are emitted, MXNET_PROFILER_NVTX at startup */
+extern std::atomic<bool> enabled;
+
+/*! \brief Whether ranges are emitted */
+inline bool Enabled() {
+#if MXNET_USE_NVTX
+  return enabled.load(std::memory_order_relaxed);
+#else
+  return false;
+#endif
+}
+
+/*! \brief Turn the emission of ranges on or off */
+void SetEnabled(bool value);
+
+/*!
+ * \brief Push a range, colored by the name for operators and graph nodes and by
+ *  the category for the others
+ */
+void RangePush(const char *name, Category category);
+
+/*! \brief Pop the innermost range of the calling thread */
+inline void RangePop() {
+#if MXNET_USE_NVTX
+  nvtxRangePop();
+#endif
+}
+
+/*!
+ * \brief Range spanning its scope, costs an atomic load when ranges are not emitted
+ */
+class NVTXRange {
+ public:
+  inline NVTXRange(const char *name, Category category)
+    : active_(name != nullptr && Enabled()) {
+    if (active_) RangePush(name, category);
+  }
+  inline ~NVTXRange() {
+    if (active_) RangePop();
+  }
+
+ private:
+  const bool active_;
+  DISALLOW_COPY_AND_ASSIGN(NVTXRange);
+};
+
+}  // namespace nvtx
+}  // namespace profiler
+}  // namespace mxnet
+#endif  // MXNET_PROFILER_NVTX_H_
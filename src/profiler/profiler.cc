@@ -79,6 +79,11 @@ Profiler::Profiler()
   this->profile_stat[cpu_num_ + gpu_num_ + 1].dev_name_ = "cpu shared/";
 
   this->mode_ = dmlc::GetEnv("MXNET_PROFILER_MODE", this->mode_);
+  const int64_t sample_rate = dmlc::GetEnv("MXNET_PROFILER_SAMPLE_RATE", 0);
+  if (sample_rate > 0) {
+    sampler_.reset(new OperatorSampler(
+        sample_rate, dmlc::GetEnv("MXNET_PROFILER_SAMPLE_BUFFER", size_t(4096))));
+  }
   if (dmlc::GetEnv("MXNET_PROFILER_AUTOSTART", 0)) {
     this->state_ = ProfilerState::kRunning;
     this->enable_output_ = true;
@@ -97,6 +102,74 @@ Profiler::~Profiler() {
   }
 }
 
+constexpr const char *OperatorSampler::kCategory;
+
+OperatorSampler::OperatorSampler(int64_t rate, size_t capacity)
+  : rate_(rate), mask_(RoundUpPow2(std::max(capacity, size_t(2))) - 1),
+    slots_(new Slot[mask_ + 1]) {
+  for (size_t i = 0; i <= mask_; ++i) {
+    slots_[i].seq.store(i, std::memory_order_relaxed);
+  }
+}
+
+size_t OperatorSampler::RoundUpPow2(size_t n) {
+  size_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+void OperatorSampler::Add(const char *name, uint64_t duration) {
+  // bounded multi-producer queue of Dmitry Vyukov, a slot is free once its
+  // sequence number equals the position to write
+  size_t pos = head_.load(std::memory_order_relaxed);
+  Slot *slot;
+  while (true) {
+    slot = &slots_[pos & mask_];
+    const size_t seq = slot->seq.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = head_.load(std::memory_order_relaxed);
+    }
+  }
+  slot->name.set(name);
+  slot->duration = duration;
+  slot->seq.store(pos + 1, std::memory_order_release);
+  // aggregate from the executing thread once a quarter of the ring is filled,
+  // unless another thread is at it already
+  if (((pos + 1) & (mask_ >> 2)) == 0) {
+    std::unique_lock<std::mutex> lk(drain_mutex_, std::try_to_lock);
+    if (lk.owns_lock()) DrainLocked();
+  }
+}
+
+void OperatorSampler::DrainLocked() {
+  size_t pos = tail_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot &slot = slots_[pos & mask_];
+    if (slot.seq.load(std::memory_order_acquire) != pos + 1) break;
+    stats_.OnSample(kCategory, slot.name.c_str(), slot.duration);
+    slot.seq.store(pos + mask_ + 1, std::memory_order_release);
+    ++pos;
+  }
+  tail_.store(pos, std::memory_order_relaxed);
+}
+
+void OperatorSampler::Drain() {
+  std::unique_lock<std::mutex> lk(drain_mutex_);
+  DrainLocked();
+}
+
+void OperatorSampler::Dump(std::ostream& os, bool clear) {
+  std::unique_lock<std::mutex> lk(drain_mutex_);
+  DrainLocked();
+  stats_.DumpJSON(os, clear);
+}
+
 Profiler* Profiler::Get(std::shared_ptr<Profiler> *sp) {
   static std::mutex mtx;
   static std::shared_ptr<Profiler> prof = nullptr;
@@ -212,7 +285,7 @@ void Profiler::DumpProfile(bool perform_cleanup) {
       opr_stat->EmitEvents(&file);
       ++num_records_emitted_;
       if (ptr_aggregate_stats) {
-        ptr_aggregate_stats->OnProfileStat(*_opr_stat);
+        ptr_aggregate_stats->OnProfileStat(*_opr_stat, d.dev_name_.c_str());
       }
     }
   }
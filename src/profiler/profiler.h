@@ -25,6 +25,7 @@
 #ifndef MXNET_PROFILER_PROFILER_H_
 #define MXNET_PROFILER_PROFILER_H_
 
+#include <dmlc/base.h>
 #include <dmlc/concurrentqueue.h>
 #include <dmlc/thread_group.h>
 #include <vector>
@@ -33,6 +34,8 @@
 #include <mutex>
 #include <memory>
 #include <array>
+#include <atomic>
+#include <ostream>
 #include "./vtune.h"
 #include "./aggregate_stats.h"
 
@@ -188,6 +191,11 @@ struct ProfileStat {
     }
   }
 
+  /*!
+   * \brief Duration in microseconds of the statistics of durations, otherwise 0
+   */
+  virtual uint64_t duration() const { return 0; }
+
  protected:
   /*!
    * \brief Override to emit extra items within the json event data block. Append with a comma ",".
@@ -241,6 +249,74 @@ struct DeviceStats {
   std::shared_ptr<TQueue> opr_exec_stats_ = std::make_shared<TQueue>();
 };
 
+/*!
+ * \brief Records the durations of every n-th operator executed, for statistics which can be
+ *  kept on in production. Samples are pushed into a preallocated lock-free ring and
+ *  aggregated by whichever thread finds the ring filling up or scrapes the statistics,
+ *  samples arriving while the ring is full are dropped.
+ */
+class OperatorSampler {
+ public:
+  /*! \brief category of the sampled statistics */
+  static constexpr const char *kCategory = "operator (sampled)";
+  /*!
+   * \brief Constructor
+   * \param rate Sample one out of rate operators
+   * \param capacity Number of samples the ring holds, rounded up to a power of two
+   */
+  OperatorSampler(int64_t rate, size_t capacity);
+  /*!
+   * \brief Whether the operator about to run on the calling thread is to be sampled
+   */
+  inline bool Sample() const {
+    static MX_THREAD_LOCAL int64_t countdown = 0;
+    if (countdown > 0) {
+      --countdown;
+      return false;
+    }
+    countdown = rate_ - 1;
+    return true;
+  }
+  /*!
+   * \brief Record a sample
+   * \param name Name of the operator
+   * \param duration Duration in microseconds
+   */
+  void Add(const char *name, uint64_t duration);
+  /*! \brief Aggregate the samples in the ring */
+  void Drain();
+  /*!
+   * \brief Aggregate the samples in the ring and print the statistics as JSON
+   * \param clear Delete the statistics after printing
+   */
+  void Dump(std::ostream& os, bool clear);
+  /*! \brief Number of samples dropped because the ring was full */
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    profile_stat_string name;
+    uint64_t duration;
+  };
+  /*! \brief aggregate the samples in the ring, drain_mutex_ is to be held */
+  void DrainLocked();
+  static size_t RoundUpPow2(size_t n);
+
+  /*! \brief sample one out of rate_ operators */
+  const int64_t rate_;
+  /*! \brief capacity of the ring minus one */
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  /*! \brief next positions to write and read */
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  std::atomic<uint64_t> dropped_{0};
+  /*! \brief held by the thread aggregating the samples */
+  std::mutex drain_mutex_;
+  AggregateStats stats_;
+};
+
 /*!
  *  _____              __  _  _
  * |  __ \            / _|(_)| |
@@ -336,6 +412,14 @@ class Profiler {
     return aggregate_stats_;
   }
 
+  /*!
+   * \brief Return the operator sampler
+   * \return the sampler, set when MXNET_PROFILER_SAMPLE_RATE is positive, otherwise nullptr
+   */
+  OperatorSampler *sampler() const {
+    return sampler_.get();
+  }
+
   /*!
    * \brief Get a pointer to the Profiler singleton
    * \return Profiler singleton
@@ -477,6 +561,8 @@ class Profiler {
   /*! \brief Maintain in-memory aggregate stats for print output.
    *  \warning This has a negative performance impact */
   std::shared_ptr<AggregateStats> aggregate_stats_ = nullptr;
+  /*! \brief Always-on sampled operator statistics */
+  std::unique_ptr<OperatorSampler> sampler_;
   /*! \brief Asynchronous operation thread lifecycle control object */
   std::shared_ptr<dmlc::ThreadGroup> thread_group_ = std::make_shared<dmlc::ThreadGroup>();
   /* !\brief pids */
@@ -733,6 +819,14 @@ class ProfileDuration : public ProfileObject {
       items_[kStop].event_type_ = end_event;
     }
 
+    /*!
+     * \brief Duration in microseconds
+     */
+    uint64_t duration() const override {
+      CHECK_GE(items_[kStop].timestamp_, items_[kStart].timestamp_);
+      return items_[kStop].timestamp_ - items_[kStart].timestamp_;
+    }
+
     /*!
      * \brief Save aggregate data for this stat
      * \param data Stat data
@@ -741,8 +835,8 @@ class ProfileDuration : public ProfileObject {
       if (data) {
         data->type_ = AggregateStats::StatData::kDuration;
         ++data->total_count_;
-        CHECK_GE(items_[kStop].timestamp_, items_[kStart].timestamp_);
-        const uint64_t duration = items_[kStop].timestamp_ - items_[kStart].timestamp_;
+        const uint64_t duration = this->duration();
+        data->histogram_.Add(duration);
         data->total_aggregate_ += duration;
         if (duration > data->max_aggregate_) {
           data->max_aggregate_ = duration;
@@ -20,9 +20,14 @@
 #define MXNET_PROFILER_STORAGE_PROFILER_H_
 
 #include <mxnet/storage.h>
+#include <cstdint>
+#include <fstream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "./profiler.h"
+#include "../storage/storage_manager.h"
 
 namespace mxnet {
 namespace storage {
@@ -37,20 +42,35 @@ class DeviceStorageProfiler {
    */
   explicit DeviceStorageProfiler(const char *domain_name = "Device Storage")
     : domain_(domain_name) {
+    const std::string trace = dmlc::GetEnv("MXNET_STORAGE_TRACE_FILE", std::string());
+    if (!trace.empty()) {
+      trace_.open(trace);
+      CHECK(trace_.good()) << "Cannot open the storage trace file " << trace;
+    }
   }
 
   /*!
-   * \brief Called when memory has been allocated in order to record the allocation size
-   * \param handle Handle to the allocated storage
+   * \brief Called when memory has been allocated in order to record the allocation size,
+   *  attributing it to the operator and category of the Storage::AllocScope of the thread
+   * \param handle Handle to the allocated storage, records the attribution
    */
-  void OnAlloc(const Storage::Handle &handle) {
-    if (handle.size > 0) {
+  void OnAlloc(Storage::Handle *handle) {
+    Trace('a', *handle);
+    handle->profiler_name = nullptr;
+    handle->profiler_category = -1;
+    if (handle->size > 0) {
       profiler::Profiler *prof = profiler::Profiler::Get();
       if (prof->IsProfiling(profiler::Profiler::kMemory)) {
         Init();
-        const size_t idx = prof->DeviceIndex(handle.ctx.dev_type, handle.ctx.dev_id);
+        const size_t idx = prof->DeviceIndex(handle->ctx.dev_type, handle->ctx.dev_id);
         CHECK_LT(idx, mem_counters_.size()) << "Invalid device index: " << idx;
-        *mem_counters_[idx] += handle.size;
+        *mem_counters_[idx] += handle->size;
+        std::lock_guard<std::mutex> lk(usage_mutex_);
+        const char *name = Storage::AllocScope::name();
+        // the names are interned, the handle outlives the strings of some operators
+        handle->profiler_name = name == nullptr ? nullptr : names_.insert(name).first->c_str();
+        handle->profiler_category = Storage::AllocScope::category();
+        Attribute(*handle, idx, static_cast<int64_t>(handle->size));
       }
     }
   }
@@ -60,6 +80,7 @@ class DeviceStorageProfiler {
    * \param handle Handle to the allocated storage
    */
   void OnFree(const Storage::Handle &handle) {
+    Trace('f', handle);
     if (handle.size > 0) {
       profiler::Profiler *prof = profiler::Profiler::Get();
       if (prof->IsProfiling(profiler::Profiler::kMemory)) {
@@ -67,11 +88,84 @@ class DeviceStorageProfiler {
         const size_t idx = prof->DeviceIndex(handle.ctx.dev_type, handle.ctx.dev_id);
         CHECK_LT(idx, mem_counters_.size()) << "Invalid device index: " << idx;
         *mem_counters_[idx] -= handle.size;
+        if (handle.profiler_category >= 0) {
+          std::lock_guard<std::mutex> lk(usage_mutex_);
+          Attribute(handle, idx, -static_cast<int64_t>(handle.size));
+        }
+      }
+    }
+  }
+
+  /*!
+   * \brief Called after each storage operation to record pool occupancy
+   * \param ctx Context the storage manager serves
+   * \param manager Storage manager of that context
+   */
+  void OnPoolStats(const Context &ctx, StorageManager *manager) {
+    profiler::Profiler *prof = profiler::Profiler::Get();
+    if (prof->IsProfiling(profiler::Profiler::kMemory)) {
+      size_t reserved, in_use;
+      if (manager->GetPoolStats(&reserved, &in_use)) {
+        Init();
+        const size_t idx = prof->DeviceIndex(ctx.dev_type, ctx.dev_id);
+        CHECK_LT(idx, pool_reserved_counters_.size()) << "Invalid device index: " << idx;
+        *pool_reserved_counters_[idx] = reserved;
+        *pool_slack_counters_[idx] = reserved - in_use;
       }
     }
   }
 
  private:
+  /*!
+   * \brief Append an allocation or a free to the trace file, one line of the operation,
+   *  device type, device id, address and size, which storage benchmarks replay
+   */
+  void Trace(char op, const Storage::Handle &handle) {
+    if (!trace_.is_open() || handle.size == 0) return;
+    std::lock_guard<std::mutex> lk(trace_mutex_);
+    trace_ << op << ' ' << handle.ctx.dev_type << ' ' << handle.ctx.dev_id << ' '
+           << reinterpret_cast<uintptr_t>(handle.dptr) << ' ' << handle.size << '\n';
+  }
+
+  /*! \brief bytes in use attributed to a category or an operator on a device */
+  struct Usage {
+    uint64_t bytes{0};
+    std::shared_ptr<profiler::ProfileCounter> counter;
+  };
+
+  static const char *CategoryName(int category) {
+    switch (category) {
+      case Storage::kWeight: return "Weights";
+      case Storage::kActivation: return "Activations";
+      case Storage::kWorkspace: return "Workspace";
+      default: return "Other";
+    }
+  }
+
+  /*!
+   * \brief Update the counters of the category and the operator of an allocation, whose
+   *  maximum over time is the peak of the breakdown. Requires usage_mutex_
+   */
+  void Attribute(const Storage::Handle &handle, size_t idx, int64_t change) {
+    const std::string device = profiler::Profiler::Get()->DeviceName(idx);
+    Update(std::string("Memory ") + CategoryName(handle.profiler_category) + ": " + device,
+           change);
+    if (handle.profiler_name != nullptr) {
+      Update(std::string("Memory by op ") + handle.profiler_name + ": " + device, change);
+    }
+  }
+
+  void Update(const std::string &name, int64_t change) {
+    Usage &usage = usage_[name];
+    if (!usage.counter) {
+      usage.counter = std::make_shared<profiler::ProfileCounter>(name.c_str(), &domain_);
+    }
+    // allocations made before profiling started are not counted
+    usage.bytes = change < 0 && usage.bytes < static_cast<uint64_t>(-change) ?
+        0 : usage.bytes + change;
+    *usage.counter = usage.bytes;
+  }
+
   /*!
    * \brief Lazy initialization.  No locks occur except for on the first pass
    * (or colliding parallel first passes)
@@ -90,6 +184,18 @@ class DeviceStorageProfiler {
           mem_counters_.emplace_back(std::make_shared<profiler::ProfileCounter>(name.c_str(),
                                                                               &domain_));
         }
+        pool_reserved_counters_.reserve(device_count);
+        pool_slack_counters_.reserve(device_count);
+        for (size_t i = 0, n = device_count; i < n; ++i) {
+          std::string name = "Pool Reserved: ";
+          name += prof->DeviceName(i);
+          pool_reserved_counters_.emplace_back(
+            std::make_shared<profiler::ProfileCounter>(name.c_str(), &domain_));
+          name = "Pool Slack: ";
+          name += prof->DeviceName(i);
+          pool_slack_counters_.emplace_back(
+            std::make_shared<profiler::ProfileCounter>(name.c_str(), &domain_));
+        }
       }
     }
   }
@@ -100,6 +206,20 @@ class DeviceStorageProfiler {
   std::mutex init_mutex_;
   /*! \brief Constant-sized vector of memory profile counters */
   std::vector<std::shared_ptr<profiler::ProfileCounter>> mem_counters_;
+  /*! \brief Bytes reserved by the pooled storage manager of each device */
+  std::vector<std::shared_ptr<profiler::ProfileCounter>> pool_reserved_counters_;
+  /*! \brief Bytes reserved but not handed out (cached or fragmented) per device */
+  std::vector<std::shared_ptr<profiler::ProfileCounter>> pool_slack_counters_;
+  /*! \brief Mutex for the attribution of allocations */
+  std::mutex usage_mutex_;
+  /*! \brief Usage per category or operator and device, by counter name */
+  std::unordered_map<std::string, Usage> usage_;
+  /*! \brief Interned operator names the handles point to */
+  std::unordered_set<std::string> names_;
+  /*! \brief Mutex for the trace file */
+  std::mutex trace_mutex_;
+  /*! \brief Allocations and frees of all devices, open when MXNET_STORAGE_TRACE_FILE is set */
+  std::ofstream trace_;
 };
 
 }  // namespace storage
@@ -29,6 +29,7 @@
 #include <mxnet/engine.h>
 #include <mxnet/resource.h>
 #include <mxnet/storage.h>
+#include <algorithm>
 #include <limits>
 #include <atomic>
 #include "./common/lazy_alloc_array.h"
@@ -38,6 +39,30 @@
 namespace mxnet {
 namespace resource {
 
+// bumped whenever any temporal space moves to a new buffer
+static std::atomic<uint64_t> temp_space_version(0);
+
+// Largest request to a space over a window of requests. A space that stays more
+// than twice as large as anything its users asked for during a whole window is
+// shrunk, so a single huge request, such as a cudnn algorithm search, does not pin
+// its memory forever. The released buffer goes back to the storage pool of the
+// device, where the other temp space copies and arrays can reuse it.
+struct SpaceWindow {
+  size_t peak = 0;
+  int count = 0;
+  // record a request of size bytes to a space of capacity bytes, returns the
+  // size the space should shrink to, or 0 to keep it
+  inline size_t Record(size_t size, size_t capacity) {
+    static const int interval = dmlc::GetEnv("MXNET_TEMP_SPACE_SHRINK_INTERVAL", 1000);
+    peak = std::max(peak, size);
+    if (interval <= 0 || ++count < interval) return 0;
+    const size_t target = peak;
+    peak = 0;
+    count = 0;
+    return target != 0 && target * 2 <= capacity ? target : 0;
+  }
+};
+
 // internal structure for space allocator
 struct SpaceAllocator {
   // internal context
@@ -46,6 +71,8 @@ struct SpaceAllocator {
   Storage::Handle handle;
   // internal CPU handle
   Storage::Handle host_handle;
+  // recent requests to handle and host_handle
+  SpaceWindow window, host_window;
 
   SpaceAllocator() {
     handle.dptr = nullptr;
@@ -63,8 +90,26 @@ struct SpaceAllocator {
       host_handle.size = 0;
     }
   }
-  inline void* GetSpace(size_t size) {
-    if (handle.size >= size) return handle.dptr;
+  inline void* GetSpace(size_t size, void* stream) {
+    const size_t shrink_size = window.Record(size, handle.size);
+    if (handle.size >= size && shrink_size == 0) return handle.dptr;
+    size = std::max(size, shrink_size);
+    Storage::AllocScope alloc_scope(nullptr, Storage::kWorkspace);
+    ++temp_space_version;
+#if MXNET_USE_CUDA
+    if (ctx.dev_mask() == gpu::kDevMask && stream != nullptr) {
+      // hand the old space back to the pool tagged with the stream that still
+      // uses it, instead of synchronizing the device in DirectFree
+      cudaStream_t s = mshadow::Stream<gpu>::GetStream(static_cast<mshadow::Stream<gpu>*>(stream));
+      if (handle.size != 0) {
+        Storage::Get()->FreeOnStream(handle, s);
+      }
+      handle.size = size;
+      handle.ctx = ctx;
+      Storage::Get()->AllocOnStream(&handle, s);
+      return handle.dptr;
+    }
+#endif
     if (handle.size != 0) {
       Storage::Get()->DirectFree(handle);
     }
@@ -73,7 +118,10 @@ struct SpaceAllocator {
   }
 
   inline void* GetHostSpace(size_t size) {
-    if (host_handle.size >= size) return host_handle.dptr;
+    const size_t shrink_size = host_window.Record(size, host_handle.size);
+    if (host_handle.size >= size && shrink_size == 0) return host_handle.dptr;
+    size = std::max(size, shrink_size);
+    Storage::AllocScope alloc_scope(nullptr, Storage::kWorkspace);
     if (host_handle.size != 0) {
       Storage::Get()->DirectFree(host_handle);
     }
@@ -184,6 +232,10 @@ class ResourceManagerImpl : public ResourceManager {
 #endif
   }
 
+  uint64_t TempSpaceVersion() const override {
+    return temp_space_version.load();
+  }
+
  private:
   /*! \brief Maximum number of GPUs */
   static constexpr std::size_t kMaxNumGPUs = 16;
@@ -386,8 +438,8 @@ class ResourceManagerImpl : public ResourceManager {
 };
 }  // namespace resource
 
-void* Resource::get_space_internal(size_t size) const {
-  return static_cast<resource::SpaceAllocator*>(ptr_)->GetSpace(size);
+void* Resource::get_space_internal(size_t size, void* stream) const {
+  return static_cast<resource::SpaceAllocator*>(ptr_)->GetSpace(size, stream);
 }
 
 void* Resource::get_host_space_internal(size_t size) const {
@@ -0,0 +1,180 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file gpu_shared_storage_manager.h
+ * \brief storage manager for gpu memory shared between processes through cuda ipc
+ */
+#ifndef MXNET_STORAGE_GPU_SHARED_STORAGE_MANAGER_H_
+#define MXNET_STORAGE_GPU_SHARED_STORAGE_MANAGER_H_
+
+#if MXNET_USE_CUDA
+
+#include <cuda_runtime.h>
+#include <unistd.h>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include "./storage_manager.h"
+#include "../common/cuda_utils.h"
+
+namespace mxnet {
+namespace storage {
+
+/*!
+ * \brief Storage manager for gpu memory other processes can map.
+ *
+ *  Memory allocated here gets shared_pid set to the pid of the process and a
+ *  shared_id unique within it. Export writes the cuda ipc handle of the memory,
+ *  which Import opens in another process, or looks up again in this one.
+ *  Allocations are reference counted: Alloc, every Export and every Import in
+ *  the owning process hold one reference, and Free releases one. Memory opened
+ *  from another process is closed once all its imports are freed.
+ */
+class GPUSharedStorageManager final : public StorageManager {
+ public:
+  /*! \brief what is exchanged between processes */
+  struct IpcHandle {
+    cudaIpcMemHandle_t mem;
+    int pid;
+    int id;
+    size_t size;
+  };
+  static_assert(sizeof(IpcHandle) <= Storage::kGPUIpcHandleSize,
+                "Storage::kGPUIpcHandleSize is too small for a cuda ipc handle");
+
+  GPUSharedStorageManager() : pid_(getpid()), next_id_(0) {}
+
+  ~GPUSharedStorageManager() {
+    // the cuda runtime may already be unloaded at exit, leave the memory to the driver
+  }
+
+  void Alloc(Storage::Handle* handle) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry entry;
+    CUDA_CALL(cudaMalloc(&entry.dptr, handle->size));
+    CUDA_CALL(cudaIpcGetMemHandle(&entry.mem, entry.dptr));
+    entry.size = handle->size;
+    handle->dptr = entry.dptr;
+    handle->shared_pid = pid_;
+    handle->shared_id = next_id_++;
+    owned_[handle->shared_id] = entry;
+  }
+
+  void Free(Storage::Handle handle) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (handle.shared_pid == pid_) {
+      auto it = owned_.find(handle.shared_id);
+      CHECK(it != owned_.end()) << "Free of unknown gpu shared memory " << handle.shared_id;
+      if (--it->second.ref == 0) {
+        CUDA_CALL(cudaFree(it->second.dptr));
+        owned_.erase(it);
+      }
+    } else {
+      auto it = opened_.find(std::make_pair(handle.shared_pid, handle.shared_id));
+      CHECK(it != opened_.end()) << "Free of unknown gpu shared memory of process "
+                                 << handle.shared_pid;
+      if (--it->second.ref == 0) {
+        CUDA_CALL(cudaIpcCloseMemHandle(it->second.dptr));
+        opened_.erase(it);
+      }
+    }
+  }
+
+  void DirectFree(Storage::Handle handle) override {
+    Free(handle);
+  }
+
+  /*!
+   * \brief write the ipc handle of memory allocated here, the memory then stays
+   *  allocated for the lifetime of the process
+   */
+  void Export(const Storage::Handle& handle, char* ipc_handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_EQ(handle.shared_pid, pid_) << "Only the owning process can export gpu shared memory";
+    auto it = owned_.find(handle.shared_id);
+    CHECK(it != owned_.end()) << "Export of unknown gpu shared memory " << handle.shared_id;
+    ++it->second.ref;
+    IpcHandle out;
+    out.mem = it->second.mem;
+    out.pid = pid_;
+    out.id = handle.shared_id;
+    out.size = it->second.size;
+    std::memset(ipc_handle, 0, Storage::kGPUIpcHandleSize);
+    std::memcpy(ipc_handle, &out, sizeof(out));
+  }
+
+  /*! \brief open memory exported by this or another process on the current device */
+  void Import(const char* ipc_handle, Storage::Handle* handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    IpcHandle in;
+    std::memcpy(&in, ipc_handle, sizeof(in));
+    Entry* entry = nullptr;
+    if (in.pid == pid_) {
+      auto it = owned_.find(in.id);
+      CHECK(it != owned_.end()) << "Import of unknown gpu shared memory " << in.id;
+      entry = &it->second;
+      ++entry->ref;
+    } else {
+      auto key = std::make_pair(in.pid, in.id);
+      auto it = opened_.find(key);
+      if (it == opened_.end()) {
+        Entry opened;
+        CUDA_CALL(cudaIpcOpenMemHandle(&opened.dptr, in.mem, cudaIpcMemLazyEnablePeerAccess));
+        opened.mem = in.mem;
+        opened.size = in.size;
+        it = opened_.emplace(key, opened).first;
+      } else {
+        ++it->second.ref;
+      }
+      entry = &it->second;
+    }
+    handle->dptr = entry->dptr;
+    handle->size = entry->size;
+    handle->shared_pid = in.pid;
+    handle->shared_id = in.id;
+  }
+
+ private:
+  struct Entry {
+    void* dptr{nullptr};
+    cudaIpcMemHandle_t mem;
+    size_t size{0};
+    int ref{1};
+  };
+  /*! \brief pid of this process */
+  const int pid_;
+  /*! \brief shared_id of the next allocation */
+  int next_id_;
+  std::mutex mutex_;
+  /*! \brief memory allocated by this process, by shared_id */
+  std::unordered_map<int, Entry> owned_;
+  /*! \brief memory opened from other processes, by (shared_pid, shared_id) */
+  std::map<std::pair<int, int>, Entry> opened_;
+  DISALLOW_COPY_AND_ASSIGN(GPUSharedStorageManager);
+};  // class GPUSharedStorageManager
+
+}  // namespace storage
+}  // namespace mxnet
+
+#endif  // MXNET_USE_CUDA
+#endif  // MXNET_STORAGE_GPU_SHARED_STORAGE_MANAGER_H_
@@ -31,6 +31,9 @@
 #include <mxnet/base.h>
 #include <mxnet/storage.h>
 #include <unordered_map>
+#include <algorithm>
+#include <set>
+#include <utility>
 #include <vector>
 #include <mutex>
 #include <new>
@@ -44,6 +47,16 @@ namespace storage {
 #if MXNET_USE_CUDA
 /*!
  * \brief Storage manager with a memory pool on gpu.
+ *
+ *  Each device owns one instance, whose pool is guarded by its own mutex so
+ *  that workers of different GPUs do not serialize on each other. The global
+ *  gpu mutex is only taken around calls into the CUDA driver that may
+ *  synchronize the device (cudaMalloc/cudaFree), which NCCL requires.
+ *
+ *  Blocks released through FreeOnStream are tagged with the stream they were
+ *  last used on and an event recorded there. They are handed out again right
+ *  away to requests on the same stream, and to other requests only once the
+ *  event has completed.
  */
 class GPUPooledStorageManager final : public StorageManager {
  public:
@@ -57,18 +70,48 @@ class GPUPooledStorageManager final : public StorageManager {
    * \brief Default destructor.
    */
   ~GPUPooledStorageManager() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> driver_lock(Storage::Get()->GetMutex(Context::kGPU));
     ReleaseAll();
+    for (cudaEvent_t event : free_events_) {
+      cudaEventDestroy(event);
+    }
   }
 
-  void Alloc(Storage::Handle* handle) override;
-  void Free(Storage::Handle handle) override;
+  void Alloc(Storage::Handle* handle) override {
+    AllocOnStream(handle, nullptr);
+  }
+  void Free(Storage::Handle handle) override {
+    FreeOnStream(handle, nullptr);
+  }
+  void AllocOnStream(Storage::Handle* handle, void* stream) override;
+  void FreeOnStream(Storage::Handle handle, void* stream) override;
 
   void DirectFree(Storage::Handle handle) override {
-    std::lock_guard<std::mutex> lock(Storage::Get()->GetMutex(Context::kGPU));
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> driver_lock(Storage::Get()->GetMutex(Context::kGPU));
     DirectFreeNoLock(handle);
   }
 
+  bool GetPoolStats(size_t* reserved, size_t* in_use) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t pooled = 0;
+    for (auto&& i : memory_pool_) pooled += i.first * i.second.size();
+    *reserved = used_memory_;
+    *in_use = used_memory_ - pooled;
+    return true;
+  }
+
  private:
+  /*! \brief a cached block and the stream it was last used on */
+  struct PooledBlock {
+    void* dptr;
+    cudaStream_t stream;
+    // recorded on stream at free time, nullptr if the block is idle
+    cudaEvent_t event;
+  };
+
+  // requires both mutex_ and the global gpu mutex
   void DirectFreeNoLock(Storage::Handle handle) {
     cudaError_t err = cudaFree(handle.dptr);
     size_t size = handle.size + NDEV;
@@ -78,8 +121,15 @@ class GPUPooledStorageManager final : public StorageManager {
     }
     used_memory_ -= size;
   }
+  // take a reusable block out of the bucket, requires mutex_
+  bool TakeBlock(std::vector<PooledBlock>* bucket, cudaStream_t stream, void** dptr);
+  // return an event to free_events_, requires mutex_
+  void RecycleEvent(cudaEvent_t event) {
+    if (event != nullptr) free_events_.push_back(event);
+  }
 
  private:
+  // requires both mutex_ and the global gpu mutex
   void ReleaseAll();
   // used memory
   size_t used_memory_ = 0;
@@ -87,16 +137,45 @@ class GPUPooledStorageManager final : public StorageManager {
   int reserve_;
   // number of devices
   const int NDEV = 32;
+  // mutex guarding the pool of this device
+  std::mutex mutex_;
   // memory pool
-  std::unordered_map<size_t, std::vector<void*>> memory_pool_;
+  std::unordered_map<size_t, std::vector<PooledBlock>> memory_pool_;
+  // events no longer attached to a block
+  std::vector<cudaEvent_t> free_events_;
   DISALLOW_COPY_AND_ASSIGN(GPUPooledStorageManager);
 };  // class GPUPooledStorageManager
 
-void GPUPooledStorageManager::Alloc(Storage::Handle* handle) {
-  std::lock_guard<std::mutex> lock(Storage::Get()->GetMutex(Context::kGPU));
+inline bool GPUPooledStorageManager::TakeBlock(std::vector<PooledBlock>* bucket,
+                                               cudaStream_t stream, void** dptr) {
+  // newest blocks are at the back and most likely to be hot in cache
+  for (size_t i = bucket->size(); i > 0; --i) {
+    PooledBlock& block = (*bucket)[i - 1];
+    bool ready = block.event == nullptr ||
+                 (stream != nullptr && block.stream == stream);
+    if (!ready) {
+      cudaError_t e = cudaEventQuery(block.event);
+      if (e == cudaErrorNotReady) continue;
+      if (e != cudaSuccess && e != cudaErrorCudartUnloading) {
+        LOG(FATAL) << "CUDA: " << cudaGetErrorString(e);
+      }
+    }
+    *dptr = block.dptr;
+    RecycleEvent(block.event);
+    block = bucket->back();
+    bucket->pop_back();
+    return true;
+  }
+  return false;
+}
+
+inline void GPUPooledStorageManager::AllocOnStream(Storage::Handle* handle, void* stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
   size_t size = handle->size + NDEV;
   auto&& reuse_it = memory_pool_.find(size);
-  if (reuse_it == memory_pool_.end() || reuse_it->second.size() == 0) {
+  if (reuse_it == memory_pool_.end() ||
+      !TakeBlock(&reuse_it->second, static_cast<cudaStream_t>(stream), &handle->dptr)) {
+    std::lock_guard<std::mutex> driver_lock(Storage::Get()->GetMutex(Context::kGPU));
     size_t free, total;
     cudaMemGetInfo(&free, &total);
     if (free <= total * reserve_ / 100 || size > free - total * reserve_ / 100)
@@ -109,35 +188,509 @@ void GPUPooledStorageManager::Alloc(Storage::Handle* handle) {
     }
     used_memory_ += size;
     handle->dptr = ret;
-  } else {
-    auto&& reuse_pool = reuse_it->second;
-    auto ret = reuse_pool.back();
-    reuse_pool.pop_back();
-    handle->dptr = ret;
   }
 }
 
-void GPUPooledStorageManager::Free(Storage::Handle handle) {
-  std::lock_guard<std::mutex> lock(Storage::Get()->GetMutex(Context::kGPU));
+inline void GPUPooledStorageManager::FreeOnStream(Storage::Handle handle, void* stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
   size_t size = handle.size + NDEV;
-  auto&& reuse_pool = memory_pool_[size];
-  reuse_pool.push_back(handle.dptr);
+  PooledBlock block{handle.dptr, static_cast<cudaStream_t>(stream), nullptr};
+  if (block.stream != nullptr) {
+    if (free_events_.empty()) {
+      CUDA_CALL(cudaEventCreateWithFlags(&block.event, cudaEventDisableTiming));
+    } else {
+      block.event = free_events_.back();
+      free_events_.pop_back();
+    }
+    CUDA_CALL(cudaEventRecord(block.event, block.stream));
+  }
+  memory_pool_[size].push_back(block);
 }
 
-void GPUPooledStorageManager::ReleaseAll() {
+inline void GPUPooledStorageManager::ReleaseAll() {
+  // cudaFree synchronizes the device, so pending events are complete here
   for (auto&& i : memory_pool_) {
     for (auto&& j : i.second) {
       Storage::Handle handle;
-      handle.dptr = j;
+      handle.dptr = j.dptr;
       handle.size = i.first - NDEV;
       DirectFreeNoLock(handle);
+      RecycleEvent(j.event);
     }
   }
   memory_pool_.clear();
 }
 
+/*!
+ * \brief Best-fit storage manager on gpu.
+ *
+ *  Memory is obtained from cudaMalloc in large arenas
+ *  (MXNET_GPU_MEM_POOL_ARENA_SIZE, in MB) and carved into blocks whose sizes
+ *  are rounded to kRoundSize. An allocation takes the smallest free block that
+ *  fits and splits off the remainder; a freed block is coalesced with its free
+ *  neighbours in the same arena. Arenas that become completely free are only
+ *  returned to the driver when the reserve limit is hit. Like
+ *  GPUPooledStorageManager, bookkeeping is guarded per device and the global
+ *  gpu mutex is only held around driver calls.
+ *
+ *  Blocks released through FreeOnStream stay out of the free set, tagged with
+ *  the stream and an event recorded there, so they are not coalesced while in
+ *  flight. Requests on the same stream reuse them right away, the others only
+ *  once the event has completed.
+ */
+class GPUBestFitStorageManager final : public StorageManager {
+ public:
+  /*!
+   * \brief Default constructor.
+   */
+  GPUBestFitStorageManager() {
+    reserve_ = dmlc::GetEnv("MXNET_GPU_MEM_POOL_RESERVE", 5);
+    arena_size_ = static_cast<size_t>(dmlc::GetEnv("MXNET_GPU_MEM_POOL_ARENA_SIZE", 64)) << 20;
+  }
+  /*!
+   * \brief Default destructor.
+   */
+  ~GPUBestFitStorageManager() {
+    std::lock_guard<std::mutex> driver_lock(Storage::Get()->GetMutex(Context::kGPU));
+    for (auto&& arena : arenas_) {
+      cudaError_t err = cudaFree(arena.first);
+      if (err != cudaSuccess && err != cudaErrorCudartUnloading) {
+        LOG(FATAL) << "CUDA: " << cudaGetErrorString(err);
+      }
+    }
+    for (const PendingBlock& pending : pending_) cudaEventDestroy(pending.event);
+    for (cudaEvent_t event : free_events_) cudaEventDestroy(event);
+  }
+
+  void Alloc(Storage::Handle* handle) override {
+    AllocOnStream(handle, nullptr);
+  }
+  void Free(Storage::Handle handle) override {
+    FreeOnStream(handle, nullptr);
+  }
+  void AllocOnStream(Storage::Handle* handle, void* stream) override;
+  void FreeOnStream(Storage::Handle handle, void* stream) override;
+
+  void DirectFree(Storage::Handle handle) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> driver_lock(Storage::Get()->GetMutex(Context::kGPU));
+    // callers rely on the cudaFree semantics, kernels still reading the block have to
+    // finish before it can be handed out again
+    CUDA_CALL(cudaDeviceSynchronize());
+    FreeNoLock(handle.dptr);
+    ReleasePending(true);
+    ReleaseFreeArenas();
+  }
+
+  bool GetPoolStats(size_t* reserved, size_t* in_use) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *reserved = reserved_memory_;
+    *in_use = used_memory_;
+    return true;
+  }
+
+ private:
+  /*! \brief a contiguous piece of an arena */
+  struct Block {
+    char* ptr;
+    size_t size;
+    bool free;
+    Block* prev;
+    Block* next;
+  };
+  /*! \brief a block freed on a stream whose work may still use it */
+  struct PendingBlock {
+    Block* block;
+    cudaStream_t stream;
+    // recorded on stream at free time
+    cudaEvent_t event;
+  };
+  /*! \brief free blocks ordered by (size, address) for best-fit lookup */
+  typedef std::set<std::pair<size_t, char*>> FreeSet;
+
+  static size_t RoundSize(size_t size) {
+    return (std::max<size_t>(size, 1) + kRoundSize - 1) / kRoundSize * kRoundSize;
+  }
+  /*! \brief allocate a new arena large enough for size, nullptr on failure */
+  Block* NewArena(size_t size);
+  /*! \brief free a block handed out by Alloc and coalesce it, requires mutex_ */
+  void FreeNoLock(void* ptr);
+  /*! \brief put a block into the free set, merged with its free neighbours, requires mutex_ */
+  void Coalesce(Block* block);
+  /*!
+   * \brief coalesce the pending blocks whose event completed, or all of them after
+   *  waiting for their events, requires mutex_
+   */
+  void ReleasePending(bool wait);
+  /*!
+   * \brief take the smallest pending block of the stream that fits size,
+   *  nullptr if there is none, requires mutex_
+   */
+  Block* TakePending(size_t size, cudaStream_t stream);
+  /*! \brief an event to record on a stream, requires mutex_ */
+  cudaEvent_t NewEvent() {
+    cudaEvent_t event;
+    if (free_events_.empty()) {
+      CUDA_CALL(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+    } else {
+      event = free_events_.back();
+      free_events_.pop_back();
+    }
+    return event;
+  }
+  /*!
+   * \brief give every completely free arena back to the driver,
+   *  requires mutex_ and the global gpu mutex
+   */
+  void ReleaseFreeArenas();
+
+  // granularity of block sizes
+  static constexpr size_t kRoundSize = 512;
+  // bytes handed out to users
+  size_t used_memory_ = 0;
+  // bytes obtained from cudaMalloc
+  size_t reserved_memory_ = 0;
+  // percentage of reserved memory
+  int reserve_;
+  // size of a regular arena
+  size_t arena_size_;
+  // mutex guarding the arenas of this device
+  std::mutex mutex_;
+  // arena base -> head block
+  std::unordered_map<char*, Block*> arenas_;
+  // allocated pointer -> block
+  std::unordered_map<void*, Block*> allocated_;
+  // free block address -> block
+  std::unordered_map<char*, Block*> free_blocks_;
+  FreeSet free_set_;
+  // blocks freed on a stream, not yet in the free set
+  std::vector<PendingBlock> pending_;
+  // events no longer attached to a block
+  std::vector<cudaEvent_t> free_events_;
+  DISALLOW_COPY_AND_ASSIGN(GPUBestFitStorageManager);
+};  // class GPUBestFitStorageManager
+
+inline GPUBestFitStorageManager::Block* GPUBestFitStorageManager::NewArena(size_t size) {
+  std::lock_guard<std::mutex> driver_lock(Storage::Get()->GetMutex(Context::kGPU));
+  size_t bytes = std::max(size, arena_size_);
+  size_t free, total;
+  cudaMemGetInfo(&free, &total);
+  const size_t reserved = total * reserve_ / 100;
+  if (free <= reserved || bytes > free - reserved) {
+    // cudaFree synchronizes the device anyway, so the pending blocks can be waited for
+    ReleasePending(true);
+    ReleaseFreeArenas();
+    cudaMemGetInfo(&free, &total);
+    // fall back to an exact-size arena before giving up
+    if (free > reserved && bytes > free - reserved) bytes = size;
+  }
+  void* ret = nullptr;
+  cudaError_t e = cudaMalloc(&ret, bytes);
+  if (e != cudaSuccess) {
+    if (e == cudaErrorCudartUnloading) return nullptr;
+    LOG(FATAL) << "cudaMalloc failed: " << cudaGetErrorString(e);
+  }
+  reserved_memory_ += bytes;
+  Block* block = new Block{static_cast<char*>(ret), bytes, true, nullptr, nullptr};
+  arenas_[block->ptr] = block;
+  free_blocks_[block->ptr] = block;
+  free_set_.emplace(block->size, block->ptr);
+  return block;
+}
+
+inline void GPUBestFitStorageManager::AllocOnStream(Storage::Handle* handle, void* stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t size = RoundSize(handle->size);
+  ReleasePending(false);
+  Block* block = TakePending(size, static_cast<cudaStream_t>(stream));
+  if (block != nullptr) {
+    if (block->size - size >= kRoundSize) {
+      // the tail stays pending, behind the work queued on the stream so far
+      Block* rest = new Block{block->ptr + size, block->size - size, false, block, block->next};
+      if (block->next != nullptr) block->next->prev = rest;
+      block->next = rest;
+      block->size = size;
+      PendingBlock tail{rest, static_cast<cudaStream_t>(stream), NewEvent()};
+      CUDA_CALL(cudaEventRecord(tail.event, tail.stream));
+      pending_.push_back(tail);
+    }
+    allocated_[block->ptr] = block;
+    used_memory_ += block->size;
+    handle->dptr = block->ptr;
+    return;
+  }
+  auto it = free_set_.lower_bound(std::make_pair(size, static_cast<char*>(nullptr)));
+  if (it != free_set_.end()) {
+    block = free_blocks_.at(it->second);
+  } else {
+    block = NewArena(size);
+    if (block == nullptr) {
+      handle->dptr = nullptr;
+      return;
+    }
+  }
+  free_set_.erase(std::make_pair(block->size, block->ptr));
+  free_blocks_.erase(block->ptr);
+  if (block->size - size >= kRoundSize) {
+    // split off the tail as a new free block
+    Block* rest = new Block{block->ptr + size, block->size - size, true, block, block->next};
+    if (block->next != nullptr) block->next->prev = rest;
+    block->next = rest;
+    block->size = size;
+    free_blocks_[rest->ptr] = rest;
+    free_set_.emplace(rest->size, rest->ptr);
+  }
+  block->free = false;
+  allocated_[block->ptr] = block;
+  used_memory_ += block->size;
+  handle->dptr = block->ptr;
+}
+
+inline void GPUBestFitStorageManager::FreeOnStream(Storage::Handle handle, void* stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stream == nullptr) {
+    FreeNoLock(handle.dptr);
+    return;
+  }
+  if (handle.dptr == nullptr) return;
+  auto it = allocated_.find(handle.dptr);
+  CHECK(it != allocated_.end()) << "Freeing memory not allocated by this pool";
+  PendingBlock pending{it->second, static_cast<cudaStream_t>(stream), NewEvent()};
+  allocated_.erase(it);
+  used_memory_ -= pending.block->size;
+  CUDA_CALL(cudaEventRecord(pending.event, pending.stream));
+  pending_.push_back(pending);
+}
+
+inline GPUBestFitStorageManager::Block* GPUBestFitStorageManager::TakePending(
+    size_t size, cudaStream_t stream) {
+  if (stream == nullptr) return nullptr;
+  size_t best = pending_.size();
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    const PendingBlock& pending = pending_[i];
+    if (pending.stream != stream || pending.block->size < size) continue;
+    if (best == pending_.size() || pending.block->size < pending_[best].block->size) best = i;
+  }
+  if (best == pending_.size()) return nullptr;
+  Block* block = pending_[best].block;
+  free_events_.push_back(pending_[best].event);
+  pending_[best] = pending_.back();
+  pending_.pop_back();
+  return block;
+}
+
+inline void GPUBestFitStorageManager::ReleasePending(bool wait) {
+  for (size_t i = 0; i < pending_.size();) {
+    const PendingBlock& pending = pending_[i];
+    if (wait) {
+      CUDA_CALL(cudaEventSynchronize(pending.event));
+    } else {
+      cudaError_t e = cudaEventQuery(pending.event);
+      if (e == cudaErrorNotReady) {
+        ++i;
+        continue;
+      }
+      if (e != cudaSuccess && e != cudaErrorCudartUnloading) {
+        LOG(FATAL) << "CUDA: " << cudaGetErrorString(e);
+      }
+    }
+    Coalesce(pending.block);
+    free_events_.push_back(pending.event);
+    pending_[i] = pending_.back();
+    pending_.pop_back();
+  }
+}
+
+inline void GPUBestFitStorageManager::FreeNoLock(void* ptr) {
+  if (ptr == nullptr) return;
+  auto it = allocated_.find(ptr);
+  CHECK(it != allocated_.end()) << "Freeing memory not allocated by this pool";
+  Block* block = it->second;
+  allocated_.erase(it);
+  used_memory_ -= block->size;
+  Coalesce(block);
+}
+
+inline void GPUBestFitStorageManager::Coalesce(Block* block) {
+  block->free = true;
+  auto unlink_free = [this](Block* b) {
+    free_set_.erase(std::make_pair(b->size, b->ptr));
+    free_blocks_.erase(b->ptr);
+  };
+  if (block->next != nullptr && block->next->free) {
+    Block* next = block->next;
+    unlink_free(next);
+    block->size += next->size;
+    block->next = next->next;
+    if (next->next != nullptr) next->next->prev = block;
+    delete next;
+  }
+  if (block->prev != nullptr && block->prev->free) {
+    Block* prev = block->prev;
+    unlink_free(prev);
+    prev->size += block->size;
+    prev->next = block->next;
+    if (block->next != nullptr) block->next->prev = prev;
+    delete block;
+    block = prev;
+  }
+  free_blocks_[block->ptr] = block;
+  free_set_.emplace(block->size, block->ptr);
+}
+
+inline void GPUBestFitStorageManager::ReleaseFreeArenas() {
+  for (auto it = arenas_.begin(); it != arenas_.end();) {
+    Block* head = it->second;
+    if (head->free && head->next == nullptr) {
+      free_set_.erase(std::make_pair(head->size, head->ptr));
+      free_blocks_.erase(head->ptr);
+      cudaError_t err = cudaFree(head->ptr);
+      if (err != cudaSuccess && err != cudaErrorCudartUnloading) {
+        LOG(FATAL) << "CUDA: " << cudaGetErrorString(err);
+      }
+      reserved_memory_ -= head->size;
+      delete head;
+      it = arenas_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 #endif  // MXNET_USE_CUDA
 
+/*!
+ * \brief Storage manager with a memory pool on cpu.
+ *
+ *  Requested sizes are rounded up to a power of two below the linear cutoff
+ *  (MXNET_CPU_MEM_POOL_ROUND_LINEAR_CUTOFF, log2 of bytes) and to a multiple
+ *  of the cutoff above it, so buffers with slightly different sizes share a
+ *  bucket. Freed buffers are kept until the pooled bytes exceed
+ *  MXNET_CPU_MEM_POOL_RESERVE (in MB), at which point the pool is released.
+ *
+ * \tparam DeviceStorage CPUDeviceStorage or PinnedMemoryStorage.
+ */
+template <class DeviceStorage>
+class CPUPooledStorageManager final : public StorageManager {
+ public:
+  /*!
+   * \brief Default constructor.
+   */
+  CPUPooledStorageManager() {
+    reserve_ = static_cast<size_t>(dmlc::GetEnv("MXNET_CPU_MEM_POOL_RESERVE", 4096)) << 20;
+    cut_off_ = dmlc::GetEnv("MXNET_CPU_MEM_POOL_ROUND_LINEAR_CUTOFF", 24);
+    CHECK_GE(cut_off_, kMinPow2) << "MXNET_CPU_MEM_POOL_ROUND_LINEAR_CUTOFF is too small";
+    CHECK_LT(cut_off_, 48) << "MXNET_CPU_MEM_POOL_ROUND_LINEAR_CUTOFF is too large";
+  }
+  /*!
+   * \brief Default destructor.
+   */
+  ~CPUPooledStorageManager() {
+    ReleaseAll();
+  }
+
+  void Alloc(Storage::Handle* handle) override;
+  void Free(Storage::Handle handle) override;
+
+  void DirectFree(Storage::Handle handle) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DirectFreeNoLock(handle);
+  }
+
+  bool GetPoolStats(size_t* reserved, size_t* in_use) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *reserved = used_memory_;
+    *in_use = used_memory_ - pooled_memory_;
+    return true;
+  }
+
+ private:
+  /*! \brief round the requested size up to the bucket it is pooled in */
+  size_t RoundAllocSize(size_t size) const {
+    const size_t linear = static_cast<size_t>(1) << cut_off_;
+    if (size > linear) {
+      return (size + linear - 1) / linear * linear;
+    }
+    size_t bucket = static_cast<size_t>(1) << kMinPow2;
+    while (bucket < size) bucket <<= 1;
+    return bucket;
+  }
+
+  void DirectFreeNoLock(Storage::Handle handle) {
+    DeviceStorage::Free(handle.dptr);
+    used_memory_ -= RoundAllocSize(handle.size);
+  }
+
+  void ReleaseAll();
+  // bytes handed out by DeviceStorage, including the pooled ones
+  size_t used_memory_ = 0;
+  // bytes currently cached in memory_pool_
+  size_t pooled_memory_ = 0;
+  // maximum number of bytes cached before the pool is released
+  size_t reserve_;
+  // log2 of the size above which buckets are linear instead of power of two
+  int cut_off_;
+  // smallest bucket, 2^kMinPow2 bytes
+  static constexpr int kMinPow2 = 6;
+  // mutex guarding the pool, cpu pools do not share the gpu lock
+  std::mutex mutex_;
+  // memory pool, keyed by rounded size
+  std::unordered_map<size_t, std::vector<void*>> memory_pool_;
+  DISALLOW_COPY_AND_ASSIGN(CPUPooledStorageManager);
+};  // class CPUPooledStorageManager
+
+template <class DeviceStorage>
+void CPUPooledStorageManager<DeviceStorage>::Alloc(Storage::Handle* handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (handle->size == 0) {
+    handle->dptr = nullptr;
+    return;
+  }
+  const size_t size = RoundAllocSize(handle->size);
+  auto&& reuse_it = memory_pool_.find(size);
+  if (reuse_it == memory_pool_.end() || reuse_it->second.size() == 0) {
+    void* ret = nullptr;
+    try {
+      ret = DeviceStorage::Alloc(size);
+    } catch (const dmlc::Error&) {
+      // out of memory, give the cached buffers back and try once more
+      ReleaseAll();
+      ret = DeviceStorage::Alloc(size);
+    }
+    used_memory_ += size;
+    handle->dptr = ret;
+  } else {
+    auto&& reuse_pool = reuse_it->second;
+    handle->dptr = reuse_pool.back();
+    reuse_pool.pop_back();
+    pooled_memory_ -= size;
+  }
+}
+
+template <class DeviceStorage>
+void CPUPooledStorageManager<DeviceStorage>::Free(Storage::Handle handle) {
+  if (handle.dptr == nullptr) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t size = RoundAllocSize(handle.size);
+  if (pooled_memory_ + size > reserve_) {
+    ReleaseAll();
+  }
+  memory_pool_[size].push_back(handle.dptr);
+  pooled_memory_ += size;
+}
+
+template <class DeviceStorage>
+void CPUPooledStorageManager<DeviceStorage>::ReleaseAll() {
+  for (auto&& i : memory_pool_) {
+    for (auto&& j : i.second) {
+      DeviceStorage::Free(j);
+      used_memory_ -= i.first;
+    }
+  }
+  memory_pool_.clear();
+  pooled_memory_ = 0;
+}
+
 }  // namespace storage
 }  // namespace mxnet
 
@@ -21,13 +21,16 @@
  * Copyright (c) 2015 by Contributors
  */
 #include <mxnet/storage.h>
+#include <string>
 #include "./storage_manager.h"
 #include "./naive_storage_manager.h"
 #include "./pooled_storage_manager.h"
 #include "./cpu_shared_storage_manager.h"
+#include "./gpu_shared_storage_manager.h"
 #include "./cpu_device_storage.h"
 #include "./pinned_memory_storage.h"
 #include "../common/lazy_alloc_array.h"
+#include "../common/numa.h"
 #include "../profiler/storage_profiler.h"
 
 namespace mxnet {
@@ -38,7 +41,12 @@ class StorageImpl : public Storage {
   void Alloc(Handle* handle) override;
   void Free(Handle handle) override;
   void DirectFree(Handle handle) override;
+  void AllocOnStream(Handle* handle, void* stream) override;
+  void FreeOnStream(Handle handle, void* stream) override;
   void SharedIncrementRefCount(Handle handle) override;
+  void SharedAllocGPU(Handle* handle) override;
+  void SharedExportGPU(const Handle& handle, char* ipc_handle) override;
+  void SharedImportGPU(const char* ipc_handle, Handle* handle) override;
   StorageImpl() {}
   virtual ~StorageImpl() = default;
 
@@ -71,6 +79,37 @@ class StorageImpl : public Storage {
         LOG(FATAL) << "Unimplemented device";
     }
   }
+  /*!
+   * \brief Create the storage manager for a cpu-side context.
+   * \param env_name environment variable selecting "Naive" or "Pooled"
+   */
+  template <class DeviceStorage>
+  static storage::StorageManager* CreateCPUStorageManager(const char* env_name) {
+    std::string type = dmlc::GetEnv(env_name, std::string("Naive"));
+    if (type == "Pooled") {
+      return new storage::CPUPooledStorageManager<DeviceStorage>();
+    }
+    if (type != "Naive") {
+      LOG(WARNING) << "Unknown " << env_name << " " << type
+                   << ", falling back to Naive";
+    }
+    return new storage::NaiveStorageManager<DeviceStorage>();
+  }
+  /*! \brief whether a handle is gpu memory of the gpu shared storage managers */
+  static bool IsGPUShared(const Handle& handle) {
+    return handle.ctx.dev_type == Context::kGPU && handle.shared_pid != -1;
+  }
+#if MXNET_USE_CUDA
+  /*! \brief gpu shared storage manager of the device of a gpu ctx */
+  std::shared_ptr<storage::GPUSharedStorageManager> GPUSharedManager(const Context& ctx) {
+    CHECK_EQ(ctx.dev_type, Context::kGPU) << "GPU shared memory needs a gpu context";
+    return gpu_shared_managers_.Get(ctx.real_dev_id(), []() {
+        return new storage::GPUSharedStorageManager();
+      });
+  }
+  // gpu memory shared with other processes, by device
+  common::LazyAllocArray<storage::GPUSharedStorageManager> gpu_shared_managers_;
+#endif  // MXNET_USE_CUDA
   // internal storage managers
   std::array<common::LazyAllocArray<storage::StorageManager>,
              kMaxNumberOfDevices> storage_managers_;
@@ -80,7 +119,35 @@ class StorageImpl : public Storage {
 int StorageImpl::num_gpu_device = 0;
 #endif  // MXNET_USE_CUDA
 
+namespace {
+MX_THREAD_LOCAL const char* alloc_scope_name = nullptr;
+MX_THREAD_LOCAL Storage::Category alloc_scope_category = Storage::kOther;
+}  // namespace
+
+Storage::AllocScope::AllocScope(const char* name, Category category)
+    : prev_name_(alloc_scope_name), prev_category_(alloc_scope_category) {
+  if (name != nullptr) alloc_scope_name = name;
+  alloc_scope_category = category;
+}
+
+Storage::AllocScope::~AllocScope() {
+  alloc_scope_name = prev_name_;
+  alloc_scope_category = prev_category_;
+}
+
+const char* Storage::AllocScope::name() {
+  return alloc_scope_name;
+}
+
+Storage::Category Storage::AllocScope::category() {
+  return alloc_scope_category;
+}
+
 void StorageImpl::Alloc(Storage::Handle* handle) {
+  AllocOnStream(handle, nullptr);
+}
+
+void StorageImpl::AllocOnStream(Storage::Handle* handle, void* stream) {
   // space already recycled, ignore request
   auto&& device = storage_managers_.at(handle->ctx.dev_type);
   std::shared_ptr<storage::StorageManager> manager = device.Get(
@@ -88,7 +155,8 @@ void StorageImpl::Alloc(Storage::Handle* handle) {
         storage::StorageManager *ptr = nullptr;
         switch (handle->ctx.dev_type) {
           case Context::kCPU: {
-            ptr = new storage::NaiveStorageManager<storage::CPUDeviceStorage>();
+            ptr = CreateCPUStorageManager<storage::CPUDeviceStorage>(
+                "MXNET_CPU_MEM_POOL_TYPE");
             break;
           }
           case Context::kCPUShared: {
@@ -105,12 +173,15 @@ void StorageImpl::Alloc(Storage::Handle* handle) {
               num_gpu_device = 0;
             }
             if (num_gpu_device > 0) {
-              ptr = new storage::NaiveStorageManager<storage::PinnedMemoryStorage>();
+              ptr = CreateCPUStorageManager<storage::PinnedMemoryStorage>(
+                  "MXNET_CPU_PINNED_MEM_POOL_TYPE");
             } else {
-              ptr = new storage::NaiveStorageManager<storage::CPUDeviceStorage>();
+              ptr = CreateCPUStorageManager<storage::CPUDeviceStorage>(
+                  "MXNET_CPU_PINNED_MEM_POOL_TYPE");
             }
 #else
-            ptr = new storage::NaiveStorageManager<storage::CPUDeviceStorage>();
+            ptr = CreateCPUStorageManager<storage::CPUDeviceStorage>(
+                "MXNET_CPU_PINNED_MEM_POOL_TYPE");
 #endif  // MXNET_USE_CUDA
             break;
           }
@@ -118,7 +189,16 @@ void StorageImpl::Alloc(Storage::Handle* handle) {
 #if MXNET_USE_CUDA
             CUDA_CALL(cudaGetDeviceCount(&num_gpu_device));
             CHECK_GT(num_gpu_device, 0) << "GPU usage requires at least 1 GPU";
-            ptr = new storage::GPUPooledStorageManager();
+            std::string type = dmlc::GetEnv("MXNET_GPU_MEM_POOL_TYPE", std::string("Naive"));
+            if (type == "BestFit") {
+              ptr = new storage::GPUBestFitStorageManager();
+            } else {
+              if (type != "Naive") {
+                LOG(WARNING) << "Unknown MXNET_GPU_MEM_POOL_TYPE " << type
+                             << ", falling back to Naive";
+              }
+              ptr = new storage::GPUPooledStorageManager();
+            }
 #else
             LOG(FATAL) << "Compile with USE_CUDA=1 to enable GPU usage";
 #endif  // MXNET_USE_CUDA
@@ -130,11 +210,25 @@ void StorageImpl::Alloc(Storage::Handle* handle) {
       });
 
   this->ActivateDevice(handle->ctx);
-  manager->Alloc(handle);
-  profiler_.OnAlloc(*handle);
+  manager->AllocOnStream(handle, stream);
+  if (handle->ctx.dev_type == Context::kCPU) {
+    // place the pages of cpu(i) on the NUMA node its workers are pinned to
+    const int node = common::numa::NodeOfDevice(handle->ctx.dev_id);
+    if (node >= 0) common::numa::PreferNodeForMemory(handle->dptr, handle->size, node);
+  }
+  profiler_.OnAlloc(handle);
+  profiler_.OnPoolStats(handle->ctx, manager.get());
 }
 
 void StorageImpl::Free(Storage::Handle handle) {
+  FreeOnStream(handle, nullptr);
+}
+
+void StorageImpl::FreeOnStream(Storage::Handle handle, void* stream) {
+  if (IsGPUShared(handle)) {
+    DirectFree(handle);
+    return;
+  }
   const Context &ctx = handle.ctx;
   auto&& device = storage_managers_.at(ctx.dev_type);
   std::shared_ptr<storage::StorageManager> manager = device.Get(
@@ -143,12 +237,20 @@ void StorageImpl::Free(Storage::Handle handle) {
         return nullptr;
       });
   this->ActivateDevice(ctx);
-  manager->Free(handle);
+  manager->FreeOnStream(handle, stream);
   profiler_.OnFree(handle);
+  profiler_.OnPoolStats(ctx, manager.get());
 }
 
 void StorageImpl::DirectFree(Storage::Handle handle) {
   const Context &ctx = handle.ctx;
+  if (IsGPUShared(handle)) {
+#if MXNET_USE_CUDA
+    this->ActivateDevice(ctx);
+    GPUSharedManager(ctx)->Free(handle);
+#endif  // MXNET_USE_CUDA
+    return;
+  }
   auto&& device = storage_managers_.at(ctx.dev_type);
   std::shared_ptr<storage::StorageManager> manager = device.Get(
       ctx.real_dev_id(), []() {
@@ -158,6 +260,7 @@ void StorageImpl::DirectFree(Storage::Handle handle) {
   this->ActivateDevice(ctx);
   manager->DirectFree(handle);
   profiler_.OnFree(handle);
+  profiler_.OnPoolStats(ctx, manager.get());
 }
 
 void StorageImpl::SharedIncrementRefCount(Storage::Handle handle) {
@@ -174,6 +277,31 @@ void StorageImpl::SharedIncrementRefCount(Storage::Handle handle) {
 #endif  // defined(ANDROID) || defined(__ANDROID__)
 }
 
+void StorageImpl::SharedAllocGPU(Storage::Handle* handle) {
+#if MXNET_USE_CUDA
+  this->ActivateDevice(handle->ctx);
+  GPUSharedManager(handle->ctx)->Alloc(handle);
+#else
+  LOG(FATAL) << "Compile with USE_CUDA=1 to enable GPU usage";
+#endif  // MXNET_USE_CUDA
+}
+
+void StorageImpl::SharedExportGPU(const Storage::Handle& handle, char* ipc_handle) {
+  CHECK(IsGPUShared(handle)) << "Only memory of SharedAllocGPU can be exported";
+#if MXNET_USE_CUDA
+  GPUSharedManager(handle.ctx)->Export(handle, ipc_handle);
+#endif  // MXNET_USE_CUDA
+}
+
+void StorageImpl::SharedImportGPU(const char* ipc_handle, Storage::Handle* handle) {
+#if MXNET_USE_CUDA
+  this->ActivateDevice(handle->ctx);
+  GPUSharedManager(handle->ctx)->Import(ipc_handle, handle);
+#else
+  LOG(FATAL) << "Compile with USE_CUDA=1 to enable GPU usage";
+#endif  // MXNET_USE_CUDA
+}
+
 std::shared_ptr<Storage> Storage::_GetSharedRef() {
 #ifdef __MXNET_JS__
   // dummy code needed for emscripten code to pass
@@ -55,6 +55,32 @@ class StorageManager {
    * \param size Size of the storage.
    */
   virtual void DirectFree(Storage::Handle handle) = 0;
+  /*!
+   * \brief Allocation for use on a device stream.
+   *  Managers that track streams may hand out memory still in flight on it.
+   * \param handle Handle initialized with size and ctx.
+   * \param stream The cudaStream_t the memory will be used on.
+   */
+  virtual void AllocOnStream(Storage::Handle* handle, void* stream) {
+    Alloc(handle);
+  }
+  /*!
+   * \brief Deallocation of memory that may still be in use on a device stream.
+   * \param handle Handle to the storage.
+   * \param stream The cudaStream_t the memory was last used on.
+   */
+  virtual void FreeOnStream(Storage::Handle handle, void* stream) {
+    Free(handle);
+  }
+  /*!
+   * \brief Query pool occupancy.
+   * \param reserved Bytes obtained from the device, including cached blocks.
+   * \param in_use Bytes currently handed out to users.
+   * \return false if the manager does not pool memory.
+   */
+  virtual bool GetPoolStats(size_t* reserved, size_t* in_use) {
+    return false;
+  }
   /*!
    * \brief Destructor.
    */
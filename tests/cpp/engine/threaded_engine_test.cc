@@ -29,12 +29,17 @@
 #include <gtest/gtest.h>
 #include <mxnet/engine.h>
 #include <dmlc/timer.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <memory>
 #include <thread>
 #include <chrono>
+#include <utility>
 #include <vector>
 
 #include "../src/engine/engine_impl.h"
+#include "../src/engine/openmp.h"
 #include "../include/test_util.h"
 
 /**
@@ -124,7 +129,7 @@ double EvaluateWorloads(const std::vector<Workload>& workloads,
 TEST(Engine, RandSumExpr) {
   std::vector<Workload> workloads;
   int num_repeat = 5;
-  const int num_engine = 4;
+  const int num_engine = 5;
 
   std::vector<double> t(num_engine, 0.0);
   std::vector<mxnet::Engine*> engine(num_engine);
@@ -133,6 +138,7 @@ TEST(Engine, RandSumExpr) {
   engine[1] = mxnet::engine::CreateNaiveEngine();
   engine[2] = mxnet::engine::CreateThreadedEnginePooled();
   engine[3] = mxnet::engine::CreateThreadedEnginePerDevice();
+  engine[4] = mxnet::engine::CreateThreadedEngineStealing();
 
   for (int repeat = 0; repeat < num_repeat; ++repeat) {
     srand(time(NULL) + repeat);
@@ -155,6 +161,60 @@ TEST(Engine, RandSumExpr) {
   LOG(INFO) << "NaiveEngine\t\t"  << t[1] << " sec";
   LOG(INFO) << "ThreadedEnginePooled\t" << t[2] << " sec";
   LOG(INFO) << "ThreadedEnginePerDevice\t" << t[3] << " sec";
+  LOG(INFO) << "ThreadedEngineStealing\t" << t[4] << " sec";
+}
+
+/**
+ * push reads of a shared variable interleaved with writes to it, check every
+ * read sees the writes pushed before it, and report the push/complete rate
+ */
+double EvaluateReadWriteThroughput(mxnet::Engine* engine, int num_ops, int write_every) {
+  using namespace mxnet;
+  std::vector<Engine::VarHandle> weights;
+  for (int i = 0; i < 4; ++i) weights.push_back(engine->NewVariable());
+  Engine::VarHandle counter_var = engine->NewVariable();
+  int counter = 0;
+  std::atomic<int> mismatches(0);
+  double t = dmlc::GetTime();
+  for (int i = 0, writes = 0; i < num_ops; ++i) {
+    if (i % write_every == 0) {
+      ++writes;
+      engine->PushAsync([&counter](RunContext ctx, Engine::CallbackOnComplete cb) {
+        ++counter; cb();
+      }, Context::CPU(), {}, {counter_var});
+    } else {
+      std::vector<Engine::VarHandle> reads = weights;
+      reads.push_back(counter_var);
+      engine->PushAsync([&counter, &mismatches, writes](RunContext ctx,
+                                                        Engine::CallbackOnComplete cb) {
+        if (counter != writes) ++mismatches;
+        cb();
+      }, Context::CPU(), reads, {});
+    }
+  }
+  engine->WaitForAll();
+  t = dmlc::GetTime() - t;
+  EXPECT_EQ(mismatches.load(), 0);
+  for (auto var : weights) engine->DeleteVariable([](RunContext) {}, Context::CPU(), var);
+  engine->DeleteVariable([](RunContext) {}, Context::CPU(), counter_var);
+  engine->WaitForAll();
+  return num_ops / t;
+}
+
+TEST(Engine, ReadWriteThroughput) {
+  const int num_ops = 100000;
+  std::vector<std::pair<const char*, mxnet::Engine*>> engines = {
+    {"ThreadedEnginePooled\t", mxnet::engine::CreateThreadedEnginePooled()},
+    {"ThreadedEnginePerDevice\t", mxnet::engine::CreateThreadedEnginePerDevice()},
+    {"ThreadedEngineStealing\t", mxnet::engine::CreateThreadedEngineStealing()}};
+  for (const auto& engine : engines) {
+    // mostly reads, as imperative code reading weights, and write heavy
+    for (int write_every : {100, 2}) {
+      LOG(INFO) << engine.first << "1 write in " << write_every << ": "
+                << EvaluateReadWriteThroughput(engine.second, num_ops, write_every)
+                << " ops/sec";
+    }
+  }
 }
 
 void Foo(mxnet::RunContext, int i) { printf("The fox says %d\n", i); }
@@ -258,6 +318,44 @@ TEST(Engine, basics) {
   LOG(INFO) << "All pass";
 }
 
+TEST(Engine, IsVarReady) {
+  std::unique_ptr<mxnet::Engine> engine(mxnet::engine::CreateThreadedEnginePerDevice());
+  auto&& var = engine->NewVariable();
+  ASSERT_TRUE(engine->IsVarReady(var));
+  std::atomic<bool> release{false};
+  engine->PushSync([&release](mxnet::RunContext) {
+      while (!release.load()) std::this_thread::yield();
+    }, mxnet::Context{}, {}, {var});
+  // the write holds the var until it is released
+  ASSERT_FALSE(engine->IsVarReady(var));
+  release.store(true);
+  engine->WaitForVar(var);
+  ASSERT_TRUE(engine->IsVarReady(var));
+  engine->DeleteVariable([](mxnet::RunContext) {}, mxnet::Context{}, var);
+  engine->WaitForAll();
+}
+
+TEST(Engine, VarVersion) {
+  std::vector<std::unique_ptr<mxnet::Engine> > engines;
+  engines.emplace_back(mxnet::engine::CreateNaiveEngine());
+  engines.emplace_back(mxnet::engine::CreateThreadedEnginePerDevice());
+  for (auto& engine : engines) {
+    auto&& var = engine->NewVariable();
+    ASSERT_EQ(var->version(), 0U);
+    // reads leave the version alone, every completed write advances it
+    engine->PushSync([](mxnet::RunContext) {}, mxnet::Context{}, {var}, {});
+    engine->WaitForVar(var);
+    ASSERT_EQ(var->version(), 0U);
+    for (int i = 0; i < 3; ++i) {
+      engine->PushSync([](mxnet::RunContext) {}, mxnet::Context{}, {}, {var});
+    }
+    engine->WaitForVar(var);
+    ASSERT_EQ(var->version(), 3U);
+    engine->DeleteVariable([](mxnet::RunContext) {}, mxnet::Context{}, var);
+    engine->WaitForAll();
+  }
+}
+
 #ifdef _OPENMP
 
 struct TestSaveAndRestoreOMPState {
@@ -312,4 +410,22 @@ TEST(Engine, omp_threading_count_scope) {
   threads->join_all();
   GTEST_ASSERT_EQ(correct.load(), THREAD_COUNT);
 }
+
+/*!
+ * \brief This test checks that concurrent operations split the recommended OMP thread count
+ */
+TEST(Engine, omp_core_budget) {
+  if (getenv("OMP_NUM_THREADS") != nullptr || !mxnet::engine::OpenMP::Get()->enabled()) {
+    return;
+  }
+  mxnet::engine::OpenMP* omp = mxnet::engine::OpenMP::Get();
+  const int full = omp->GetRecommendedOMPThreadCount();
+  {
+    mxnet::engine::OpenMP::OpScope first;
+    EXPECT_EQ(omp->GetRecommendedOMPThreadCount(), full);
+    mxnet::engine::OpenMP::OpScope second;
+    EXPECT_EQ(omp->GetRecommendedOMPThreadCount(), std::max(1, full / 2));
+  }
+  EXPECT_EQ(omp->GetRecommendedOMPThreadCount(), full);
+}
 #endif  // _OPENMP
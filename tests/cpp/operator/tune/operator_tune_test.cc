@@ -19,6 +19,7 @@
 #include <gtest/gtest.h>
 #include <mxnet/tensor_blob.h>
 #include "../../src/operator/nn/activation-inl.h"
+#include "../../src/operator/mshadow_op.h"
 #include "../../src/operator/operator_tune-inl.h"
 #include "../include/test_op_runner.h"
 #include "../include/test_core_op.h"
@@ -39,6 +40,23 @@ TEST(OMP_TUNING, ShowAllTunedOps) {
   }
 }
 
+/*!
+ * \brief The recommended thread count grows with the number of iterations and stays
+ *        within the threads available
+ */
+TEST(OMP_TUNING, ThreadCountGrowsWithSize) {
+  typedef mxnet::op::mxnet_op::tuned_op<mxnet::op::mshadow_op::plus, float> tuned_plus;
+  const size_t max_threads = 32;
+  size_t prev = 1;
+  for (size_t n = 1; n <= (size_t(1) << 28); n <<= 2) {
+    const size_t threads = tuned_plus::OMPThreadCount(n, max_threads);
+    EXPECT_GE(threads, prev);
+    EXPECT_LE(threads, max_threads);
+    EXPECT_EQ(tuned_plus::OMPThreadCount(n, 1), 1U);
+    prev = threads;
+  }
+}
+
 using kwargs_t = test::op::kwargs_t;
 
 static std::vector<std::vector<TShape>> tuning_shapes() {
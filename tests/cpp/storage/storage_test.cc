@@ -27,6 +27,8 @@
 #include <mxnet/storage.h>
 #include <cstdio>
 #include "test_util.h"
+#include "../../src/storage/pooled_storage_manager.h"
+#include "../../src/storage/cpu_device_storage.h"
 
 TEST(Storage, Basic_CPU) {
   constexpr size_t kSize = 1024;
@@ -42,6 +44,26 @@ TEST(Storage, Basic_CPU) {
   storage->Free(handle);
 }
 
+TEST(Storage, Pooled_CPU) {
+  mxnet::storage::CPUPooledStorageManager<mxnet::storage::CPUDeviceStorage> manager;
+  mxnet::Storage::Handle handle;
+  handle.ctx = mxnet::Context::CPU();
+  handle.size = 1000;
+  manager.Alloc(&handle);
+  auto ptr = handle.dptr;
+  EXPECT_NE(ptr, nullptr);
+  manager.Free(handle);
+  // a slightly different size falls into the same bucket and is reused
+  handle.size = 1024;
+  manager.Alloc(&handle);
+  EXPECT_EQ(handle.dptr, ptr);
+  manager.Free(handle);
+  handle.size = 4096;
+  manager.Alloc(&handle);
+  EXPECT_NE(handle.dptr, ptr);
+  manager.DirectFree(handle);
+}
+
 #if MXNET_USE_CUDA
 TEST(Storage, Basic_GPU) {
   if (mxnet::test::unitTestsWithCuda) {
@@ -60,5 +82,34 @@ TEST(Storage, Basic_GPU) {
     storage->Free(handle);
   }
 }
+
+TEST(Storage, BestFit_GPU_Stream) {
+  if (mxnet::test::unitTestsWithCuda) {
+    CUDA_CALL(cudaSetDevice(0));
+    cudaStream_t s1, s2;
+    CUDA_CALL(cudaStreamCreate(&s1));
+    CUDA_CALL(cudaStreamCreate(&s2));
+    {
+      mxnet::storage::GPUBestFitStorageManager manager;
+      mxnet::Storage::Handle handle;
+      handle.ctx = mxnet::Context::GPU(0);
+      handle.size = 1 << 20;
+      manager.AllocOnStream(&handle, s1);
+      auto ptr = handle.dptr;
+      manager.FreeOnStream(handle, s1);
+      // the same stream reuses the block right away, even if its work is in flight
+      manager.AllocOnStream(&handle, s1);
+      EXPECT_EQ(handle.dptr, ptr);
+      manager.FreeOnStream(handle, s1);
+      // another stream gets it once the work of the first one is done
+      CUDA_CALL(cudaStreamSynchronize(s1));
+      manager.AllocOnStream(&handle, s2);
+      EXPECT_EQ(handle.dptr, ptr);
+      manager.DirectFree(handle);
+    }
+    CUDA_CALL(cudaStreamDestroy(s1));
+    CUDA_CALL(cudaStreamDestroy(s2));
+  }
+}
 #endif  // MXNET_USE_CUDA
 
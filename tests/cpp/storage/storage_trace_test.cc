@@ -0,0 +1,236 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file storage_trace_test.cc
+ * \brief replay of allocation traces against the storage managers
+ *
+ *  Traces are written by setting MXNET_STORAGE_TRACE_FILE for a training or
+ *  inference run and replayed by pointing MXNET_STORAGE_BENCH_TRACE at the file,
+ *  otherwise a synthetic trace shaped like the one of an executor is replayed.
+ *  Run with --perf for the long synthetic trace.
+ */
+#include <gtest/gtest.h>
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <mxnet/storage.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "test_util.h"
+#include "../../src/storage/naive_storage_manager.h"
+#include "../../src/storage/pooled_storage_manager.h"
+#include "../../src/storage/cpu_device_storage.h"
+#include "../../src/storage/gpu_device_storage.h"
+
+using mxnet::Context;
+using mxnet::Storage;
+using mxnet::storage::StorageManager;
+
+namespace {
+struct TraceEvent {
+  bool alloc;
+  uint64_t id;
+  size_t size;
+};
+
+/*! \brief the events of the first device of a type in a recorded trace */
+std::vector<TraceEvent> ReadTrace(const std::string& path, int dev_type) {
+  std::ifstream is(path);
+  CHECK(is.good()) << "Cannot open the storage trace " << path;
+  std::vector<TraceEvent> trace;
+  char op;
+  int type, dev_id, first_dev_id = -1;
+  uint64_t id;
+  size_t size;
+  while (is >> op >> type >> dev_id >> id >> size) {
+    if (type != dev_type) continue;
+    if (first_dev_id == -1) first_dev_id = dev_id;
+    if (dev_id != first_dev_id) continue;
+    trace.push_back({op == 'a', id, size});
+  }
+  return trace;
+}
+
+/*!
+ * \brief a trace like the one of an executor: parameters allocated once, then for
+ *  every iteration activations of varying sizes freed roughly in reverse order,
+ *  with short lived workspaces in between
+ */
+std::vector<TraceEvent> SyntheticTrace(int iterations) {
+  std::mt19937 rng(17);
+  std::uniform_int_distribution<size_t> weight_size(1 << 10, 1 << 20);
+  std::uniform_int_distribution<size_t> activation_size(1 << 12, 1 << 21);
+  std::uniform_int_distribution<int> coin(0, 3);
+  std::vector<TraceEvent> trace;
+  uint64_t next_id = 0;
+  for (int i = 0; i < 32; ++i) trace.push_back({true, next_id++, weight_size(rng)});
+  for (int it = 0; it < iterations; ++it) {
+    std::vector<TraceEvent> live;
+    for (int layer = 0; layer < 48; ++layer) {
+      live.push_back({true, next_id++, activation_size(rng)});
+      trace.push_back(live.back());
+      if (coin(rng) == 0) {
+        const TraceEvent workspace{true, next_id++, activation_size(rng) * 2};
+        trace.push_back(workspace);
+        trace.push_back({false, workspace.id, workspace.size});
+      }
+    }
+    while (!live.empty()) {
+      // every few frees one of an earlier layer, as with skip connections
+      auto it_free = live.end() - 1;
+      if (live.size() > 2 && coin(rng) == 0) it_free -= 2;
+      trace.push_back({false, it_free->id, it_free->size});
+      live.erase(it_free);
+    }
+  }
+  return trace;
+}
+
+struct ReplayStats {
+  size_t allocs{0}, frees{0};
+  uint64_t alloc_ns{0}, free_ns{0}, max_alloc_ns{0}, max_free_ns{0};
+  size_t peak_used{0}, peak_reserved{0};
+};
+
+/*! \brief replay the trace, the memory still in use at its end is given back */
+ReplayStats Replay(StorageManager* manager, const Context& ctx,
+                   const std::vector<TraceEvent>& trace) {
+  using clock = std::chrono::steady_clock;
+  ReplayStats stats;
+  std::unordered_map<uint64_t, Storage::Handle> live;
+  size_t used = 0;
+  for (const TraceEvent& ev : trace) {
+    if (ev.alloc) {
+      Storage::Handle handle;
+      handle.ctx = ctx;
+      handle.size = ev.size;
+      const auto start = clock::now();
+      manager->Alloc(&handle);
+      const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          clock::now() - start).count();
+      stats.alloc_ns += ns;
+      stats.max_alloc_ns = std::max(stats.max_alloc_ns, ns);
+      ++stats.allocs;
+      live[ev.id] = handle;
+      used += ev.size;
+    } else {
+      // memory allocated before the trace started is skipped
+      auto it = live.find(ev.id);
+      if (it == live.end()) continue;
+      const auto start = clock::now();
+      manager->Free(it->second);
+      const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          clock::now() - start).count();
+      stats.free_ns += ns;
+      stats.max_free_ns = std::max(stats.max_free_ns, ns);
+      ++stats.frees;
+      used -= it->second.size;
+      live.erase(it);
+    }
+    size_t reserved, in_use;
+    if (!manager->GetPoolStats(&reserved, &in_use)) reserved = used;
+    stats.peak_used = std::max(stats.peak_used, used);
+    stats.peak_reserved = std::max(stats.peak_reserved, reserved);
+  }
+  for (auto& kv : live) manager->DirectFree(kv.second);
+  return stats;
+}
+
+void Report(const std::string& name, const ReplayStats& stats) {
+  const double mb = 1 << 20;
+  std::cout << std::left << std::setw(28) << name << std::fixed << std::setprecision(1)
+            << " alloc " << stats.alloc_ns / std::max<size_t>(stats.allocs, 1) << " ns avg, "
+            << stats.max_alloc_ns << " ns max; free "
+            << stats.free_ns / std::max<size_t>(stats.frees, 1) << " ns avg, "
+            << stats.max_free_ns << " ns max; peak used " << stats.peak_used / mb
+            << " MB, peak reserved " << stats.peak_reserved / mb << " MB, fragmentation "
+            << std::setprecision(3)
+            << (stats.peak_reserved == 0 ? 0.0 :
+                1.0 - static_cast<double>(stats.peak_used) / stats.peak_reserved)
+            << std::endl;
+}
+
+std::vector<TraceEvent> BenchTrace(int dev_type) {
+  const std::string path = dmlc::GetEnv("MXNET_STORAGE_BENCH_TRACE", std::string());
+  if (!path.empty()) return ReadTrace(path, dev_type);
+  return SyntheticTrace(mxnet::test::performance_run ? 200 : 4);
+}
+
+void ExpectConsistent(const ReplayStats& stats, const std::vector<TraceEvent>& trace) {
+  size_t allocs = 0;
+  for (const TraceEvent& ev : trace) allocs += ev.alloc;
+  EXPECT_EQ(stats.allocs, allocs);
+  EXPECT_LE(stats.frees, stats.allocs);
+  EXPECT_GE(stats.peak_reserved, stats.peak_used);
+}
+}  // namespace
+
+TEST(Storage, TraceReplay_CPU) {
+  const std::vector<TraceEvent> trace = BenchTrace(Context::kCPU);
+  const Context ctx = Context::CPU();
+  {
+    mxnet::storage::NaiveStorageManager<mxnet::storage::CPUDeviceStorage> naive;
+    const ReplayStats stats = Replay(&naive, ctx, trace);
+    Report("cpu Naive", stats);
+    ExpectConsistent(stats, trace);
+    EXPECT_EQ(stats.peak_reserved, stats.peak_used);
+  }
+  {
+    mxnet::storage::CPUPooledStorageManager<mxnet::storage::CPUDeviceStorage> pooled;
+    const ReplayStats stats = Replay(&pooled, ctx, trace);
+    Report("cpu Pooled", stats);
+    ExpectConsistent(stats, trace);
+  }
+}
+
+#if MXNET_USE_CUDA
+TEST(Storage, TraceReplay_GPU) {
+  if (!mxnet::test::unitTestsWithCuda) return;
+  const std::vector<TraceEvent> trace = BenchTrace(Context::kGPU);
+  const Context ctx = Context::GPU(0);
+  CUDA_CALL(cudaSetDevice(0));
+  {
+    mxnet::storage::NaiveStorageManager<mxnet::storage::GPUDeviceStorage> direct;
+    const ReplayStats stats = Replay(&direct, ctx, trace);
+    Report("gpu cudaMalloc", stats);
+    ExpectConsistent(stats, trace);
+  }
+  {
+    mxnet::storage::GPUPooledStorageManager pooled;
+    const ReplayStats stats = Replay(&pooled, ctx, trace);
+    Report("gpu Naive (exact size)", stats);
+    ExpectConsistent(stats, trace);
+  }
+  {
+    mxnet::storage::GPUBestFitStorageManager best_fit;
+    const ReplayStats stats = Replay(&best_fit, ctx, trace);
+    Report("gpu BestFit", stats);
+    ExpectConsistent(stats, trace);
+  }
+}
+#endif  // MXNET_USE_CUDA
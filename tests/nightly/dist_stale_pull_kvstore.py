@@ -0,0 +1,63 @@
+#!/usr/bin/env python
+
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# pylint: skip-file
+import os
+import sys
+sys.path.insert(0, "../../python/")
+# read when the kvstore is created
+os.environ['MXNET_KVSTORE_STALE_PULL'] = '1'
+import mxnet as mx
+import numpy as np
+
+def check_diff(A, x, rank=None):
+    """ assert A == x
+        x can be scalar as well as numpy array
+    """
+    assert (np.sum(np.abs((A - x).asnumpy())) == 0), (rank, A.asnumpy(), x.asnumpy())
+
+shape = (2, 3)
+big_shape = (1200, 1200)        # bigger than MXNET_KVSTORE_BIGARRAY_BOUND
+keys_shapes = [('3', shape), ('5', shape), ('99', big_shape)]
+rate = 2
+
+kv = mx.kv.create('dist_sync')
+my_rank = kv.rank
+nworker = kv.num_workers
+
+def test_stale_pull(nrepeat):
+    for k, s in keys_shapes:
+        kv.init(k, mx.nd.ones(s))
+    kv.set_optimizer(mx.optimizer.create('test', rescale_grad=rate))
+    # the weights after i pushes of the gradients of all workers
+    weight = lambda i: (nworker + 1) * nworker * rate / 2 * i + 1
+    for k, s in keys_shapes:
+        val = mx.nd.zeros(s)
+        for i in range(nrepeat):
+            kv.push(k, mx.nd.ones(s) * (my_rank + 1))
+            kv.pull(k, out=val)
+            # the first pull is waited for, later ones hand out the weights
+            # the previous pull brought in, never the pushed gradients
+            check_diff(val, weight(max(i, 1)), my_rank)
+        kv.pull(k, out=val)
+        check_diff(val, weight(nrepeat), my_rank)
+    print('worker ' + str(my_rank) + ' is done with stale pulls')
+
+if __name__ == "__main__":
+    test_stale_pull(4)
@@ -211,6 +211,31 @@ def test_compress_kvstore(kv_type, compression='2bit', threshold=0.5):
     check_compr_random(kv, threshold)
 
 ## group keys interface
+def test_topk_kvstore(kv_type, ratio=0.25):
+    print(kv_type + ' with topk compression')
+    kv = mx.kv.create(kv_type)
+    kv.set_gradient_compression({'type':'topk', 'ratio':ratio})
+    kv.set_optimizer(mx.optimizer.create('test', rescale_grad=1))
+    # blocks of 1/ratio values, a single nonzero value per block survives
+    # compression exactly
+    block = int(1 / ratio)
+    for k, s in zip(keys, shapes):
+        kv.init(k, mx.nd.zeros(s))
+    for j in range(len(keys)):
+        size = int(np.prod(shapes[j]))
+        grads = []
+        for g in range(nworker):
+            grad = np.zeros(size)
+            for start in range(0, size, block):
+                end = min(start + block, size)
+                grad[np.random.randint(start, end)] = np.random.random() * 2 - 1
+            grads.append(grad.reshape(shapes[j]))
+        kv.push(keys[j], [mx.nd.array(grads[g], mx.gpu(g)) for g in range(nworker)])
+        out = [mx.nd.zeros(shapes[j], mx.gpu(g)) for g in range(nworker)]
+        kv.pull(keys[j], out=out)
+        for o in out:
+            assert_almost_equal(o.asnumpy(), sum(grads), rtol=1e-5, atol=1e-6)
+
 def test_group_kvstore(kv_type):
     print(kv_type)
     kv = mx.kv.create(kv_type)
@@ -250,6 +275,7 @@ if __name__ == "__main__":
 
     # compression for local kvstore happens only when reduce is on device
     test_compress_kvstore('local_allreduce_device')
+    test_topk_kvstore('local_allreduce_device')
 
     test_group_kvstore('local_update_cpu')
     test_group_kvstore('local_allreduce_cpu')
@@ -1022,6 +1022,28 @@ def test_global_pooling():
     test_2d_pooling('sum')
 
 
+@with_seed()
+def test_pooling_channel_last():
+    for data_shape, kernel, layout, axes in [((2, 3, 9, 10), (3, 2), 'NHWC', (0, 2, 3, 1)),
+                                             ((2, 3, 5, 6, 7), (2, 3, 2), 'NDHWC', (0, 2, 3, 4, 1))]:
+        for pool_type in ['max', 'avg']:
+            for global_pool in [False, True]:
+                x = mx.nd.random.uniform(shape=data_shape, ctx=mx.gpu(0))
+                x_last = mx.nd.transpose(x, axes=axes)
+                x.attach_grad()
+                x_last.attach_grad()
+                kwargs = dict(kernel=kernel, stride=(2,) * len(kernel), pool_type=pool_type,
+                              global_pool=global_pool)
+                with mx.autograd.record():
+                    y = mx.nd.Pooling(x, **kwargs)
+                    y_last = mx.nd.Pooling(x_last, layout=layout, **kwargs)
+                y.backward()
+                y_last.backward()
+                assert_almost_equal(mx.nd.transpose(y, axes=axes).asnumpy(), y_last.asnumpy())
+                assert_almost_equal(mx.nd.transpose(x.grad, axes=axes).asnumpy(),
+                                    x_last.grad.asnumpy())
+
+
 @with_seed()
 def test_upsampling_with_type():
     sym = mx.sym.UpSampling(scale=2, num_filter=2, name='up', sample_type='nearest', num_args=1)
@@ -1858,6 +1880,92 @@ def test_softmax_activation():
                 atol = 1e-3, rtol = 1e-3)
 
 
+@with_seed()
+def test_backward_offload():
+    x = mx.sym.Variable('x')
+    y = x
+    for i in range(4):
+        y = mx.sym.FullyConnected(y, num_hidden=64, name='fc%d' % i)
+        y = mx.sym.Activation(y, act_type='tanh')
+    y = mx.sym.sum(y)
+    args = {'x': mx.nd.random.uniform(shape=(32, 64), ctx=mx.gpu(0))}
+    for i in range(4):
+        args['fc%d_weight' % i] = mx.nd.random.uniform(-0.1, 0.1, shape=(64, 64), ctx=mx.gpu(0))
+        args['fc%d_bias' % i] = mx.nd.zeros((64,), ctx=mx.gpu(0))
+
+    def grads():
+        grad = {k: mx.nd.zeros(v.shape, ctx=mx.gpu(0)) for k, v in args.items()}
+        exe = y.bind(mx.gpu(0), args, args_grad=grad)
+        exe.forward(is_train=True)
+        exe.backward()
+        return {k: v.asnumpy() for k, v in grad.items()}
+
+    expected = grads()
+    os.environ['MXNET_BACKWARD_OFFLOAD'] = '1'
+    os.environ['MXNET_BACKWARD_OFFLOAD_MIN_KB'] = '0'
+    try:
+        offloaded = grads()
+    finally:
+        del os.environ['MXNET_BACKWARD_OFFLOAD']
+        del os.environ['MXNET_BACKWARD_OFFLOAD_MIN_KB']
+    for k in expected:
+        assert_almost_equal(expected[k], offloaded[k], rtol=1e-5, atol=1e-6)
+
+
+@with_seed()
+def test_fp16_inference_simple_bind():
+    data = mx.sym.Variable('data')
+    y = mx.sym.Convolution(data, num_filter=8, kernel=(3, 3), pad=(1, 1), name='conv')
+    y = mx.sym.BatchNorm(y, fix_gamma=False, name='bn')
+    y = mx.sym.Activation(y, act_type='relu')
+    y = mx.sym.FullyConnected(y, num_hidden=10, name='fc')
+    y = mx.sym.softmax(y)
+    x = mx.nd.random.uniform(shape=(4, 3, 8, 8))
+    params = {'conv_weight': mx.nd.random.uniform(-0.1, 0.1, shape=(8, 3, 3, 3)),
+              'conv_bias': mx.nd.zeros((8,)),
+              'bn_gamma': mx.nd.random.uniform(0.5, 1.5, shape=(8,)),
+              'bn_beta': mx.nd.random.uniform(-0.1, 0.1, shape=(8,)),
+              'fc_weight': mx.nd.random.uniform(-0.1, 0.1, shape=(10, 512)),
+              'fc_bias': mx.nd.zeros((10,))}
+    aux = {'bn_moving_mean': mx.nd.random.uniform(-0.1, 0.1, shape=(8,)),
+           'bn_moving_var': mx.nd.random.uniform(0.5, 1.5, shape=(8,))}
+
+    def forward():
+        exe = y.simple_bind(mx.gpu(0), grad_req='null', data=x.shape)
+        exe.copy_params_from(params, aux)
+        exe.forward(is_train=False, data=x)
+        return exe
+
+    expected = forward().outputs[0].asnumpy()
+    os.environ['MXNET_EXEC_FP16_INFERENCE'] = '1'
+    try:
+        exe = forward()
+    finally:
+        del os.environ['MXNET_EXEC_FP16_INFERENCE']
+    # parameters of the convolution and the fully connected layer are stored in float16,
+    # the BatchNorm statistics, the input and the output keep float32
+    assert exe.arg_dict['conv_weight'].dtype == np.float16
+    assert exe.arg_dict['fc_weight'].dtype == np.float16
+    assert exe.arg_dict['bn_gamma'].dtype == np.float32
+    assert exe.aux_dict['bn_moving_var'].dtype == np.float32
+    assert exe.arg_dict['data'].dtype == np.float32
+    assert exe.outputs[0].dtype == np.float32
+    assert_almost_equal(expected, exe.outputs[0].asnumpy(), rtol=1e-2, atol=1e-3)
+
+
+@with_seed()
+def test_gpu_ipc_handle():
+    a = mx.nd.random.uniform(shape=(16, 8), ctx=mx.gpu(0))
+    handle = a._to_gpu_ipc_handle()
+    b = mx.nd.NDArray(mx.nd.ndarray._new_from_gpu_ipc_handle(*handle))
+    assert b.context == mx.gpu(0)
+    assert_almost_equal(a.asnumpy(), b.asnumpy())
+    # b shares the exported memory, exporting it again gives the same handle
+    b[:] = 1
+    c = mx.nd.NDArray(mx.nd.ndarray._new_from_gpu_ipc_handle(*b._to_gpu_ipc_handle()))
+    assert_almost_equal(c.asnumpy(), np.ones((16, 8)))
+
+
 if __name__ == '__main__':
     import nose
     nose.runmodule()
@@ -16,6 +16,7 @@
 # under the License.
 
 """Test TVM bridge, only enable this when TVM is available"""
+import json
 import logging
 import mxnet as mx
 import numpy as np
@@ -61,6 +62,43 @@ def test_tvm_bridge():
             check(tgt, dtype)
 
 
+def test_tvm_subgraph():
+    try:
+        import tvm
+        import topi
+    except ImportError:
+        logging.warn("TVM subgraph test skipped because TVM is missing...")
+        return
+    import os
+    from mxnet.contrib import tvm as mxtvm
+
+    compiled = []
+    def fcompile(symbol, shapes, dtypes, ctx):
+        ops = [node['op'] for node in json.loads(symbol.tojson())['nodes']]
+        assert ops == ['null', '_plus_scalar', 'relu'], ops
+        compiled.append(shapes)
+        x = tvm.placeholder(shapes[0], dtype=dtypes[0])
+        y = tvm.compute(shapes[1], lambda *i: tvm.max(x(*i) + 1, tvm.const(0, dtypes[0])))
+        target = tvm.target.create('cuda' if ctx.device_type == 'gpu' else 'llvm')
+        with target:
+            s = topi.generic.schedule_injective(y)
+            return tvm.build(s, [x, y])
+    mxtvm.set_subgraph_compiler(fcompile)
+
+    data = mx.sym.var('data')
+    out = mx.sym.relu(data + 1)
+    os.environ['MXNET_EXEC_TVM_SUBGRAPH'] = '1'
+    try:
+        for ctx in [mx.cpu(0), mx.gpu(0)]:
+            x = mx.nd.uniform(-2, 2, shape=(4, 5), ctx=ctx)
+            exe = out.bind(ctx, {'data': x}, grad_req='null')
+            y = exe.forward()[0]
+            np.testing.assert_allclose(y.asnumpy(), np.maximum(x.asnumpy() + 1, 0), rtol=1e-6)
+    finally:
+        del os.environ['MXNET_EXEC_TVM_SUBGRAPH']
+    assert len(compiled) == 2
+
+
 if __name__ == "__main__":
     import nose
     nose.runmodule()
@@ -213,5 +213,58 @@ def test_mkldnn_sum_inplace_with_cpu_layout():
     assert_almost_equal(out[0].asnumpy()[0, 0, 0], 1.0)
 
 
+
+@with_seed()
+def test_mkldnn_layout_pass():
+    x_shape = (4, 3, 16, 16)
+    x_npy = np.random.uniform(-1, 1, size=x_shape)
+    x = mx.sym.Variable("x")
+    conv = mx.symbol.Convolution(data=x, num_filter=16, kernel=(3, 3), name='conv')
+    # the convolution feeds MKLDNN operators and two operators reading the default layout
+    pool = mx.sym.Pooling(mx.sym.Activation(conv, act_type='relu'), kernel=(2, 2),
+                          pool_type='max')
+    z = mx.sym.Group([pool, mx.sym.sin(conv), mx.sym.square(conv) + 1])
+    outputs = []
+    for enabled in ['0', '1']:
+        os.environ['MXNET_MKLDNN_LAYOUT_PASS'] = enabled
+        exe = z.simple_bind(ctx=mx.cpu(), grad_req='null', x=x_shape)
+        mx.random.seed(1)
+        for name, arr in exe.arg_dict.items():
+            if name != 'x':
+                arr[:] = mx.nd.random.uniform(-1, 1, shape=arr.shape)
+        outputs.append([out.asnumpy() for out in exe.forward(is_train=False, x=x_npy)])
+    del os.environ['MXNET_MKLDNN_LAYOUT_PASS']
+    for out1, out2 in zip(outputs[0], outputs[1]):
+        assert_almost_equal(out1, out2, rtol=1e-5, atol=1e-6)
+
+def test_mkldnn_fuse_conv():
+    x_shape = (2, 8, 10, 10)
+    x_npy = np.random.uniform(-1, 1, size=x_shape)
+    x = mx.sym.Variable("x")
+    def conv_bn(data, name, act=True):
+        conv = mx.sym.Convolution(data, num_filter=8, kernel=(3, 3), pad=(1, 1),
+                                  name=name + '_conv')
+        bn = mx.sym.BatchNorm(conv, fix_gamma=False, use_global_stats=True, eps=2e-5,
+                              name=name + '_bn')
+        return mx.sym.Activation(bn, act_type='relu') if act else bn
+    # the residual sums have the convolution on either side
+    y = mx.sym.relu(conv_bn(conv_bn(x, 'a'), 'b', act=False) + x)
+    y = mx.sym.Activation(y + conv_bn(y, 'c', act=False), act_type='relu')
+    z = mx.sym.Group([y, mx.sym.Convolution(y, num_filter=4, kernel=(1, 1), no_bias=True)])
+    outputs = []
+    for enabled in ['0', '1']:
+        os.environ['MXNET_MKLDNN_FUSE_CONV'] = enabled
+        exe = z.simple_bind(ctx=mx.cpu(), grad_req='null', x=x_shape)
+        mx.random.seed(1)
+        for name, arr in exe.arg_dict.items():
+            if name != 'x':
+                arr[:] = mx.nd.random.uniform(-1, 1, shape=arr.shape)
+        for name, arr in exe.aux_dict.items():
+            arr[:] = mx.nd.random.uniform(0.5, 1.5, shape=arr.shape)
+        outputs.append([out.asnumpy() for out in exe.forward(is_train=False, x=x_npy)])
+    del os.environ['MXNET_MKLDNN_FUSE_CONV']
+    for out1, out2 in zip(outputs[0], outputs[1]):
+        assert_almost_equal(out1, out2, rtol=1e-4, atol=1e-5)
+
 if __name__ == '__main__':
     test_mkldnn_install()
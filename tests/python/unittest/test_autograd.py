@@ -444,6 +444,37 @@ def test_gradient():
     assert abs(x.grad.asscalar() - 2.71828175) < 1e-7
 
 
+@with_seed()
+def test_repeated_backward():
+    # the backward plan recorded by the first step is reused by the same tape
+    # and must not be reused once the shapes or the operators change
+    x = mx.nd.random.uniform(shape=(3, 4))
+    w = mx.nd.random.uniform(shape=(5, 4))
+    w.attach_grad()
+    for step in range(3):
+        with mx.autograd.record():
+            y = mx.nd.FullyConnected(x, w, num_hidden=5, no_bias=True)
+            z = (y * y).sum()
+        z.backward()
+        expected = np.dot((2 * np.dot(x.asnumpy(), w.asnumpy().T)).T, x.asnumpy())
+        assert_almost_equal(w.grad.asnumpy(), expected, rtol=1e-4, atol=1e-5)
+
+    x = mx.nd.random.uniform(shape=(6, 4))
+    with mx.autograd.record():
+        y = mx.nd.FullyConnected(x, w, num_hidden=5, no_bias=True)
+        z = (y * y).sum()
+    z.backward()
+    expected = np.dot((2 * np.dot(x.asnumpy(), w.asnumpy().T)).T, x.asnumpy())
+    assert_almost_equal(w.grad.asnumpy(), expected, rtol=1e-4, atol=1e-5)
+
+    with mx.autograd.record():
+        y = mx.nd.FullyConnected(x, w, num_hidden=5, no_bias=True)
+        z = (y * 3).sum()
+    z.backward()
+    assert_almost_equal(w.grad.asnumpy(), np.tile(3 * x.asnumpy().sum(axis=0), (5, 1)),
+                        rtol=1e-4, atol=1e-5)
+
+
 if __name__ == "__main__":
     import nose
     nose.runmodule()
@@ -226,6 +226,71 @@ def test_bipartite_matching_op():
     assert_match([[0.5, 0.6], [0.1, 0.2], [0.3, 0.4]], [1, -1, 0], [2, 0], 1e-12, False)
     assert_match([[0.5, 0.6], [0.1, 0.2], [0.3, 0.4]], [-1, 0, 1], [1, 2], 100, True)
 
+def test_point_grid_search():
+    xyz = mx.nd.random.uniform(-1, 1, shape=(2, 500, 3))
+    query = mx.nd.random.uniform(-1, 1, shape=(2, 40, 3))
+    # the grid returns exactly the samples of the search over all points
+    brute = mx.nd.contrib.BallQuery(xyz, query, radius=0.5, nsample=8)
+    grid = mx.nd.contrib.BallQuery(xyz, query, radius=0.5, nsample=8, use_grid=True)
+    assert_array_equal(brute.asnumpy(), grid.asnumpy())
+    for cell_size in [0.05, 0.2, 1.0]:
+        brute_dist, brute_idx = mx.nd.contrib.ThreeNN(query, xyz)
+        grid_dist, grid_idx = mx.nd.contrib.ThreeNN(query, xyz, cell_size=cell_size)
+        assert_array_equal(brute_idx.asnumpy(), grid_idx.asnumpy())
+        assert_allclose(brute_dist.asnumpy(), grid_dist.asnumpy())
+
+
+def test_farthest_point_sampling():
+    def fps(points, npoints):
+        dist = np.full(points.shape[0], np.finfo(np.float32).max, dtype=np.float32)
+        idx = [0]
+        for _ in range(1, npoints):
+            d = np.sum(np.square(points[:, :3] - points[idx[-1], :3]), axis=1)
+            dist = np.minimum(dist, d)
+            idx.append(int(np.argmax(dist)))
+        return np.array(idx), dist
+
+    for n in [50, 10000]:
+        data = mx.nd.random.uniform(shape=(2, n, 4))
+        idx, min_dis = mx.nd.contrib.FarthestPointSampling(data, npoints=32)
+        for b in range(2):
+            expected_idx, expected_dist = fps(data[b].asnumpy(), 32)
+            assert_array_equal(idx[b].asnumpy(), expected_idx)
+            assert_allclose(min_dis[b].asnumpy(), expected_dist, rtol=1e-5, atol=1e-6)
+
+
+def test_sigmoid_cross_entropy():
+    x = np.random.uniform(-30, 30, size=(4, 50)).astype(np.float32)
+    t = np.random.randint(-1, 2, size=(4, 50)).astype(np.float32)
+    valid = (t != -1).astype(np.float32)
+    count = valid.sum(axis=1) + 1e-5
+    loss = (np.maximum(x, 0) - x * t + np.log1p(np.exp(-np.abs(x)))) * valid
+    grad = (1 / (1 + np.exp(-x)) - t) * valid / count[:, None] * 2.0
+
+    data = mx.sym.Variable('data')
+    label = mx.sym.Variable('label')
+    sym = mx.sym.contrib.SigmoidCrossEntropy(data=data, label=label, grad_scale=2.0)
+    exe = sym.simple_bind(ctx=default_context(), data=x.shape, label=t.shape)
+    exe.arg_dict['data'][:] = x
+    exe.arg_dict['label'][:] = t
+    out = exe.forward(is_train=True)[0]
+    exe.backward()
+    assert_allclose(out.asnumpy(), loss.sum(axis=1) / count, rtol=1e-5, atol=1e-5)
+    assert_allclose(exe.grad_dict['data'].asnumpy(), grad, rtol=1e-5, atol=1e-6)
+
+
+def test_fft_ifft():
+    # a power of two, a length for Bluestein's algorithm and a tail sub-batch
+    for shape in [(5, 16), (2, 3, 2, 30)]:
+        x = np.random.normal(size=shape).astype(np.float32)
+        out = mx.nd.contrib.fft(mx.nd.array(x), compute_size=4).asnumpy()
+        expected = np.fft.fft(x, axis=-1)
+        assert_allclose(out[..., 0::2], expected.real, rtol=1e-4, atol=1e-4)
+        assert_allclose(out[..., 1::2], expected.imag, rtol=1e-4, atol=1e-4)
+        back = mx.nd.contrib.ifft(mx.nd.array(out), compute_size=4).asnumpy()
+        assert_allclose(back / shape[-1], x, rtol=1e-4, atol=1e-4)
+
+
 if __name__ == '__main__':
     import nose
     nose.runmodule()
@@ -31,6 +31,43 @@ def test_bulk():
     assert (x.asnumpy() == 104).all()
 
 
+def test_record_replay():
+    x = mx.nd.ones((10,))
+    y = mx.nd.zeros((10,))
+    z = mx.nd.zeros((10,))
+    with mx.engine.record() as step:
+        y += x * 2
+        z[:] = y + 1
+    assert (y.asnumpy() == 2).all()
+    assert (z.asnumpy() == 3).all()
+    for i in range(5):
+        step.replay()
+    assert (y.asnumpy() == 12).all()
+    assert (z.asnumpy() == 13).all()
+    # new inputs are copied into the recorded ones
+    mx.nd.full((10,), 3).copyto(x)
+    step.replay()
+    assert (y.asnumpy() == 18).all()
+    assert (z.asnumpy() == 19).all()
+    del step
+    mx.nd.waitall()
+
+
+def test_worker_stats():
+    x = mx.nd.ones((10,))
+    for i in range(10):
+        x += 1
+    x.wait_to_read()
+    stats = mx.engine.worker_stats()
+    # the naive engine has no worker queues
+    for s in stats.values():
+        assert s['nthreads'] >= 1
+        assert s['busy_us'] + s['idle_us'] > 0 or s['executed'] == 0
+    if 'cpu(0)' in stats:
+        assert stats['cpu(0)']['executed'] >= 10
+        assert stats['cpu(0)']['busy_us'] > 0
+
+
 if __name__ == '__main__':
     import nose
     nose.runmodule()
@@ -161,6 +161,141 @@ def test_reshape():
     assert np.all(exe.outputs[0].asnumpy() == 4)
 
 
+@with_seed()
+def test_fuse_elemwise():
+    import os
+    a = mx.sym.Variable('a')
+    b = mx.sym.Variable('b')
+    c = mx.sym.Variable('c')
+    y = mx.sym.relu(a * 2 + b) * c - 1
+    y = mx.sym.Group([mx.sym.sigmoid(mx.sym.exp(y / 4)), mx.sym.tanh(y)])
+    shape = (3, 1000)
+    args = {k: mx.nd.random.uniform(-1, 1, shape) for k in ['a', 'b', 'c']}
+    expected = [out.asnumpy() for out in y.bind(mx.cpu(), args).forward()]
+    os.environ['MXNET_EXEC_FUSE_ELEMWISE'] = '1'
+    try:
+        exe = y.bind(mx.cpu(), args)
+    finally:
+        del os.environ['MXNET_EXEC_FUSE_ELEMWISE']
+    assert 'FusedElemwise' in exe.debug_str()
+    for out, expect in zip(exe.forward(), expected):
+        assert reldiff(expect, out.asnumpy()) < 1e-5
+
+
+@with_seed()
+def test_mirror_budget():
+    import os
+    x = mx.sym.Variable('x')
+    y = x
+    for i in range(6):
+        y = mx.sym.FullyConnected(y, num_hidden=64, name='fc%d' % i)
+        y = mx.sym.Activation(y, act_type='tanh')
+    y = mx.sym.sum(y)
+    args = {'x': mx.nd.random.uniform(shape=(32, 64))}
+    for i in range(6):
+        args['fc%d_weight' % i] = mx.nd.random.uniform(-0.1, 0.1, shape=(64, 64))
+        args['fc%d_bias' % i] = mx.nd.zeros((64,))
+
+    def grads():
+        grad = {k: mx.nd.zeros(v.shape) for k, v in args.items()}
+        exe = y.bind(mx.cpu(), args, args_grad=grad)
+        exe.forward(is_train=True)
+        exe.backward()
+        return {k: v.asnumpy() for k, v in grad.items()}
+
+    expected = grads()
+    os.environ['MXNET_BACKWARD_MIRROR_BUDGET_MB'] = '1'
+    try:
+        mirrored = grads()
+    finally:
+        del os.environ['MXNET_BACKWARD_MIRROR_BUDGET_MB']
+    for k in expected:
+        assert reldiff(expected[k], mirrored[k]) < 1e-5
+
+
+def test_bulk_segment_time():
+    import os
+    x = mx.sym.Variable('x')
+    y = x
+    for i in range(6):
+        y = mx.sym.FullyConnected(y, num_hidden=32, name='fc%d' % i)
+        y = mx.sym.Activation(y, act_type='relu')
+    y = mx.sym.sum(y)
+    args = {'x': mx.nd.random.uniform(shape=(16, 32))}
+    for i in range(6):
+        args['fc%d_weight' % i] = mx.nd.random.uniform(-0.1, 0.1, shape=(32, 32))
+        args['fc%d_bias' % i] = mx.nd.zeros((32,))
+
+    def grads():
+        grad = {k: mx.nd.zeros(v.shape) for k, v in args.items()}
+        exe = y.bind(mx.cpu(), args, args_grad=grad)
+        # the segments change after the second iteration
+        for _ in range(4):
+            exe.forward(is_train=True)
+            exe.backward()
+        return {k: v.asnumpy() for k, v in grad.items()}
+
+    expected = grads()
+    os.environ['MXNET_EXEC_BULK_EXEC_SEGMENT_US'] = '1'
+    try:
+        segmented = grads()
+    finally:
+        del os.environ['MXNET_EXEC_BULK_EXEC_SEGMENT_US']
+    for k in expected:
+        assert reldiff(expected[k], segmented[k]) < 1e-5
+
+
+def test_parallel_branches():
+    import os
+    x = mx.sym.Variable('x')
+    towers = []
+    for i in range(3):
+        t = mx.sym.FullyConnected(x, num_hidden=16, name='fc%d_a' % i)
+        t = mx.sym.Activation(t, act_type='relu')
+        t = mx.sym.FullyConnected(t, num_hidden=16, name='fc%d_b' % i)
+        towers.append(t)
+    y = mx.sym.sum(mx.sym.concat(*towers, dim=1))
+    shapes = dict(zip(y.list_arguments(), y.infer_shape(x=(8, 16))[0]))
+    args = {k: mx.nd.random.uniform(-0.5, 0.5, shape=v) for k, v in shapes.items()}
+
+    def run():
+        grad = {k: mx.nd.zeros(v.shape) for k, v in args.items()}
+        exe = y.bind(mx.cpu(), args, args_grad=grad)
+        exe.forward(is_train=True)
+        exe.backward()
+        out = exe.outputs[0].asnumpy()
+        infer = y.bind(mx.cpu(), args).forward()[0].asnumpy()
+        return out, infer, {k: v.asnumpy() for k, v in grad.items()}
+
+    expected = run()
+    os.environ['MXNET_EXEC_PARALLEL_BRANCHES'] = '1'
+    try:
+        branched = run()
+    finally:
+        del os.environ['MXNET_EXEC_PARALLEL_BRANCHES']
+    assert reldiff(expected[0], branched[0]) < 1e-5
+    assert reldiff(expected[1], branched[1]) < 1e-5
+    for k in expected[2]:
+        assert reldiff(expected[2][k], branched[2][k]) < 1e-5
+
+
+def test_priority():
+    x = mx.sym.Variable('x')
+    y = mx.sym.FullyConnected(mx.sym.relu(x), num_hidden=8, name='fc')
+    shapes = dict(zip(y.list_arguments(), y.infer_shape(x=(4, 16))[0]))
+    args = {k: mx.nd.random.uniform(-1, 1, shape=v) for k, v in shapes.items()}
+    expected = y.bind(mx.cpu(), args).forward()[0].asnumpy()
+    batch = y.bind(mx.cpu(), args)
+    latency = y.bind(mx.cpu(), args)
+    latency.set_priority(1)
+    outs = []
+    for _ in range(4):
+        outs.append(batch.forward()[0].copy())
+        outs.append(latency.forward()[0].copy())
+    for out in outs:
+        assert reldiff(expected, out.asnumpy()) < 1e-5
+
+
 if __name__ == "__main__":
     import nose
     nose.runmodule()
@@ -736,6 +736,57 @@ def test_hybrid_stale_cache():
     assert net(mx.nd.ones((2,3,5))).shape == (2, 10)
 
 
+@with_seed()
+def test_hybrid_static_alloc():
+    net = mx.gluon.nn.HybridSequential()
+    with net.name_scope():
+        net.add(nn.Dense(8, activation='relu'))
+        net.add(nn.Dense(4))
+    net.initialize()
+    shapes = [(2, 5), (3, 5), (2, 5), (4, 5), (5, 5), (6, 5), (2, 5)]
+    data = [mx.nd.random.uniform(shape=shape) for shape in shapes]
+    expected = [net(x).asnumpy() for x in data]
+
+    net.hybridize(static_alloc=True, static_alloc_cache_size=2)
+    outs = [net(x) for x in data]
+    # outputs of earlier calls must not be overwritten by later ones
+    for out, expect in zip(outs, expected):
+        assert_almost_equal(out.asnumpy(), expect)
+
+    with mx.autograd.record():
+        out = net(data[0])
+    out.backward()
+    assert_almost_equal(out.asnumpy(), expected[0])
+
+
+@with_seed()
+def test_hybrid_alternating_shapes():
+    net = mx.gluon.nn.HybridSequential()
+    with net.name_scope():
+        net.add(nn.Dense(8, activation='tanh', flatten=False))
+        net.add(nn.Dense(4, flatten=False))
+    net.initialize()
+    lengths = [3, 7, 3, 5, 7, 3, 9, 5]
+    data = [mx.nd.random.uniform(shape=(2, l, 5)) for l in lengths]
+
+    def run():
+        outs, grads = [], []
+        for x in data:
+            with mx.autograd.record():
+                out = net(x)
+            out.backward()
+            outs.append(out.asnumpy())
+            grads.append(net[0].weight.grad().asnumpy())
+        return outs, grads
+
+    expected = run()
+    # shapes and memory plans of the sequence lengths seen before are reused
+    net.hybridize(shape_cache_size=2)
+    for outs in zip(run(), expected):
+        for out, expect in zip(*outs):
+            assert_almost_equal(out, expect)
+
+
 @with_seed()
 def test_lambda():
     net1 = mx.gluon.nn.HybridSequential()
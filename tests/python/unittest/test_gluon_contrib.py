@@ -19,8 +19,8 @@ from __future__ import print_function
 import mxnet as mx
 from mxnet.gluon import contrib
 from mxnet.gluon import nn
-from mxnet.gluon.contrib.nn import Concurrent, HybridConcurrent, Identity
-from mxnet.test_utils import almost_equal
+from mxnet.gluon.contrib.nn import Concurrent, HybridConcurrent, Identity, SyncBatchNorm
+from mxnet.test_utils import almost_equal, assert_almost_equal
 from common import setup_module, with_seed
 import numpy as np
 from numpy.testing import assert_allclose
@@ -216,6 +216,31 @@ def test_sampler():
     assert list(interval_sampler) == [0, 3, 6, 9]
 
 
+@with_seed()
+def test_sync_batchnorm():
+    # on a single device the layer must match BatchNorm
+    for shape in [(4, 3), (2, 3, 4, 5)]:
+        x = mx.nd.random.normal(shape=shape)
+        ref = nn.BatchNorm(in_channels=shape[1])
+        sync = SyncBatchNorm(in_channels=shape[1])
+        ref.initialize()
+        sync.initialize()
+        for layer in [ref, sync]:
+            layer.gamma.set_data(mx.nd.array([1., 2., 3.]))
+            layer.beta.set_data(mx.nd.array([0., -1., 1.]))
+        outs = []
+        for layer in [ref, sync]:
+            data = x.copy()
+            data.attach_grad()
+            with mx.autograd.record():
+                out = layer(data)
+            out.backward(mx.nd.arange(out.size).reshape(out.shape))
+            outs.append((out, data.grad, layer.gamma.grad(), layer.beta.grad(),
+                         layer.running_mean.data(), layer.running_var.data()))
+        for a, b in zip(*outs):
+            assert_almost_equal(a.asnumpy(), b.asnumpy(), rtol=1e-3, atol=1e-4)
+
+
 if __name__ == '__main__':
     import nose
     nose.runmodule()
@@ -61,6 +61,25 @@ def test_flip_top_bottom():
     assert_almost_equal(flip_in, data_trans.asnumpy())
 
 
+@with_seed()
+def test_random_augment():
+    data_in = np.random.uniform(0, 255, (4, 31, 17, 3)).astype(np.float32)
+    out = nd.image.random_augment(nd.array(data_in))
+    assert_almost_equal(data_in, out.asnumpy())
+
+    out = nd.image.random_augment(nd.array(data_in), flip_left_right=True,
+                                  flip_top_bottom=True).asnumpy()
+    for img_in, img_out in zip(data_in, out):
+        assert any(np.array_equal(img_out, img_in[::h, ::w, :])
+                   for h in (1, -1) for w in (1, -1))
+
+    out = nd.image.random_augment(nd.array(data_in), brightness=0.5).asnumpy()
+    for img_in, img_out in zip(data_in, out):
+        alpha = img_out.sum() / img_in.sum()
+        assert 0.5 <= alpha <= 1.5
+        assert_almost_equal(img_out, img_in * alpha, rtol=1e-4, atol=1e-3)
+
+
 @with_seed()
 def test_transformer():
     from mxnet.gluon.data.vision import transforms
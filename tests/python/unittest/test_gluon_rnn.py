@@ -82,6 +82,26 @@ def test_lstm_cpu_inference():
                                       rtol=1e-3, atol=1e-5)
     
 
+def test_rnn_layers_cpu_inference():
+    # the fused CPU kernel against the unrolled cells
+    for layer_type, kwargs in [(gluon.rnn.RNN, {'activation': 'relu'}),
+                               (gluon.rnn.RNN, {'activation': 'tanh'}),
+                               (gluon.rnn.LSTM, {}), (gluon.rnn.GRU, {})]:
+        for bidirectional in [False, True]:
+            layer = layer_type(6, num_layers=3, bidirectional=bidirectional, input_size=5,
+                               **kwargs)
+            layer.initialize()
+            for param in layer.collect_params().values():
+                param.set_data(mx.nd.random.uniform(-0.5, 0.5, param.shape))
+            x = mx.nd.random.uniform(-1, 1, (7, 3, 5))
+            states = [mx.nd.random.uniform(-1, 1, s.shape) for s in layer.begin_state(3)]
+            out, out_states = layer(x, states)
+            expected, expected_states = layer._forward(x, states)
+            assert_allclose(out.asnumpy(), expected.asnumpy(), rtol=1e-4, atol=1e-5)
+            for state, expected_state in zip(out_states, expected_states):
+                assert_allclose(state.asnumpy(), expected_state.asnumpy(), rtol=1e-4, atol=1e-5)
+
+
 def test_gru():
     cell = gluon.rnn.GRUCell(100, prefix='rnn_')
     inputs = [mx.sym.Variable('rnn_t%d_data'%i) for i in range(3)]
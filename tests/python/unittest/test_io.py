@@ -313,6 +313,29 @@ def test_CSVIter():
 
     check_CSVIter_synthetic()
 
+def test_LibSVMIter_preprocess_threads():
+    cwd = os.getcwd()
+    data_path = os.path.join(cwd, 'data_threads.t')
+    num_rows, num_cols = 1000, 50
+    rnd = np.random.RandomState(0)
+    expected = np.zeros((num_rows, num_cols))
+    labels = rnd.randint(0, 10, num_rows)
+    with open(data_path, 'w') as fout:
+        for i in range(num_rows):
+            cols = np.sort(rnd.choice(num_cols, rnd.randint(0, 5), replace=False))
+            expected[i, cols] = i + 1
+            fout.write(' '.join([str(labels[i])] + ['%d:%d' % (c, i + 1) for c in cols]) + '\n')
+
+    for threads in [1, 3, 8]:
+        data_iter = mx.io.LibSVMIter(data_libsvm=data_path, data_shape=(num_cols,),
+                                     batch_size=100, preprocess_threads=threads)
+        data, label = [], []
+        for batch in data_iter:
+            data.append(batch.data[0].asnumpy())
+            label.append(batch.label[0].asnumpy())
+        assert_almost_equal(np.concatenate(data), expected)
+        assert_almost_equal(np.concatenate(label), labels)
+
 if __name__ == "__main__":
     test_NDArrayIter()
     if h5py:
@@ -322,3 +345,4 @@ if __name__ == "__main__":
     test_LibSVMIter()
     test_NDArrayIter_csr()
     test_CSVIter()
+    test_LibSVMIter_preprocess_threads()
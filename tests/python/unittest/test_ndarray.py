@@ -294,6 +294,76 @@ def test_ndarray_saveload():
     os.remove(fname)
 
 
+@with_seed()
+def test_dlpack():
+    for dtype in [np.float32, np.float16, np.int32, np.uint8]:
+        a = mx.nd.array(np.random.uniform(0, 10, size=(2, 3, 4)), dtype=dtype)
+        b = mx.nd.from_dlpack(a.to_dlpack_for_read())
+        assert b.dtype == dtype and b.shape == a.shape
+        assert np.sum(a.asnumpy() != b.asnumpy()) == 0
+        # the memory is shared
+        c = mx.nd.from_dlpack(mx.nd.to_dlpack_for_write(a))
+        c[:] = 1
+        c.wait_to_read()
+        assert np.all(a.asnumpy() == 1)
+        # the capsules release the arrays when not consumed
+        del a, b, c
+        mx.nd.ones((2, 3)).to_dlpack_for_read()
+    capsule = mx.nd.ones((2, 3)).to_dlpack_for_read()
+    mx.nd.from_dlpack(capsule)
+    assertRaises(ValueError, mx.nd.from_dlpack, capsule)
+
+
+@with_seed()
+def test_ndarray_saveload_background():
+    fname = 'tmp_background.bin'
+    dmap = {'x': mx.nd.array(np.random.uniform(size=(3, 4))),
+            'y': mx.nd.array([1, 2, 3], dtype='int32')}
+    expected = {k: v.asnumpy() for k, v in dmap.items()}
+    done = mx.nd.save(fname, dmap, background=True)
+    # the file holds the values at the time of the call
+    dmap['x'][:] = 0
+    done.wait_to_read()
+    loaded = mx.nd.load(fname)
+    for k, v in expected.items():
+        assert loaded[k].dtype == v.dtype
+        assert np.sum(loaded[k].asnumpy() != v) == 0
+    # float32 arrays stored as float16, other types kept
+    mx.nd.save(fname, {k: mx.nd.array(v, dtype=v.dtype) for k, v in expected.items()},
+               dtype='float16')
+    loaded = mx.nd.load(fname)
+    assert loaded['x'].dtype == np.float16
+    assert loaded['y'].dtype == np.int32
+    assert_almost_equal(loaded['x'].asnumpy(), expected['x'], rtol=1e-3, atol=1e-3)
+    os.remove(fname)
+
+
+@with_seed()
+def test_ndarray_saveload_mapped():
+    fname = 'tmp_mapped.bin'
+    data = [random_ndarray(np.random.randint(1, 5)) for i in range(10)]
+    data.append(mx.nd.array([1, 2, 3], dtype='int32'))
+    mx.nd.save(fname, data, mapped=True)
+    data2 = mx.nd.load(fname)
+    assert len(data) == len(data2)
+    for x, y in zip(data, data2):
+        assert x.dtype == y.dtype
+        assert np.sum(x.asnumpy() != y.asnumpy()) == 0
+    dmap = {'ndarray xx %s' % i : x for i, x in enumerate(data)}
+    mx.nd.save(fname, dmap, mapped=True)
+    dmap2 = mx.nd.load(fname)
+    assert len(dmap2) == len(dmap)
+    for k, x in dmap.items():
+        assert np.sum(x.asnumpy() != dmap2[k].asnumpy()) == 0
+    # the mapping is copy-on-write, writing the loaded arrays leaves the file unchanged
+    for y in dmap2.values():
+        y[:] = 0
+    for k, x in mx.nd.load(fname).items():
+        assert np.sum(dmap[k].asnumpy() != x.asnumpy()) == 0
+    del dmap2
+    os.remove(fname)
+
+
 @with_seed()
 def test_ndarray_legacy_load():
     data = []
@@ -1268,6 +1338,30 @@ def test_ndarray_astype():
     assert (id(x) == id(y))
 
 
+@with_seed()
+def test_op_instance():
+    a = mx.nd.random.uniform(shape=(3, 4))
+    b = mx.nd.random.uniform(shape=(3, 4))
+    add = mx.nd.OpInstance('elemwise_add', 2)
+    for _ in range(3):
+        assert same(add(a, b).asnumpy(), (a + b).asnumpy())
+    out = mx.nd.empty((3, 4))
+    add(a, b, out=out)
+    assert same(out.asnumpy(), (a + b).asnumpy())
+
+    clip = mx.nd.OpInstance('clip', 1, a_min=0.2, a_max=0.5)
+    assert same(clip(a).asnumpy(), mx.nd.clip(a, 0.2, 0.5).asnumpy())
+    concat = mx.nd.OpInstance('Concat', 3, dim=0)
+    assert concat(a, b, a).shape == (9, 4)
+    assertRaises(mx.base.MXNetError, concat, a, b)
+
+    a.attach_grad()
+    with mx.autograd.record():
+        y = clip(a)
+    y.backward()
+    assert same(a.grad.asnumpy(), ((a >= 0.2) * (a <= 0.5)).asnumpy())
+
+
 @with_seed()
 def test_norm(ctx=default_context()):
     np_arr = np.random.uniform(size=(3, 3, 3, 3))
@@ -763,13 +763,14 @@ class PyRMSProp(mx.optimizer.Optimizer):
 
     """
     def __init__(self, learning_rate=0.001, gamma1=0.9, gamma2=0.9,
-                 epsilon=1e-8, centered=False, clip_weights=None, **kwargs):
+                 epsilon=1e-8, centered=False, clip_weights=None, lazy_update=False, **kwargs):
         super(PyRMSProp, self).__init__(learning_rate=learning_rate, **kwargs)
         self.centered = centered
         self.gamma1 = gamma1
         self.gamma2 = gamma2
         self.epsilon = epsilon
         self.clip_weights = clip_weights
+        self.lazy_update = lazy_update
 
     def create_state(self, index, weight):
         """Create additional optimizer state.
@@ -809,6 +810,17 @@ class PyRMSProp(mx.optimizer.Optimizer):
         lr = self._get_lr(index)
         wd = self._get_wd(index)
         self._update_count(index)
+        if self.lazy_update:
+            # only the rows with non-zero gradients are updated
+            for row in range(weight.shape[0]):
+                grad_row = grad[row].asnumpy()
+                if not mx.test_utils.almost_equal(grad_row, np.zeros_like(grad_row)):
+                    self._update_impl(lr, wd, weight[row], grad[row],
+                                      tuple(s[row] for s in state))
+        else:
+            self._update_impl(lr, wd, weight, grad, state)
+
+    def _update_impl(self, lr, wd, weight, grad, state):
         grad = grad * self.rescale_grad + wd * weight
 
         if not self.centered:
@@ -864,6 +876,23 @@ def test_rms():
                                 if (default_context() == mx.cpu()):
                                     compare_optimizer(opt1(**kwarg), opt2(**kwarg), shape, dtype, g_stype='row_sparse')
 
+@with_seed()
+def test_sparse_rms():
+    opt1 = PyRMSProp
+    opt2 = mx.optimizer.RMSProp
+    shape = (3, 4, 5)
+    kwargs = [{},
+              {'clip_gradient': 0.5, 'wd': 0.07},
+              {'clip_weights': 0.01, 'rescale_grad': 0.14},
+              {'centered': True},
+              {'centered': True, 'clip_gradient': 0.4, 'wd': 0.03, 'rescale_grad': 0.8}]
+    for kwarg in kwargs:
+        # the lazy update only touches the rows of weight and states present in grad
+        compare_optimizer(opt1(lazy_update=True, **kwarg), opt2(**kwarg), shape, np.float32,
+                          w_stype='row_sparse', g_stype='row_sparse')
+        compare_optimizer(opt1(**kwarg), opt2(lazy_update=False, **kwarg), shape, np.float32,
+                          w_stype='row_sparse', g_stype='row_sparse')
+
 class PyFtrl(mx.optimizer.Optimizer):
     """The Ftrl optimizer.
 
@@ -1031,6 +1060,89 @@ def test_adagrad():
                                               w_stype='row_sparse', g_stype='row_sparse')
 
 
+@with_seed()
+def test_multi_tensor_updates():
+    # every weight of one multi-tensor update against its own single-tensor update
+    shapes = [(3, 4), (7,), (2, 3, 5), (1,)] * 13
+    lrs = [0.1 + 0.01 * i for i in range(len(shapes))]
+    wds = [0.001 * (i % 3) for i in range(len(shapes))]
+    kwargs = {'rescale_grad': 0.7, 'clip_gradient': 0.5}
+    cases = [('multi_sgd_update', 'sgd_update', [], [], {}),
+             ('multi_sgd_mom_update', 'sgd_mom_update', ['mom'], [], {'momentum': 0.9}),
+             ('multi_mp_sgd_update', 'mp_sgd_update', [], ['weight32'], {}),
+             ('multi_mp_sgd_mom_update', 'mp_sgd_mom_update', ['mom'], ['weight32'],
+              {'momentum': 0.9}),
+             ('multi_adam_update', 'adam_update', ['mean', 'var'], [], {'beta1': 0.8})]
+    for multi_op, single_op, states, masters, op_kwargs in cases:
+        dtype = np.float16 if masters else np.float32
+        op_kwargs.update(kwargs)
+        for num_weights in [1, 5, len(shapes)]:
+            arrays = []
+            for shape in shapes[:num_weights]:
+                weight = mx.nd.random.uniform(-1, 1, shape).astype(dtype)
+                group = [weight, mx.nd.random.uniform(-1, 1, shape).astype(dtype)]
+                state_dtype = np.float32 if masters else dtype
+                group += [mx.nd.random.uniform(0, 1, shape).astype(state_dtype) for _ in states]
+                group += [weight.astype(np.float32) for _ in masters]
+                arrays.append(group)
+            expected = [[a.copy() for a in group] for group in arrays]
+            for i, group in enumerate(expected):
+                getattr(mx.nd, single_op)(*group, out=group[0], lr=lrs[i], wd=wds[i],
+                                          **op_kwargs)
+            getattr(mx.nd, multi_op)(*[a for group in arrays for a in group],
+                                     out=[group[0] for group in arrays],
+                                     lrs=lrs[:num_weights], wds=wds[:num_weights],
+                                     num_weights=num_weights, **op_kwargs)
+            rtol, atol = (1e-2, 1e-3) if dtype == np.float16 else (1e-5, 1e-6)
+            for group, expected_group in zip(arrays, expected):
+                for a, e in zip(group, expected_group):
+                    assert_almost_equal(a.asnumpy(), e.asnumpy(), rtol=rtol, atol=atol)
+
+
+@with_seed()
+def test_loss_scaled_update():
+    shapes = [(3, 4), (7,)]
+    loss_scale = mx.nd.array([8.0])
+    num_good_steps = mx.nd.array([0.0])
+    kwargs = {'lrs': [0.1, 0.2], 'wds': [0.01, 0.0], 'momentum': 0.9, 'num_weights': 2}
+    for overflow in [False, True]:
+        arrays = []
+        for shape in shapes:
+            weight = mx.nd.random.uniform(-1, 1, shape).astype(np.float16)
+            grad = mx.nd.random.uniform(-8, 8, shape).astype(np.float16)
+            arrays.append([weight, grad, mx.nd.random.uniform(0, 1, shape),
+                           weight.astype(np.float32)])
+        if overflow:
+            arrays[1][1][3] = np.inf
+        grads = [group[1] for group in arrays]
+        is_finite = mx.nd.multi_all_finite(*grads, num_arrays=len(grads))
+        assert is_finite.asscalar() == (0 if overflow else 1)
+        expected = [[a.copy() for a in group] for group in arrays]
+        if not overflow:
+            for i, group in enumerate(expected):
+                mx.nd.mp_sgd_mom_update(*group, out=group[0], lr=kwargs['lrs'][i],
+                                        wd=kwargs['wds'][i], momentum=0.9,
+                                        rescale_grad=1.0 / 8)
+        mx.nd.multi_mp_sgd_mom_update(*([a for group in arrays for a in group] +
+                                        [is_finite, loss_scale]),
+                                      out=[group[0] for group in arrays],
+                                      use_loss_scale=True, **kwargs)
+        for group, expected_group in zip(arrays, expected):
+            for a, e in zip(group, expected_group):
+                assert_almost_equal(a.asnumpy(), e.asnumpy(), rtol=1e-2, atol=1e-3)
+    # the overflow halves the scale, two good steps double it again
+    mx.nd.dynamic_loss_scale_update(mx.nd.array([0.0]), loss_scale, num_good_steps,
+                                    out=loss_scale, scale_window=2)
+    assert loss_scale.asscalar() == 4.0 and num_good_steps.asscalar() == 0
+    for steps in [1, 0]:
+        mx.nd.dynamic_loss_scale_update(mx.nd.array([1.0]), loss_scale, num_good_steps,
+                                        out=loss_scale, scale_window=2)
+        assert num_good_steps.asscalar() == steps
+    assert loss_scale.asscalar() == 8.0
+    mx.nd.dynamic_loss_scale_update(mx.nd.array([0.0]), loss_scale, num_good_steps,
+                                    out=loss_scale, min_loss_scale=6.0)
+    assert loss_scale.asscalar() == 6.0
+
 
 if __name__ == '__main__':
     import nose
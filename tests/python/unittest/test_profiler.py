@@ -21,6 +21,7 @@ import mxnet as mx
 from mxnet import profiler
 import time
 import os
+import json
 
 def enable_profiler(profile_filename, run=True, continuous_dump=False, aggregate_stats=False):
     profiler.set_config(profile_symbolic=True,
@@ -233,6 +234,22 @@ def test_continuous_profile_and_instant_marker():
     profiler.set_state('stop')
 
 
+
+def test_aggregate_stats_json():
+    enable_profiler('test_aggregate_stats_json.json', True, False, True)
+    a = mx.nd.ones((64, 64))
+    for _ in range(10):
+        a = mx.nd.dot(a, a)
+    a.wait_to_read()
+    profiler.set_state('stop')
+    stats = json.loads(profiler.dumps(reset=True, format='json'))
+    dot = stats['operator']['dot']
+    assert dot['count'] == 10
+    percentiles = [dot[k] for k in ['min_us', 'p50_us', 'p90_us', 'p99_us', 'p999_us', 'max_us']]
+    assert percentiles == sorted(percentiles)
+    assert sum(count for _, count in dot['histogram']) == 10
+    assert sum(dev['count'] for dev in dot['devices'].values()) == 10
+
 if __name__ == '__main__':
     import nose
     nose.runmodule()
@@ -282,6 +282,21 @@ def set_seed_variously_for_context(ctx, init_seed, num_init_seeds, final_seed):
     return end_seed
 
 # Tests that seed setting of std (non-parallel) rng for specific context is synchronous w.r.t. rng use before and after.
+# Tests that uniform and normal samples are a function of the seed and the index of the sample,
+# so a longer draw starts with the samples of a shorter one.
+@with_seed()
+def test_counter_based_random_independent_of_size():
+    ctx = mx.context.current_context()
+    for dtype in ['float16', 'float32', 'float64']:
+        for sampler in [mx.nd.random.uniform, mx.nd.random.normal]:
+            mx.random.seed(128)
+            short = sampler(shape=(10,), ctx=ctx, dtype=dtype).asnumpy()
+            mx.random.seed(128)
+            long = sampler(shape=(100003,), ctx=ctx, dtype=dtype).asnumpy()
+            assert same(short, long[:10]), \
+                "%s should give the same leading samples for any shape" % sampler.__name__
+
+
 @with_seed()
 def test_random_seed_setting_for_context():
     seed_to_test = 1234
@@ -1281,9 +1281,22 @@ def test_sparse_dot():
         sps_out = mx.nd.sparse.dot(lhs.tostype('csr'), rhs.tostype('row_sparse'), transpose_a=trans_lhs)
         assert same(dns_out.asnumpy(), sps_out.asnumpy())
 
+    def test_dot_csr_int32_idx(lhs_shape, num_cols, trans_lhs, lhs_density):
+        """csr with int32 indices and wide rhs, which the GPU dot may run through cuSPARSE"""
+        csr = rand_ndarray(lhs_shape, 'csr', density=lhs_density)
+        lhs_nd = mx.nd.sparse._csr_matrix_from_definition(
+            csr.data, csr.indices, csr.indptr, shape=lhs_shape,
+            indices_type=np.int32, indptr_type=np.int32)
+        rhs_nd = rand_ndarray((lhs_shape[0] if trans_lhs else lhs_shape[1], num_cols), 'default')
+        out = mx.nd.dot(lhs_nd, rhs_nd, transpose_a=trans_lhs)
+        out_np = mx.nd.dot(csr.tostype('default'), rhs_nd, transpose_a=trans_lhs).asnumpy()
+        assert_almost_equal(out.asnumpy(), out_np, rtol=1e-4, atol=1e-5)
+
     density = [1.00, 0.50, 0.01]
     for lhs_d in density:
         lhs_shape = rand_shape_2d(50, 200)
+        test_dot_csr_int32_idx(lhs_shape, rnd.randint(32, 80), False, lhs_d)
+        test_dot_csr_int32_idx(lhs_shape, rnd.randint(2, 80), True, lhs_d)
         rhs_d = 1
         test_dot_csr(lhs_shape, (lhs_shape[1], 1), 'default', False, lhs_d, rhs_d)  # test gpu SpMV
         test_dot_csr(lhs_shape, (lhs_shape[0], 1), 'default', True,  lhs_d, rhs_d)  # (vector kernel)
@@ -1874,6 +1887,26 @@ def test_scatter_ops():
                           lambda l, r: l + r,
                           rhs_is_scalar=True, verbose=False, density=0.5)
 
+@with_seed()
+def test_scatter_elemwise_div_inplace():
+    shape = (20, 4)
+    lhs_idx = np.array([1, 3, 8, 12, 19])
+    lhs_np = np.random.uniform(1, 2, (len(lhs_idx), shape[1])).astype(np.float32)
+    for rhs_stype in ['row_sparse', 'default']:
+        if rhs_stype == 'row_sparse':
+            rhs = mx.nd.sparse.row_sparse_array(
+                (np.random.uniform(1, 2, (7, shape[1])), [0, 1, 3, 8, 12, 15, 19]), shape=shape)
+        else:
+            rhs = mx.nd.array(np.random.uniform(1, 2, shape))
+        rhs_np = rhs.asnumpy()
+        expected = np.zeros(shape)
+        expected[lhs_idx] = lhs_np / rhs_np[lhs_idx]
+        lhs = mx.nd.sparse.row_sparse_array((lhs_np, lhs_idx), shape=shape)
+        mx.nd._internal._scatter_elemwise_div(lhs, rhs, out=lhs)
+        assert lhs.stype == 'row_sparse'
+        assert same(lhs.indices.asnumpy(), lhs_idx)
+        assert_almost_equal(lhs.asnumpy(), expected)
+
 @with_seed()
 def test_mkldnn_sparse():
     # This test is trying to create a race condition describedd in
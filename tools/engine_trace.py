@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+Summarize a trace written by the threaded engines with MXNET_ENGINE_TRACE=<file>.
+
+For every queue, a context and operation property, it reports how long the
+operations waited for their dependencies (push to ready), for a worker
+(ready to start) and ran (start to end). It then walks the critical path back
+from the operation that finished last, following for every operation the one
+whose completion made it ready.
+"""
+import argparse
+import collections
+import json
+
+parser = argparse.ArgumentParser(description='Summarize an mxnet engine trace')
+parser.add_argument('tracefile', type=str, help='the trace written by MXNET_ENGINE_TRACE')
+parser.add_argument('--top', type=int, default=20,
+                    help='number of operations of the critical path to show, 0 for all')
+args = parser.parse_args()
+
+oprs = {}
+with open(args.tracefile) as f:
+    for line in f:
+        line = line.strip()
+        if line:
+            opr = json.loads(line)
+            oprs[opr['id']] = opr
+if not oprs:
+    raise SystemExit('empty trace')
+
+begin = min(o['push'] for o in oprs.values())
+end = max(o['end'] for o in oprs.values())
+print('%d operations over %.3f ms' % (len(oprs), (end - begin) / 1e3))
+
+# per queue wait and run times
+queues = collections.defaultdict(lambda: [0, 0, 0, 0])
+for o in oprs.values():
+    q = queues[(o['ctx'], o['prop'])]
+    q[0] += 1
+    q[1] += o['ready'] - o['push']
+    q[2] += o['start'] - o['ready']
+    q[3] += o['end'] - o['start']
+print('\n| queue | ops | dependency wait (ms) | queue wait (ms) | run (ms) |')
+print('| --- | --- | --- | --- | --- |')
+for (ctx, prop), (n, dep, queue, run) in sorted(queues.items(), key=lambda x: -x[1][2]):
+    print('| %s %s | %d | %.3f | %.3f | %.3f |' % (ctx, prop, n, dep / 1e3, queue / 1e3,
+                                                  run / 1e3))
+
+# the critical path, from the last operation back to one that was ready at push
+path = []
+opr = max(oprs.values(), key=lambda o: o['end'])
+while opr is not None:
+    path.append(opr)
+    opr = oprs.get(opr['trigger'])
+path.reverse()
+totals = collections.Counter()
+rows = []
+for o in path:
+    prev = oprs.get(o['trigger'])
+    # time from the trigger finishing, or from the push, to this operation being ready
+    dispatch = o['ready'] - (prev['end'] if prev else o['push'])
+    queue = o['start'] - o['ready']
+    run = o['end'] - o['start']
+    totals['dispatch'] += dispatch
+    totals['queue'] += queue
+    totals['run'] += run
+    rows.append((o, dispatch, queue, run))
+host = path[0]['push'] - begin
+print('\ncritical path: %d operations, %.3f ms' % (len(path), (path[-1]['end'] - begin) / 1e3))
+print('  waiting for the pusher %.3f ms, for dependencies to be dispatched %.3f ms, '
+      'in worker queues %.3f ms, running %.3f ms' %
+      (host / 1e3, totals['dispatch'] / 1e3, totals['queue'] / 1e3, totals['run'] / 1e3))
+if args.top > 0:
+    rows = sorted(rows, key=lambda r: -(r[2] + r[3]))[:args.top]
+print('\n| id | name | queue | last satisfied var | queue wait (ms) | run (ms) |')
+print('| --- | --- | --- | --- | --- | --- |')
+for o, dispatch, queue, run in rows:
+    print('| %d | %s | %s %s | %s | %.3f | %.3f |' % (o['id'], o['name'], o['ctx'], o['prop'],
+                                                    o['var'] if o['trigger'] else 'push',
+                                                    queue / 1e3, run / 1e3))